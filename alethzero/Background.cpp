@@ -0,0 +1,98 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Background.cpp
+ * @date 2015
+ */
+
+#include "Background.h"
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEvent>
+#include <boost/exception/diagnostic_information.hpp>
+#include <libdevcore/Log.h>
+using namespace std;
+
+namespace
+{
+
+/// Carries what to do with a query's results to the UI thread.
+class Applied: public QEvent
+{
+public:
+	explicit Applied(Background::Apply const& _a): QEvent(QEvent::User), apply(_a) {}
+	Background::Apply apply;
+};
+
+}
+
+Background::Background():
+	m_thread([=](){ dev::setThreadName("views"); work(); })
+{
+}
+
+Background::~Background()
+{
+	{
+		lock_guard<mutex> l(x_queries);
+		m_stopping = true;
+	}
+	m_queriesChanged.notify_all();
+	m_thread.join();
+}
+
+void Background::run(string const& _kind, Query const& _q)
+{
+	{
+		lock_guard<mutex> l(x_queries);
+		if (!m_queries.count(_kind))
+			m_order.push_back(_kind);
+		m_queries[_kind] = _q;
+	}
+	m_queriesChanged.notify_all();
+}
+
+void Background::work()
+{
+	while (true)
+	{
+		Query q;
+		{
+			unique_lock<mutex> l(x_queries);
+			m_queriesChanged.wait(l, [&](){ return m_stopping || !m_order.empty(); });
+			if (m_stopping)
+				return;
+			q = m_queries[m_order.front()];
+			m_queries.erase(m_order.front());
+			m_order.pop_front();
+		}
+		try
+		{
+			if (Apply a = q())
+				QCoreApplication::postEvent(this, new Applied(a));
+		}
+		catch (...)
+		{
+			cwarn << "View query failed:" << boost::current_exception_diagnostic_information();
+		}
+	}
+}
+
+void Background::customEvent(QEvent* _e)
+{
+	if (_e->type() == QEvent::User)
+		static_cast<Applied*>(_e)->apply();
+}
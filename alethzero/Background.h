@@ -0,0 +1,64 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Background.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <QtCore/QObject>
+
+/**
+ * @brief Runs the slow queries of the views, of the chain and the state, on a thread of its own, one at a time, and
+ * hands what they make of them back to the UI thread.
+ * A query asked for again before it has started runs only once, as last asked for.
+ */
+class Background: public QObject
+{
+public:
+	/// What to do with the results of a query, on the UI thread.
+	using Apply = std::function<void()>;
+	using Query = std::function<Apply()>;
+
+	Background();
+	~Background();
+
+	/// Runs @a _q off the UI thread, then what it returns on the UI thread, replacing any query of @a _kind that has
+	/// yet to start.
+	void run(std::string const& _kind, Query const& _q);
+
+protected:
+	virtual void customEvent(QEvent* _e);
+
+private:
+	void work();
+
+	std::mutex x_queries;
+	std::condition_variable m_queriesChanged;
+	std::deque<std::string> m_order;				///< Kinds of m_queries, oldest asked for first.
+	std::map<std::string, Query> m_queries;
+	bool m_stopping = false;
+
+	std::thread m_thread;
+};
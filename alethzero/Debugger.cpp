@@ -46,12 +46,12 @@ Debugger::~Debugger()
 
 void Debugger::init()
 {
-	if (m_session.history.size())
+	if (stepCount())
 	{
 		alterDebugStateGroup(true);
 		ui->debugCode->setEnabled(false);
 		ui->debugTimeline->setMinimum(0);
-		ui->debugTimeline->setMaximum(m_session.history.size());
+		ui->debugTimeline->setMaximum(stepCount());
 		ui->debugTimeline->setValue(0);
 	}
 }
@@ -77,36 +77,7 @@ bool DebugSession::populate(dev::eth::Executive& _executive, dev::eth::Transacti
 		return false;
 	}
 
-	vector<WorldState const*> levels;
-	bytes lastExtCode;
-	bytesConstRef lastData;
-	h256 lastHash;
-	h256 lastDataHash;
-	auto onOp = [&](uint64_t steps, Instruction inst, dev::bigint newMemSize, dev::bigint gasCost, VM* voidVM, ExtVMFace const* voidExt)
-	{
-		VM& vm = *voidVM;
-		ExtVM const& ext = *static_cast<ExtVM const*>(voidExt);
-		if (ext.code != lastExtCode)
-		{
-			lastExtCode = ext.code;
-			lastHash = sha3(lastExtCode);
-			if (!codes.count(lastHash))
-				codes[lastHash] = ext.code;
-		}
-		if (ext.data != lastData)
-		{
-			lastData = ext.data;
-			lastDataHash = sha3(lastData);
-			if (!codes.count(lastDataHash))
-				codes[lastDataHash] = ext.data.toBytes();
-		}
-		if (levels.size() < ext.depth)
-			levels.push_back(&history.back());
-		else
-			levels.resize(ext.depth);
-		history.append(WorldState({steps, ext.myAddress, vm.curPC(), inst, newMemSize, vm.gas(), lastHash, lastDataHash, vm.stack(), vm.memory(), gasCost, ext.state().storage(ext.myAddress), levels}));
-	};
-	_executive.go(onOp);
+	_executive.go(trace.onOp());
 	_executive.finalize();
 	return true;
 }
@@ -125,12 +96,13 @@ void Debugger::finished()
 
 void Debugger::update()
 {
-	if (m_session.history.size())
+	StepTrace const& trace = m_session.trace;
+	if (trace.size())
 	{
-		WorldState const& nws = m_session.history[min((int)m_session.history.size() - 1, ui->debugTimeline->value())];
-		WorldState const& ws = ui->callStack->currentRow() > 0 ? *nws.levels[nws.levels.size() - ui->callStack->currentRow()] : nws;
+		TraceStep nws = trace.at(min(stepCount() - 1, ui->debugTimeline->value()));
+		TraceStep ws = ui->callStack->currentRow() > 0 ? trace.at(nws.levels[nws.levels.size() - ui->callStack->currentRow()]) : nws;
 
-		if (ui->debugTimeline->value() >= m_session.history.size())
+		if (ui->debugTimeline->value() >= stepCount())
 		{
 			if (ws.gasCost > ws.gas)
 				ui->debugMemory->setHtml("<h3>OUT-OF-GAS</h3>");
@@ -156,11 +128,11 @@ void Debugger::update()
 			ui->debugStateInfo->setText(QString::fromStdString(ss.str()));
 			ui->debugStorage->setHtml("");
 			ui->debugCallData->setHtml("");
-			m_session.currentData = h256();
+			m_session.currentData = (unsigned)-1;
 			ui->callStack->clear();
 			m_session.currentLevels.clear();
 			ui->debugCode->clear();
-			m_session.currentCode = h256();
+			m_session.currentCode = (unsigned)-1;
 			ui->debugStack->setHtml("");
 		}
 		else
@@ -171,19 +143,19 @@ void Debugger::update()
 				ui->callStack->clear();
 				for (unsigned i = 0; i <= nws.levels.size(); ++i)
 				{
-					WorldState const& s = i ? *nws.levels[nws.levels.size() - i] : nws;
+					StepInfo const& s = i ? trace.info(nws.levels[nws.levels.size() - i]) : nws;
 					ostringstream out;
-					out << s.cur.abridged();
+					out << trace.codes()[s.code].address.abridged();
 					if (i)
-						out << " " << instructionInfo(s.inst).name << " @0x" << hex << s.curPC;
+						out << " " << instructionInfo(s.inst).name << " @0x" << hex << s.pc;
 					ui->callStack->addItem(QString::fromStdString(out.str()));
 				}
 			}
 
+			bytes const& code = trace.codes()[ws.code].code;
 			if (ws.code != m_session.currentCode)
 			{
 				m_session.currentCode = ws.code;
-				bytes const& code = m_session.codes[ws.code];
 				QListWidget* dc = ui->debugCode;
 				dc->clear();
 				m_session.pcWarp.clear();
@@ -212,16 +184,10 @@ void Debugger::update()
 				}
 			}
 
-			if (ws.callData != m_session.currentData)
+			if (ws.data != m_session.currentData)
 			{
-				m_session.currentData = ws.callData;
-				if (ws.callData)
-				{
-					assert(m_session.codes.count(ws.callData));
-					ui->debugCallData->setHtml(QString::fromStdString(dev::memDump(m_session.codes[ws.callData], 16, true)));
-				}
-				else
-					ui->debugCallData->setHtml("");
+				m_session.currentData = ws.data;
+				ui->debugCallData->setHtml(QString::fromStdString(dev::memDump(trace.data()[ws.data], 16, true)));
 			}
 
 			QString stack;
@@ -229,20 +195,19 @@ void Debugger::update()
 				stack.prepend("<div>" + m_context->prettyU256(i) + "</div>");
 			ui->debugStack->setHtml(stack);
 			ui->debugMemory->setHtml(QString::fromStdString(dev::memDump(ws.memory, 16, true)));
-			assert(m_session.codes.count(ws.code));
 
-			if (m_session.codes[ws.code].size() >= (unsigned)ws.curPC)
+			if (code.size() >= (unsigned)ws.pc)
 			{
-				int l = m_session.pcWarp[(unsigned)ws.curPC];
+				int l = m_session.pcWarp[(unsigned)ws.pc];
 				ui->debugCode->setCurrentRow(max(0, l - 5));
 				ui->debugCode->setCurrentRow(min(ui->debugCode->count() - 1, l + 5));
 				ui->debugCode->setCurrentRow(l);
 			}
 			else
-				cwarn << "PC (" << (unsigned)ws.curPC << ") is after code range (" << m_session.codes[ws.code].size() << ")";
+				cwarn << "PC (" << (unsigned)ws.pc << ") is after code range (" << code.size() << ")";
 
 			ostringstream ss;
-			ss << dec << "STEP: " << ws.steps << "  |  PC: 0x" << hex << ws.curPC << "  :  " << instructionInfo(ws.inst).name << "  |  ADDMEM: " << dec << ws.newMemSize << " words  |  COST: " << dec << ws.gasCost <<  "  |  GAS: " << dec << ws.gas;
+			ss << dec << "STEP: " << ws.steps << "  |  PC: 0x" << hex << ws.pc << "  :  " << instructionInfo(ws.inst).name << "  |  ADDMEM: " << dec << ws.newMemSize << " words  |  COST: " << dec << ws.gasCost <<  "  |  GAS: " << dec << ws.gas;
 			ui->debugStateInfo->setText(QString::fromStdString(ss.str()));
 			stringstream s;
 			for (auto const& i: ws.storage)
@@ -277,12 +242,12 @@ void Debugger::on_debugTimeline_valueChanged()
 
 void Debugger::on_stepOver_clicked()
 {
-	if (ui->debugTimeline->value() < m_session.history.size()) {
-		auto l = m_session.history[ui->debugTimeline->value()].levels.size();
-		if ((ui->debugTimeline->value() + 1) < m_session.history.size() && m_session.history[ui->debugTimeline->value() + 1].levels.size() > l)
+	if (ui->debugTimeline->value() < stepCount()) {
+		auto l = depthAt(ui->debugTimeline->value());
+		if ((ui->debugTimeline->value() + 1) < stepCount() && depthAt(ui->debugTimeline->value() + 1) > l)
 		{
 			on_stepInto_clicked();
-			if (m_session.history[ui->debugTimeline->value()].levels.size() > l)
+			if (depthAt(ui->debugTimeline->value()) > l)
 				on_stepOut_clicked();
 		}
 		else
@@ -298,11 +263,11 @@ void Debugger::on_stepInto_clicked()
 
 void Debugger::on_stepOut_clicked()
 {
-	if (ui->debugTimeline->value() < m_session.history.size())
+	if (ui->debugTimeline->value() < stepCount())
 	{
-		auto ls = m_session.history[ui->debugTimeline->value()].levels.size();
+		auto ls = depthAt(ui->debugTimeline->value());
 		auto l = ui->debugTimeline->value();
-		for (; l < m_session.history.size() && m_session.history[l].levels.size() >= ls; ++l) {}
+		for (; l < stepCount() && depthAt(l) >= ls; ++l) {}
 		ui->debugTimeline->setValue(l);
 		ui->callStack->setCurrentRow(0);
 	}
@@ -316,11 +281,11 @@ void Debugger::on_backInto_clicked()
 
 void Debugger::on_backOver_clicked()
 {
-	auto l = m_session.history[ui->debugTimeline->value()].levels.size();
-	if (ui->debugTimeline->value() > 0 && m_session.history[ui->debugTimeline->value() - 1].levels.size() > l)
+	auto l = depthAt(ui->debugTimeline->value());
+	if (ui->debugTimeline->value() > 0 && depthAt(ui->debugTimeline->value() - 1) > l)
 	{
 		on_backInto_clicked();
-		if (m_session.history[ui->debugTimeline->value()].levels.size() > l)
+		if (depthAt(ui->debugTimeline->value()) > l)
 			on_backOut_clicked();
 	}
 	else
@@ -329,11 +294,11 @@ void Debugger::on_backOver_clicked()
 
 void Debugger::on_backOut_clicked()
 {
-	if (ui->debugTimeline->value() > 0 && m_session.history.size() > 0)
+	if (ui->debugTimeline->value() > 0 && stepCount() > 0)
 	{
-		auto ls = m_session.history[min(ui->debugTimeline->value(), m_session.history.size() - 1)].levels.size();
+		auto ls = depthAt(min(ui->debugTimeline->value(), stepCount() - 1));
 		int l = ui->debugTimeline->value();
-		for (; l > 0 && m_session.history[l].levels.size() >= ls; --l) {}
+		for (; l > 0 && depthAt(l) >= ls; --l) {}
 		ui->debugTimeline->setValue(l);
 		ui->callStack->setCurrentRow(0);
 	}
@@ -343,18 +308,24 @@ void Debugger::on_dump_clicked()
 {
 	QString fn = QFileDialog::getSaveFileName(this, "Select file to output EVM trace");
 	ofstream f(fn.toStdString());
+	StepTrace const& trace = m_session.trace;
 	if (f.is_open())
-		for (WorldState const& ws: m_session.history)
-			f << ws.cur << " " << hex << toHex(dev::toCompactBigEndian(ws.curPC, 1)) << " " << hex << toHex(dev::toCompactBigEndian((int)(byte)ws.inst, 1)) << " " << hex << toHex(dev::toCompactBigEndian((uint64_t)ws.gas, 1)) << endl;
+		for (unsigned n = 0; n < trace.size(); ++n)
+		{
+			StepInfo const& ws = trace.info(n);
+			f << trace.codes()[ws.code].address << " " << hex << toHex(dev::toCompactBigEndian(ws.pc, 1)) << " " << hex << toHex(dev::toCompactBigEndian((int)(byte)ws.inst, 1)) << " " << hex << toHex(dev::toCompactBigEndian((uint64_t)ws.gas, 1)) << endl;
+		}
 }
 
 void Debugger::on_dumpPretty_clicked()
 {
 	QString fn = QFileDialog::getSaveFileName(this, "Select file to output EVM trace");
 	ofstream f(fn.toStdString());
+	StepTrace const& trace = m_session.trace;
 	if (f.is_open())
-		for (WorldState const& ws: m_session.history)
+		for (unsigned n = 0; n < trace.size(); ++n)
 		{
+			TraceStep ws = trace.at(n);
 			f << endl << "    STACK" << endl;
 			for (auto i: ws.stack)
 				f << (h256)i << endl;
@@ -362,7 +333,7 @@ void Debugger::on_dumpPretty_clicked()
 			f << "    STORAGE" << endl;
 			for (auto const& i: ws.storage)
 				f << showbase << hex << i.first << ": " << i.second << endl;
-			f << dec << ws.levels.size() << " | " << ws.cur << " | #" << ws.steps << " | " << hex << setw(4) << setfill('0') << ws.curPC << " : " << instructionInfo(ws.inst).name << " | " << dec << ws.gas << " | -" << dec << ws.gasCost << " | " << ws.newMemSize << "x32";
+			f << dec << ws.levels.size() << " | " << trace.codes()[ws.code].address << " | #" << ws.steps << " | " << hex << setw(4) << setfill('0') << ws.pc << " : " << instructionInfo(ws.inst).name << " | " << dec << ws.gas << " | -" << dec << ws.gasCost << " | " << ws.newMemSize << "x32";
 		}
 }
 
@@ -370,12 +341,14 @@ void Debugger::on_dumpStorage_clicked()
 {
 	QString fn = QFileDialog::getSaveFileName(this, "Select file to output EVM trace");
 	ofstream f(fn.toStdString());
+	StepTrace const& trace = m_session.trace;
 	if (f.is_open())
-		for (WorldState const& ws: m_session.history)
+		for (unsigned n = 0; n < trace.size(); ++n)
 		{
+			StepInfo const& ws = trace.info(n);
 			if (ws.inst == Instruction::STOP || ws.inst == Instruction::RETURN || ws.inst == Instruction::SUICIDE)
-				for (auto i: ws.storage)
+				for (auto i: trace.at(n, false).storage)
 					f << toHex(dev::toCompactBigEndian(i.first, 1)) << " " << toHex(dev::toCompactBigEndian(i.second, 1)) << endl;
-			f << ws.cur << " " << hex << toHex(dev::toCompactBigEndian(ws.curPC, 1)) << " " << hex << toHex(dev::toCompactBigEndian((int)(byte)ws.inst, 1)) << " " << hex << toHex(dev::toCompactBigEndian((uint64_t)ws.gas, 1)) << endl;
+			f << trace.codes()[ws.code].address << " " << hex << toHex(dev::toCompactBigEndian(ws.pc, 1)) << " " << hex << toHex(dev::toCompactBigEndian((int)(byte)ws.inst, 1)) << " " << hex << toHex(dev::toCompactBigEndian((uint64_t)ws.gas, 1)) << endl;
 		}
 }
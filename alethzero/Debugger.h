@@ -25,6 +25,7 @@
 #include <libethcore/Common.h>
 #include <libethereum/State.h>
 #include <libethereum/Executive.h>
+#include <libethereum/StepTrace.h>
 #include <QDialog>
 #include <QMap>
 #include <QList>
@@ -32,37 +33,18 @@
 
 namespace Ui { class Debugger; }
 
-struct WorldState
-{
-	uint64_t steps;
-	dev::Address cur;
-	dev::u256 curPC;
-	dev::eth::Instruction inst;
-	dev::bigint newMemSize;
-	dev::u256 gas;
-	dev::h256 code;
-	dev::h256 callData;
-	dev::u256s stack;
-	dev::bytes memory;
-	dev::bigint gasCost;
-	std::map<dev::u256, dev::u256> storage;
-	std::vector<WorldState const*> levels;
-};
-
 struct DebugSession
 {
 	DebugSession() {}
 
 	bool populate(dev::eth::Executive& _executive, dev::eth::Transaction const& _transaction);
 
-	dev::h256 currentCode;
-	dev::h256 currentData;
-	std::vector<WorldState const*> currentLevels;
+	unsigned currentCode = (unsigned)-1;
+	unsigned currentData = (unsigned)-1;
+	std::vector<unsigned> currentLevels;
 
 	QMap<unsigned, unsigned> pcWarp;
-	QList<WorldState> history;
-
-	std::map<dev::u256, dev::bytes> codes;
+	dev::eth::StepTrace trace;
 };
 
 class Debugger: public QDialog
@@ -95,6 +77,8 @@ private:
 	void finished();
 
 	void alterDebugStateGroup(bool _enable) const;
+	int stepCount() const { return (int)m_session.trace.size(); }
+	unsigned depthAt(int _step) const { return m_session.trace.info(std::min(_step, stepCount() - 1)).depth; }
 
 	Ui::Debugger* ui;
 
@@ -34,50 +34,76 @@ DownloadView::DownloadView(QWidget* _p): QWidget(_p)
 {
 }
 
-void DownloadView::paintEvent(QPaintEvent*)
+void DownloadView::refresh()
 {
-	QPainter p(this);
-
-	p.fillRect(rect(), Qt::white);
-	if (!m_man || m_man->chain().empty() || !m_man->subCount())
-		return;
+	vector<int> states;
+	unsigned subs = 0;
+	if (m_man && !m_man->chain().empty() && (subs = m_man->subCount()))
+	{
+		// Gathered from the masks rather than asked of every sub for every block.
+		auto bg = m_man->blocksGot();
+		unsigned from = bg.all().first;
+		states.assign(bg.all().second - from, -2);
+		int h = 0;
+		m_man->foreachSub([&](DownloadSub const& sub)
+		{
+			for (auto i: sub.asked())
+				if (i >= from && i - from < states.size())
+					states[i - from] = h;
+			h++;
+		});
+		for (auto i: bg)
+			states[i - from] = -1;
+	}
 
 	double ratio = (double)rect().width() / rect().height();
 	if (ratio < 1)
 		ratio = 1 / ratio;
-	double n = min(16.0, min(rect().width(), rect().height()) / ceil(sqrt(m_man->chain().size() / ratio)));
+	double n = states.empty() ? 0 : min(16.0, min(rect().width(), rect().height()) / ceil(sqrt(states.size() / ratio)));
+	unsigned columns = n ? max<int>(1, rect().width() / n) : 1;
+
+	if (states.size() != m_states.size() || subs != m_subs || n != m_cell || columns != m_columns)
+	{
+		m_states.swap(states);
+		m_subs = subs;
+		m_cell = n;
+		m_columns = columns;
+		update();
+		return;
+	}
 
-//	QSizeF area(rect().width() / floor(rect().width() / n), rect().height() / floor(rect().height() / n));
-	QSizeF area(n, n);
-	QPointF pos(0, 0);
+	QRegion dirty;
+	for (unsigned i = 0; i < states.size(); ++i)
+		if (states[i] != m_states[i])
+			dirty += cell(i).toAlignedRect();
+	m_states.swap(states);
+	if (!dirty.isEmpty())
+		update(dirty);
+}
 
-	auto bg = m_man->blocksGot();
+void DownloadView::paintEvent(QPaintEvent* _e)
+{
+	QPainter p(this);
+	QRect r = _e->rect();
 
-	for (unsigned i = bg.all().first, ei = bg.all().second; i < ei; ++i)
+	p.fillRect(r, Qt::white);
+	if (m_states.empty())
+		return;
+
+	// Only the rows of the region being repainted.
+	unsigned from = min<size_t>(m_states.size(), unsigned(r.top() / m_cell) * m_columns);
+	unsigned to = min<size_t>(m_states.size(), unsigned(r.bottom() / m_cell + 1) * m_columns);
+	unsigned dh = 360 / m_subs;
+	QSizeF area(m_cell, m_cell);
+	for (unsigned i = from; i < to; ++i)
 	{
-		int s = -2;
-		if (bg.contains(i))
-			s = -1;
-		else
-		{
-			unsigned h = 0;
-			m_man->foreachSub([&](DownloadSub const& sub)
-			{
-				if (sub.askedContains(i))
-					s = h;
-				h++;
-			});
-		}
-		unsigned dh = 360 / m_man->subCount();
+		QPointF pos = cell(i).topLeft();
+		int s = m_states[i];
 		if (s == -2)
-			p.fillRect(QRectF(QPointF(pos) + QPointF(3 * area.width() / 8, 3 * area.height() / 8), area / 4), Qt::black);
+			p.fillRect(QRectF(pos + QPointF(3 * area.width() / 8, 3 * area.height() / 8), area / 4), Qt::black);
 		else if (s == -1)
-			p.fillRect(QRectF(QPointF(pos) + QPointF(1 * area.width() / 8, 1 * area.height() / 8), area * 3 / 4), Qt::black);
+			p.fillRect(QRectF(pos + QPointF(1 * area.width() / 8, 1 * area.height() / 8), area * 3 / 4), Qt::black);
 		else
-			p.fillRect(QRectF(QPointF(pos) + QPointF(1 * area.width() / 8, 1 * area.height() / 8), area * 3 / 4), QColor::fromHsv(s * dh, 64, 128));
-
-		pos.setX(pos.x() + n);
-		if (pos.x() >= rect().width() - n)
-			pos = QPoint(0, pos.y() + n);
+			p.fillRect(QRectF(pos + QPointF(1 * area.width() / 8, 1 * area.height() / 8), area * 3 / 4), QColor::fromHsv(s * dh, 64, 128));
 	}
 }
@@ -43,11 +43,24 @@ class DownloadView: public QWidget
 public:
 	DownloadView(QWidget* _p = nullptr);
 
-	void setDownloadMan(dev::eth::DownloadMan const* _man) { m_man = _man; }
+	void setDownloadMan(dev::eth::DownloadMan const* _man) { m_man = _man; m_states.clear(); refresh(); }
+
+	/// Repaints the blocks whose state has changed since the last refresh, or all of them if their layout has.
+	void refresh();
 
 protected:
-	virtual void paintEvent(QPaintEvent*);
+	virtual void paintEvent(QPaintEvent* _e);
+	virtual void resizeEvent(QResizeEvent*) { m_states.clear(); refresh(); }
 
 private:
+	/// @returns the cell of block @a _i.
+	QRectF cell(unsigned _i) const { return QRectF((_i % m_columns) * m_cell, (_i / m_columns) * m_cell, m_cell, m_cell); }
+
 	dev::eth::DownloadMan const* m_man = nullptr;
+
+	/// Of each block as last refreshed: -2 if not got, -1 if got, else the index of the sub asking for it.
+	std::vector<int> m_states;
+	unsigned m_subs = 0;
+	double m_cell = 0;
+	unsigned m_columns = 1;
 };
@@ -139,6 +139,47 @@ void Grapher::drawLineGraph(vector<float> const& _data, QColor _color, QBrush co
 	}
 }
 
+void Grapher::drawLineGraph(GraphData const& _data, QColor _color, float _width) const
+{
+	p->setPen(QPen(_color, _width));
+	bool started = false;
+	QPoint last;
+	int x = 0;
+	int first = 0;
+	int lo = 0;
+	int hi = 0;
+	int end = 0;
+	auto flush = [&]()
+	{
+		if (started)
+			p->drawLine(last, QPoint(x, first));
+		if (lo != hi)
+			p->drawLine(x, lo, x, hi);
+		last = QPoint(x, end);
+		started = true;
+	};
+	for (unsigned i = 0; i < _data.size(); ++i)
+	{
+		int ix = xTP(i);
+		int iy = yTP(_data[i]);
+		if (!i || ix != x)
+		{
+			if (i)
+				flush();
+			x = ix;
+			first = lo = hi = end = iy;
+		}
+		else
+		{
+			lo = min(lo, iy);
+			hi = max(hi, iy);
+			end = iy;
+		}
+	}
+	if (!_data.empty())
+		flush();
+}
+
 void Grapher::ruleY(float _x, QColor _color, float _width) const
 {
 	p->setPen(QPen(_color, _width));
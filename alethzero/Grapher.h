@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <map>
 #include <vector>
 #include <string>
@@ -34,6 +35,33 @@ class QPainter;
 namespace lb
 {
 
+/// A history of samples of fixed capacity, in which adding one to a full history drops the oldest, in constant time.
+class GraphData
+{
+public:
+	explicit GraphData(unsigned _capacity): m_data(std::max(_capacity, 1u)) {}
+
+	void push(float _v)
+	{
+		m_data[(m_first + m_size) % m_data.size()] = _v;
+		if (m_size < m_data.size())
+			++m_size;
+		else
+			m_first = (m_first + 1) % m_data.size();
+	}
+	void clear() { m_first = m_size = 0; }
+
+	unsigned size() const { return m_size; }
+	bool empty() const { return !m_size; }
+	/// @returns the sample @a _i after the oldest.
+	float operator[](unsigned _i) const { return m_data[(m_first + _i) % m_data.size()]; }
+
+private:
+	std::vector<float> m_data;
+	unsigned m_first = 0;
+	unsigned m_size = 0;
+};
+
 class Grapher
 {
 public:
@@ -70,6 +98,9 @@ public:
 
 	bool drawAxes(bool _x = true, bool _y = true) const;
 	void drawLineGraph(std::vector<float> const& _data, QColor _color = QColor(128, 128, 128), QBrush const& _fillToZero = Qt::NoBrush, float _width = 0.f) const;
+	/// Draws @a _data decimated to the pixel columns it spans: a vertical line over the least to the greatest sample
+	/// of each, joined to the next. Costs as many lines as the graph is pixels wide, however long the history.
+	void drawLineGraph(GraphData const& _data, QColor _color = QColor(128, 128, 128), float _width = 0.f) const;
 	void drawLineGraph(std::function<float(float)> const& _f, QColor _color = QColor(128, 128, 128), QBrush const& _fillToZero = Qt::NoBrush, float _width = 0.f) const;
 	void ruleX(float _y, QColor _color = QColor(128, 128, 128), float _width = 0.f) const;
 	void ruleY(float _x, QColor _color = QColor(128, 128, 128), float _width = 0.f) const;
@@ -157,6 +157,17 @@ Main::Main(QWidget *parent) :
 	ui->configDock->close();
 	on_verbosity_valueChanged();
 
+	// Lines all of a height let the lists lay out only those in view, however many they hold.
+	QList<QListWidget*> lists = { ui->blocks, ui->transactionQueue, ui->ourAccounts };
+#if ETH_FATDB
+	lists += { ui->accounts, ui->contracts };
+#endif
+	for (QListWidget* l: lists)
+	{
+		l->setUniformItemSizes(true);
+		l->setLayoutMode(QListView::Batched);
+	}
+
 	statusBar()->addPermanentWidget(ui->cacheUsage);
 	statusBar()->addPermanentWidget(ui->balance);
 	statusBar()->addPermanentWidget(ui->peerCount);
@@ -971,41 +982,27 @@ void Main::refreshMining()
 void Main::refreshBalances()
 {
 	cwatch << "refreshBalances()";
-	// update all the balance-dependent stuff.
-	ui->ourAccounts->clear();
-	u256 totalBalance = 0;
-/*	map<Address, tuple<QString, u256, u256>> altCoins;
-	Address coinsAddr = getCurrencies();
-	for (unsigned i = 0; i < ethereum()->stateAt(coinsAddr, PendingBlock); ++i)
-	{
-		auto n = ethereum()->stateAt(coinsAddr, i + 1);
-		auto addr = right160(ethereum()->stateAt(coinsAddr, n));
-		auto denom = ethereum()->stateAt(coinsAddr, sha3(h256(n).asBytes()));
-		if (denom == 0)
-			denom = 1;
-//		cdebug << n << addr << denom << sha3(h256(n).asBytes());
-		altCoins[addr] = make_tuple(fromRaw(n), 0, denom);
-	}*/
-	for (auto i: m_myKeys)
+	auto keys = m_myKeys;
+	m_background.run("balances", [=]() -> Background::Apply
 	{
-		u256 b = ethereum()->balanceAt(i.address());
-		(new QListWidgetItem(QString("%2: %1 [%3]").arg(formatBalance(b).c_str()).arg(render(i.address())).arg((unsigned)ethereum()->countAt(i.address())), ui->ourAccounts))
-			->setData(Qt::UserRole, QByteArray((char const*)i.address().data(), Address::size));
-		totalBalance += b;
-
-//		for (auto& c: altCoins)
-//			get<1>(c.second) += (u256)ethereum()->stateAt(c.first, (u160)i.address());
-	}
-
-	QString b;
-/*	for (auto const& c: altCoins)
-		if (get<1>(c.second))
+		State st = ethereum()->postState();
+		vector<pair<Address, QString>> lines;
+		u256 totalBalance = 0;
+		for (auto const& i: keys)
+		{
+			u256 b = st.balance(i.address());
+			lines.push_back(make_pair(i.address(), QString("%2: %1 [%3]").arg(formatBalance(b).c_str()).arg(render(i.address())).arg((unsigned)st.transactionsFrom(i.address()))));
+			totalBalance += b;
+		}
+		return [=]()
 		{
-			stringstream s;
-			s << setw(toString(get<2>(c.second) - 1).size()) << setfill('0') << (get<1>(c.second) % get<2>(c.second));
-			b += QString::fromStdString(toString(get<1>(c.second) / get<2>(c.second)) + "." + s.str() + " ") + get<0>(c.second).toUpper() + " | ";
-		}*/
-	ui->balance->setText(b + QString::fromStdString(formatBalance(totalBalance)));
+			ui->ourAccounts->clear();
+			for (auto const& i: lines)
+				(new QListWidgetItem(i.second, ui->ourAccounts))
+					->setData(Qt::UserRole, QByteArray((char const*)i.first.data(), Address::size));
+			ui->balance->setText(QString::fromStdString(formatBalance(totalBalance)));
+		};
+	});
 }
 
 void Main::refreshNetwork()
@@ -1047,52 +1044,119 @@ void Main::refreshAll()
 	refreshBlockChain();
 	refreshBlockCount();
 	refreshPending();
-	refreshAccounts();
+	refreshAccounts(true);
 	refreshBalances();
 }
 
+QString Main::renderTransaction(Transaction const& _t, State const& _s) const
+{
+	return _t.receiveAddress() ?
+		QString("%2 %5> %3: %1 [%4]")
+			.arg(formatBalance(_t.value()).c_str())
+			.arg(render(_t.safeSender()))
+			.arg(render(_t.receiveAddress()))
+			.arg((unsigned)_t.nonce())
+			.arg(_s.addressHasCode(_t.receiveAddress()) ? '*' : '-') :
+		QString("%2 +> %3: %1 [%4]")
+			.arg(formatBalance(_t.value()).c_str())
+			.arg(render(_t.safeSender()))
+			.arg(render(right160(sha3(rlpList(_t.safeSender(), _t.nonce())))))
+			.arg((unsigned)_t.nonce());
+}
+
 void Main::refreshPending()
 {
 	cwatch << "refreshPending()";
-	ui->transactionQueue->clear();
-	for (Transaction const& t: ethereum()->pending())
+	m_background.run("pending", [=]() -> Background::Apply
+	{
+		State st = ethereum()->postState();
+		QStringList lines;
+		for (Transaction const& t: ethereum()->pending())
+			lines.push_back(renderTransaction(t, st));
+		return [=]()
+		{
+			ui->transactionQueue->clear();
+			ui->transactionQueue->addItems(lines);
+		};
+	});
+}
+
+void Main::setAccountItem(QListWidget* _list, map<Address, QListWidgetItem*>& io_items, Address const& _a, QString const& _text, bool _first)
+{
+	auto& item = io_items[_a];
+	if (item)
 	{
-		QString s = t.receiveAddress() ?
-			QString("%2 %5> %3: %1 [%4]")
-				.arg(formatBalance(t.value()).c_str())
-				.arg(render(t.safeSender()))
-				.arg(render(t.receiveAddress()))
-				.arg((unsigned)t.nonce())
-				.arg(ethereum()->codeAt(t.receiveAddress()).size() ? '*' : '-') :
-			QString("%2 +> %3: %1 [%4]")
-				.arg(formatBalance(t.value()).c_str())
-				.arg(render(t.safeSender()))
-				.arg(render(right160(sha3(rlpList(t.safeSender(), t.nonce())))))
-				.arg((unsigned)t.nonce());
-		ui->transactionQueue->addItem(s);
+		item->setText(_text);
+		return;
 	}
+	item = new QListWidgetItem(_text);
+	item->setData(Qt::UserRole, QByteArray((char const*)_a.data(), Address::size));
+	_list->insertItem(_first ? 0 : _list->count(), item);
 }
 
-void Main::refreshAccounts()
+void Main::refreshAccounts(bool _rerender)
 {
 #if ETH_FATDB
 	cwatch << "refreshAccounts()";
-	ui->accounts->clear();
-	ui->contracts->clear();
-	for (auto n = 0; n < 2; ++n)
-		for (auto i: ethereum()->addresses())
+	bool all = ui->showAllAccounts->isChecked();
+	m_background.run(_rerender ? "accounts all" : "accounts", [=]() -> Background::Apply
+	{
+		// Only the accounts whose balances have changed since last time are rendered, which takes lookups of their
+		// names; named accounts go first.
+		State st = ethereum()->postState();
+		bool reset = _rerender || all != m_accountsSeenAll;
+		if (reset)
+			m_accountsSeen.clear();
+		m_accountsSeenAll = all;
+
+		struct Line { Address address; QString text; bool named; bool contract; };
+		vector<Line> changed;
+		vector<Address> gone;
+		auto now = st.addresses();
+		for (auto const& i: now)
 		{
-			auto r = render(i);
-			if (r.contains('(') == !n)
+			auto it = m_accountsSeen.find(i.first);
+			if (it != m_accountsSeen.end() && it->second == i.second)
+				continue;
+			QString r = render(i.first);
+			changed.push_back(Line{i.first, QString("%2: %1 [%3]").arg(formatBalance(i.second).c_str()).arg(r).arg((unsigned)st.transactionsFrom(i.first)), r.contains('('), st.addressHasCode(i.first)});
+		}
+		for (auto const& i: m_accountsSeen)
+			if (!now.count(i.first))
+				gone.push_back(i.first);
+		m_accountsSeen.swap(now);
+		if (!reset && changed.empty() && gone.empty())
+			return Background::Apply();
+
+		return [=]()
+		{
+			if (reset)
 			{
-				if (n == 0 || ui->showAllAccounts->isChecked())
-					(new QListWidgetItem(QString("%2: %1 [%3]").arg(formatBalance(ethereum()->balanceAt(i)).c_str()).arg(r).arg((unsigned)ethereum()->countAt(i)), ui->accounts))
-						->setData(Qt::UserRole, QByteArray((char const*)i.data(), Address::size));
-				if (ethereum()->codeAt(i).size())
-					(new QListWidgetItem(QString("%2: %1 [%3]").arg(formatBalance(ethereum()->balanceAt(i)).c_str()).arg(r).arg((unsigned)ethereum()->countAt(i)), ui->contracts))
-						->setData(Qt::UserRole, QByteArray((char const*)i.data(), Address::size));
+				ui->accounts->clear();
+				ui->contracts->clear();
+				m_accountItems.clear();
+				m_contractItems.clear();
 			}
-		}
+			for (auto const& a: gone)
+			{
+				for (auto items: { &m_accountItems, &m_contractItems })
+					if (items->count(a))
+					{
+						delete (*items)[a];
+						items->erase(a);
+					}
+			}
+			for (auto const& l: changed)
+			{
+				if (l.named || all)
+					setAccountItem(ui->accounts, m_accountItems, l.address, l.text, l.named);
+				if (l.contract)
+					setAccountItem(ui->contracts, m_contractItems, l.address, l.text, l.named);
+			}
+		};
+	});
+#else
+	(void)_rerender;
 #endif
 }
 
@@ -1100,7 +1164,7 @@ void Main::refreshBlockCount()
 {
 	auto d = ethereum()->blockChain().details();
 	BlockQueueStatus b = ethereum()->blockQueueStatus();
-	ui->chainStatus->setText(QString("%3 ready %4 future %5 unknown %6 bad  %1 #%2").arg(m_privateChain.size() ? "[" + m_privateChain + "] " : "testnet").arg(d.number).arg(b.ready).arg(b.future).arg(b.unknown).arg(b.bad));
+	ui->chainStatus->setText(QString("%3 ready %4 verifying %5 future %6 unknown %7 bad  %1 #%2").arg(m_privateChain.size() ? "[" + m_privateChain + "] " : "testnet").arg(d.number).arg(b.ready).arg(b.verifying).arg(b.future).arg(b.unknown).arg(b.bad));
 }
 
 void Main::on_turboMining_triggered()
@@ -1112,86 +1176,109 @@ void Main::refreshBlockChain()
 {
 	cwatch << "refreshBlockChain()";
 
-	// TODO: keep the same thing highlighted.
-	// TODO: refactor into MVC
-	// TODO: use get by hash/number
-	// TODO: transactions
-
-	auto const& bc = ethereum()->blockChain();
 	QStringList filters = ui->blockChainFilter->text().toLower().split(QRegExp("\\s+"), QString::SkipEmptyParts);
+	unsigned limit = ui->showAll->isChecked() ? (unsigned)-1 : 10;
+	// The latest blocks, unfiltered, need only those since the last shown; anything else is redrawn.
+	h256 shown = filters.empty() && m_shownLatest && m_shownLimit == limit && !m_shownBlocks.empty() ? m_shownBlocks.front().first : h256();
 
-	h256Set blocks;
-	for (QString f: filters)
-		if (f.size() == 64)
+	m_background.run("blockchain", [=]() -> Background::Apply
+	{
+		auto const& bc = ethereum()->blockChain();
+		State st = ethereum()->postState();
+
+		h256s blocks;
+		bool incremental = false;
+		if (filters.empty())
 		{
-			h256 h(f.toStdString());
-			if (bc.isKnown(h))
-				blocks.insert(h);
-			for (auto const& b: bc.withBlockBloom(LogBloom().shiftBloom<3>(sha3(h)), 0, -1))
-				blocks.insert(bc.numberHash(b));
+			unsigned i = limit;
+			for (auto h = bc.currentHash(); bc.details(h) && i; h = bc.details(h).parent, --i)
+			{
+				if (h == shown)
+				{
+					incremental = true;
+					break;
+				}
+				blocks.push_back(h);
+				if (h == bc.genesisHash())
+					break;
+			}
+			if (incremental && blocks.empty())
+				return Background::Apply();
 		}
-		else if (f.toLongLong() <= bc.number())
-			blocks.insert(bc.numberHash((unsigned)f.toLongLong()));
-		else if (f.size() == 40)
+		else
 		{
-			Address h(f.toStdString());
-			for (auto const& b: bc.withBlockBloom(LogBloom().shiftBloom<3>(sha3(h)), 0, -1))
-				blocks.insert(bc.numberHash(b));
+			h256Set found;
+			for (QString f: filters)
+				if (f.size() == 64)
+				{
+					h256 h(f.toStdString());
+					if (bc.isKnown(h))
+						found.insert(h);
+					for (auto const& b: bc.withBlockBloom(LogBloom().shiftBloom<3>(sha3(h)), 0, -1))
+						found.insert(bc.numberHash(b));
+				}
+				else if (f.toLongLong() <= bc.number())
+					found.insert(bc.numberHash((unsigned)f.toLongLong()));
+				else if (f.size() == 40)
+				{
+					Address h(f.toStdString());
+					for (auto const& b: bc.withBlockBloom(LogBloom().shiftBloom<3>(sha3(h)), 0, -1))
+						found.insert(bc.numberHash(b));
+				}
+			blocks = h256s(found.begin(), found.end());
 		}
 
-	QByteArray oldSelected = ui->blocks->count() ? ui->blocks->currentItem()->data(Qt::UserRole).toByteArray() : QByteArray();
-	ui->blocks->clear();
-	auto showBlock = [&](h256 const& h) {
-		auto d = bc.details(h);
-		QListWidgetItem* blockItem = new QListWidgetItem(QString("#%1 %2").arg(d.number).arg(h.abridged().c_str()), ui->blocks);
-		auto hba = QByteArray((char const*)h.data(), h.size);
-		blockItem->setData(Qt::UserRole, hba);
-		if (oldSelected == hba)
-			blockItem->setSelected(true);
-
-		int n = 0;
-		auto b = bc.block(h);
-		for (auto const& i: RLP(b)[1])
+		// Each block's line, then those of its transactions.
+		vector<QStringList> lines;
+		for (auto const& h: blocks)
 		{
-			Transaction t(i.data(), CheckTransaction::Everything);
-			QString s = t.receiveAddress() ?
-				QString("    %2 %5> %3: %1 [%4]")
-					.arg(formatBalance(t.value()).c_str())
-					.arg(render(t.safeSender()))
-					.arg(render(t.receiveAddress()))
-					.arg((unsigned)t.nonce())
-					.arg(ethereum()->codeAt(t.receiveAddress()).size() ? '*' : '-') :
-				QString("    %2 +> %3: %1 [%4]")
-					.arg(formatBalance(t.value()).c_str())
-					.arg(render(t.safeSender()))
-					.arg(render(right160(sha3(rlpList(t.safeSender(), t.nonce())))))
-					.arg((unsigned)t.nonce());
-			QListWidgetItem* txItem = new QListWidgetItem(s, ui->blocks);
-			auto hba = QByteArray((char const*)h.data(), h.size);
-			txItem->setData(Qt::UserRole, hba);
-			txItem->setData(Qt::UserRole + 1, n);
-			if (oldSelected == hba)
-				txItem->setSelected(true);
-			n++;
+			lines.push_back(QStringList(QString("#%1 %2").arg(bc.details(h).number).arg(h.abridged().c_str())));
+			for (auto const& i: RLP(bc.block(h))[1])
+				lines.back().push_back("    " + renderTransaction(Transaction(i.data(), CheckTransaction::Everything), st));
 		}
-	};
 
-	if (filters.empty())
-	{
-		unsigned i = ui->showAll->isChecked() ? (unsigned)-1 : 10;
-		for (auto h = bc.currentHash(); bc.details(h) && i; h = bc.details(h).parent, --i)
+		return [=]()
 		{
-			showBlock(h);
-			if (h == bc.genesisHash())
-				break;
-		}
-	}
-	else
-		for (auto const& h: blocks)
-			showBlock(h);
+			if (incremental && (!m_shownLatest || m_shownBlocks.empty() || m_shownBlocks.front().first != shown))
+			{
+				// The view changed while this was made; start again from what it shows now.
+				refreshBlockChain();
+				return;
+			}
 
-	if (!ui->blocks->currentItem())
-		ui->blocks->setCurrentRow(0);
+			QByteArray oldSelected = ui->blocks->currentItem() ? ui->blocks->currentItem()->data(Qt::UserRole).toByteArray() : QByteArray();
+			if (!incremental)
+			{
+				ui->blocks->clear();
+				m_shownBlocks.clear();
+			}
+			int row = 0;
+			for (unsigned b = 0; b < blocks.size(); ++b)
+			{
+				auto hba = QByteArray((char const*)blocks[b].data(), blocks[b].size);
+				for (int n = 0; n < lines[b].size(); ++n)
+				{
+					QListWidgetItem* item = new QListWidgetItem(lines[b][n]);
+					item->setData(Qt::UserRole, hba);
+					if (n)
+						item->setData(Qt::UserRole + 1, n - 1);
+					ui->blocks->insertItem(row++, item);
+					if (!incremental && oldSelected == hba)
+						item->setSelected(true);
+				}
+				m_shownBlocks.insert(m_shownBlocks.begin() + b, make_pair(blocks[b], lines[b].size()));
+			}
+			m_shownLatest = filters.empty();
+			m_shownLimit = limit;
+			if (m_shownLatest)
+				for (; m_shownBlocks.size() > limit; m_shownBlocks.pop_back())
+					for (int n = 0; n < m_shownBlocks.back().second; ++n)
+						delete ui->blocks->takeItem(ui->blocks->count() - 1);
+
+			if (!ui->blocks->currentItem())
+				ui->blocks->setCurrentRow(0);
+		};
+	});
 }
 
 void Main::on_blockChainFilter_textChanged()
@@ -1236,16 +1323,20 @@ void Main::refreshCache()
 		t += ("%1 " + l).arg(QString::fromStdString(niceUsed(n)));
 	};
 	f(s.memTotal(), "total");
+	t += " of ";
+	f(s.budget, "budget");
 	t += " (";
 	f(s.memBlocks, "blocks");
 	t += ", ";
 	f(s.memReceipts, "receipts");
 	t += ", ";
-	f(s.memLogBlooms, "blooms");
+	f(s.memLogBlooms + s.memBlocksBlooms + s.memBloomBits, "blooms");
+	t += ", ";
+	f(s.memLogIndex, "log index");
 	t += ", ";
 	f(s.memBlockHashes + s.memTransactionAddresses, "hashes");
 	t += ", ";
-	f(s.memDetails, "family");
+	f(s.memDetails + s.memUncleHashes + s.memHeaders, "family");
 	t += ")";
 	ui->cacheUsage->setText(t);
 }
@@ -1261,7 +1352,7 @@ void Main::timerEvent(QTimerEvent*)
 		refreshMining();
 
 	if ((interval / 100 % 2 == 0 && m_webThree->ethereum()->isSyncing()) || interval == 1000)
-		ui->downloadView->update();
+		ui->downloadView->refresh();
 
 	if (m_logChanged)
 	{
@@ -1536,7 +1627,7 @@ void Main::on_blocks_currentItemChanged()
 			Transaction tx(block[1][txi].data(), CheckTransaction::Everything);
 			auto ss = tx.safeSender();
 			h256 th = sha3(rlpList(ss, tx.nonce()));
-			TransactionReceipt receipt = ethereum()->blockChain().receipts(h).receipts[txi];
+			TransactionReceipt receipt = ethereum()->blockChain().receipt(h, txi);
 			s << "<h3>" << th << "</h3>";
 			s << "<h4>" << h << "[<b>" << txi << "</b>]</h4>";
 			s << "<div>From: <b>" << pretty(ss).toHtmlEscaped().toStdString() << " " << ss << "</b>" << "</div>";
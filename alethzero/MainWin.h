@@ -25,6 +25,7 @@
 #define BOOST_MPL_IF_HPP_INCLUDED
 #endif
 
+#include <deque>
 #include <map>
 
 #include <QtNetwork/QNetworkAccessManager>
@@ -41,6 +42,7 @@
 #include "Transact.h"
 #include "NatspecHandler.h"
 #include "Connect.h"
+#include "Background.h"
 
 namespace Ui {
 class Main;
@@ -55,6 +57,8 @@ namespace jsonrpc {
 class HttpServer;
 }
 
+class QListWidget;
+class QListWidgetItem;
 class QWebEnginePage;
 class OurWebThreeStubServer;
 class DappLoader;
@@ -223,10 +227,16 @@ private:
 
 	void refreshAll();
 	void refreshPending();
-	void refreshAccounts();
+	/// Updates the accounts views with the accounts that have changed, or, if @a _rerender, with all of them.
+	void refreshAccounts(bool _rerender = false);
 	void refreshBlockCount();
 	void refreshBalances();
 
+	/// @returns the line of the views of transactions for @a _t, as of the state @a _s.
+	QString renderTransaction(dev::eth::Transaction const& _t, dev::eth::State const& _s) const;
+	/// Adds the line @a _text for @a _a to @a _list, or updates it if @a io_items has it already.
+	static void setAccountItem(QListWidget* _list, std::map<dev::Address, QListWidgetItem*>& io_items, dev::Address const& _a, QString const& _text, bool _first);
+
 	std::unique_ptr<Ui::Main> ui;
 
 	std::unique_ptr<dev::WebThreeDirect> m_webThree;
@@ -260,4 +270,20 @@ private:
 	QWebEnginePage* m_webPage;
 	
 	Connect m_connect;
+
+	/// The blocks the blocks view shows, latest first, with how many lines each takes. Only when it shows the latest
+	/// blocks, unfiltered, are new blocks added to it; otherwise it is redrawn.
+	std::deque<std::pair<dev::h256, int>> m_shownBlocks;
+	bool m_shownLatest = false;
+	unsigned m_shownLimit = 0;
+
+	std::map<dev::Address, QListWidgetItem*> m_accountItems;
+	std::map<dev::Address, QListWidgetItem*> m_contractItems;
+	/// The balances of the accounts as last rendered, and whether all accounts were shown; only the queries of
+	/// m_background touch them.
+	std::map<dev::Address, dev::u256> m_accountsSeen;
+	bool m_accountsSeenAll = false;
+
+	/// Last, so that it is gone, and its queries with it, before anything they use.
+	Background m_background;
 };
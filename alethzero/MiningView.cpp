@@ -40,7 +40,6 @@ using dev::eth::MineProgress;
 
 // functions
 using dev::toString;
-using dev::trimFront;
 
 string id(float _y) { return toString(_y); }
 string s(float _x){ return toString(round(_x * 1000) / 1000) + (!_x ? "s" : ""); }
@@ -55,40 +54,34 @@ void MiningView::appendStats(list<MineInfo> const& _i, MineProgress const& _p)
 	if (_i.empty())
 		return;
 
-	unsigned o = m_values.size();
 	for (MineInfo const& i: _i)
 	{
-		m_values.push_back(i.best);
+		m_values.push(i.best);
 		m_lastBest = min(m_lastBest, i.best);
-		m_bests.push_back(m_lastBest);
-		m_reqs.push_back(i.requirement);
+		m_bests.push(m_lastBest);
+		m_reqs.push(i.requirement);
 		if (i.completed)
 		{
-			m_completes.push_back(o);
-			m_resets.push_back(o);
+			m_completes.push_back(m_total);
+			m_resets.push_back(m_total);
 			m_haveReset = false;
 			m_lastBest = 1e99;
 		}
-		++o;
+		++m_total;
 	}
 	if (m_haveReset)
 	{
-		m_resets.push_back(o - 1);
+		m_resets.push_back(m_total - 1);
 		m_lastBest = 1e99;
 		m_haveReset = false;
 	}
 
-	o = max<int>(0, (int)m_values.size() - (int)m_duration);
-	trimFront(m_values, o);
-	trimFront(m_bests, o);
-	trimFront(m_reqs, o);
-
-	for (auto& i: m_resets)
-		i -= o;
-	m_resets.erase(remove_if(m_resets.begin(), m_resets.end(), [](int i){return i < 0;}), m_resets.end());
-	for (auto& i: m_completes)
-		i -= o;
-	m_completes.erase(remove_if(m_completes.begin(), m_completes.end(), [](int i){return i < 0;}), m_completes.end());
+	// The histories drop their oldest samples themselves; the marks of those samples go with them.
+	unsigned o = m_total - m_values.size();
+	while (!m_resets.empty() && m_resets.front() < o)
+		m_resets.pop_front();
+	while (!m_completes.empty() && m_completes.front() < o)
+		m_completes.pop_front();
 
 	m_progress = _p;
 	update();
@@ -111,8 +104,9 @@ void MiningView::paintEvent(QPaintEvent*)
 	g.drawLineGraph(m_values, QColor(192, 192, 192));
 	g.drawLineGraph(m_bests, QColor(128, 128, 128));
 	g.drawLineGraph(m_reqs, QColor(128, 64, 64));
+	int o = m_total - m_values.size();
 	for (auto r: m_resets)
-		g.ruleY(r - 1, QColor(128, 128, 128));
+		g.ruleY((int)r - o - 1, QColor(128, 128, 128));
 	for (auto r: m_completes)
-		g.ruleY(r, QColor(192, 64, 64));
+		g.ruleY((int)r - o, QColor(192, 64, 64));
 }
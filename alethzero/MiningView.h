@@ -25,11 +25,13 @@
 #define BOOST_MPL_IF_HPP_INCLUDED
 #endif
 
+#include <deque>
 #include <list>
 #include <QtWidgets/QWidget>
 #ifndef Q_MOC_RUN
 #include <libethereum/Client.h>
 #endif
+#include "Grapher.h"
 
 namespace dev { namespace eth {
 struct MineInfo;
@@ -51,11 +53,12 @@ protected:
 private:
 	dev::eth::MineProgress m_progress;
 	unsigned m_duration = 300;
-	std::vector<float> m_values;
-	std::vector<float> m_bests;
-	std::vector<float> m_reqs;
-	std::vector<int> m_resets;
-	std::vector<int> m_completes;
+	lb::GraphData m_values{m_duration};
+	lb::GraphData m_bests{m_duration};
+	lb::GraphData m_reqs{m_duration};
+	unsigned m_total = 0;				///< Samples ever appended; m_resets and m_completes index them.
+	std::deque<unsigned> m_resets;
+	std::deque<unsigned> m_completes;
 	double m_lastBest = 1e31;
 	bool m_haveReset = false;
 };
@@ -52,6 +52,8 @@ void NatspecHandler::add(dev::h256 const& _contractHash, string const& _doc)
 {
 	m_db->Put(m_writeOptions, _contractHash.ref(), _doc);
 	cdebug << "Registering NatSpec: " << _contractHash.abridged() << _doc;
+	Guard l(x_notices);
+	m_notices.erase(_contractHash);
 }
 
 string NatspecHandler::retrieve(dev::h256 const& _contractHash) const
@@ -62,40 +64,41 @@ string NatspecHandler::retrieve(dev::h256 const& _contractHash) const
 	return ret;
 }
 
-string NatspecHandler::getUserNotice(string const& json, dev::bytes const& _transactionData)
+NatspecHandler::Notices NatspecHandler::parseNotices(string const& _json)
 {
 	Json::Value natspec;
-	Json::Value userNotice;
-	m_reader.parse(json, natspec);
-
-	FixedHash<4> transactionFunctionHash((bytesConstRef(&_transactionData).cropped(0, 4).toBytes()));
+	m_reader.parse(_json, natspec);
 
+	Notices ret;
 	Json::Value methods = natspec["methods"];
 	for (Json::ValueIterator it = methods.begin(); it != methods.end(); ++it)
 	{
 		Json::Value keyValue = it.key();
 		if (!keyValue.isString())
 			BOOST_THROW_EXCEPTION(Exception() << errinfo_comment("Illegal Natspec JSON detected"));
-
-		string functionSig = keyValue.asString();
-		FixedHash<4> functionHash(dev::sha3(functionSig));
-
-		if (functionHash == transactionFunctionHash)
-		{
-			Json::Value val = (*it)["notice"];
-			if (!val.isString())
-				BOOST_THROW_EXCEPTION(Exception() << errinfo_comment("Illegal Natspec JSON detected"));
-			return val.asString();
-		}
+		Json::Value val = (*it)["notice"];
+		if (!val.isString())
+			BOOST_THROW_EXCEPTION(Exception() << errinfo_comment("Illegal Natspec JSON detected"));
+		ret[FixedHash<4>(dev::sha3(keyValue.asString()))] = val.asString();
 	}
+	return ret;
+}
 
-	// not found
-	return string();
+string NatspecHandler::getUserNotice(string const& json, dev::bytes const& _transactionData)
+{
+	Guard l(x_notices);
+	Notices notices = parseNotices(json);
+	auto it = notices.find(FixedHash<4>(bytesConstRef(&_transactionData).cropped(0, 4)));
+	return it == notices.end() ? string() : it->second;
 }
 
 string NatspecHandler::getUserNotice(dev::h256 const& _contractHash, dev::bytes const& _transactionData)
 {
-	return getUserNotice(retrieve(_contractHash), _transactionData);
+	Guard l(x_notices);
+	auto n = m_notices.find(_contractHash);
+	if (n == m_notices.end())
+		// Known to have none, too, until some are added.
+		n = m_notices.insert(make_pair(_contractHash, parseNotices(retrieve(_contractHash)))).first;
+	auto it = n->second.find(FixedHash<4>(bytesConstRef(&_transactionData).cropped(0, 4)));
+	return it == n->second.end() ? string() : it->second;
 }
-
-
@@ -26,8 +26,10 @@
 #pragma warning(disable: 4100 4267)
 #include <leveldb/db.h>
 #pragma warning(pop)
+#include <map>
 #include <json/json.h>
 #include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
 #include "Context.h"
 
 namespace ldb = leveldb;
@@ -52,8 +54,17 @@ class NatspecHandler: public NatSpecFace
 	std::string getUserNotice(dev::h256 const& _contractHash, dev::bytes const& _transactionDacta);
 	
   private:
+	/// The user notices of a contract's methods, by the selectors of their signatures.
+	using Notices = std::map<dev::FixedHash<4>, std::string>;
+
+	/// @returns the user notices of the natspec documentation @a _json.
+	Notices parseNotices(std::string const& _json);
+
 	ldb::ReadOptions m_readOptions;
 	ldb::WriteOptions m_writeOptions;
 	ldb::DB* m_db = nullptr;
 	Json::Reader m_reader;
+
+	dev::Mutex x_notices;
+	std::map<dev::h256, Notices> m_notices;	///< The notices of each contract looked up, so each is read and parsed once.
 };
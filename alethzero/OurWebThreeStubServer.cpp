@@ -99,6 +99,13 @@ void OurWebThreeStubServer::authenticate(TransactionSkeleton const& _t, bool _to
 	m_queued.push(make_pair(_t, _toProxy));
 }
 
+void OurWebThreeStubServer::authenticate(vector<TransactionSkeleton> const& _ts)
+{
+	// Each one is still to be confirmed by the user on its own.
+	for (TransactionSkeleton const& t: _ts)
+		authenticate(t, false);
+}
+
 void OurWebThreeStubServer::doValidations()
 {
 	Guard l(x_queued);
@@ -38,6 +38,7 @@ public:
 
 	virtual std::string shh_newIdentity() override;
 	virtual void authenticate(dev::eth::TransactionSkeleton const& _t, bool _toProxy);
+	virtual void authenticate(std::vector<dev::eth::TransactionSkeleton> const& _ts);
 
 signals:
 	void onNewId(QString _s);
@@ -225,7 +225,7 @@ static tuple<vector<string>, bytes, string> userInputToCode(string const& _user,
 	{
 		try
 		{
-			data = dev::asBytes(::compile(_user));
+			data = dev::asBytes(::compile(_user, _opt));
 		}
 		catch (string const& err)
 		{
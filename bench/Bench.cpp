@@ -0,0 +1,99 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Bench.cpp
+ * @date 2015
+ */
+
+#include "Bench.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+using namespace std;
+using namespace std::chrono;
+using namespace dev;
+using namespace dev::bench;
+
+vector<BenchCase>& dev::bench::benchCases()
+{
+	static vector<BenchCase> s_cases;
+	return s_cases;
+}
+
+/// @returns the seconds @a _n calls of @a _op take.
+static double timeBatch(BenchOp const& _op, unsigned _n)
+{
+	auto start = steady_clock::now();
+	for (unsigned i = 0; i < _n; ++i)
+		_op();
+	return duration_cast<duration<double>>(steady_clock::now() - start).count();
+}
+
+/// @returns the @a _p th percentile of @a _sorted, by nearest rank.
+static double percentile(vector<double> const& _sorted, double _p)
+{
+	size_t rank = (size_t)ceil(_p / 100 * _sorted.size());
+	return _sorted[min(max<size_t>(rank, 1), _sorted.size()) - 1];
+}
+
+BenchResult dev::bench::runBench(BenchCase const& _c, BenchOptions const& _o)
+{
+	BenchResult ret;
+	ret.name = _c.name;
+	ret.units = _c.units;
+	BenchOp op = _c.setup();
+
+	// Warm up, doubling the batch until one takes a sample's time; with few operations to spare, a tenth goes on it.
+	unsigned budget = _c.maxOps ? _c.maxOps : ~0u;
+	unsigned warmUpBudget = _c.maxOps ? max(_c.maxOps / 10, 1u) : ~0u;
+	unsigned batch = 1;
+	unsigned used = 0;
+	for (double spent = 0; spent < _o.warmUpSeconds && used + batch <= warmUpBudget;)
+	{
+		double t = timeBatch(op, batch);
+		spent += t;
+		used += batch;
+		if (t < _o.sampleSeconds && batch < (1u << 30))
+			batch *= 2;
+	}
+	budget -= min(used, budget);
+	unsigned samples = _o.samples;
+	if (_c.maxOps)
+	{
+		// Spread what is left over the samples, rather than have few samples of a large batch.
+		batch = max(min(batch, budget / max(samples, 1u)), 1u);
+		samples = min(samples, budget / batch);
+	}
+
+	vector<double> times;
+	times.reserve(samples);
+	for (unsigned i = 0; i < samples; ++i)
+		times.push_back(timeBatch(op, batch) * 1e9 / batch / _c.units);
+	ret.batch = batch;
+	ret.samples = samples;
+	if (times.empty())
+		return ret;
+
+	ret.mean = accumulate(times.begin(), times.end(), 0.0) / times.size();
+	sort(times.begin(), times.end());
+	ret.min = times.front();
+	ret.max = times.back();
+	ret.p50 = percentile(times, 50);
+	ret.p90 = percentile(times, 90);
+	ret.p99 = percentile(times, 99);
+	return ret;
+}
@@ -0,0 +1,102 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Bench.h
+ * @date 2015
+ * The microbenchmark harness: registered benchmarks, warmed up and timed in samples, with percentiles of each.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace dev
+{
+namespace bench
+{
+
+/// The operation a benchmark times, called over and over.
+using BenchOp = std::function<void()>;
+/// Prepares what a benchmark needs, untimed, and @returns the operation to time.
+using BenchSetup = std::function<BenchOp()>;
+
+/// A registered benchmark.
+struct BenchCase
+{
+	BenchCase(std::string const& _name, BenchSetup const& _setup, unsigned _units, unsigned _maxOps): name(_name), setup(_setup), units(_units), maxOps(_maxOps) {}
+
+	std::string name;		///< As "<area>/<what>", e.g. "rlp/decode".
+	BenchSetup setup;
+	unsigned units;			///< Things each operation does, e.g. instructions, by which its times are divided.
+	unsigned maxOps;		///< Operations the setup leaves enough for, e.g. blocks to import; 0 for no limit.
+};
+
+/// @returns the benchmarks registered, in the order they were.
+std::vector<BenchCase>& benchCases();
+
+/**
+ * @brief Registers benchmarks during static initialisation, at namespace scope in the file of their area.
+ * @code
+ * static BenchRegistrar const s_sha3("sha3/32", []() { h256 h; return [=]() mutable { h = sha3(h); }; });
+ * @endcode
+ */
+struct BenchRegistrar
+{
+	BenchRegistrar(std::string const& _name, BenchSetup const& _setup, unsigned _units = 1, unsigned _maxOps = 0) { benchCases().push_back(BenchCase(_name, _setup, _units, _maxOps)); }
+	/// Runs @a _register, which registers a family of benchmarks, e.g. one for each instruction.
+	explicit BenchRegistrar(std::function<void()> const& _register) { _register(); }
+};
+
+struct BenchOptions
+{
+	double warmUpSeconds = 0.2;		///< Time running the operation untimed first, also finding the batch size.
+	double sampleSeconds = 0.005;	///< Time each sample is aimed to take, running a batch of operations.
+	unsigned samples = 100;
+};
+
+/// What a benchmark took, in nanoseconds per unit.
+struct BenchResult
+{
+	std::string name;
+	unsigned units = 1;
+	unsigned batch = 0;			///< Operations in each sample.
+	unsigned samples = 0;
+	double mean = 0;
+	double min = 0;
+	double p50 = 0;
+	double p90 = 0;
+	double p99 = 0;
+	double max = 0;
+};
+
+/// Sets up and runs @a _c as @a _o says, timing each sample of a batch of operations after warming up.
+BenchResult runBench(BenchCase const& _c, BenchOptions const& _o);
+
+/// Keeps @a _v from being optimised away, as if it were read.
+template <class T> inline void doNotOptimise(T const& _v)
+{
+#if defined(__GNUC__)
+	asm volatile("" : : "g"(&_v) : "memory");
+#else
+	static volatile char const* s_sink;
+	s_sink = reinterpret_cast<char const*>(&_v);
+#endif
+}
+
+}
+}
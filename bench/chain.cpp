@@ -0,0 +1,111 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file chain.cpp
+ * @date 2015
+ * Benchmarks of importing synthetic blocks into a chain and transactions into the queue.
+ */
+
+#include <libdevcore/TransientDirectory.h>
+#include <libethereum/CanonBlockChain.h>
+#include <libethereum/State.h>
+#include <libethereum/TransactionQueue.h>
+#include "Bench.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+using namespace dev::bench;
+
+/// Blocks made for the import, and the value transfers in each.
+static const unsigned c_blocks = 200;
+static const unsigned c_blockTransactions = 50;
+
+/// Transactions made for the queue, each from a sender of its own.
+static const unsigned c_queueTransactions = 20000;
+
+/// A chain and its state in a directory of their own.
+struct TransientChain
+{
+	TransientChain(): bc(dir.path(), WithExisting::Kill), stateDB(State::openDB(dir.path(), WithExisting::Kill)) {}
+
+	TransientDirectory dir;
+	CanonBlockChain bc;
+	OverlayDB stateDB;
+};
+
+/// @returns @a _block with the timestamp @a _timestamp and the difficulty that goes with it after @a _parent.
+static bytes retimed(bytes const& _block, BlockInfo const& _parent, u256 _timestamp)
+{
+	RLP r(_block);
+	BlockInfo bi(_block, CheckNothing);
+	bi.timestamp = _timestamp;
+	bi.difficulty = bi.calculateDifficulty(_parent);
+	bi.noteDirty();
+	RLPStream s(3);
+	bi.streamRLP(s, WithNonce);
+	s.appendRaw(r[1].data()).appendRaw(r[2].data());
+	return s.out();
+}
+
+/// @returns c_blocks blocks on the canonical genesis, the first mining the ether the rest's transfers spend. Their
+/// proofs of work are not valid, so they are imported as verified.
+static vector<bytes> makeBlocks()
+{
+	TransientChain c;
+	KeyPair miner(sha3("bench miner"));
+	State s(c.stateDB, BaseState::CanonGenesis, miner.address());
+	vector<bytes> ret;
+
+	// Made as fast as we can, so the timestamps the state gives would be in the future; they go a second apart from
+	// before the first.
+	u256 start = (u256)time(0) - c_blocks - 1;
+	for (unsigned n = 0; n < c_blocks; ++n)
+	{
+		s.sync(c.bc);
+		if (n)
+			for (unsigned i = 0; i < c_blockTransactions; ++i)
+			{
+				Transaction t(1, 1, c_txGas, Address(sha3(toBigEndian(u256(n * c_blockTransactions + i)))), bytes(), s.transactionsFrom(miner.address()), miner.secret());
+				s.execute(c.bc.lastHashes(), t);
+			}
+		s.commitToMine(c.bc);
+		s.completeMine();
+		ret.push_back(retimed(s.blockData(), c.bc.info(), start + n));
+		c.bc.import(ret.back(), c.stateDB, Aversion::AvoidOldBlocks, true);
+	}
+	return ret;
+}
+
+static BenchRegistrar const s_blockImport("chain/import", []()
+{
+	auto blocks = make_shared<vector<bytes>>(makeBlocks());
+	auto c = make_shared<TransientChain>();
+	unsigned n = 0;
+	return [=]() mutable { c->bc.import((*blocks)[n++], c->stateDB, Aversion::AvoidOldBlocks, true); };
+}, 1, c_blocks);
+
+static BenchRegistrar const s_queueImport("txqueue/import", []()
+{
+	auto txs = make_shared<vector<bytes>>();
+	for (unsigned i = 0; i < c_queueTransactions; ++i)
+	{
+		KeyPair k(sha3(toBigEndian(u256(i))));
+		txs->push_back(Transaction(1, 1, c_txGas, k.address(), bytes(), 0, k.secret()).rlp());
+	}
+	auto q = make_shared<TransactionQueue>(c_queueTransactions, c_queueTransactions);
+	unsigned n = 0;
+	return [=]() mutable { doNotOptimise(q->import((*txs)[n++])); };
+}, 1, c_queueTransactions);
@@ -0,0 +1,54 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file crypto.cpp
+ * @date 2015
+ * Hashing and signature benchmarks.
+ */
+
+#include <libdevcrypto/Common.h>
+#include <libdevcrypto/SHA3.h>
+#include "Bench.h"
+using namespace std;
+using namespace dev;
+using namespace dev::bench;
+
+static BenchRegistrar const s_sha3_32("sha3/32", []()
+{
+	auto h = make_shared<h256>();
+	return [=]() { *h = sha3(*h); };
+});
+
+static BenchRegistrar const s_sha3_1k("sha3/1k", []()
+{
+	bytes data(1024, 0x5a);
+	return [=]() { doNotOptimise(sha3(data)); };
+});
+
+static BenchRegistrar const s_ecrecover("crypto/ecrecover", []()
+{
+	KeyPair k(sha3("bench"));
+	h256 hash = sha3("message");
+	Signature sig = sign(k.secret(), hash);
+	return [=]() { doNotOptimise(recover(sig, hash)); };
+});
+
+static BenchRegistrar const s_sign("crypto/sign", []()
+{
+	Secret s = sha3("bench");
+	h256 hash = sha3("message");
+	return [=]() { doNotOptimise(sign(s, hash)); };
+});
@@ -0,0 +1,158 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file main.cpp
+ * @date 2015
+ * Microbenchmarks of the hot paths: RLP, hashing, signatures, tries and their DBs, the VM, block import and the
+ * transaction queue. Each is warmed up, then timed in samples, reporting percentiles as text or JSON for tracking.
+ */
+
+#include <iostream>
+#include <iomanip>
+#include "../test/JsonSpiritHeaders.h"
+#include <libdevcore/Log.h>
+#include <libdevcrypto/KeyValueDB.h>
+#include <libevm/VMFactory.h>
+#include <libethereum/Defaults.h>
+#include "Bench.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+using namespace dev::bench;
+namespace js = json_spirit;
+
+void help()
+{
+	cout
+		<< "Usage bench [OPTIONS]" << endl
+		<< "Options:" << endl
+		<< "    -f,--filter <text>  Run only the benchmarks whose names contain text; may be given several times (default: all)." << endl
+		<< "    -l,--list  List the benchmarks and exit." << endl
+		<< "    -s,--samples <n>  Time n samples of each benchmark (default: 100)." << endl
+		<< "    --sample-ms <ms>  Aim for samples of a batch of operations taking ms milliseconds (default: 5)." << endl
+		<< "    --warm-up-ms <ms>  Run each benchmark untimed for ms milliseconds first (default: 200)." << endl
+		<< "    --vm <vm>  Run the vm/ benchmarks with interpreter, threaded or jit (default: interpreter)." << endl
+		<< "    --db <backend>  Back the DBs of the benchmarks that need one with leveldb, rocksdb or memory (default: leveldb)." << endl
+		<< "    -j,--json  Write the results as a JSON object rather than as text." << endl
+		<< "    -h,--help  Show this help message and exit." << endl
+		;
+	exit(0);
+}
+
+int main(int argc, char** argv)
+{
+	BenchOptions options;
+	vector<string> filters;
+	bool list = false;
+	bool json = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-h" || arg == "--help")
+			help();
+		else if ((arg == "-f" || arg == "--filter") && i + 1 < argc)
+			filters.push_back(argv[++i]);
+		else if (arg == "-l" || arg == "--list")
+			list = true;
+		else if ((arg == "-s" || arg == "--samples") && i + 1 < argc)
+			options.samples = max(atoi(argv[++i]), 1);
+		else if (arg == "--sample-ms" && i + 1 < argc)
+			options.sampleSeconds = max(atof(argv[++i]), 0.001) / 1000;
+		else if (arg == "--warm-up-ms" && i + 1 < argc)
+			options.warmUpSeconds = max(atof(argv[++i]), 0.0) / 1000;
+		else if (arg == "--vm" && i + 1 < argc)
+		{
+			string v = argv[++i];
+			if (v == "interpreter")
+				VMFactory::setKind(VMKind::Interpreter);
+			else if (v == "threaded")
+				VMFactory::setKind(VMKind::Threaded);
+#if ETH_EVMJIT
+			else if (v == "jit")
+				VMFactory::setKind(VMKind::JIT);
+#endif
+			else
+			{
+				cerr << "Unknown or disabled VM: " << v << endl;
+				return -1;
+			}
+		}
+		else if (arg == "--db" && i + 1 < argc)
+			try
+			{
+				DBOptions o;
+				o.backend = toDBBackend(argv[++i]);
+				Defaults::setDBOptions(o);
+			}
+			catch (UnknownDBBackend const&)
+			{
+				cerr << "Unknown DB backend: " << argv[i] << endl;
+				return -1;
+			}
+		else if (arg == "-j" || arg == "--json")
+			json = true;
+		else
+		{
+			cerr << "Invalid argument: " << arg << endl;
+			return -1;
+		}
+	}
+	g_logVerbosity = 0;
+
+	js::mArray results;
+	if (!json && !list)
+		cout << "benchmark" << string(22, ' ') << "samples\tbatch\tmean\tmin\tp50\tp90\tp99\tmax (ns per unit)" << endl;
+	for (BenchCase const& c: benchCases())
+	{
+		if (!filters.empty() && none_of(filters.begin(), filters.end(), [&](string const& f) { return c.name.find(f) != string::npos; }))
+			continue;
+		if (list)
+		{
+			cout << c.name << endl;
+			continue;
+		}
+		BenchResult r = runBench(c, options);
+		if (json)
+		{
+			js::mObject o;
+			o["name"] = r.name;
+			o["units"] = (int)r.units;
+			o["batch"] = (int)r.batch;
+			o["samples"] = (int)r.samples;
+			o["mean_ns"] = r.mean;
+			o["min_ns"] = r.min;
+			o["p50_ns"] = r.p50;
+			o["p90_ns"] = r.p90;
+			o["p99_ns"] = r.p99;
+			o["max_ns"] = r.max;
+			o["per_second"] = r.mean ? 1e9 / r.mean : 0;
+			results.push_back(o);
+		}
+		else
+			cout << setw(30) << left << r.name << " " << r.samples << "\t" << r.batch << "\t" << fixed << setprecision(1) << r.mean << "\t" << r.min << "\t" << r.p50 << "\t" << r.p90 << "\t" << r.p99 << "\t" << r.max << endl;
+	}
+	if (json)
+	{
+		js::mObject o;
+		o["samples"] = (int)options.samples;
+		o["sample_ms"] = options.sampleSeconds * 1000;
+		o["warm_up_ms"] = options.warmUpSeconds * 1000;
+		o["benchmarks"] = results;
+		cout << js::write_string(js::mValue(o), true) << endl;
+	}
+	return 0;
+}
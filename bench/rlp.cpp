@@ -0,0 +1,76 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file rlp.cpp
+ * @date 2015
+ * RLP benchmarks, on the shape of a signed transaction.
+ */
+
+#include <libdevcore/RLP.h>
+#include "Bench.h"
+using namespace std;
+using namespace dev;
+using namespace dev::bench;
+
+/// A signed transaction's fields: nonce, gas price, gas, to, value, data, v, r, s.
+static bytes transactionRLP(unsigned _dataSize)
+{
+	RLPStream s(9);
+	s << u256(42) << u256(50000000000) << u256(90000) << h160(0x1234) << u256(1000000000000000000) << bytes(_dataSize, 0xab) << 27 << h256(0x5678) << h256(0x9abc);
+	return s.out();
+}
+
+static BenchRegistrar const s_encode("rlp/encode", []()
+{
+	bytes data(100, 0xab);
+	return [=]()
+	{
+		RLPStream s(9);
+		s << u256(42) << u256(50000000000) << u256(90000) << h160(0x1234) << u256(1000000000000000000) << data << 27 << h256(0x5678) << h256(0x9abc);
+		doNotOptimise(s.out());
+	};
+});
+
+static BenchRegistrar const s_decode("rlp/decode", []()
+{
+	bytes rlp = transactionRLP(100);
+	return [=]()
+	{
+		RLP r(rlp);
+		doNotOptimise(r[0].toInt<u256>() + r[1].toInt<u256>() + r[2].toInt<u256>() + r[4].toInt<u256>());
+		doNotOptimise(r[3].toHash<h160>());
+		doNotOptimise(r[5].toBytesConstRef());
+		doNotOptimise(r[6].toInt<byte>());
+		doNotOptimise(r[7].toHash<h256>() ^ r[8].toHash<h256>());
+	};
+});
+
+static BenchRegistrar const s_list("rlp/iterate", []()
+{
+	// As a block's transaction list is walked.
+	bytes tx = transactionRLP(100);
+	RLPStream s(200);
+	for (unsigned i = 0; i < 200; ++i)
+		s.appendRaw(tx);
+	bytes list = s.out();
+	return [=]()
+	{
+		size_t total = 0;
+		for (auto const& i: RLP(list))
+			total += i.actualSize();
+		doNotOptimise(total);
+	};
+}, 200);
@@ -0,0 +1,141 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file trie.cpp
+ * @date 2015
+ * Trie benchmarks, and those of the DBs under it, over a state-sized set of hashed keys.
+ */
+
+#include <libdevcore/TransientDirectory.h>
+#include <libdevcrypto/OverlayDB.h>
+#include <libdevcrypto/TrieDB.h>
+#include <libethereum/Defaults.h>
+#include "Bench.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+using namespace dev::bench;
+
+/// Keys in the tries and DBs before timing, enough for the top levels of the trie to be full.
+static const unsigned c_keys = 10000;
+
+/// @returns the @a _i th key, hashed as the state's are.
+static bytes key(unsigned _i)
+{
+	return sha3(toBigEndian(u256(_i))).asBytes();
+}
+
+/// An account's RLP is about this long.
+static bytes value(unsigned _i)
+{
+	bytes ret = toBigEndian(u256(_i));
+	ret.resize(70);
+	return ret;
+}
+
+/// A trie with c_keys keys, in memory.
+struct MemoryTrie
+{
+	MemoryTrie(): trie(&db)
+	{
+		trie.init();
+		for (unsigned i = 0; i < c_keys; ++i)
+			trie.insert(key(i), value(i));
+	}
+
+	MemoryDB db;
+	GenericTrieDB<MemoryDB> trie;
+};
+
+/// A trie on an OverlayDB over a KeyValueDB in a directory of its own, as the state's.
+struct DiskTrie
+{
+	DiskTrie(): db(KeyValueDB::open(dir.path(), Defaults::dbOptions(DBRole::State))), trie(&db)
+	{
+		trie.init();
+		for (unsigned i = 0; i < c_keys; ++i)
+			trie.insert(key(i), value(i));
+		nodes = db.keys();
+		db.commit();
+	}
+
+	TransientDirectory dir;
+	OverlayDB db;
+	GenericTrieDB<OverlayDB> trie;
+	std::set<h256> nodes;		///< Those committed, which lookups now find only in the KeyValueDB.
+};
+
+static BenchRegistrar const s_trieInsert("trie/insert", []()
+{
+	auto t = make_shared<MemoryTrie>();
+	unsigned n = c_keys;
+	return [=]() mutable { t->trie.insert(key(n), value(n)); ++n; };
+});
+
+static BenchRegistrar const s_trieAt("trie/at", []()
+{
+	auto t = make_shared<MemoryTrie>();
+	vector<bytes> keys;
+	for (unsigned i = 0; i < c_keys; ++i)
+		keys.push_back(key(i));
+	unsigned n = 0;
+	return [=]() mutable { doNotOptimise(t->trie.at(keys[n++ % c_keys])); };
+});
+
+/// Keys inserted between commits, about as many accounts as a block changes.
+static const unsigned c_commitKeys = 100;
+
+static BenchRegistrar const s_trieCommit("trie/commit", []()
+{
+	auto t = make_shared<DiskTrie>();
+	unsigned n = c_keys;
+	return [=]() mutable
+	{
+		for (unsigned i = 0; i < c_commitKeys; ++i, ++n)
+			t->trie.insert(key(n), value(n));
+		t->db.commit();
+	};
+}, c_commitKeys);
+
+static BenchRegistrar const s_memoryDBInsert("memorydb/insert", []()
+{
+	auto db = make_shared<MemoryDB>();
+	bytes v = value(0);
+	unsigned n = 0;
+	return [=]() mutable { db->insert(sha3(toBigEndian(u256(n++))), &v); };
+});
+
+static BenchRegistrar const s_memoryDBLookup("memorydb/lookup", []()
+{
+	auto db = make_shared<MemoryDB>();
+	h256s keys;
+	bytes v = value(0);
+	for (unsigned i = 0; i < c_keys; ++i)
+	{
+		keys.push_back(sha3(toBigEndian(u256(i))));
+		db->insert(keys.back(), &v);
+	}
+	unsigned n = 0;
+	return [=]() mutable { doNotOptimise(db->lookup(keys[n++ % c_keys])); };
+});
+
+static BenchRegistrar const s_overlayDBLookup("overlaydb/lookup", []()
+{
+	auto t = make_shared<DiskTrie>();
+	h256s nodes(t->nodes.begin(), t->nodes.end());
+	unsigned n = 0;
+	return [=]() mutable { doNotOptimise(t->db.lookup(nodes[n++ % nodes.size()])); };
+});
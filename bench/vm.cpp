@@ -0,0 +1,102 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file vm.cpp
+ * @date 2015
+ * VM benchmarks of each instruction, run in a straight line of repeats within the VM chosen with --vm.
+ * Each repeat includes the pushes of its arguments and the pop of its result; vm/PUSH1,POP times those alone.
+ */
+
+#include <libevmcore/Instruction.h>
+#include <libevm/ExtVMFace.h>
+#include <libevm/VMFactory.h>
+#include "Bench.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+using namespace dev::bench;
+
+/// Repeats of the instruction in each run of the code.
+static const unsigned c_repeats = 256;
+
+/// @returns the code running @a _body c_repeats times after @a _prefix, then stopping.
+static bytes repeated(bytes const& _prefix, bytes const& _body)
+{
+	bytes ret = _prefix;
+	for (unsigned i = 0; i < c_repeats; ++i)
+		ret += _body;
+	ret.push_back((byte)Instruction::STOP);
+	return ret;
+}
+
+/// Registers the benchmark vm/<_name>, running @a _code.
+static void registerCode(string const& _name, bytes const& _code)
+{
+	BenchRegistrar("vm/" + _name, [=]()
+	{
+		auto ext = make_shared<ExtVMFace>();
+		ext->code = make_shared<bytes const>(_code);
+		ext->codeHash = sha3(_code);
+		ext->gasPrice = 1;
+		return [=]()
+		{
+			u256 gas = 1000000000;
+			doNotOptimise(VMFactory::create(gas)->go(*ext));
+		};
+	}, c_repeats);
+}
+
+static bytes push1(byte _v) { return bytes{(byte)Instruction::PUSH1, _v}; }
+static byte op(Instruction _i) { return (byte)_i; }
+
+static BenchRegistrar const s_instructions([]()
+{
+	registerCode("PUSH1,POP", repeated({}, push1(3) + bytes{op(Instruction::POP)}));
+
+	// Taking two arguments, or one, and giving a result.
+	for (auto i: {Instruction::ADD, Instruction::MUL, Instruction::SUB, Instruction::DIV, Instruction::SDIV, Instruction::MOD, Instruction::SMOD, Instruction::EXP, Instruction::SIGNEXTEND, Instruction::LT, Instruction::GT, Instruction::SLT, Instruction::SGT, Instruction::EQ, Instruction::AND, Instruction::OR, Instruction::XOR, Instruction::BYTE})
+		registerCode(instructionInfo(i).name, repeated({}, push1(3) + push1(200) + bytes{op(i), op(Instruction::POP)}));
+	for (auto i: {Instruction::ISZERO, Instruction::NOT})
+		registerCode(instructionInfo(i).name, repeated({}, push1(3) + bytes{op(i), op(Instruction::POP)}));
+	for (auto i: {Instruction::ADDMOD, Instruction::MULMOD})
+		registerCode(instructionInfo(i).name, repeated({}, push1(7) + push1(200) + push1(3) + bytes{op(i), op(Instruction::POP)}));
+
+	// Of the environment, without arguments.
+	for (auto i: {Instruction::ADDRESS, Instruction::CALLER, Instruction::CALLVALUE, Instruction::GAS, Instruction::PC, Instruction::NUMBER})
+		registerCode(instructionInfo(i).name, repeated({}, bytes{op(i), op(Instruction::POP)}));
+
+	// The stack, memory, storage and control flow.
+	bytes push32{op(Instruction::PUSH32)};
+	push32.resize(33, 0xee);
+	registerCode("PUSH32", repeated({}, push32 + bytes{op(Instruction::POP)}));
+	registerCode("DUP1", repeated(push1(3), bytes{op(Instruction::DUP1), op(Instruction::POP)}));
+	registerCode("SWAP1", repeated(push1(3) + push1(5), bytes{op(Instruction::SWAP1)}));
+	registerCode("MLOAD", repeated({}, push1(0) + bytes{op(Instruction::MLOAD), op(Instruction::POP)}));
+	registerCode("MSTORE", repeated({}, push1(7) + push1(0) + bytes{op(Instruction::MSTORE)}));
+	registerCode("SHA3", repeated({}, push1(32) + push1(0) + bytes{op(Instruction::SHA3), op(Instruction::POP)}));
+	registerCode("SLOAD", repeated({}, push1(0) + bytes{op(Instruction::SLOAD), op(Instruction::POP)}));
+	registerCode("SSTORE", repeated({}, push1(7) + push1(0) + bytes{op(Instruction::SSTORE)}));
+
+	// Each jump goes to the JUMPDEST straight after it.
+	bytes jumps;
+	for (unsigned i = 0; i < c_repeats; ++i)
+	{
+		unsigned dest = jumps.size() + 4;
+		jumps += bytes{op(Instruction::PUSH2), (byte)(dest >> 8), (byte)dest, op(Instruction::JUMP), op(Instruction::JUMPDEST)};
+	}
+	jumps.push_back(op(Instruction::STOP));
+	registerCode("JUMP", jumps);
+});
@@ -0,0 +1,215 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file main.cpp
+ * @date 2015
+ * Ethash benchmarks: making the light cache and the DAG, hash rates, and verification latency.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "../test/JsonSpiritHeaders.h"
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/Log.h>
+#include <libethcore/Ethasher.h>
+#include <libethcore/ProofOfWork.h>
+using namespace std;
+using namespace std::chrono;
+using namespace dev;
+using namespace dev::eth;
+namespace js = json_spirit;
+
+/// Nonces evaluated at once in the batched runs, as EthashCPU does.
+static const unsigned c_batch = 32;
+
+void help()
+{
+	cout
+		<< "Usage bench_ethash [OPTIONS]" << endl
+		<< "Options:" << endl
+		<< "    -e,--epoch <n>  Benchmark with the sizes and seed of epoch n (default: 0)." << endl
+		<< "    --small  Benchmark with a 1MB cache and 32MB DAG, for a quick look; skips the EthashCPU and EthashCL runs." << endl
+		<< "    -t,--threads <n>  Make the DAG and hash on n threads (default: one per hardware thread)." << endl
+		<< "    -s,--seconds <n>  Hash for n seconds in each hash rate run (default: 5)." << endl
+		<< "    --no-serial  Skip making the DAG on one thread." << endl
+		<< "    -j,--json  Write the results as a JSON object rather than as text." << endl
+		<< "    -h,--help  Show this help message and exit." << endl
+		;
+	exit(0);
+}
+
+/// @returns the seconds taken by @a _f.
+static double timed(function<void()> const& _f)
+{
+	auto start = steady_clock::now();
+	_f();
+	return duration_cast<duration<double>>(steady_clock::now() - start).count();
+}
+
+/// @returns the hashes a second @a _threads threads manage, each calling @a _f, which hashes the given number of
+/// nonces from the given one, for @a _seconds seconds.
+static double hashRate(unsigned _threads, unsigned _seconds, function<void(uint64_t, unsigned)> const& _f)
+{
+	atomic<bool> stop(false);
+	atomic<uint64_t> hashes(0);
+	vector<thread> threads;
+	auto start = steady_clock::now();
+	for (unsigned i = 0; i < _threads; ++i)
+		threads.push_back(thread([&, i]()
+		{
+			uint64_t n = 0;
+			for (uint64_t nonce = (uint64_t)i << 40; !stop; nonce += c_batch, n += c_batch)
+				_f(nonce, c_batch);
+			hashes += n;
+		}));
+	this_thread::sleep_for(seconds(_seconds));
+	stop = true;
+	for (auto& t: threads)
+		t.join();
+	return hashes / duration_cast<duration<double>>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+	unsigned epoch = 0;
+	bool small = false;
+	unsigned threads = max(thread::hardware_concurrency(), 1u);
+	unsigned secs = 5;
+	bool serial = true;
+	bool json = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-h" || arg == "--help")
+			help();
+		else if ((arg == "-e" || arg == "--epoch") && i + 1 < argc)
+			epoch = atoi(argv[++i]);
+		else if (arg == "--small")
+			small = true;
+		else if ((arg == "-t" || arg == "--threads") && i + 1 < argc)
+			threads = max(atoi(argv[++i]), 1);
+		else if ((arg == "-s" || arg == "--seconds") && i + 1 < argc)
+			secs = max(atoi(argv[++i]), 1);
+		else if (arg == "--no-serial")
+			serial = false;
+		else if (arg == "-j" || arg == "--json")
+			json = true;
+		else
+		{
+			cerr << "Invalid argument: " << arg << endl;
+			exit(-1);
+		}
+	}
+	g_logVerbosity = 0;
+
+	BlockInfo header;
+	header.number = epoch * c_ethashEpochLength;
+	header.difficulty = u256(1) << 255;
+	ethash_params p = Ethasher::params(header);
+	if (small)
+	{
+		p.cache_size = 1024 * 1024;
+		p.full_size = 32 * 1024 * 1024;
+	}
+	h256 seed = header.seedHash();
+	h256 headerHash = sha3("bench_ethash");
+
+	js::mObject results;
+	auto note = [&](string const& _name, double _value, string const& _unit)
+	{
+		results[_name + "_" + _unit] = _value;
+		if (!json)
+			cout << _name << ": " << _value << " " << _unit << endl;
+	};
+	if (!json)
+		cout << "Epoch " << epoch << ", cache " << p.cache_size << " bytes, DAG " << p.full_size << " bytes, " << threads << " threads" << endl;
+
+	ethash_light_t light = nullptr;
+	note("light_build", timed([&](){ light = ethash_new_light(&p, seed.data()); }) * 1000, "ms");
+
+	bytes full(p.full_size);
+	if (serial)
+		note("dag_build_serial", timed([&](){ ethash_compute_full_data(full.data(), &p, light); }), "s");
+	note("dag_build_parallel", timed([&](){ Ethasher::computeFull(full.data(), p, light, threads); }), "s");
+
+	note("hashrate_single_thread", hashRate(1, secs, [&](uint64_t _nonce, unsigned _count)
+	{
+		ethash_return_value r;
+		for (unsigned i = 0; i < _count; ++i)
+			ethash_compute_full(&r, full.data(), &p, headerHash.data(), _nonce + i);
+	}), "H/s");
+	note("hashrate_batch_thread", hashRate(1, secs, [&](uint64_t _nonce, unsigned _count)
+	{
+		ethash_return_value r[c_batch];
+		ethash_full_batch(r, full.data(), &p, headerHash.data(), _nonce, _count);
+	}), "H/s");
+	if (threads > 1)
+		note("hashrate_batch", hashRate(threads, secs, [&](uint64_t _nonce, unsigned _count)
+		{
+			ethash_return_value r[c_batch];
+			ethash_full_batch(r, full.data(), &p, headerHash.data(), _nonce, _count);
+		}), "H/s");
+
+	// Verifying a header is a single evaluation, from the light cache or from the resident DAG.
+	unsigned verifications = 0;
+	double lightTime = 0;
+	for (; lightTime < secs / 2.0 || verifications < 10; ++verifications)
+		lightTime += timed([&](){ ethash_return_value r; ethash_compute_light(&r, light, &p, headerHash.data(), verifications); });
+	note("verify_light", lightTime / verifications * 1000000, "us");
+	double fullTime = timed([&](){ ethash_return_value r; for (unsigned i = 0; i < verifications; ++i) ethash_compute_full(&r, full.data(), &p, headerHash.data(), i); });
+	note("verify_full", fullTime / verifications * 1000000, "us");
+	ethash_delete_light(light);
+	bytes().swap(full);
+
+	if (!small)
+	{
+		// The miners as the client runs them, with the DAG mapped from its file, which is made first if need be.
+		auto mine = [&](EthashPoW& _pow)
+		{
+			Ethasher::get()->fullFile(header);
+			uint64_t hashes = 0;
+			double t = timed([&]()
+			{
+				for (auto end = steady_clock::now() + seconds(secs); steady_clock::now() < end;)
+					hashes += _pow.mine(header, _pow.defaultTimeout()).first.hashes;
+			});
+			return hashes / t;
+		};
+		EthashCPU cpu;
+		note("hashrate_ethashcpu_thread", mine(cpu), "H/s");
+#if ETH_ETHASHCL
+		EthashCL cl;
+		note("hashrate_ethashcl", mine(cl), "H/s");
+#endif
+	}
+
+	if (json)
+	{
+		js::mObject o;
+		o["epoch"] = (int)epoch;
+		o["cache_size"] = (uint64_t)p.cache_size;
+		o["full_size"] = (uint64_t)p.full_size;
+		o["threads"] = (int)threads;
+		o["results"] = results;
+		cout << js::write_string(js::mValue(o), true) << endl;
+	}
+	return 0;
+}
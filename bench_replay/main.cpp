@@ -0,0 +1,238 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file main.cpp
+ * @date 2015
+ * Replays a range of a real chain's blocks onto a copy of its state, timing execution, trie commits and DB writes.
+ */
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <boost/filesystem.hpp>
+#include "../test/JsonSpiritHeaders.h"
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/Log.h>
+#include <libdevcore/Metrics.h>
+#include <libevm/VMFactory.h>
+#include <libevm/AdaptiveVM.h>
+#include <libethereum/CanonBlockChain.h>
+#include <libethereum/Defaults.h>
+#include <libethereum/State.h>
+using namespace std;
+using namespace std::chrono;
+using namespace dev;
+using namespace dev::eth;
+namespace js = json_spirit;
+namespace fs = boost::filesystem;
+
+void help()
+{
+	cout
+		<< "Usage bench_replay [OPTIONS]" << endl
+		<< "Re-executes blocks of the chain in a database against a copy of its state database, which is left as it was." << endl
+		<< "The state of the block before the first must still be in the database, so it must not have been pruned past it." << endl
+		<< "Options:" << endl
+		<< "    -d,--db-path <path>  Load the chain and state from path (default: the eth client's)." << endl
+		<< "    -f,--from <n>  Replay from block n (default: 1)." << endl
+		<< "    -t,--to <n>  Replay up to and including block n (default: the chain's head)." << endl
+		<< "    -r,--runs <n>  Replay the range n times, reporting each block's fastest run (default: 1)." << endl
+		<< "    --vm <vm>  Execute code with interpreter, threaded, jit or adaptive (default: interpreter)." << endl
+		<< "    --jit-after <n>  With --vm adaptive, interpret code until it has run n times." << endl
+		<< "    -j,--json  Write the results as a JSON object rather than as text." << endl
+		<< "    -h,--help  Show this help message and exit." << endl
+		;
+	exit(0);
+}
+
+/// @returns the seconds taken by @a _f.
+static double timed(function<void()> const& _f)
+{
+	auto start = steady_clock::now();
+	_f();
+	return duration_cast<duration<double>>(steady_clock::now() - start).count();
+}
+
+/// Copies the directory @a _from, and all in it, to @a _to.
+static void copyDirectory(fs::path const& _from, fs::path const& _to)
+{
+	fs::create_directories(_to);
+	for (fs::directory_iterator i(_from), end; i != end; ++i)
+		if (fs::is_directory(i->status()))
+			copyDirectory(i->path(), _to / i->path().filename());
+		else
+			fs::copy_file(i->path(), _to / i->path().filename());
+}
+
+/// The times of a block's replay, in seconds.
+struct BlockTimes
+{
+	double execution = 0;	///< Executing the transactions and rewards, without the commits to the trie.
+	double commit = 0;		///< Committing the changed accounts to the state trie, and so hashing the tries.
+	double write = 0;		///< Writing the new trie nodes out to the state DB.
+	unsigned transactions = 0;
+	u256 gasUsed;
+};
+
+int main(int argc, char** argv)
+{
+	string dbPath;
+	unsigned from = 1;
+	unsigned to = 0;
+	unsigned runs = 1;
+	VMKind vm = VMKind::Interpreter;
+	int jitAfter = -1;
+	bool json = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-h" || arg == "--help")
+			help();
+		else if ((arg == "-d" || arg == "--db-path") && i + 1 < argc)
+			dbPath = argv[++i];
+		else if ((arg == "-f" || arg == "--from") && i + 1 < argc)
+			from = max(atoi(argv[++i]), 1);
+		else if ((arg == "-t" || arg == "--to") && i + 1 < argc)
+			to = atoi(argv[++i]);
+		else if ((arg == "-r" || arg == "--runs") && i + 1 < argc)
+			runs = max(atoi(argv[++i]), 1);
+		else if (arg == "--vm" && i + 1 < argc)
+		{
+			string v = argv[++i];
+			if (v == "interpreter")
+				vm = VMKind::Interpreter;
+			else if (v == "threaded")
+				vm = VMKind::Threaded;
+#if ETH_EVMJIT
+			else if (v == "jit")
+				vm = VMKind::JIT;
+			else if (v == "adaptive")
+				vm = VMKind::Adaptive;
+#endif
+			else
+			{
+				cerr << "Unknown or disabled VM: " << v << endl;
+				return -1;
+			}
+		}
+		else if (arg == "--jit-after" && i + 1 < argc)
+			jitAfter = atoi(argv[++i]);
+		else if (arg == "-j" || arg == "--json")
+			json = true;
+		else
+		{
+			cerr << "Invalid argument: " << arg << endl;
+			return -1;
+		}
+	}
+	g_logVerbosity = 0;
+	if (!dbPath.empty())
+		Defaults::setDBPath(dbPath);
+	dbPath = Defaults::dbPath();
+	VMFactory::setKind(vm);
+	if (jitAfter >= 0)
+		AdaptiveVM::setPromotionThreshold(jitAfter);
+
+	// Replaying writes the blocks' states again, so it does so into a copy, which goes once done.
+	fs::path copy = fs::temp_directory_path() / fs::unique_path("bench_replay-%%%%-%%%%");
+	copyDirectory(fs::path(dbPath) / "state", copy / "state");
+	struct RemoveCopy { fs::path p; ~RemoveCopy() { fs::remove_all(p); } } removeCopy{copy};
+
+	CanonBlockChain bc(dbPath);
+	OverlayDB stateDB = State::openDB(copy.string());
+	to = to ? min(to, bc.number()) : bc.number();
+	if (from > to)
+	{
+		cerr << "Nothing to replay: the chain's head is #" << bc.number() << endl;
+		return -1;
+	}
+
+	// The trie commits are timed within the state; the rest of the block's enactment is execution.
+	MetricHistogram& commitTime = Metrics::get().histogram("eth_state_commit_seconds", "Time to commit changed accounts to the state trie.");
+	vector<BlockTimes> times(to - from + 1);
+	for (unsigned run = 0; run < runs; ++run)
+		for (unsigned n = from; n <= to; ++n)
+		{
+			bytes block = bc.block(bc.numberHash(n));
+			BlockInfo bi(&block, CheckNothing);
+			State s(stateDB, BaseState::PreExisting, bi.coinbaseAddress);
+
+			double commitStart = commitTime.sum();
+			double enactment = timed([&](){ s.enactOn(&block, bi, bc, true); });
+			double commit = commitTime.sum() - commitStart;
+			BlockTimes& t = times[n - from];
+			t.transactions = s.pending().size();
+			t.gasUsed = bi.gasUsed;
+			double write = timed([&](){ s.cleanup(true); });
+
+			if (!run || enactment + write < t.execution + t.commit + t.write)
+			{
+				t.execution = enactment - commit;
+				t.commit = commit;
+				t.write = write;
+			}
+		}
+
+	BlockTimes total;
+	js::mArray blocks;
+	if (!json)
+		cout << "Blocks #" << from << " to #" << to << ", " << runs << " run(s); times in ms" << endl
+			<< "block\ttxs\tgas\texecution\tcommit\twrite" << endl;
+	for (unsigned n = from; n <= to; ++n)
+	{
+		BlockTimes const& t = times[n - from];
+		total.execution += t.execution;
+		total.commit += t.commit;
+		total.write += t.write;
+		total.transactions += t.transactions;
+		total.gasUsed += t.gasUsed;
+		if (json)
+		{
+			js::mObject b;
+			b["number"] = (int)n;
+			b["transactions"] = (int)t.transactions;
+			b["gas_used"] = toString(t.gasUsed);
+			b["execution_ms"] = t.execution * 1000;
+			b["commit_ms"] = t.commit * 1000;
+			b["write_ms"] = t.write * 1000;
+			blocks.push_back(b);
+		}
+		else
+			cout << n << "\t" << t.transactions << "\t" << t.gasUsed << "\t" << t.execution * 1000 << "\t" << t.commit * 1000 << "\t" << t.write * 1000 << endl;
+	}
+
+	double seconds = total.execution + total.commit + total.write;
+	double gasRate = seconds ? double(total.gasUsed) / seconds : 0;
+	if (json)
+	{
+		js::mObject o;
+		o["from"] = (int)from;
+		o["to"] = (int)to;
+		o["runs"] = (int)runs;
+		o["blocks"] = blocks;
+		o["transactions"] = (int)total.transactions;
+		o["execution_ms"] = total.execution * 1000;
+		o["commit_ms"] = total.commit * 1000;
+		o["write_ms"] = total.write * 1000;
+		o["gas_per_second"] = gasRate;
+		cout << js::write_string(js::mValue(o), true) << endl;
+	}
+	else
+		cout << "total\t" << total.transactions << "\t" << total.gasUsed << "\t" << total.execution * 1000 << "\t" << total.commit * 1000 << "\t" << total.write * 1000 << endl
+			<< gasRate << " gas/s" << endl;
+	return 0;
+}
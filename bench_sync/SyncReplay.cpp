@@ -0,0 +1,352 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SyncReplay.cpp
+ * @date 2015
+ */
+
+#include "SyncReplay.h"
+#include <algorithm>
+#include <libdevcore/Log.h>
+#include <libethcore/BlockInfo.h>
+#include <libp2p/Session.h>
+using namespace std;
+using namespace std::chrono;
+using namespace dev;
+using namespace dev::eth;
+using namespace dev::p2p;
+
+SyncRecording::SyncRecording(vector<LoggedPacket> const& _log)
+{
+	if (_log.empty())
+		return;
+	auto begin = _log.front().at;
+
+	map<NodeId, unsigned> index;
+	map<NodeId, microseconds> askedHashes;
+	map<NodeId, microseconds> askedBlocks;
+	map<NodeId, vector<microseconds>> hashTimes;
+	map<NodeId, vector<pair<microseconds, size_t>>> blockTimes;
+	auto peer = [&](NodeId const& _id) -> RecordedPeer&
+	{
+		if (!index.count(_id))
+		{
+			index[_id] = peers.size();
+			peers.push_back(RecordedPeer());
+			peers.back().id = _id;
+		}
+		return peers[index[_id]];
+	};
+
+	for (auto const& p: _log)
+	{
+		if (p.capability != "eth")
+			continue;
+		RLP r(p.payload);
+		if (p.outgoing)
+		{
+			if (p.type == StatusPacket && r.itemCount() > 1)
+				networkId = r[1].toInt<u256>();
+			else if (p.type == GetBlockHashesPacket)
+				askedHashes[p.node] = p.at;
+			else if (p.type == GetBlocksPacket)
+				askedBlocks[p.node] = p.at;
+			continue;
+		}
+
+		RecordedPeer& rp = peer(p.node);
+		switch (p.type)
+		{
+		case StatusPacket:
+			if (r.itemCount() > 3)
+				rp.head = r[3].toHash<h256>();
+			break;
+		case BlockHashesPacket:
+			if (askedHashes.count(p.node))
+			{
+				hashTimes[p.node].push_back(p.at - askedHashes[p.node]);
+				askedHashes.erase(p.node);
+			}
+			break;
+		case BlocksPacket:
+			for (auto const& b: r)
+				blocks[BlockInfo::headerHash(b.data())] = b.data().toBytes();
+			if (askedBlocks.count(p.node))
+			{
+				blockTimes[p.node].push_back(make_pair(p.at - askedBlocks[p.node], p.payload.size()));
+				askedBlocks.erase(p.node);
+			}
+			break;
+		case NewBlockPacket:
+			if (r.itemCount() != 2)
+				break;
+			if (r[0].isData())
+				rp.announcements.push_back(Announcement{p.at - begin, r[0].toHash<h256>(), false});
+			else
+			{
+				auto h = BlockInfo::headerHash(r[0].data());
+				blocks[h] = r[0].data().toBytes();
+				rp.announcements.push_back(Announcement{p.at - begin, h, true});
+			}
+			break;
+		default:;
+		}
+	}
+
+	// Each peer's latency is its median answer to GetBlockHashes, whose answers are small; its bandwidth is what its
+	// Blocks carried over the time they took beyond that.
+	for (auto& rp: peers)
+	{
+		auto& h = hashTimes[rp.id];
+		if (!h.empty())
+		{
+			nth_element(h.begin(), h.begin() + h.size() / 2, h.end());
+			rp.latency = h[h.size() / 2];
+		}
+		double seconds = 0;
+		size_t bytes = 0;
+		for (auto const& b: blockTimes[rp.id])
+		{
+			seconds += max(duration<double>(b.first - rp.latency).count(), 0.001);
+			bytes += b.second;
+		}
+		rp.bandwidth = seconds ? size_t(bytes / seconds) : 0;
+	}
+}
+
+ReplayChain::ReplayChain(map<h256, bytes> const& _blocks, h256 const& _genesis, u256 const& _genesisDifficulty):
+	m_genesis(_genesis),
+	m_genesisDifficulty(_genesisDifficulty),
+	m_best(_genesis)
+{
+	map<h256, Linked> unlinked;
+	for (auto const& b: _blocks)
+	{
+		BlockInfo bi(b.second, CheckNothing);
+		unlinked[b.first] = Linked{b.second, bi.parentHash, (unsigned)bi.number, bi.difficulty};
+	}
+
+	// Links each block whose parent is linked, until no more are; totalDifficulty holds the block's own difficulty
+	// until it is linked.
+	for (bool linked = true; linked;)
+	{
+		linked = false;
+		for (auto i = unlinked.begin(); i != unlinked.end();)
+			if (has(i->second.parent))
+			{
+				i->second.totalDifficulty += totalDifficulty(i->second.parent);
+				if (i->second.totalDifficulty > totalDifficulty(m_best))
+					m_best = i->first;
+				m_blocks.insert(*i);
+				i = unlinked.erase(i);
+				linked = true;
+			}
+			else
+				++i;
+	}
+	if (!unlinked.empty())
+		cwarn << unlinked.size() << "recorded blocks don't descend from the genesis; leaving them out.";
+}
+
+bytes const& ReplayChain::block(h256 const& _h) const
+{
+	static const bytes s_none;
+	auto it = m_blocks.find(_h);
+	return it == m_blocks.end() ? s_none : it->second.block;
+}
+
+unsigned ReplayChain::number(h256 const& _h) const
+{
+	auto it = m_blocks.find(_h);
+	return it == m_blocks.end() ? 0 : it->second.number;
+}
+
+u256 ReplayChain::totalDifficulty(h256 const& _h) const
+{
+	if (_h == m_genesis)
+		return m_genesisDifficulty;
+	auto it = m_blocks.find(_h);
+	return it == m_blocks.end() ? 0 : it->second.totalDifficulty;
+}
+
+h256 ReplayChain::parent(h256 const& _h) const
+{
+	auto it = m_blocks.find(_h);
+	return it == m_blocks.end() ? h256() : it->second.parent;
+}
+
+pair<size_t, size_t> ReplayChain::served() const
+{
+	Guard l(x_served);
+	size_t total = 0;
+	for (auto const& s: m_served)
+		total += s.second;
+	return make_pair(total, m_served.size());
+}
+
+ReplayPeer::ReplayPeer(Session* _s, HostCapabilityFace* _h, unsigned _i):
+	Capability(_s, _h, _i)
+{
+	auto h = host()->head();
+	RLPStream s;
+	prep(s, StatusPacket, 6)
+		<< c_protocolVersion
+		<< host()->m_networkId
+		<< host()->m_chain.totalDifficulty(h)
+		<< h
+		<< host()->m_chain.genesis()
+		<< c_relayVersion;
+	sealAndSend(s);
+}
+
+ReplayHost* ReplayPeer::host() const
+{
+	return static_cast<ReplayHost*>(Capability::hostCapability());
+}
+
+bool ReplayPeer::interpret(unsigned _id, RLP const& _r)
+{
+	ReplayChain const& chain = host()->m_chain;
+	switch (_id)
+	{
+	case GetBlockHashesPacket:
+	{
+		// As EthereumPeer answers: the hashes before the one given, latest first, down to the genesis.
+		h256 later = _r[0].toHash<h256>();
+		unsigned c = min<unsigned>(chain.number(later), _r[1].toInt<unsigned>());
+		RLPStream s;
+		prep(s, BlockHashesPacket, c);
+		h256 p = chain.parent(later);
+		for (unsigned i = 0; i < c; ++i, p = chain.parent(p))
+			s << p;
+		delayedSend(s);
+		break;
+	}
+	case GetBlocksPacket:
+	{
+		bytes rlp;
+		unsigned n = 0;
+		for (unsigned i = 0; i < _r.itemCount() && i <= c_maxBlocks; ++i)
+		{
+			auto h = _r[i].toHash<h256>();
+			auto const& b = chain.block(h);
+			if (b.size())
+			{
+				rlp += b;
+				++n;
+				host()->m_chain.noteServed(h);
+			}
+		}
+		host()->m_blocksSent += n;
+		host()->m_bytesSent += rlp.size();
+		RLPStream s;
+		prep(s, BlocksPacket, n).appendRaw(rlp, n);
+		delayedSend(s);
+		break;
+	}
+	case StatusPacket:
+	case GetTransactionsPacket:
+	case TransactionsPacket:
+	case BlockHashesPacket:
+	case BlocksPacket:
+	case NewBlockPacket:
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+void ReplayPeer::delayedSend(RLPStream& _s)
+{
+	Pending p;
+	_s.swapOut(p.packet);
+	auto now = steady_clock::now();
+	auto bandwidth = host()->m_bandwidth;
+	auto transfer = bandwidth ? duration_cast<steady_clock::duration>(duration<double>(double(p.packet.size()) / bandwidth)) : steady_clock::duration::zero();
+
+	Guard l(x_pending);
+	m_linkFree = max(now + host()->m_latency, m_linkFree) + transfer;
+	p.due = m_linkFree;
+	m_pending.push_back(move(p));
+}
+
+void ReplayPeer::flush(steady_clock::time_point _now)
+{
+	Guard l(x_pending);
+	while (!m_pending.empty() && m_pending.front().due <= _now)
+	{
+		RLPStream s;
+		s.appendRaw(m_pending.front().packet, 2);
+		sealAndSend(s);
+		m_pending.pop_front();
+	}
+}
+
+ReplayHost::ReplayHost(ReplayChain& _chain, RecordedPeer const& _peer, u256 const& _networkId, microseconds _latency, size_t _bandwidth, steady_clock::time_point _start):
+	HostCapability<ReplayPeer>(),
+	Worker		("replay", 1),
+	m_chain		(_chain),
+	m_networkId	(_networkId),
+	m_latency	(_latency),
+	m_bandwidth	(_bandwidth),
+	m_start		(_start),
+	m_head		(_chain.has(_peer.head) ? _peer.head : _chain.best()),
+	m_announcements(_peer.announcements)
+{
+}
+
+void ReplayHost::doWork()
+{
+	auto now = steady_clock::now();
+	vector<shared_ptr<ReplayPeer>> peers;
+	for (auto const& s: peerSessions())
+		if (auto p = s.first->cap<ReplayPeer>())
+			peers.push_back(p);
+
+	for (; m_announced < m_announcements.size() && m_start + m_announcements[m_announced].at <= now; ++m_announced)
+	{
+		auto const& a = m_announcements[m_announced];
+		if (!m_chain.has(a.hash))
+			continue;
+		u256 td = m_chain.totalDifficulty(a.hash);
+		{
+			Guard l(x_head);
+			if (td > m_chain.totalDifficulty(m_head))
+				m_head = a.hash;
+		}
+		for (auto const& p: peers)
+		{
+			RLPStream s;
+			p->prep(s, NewBlockPacket, 2);
+			if (a.full)
+			{
+				auto const& b = m_chain.block(a.hash);
+				s.appendRaw(b, 1);
+				m_chain.noteServed(a.hash);
+				++m_blocksSent;
+				m_bytesSent += b.size();
+			}
+			else
+				s << a.hash;
+			s << td;
+			p->sealAndSend(s, p2p::Lane::Urgent);
+		}
+	}
+
+	for (auto const& p: peers)
+		p->flush(now);
+}
@@ -0,0 +1,197 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SyncReplay.h
+ * @date 2015
+ * Peers which replay those of a packet log to a node syncing from them.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/Guards.h>
+#include <libdevcore/Worker.h>
+#include <libethcore/Common.h>
+#include <libethereum/CommonNet.h>
+#include <libp2p/Capability.h>
+#include <libp2p/HostCapability.h>
+#include <libp2p/PacketLog.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/// A block a peer announced with NewBlock during the recording.
+struct Announcement
+{
+	std::chrono::microseconds at;	///< Since the recording began.
+	h256 hash;
+	bool full;						///< Whether the whole block came, rather than its hash.
+};
+
+/// A remote peer of the recording, as its eth packets tell of it.
+struct RecordedPeer
+{
+	p2p::NodeId id;
+	h256 head;									///< As its Status gave.
+	std::vector<Announcement> announcements;
+	std::chrono::microseconds latency{0};		///< Median time it took to answer GetBlockHashes.
+	size_t bandwidth = 0;						///< Bytes a second it sent Blocks at, once past latency; zero if unknown.
+};
+
+/// What a packet log tells of a sync.
+struct SyncRecording
+{
+	/// Gathers the eth packets of @a _log.
+	explicit SyncRecording(std::vector<p2p::LoggedPacket> const& _log);
+
+	u256 networkId;								///< As the recording node's Status gave.
+	std::map<h256, bytes> blocks;				///< Every block received.
+	std::vector<RecordedPeer> peers;			///< In the order they first sent a packet.
+};
+
+/**
+ * @brief The blocks of a recording, linked to a genesis, which every replayed peer serves.
+ * Peers can only serve the blocks the recording node received; those not descended from the genesis are left out.
+ * @threadsafe
+ */
+class ReplayChain
+{
+public:
+	ReplayChain(std::map<h256, bytes> const& _blocks, h256 const& _genesis, u256 const& _genesisDifficulty);
+
+	bool has(h256 const& _h) const { return m_blocks.count(_h) || _h == m_genesis; }
+	bytes const& block(h256 const& _h) const;
+	unsigned number(h256 const& _h) const;
+	u256 totalDifficulty(h256 const& _h) const;
+	h256 parent(h256 const& _h) const;
+	h256 genesis() const { return m_genesis; }
+	/// @returns the block with the most total difficulty.
+	h256 best() const { return m_best; }
+	size_t size() const { return m_blocks.size(); }
+
+	/// Notes that a peer sent the block @a _h.
+	void noteServed(h256 const& _h) { Guard l(x_served); m_served[_h]++; }
+	/// @returns how many blocks were sent, and how many of those were distinct.
+	std::pair<size_t, size_t> served() const;
+
+private:
+	struct Linked
+	{
+		bytes block;
+		h256 parent;
+		unsigned number;
+		u256 totalDifficulty;
+	};
+
+	std::map<h256, Linked> m_blocks;
+	h256 m_genesis;
+	u256 m_genesisDifficulty;
+	h256 m_best;
+
+	mutable Mutex x_served;
+	std::map<h256, unsigned> m_served;
+};
+
+class ReplayHost;
+
+/**
+ * @brief A replayed peer's end of an eth session: sends Status, answers GetBlockHashes and GetBlocks from the
+ * ReplayChain, and ignores the rest. Its answers wait out its host's latency and bandwidth before they go.
+ */
+class ReplayPeer: public p2p::Capability
+{
+	friend class ReplayHost;
+
+public:
+	ReplayPeer(p2p::Session* _s, p2p::HostCapabilityFace* _h, unsigned _i);
+
+	static std::string name() { return "eth"; }
+	static u256 version() { return c_protocolVersion; }
+	static unsigned messageCount() { return PacketCount; }
+
+	ReplayHost* host() const;
+
+private:
+	/// An answer waiting to go.
+	struct Pending
+	{
+		std::chrono::steady_clock::time_point due;
+		bytes packet;						///< As prep() and what followed left it.
+	};
+
+	virtual bool interpret(unsigned _id, RLP const& _r);
+
+	/// Queues @a _s to go once the link has carried those before and latency has passed.
+	void delayedSend(RLPStream& _s);
+	/// Sends the answers that are due.
+	void flush(std::chrono::steady_clock::time_point _now);
+
+	Mutex x_pending;
+	std::deque<Pending> m_pending;
+	std::chrono::steady_clock::time_point m_linkFree;	///< When the last answer queued is through the link.
+};
+
+/**
+ * @brief Plays one peer of a recording: serves its head, and announces the blocks it announced, when it did, after
+ * @a _start.
+ */
+class ReplayHost: public p2p::HostCapability<ReplayPeer>, Worker
+{
+	friend class ReplayPeer;
+
+public:
+	/// Plays @a _peer with the round-trip time @a _latency and @a _bandwidth bytes a second, zero being unlimited.
+	ReplayHost(ReplayChain& _chain, RecordedPeer const& _peer, u256 const& _networkId, std::chrono::microseconds _latency, size_t _bandwidth, std::chrono::steady_clock::time_point _start);
+	virtual ~ReplayHost() { stopWorking(); }
+
+	std::chrono::microseconds latency() const { return m_latency; }
+	size_t bandwidth() const { return m_bandwidth; }
+	/// @returns the blocks, and their bytes, sent in Blocks and NewBlock.
+	size_t blocksSent() const { return m_blocksSent; }
+	size_t bytesSent() const { return m_bytesSent; }
+
+private:
+	h256 head() const { Guard l(x_head); return m_head; }
+
+	virtual void onStarting() { startWorking(); }
+	virtual void onStopping() { stopWorking(); }
+	/// Sends the answers and announcements that are due.
+	virtual void doWork();
+
+	ReplayChain& m_chain;
+	u256 m_networkId;
+	std::chrono::microseconds m_latency;
+	size_t m_bandwidth;
+	std::chrono::steady_clock::time_point m_start;
+
+	mutable Mutex x_head;
+	h256 m_head;
+	std::vector<Announcement> m_announcements;
+	size_t m_announced = 0;					///< Of m_announcements, those sent; touched only by doWork().
+
+	std::atomic<size_t> m_blocksSent{0};
+	std::atomic<size_t> m_bytesSent{0};
+};
+
+}
+}
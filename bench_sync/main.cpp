@@ -0,0 +1,226 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file main.cpp
+ * @date 2015
+ * Replays the peers of a recorded sync to a fresh node syncing from them in process, timing the sync and counting
+ * what it downloaded twice and how full its block queue ran.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include "../test/JsonSpiritHeaders.h"
+#include <libdevcore/Log.h>
+#include <libdevcrypto/KeyValueDB.h>
+#include <libp2p/Host.h>
+#include <libp2p/PacketLog.h>
+#include <libethereum/BlockQueue.h>
+#include <libethereum/CanonBlockChain.h>
+#include <libethereum/EthereumHost.h>
+#include <libethereum/State.h>
+#include <libethereum/TransactionQueue.h>
+#include "SyncReplay.h"
+using namespace std;
+using namespace std::chrono;
+using namespace dev;
+using namespace dev::eth;
+using namespace dev::p2p;
+namespace js = json_spirit;
+
+void help()
+{
+	cout
+		<< "Usage bench_sync [OPTIONS] <log>" << endl
+		<< "Replays the peers of a packet log, as recorded by eth --record-packets, to a fresh node syncing from them in this process." << endl
+		<< "The peers serve only the blocks received while recording, and announce new blocks when they did then." << endl
+		<< "Options:" << endl
+		<< "    --latency <ms>  Give every peer this round-trip time (default: each its median answer to GetBlockHashes while recording)." << endl
+		<< "    --bandwidth <bytes>  Give every peer this many bytes a second, or 0 for unlimited (default: each that it sent Blocks at while recording)." << endl
+		<< "    -p,--peers <n>  Replay only the first n peers of the log (default: all)." << endl
+		<< "    --port <port>  Listen on the given port, and the peers on those following it (default: 30310)." << endl
+		<< "    -t,--timeout <seconds>  Give up if not synced in this time (default: 600)." << endl
+		<< "    -j,--json  Write the results as a JSON object rather than as text." << endl
+		<< "    -h,--help  Show this help message and exit." << endl
+		;
+	exit(0);
+}
+
+/// How full the block queue ran, sampled as the sync went.
+struct QueueOccupancy
+{
+	void sample(BlockQueueStatus const& _s)
+	{
+		size_t total = _s.ready + _s.verifying + _s.unknown + _s.future;
+		sum += total;
+		maxTotal = max(maxTotal, total);
+		maxUnknown = max(maxUnknown, _s.unknown);
+		++samples;
+	}
+	double mean() const { return samples ? double(sum) / samples : 0; }
+
+	size_t sum = 0;
+	size_t samples = 0;
+	size_t maxTotal = 0;
+	size_t maxUnknown = 0;		///< Waiting on parents not yet downloaded.
+};
+
+int main(int argc, char** argv)
+{
+	string logPath;
+	int latencyMs = -1;
+	long long bandwidth = -1;
+	unsigned maxPeers = 0;
+	unsigned short port = 30310;
+	unsigned timeout = 600;
+	bool json = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-h" || arg == "--help")
+			help();
+		else if (arg == "--latency" && i + 1 < argc)
+			latencyMs = max(atoi(argv[++i]), 0);
+		else if (arg == "--bandwidth" && i + 1 < argc)
+			bandwidth = max(atoll(argv[++i]), 0ll);
+		else if ((arg == "-p" || arg == "--peers") && i + 1 < argc)
+			maxPeers = atoi(argv[++i]);
+		else if (arg == "--port" && i + 1 < argc)
+			port = (unsigned short)atoi(argv[++i]);
+		else if ((arg == "-t" || arg == "--timeout") && i + 1 < argc)
+			timeout = atoi(argv[++i]);
+		else if (arg == "-j" || arg == "--json")
+			json = true;
+		else if (logPath.empty() && arg[0] != '-')
+			logPath = arg;
+		else
+		{
+			cerr << "Invalid argument: " << arg << endl;
+			return -1;
+		}
+	}
+	if (logPath.empty())
+	{
+		cerr << "No packet log given." << endl;
+		return -1;
+	}
+	g_logVerbosity = 0;
+
+	SyncRecording recording(PacketLog::read(logPath));
+	if (maxPeers && recording.peers.size() > maxPeers)
+		recording.peers.resize(maxPeers);
+	if (recording.peers.empty())
+	{
+		cerr << "No eth peers in " << logPath << endl;
+		return -1;
+	}
+
+	CanonBlockChain bc(c_memoryDBPath);
+	OverlayDB stateDB = State::openDB(c_memoryDBPath);
+	TransactionQueue tq;
+	BlockQueue bq;
+	bq.setVerifierThreads(max(thread::hardware_concurrency(), 2u) - 1);
+
+	ReplayChain chain(recording.blocks, bc.genesisHash(), bc.details(bc.genesisHash()).totalDifficulty);
+	h256 target = chain.best();
+	u256 targetDifficulty = chain.totalDifficulty(target);
+	if (target == bc.genesisHash())
+	{
+		cerr << "No blocks in " << logPath << " descend from our genesis." << endl;
+		return -1;
+	}
+
+	auto start = steady_clock::now();
+	vector<shared_ptr<ReplayHost>> replays;
+	vector<unique_ptr<Host>> peerHosts;
+	for (auto const& p: recording.peers)
+	{
+		auto l = latencyMs >= 0 ? microseconds(latencyMs * 1000) : p.latency;
+		auto b = bandwidth >= 0 ? size_t(bandwidth) : p.bandwidth;
+		peerHosts.emplace_back(new Host("bench_sync/peer", NetworkPreferences("127.0.0.1", port + 1 + peerHosts.size(), false)));
+		replays.push_back(peerHosts.back()->registerCapability(new ReplayHost(chain, p, recording.networkId, l, b, start)));
+		peerHosts.back()->start();
+	}
+
+	Host node("bench_sync", NetworkPreferences("127.0.0.1", port, false));
+	node.registerCapability(new EthereumHost(bc, stateDB, tq, bq, recording.networkId));
+	node.setIdealPeerCount(peerHosts.size());
+	node.start();
+	while (!node.haveNetwork())
+		this_thread::sleep_for(milliseconds(2));
+	for (auto const& h: peerHosts)
+	{
+		while (!h->haveNetwork())
+			this_thread::sleep_for(milliseconds(2));
+		node.addNode(h->id(), bi::address::from_string("127.0.0.1"), h->listenPort(), h->listenPort());
+	}
+
+	// Drains the queue into the chain as a client would, until it holds the best recorded block.
+	QueueOccupancy occupancy;
+	auto deadline = start + seconds(timeout);
+	bool synced = false;
+	while (!(synced = bc.details().totalDifficulty >= targetDifficulty) && steady_clock::now() < deadline)
+	{
+		bc.sync(bq, stateDB, 100);
+		occupancy.sample(bq.status());
+		this_thread::sleep_for(milliseconds(10));
+	}
+	double syncSeconds = duration<double>(steady_clock::now() - start).count();
+
+	node.stop();
+	for (auto const& h: peerHosts)
+		h->stop();
+
+	auto served = chain.served();
+	size_t duplicates = served.first - served.second;
+	if (json)
+	{
+		js::mObject o;
+		o["synced"] = synced;
+		o["seconds"] = syncSeconds;
+		o["target"] = (int)chain.number(target);
+		o["imported"] = (int)bc.number();
+		o["blocks_served"] = (int)served.first;
+		o["duplicates"] = (int)duplicates;
+		o["queue_mean"] = occupancy.mean();
+		o["queue_max"] = (int)occupancy.maxTotal;
+		o["queue_max_unknown"] = (int)occupancy.maxUnknown;
+		js::mArray peers;
+		for (unsigned i = 0; i < replays.size(); ++i)
+		{
+			js::mObject p;
+			p["id"] = recording.peers[i].id.abridged();
+			p["latency_ms"] = replays[i]->latency().count() / 1000.0;
+			p["bandwidth"] = (int)replays[i]->bandwidth();
+			p["blocks"] = (int)replays[i]->blocksSent();
+			p["bytes"] = (int)replays[i]->bytesSent();
+			peers.push_back(p);
+		}
+		o["peers"] = peers;
+		cout << js::write_string(js::mValue(o), true) << endl;
+	}
+	else
+	{
+		cout << "peer\tlatency ms\tbandwidth B/s\tblocks\tbytes" << endl;
+		for (unsigned i = 0; i < replays.size(); ++i)
+			cout << recording.peers[i].id.abridged() << "\t" << replays[i]->latency().count() / 1000.0 << "\t" << replays[i]->bandwidth() << "\t" << replays[i]->blocksSent() << "\t" << replays[i]->bytesSent() << endl;
+		cout << (synced ? "Synced" : "Gave up") << " at #" << bc.number() << " of #" << chain.number(target) << " after " << syncSeconds << " s" << endl
+			<< served.first << " blocks served, " << duplicates << " of them duplicates" << endl
+			<< "Block queue: " << occupancy.mean() << " mean, " << occupancy.maxTotal << " max, " << occupancy.maxUnknown << " max awaiting parents" << endl;
+	}
+	return synced ? 0 : 1;
+}
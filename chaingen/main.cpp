@@ -0,0 +1,341 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file main.cpp
+ * @date 2015
+ * Builds a chain of full blocks of synthetic transactions, a mix of transfers, token calls, contract creations and
+ * storage-heavy calls, and writes it for eth --import.
+ */
+
+#include <algorithm>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/Log.h>
+#include <libdevcrypto/KeyValueDB.h>
+#include <liblll/Compiler.h>
+#include <libethereum/BlockArchive.h>
+#include <libethereum/CanonBlockChain.h>
+#include <libethereum/State.h>
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+void help()
+{
+	cout
+		<< "Usage chaingen [OPTIONS] <file>" << endl
+		<< "Builds a chain of full blocks of synthetic transactions on the canonical genesis and writes it to file, for eth --import." << endl
+		<< "The blocks' proofs of work are not valid, so import them with eth's --no-pow-check." << endl
+		<< "Options:" << endl
+		<< "    -b,--blocks <n>  Make n blocks of load, after those setting it up (default: 1000)." << endl
+		<< "    -a,--accounts <n>  Send from n accounts, funded and given tokens by the setup (default: 1000)." << endl
+		<< "    -m,--mix <mix>  Weigh the kinds of transaction, of transfer, token, create and storage, as so (default: transfer:60,token:25,create:5,storage:10)." << endl
+		<< "    --slots <n>  Set n new storage slots in each storage-heavy call (default: 20)." << endl
+		<< "    --block-time <seconds>  Space the blocks' timestamps so (default: 15)." << endl
+		<< "    --start <time>  Give the first block this Unix time (default: early enough that the last is not in the future)." << endl
+		<< "    --seed <n>  Seed the choice of transactions with n (default: 0)." << endl
+		<< "    -s,--snappy  Write a snappy archive rather than the blocks' RLP concatenated." << endl
+		<< "    -h,--help  Show this help message and exit." << endl
+		;
+	exit(0);
+}
+
+enum Kind { Transfer, TokenCall, Create, StorageCall, KindCount };
+static char const* const c_kindNames[KindCount] = { "transfer", "token", "create", "storage" };
+
+/// Gas given each kind of transaction; a little over what they use, so blocks fill to within a transfer.
+static const u256 c_transferTxGas = 21000;
+static const u256 c_tokenTxGas = 60000;
+static const u256 c_createTxGas = 150000;
+
+/// Tokens each account is given by the setup.
+static const u256 c_tokens = 1000000;
+
+/// @returns the init code of a token whose whole supply goes to its creator, and whose calls, of the recipient and
+/// amount as words, move tokens from the caller, logging Transfer as an ERC-style token does.
+static bytes tokenCode()
+{
+	string transfer = "0x" + toHex(sha3("Transfer(address,address,uint256)").ref());
+	return compileLLL(
+		"{ [[(caller)]] 0x1000000000000000000000000000000"
+		"  (return 0 (lll {"
+		"    (when (>= @@(caller) (calldataload 32)) {"
+		"      [[(caller)]] (- @@(caller) (calldataload 32))"
+		"      [[(calldataload 0)]] (+ @@(calldataload 0) (calldataload 32))"
+		"      [0] (calldataload 32)"
+		"      (log3 0 32 " + transfer + " (caller) (calldataload 0)) })"
+		"  } 0)) }");
+}
+
+/// @returns the init code of a contract whose calls set as many new storage slots as their first word says.
+static bytes storageCode()
+{
+	return compileLLL(
+		"(return 0 (lll {"
+		"  [0] @@0"
+		"  (for {} (< @32 (calldataload 0)) [32] (+ @32 1) [[(+ @0 (+ @32 1))]] 1)"
+		"  [[0]] (+ @0 (calldataload 0))"
+		"} 0))");
+}
+
+/// @returns the RLP of @a _block with the timestamp @a _timestamp, and the difficulty that follows from it, as the
+/// state gives timestamps of now.
+static bytes retimed(bytes const& _block, BlockInfo const& _parent, u256 _timestamp)
+{
+	RLP r(_block);
+	BlockInfo bi(_block, CheckNothing);
+	bi.timestamp = _timestamp;
+	bi.difficulty = bi.calculateDifficulty(_parent);
+	bi.noteDirty();
+	RLPStream s(3);
+	bi.streamRLP(s, WithNonce);
+	s.appendRaw(r[1].data()).appendRaw(r[2].data());
+	return s.out();
+}
+
+/// Fills blocks with transactions and adds them to an in-memory chain.
+class ChainMaker
+{
+public:
+	/// Makes @a _accounts accounts, the first of them the coinbase, and times the blocks @a _blockTime seconds apart
+	/// from @a _start.
+	ChainMaker(unsigned _accounts, u256 _start, unsigned _blockTime):
+		m_bc(c_memoryDBPath),
+		m_db(State::openDB(c_memoryDBPath)),
+		m_accounts(makeAccounts(_accounts)),
+		m_state(m_db, BaseState::CanonGenesis, m_accounts[0].address()),
+		m_start(_start),
+		m_blockTime(_blockTime)
+	{
+		m_state.sync(m_bc);
+	}
+
+	CanonBlockChain const& chain() const { return m_bc; }
+	vector<KeyPair> const& accounts() const { return m_accounts; }
+
+	/// @returns a transaction from @a _from with its next nonce.
+	Transaction call(KeyPair const& _from, Address const& _to, u256 _value, bytes const& _data, u256 _gas) const
+	{
+		return Transaction(_value, 1, _gas, _to, _data, m_state.transactionsFrom(_from.address()), _from.secret());
+	}
+	Transaction create(KeyPair const& _from, bytes const& _code, u256 _gas) const
+	{
+		return Transaction(0, 1, _gas, _code, m_state.transactionsFrom(_from.address()), _from.secret());
+	}
+
+	/// @returns whether @a _t fits what is left of the block.
+	bool fits(Transaction const& _t) const { return _t.gas() <= m_state.gasLimitRemaining(); }
+	ExecutionResult execute(Transaction const& _t)
+	{
+		auto r = m_state.execute(m_bc.lastHashes(), _t);
+		++m_transactions;
+		m_gasUsed += r.gasUsed;
+		return r;
+	}
+
+	/// Seals the block, timed m_blockTime after the last, and imports it as verified, the proof of work not being valid.
+	void seal()
+	{
+		m_state.commitToMine(m_bc);
+		m_state.completeMine();
+		bytes b = retimed(m_state.blockData(), m_bc.info(), m_start + m_bc.number() * m_blockTime);
+		m_bc.import(b, m_db, Aversion::AvoidOldBlocks, true);
+		m_state.sync(m_bc);
+	}
+
+	unsigned transactions() const { return m_transactions; }
+	u256 gasUsed() const { return m_gasUsed; }
+
+private:
+	static vector<KeyPair> makeAccounts(unsigned _n)
+	{
+		vector<KeyPair> ret;
+		for (unsigned i = 0; i < _n; ++i)
+			ret.push_back(KeyPair(sha3("chaingen " + toString(i))));
+		return ret;
+	}
+
+	CanonBlockChain m_bc;
+	OverlayDB m_db;
+	vector<KeyPair> m_accounts;
+	State m_state;
+	u256 m_start;
+	unsigned m_blockTime;
+	unsigned m_transactions = 0;
+	u256 m_gasUsed;
+};
+
+/// @returns the call data of a token transfer of @a _amount to @a _to.
+static bytes tokenTransfer(Address const& _to, u256 _amount)
+{
+	return h256(_to, h256::AlignRight).asBytes() + toBigEndian(_amount);
+}
+
+int main(int argc, char** argv)
+{
+	string path;
+	unsigned blocks = 1000;
+	unsigned accounts = 1000;
+	vector<double> weights = { 60, 25, 5, 10 };
+	unsigned slots = 20;
+	unsigned blockTime = 15;
+	u256 start;
+	unsigned seed = 0;
+	bool snappy = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-h" || arg == "--help")
+			help();
+		else if ((arg == "-b" || arg == "--blocks") && i + 1 < argc)
+			blocks = atoi(argv[++i]);
+		else if ((arg == "-a" || arg == "--accounts") && i + 1 < argc)
+			accounts = max(atoi(argv[++i]), 2);
+		else if ((arg == "-m" || arg == "--mix") && i + 1 < argc)
+		{
+			weights.assign(KindCount, 0);
+			string mix = argv[++i];
+			for (size_t b = 0; b < mix.size();)
+			{
+				size_t e = min(mix.find(',', b), mix.size());
+				string item = mix.substr(b, e - b);
+				auto colon = item.find(':');
+				auto kind = find(begin(c_kindNames), end(c_kindNames), item.substr(0, colon));
+				if (colon == string::npos || kind == end(c_kindNames))
+				{
+					cerr << "Bad " << arg << " option: " << item << endl;
+					return -1;
+				}
+				weights[kind - begin(c_kindNames)] = max(atof(item.substr(colon + 1).c_str()), 0.0);
+				b = e + 1;
+			}
+		}
+		else if (arg == "--slots" && i + 1 < argc)
+			slots = atoi(argv[++i]);
+		else if (arg == "--block-time" && i + 1 < argc)
+			blockTime = max(atoi(argv[++i]), 1);
+		else if (arg == "--start" && i + 1 < argc)
+			start = u256(argv[++i]);
+		else if (arg == "--seed" && i + 1 < argc)
+			seed = atoi(argv[++i]);
+		else if (arg == "-s" || arg == "--snappy")
+			snappy = true;
+		else if (path.empty() && arg[0] != '-')
+			path = arg;
+		else
+		{
+			cerr << "Invalid argument: " << arg << endl;
+			return -1;
+		}
+	}
+	if (path.empty())
+	{
+		cerr << "No file given." << endl;
+		return -1;
+	}
+
+	if (accumulate(weights.begin(), weights.end(), 0.0) <= 0)
+	{
+		cerr << "Nothing in the mix." << endl;
+		return -1;
+	}
+	g_logVerbosity = 0;
+
+	// The setup takes a block for each forty accounts or so; this leaves plenty.
+	if (!start)
+		start = (u256)time(0) - (blocks + accounts + 1) * blockTime;
+	ChainMaker c(accounts, start, blockTime);
+	auto const& keys = c.accounts();
+	KeyPair const& owner = keys[0];
+	bytes tokenInit = tokenCode();
+
+	// Setup: the first block mines the ether the rest spend; then the contracts go up, and every account is given
+	// ether and tokens.
+	c.seal();
+	Address token;
+	Address storage;
+	deque<function<Transaction()>> setup;
+	setup.push_back([&](){ return c.create(owner, tokenInit, c_createTxGas); });
+	setup.push_back([&](){ return c.create(owner, storageCode(), c_createTxGas); });
+	for (unsigned i = 1; i < accounts; ++i)
+		setup.push_back([&, i](){ return c.call(owner, keys[i].address(), finney, bytes(), c_transferTxGas); });
+	for (unsigned i = 1; i < accounts; ++i)
+		setup.push_back([&, i](){ return c.call(owner, token, 0, tokenTransfer(keys[i].address(), c_tokens), c_tokenTxGas); });
+	for (unsigned n = 0; !setup.empty(); c.seal())
+		while (!setup.empty())
+		{
+			auto t = setup.front()();
+			if (!c.fits(t))
+				break;
+			auto r = c.execute(t);
+			if (n < 2 && r.newAddress)
+				(n++ ? storage : token) = r.newAddress;
+			setup.pop_front();
+		}
+	unsigned setupBlocks = c.chain().number();
+	unsigned setupTransactions = c.transactions();
+	u256 setupGas = c.gasUsed();
+
+	// Load: each transaction of a kind drawn by weight, between accounts drawn evenly; a transfer in its place if it
+	// doesn't fit, and the block sealed once not even that does.
+	mt19937 rng(seed);
+	discrete_distribution<int> kinds(weights.begin(), weights.end());
+	uniform_int_distribution<unsigned> account(1, accounts - 1);
+	bytes storageData = toBigEndian(u256(slots));
+	u256 storageGas = 40000 + slots * 21000;
+	vector<unsigned> counts(KindCount, 0);
+	for (unsigned b = 0; b < blocks; ++b, c.seal())
+		for (;;)
+		{
+			auto const& from = keys[account(rng)];
+			Kind k = (Kind)kinds(rng);
+			Transaction t;
+			switch (k)
+			{
+			case TokenCall: t = c.call(from, token, 0, tokenTransfer(keys[account(rng)].address(), 1), c_tokenTxGas); break;
+			case Create: t = c.create(from, tokenInit, c_createTxGas); break;
+			case StorageCall: t = c.call(from, storage, 0, storageData, storageGas); break;
+			default: k = Transfer;
+			}
+			if (k == Transfer || !c.fits(t))
+			{
+				k = Transfer;
+				t = c.call(from, keys[account(rng)].address(), 1, bytes(), c_transferTxGas);
+			}
+			if (!c.fits(t))
+				break;
+			c.execute(t);
+			counts[k]++;
+		}
+
+	if (!writeBlockArchive(c.chain(), 1, c.chain().number(), path, snappy ? ArchiveFormat::Snappy : ArchiveFormat::Binary))
+	{
+		cerr << "Can't write " << path << endl;
+		return -1;
+	}
+	cout << "Setup: " << setupBlocks << " blocks, " << setupTransactions << " transactions, " << setupGas << " gas" << endl
+		<< "Load: " << blocks << " blocks, " << (c.transactions() - setupTransactions) << " transactions, " << (c.gasUsed() - setupGas) << " gas:";
+	for (unsigned k = 0; k < KindCount; ++k)
+		cout << " " << counts[k] << " " << c_kindNames[k];
+	cout << endl << "Written #1 to #" << c.chain().number() << " to " << path << endl;
+	return 0;
+}
@@ -43,6 +43,12 @@ find_package (LevelDB REQUIRED)
 message(" - LevelDB header: ${LEVELDB_INCLUDE_DIRS}")
 message(" - LevelDB lib: ${LEVELDB_LIBRARIES}")
 
+if (ROCKSDB)
+	find_package (RocksDB REQUIRED)
+	message(" - RocksDB header: ${ROCKSDB_INCLUDE_DIRS}")
+	message(" - RocksDB lib: ${ROCKSDB_LIBRARIES}")
+endif()
+
 # TODO the Jsoncpp package does not yet check for correct version number
 find_package (Jsoncpp 0.60 REQUIRED)
 message(" - Jsoncpp header: ${JSONCPP_INCLUDE_DIRS}")
@@ -0,0 +1,107 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file MetricsServer.cpp
+ * @date 2015
+ */
+
+#include "MetricsServer.h"
+#include <memory>
+#include <libdevcore/Log.h>
+#include <libdevcore/Metrics.h>
+using namespace std;
+using namespace dev;
+namespace ba = boost::asio;
+namespace bi = boost::asio::ip;
+
+namespace
+{
+
+/// The most we read of a request before giving up on it.
+static const size_t c_maxRequest = 8192;
+
+/// A connection, living as long as the handlers it has outstanding.
+struct MetricsConnection: public enable_shared_from_this<MetricsConnection>
+{
+	explicit MetricsConnection(ba::io_service& _io): socket(_io) {}
+
+	void read()
+	{
+		auto self = shared_from_this();
+		ba::async_read_until(socket, request, "\r\n\r\n", [this, self](boost::system::error_code const& _ec, size_t)
+		{
+			if (_ec)
+				return;
+			istream in(&request);
+			string method;
+			string path;
+			in >> method >> path;
+			if (method != "GET")
+				respond("405 Method Not Allowed", "text/plain", "");
+			else if (path == "/metrics")
+				respond("200 OK", "text/plain; version=0.0.4", Metrics::get().prometheus());
+			else
+				respond("404 Not Found", "text/plain", "");
+		});
+	}
+
+	void respond(string const& _status, string const& _type, string const& _body)
+	{
+		response = "HTTP/1.1 " + _status + "\r\nContent-Type: " + _type + "\r\nContent-Length: " + toString(_body.size()) + "\r\nConnection: close\r\n\r\n" + _body;
+		auto self = shared_from_this();
+		ba::async_write(socket, ba::buffer(response), [this, self](boost::system::error_code const&, size_t)
+		{
+			boost::system::error_code ec;
+			socket.shutdown(bi::tcp::socket::shutdown_both, ec);
+		});
+	}
+
+	bi::tcp::socket socket;
+	ba::streambuf request{c_maxRequest};
+	string response;
+};
+
+}
+
+MetricsServer::MetricsServer(unsigned short _port, string const& _address):
+	m_acceptor(m_io, bi::tcp::endpoint(bi::address::from_string(_address), _port))
+{
+	accept();
+	m_thread = thread([&]()
+	{
+		setThreadName("metrics");
+		m_io.run();
+	});
+}
+
+MetricsServer::~MetricsServer()
+{
+	m_io.stop();
+	if (m_thread.joinable())
+		m_thread.join();
+}
+
+void MetricsServer::accept()
+{
+	auto c = make_shared<MetricsConnection>(m_io);
+	m_acceptor.async_accept(c->socket, [this, c](boost::system::error_code const& _ec)
+	{
+		if (!_ec)
+			c->read();
+		if (_ec != ba::error::operation_aborted)
+			accept();
+	});
+}
@@ -0,0 +1,47 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file MetricsServer.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <thread>
+#include <boost/asio.hpp>
+
+namespace dev
+{
+
+/**
+ * @brief Serves the process's Metrics over HTTP, for Prometheus to scrape from /metrics.
+ * One request a connection, answered on a thread of its own.
+ */
+class MetricsServer
+{
+public:
+	MetricsServer(unsigned short _port, std::string const& _address = "0.0.0.0");
+	~MetricsServer();
+
+private:
+	void accept();
+
+	boost::asio::io_service m_io;
+	boost::asio::ip::tcp::acceptor m_acceptor;
+	std::thread m_thread;
+};
+
+}
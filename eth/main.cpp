@@ -31,10 +31,19 @@
 
 #include <libdevcrypto/FileSystem.h>
 #include <libevmcore/Instruction.h>
+#include <libdevcore/Affinity.h>
+#include <libdevcore/CpuFeatures.h>
+#include <libdevcore/MappedFile.h>
 #include <libdevcore/StructuredLogger.h>
+#include <libdevcore/ThreadPool.h>
 #include <libevm/VM.h>
 #include <libevm/VMFactory.h>
+#include <libevm/VMProfiler.h>
+#include <libevm/AdaptiveVM.h>
 #include <libethereum/All.h>
+#include <libethereum/BlockArchive.h>
+#include <libethereum/StateArchive.h>
+#include <libethereum/ParallelExecutor.h>
 #include <libwebthree/WebThree.h>
 #if ETH_READLINE
 #include <readline/readline.h>
@@ -42,10 +51,14 @@
 #endif
 #if ETH_JSONRPC
 #include <libweb3jsonrpc/WebThreeStubServer.h>
-#include <jsonrpccpp/server/connectors/httpserver.h>
+#include <libweb3jsonrpc/StreamServer.h>
+#include <libweb3jsonrpc/WebServer.h>
+#include <libweb3jsonrpc/StratumServer.h>
+#include <libweb3jsonrpc/IpcServer.h>
 #endif
 #include <libethcore/Ethasher.h>
 #include "BuildInfo.h"
+#include "MetricsServer.h"
 using namespace std;
 using namespace dev;
 using namespace dev::p2p;
@@ -88,6 +101,7 @@ void interactiveHelp()
 		<< "    send  Execute a given transaction with current secret." << endl
 		<< "    contract  Create a new contract with current secret." << endl
 		<< "    peers  List the peers that are connected" << endl
+		<< "    dbstats  Dumps the statistics of the blocks, extras and state DBs." << endl
 #if ETH_FATDB
 		<< "    listaccounts  List the accounts on the network." << endl
 		<< "    listcontracts  List the contracts on the network." << endl
@@ -114,18 +128,43 @@ void help()
 		<< "    -d,--db-path <path>  Load database from path (default:  ~/.ethereum " << endl
 		<< "                         <APPDATA>/Etherum or Library/Application Support/Ethereum)." << endl
 		<< "    -D,--create-dag <this/next/number>  Create the DAG in preparation for mining on given block and exit." << endl
+		<< "    --dag-huge-pages  Read the DAG into huge pages rather than sharing it with other processes (default: off)." << endl
+		<< "    --dag-numa <interleave/replicate>  Read the DAG into memory of our own, spread over the NUMA nodes or copied onto each" << endl
+		<< "                                       for the threads running there (default: shared with other processes)." << endl
+		<< "    --dag-verify  Verify blocks against the DAG, kept in memory, rather than the light cache; needs 1GB or more spare (default: off)." << endl
 		<< "    -e,--ether-price <n>  Set the ether price in the reference unit e.g. ¢ (Default: 30.679)." << endl
 		<< "    -E,--export <file>  Export file as a concatenated series of blocks and exit." << endl
 		<< "    --from <n>  Export only from block n; n may be a decimal, a '0x' prefixed hash, or 'latest'." << endl
 		<< "    --to <n>  Export only to block n (inclusive); n may be a decimal, a '0x' prefixed hash, or 'latest'." << endl
 		<< "    --only <n>  Equivalent to --export-from n --export-to n." << endl
+		<< "    --format <binary/hex/human/snappy>  Format of the exported blocks; snappy compresses them in frames (default: binary)." << endl
+		<< "    --export-state <dir>  Export the state after the block given by --to as a snapshot in dir and exit." << endl
+		<< "    --import-state <dir>  Import the state snapshot in dir, checking it against the block header it has, and exit." << endl
+		<< "    --trusted-hash <hash>  Require the snapshot imported to be of the block with this hash." << endl
+		<< "    --shards <n>  Export to n files of consecutive ranges, <file>.0 onwards, written in parallel (default: 1)." << endl
 		<< "    -f,--force-mining  Mine even when there are no transaction to mine (Default: off)" << endl
 		<< "    -h,--help  Show this help message and exit." << endl
 		<< "    -i,--interactive  Enter interactive mode (default: non-interactive)." << endl
-		<< "    -I,--import <file>  Import file as a concatenated series of blocks and exit." << endl
+		<< "    --server <sync/rpc/miner>  Run headless, without whisper or the interactive console, sizing the threads of each" << endl
+		<< "                               subsystem from the cores for a node that syncs, serves JSON-RPC or mines; rpc and miner" << endl
+		<< "                               nodes load the top of the state, the recently called code and the DAG before serving." << endl
+		<< "    --cpus <thread>=<cpus>  Pin threads named thread, e.g. eth, verifier, pool, p2p, miner, db or main, or * for the rest," << endl
+		<< "                            to the given CPUs, as 0-3,8, or those of NUMA nodes, as node1 (default: unpinned)." << endl
+		<< "    --numa-miners  Pin each mining thread to a NUMA node, going round the nodes in turn (default: off)." << endl
+		<< "    --warm-up  Load the top of the state, the recently called code and, if mining, the DAG before serving (default: off)." << endl
+		<< "    -I,--import <file>  Import file as a concatenated series of blocks and exit. A file, rather than -- for stdin, is imported in bulk, straight into the chain." << endl
+		<< "    --no-pow-check  With --import of a file, don't check the blocks' proofs of work, as those chaingen makes are not valid." << endl
 #if ETH_JSONRPC
 		<< "    -j,--json-rpc  Enable JSON-RPC server (default: off)." << endl
 		<< "    --json-rpc-port	 Specify JSON-RPC server port (implies '-j', default: " << SensibleHttpPort << ")." << endl
+		<< "    --json-rpc-stream  Serve JSON-RPC over plain TCP, a request per line, with subscriptions pushed as they happen, instead of HTTP (implies '-j')." << endl
+		<< "    --json-rpc-threads <n>  Handle HTTP and WebSocket JSON-RPC requests on n threads (default: " << SensibleHttpThreads << ", or the cores with --server rpc)." << endl
+		<< "    --stratum <port>  Give work to remote miners over Stratum (eth-proxy flavour) on the given port (default: off)." << endl
+		<< "    --stratum-share-difficulty <n>  Count shares from Stratum miners meeting difficulty n (default: the block's)." << endl
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+		<< "    --ipc [path]  Serve the chain in RLP to processes on this host over a unix socket at path, writing new blocks to a ring in shared memory at path.ring (default path: <data dir>/eth.ipc)." << endl
+		<< "    --ipc-ring-size <MiB>  Make the ring of new blocks for --ipc this big; 0 for none (default: 64)." << endl
+#endif
 #endif
 		<< "    -K,--kill  First kill the blockchain." << endl
 		<< "       --listen-ip <port>  Listen on the given port for incoming connections (default: 30303)." << endl
@@ -141,10 +180,30 @@ void help()
 		<< "    -s,--secret <secretkeyhex>  Set the secret key for use with send command (default: auto)." << endl
 		<< "    -t,--miners <number>  Number of mining threads to start (Default: " << thread::hardware_concurrency() << ")" << endl
 		<< "    -v,--verbosity <0 - 9>  Set the log verbosity from 0 to 9 (Default: 8)." << endl
+		<< "    --log-async  Write the log from a thread of its own, dropping entries should it fall behind." << endl
+		<< "    --lock-profile <seconds>  Log the most contended locks every given seconds; needs a build with LOCK_PROFILING." << endl
+		<< "    --metrics-port <port>  Serve metrics for Prometheus at /metrics on the given port (default: none)." << endl
 		<< "    -x,--peers <number>  Attempt to connect to given number of peers (Default: 5)." << endl
+		<< "    --network-threads <number>  Number of threads to run the network on (Default: 1)." << endl
+		<< "    --egress-limit <cap>:<bytes>  Limit what capability cap (e.g. eth, shh) sends to all peers to the given bytes a second, but for new blocks (Default: unlimited)." << endl
+		<< "    --record-packets <path>  Append every packet sent or received, and when, to the given file, for bench_sync to replay." << endl
 		<< "    -V,--version  Show the version and exit." << endl
+		<< "    --db <backend>  Store the blockchain and state with leveldb, rocksdb or memory (default: leveldb)." << endl
+		<< "    --db-profile <profile>  Tune the DBs for a default, full (pruned) or archive node; later --db-* options override it (default: default)." << endl
+		<< "    --db-cache [<db>:]<MB>  Size of the block cache of the blocks, extras or state DB, or of each (default: the backend's own)." << endl
+		<< "    --db-write-buffer [<db>:]<MB>  Bytes written to a DB before they are flushed to a table (default: the backend's own)." << endl
+		<< "    --db-bloom [<db>:]<bits>  Bits per key of the bloom filters of a DB's tables, sparing reads; 0 for none (default: none)." << endl
+		<< "    --db-open-files [<db>:]<n>  Tables of a DB kept open (default: the backend's own)." << endl
+		<< "    --db-compression [<db>:]<on/off>  Compress a DB's tables (default: on)." << endl
+		<< "    --chain-cache <MB>  Memory for cached blocks, receipts and other chain data (default: 64)." << endl
+		<< "    --log-index  Index the logs of blocks imported from now on by address and first topic, for fast log queries (default: off)." << endl
+		<< "    --fast-sync  Sync a new chain by downloading the state of a recent block, rather than executing every block up to it (default: off)." << endl
+		<< "    --import-threads <n>  Execute the transactions of imported blocks speculatively on n threads (default: 1)." << endl
+		<< "    --prune <n>[:<k>]  Keep only the states of the last n blocks, and of every k-th block; needs a fresh state DB (default: keep all)." << endl
+		<< "    --vm-profile  Profile opcode counts, gas and time per contract; the hottest are reported with --structured-logging on exit (default: off)." << endl
 #if ETH_EVMJIT
 		<< "    --jit  Use EVM JIT (default: off)." << endl
+		<< "    --jit-after <n>  Interpret code until it has run n times, then use EVM JIT (default: off)." << endl
 #endif
 		;
 		exit(0);
@@ -172,6 +231,9 @@ void version()
 	cout << "eth network protocol version: " << dev::eth::c_protocolVersion << endl;
 	cout << "Client database version: " << dev::eth::c_databaseVersion << endl;
 	cout << "Build: " << DEV_QUOTED(ETH_BUILD_PLATFORM) << "/" << DEV_QUOTED(ETH_BUILD_TYPE) << endl;
+	cout << "CPU features: " << cpuFeatureNames(cpuFeatures()) << endl;
+	for (auto const& k: cpuKernels())
+		cout << "  " << k.first << ": " << k.second << endl;
 	exit(0);
 }
 
@@ -192,6 +254,28 @@ string pretty(h160 _a, dev::eth::State const& _st)
 	return ns;
 }
 
+/// Calls @a _f with the options of the DB named before a colon in @a _arg ("blocks", "extras" or "state"), or of each
+/// DB if there is none, and what follows it. @returns false if there is no such DB.
+bool tuneDBs(string const& _arg, function<void(DBOptions&, string const&)> const& _f)
+{
+	static const pair<char const*, DBRole> c_dbs[] = {
+		{ "blocks", DBRole::Blocks },
+		{ "extras", DBRole::Extras },
+		{ "state", DBRole::State }
+	};
+	auto colon = _arg.find(':');
+	for (auto const& d: c_dbs)
+		if (colon == string::npos || _arg.substr(0, colon) == d.first)
+		{
+			DBOptions o = Defaults::dbOptions(d.second);
+			_f(o, _arg.substr(colon == string::npos ? 0 : colon + 1));
+			Defaults::setDBOptions(d.second, o);
+			if (colon != string::npos)
+				return true;
+		}
+	return colon == string::npos;
+}
+
 bool g_exit = false;
 
 void sighandler(int)
@@ -199,12 +283,25 @@ void sighandler(int)
 	g_exit = true;
 }
 
+/// Levels of the state trie, about 16 times as many nodes each, and blocks whose called code a warm-up loads.
+static const unsigned c_warmStateLevels = 4;
+static const unsigned c_warmCodeBlocks = 256;
+
 enum class NodeMode
 {
 	PeerServer,
 	Full
 };
 
+/// What a headless node started with --server is for.
+enum class ServerRole
+{
+	None,
+	Sync,
+	RPC,
+	Miner
+};
+
 void doInitDAG(unsigned _n)
 {
 	BlockInfo bi;
@@ -214,11 +311,104 @@ void doInitDAG(unsigned _n)
 	exit(0);
 }
 
+/// Imports the blocks of @a _file straight into the chain at @a _dbPath, without the client's queue, watches and
+/// mining, and reports the rate. Proofs of work are checked only with @a _s of CheckEverything.
+int doBulkImport(string const& _file, string const& _dbPath, WithExisting _we, Strictness _s)
+{
+	MappedFile file(_file);
+	if (file.data().empty())
+	{
+		cerr << "Can't read " << _file << endl;
+		return -1;
+	}
+	VersionChecker vc(_dbPath);
+	WithExisting we = max(vc.action(), _we);
+	CanonBlockChain bc(_dbPath, we, [](unsigned d, unsigned t){ cerr << "REVISING BLOCKCHAIN: Processed " << d << " of " << t << "...\r"; });
+	State s(State::openDB(_dbPath, we), BaseState::CanonGenesis);
+	vc.setOk();
+
+	// An index, where the archive has one, skips what is already imported.
+	bytes index = contents(_file + ".index");
+	auto start = chrono::steady_clock::now();
+	BlockChain::BulkImport r;
+	bool ok = readBlockArchive(file.data(), [&](bytesConstRef _blocks)
+	{
+		auto b = bc.importBulk(_blocks, s.db(), _s);
+		r.imported += b.imported;
+		r.alreadyHave += b.alreadyHave;
+		r.gasUsed += b.gasUsed;
+		r.stopped = b.stopped;
+		return !r.stopped;
+	}, &index, bc.number() + 1);
+	if (!ok)
+		cerr << _file << " is malformed." << endl;
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout << r.imported << " imported, " << r.alreadyHave << " got" << (r.stopped ? ", stopped at a bad block" : "") << " in " << seconds << "s: "
+		<< (r.imported / seconds) << " blocks/s, " << (double(r.gasUsed) / seconds / 1000000) << " Mgas/s." << endl;
+	return r.stopped || !ok ? 1 : 0;
+}
+
+/// Writes the state after block @a _block, "latest", a number or a hash, of the chain at @a _dbPath to @a _dir.
+int doExportState(string const& _dir, string const& _dbPath, string const& _block)
+{
+	CanonBlockChain bc(_dbPath);
+	OverlayDB db = State::openDB(_dbPath);
+	h256 h = _block == "latest" ? bc.currentHash() : _block.size() >= 64 ? h256(_block) : bc.numberHash(atoi(_block.c_str()));
+	bytes block = bc.block(h);
+	if (block.empty())
+	{
+		cerr << "Unknown block " << _block << endl;
+		return -1;
+	}
+	BlockInfo bi(block);
+	if (!writeStateArchive(db, bi.stateRoot, RLP(block)[0].data().toBytes(), _dir))
+	{
+		cerr << "The state of #" << bi.number << " is not all in the state DB; it may have been pruned." << endl;
+		return -1;
+	}
+	cout << "State of #" << bi.number << " " << bi.hash() << " written to " << _dir << endl;
+	return 0;
+}
+
+/// Imports the state snapshot in @a _dir into the state DB at @a _dbPath. Its root is checked against the header in
+/// the snapshot, whose proof of work is verified and which must be of @a _trusted if that is given.
+int doImportState(string const& _dir, string const& _dbPath, h256 const& _trusted)
+{
+	bytes header = stateArchiveHeader(_dir);
+	BlockInfo bi;
+	try
+	{
+		bi.populateFromHeader(RLP(header), CheckEverything);
+	}
+	catch (Exception const& _e)
+	{
+		cerr << "No good header in " << _dir << ": " << diagnostic_information(_e) << endl;
+		return -1;
+	}
+	if (_trusted && bi.hash() != _trusted)
+	{
+		cerr << "Snapshot is of " << bi.hash() << " rather than " << _trusted << endl;
+		return -1;
+	}
+
+	OverlayDB db = State::openDB(_dbPath);
+	auto start = chrono::steady_clock::now();
+	if (!importStateArchive(_dir, db, bi.stateRoot))
+	{
+		cerr << "Snapshot in " << _dir << " is corrupt." << endl;
+		return 1;
+	}
+	cout << "Imported state of #" << bi.number << " " << bi.hash() << " in " << chrono::duration<double>(chrono::steady_clock::now() - start).count() << "s." << endl;
+	return 0;
+}
+
 enum class OperationMode
 {
 	Node,
 	Import,
 	Export,
+	ImportState,
+	ExportState,
 	DAGInit
 };
 
@@ -226,7 +416,8 @@ enum class Format
 {
 	Binary,
 	Hex,
-	Human
+	Human,
+	Snappy
 };
 
 int main(int argc, char** argv)
@@ -240,11 +431,16 @@ int main(int argc, char** argv)
 
 	/// File name for import/export.
 	string filename;
+	/// Whether a bulk import checks the blocks' proofs of work.
+	bool checkPow = true;
 
 	/// Hashes/numbers for export range.
 	string exportFrom = "1";
 	string exportTo = "latest";
 	Format exportFormat = Format::Binary;
+	unsigned exportShards = 1;
+	/// The block a state snapshot must be of, if known.
+	h256 trustedHash;
 
 	/// DAG initialisation param.
 	unsigned initDAG = 0;
@@ -252,12 +448,23 @@ int main(int argc, char** argv)
 	/// General params for Node operation
 	NodeMode nodeMode = NodeMode::Full;
 	bool interactive = false;
+	ServerRole server = ServerRole::None;
+	bool warmUp = false;
+	map<string, vector<unsigned>> cpuSets;
+	bool numaMiners = false;
 #if ETH_JSONRPC
 	int jsonrpc = -1;
+	bool jsonrpcStream = false;
+	unsigned jsonrpcThreads = 0;
+	int stratum = -1;
+	u256 shareDifficulty = 0;
+	string ipcPath;
+	size_t ipcRingSize = 64 * 1024 * 1024;
 #endif
 	bool upnp = true;
 	WithExisting killChain = WithExisting::Trust;
 	bool jit = false;
+	int jitAfter = -1;
 
 	/// Networking params.
 	string clientName;
@@ -267,17 +474,26 @@ int main(int argc, char** argv)
 	string remoteHost;
 	unsigned short remotePort = 30303;
 	unsigned peers = 5;
+	unsigned networkThreads = 0;
+	map<string, size_t> egressLimits;
+	string packetLogPath;
 	bool bootstrap = false;
 
 	/// Mining params
 	unsigned mining = ~(unsigned)0;
+	bool miningGiven = false;
 	int miners = -1;
 	bool forceMining = false;
-	KeyPair us = KeyPair::create();
+	bool fastSync = false;
+
+	/// Thread counts, 0 where left to the defaults or to --server.
+	unsigned importThreads = 0;	KeyPair us = KeyPair::create();
 	Address coinbase = us.address();
 
 	/// Structured logging params
 	bool structuredLogging = false;
+	bool vmProfile = false;
+	unsigned short metricsPort = 0;
 	string structuredLoggingFormat = "%Y-%m-%dT%H:%M:%S";
 
 	/// Transaction params
@@ -312,6 +528,20 @@ int main(int argc, char** argv)
 			mode = OperationMode::Import;
 			filename = argv[++i];
 		}
+		else if (arg == "--no-pow-check")
+			checkPow = false;
+		else if (arg == "--import-state" && i + 1 < argc)
+		{
+			mode = OperationMode::ImportState;
+			filename = argv[++i];
+		}
+		else if (arg == "--export-state" && i + 1 < argc)
+		{
+			mode = OperationMode::ExportState;
+			filename = argv[++i];
+		}
+		else if (arg == "--trusted-hash" && i + 1 < argc)
+			trustedHash = h256(argv[++i]);
 		else if ((arg == "-E" || arg == "--export") && i + 1 < argc)
 		{
 			mode = OperationMode::Export;
@@ -326,6 +556,8 @@ int main(int argc, char** argv)
 				exportFormat = Format::Hex;
 			else if (m == "human")
 				exportFormat = Format::Human;
+			else if (m == "snappy")
+				exportFormat = Format::Snappy;
 			else
 			{
 				cerr << "Bad " << arg << " option: " << m << endl;
@@ -338,6 +570,8 @@ int main(int argc, char** argv)
 			exportFrom = argv[++i];
 		else if (arg == "--only" && i + 1 < argc)
 			exportTo = exportFrom = argv[++i];
+		else if (arg == "--shards" && i + 1 < argc)
+			exportShards = max(1, atoi(argv[++i]));
 		else if ((arg == "-n" || arg == "--upnp") && i + 1 < argc)
 		{
 			string m = argv[++i];
@@ -378,8 +612,89 @@ int main(int argc, char** argv)
 			structuredLoggingFormat = string(argv[++i]);
 		else if (arg == "--structured-logging")
 			structuredLogging = true;
+		else if (arg == "--vm-profile")
+			vmProfile = true;
+		else if (arg == "--log-index")
+			Defaults::setLogIndex(true);
+		else if (arg == "--fast-sync")
+			fastSync = true;
+		else if (arg == "--import-threads" && i + 1 < argc)
+			importThreads = max(atoi(argv[++i]), 1);
+		else if (arg == "--prune" && i + 1 < argc)
+		{
+			string p = argv[++i];
+			auto colon = p.find(':');
+			Defaults::setPruning(atoi(p.substr(0, colon).c_str()), colon == string::npos ? 0 : atoi(p.substr(colon + 1).c_str()));
+		}
+		else if (arg == "--db" && i + 1 < argc)
+		{
+			try
+			{
+				DBBackend b = toDBBackend(argv[++i]);
+				tuneDBs("", [&](DBOptions& o, string const&) { o.backend = b; });
+			}
+			catch (...)
+			{
+				cerr << "Bad " << arg << " option: " << argv[i] << endl;
+				return -1;
+			}
+		}
+		else if (arg == "--db-profile" && i + 1 < argc)
+		{
+			try
+			{
+				Defaults::setDBProfile(toDBProfile(argv[++i]));
+			}
+			catch (...)
+			{
+				cerr << "Bad " << arg << " option: " << argv[i] << endl;
+				return -1;
+			}
+		}
+		else if ((arg == "--db-cache" || arg == "--db-write-buffer" || arg == "--db-bloom" || arg == "--db-open-files" || arg == "--db-compression") && i + 1 < argc)
+		{
+			bool ok = tuneDBs(argv[++i], [&](DBOptions& o, string const& v)
+			{
+				if (arg == "--db-cache")
+					o.blockCacheSize = (size_t)atoi(v.c_str()) * 1024 * 1024;
+				else if (arg == "--db-write-buffer")
+					o.writeBufferSize = (size_t)atoi(v.c_str()) * 1024 * 1024;
+				else if (arg == "--db-bloom")
+					o.bloomBitsPerKey = atoi(v.c_str());
+				else if (arg == "--db-open-files")
+					o.maxOpenFiles = atoi(v.c_str());
+				else
+					o.compression = isTrue(v);
+			});
+			if (!ok)
+			{
+				cerr << "Bad " << arg << " option: " << argv[i] << endl;
+				return -1;
+			}
+		}
+		else if (arg == "--chain-cache" && i + 1 < argc)
+			Defaults::setCacheSize((size_t)atoi(argv[++i]) * 1024 * 1024);
 		else if ((arg == "-d" || arg == "--path" || arg == "--db-path") && i + 1 < argc)
 			dbPath = argv[++i];
+		else if (arg == "--dag-huge-pages")
+			Ethasher::get()->setHugePages(true);
+		else if (arg == "--dag-numa" && i + 1 < argc)
+		{
+			string p = argv[++i];
+			if (p == "interleave")
+				Ethasher::get()->setDagPlacement(DagPlacement::Interleaved);
+			else if (p == "replicate")
+				Ethasher::get()->setDagPlacement(DagPlacement::Replicated);
+			else
+			{
+				cerr << "Bad " << arg << " option: " << p << endl;
+				return -1;
+			}
+		}
+		else if (arg == "--numa-miners")
+			numaMiners = true;
+		else if (arg == "--dag-verify")
+			Ethasher::get()->setFullVerification(true);
 		else if ((arg == "-D" || arg == "--create-dag") && i + 1 < argc)
 		{
 			string m = boost::to_lower_copy(string(argv[++i]));
@@ -448,6 +763,7 @@ int main(int argc, char** argv)
 		else if ((arg == "-m" || arg == "--mining") && i + 1 < argc)
 		{
 			string m = argv[++i];
+			miningGiven = true;
 			if (isTrue(m))
 				mining = ~(unsigned)0;
 			else if (isFalse(m))
@@ -467,16 +783,98 @@ int main(int argc, char** argv)
 			forceMining = true;
 		else if (arg == "-i" || arg == "--interactive")
 			interactive = true;
+		else if (arg == "--server" && i + 1 < argc)
+		{
+			string r = argv[++i];
+			if (r == "sync")
+				server = ServerRole::Sync;
+			else if (r == "rpc")
+				server = ServerRole::RPC;
+			else if (r == "miner")
+				server = ServerRole::Miner;
+			else
+			{
+				cerr << "Unknown server role: " << r << endl;
+				return -1;
+			}
+		}
+		else if (arg == "--cpus" && i + 1 < argc)
+		{
+			string c = argv[++i];
+			auto eq = c.find('=');
+			try
+			{
+				if (eq == string::npos || !eq)
+					BOOST_THROW_EXCEPTION(BadCpuSet());
+				cpuSets[c.substr(0, eq)] = parseCpuSet(c.substr(eq + 1));
+			}
+			catch (BadCpuSet const&)
+			{
+				cerr << "Bad CPU set: " << c << endl;
+				return -1;
+			}
+		}
+		else if (arg == "--warm-up")
+			warmUp = true;
 #if ETH_JSONRPC
 		else if ((arg == "-j" || arg == "--json-rpc"))
 			jsonrpc = jsonrpc == -1 ? SensibleHttpPort : jsonrpc;
 		else if (arg == "--json-rpc-port" && i + 1 < argc)
 			jsonrpc = atoi(argv[++i]);
+		else if (arg == "--json-rpc-stream")
+		{
+			jsonrpc = jsonrpc == -1 ? SensibleHttpPort : jsonrpc;
+			jsonrpcStream = true;
+		}
+		else if (arg == "--json-rpc-threads" && i + 1 < argc)
+			jsonrpcThreads = max(atoi(argv[++i]), 1);
+		else if (arg == "--stratum" && i + 1 < argc)
+			stratum = atoi(argv[++i]);
+		else if (arg == "--ipc")
+			ipcPath = i + 1 < argc && argv[i + 1][0] != '-' ? argv[++i] : getDataDir() + "/eth.ipc";
+		else if (arg == "--ipc-ring-size" && i + 1 < argc)
+			ipcRingSize = (size_t)atol(argv[++i]) * 1024 * 1024;
+		else if (arg == "--stratum-share-difficulty" && i + 1 < argc)
+			try
+			{
+				shareDifficulty = u256(argv[++i]);
+			}
+			catch (...)
+			{
+				cerr << "Bad " << arg << " option: " << argv[i] << endl;
+				return -1;
+			}
 #endif
 		else if ((arg == "-v" || arg == "--verbosity") && i + 1 < argc)
 			g_logVerbosity = atoi(argv[++i]);
+		else if (arg == "--log-async")
+			setAsyncLogging(true);
+		else if (arg == "--metrics-port" && i + 1 < argc)
+			metricsPort = (short)atoi(argv[++i]);
+		else if (arg == "--lock-profile" && i + 1 < argc)
+		{
+#if !ETH_LOCK_PROFILING
+			cerr << "Lock profiling isn't built in; rebuild with -DLOCK_PROFILING=ON." << endl;
+#endif
+			setLockProfileLogging(atoi(argv[++i]));
+		}
 		else if ((arg == "-x" || arg == "--peers") && i + 1 < argc)
 			peers = atoi(argv[++i]);
+		else if (arg == "--network-threads" && i + 1 < argc)
+			networkThreads = max(atoi(argv[++i]), 1);
+		else if (arg == "--egress-limit" && i + 1 < argc)
+		{
+			string l = argv[++i];
+			auto colon = l.find(':');
+			if (colon == string::npos)
+			{
+				cerr << "Bad " << arg << " option: " << l << endl;
+				return -1;
+			}
+			egressLimits[l.substr(0, colon)] = atoll(l.substr(colon + 1).c_str());
+		}
+		else if (arg == "--record-packets" && i + 1 < argc)
+			packetLogPath = argv[++i];
 		else if ((arg == "-t" || arg == "--miners") && i + 1 < argc)
 			miners = atoi(argv[++i]);
 		else if ((arg == "-o" || arg == "--mode") && i + 1 < argc)
@@ -499,6 +897,15 @@ int main(int argc, char** argv)
 #else
 			cerr << "EVM JIT not enabled" << endl;
 			return -1;
+#endif
+		}
+		else if (arg == "--jit-after" && i + 1 < argc)
+		{
+#if ETH_EVMJIT
+			jitAfter = atoi(argv[++i]);
+#else
+			cerr << "EVM JIT not enabled" << endl;
+			return -1;
 #endif
 		}
 		else if (arg == "-h" || arg == "--help")
@@ -526,20 +933,92 @@ int main(int argc, char** argv)
 	if (!clientName.empty())
 		clientName += "/";
 
+	for (auto const& c: cpuSets)
+		setThreadAffinity(c.first, c.second);
+	setThreadName("main");
+
+	// A server gives each subsystem the cores its role needs and the rest as little as works; what was set explicitly
+	// stands.
+	unsigned cores = max(thread::hardware_concurrency(), 2u);
+	unsigned verifierThreads = 0;
+	if (server != ServerRole::None)
+	{
+		if (interactive)
+			cerr << "--server runs headless; ignoring --interactive." << endl;
+		interactive = false;
+		warmUp = warmUp || server != ServerRole::Sync;
+		unsigned pool = 1;
+		switch (server)
+		{
+		case ServerRole::Sync:
+			networkThreads = networkThreads ? networkThreads : max(cores / 4, 1u);
+			importThreads = importThreads ? importThreads : max(cores / 2, 1u);
+			verifierThreads = max(cores / 4, 1u);
+			pool = max(cores / 4, 1u);
+			mining = miningGiven ? mining : 0;
+			break;
+		case ServerRole::RPC:
+#if ETH_JSONRPC
+			jsonrpcThreads = jsonrpcThreads ? jsonrpcThreads : cores;
+#endif
+			verifierThreads = 1;
+			pool = max(cores / 2, 1u);
+			mining = miningGiven ? mining : 0;
+			break;
+		case ServerRole::Miner:
+			verifierThreads = 1;
+			miners = miners >= 0 ? miners : cores - 1;
+			break;
+		case ServerRole::None:
+			break;
+		}
+		ThreadPool::setSharedSize(pool);
+	}
+	if (numaMiners)
+		spreadOverNumaNodes("miner-", miners >= 0 ? miners : thread::hardware_concurrency());
+	if (importThreads)
+		ParallelExecutor::setThreads(importThreads);
+#if ETH_JSONRPC
+	jsonrpcThreads = jsonrpcThreads ? jsonrpcThreads : SensibleHttpThreads;
+#endif
+
 	StructuredLogger::get().initialize(structuredLogging, structuredLoggingFormat);
-	VMFactory::setKind(jit ? VMKind::JIT : VMKind::Interpreter);
+	if (jitAfter >= 0)
+	{
+		AdaptiveVM::setPromotionThreshold(jitAfter);
+		VMFactory::setKind(VMKind::Adaptive);
+	}
+	else
+		VMFactory::setKind(jit ? VMKind::JIT : VMKind::Interpreter);
+	VMProfiler::get().setEnabled(vmProfile);
+
+	if (mode == OperationMode::Import && !filename.empty() && filename != "--")
+		return doBulkImport(filename, dbPath, killChain, checkPow ? CheckEverything : IgnoreNonce);
+	if (mode == OperationMode::ExportState)
+		return doExportState(filename, dbPath, exportTo);
+	if (mode == OperationMode::ImportState)
+		return doImportState(filename, dbPath, trustedHash);
+
 	auto netPrefs = publicIP.empty() ? NetworkPreferences(listenIP ,listenPort, upnp) : NetworkPreferences(publicIP, listenIP ,listenPort, upnp);
+	netPrefs.ioThreads = max(networkThreads, 1u);
+	netPrefs.egressLimits = egressLimits;
+	netPrefs.packetLogPath = packetLogPath;
+	netPrefs.peerStorePath = (dbPath.size() ? dbPath : getDataDir()) + "/peers";
 	auto nodesState = contents((dbPath.size() ? dbPath : getDataDir()) + "/network.rlp");
-	std::string clientImplString = "Ethereum(++)/" + clientName + "v" + dev::Version + "/" DEV_QUOTED(ETH_BUILD_TYPE) "/" DEV_QUOTED(ETH_BUILD_PLATFORM) + (jit ? "/JIT" : "");
+	std::string clientImplString = "Ethereum(++)/" + clientName + "v" + dev::Version + "/" DEV_QUOTED(ETH_BUILD_TYPE) "/" DEV_QUOTED(ETH_BUILD_PLATFORM) + (jit || jitAfter >= 0 ? "/JIT" : "");
 	dev::WebThreeDirect web3(
 		clientImplString,
 		dbPath,
 		killChain,
-		nodeMode == NodeMode::Full ? set<string>{"eth", "shh"} : set<string>(),
+		nodeMode == NodeMode::Full ? server != ServerRole::None ? set<string>{"eth"} : set<string>{"eth", "shh"} : set<string>(),
 		netPrefs,
 		&nodesState,
 		miners
 		);
+
+	unique_ptr<MetricsServer> metricsServer;
+	if (metricsPort)
+		metricsServer.reset(new MetricsServer(metricsPort));
 	
 	if (mode == OperationMode::DAGInit)
 		doInitDAG(web3.ethereum()->blockChain().number() + (initDAG == PendingBlock ? 30000 : 0));
@@ -559,6 +1038,19 @@ int main(int argc, char** argv)
 		}
 	};
 
+	if (mode == OperationMode::Export && !filename.empty() && filename != "--" && (exportFormat == Format::Binary || exportFormat == Format::Snappy))
+	{
+		// Archives, with an index of each file beside it, for the bulk importer.
+		auto& bc = web3.ethereum()->blockChain();
+		ArchiveFormat f = exportFormat == Format::Snappy ? ArchiveFormat::Snappy : ArchiveFormat::Binary;
+		unsigned from = toNumber(exportFrom);
+		unsigned to = toNumber(exportTo);
+		bool ok = exportShards > 1 ? writeBlockArchives(bc, from, to, filename, f, exportShards) : writeBlockArchive(bc, from, to, filename, f);
+		if (!ok)
+			cerr << "Can't write " << filename << endl;
+		return ok ? 0 : -1;
+	}
+
 	if (mode == OperationMode::Export)
 	{
 		ofstream fout(filename, std::ofstream::binary);
@@ -629,13 +1121,24 @@ int main(int argc, char** argv)
 	{
 		c->setGasPricer(gasPricer);
 		c->setForceMining(forceMining);
+		c->setFastSync(fastSync);
 		c->setAddress(coinbase);
+		if (verifierThreads)
+			c->setVerifierThreads(verifierThreads);
 	}
 
 	cout << "Transaction Signer: " << us.address() << endl;
 	cout << "Mining Benefactor: " << coinbase << endl;
 	web3.startNetwork();
 
+	if (warmUp && c)
+	{
+		// Before anything is served, so that neither the first requests nor the first blocks mined wait on the disk.
+		auto start = chrono::steady_clock::now();
+		auto w = c->warmUp(mining && miners != 0, c_warmStateLevels, c_warmCodeBlocks);
+		cout << "Warmed up " << w.first << " state nodes and " << w.second << " contracts in " << chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count() << "ms" << endl;
+	}
+
 	if (bootstrap)
 		web3.addNode(p2p::NodeId(), Host::pocHost());
 	if (remoteHost.size())
@@ -646,11 +1149,28 @@ int main(int argc, char** argv)
 	unique_ptr<jsonrpc::AbstractServerConnector> jsonrpcConnector;
 	if (jsonrpc > -1)
 	{
-		jsonrpcConnector = unique_ptr<jsonrpc::AbstractServerConnector>(new jsonrpc::HttpServer(jsonrpc, "", "", SensibleHttpThreads));
+		jsonrpcConnector = unique_ptr<jsonrpc::AbstractServerConnector>(jsonrpcStream ? (jsonrpc::AbstractServerConnector*)new StreamServer(jsonrpc) : new WebServer(jsonrpc, "0.0.0.0", jsonrpcThreads));
 		jsonrpcServer = shared_ptr<WebThreeStubServer>(new WebThreeStubServer(*jsonrpcConnector.get(), web3, vector<KeyPair>({us})));
 		jsonrpcServer->setIdentities({us});
+		if (jsonrpcStream)
+			static_cast<StreamServer*>(jsonrpcConnector.get())->setFace(jsonrpcServer.get());
 		jsonrpcServer->StartListening();
 	}
+	unique_ptr<StratumServer> stratumServer;
+	if (stratum > -1 && c)
+	{
+		stratumServer.reset(new StratumServer(*c, stratum));
+		stratumServer->setShareDifficulty(shareDifficulty);
+		stratumServer->start();
+	}
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+	unique_ptr<IpcServer> ipcServer;
+	if (!ipcPath.empty() && c)
+	{
+		ipcServer.reset(new IpcServer(*c, ipcPath, ipcRingSize));
+		ipcServer->start();
+	}
+#endif
 #endif
 
 	signal(SIGABRT, &sighandler);
@@ -771,9 +1291,11 @@ int main(int argc, char** argv)
 			{
 				if (jsonrpc < 0)
 					jsonrpc = SensibleHttpPort;
-				jsonrpcConnector = unique_ptr<jsonrpc::AbstractServerConnector>(new jsonrpc::HttpServer(jsonrpc, "", "", SensibleHttpThreads));
+				jsonrpcConnector = unique_ptr<jsonrpc::AbstractServerConnector>(jsonrpcStream ? (jsonrpc::AbstractServerConnector*)new StreamServer(jsonrpc) : new WebServer(jsonrpc, "0.0.0.0", jsonrpcThreads));
 				jsonrpcServer = shared_ptr<WebThreeStubServer>(new WebThreeStubServer(*jsonrpcConnector.get(), web3, vector<KeyPair>({us})));
 				jsonrpcServer->setIdentities({us});
+				if (jsonrpcStream)
+					static_cast<StreamServer*>(jsonrpcConnector.get())->setFace(jsonrpcServer.get());
 				jsonrpcServer->StartListening();
 			}
 			else if (cmd == "jsonstop")
@@ -796,6 +1318,12 @@ int main(int argc, char** argv)
 			{
 				cout << "Current block: " <<c->blockChain().details().number << endl;
 			}
+			else if (c && cmd == "dbstats")
+			{
+				cout << "blocks:" << endl << c->dbProperty(DBRole::Blocks, "stats") << endl;
+				cout << "extras:" << endl << c->dbProperty(DBRole::Extras, "stats") << endl;
+				cout << "state:" << endl << c->dbProperty(DBRole::State, "stats") << endl;
+			}
 			else if (cmd == "peers")
 			{
 				for (auto it: web3.peers())
@@ -1000,7 +1528,7 @@ int main(int argc, char** argv)
 				unsigned block;
 				unsigned index;
 				iss >> block >> index;
-				dev::eth::TransactionReceipt r = c->blockChain().receipts(c->blockChain().numberHash(block)).receipts[index];
+				dev::eth::TransactionReceipt r = c->blockChain().receipt(c->blockChain().numberHash(block), index);
 				auto rb = r.rlp();
 				cout << "RLP: " << RLP(rb) << endl;
 				cout << "Hex: " << toHex(rb) << endl;
@@ -1200,6 +1728,7 @@ int main(int argc, char** argv)
 		while (!g_exit)
 			this_thread::sleep_for(chrono::milliseconds(1000));
 
+	VMProfiler::get().log();
 	StructuredLogger::stopping(clientImplString, dev::Version);
 	auto netData = web3.saveNetwork();
 	if (!netData.empty())
@@ -0,0 +1,347 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file main.cpp
+ * @date 2015
+ * Drives a mix of JSON-RPC requests at a server, such as ethrpctest or eth -j, at a given rate, and reports their
+ * latencies and errors.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <json/json.h>
+#include <jsonrpccpp/client.h>
+#include <jsonrpccpp/client/connectors/httpclient.h>
+#include <libdevcore/CommonJS.h>
+#include <libdevcrypto/Common.h>
+#include <libethereum/Transaction.h>
+using namespace std;
+using namespace std::chrono;
+using namespace dev;
+using namespace dev::eth;
+
+void help()
+{
+	cout
+		<< "Usage ethrpcload [OPTIONS]" << endl
+		<< "Sends a mix of JSON-RPC requests to a server from several connections at once, and reports their latencies and errors." << endl
+		<< "With a rate, requests are due at even intervals, and each one's latency counts from when it was due, so time spent" << endl
+		<< "waiting for a free connection behind a slow server counts too." << endl
+		<< "Options:" << endl
+		<< "    -u,--url <url>  Send to the server at url (default: http://localhost:8080)." << endl
+		<< "    -m,--mix <mix>  Send methods in the proportions given, as call:1,balance:4,logs:1,block:3,send:1 (default: call:1,balance:4,logs:1,block:3)." << endl
+		<< "    -q,--qps <n>  Aim for n requests a second in all, or 0 to send as fast as the connections allow (default: 100)." << endl
+		<< "    -c,--concurrency <n>  Keep at most n requests under way, each on a connection of its own (default: 8)." << endl
+		<< "    -d,--duration <seconds>  Send requests for this long (default: 10)." << endl
+		<< "    --address <address>  Ask eth_getBalance and eth_call about this address; may be given more than once (default: eth_accounts)." << endl
+		<< "    --call-data <hex>  Send this data with eth_call (default: none)." << endl
+		<< "    --logs-blocks <n>  Ask eth_getLogs for the logs of the latest n blocks (default: 100)." << endl
+		<< "    --secret <hex>  Sign the transactions of eth_sendRawTransaction, sending nothing to itself, with this key; needed for send." << endl
+		<< "    -j,--json  Write the results as a JSON object rather than as text." << endl
+		<< "    -h,--help  Show this help message and exit." << endl
+		;
+	exit(0);
+}
+
+/// The methods the load mixes.
+enum class Method
+{
+	Call,
+	Balance,
+	Logs,
+	Block,
+	Send,
+	Count
+};
+
+static char const* const c_methodKeys[] = { "call", "balance", "logs", "block", "send" };
+static char const* const c_methodNames[] = { "eth_call", "eth_getBalance", "eth_getLogs", "eth_getBlockByNumber", "eth_sendRawTransaction" };
+
+/// What the requests of one method took, gathered by each connection and then together.
+struct MethodStats
+{
+	void merge(MethodStats const& _s)
+	{
+		latencies.insert(latencies.end(), _s.latencies.begin(), _s.latencies.end());
+		errors += _s.errors;
+		if (firstError.empty())
+			firstError = _s.firstError;
+	}
+
+	/// @returns the @a _p quantile of the latencies, in milliseconds; they must be sorted.
+	double quantile(double _p) const { return latencies.empty() ? 0 : latencies[min<size_t>(latencies.size() * _p, latencies.size() - 1)] * 1000; }
+
+	vector<double> latencies;		///< Of the requests answered without error, in seconds.
+	unsigned errors = 0;
+	string firstError;
+};
+
+/// What the requests are about, found before the load begins.
+struct LoadTarget
+{
+	vector<string> addresses;
+	string callData = "0x";
+	unsigned head = 0;
+	unsigned logsBlocks = 100;
+	Secret secret;
+	u256 gasPrice;
+	atomic<uint64_t> nonce{0};
+};
+
+/// @returns the parameters of a request of @a _m, varied by @a _rng.
+static Json::Value params(Method _m, LoadTarget& _t, mt19937& _rng)
+{
+	Json::Value p(Json::arrayValue);
+	string const& address = _t.addresses[_rng() % _t.addresses.size()];
+	switch (_m)
+	{
+	case Method::Call:
+	{
+		Json::Value call;
+		call["to"] = address;
+		call["data"] = _t.callData;
+		p.append(call);
+		p.append("latest");
+		break;
+	}
+	case Method::Balance:
+		p.append(address);
+		p.append("latest");
+		break;
+	case Method::Logs:
+	{
+		Json::Value filter;
+		filter["fromBlock"] = toJS(u256(_t.head > _t.logsBlocks ? _t.head - _t.logsBlocks : 0));
+		filter["toBlock"] = "latest";
+		p.append(filter);
+		break;
+	}
+	case Method::Block:
+		p.append(toJS(u256(_rng() % (_t.head + 1))));
+		p.append(false);
+		break;
+	case Method::Send:
+	{
+		Address self = toAddress(_t.secret);
+		Transaction t(0, _t.gasPrice, 21000, self, bytes(), _t.nonce++, _t.secret);
+		p.append(toJS(t.rlp()));
+		break;
+	}
+	default:;
+	}
+	return p;
+}
+
+int main(int argc, char** argv)
+{
+	string url = "http://localhost:8080";
+	vector<unsigned> weights = { 1, 4, 1, 3, 0 };
+	double qps = 100;
+	unsigned concurrency = 8;
+	double duration = 10;
+	LoadTarget target;
+	bool json = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-h" || arg == "--help")
+			help();
+		else if ((arg == "-u" || arg == "--url") && i + 1 < argc)
+			url = argv[++i];
+		else if ((arg == "-m" || arg == "--mix") && i + 1 < argc)
+		{
+			weights.assign((unsigned)Method::Count, 0);
+			string mix = argv[++i];
+			for (size_t b = 0; b < mix.size();)
+			{
+				size_t e = min(mix.find(',', b), mix.size());
+				string item = mix.substr(b, e - b);
+				auto colon = item.find(':');
+				auto key = find(begin(c_methodKeys), end(c_methodKeys), item.substr(0, colon));
+				if (colon == string::npos || key == end(c_methodKeys))
+				{
+					cerr << "Bad " << arg << " option: " << item << endl;
+					return -1;
+				}
+				weights[key - begin(c_methodKeys)] = atoi(item.substr(colon + 1).c_str());
+				b = e + 1;
+			}
+		}
+		else if ((arg == "-q" || arg == "--qps") && i + 1 < argc)
+			qps = max(atof(argv[++i]), 0.0);
+		else if ((arg == "-c" || arg == "--concurrency") && i + 1 < argc)
+			concurrency = max(atoi(argv[++i]), 1);
+		else if ((arg == "-d" || arg == "--duration") && i + 1 < argc)
+			duration = max(atof(argv[++i]), 0.0);
+		else if (arg == "--address" && i + 1 < argc)
+			target.addresses.push_back(argv[++i]);
+		else if (arg == "--call-data" && i + 1 < argc)
+			target.callData = argv[++i];
+		else if (arg == "--logs-blocks" && i + 1 < argc)
+			target.logsBlocks = atoi(argv[++i]);
+		else if (arg == "--secret" && i + 1 < argc)
+			target.secret = Secret(fromHex(argv[++i]));
+		else if (arg == "-j" || arg == "--json")
+			json = true;
+		else
+		{
+			cerr << "Invalid argument: " << arg << endl;
+			return -1;
+		}
+	}
+	unsigned totalWeight = 0;
+	for (auto w: weights)
+		totalWeight += w;
+	if (!totalWeight)
+	{
+		cerr << "Nothing in the mix." << endl;
+		return -1;
+	}
+	if (weights[(unsigned)Method::Send] && !target.secret)
+	{
+		cerr << "Sending transactions needs --secret." << endl;
+		return -1;
+	}
+
+	try
+	{
+		jsonrpc::HttpClient connector(url);
+		jsonrpc::Client client(connector);
+		target.head = jsToInt(client.CallMethod("eth_blockNumber", Json::Value(Json::nullValue)).asString());
+		if (target.addresses.empty())
+			for (auto const& a: client.CallMethod("eth_accounts", Json::Value(Json::nullValue)))
+				target.addresses.push_back(a.asString());
+		if (target.addresses.empty())
+			target.addresses.push_back(toJS(Address()));
+		if (target.secret)
+		{
+			Json::Value p(Json::arrayValue);
+			p.append(toJS(toAddress(target.secret)));
+			p.append("pending");
+			target.nonce = (uint64_t)jsToU256(client.CallMethod("eth_getTransactionCount", p).asString());
+			target.gasPrice = jsToU256(client.CallMethod("eth_gasPrice", Json::Value(Json::nullValue)).asString());
+		}
+	}
+	catch (jsonrpc::JsonRpcException const& _e)
+	{
+		cerr << "Couldn't ask " << url << " what to send: " << _e.what() << endl;
+		return -1;
+	}
+
+	// Each connection takes the next request due, waits until it is, and keeps what it took to itself until done.
+	atomic<uint64_t> next{0};
+	auto start = steady_clock::now();
+	auto end = start + duration_cast<steady_clock::duration>(std::chrono::duration<double>(duration));
+	auto interval = qps ? duration_cast<steady_clock::duration>(std::chrono::duration<double>(1 / qps)) : steady_clock::duration::zero();
+	vector<vector<MethodStats>> stats(concurrency, vector<MethodStats>((unsigned)Method::Count));
+	vector<thread> connections;
+	for (unsigned c = 0; c < concurrency; ++c)
+		connections.push_back(thread([&, c]()
+		{
+			jsonrpc::HttpClient connector(url);
+			jsonrpc::Client client(connector);
+			mt19937 rng(c);
+			while (true)
+			{
+				uint64_t n = next++;
+				steady_clock::time_point due = qps ? start + interval * (int64_t)n : steady_clock::now();
+				if (due >= end)
+					break;
+				this_thread::sleep_until(due);
+
+				unsigned w = rng() % totalWeight;
+				unsigned m = 0;
+				for (; w >= weights[m]; ++m)
+					w -= weights[m];
+				MethodStats& s = stats[c][m];
+				try
+				{
+					client.CallMethod(c_methodNames[m], params((Method)m, target, rng));
+					s.latencies.push_back(std::chrono::duration<double>(steady_clock::now() - due).count());
+				}
+				catch (jsonrpc::JsonRpcException const& _e)
+				{
+					if (!s.errors++)
+						s.firstError = _e.what();
+				}
+			}
+		}));
+	for (auto& t: connections)
+		t.join();
+	double seconds = std::chrono::duration<double>(steady_clock::now() - start).count();
+
+	MethodStats all;
+	vector<MethodStats> methods((unsigned)Method::Count);
+	for (unsigned m = 0; m < methods.size(); ++m)
+	{
+		for (auto const& c: stats)
+			methods[m].merge(c[m]);
+		all.merge(methods[m]);
+		sort(methods[m].latencies.begin(), methods[m].latencies.end());
+	}
+	sort(all.latencies.begin(), all.latencies.end());
+	double achieved = seconds ? (all.latencies.size() + all.errors) / seconds : 0;
+
+	if (json)
+	{
+		auto report = [](MethodStats const& _s)
+		{
+			Json::Value r;
+			r["requests"] = (unsigned)_s.latencies.size() + _s.errors;
+			r["errors"] = _s.errors;
+			r["p50_ms"] = _s.quantile(0.5);
+			r["p99_ms"] = _s.quantile(0.99);
+			r["p999_ms"] = _s.quantile(0.999);
+			r["max_ms"] = _s.latencies.empty() ? 0 : _s.latencies.back() * 1000;
+			if (!_s.firstError.empty())
+				r["first_error"] = _s.firstError;
+			return r;
+		};
+		Json::Value o;
+		o["url"] = url;
+		o["target_qps"] = qps;
+		o["achieved_qps"] = achieved;
+		o["concurrency"] = concurrency;
+		o["seconds"] = seconds;
+		o["all"] = report(all);
+		for (unsigned m = 0; m < methods.size(); ++m)
+			if (weights[m])
+				o["methods"][c_methodNames[m]] = report(methods[m]);
+		cout << Json::StyledWriter().write(o);
+	}
+	else
+	{
+		cout << achieved << " requests/s of " << (qps ? toString(qps) : "unlimited") << " over " << seconds << " s, " << concurrency << " connections; latencies in ms" << endl
+			<< "method\trequests\terrors\tp50\tp99\tp999\tmax" << endl;
+		auto report = [](string const& _name, MethodStats const& _s)
+		{
+			cout << _name << "\t" << _s.latencies.size() + _s.errors << "\t" << _s.errors << "\t" << _s.quantile(0.5) << "\t" << _s.quantile(0.99) << "\t" << _s.quantile(0.999) << "\t" << (_s.latencies.empty() ? 0 : _s.latencies.back() * 1000) << endl;
+		};
+		for (unsigned m = 0; m < methods.size(); ++m)
+			if (weights[m])
+				report(c_methodNames[m], methods[m]);
+		report("all", all);
+		for (unsigned m = 0; m < methods.size(); ++m)
+			if (!methods[m].firstError.empty())
+				cout << c_methodNames[m] << " first failed: " << methods[m].firstError << endl;
+	}
+	return all.errors ? 1 : 0;
+}
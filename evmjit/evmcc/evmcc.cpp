@@ -1,5 +1,6 @@
 
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <ostream>
@@ -18,6 +19,8 @@
 #include <libdevcore/CommonIO.h>
 #include <libevmcore/Instruction.h>
 #include <libevm/ExtVMFace.h>
+#include <libethereum/State.h>
+#include <evmjit/libevmjit-cpp/Utils.h>
 #include <evmjit/libevmjit/Compiler.h>
 #include <evmjit/libevmjit/ExecutionEngine.h>
 
@@ -33,6 +36,9 @@ void parseProgramOptions(int _argc, char** _argv, boost::program_options::variab
 		("interpret,i", "compile the code to LLVM IR and execute")
 		("gas,g", opt::value<size_t>(), "set initial gas for execution")
 		("disassemble,d", "dissassemble the code")
+		("aot", "compile ahead of time the code of each hash listed in the input file into the object cache")
+		("db", opt::value<std::string>(), "chain database directory to read the code of --aot from (default: the client's)")
+		("cache-dir", opt::value<std::string>(), "object cache directory to write --aot objects to (default: EVMJIT's)")
 		("dump-cfg", "dump control flow graph to graphviz file")
 		("dont-optimize", "turn off optimizations")
 		("optimize-stack", "optimize stack use between basic blocks (default: on)")
@@ -69,9 +75,10 @@ void parseProgramOptions(int _argc, char** _argv, boost::program_options::variab
 
 	if (_varMap.count("disassemble") == 0
 		&& _varMap.count("compile") == 0
-		&& _varMap.count("interpret") == 0)
+		&& _varMap.count("interpret") == 0
+		&& _varMap.count("aot") == 0)
 	{
-		errorMsg = "at least one of -c, -i, -d is required";
+		errorMsg = "at least one of -c, -i, -d, --aot is required";
 	}
 
 	if (errorMsg || _varMap.count("help"))
@@ -85,6 +92,43 @@ void parseProgramOptions(int _argc, char** _argv, boost::program_options::variab
 	}
 }
 
+/// Compiles the code of each hash listed, one per line, in @a _list into the object cache. A node whose EVMJIT
+/// options include -cache=p then starts with all of it loaded, without compiling anything. The list may come
+/// from the hot spots of the VM profiler.
+/// @returns the number of pieces of code that could not be compiled.
+int compileAheadOfTime(std::istream& _list, std::string const& _dbPath, bool _verbose)
+{
+	using namespace dev;
+	auto db = eth::State::openDB(_dbPath);
+	int failures = 0;
+	std::string line;
+	while (std::getline(_list, line))
+	{
+		boost::algorithm::trim(line);
+		if (line.empty() || line[0] == '#')
+			continue;
+		h256 hash(line);
+		bytes code = asBytes(db.lookup(hash));
+		if (code.empty())
+		{
+			std::cerr << "no code with hash " << line << std::endl;
+			++failures;
+			continue;
+		}
+		auto startTime = std::chrono::high_resolution_clock::now();
+		if (!eth::jit::ExecutionEngine::precompile(code.data(), code.size(), eth::eth2llvm(u256(hash))))
+		{
+			std::cerr << "cannot compile " << line << std::endl;
+			++failures;
+		}
+		else if (_verbose)
+			std::cerr << line << ": " << code.size() << " bytes compiled in "
+					  << std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - startTime).count()
+					  << " ms" << std::endl;
+	}
+	return failures;
+}
+
 int main(int argc, char** argv)
 {
 	llvm::sys::PrintStackTraceOnErrorSignal();
@@ -101,6 +145,19 @@ int main(int argc, char** argv)
 		exit(1);
 	}
 
+	if (options.count("aot"))
+	{
+		if (options.count("cache-dir"))
+		{
+			// ExecutionEngine takes its options from the environment only.
+			auto envLine = std::getenv("EVMJIT");
+			auto jitOptions = std::string(envLine ? envLine : "") + " -cache-dir=" + options["cache-dir"].as<std::string>();
+			setenv("EVMJIT", jitOptions.c_str(), 1);
+		}
+		auto dbPath = options.count("db") ? options["db"].as<std::string>() : std::string();
+		return compileAheadOfTime(ifs, dbPath, options.count("verbose") > 0) ? 1 : 0;
+	}
+
 	std::string src((std::istreambuf_iterator<char>(ifs)),
 					(std::istreambuf_iterator<char>()));
 
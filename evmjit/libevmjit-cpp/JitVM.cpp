@@ -3,11 +3,15 @@
 
 #include "JitVM.h"
 
+#include <mutex>
 #include <libdevcore/Log.h>
+#include <libdevcore/Metrics.h>
 #include <libdevcrypto/SHA3.h>
 #include <libevm/VM.h>
 #include <libevm/VMFactory.h>
+#include <libevm/AdaptiveVM.h>
 #include <evmjit/libevmjit/ExecutionEngine.h>
+#include <evmjit/libevmjit/ExecStats.h>
 
 #include "Utils.h"
 
@@ -18,6 +22,47 @@ namespace eth
 
 extern "C" void env_sload(); // fake declaration for linker symbol stripping workaround, see a call below
 
+namespace
+{
+
+/// Reports the phases of the JIT's runs, where their code came from and its compilation queue to the process's
+/// Metrics. Phases are not labelled by code hash, as there would be a series for each contract ever run; the
+/// VMProfiler breaks costs down by code.
+void watchJitMetrics()
+{
+	using namespace jit;
+	static const std::pair<ExecState, char const*> c_phases[] = {
+		{ ExecState::CacheLoad, "cache_load" },
+		{ ExecState::Compilation, "compilation" },
+		{ ExecState::Optimization, "optimization" },
+		{ ExecState::CodeGen, "codegen" },
+		{ ExecState::Execution, "execution" }
+	};
+	static const char* const c_sources[] = { "memory", "object_cache", "compiled", "queued" };
+
+	auto& m = Metrics::get();
+	std::vector<MetricHistogram*> phases;
+	for (auto const& p: c_phases)
+		phases.push_back(&m.histogram("eth_jit_phase_seconds", "Time the EVM JIT spends in each phase of a run.", std::string("phase=\"") + p.second + "\""));
+	std::vector<MetricCounter*> sources;
+	for (auto s: c_sources)
+		sources.push_back(&m.counter("eth_jit_runs_total", "Runs of the EVM JIT, by where their code came from; those from memory or the object cache are cache hits.", std::string("source=\"") + s + "\""));
+	m.watch("eth_jit_compile_queue", "Pieces of code queued for, or in, background compilation by the EVM JIT.", "", []() { return ExecutionEngine::compileQueueDepth(); });
+
+	ExecutionEngine::setStatsHandler([=](ExecStats const& _stats)
+	{
+		sources[(size_t)_stats.source]->inc();
+		for (size_t i = 0; i < phases.size(); ++i)
+		{
+			auto time = _stats.time[(int)c_phases[i].first];
+			if (time != ExecStats::duration::zero())
+				phases[i]->observe(std::chrono::duration<double>(time).count());
+		}
+	});
+}
+
+}
+
 bytesConstRef JitVM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _step)
 {
 	using namespace jit;
@@ -32,12 +77,7 @@ bytesConstRef JitVM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _step)
 	if (rejected)
 	{
 		cwarn << "Execution rejected by EVM JIT (gas limit: " << m_gas << "), executing with interpreter";
-		VMFactory::setKind(VMKind::Interpreter);
-		m_fallbackVM = VMFactory::create(m_gas);
-		VMFactory::setKind(VMKind::JIT);
-		auto&& output = m_fallbackVM->go(_ext, _onOp, _step);
-		m_gas = m_fallbackVM->gas(); // copy remaining gas, Executive expects it
-		return output;
+		return fallback(_ext, _onOp, _step);
 	}
 
 	m_data.gas 			= static_cast<decltype(m_data.gas)>(m_gas);
@@ -53,9 +93,12 @@ bytesConstRef JitVM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _step)
 	m_data.gasLimit     = eth2llvm(_ext.currentBlock.gasLimit);
 	m_data.number 		= static_cast<decltype(m_data.number)>(_ext.currentBlock.number);
 	m_data.timestamp 	= static_cast<decltype(m_data.timestamp)>(_ext.currentBlock.timestamp);
-	m_data.code     	= _ext.code.data();
-	m_data.codeSize 	= _ext.code.size();
-	m_data.codeHash		= eth2llvm(sha3(_ext.code));
+	m_data.code     	= _ext.code->data();
+	m_data.codeSize 	= _ext.code->size();
+	m_data.codeHash		= eth2llvm(_ext.codeHash ? _ext.codeHash : sha3(*_ext.code));
+
+	static std::once_flag s_watchMetrics;
+	std::call_once(s_watchMetrics, watchJitMetrics);
 
 	auto env = reinterpret_cast<Env*>(&_ext);
 	auto exitCode = m_engine.run(&m_data, env);
@@ -73,6 +116,15 @@ bytesConstRef JitVM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _step)
 		BOOST_THROW_EXCEPTION(StackUnderflow());
 	case ReturnCode::BadInstruction:
 		BOOST_THROW_EXCEPTION(BadInstruction());
+	case ReturnCode::Rejected:			// code is still being compiled in the background
+		return fallback(_ext, _onOp, _step);
+	case ReturnCode::LLVMConfigError:
+	case ReturnCode::LLVMCompileError:
+	case ReturnCode::LLVMLinkError:		// nothing has been executed yet
+		cwarn << "EVM JIT failed to compile code, executing with interpreter";
+		if (_ext.codeHash)
+			AdaptiveVM::demote(_ext.codeHash);
+		return fallback(_ext, _onOp, _step);
 	case ReturnCode::LinkerWorkaround:	// never happens
 		env_sload();					// but forces linker to include env_* JIT callback functions
 		break;
@@ -84,5 +136,13 @@ bytesConstRef JitVM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _step)
 	return {std::get<0>(m_engine.returnData), std::get<1>(m_engine.returnData)};
 }
 
+bytesConstRef JitVM::fallback(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _step)
+{
+	m_fallbackVM = VMFactory::create(VMKind::Interpreter, m_gas);
+	auto&& output = m_fallbackVM->go(_ext, _onOp, _step);
+	m_gas = m_fallbackVM->gas(); // copy remaining gas, Executive expects it
+	return output;
+}
+
 }
 }
@@ -10,12 +10,19 @@ namespace eth
 
 class JitVM: public VMFace
 {
+public:
 	virtual bytesConstRef go(ExtVMFace& _ext, OnOpFunc const& _onOp = {}, uint64_t _steps = (uint64_t)-1) override final;
 
+	/// @returns true if the last go() was handed to the interpreter rather than run natively.
+	bool interpreted() const { return !!m_fallbackVM; }
+
 private:
 	friend class VMFactory;
 	explicit JitVM(u256 _gas = 0) : VMFace(_gas) {}
 
+	/// Executes with the interpreter, for requests the JIT rejected or code it has not compiled yet.
+	bytesConstRef fallback(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _step);
+
 	jit::RuntimeData m_data;
 	jit::ExecutionEngine m_engine;
 	std::unique_ptr<VMFace> m_fallbackVM; ///< VM used in case of input data rejected by JIT
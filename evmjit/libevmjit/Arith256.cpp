@@ -10,6 +10,7 @@
 #include "Type.h"
 #include "Endianness.h"
 #include "Utils.h"
+#include "Arith256Kernels.h"
 
 namespace dev
 {
@@ -32,6 +33,45 @@ void Arith256::debug(llvm::Value* _value, char _c)
 	createCall(m_debug, {m_builder.CreateZExtOrTrunc(_value, Type::Word), m_builder.getInt8(_c)});
 }
 
+llvm::Function* Arith256::createNativeFunc(char const* _name, unsigned _numArgs, unsigned _numResults)
+{
+	std::vector<llvm::Type*> argTypes(_numArgs, Type::Word);
+	std::vector<llvm::Type*> resultTypes(_numResults, Type::Word);
+	llvm::Type* retType = _numResults == 1 ? Type::Word : llvm::StructType::get(m_builder.getContext(), resultTypes);
+	auto func = llvm::Function::Create(llvm::FunctionType::get(retType, argTypes, false), llvm::Function::PrivateLinkage, _name, getModule());
+	func->setDoesNotThrow();
+	func->setDoesNotAccessMemory();
+
+	std::vector<llvm::Type*> kernelArgTypes(_numArgs + _numResults, Type::WordPtr);
+	auto kernelName = std::string{"arith_"} + _name;
+	auto kernel = llvm::Function::Create(llvm::FunctionType::get(Type::Void, kernelArgTypes, false), llvm::Function::ExternalLinkage, kernelName, getModule());
+	kernel->setDoesNotThrow();
+
+	InsertPointGuard guard{m_builder};
+	auto bb = llvm::BasicBlock::Create(m_builder.getContext(), {}, func);
+	m_builder.SetInsertPoint(bb);
+
+	std::vector<llvm::Value*> kernelArgs;
+	for (auto& arg : func->getArgumentList())
+	{
+		auto p = m_builder.CreateAlloca(Type::Word);
+		m_builder.CreateStore(&arg, p);
+		kernelArgs.push_back(p);
+	}
+	for (unsigned i = 0; i < _numResults; ++i)
+		kernelArgs.push_back(m_builder.CreateAlloca(Type::Word));
+	m_builder.CreateCall(kernel, kernelArgs);
+
+	llvm::Value* ret = llvm::UndefValue::get(retType);
+	for (unsigned i = 0; i < _numResults; ++i)
+	{
+		auto r = m_builder.CreateLoad(kernelArgs[_numArgs + i]);
+		ret = _numResults == 1 ? r : m_builder.CreateInsertValue(ret, r, i);
+	}
+	m_builder.CreateRet(ret);
+	return func;
+}
+
 llvm::Function* Arith256::getMulFunc()
 {
 	auto& func = m_mul;
@@ -130,6 +170,11 @@ llvm::Function* Arith256::getDivFunc(llvm::Type* _type)
 {
 	auto& func = _type == Type::Word ? m_div : m_div512;
 
+#if EVMJIT_NATIVE_ARITH
+	if (!func && _type == Type::Word)
+		func = createNativeFunc("divmod", 2, 2);
+#endif
+
 	if (!func)
 	{
 		// Based of "Improved shift divisor algorithm" from "Software Integer Division" by Microsoft Research
@@ -228,6 +273,11 @@ llvm::Function* Arith256::getDivFunc(llvm::Type* _type)
 
 llvm::Function* Arith256::getExpFunc()
 {
+#if EVMJIT_NATIVE_ARITH
+	if (!m_exp)
+		m_exp = createNativeFunc("exp", 2, 1);
+#endif
+
 	if (!m_exp)
 	{
 		llvm::Type* argTypes[] = {Type::Word, Type::Word};
@@ -297,6 +347,11 @@ llvm::Function* Arith256::getExpFunc()
 
 llvm::Function* Arith256::getAddModFunc()
 {
+#if EVMJIT_NATIVE_ARITH
+	if (!m_addmod)
+		m_addmod = createNativeFunc("addmod", 3, 1);
+#endif
+
 	if (!m_addmod)
 	{
 		auto i512Ty = m_builder.getIntNTy(512);
@@ -329,6 +384,11 @@ llvm::Function* Arith256::getAddModFunc()
 
 llvm::Function* Arith256::getMulModFunc()
 {
+#if EVMJIT_NATIVE_ARITH
+	if (!m_mulmod)
+		m_mulmod = createNativeFunc("mulmod", 3, 1);
+#endif
+
 	if (!m_mulmod)
 	{
 		llvm::Type* argTypes[] = {Type::Word, Type::Word, Type::Word};
@@ -510,4 +570,29 @@ extern "C"
 		DLOG(JIT) << "DEBUG " << std::dec << z << ": " //<< d << c << b << a
 				<< " ["	<< std::hex << std::setfill('0') << std::setw(16) << d << std::setw(16) << c << std::setw(16) << b << std::setw(16) << a << "]\n";
 	}
+
+#if EVMJIT_NATIVE_ARITH
+	// Native kernels called by the code generated in Arith256. i256 is stored as little-endian 64-bit words.
+	using namespace dev::eth::jit;
+
+	EXPORT void arith_divmod(i256 const* _x, i256 const* _y, i256* o_q, i256* o_r)
+	{
+		arith::divmod(&_x->a, 4, &_y->a, &o_q->a, &o_r->a);
+	}
+
+	EXPORT void arith_exp(i256 const* _b, i256 const* _e, i256* o_r)
+	{
+		arith::exp(&_b->a, &_e->a, &o_r->a);
+	}
+
+	EXPORT void arith_addmod(i256 const* _x, i256 const* _y, i256 const* _m, i256* o_r)
+	{
+		arith::addmod(&_x->a, &_y->a, &_m->a, &o_r->a);
+	}
+
+	EXPORT void arith_mulmod(i256 const* _x, i256 const* _y, i256 const* _m, i256* o_r)
+	{
+		arith::mulmod(&_x->a, &_y->a, &_m->a, &o_r->a);
+	}
+#endif
 }
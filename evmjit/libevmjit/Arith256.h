@@ -31,6 +31,10 @@ private:
 	llvm::Function* getAddModFunc();
 	llvm::Function* getMulModFunc();
 
+	/// Creates a private wrapper taking and returning words by value that calls the native kernel @a _name.
+	/// The kernel takes pointers to @a _numArgs arguments followed by @a _numResults results.
+	llvm::Function* createNativeFunc(char const* _name, unsigned _numArgs, unsigned _numResults);
+
 	llvm::Function* m_mul = nullptr;
 	llvm::Function* m_mul512 = nullptr;
 	llvm::Function* m_div = nullptr;
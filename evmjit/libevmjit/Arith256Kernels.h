@@ -0,0 +1,270 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// The kernels need a 64 x 64 -> 128 bit multiply, which is available wherever the compiler has a 128-bit integer.
+#if !defined(EVMJIT_NATIVE_ARITH) && defined(__SIZEOF_INT128__)
+#define EVMJIT_NATIVE_ARITH 1
+#endif
+
+#if EVMJIT_NATIVE_ARITH
+
+// Variants built for BMI2 (mulx) are picked at runtime on x86-64.
+#if defined(__x86_64__) && defined(__GNUC__)
+#define EVMJIT_ARITH_DISPATCH 1
+#define EVMJIT_ARITH_INLINE inline __attribute__((always_inline))
+#else
+#define EVMJIT_ARITH_INLINE inline
+#endif
+
+namespace dev
+{
+namespace eth
+{
+namespace jit
+{
+/// Native kernels for 256-bit arithmetic, shared by the JIT runtime and the interpreter.
+/// Numbers are arrays of 64-bit words, least significant first. Division by zero gives zero.
+namespace arith
+{
+
+__extension__ typedef unsigned __int128 uint128;
+
+/// @returns the number of significant words of the @a _n words at @a _x.
+inline unsigned words(uint64_t const* _x, unsigned _n)
+{
+	while (_n && !_x[_n - 1])
+		--_n;
+	return _n;
+}
+
+/// Divides the 128-bit number _hi:_lo by @a _d; the quotient must fit in 64 bits, i.e. _hi < _d.
+inline uint64_t div128(uint64_t _hi, uint64_t _lo, uint64_t _d, uint64_t& o_r)
+{
+#if defined(__x86_64__) && defined(__GNUC__)
+	uint64_t q;
+	__asm__("divq %4" : "=a"(q), "=d"(o_r) : "a"(_lo), "d"(_hi), "rm"(_d));
+	return q;
+#else
+	uint128 n = ((uint128)_hi << 64) | _lo;
+	o_r = (uint64_t)(n % _d);
+	return (uint64_t)(n / _d);
+#endif
+}
+
+/// o_r[0..7] = _x * _y
+EVMJIT_ARITH_INLINE void mul512Impl(uint64_t const* _x, uint64_t const* _y, uint64_t* o_r)
+{
+	uint64_t r[8] = {};
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		uint64_t carry = 0;
+		for (unsigned j = 0; j < 4; ++j)
+		{
+			uint128 t = (uint128)_x[i] * _y[j] + r[i + j] + carry;
+			r[i + j] = (uint64_t)t;
+			carry = (uint64_t)(t >> 64);
+		}
+		r[i + 4] = carry;
+	}
+	std::memcpy(o_r, r, sizeof(r));
+}
+
+/// o_r[0..3] = _x * _y mod 2^256
+EVMJIT_ARITH_INLINE void mul256Impl(uint64_t const* _x, uint64_t const* _y, uint64_t* o_r)
+{
+	uint64_t r[4] = {};
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		uint64_t carry = 0;
+		for (unsigned j = 0; i + j < 4; ++j)
+		{
+			uint128 t = (uint128)_x[i] * _y[j] + r[i + j] + carry;
+			r[i + j] = (uint64_t)t;
+			carry = (uint64_t)(t >> 64);
+		}
+	}
+	std::memcpy(o_r, r, sizeof(r));
+}
+
+/// Divides the @a _xn words at @a _x by the 4 words at @a _y (Knuth's algorithm D).
+/// o_q gets @a _xn words of quotient (may be null), o_r 4 words of remainder.
+inline void divmod(uint64_t const* _x, unsigned _xn, uint64_t const* _y, uint64_t* o_q, uint64_t* o_r)
+{
+	unsigned m = words(_x, _xn);
+	unsigned n = words(_y, 4);
+	uint64_t q[8] = {};
+	uint64_t r[4] = {};
+
+	if (!n)
+	{}	// Division by zero
+	else if (m < n)
+		std::memcpy(r, _x, m * sizeof(uint64_t));
+	else if (n == 1)
+	{
+		uint64_t rem = 0;
+		for (unsigned i = m; i--;)
+			q[i] = div128(rem, _x[i], _y[0], rem);
+		r[0] = rem;
+	}
+	else
+	{
+		// Normalise so that the top word of the divisor has its top bit set.
+		unsigned s = __builtin_clzll(_y[n - 1]);
+		uint64_t yn[4];
+		uint64_t xn[9];
+		for (unsigned i = n - 1; i > 0; --i)
+			yn[i] = (_y[i] << s) | (s ? _y[i - 1] >> (64 - s) : 0);
+		yn[0] = _y[0] << s;
+		xn[m] = s ? _x[m - 1] >> (64 - s) : 0;
+		for (unsigned i = m - 1; i > 0; --i)
+			xn[i] = (_x[i] << s) | (s ? _x[i - 1] >> (64 - s) : 0);
+		xn[0] = _x[0] << s;
+
+		for (int j = m - n; j >= 0; --j)
+		{
+			// Estimate the quotient word; it is at most two too large.
+			uint128 qhat;
+			uint128 rhat;
+			if (xn[j + n] < yn[n - 1])
+			{
+				uint64_t r64;
+				qhat = div128(xn[j + n], xn[j + n - 1], yn[n - 1], r64);
+				rhat = r64;
+			}
+			else
+			{
+				uint128 num = ((uint128)xn[j + n] << 64) | xn[j + n - 1];
+				qhat = num / yn[n - 1];
+				rhat = num % yn[n - 1];
+			}
+			while ((qhat >> 64) || qhat * yn[n - 2] > ((rhat << 64) | xn[j + n - 2]))
+			{
+				--qhat;
+				rhat += yn[n - 1];
+				if (rhat >> 64)
+					break;
+			}
+
+			// Multiply and subtract.
+			uint64_t carry = 0;
+			uint64_t borrow = 0;
+			for (unsigned i = 0; i < n; ++i)
+			{
+				uint128 p = qhat * yn[i] + carry;
+				carry = (uint64_t)(p >> 64);
+				uint128 t = (uint128)xn[i + j] - (uint64_t)p - borrow;
+				xn[i + j] = (uint64_t)t;
+				borrow = (t >> 64) ? 1 : 0;
+			}
+			uint128 t = (uint128)xn[j + n] - carry - borrow;
+			xn[j + n] = (uint64_t)t;
+			q[j] = (uint64_t)qhat;
+
+			if (t >> 64)
+			{
+				// Subtracted too much; add the divisor back.
+				--q[j];
+				uint64_t c = 0;
+				for (unsigned i = 0; i < n; ++i)
+				{
+					uint128 a = (uint128)xn[i + j] + yn[i] + c;
+					xn[i + j] = (uint64_t)a;
+					c = (uint64_t)(a >> 64);
+				}
+				xn[j + n] += c;
+			}
+		}
+
+		for (unsigned i = 0; i < n; ++i)
+			r[i] = (xn[i] >> s) | (s ? xn[i + 1] << (64 - s) : 0);
+	}
+
+	if (o_q)
+		std::memcpy(o_q, q, _xn * sizeof(uint64_t));
+	std::memcpy(o_r, r, sizeof(r));
+}
+
+/// o_r = (_x + _y) mod _m
+inline void addmod(uint64_t const* _x, uint64_t const* _y, uint64_t const* _m, uint64_t* o_r)
+{
+	uint64_t s[5];
+	uint64_t carry = 0;
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		uint128 t = (uint128)_x[i] + _y[i] + carry;
+		s[i] = (uint64_t)t;
+		carry = (uint64_t)(t >> 64);
+	}
+	s[4] = carry;
+	divmod(s, 5, _m, nullptr, o_r);
+}
+
+EVMJIT_ARITH_INLINE void mulmodImpl(uint64_t const* _x, uint64_t const* _y, uint64_t const* _m, uint64_t* o_r)
+{
+	uint64_t p[8];
+	mul512Impl(_x, _y, p);
+	divmod(p, 8, _m, nullptr, o_r);
+}
+
+EVMJIT_ARITH_INLINE void expImpl(uint64_t const* _b, uint64_t const* _e, uint64_t* o_r)
+{
+	uint64_t r[4] = {1, 0, 0, 0};
+	uint64_t b[4];
+	std::memcpy(b, _b, sizeof(b));
+	for (unsigned n = words(_e, 4), i = 0; i < n; ++i)
+		for (uint64_t e = _e[i], bit = 0; bit < 64 && (e || i + 1 < n); ++bit, e >>= 1)
+		{
+			if (e & 1)
+				mul256Impl(r, b, r);
+			mul256Impl(b, b, b);
+		}
+	std::memcpy(o_r, r, sizeof(r));
+}
+
+using MulModFunc = void(*)(uint64_t const*, uint64_t const*, uint64_t const*, uint64_t*);
+using ExpFunc = void(*)(uint64_t const*, uint64_t const*, uint64_t*);
+
+inline void mulmodGeneric(uint64_t const* _x, uint64_t const* _y, uint64_t const* _m, uint64_t* o_r) { mulmodImpl(_x, _y, _m, o_r); }
+inline void expGeneric(uint64_t const* _b, uint64_t const* _e, uint64_t* o_r) { expImpl(_b, _e, o_r); }
+
+#if EVMJIT_ARITH_DISPATCH
+__attribute__((target("bmi2"))) inline void mulmodBMI2(uint64_t const* _x, uint64_t const* _y, uint64_t const* _m, uint64_t* o_r) { mulmodImpl(_x, _y, _m, o_r); }
+__attribute__((target("bmi2"))) inline void expBMI2(uint64_t const* _b, uint64_t const* _e, uint64_t* o_r) { expImpl(_b, _e, o_r); }
+
+inline bool hasBMI2()
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("bmi2");
+}
+#endif
+
+/// o_r = (_x * _y) mod _m
+inline void mulmod(uint64_t const* _x, uint64_t const* _y, uint64_t const* _m, uint64_t* o_r)
+{
+#if EVMJIT_ARITH_DISPATCH
+	static MulModFunc const s_impl = hasBMI2() ? mulmodBMI2 : mulmodGeneric;
+	s_impl(_x, _y, _m, o_r);
+#else
+	mulmodGeneric(_x, _y, _m, o_r);
+#endif
+}
+
+/// o_r = _b ^ _e mod 2^256
+inline void exp(uint64_t const* _b, uint64_t const* _e, uint64_t* o_r)
+{
+#if EVMJIT_ARITH_DISPATCH
+	static ExpFunc const s_impl = hasBMI2() ? expBMI2 : expGeneric;
+	s_impl(_b, _e, o_r);
+#else
+	expGeneric(_b, _e, o_r);
+#endif
+}
+
+}
+}
+}
+}
+
+#endif
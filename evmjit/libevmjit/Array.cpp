@@ -58,7 +58,7 @@ llvm::Function* Array::createArrayPushFunc()
 
 	m_builder.SetInsertPoint(reallocBB);
 	auto newCap = m_builder.CreateNUWAdd(cap, m_builder.getInt64(c_reallocStep), "newCap");
-	//newCap = m_builder.CreateNUWMul(newCap, m_builder.getInt64(c_reallocMultipier));
+	newCap = m_builder.CreateNUWMul(newCap, m_builder.getInt64(c_reallocMultipier));
 	auto reallocSize = m_builder.CreateShl(newCap, 5, "reallocSize"); // size in bytes: newCap * 32
 	auto bytes = m_builder.CreateBitCast(data, Type::BytePtr, "bytes");
 	auto newBytes = m_reallocFunc.call(m_builder, {bytes, reallocSize}, "newBytes");
@@ -197,19 +197,38 @@ llvm::Function* Array::createExtendFunc()
 	newSize->setName("newSize");
 
 	InsertPointGuard guard{m_builder};
-	m_builder.SetInsertPoint(llvm::BasicBlock::Create(m_builder.getContext(), {}, func));
+	auto entryBB = llvm::BasicBlock::Create(m_builder.getContext(), "Entry", func);
+	auto reallocBB = llvm::BasicBlock::Create(m_builder.getContext(), "Realloc", func);
+	auto extendBB = llvm::BasicBlock::Create(m_builder.getContext(), "Extend", func);
+
+	m_builder.SetInsertPoint(entryBB);
 	auto dataPtr = m_builder.CreateBitCast(arrayPtr, Type::BytePtr->getPointerTo(), "dataPtr");// TODO: Use byte* in Array
 	auto sizePtr = m_builder.CreateStructGEP(arrayPtr, 1, "sizePtr");
 	auto capPtr = m_builder.CreateStructGEP(arrayPtr, 2, "capPtr");
 	auto data = m_builder.CreateLoad(dataPtr, "data");
 	auto size = m_builder.CreateLoad(sizePtr, "size");
+	auto cap = m_builder.CreateLoad(capPtr, "cap");
+	auto reallocReq = m_builder.CreateICmpUGT(newSize, cap, "reallocReq");
+	m_builder.CreateCondBr(reallocReq, reallocBB, extendBB);
+
+	// The capacity at least doubles, so memory growing a little at a time is not copied each time.
+	m_builder.SetInsertPoint(reallocBB);
+	auto doubleCap = m_builder.CreateNUWMul(cap, m_builder.getInt64(c_reallocMultipier), "doubleCap");
+	auto newCap = m_builder.CreateSelect(m_builder.CreateICmpUGT(newSize, doubleCap), newSize, doubleCap, "newCap");
+	auto newData = m_reallocFunc.call(m_builder, {data, newCap}, "newData"); // TODO: Check realloc result for null
+	m_builder.CreateStore(newData, dataPtr);
+	m_builder.CreateStore(newCap, capPtr);
+	m_builder.CreateBr(extendBB);
+
+	// The bytes beyond the size are not kept zeroed, so the extension is cleared now.
+	m_builder.SetInsertPoint(extendBB);
+	auto dataPhi = m_builder.CreatePHI(Type::BytePtr, 2, "dataPhi");
+	dataPhi->addIncoming(data, entryBB);
+	dataPhi->addIncoming(newData, reallocBB);
 	auto extSize = m_builder.CreateNUWSub(newSize, size, "extSize");
-	auto newData = m_reallocFunc.call(m_builder, {data, newSize}, "newData"); // TODO: Check realloc result for null
-	auto extPtr = m_builder.CreateGEP(newData, size, "extPtr");
+	auto extPtr = m_builder.CreateGEP(dataPhi, size, "extPtr");
 	m_builder.CreateMemSet(extPtr, m_builder.getInt8(0), extSize, 16);
-	m_builder.CreateStore(newData, dataPtr);
 	m_builder.CreateStore(newSize, sizePtr);
-	m_builder.CreateStore(newSize, capPtr);
 	m_builder.CreateRetVoid();
 	return func;
 }
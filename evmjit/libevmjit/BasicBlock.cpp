@@ -1,5 +1,6 @@
 #include "BasicBlock.h"
 
+#include <algorithm>
 #include <iostream>
 
 #include "preprocessor/llvm_includes_start.h"
@@ -191,7 +192,7 @@ void BasicBlock::synchronizeLocalStack(Stack& _evmStack)
 	m_tosOffset = 0;
 }
 
-void BasicBlock::linkLocalStacks(std::vector<BasicBlock*> basicBlocks, llvm::IRBuilder<>& _builder)
+void BasicBlock::linkLocalStacks(std::vector<BasicBlock*> basicBlocks, BasicBlock* _jumpTable, Stack& _evmStack, llvm::IRBuilder<>& _builder)
 {
 	struct BBInfo
 	{
@@ -267,6 +268,9 @@ void BasicBlock::linkLocalStacks(std::vector<BasicBlock*> basicBlocks, llvm::IRB
 
 			for (auto predInfo : info.predecessors)
 			{
+				if (&predInfo->bblock == _jumpTable)
+					continue; // values coming through the jump table are taken from the EVM stack
+
 				if (predInfo->outputItems < info.inputItems)
 				{
 					info.inputItems = predInfo->outputItems;
@@ -287,6 +291,23 @@ void BasicBlock::linkLocalStacks(std::vector<BasicBlock*> basicBlocks, llvm::IRB
 		auto& info = entry.second;
 		auto& bblock = info.bblock;
 
+		// A dynamic jump lands in a block of its own, which takes the values
+		// from the EVM stack, as the jump table block left them there.
+		llvm::BasicBlock* landing = nullptr;
+		std::vector<llvm::Value*> landingValues;
+		auto fromJumpTable = std::find_if(info.predecessors.begin(), info.predecessors.end(), [&](BBInfo* _pred) { return &_pred->bblock == _jumpTable; });
+		if (info.inputItems > 0 && fromJumpTable != info.predecessors.end())
+		{
+			auto mainFunc = bblock.llvm()->getParent();
+			landing = llvm::BasicBlock::Create(bblock.llvm()->getContext(), bblock.llvm()->getName() + ".Landing", mainFunc, bblock.llvm());
+			_jumpTable->llvm()->getTerminator()->replaceUsesOfWith(bblock.llvm(), landing);
+			_builder.SetInsertPoint(landing);
+			for (size_t index = 0; index < info.inputItems; ++index)
+				landingValues.push_back(_evmStack.get(index));
+			_evmStack.pop(info.inputItems);
+			_builder.CreateBr(bblock.llvm());
+		}
+
 		llvm::BasicBlock::iterator fstNonPhi(bblock.llvm()->getFirstNonPHI());
 		auto phiIter = bblock.m_initialStack.begin();
 		for (size_t index = 0; index < info.inputItems; ++index, ++phiIter)
@@ -296,10 +317,14 @@ void BasicBlock::linkLocalStacks(std::vector<BasicBlock*> basicBlocks, llvm::IRB
 
 			for (auto predIt : info.predecessors)
 			{
+				if (&predIt->bblock == _jumpTable)
+					continue;
 				auto& predExitStack = predIt->bblock.m_currentStack;
 				auto value = *(predExitStack.end() - 1 - index);
 				phi->addIncoming(value, predIt->bblock.llvm());
 			}
+			if (landing)
+				phi->addIncoming(landingValues[index], landing);
 
 			// Move phi to the front
 			if (llvm::BasicBlock::iterator(phi) != bblock.llvm()->begin())
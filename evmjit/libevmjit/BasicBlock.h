@@ -76,7 +76,11 @@ public:
 
 	/// Optimization: propagates values between local stacks in basic blocks
 	/// to avoid excessive pushing/popping on the EVM stack.
-	static void linkLocalStacks(std::vector<BasicBlock*> _basicBlocks, llvm::IRBuilder<>& _builder);
+	/// The edges out of the jump table block @a _jumpTable (if any) do not limit
+	/// the values a block takes from its other predecessors: on those edges the
+	/// values are taken from @a _evmStack instead, so that only dynamic jumps
+	/// go through memory.
+	static void linkLocalStacks(std::vector<BasicBlock*> _basicBlocks, BasicBlock* _jumpTable, Stack& _evmStack, llvm::IRBuilder<>& _builder);
 
 	/// Synchronize current local stack with the EVM stack.
 	void synchronizeLocalStack(Stack& _evmStack);
@@ -8,6 +8,8 @@
 #include <llvm/Support/Path.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/raw_os_ostream.h>
+#include <llvm/Support/CommandLine.h>
+#include <llvm/Support/Host.h>
 #include "preprocessor/llvm_includes_end.h"
 
 #include "ExecutionEngine.h"
@@ -28,6 +30,21 @@ namespace
 	ExecutionEngineListener* g_listener;
 	static const size_t c_versionStampLength = 32;
 
+	llvm::cl::opt<std::string> g_cacheDir{"cache-dir", llvm::cl::desc{"Directory of the object cache; may be shared by several processes (default: <tmp>/evm_objs)"}};
+
+	/// The objects are code generated for the CPU we run on, so those for each CPU model are kept apart.
+	void getCachePath(llvm::SmallVectorImpl<char>& o_path)
+	{
+		if (!g_cacheDir.empty())
+			o_path.assign(g_cacheDir.begin(), g_cacheDir.end());
+		else
+		{
+			llvm::sys::path::system_temp_directory(false, o_path);
+			llvm::sys::path::append(o_path, "evm_objs");
+		}
+		llvm::sys::path::append(o_path, llvm::sys::getHostCPUName());
+	}
+
 	llvm::StringRef getLibVersionStamp()
 	{
 		static auto version = llvm::SmallString<c_versionStampLength>{};
@@ -52,8 +69,7 @@ void Cache::clear()
 {
 	using namespace llvm::sys;
 	llvm::SmallString<256> cachePath;
-	path::system_temp_directory(false, cachePath);
-	path::append(cachePath, "evm_objs");
+	getCachePath(cachePath);
 
 	std::error_code err;
 	for (auto it = fs::directory_iterator{cachePath.str(), err}; it != fs::directory_iterator{}; it.increment(err))
@@ -62,11 +78,9 @@ void Cache::clear()
 
 void Cache::preload(llvm::ExecutionEngine& _ee, std::unordered_map<std::string, uint64_t>& _funcCache)
 {
-	// TODO: Cache dir should be in one place
 	using namespace llvm::sys;
 	llvm::SmallString<256> cachePath;
-	path::system_temp_directory(false, cachePath);
-	path::append(cachePath, "evm_objs");
+	getCachePath(cachePath);
 
 	// Disable listener
 	auto listener = g_listener;
@@ -76,6 +90,8 @@ void Cache::preload(llvm::ExecutionEngine& _ee, std::unordered_map<std::string,
 	for (auto it = fs::directory_iterator{cachePath.str(), err}; it != fs::directory_iterator{}; it.increment(err))
 	{
 		auto name = it->path().substr(cachePath.size() + 1);
+		if (name.find('.') != std::string::npos)
+			continue; // Temporary file of an unfinished (or interrupted) write
 		if (auto module = getObject(name))
 		{
 			DLOG(cache) << "Preload: " << name << "\n";
@@ -103,15 +119,15 @@ std::unique_ptr<llvm::Module> Cache::getObject(std::string const& id)
 		g_lastObject = nullptr;
 
 	llvm::SmallString<256> cachePath;
-	llvm::sys::path::system_temp_directory(false, cachePath);
-	llvm::sys::path::append(cachePath, "evm_objs", id);
+	getCachePath(cachePath);
+	llvm::sys::path::append(cachePath, id);
 
 	if (auto r = llvm::MemoryBuffer::getFile(cachePath.str(), -1, false))
 	{
 		auto& buf = r.get();
 		auto objVersionStamp = buf->getBufferSize() >= c_versionStampLength ? llvm::StringRef{buf->getBufferEnd() - c_versionStampLength, c_versionStampLength} : llvm::StringRef{};
 		if (objVersionStamp == getLibVersionStamp())
-			g_lastObject = llvm::MemoryBuffer::getMemBufferCopy(r.get()->getBuffer());
+			g_lastObject = buf.release(); // Hand over the mapped file as is; objects are replaced by rename, never rewritten in place
 		else
 			DLOG(cache) << "Unmatched version: " << objVersionStamp.str() << ", expected " << getLibVersionStamp().str() << "\n";
 	}
@@ -145,18 +161,29 @@ void ObjectCache::notifyObjectCompiled(llvm::Module const* _module, llvm::Memory
 
 	auto&& id = _module->getModuleIdentifier();
 	llvm::SmallString<256> cachePath;
-	llvm::sys::path::system_temp_directory(false, cachePath);
-	llvm::sys::path::append(cachePath, "evm_objs");
+	getCachePath(cachePath);
 
-	if (llvm::sys::fs::create_directory(cachePath.str()))
+	if (llvm::sys::fs::create_directories(cachePath.str()))
 		DLOG(cache) << "Cannot create cache dir " << cachePath.str().str() << "\n";
 
 	llvm::sys::path::append(cachePath, id);
 
+	// Write to a temporary file and rename it into place, so that other processes sharing the cache
+	// never map a partially written object.
 	DLOG(cache) << id << ": write\n";
-	std::string error;
-	llvm::raw_fd_ostream cacheFile(cachePath.c_str(), error, llvm::sys::fs::F_None);
-	cacheFile << _object->getBuffer() << getLibVersionStamp();
+	int fd;
+	llvm::SmallString<256> tmpPath;
+	if (llvm::sys::fs::createUniqueFile(llvm::Twine(cachePath) + ".%%%%%%", fd, tmpPath))
+	{
+		DLOG(cache) << "Cannot create " << tmpPath.str().str() << "\n";
+		return;
+	}
+	{
+		llvm::raw_fd_ostream cacheFile(fd, true);
+		cacheFile << _object->getBuffer() << getLibVersionStamp();
+	}
+	if (llvm::sys::fs::rename(tmpPath.str(), cachePath.str()))
+		llvm::sys::fs::remove(tmpPath.str());
 }
 
 llvm::MemoryBuffer* ObjectCache::getObject(llvm::Module const* _module)
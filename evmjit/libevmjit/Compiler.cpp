@@ -4,6 +4,7 @@
 #include <fstream>
 #include <chrono>
 #include <sstream>
+#include <limits>
 
 #include "preprocessor/llvm_includes_start.h"
 #include <llvm/IR/CFG.h>
@@ -29,6 +30,70 @@ namespace eth
 namespace jit
 {
 
+namespace
+{
+
+/// Stack items taken and returned by an instruction other than PUSH, DUP and SWAP.
+/// @returns false for invalid instructions.
+bool stackEffect(Instruction _inst, int& o_args, int& o_ret)
+{
+	o_args = 0;
+	o_ret = 1;
+	switch (_inst)
+	{
+	case Instruction::ADDRESS: case Instruction::ORIGIN: case Instruction::CALLER: case Instruction::CALLVALUE:
+	case Instruction::CALLDATASIZE: case Instruction::CODESIZE: case Instruction::GASPRICE: case Instruction::COINBASE:
+	case Instruction::TIMESTAMP: case Instruction::NUMBER: case Instruction::DIFFICULTY: case Instruction::GASLIMIT:
+	case Instruction::PC: case Instruction::MSIZE: case Instruction::GAS:
+		break;
+	case Instruction::ISZERO: case Instruction::NOT: case Instruction::BALANCE: case Instruction::CALLDATALOAD:
+	case Instruction::EXTCODESIZE: case Instruction::BLOCKHASH: case Instruction::MLOAD: case Instruction::SLOAD:
+		o_args = 1;
+		break;
+	case Instruction::ADD: case Instruction::MUL: case Instruction::SUB: case Instruction::DIV: case Instruction::SDIV:
+	case Instruction::MOD: case Instruction::SMOD: case Instruction::EXP: case Instruction::SIGNEXTEND:
+	case Instruction::LT: case Instruction::GT: case Instruction::SLT: case Instruction::SGT: case Instruction::EQ:
+	case Instruction::AND: case Instruction::OR: case Instruction::XOR: case Instruction::BYTE: case Instruction::SHA3:
+		o_args = 2;
+		break;
+	case Instruction::ADDMOD: case Instruction::MULMOD: case Instruction::CREATE:
+		o_args = 3;
+		break;
+	case Instruction::CALL: case Instruction::CALLCODE:
+		o_args = 7;
+		break;
+	case Instruction::STOP: case Instruction::JUMPDEST:
+		o_ret = 0;
+		break;
+	case Instruction::POP: case Instruction::JUMP: case Instruction::SUICIDE:
+		o_args = 1;
+		o_ret = 0;
+		break;
+	case Instruction::MSTORE: case Instruction::MSTORE8: case Instruction::SSTORE: case Instruction::JUMPI:
+	case Instruction::RETURN:
+		o_args = 2;
+		o_ret = 0;
+		break;
+	case Instruction::CALLDATACOPY: case Instruction::CODECOPY:
+		o_args = 3;
+		o_ret = 0;
+		break;
+	case Instruction::EXTCODECOPY:
+		o_args = 4;
+		o_ret = 0;
+		break;
+	case Instruction::LOG0: case Instruction::LOG1: case Instruction::LOG2: case Instruction::LOG3: case Instruction::LOG4:
+		o_args = 2 + static_cast<int>(_inst) - static_cast<int>(Instruction::LOG0);
+		o_ret = 0;
+		break;
+	default:
+		return false;
+	}
+	return true;
+}
+
+}
+
 Compiler::Compiler(Options const& _options):
 	m_options(_options),
 	m_builder(llvm::getGlobalContext())
@@ -89,6 +154,138 @@ void Compiler::createBasicBlocks(code_iterator _codeBegin, code_iterator _codeEn
 	}
 }
 
+void Compiler::resolveJumpTargets()
+{
+	// The constants on the stack, top last, as far down as they are known.
+	using Constants = std::vector<ProgramCounter>;
+	static const auto c_unknown = std::numeric_limits<ProgramCounter>::max();
+	static const size_t c_maxTracked = 32;
+
+	std::map<ProgramCounter, Constants> entries;
+	std::vector<ProgramCounter> worklist;
+	auto reach = [&](ProgramCounter _pc, Constants const& _stack)
+	{
+		auto it = entries.find(_pc);
+		if (it == entries.end())
+			entries.emplace(_pc, _stack);
+		else
+		{
+			// Merge aligned at the top: only what is the same on both paths stays known.
+			auto& known = it->second;
+			auto size = std::min(known.size(), _stack.size());
+			Constants merged(known.end() - size, known.end());
+			for (size_t i = 0; i < size; ++i)
+				if (merged[i] != _stack[_stack.size() - size + i])
+					merged[i] = c_unknown;
+			if (merged == known)
+				return;
+			known = std::move(merged);
+		}
+		worklist.push_back(_pc);
+	};
+
+	// At first, every jump is assumed to be resolved, so the jump destinations are only reached by the
+	// jumps seen to go there. If that turns out not to hold, a dynamic jump may reach any jump destination
+	// with anything on the stack, and it is all done again.
+	for (bool dynamicJumps: {false, true})
+	{
+		entries.clear();
+		m_jumpTargets.clear();
+		if (!m_basicBlocks.empty())
+			reach(m_basicBlocks.begin()->first, {});
+		if (dynamicJumps)
+			for (auto&& p : m_basicBlocks)
+				if (p.second.isJumpDest())
+					reach(p.first, {});
+
+		bool unresolved = false;
+		while (!worklist.empty())
+		{
+			auto pc = worklist.back();
+			worklist.pop_back();
+			auto& block = m_basicBlocks.find(pc)->second;
+			auto stack = entries[pc];
+			auto top = [&](size_t _index) { return _index < stack.size() ? stack[stack.size() - 1 - _index] : c_unknown; };
+			auto pop = [&](size_t _count) { stack.resize(stack.size() - std::min(_count, stack.size())); };
+			auto push = [&](ProgramCounter _value)
+			{
+				stack.push_back(_value);
+				if (stack.size() > c_maxTracked)
+					stack.erase(stack.begin());
+			};
+
+			bool fallsThrough = true;
+			for (auto it = block.begin(); it != block.end() && fallsThrough; ++it)
+			{
+				auto inst = Instruction(*it);
+				auto instPC = static_cast<ProgramCounter>(it - block.begin()) + block.firstInstrIdx();
+				switch (inst)
+				{
+				case Instruction::ANY_PUSH:
+				{
+					auto value = readPushData(it, block.end());
+					push(value.getActiveBits() < 64 ? value.getZExtValue() : c_unknown);
+					break;
+				}
+				case Instruction::ANY_DUP:
+					push(top(static_cast<size_t>(inst) - static_cast<size_t>(Instruction::DUP1)));
+					break;
+				case Instruction::ANY_SWAP:
+				{
+					auto index = static_cast<size_t>(inst) - static_cast<size_t>(Instruction::SWAP1) + 1;
+					if (index < stack.size())
+						std::swap(stack.back(), stack[stack.size() - 1 - index]);
+					else if (!stack.empty())
+						stack.back() = c_unknown;
+					break;
+				}
+				case Instruction::JUMP:
+				case Instruction::JUMPI:
+				{
+					auto target = top(0);
+					pop(inst == Instruction::JUMP ? 1 : 2);
+					m_jumpTargets[instPC] = target;
+					if (target == c_unknown)
+						unresolved = true;
+					else
+					{
+						auto targetBlock = m_basicBlocks.find(target);
+						if (targetBlock != m_basicBlocks.end() && targetBlock->second.isJumpDest())
+							reach(target, stack);
+					}
+					fallsThrough = inst == Instruction::JUMPI;
+					break;
+				}
+				default:
+				{
+					int args, ret;
+					fallsThrough = stackEffect(inst, args, ret) && inst != Instruction::STOP &&
+						inst != Instruction::RETURN && inst != Instruction::SUICIDE;
+					pop(static_cast<size_t>(args));
+					for (int i = 0; i < ret; ++i)
+						push(c_unknown);
+				}
+				}
+			}
+			if (fallsThrough)
+			{
+				auto next = m_basicBlocks.upper_bound(pc);
+				if (next != m_basicBlocks.end())
+					reach(next->first, stack);
+			}
+		}
+		if (!unresolved)
+			break;
+	}
+
+	// The dynamic jumps are those left out.
+	for (auto it = m_jumpTargets.begin(); it != m_jumpTargets.end();)
+		if (it->second == c_unknown)
+			it = m_jumpTargets.erase(it);
+		else
+			++it;
+}
+
 llvm::BasicBlock* Compiler::getJumpTableBlock(RuntimeManager& _runtimeManager)
 {
 	if (!m_jumpTableBlock)
@@ -97,12 +294,29 @@ llvm::BasicBlock* Compiler::getJumpTableBlock(RuntimeManager& _runtimeManager)
 		InsertPointGuard g{m_builder};
 		m_builder.SetInsertPoint(m_jumpTableBlock->llvm());
 		auto dest = m_builder.CreatePHI(Type::Word, 8, "target");
-		auto switchInstr = m_builder.CreateSwitch(dest, getBadJumpBlock(_runtimeManager));
+
+		// The jump destinations are numbered from 1 in a table indexed by PC, where every other PC,
+		// and the one past the end that targets out of the code are sent to, is 0. A switch over
+		// those dense numbers becomes a jump table rather than a search through the destinations.
+		auto codeSize = m_basicBlocks.empty() ? 0 : m_basicBlocks.rbegin()->second.end() - m_basicBlocks.begin()->second.begin();
+		std::vector<uint32_t> indices(static_cast<size_t>(codeSize) + 1, 0);
+		std::vector<llvm::BasicBlock*> destinations;
 		for (auto&& p : m_basicBlocks)
-		{
 			if (p.second.isJumpDest())
-				switchInstr->addCase(Constant::get(p.first), p.second.llvm());
-		}
+			{
+				destinations.push_back(p.second.llvm());
+				indices[p.first] = static_cast<uint32_t>(destinations.size());
+			}
+		auto indexTable = new llvm::GlobalVariable(*m_mainFunc->getParent(), llvm::ArrayType::get(m_builder.getInt32Ty(), indices.size()), true,
+			llvm::GlobalValue::PrivateLinkage, llvm::ConstantDataArray::get(m_builder.getContext(), indices), "jumpTable.indices");
+		auto inCode = m_builder.CreateICmpULT(dest, Constant::get(codeSize), "inCode");
+		auto pc = m_builder.CreateSelect(inCode, m_builder.CreateTrunc(dest, Type::Size), m_builder.getInt64(codeSize), "pc");
+		llvm::Value* idxList[] = {m_builder.getInt64(0), pc};
+		auto indexPtr = m_builder.CreateInBoundsGEP(indexTable, idxList, "indexPtr");
+		auto index = m_builder.CreateLoad(indexPtr, "index");
+		auto switchInstr = m_builder.CreateSwitch(index, getBadJumpBlock(_runtimeManager), destinations.size());
+		for (size_t i = 0; i < destinations.size(); ++i)
+			switchInstr->addCase(m_builder.getInt32(static_cast<uint32_t>(i + 1)), destinations[i]);
 	}
 	return m_jumpTableBlock->llvm();
 }
@@ -133,6 +347,7 @@ std::unique_ptr<llvm::Module> Compiler::compile(code_iterator _begin, code_itera
 	m_builder.SetInsertPoint(entryBlock);
 
 	createBasicBlocks(_begin, _end);
+	resolveJumpTargets();
 
 	// Init runtime structures.
 	RuntimeManager runtimeManager(m_builder, _begin, _end);
@@ -214,7 +429,7 @@ std::unique_ptr<llvm::Module> Compiler::compile(code_iterator _begin, code_itera
 		if (m_jumpTableBlock)
 			blockList.push_back(m_jumpTableBlock.get());
 
-		BasicBlock::linkLocalStacks(blockList, m_builder);
+		BasicBlock::linkLocalStacks(blockList, m_jumpTableBlock.get(), stack, m_builder);
 
 		dumpCFGifRequired("blocks-opt.dot");
 	}
@@ -581,13 +796,19 @@ void Compiler::compileBasicBlock(BasicBlock& _basicBlock, RuntimeManager& _runti
 		{
 			llvm::BasicBlock* targetBlock = nullptr;
 			auto target = stack.pop();
+			auto jumpTargetBlock = [&](ProgramCounter _targetIdx)
+			{
+				auto block = m_basicBlocks.find(_targetIdx);
+				return (block != m_basicBlocks.end() && block->second.isJumpDest()) ? block->second.llvm() : getBadJumpBlock(_runtimeManager);
+			};
+			auto resolved = m_jumpTargets.find(static_cast<ProgramCounter>(it - _basicBlock.begin()) + _basicBlock.firstInstrIdx());
 			if (auto constant = llvm::dyn_cast<llvm::ConstantInt>(target))
 			{
 				auto&& c = constant->getValue();
-				auto targetIdx = c.getActiveBits() <= 64 ? c.getZExtValue() : -1;
-				auto it = m_basicBlocks.find(targetIdx);
-				targetBlock = (it != m_basicBlocks.end() && it->second.isJumpDest()) ? it->second.llvm() : getBadJumpBlock(_runtimeManager);
+				targetBlock = jumpTargetBlock(c.getActiveBits() <= 64 ? c.getZExtValue() : -1);
 			}
+			else if (resolved != m_jumpTargets.end())
+				targetBlock = jumpTargetBlock(resolved->second);
 
 			// TODO: Improve; check for constants
 			if (inst == Instruction::JUMP)
@@ -36,6 +36,10 @@ private:
 
 	void createBasicBlocks(code_iterator _begin, code_iterator _end);
 
+	/// Finds the targets of the jumps that are constant on every path reaching them,
+	/// following constants pushed in one block and used in another through DUPs and SWAPs.
+	void resolveJumpTargets();
+
 	void compileBasicBlock(BasicBlock& _basicBlock, class RuntimeManager& _runtimeManager, class Arith256& _arith, class Memory& _memory, class Ext& _ext, class GasMeter& _gasMeter, llvm::BasicBlock* _nextBasicBlock);
 
 	llvm::BasicBlock* getJumpTableBlock(RuntimeManager& _runtimeManager);
@@ -62,6 +66,9 @@ private:
 	/// Maps a program counter pc to a basic block that starts at pc (if any).
 	std::map<ProgramCounter, BasicBlock> m_basicBlocks;
 
+	/// Maps the program counter of a JUMP or JUMPI to its target, if resolveJumpTargets() found it.
+	std::map<ProgramCounter, ProgramCounter> m_jumpTargets;
+
 	/// Stop basic block - terminates execution with STOP code (0)
 	llvm::BasicBlock* m_stopBB = nullptr;
 
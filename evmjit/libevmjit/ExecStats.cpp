@@ -26,6 +26,11 @@ void ExecStats::stateChanged(ExecState _state)
 	}
 	m_state = _state;
 	m_tp = now;
+
+	if (_state == ExecState::CacheLoad)
+		source = CodeSource::ObjectCache;
+	else if (_state == ExecState::Compilation)
+		source = CodeSource::Compiled;	// Not found in the cache after all
 }
 
 namespace
@@ -13,6 +13,15 @@ namespace eth
 namespace jit
 {
 
+/// Where the code of a run came from.
+enum class CodeSource
+{
+	Memory,			///< Compiled earlier in this process
+	ObjectCache,	///< Loaded from the object cache
+	Compiled,		///< Compiled for this run
+	Queued			///< Queued for background compilation; the run was rejected
+};
+
 class ExecStats : public ExecutionEngineListener
 {
 public:
@@ -22,6 +31,7 @@ public:
 
 	std::string id;
 	duration time[(int)ExecState::Finished] = {};
+	CodeSource source = CodeSource::Memory;
 
 	void stateChanged(ExecState _state) override;
 
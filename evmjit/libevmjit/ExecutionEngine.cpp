@@ -2,6 +2,11 @@
 
 #include <array>
 #include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <unordered_set>
 #include <iostream>
 #include <unordered_map>
 #include <cstdlib>
@@ -68,7 +73,8 @@ void printVersion()
 }
 
 namespace cl = llvm::cl;
-cl::opt<bool> g_optimize{"O", cl::desc{"Optimize"}};
+cl::opt<bool> g_optimize{"O", cl::desc{"Optimize all code with the full tier"}};
+cl::opt<unsigned> g_promoteAfter{"promote", cl::desc{"Recompile code with the full optimization tier in the background after this many runs (default: 0, never)"}};
 cl::opt<CacheMode> g_cache{"cache", cl::desc{"Cache compiled EVM code on disk"},
 	cl::values(
 		clEnumValN(CacheMode::on,    "1", "Enabled"),
@@ -80,6 +86,7 @@ cl::opt<CacheMode> g_cache{"cache", cl::desc{"Cache compiled EVM code on disk"},
 		clEnumValEnd)};
 cl::opt<bool> g_stats{"st", cl::desc{"Statistics"}};
 cl::opt<bool> g_dump{"dump", cl::desc{"Dump LLVM IR module"}};
+cl::opt<bool> g_async{"async", cl::desc{"Compile in background. Execution of code not compiled yet is rejected."}};
 
 void parseOptions()
 {
@@ -101,94 +108,306 @@ void parseOptions()
 	cl::ParseCommandLineOptions(i, argv, "Ethereum EVM JIT Compiler");
 }
 
+void ensureOptionsParsed()
+{
+	static std::once_flag flag;
+	std::call_once(flag, parseOptions);
 }
 
+/// LLVM's context and execution engine are not thread-safe, so all the compilation is serialised on this lock.
+std::mutex x_engine;
+std::unique_ptr<llvm::ExecutionEngine> g_ee;
 
-ReturnCode ExecutionEngine::run(RuntimeData* _data, Env* _env)
+/// Entry points of the code compiled so far; guarded by its own lock so lookups do not wait for compilations.
+std::mutex x_funcCache;
+std::unordered_map<std::string, uint64_t> g_funcCache;
+/// Runs of the code compiled with the fast tier only, by name, while it is not queued for promotion yet.
+std::unordered_map<std::string, unsigned> g_fastTierRuns;
+
+/// Suffix of the name a piece of code is compiled under when promoted to the full tier, so that both compilations
+/// of it may live in the execution engine and in the object cache.
+static const std::string c_fullTierSuffix = "_full";
+
+bool isPromoted(std::string const& _name)
 {
-	static std::once_flag flag;
-	std::call_once(flag, parseOptions);
+	auto size = c_fullTierSuffix.size();
+	return _name.size() > size && !_name.compare(_name.size() - size, size, c_fullTierSuffix);
+}
 
-	std::unique_ptr<ExecStats> listener{new ExecStats};
-	listener->stateChanged(ExecState::Started);
+/// @returns the entry point of the code compiled under @a _name, if any. If @a o_promote is given, a run of the
+/// code is counted and it is set to whether the code has now been run often enough to be promoted.
+EntryFuncPtr findEntry(std::string const& _name, bool* o_promote = nullptr)
+{
+	std::lock_guard<std::mutex> lock{x_funcCache};
+	auto it = g_funcCache.find(_name);
+	if (it == g_funcCache.end())
+		return nullptr;
+	if (o_promote)
+	{
+		auto runs = g_fastTierRuns.find(_name);
+		*o_promote = runs != g_fastTierRuns.end() && ++runs->second >= g_promoteAfter;
+		if (*o_promote)
+			g_fastTierRuns.erase(runs);
+	}
+	return (EntryFuncPtr) it->second;
+}
 
+/// Sets up the object cache reporting to @a _listener and creates the execution engine on first use.
+/// Must be called with x_engine held.
+bool initEngine(ExecutionEngineListener* _listener, ObjectCache*& o_objectCache)
+{
 	bool preloadCache = g_cache == CacheMode::preload;
 	if (preloadCache)
 		g_cache = CacheMode::on;
 
 	// TODO: Do not pseudo-init the cache every time
-	auto objectCache = (g_cache != CacheMode::off && g_cache != CacheMode::clear) ? Cache::getObjectCache(g_cache, listener.get()) : nullptr;
+	o_objectCache = (g_cache != CacheMode::off && g_cache != CacheMode::clear) ? Cache::getObjectCache(g_cache, _listener) : nullptr;
 
-	static std::unordered_map<std::string, uint64_t> funcCache;
+	if (g_ee)
+		return true;
 
-	static std::unique_ptr<llvm::ExecutionEngine> ee;
-	if (!ee)
-	{
-		if (g_cache == CacheMode::clear)
-			Cache::clear();
+	if (g_cache == CacheMode::clear)
+		Cache::clear();
 
-		llvm::InitializeNativeTarget();
-		llvm::InitializeNativeTargetAsmPrinter();
+	llvm::InitializeNativeTarget();
+	llvm::InitializeNativeTargetAsmPrinter();
 
-		auto module = std::unique_ptr<llvm::Module>(new llvm::Module({}, llvm::getGlobalContext()));
-		llvm::EngineBuilder builder(module.get());
-		builder.setEngineKind(llvm::EngineKind::JIT);
-		builder.setUseMCJIT(true);
-		builder.setOptLevel(g_optimize ? llvm::CodeGenOpt::Default : llvm::CodeGenOpt::None);
+	auto module = std::unique_ptr<llvm::Module>(new llvm::Module({}, llvm::getGlobalContext()));
+	llvm::EngineBuilder builder(module.get());
+	builder.setEngineKind(llvm::EngineKind::JIT);
+	builder.setUseMCJIT(true);
+	builder.setOptLevel(g_optimize ? llvm::CodeGenOpt::Default : llvm::CodeGenOpt::None);
+	builder.setMCPU(llvm::sys::getHostCPUName());	// Lets the Arith256 helpers and the rest use what this CPU has
 
-		auto triple = llvm::Triple(llvm::sys::getProcessTriple());
-		if (triple.getOS() == llvm::Triple::OSType::Win32)
-			triple.setObjectFormat(llvm::Triple::ObjectFormatType::ELF);  // MCJIT does not support COFF format
-		module->setTargetTriple(triple.str());
+	auto triple = llvm::Triple(llvm::sys::getProcessTriple());
+	if (triple.getOS() == llvm::Triple::OSType::Win32)
+		triple.setObjectFormat(llvm::Triple::ObjectFormatType::ELF);  // MCJIT does not support COFF format
+	module->setTargetTriple(triple.str());
 
-		ee.reset(builder.create());
-		if (!CHECK(ee))
-			return ReturnCode::LLVMConfigError;
-		module.release();  // Successfully created llvm::ExecutionEngine takes ownership of the module
-		ee->setObjectCache(objectCache);
+	g_ee.reset(builder.create());
+	if (!CHECK(g_ee))
+		return false;
+	module.release();  // Successfully created llvm::ExecutionEngine takes ownership of the module
+	g_ee->setObjectCache(o_objectCache);
+
+	if (preloadCache)
+	{
+		std::lock_guard<std::mutex> lock{x_funcCache};
+		Cache::preload(*g_ee, g_funcCache);
+		// Promoted code replaces its fast compilation; the rest may still be promoted.
+		std::vector<std::pair<std::string, uint64_t>> promoted;
+		for (auto const& f: g_funcCache)
+			if (isPromoted(f.first))
+				promoted.emplace_back(f.first.substr(0, f.first.size() - c_fullTierSuffix.size()), f.second);
+			else if (g_promoteAfter && !g_optimize)
+				g_fastTierRuns.emplace(f.first, 0);
+		for (auto const& p: promoted)
+		{
+			g_funcCache[p.first] = p.second;
+			g_fastTierRuns.erase(p.first);
+		}
+	}
+	return true;
+}
 
-		if (preloadCache)
-			Cache::preload(*ee, funcCache);
+/// Loads the code from the object cache or compiles it and registers its entry point under @a _name.
+/// With -O everything is compiled with the full tier. Otherwise code is first compiled with the fast tier and,
+/// if @a _promote, compiled again with the full tier, its entry point replacing the fast one.
+/// Must be called with x_engine held.
+EntryFuncPtr compile(std::string const& _name, code_iterator _begin, code_iterator _end, ObjectCache* _objectCache, ExecutionEngineListener* _listener, bool _promote = false)
+{
+	if (!_promote)
+		if (auto entry = findEntry(_name))
+			return entry;	// Compiled by someone else while we were waiting for the engine
+
+	auto tier = g_optimize || _promote ? OptimizationTier::Full : OptimizationTier::Fast;
+	auto moduleName = _promote && !g_optimize ? _name + c_fullTierSuffix : _name;
+	auto module = _objectCache ? Cache::getObject(moduleName) : nullptr;
+	if (!module)
+	{
+		if (_listener)
+			_listener->stateChanged(ExecState::Compilation);
+		assert(_begin || _begin == _end); //TODO: Is it good idea to execute empty code?
+		module = Compiler{{}}.compile(_begin, _end, moduleName);
+
+		if (_listener)
+			_listener->stateChanged(ExecState::Optimization);
+		optimize(*module, tier);
 	}
+	if (g_dump)
+		module->dump();
+
+	g_ee->addModule(module.get());
+	module.release();
+	if (_listener)
+		_listener->stateChanged(ExecState::CodeGen);
+	auto entry = (EntryFuncPtr)g_ee->getFunctionAddress(moduleName);
+	if (entry)
+	{
+		std::lock_guard<std::mutex> lock{x_funcCache};
+		g_funcCache[_name] = (uint64_t) entry;
+		if (tier == OptimizationTier::Fast && g_promoteAfter)
+			g_fastTierRuns.emplace(_name, 0);
+	}
+	return entry;
+}
 
-	static StatsCollector statsCollector;
+/// Compiles queued code on a worker thread, so that the callers can keep interpreting it meanwhile.
+/// A single worker is used as compilation is serialised on x_engine anyway. The worker also creates the
+/// execution engine (preloading the cache if asked to), so the callers never wait on x_engine.
+class BackgroundCompiler
+{
+public:
+	BackgroundCompiler(): m_worker([this]{ work(); }) {}
 
-	auto mainFuncName = codeHash(_data->codeHash);
-	m_runtime.init(_data, _env);
+	~BackgroundCompiler()
+	{
+		{
+			std::lock_guard<std::mutex> lock{x_queue};
+			m_stop = true;
+		}
+		m_ready.notify_all();
+		m_worker.join();
+	}
 
-	EntryFuncPtr entryFuncPtr = nullptr;
-	auto it = funcCache.find(mainFuncName);
-	if (it != funcCache.end())
-		entryFuncPtr = (EntryFuncPtr) it->second;
+	size_t depth()
+	{
+		std::lock_guard<std::mutex> lock{x_queue};
+		return m_queued.size();
+	}
 
-	if (!entryFuncPtr)
+	/// Queues the code for compilation, or for promotion to the full tier if @a _promote, unless it is already
+	/// queued.
+	void enqueue(std::string const& _name, code_iterator _begin, code_iterator _end, bool _promote = false)
 	{
-		auto module = objectCache ? Cache::getObject(mainFuncName) : nullptr;
-		if (!module)
 		{
-			listener->stateChanged(ExecState::Compilation);
-			assert(_data->code || !_data->codeSize); //TODO: Is it good idea to execute empty code?
-			module = Compiler{{}}.compile(_data->code, _data->code + _data->codeSize, mainFuncName);
+			std::lock_guard<std::mutex> lock{x_queue};
+			if (!m_queued.insert(_promote ? _name + c_fullTierSuffix : _name).second)
+				return;
+			m_queue.push_back(Item{_name, std::vector<byte>(_begin, _end), _promote});
+		}
+		m_ready.notify_one();
+	}
+
+private:
+	void work()
+	{
+		while (true)
+		{
+			Item item;
+			{
+				std::unique_lock<std::mutex> lock{x_queue};
+				m_ready.wait(lock, [this]{ return m_stop || !m_queue.empty(); });
+				if (m_stop)
+					return;
+				item = std::move(m_queue.front());
+				m_queue.pop_front();
+			}
 
-			if (g_optimize)
 			{
-				listener->stateChanged(ExecState::Optimization);
-				optimize(*module);
+				std::lock_guard<std::mutex> lock{x_engine};
+				ObjectCache* objectCache = nullptr;
+				auto& code = item.code;
+				if (!initEngine(nullptr, objectCache) || !CHECK(compile(item.name, code.data(), code.data() + code.size(), objectCache, nullptr, item.promote)))
+					DLOG(JIT) << item.name << ": background compilation failed\n";
 			}
+
+			std::lock_guard<std::mutex> lock{x_queue};
+			m_queued.erase(item.promote ? item.name + c_fullTierSuffix : item.name);
 		}
-		if (g_dump)
-			module->dump();
+	}
+
+	struct Item
+	{
+		std::string name;
+		std::vector<byte> code;
+		bool promote;
+	};
+
+	std::mutex x_queue;
+	std::condition_variable m_ready;
+	std::deque<Item> m_queue;
+	std::unordered_set<std::string> m_queued;	///< Names in m_queue or being compiled.
+	bool m_stop = false;
+	std::thread m_worker;
+};
+
+/// Created after the LLVM shutdown object of parseOptions(), so the worker is stopped before LLVM goes away.
+BackgroundCompiler& backgroundCompiler()
+{
+	static BackgroundCompiler s_this;
+	return s_this;
+}
+
+std::function<void(ExecStats const&)> g_statsHandler;
 
-		ee->addModule(module.get());
-		module.release();
-		listener->stateChanged(ExecState::CodeGen);
-		entryFuncPtr = (EntryFuncPtr)ee->getFunctionAddress(mainFuncName);
+}
+
+
+bool ExecutionEngine::precompile(byte const* _code, uint64_t _codeSize, i256 const& _codeHash)
+{
+	ensureOptionsParsed();
+
+	std::lock_guard<std::mutex> lock{x_engine};
+	if (!g_ee)
+		g_optimize = true;	// Sets the code generation level of the engine about to be created, too
+	if (g_cache == CacheMode::off || g_cache == CacheMode::read || g_cache == CacheMode::clear)
+		g_cache = CacheMode::write;
+
+	ObjectCache* objectCache = nullptr;
+	if (!initEngine(nullptr, objectCache))
+		return false;
+	return compile(codeHash(_codeHash), _code, _code + _codeSize, objectCache, nullptr, true) != nullptr;
+}
+
+void ExecutionEngine::setStatsHandler(std::function<void(ExecStats const&)> const& _handler)
+{
+	g_statsHandler = _handler;
+}
+
+size_t ExecutionEngine::compileQueueDepth()
+{
+	return g_async || g_promoteAfter ? backgroundCompiler().depth() : 0;
+}
+
+ReturnCode ExecutionEngine::run(RuntimeData* _data, Env* _env)
+{
+	ensureOptionsParsed();
+
+	std::unique_ptr<ExecStats> listener{new ExecStats};
+	listener->stateChanged(ExecState::Started);
+
+	auto mainFuncName = codeHash(_data->codeHash);
+	bool promote = false;
+	auto entryFuncPtr = findEntry(mainFuncName, &promote);
+	if (promote)
+		backgroundCompiler().enqueue(mainFuncName, _data->code, _data->code + _data->codeSize, true);
+
+	if (!entryFuncPtr && g_async)
+	{
+		backgroundCompiler().enqueue(mainFuncName, _data->code, _data->code + _data->codeSize);
+		if (g_statsHandler)
+		{
+			listener->source = CodeSource::Queued;
+			g_statsHandler(*listener);
+		}
+		return ReturnCode::Rejected;
+	}
+
+	if (!entryFuncPtr)
+	{
+		std::lock_guard<std::mutex> lock{x_engine};
+		ObjectCache* objectCache = nullptr;
+		if (!initEngine(listener.get(), objectCache))
+			return ReturnCode::LLVMConfigError;
+		entryFuncPtr = compile(mainFuncName, _data->code, _data->code + _data->codeSize, objectCache, listener.get());
 	}
 	if (!CHECK(entryFuncPtr))
 		return ReturnCode::LLVMLinkError;
 
-	if (it == funcCache.end())
-		funcCache[mainFuncName] = (uint64_t) entryFuncPtr;
+	static StatsCollector statsCollector;
+
+	m_runtime.init(_data, _env);
 
 	listener->stateChanged(ExecState::Execution);
 	auto returnCode = entryFuncPtr(&m_runtime);
@@ -199,6 +418,9 @@ ReturnCode ExecutionEngine::run(RuntimeData* _data, Env* _env)
 
 	listener->stateChanged(ExecState::Finished);
 
+	if (g_statsHandler)
+		g_statsHandler(*listener);
+
 	if (g_stats)
 		statsCollector.stats.push_back(std::move(listener));
 
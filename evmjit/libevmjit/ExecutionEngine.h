@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <memory>
 
 #include "Runtime.h"
@@ -38,6 +39,8 @@ public:
 	virtual void stateChanged(ExecState) {}
 };
 
+class ExecStats;
+
 class ExecutionEngine
 {
 public:
@@ -47,6 +50,20 @@ public:
 
 	EXPORT ReturnCode run(RuntimeData* _data, Env* _env);
 
+	/// Compiles the code ahead of time into the object cache under @a _codeHash, so that a later
+	/// process started with the cache in preload mode loads it without any LLVM code generation.
+	/// The cache is written even if it is not enabled by the EVMJIT options. The code is compiled with the full
+	/// optimization tier.
+	/// @returns false if the code could not be compiled.
+	EXPORT static bool precompile(byte const* _code, uint64_t _codeSize, i256 const& _codeHash);
+
+	/// Has @a _handler called, on the thread of the run, with the statistics of every run from now on, including
+	/// runs rejected while their code is compiled in the background. To be set before the first run.
+	EXPORT static void setStatsHandler(std::function<void(ExecStats const&)> const& _handler);
+
+	/// @returns the number of pieces of code queued for, or in, background compilation.
+	EXPORT static size_t compileQueueDepth();
+
 	/// Reference to returned data (RETURN opcode used)
 	bytes_ref returnData;
 
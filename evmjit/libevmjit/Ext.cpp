@@ -89,16 +89,113 @@ llvm::CallInst* Ext::createCall(EnvFunc _funcId, std::initializer_list<llvm::Val
 	return getBuilder().CreateCall(func, {_args.begin(), _args.size()});
 }
 
+namespace
+{
+/// Number of entries in the storage cache; a power of 2.
+static const uint64_t c_storageCacheSize = 32;
+}
+
+llvm::Value* Ext::getStorageCache()
+{
+	if (!m_storageCache)
+	{
+		// Made and emptied in the entry block, once, however many SLOADs and SSTOREs there are.
+		InsertPointGuard g{getBuilder()};
+		auto& entryBlock = getMainFunction()->front();
+		getBuilder().SetInsertPoint(entryBlock.getTerminator());
+		llvm::Type* elems[] =
+		{
+			llvm::ArrayType::get(Type::Word, c_storageCacheSize),	// keys
+			llvm::ArrayType::get(Type::Word, c_storageCacheSize),	// values
+			llvm::ArrayType::get(Type::Byte, c_storageCacheSize)	// valid flags
+		};
+		m_storageCache = getBuilder().CreateAlloca(llvm::StructType::get(getBuilder().getContext(), elems), nullptr, "storage.cache");
+		clearStorageCache();
+	}
+	return m_storageCache;
+}
+
+std::array<llvm::Value*, 3> Ext::getStorageCacheEntry(llvm::IRBuilder<>& _builder, llvm::Value* _cache, llvm::Value* _index)
+{
+	auto slot = _builder.CreateAnd(_builder.CreateTrunc(_index, Type::Size), _builder.getInt64(c_storageCacheSize - 1), "slot");
+	std::array<llvm::Value*, 3> ret;
+	for (unsigned i = 0; i < ret.size(); ++i)
+	{
+		llvm::Value* idxList[] = {_builder.getInt32(0), _builder.getInt32(i), slot};
+		ret[i] = _builder.CreateInBoundsGEP(_cache, idxList);
+	}
+	return ret;
+}
+
+void Ext::clearStorageCache()
+{
+	auto flags = m_builder.CreateStructGEP(m_storageCache, 2);
+	m_builder.CreateMemSet(m_builder.CreateBitCast(flags, Type::BytePtr), m_builder.getInt8(0), c_storageCacheSize, 1);
+}
+
+llvm::Function* Ext::getSloadFunc()
+{
+	if (!m_sloadFunc)
+	{
+		auto sloadEnv = m_funcs[static_cast<size_t>(EnvFunc::sload)];
+		if (!sloadEnv)
+			sloadEnv = m_funcs[static_cast<size_t>(EnvFunc::sload)] = createFunc(EnvFunc::sload, getModule());
+
+		llvm::Type* argTypes[] = {Type::EnvPtr, getStorageCache()->getType(), Type::WordPtr, Type::WordPtr};
+		m_sloadFunc = llvm::Function::Create(llvm::FunctionType::get(Type::Void, argTypes, false), llvm::Function::PrivateLinkage, "ext.sload", getModule());
+		m_sloadFunc->setDoesNotThrow();
+
+		auto env = &m_sloadFunc->getArgumentList().front();
+		env->setName("env");
+		auto cache = env->getNextNode();
+		cache->setName("cache");
+		auto indexPtr = cache->getNextNode();
+		indexPtr->setName("indexPtr");
+		auto valuePtr = indexPtr->getNextNode();
+		valuePtr->setName("valuePtr");
+
+		InsertPointGuard guard{m_builder};
+		auto checkBB = llvm::BasicBlock::Create(m_builder.getContext(), "Check", m_sloadFunc);
+		auto hitBB = llvm::BasicBlock::Create(m_builder.getContext(), "Hit", m_sloadFunc);
+		auto missBB = llvm::BasicBlock::Create(m_builder.getContext(), "Miss", m_sloadFunc);
+
+		m_builder.SetInsertPoint(checkBB);
+		auto index = m_builder.CreateLoad(indexPtr, "index");
+		auto entry = getStorageCacheEntry(m_builder, cache, index);
+		auto valid = m_builder.CreateICmpNE(m_builder.CreateLoad(entry[2]), m_builder.getInt8(0), "valid");
+		auto sameKey = m_builder.CreateICmpEQ(m_builder.CreateLoad(entry[0]), index, "sameKey");
+		m_builder.CreateCondBr(m_builder.CreateAnd(valid, sameKey), hitBB, missBB);
+
+		m_builder.SetInsertPoint(hitBB);
+		m_builder.CreateStore(m_builder.CreateLoad(entry[1]), valuePtr);
+		m_builder.CreateRetVoid();
+
+		m_builder.SetInsertPoint(missBB);
+		m_builder.CreateCall3(sloadEnv, env, indexPtr, valuePtr);
+		m_builder.CreateStore(index, entry[0]);
+		m_builder.CreateStore(m_builder.CreateLoad(valuePtr), entry[1]);
+		m_builder.CreateStore(m_builder.getInt8(1), entry[2]);
+		m_builder.CreateRetVoid();
+	}
+	return m_sloadFunc;
+}
+
 llvm::Value* Ext::sload(llvm::Value* _index)
 {
 	auto ret = getArgAlloca();
-	createCall(EnvFunc::sload, {getRuntimeManager().getEnvPtr(), byPtr(_index), ret}); // Uses native endianness
+	auto index = byPtr(_index);
+	m_argCounter = 0;
+	m_builder.CreateCall4(getSloadFunc(), getRuntimeManager().getEnvPtr(), getStorageCache(), index, ret); // Uses native endianness
 	return m_builder.CreateLoad(ret);
 }
 
 void Ext::sstore(llvm::Value* _index, llvm::Value* _value)
 {
 	createCall(EnvFunc::sstore, {getRuntimeManager().getEnvPtr(), byPtr(_index), byPtr(_value)}); // Uses native endianness
+	auto entry = getStorageCacheEntry(m_builder, getStorageCache(), _index);
+	m_builder.CreateStore(_index, entry[0]);
+	m_builder.CreateStore(_value, entry[1]);
+	m_builder.CreateStore(m_builder.getInt8(1), entry[2]);
 }
 
 llvm::Value* Ext::calldataload(llvm::Value* _index)
@@ -131,6 +228,8 @@ llvm::Value* Ext::create(llvm::Value* _endowment, llvm::Value* _initOff, llvm::V
 	auto begin = m_memoryMan.getBytePtr(_initOff);
 	auto size = m_builder.CreateTrunc(_initSize, Type::Size, "size");
 	createCall(EnvFunc::create, {getRuntimeManager().getEnvPtr(), getRuntimeManager().getGasPtr(), byPtr(_endowment), begin, size, ret});
+	if (m_storageCache)
+		clearStorageCache();
 	llvm::Value* address = m_builder.CreateLoad(ret);
 	address = Endianness::toNative(m_builder, address);
 	return address;
@@ -149,6 +248,8 @@ llvm::Value* Ext::call(llvm::Value* _callGas, llvm::Value* _receiveAddress, llvm
 			m_builder.CreateTrunc(_callGas, Type::Gas),
 			Constant::gasMax);
 	auto ret = createCall(EnvFunc::call, {getRuntimeManager().getEnvPtr(), getRuntimeManager().getGasPtr(), callGas, byPtr(receiveAddress), byPtr(_value), inBeg, inSize, outBeg, outSize, byPtr(codeAddress)});
+	if (m_storageCache)
+		clearStorageCache();
 	return m_builder.CreateZExt(ret, Type::Word, "ret");
 }
 
@@ -69,9 +69,21 @@ private:
 	std::array<llvm::Value*, 8> m_argAllocas;
 	size_t m_argCounter = 0;
 
+	/// Storage values seen in this execution, to save calls to the environment for SLOADs.
+	/// A direct-mapped table in the frame of the main function, kept up to date by SSTOREs
+	/// and emptied after calls and creations, which may change the storage themselves.
+	llvm::Value* m_storageCache = nullptr;
+	llvm::Function* m_sloadFunc = nullptr;
+
 	llvm::CallInst* createCall(EnvFunc _funcId, std::initializer_list<llvm::Value*> const& _args);
 	llvm::Value* getArgAlloca();
 	llvm::Value* byPtr(llvm::Value* _value);
+
+	llvm::Value* getStorageCache();
+	llvm::Function* getSloadFunc();
+	/// @returns pointers to the key, value and validity flag of the storage cache entry for @a _index.
+	std::array<llvm::Value*, 3> getStorageCacheEntry(llvm::IRBuilder<>& _builder, llvm::Value* _cache, llvm::Value* _index);
+	void clearStorageCache();
 };
 
 
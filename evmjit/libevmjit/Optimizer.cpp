@@ -13,14 +13,24 @@ namespace eth
 namespace jit
 {
 
-bool optimize(llvm::Module& _module)
+bool optimize(llvm::Module& _module, OptimizationTier _tier)
 {
 	auto pm = llvm::PassManager{};
 	//pm.add(llvm::createFunctionInliningPass(2, 2)); // Produces invalid IR
 	pm.add(llvm::createCFGSimplificationPass());
 	//pm.add(llvm::createInstructionCombiningPass()); // Produces invalid runtime results
+	if (_tier == OptimizationTier::Full)
+	{
+		pm.add(llvm::createPromoteMemoryToRegisterPass());
+		pm.add(llvm::createEarlyCSEPass());
+		pm.add(llvm::createGVNPass());
+		pm.add(llvm::createLoopSimplifyPass());
+		pm.add(llvm::createLICMPass());
+		pm.add(llvm::createDeadStoreEliminationPass());
+		pm.add(llvm::createCFGSimplificationPass());
+	}
 	pm.add(llvm::createAggressiveDCEPass());
-	pm.add(llvm::createLowerSwitchPass());
+	// The switch of the jump table is left for code generation to lower into a table of addresses.
 	return pm.run(_module);
 }
 
@@ -12,7 +12,14 @@ namespace eth
 namespace jit
 {
 
-bool optimize(llvm::Module& _module);
+/// How much compiled code is optimized.
+enum class OptimizationTier
+{
+	Fast,	///< Only cheap clean-ups, for the first compilation of code
+	Full	///< Redundancy elimination and loop optimizations as well, for code that is run often
+};
+
+bool optimize(llvm::Module& _module, OptimizationTier _tier);
 
 }
 }
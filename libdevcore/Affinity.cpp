@@ -0,0 +1,133 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Affinity.cpp
+ * @date 2015
+ */
+
+#include "Affinity.h"
+#include <map>
+#include <boost/algorithm/string.hpp>
+#include "Guards.h"
+#include "Numa.h"
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+using namespace std;
+using namespace dev;
+
+static Mutex x_affinity;
+static map<string, vector<unsigned>> s_affinity;
+
+vector<unsigned> dev::parseCpuSet(string const& _s)
+{
+	vector<unsigned> ret;
+	vector<string> parts;
+	boost::split(parts, _s, boost::is_any_of(","));
+	for (auto const& p: parts)
+	{
+		if (p.compare(0, 4, "node") == 0)
+		{
+			auto const& nodes = numaNodes();
+			try
+			{
+				size_t used = 0;
+				unsigned n = stoul(p.substr(4), &used);
+				if (used != p.size() - 4 || n >= nodes.size() || nodes[n].empty())
+					BOOST_THROW_EXCEPTION(BadCpuSet());
+				ret.insert(ret.end(), nodes[n].begin(), nodes[n].end());
+			}
+			catch (logic_error const&)
+			{
+				BOOST_THROW_EXCEPTION(BadCpuSet());
+			}
+			continue;
+		}
+		auto dash = p.find('-');
+		try
+		{
+			size_t used = 0;
+			unsigned b = stoul(p.substr(0, dash), &used);
+			if (used != min(dash, p.size()))
+				BOOST_THROW_EXCEPTION(BadCpuSet());
+			unsigned e = b;
+			if (dash != string::npos)
+			{
+				e = stoul(p.substr(dash + 1), &used);
+				if (used != p.size() - dash - 1 || e < b)
+					BOOST_THROW_EXCEPTION(BadCpuSet());
+			}
+			for (unsigned i = b; i <= e; ++i)
+				ret.push_back(i);
+		}
+		catch (logic_error const&)
+		{
+			BOOST_THROW_EXCEPTION(BadCpuSet());
+		}
+	}
+	return ret;
+}
+
+void dev::setThreadAffinity(string const& _prefix, vector<unsigned> const& _cpus)
+{
+	Guard l(x_affinity);
+	if (_cpus.empty())
+		s_affinity.erase(_prefix);
+	else
+		s_affinity[_prefix] = _cpus;
+}
+
+void dev::spreadOverNumaNodes(string const& _prefix, unsigned _count)
+{
+	vector<vector<unsigned>> nodes;
+	for (auto const& n: numaNodes())
+		if (!n.empty())
+			nodes.push_back(n);
+	for (unsigned i = 0; i < _count && !nodes.empty(); ++i)
+		setThreadAffinity(_prefix + to_string(i), nodes[i % nodes.size()]);
+}
+
+void dev::applyThreadAffinity(string const& _name)
+{
+	vector<unsigned> cpus;
+	{
+		Guard l(x_affinity);
+		if (s_affinity.empty())
+			return;
+		// Prefixes sort before what they prefix, so the longest match is the last one not after _name.
+		for (auto it = s_affinity.upper_bound(_name); it != s_affinity.begin();)
+			if (_name.compare(0, (--it)->first.size(), it->first) == 0)
+			{
+				cpus = it->second;
+				break;
+			}
+		if (cpus.empty() && s_affinity.count("*"))
+			cpus = s_affinity["*"];
+	}
+#if defined(__linux__)
+	if (cpus.empty())
+		return;
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (unsigned c: cpus)
+		if (c < CPU_SETSIZE)
+			CPU_SET(c, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+	(void)cpus;
+#endif
+}
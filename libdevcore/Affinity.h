@@ -0,0 +1,49 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Affinity.h
+ * @date 2015
+ * Pinning threads to sets of CPUs by the names they give themselves.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Exceptions.h"
+
+namespace dev
+{
+
+struct BadCpuSet: virtual Exception {};
+
+/// @returns the CPUs of @a _s, a list of numbers, ranges and NUMA nodes as "0-3,8" or "node1". Throws BadCpuSet if it
+/// is malformed or names a node there is not.
+std::vector<unsigned> parseCpuSet(std::string const& _s);
+
+/// Pins threads named, by setThreadName(), @a _prefix or @a _prefix followed by anything, to @a _cpus; of several
+/// matching prefixes the longest wins, and an empty @a _cpus unpins them. Threads already named are not moved, so call
+/// before starting them. The prefix "*" matches threads no other prefix does.
+void setThreadAffinity(std::string const& _prefix, std::vector<unsigned> const& _cpus);
+
+/// Pins the threads named @a _prefix followed by a number, from 0 to @a _count - 1, each to the CPUs of a NUMA node,
+/// going round the nodes with CPUs in turn.
+void spreadOverNumaNodes(std::string const& _prefix, unsigned _count);
+
+/// Pins the calling thread to the CPUs setThreadAffinity() gave for @a _name, if any. A no-op other than on Linux.
+void applyThreadAffinity(std::string const& _name);
+
+}
@@ -0,0 +1,66 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Arena.cpp
+ * @date 2015
+ */
+
+#include "Arena.h"
+#include <cstring>
+using namespace std;
+using namespace dev;
+
+const size_t Arena::c_defaultChunkSize;
+
+bytesRef Arena::copy(bytesConstRef _data)
+{
+	byte* p = static_cast<byte*>(allocate(_data.size(), 1));
+	memcpy(p, _data.data(), _data.size());
+	return bytesRef(p, _data.size());
+}
+
+void* Arena::grow(size_t _size, size_t _align)
+{
+	if (!m_chunks.empty())
+		m_allocated += m_used;
+	// Room for the alignment too, as new[] promises only that of max_align_t.
+	size_t size = max(m_chunkSize, _size + _align);
+	m_chunks.push_back(Chunk{unique_ptr<byte[]>(new byte[size]), size});
+	size_t p = aligned(m_chunks.back().data.get(), 0, _align);
+	m_used = p + _size;
+	return m_chunks.back().data.get() + p;
+}
+
+void Arena::reset()
+{
+	if (m_chunks.size() > 1)
+	{
+		// Next time, everything should fit in one chunk.
+		m_chunkSize = max(m_chunkSize, allocated());
+		m_chunks.clear();
+		m_chunks.push_back(Chunk{unique_ptr<byte[]>(new byte[m_chunkSize]), m_chunkSize});
+	}
+	m_used = 0;
+	m_allocated = 0;
+}
+
+size_t Arena::capacity() const
+{
+	size_t ret = 0;
+	for (auto const& c: m_chunks)
+		ret += c.size;
+	return ret;
+}
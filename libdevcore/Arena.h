@@ -0,0 +1,120 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Arena.h
+ * @date 2015
+ * A bump allocator for objects which all die together, such as those made while processing one block.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+#include "Common.h"
+
+namespace dev
+{
+
+/**
+ * @brief Memory handed out by bumping a pointer through large chunks, and given back all at once by reset().
+ * Nothing is freed singly, so that the many small objects made for one block or transaction cost neither a call
+ * to malloc each nor the fragmentation of the heap they would leave. reset() keeps a single chunk, as large as
+ * everything allocated since the last reset, so that a long-lived arena settles on one allocation.
+ * Destructors are not run: keep in it only trivial objects or those whose destruction frees nothing but memory
+ * from the same arena, such as containers using ArenaAllocator.
+ * @not threadsafe
+ */
+class Arena
+{
+public:
+	explicit Arena(size_t _chunkSize = c_defaultChunkSize): m_chunkSize(_chunkSize) {}
+	Arena(Arena const&) = delete;
+	Arena& operator=(Arena const&) = delete;
+
+	/// @returns @a _size bytes aligned to @a _align, which must be a power of two.
+	void* allocate(size_t _size, size_t _align = alignof(std::max_align_t))
+	{
+		if (!m_chunks.empty())
+		{
+			byte* base = m_chunks.back().data.get();
+			size_t p = aligned(base, m_used, _align);
+			if (p + _size <= m_chunks.back().size)
+			{
+				m_used = p + _size;
+				return base + p;
+			}
+		}
+		return grow(_size, _align);
+	}
+
+	/// @returns a copy of @a _data, valid until reset().
+	bytesRef copy(bytesConstRef _data);
+
+	/// Gives back everything allocated. Any object still using it must be gone.
+	void reset();
+
+	/// @returns the bytes allocated since the last reset().
+	size_t allocated() const { return m_allocated + m_used; }
+	/// @returns the bytes of the chunks held.
+	size_t capacity() const;
+
+	static const size_t c_defaultChunkSize = 64 * 1024;
+
+private:
+	struct Chunk
+	{
+		std::unique_ptr<byte[]> data;
+		size_t size;
+	};
+
+	void* grow(size_t _size, size_t _align);
+	/// @returns the first offset from @a _p, at or after @a _offset, aligned to @a _align.
+	static size_t aligned(byte const* _p, size_t _offset, size_t _align) { return ((reinterpret_cast<uintptr_t>(_p) + _offset + _align - 1) & ~uintptr_t(_align - 1)) - reinterpret_cast<uintptr_t>(_p); }
+
+	size_t m_chunkSize;
+	std::vector<Chunk> m_chunks;
+	size_t m_used = 0;				///< Of the last chunk.
+	size_t m_allocated = 0;			///< In the chunks before the last.
+};
+
+/// A standard allocator taking its memory from an Arena, for containers which die with it.
+template <class _T> class ArenaAllocator
+{
+public:
+	using value_type = _T;
+
+	ArenaAllocator(Arena& _arena): m_arena(&_arena) {}
+	template <class _U> ArenaAllocator(ArenaAllocator<_U> const& _a): m_arena(_a.arena()) {}
+
+	_T* allocate(size_t _n) { return static_cast<_T*>(m_arena->allocate(_n * sizeof(_T), alignof(_T))); }
+	void deallocate(_T*, size_t) {}
+
+	Arena* arena() const { return m_arena; }
+
+	template <class _U> bool operator==(ArenaAllocator<_U> const& _a) const { return m_arena == _a.arena(); }
+	template <class _U> bool operator!=(ArenaAllocator<_U> const& _a) const { return m_arena != _a.arena(); }
+
+private:
+	Arena* m_arena;
+};
+
+template <class _T> using ArenaVector = std::vector<_T, ArenaAllocator<_T>>;
+template <class _K, class _V, class _Compare = std::less<_K>> using ArenaMap = std::map<_K, _V, _Compare, ArenaAllocator<std::pair<_K const, _V>>>;
+
+}
@@ -72,8 +72,9 @@ inline bool assertEqualAux(A const& _a, B const& _b, char const* _aStr, char con
 /// Assertion that throws an exception containing the given description if it is not met.
 /// Use it as assertThrow(1 == 1, ExceptionType, "Mathematics is wrong.");
 /// Do NOT supply an exception object as the second parameter.
+/// The description is only evaluated if the assertion fails, so passing the check costs no string.
 #define assertThrow(_condition, _ExceptionType, _description) \
-	::dev::assertThrowAux<_ExceptionType>(_condition, _description, __LINE__, __FILE__, ETH_FUNC)
+	do { if (!(_condition)) ::dev::assertThrowAux<_ExceptionType>(false, _description, __LINE__, __FILE__, ETH_FUNC); } while (false)
 
 using errinfo_comment = boost::error_info<struct tag_comment, std::string>;
 
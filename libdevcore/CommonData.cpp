@@ -67,51 +67,70 @@ std::string dev::randomWord()
 	return ret;
 }
 
+/// The value of each hex character, or -1 for the other chars.
+static int8_t const c_hexValues[256] = {
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+	-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
 int dev::fromHex(char _i)
 {
-	if (_i >= '0' && _i <= '9')
-		return _i - '0';
-	if (_i >= 'a' && _i <= 'f')
-		return _i - 'a' + 10;
-	if (_i >= 'A' && _i <= 'F')
-		return _i - 'A' + 10;
-	BOOST_THROW_EXCEPTION(BadHexCharacter() << errinfo_invalidSymbol(_i));
+	int ret = c_hexValues[(byte)_i];
+	if (ret < 0)
+		BOOST_THROW_EXCEPTION(BadHexCharacter() << errinfo_invalidSymbol(_i));
+	return ret;
 }
 
-bytes dev::fromHex(std::string const& _s, WhenError _throw)
+/// Warns of the bad hex character @a _c, then throws if @a _throw says to.
+static void badHexCharacter(char _c, WhenError _throw)
 {
-	unsigned s = (_s[0] == '0' && _s[1] == 'x') ? 2 : 0;
-	std::vector<uint8_t> ret;
-	ret.reserve((_s.size() - s + 1) / 2);
-
-	if (_s.size() % 2)
-		try
-		{
-			ret.push_back(fromHex(_s[s++]));
-		}
-		catch (...)
-		{ 
-			ret.push_back(0);
-			// msvc does not support it
-#ifndef BOOST_NO_EXCEPTIONS
-			cwarn << boost::current_exception_diagnostic_information(); 
-#endif
-			if (_throw == WhenError::Throw)
-				throw;
-		}
-	for (unsigned i = s; i < _s.size(); i += 2)
-		try
-		{
-			ret.push_back((byte)(fromHex(_s[i]) * 16 + fromHex(_s[i + 1])));
-		}
-		catch (...){
-			ret.push_back(0);
+	try
+	{
+		fromHex(_c);
+	}
+	catch (...)
+	{
+		// msvc does not support it
 #ifndef BOOST_NO_EXCEPTIONS
-			cwarn << boost::current_exception_diagnostic_information();
+		cwarn << boost::current_exception_diagnostic_information();
 #endif
-			if (_throw == WhenError::Throw)
-				throw;
-		}
+		if (_throw == WhenError::Throw)
+			throw;
+	}
+}
+
+bytes dev::fromHex(std::string const& _s, WhenError _throw)
+{
+	unsigned s = (_s.size() >= 2 && _s[0] == '0' && _s[1] == 'x') ? 2 : 0;
+	bytes ret((_s.size() - s + 1) / 2);
+	byte const* in = (byte const*)_s.data() + s;
+	byte const* end = (byte const*)_s.data() + _s.size();
+	byte* out = ret.data();
+
+	if ((end - in) % 2)
+	{
+		int v = c_hexValues[*in];
+		if (v < 0)
+			badHexCharacter(*in, _throw);
+		*out++ = byte(max(v, 0));
+		++in;
+	}
+	// Each pair is looked up at once; a bad char in either gives a byte of zero.
+	for (; in != end; in += 2, ++out)
+	{
+		int h = c_hexValues[in[0]];
+		int l = c_hexValues[in[1]];
+		if ((h | l) < 0)
+			badHexCharacter(h < 0 ? in[0] : in[1], _throw);
+		else
+			*out = byte(h << 4 | l);
+	}
 	return ret;
 }
 
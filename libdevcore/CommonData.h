@@ -25,6 +25,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <iterator>
 #include <type_traits>
 #include <cstring>
 #include <string>
@@ -47,11 +48,36 @@ enum class WhenError
 template <class _T>
 std::string toHex(_T const& _data, int _w = 2)
 {
-	std::ostringstream ret;
-	unsigned ii = 0;
+	static char const c_hexDigits[] = "0123456789abcdef";
+	std::string ret(std::distance(std::begin(_data), std::end(_data)) * 2, '0');
+	size_t o = 0;
+	int w = _w;
 	for (auto i: _data)
-		ret << std::hex << std::setfill('0') << std::setw(ii++ ? 2 : _w) << (int)(typename std::make_unsigned<decltype(i)>::type)i;
-	return ret.str();
+	{
+		auto v = (typename std::make_unsigned<decltype(i)>::type)i;
+		if (w == 2 && v < 256)
+		{
+			// A byte, as all but the rarest calls give.
+			ret[o++] = c_hexDigits[v >> 4];
+			ret[o++] = c_hexDigits[v & 15];
+		}
+		else
+		{
+			char d[sizeof(v) * 2];
+			int n = 0;
+			do
+				d[n++] = c_hexDigits[v & 15];
+			while (v >>= 4);
+			// Room for two digits was made; make it what they need.
+			ret.resize(ret.size() + std::max(w, n) - 2);
+			for (; w > n; --w)
+				ret[o++] = '0';
+			while (n)
+				ret[o++] = d[--n];
+		}
+		w = 2;
+	}
+	return ret;
 }
 
 /// Converts a (printable) ASCII hex character into the correspnding integer value.
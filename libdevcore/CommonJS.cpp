@@ -32,7 +32,7 @@ bytes jsToBytes(string const& _s)
 {
 	if (_s.substr(0, 2) == "0x")
 		// Hex
-		return fromHex(_s.substr(2));
+		return fromHex(_s);
 	else if (_s.find_first_not_of("0123456789") == string::npos)
 		// Decimal
 		return toCompactBigEndian(bigint(_s));
@@ -93,7 +93,7 @@ template <unsigned N> boost::multiprecision::number<boost::multiprecision::cpp_i
 {
 	if (_s.substr(0, 2) == "0x")
 		// Hex
-		return fromBigEndian<boost::multiprecision::number<boost::multiprecision::cpp_int_backend<N * 8, N * 8, boost::multiprecision::unsigned_magnitude, boost::multiprecision::unchecked, void>>>(fromHex(_s.substr(2)));
+		return fromBigEndian<boost::multiprecision::number<boost::multiprecision::cpp_int_backend<N * 8, N * 8, boost::multiprecision::unsigned_magnitude, boost::multiprecision::unchecked, void>>>(fromHex(_s));
 	else if (_s.find_first_not_of("0123456789") == std::string::npos)
 		// Decimal
 		return boost::multiprecision::number<boost::multiprecision::cpp_int_backend<N * 8, N * 8, boost::multiprecision::unsigned_magnitude, boost::multiprecision::unchecked, void>>(_s);
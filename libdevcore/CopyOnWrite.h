@@ -0,0 +1,67 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file CopyOnWrite.h
+ * @date 2015
+ * A value shared by its copies until one of them changes it.
+ */
+
+#pragma once
+
+#include <memory>
+
+namespace dev
+{
+
+/**
+ * @brief Holds a @a _T which copies of the holder share, copying it only when a holder which is not alone
+ * asks to change it through write().
+ * Copying the holder is then constant-time, for the many copies which are only read, or are thrown away before
+ * they are written. Reads go through * and ->, which never copy.
+ * Copies may be read and written by different threads, as with any two objects; a single holder is no more
+ * threadsafe than the @a _T it holds.
+ */
+template <class _T> class CopyOnWrite
+{
+public:
+	CopyOnWrite(): m_p(std::make_shared<_T>()) {}
+	CopyOnWrite(_T _v): m_p(std::make_shared<_T>(std::move(_v))) {}
+	// Declared so that there is no move, which would leave the holder moved from with nothing.
+	CopyOnWrite(CopyOnWrite const&) = default;
+	CopyOnWrite& operator=(CopyOnWrite const&) = default;
+
+	_T const& operator*() const { return *m_p; }
+	_T const* operator->() const { return m_p.get(); }
+
+	/// @returns the value to change, copying it first if another holder shares it.
+	_T& write()
+	{
+		if (m_p.use_count() > 1)
+			m_p = std::make_shared<_T>(*m_p);
+		return *m_p;
+	}
+
+	/// Gives this holder a new, default value, leaving any other holders the old one.
+	void reset() { m_p = std::make_shared<_T>(); }
+
+	/// @returns true if another holder shares the value.
+	bool shared() const { return m_p.use_count() > 1; }
+
+private:
+	std::shared_ptr<_T> m_p;
+};
+
+}
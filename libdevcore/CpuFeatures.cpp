@@ -0,0 +1,133 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file CpuFeatures.cpp
+ * @date 2015
+ */
+
+#include "CpuFeatures.h"
+#include <cstdlib>
+#include <sstream>
+#include "Guards.h"
+using namespace std;
+using namespace dev;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ETH_CPUID 1
+#include <cpuid.h>
+#elif defined(__linux__) && (defined(__aarch64__) || defined(__arm__))
+#define ETH_HWCAP 1
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+static const pair<CpuFeature, char const*> c_featureNames[] =
+{
+	{ CpuSSSE3, "ssse3" },
+	{ CpuSSE41, "sse4.1" },
+	{ CpuAVX2, "avx2" },
+	{ CpuAVX512F, "avx512f" },
+	{ CpuSHA, "sha" },
+	{ CpuNEON, "neon" },
+	{ CpuSHA2, "sha2" }
+};
+
+static unsigned detectFeatures()
+{
+	unsigned ret = 0;
+#if ETH_CPUID
+	unsigned a, b, c, d;
+	if (__get_cpuid(1, &a, &b, &c, &d))
+	{
+		if (c & bit_SSSE3)
+			ret |= CpuSSSE3;
+		if (c & bit_SSE4_1)
+			ret |= CpuSSE41;
+	}
+	if (__get_cpuid_max(0, nullptr) >= 7)
+	{
+		__cpuid_count(7, 0, a, b, c, d);
+		// Only if the operating system saves the YMM and ZMM registers, too; __builtin_cpu_supports() checks that.
+		__builtin_cpu_init();
+		if ((b & (1u << 5)) && __builtin_cpu_supports("avx2"))
+			ret |= CpuAVX2;
+		if ((b & (1u << 16)) && __builtin_cpu_supports("avx512f"))
+			ret |= CpuAVX512F;
+		if (b & (1u << 29))
+			ret |= CpuSHA;
+	}
+#elif ETH_HWCAP && defined(__aarch64__)
+	unsigned long caps = getauxval(AT_HWCAP);
+	if (caps & HWCAP_ASIMD)
+		ret |= CpuNEON;
+	if (caps & HWCAP_SHA2)
+		ret |= CpuSHA2;
+#elif ETH_HWCAP
+	if (getauxval(AT_HWCAP) & HWCAP_NEON)
+		ret |= CpuNEON;
+	if (getauxval(AT_HWCAP2) & HWCAP2_SHA2)
+		ret |= CpuSHA2;
+#endif
+
+	if (char const* disabled = getenv("ETH_CPU_DISABLE"))
+	{
+		istringstream names(disabled);
+		for (string name; names >> name;)
+			for (auto const& f: c_featureNames)
+				if (name == f.second)
+					ret &= ~f.first;
+	}
+	return ret;
+}
+
+unsigned dev::cpuFeatures()
+{
+	static unsigned const s_features = detectFeatures();
+	return s_features;
+}
+
+string dev::cpuFeatureNames(unsigned _features)
+{
+	string ret;
+	for (auto const& f: c_featureNames)
+		if (_features & f.first)
+			ret += (ret.empty() ? "" : " ") + string(f.second);
+	return ret;
+}
+
+static Mutex& kernelsMutex()
+{
+	static Mutex s_mutex;
+	return s_mutex;
+}
+
+static map<string, string>& kernels()
+{
+	static map<string, string> s_kernels;
+	return s_kernels;
+}
+
+void dev::noteCpuKernel(string const& _kernel, string const& _impl)
+{
+	Guard l(kernelsMutex());
+	kernels()[_kernel] = _impl;
+}
+
+map<string, string> dev::cpuKernels()
+{
+	Guard l(kernelsMutex());
+	return kernels();
+}
@@ -0,0 +1,95 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file CpuFeatures.h
+ * @date 2015
+ * Detection of the instruction set extensions of the CPU we run on, and picking kernels by them.
+ */
+
+#pragma once
+
+#include <initializer_list>
+#include <map>
+#include <string>
+
+namespace dev
+{
+
+/// Instruction set extensions a kernel may need, as bits of a mask.
+enum CpuFeature: unsigned
+{
+	CpuSSSE3 = 1 << 0,
+	CpuSSE41 = 1 << 1,
+	CpuAVX2 = 1 << 2,
+	CpuAVX512F = 1 << 3,
+	CpuSHA = 1 << 4,		///< The x86 SHA extensions.
+	CpuNEON = 1 << 5,		///< ARM Advanced SIMD.
+	CpuSHA2 = 1 << 6		///< The ARMv8 SHA-256 instructions.
+};
+
+/// @returns the features of this CPU, by cpuid on x86 and the hardware capabilities on ARM Linux.
+/// Those named in the environment variable ETH_CPU_DISABLE, as by cpuFeatureNames(), are left out.
+unsigned cpuFeatures();
+
+/// @returns the names of @a _features, separated by spaces.
+std::string cpuFeatureNames(unsigned _features);
+
+/// Records that @a _impl was picked for the kernel @a _kernel, for cpuKernels().
+void noteCpuKernel(std::string const& _kernel, std::string const& _impl);
+
+/// @returns the implementation picked for each kernel so far, by kernel.
+std::map<std::string, std::string> cpuKernels();
+
+/**
+ * @brief The implementations of a kernel for several instruction sets, of which the first this CPU has is picked
+ * on construction. Kept at namespace scope, so that all the kernels are picked, and reported, on startup.
+ * @code
+ * static CpuDispatch<Compress> const s_compress("sha256", {{"sha", CpuSHA | CpuSSE41, compressNative}, {"portable", 0, compressPortable}});
+ * s_compress()(state, blocks, count);
+ * @endcode
+ */
+template <class F>
+class CpuDispatch
+{
+public:
+	struct Impl
+	{
+		char const* name;
+		unsigned features;	///< Those it needs.
+		F f;
+	};
+
+	/// @a _impls are in order of preference; the last should need no features.
+	CpuDispatch(char const* _kernel, std::initializer_list<Impl> _impls)
+	{
+		unsigned have = cpuFeatures();
+		for (Impl const& i: _impls)
+			if ((i.features & have) == i.features)
+			{
+				m_picked = i;
+				break;
+			}
+		noteCpuKernel(_kernel, m_picked.name ? m_picked.name : "none");
+	}
+
+	F operator()() const { return m_picked.f; }
+	char const* name() const { return m_picked.name; }
+
+private:
+	Impl m_picked = Impl{nullptr, 0, nullptr};
+};
+
+}
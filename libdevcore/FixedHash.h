@@ -80,14 +80,15 @@ public:
 	operator Arith() const { return fromBigEndian<Arith>(m_data); }
 
 	/// @returns true iff this is the empty hash.
-	explicit operator bool() const { return ((Arith)*this) != 0; }
+	explicit operator bool() const { return std::any_of(m_data.begin(), m_data.end(), [](byte _b) { return _b != 0; }); }
 
 	// The obvious comparison operators.
-	bool operator==(FixedHash const& _c) const { return m_data == _c.m_data; }
-	bool operator!=(FixedHash const& _c) const { return m_data != _c.m_data; }
-	bool operator<(FixedHash const& _c) const { for (unsigned i = 0; i < N; ++i) if (m_data[i] < _c.m_data[i]) return true; else if (m_data[i] > _c.m_data[i]) return false; return false; }
+	// The byte order is big-endian, so memcmp's order is the numeric one; the C library's is vectorised.
+	bool operator==(FixedHash const& _c) const { return !memcmp(m_data.data(), _c.m_data.data(), N); }
+	bool operator!=(FixedHash const& _c) const { return !operator==(_c); }
+	bool operator<(FixedHash const& _c) const { return memcmp(m_data.data(), _c.m_data.data(), N) < 0; }
 	bool operator>=(FixedHash const& _c) const { return !operator<(_c); }
-	bool operator<=(FixedHash const& _c) const { return operator==(_c) || operator<(_c); }
+	bool operator<=(FixedHash const& _c) const { return memcmp(m_data.data(), _c.m_data.data(), N) <= 0; }
 	bool operator>(FixedHash const& _c) const { return !operator<=(_c); }
 
 	// The obvious binary operators.
@@ -100,7 +101,8 @@ public:
 	FixedHash& operator~() { for (unsigned i = 0; i < N; ++i) m_data[i] = ~m_data[i]; return *this; }
 
 	/// @returns true if all bytes in @a _c are set in this object.
-	bool contains(FixedHash const& _c) const { return (*this & _c) == _c; }
+	/// Without an early exit, so that the loop vectorises, as do those of the binary operators.
+	bool contains(FixedHash const& _c) const { byte missing = 0; for (unsigned i = 0; i < N; ++i) missing |= _c.m_data[i] & ~m_data[i]; return !missing; }
 
 	/// @returns a particular byte from the hash.
 	byte& operator[](unsigned _i) { return m_data[_i]; }
@@ -162,7 +164,7 @@ public:
 		return (*this |= _h.template bloom<P, N>());
 	}
 
-	template <unsigned P, unsigned M> inline bool containsBloom(FixedHash<M> const& _h)
+	template <unsigned P, unsigned M> inline bool containsBloom(FixedHash<M> const& _h) const
 	{
 		return contains(_h.template bloom<P, N>());
 	}
@@ -20,10 +20,100 @@
  */
 
 #include "Guards.h"
+#include <algorithm>
+#include <map>
+#include <memory>
+#include "Log.h"
+#include "ThreadPool.h"
 using namespace std;
 using namespace dev;
 
-namespace dev
+namespace
 {
 
+struct LockProfileChannel: public LogChannel { static const char* name() { return "#L#"; } static const int verbosity = 1; };
+
+/// The stats of each name. Plain std::mutex, as it is taken while profiling the others.
+struct LockRegistry
+{
+	std::mutex x_stats;
+	map<string, unique_ptr<LockStats>> stats;
+	LockStats unnamed;
+};
+
+/// Leaked, so that locks destroyed after the end of main still have somewhere to count.
+LockRegistry& lockRegistry()
+{
+	static LockRegistry* s_this = new LockRegistry;
+	return *s_this;
+}
+
+atomic<unsigned> s_logGeneration{0};
+
+void logLockProfile(unsigned _generation, unsigned _seconds, unsigned _max)
+{
+	if (_generation != s_logGeneration)
+		return;
+	auto p = lockProfile();
+	clog(LockProfileChannel) << "Lock profile, the most waited for first:";
+	for (size_t i = 0; i < p.size() && i < _max && p[i].acquisitions; ++i)
+		clog(LockProfileChannel) << p[i].name << p[i].acquisitions << "taken," << p[i].contentions << "contended; waited" << p[i].waitMs << "ms (longest" << p[i].maxWaitMs << "ms); held" << p[i].holdMs << "ms (longest" << p[i].maxHoldMs << "ms)";
+	ThreadPool::get().schedule(chrono::seconds(_seconds), [=]() { logLockProfile(_generation, _seconds, _max); }, TaskPriority::Low);
+}
+
+#if ETH_LOCK_PROFILING
+LockProfile snapshot(string const& _name, LockStats const& _s)
+{
+	return LockProfile{_name, _s.acquisitions, _s.contentions, _s.waitNs / 1e6, _s.maxWaitNs / 1e6, _s.holdNs / 1e6, _s.maxHoldNs / 1e6};
+}
+#endif
+
+}
+
+LockStats& dev::lockStats(char const* _name)
+{
+	auto& r = lockRegistry();
+	if (!_name)
+		return r.unnamed;
+	lock_guard<std::mutex> l(r.x_stats);
+	auto& s = r.stats[_name];
+	if (!s)
+		s.reset(new LockStats);
+	return *s;
+}
+
+vector<LockProfile> dev::lockProfile()
+{
+	vector<LockProfile> ret;
+#if ETH_LOCK_PROFILING
+	auto& r = lockRegistry();
+	{
+		lock_guard<std::mutex> l(r.x_stats);
+		for (auto const& s: r.stats)
+			ret.push_back(snapshot(s.first, *s.second));
+	}
+	ret.push_back(snapshot("(unnamed)", r.unnamed));
+	sort(ret.begin(), ret.end(), [](LockProfile const& _a, LockProfile const& _b) { return _a.waitMs > _b.waitMs; });
+#endif
+	return ret;
+}
+
+void dev::resetLockProfile()
+{
+	auto& r = lockRegistry();
+	auto reset = [](LockStats& _s)
+	{
+		_s.acquisitions = _s.contentions = _s.waitNs = _s.maxWaitNs = _s.holdNs = _s.maxHoldNs = 0;
+	};
+	lock_guard<std::mutex> l(r.x_stats);
+	for (auto const& s: r.stats)
+		reset(*s.second);
+	reset(r.unnamed);
+}
+
+void dev::setLockProfileLogging(unsigned _seconds, unsigned _max)
+{
+	unsigned g = ++s_logGeneration;
+	if (_seconds)
+		ThreadPool::get().schedule(chrono::seconds(_seconds), [=]() { logLockProfile(g, _seconds, _max); }, TaskPriority::Low);
 }
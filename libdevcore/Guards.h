@@ -21,21 +21,145 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <mutex>
+#include <string>
+#include <vector>
 #include <boost/thread.hpp>
 
 namespace dev
 {
 
+/// What is known of the locking of the locks of one name, while built with ETH_LOCK_PROFILING.
+struct LockStats
+{
+	std::atomic<uint64_t> acquisitions{0};
+	std::atomic<uint64_t> contentions{0};	///< Acquisitions which had to wait for another thread.
+	std::atomic<uint64_t> waitNs{0};		///< Spent waiting, in all.
+	std::atomic<uint64_t> maxWaitNs{0};
+	std::atomic<uint64_t> holdNs{0};		///< Spent holding exclusively, in all. Shared holds aren't timed.
+	std::atomic<uint64_t> maxHoldNs{0};
+
+	void waited(uint64_t _ns) { ++contentions; waitNs += _ns; raise(maxWaitNs, _ns); }
+	void held(uint64_t _ns) { holdNs += _ns; raise(maxHoldNs, _ns); }
+
+private:
+	static void raise(std::atomic<uint64_t>& io_max, uint64_t _v) { for (uint64_t m = io_max; _v > m && !io_max.compare_exchange_weak(m, _v);) {} }
+};
+
+/// @returns the stats of the locks named @a _name, or of all unnamed locks if null. Never freed.
+LockStats& lockStats(char const* _name);
+
+/// A snapshot of the LockStats of one name.
+struct LockProfile
+{
+	std::string name;
+	uint64_t acquisitions;
+	uint64_t contentions;
+	double waitMs;
+	double maxWaitMs;
+	double holdMs;
+	double maxHoldMs;
+};
+
+/// @returns a snapshot of all lock stats, the longest waited for first; empty unless built with ETH_LOCK_PROFILING.
+std::vector<LockProfile> lockProfile();
+
+/// Zeroes all lock stats.
+void resetLockProfile();
+
+/// Logs the @a _max most waited for locks every @a _seconds, or stops doing so if 0.
+void setLockProfileLogging(unsigned _seconds, unsigned _max = 10);
+
+/**
+ * @brief A lock which counts into LockStats how often it is taken and contended, and how long it is waited for
+ * and held, for finding lock convoys. Any lock of the standard or boost kinds may be wrapped; only the operations
+ * the wrapped lock has may be used.
+ * Taking it uncontended costs a try_lock and a clock read more than the wrapped lock.
+ */
+template <class _M> class ProfiledMutex
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	ProfiledMutex(): m_stats(&lockStats(nullptr)) {}
+	ProfiledMutex(ProfiledMutex const&) = delete;
+	ProfiledMutex& operator=(ProfiledMutex const&) = delete;
+
+	/// Counts this in with the other locks named @a _name, a string literal.
+	void setName(char const* _name) { m_stats = &lockStats(_name); }
+
+	void lock() { acquire([&]() { return m_m.try_lock(); }, [&]() { m_m.lock(); }); startHold(); }
+	bool try_lock() { if (!m_m.try_lock()) return false; ++m_stats->acquisitions; startHold(); return true; }
+	void unlock() { uint64_t ns = endHold(); m_m.unlock(); if (ns) m_stats->held(ns); }
+
+	void lock_shared() { acquire([&]() { return m_m.try_lock_shared(); }, [&]() { m_m.lock_shared(); }); }
+	bool try_lock_shared() { if (!m_m.try_lock_shared()) return false; ++m_stats->acquisitions; return true; }
+	void unlock_shared() { m_m.unlock_shared(); }
+
+	void lock_upgrade() { acquire([&]() { return m_m.try_lock_upgrade(); }, [&]() { m_m.lock_upgrade(); }); }
+	bool try_lock_upgrade() { if (!m_m.try_lock_upgrade()) return false; ++m_stats->acquisitions; return true; }
+	void unlock_upgrade() { m_m.unlock_upgrade(); }
+	void unlock_upgrade_and_lock()
+	{
+		if (!m_m.try_unlock_upgrade_and_lock())
+		{
+			auto t = Clock::now();
+			m_m.unlock_upgrade_and_lock();
+			waitedSince(t);
+		}
+		startHold();
+	}
+	void unlock_and_lock_upgrade() { uint64_t ns = endHold(); m_m.unlock_and_lock_upgrade(); if (ns) m_stats->held(ns); }
+
+private:
+	template <class _Try, class _Lock> void acquire(_Try const& _try, _Lock const& _lock)
+	{
+		++m_stats->acquisitions;
+		if (_try())
+			return;
+		auto t = Clock::now();
+		_lock();
+		waitedSince(t);
+	}
+	void waitedSince(Clock::time_point _t) { m_stats->waited(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - _t).count()); }
+
+	/// Called holding the lock exclusively; times only the outermost hold of a recursive lock.
+	void startHold() { if (!m_depth++) m_since = Clock::now(); }
+	/// @returns how long the lock was held, if this is the outermost hold, else 0.
+	uint64_t endHold() { return --m_depth ? 0 : std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_since).count(); }
+
+	_M m_m;
+	LockStats* m_stats;
+	unsigned m_depth = 0;					///< Exclusive holds; touched only by the holder.
+	Clock::time_point m_since;				///< When the outermost exclusive hold began.
+};
+
+#if ETH_LOCK_PROFILING
+using Mutex = ProfiledMutex<std::mutex>;
+using RecursiveMutex = ProfiledMutex<std::recursive_mutex>;
+using SharedMutex = ProfiledMutex<boost::shared_mutex>;
+/// To wait with a Mutex, which std::condition_variable takes only unwrapped.
+using Condition = std::condition_variable_any;
+#else
 using Mutex = std::mutex;
 using RecursiveMutex = std::recursive_mutex;
 using SharedMutex = boost::shared_mutex;
+/// To wait with a Mutex.
+using Condition = std::condition_variable;
+#endif
+
+/// Names @a _m for the lock profile, if it is profiled.
+template <class _M> inline void setLockName(_M&, char const*) {}
+template <class _M> inline void setLockName(ProfiledMutex<_M>& _m, char const* _name) { _m.setName(_name); }
 
-using Guard = std::lock_guard<std::mutex>;
-using RecursiveGuard = std::lock_guard<std::recursive_mutex>;
-using ReadGuard = boost::shared_lock<boost::shared_mutex>;
-using UpgradableGuard = boost::upgrade_lock<boost::shared_mutex>;
-using UpgradeGuard = boost::upgrade_to_unique_lock<boost::shared_mutex>;
-using WriteGuard = boost::unique_lock<boost::shared_mutex>;
+using Guard = std::lock_guard<Mutex>;
+using RecursiveGuard = std::lock_guard<RecursiveMutex>;
+using ReadGuard = boost::shared_lock<SharedMutex>;
+using UpgradableGuard = boost::upgrade_lock<SharedMutex>;
+using UpgradeGuard = boost::upgrade_to_unique_lock<SharedMutex>;
+using WriteGuard = boost::unique_lock<SharedMutex>;
 
 }
@@ -0,0 +1,101 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file HashFilter.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include "FixedHash.h"
+
+namespace dev
+{
+
+/**
+ * @brief Remembers about the last @a _capacity hashes inserted, in fixed memory, as a pair of bloom filters.
+ * Inserts go to the newer filter; once it has taken half the capacity, the older is cleared and takes its place.
+ * contains() never misses any of the last half-capacity hashes inserted, but may report one never inserted
+ * (about 1 in 200 times, when full). The hashes are assumed to be uniformly distributed, as SHA3 hashes are.
+ */
+class HashFilter
+{
+public:
+	explicit HashFilter(unsigned _capacity = 8192): m_half(std::max(_capacity / 2, 1u))
+	{
+		for (auto& f: m_filters)
+			f.resize(m_half * c_bitsPerEntry / 64 + 1);
+	}
+
+	void insert(h256 const& _h)
+	{
+		if (test(m_filters[0], _h))
+			return;
+		if (m_count == m_half)
+		{
+			std::swap(m_filters[0], m_filters[1]);
+			std::fill(m_filters[0].begin(), m_filters[0].end(), 0);
+			m_count = 0;
+		}
+		auto& f = m_filters[0];
+		for (unsigned i = 0; i < c_probes; ++i)
+		{
+			auto b = bit(f, _h, i);
+			f[b / 64] |= uint64_t(1) << (b % 64);
+		}
+		++m_count;
+	}
+
+	bool contains(h256 const& _h) const { return test(m_filters[0], _h) || test(m_filters[1], _h); }
+
+	void clear()
+	{
+		for (auto& f: m_filters)
+			std::fill(f.begin(), f.end(), 0);
+		m_count = 0;
+	}
+
+private:
+	static const unsigned c_bitsPerEntry = 16;
+	static const unsigned c_probes = 4;
+
+	/// @returns the bit of @a _f for the @a _i th probe of @a _h, taken from the hash's @a _i th 32-bit word.
+	static size_t bit(std::vector<uint64_t> const& _f, h256 const& _h, unsigned _i)
+	{
+		byte const* p = _h.data() + _i * 4;
+		return (uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24) % (_f.size() * 64);
+	}
+
+	static bool test(std::vector<uint64_t> const& _f, h256 const& _h)
+	{
+		for (unsigned i = 0; i < c_probes; ++i)
+		{
+			auto b = bit(_f, _h, i);
+			if (!(_f[b / 64] & (uint64_t(1) << (b % 64))))
+				return false;
+		}
+		return true;
+	}
+
+	unsigned m_half;
+	unsigned m_count = 0;								///< Hashes in m_filters[0].
+	std::array<std::vector<uint64_t>, 2> m_filters;		///< The newer first.
+};
+
+}
@@ -21,8 +21,11 @@
 
 #include "Log.h"
 
+#include <algorithm>
+#include <atomic>
 #include <string>
 #include <iostream>
+#include <thread>
 #include "Guards.h"
 using namespace std;
 using namespace dev;
@@ -38,10 +41,16 @@ ThreadLocalLogName dev::t_logThreadName("main");
 extern "C" __declspec(dllimport) void __stdcall OutputDebugStringA(const char* lpOutputString);
 #endif
 
+// At namespace scope rather than in the functions using them, so as to outlive s_asyncLog, which posts what remains
+// when destroyed.
+static Mutex s_debugOutLock;
+static Mutex s_timeLock;
+static time_t s_lastTime = 0;
+static char s_lastFormatted[24] = "";
+
 void dev::simpleDebugOut(std::string const& _s, char const*)
 {
-	static Mutex s_lock;
-	Guard l(s_lock);
+	Guard l(s_debugOutLock);
 
 	cerr << _s << endl << flush;
 
@@ -56,3 +65,191 @@ void dev::simpleDebugOut(std::string const& _s, char const*)
 
 std::function<void(std::string const&, char const*)> dev::g_logPost = simpleDebugOut;
 
+/// @returns @a _r formatted as a line of the log.
+static string formatLog(LogRecord const& _r)
+{
+	// Formatting the time is dear, and entries come many to the second, so the last is kept.
+	char buf[24];
+	time_t rawTime = chrono::system_clock::to_time_t(_r.time);
+	{
+		Guard l(s_timeLock);
+		if (rawTime != s_lastTime)
+		{
+			if (strftime(s_lastFormatted, 24, "%X", localtime(&rawTime)) == 0)
+				s_lastFormatted[0] = '\0'; // empty if case strftime fails
+			s_lastTime = rawTime;
+		}
+		memcpy(buf, s_lastFormatted, 24);
+	}
+	string ret;
+	ret.reserve(16 + strlen(buf) + _r.thread.size() + _r.text.size());
+	ret += _r.channel;
+	ret += " [ ";
+	ret += buf;
+	ret += " | ";
+	ret += _r.thread;
+	if (_r.term)
+		ret += " ] ";
+	ret += _r.text;
+	return ret;
+}
+
+namespace
+{
+
+/// The entries logged by one thread, waiting to be posted. Only that thread puts entries in and only the logging
+/// thread takes them out, so neither takes a lock.
+struct LogRing
+{
+	explicit LogRing(size_t _size): entries(_size) {}
+
+	vector<LogRecord> entries;
+	atomic<size_t> head{0};			///< One past the last entry put in, ever; only the logging thread writes this.
+	atomic<size_t> tail{0};			///< The first entry not yet taken out, ever; only the logging thread writes this.
+	atomic<bool> orphaned{false};	///< The thread has exited; once emptied, the ring may go.
+};
+
+/// Posts entries from the rings of all threads on a thread of its own.
+class AsyncLog
+{
+public:
+	~AsyncLog() { stop(); }
+
+	void start(size_t _ringSize)
+	{
+		Guard l(x_rings);
+		if (m_thread.joinable())
+			return;
+		m_ringSize = max<size_t>(_ringSize, 2);
+		m_running = true;
+		m_thread = thread([this](){ run(); });
+	}
+
+	void stop()
+	{
+		{
+			Guard l(x_rings);
+			if (!m_thread.joinable())
+				return;
+			m_running = false;
+		}
+		m_thread.join();
+		drain();
+	}
+
+	bool running() const { return m_running; }
+
+	/// @returns false, dropping @a _r, if this thread's ring is full.
+	bool push(LogRecord&& _r)
+	{
+		LogRing& ring = threadRing();
+		size_t h = ring.head.load(memory_order_relaxed);
+		if (h - ring.tail.load(memory_order_acquire) >= ring.entries.size())
+			return false;
+		ring.entries[h % ring.entries.size()] = move(_r);
+		ring.head.store(h + 1, memory_order_release);
+		return true;
+	}
+
+private:
+	/// Keeps a thread's ring alive for as long as either it or the logging thread has use of it.
+	struct RingHolder
+	{
+		explicit RingHolder(shared_ptr<LogRing> const& _r): ring(_r) {}
+		~RingHolder() { ring->orphaned = true; }
+		shared_ptr<LogRing> ring;
+	};
+
+	LogRing& threadRing()
+	{
+		if (!m_threadRing.get())
+		{
+			Guard l(x_rings);
+			auto r = make_shared<LogRing>(m_ringSize);
+			m_rings.push_back(r);
+			m_threadRing.reset(new RingHolder(r));
+		}
+		return *m_threadRing->ring;
+	}
+
+	void run()
+	{
+		setThreadName("log");
+		while (m_running)
+			if (!drain())
+				this_thread::sleep_for(chrono::milliseconds(5));
+	}
+
+	/// Posts what entries are waiting, oldest first. @returns true if there were any.
+	bool drain()
+	{
+		vector<shared_ptr<LogRing>> rings;
+		{
+			Guard l(x_rings);
+			m_rings.erase(remove_if(m_rings.begin(), m_rings.end(), [](shared_ptr<LogRing> const& _r)
+			{
+				return _r->orphaned && _r->head == _r->tail;
+			}), m_rings.end());
+			rings = m_rings;
+		}
+		vector<LogRecord> batch;
+		for (auto const& r: rings)
+		{
+			size_t t = r->tail.load(memory_order_relaxed);
+			size_t h = r->head.load(memory_order_acquire);
+			for (; t != h; ++t)
+				batch.push_back(move(r->entries[t % r->entries.size()]));
+			r->tail.store(t, memory_order_release);
+		}
+		stable_sort(batch.begin(), batch.end(), [](LogRecord const& _a, LogRecord const& _b) { return _a.time < _b.time; });
+		for (auto const& r: batch)
+			g_logPost(formatLog(r), r.channel);
+
+		uint64_t dropped = s_dropped;
+		if (dropped != m_droppedReported)
+		{
+			g_logPost(string(WarnChannel::name()) + " [ log ] " + toString(dropped - m_droppedReported) + " log entries dropped", WarnChannel::name());
+			m_droppedReported = dropped;
+		}
+		return !batch.empty();
+	}
+
+	Mutex x_rings;
+	vector<shared_ptr<LogRing>> m_rings;
+	size_t m_ringSize = 4096;
+	boost::thread_specific_ptr<RingHolder> m_threadRing;
+	atomic<bool> m_running{false};
+	thread m_thread;
+	uint64_t m_droppedReported = 0;
+
+public:
+	static atomic<uint64_t> s_dropped;
+};
+
+atomic<uint64_t> AsyncLog::s_dropped{0};
+
+}
+
+// After g_logPost, so as to be destroyed, and so post what remains, before it.
+static AsyncLog s_asyncLog;
+
+void dev::postLog(LogRecord&& _r)
+{
+	if (!s_asyncLog.running())
+		g_logPost(formatLog(_r), _r.channel);
+	else if (!s_asyncLog.push(move(_r)))
+		++AsyncLog::s_dropped;
+}
+
+void dev::setAsyncLogging(bool _async, size_t _ringSize)
+{
+	if (_async)
+		s_asyncLog.start(_ringSize);
+	else
+		s_asyncLog.stop();
+}
+
+uint64_t dev::droppedLogEntries()
+{
+	return AsyncLog::s_dropped;
+}
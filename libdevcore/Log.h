@@ -25,9 +25,12 @@
 
 #include <ctime>
 #include <chrono>
+#include <ostream>
+#include <streambuf>
 #include <boost/thread.hpp>
 #include "vector_ref.h"
 #include "CommonIO.h"
+#include "Affinity.h"
 
 namespace dev
 {
@@ -42,6 +45,12 @@ public:
 /// A simple log-output function that prints log messages to stdout.
 void simpleDebugOut(std::string const&, char const*);
 
+/// Channels more verbose than this are compiled out of clog(), cslog(), cnote and cwarn altogether, whatever
+/// g_logVerbosity or g_logOverride say.
+#ifndef ETH_LOG_MAX_VERBOSITY
+#define ETH_LOG_MAX_VERBOSITY 1000
+#endif
+
 /// The logging system's current verbosity.
 extern int g_logVerbosity;
 
@@ -63,8 +72,54 @@ struct ThreadLocalLogName
 /// The current thread's name.
 extern ThreadLocalLogName t_logThreadName;
 
-/// Set the current thread's log name.
-inline void setThreadName(char const* _n) { t_logThreadName.m_name.reset(new std::string(_n)); }
+/// Set the current thread's log name, and pin it to the CPUs setThreadAffinity() gave for the name.
+inline void setThreadName(char const* _n) { t_logThreadName.m_name.reset(new std::string(_n)); applyThreadAffinity(_n); }
+
+/// A log entry, as yet unformatted.
+struct LogRecord
+{
+	char const* channel = nullptr;					///< The channel's name().
+	std::chrono::system_clock::time_point time;
+	std::string thread;
+	bool term = true;								///< Whether the prefix is terminated with a ']'.
+	std::string text;
+};
+
+/// Outputs @a _r through g_logPost, now or, if logging is asynchronous, from the logging thread.
+void postLog(LogRecord&& _r);
+
+/// Posts log entries from a background thread, rather than from the thread logging them, if @a _async.
+/// Each logging thread then puts its entries in a ring of @a _ringSize entries of its own, taking no lock; should it
+/// be full, the entry is dropped and counted. Turning it off posts any entries still waiting.
+void setAsyncLogging(bool _async, size_t _ringSize = 4096);
+
+/// @returns the log entries dropped since startup for being logged faster than they were posted.
+uint64_t droppedLogEntries();
+
+/// @returns true if entries in the log channel @a Id are output.
+template <class Id> bool isLogVisible()
+{
+	if (Id::verbosity > ETH_LOG_MAX_VERBOSITY)
+		return false;
+	if (g_logOverride.empty())
+		return Id::verbosity <= g_logVerbosity;
+	auto it = g_logOverride.find(&typeid(Id));
+	return it == g_logOverride.end() ? Id::verbosity <= g_logVerbosity : it->second;
+}
+
+/// A stream buffer appending to a string, so that what is written so far may be looked at without copying it.
+class LogStreamBuf: public std::streambuf
+{
+public:
+	explicit LogStreamBuf(std::string& _s): m_s(_s) {}
+
+protected:
+	int_type overflow(int_type _c) override { if (_c != traits_type::eof()) m_s.push_back((char)_c); return _c; }
+	std::streamsize xsputn(char const* _s, std::streamsize _n) override { m_s.append(_s, (size_t)_n); return _n; }
+
+private:
+	std::string& m_s;
+};
 
 /// The default logging channels. Each has an associated verbosity and three-letter prefix (name() ).
 /// Channels should inherit from LogChannel and define name() and verbosity.
@@ -82,34 +137,58 @@ class LogOutputStream
 public:
 	/// Construct a new object.
 	/// If _term is true the the prefix info is terminated with a ']' character; if not it ends only with a '|' character.
+	/// Nothing is allocated or formatted unless the channel is visible.
 	LogOutputStream(bool _term = true)
 	{
-		std::type_info const* i = &typeid(Id);
-		auto it = g_logOverride.find(i);
-		if ((it != g_logOverride.end() && it->second == true) || (it == g_logOverride.end() && Id::verbosity <= g_logVerbosity))
+		if (isLogVisible<Id>())
 		{
-			time_t rawTime = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-			char buf[24];
-			if (strftime(buf, 24, "%X", localtime(&rawTime)) == 0)
-				buf[0] = '\0'; // empty if case strftime fails
-			m_sstr << Id::name() << " [ " << buf << " | " << (t_logThreadName.m_name.get() ? *t_logThreadName.m_name.get() : std::string("<unknown>")) << (_term ? " ] " : "");
+			m_entry.reset(new Entry);
+			m_entry->record.channel = Id::name();
+			m_entry->record.time = std::chrono::system_clock::now();
+			m_entry->record.thread = t_logThreadName.m_name.get() ? *t_logThreadName.m_name.get() : std::string("<unknown>");
+			m_entry->record.term = _term;
 		}
 	}
 
-	/// Destructor. Posts the accrued log entry to the g_logPost function.
-	~LogOutputStream() { if (Id::verbosity <= g_logVerbosity) g_logPost(m_sstr.str(), Id::name()); }
+	/// Destructor. Posts the accrued log entry.
+	~LogOutputStream() { if (m_entry) { m_entry->stream.flush(); postLog(std::move(m_entry->record)); } }
 
 	/// Shift arbitrary data to the log. Spaces will be added between items as required.
-	template <class T> LogOutputStream& operator<<(T const& _t) { if (Id::verbosity <= g_logVerbosity) { if (_AutoSpacing && m_sstr.str().size() && m_sstr.str().back() != ' ') m_sstr << " "; m_sstr << _t; } return *this; }
+	template <class T> LogOutputStream& operator<<(T const& _t)
+	{
+		if (m_entry)
+		{
+			// The prefix, before any text, ends with a space only if terminated.
+			std::string const& text = m_entry->record.text;
+			if (_AutoSpacing && (text.empty() ? !m_entry->record.term : text.back() != ' '))
+				m_entry->stream << ' ';
+			m_entry->stream << _t;
+		}
+		return *this;
+	}
 
 private:
-	std::stringstream m_sstr;	///< The accrued log entry.
+	struct Entry
+	{
+		Entry(): buf(record.text), stream(&buf) {}
+		LogRecord record;
+		LogStreamBuf buf;
+		std::ostream stream;
+	};
+	std::unique_ptr<Entry> m_entry;	///< The accrued log entry, if the channel is visible.
+};
+
+/// Swallows a log stream, so that a log statement may be a conditional expression without an if to dangle an else.
+struct LogVoidify
+{
+	template <class T> void operator&(T const&) {}
 };
 
 // Simple cout-like stream objects for accessing common log channels.
 // Dirties the global namespace, but oh so convenient...
-#define cnote dev::LogOutputStream<dev::NoteChannel, true>()
-#define cwarn dev::LogOutputStream<dev::WarnChannel, true>()
+// Each checks first that its channel is visible, so nothing to be logged is evaluated otherwise.
+#define cnote !dev::isLogVisible<dev::NoteChannel>() ? (void)0 : dev::LogVoidify() & dev::LogOutputStream<dev::NoteChannel, true>()
+#define cwarn !dev::isLogVisible<dev::WarnChannel>() ? (void)0 : dev::LogVoidify() & dev::LogOutputStream<dev::WarnChannel, true>()
 
 // Null stream-like objects.
 #define ndebug if (true) {} else dev::NullOutputStream()
@@ -120,7 +199,7 @@ private:
 #if NDEBUG
 #define cdebug ndebug
 #else
-#define cdebug dev::LogOutputStream<dev::DebugChannel, true>()
+#define cdebug !dev::isLogVisible<dev::DebugChannel>() ? (void)0 : dev::LogVoidify() & dev::LogOutputStream<dev::DebugChannel, true>()
 #endif
 
 // Kill all logs when when NLOG is defined.
@@ -128,8 +207,8 @@ private:
 #define clog(X) nlog(X)
 #define cslog(X) nslog(X)
 #else
-#define clog(X) dev::LogOutputStream<X, true>()
-#define cslog(X) dev::LogOutputStream<X, false>()
+#define clog(X) !dev::isLogVisible<X>() ? (void)0 : dev::LogVoidify() & dev::LogOutputStream<X, true>()
+#define cslog(X) !dev::isLogVisible<X>() ? (void)0 : dev::LogVoidify() & dev::LogOutputStream<X, false>()
 #endif
 
 }
@@ -0,0 +1,250 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file MappedFile.cpp
+ * @date 2015
+ */
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+using namespace dev;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(string const& _path, bool, unsigned)
+{
+	// Huge pages need privileges few accounts have on Windows; the file is mapped as usual.
+	HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return;
+	LARGE_INTEGER size;
+	if (GetFileSizeEx(file, &size) && size.QuadPart)
+	{
+		HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping)
+		{
+			if (void* p = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0))
+			{
+				m_data = (byte*)p;
+				m_size = m_mapped = (size_t)size.QuadPart;
+			}
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+		UnmapViewOfFile(m_data);
+}
+
+bool MappedFile::create(string const& _path, size_t _size, function<void(bytesRef)> const& _fill)
+{
+	HANDLE file = CreateFileA(_path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)((uint64_t)_size >> 32), (DWORD)_size, nullptr);
+	void* p = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, _size) : nullptr;
+	if (p)
+	{
+		try
+		{
+			_fill(bytesRef((byte*)p, _size));
+		}
+		catch (...)
+		{
+			UnmapViewOfFile(p);
+			CloseHandle(mapping);
+			CloseHandle(file);
+			throw;
+		}
+		FlushViewOfFile(p, 0);
+		UnmapViewOfFile(p);
+	}
+	if (mapping)
+		CloseHandle(mapping);
+	CloseHandle(file);
+	return !!p;
+}
+
+// Windows maps no further than a file's end, so reserving the capacity would mean making the file that big.
+GrowableMappedFile::GrowableMappedFile(string const&, size_t) {}
+GrowableMappedFile::~GrowableMappedFile() {}
+bool GrowableMappedFile::resize(size_t) { return false; }
+void GrowableMappedFile::flush() {}
+
+#else
+
+/// Huge pages are taken to be this size, or a divisor of it.
+static const size_t c_hugePageSize = 2 * 1024 * 1024;
+
+MappedFile::MappedFile(string const& _path, bool _hugePages, unsigned _numaNode)
+{
+	int fd = open(_path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	struct stat s;
+	if (fstat(fd, &s) || !s.st_size)
+	{
+		close(fd);
+		return;
+	}
+	size_t size = (size_t)s.st_size;
+
+	if (_hugePages || _numaNode != c_anyNumaNode)
+	{
+		size_t mapped = (size + c_hugePageSize - 1) / c_hugePageSize * c_hugePageSize;
+		void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+		if (_hugePages)
+			p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+		if (p == MAP_FAILED)
+		{
+			// No huge pages reserved; ask for transparent ones instead.
+			p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+			if (p != MAP_FAILED && _hugePages)
+				madvise(p, mapped, MADV_HUGEPAGE);
+#endif
+		}
+		if (p != MAP_FAILED)
+		{
+			// Before it is read into, so that its pages are made where they are to be.
+			placeMemory(p, mapped, _numaNode);
+			size_t done = 0;
+			while (done < size)
+			{
+				ssize_t n = pread(fd, (byte*)p + done, size - done, (off_t)done);
+				if (n <= 0)
+					break;
+				done += (size_t)n;
+			}
+			if (done == size)
+			{
+				mprotect(p, mapped, PROT_READ);
+				m_data = (byte*)p;
+				m_size = size;
+				m_mapped = mapped;
+				close(fd);
+				return;
+			}
+			munmap(p, mapped);
+		}
+	}
+
+	void* p = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	if (p != MAP_FAILED)
+	{
+		m_data = (byte*)p;
+		m_size = m_mapped = size;
+	}
+	close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+	if (m_data)
+		munmap(m_data, m_mapped);
+}
+
+bool MappedFile::create(string const& _path, size_t _size, function<void(bytesRef)> const& _fill)
+{
+	int fd = open(_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+	void* p = ftruncate(fd, (off_t)_size) ? MAP_FAILED : mmap(nullptr, _size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+		return false;
+	try
+	{
+		_fill(bytesRef((byte*)p, _size));
+	}
+	catch (...)
+	{
+		munmap(p, _size);
+		throw;
+	}
+	bool ret = !msync(p, _size, MS_SYNC);
+	munmap(p, _size);
+	return ret;
+}
+
+GrowableMappedFile::GrowableMappedFile(string const& _path, size_t _capacity)
+{
+	int flags = MAP_SHARED;
+	if (_path.empty())
+		flags = MAP_PRIVATE | MAP_ANONYMOUS;
+	else
+	{
+		m_fd = open(_path.c_str(), O_RDWR | O_CREAT, 0644);
+		struct stat s;
+		if (m_fd < 0 || fstat(m_fd, &s))
+			return;
+		m_size = min((size_t)s.st_size, _capacity);
+	}
+#ifdef MAP_NORESERVE
+	// Only what has been written takes memory or swap.
+	flags |= MAP_NORESERVE;
+#endif
+	void* p = mmap(nullptr, _capacity, PROT_READ | PROT_WRITE, flags, m_fd, 0);
+	if (p == MAP_FAILED)
+	{
+		m_size = 0;
+		return;
+	}
+	m_data = (byte*)p;
+	m_capacity = _capacity;
+}
+
+GrowableMappedFile::~GrowableMappedFile()
+{
+	if (m_data)
+		munmap(m_data, m_capacity);
+	if (m_fd >= 0)
+		close(m_fd);
+}
+
+bool GrowableMappedFile::resize(size_t _size)
+{
+	if (!m_data || _size > m_capacity)
+		return false;
+	// Pages of the mapping past the file's end may not be touched, so it is extended before they are.
+	if (m_fd >= 0 && ftruncate(m_fd, (off_t)_size))
+		return false;
+	m_size = _size;
+	return true;
+}
+
+void GrowableMappedFile::flush()
+{
+	if (m_data && m_fd >= 0 && m_size)
+		msync(m_data, m_size, MS_SYNC);
+}
+
+#endif
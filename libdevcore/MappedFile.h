@@ -0,0 +1,93 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file MappedFile.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include "Common.h"
+#include "Numa.h"
+
+namespace dev
+{
+
+/**
+ * @brief A file mapped read-only into memory, so that every process mapping it shares the one copy in the page cache.
+ * Asked for huge pages, it is instead read into a private mapping of huge pages, where the system gives them: fewer
+ * TLB misses for random reads over a large file, at the price of the memory no longer being shared. So it is, too,
+ * when asked to place it on a NUMA node, or over all of them, which the page cache cannot be made to do.
+ */
+class MappedFile
+{
+public:
+	/// Maps @a _path, placed on NUMA node @a _numaNode as placeMemory() has it; data() is empty if it could not be.
+	explicit MappedFile(std::string const& _path, bool _hugePages = false, unsigned _numaNode = c_anyNumaNode);
+	~MappedFile();
+
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	/// @returns the file's contents, valid for as long as we are.
+	bytesConstRef data() const { return bytesConstRef(m_data, m_size); }
+
+	/// Creates @a _path, of @a _size bytes, calling @a _fill to write them straight into a mapping of it.
+	/// @returns false if the file could not be created or mapped.
+	static bool create(std::string const& _path, size_t _size, std::function<void(bytesRef)> const& _fill);
+
+private:
+	byte* m_data = nullptr;
+	size_t m_size = 0;
+	size_t m_mapped = 0;			///< Bytes mapped, which for huge pages is rounded up.
+};
+
+/**
+ * @brief A file mapped writable into memory, at an address reserved up front for all it may grow to, so that what
+ * has been written may be read without locking while the file grows. The system writes it back in its own time.
+ * Not available on Windows, where data() is always null.
+ */
+class GrowableMappedFile
+{
+public:
+	/// Opens or creates @a _path, or makes an anonymous mapping if it is empty, reserving room for @a _capacity bytes.
+	/// data() is null if it could not be mapped.
+	GrowableMappedFile(std::string const& _path, size_t _capacity);
+	~GrowableMappedFile();
+
+	GrowableMappedFile(GrowableMappedFile const&) = delete;
+	GrowableMappedFile& operator=(GrowableMappedFile const&) = delete;
+
+	/// @returns the mapping, of which the first size() bytes may be read and written.
+	byte* data() const { return m_data; }
+	size_t size() const { return m_size; }
+	size_t capacity() const { return m_capacity; }
+
+	/// Grows or shrinks the file to @a _size bytes, at most capacity(). @returns false if it could not be.
+	bool resize(size_t _size);
+	/// Writes what has changed back to the file, returning once it is there.
+	void flush();
+
+private:
+	byte* m_data = nullptr;
+	size_t m_size = 0;
+	size_t m_capacity = 0;
+	int m_fd = -1;					///< The file's, or -1 for an anonymous mapping.
+};
+
+}
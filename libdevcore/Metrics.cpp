@@ -0,0 +1,202 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Metrics.cpp
+ * @date 2015
+ */
+
+#include "Metrics.h"
+#include <algorithm>
+#include <sstream>
+#include "Exceptions.h"
+using namespace std;
+using namespace dev;
+
+unsigned dev::metricShard()
+{
+	static atomic<unsigned> s_next{0};
+	static thread_local unsigned s_shard = s_next++ % c_metricShards;
+	return s_shard;
+}
+
+uint64_t MetricCounter::value() const
+{
+	uint64_t ret = 0;
+	for (auto const& s: m_shards)
+		ret += s.value.load(memory_order_relaxed);
+	return ret;
+}
+
+MetricHistogram::MetricHistogram(vector<double> const& _bounds):
+	m_bounds(_bounds)
+{
+	for (auto& s: m_shards)
+	{
+		s.counts.reset(new atomic<uint64_t>[m_bounds.size() + 1]);
+		for (size_t i = 0; i <= m_bounds.size(); ++i)
+			s.counts[i] = 0;
+	}
+}
+
+void MetricHistogram::observe(double _v)
+{
+	Shard& s = m_shards[metricShard()];
+	size_t b = lower_bound(m_bounds.begin(), m_bounds.end(), _v) - m_bounds.begin();
+	s.counts[b].fetch_add(1, memory_order_relaxed);
+	for (double sum = s.sum.load(memory_order_relaxed); !s.sum.compare_exchange_weak(sum, sum + _v, memory_order_relaxed);) {}
+}
+
+vector<uint64_t> MetricHistogram::counts() const
+{
+	vector<uint64_t> ret(m_bounds.size() + 1, 0);
+	for (auto const& s: m_shards)
+		for (size_t i = 0; i < ret.size(); ++i)
+			ret[i] += s.counts[i].load(memory_order_relaxed);
+	return ret;
+}
+
+double MetricHistogram::sum() const
+{
+	double ret = 0;
+	for (auto const& s: m_shards)
+		ret += s.sum.load(memory_order_relaxed);
+	return ret;
+}
+
+vector<double> const& dev::metricSecondsBounds()
+{
+	static const vector<double> s_bounds{0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+	return s_bounds;
+}
+
+Metrics& Metrics::get()
+{
+	// Leaked, as hot paths may keep references to its metrics until the very end.
+	static Metrics* s_this = new Metrics;
+	return *s_this;
+}
+
+Metrics::Family& Metrics::family(string const& _name, string const& _help, Type _type)
+{
+	auto it = m_families.find(_name);
+	if (it == m_families.end())
+	{
+		it = m_families.insert(make_pair(_name, Family())).first;
+		it->second.type = _type;
+		it->second.help = _help;
+	}
+	else if (it->second.type != _type)
+		BOOST_THROW_EXCEPTION(InvalidMetric() << errinfo_comment(_name));
+	return it->second;
+}
+
+MetricCounter& Metrics::counter(string const& _name, string const& _help, string const& _labels)
+{
+	Guard l(x_families);
+	auto& m = family(_name, _help, Type::Counter).counters[_labels];
+	if (!m)
+		m.reset(new MetricCounter);
+	return *m;
+}
+
+MetricGauge& Metrics::gauge(string const& _name, string const& _help, string const& _labels)
+{
+	Guard l(x_families);
+	auto& m = family(_name, _help, Type::Gauge).gauges[_labels];
+	if (!m)
+		m.reset(new MetricGauge);
+	return *m;
+}
+
+MetricHistogram& Metrics::histogram(string const& _name, string const& _help, string const& _labels, vector<double> const& _bounds)
+{
+	Guard l(x_families);
+	auto& m = family(_name, _help, Type::Histogram).histograms[_labels];
+	if (!m)
+		m.reset(new MetricHistogram(_bounds));
+	return *m;
+}
+
+unsigned Metrics::watch(string const& _name, string const& _help, string const& _labels, function<double()> const& _f)
+{
+	Guard l(x_families);
+	unsigned id = ++m_lastId;
+	family(_name, _help, Type::Gauge).watched[id] = make_pair(_labels, _f);
+	m_watchedNames[id] = _name;
+	return id;
+}
+
+void Metrics::unwatch(unsigned _id)
+{
+	Guard l(x_families);
+	auto it = m_watchedNames.find(_id);
+	if (it == m_watchedNames.end())
+		return;
+	m_families[it->second].watched.erase(_id);
+	m_watchedNames.erase(it);
+}
+
+namespace
+{
+
+string labelled(string const& _name, string const& _labels, string const& _more = string())
+{
+	if (_labels.empty() && _more.empty())
+		return _name;
+	return _name + "{" + _labels + (_labels.empty() || _more.empty() ? "" : ",") + _more + "}";
+}
+
+}
+
+string Metrics::prometheus() const
+{
+	ostringstream out;
+	out.precision(17);
+	// Held throughout, so that a watched callback is never called once unwatched.
+	Guard l(x_families);
+	for (auto const& f: m_families)
+	{
+		string const& name = f.first;
+		static char const* const c_types[] = { "counter", "gauge", "histogram" };
+		out << "# HELP " << name << " " << f.second.help << "\n";
+		out << "# TYPE " << name << " " << c_types[(unsigned)f.second.type] << "\n";
+		for (auto const& m: f.second.counters)
+			out << labelled(name, m.first) << " " << m.second->value() << "\n";
+		for (auto const& m: f.second.gauges)
+			out << labelled(name, m.first) << " " << m.second->value() << "\n";
+		for (auto const& w: f.second.watched)
+			out << labelled(name, w.second.first) << " " << w.second.second() << "\n";
+		for (auto const& m: f.second.histograms)
+		{
+			auto counts = m.second->counts();
+			uint64_t cumulative = 0;
+			for (size_t i = 0; i < counts.size(); ++i)
+			{
+				cumulative += counts[i];
+				ostringstream le;
+				le.precision(17);
+				if (i < m.second->bounds().size())
+					le << "le=\"" << m.second->bounds()[i] << "\"";
+				else
+					le << "le=\"+Inf\"";
+				out << labelled(name + "_bucket", m.first, le.str()) << " " << cumulative << "\n";
+			}
+			out << labelled(name + "_sum", m.first) << " " << m.second->sum() << "\n";
+			out << labelled(name + "_count", m.first) << " " << cumulative << "\n";
+		}
+	}
+	return out.str();
+}
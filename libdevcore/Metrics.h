@@ -0,0 +1,163 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Metrics.h
+ * @date 2015
+ * Counters, gauges and histograms for the hot paths, exported in the Prometheus text format.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Guards.h"
+
+namespace dev
+{
+
+/// How many shards each counter and histogram is split into. Each thread adds into one of them, so that threads
+/// rarely share a cache line; reading sums them.
+static const unsigned c_metricShards = 16;
+
+/// @returns the shard the calling thread adds into.
+unsigned metricShard();
+
+/// A count which only goes up, such as of bytes sent.
+class MetricCounter
+{
+public:
+	void inc(uint64_t _n = 1) { m_shards[metricShard()].value.fetch_add(_n, std::memory_order_relaxed); }
+	uint64_t value() const;
+
+private:
+	struct Shard
+	{
+		std::atomic<uint64_t> value{0};
+		char pad[64 - sizeof(std::atomic<uint64_t>)];
+	};
+	Shard m_shards[c_metricShards];
+};
+
+/// A value which may go up and down, such as a queue's length.
+class MetricGauge
+{
+public:
+	void set(double _v) { m_value = _v; }
+	double value() const { return m_value; }
+
+private:
+	std::atomic<double> m_value{0};
+};
+
+/// A distribution of values, such as of how long something takes, counted into buckets by upper bound.
+class MetricHistogram
+{
+public:
+	/// @a _bounds are the buckets' upper bounds, ascending; above the last, values go into a bucket of their own.
+	explicit MetricHistogram(std::vector<double> const& _bounds);
+
+	void observe(double _v);
+
+	std::vector<double> const& bounds() const { return m_bounds; }
+	/// @returns the number of values in each bucket, the one above the last bound last; not cumulative.
+	std::vector<uint64_t> counts() const;
+	double sum() const;
+
+private:
+	struct Shard
+	{
+		std::unique_ptr<std::atomic<uint64_t>[]> counts;
+		std::atomic<double> sum{0};
+		char pad[64 - sizeof(std::unique_ptr<std::atomic<uint64_t>[]>) - sizeof(std::atomic<double>)];
+	};
+
+	std::vector<double> m_bounds;
+	Shard m_shards[c_metricShards];
+};
+
+/// Observes into a histogram the seconds from its construction to its destruction.
+class MetricTimer
+{
+public:
+	explicit MetricTimer(MetricHistogram& _h): m_h(_h), m_start(std::chrono::steady_clock::now()) {}
+	~MetricTimer() { m_h.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count()); }
+
+private:
+	MetricHistogram& m_h;
+	std::chrono::steady_clock::time_point m_start;
+};
+
+/// Bounds for a histogram of seconds, from 100us to 10s.
+std::vector<double> const& metricSecondsBounds();
+
+/**
+ * @brief The process's metrics, by name and labels.
+ * Metrics are made on first asking for them and live as long as the process, so that a hot path can keep a
+ * reference to its own, typically in a function-local static, and update it without a lookup:
+ * @code
+ * static MetricHistogram& s_time = Metrics::get().histogram("eth_block_import_seconds", "Time to import a block.");
+ * MetricTimer t(s_time);
+ * @endcode
+ * Values the hot paths don't see change, such as queue lengths, are instead read when exported, from callbacks
+ * which whoever owns them adds with watch() and removes with unwatch().
+ * Names and labels are as Prometheus has them: @a _labels is empty or as in `method="eth_call"`.
+ * @threadsafe
+ */
+class Metrics
+{
+public:
+	static Metrics& get();
+
+	MetricCounter& counter(std::string const& _name, std::string const& _help, std::string const& _labels = std::string());
+	MetricGauge& gauge(std::string const& _name, std::string const& _help, std::string const& _labels = std::string());
+	MetricHistogram& histogram(std::string const& _name, std::string const& _help, std::string const& _labels = std::string(), std::vector<double> const& _bounds = metricSecondsBounds());
+
+	/// Reports the gauge @a _name as whatever @a _f returns when exported. @returns an id for unwatch().
+	unsigned watch(std::string const& _name, std::string const& _help, std::string const& _labels, std::function<double()> const& _f);
+	void unwatch(unsigned _id);
+
+	/// @returns every metric in the Prometheus text exposition format, version 0.0.4.
+	std::string prometheus() const;
+
+private:
+	Metrics() = default;
+
+	enum class Type { Counter, Gauge, Histogram };
+
+	struct Family
+	{
+		Type type;
+		std::string help;
+		std::map<std::string, std::unique_ptr<MetricCounter>> counters;		///< By labels.
+		std::map<std::string, std::unique_ptr<MetricGauge>> gauges;
+		std::map<std::string, std::unique_ptr<MetricHistogram>> histograms;
+		std::map<unsigned, std::pair<std::string, std::function<double()>>> watched;	///< By id: labels and callback.
+	};
+
+	Family& family(std::string const& _name, std::string const& _help, Type _type);
+
+	mutable Mutex x_families;
+	std::map<std::string, Family> m_families;
+	std::map<unsigned, std::string> m_watchedNames;		///< The family of each watched id.
+	unsigned m_lastId = 0;
+};
+
+}
@@ -0,0 +1,131 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Numa.cpp
+ * @date 2015
+ */
+
+#include "Numa.h"
+
+#include <fstream>
+#include <thread>
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include "Affinity.h"
+#if defined(__linux__)
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+using namespace std;
+using namespace dev;
+
+#if defined(__linux__)
+/// The modes of mbind(2), as numaif.h has them; that comes with libnuma, which we do without.
+static const int c_mpolBind = 2;
+static const int c_mpolInterleave = 3;
+#endif
+
+/// @returns the NUMA nodes as the system lists them, or none if it does not.
+static vector<vector<unsigned>> readNumaNodes()
+{
+	vector<vector<unsigned>> ret;
+#if defined(__linux__)
+	boost::system::error_code ec;
+	for (boost::filesystem::directory_iterator it("/sys/devices/system/node", ec), end; !ec && it != end; it.increment(ec))
+	{
+		string name = it->path().filename().string();
+		if (name.size() <= 4 || name.compare(0, 4, "node") || name.find_first_not_of("0123456789", 4) != string::npos)
+			continue;
+		unsigned n = stoul(name.substr(4));
+		if (n >= ret.size())
+			ret.resize(n + 1);
+		// Files of sysfs claim a size they do not have, so are read by line rather than by contentsString.
+		string cpus;
+		ifstream cpulist(it->path().string() + "/cpulist");
+		getline(cpulist, cpus);
+		boost::trim(cpus);
+		try
+		{
+			// Nodes of memory alone have no CPUs.
+			if (!cpus.empty())
+				ret[n] = parseCpuSet(cpus);
+		}
+		catch (BadCpuSet const&) {}
+	}
+#endif
+	return ret;
+}
+
+vector<vector<unsigned>> const& dev::numaNodes()
+{
+	static vector<vector<unsigned>> const s_nodes = []()
+	{
+		auto ret = readNumaNodes();
+		if (ret.empty())
+		{
+			ret.resize(1);
+			for (unsigned i = 0; i < max(thread::hardware_concurrency(), 1u); ++i)
+				ret[0].push_back(i);
+		}
+		return ret;
+	}();
+	return s_nodes;
+}
+
+unsigned dev::currentNumaNode()
+{
+#if defined(__linux__)
+	static vector<unsigned> const s_nodeOfCpu = []()
+	{
+		vector<unsigned> ret;
+		auto const& nodes = numaNodes();
+		for (unsigned n = 0; n < nodes.size(); ++n)
+			for (unsigned c: nodes[n])
+			{
+				if (c >= ret.size())
+					ret.resize(c + 1, 0);
+				ret[c] = n;
+			}
+		return ret;
+	}();
+	int cpu = sched_getcpu();
+	if (cpu >= 0 && (unsigned)cpu < s_nodeOfCpu.size())
+		return s_nodeOfCpu[cpu];
+#endif
+	return 0;
+}
+
+bool dev::placeMemory(void* _p, size_t _size, unsigned _node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+	auto const& nodes = numaNodes();
+	if (_node == c_anyNumaNode || nodes.size() < 2 || (_node != c_allNumaNodes && _node >= nodes.size()))
+		return false;
+	size_t const bits = sizeof(unsigned long) * 8;
+	vector<unsigned long> mask((nodes.size() + bits - 1) / bits, 0);
+	for (unsigned n = 0; n < nodes.size(); ++n)
+		if (_node == n || (_node == c_allNumaNodes && !nodes[n].empty()))
+			mask[n / bits] |= 1ul << (n % bits);
+	int mode = _node == c_allNumaNodes ? c_mpolInterleave : c_mpolBind;
+	return !syscall(SYS_mbind, _p, _size, mode, mask.data(), mask.size() * bits + 1, 0);
+#else
+	(void)_p;
+	(void)_size;
+	(void)_node;
+	return false;
+#endif
+}
@@ -0,0 +1,46 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Numa.h
+ * @date 2015
+ * The NUMA nodes of the machine, and placing memory among them.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace dev
+{
+
+/// Stands for no node in particular: memory goes wherever the system puts it, usually by the thread first touching it.
+static const unsigned c_anyNumaNode = (unsigned)-2;
+/// Stands for every node: memory is spread page by page over them all.
+static const unsigned c_allNumaNodes = (unsigned)-1;
+
+/// @returns the CPUs of each NUMA node, by node number; a node without CPUs has none. Where the machine is not split
+/// into nodes, or it is not known how it is, as other than on Linux, there is one node of every CPU.
+std::vector<std::vector<unsigned>> const& numaNodes();
+
+/// @returns the NUMA node of the CPU the calling thread is running on, or 0 if it is not known.
+unsigned currentNumaNode();
+
+/// Places the pages of @a _p, of @a _size bytes and page-aligned, that are yet to be touched, on NUMA node @a _node;
+/// spread over all if it is c_allNumaNodes. @returns false if they could not be, as other than on Linux.
+bool placeMemory(void* _p, size_t _size, unsigned _node);
+
+}
@@ -168,22 +168,50 @@ unsigned RLP::length() const
 
 unsigned RLP::items() const
 {
+	if (m_itemCount != (unsigned)-1)
+		return m_itemCount;
 	if (isList())
 	{
 		bytesConstRef d = payload().cropped(0, length());
 		unsigned i = 0;
 		for (; d.size(); ++i)
 			d = d.cropped(RLP(d, ThrowOnFail | FailIfTooSmall).actualSize());
-		return i;
+		return m_itemCount = i;
 	}
 	return 0;
 }
 
+void IndexedRLP::index() const
+{
+	if (m_count != (unsigned)-1)
+		return;
+	unsigned count = m_list.itemCount();
+	unsigned* o = m_inline.data();
+	if (count >= c_inlineItems)
+	{
+		m_heap.resize(count + 1);
+		o = m_heap.data();
+	}
+	bytesConstRef payload = m_list.payload();
+	o[0] = 0;
+	for (unsigned i = 0; i < count; ++i)
+		o[i + 1] = o[i] + RLP(payload.cropped(o[i]), RLP::ThrowOnFail | RLP::FailIfTooSmall).actualSize();
+	m_count = count;
+}
+
+RLP IndexedRLP::operator[](unsigned _i) const
+{
+	index();
+	if (_i >= m_count)
+		return RLP();
+	unsigned const* o = offsets();
+	return RLP(m_list.payload().cropped(o[_i], o[_i + 1] - o[_i]), RLP::ThrowOnFail | RLP::FailIfTooSmall);
+}
+
 RLPStream& RLPStream::appendRaw(bytesConstRef _s, unsigned _itemCount)
 {
-	unsigned os = m_out.size();
-	m_out.resize(os + _s.size());
-	memcpy(m_out.data() + os, _s.data(), _s.size());
+	if (byte* b = grow(_s.size()))
+		memcpy(b, _s.data(), _s.size());
 	noteAppended(_itemCount);
 	return *this;
 }
@@ -195,30 +223,40 @@ void RLPStream::noteAppended(unsigned _itemCount)
 //	cdebug << "noteAppended(" << _itemCount << ")";
 	while (m_listStack.size())
 	{
-		if (m_listStack.back().first < _itemCount)
-			BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("itemCount too large") << RequirementError((bigint)m_listStack.back().first, (bigint)_itemCount));
-		m_listStack.back().first -= _itemCount;
-		if (m_listStack.back().first)
+		if (m_listStack.back().items < _itemCount)
+			BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("itemCount too large") << RequirementError((bigint)m_listStack.back().items, (bigint)_itemCount));
+		m_listStack.back().items -= _itemCount;
+		if (m_listStack.back().items)
 			break;
 		else
 		{
-			auto p = m_listStack.back().second;
+			OpenList l = m_listStack.back();
 			m_listStack.pop_back();
-			unsigned s = m_out.size() - p;		// list size
-			auto brs = bytesRequired(s);
-			unsigned encodeSize = s < c_rlpListImmLenCount ? 1 : (1 + brs);
-//			cdebug << "s: " << s << ", p: " << p << ", m_out.size(): " << m_out.size() << ", encodeSize: " << encodeSize << " (br: " << brs << ")";
-			auto os = m_out.size();
-			m_out.resize(os + encodeSize);
-			memmove(m_out.data() + p + encodeSize, m_out.data() + p, os - p);
-			if (s < c_rlpListImmLenCount)
-				m_out[p] = (byte)(c_rlpListStart + s);
-			else
+			size_t s = position() - l.start;		// list size
+			if (m_measuring)
 			{
-				m_out[p] = (byte)(c_rlpListIndLenZero + brs);
-				byte* b = &(m_out[p + brs]);
-				for (; s; s >>= 8)
-					*(b--) = (byte)s;
+				m_listSizes[l.size] = s;
+				m_measured += s < c_rlpListImmLenCount ? 1 : (1 + bytesRequired(s));
+			}
+			else if (!l.size)
+			{
+				// Its header is put in front of its payload, now that the payload's size is known.
+				auto p = l.start;
+				auto brs = bytesRequired(s);
+				unsigned encodeSize = s < c_rlpListImmLenCount ? 1 : (1 + brs);
+//				cdebug << "s: " << s << ", p: " << p << ", m_out.size(): " << m_out.size() << ", encodeSize: " << encodeSize << " (br: " << brs << ")";
+				auto os = m_out.size();
+				m_out.resize(os + encodeSize);
+				memmove(m_out.data() + p + encodeSize, m_out.data() + p, os - p);
+				if (s < c_rlpListImmLenCount)
+					m_out[p] = (byte)(c_rlpListStart + s);
+				else
+				{
+					m_out[p] = (byte)(c_rlpListIndLenZero + brs);
+					byte* b = &(m_out[p + brs]);
+					for (; s; s >>= 8)
+						*(b--) = (byte)s;
+				}
 			}
 		}
 		_itemCount = 1;	// for all following iterations, we've effectively appended a single item only since we completed a list.
@@ -228,23 +266,39 @@ void RLPStream::noteAppended(unsigned _itemCount)
 RLPStream& RLPStream::appendList(unsigned _items)
 {
 //	cdebug << "appendList(" << _items << ")";
-	if (_items)
-		m_listStack.push_back(std::make_pair(_items, m_out.size()));
-	else
+	if (!_items)
 		appendList(bytes());
+	else if (m_measuring)
+	{
+		m_listStack.push_back(OpenList{_items, m_measured, (unsigned)m_listSizes.size()});
+		m_listSizes.push_back(0);
+	}
+	else if (m_nextList < m_listSizes.size())
+	{
+		// Measured already, so its header goes in now.
+		pushListHeader(m_listSizes[m_nextList++]);
+		m_listStack.push_back(OpenList{_items, m_out.size(), 1});
+	}
+	else
+		m_listStack.push_back(OpenList{_items, m_out.size(), 0});
 	return *this;
 }
 
 RLPStream& RLPStream::appendList(bytesConstRef _rlp)
 {
-	if (_rlp.size() < c_rlpListImmLenCount)
-		m_out.push_back((byte)(_rlp.size() + c_rlpListStart));
-	else
-		pushCount(_rlp.size(), c_rlpListIndLenZero);
+	pushListHeader(_rlp.size());
 	appendRaw(_rlp, 1);
 	return *this;
 }
 
+void RLPStream::pushListHeader(size_t _size)
+{
+	if (_size < c_rlpListImmLenCount)
+		push((byte)(_size + c_rlpListStart));
+	else
+		pushCount(_size, c_rlpListIndLenZero);
+}
+
 RLPStream& RLPStream::append(bytesConstRef _s, bool _compact)
 {
 	unsigned s = _s.size();
@@ -253,11 +307,11 @@ RLPStream& RLPStream::append(bytesConstRef _s, bool _compact)
 		for (unsigned i = 0; i < _s.size() && !*d; ++i, --s, ++d) {}
 
 	if (s == 1 && *d < c_rlpDataImmLenStart)
-		m_out.push_back(*d);
+		push(*d);
 	else
 	{
 		if (s < c_rlpDataImmLenCount)
-			m_out.push_back((byte)(s + c_rlpDataImmLenStart));
+			push((byte)(s + c_rlpDataImmLenStart));
 		else
 			pushCount(s, c_rlpDataIndLenZero);
 		appendRaw(bytesConstRef(d, s), 0);
@@ -266,21 +320,21 @@ RLPStream& RLPStream::append(bytesConstRef _s, bool _compact)
 	return *this;
 }
 
-RLPStream& RLPStream::append(bigint _i)
+template <class _T> RLPStream& RLPStream::appendInt(_T const& _i)
 {
 	if (!_i)
-		m_out.push_back(c_rlpDataImmLenStart);
+		push(c_rlpDataImmLenStart);
 	else if (_i < c_rlpDataImmLenStart)
-		m_out.push_back((byte)_i);
+		push((byte)_i);
 	else
 	{
 		unsigned br = bytesRequired(_i);
 		if (br < c_rlpDataImmLenCount)
-			m_out.push_back((byte)(br + c_rlpDataImmLenStart));
+			push((byte)(br + c_rlpDataImmLenStart));
 		else
 		{
 			auto brbr = bytesRequired(br);
-			m_out.push_back((byte)(c_rlpDataIndLenZero + brbr));
+			push((byte)(c_rlpDataIndLenZero + brbr));
 			pushInt(br, brbr);
 		}
 		pushInt(_i, br);
@@ -289,10 +343,30 @@ RLPStream& RLPStream::append(bigint _i)
 	return *this;
 }
 
-void RLPStream::pushCount(unsigned _count, byte _base)
+RLPStream& RLPStream::append(unsigned _i)
+{
+	return appendInt(_i);
+}
+
+RLPStream& RLPStream::append(u160 _i)
+{
+	return appendInt(_i);
+}
+
+RLPStream& RLPStream::append(u256 _i)
+{
+	return appendInt(_i);
+}
+
+RLPStream& RLPStream::append(bigint _i)
+{
+	return appendInt(_i);
+}
+
+void RLPStream::pushCount(size_t _count, byte _base)
 {
 	auto br = bytesRequired(_count);
-	m_out.push_back((byte)(br + _base));	// max 8 bytes.
+	push((byte)(br + _base));	// max 8 bytes.
 	pushInt(_count, br);
 }
 
@@ -32,6 +32,7 @@
 #include "Common.h"
 #include "Exceptions.h"
 #include "FixedHash.h"
+#include "SmallVector.h"
 
 namespace dev
 {
@@ -312,7 +313,7 @@ private:
 	/// @returns the number of bytes into the data that the payload starts.
 	unsigned payloadOffset() const { return isSingleByte() ? 0 : (1 + lengthSize()); }
 
-	/// @returns the number of data items.
+	/// @returns the number of data items, counted on first call.
 	unsigned items() const;
 
 	/// Our byte data.
@@ -322,6 +323,37 @@ private:
 	mutable unsigned m_lastIndex = (unsigned)-1;
 	mutable unsigned m_lastEnd = 0;
 	mutable bytesConstRef m_lastItem;
+	mutable unsigned m_itemCount = (unsigned)-1;	///< The number of items, once counted.
+};
+
+/**
+ * @brief An RLP list with an index of where each of its items starts, so that any of them is reached in constant time.
+ * RLP itself reaches the item after the one last reached quickly, but any other by a scan from the start; this is for
+ * lists read out of order. The index is built on first use, in place for lists of up to c_inlineItems items.
+ */
+class IndexedRLP
+{
+public:
+	explicit IndexedRLP(RLP const& _list): m_list(_list) {}
+
+	RLP const& rlp() const { return m_list; }
+
+	/// @returns the number of items in the list, or zero if it isn't a list.
+	unsigned itemCount() const { index(); return m_count; }
+
+	/// @returns the item @a _i, or a null RLP if there are not that many.
+	RLP operator[](unsigned _i) const;
+
+private:
+	enum { c_inlineItems = 32 };
+
+	void index() const;
+	unsigned const* offsets() const { return m_count < c_inlineItems ? m_inline.data() : m_heap.data(); }
+
+	RLP m_list;
+	mutable unsigned m_count = (unsigned)-1;				///< The number of items, once indexed.
+	mutable std::array<unsigned, c_inlineItems> m_inline;	///< Offsets into the payload of each item and the end, for short lists.
+	mutable std::vector<unsigned> m_heap;					///< Offsets into the payload of each item and the end, for others.
 };
 
 /**
@@ -339,9 +371,9 @@ public:
 	~RLPStream() {}
 
 	/// Append given datum to the byte stream.
-	RLPStream& append(unsigned _s) { return append(bigint(_s)); }
-	RLPStream& append(u160 _s) { return append(bigint(_s)); }
-	RLPStream& append(u256 _s) { return append(bigint(_s)); }
+	RLPStream& append(unsigned _s);
+	RLPStream& append(u160 _s);
+	RLPStream& append(u256 _s);
 	RLPStream& append(bigint _s);
 	RLPStream& append(bytesConstRef _s, bool _compact = false);
 	RLPStream& append(bytes const& _s) { return append(bytesConstRef(&_s)); }
@@ -363,7 +395,7 @@ public:
 	RLPStream& appendList(unsigned _items);
 	RLPStream& appendList(bytesConstRef _rlp);
 	RLPStream& appendList(bytes const& _rlp) { return appendList(&_rlp); }
-	RLPStream& appendList(RLPStream const& _s) { return appendList(&_s.out()); }
+	RLPStream& appendList(RLPStream const& _s) { return appendList(_s.outRef()); }
 
 	/// Appends raw (pre-serialised) RLP data. Use with caution.
 	RLPStream& appendRaw(bytesConstRef _rlp, unsigned _itemCount = 1);
@@ -372,50 +404,113 @@ public:
 	/// Shift operators for appending data items.
 	template <class T> RLPStream& operator<<(T _data) { return append(_data); }
 
+	/// Appends what @a _f appends to the stream it is given, without growing or moving anything written: @a _f is
+	/// first called on a stream that only measures, then on this one, grown once to the size measured, which writes
+	/// each list's header as the list is begun. @a _f must append the same each time.
+	template <class F> RLPStream& appendExact(F const& _f)
+	{
+		RLPStream m;
+		m.m_measuring = true;
+		_f(m);
+		m_out.reserve(m_out.size() + m.m_measured);
+		m_listSizes.swap(m.m_listSizes);
+		m_nextList = 0;
+		_f(*this);
+		m_listSizes.clear();
+		return *this;
+	}
+
 	/// Clear the output stream so far.
 	void clear() { m_out.clear(); m_listStack.clear(); }
 
 	/// Read the byte stream.
-	bytes const& out() const { if(!m_listStack.empty()) BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("listStack is not empty")); return m_out; }
+	bytes const& out() const { checkClosed(); return m_out.spill(); }
+
+	/// Read the byte stream without moving it out of its inline buffer; valid until the stream is next changed.
+	bytesConstRef outRef() const { checkClosed(); return m_out.ref(); }
 
 	/// Swap the contents of the output stream out for some other byte array.
-	void swapOut(bytes& _dest) { if(!m_listStack.empty()) BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("listStack is not empty")); swap(m_out, _dest); }
+	void swapOut(bytes& _dest) { checkClosed(); m_out.swap(_dest); }
 
 private:
+	/// A list begun but not yet ended.
+	struct OpenList
+	{
+		unsigned items;						///< Items yet to be appended to it.
+		size_t start;						///< Where its payload starts.
+		unsigned size;						///< When measuring, its index in m_listSizes; else nonzero if its header is already written.
+	};
+
 	void noteAppended(unsigned _itemCount = 1);
+	void checkClosed() const { if(!m_listStack.empty()) BOOST_THROW_EXCEPTION(RLPException() << errinfo_comment("listStack is not empty")); }
+
+	/// @returns where to write @a _n more bytes, appended to the output; null if only measuring.
+	byte* grow(size_t _n)
+	{
+		if (m_measuring)
+		{
+			m_measured += _n;
+			return nullptr;
+		}
+		m_out.resize(m_out.size() + _n);
+		return m_out.data() + m_out.size() - _n;
+	}
+	void push(byte _b) { if (m_measuring) ++m_measured; else m_out.push_back(_b); }
+	size_t position() const { return m_measuring ? m_measured : m_out.size(); }
 
 	/// Push the node-type byte (using @a _base) along with the item count @a _count.
 	/// @arg _count is number of characters for strings, data-bytes for ints, or items for lists.
-	void pushCount(unsigned _count, byte _offset);
+	void pushCount(size_t _count, byte _offset);
+
+	/// Push the header of a list of @a _size bytes of payload.
+	void pushListHeader(size_t _size);
 
 	/// Push an integer as a raw big-endian byte-stream.
 	template <class _T> void pushInt(_T _i, unsigned _br)
 	{
-		m_out.resize(m_out.size() + _br);
-		byte* b = &m_out.back();
-		for (; _i; _i >>= 8)
-			*(b--) = (byte)_i;
+		if (byte* b = grow(_br))
+			for (b += _br - 1; _i; _i >>= 8)
+				*(b--) = (byte)_i;
 	}
 
-	/// Our output byte stream.
-	bytes m_out;
+	template <class _T> RLPStream& appendInt(_T const& _i);
+
+	/// Our output byte stream; most are small enough never to allocate. Mutable, as out() moves it into a bytes.
+	mutable SmallBytes m_out;
 
-	std::vector<std::pair<unsigned, unsigned>> m_listStack;
+	SmallVector<OpenList, 4> m_listStack;
+
+	bool m_measuring = false;				///< Whether we only measure, as the first pass of appendExact().
+	size_t m_measured = 0;					///< When measuring, the bytes appended.
+	std::vector<size_t> m_listSizes;		///< The payload size of each list, in the order begun, as measured by appendExact().
+	unsigned m_nextList = 0;				///< The next of m_listSizes to be begun.
 };
 
 template <class _T> void rlpListAux(RLPStream& _out, _T _t) { _out << _t; }
 template <class _T, class ... _Ts> void rlpListAux(RLPStream& _out, _T _t, _Ts ... _ts) { rlpListAux(_out << _t, _ts...); }
 
 /// Export a single item in RLP format, returning a byte array.
-template <class _T> bytes rlp(_T _t) { return (RLPStream() << _t).out(); }
+template <class _T> bytes rlp(_T _t) { bytes ret; (RLPStream() << _t).swapOut(ret); return ret; }
 
 /// Export a list of items in RLP format, returning a byte array.
-inline bytes rlpList() { return RLPStream(0).out(); }
+inline bytes rlpList() { bytes ret; RLPStream(0).swapOut(ret); return ret; }
 template <class ... _Ts> bytes rlpList(_Ts ... _ts)
 {
 	RLPStream out(sizeof ...(_Ts));
 	rlpListAux(out, _ts...);
-	return out.out();
+	bytes ret;
+	out.swapOut(ret);
+	return ret;
+}
+
+/// @returns what @a _f appends to the stream it is given, encoded by RLPStream::appendExact().
+template <class F> bytes rlpExact(F const& _f)
+{
+	RLPStream s;
+	s.appendExact(_f);
+	bytes ret;
+	s.swapOut(ret);
+	return ret;
 }
 
 /// The empty string in RLP format.
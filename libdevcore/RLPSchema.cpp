@@ -0,0 +1,59 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file RLPSchema.cpp
+ * @date 2015
+ */
+
+#include "RLPSchema.h"
+using namespace std;
+using namespace dev;
+
+RLPSchemaItem dev::readRLPItem(bytesConstRef& io_data)
+{
+	if (io_data.empty())
+		BOOST_THROW_EXCEPTION(BadRLP());
+	byte n = io_data[0];
+	RLPSchemaItem ret;
+	ret.isList = n >= c_rlpListStart;
+	size_t header = 1;
+	size_t length = 0;
+	if (n < c_rlpDataImmLenStart)
+	{
+		header = 0;
+		length = 1;
+	}
+	else if (n <= c_rlpDataIndLenZero)
+		length = n - c_rlpDataImmLenStart;
+	else if (n < c_rlpListStart || n > c_rlpListIndLenZero)
+	{
+		// The length follows, in as many bytes as the first byte says.
+		header += n - (ret.isList ? c_rlpListIndLenZero : c_rlpDataIndLenZero);
+		if (io_data.size() < header)
+			BOOST_THROW_EXCEPTION(BadRLP());
+		for (size_t i = 1; i < header; ++i)
+			length = (length << 8) | io_data[i];
+	}
+	else
+		length = n - c_rlpListStart;
+
+	if (io_data.size() - header < length)
+		BOOST_THROW_EXCEPTION(BadRLP());
+	ret.data = io_data.cropped(0, header + length);
+	ret.payload = io_data.cropped(header, length);
+	io_data = io_data.cropped(header + length);
+	return ret;
+}
@@ -0,0 +1,138 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file RLPSchema.h
+ * @date 2015
+ * Decoding an RLP list straight into the fields of a struct, in one pass and without copies.
+ */
+
+#pragma once
+
+#include <type_traits>
+#include "Exceptions.h"
+#include "RLP.h"
+
+namespace dev
+{
+
+/// An item of an RLP list, as the schema decoder reads it.
+struct RLPSchemaItem
+{
+	bytesConstRef data;		///< The whole item.
+	bytesConstRef payload;	///< Its payload.
+	bool isList;
+};
+
+/// Reads the item at the front of @a io_data, dropping it from there.
+/// @throws BadRLP if the item is truncated.
+RLPSchemaItem readRLPItem(bytesConstRef& io_data);
+
+/// The decoders of the fields of a schema. Which one a field gets, and so what it must be, is given by its type:
+/// a FixedHash of N bytes must be data of exactly N bytes, as RLP::toHash with RLP::VeryStrict; bytesConstRef is
+/// any data, viewed in place; bytes is any data, copied; RLP is any item at all; and any other type is an integer,
+/// as RLP::toInt with RLP::Strict: data without a leading zero and no longer than the type.
+/// Each @throws BadCast if the item isn't as its field must be.
+template <unsigned N> void decodeRLPField(RLPSchemaItem const& _i, FixedHash<N>& o_field)
+{
+	if (_i.isList || _i.payload.size() != N)
+		BOOST_THROW_EXCEPTION(BadCast());
+	memcpy(o_field.data(), _i.payload.data(), N);
+}
+
+inline void decodeRLPField(RLPSchemaItem const& _i, bytesConstRef& o_field)
+{
+	if (_i.isList)
+		BOOST_THROW_EXCEPTION(BadCast());
+	o_field = _i.payload;
+}
+
+inline void decodeRLPField(RLPSchemaItem const& _i, bytes& o_field)
+{
+	if (_i.isList)
+		BOOST_THROW_EXCEPTION(BadCast());
+	o_field.assign(_i.payload.begin(), _i.payload.end());
+}
+
+inline void decodeRLPField(RLPSchemaItem const& _i, RLP& o_field)
+{
+	o_field = RLP(_i.data, RLP::ThrowOnFail);
+}
+
+/// Big-endian bytes of no more than the integer's size to the integer, a machine word at a time for the wide ones.
+template <class _T> _T fromBigEndianWords(bytesConstRef _b, std::true_type)
+{
+	return fromBigEndian<_T>(_b);
+}
+
+template <class _T> _T fromBigEndianWords(bytesConstRef _b, std::false_type)
+{
+	_T ret = 0;
+	size_t i = 0;
+	for (size_t head = _b.size() % 8; i < head; ++i)
+		ret = (ret << 8) | _b[i];
+	for (; i < _b.size(); i += 8)
+	{
+		uint64_t w = 0;
+		for (unsigned j = 0; j < 8; ++j)
+			w = (w << 8) | _b[i + j];
+		ret = (ret << 64) | w;
+	}
+	return ret;
+}
+
+template <class _T> void decodeRLPField(RLPSchemaItem const& _i, _T& o_field)
+{
+	if (_i.isList || _i.payload.size() > intTraits<_T>::maxSize || (_i.payload.size() && !_i.payload[0]))
+		BOOST_THROW_EXCEPTION(BadCast());
+	o_field = fromBigEndianWords<_T>(_i.payload, std::is_integral<_T>());
+}
+
+inline bool decodeRLPFields(bytesConstRef&, unsigned&) { return true; }
+
+template <class _F, class ... _Fs> bool decodeRLPFields(bytesConstRef& io_items, unsigned& io_field, _F& o_field, _Fs& ... o_fields)
+{
+	if (io_items.empty())
+		return false;
+	decodeRLPField(readRLPItem(io_items), o_field);
+	++io_field;
+	return decodeRLPFields(io_items, io_field, o_fields...);
+}
+
+/**
+ * Decodes the RLP list @a _rlp into @a o_fields, one item each, in order.
+ * The fields are the schema: their number is how many items there must be, and their types how each must be decoded
+ * (see decodeRLPField), which are settled at compile time, so that the list is checked and decoded in a single pass
+ * without an RLP being made for each item or any payload being copied other than into a field of type bytes.
+ * @code
+ * unsigned field;
+ * if (!decodeRLPList(_rlp, field, hash, number, extraData))
+ *     // not three items
+ * @endcode
+ * @a o_field is set to the index of the field being decoded, so that it names the offending field should this throw.
+ * @returns false if the list has other than as many items as there are fields; the leading fields may be decoded.
+ * @throws BadRLP if @a _rlp is not exactly one list or is malformed, BadCast if an item isn't as its field must be.
+ */
+template <class ... _Fields> bool decodeRLPList(bytesConstRef _rlp, unsigned& o_field, _Fields& ... o_fields)
+{
+	o_field = 0;
+	RLPSchemaItem list = readRLPItem(_rlp);
+	if (!list.isList || !_rlp.empty())
+		BOOST_THROW_EXCEPTION(BadRLP());
+	bytesConstRef items = list.payload;
+	return decodeRLPFields(items, o_field, o_fields...) && items.empty();
+}
+
+}
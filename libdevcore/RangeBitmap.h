@@ -0,0 +1,352 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file RangeBitmap.h
+ * @date 2015
+ * A RangeMask kept as a bitmap, for masks over long ranges that become fragmented.
+ */
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+#include <iostream>
+#include <assert.h>
+
+namespace dev
+{
+
+/**
+ * @brief The items of a range that are in a set, as RangeMask has them but kept as a bitmap.
+ * The bitmap is in chunks of 4096 items, of which only those with any item in are kept, so a mask of a few
+ * items over a long range is small. Whereas RangeMask's map grows and slows with how fragmented the set is,
+ * here each operation costs in proportion to the chunks it touches, and everything is done in place. Finding
+ * the lowest items in none of several masks, as a download does for each fetch, is done by lowestClear()
+ * without building their union or its inverse.
+ */
+template <class T>
+class RangeBitmap
+{
+	template <class U> friend std::ostream& operator<<(std::ostream& _out, RangeBitmap<U> const& _r);
+
+public:
+	using Range = std::pair<T, T>;
+	using Ranges = std::vector<Range>;
+
+	RangeBitmap(): m_all(0, 0) {}
+	RangeBitmap(T _begin, T _end): m_all(_begin, _end) {}
+	RangeBitmap(Range const& _c): m_all(_c) {}
+
+	RangeBitmap unionedWith(RangeBitmap const& _m) const { return operator+(_m); }
+	RangeBitmap operator+(RangeBitmap const& _m) const { return RangeBitmap(*this) += _m; }
+
+	/// @returns the lowest @a _items in the set.
+	RangeBitmap lowest(T _items) const
+	{
+		RangeBitmap ret(m_all);
+		for (auto i = m_chunks.begin(); i != m_chunks.end() && _items; ++i)
+			for (unsigned w = 0; w < c_chunkWords && _items; ++w)
+				ret.orWord(i->first, w, takeLowest(i->second.words[w], _items));
+		return ret;
+	}
+
+	/// @returns the lowest @a _items of the range in neither this nor any of @a _also, as (~(*this + ...)).lowest()
+	/// would but with no more work than it takes to find them.
+	RangeBitmap lowestClear(T _items, std::vector<RangeBitmap const*> const& _also = std::vector<RangeBitmap const*>()) const
+	{
+		RangeBitmap ret(m_all);
+		std::vector<Chunk const*> chunks;
+		for (T i = m_all.first; i < m_all.second && _items;)
+		{
+			T c = i / c_chunkBits;
+			T base = c * c_chunkBits;
+			chunks.clear();
+			bool full = false;
+			auto gather = [&](RangeBitmap const& _m)
+			{
+				auto it = _m.m_chunks.find(c);
+				if (it != _m.m_chunks.end())
+				{
+					full = full || it->second.count == c_chunkBits;
+					chunks.push_back(&it->second);
+				}
+			};
+			gather(*this);
+			for (auto m: _also)
+				gather(*m);
+			for (unsigned w = (i - base) / c_wordBits; !full && w < c_chunkWords && _items; ++w)
+			{
+				T wordBase = base + w * c_wordBits;
+				if (wordBase >= m_all.second)
+					break;
+				uint64_t used = 0;
+				for (auto ch: chunks)
+					used |= ch->words[w];
+				uint64_t clear = ~used;
+				if (wordBase < i)
+					clear &= ~((uint64_t(1) << (i - wordBase)) - 1);
+				if (m_all.second - wordBase < c_wordBits)
+					clear &= (uint64_t(1) << (m_all.second - wordBase)) - 1;
+				ret.orWord(c, w, takeLowest(clear, _items));
+			}
+			i = base + c_chunkBits;
+		}
+		return ret;
+	}
+
+	RangeBitmap operator~() const { return inverted(); }
+
+	RangeBitmap inverted() const
+	{
+		RangeBitmap ret(m_all);
+		ret.apply(m_all.first, m_all.second, true);
+		return ret -= *this;
+	}
+
+	RangeBitmap& invert() { return *this = inverted(); }
+
+	template <class S> RangeBitmap operator-(S const& _m) const { auto ret = *this; return ret -= _m; }
+
+	RangeBitmap& operator-=(RangeBitmap const& _m)
+	{
+		for (auto const& i: _m.m_chunks)
+		{
+			auto it = m_chunks.find(i.first);
+			if (it == m_chunks.end())
+				continue;
+			for (unsigned w = 0; w < c_chunkWords; ++w)
+				setWord(it->second, w, it->second.words[w] & ~i.second.words[w]);
+			if (!it->second.count)
+				m_chunks.erase(it);
+		}
+		return *this;
+	}
+	RangeBitmap& operator-=(Range const& _m) { apply(_m.first, _m.second, false); return *this; }
+	RangeBitmap& operator-=(T _i) { return operator-=(Range(_i, _i + 1)); }
+
+	RangeBitmap& operator+=(RangeBitmap const& _m) { return unionWith(_m); }
+
+	RangeBitmap& unionWith(RangeBitmap const& _m)
+	{
+		m_all.first = std::min(_m.m_all.first, m_all.first);
+		m_all.second = std::max(_m.m_all.second, m_all.second);
+		for (auto const& i: _m.m_chunks)
+			for (unsigned w = 0; w < c_chunkWords; ++w)
+				orWord(i.first, w, i.second.words[w]);
+		return *this;
+	}
+	RangeBitmap& operator+=(Range const& _m) { return unionWith(_m); }
+	RangeBitmap& unionWith(Range const& _m)
+	{
+		assert(_m.first >= _m.second || (_m.first >= m_all.first && _m.second <= m_all.second));
+		apply(_m.first, _m.second, true);
+		return *this;
+	}
+
+	RangeBitmap& operator+=(T _m) { return unionWith(_m); }
+	RangeBitmap& unionWith(T _i)
+	{
+		return operator+=(Range(_i, _i + 1));
+	}
+
+	bool contains(T _i) const
+	{
+		auto it = m_chunks.find(_i / c_chunkBits);
+		return it != m_chunks.end() && ((it->second.words[_i % c_chunkBits / c_wordBits] >> (_i % c_wordBits)) & 1);
+	}
+
+	bool empty() const
+	{
+		return m_chunks.empty();
+	}
+
+	bool full() const
+	{
+		return m_all.first == m_all.second || m_count == m_all.second - m_all.first;
+	}
+
+	/// @returns the number of items in the set.
+	size_t size() const { return m_count; }
+
+	void clear()
+	{
+		m_chunks.clear();
+		m_count = 0;
+	}
+
+	void reset()
+	{
+		clear();
+		m_all = std::make_pair(0, 0);
+	}
+
+	std::pair<T, T> const& all() const { return m_all; }
+	void extendAll(T _i) { m_all = std::make_pair(std::min(m_all.first, _i), std::max(m_all.second, _i + 1)); }
+
+	class const_iterator
+	{
+		friend class RangeBitmap;
+
+	public:
+		const_iterator() {}
+
+		T operator*() const { return m_value; }
+		const_iterator& operator++() { if (m_owner) m_value = m_owner->next(m_value); return *this; }
+		const_iterator operator++(int) { auto ret = *this; if (m_owner) m_value = m_owner->next(m_value); return ret; }
+
+		bool operator==(const_iterator const& _i) const { return m_owner == _i.m_owner && m_value == _i.m_value; }
+		bool operator!=(const_iterator const& _i) const { return !operator==(_i); }
+		bool operator<(const_iterator const& _i) const { return m_value < _i.m_value; }
+
+	private:
+		const_iterator(RangeBitmap const& _m, bool _end): m_owner(&_m), m_value(_end ? _m.m_all.second : _m.firstFrom(_m.m_all.first)) {}
+
+		RangeBitmap const* m_owner = nullptr;
+		T m_value = 0;
+	};
+
+	const_iterator begin() const { return const_iterator(*this, false); }
+	const_iterator end() const { return const_iterator(*this, true); }
+	T next(T _t) const { return firstFrom(_t + 1); }
+
+private:
+	static const unsigned c_wordBits = 64;
+	static const unsigned c_chunkWords = 64;
+	static const T c_chunkBits = c_wordBits * c_chunkWords;
+
+	struct Chunk
+	{
+		Chunk() { words.fill(0); }
+		std::array<uint64_t, c_chunkWords> words;
+		T count = 0;
+	};
+
+	static unsigned popCount(uint64_t _x) { return std::bitset<64>(_x).count(); }
+
+	/// @returns the lowest bits of @a _x, up to @a io_items of them, taking those from @a io_items.
+	static uint64_t takeLowest(uint64_t _x, T& io_items)
+	{
+		unsigned n = popCount(_x);
+		if (n <= io_items)
+		{
+			io_items -= n;
+			return _x;
+		}
+		uint64_t ret = 0;
+		for (; io_items; --io_items)
+		{
+			uint64_t low = _x & (~_x + 1);
+			ret |= low;
+			_x ^= low;
+		}
+		return ret;
+	}
+
+	/// @returns the lowest item of the set at least @a _from, or the end of the range if there is none.
+	T firstFrom(T _from) const
+	{
+		for (auto it = m_chunks.lower_bound(_from / c_chunkBits); it != m_chunks.end(); ++it)
+		{
+			T base = it->first * c_chunkBits;
+			for (unsigned w = base < _from ? (_from - base) / c_wordBits : 0; w < c_chunkWords; ++w)
+			{
+				T wordBase = base + w * c_wordBits;
+				uint64_t x = it->second.words[w];
+				if (wordBase < _from)
+					x &= ~((uint64_t(1) << (_from - wordBase)) - 1);
+				if (x)
+				{
+					T b = 0;
+					for (; !(x & 1); x >>= 1)
+						++b;
+					return wordBase + b;
+				}
+			}
+		}
+		return m_all.second;
+	}
+
+	void setWord(Chunk& _c, unsigned _w, uint64_t _x)
+	{
+		unsigned was = popCount(_c.words[_w]);
+		unsigned is = popCount(_x);
+		_c.words[_w] = _x;
+		_c.count = _c.count + is - was;
+		m_count = m_count + is - was;
+	}
+
+	void orWord(T _chunk, unsigned _w, uint64_t _x)
+	{
+		if (_x)
+		{
+			Chunk& c = m_chunks[_chunk];
+			setWord(c, _w, c.words[_w] | _x);
+		}
+	}
+
+	/// Puts the items [@a _begin, @a _end) in the set if @a _set, otherwise takes them out.
+	void apply(T _begin, T _end, bool _set)
+	{
+		while (_begin < _end)
+		{
+			T c = _begin / c_chunkBits;
+			T chunkEnd = _end - _begin > c_chunkBits - _begin % c_chunkBits ? (c + 1) * c_chunkBits : _end;
+			auto it = m_chunks.find(c);
+			if (it == m_chunks.end() && _set)
+				it = m_chunks.insert(std::make_pair(c, Chunk())).first;
+			if (it != m_chunks.end())
+			{
+				for (T i = _begin; i < chunkEnd;)
+				{
+					unsigned w = i % c_chunkBits / c_wordBits;
+					unsigned b = i % c_wordBits;
+					unsigned e = (unsigned)std::min<T>(T(c_wordBits), b + (chunkEnd - i));
+					uint64_t mask = (e == c_wordBits ? ~uint64_t(0) : (uint64_t(1) << e) - 1) & ~((uint64_t(1) << b) - 1);
+					setWord(it->second, w, _set ? it->second.words[w] | mask : it->second.words[w] & ~mask);
+					i += e - b;
+				}
+				if (!it->second.count)
+					m_chunks.erase(it);
+			}
+			_begin = chunkEnd;
+		}
+	}
+
+	Range m_all;
+	std::map<T, Chunk> m_chunks;	///< The chunks with any item in, by their first item / c_chunkBits.
+	size_t m_count = 0;				///< The items in the set.
+};
+
+template <class T> inline std::ostream& operator<<(std::ostream& _out, RangeBitmap<T> const& _r)
+{
+	_out << _r.m_all.first << "{ ";
+	for (auto i = _r.begin(); i != _r.end();)
+	{
+		T b = *i;
+		T e = b;
+		for (; i != _r.end() && *i == e; ++i)
+			++e;
+		_out << "[" << b << ", " << e << ") ";
+	}
+	_out << "}" << _r.m_all.second;
+	return _out;
+}
+
+}
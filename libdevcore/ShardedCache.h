@@ -0,0 +1,217 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file ShardedCache.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include "Guards.h"
+
+namespace dev
+{
+
+/**
+ * @brief A size-bounded map split into shards, each with its own lock and least-recently-used eviction.
+ * Lookups of keys in different shards never contend, and filling a miss locks only the one shard.
+ * @a _Size is a function object giving the bytes a value accounts for. Of the few least recently used entries,
+ * the largest is evicted first, so that one big entry goes before several small ones of about the same age.
+ * @threadsafe
+ */
+template <class _Key, class _Value, class _Size, class _Hash = std::hash<_Key>>
+class ShardedCache
+{
+public:
+	/// Bytes accounted for each entry on top of its value's size.
+	static const size_t c_entryOverhead = 64;
+	/// How many of the least recently used entries are weighed against each other for eviction.
+	static const unsigned c_evictionSample = 4;
+
+	/// @a _capacity bytes are split evenly among @a _shards; a shard over its share evicts its oldest entries.
+	explicit ShardedCache(size_t _capacity, unsigned _shards = 16): m_shards(new Shard[_shards]), m_shardCount(_shards), m_shardCapacity(_capacity / _shards) {}
+
+	/// Copies the value at @a _k into @a o_value, marking it most recently used. @returns false if it is not cached.
+	bool get(_Key const& _k, _Value& o_value)
+	{
+		Shard& s = shard(_k);
+		Guard l(s.x);
+		auto it = s.index.find(_k);
+		if (it == s.index.end())
+			return false;
+		s.entries.splice(s.entries.begin(), s.entries, it->second);
+		o_value = it->second->value;
+		return true;
+	}
+
+	/// @returns true if @a _k is cached, without counting as a use.
+	bool contains(_Key const& _k) const
+	{
+		Shard& s = shard(_k);
+		Guard l(s.x);
+		return s.index.count(_k);
+	}
+
+	/// Caches @a _v at @a _k as the most recently used entry, replacing any there.
+	void insert(_Key const& _k, _Value const& _v)
+	{
+		Shard& s = shard(_k);
+		Guard l(s.x);
+		auto it = s.index.find(_k);
+		if (it != s.index.end())
+		{
+			s.entries.splice(s.entries.begin(), s.entries, it->second);
+			it->second->value = _v;
+			resize(s, *it->second);
+		}
+		else
+		{
+			s.entries.push_front(Entry{_k, _v, 0});
+			s.index[_k] = s.entries.begin();
+			resize(s, s.entries.front());
+		}
+		evict(s);
+	}
+
+	/// Applies @a _f to the value at @a _k under its shard's lock, caching @a _default there first if it is absent.
+	/// @returns a copy of the updated value.
+	template <class _F> _Value update(_Key const& _k, _Value const& _default, _F const& _f)
+	{
+		Shard& s = shard(_k);
+		Guard l(s.x);
+		auto it = s.index.find(_k);
+		if (it == s.index.end())
+		{
+			s.entries.push_front(Entry{_k, _default, 0});
+			it = s.index.insert(std::make_pair(_k, s.entries.begin())).first;
+		}
+		else
+			s.entries.splice(s.entries.begin(), s.entries, it->second);
+		Entry& e = *it->second;
+		_f(e.value);
+		resize(s, e);
+		_Value ret = e.value;
+		evict(s);
+		return ret;
+	}
+
+	void erase(_Key const& _k)
+	{
+		Shard& s = shard(_k);
+		Guard l(s.x);
+		auto it = s.index.find(_k);
+		if (it == s.index.end())
+			return;
+		s.used -= it->second->size;
+		s.entries.erase(it->second);
+		s.index.erase(it);
+	}
+
+	void clear()
+	{
+		for (unsigned i = 0; i < m_shardCount; ++i)
+		{
+			Guard l(m_shards[i].x);
+			m_shards[i].entries.clear();
+			m_shards[i].index.clear();
+			m_shards[i].used = 0;
+		}
+	}
+
+	/// @returns the bytes accounted for across all shards.
+	size_t memoryUsage() const
+	{
+		size_t ret = 0;
+		for (unsigned i = 0; i < m_shardCount; ++i)
+		{
+			Guard l(m_shards[i].x);
+			ret += m_shards[i].used;
+		}
+		return ret;
+	}
+
+	/// @returns the bytes above which the shards, together, evict.
+	size_t capacity() const { return m_shardCapacity * m_shardCount; }
+	/// Sets the capacity to @a _capacity bytes, evicting at once down to it.
+	void setCapacity(size_t _capacity)
+	{
+		m_shardCapacity = _capacity / m_shardCount;
+		for (unsigned i = 0; i < m_shardCount; ++i)
+		{
+			Guard l(m_shards[i].x);
+			evict(m_shards[i]);
+		}
+	}
+
+private:
+	struct Entry
+	{
+		_Key key;
+		_Value value;
+		size_t size;
+	};
+
+	struct Shard
+	{
+		mutable Mutex x;
+		std::list<Entry> entries;		///< Most recently used first.
+		std::unordered_map<_Key, typename std::list<Entry>::iterator, _Hash> index;
+		size_t used = 0;
+	};
+
+	Shard& shard(_Key const& _k) const
+	{
+		// Mix the hash, since that of h256 is a plain xor of its words and so leaves small numbers' low bits clear.
+		uint64_t h = _Hash()(_k);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return m_shards[h % m_shardCount];
+	}
+
+	static void resize(Shard& _s, Entry& _e)
+	{
+		_s.used -= _e.size;
+		_e.size = _Size()(_e.value) + c_entryOverhead;
+		_s.used += _e.size;
+	}
+
+	/// Drops old entries of @a _s until it fits its share, always keeping the newest.
+	void evict(Shard& _s)
+	{
+		while (_s.used > m_shardCapacity && _s.entries.size() > 1)
+		{
+			auto victim = std::prev(_s.entries.end());
+			auto it = victim;
+			for (unsigned i = 1; i < c_evictionSample && std::prev(it) != _s.entries.begin(); ++i)
+				if ((--it)->size > victim->size)
+					victim = it;
+			_s.used -= victim->size;
+			_s.index.erase(victim->key);
+			_s.entries.erase(victim);
+		}
+	}
+
+	std::unique_ptr<Shard[]> m_shards;
+	unsigned m_shardCount;
+	std::atomic<size_t> m_shardCapacity;
+};
+
+}
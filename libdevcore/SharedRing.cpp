@@ -0,0 +1,134 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SharedRing.cpp
+ * @date 2015
+ */
+
+#include "SharedRing.h"
+
+#include <cstring>
+#include <new>
+#include <boost/filesystem.hpp>
+using namespace std;
+using namespace dev;
+
+/// Marks the file as a ring, and which layout it has.
+static const uint64_t c_magic = 0x31676e6972687465;	// "ethring1"
+/// Each record is its length, then its bytes, padded so that the next length is aligned.
+static const uint64_t c_lengthSize = sizeof(uint64_t);
+/// In place of a length, says that the record would not fit before the end, so it is at the start.
+static const uint64_t c_wrapped = ~uint64_t(0);
+
+static uint64_t padded(uint64_t _size) { return (_size + c_lengthSize - 1) / c_lengthSize * c_lengthSize; }
+
+static size_t fileSize(string const& _path)
+{
+	boost::system::error_code ec;
+	auto ret = boost::filesystem::file_size(_path, ec);
+	return ec ? 0 : (size_t)ret;
+}
+
+SharedRing::SharedRing(string const& _path, size_t _capacity):
+	SharedRing(_path, sizeof(Header) + _capacity / c_lengthSize * c_lengthSize, true)
+{
+}
+
+SharedRing::SharedRing(string const& _path):
+	SharedRing(_path, fileSize(_path), false)
+{
+}
+
+SharedRing::SharedRing(string const& _path, size_t _fileSize, bool _create):
+	// Nothing is created for a reader of a file that is not there.
+	m_file(_create || _fileSize ? _path : string(), _fileSize)
+{
+	if (!m_file.data() || _fileSize <= sizeof(Header))
+		return;
+	if (_create)
+	{
+		// Truncated first, so that no reader takes what was there for records.
+		if (!m_file.resize(0) || !m_file.resize(_fileSize))
+			return;
+		m_header = new (m_file.data()) Header;
+		m_header->capacity = _fileSize - sizeof(Header);
+		m_header->reserved = 0;
+		m_header->written = 0;
+		m_header->magic = c_magic;
+		return;
+	}
+	auto h = (Header*)m_file.data();
+	if (m_file.size() == _fileSize && h->magic == c_magic && h->capacity == _fileSize - sizeof(Header))
+		m_header = h;
+}
+
+uint64_t SharedRing::append(bytesConstRef _record)
+{
+	uint64_t need = c_lengthSize + padded(_record.size());
+	if (!isOpen() || need > m_header->capacity / 2)
+		return (uint64_t)-1;
+
+	uint64_t pos = m_header->written.load(memory_order_relaxed);
+	uint64_t left = m_header->capacity - pos % m_header->capacity;
+	uint64_t skip = need > left ? left : 0;
+	// Readers check this once they have copied a record, to know whether it changed under them.
+	m_header->reserved.store(pos + skip + need, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+
+	if (skip)
+	{
+		memcpy(at(pos), &c_wrapped, c_lengthSize);
+		pos += skip;
+	}
+	uint64_t length = _record.size();
+	memcpy(at(pos), &length, c_lengthSize);
+	memcpy(at(pos) + c_lengthSize, _record.data(), _record.size());
+	m_header->written.store(pos + need, memory_order_release);
+	return pos;
+}
+
+bool SharedRing::read(uint64_t& io_pos, bytes& o_record) const
+{
+	if (!isOpen() || io_pos % c_lengthSize)
+		return false;
+	uint64_t capacity = m_header->capacity;
+	uint64_t written = m_header->written.load(memory_order_acquire);
+	if (io_pos >= written || m_header->reserved.load(memory_order_relaxed) > io_pos + capacity)
+		return false;
+
+	uint64_t pos = io_pos;
+	uint64_t length;
+	memcpy(&length, at(pos), c_lengthSize);
+	if (length == c_wrapped)
+	{
+		pos += capacity - pos % capacity;
+		if (pos >= written)
+			return false;
+		memcpy(&length, at(pos), c_lengthSize);
+	}
+	// Should the writer have been here since, the length may be anything.
+	bool fits = length <= capacity - pos % capacity - c_lengthSize;
+	bytes record;
+	if (fits)
+		record = bytes(at(pos) + c_lengthSize, at(pos) + c_lengthSize + length);
+	atomic_thread_fence(memory_order_acquire);
+	if (!fits || m_header->reserved.load(memory_order_relaxed) > io_pos + capacity)
+		return false;
+
+	o_record = move(record);
+	io_pos = pos + c_lengthSize + padded(length);
+	return true;
+}
@@ -0,0 +1,77 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SharedRing.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include "Common.h"
+#include "MappedFile.h"
+
+namespace dev
+{
+
+/**
+ * @brief A ring of records in a file mapped into memory, written by one process and read, without locking or copying
+ * through the kernel, by any others on the host that map it.
+ * Records are known by their position: the count of bytes written to the ring before them, which only grows. Once the
+ * writer has gone a capacity past a record, it is overwritten, which a reader finds out when it reads it, so that it
+ * may fetch what it missed some other way. Not available on Windows, where isOpen() is always false.
+ */
+class SharedRing
+{
+public:
+	/// Creates @a _path afresh, for the writer, with room for @a _capacity bytes of records.
+	SharedRing(std::string const& _path, size_t _capacity);
+	/// Opens @a _path, made by a writer, for reading.
+	explicit SharedRing(std::string const& _path);
+
+	bool isOpen() const { return !!m_header; }
+	size_t capacity() const { return isOpen() ? m_header->capacity : 0; }
+	/// @returns the position after the last record written.
+	uint64_t end() const { return isOpen() ? m_header->written.load(std::memory_order_acquire) : 0; }
+
+	/// Writes @a _record after the last, overwriting the oldest it needs to. Only for the writer.
+	/// @returns its position, or -1 if the ring is not open or the record needs more than half of it.
+	uint64_t append(bytesConstRef _record);
+	/// Copies the record at @a io_pos into @a o_record and moves @a io_pos on to the next.
+	/// @returns false, leaving @a io_pos, if there is no record there yet or it has been overwritten.
+	bool read(uint64_t& io_pos, bytes& o_record) const;
+
+private:
+	SharedRing(std::string const& _path, size_t _fileSize, bool _create);
+
+	/// What the file starts with; the records follow.
+	struct Header
+	{
+		uint64_t magic;
+		uint64_t capacity;
+		std::atomic<uint64_t> reserved;		///< The end of what the writer may be writing over.
+		std::atomic<uint64_t> written;		///< The end of what it has finished writing.
+	};
+
+	byte* at(uint64_t _pos) const { return m_file.data() + sizeof(Header) + _pos % m_header->capacity; }
+
+	GrowableMappedFile m_file;
+	Header* m_header = nullptr;
+};
+
+}
@@ -0,0 +1,144 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SmallVector.h
+ * @date 2015
+ * A vector which keeps its first few items in place, allocating only once it outgrows them.
+ */
+
+#pragma once
+
+#include <cstring>
+#include <type_traits>
+#include <vector>
+#include "Common.h"
+
+namespace dev
+{
+
+/**
+ * @brief A vector of up to @a N trivial items kept inline, and of more in a std::vector.
+ * For the many short-lived buffers that are usually small, such as RLP of a single value or a trie node, this
+ * saves the allocation a std::vector makes on its first item. Once it has spilled into its std::vector it stays
+ * there, so that the std::vector may be taken by spill() or swap() without a copy.
+ */
+template <class _T, size_t N> class SmallVector
+{
+	static_assert(std::is_trivial<_T>::value, "SmallVector keeps only trivial types.");
+
+public:
+	SmallVector() {}
+	SmallVector(vector_ref<_T const> _r) { assign(_r); }
+	SmallVector(SmallVector const& _s) { assign(_s.ref()); }
+	SmallVector(SmallVector&& _s) { *this = std::move(_s); }
+
+	SmallVector& operator=(SmallVector const& _s) { if (this != &_s) assign(_s.ref()); return *this; }
+	SmallVector& operator=(SmallVector&& _s)
+	{
+		if (_s.m_spilled)
+		{
+			m_vector = std::move(_s.m_vector);
+			m_spilled = true;
+			_s.m_vector.clear();
+		}
+		else
+			assign(_s.ref());
+		return *this;
+	}
+
+	size_t size() const { return m_spilled ? m_vector.size() : m_size; }
+	bool empty() const { return !size(); }
+	/// @returns true if the items are in the std::vector rather than inline.
+	bool spilled() const { return m_spilled; }
+
+	_T* data() { return m_spilled ? m_vector.data() : m_inline; }
+	_T const* data() const { return m_spilled ? m_vector.data() : m_inline; }
+	_T* begin() { return data(); }
+	_T* end() { return data() + size(); }
+	_T const* begin() const { return data(); }
+	_T const* end() const { return data() + size(); }
+	_T& operator[](size_t _i) { return data()[_i]; }
+	_T const& operator[](size_t _i) const { return data()[_i]; }
+	_T& back() { return data()[size() - 1]; }
+	_T const& back() const { return data()[size() - 1]; }
+
+	vector_ref<_T const> ref() const { return vector_ref<_T const>(data(), size()); }
+	vector_ref<_T> ref() { return vector_ref<_T>(data(), size()); }
+	std::vector<_T> toVector() const { return std::vector<_T>(begin(), end()); }
+
+	void push_back(_T const& _t)
+	{
+		if (!m_spilled && m_size < N)
+			m_inline[m_size++] = _t;
+		else
+			spill().push_back(_t);
+	}
+	void pop_back() { if (m_spilled) m_vector.pop_back(); else --m_size; }
+
+	/// Resizes to @a _n items, those added being zero.
+	void resize(size_t _n)
+	{
+		if (m_spilled || _n > N)
+			spill().resize(_n);
+		else
+		{
+			if (_n > m_size)
+				memset(m_inline + m_size, 0, (_n - m_size) * sizeof(_T));
+			m_size = _n;
+		}
+	}
+	void reserve(size_t _n) { if (m_spilled || _n > N) spill().reserve(_n); }
+	void clear() { m_size = 0; m_vector.clear(); }
+
+	void assign(vector_ref<_T const> _r)
+	{
+		if (m_spilled || _r.size() > N)
+			spill().assign(_r.begin(), _r.end());
+		else
+		{
+			memcpy(m_inline, _r.data(), _r.size() * sizeof(_T));
+			m_size = _r.size();
+		}
+	}
+
+	/// Moves the items into the std::vector, should they be inline, for good. @returns the std::vector.
+	std::vector<_T>& spill()
+	{
+		if (!m_spilled)
+		{
+			m_vector.assign(m_inline, m_inline + m_size);
+			m_spilled = true;
+		}
+		return m_vector;
+	}
+
+	/// Swaps the items with those of @a _v, leaving them in the std::vector.
+	void swap(std::vector<_T>& _v) { spill().swap(_v); }
+
+	bool operator==(SmallVector const& _c) const { return size() == _c.size() && !memcmp(data(), _c.data(), size() * sizeof(_T)); }
+	bool operator!=(SmallVector const& _c) const { return !operator==(_c); }
+
+private:
+	_T m_inline[N];
+	size_t m_size = 0;				///< Of m_inline, while not spilled.
+	bool m_spilled = false;
+	std::vector<_T> m_vector;
+};
+
+/// Bytes which are usually few enough to keep inline, such as the RLP of a small item.
+using SmallBytes = SmallVector<byte, 64>;
+
+}
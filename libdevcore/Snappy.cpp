@@ -0,0 +1,217 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Snappy.cpp
+ * @date 2015
+ */
+
+#include "Snappy.h"
+#include <cstring>
+using namespace std;
+using namespace dev;
+
+/// Input is compressed in blocks of this many bytes, as copies reach back at most 64KB.
+static const size_t c_blockSize = 1 << 16;
+/// Bits of the hash of four bytes kept in the table of where they were last seen.
+static const unsigned c_hashBits = 14;
+
+static uint32_t load32(byte const* _p)
+{
+	uint32_t ret;
+	memcpy(&ret, _p, 4);
+	return ret;
+}
+
+static unsigned hash4(byte const* _p)
+{
+	return (load32(_p) * 0x1e35a7bd) >> (32 - c_hashBits);
+}
+
+static void appendVarint(bytes& _out, uint64_t _v)
+{
+	for (; _v >= 0x80; _v >>= 7)
+		_out.push_back((byte)(_v | 0x80));
+	_out.push_back((byte)_v);
+}
+
+static void appendLiteral(bytes& _out, byte const* _p, size_t _n)
+{
+	if (!_n)
+		return;
+	size_t n = _n - 1;
+	if (n < 60)
+		_out.push_back((byte)(n << 2));
+	else
+	{
+		unsigned count = n < 0x100 ? 1 : n < 0x10000 ? 2 : n < 0x1000000 ? 3 : 4;
+		_out.push_back((byte)((59 + count) << 2));
+		for (unsigned i = 0; i < count; ++i)
+			_out.push_back((byte)(n >> (8 * i)));
+	}
+	_out.insert(_out.end(), _p, _p + _n);
+}
+
+static void appendCopy(bytes& _out, size_t _offset, size_t _length)
+{
+	// Copies of up to 64 bytes each; one of 60 first if need be so that what is left is never under four.
+	while (_length >= 68)
+	{
+		_out.push_back((byte)(2 | (63 << 2)));
+		_out.push_back((byte)_offset);
+		_out.push_back((byte)(_offset >> 8));
+		_length -= 64;
+	}
+	if (_length > 64)
+	{
+		_out.push_back((byte)(2 | (59 << 2)));
+		_out.push_back((byte)_offset);
+		_out.push_back((byte)(_offset >> 8));
+		_length -= 60;
+	}
+	if (_length < 12 && _offset < 2048)
+	{
+		_out.push_back((byte)(1 | ((_length - 4) << 2) | ((_offset >> 8) << 5)));
+		_out.push_back((byte)_offset);
+	}
+	else
+	{
+		_out.push_back((byte)(2 | ((_length - 1) << 2)));
+		_out.push_back((byte)_offset);
+		_out.push_back((byte)(_offset >> 8));
+	}
+}
+
+static void compressBlock(bytes& _out, byte const* _in, size_t _size, vector<uint16_t>& _table)
+{
+	fill(_table.begin(), _table.end(), 0);
+	byte const* literal = _in;
+	if (_size >= 15)
+	{
+		// Stops short of the end, so that four bytes may always be read; what remains goes as a literal.
+		byte const* end = _in + _size;
+		byte const* limit = end - 4;
+		byte const* p = _in + 1;
+		for (unsigned misses = 32; p < limit;)
+		{
+			unsigned h = hash4(p);
+			byte const* candidate = _in + _table[h];
+			_table[h] = (uint16_t)(p - _in);
+			if (candidate >= p || load32(candidate) != load32(p))
+			{
+				// The longer nothing matches, the more is skipped, so that incompressible data goes quickly.
+				p += misses++ >> 5;
+				continue;
+			}
+			appendLiteral(_out, literal, p - literal);
+			size_t length = 4;
+			while (p + length < end && candidate[length] == p[length])
+				++length;
+			appendCopy(_out, p - candidate, length);
+			p += length;
+			literal = p;
+			misses = 32;
+		}
+	}
+	appendLiteral(_out, literal, _in + _size - literal);
+}
+
+void dev::snappyCompress(bytesConstRef _in, bytes& io_out)
+{
+	io_out.reserve(io_out.size() + _in.size() + _in.size() / 6 + 32);
+	appendVarint(io_out, _in.size());
+	vector<uint16_t> table(1 << c_hashBits);
+	for (size_t i = 0; i < _in.size(); i += c_blockSize)
+		compressBlock(io_out, _in.data() + i, min(c_blockSize, _in.size() - i), table);
+}
+
+bool dev::snappyUncompress(bytesConstRef _in, bytes& io_out, size_t _limit)
+{
+	byte const* p = _in.data();
+	byte const* end = p + _in.size();
+	uint64_t size = 0;
+	for (unsigned shift = 0;; shift += 7)
+	{
+		if (p == end || shift > 63)
+			return false;
+		size |= (uint64_t)(*p & 0x7f) << shift;
+		if (!(*p++ & 0x80))
+			break;
+	}
+	if (size > _limit)
+		return false;
+	size_t begin = io_out.size();
+	size += begin;
+	io_out.reserve((size_t)size);
+
+	while (p < end)
+	{
+		byte tag = *p++;
+		size_t length;
+		size_t offset;
+		switch (tag & 3)
+		{
+		case 0:
+			length = tag >> 2;
+			if (length >= 60)
+			{
+				unsigned count = length - 59;
+				if ((size_t)(end - p) < count)
+					return false;
+				length = 0;
+				for (unsigned i = 0; i < count; ++i)
+					length |= (size_t)*p++ << (8 * i);
+			}
+			++length;
+			if ((size_t)(end - p) < length || io_out.size() + length > size)
+				return false;
+			io_out.insert(io_out.end(), p, p + length);
+			p += length;
+			continue;
+		case 1:
+			if (p == end)
+				return false;
+			length = ((tag >> 2) & 7) + 4;
+			offset = ((size_t)(tag >> 5) << 8) | *p++;
+			break;
+		case 2:
+			if (end - p < 2)
+				return false;
+			length = (tag >> 2) + 1;
+			offset = p[0] | ((size_t)p[1] << 8);
+			p += 2;
+			break;
+		default:
+			if (end - p < 4)
+				return false;
+			length = (tag >> 2) + 1;
+			offset = p[0] | ((size_t)p[1] << 8) | ((size_t)p[2] << 16) | ((size_t)p[3] << 24);
+			p += 4;
+			break;
+		}
+		if (!offset || offset > io_out.size() - begin || io_out.size() + length > size)
+			return false;
+		size_t at = io_out.size();
+		io_out.resize(at + length);
+		byte* d = io_out.data() + at;
+		if (offset >= length)
+			memcpy(d, d - offset, length);
+		else
+			// Byte by byte, as the copy overlaps what it makes.
+			for (size_t i = 0; i < length; ++i)
+				d[i] = d[i - offset];
+	}
+	return io_out.size() == size;
+}
@@ -0,0 +1,38 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Snappy.h
+ * @date 2015
+ * Compression in Snappy's raw format: quick, for data with repeats, such as RLP of padded numbers and addresses.
+ */
+
+#pragma once
+
+#include "Common.h"
+
+namespace dev
+{
+
+/// Appends @a _in compressed to @a io_out.
+void snappyCompress(bytesConstRef _in, bytes& io_out);
+inline bytes snappyCompress(bytesConstRef _in) { bytes ret; snappyCompress(_in, ret); return ret; }
+
+/// Appends @a _in uncompressed to @a io_out.
+/// @returns false, leaving what is appended unspecified, if @a _in is malformed or would uncompress to over @a _limit
+/// bytes.
+bool snappyUncompress(bytesConstRef _in, bytes& io_out, size_t _limit = (size_t)-1);
+
+}
@@ -180,5 +180,28 @@ void StructuredLogger::transactionReceived(string const& _hash, string const& _r
 	}
 }
 
+void StructuredLogger::vmProfile(
+	string const& _codeHash,
+	uint64_t _runs,
+	uint64_t _steps,
+	uint64_t _gas,
+	uint64_t _microseconds,
+	string const& _hottestOpcodes)
+{
+	if (get().m_enabled)
+	{
+		Json::Value event;
+		event["code_hash"] = _codeHash;
+		event["runs"] = Json::Value((Json::UInt64)_runs);
+		event["steps"] = Json::Value((Json::UInt64)_steps);
+		event["gas"] = Json::Value((Json::UInt64)_gas);
+		event["time_us"] = Json::Value((Json::UInt64)_microseconds);
+		event["hottest_opcodes"] = _hottestOpcodes;
+		event["ts"] = dev::toString(chrono::system_clock::now(), get().m_timeFormat.c_str());
+
+		get().outputJson(event, "eth.vm.profile");
+	}
+}
+
 
 }
@@ -25,6 +25,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <chrono>
 
@@ -92,6 +93,14 @@ public:
 		std::string const& _prevHash
 	);
 	static void transactionReceived(std::string const& _hash, std::string const& _remoteId);
+	static void vmProfile(
+		std::string const& _codeHash,
+		uint64_t _runs,
+		uint64_t _steps,
+		uint64_t _gas,
+		uint64_t _microseconds,
+		std::string const& _hottestOpcodes
+	);
 private:
 	// Singleton class. Private default ctor and no copying
 	StructuredLogger() = default;
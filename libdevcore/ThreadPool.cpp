@@ -0,0 +1,267 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file ThreadPool.cpp
+ * @date 2015
+ */
+
+#include "ThreadPool.h"
+#include "Log.h"
+using namespace std;
+using namespace dev;
+
+namespace
+{
+/// The pool and index of the current thread, if it is one of a pool's.
+struct PoolThread
+{
+	ThreadPool const* pool;
+	unsigned index;
+};
+boost::thread_specific_ptr<PoolThread> t_poolThread;
+}
+
+ThreadPool::ThreadPool(unsigned _threads)
+{
+	for (unsigned i = 0; i < _threads; ++i)
+		m_locals.emplace_back(new Local);
+	for (unsigned i = 0; i < _threads; ++i)
+		m_threads.emplace_back([=]() { run(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		Guard l(x_timer);
+		m_timerStop = true;
+	}
+	m_timerChanged.notify_all();
+	if (m_timer.joinable())
+		m_timer.join();
+
+	{
+		Guard l(x_tasks);
+		m_stop = true;
+	}
+	m_ready.notify_all();
+	for (auto& t: m_threads)
+		t.join();
+}
+
+std::atomic<unsigned> ThreadPool::s_sharedSize{0};
+
+ThreadPool& ThreadPool::get()
+{
+	// At least one, so that pooled Workers and posted tasks never run on the thread posting them.
+	static ThreadPool s_pool(s_sharedSize ? s_sharedSize.load() : max(thread::hardware_concurrency(), 2u) - 1);
+	return s_pool;
+}
+
+void ThreadPool::run(unsigned _i)
+{
+	setThreadName("pool");
+	t_poolThread.reset(new PoolThread{this, _i});
+	Task task;
+	while (true)
+	{
+		if (take(_i, task))
+		{
+			task();
+			task = Task();
+			continue;
+		}
+		unique_lock<Mutex> l(x_tasks);
+		m_ready.wait(l, [&]() { return m_stop || m_waiting; });
+		if (m_stop)
+			return;
+	}
+}
+
+bool ThreadPool::take(unsigned _i, Task& o_task)
+{
+	if (!m_waiting)
+		return false;
+
+	auto fromGlobal = [&](TaskPriority _p)
+	{
+		Guard l(x_tasks);
+		auto& q = m_global[(unsigned)_p];
+		if (q.empty())
+			return false;
+		o_task = move(q.front());
+		q.pop_front();
+		return true;
+	};
+	auto fromLocal = [&](unsigned _j)
+	{
+		Local& local = *m_locals[_j];
+		Guard l(local.x_tasks);
+		if (local.tasks.empty())
+			return false;
+		// Our own newest first; the oldest of anyone else's.
+		if (_j == _i)
+		{
+			o_task = move(local.tasks.back());
+			local.tasks.pop_back();
+		}
+		else
+		{
+			o_task = move(local.tasks.front());
+			local.tasks.pop_front();
+		}
+		return true;
+	};
+
+	bool got = fromGlobal(TaskPriority::High) || fromLocal(_i) || fromGlobal(TaskPriority::Normal);
+	for (unsigned j = 1; !got && j < m_locals.size(); ++j)
+		got = fromLocal((_i + j) % m_locals.size());
+	got = got || fromGlobal(TaskPriority::Low);
+	if (got)
+		--m_waiting;
+	return got;
+}
+
+void ThreadPool::post(Task _f, TaskPriority _p)
+{
+	auto task = [=]()
+	{
+		try
+		{
+			_f();
+		}
+		catch (...)
+		{
+			cwarn << "Pooled task threw:" << boost::current_exception_diagnostic_information();
+		}
+	};
+	if (m_threads.empty())
+	{
+		task();
+		return;
+	}
+
+	// Counted before it is put anywhere, so that whoever takes it cannot count it out first.
+	PoolThread const* self = t_poolThread.get();
+	bool local = self && self->pool == this && _p == TaskPriority::Normal;
+	{
+		Guard l(x_tasks);
+		++m_waiting;
+		if (!local)
+			m_global[(unsigned)_p].push_back(move(task));
+	}
+	if (local)
+	{
+		Local& l = *m_locals[self->index];
+		Guard g(l.x_tasks);
+		l.tasks.push_back(move(task));
+	}
+	m_ready.notify_one();
+}
+
+void ThreadPool::schedule(Clock::duration _delay, Task _f, TaskPriority _p)
+{
+	Guard l(x_timer);
+	if (m_timerStop)
+		return;
+	if (!m_timer.joinable())
+		m_timer = thread([this]() { runTimer(); });
+	m_timed.insert(make_pair(Clock::now() + _delay, make_pair(move(_f), _p)));
+	m_timerChanged.notify_all();
+}
+
+void ThreadPool::runTimer()
+{
+	setThreadName("pool timer");
+	unique_lock<Mutex> l(x_timer);
+	while (!m_timerStop)
+	{
+		if (m_timed.empty())
+			m_timerChanged.wait(l);
+		else if (m_timed.begin()->first > Clock::now())
+			m_timerChanged.wait_until(l, m_timed.begin()->first);
+		else
+		{
+			auto due = move(m_timed.begin()->second);
+			m_timed.erase(m_timed.begin());
+			l.unlock();
+			post(move(due.first), due.second);
+			l.lock();
+		}
+	}
+}
+
+void ThreadPool::work(Job& _job)
+{
+	unsigned i;
+	while ((i = _job.next++) < _job.count)
+	{
+		try
+		{
+			(*_job.f)(i);
+		}
+		catch (...)
+		{
+			Guard l(_job.x_job);
+			if (!_job.error)
+				_job.error = current_exception();
+		}
+		if (++_job.done == _job.count)
+		{
+			// Take the lock so the caller cannot miss the notification between its check and its wait.
+			Guard l(_job.x_job);
+			_job.finished.notify_all();
+		}
+	}
+}
+
+void ThreadPool::forEach(unsigned _n, function<void(unsigned)> const& _f)
+{
+	if (!_n)
+		return;
+
+	auto job = make_shared<Job>();
+	job->f = &_f;
+	job->count = _n;
+	job->next = 0;
+	job->done = 0;
+	// Helpers finding the items all taken return at once; the job outlives any that start late.
+	for (unsigned i = min<unsigned>(_n - 1, m_threads.size()); i > 0; --i)
+		post([=]() { work(*job); }, TaskPriority::High);
+
+	work(*job);
+	{
+		unique_lock<Mutex> l(job->x_job);
+		job->finished.wait(l, [&]() { return job->done == job->count; });
+	}
+
+	if (job->error)
+		rethrow_exception(job->error);
+}
+
+void ThreadPool::forRange(size_t _begin, size_t _end, function<void(size_t, size_t)> const& _f, size_t _grain)
+{
+	if (_end <= _begin)
+		return;
+	size_t n = _end - _begin;
+	if (!_grain)
+		_grain = max<size_t>(n / ((m_threads.size() + 1) * 4), 1);
+	size_t pieces = (n + _grain - 1) / _grain;
+	forEach(pieces, [&](unsigned i)
+	{
+		size_t b = _begin + i * _grain;
+		_f(b, min(b + _grain, _end));
+	});
+}
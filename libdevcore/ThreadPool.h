@@ -0,0 +1,146 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file ThreadPool.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "Guards.h"
+
+namespace dev
+{
+
+/// How soon a task runs relative to others waiting. Within a priority, tasks run in no particular order.
+enum class TaskPriority
+{
+	High,		///< Before any other waiting task, e.g. helping with a loop someone waits on.
+	Normal,
+	Low			///< Only once nothing else is waiting, e.g. housekeeping.
+};
+
+/**
+ * @brief A fixed set of threads running tasks and data-parallel loops.
+ * Each thread keeps a deque of the tasks it posts itself, taking the newest first, and when it runs dry steals the
+ * oldest from the other threads, so that tasks spawning tasks stay on the thread that spawned them, and so in cache,
+ * until another is idle. Tasks posted from outside the pool wait in a queue for each priority.
+ * @threadsafe
+ */
+class ThreadPool
+{
+public:
+	using Task = std::function<void()>;
+	using Clock = std::chrono::steady_clock;
+
+	/// Starts @a _threads threads; with 0, tasks and loops run on the thread posting them.
+	explicit ThreadPool(unsigned _threads);
+	~ThreadPool();
+
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool& operator=(ThreadPool const&) = delete;
+
+	/// Runs @a _f on the pool. Should it throw, the exception is logged and dropped.
+	void post(Task _f, TaskPriority _p = TaskPriority::Normal);
+
+	/// Runs @a _f on the pool. @returns a future for what it returns or throws.
+	template <class F> auto submit(F _f, TaskPriority _p = TaskPriority::Normal) -> std::future<decltype(_f())>
+	{
+		auto task = std::make_shared<std::packaged_task<decltype(_f())()>>(std::move(_f));
+		auto ret = task->get_future();
+		post([=]() { (*task)(); }, _p);
+		return ret;
+	}
+
+	/// Posts @a _f once @a _delay has passed.
+	void schedule(Clock::duration _delay, Task _f, TaskPriority _p = TaskPriority::Normal);
+
+	/// Calls @a _f(i) for each i in [0, _n), returning once all calls are done. The calling thread takes part.
+	/// If any call throws, the first exception is rethrown here after the others are done.
+	void forEach(unsigned _n, std::function<void(unsigned)> const& _f);
+
+	/// Calls @a _f(b, e) on consecutive ranges [b, e) of about @a _grain items together covering [_begin, _end), as
+	/// forEach() does. With no @a _grain, the range is split in a few times as many pieces as there are threads.
+	void forRange(size_t _begin, size_t _end, std::function<void(size_t, size_t)> const& _f, size_t _grain = 0);
+
+	/// @returns the number of threads in the pool, apart from callers.
+	unsigned size() const { return m_threads.size(); }
+
+	/// @returns the shared pool, with a thread per hardware thread other than the caller's, and at least one, unless
+	/// setSharedSize() said otherwise.
+	static ThreadPool& get();
+	/// Sets the number of threads the shared pool starts with, at least one; 0 goes back to the default. Only has an
+	/// effect before the first get().
+	static void setSharedSize(unsigned _threads) { s_sharedSize = _threads; }
+
+private:
+	/// The tasks a thread of the pool has posted itself.
+	struct Local
+	{
+		Mutex x_tasks;
+		std::deque<Task> tasks;
+	};
+
+	struct Job
+	{
+		std::function<void(unsigned)> const* f;
+		unsigned count;
+		std::atomic<unsigned> next;
+		std::atomic<unsigned> done;
+		std::exception_ptr error;
+		Mutex x_job;
+		Condition finished;					///< Signalled when the last item completes.
+	};
+
+	/// Runs on each thread of the pool.
+	void run(unsigned _i);
+	/// Takes the next task for thread @a _i of the pool into @a o_task. @returns false if there is none.
+	bool take(unsigned _i, Task& o_task);
+	/// Runs items of @a _job until none are left.
+	void work(Job& _job);
+	/// Runs on the timer thread, posting scheduled tasks as they come due.
+	void runTimer();
+
+	static std::atomic<unsigned> s_sharedSize;
+
+	std::vector<std::thread> m_threads;
+	std::vector<std::unique_ptr<Local>> m_locals;	///< One for each of m_threads.
+
+	Mutex x_tasks;								///< Lock for m_global, m_stop and waiting for tasks.
+	std::deque<Task> m_global[3];				///< Tasks posted from outside the pool, by priority.
+	std::atomic<unsigned> m_waiting{0};			///< Tasks waiting, wherever they are.
+	Condition m_ready;							///< Signalled when a task is posted or the pool stops.
+	bool m_stop = false;
+
+	Mutex x_timer;								///< Lock for m_timed and m_timerStop.
+	std::multimap<Clock::time_point, std::pair<Task, TaskPriority>> m_timed;
+	Condition m_timerChanged;
+	std::thread m_timer;						///< Started on the first schedule().
+	bool m_timerStop = false;
+};
+
+}
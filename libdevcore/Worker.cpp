@@ -24,6 +24,7 @@
 #include <chrono>
 #include <thread>
 #include "Log.h"
+#include "ThreadPool.h"
 using namespace std;
 using namespace dev;
 
@@ -31,10 +32,27 @@ void Worker::startWorking()
 {
 	cnote << "startWorking for thread" << m_name;
 	Guard l(x_work);
-	if (m_work)
+	if (m_work || m_pooled)
 		return;
-	cnote << "Spawning" << m_name;
 	m_stop = false;
+	if (m_mode == WorkerMode::Pool)
+	{
+		cnote << "Pooling" << m_name;
+		auto p = make_shared<Pooled>();
+		p->worker = this;
+		{
+			Guard wl(x_wake);
+			m_pooled = p;
+		}
+		startedWorking();
+		// As on a thread, the first doWork() follows an idle wait.
+		if (m_idleWaitMs)
+			ThreadPool::get().schedule(chrono::milliseconds(m_idleWaitMs), [=](){ runPooled(p, 0); });
+		else
+			ThreadPool::get().post([=](){ runPooled(p, 0); });
+		return;
+	}
+	cnote << "Spawning" << m_name;
 	m_work.reset(new thread([&]()
 	{
 		setThreadName(m_name.c_str());
@@ -42,7 +60,14 @@ void Worker::startWorking()
 		while (!m_stop)
 		{
 			if (m_idleWaitMs)
-				this_thread::sleep_for(chrono::milliseconds(m_idleWaitMs));
+			{
+				unique_lock<Mutex> l(x_wake);
+				m_wake.wait_for(l, chrono::milliseconds(m_idleWaitMs), [&](){ return m_woken || m_stop; });
+			}
+			{
+				Guard l(x_wake);
+				m_woken = false;
+			}
 			doWork();
 		}
 		cnote << "Finishing up worker thread";
@@ -50,16 +75,103 @@ void Worker::startWorking()
 	}));
 }
 
+void Worker::runPooled(shared_ptr<Pooled> const& _p, unsigned _cycle)
+{
+	{
+		Guard l(_p->x_state);
+		if (_p->stopping || _cycle != _p->cycle)
+			return;
+		_p->busy = true;
+	}
+	try
+	{
+		_p->worker->doWork();
+	}
+	catch (...)
+	{
+		cwarn << "Worker" << _p->worker->m_name << "threw:" << boost::current_exception_diagnostic_information();
+	}
+
+	unique_lock<Mutex> l(_p->x_state);
+	_p->busy = false;
+	if (_p->stopping)
+	{
+		_p->idle.notify_all();
+		return;
+	}
+	unsigned next = ++_p->cycle;
+	shared_ptr<Pooled> p = _p;
+	if (_p->woken || !_p->worker->m_idleWaitMs)
+	{
+		_p->woken = false;
+		l.unlock();
+		ThreadPool::get().post([=](){ runPooled(p, next); });
+	}
+	else
+	{
+		unsigned wait = _p->worker->m_idleWaitMs;
+		l.unlock();
+		ThreadPool::get().schedule(chrono::milliseconds(wait), [=](){ runPooled(p, next); });
+	}
+}
+
+void Worker::wake()
+{
+	shared_ptr<Pooled> p;
+	{
+		// Not x_work, which stopWorking() holds while waiting for doWork(), which may well wake().
+		Guard l(x_wake);
+		p = m_pooled;
+	}
+	if (p)
+	{
+		Guard l(p->x_state);
+		if (p->busy)
+			p->woken = true;
+		else if (!p->stopping)
+		{
+			// Supersede the scheduled doWork() with one now.
+			unsigned next = ++p->cycle;
+			ThreadPool::get().post([=](){ runPooled(p, next); });
+		}
+		return;
+	}
+	{
+		Guard l(x_wake);
+		m_woken = true;
+	}
+	m_wake.notify_all();
+}
+
 void Worker::stopWorking()
 {
 	cnote << "stopWorking for thread" << m_name;
 	Guard l(x_work);
+	if (m_pooled)
+	{
+		cnote << "Stopping" << m_name;
+		{
+			unique_lock<Mutex> sl(m_pooled->x_state);
+			m_pooled->stopping = true;
+			m_pooled->idle.wait(sl, [&](){ return !m_pooled->busy; });
+		}
+		{
+			Guard wl(x_wake);
+			m_pooled.reset();
+		}
+		doneWorking();
+		cnote << "Stopped" << m_name;
+		return;
+	}
 	if (!m_work)
 		return;
 	cnote << "Stopping" << m_name;
-	m_stop = true;
+	{
+		Guard wl(x_wake);
+		m_stop = true;
+	}
+	m_wake.notify_all();
 	m_work->join();
 	m_work.reset();
 	cnote << "Stopped" << m_name;
 }
-
@@ -21,6 +21,9 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
 #include <string>
 #include <thread>
 #include "Guards.h"
@@ -28,10 +31,17 @@
 namespace dev
 {
 
+/// Where a Worker does its work.
+enum class WorkerMode
+{
+	Thread,		///< On a thread of its own.
+	Pool		///< As a task on the shared ThreadPool, scheduled again after each doWork().
+};
+
 class Worker
 {
 protected:
-	Worker(std::string const& _name = "anon", unsigned _idleWaitMs = 30): m_name(_name), m_idleWaitMs(_idleWaitMs) {}
+	Worker(std::string const& _name = "anon", unsigned _idleWaitMs = 30, WorkerMode _mode = WorkerMode::Thread): m_name(_name), m_idleWaitMs(_idleWaitMs), m_mode(_mode) {}
 
 	/// Move-constructor.
 	Worker(Worker&& _m) { std::swap(m_name, _m.m_name); }
@@ -51,24 +61,48 @@ protected:
 	void stopWorking();
 	
 	/// Returns if worker thread is present.
-	bool isWorking() const { Guard l(x_work); return !!m_work; }
+	bool isWorking() const { Guard l(x_work); return m_work || m_pooled; }
+
+	/// Has doWork() called again without waiting the rest of m_idleWaitMs, or straight after if it is in progress.
+	void wake();
 	
 	/// Called after thread is started from startWorking().
 	virtual void startedWorking() {}
 	
-	/// Called continuously following sleep for m_idleWaitMs.
+	/// Called continuously following sleep for m_idleWaitMs, or until wake() is called.
 	virtual void doWork() = 0;
 	
 	/// Called when is to be stopped, just prior to thread being joined.
 	virtual void doneWorking() {}
 
 private:
+	/// The state of a Worker running on the pool, shared with the tasks it has posted so that they may outlive it.
+	struct Pooled
+	{
+		Worker* worker;
+		Mutex x_state;
+		Condition idle;						///< Signalled when a doWork() returns once stopping.
+		unsigned cycle = 0;					///< Which posted task is to do the next doWork(); others return.
+		bool busy = false;					///< In doWork().
+		bool woken = false;					///< wake() was called during doWork().
+		bool stopping = false;
+	};
+
+	/// Does a doWork() on the pool for @a _p if @a _cycle is still its next, then posts or schedules the next.
+	static void runPooled(std::shared_ptr<Pooled> const& _p, unsigned _cycle);
+
 	std::string m_name;
 	unsigned m_idleWaitMs = 0;
+	WorkerMode m_mode = WorkerMode::Thread;
 	
 	mutable Mutex x_work;						///< Lock for the network existance.
 	std::unique_ptr<std::thread> m_work;		///< The network thread.
-	bool m_stop = false;
+	std::shared_ptr<Pooled> m_pooled;			///< Our state on the pool, in WorkerMode::Pool.
+	std::atomic<bool> m_stop{false};
+
+	Mutex x_wake;								///< Lock for m_woken, and for changing m_pooled.
+	Condition m_wake;							///< Signalled by wake() and stopWorking().
+	bool m_woken = false;
 };
 
 }
@@ -25,6 +25,9 @@
 #include <thread>
 #include <mutex>
 #include <libdevcore/Guards.h>
+#if ETH_SECP256K1
+#include <secp256k1/secp256k1.h>
+#endif
 #include "SHA3.h"
 #include "FileSystem.h"
 #include "CryptoPP.h"
@@ -46,12 +49,6 @@ bool dev::SignatureStruct::isValid() const
 
 Address dev::ZeroAddress = Address();
 
-Public dev::toPublic(Secret const& _secret)
-{
-	Public p;
-	s_secp256k1.toPublic(_secret, p);
-	return std::move(p);
-}
 
 Address dev::toAddress(Public const& _public)
 {
@@ -60,9 +57,7 @@ Address dev::toAddress(Public const& _public)
 
 Address dev::toAddress(Secret const& _secret)
 {
-	Public p;
-	s_secp256k1.toPublic(_secret, p);
-	return s_secp256k1.toAddress(p);
+	return s_secp256k1.toAddress(toPublic(_secret));
 }
 
 void dev::encrypt(Public const& _k, bytesConstRef _plain, bytes& o_cipher)
@@ -89,6 +84,11 @@ void dev::encryptECIES(Public const& _k, bytesConstRef _plain, bytes& o_cipher)
 	o_cipher = std::move(io);
 }
 
+void dev::encryptECIES(vector<Public> const& _ks, bytesConstRef _plain, vector<bytes>& o_ciphers)
+{
+	s_secp256k1.encryptECIES(_ks, _plain, o_ciphers);
+}
+
 bool dev::decryptECIES(Secret const& _k, bytesConstRef _cipher, bytes& o_plaintext)
 {
 	bytes io = _cipher.toBytes();
@@ -158,6 +158,99 @@ bool dev::decryptSymNoAuth(Secret const& _k, h128 const& _iv, bytesConstRef _cip
 	}
 }
 
+#if ETH_SECP256K1
+
+/// Has libsecp256k1 build its precomputed tables, the first time only; all threads share them after that.
+static void startSecp256k1()
+{
+	static bool const s_started = [](){ secp256k1_start(); return true; }();
+	(void)s_started;
+}
+
+/// @returns the DER encoding of r and s of @a _sig, which is what secp256k1_ecdsa_verify takes.
+static bytes toDER(Signature const& _sig)
+{
+	bytes ret{0x30, 0};
+	for (unsigned offset: {0, 32})
+	{
+		unsigned start = offset;
+		while (start < offset + 31 && _sig[start] == 0)
+			++start;
+		bool pad = _sig[start] & 0x80;
+		ret.push_back(0x02);
+		ret.push_back(byte(offset + 32 - start + (pad ? 1 : 0)));
+		if (pad)
+			ret.push_back(0);
+		ret.insert(ret.end(), _sig.data() + start, _sig.data() + offset + 32);
+	}
+	ret[1] = byte(ret.size() - 2);
+	return ret;
+}
+
+/// Puts the public key of @a _secret, from the generator's precomputed multiples, in @a o_public.
+/// @returns false, leaving it alone, if @a _secret is not a valid secret key.
+static bool toPublicSecp256k1(Secret const& _secret, Public& o_public)
+{
+	startSecp256k1();
+	byte pubkey[65];
+	int pubkeyLength = 65;
+	if (!secp256k1_ecdsa_seckey_verify(_secret.data()) || !secp256k1_ecdsa_pubkey_create(pubkey, &pubkeyLength, _secret.data(), 0) || pubkeyLength != 65)
+		return false;
+	memcpy(o_public.data(), pubkey + 1, 64);
+	return true;
+}
+
+Public dev::toPublic(Secret const& _secret)
+{
+	Public ret;
+	toPublicSecp256k1(_secret, ret);
+	return ret;
+}
+
+Public dev::recover(Signature const& _sig, h256 const& _message)
+{
+	startSecp256k1();
+	Public ret;
+	byte pubkey[65];
+	int pubkeyLength = 65;
+	if (_sig[64] <= 1 && secp256k1_ecdsa_recover_compact(_message.data(), 32, _sig.data(), pubkey, &pubkeyLength, 0, _sig[64]) && pubkeyLength == 65)
+		memcpy(ret.data(), pubkey + 1, 64);
+	return ret;
+}
+
+Signature dev::sign(Secret const& _k, h256 const& _hash)
+{
+	startSecp256k1();
+	// The same nonce as the Crypto++ signer takes.
+	static u256 const c_order("0xfffffffffffffffffffffffffffffffebaaedce6af48a03bbfd25e8cd0364141");
+	h256 nonce(1 + u256(crypto::kdf(_k, _hash)) % (c_order - 1));
+	Signature ret;
+	int recid;
+	if (!secp256k1_ecdsa_sign_compact(_hash.data(), 32, ret.data(), _k.data(), nonce.data(), &recid) || recid > 1)
+		// An x of the nonce's point of at least the group order cannot be told by v = 0 or 1; let Crypto++ deal with it.
+		return s_secp256k1.sign(_k, _hash);
+	ret[64] = byte(recid);
+	return ret;
+}
+
+bool dev::verify(Public const& _p, Signature const& _s, h256 const& _hash)
+{
+	startSecp256k1();
+	byte pubkey[65] = {0x04};
+	memcpy(pubkey + 1, _p.data(), 64);
+	bytes der = toDER(_s);
+	return secp256k1_ecdsa_verify(_hash.data(), 32, der.data(), int(der.size()), pubkey, 65) == 1;
+}
+
+#else
+
+Public dev::toPublic(Secret const& _secret)
+{
+	Public p;
+	s_secp256k1.toPublic(_secret, p);
+	return std::move(p);
+}
+
 Public dev::recover(Signature const& _sig, h256 const& _message)
 {
 	return s_secp256k1.recover(_sig, _message.ref());
@@ -173,6 +266,8 @@ bool dev::verify(Public const& _p, Signature const& _s, h256 const& _hash)
 	return s_secp256k1.verify(_p, _s, _hash.ref(), true);
 }
 
+#endif
+
 KeyPair KeyPair::create()
 {
 	static boost::thread_specific_ptr<mt19937_64> s_eng;
@@ -194,7 +289,11 @@ KeyPair KeyPair::create()
 KeyPair::KeyPair(h256 _sec):
 	m_secret(_sec)
 {
+#if ETH_SECP256K1
+	if (toPublicSecp256k1(m_secret, m_public))
+#else
 	if (s_secp256k1.verifySecret(m_secret, m_public))
+#endif
 		m_address = s_secp256k1.toAddress(m_public);
 }
 
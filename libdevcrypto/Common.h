@@ -98,6 +98,10 @@ bool decryptSym(Secret const& _k, bytesConstRef _cipher, bytes& o_plaintext);
 
 /// Encrypt payload using ECIES standard with AES128-CTR.
 void encryptECIES(Public const& _k, bytesConstRef _plain, bytes& o_cipher);
+
+/// Encrypt payload to each of the keys @a _ks using ECIES standard with AES128-CTR, into @a o_ciphers in the same
+/// order. Cheaper than encrypting to each in turn: the ephemeral key is made just the once.
+void encryptECIES(std::vector<Public> const& _ks, bytesConstRef _plain, std::vector<bytes>& o_ciphers);
 	
 /// Decrypt payload using ECIES standard with AES128-CTR.
 bool decryptECIES(Secret const& _k, bytesConstRef _cipher, bytes& o_plaintext);
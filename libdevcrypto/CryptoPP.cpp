@@ -66,11 +66,34 @@ bytes Secp256k1::eciesKDF(Secret _z, bytes _s1, unsigned kdByteLen)
 
 void Secp256k1::encryptECIES(Public const& _k, bytes& io_cipher)
 {
-	// interop w/go ecies implementation
 	auto r = KeyPair::create();
 	h256 z;
 	ecdh::agree(r.sec(), _k, z);
-	auto key = eciesKDF(z, bytes(), 32);
+	bytes cipher;
+	encryptECIES(r, z, bytesConstRef(&io_cipher), cipher);
+	io_cipher.swap(cipher);
+}
+
+void Secp256k1::encryptECIES(vector<Public> const& _ks, bytesConstRef _plain, vector<bytes>& o_ciphers)
+{
+	auto r = KeyPair::create();
+	ECDH<ECP>::Domain d(ASN1::secp256k1());
+	assert(d.AgreedValueLength() == h256::size);
+	o_ciphers.resize(_ks.size());
+	byte remote[65] = {0x04};
+	for (size_t i = 0; i < _ks.size(); ++i)
+	{
+		h256 z;
+		memcpy(&remote[1], _ks[i].data(), 64);
+		d.Agree(z.data(), r.sec().data(), remote);
+		encryptECIES(r, z, _plain, o_ciphers[i]);
+	}
+}
+
+void Secp256k1::encryptECIES(KeyPair const& _r, h256 const& _z, bytesConstRef _plain, bytes& o_cipher)
+{
+	// interop w/go ecies implementation
+	auto key = eciesKDF(_z, bytes(), 32);
 	bytesConstRef eKey = bytesConstRef(&key).cropped(0, 16);
 	bytesRef mKeyMaterial = bytesRef(&key).cropped(16, 16);
 	CryptoPP::SHA256 ctx;
@@ -79,13 +102,16 @@ void Secp256k1::encryptECIES(Public const& _k, bytes& io_cipher)
 	ctx.Final(mKey.data());
 	
 	bytes cipherText;
-	encryptSymNoAuth(*(Secret*)eKey.data(), bytesConstRef(&io_cipher), cipherText, h128());
+	encryptSymNoAuth(*(Secret*)eKey.data(), _plain, cipherText, h128());
 	if (cipherText.empty())
+	{
+		o_cipher = _plain.toBytes();
 		return;
+	}
 
 	bytes msg(1 + Public::size + h128::size + cipherText.size() + 32);
 	msg[0] = 0x04;
-	r.pub().ref().copyTo(bytesRef(&msg).cropped(1, Public::size));
+	_r.pub().ref().copyTo(bytesRef(&msg).cropped(1, Public::size));
 	bytesRef msgCipherRef = bytesRef(&msg).cropped(1 + Public::size + h128::size, cipherText.size());
 	bytesConstRef(&cipherText).copyTo(msgCipherRef);
 	
@@ -95,8 +121,7 @@ void Secp256k1::encryptECIES(Public const& _k, bytes& io_cipher)
 	hmacctx.Update(cipherWithIV.data(), cipherWithIV.size());
 	hmacctx.Final(msg.data() + 1 + Public::size + cipherWithIV.size());
 	
-	io_cipher.resize(msg.size());
-	io_cipher.swap(msg);
+	o_cipher.swap(msg);
 }
 
 bool Secp256k1::decryptECIES(Secret const& _k, bytes& io_text)
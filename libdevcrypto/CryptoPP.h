@@ -85,6 +85,10 @@ public:
 	/// Encrypts text (replace input). (ECIES w/AES128-CTR-SHA256)
 	void encryptECIES(Public const& _k, bytes& io_cipher);
 
+	/// Encrypts @a _plain to each of @a _ks into @a o_ciphers, as encryptECIES does, but with one ephemeral key and one
+	/// ECDH domain for all of them. The shared secrets, and so the keys, still differ for each recipient.
+	void encryptECIES(std::vector<Public> const& _ks, bytesConstRef _plain, std::vector<bytes>& o_ciphers);
+
 	/// Decrypts text (replace input). (ECIES w/AES128-CTR-SHA256)
 	bool decryptECIES(Secret const& _k, bytes& io_text);
 	
@@ -117,6 +121,10 @@ protected:
 	void exportPublicKey(DL_PublicKey_EC<ECP> const& _k, Public& o_p);
 	
 	void exponentToPublic(Integer const& _e, Public& o_p);
+
+	/// Encrypts @a _plain into @a o_cipher (ECIES w/AES128-CTR-SHA256) with the ephemeral key @a _r, given the secret
+	/// @a _z it shares with the recipient.
+	void encryptECIES(KeyPair const& _r, h256 const& _z, bytesConstRef _plain, bytes& o_cipher);
 	
 	template <class T> void initializeDLScheme(Secret const& _s, T& io_operator) { std::lock_guard<std::mutex> l(x_params); io_operator.AccessKey().Initialize(m_params, secretToExponent(_s)); }
 	
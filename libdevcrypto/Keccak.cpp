@@ -0,0 +1,226 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Keccak.cpp
+ * @date 2015
+ */
+
+#include "Keccak.h"
+#include <cstring>
+#include <libdevcore/CpuFeatures.h>
+using namespace std;
+using namespace dev;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// Four states at once, a 64-bit lane of each in one AVX2 register, picked at runtime.
+#define ETH_KECCAK_AVX2 1
+#define ETH_KECCAK_INLINE inline __attribute__((always_inline))
+#else
+#define ETH_KECCAK_AVX2 0
+#define ETH_KECCAK_INLINE inline
+#endif
+
+/// The bytes absorbed per permutation for a 256-bit output.
+static const unsigned c_rate = 136;
+
+static const uint64_t c_roundConstants[24] =
+{
+	0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+	0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+	0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+	0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+	0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+
+// A macro rather than a function, as a function returning a vector by value would need AVX for its ABI.
+#define ETH_KECCAK_ROTL(X, N) (((X) << (N)) | ((X) >> (64 - (N))))
+
+/// Keccak-f[1600] on the 25 lanes at @a _a, which may be integers or vectors of them, each holding a state.
+template <class T> static ETH_KECCAK_INLINE void keccakF1600(T* _a)
+{
+	for (unsigned r = 0; r < 24; ++r)
+	{
+		T c0 = _a[0] ^ _a[5] ^ _a[10] ^ _a[15] ^ _a[20];
+		T c1 = _a[1] ^ _a[6] ^ _a[11] ^ _a[16] ^ _a[21];
+		T c2 = _a[2] ^ _a[7] ^ _a[12] ^ _a[17] ^ _a[22];
+		T c3 = _a[3] ^ _a[8] ^ _a[13] ^ _a[18] ^ _a[23];
+		T c4 = _a[4] ^ _a[9] ^ _a[14] ^ _a[19] ^ _a[24];
+		T d0 = c4 ^ ETH_KECCAK_ROTL(c1, 1);
+		T d1 = c0 ^ ETH_KECCAK_ROTL(c2, 1);
+		T d2 = c1 ^ ETH_KECCAK_ROTL(c3, 1);
+		T d3 = c2 ^ ETH_KECCAK_ROTL(c4, 1);
+		T d4 = c3 ^ ETH_KECCAK_ROTL(c0, 1);
+
+		T b0 = _a[0] ^ d0;
+		T b1 = ETH_KECCAK_ROTL(_a[6] ^ d1, 44);
+		T b2 = ETH_KECCAK_ROTL(_a[12] ^ d2, 43);
+		T b3 = ETH_KECCAK_ROTL(_a[18] ^ d3, 21);
+		T b4 = ETH_KECCAK_ROTL(_a[24] ^ d4, 14);
+		T b5 = ETH_KECCAK_ROTL(_a[3] ^ d3, 28);
+		T b6 = ETH_KECCAK_ROTL(_a[9] ^ d4, 20);
+		T b7 = ETH_KECCAK_ROTL(_a[10] ^ d0, 3);
+		T b8 = ETH_KECCAK_ROTL(_a[16] ^ d1, 45);
+		T b9 = ETH_KECCAK_ROTL(_a[22] ^ d2, 61);
+		T b10 = ETH_KECCAK_ROTL(_a[1] ^ d1, 1);
+		T b11 = ETH_KECCAK_ROTL(_a[7] ^ d2, 6);
+		T b12 = ETH_KECCAK_ROTL(_a[13] ^ d3, 25);
+		T b13 = ETH_KECCAK_ROTL(_a[19] ^ d4, 8);
+		T b14 = ETH_KECCAK_ROTL(_a[20] ^ d0, 18);
+		T b15 = ETH_KECCAK_ROTL(_a[4] ^ d4, 27);
+		T b16 = ETH_KECCAK_ROTL(_a[5] ^ d0, 36);
+		T b17 = ETH_KECCAK_ROTL(_a[11] ^ d1, 10);
+		T b18 = ETH_KECCAK_ROTL(_a[17] ^ d2, 15);
+		T b19 = ETH_KECCAK_ROTL(_a[23] ^ d3, 56);
+		T b20 = ETH_KECCAK_ROTL(_a[2] ^ d2, 62);
+		T b21 = ETH_KECCAK_ROTL(_a[8] ^ d3, 55);
+		T b22 = ETH_KECCAK_ROTL(_a[14] ^ d4, 39);
+		T b23 = ETH_KECCAK_ROTL(_a[15] ^ d0, 41);
+		T b24 = ETH_KECCAK_ROTL(_a[21] ^ d1, 2);
+
+		_a[0] = b0 ^ (~b1 & b2);
+		_a[1] = b1 ^ (~b2 & b3);
+		_a[2] = b2 ^ (~b3 & b4);
+		_a[3] = b3 ^ (~b4 & b0);
+		_a[4] = b4 ^ (~b0 & b1);
+		_a[5] = b5 ^ (~b6 & b7);
+		_a[6] = b6 ^ (~b7 & b8);
+		_a[7] = b7 ^ (~b8 & b9);
+		_a[8] = b8 ^ (~b9 & b5);
+		_a[9] = b9 ^ (~b5 & b6);
+		_a[10] = b10 ^ (~b11 & b12);
+		_a[11] = b11 ^ (~b12 & b13);
+		_a[12] = b12 ^ (~b13 & b14);
+		_a[13] = b13 ^ (~b14 & b10);
+		_a[14] = b14 ^ (~b10 & b11);
+		_a[15] = b15 ^ (~b16 & b17);
+		_a[16] = b16 ^ (~b17 & b18);
+		_a[17] = b17 ^ (~b18 & b19);
+		_a[18] = b18 ^ (~b19 & b15);
+		_a[19] = b19 ^ (~b15 & b16);
+		_a[20] = b20 ^ (~b21 & b22);
+		_a[21] = b21 ^ (~b22 & b23);
+		_a[22] = b22 ^ (~b23 & b24);
+		_a[23] = b23 ^ (~b24 & b20);
+		_a[24] = b24 ^ (~b20 & b21);
+		_a[0] ^= c_roundConstants[r];
+	}
+}
+
+#undef ETH_KECCAK_ROTL
+
+static ETH_KECCAK_INLINE uint64_t load64(byte const* _p)
+{
+	uint64_t ret = 0;
+	for (unsigned i = 8; i-- > 0;)
+		ret = (ret << 8) | _p[i];
+	return ret;
+}
+
+static ETH_KECCAK_INLINE void store64(byte* _p, uint64_t _v)
+{
+	for (unsigned i = 0; i < 8; ++i, _v >>= 8)
+		_p[i] = (byte)_v;
+}
+
+/// Copies the last, partial block of @a _in, which has @a _blocks blocks once padded, into @a o_block, padded.
+static void lastBlock(bytesConstRef _in, size_t _blocks, byte* o_block)
+{
+	size_t done = (_blocks - 1) * c_rate;
+	memset(o_block, 0, c_rate);
+	memcpy(o_block, _in.data() + done, _in.size() - done);
+	o_block[_in.size() - done] ^= 0x01;
+	o_block[c_rate - 1] ^= 0x80;
+}
+
+void dev::keccak256(bytesConstRef _in, byte* o_out)
+{
+	uint64_t a[25] = {};
+	size_t blocks = _in.size() / c_rate + 1;
+	byte last[c_rate];
+	lastBlock(_in, blocks, last);
+	for (size_t b = 0; b < blocks; ++b)
+	{
+		byte const* p = b + 1 < blocks ? _in.data() + b * c_rate : last;
+		for (unsigned i = 0; i < c_rate / 8; ++i)
+			a[i] ^= load64(p + i * 8);
+		keccakF1600(a);
+	}
+	for (unsigned i = 0; i < 4; ++i)
+		store64(o_out + i * 8, a[i]);
+}
+
+#if ETH_KECCAK_AVX2
+
+typedef uint64_t u64x4 __attribute__((vector_size(32)));
+
+/// Hashes four messages at once, each into 32 bytes of @a o_out.
+__attribute__((target("avx2"))) static void keccak256x4(bytesConstRef const* _in, byte* o_out)
+{
+	u64x4 a[25] = {};
+	size_t blocks[4];
+	byte last[4][c_rate];
+	size_t most = 0;
+	for (unsigned k = 0; k < 4; ++k)
+	{
+		blocks[k] = _in[k].size() / c_rate + 1;
+		lastBlock(_in[k], blocks[k], last[k]);
+		most = max(most, blocks[k]);
+	}
+	// Those done already are permuted on along with the rest; their outputs are taken as they finish.
+	for (size_t b = 0; b < most; ++b)
+	{
+		for (unsigned k = 0; k < 4; ++k)
+			if (b < blocks[k])
+			{
+				byte const* p = b + 1 < blocks[k] ? _in[k].data() + b * c_rate : last[k];
+				for (unsigned i = 0; i < c_rate / 8; ++i)
+					a[i][k] ^= load64(p + i * 8);
+			}
+		keccakF1600(a);
+		for (unsigned k = 0; k < 4; ++k)
+			if (b + 1 == blocks[k])
+				for (unsigned i = 0; i < 4; ++i)
+					store64(o_out + k * 32 + i * 8, a[i][k]);
+	}
+}
+
+#endif
+
+typedef void (*HashFour)(bytesConstRef const* _in, byte* o_out);
+
+/// Hashes four messages at once, if the CPU can; null otherwise, or before static initialisation.
+static CpuDispatch<HashFour> const s_keccak256x4("keccak256x4", {
+#if ETH_KECCAK_AVX2
+	{ "avx2", CpuAVX2, keccak256x4 },
+#endif
+	{ "one at a time", 0, nullptr }
+});
+
+bool dev::keccak256Wide()
+{
+	return !!s_keccak256x4();
+}
+
+void dev::keccak256(bytesConstRef const* _in, byte* o_out, size_t _count)
+{
+	size_t i = 0;
+	if (HashFour hashFour = s_keccak256x4())
+		for (; i + 4 <= _count; i += 4)
+			hashFour(_in + i, o_out + i * 32);
+	for (; i < _count; ++i)
+		keccak256(_in[i], o_out + i * 32);
+}
@@ -0,0 +1,38 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file Keccak.h
+ * @date 2015
+ * Keccak-256, as Ethereum's SHA3, one message at a time or several at once.
+ */
+
+#pragma once
+
+#include <libdevcore/Common.h>
+
+namespace dev
+{
+
+/// Hashes @a _in into the 32 bytes at @a o_out.
+void keccak256(bytesConstRef _in, byte* o_out);
+
+/// Hashes the @a _count messages at @a _in into the 32 bytes each at @a o_out, four at a time on CPUs with AVX2.
+void keccak256(bytesConstRef const* _in, byte* o_out, size_t _count);
+
+/// @returns true if the several-at-once keccak256() runs four messages at a time on this CPU.
+bool keccak256Wide();
+
+}
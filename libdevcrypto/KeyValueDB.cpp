@@ -0,0 +1,478 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file KeyValueDB.cpp
+ * @date 2015
+ */
+
+#include <map>
+#pragma warning(push)
+#pragma warning(disable: 4100 4267)
+#include <leveldb/cache.h>
+#include <leveldb/db.h>
+#include <leveldb/filter_policy.h>
+#include <leveldb/write_batch.h>
+#pragma warning(pop)
+#if ETH_ROCKSDB
+#include <rocksdb/db.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/table.h>
+#include <rocksdb/write_batch.h>
+#endif
+#include <libdevcore/Guards.h>
+#include <libdevcore/Log.h>
+#include "KeyValueDB.h"
+using namespace std;
+using namespace dev;
+
+namespace ldb = leveldb;
+
+namespace
+{
+
+/// The DB of the Memory backend. Snapshots share its map until the next write, which copies it.
+class MemoryKeyValueDB: public KeyValueDB
+{
+public:
+	using Map = map<string, string>;
+
+	class Batch: public WriteBatch
+	{
+	public:
+		void insert(bytesConstRef _key, bytesConstRef _value) override { m_ops.push_back(make_pair(_key.toString(), make_pair(true, _value.toString()))); }
+		void kill(bytesConstRef _key) override { m_ops.push_back(make_pair(_key.toString(), make_pair(false, string()))); }
+
+		vector<pair<string, pair<bool, string>>> m_ops;
+	};
+
+	class Snapshot: public KeyValueReader
+	{
+	public:
+		explicit Snapshot(shared_ptr<Map const> const& _map): m_map(_map) {}
+		string lookup(bytesConstRef _key) const override { return lookupIn(*m_map, _key); }
+		void forEach(bytesConstRef _from, EntryVisitor const& _f) const override { forEachIn(*m_map, _from, _f); }
+
+	private:
+		shared_ptr<Map const> m_map;
+	};
+
+	static string lookupIn(Map const& _m, bytesConstRef _key)
+	{
+		auto it = _m.find(_key.toString());
+		return it == _m.end() ? string() : it->second;
+	}
+
+	static void forEachIn(Map const& _m, bytesConstRef _from, EntryVisitor const& _f)
+	{
+		for (auto it = _m.lower_bound(_from.toString()); it != _m.end(); ++it)
+			if (!_f(bytesConstRef(&it->first), bytesConstRef(&it->second)))
+				break;
+	}
+
+	string lookup(bytesConstRef _key) const override
+	{
+		ReadGuard l(x_map);
+		return lookupIn(*m_map, _key);
+	}
+
+	void forEach(bytesConstRef _from, EntryVisitor const& _f) const override
+	{
+		// Visits a snapshot, so that _f may write to the DB.
+		Snapshot(current()).forEach(_from, _f);
+	}
+
+	unique_ptr<WriteBatch> batch() const override { return unique_ptr<WriteBatch>(new Batch); }
+
+	bool write(WriteBatch const& _batch) override
+	{
+		WriteGuard l(x_map);
+		if (m_map.use_count() > 1)
+			m_map = make_shared<Map>(*m_map);
+		for (auto const& i: static_cast<Batch const&>(_batch).m_ops)
+			if (i.second.first)
+				(*m_map)[i.first] = i.second.second;
+			else
+				m_map->erase(i.first);
+		return true;
+	}
+
+	unique_ptr<KeyValueReader> snapshot() const override { return unique_ptr<KeyValueReader>(new Snapshot(current())); }
+
+private:
+	shared_ptr<Map const> current() const
+	{
+		ReadGuard l(x_map);
+		return m_map;
+	}
+
+	mutable SharedMutex x_map;
+	shared_ptr<Map> m_map = make_shared<Map>();
+};
+
+ldb::Slice toLevelDBSlice(bytesConstRef _s)
+{
+	return ldb::Slice((char const*)_s.data(), _s.size());
+}
+
+bytesConstRef fromLevelDBSlice(ldb::Slice const& _s)
+{
+	return bytesConstRef((byte const*)_s.data(), _s.size());
+}
+
+/// The DB of the LevelDB backend.
+class LevelDB: public KeyValueDB
+{
+public:
+	class Batch: public WriteBatch
+	{
+	public:
+		void insert(bytesConstRef _key, bytesConstRef _value) override { m_batch.Put(toLevelDBSlice(_key), toLevelDBSlice(_value)); }
+		void kill(bytesConstRef _key) override { m_batch.Delete(toLevelDBSlice(_key)); }
+
+		mutable ldb::WriteBatch m_batch;
+	};
+
+	class Snapshot: public KeyValueReader
+	{
+	public:
+		Snapshot(shared_ptr<ldb::DB> const& _db): m_db(_db) { m_readOptions.snapshot = m_db->GetSnapshot(); }
+		~Snapshot() { m_db->ReleaseSnapshot(m_readOptions.snapshot); }
+
+		string lookup(bytesConstRef _key) const override { return lookupIn(*m_db, m_readOptions, _key); }
+		void forEach(bytesConstRef _from, EntryVisitor const& _f) const override { forEachIn(*m_db, m_readOptions, _from, _f); }
+
+	private:
+		shared_ptr<ldb::DB> m_db;
+		ldb::ReadOptions m_readOptions;
+	};
+
+	explicit LevelDB(shared_ptr<ldb::DB> const& _db): m_db(_db) {}
+
+	static string lookupIn(ldb::DB& _db, ldb::ReadOptions const& _o, bytesConstRef _key)
+	{
+		string ret;
+		_db.Get(_o, toLevelDBSlice(_key), &ret);
+		return ret;
+	}
+
+	static void forEachIn(ldb::DB& _db, ldb::ReadOptions const& _o, bytesConstRef _from, EntryVisitor const& _f)
+	{
+		unique_ptr<ldb::Iterator> it(_db.NewIterator(_o));
+		for (it->Seek(toLevelDBSlice(_from)); it->Valid(); it->Next())
+			if (!_f(fromLevelDBSlice(it->key()), fromLevelDBSlice(it->value())))
+				break;
+	}
+
+	string lookup(bytesConstRef _key) const override { return lookupIn(*m_db, m_readOptions, _key); }
+	void forEach(bytesConstRef _from, EntryVisitor const& _f) const override { forEachIn(*m_db, m_readOptions, _from, _f); }
+
+	unique_ptr<WriteBatch> batch() const override { return unique_ptr<WriteBatch>(new Batch); }
+
+	bool write(WriteBatch const& _batch) override
+	{
+		ldb::Status s = m_db->Write(m_writeOptions, &static_cast<Batch const&>(_batch).m_batch);
+		if (!s.ok())
+			cwarn << "Error writing to DB:" << s.ToString();
+		return s.ok();
+	}
+
+	unique_ptr<KeyValueReader> snapshot() const override { return unique_ptr<KeyValueReader>(new Snapshot(m_db)); }
+
+	string property(string const& _name) const override
+	{
+		string ret;
+		m_db->GetProperty("leveldb." + _name, &ret);
+		return ret;
+	}
+
+private:
+	shared_ptr<ldb::DB> m_db;
+	ldb::ReadOptions m_readOptions;
+	ldb::WriteOptions m_writeOptions;
+};
+
+shared_ptr<KeyValueDB> openLevelDB(string const& _path, DBOptions const& _options)
+{
+	ldb::Options o;
+	o.create_if_missing = _options.createIfMissing;
+	shared_ptr<ldb::Cache> cache;
+	if (_options.blockCacheSize)
+	{
+		cache.reset(ldb::NewLRUCache(_options.blockCacheSize));
+		o.block_cache = cache.get();
+	}
+	if (_options.writeBufferSize)
+		o.write_buffer_size = _options.writeBufferSize;
+	shared_ptr<ldb::FilterPolicy const> filter;
+	if (_options.bloomBitsPerKey)
+	{
+		filter.reset(ldb::NewBloomFilterPolicy(_options.bloomBitsPerKey));
+		o.filter_policy = filter.get();
+	}
+	if (_options.maxOpenFiles)
+		o.max_open_files = _options.maxOpenFiles;
+	o.compression = _options.compression ? ldb::kSnappyCompression : ldb::kNoCompression;
+	ldb::DB* db = nullptr;
+	ldb::Status s = ldb::DB::Open(o, _path, &db);
+	if (!db)
+	{
+		cwarn << "Error opening" << _path + ":" << s.ToString();
+		return nullptr;
+	}
+	// The cache and filter must outlive the DB.
+	return make_shared<LevelDB>(shared_ptr<ldb::DB>(db, [=](ldb::DB* _db){ delete _db; (void)cache; (void)filter; }));
+}
+
+#if ETH_ROCKSDB
+
+namespace rdb = rocksdb;
+
+rdb::Slice toRocksDBSlice(bytesConstRef _s)
+{
+	return rdb::Slice((char const*)_s.data(), _s.size());
+}
+
+bytesConstRef fromRocksDBSlice(rdb::Slice const& _s)
+{
+	return bytesConstRef((byte const*)_s.data(), _s.size());
+}
+
+/// A DB of the RocksDB backend: one column family of a DB shared with the other columns opened alongside it.
+class RocksDB: public KeyValueDB
+{
+public:
+	/// The DB and the handles of its column families, closed with the last column.
+	struct Shared
+	{
+		~Shared()
+		{
+			for (auto h: handles)
+				db->DestroyColumnFamilyHandle(h);
+		}
+
+		unique_ptr<rdb::DB> db;
+		vector<rdb::ColumnFamilyHandle*> handles;
+	};
+
+	class Batch: public WriteBatch
+	{
+	public:
+		explicit Batch(rdb::ColumnFamilyHandle* _column): m_column(_column) {}
+		void insert(bytesConstRef _key, bytesConstRef _value) override { m_batch.Put(m_column, toRocksDBSlice(_key), toRocksDBSlice(_value)); }
+		void kill(bytesConstRef _key) override { m_batch.Delete(m_column, toRocksDBSlice(_key)); }
+
+		rdb::ColumnFamilyHandle* m_column;
+		mutable rdb::WriteBatch m_batch;
+	};
+
+	class Snapshot: public KeyValueReader
+	{
+	public:
+		Snapshot(shared_ptr<Shared> const& _shared, rdb::ColumnFamilyHandle* _column): m_shared(_shared), m_column(_column) { m_readOptions.snapshot = m_shared->db->GetSnapshot(); }
+		~Snapshot() { m_shared->db->ReleaseSnapshot(m_readOptions.snapshot); }
+
+		string lookup(bytesConstRef _key) const override { return lookupIn(*m_shared->db, m_readOptions, m_column, _key); }
+		void forEach(bytesConstRef _from, EntryVisitor const& _f) const override { forEachIn(*m_shared->db, m_readOptions, m_column, _from, _f); }
+
+	private:
+		shared_ptr<Shared> m_shared;
+		rdb::ColumnFamilyHandle* m_column;
+		rdb::ReadOptions m_readOptions;
+	};
+
+	RocksDB(shared_ptr<Shared> const& _shared, rdb::ColumnFamilyHandle* _column): m_shared(_shared), m_column(_column) {}
+
+	static string lookupIn(rdb::DB& _db, rdb::ReadOptions const& _o, rdb::ColumnFamilyHandle* _column, bytesConstRef _key)
+	{
+		string ret;
+		_db.Get(_o, _column, toRocksDBSlice(_key), &ret);
+		return ret;
+	}
+
+	static void forEachIn(rdb::DB& _db, rdb::ReadOptions const& _o, rdb::ColumnFamilyHandle* _column, bytesConstRef _from, EntryVisitor const& _f)
+	{
+		unique_ptr<rdb::Iterator> it(_db.NewIterator(_o, _column));
+		for (it->Seek(toRocksDBSlice(_from)); it->Valid(); it->Next())
+			if (!_f(fromRocksDBSlice(it->key()), fromRocksDBSlice(it->value())))
+				break;
+	}
+
+	string lookup(bytesConstRef _key) const override { return lookupIn(*m_shared->db, m_readOptions, m_column, _key); }
+	void forEach(bytesConstRef _from, EntryVisitor const& _f) const override { forEachIn(*m_shared->db, m_readOptions, m_column, _from, _f); }
+
+	unique_ptr<WriteBatch> batch() const override { return unique_ptr<WriteBatch>(new Batch(m_column)); }
+
+	bool write(WriteBatch const& _batch) override
+	{
+		rdb::Status s = m_shared->db->Write(m_writeOptions, &static_cast<Batch const&>(_batch).m_batch);
+		if (!s.ok())
+			cwarn << "Error writing to DB:" << s.ToString();
+		return s.ok();
+	}
+
+	unique_ptr<KeyValueReader> snapshot() const override { return unique_ptr<KeyValueReader>(new Snapshot(m_shared, m_column)); }
+
+	string property(string const& _name) const override
+	{
+		string ret;
+		m_shared->db->GetProperty(m_column, "rocksdb." + _name, &ret);
+		return ret;
+	}
+
+private:
+	shared_ptr<Shared> m_shared;
+	rdb::ColumnFamilyHandle* m_column;
+	rdb::ReadOptions m_readOptions;
+	rdb::WriteOptions m_writeOptions;
+};
+
+rdb::ColumnFamilyOptions toRocksDBColumnOptions(DBOptions const& _options)
+{
+	rdb::ColumnFamilyOptions ret;
+	rdb::BlockBasedTableOptions to;
+	if (_options.blockCacheSize)
+		to.block_cache = rdb::NewLRUCache(_options.blockCacheSize);
+	if (_options.bloomBitsPerKey)
+		to.filter_policy.reset(rdb::NewBloomFilterPolicy(_options.bloomBitsPerKey));
+	ret.table_factory.reset(rdb::NewBlockBasedTableFactory(to));
+	if (_options.writeBufferSize)
+		ret.write_buffer_size = _options.writeBufferSize;
+	ret.compression = _options.compression ? rdb::kSnappyCompression : rdb::kNoCompression;
+	return ret;
+}
+
+vector<shared_ptr<KeyValueDB>> openRocksDB(string const& _path, strings const& _columns, vector<DBOptions> const& _options)
+{
+	rdb::DBOptions o;
+	o.create_if_missing = _options[0].createIfMissing;
+	o.create_missing_column_families = _options[0].createIfMissing;
+	if (_options[0].maxOpenFiles)
+		o.max_open_files = _options[0].maxOpenFiles;
+	vector<rdb::ColumnFamilyDescriptor> columns;
+	for (unsigned i = 0; i < _columns.size(); ++i)
+		// The first column is the default column family, so that a single column is a plain DB.
+		columns.push_back(rdb::ColumnFamilyDescriptor(i ? _columns[i] : rdb::kDefaultColumnFamilyName, toRocksDBColumnOptions(_options[i])));
+
+	auto shared = make_shared<Shared>();
+	rdb::DB* db = nullptr;
+	rdb::Status s = rdb::DB::Open(o, _path, columns, &shared->handles, &db);
+	if (!db)
+	{
+		cwarn << "Error opening" << _path + ":" << s.ToString();
+		return {};
+	}
+	shared->db.reset(db);
+	vector<shared_ptr<KeyValueDB>> ret;
+	for (auto h: shared->handles)
+		ret.push_back(make_shared<RocksDB>(shared, h));
+	return ret;
+}
+
+#endif
+
+}
+
+DBBackend dev::toDBBackend(string const& _name)
+{
+	if (_name == "leveldb")
+		return DBBackend::LevelDB;
+	if (_name == "rocksdb")
+		return DBBackend::RocksDB;
+	if (_name == "memory")
+		return DBBackend::Memory;
+	BOOST_THROW_EXCEPTION(UnknownDBBackend() << errinfo_comment(_name));
+}
+
+string dev::toString(DBBackend _b)
+{
+	switch (_b)
+	{
+	case DBBackend::LevelDB: return "leveldb";
+	case DBBackend::RocksDB: return "rocksdb";
+	case DBBackend::Memory: return "memory";
+	}
+	return "unknown";
+}
+
+bool dev::isMemoryDBPath(string const& _path)
+{
+	string p = c_memoryDBPath;
+	return _path.compare(0, p.size(), p) == 0 && (_path.size() == p.size() || _path[p.size()] == '/');
+}
+
+void KeyValueDB::insert(bytesConstRef _key, bytesConstRef _value)
+{
+	auto b = batch();
+	b->insert(_key, _value);
+	write(*b);
+}
+
+void KeyValueDB::kill(bytesConstRef _key)
+{
+	auto b = batch();
+	b->kill(_key);
+	write(*b);
+}
+
+shared_ptr<KeyValueDB> KeyValueDB::open(string const& _path, DBOptions const& _options)
+{
+	if (isMemoryDBPath(_path))
+		return make_shared<MemoryKeyValueDB>();
+	switch (_options.backend)
+	{
+	case DBBackend::LevelDB:
+		return openLevelDB(_path, _options);
+	case DBBackend::Memory:
+		return make_shared<MemoryKeyValueDB>();
+	case DBBackend::RocksDB:
+#if ETH_ROCKSDB
+	{
+		auto ret = openRocksDB(_path, strings(1), {_options});
+		return ret.empty() ? nullptr : ret[0];
+	}
+#else
+		cwarn << "Not built with RocksDB support.";
+		return nullptr;
+#endif
+	}
+	return nullptr;
+}
+
+vector<shared_ptr<KeyValueDB>> KeyValueDB::open(string const& _path, strings const& _columns, DBOptions const& _options)
+{
+	return open(_path, _columns, vector<DBOptions>(_columns.size(), _options));
+}
+
+vector<shared_ptr<KeyValueDB>> KeyValueDB::open(string const& _path, strings const& _columns, vector<DBOptions> const& _options)
+{
+	if (_columns.empty() || _options.size() != _columns.size())
+		return {};
+#if ETH_ROCKSDB
+	if (_options[0].backend == DBBackend::RocksDB && !isMemoryDBPath(_path))
+		return openRocksDB(_path + "/" + _columns[0], _columns, _options);
+#endif
+	vector<shared_ptr<KeyValueDB>> ret;
+	for (unsigned i = 0; i < _columns.size(); ++i)
+	{
+		DBOptions o = _options[i];
+		o.backend = _options[0].backend;
+		if (auto db = open(_path + "/" + _columns[i], o))
+			ret.push_back(db);
+		else
+			return {};
+	}
+	return ret;
+}
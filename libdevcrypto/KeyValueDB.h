@@ -0,0 +1,126 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file KeyValueDB.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <libdevcore/Common.h>
+#include <libdevcore/Exceptions.h>
+
+namespace dev
+{
+
+struct UnknownDBBackend: virtual Exception {};
+
+/// The storage engines a KeyValueDB may be backed by.
+enum class DBBackend
+{
+	LevelDB,
+	RocksDB,		///< Only available when built with ETH_ROCKSDB.
+	Memory			///< Nothing is written to disk; for tests and ephemeral nodes.
+};
+
+/// @returns the backend named @a _name ("leveldb", "rocksdb" or "memory"); throws UnknownDBBackend otherwise.
+DBBackend toDBBackend(std::string const& _name);
+std::string toString(DBBackend _b);
+
+/// The path of a DB kept in memory, whatever backend its options name; DBs beneath it, such as its columns, are too.
+/// Each one opened is new and empty, and goes with its last reference, so chains for tests need no directory.
+char const* const c_memoryDBPath = ":memory:";
+
+/// @returns true if @a _path is c_memoryDBPath or beneath it.
+bool isMemoryDBPath(std::string const& _path);
+
+struct DBOptions
+{
+	DBBackend backend = DBBackend::LevelDB;
+	bool createIfMissing = true;
+	size_t blockCacheSize = 0;		///< Bytes of uncompressed blocks cached; 0 for the backend's default.
+	size_t writeBufferSize = 0;		///< Bytes written before a memtable is flushed; 0 for the backend's default.
+	unsigned bloomBitsPerKey = 0;	///< Bits of each table's bloom filter per key, sparing reads of tables without a key; 0 for none.
+	int maxOpenFiles = 0;			///< Tables kept open, each with its index in memory; 0 for the backend's default.
+	bool compression = true;		///< Whether tables are snappy-compressed; not worth it for hashes, such as trie nodes.
+};
+
+/// Writes to a KeyValueDB, applied together by KeyValueDB::write(). Made by the DB it is for.
+class WriteBatch
+{
+public:
+	virtual ~WriteBatch() {}
+
+	virtual void insert(bytesConstRef _key, bytesConstRef _value) = 0;
+	virtual void kill(bytesConstRef _key) = 0;
+};
+
+/// Read access to a KeyValueDB, or to a snapshot of it.
+class KeyValueReader
+{
+public:
+	/// Called with each entry by forEach(); returns false to stop.
+	using EntryVisitor = std::function<bool(bytesConstRef _key, bytesConstRef _value)>;
+
+	virtual ~KeyValueReader() {}
+
+	/// @returns the value at @a _key, or the empty string if there is none.
+	virtual std::string lookup(bytesConstRef _key) const = 0;
+	bool exists(bytesConstRef _key) const { return !lookup(_key).empty(); }
+
+	/// Calls @a _f with each entry whose key is not before @a _from, in key order, until it returns false.
+	virtual void forEach(bytesConstRef _from, EntryVisitor const& _f) const = 0;
+	void forEach(EntryVisitor const& _f) const { forEach(bytesConstRef(), _f); }
+};
+
+/**
+ * @brief An ordered map of byte strings on some storage engine, as used beneath OverlayDB and BlockChain.
+ * @threadsafe
+ */
+class KeyValueDB: public KeyValueReader
+{
+public:
+	/// @returns a DB at @a _path with @a _options, or null if it could not be opened. One under c_memoryDBPath is
+	/// always of the Memory backend.
+	static std::shared_ptr<KeyValueDB> open(std::string const& _path, DBOptions const& _options = DBOptions());
+	/// @returns one DB for each of @a _columns, or an empty vector if they could not be opened.
+	/// LevelDB opens a DB at @a _path/<column> for each; RocksDB keeps them all as column families of the DB at
+	/// @a _path/<first column>, sharing its block cache.
+	static std::vector<std::shared_ptr<KeyValueDB>> open(std::string const& _path, strings const& _columns, DBOptions const& _options = DBOptions());
+	/// As above, with the tuning of each column from the same element of @a _options; the backend and those options
+	/// which are of the whole DB under RocksDB, such as maxOpenFiles, are the first's.
+	static std::vector<std::shared_ptr<KeyValueDB>> open(std::string const& _path, strings const& _columns, std::vector<DBOptions> const& _options);
+
+	virtual void insert(bytesConstRef _key, bytesConstRef _value);
+	virtual void kill(bytesConstRef _key);
+
+	/// @returns an empty batch for this DB.
+	virtual std::unique_ptr<WriteBatch> batch() const = 0;
+	/// Atomically applies @a _batch, which must have come from batch(). @returns false on failure, having warned.
+	virtual bool write(WriteBatch const& _batch) = 0;
+
+	/// @returns a consistent view of the DB as it is now, unchanged by later writes.
+	virtual std::unique_ptr<KeyValueReader> snapshot() const = 0;
+
+	/// @returns the backend's property @a _name, as its GetProperty() has it without the "leveldb." or "rocksdb."
+	/// prefix, e.g. "stats" or "num-files-at-level0"; empty if the backend has no such property.
+	virtual std::string property(std::string const& _name) const { (void)_name; return std::string(); }
+};
+
+}
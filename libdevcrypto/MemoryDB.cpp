@@ -29,51 +29,49 @@ namespace dev
 
 std::map<h256, std::string> MemoryDB::get() const
 {
-	if (!m_enforceRefs)
-		return m_over;
 	std::map<h256, std::string> ret;
-	for (auto const& i: m_refCount)
-		if (i.second)
-			ret.insert(*m_over.find(i.first));
+	m_over->forEach([&](NodeTable::Slot const& s)
+	{
+		if (!m_enforceRefs || s.refs)
+			ret.insert(make_pair(s.key, m_over->value(s).toString()));
+	});
 	return ret;
 }
 
 std::string MemoryDB::lookup(h256 _h) const
 {
-	auto it = m_over.find(_h);
-	if (it != m_over.end())
-	{
-		if (!m_enforceRefs || (m_refCount.count(it->first) && m_refCount.at(it->first)))
-			return it->second;
-//		else if (m_enforceRefs && m_refCount.count(it->first) && !m_refCount.at(it->first))
-//			cnote << "Lookup required for value with no refs. Let's hope it's in the DB." << _h.abridged();
-	}
+	auto s = m_over->find(_h);
+	if (s && (!m_enforceRefs || s->refs))
+		return m_over->value(*s).toString();
+//	else if (s && m_enforceRefs && !s->refs)
+//		cnote << "Lookup required for value with no refs. Let's hope it's in the DB." << _h.abridged();
 	return std::string();
 }
 
 bool MemoryDB::exists(h256 _h) const
 {
-	auto it = m_over.find(_h);
-	if (it != m_over.end() && (!m_enforceRefs || (m_refCount.count(it->first) && m_refCount.at(it->first))))
-		return true;
-	return false;
+	auto s = m_over->find(_h);
+	return s && (!m_enforceRefs || s->refs);
 }
 
 void MemoryDB::insert(h256 _h, bytesConstRef _v)
 {
-	m_over[_h] = _v.toString();
-	m_refCount[_h]++;
+	NodeTable& over = m_over.write();
+	auto& s = over.insert(_h);
+	over.setValue(s, _v);
+	s.refs++;
 #if ETH_PARANOIA
-	dbdebug << "INST" << _h.abridged() << "=>" << m_refCount[_h];
+	dbdebug << "INST" << _h.abridged() << "=>" << s.refs;
 #endif
 }
 
 bool MemoryDB::kill(h256 _h)
 {
-	if (m_refCount.count(_h))
+	// Copies a shared table only if there is something in it to change.
+	if (auto s = m_over->find(_h) ? m_over.write().find(_h) : nullptr)
 	{
-		if (m_refCount[_h] > 0)
-			--m_refCount[_h];
+		if (s->refs > 0)
+			--s->refs;
 #if ETH_PARANOIA
 		else
 		{
@@ -82,7 +80,7 @@ bool MemoryDB::kill(h256 _h)
 			dbdebug << "NOKILL-WAS" << _h.abridged();
 			return false;
 		}
-		dbdebug << "KILL" << _h.abridged() << "=>" << m_refCount[_h];
+		dbdebug << "KILL" << _h.abridged() << "=>" << s->refs;
 		return true;
 	}
 	else
@@ -98,17 +96,17 @@ bool MemoryDB::kill(h256 _h)
 
 void MemoryDB::purge()
 {
-	for (auto const& i: m_refCount)
-		if (!i.second)
-			m_over.erase(i.first);
+	m_over.write().purge();
 }
 
 set<h256> MemoryDB::keys() const
 {
 	set<h256> ret;
-	for (auto const& i: m_refCount)
-		if (i.second && h128(i.first.ref().cropped(0, 16)))
-			ret.insert(i.first);
+	m_over->forEach([&](NodeTable::Slot const& s)
+	{
+		if (s.refs && h128(s.key.ref().cropped(0, 16)))
+			ret.insert(s.key);
+	});
 	return ret;
 }
 
@@ -22,10 +22,13 @@
 #pragma once
 
 #include <map>
+#include <unordered_map>
 #include <libdevcore/Common.h>
+#include <libdevcore/CopyOnWrite.h>
 #include <libdevcore/FixedHash.h>
 #include <libdevcore/Log.h>
 #include <libdevcore/RLP.h>
+#include "NodeTable.h"
 #include "SHA3.h"
 
 namespace dev
@@ -44,7 +47,7 @@ class MemoryDB
 public:
 	MemoryDB() {}
 
-	void clear() { m_over.clear(); }
+	void clear() { m_over.reset(); }
 	std::map<h256, std::string> get() const;
 
 	std::string lookup(h256 _h) const;
@@ -53,19 +56,19 @@ public:
 	bool kill(h256 _h);
 	void purge();
 
-	bytes lookupAux(h256 _h) const { auto h = aux(_h); return m_aux.count(h) ? m_aux.at(h) : bytes(); }
-	void removeAux(h256 _h) { m_auxActive.erase(aux(_h)); }
-	void insertAux(h256 _h, bytesConstRef _v) { auto h = aux(_h); m_auxActive.insert(h); m_aux[h] = _v.toBytes(); }
+	bytes lookupAux(h256 _h) const { auto it = m_aux->find(aux(_h)); return it != m_aux->end() ? it->second : bytes(); }
+	void removeAux(h256 _h) { m_auxActive.write().erase(aux(_h)); }
+	void insertAux(h256 _h, bytesConstRef _v) { auto h = aux(_h); m_auxActive.write().insert(h); m_aux.write()[h] = _v.toBytes(); }
 
 	std::set<h256> keys() const;
 
 protected:
 	static h256 aux(h256 _k) { return h256(sha3(_k).ref().cropped(0, 24), h256::AlignLeft); }
 
-	std::map<h256, std::string> m_over;
-	std::map<h256, unsigned> m_refCount;
-	std::set<h256> m_auxActive;
-	std::map<h256, bytes> m_aux;
+	// Shared by copies until written, so that copying a state's overlay costs nothing until it changes.
+	CopyOnWrite<NodeTable> m_over;					///< The nodes and their reference counts.
+	CopyOnWrite<std::set<h256>> m_auxActive;
+	CopyOnWrite<std::unordered_map<h256, bytes>> m_aux;
 
 	mutable bool m_enforceRefs = false;
 };
@@ -0,0 +1,163 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file NodeTable.cpp
+ * @date 2015
+ */
+
+#include "NodeTable.h"
+#include <cstring>
+using namespace std;
+using namespace dev;
+
+size_t NodeTable::home(h256 const& _k) const
+{
+	// Mix all of the key, so that keys which are not hashes (e.g. small numbers) still spread out.
+	uint64_t w[4];
+	memcpy(w, _k.data(), sizeof(w));
+	uint64_t x = w[0] ^ w[1] ^ w[2] ^ w[3];
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33;
+	return x & (m_slots.size() - 1);
+}
+
+NodeTable::Slot const* NodeTable::find(h256 const& _k) const
+{
+	if (!m_count)
+		return nullptr;
+	size_t mask = m_slots.size() - 1;
+	for (size_t i = home(_k);; i = (i + 1) & mask)
+	{
+		Slot const& s = m_slots[i];
+		if (s.size == c_unused)
+			return nullptr;
+		if (s.key == _k)
+			return &s;
+	}
+}
+
+NodeTable::Slot& NodeTable::insert(h256 const& _k)
+{
+	if ((m_count + 1) * 4 > m_slots.size() * 3)
+		grow();
+	size_t mask = m_slots.size() - 1;
+	for (size_t i = home(_k);; i = (i + 1) & mask)
+	{
+		Slot& s = m_slots[i];
+		if (s.size == c_unused)
+		{
+			s.key = _k;
+			s.refs = 0;
+			s.size = 0;
+			++m_count;
+			return s;
+		}
+		if (s.key == _k)
+			return s;
+	}
+}
+
+void NodeTable::erase(h256 const& _k)
+{
+	Slot* s = find(_k);
+	if (!s)
+		return;
+	s->size = c_unused;
+	--m_count;
+
+	// Shift back the slots after it that would no longer be found.
+	size_t mask = m_slots.size() - 1;
+	size_t i = s - m_slots.data();
+	for (size_t j = (i + 1) & mask; m_slots[j].size != c_unused; j = (j + 1) & mask)
+	{
+		size_t h = home(m_slots[j].key);
+		if (j > i ? (h <= i || h > j) : (h <= i && h > j))
+		{
+			m_slots[i] = m_slots[j];
+			m_slots[j].size = c_unused;
+			i = j;
+		}
+	}
+}
+
+bytesConstRef NodeTable::value(Slot const& _s) const
+{
+	if (_s.size <= c_inline)
+		return bytesConstRef(_s.data, _s.size);
+	return bytesConstRef(m_arena[_s.at.chunk].data() + _s.at.offset, _s.size);
+}
+
+void NodeTable::setValue(Slot& _s, bytesConstRef _v)
+{
+	if (_v.size() == _s.size && !memcmp(value(_s).data(), _v.data(), _v.size()))
+		return;
+	if (_v.size() <= c_inline)
+		memcpy(_s.data, _v.data(), _v.size());
+	else
+	{
+		if (m_arena.empty() || m_arena.back().size() + _v.size() > m_arena.back().capacity())
+		{
+			m_arena.emplace_back();
+			m_arena.back().reserve(max(size_t(c_chunkSize), _v.size()));
+		}
+		bytes& chunk = m_arena.back();
+		_s.at.chunk = m_arena.size() - 1;
+		_s.at.offset = chunk.size();
+		chunk.insert(chunk.end(), _v.begin(), _v.end());
+	}
+	_s.size = _v.size();
+}
+
+void NodeTable::purge()
+{
+	NodeTable t;
+	forEach([&](Slot const& s)
+	{
+		if (s.refs)
+		{
+			Slot& n = t.insert(s.key);
+			n.refs = s.refs;
+			t.setValue(n, value(s));
+		}
+	});
+	swap(*this, t);
+}
+
+void NodeTable::clear()
+{
+	*this = NodeTable();
+}
+
+void NodeTable::grow()
+{
+	vector<Slot> old;
+	old.swap(m_slots);
+	size_t size = max<size_t>(old.size() * 2, 16);
+	m_slots.resize(size);
+	for (Slot& s: m_slots)
+		s.size = c_unused;
+
+	size_t mask = m_slots.size() - 1;
+	for (Slot const& s: old)
+		if (s.size != c_unused)
+		{
+			size_t i = home(s.key);
+			while (m_slots[i].size != c_unused)
+				i = (i + 1) & mask;
+			m_slots[i] = s;
+		}
+}
@@ -0,0 +1,91 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file NodeTable.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+
+namespace dev
+{
+
+/**
+ * @brief Open-addressing hash table from h256 to a reference count and a value, as kept by MemoryDB.
+ * Keys are hashes already, so a word of the key is all the hashing done. Values up to c_inline bytes live in the
+ * slot; longer ones are appended to an arena, whose space is reclaimed only by purge() or clear().
+ */
+class NodeTable
+{
+public:
+	static const unsigned c_inline = 24;
+
+	struct Slot
+	{
+		h256 key;
+		unsigned refs;
+		uint32_t size;							///< Size of the value, or c_unused for a free slot.
+		union
+		{
+			byte data[c_inline];				///< The value if it fits.
+			struct { uint32_t chunk; uint32_t offset; } at;	///< Where the value is in the arena otherwise.
+		};
+	};
+
+	NodeTable() {}
+
+	/// @returns the slot of @a _k, or null if there is none.
+	Slot const* find(h256 const& _k) const;
+	Slot* find(h256 const& _k) { return const_cast<Slot*>(const_cast<NodeTable const*>(this)->find(_k)); }
+
+	/// @returns the slot of @a _k, adding one with no references and an empty value if there is none.
+	Slot& insert(h256 const& _k);
+
+	/// Removes the slot of @a _k, if any.
+	void erase(h256 const& _k);
+
+	bytesConstRef value(Slot const& _s) const;
+	void setValue(Slot& _s, bytesConstRef _v);
+
+	/// Removes the slots with no references and reclaims the arena space no longer used.
+	void purge();
+
+	void clear();
+
+	size_t size() const { return m_count; }
+	bool empty() const { return !m_count; }
+
+	/// Calls @a _f with every slot in use.
+	template <class F> void forEach(F const& _f) const { for (Slot const& s: m_slots) if (s.size != c_unused) _f(s); }
+
+private:
+	static const uint32_t c_unused = ~uint32_t(0);
+	static const size_t c_chunkSize = 1 << 20;
+
+	size_t home(h256 const& _k) const;
+	void grow();
+
+	std::vector<Slot> m_slots;			///< Power-of-two sized; linear probing.
+	size_t m_count = 0;
+	std::vector<bytes> m_arena;			///< Chunks of values too long to go inline.
+};
+
+}
@@ -19,8 +19,12 @@
  * @date 2014
  */
 
-#include <leveldb/db.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <thread>
 #include <libdevcore/Common.h>
+#include <libdevcore/Guards.h>
 #include "OverlayDB.h"
 using namespace std;
 using namespace dev;
@@ -28,50 +32,284 @@ using namespace dev;
 namespace dev
 {
 
+/**
+ * @brief Writes the batches committed by the copies of an OverlayDB, either straight away or on its own thread.
+ * Queued batches are kept in memory, and searched by lookups, until they are durable.
+ * @threadsafe
+ */
+class OverlayDB::Writer
+{
+public:
+	struct Batch
+	{
+		NodeTable nodes;
+		std::unordered_map<h256, bytes> aux;
+		std::unordered_map<h256, unsigned> killed;		///< References dropped to nodes on disk, if pruning.
+		bool journalled = false;						///< Whether this is the commit of a block.
+		unsigned era = 0;
+		h256 block;
+	};
+
+	explicit Writer(shared_ptr<KeyValueDB> const& _db): m_db(_db) {}
+	~Writer() { setAsync(false); }
+
+	/// Starts or stops the writer thread; stopping it writes what is queued first. Not to be called concurrently with itself.
+	void setAsync(bool _async);
+	void write(shared_ptr<Batch const> const& _b);
+	void flush();
+
+	bool lookup(h256 const& _h, std::string& o_v) const;
+	bool lookupAux(h256 const& _h, bytes& o_v) const;
+
+	bool setPruning(unsigned _history, unsigned _checkpointInterval);
+	void setCanonical(CanonicalHash const& _f);
+	bool pruning() const { return m_pruning; }
+
+private:
+	/// The most batches queued at once; commit() waits for the writer beyond this.
+	static const unsigned c_maxQueued = 4;
+
+	void writeNow(Batch const& _b);
+	void run();
+
+	shared_ptr<KeyValueDB> m_db;
+
+	Mutex x_write;									///< Serialises writes, and guards the pruner.
+	unique_ptr<StatePruner> m_pruner;
+	atomic<bool> m_pruning{false};
+
+	mutable Mutex x_queue;
+	deque<shared_ptr<Batch const>> m_queue;		///< Oldest first; the front one is being written.
+	Condition m_queued;								///< Signalled when a batch is queued or the thread is to stop.
+	Condition m_written;							///< Signalled when a batch has been written.
+	bool m_async = false;
+	bool m_stop = false;
+	std::thread m_thread;
+};
+
+void OverlayDB::Writer::setAsync(bool _async)
+{
+	if (_async)
+	{
+		Guard l(x_queue);
+		if (!m_async)
+		{
+			m_async = true;
+			m_stop = false;
+			m_thread = std::thread([=](){ run(); });
+		}
+	}
+	else
+	{
+		{
+			Guard l(x_queue);
+			if (!m_async)
+				return;
+			m_async = false;
+			m_stop = true;
+		}
+		m_queued.notify_all();
+		m_thread.join();
+	}
+}
+
+void OverlayDB::Writer::write(shared_ptr<Batch const> const& _b)
+{
+	unique_lock<Mutex> l(x_queue);
+	if (m_async)
+	{
+		m_written.wait(l, [&](){ return m_queue.size() < c_maxQueued; });
+		m_queue.push_back(_b);
+		m_queued.notify_all();
+	}
+	else
+	{
+		// Anything still queued from before must land first.
+		m_written.wait(l, [&](){ return m_queue.empty(); });
+		l.unlock();
+		writeNow(*_b);
+	}
+}
+
+void OverlayDB::Writer::flush()
+{
+	unique_lock<Mutex> l(x_queue);
+	m_written.wait(l, [&](){ return m_queue.empty(); });
+}
+
+void OverlayDB::Writer::run()
+{
+	setThreadName("db");
+	unique_lock<Mutex> l(x_queue);
+	while (true)
+	{
+		m_queued.wait(l, [&](){ return m_stop || !m_queue.empty(); });
+		if (m_queue.empty())
+			break;
+		auto b = m_queue.front();
+		l.unlock();
+		writeNow(*b);
+		l.lock();
+		m_queue.pop_front();
+		m_written.notify_all();
+	}
+}
+
+void OverlayDB::Writer::writeNow(Batch const& _b)
+{
+	Guard l(x_write);
+	auto batch = m_db->batch();
+	_b.nodes.forEach([&](NodeTable::Slot const& s)
+	{
+		if (s.refs)
+			batch->insert(s.key.ref(), _b.nodes.value(s));
+	});
+	for (auto const& i: _b.aux)
+		batch->insert(i.first.ref(), bytesConstRef(&i.second));
+	if (m_pruner && _b.journalled)
+		m_pruner->journal(*batch, _b.era, _b.block, _b.nodes, _b.killed);
+	else if (m_pruner)
+		m_pruner->count(*batch, _b.nodes);
+	if (!m_db->write(*batch))
+		cwarn << "Error writing state DB batch.";
+	if (m_pruner && _b.journalled)
+		m_pruner->prune(_b.era);
+}
+
+bool OverlayDB::Writer::setPruning(unsigned _history, unsigned _checkpointInterval)
+{
+	flush();
+	Guard l(x_write);
+	if (_history)
+		m_pruner = StatePruner::open(m_db.get(), _history, _checkpointInterval);
+	else
+	{
+		m_pruner.reset();
+		StatePruner::disable(m_db.get());
+	}
+	m_pruning = !!m_pruner;
+	return m_pruner || !_history;
+}
+
+void OverlayDB::Writer::setCanonical(CanonicalHash const& _f)
+{
+	Guard l(x_write);
+	if (m_pruner)
+		m_pruner->setCanonical(_f);
+}
+
+bool OverlayDB::Writer::lookup(h256 const& _h, std::string& o_v) const
+{
+	Guard l(x_queue);
+	for (auto i = m_queue.rbegin(); i != m_queue.rend(); ++i)
+		if (auto s = (*i)->nodes.find(_h))
+			if (s->refs)
+			{
+				o_v = (*i)->nodes.value(*s).toString();
+				return true;
+			}
+	return false;
+}
+
+bool OverlayDB::Writer::lookupAux(h256 const& _h, bytes& o_v) const
+{
+	Guard l(x_queue);
+	for (auto i = m_queue.rbegin(); i != m_queue.rend(); ++i)
+	{
+		auto it = (*i)->aux.find(_h);
+		if (it != (*i)->aux.end())
+		{
+			o_v = it->second;
+			return true;
+		}
+	}
+	return false;
+}
+
+OverlayDB::OverlayDB(shared_ptr<KeyValueDB> const& _db):
+	m_db(_db),
+	m_writer(_db ? make_shared<Writer>(m_db) : nullptr)
+{}
+
 OverlayDB::~OverlayDB()
 {
-	if (m_db.use_count() == 1 && m_db.get())
+	if (m_writer.use_count() == 1)
 		cnote << "Closing state DB";
 }
 
-void OverlayDB::setDB(ldb::DB* _db, bool _clearOverlay)
+void OverlayDB::setDB(shared_ptr<KeyValueDB> const& _db, bool _clearOverlay)
 {
-	m_db = std::shared_ptr<ldb::DB>(_db);
+	m_db = _db;
+	m_writer = _db ? make_shared<Writer>(m_db) : nullptr;
 	if (_clearOverlay)
-		m_over.clear();
+	{
+		m_over.reset();
+		m_killed.clear();
+	}
+}
+
+void OverlayDB::setAsyncCommit(bool _async)
+{
+	if (m_writer)
+		m_writer->setAsync(_async);
+}
+
+void OverlayDB::flush()
+{
+	if (m_writer)
+		m_writer->flush();
+}
+
+bool OverlayDB::setPruning(unsigned _history, unsigned _checkpointInterval)
+{
+	return !m_writer || m_writer->setPruning(_history, _checkpointInterval);
+}
+
+void OverlayDB::setCanonical(CanonicalHash const& _f)
+{
+	if (m_writer)
+		m_writer->setCanonical(_f);
 }
 
 void OverlayDB::commit()
 {
-	if (m_db)
+	commit(false, 0, h256());
+}
+
+void OverlayDB::commit(unsigned _era, h256 const& _block)
+{
+	commit(true, _era, _block);
+}
+
+void OverlayDB::commit(bool _journalled, unsigned _era, h256 const& _block)
+{
+	if (m_writer)
 	{
-//		cnote << "Committing nodes to disk DB:";
-		for (auto const& i: m_over)
+		auto b = make_shared<Writer::Batch>();
+		b->journalled = _journalled;
+		b->era = _era;
+		b->block = _block;
+		std::swap(b->nodes, m_over.write());
+		std::swap(b->killed, m_killed);
+		auto& aux = m_aux.write();
+		for (auto const& i: *m_auxActive)
 		{
-//			cnote << i.first << "#" << m_refCount[i.first];
-			if (m_refCount[i.first])
-				m_db->Put(m_writeOptions, ldb::Slice((char const*)i.first.data(), i.first.size), ldb::Slice(i.second.data(), i.second.size()));
+			auto it = aux.find(i);
+			if (it != aux.end())
+				b->aux.insert(std::move(*it));
 		}
-		for (auto const& i: m_auxActive)
-			if (m_aux.count(i))
-			{
-				m_db->Put(m_writeOptions, i.ref(), bytesConstRef(&m_aux[i]));
-				m_aux.erase(i);
-			}
-		m_auxActive.clear();
-		m_aux.clear();
-		m_over.clear();
-		m_refCount.clear();
+		m_auxActive.reset();
+		m_aux.reset();
+		m_writer->write(b);
 	}
 }
 
 bytes OverlayDB::lookupAux(h256 _h) const
 {
 	bytes ret = MemoryDB::lookupAux(_h);
-	if (!ret.empty())
+	if (!ret.empty() || (m_writer && m_writer->lookupAux(aux(_h), ret)))
 		return ret;
-	std::string v;
-	m_db->Get(m_readOptions, aux(_h).ref(), &v);
+	std::string v = m_db->lookup(aux(_h).ref());
 	if (v.empty())
 		cwarn << "Aux not found: " << _h;
 	return asBytes(v);
@@ -79,15 +317,15 @@ bytes OverlayDB::lookupAux(h256 _h) const
 
 void OverlayDB::rollback()
 {
-	m_over.clear();
-	m_refCount.clear();
+	m_over.reset();
+	m_killed.clear();
 }
 
 std::string OverlayDB::lookup(h256 _h) const
 {
 	std::string ret = MemoryDB::lookup(_h);
-	if (ret.empty() && m_db)
-		m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
+	if (ret.empty() && m_db && !m_writer->lookup(_h, ret))
+		ret = m_db->lookup(_h.ref());
 	return ret;
 }
 
@@ -96,25 +334,25 @@ bool OverlayDB::exists(h256 _h) const
 	if (MemoryDB::exists(_h))
 		return true;
 	std::string ret;
-	if (m_db)
-		m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
-	return !ret.empty();
+	if (m_db && m_writer->lookup(_h, ret))
+		return true;
+	return m_db && m_db->exists(_h.ref());
 }
 
 void OverlayDB::kill(h256 _h)
 {
-#if ETH_PARANOIA
-	if (!MemoryDB::kill(_h))
+	NodeTable::Slot const* s = m_over->find(_h);
+	if (!s || !s->refs)
 	{
-		std::string ret;
-		if (m_db)
-			m_db->Get(m_readOptions, ldb::Slice((char const*)_h.data(), 32), &ret);
-		if (ret.empty())
+		// The reference is to a node on disk, which only pruning needs to hear of.
+		if (m_writer && m_writer->pruning())
+			++m_killed[_h];
+#if ETH_PARANOIA
+		if (!exists(_h))
 			cnote << "Decreasing DB node ref count below zero with no DB node. Probably have a corrupt Trie." << _h.abridged();
+#endif
 	}
-#else
 	MemoryDB::kill(_h);
-#endif
 }
 
 }
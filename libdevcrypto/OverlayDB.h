@@ -21,16 +21,14 @@
 
 #pragma once
 
-#pragma warning(push)
-#pragma warning(disable: 4100 4267)
-#include <leveldb/db.h>
-#pragma warning(pop)
-
 #include <memory>
 #include <libdevcore/Common.h>
 #include <libdevcore/Log.h>
+#include "KeyValueDB.h"
 #include "MemoryDB.h"
-namespace ldb = leveldb;
+#include "StatePruner.h"
+#include "StateSnapshot.h"
+#include "TrieNodeCache.h"
 
 namespace dev
 {
@@ -38,28 +36,54 @@ namespace dev
 class OverlayDB: public MemoryDB
 {
 public:
-	OverlayDB(ldb::DB* _db = nullptr): m_db(_db) {}
+	OverlayDB(std::shared_ptr<KeyValueDB> const& _db = nullptr);
 	~OverlayDB();
 
-	ldb::DB* db() const { return m_db.get(); }
-	void setDB(ldb::DB* _db, bool _clearOverlay = true);
+	KeyValueDB* db() const { return m_db.get(); }
+	void setDB(std::shared_ptr<KeyValueDB> const& _db, bool _clearOverlay = true);
 
+	/// Writes the overlay to the disk DB as a single batch; with asynchronous commits the write is only queued.
 	void commit();
+	/// As commit(), for the state of block @a _block at @a _era (its number), journalling it if the DB is pruned.
+	void commit(unsigned _era, h256 const& _block);
 	void rollback();
 
+	/// Makes commit() hand its batches to a writer thread, shared by all copies of this object.
+	/// Until a batch is durable its nodes are still found by lookup().
+	void setAsyncCommit(bool _async);
+	/// Blocks until everything committed so far has been written to the disk DB.
+	void flush();
+
+	/// Keeps only the states of the last @a _history eras, and of multiples of @a _checkpointInterval if non-zero,
+	/// deleting other nodes as eras expire; 0 keeps every state. Shared by all copies of this object.
+	/// @returns false if the DB already holds state written without pruning, in which case it is left unpruned.
+	bool setPruning(unsigned _history, unsigned _checkpointInterval = 0);
+	/// Sets how the canonical block of an era is found; eras expire only once it is known.
+	void setCanonical(CanonicalHash const& _f);
+
 	std::string lookup(h256 _h) const;
 	bool exists(h256 _h) const;
 	void kill(h256 _h);
 
 	bytes lookupAux(h256 _h) const;
 
+	/// @returns the cache of parsed trie nodes shared by copies of this object, or null while references are enforced.
+	TrieNodeCache* nodeCache() const { return m_enforceRefs ? nullptr : m_nodeCache.get(); }
+	/// @returns the flat index of the states kept in this object, shared by its copies.
+	StateSnapshot* snapshot() const { return m_snapshot.get(); }
+
 private:
+	class Writer;
+
 	using MemoryDB::clear;
 
-	std::shared_ptr<ldb::DB> m_db;
+	void commit(bool _journalled, unsigned _era, h256 const& _block);
 
-	ldb::ReadOptions m_readOptions;
-	ldb::WriteOptions m_writeOptions;
+	std::shared_ptr<KeyValueDB> m_db;
+	std::shared_ptr<Writer> m_writer;		///< Keeps the DB open until its queued batches are written.
+	std::shared_ptr<TrieNodeCache> m_nodeCache = std::make_shared<TrieNodeCache>();
+	std::shared_ptr<StateSnapshot> m_snapshot = std::make_shared<StateSnapshot>();
+	std::unordered_map<h256, unsigned> m_killed;	///< References dropped since the last commit to nodes on disk, if pruning.
 };
 
 }
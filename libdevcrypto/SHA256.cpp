@@ -0,0 +1,181 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SHA256.cpp
+ * @date 2015
+ */
+
+#include "SHA256.h"
+#include <cstring>
+#include <libdevcore/CpuFeatures.h>
+using namespace std;
+using namespace dev;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// The SHA extensions do two rounds an instruction; picked at runtime.
+#define ETH_SHA256_NI 1
+#include <immintrin.h>
+#else
+#define ETH_SHA256_NI 0
+#endif
+
+static const uint32_t c_roundConstants[64] =
+{
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t c_initialState[8] =
+{
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+typedef void (*Compress)(uint32_t* io_state, byte const* _blocks, size_t _count);
+
+static inline uint32_t rotr(uint32_t _x, unsigned _n) { return (_x >> _n) | (_x << (32 - _n)); }
+
+/// Runs the compression function of each of the @a _count 64-byte blocks at @a _blocks on @a io_state.
+static void compressPortable(uint32_t* io_state, byte const* _blocks, size_t _count)
+{
+	for (; _count; --_count, _blocks += 64)
+	{
+		uint32_t w[64];
+		for (unsigned i = 0; i < 16; ++i)
+			w[i] = (uint32_t(_blocks[i * 4]) << 24) | (uint32_t(_blocks[i * 4 + 1]) << 16) | (uint32_t(_blocks[i * 4 + 2]) << 8) | _blocks[i * 4 + 3];
+		for (unsigned i = 16; i < 64; ++i)
+		{
+			uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+
+		uint32_t a = io_state[0], b = io_state[1], c = io_state[2], d = io_state[3];
+		uint32_t e = io_state[4], f = io_state[5], g = io_state[6], h = io_state[7];
+		for (unsigned i = 0; i < 64; ++i)
+		{
+			uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + c_roundConstants[i] + w[i];
+			uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+		io_state[0] += a; io_state[1] += b; io_state[2] += c; io_state[3] += d;
+		io_state[4] += e; io_state[5] += f; io_state[6] += g; io_state[7] += h;
+	}
+}
+
+#if ETH_SHA256_NI
+
+__attribute__((target("sha,sse4.1,ssse3"))) static void compressNative(uint32_t* io_state, byte const* _blocks, size_t _count)
+{
+	// The instructions want the state as ABEF and CDGH, and each message word big-endian.
+	__m128i t = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const*)io_state), 0xB1);
+	__m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const*)(io_state + 4)), 0x1B);
+	__m128i state0 = _mm_alignr_epi8(t, state1, 8);
+	state1 = _mm_blend_epi16(state1, t, 0xF0);
+	__m128i const mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+	for (; _count; --_count, _blocks += 64)
+	{
+		__m128i abef = state0;
+		__m128i cdgh = state1;
+		__m128i w[4];
+		for (unsigned i = 0; i < 4; ++i)
+			w[i] = _mm_shuffle_epi8(_mm_loadu_si128((__m128i const*)(_blocks + i * 16)), mask);
+
+		// Four rounds a turn; from the fifth on, the next four words of the schedule replace the oldest.
+		for (unsigned i = 0; i < 16; ++i)
+		{
+			if (i >= 4)
+			{
+				__m128i m = _mm_sha256msg1_epu32(w[i % 4], w[(i + 1) % 4]);
+				m = _mm_add_epi32(m, _mm_alignr_epi8(w[(i + 3) % 4], w[(i + 2) % 4], 4));
+				w[i % 4] = _mm_sha256msg2_epu32(m, w[(i + 3) % 4]);
+			}
+			__m128i m = _mm_add_epi32(w[i % 4], _mm_loadu_si128((__m128i const*)(c_roundConstants + i * 4)));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(m, 0x0E));
+		}
+
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+	}
+
+	t = _mm_shuffle_epi32(state0, 0x1B);
+	state1 = _mm_shuffle_epi32(state1, 0xB1);
+	_mm_storeu_si128((__m128i*)io_state, _mm_blend_epi16(t, state1, 0xF0));
+	_mm_storeu_si128((__m128i*)(io_state + 4), _mm_alignr_epi8(state1, t, 8));
+}
+
+#endif
+
+static void digest(Compress _compress, bytesConstRef _in, byte* o_out)
+{
+	uint32_t state[8];
+	memcpy(state, c_initialState, sizeof(state));
+	size_t blocks = _in.size() / 64;
+	_compress(state, _in.data(), blocks);
+
+	// The rest, a one bit, zeroes and the length in bits fill one or two more blocks.
+	byte last[128] = {};
+	size_t rest = _in.size() - blocks * 64;
+	if (rest)
+		memcpy(last, _in.data() + blocks * 64, rest);
+	last[rest] = 0x80;
+	size_t lastBlocks = rest < 56 ? 1 : 2;
+	uint64_t bits = uint64_t(_in.size()) * 8;
+	for (unsigned i = 0; i < 8; ++i)
+		last[lastBlocks * 64 - 1 - i] = byte(bits >> (i * 8));
+	_compress(state, last, lastBlocks);
+
+	for (unsigned i = 0; i < 8; ++i)
+		for (unsigned j = 0; j < 4; ++j)
+			o_out[i * 4 + j] = byte(state[i] >> (24 - j * 8));
+}
+
+static CpuDispatch<Compress> const s_compress("sha256", {
+#if ETH_SHA256_NI
+	{ "sha", CpuSHA | CpuSSE41 | CpuSSSE3, compressNative },
+#endif
+	{ "portable", 0, compressPortable }
+});
+
+bool dev::sha256Native()
+{
+	return s_compress() && s_compress() != compressPortable;
+}
+
+void dev::sha256Portable(bytesConstRef _in, byte* o_out)
+{
+	digest(compressPortable, _in, o_out);
+}
+
+void dev::sha256(bytesConstRef _in, byte* o_out)
+{
+	// Not picked yet only if called during static initialisation.
+	digest(s_compress() ? s_compress() : compressPortable, _in, o_out);
+}
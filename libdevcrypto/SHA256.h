@@ -0,0 +1,38 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file SHA256.h
+ * @date 2015
+ * SHA-256, with the SHA extensions on CPUs that have them.
+ */
+
+#pragma once
+
+#include <libdevcore/Common.h>
+
+namespace dev
+{
+
+/// Hashes @a _in into the 32 bytes at @a o_out.
+void sha256(bytesConstRef _in, byte* o_out);
+
+/// Hashes @a _in into the 32 bytes at @a o_out without the SHA extensions, whatever the CPU.
+void sha256Portable(bytesConstRef _in, byte* o_out);
+
+/// @returns true if sha256() uses the SHA extensions on this CPU.
+bool sha256Native();
+
+}
@@ -23,6 +23,8 @@
 
 #include <libdevcore/RLP.h>
 #include "CryptoPP.h"
+#include "Keccak.h"
+#include "SHA256.h"
 using namespace std;
 using namespace dev;
 
@@ -51,10 +53,15 @@ std::string sha3(std::string const& _input, bool _hex)
 
 void sha3(bytesConstRef _input, bytesRef _output)
 {
-	CryptoPP::SHA3_256 ctx;
-	ctx.Update((byte*)_input.data(), _input.size());
 	assert(_output.size() >= 32);
-	ctx.Final(_output.data());
+	keccak256(_input, _output.data());
+}
+
+void sha3(bytesConstRef const* _inputs, h256* o_outputs, size_t _count)
+{
+	static_assert(sizeof(h256) == 32, "h256 must be just its bytes to be hashed into in place.");
+	if (_count)
+		keccak256(_inputs, o_outputs->data(), _count);
 }
 
 void ripemd160(bytesConstRef _input, bytesRef _output)
@@ -67,9 +74,15 @@ void ripemd160(bytesConstRef _input, bytesRef _output)
 
 void sha256(bytesConstRef _input, bytesRef _output)
 {
-	CryptoPP::SHA256 ctx;
-	ctx.Update((byte*)_input.data(), _input.size());
 	assert(_output.size() >= 32);
+	sha256(_input, _output.data());
+}
+
+void sha1(bytesConstRef _input, bytesRef _output)
+{
+	CryptoPP::SHA1 ctx;
+	ctx.Update((byte*)_input.data(), _input.size());
+	assert(_output.size() >= 20);
 	ctx.Final(_output.data());
 }
 
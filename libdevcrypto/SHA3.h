@@ -62,6 +62,10 @@ void sha3mac(bytesConstRef _secret, bytesConstRef _plain, bytesRef _output);
 /// Calculate SHA3-256 hash of the given input (presented as a FixedHash), returns a 256-bit hash.
 template<unsigned N> inline h256 sha3(FixedHash<N> const& _input) { return sha3(_input.ref()); }
 
+/// Calculates the SHA3-256 hashes of the @a _count inputs at @a _inputs into @a o_outputs, several at once where the
+/// CPU can, which is quicker than one at a time for many short inputs such as trie nodes and keys.
+void sha3(bytesConstRef const* _inputs, h256* o_outputs, size_t _count);
+
 extern h256 EmptySHA3;
 
 extern h256 EmptyListSHA3;
@@ -74,4 +78,7 @@ void sha256(bytesConstRef _input, bytesRef _output);
 
 void ripemd160(bytesConstRef _input, bytesRef _output);
 
+/// Calculates the SHA-1 hash of @a _input into the first 20 bytes of @a _output. Only for protocols requiring it, such as WebSocket's handshake.
+void sha1(bytesConstRef _input, bytesRef _output);
+
 }
@@ -0,0 +1,277 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StatePruner.cpp
+ * @date 2015
+ */
+
+#include "StatePruner.h"
+#include <algorithm>
+#include <libdevcore/Log.h>
+#include <libdevcore/RLP.h>
+#include "MemoryDB.h"
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+// Keys of the pruner's records; node and aux keys are all 32 bytes long, so none of these can clash with them.
+string const c_markerKey = "pruning";
+string const c_journalPrefix = "jrnl";
+
+string journalPrefix(unsigned _era)
+{
+	string ret = c_journalPrefix;
+	for (unsigned i = 4; i--;)
+		ret.push_back((char)(_era >> (i * 8)));
+	return ret;
+}
+
+string journalKey(unsigned _era, h256 const& _block)
+{
+	return journalPrefix(_era) + string((char const*)_block.data(), 32);
+}
+
+string countKey(h256 const& _h)
+{
+	return string((char const*)_h.data(), 32) + 'c';
+}
+
+bool startsWith(bytesConstRef _s, string const& _prefix)
+{
+	return _s.size() >= _prefix.size() && !memcmp(_s.data(), _prefix.data(), _prefix.size());
+}
+
+}
+
+unique_ptr<StatePruner> StatePruner::open(KeyValueDB* _db, unsigned _history, unsigned _checkpointInterval)
+{
+	unique_ptr<StatePruner> ret(new StatePruner(_db, _history, _checkpointInterval));
+	string marker = _db->lookup(bytesConstRef(&c_markerKey));
+	if (marker.empty())
+	{
+		// Nodes already in the DB have no counts, so they could be deleted while still referenced.
+		bool empty = true;
+		_db->forEach([&](bytesConstRef, bytesConstRef){ return empty = false; });
+		if (!empty)
+			return nullptr;
+	}
+	else
+	{
+		ret->m_expired = RLP(marker)[1].toInt<unsigned>();
+		_db->forEach(bytesConstRef(&c_journalPrefix), [&](bytesConstRef _key, bytesConstRef _value)
+		{
+			if (!startsWith(_key, c_journalPrefix))
+				return false;
+			for (auto const& i: RLP(_value)[0])
+				ret->m_pending[i[0].toHash<h256>()] += i[1].toInt<unsigned>();
+			return true;
+		});
+	}
+
+	auto batch = _db->batch();
+	ret->writeMarker(*batch);
+	_db->write(*batch);
+	return ret;
+}
+
+void StatePruner::disable(KeyValueDB* _db)
+{
+	if (_db->exists(bytesConstRef(&c_markerKey)))
+	{
+		cnote << "State DB no longer pruned; it cannot be pruned again without killing it.";
+		_db->kill(bytesConstRef(&c_markerKey));
+	}
+}
+
+void StatePruner::writeMarker(WriteBatch& o_batch) const
+{
+	bytes v = rlpList(m_history, m_expired);
+	o_batch.insert(bytesConstRef(&c_markerKey), &v);
+}
+
+void StatePruner::journal(WriteBatch& o_batch, unsigned _era, h256 const& _block, NodeTable const& _nodes, unordered_map<h256, unsigned> const& _killed)
+{
+	vector<pair<h256, unsigned>> inserted;
+	vector<pair<h256, unsigned>> killed;
+	_nodes.forEach([&](NodeTable::Slot const& s)
+	{
+		auto k = _killed.find(s.key);
+		unsigned kills = k == _killed.end() ? 0 : k->second;
+		if (s.refs > kills)
+			inserted.push_back(make_pair(s.key, s.refs - kills));
+		else if (kills > s.refs)
+			killed.push_back(make_pair(s.key, kills - s.refs));
+	});
+	for (auto const& i: _killed)
+		if (!_nodes.find(i.first))
+			killed.push_back(i);
+
+	RLPStream s(2);
+	s.appendList(inserted.size());
+	for (auto const& i: inserted)
+	{
+		s.appendList(2) << i.first << i.second;
+		m_pending[i.first] += i.second;
+	}
+	s.appendList(killed.size());
+	for (auto const& i: killed)
+		s.appendList(2) << i.first << i.second;
+	o_batch.insert(bytesConstRef(journalKey(_era, _block)), &s.out());
+}
+
+void StatePruner::count(WriteBatch& o_batch, NodeTable const& _nodes)
+{
+	// Era 0 keeps the nodes in any checkpoint, since it is not known which states they are part of.
+	unordered_map<h256, Count> counts;
+	_nodes.forEach([&](NodeTable::Slot const& s)
+	{
+		if (s.refs)
+			countOf(s.key, counts, 0).refs += s.refs;
+	});
+	for (auto const& i: counts)
+	{
+		bytes v = rlpList(i.second.refs, i.second.era, i.second.pinned ? 1 : 0);
+		o_batch.insert(bytesConstRef(countKey(i.first)), &v);
+	}
+}
+
+StatePruner::Count& StatePruner::countOf(h256 const& _h, unordered_map<h256, Count>& io_counts, unsigned _era) const
+{
+	auto it = io_counts.find(_h);
+	if (it != io_counts.end())
+		return it->second;
+	Count& ret = io_counts[_h];
+	string v = m_db->lookup(bytesConstRef(countKey(_h)));
+	if (v.empty())
+		ret.era = _era;
+	else
+	{
+		RLP r(v);
+		ret.refs = r[0].toInt<unsigned>();
+		ret.era = r[1].toInt<unsigned>();
+		ret.pinned = !!r[2].toInt<unsigned>();
+	}
+	return ret;
+}
+
+bool StatePruner::pinned(unsigned _first, unsigned _era) const
+{
+	// The last checkpoint before _era is the only one that could still have the node.
+	return m_checkpointInterval && _era && (_era - 1) / m_checkpointInterval * m_checkpointInterval >= _first;
+}
+
+void StatePruner::prune(unsigned _era)
+{
+	if (!m_canonical)
+		return;
+	for (unsigned e = m_expired + 1; e + m_history <= _era; ++e)
+	{
+		h256 canonical = m_canonical(e);
+		if (!canonical)
+			break;
+		expire(e, canonical);
+	}
+}
+
+void StatePruner::expire(unsigned _era, h256 const& _canonical)
+{
+	string prefix = journalPrefix(_era);
+	vector<pair<string, bytes>> entries;
+	m_db->forEach(bytesConstRef(&prefix), [&](bytesConstRef _key, bytesConstRef _value)
+	{
+		if (!startsWith(_key, prefix))
+			return false;
+		entries.push_back(make_pair(_key.toString(), _value.toBytes()));
+		return true;
+	});
+
+	// The canonical block's journal goes first, so that the other blocks' nodes it shares are known to be referenced.
+	string canonicalKey = journalKey(_era, _canonical);
+	stable_partition(entries.begin(), entries.end(), [&](pair<string, bytes> const& _e){ return _e.first == canonicalKey; });
+
+	auto batch = m_db->batch();
+	unordered_map<h256, Count> counts;
+	vector<h256> unreferenced;
+	for (auto const& e: entries)
+	{
+		RLP journal(e.second);
+		bool canonical = e.first == canonicalKey;
+		for (auto const& i: journal[0])
+		{
+			h256 h = i[0].toHash<h256>();
+			unsigned n = i[1].toInt<unsigned>();
+			auto p = m_pending.find(h);
+			if (p != m_pending.end() && (p->second -= min(p->second, n)) == 0)
+				m_pending.erase(p);
+			Count& c = countOf(h, counts, _era);
+			if (canonical)
+			{
+				c.refs += n;
+				c.dirty = true;
+			}
+			else if (!c.refs)
+				unreferenced.push_back(h);
+		}
+		if (canonical)
+			for (auto const& i: journal[1])
+			{
+				h256 h = i[0].toHash<h256>();
+				Count& c = countOf(h, counts, _era);
+				c.refs -= min(c.refs, i[1].toInt<unsigned>());
+				c.dirty = true;
+				if (!c.refs)
+					unreferenced.push_back(h);
+			}
+		batch->kill(bytesConstRef(&e.first));
+	}
+
+	sort(unreferenced.begin(), unreferenced.end());
+	unreferenced.erase(unique(unreferenced.begin(), unreferenced.end()), unreferenced.end());
+	unsigned deleted = 0;
+	for (auto const& h: unreferenced)
+	{
+		Count& c = countOf(h, counts, _era);
+		if (c.refs || c.pinned)
+			continue;
+		if (pinned(c.era, _era))
+			c.pinned = c.dirty = true;
+		else if (!m_pending.count(h))
+		{
+			batch->kill(h.ref());
+			++deleted;
+		}
+	}
+	for (auto const& i: counts)
+		if (i.second.dirty)
+		{
+			// A pinned node keeps its record even with no references, so that it is never deleted.
+			if (i.second.refs || i.second.pinned)
+			{
+				bytes v = rlpList(i.second.refs, i.second.era, i.second.pinned ? 1 : 0);
+				batch->insert(bytesConstRef(countKey(i.first)), &v);
+			}
+			else
+				batch->kill(bytesConstRef(countKey(i.first)));
+		}
+
+	m_expired = _era;
+	writeMarker(*batch);
+	if (!m_db->write(*batch))
+		cwarn << "Error pruning state DB.";
+	dbdebug << "Pruned era" << _era << ":" << deleted << "nodes deleted," << m_pending.size() << "still pending.";
+}
@@ -0,0 +1,94 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StatePruner.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include "KeyValueDB.h"
+#include "NodeTable.h"
+
+namespace dev
+{
+
+/// @returns the hash of the canonical block at the given era (block number), or zero if there is none yet.
+using CanonicalHash = std::function<h256(unsigned)>;
+
+/**
+ * @brief Deletes the state DB nodes no longer reachable from the states of recent blocks.
+ * Each commit of a block journals the nodes it inserted and killed, keyed by era and block hash.
+ * Once an era is older than the history kept, the journal of its canonical block is applied to the
+ * reference counts persisted in the DB, and nodes left with none are deleted, as are nodes only other
+ * blocks of that era inserted. Nodes of the states at checkpoint eras are kept for good.
+ * Callers serialise access.
+ */
+class StatePruner
+{
+public:
+	/// @returns a pruner keeping @a _history eras of @a _db, or null if the DB holds state written without one.
+	/// With @a _checkpointInterval non-zero, the states at multiples of it are kept as well.
+	static std::unique_ptr<StatePruner> open(KeyValueDB* _db, unsigned _history, unsigned _checkpointInterval);
+	/// Marks @a _db as no longer pruned, so that it is never pruned again.
+	static void disable(KeyValueDB* _db);
+
+	void setCanonical(CanonicalHash const& _f) { m_canonical = _f; }
+
+	/// Adds to @a o_batch the journal of the commit of block @a _block at @a _era,
+	/// which inserted the nodes of @a _nodes with references and killed those of @a _killed.
+	void journal(WriteBatch& o_batch, unsigned _era, h256 const& _block, NodeTable const& _nodes, std::unordered_map<h256, unsigned> const& _killed);
+	/// Counts straight away the references of @a _nodes, inserted by a commit outside of any era; its kills are forgotten.
+	void count(WriteBatch& o_batch, NodeTable const& _nodes);
+
+	/// Expires the eras now older than the history kept before @a _era, as far as the canonical chain is known.
+	void prune(unsigned _era);
+
+	/// @returns the last era expired.
+	unsigned expired() const { return m_expired; }
+
+private:
+	struct Count
+	{
+		unsigned refs = 0;
+		unsigned era = 0;		///< The first era the node was inserted in.
+		bool pinned = false;	///< Part of a checkpoint state, so never deleted.
+		bool dirty = false;
+	};
+
+	StatePruner(KeyValueDB* _db, unsigned _history, unsigned _checkpointInterval): m_db(_db), m_history(_history), m_checkpointInterval(_checkpointInterval) {}
+
+	/// @returns the count of @a _h in @a io_counts, reading it from the DB first if need be; a node with none gets @a _era.
+	Count& countOf(h256 const& _h, std::unordered_map<h256, Count>& io_counts, unsigned _era) const;
+	void expire(unsigned _era, h256 const& _canonical);
+	/// @returns true if a node inserted first at @a _first and unreferenced at @a _era is part of a checkpoint state.
+	bool pinned(unsigned _first, unsigned _era) const;
+	void writeMarker(WriteBatch& o_batch) const;
+
+	KeyValueDB* m_db;
+	unsigned m_history;
+	unsigned m_checkpointInterval;
+	unsigned m_expired = 0;
+	CanonicalHash m_canonical;
+	std::unordered_map<h256, unsigned> m_pending;		///< References inserted by journals not yet expired.
+};
+
+}
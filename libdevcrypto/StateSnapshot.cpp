@@ -0,0 +1,153 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateSnapshot.cpp
+ * @date 2015
+ */
+
+#include "StateSnapshot.h"
+using namespace std;
+using namespace dev;
+
+bool StateSnapshot::account(h256 const& _root, Address const& _a, std::string& o_rlp) const
+{
+	ReadGuard l(x_layers);
+	auto it = m_layers.find(_root);
+	unsigned depth = 0;
+	for (Layer const* p = it == m_layers.end() ? nullptr : it->second.get(); p && depth < c_maxDepth; p = p->parent.get(), ++depth)
+	{
+		auto a = p->accounts.find(_a);
+		if (a != p->accounts.end())
+		{
+			++m_hits;
+			o_rlp = a->second;
+			return true;
+		}
+	}
+	++m_misses;
+	return false;
+}
+
+bool StateSnapshot::storage(h256 const& _root, Address const& _a, u256 const& _slot, u256& o_value) const
+{
+	ReadGuard l(x_layers);
+	auto it = m_layers.find(_root);
+	unsigned depth = 0;
+	for (Layer const* p = it == m_layers.end() ? nullptr : it->second.get(); p && depth < c_maxDepth; p = p->parent.get(), ++depth)
+	{
+		auto s = p->storage.find(make_pair(_a, _slot));
+		if (s != p->storage.end() || p->resetStorage.count(_a))
+		{
+			++m_hits;
+			o_value = s != p->storage.end() ? s->second : 0;
+			return true;
+		}
+	}
+	++m_misses;
+	return false;
+}
+
+void StateSnapshot::noteAccount(h256 const& _root, Address const& _a, std::string const& _rlp)
+{
+	WriteGuard l(x_layers);
+	layer(_root).accounts.insert(make_pair(_a, _rlp));
+}
+
+void StateSnapshot::noteStorage(h256 const& _root, Address const& _a, u256 const& _slot, u256 const& _value)
+{
+	WriteGuard l(x_layers);
+	layer(_root).storage.insert(make_pair(make_pair(_a, _slot), _value));
+}
+
+void StateSnapshot::update(h256 const& _parent, h256 const& _root, Changes&& _changes)
+{
+	if (_parent == _root)
+		return;
+
+	WriteGuard l(x_layers);
+	auto parent = m_layers.count(_parent) ? m_layers[_parent] : shared_ptr<Layer>();
+	Layer& top = layer(_root);
+	// What was noted for the root stays true; the changes make the rest follow from the parent.
+	for (auto& i: _changes.accounts)
+		top.accounts[i.first] = move(i.second);
+	for (auto const& i: _changes.storage)
+		top.storage[i.first] = i.second;
+	top.resetStorage.insert(_changes.resetStorage.begin(), _changes.resetStorage.end());
+	if (!top.parent)
+	{
+		// Don't link a state to its own descendant.
+		Layer const* p = parent.get();
+		for (unsigned i = 0; p && p != &top && i <= c_maxDepth; ++i)
+			p = p->parent.get();
+		if (p != &top)
+			top.parent = parent;
+	}
+	fold(top);
+}
+
+void StateSnapshot::clear()
+{
+	WriteGuard l(x_layers);
+	m_layers.clear();
+	m_versions.clear();
+}
+
+StateSnapshot::Layer& StateSnapshot::layer(h256 const& _root)
+{
+	auto& ret = m_layers[_root];
+	if (!ret)
+	{
+		ret = make_shared<Layer>();
+		m_versions.push_back(_root);
+		if (m_versions.size() > c_maxVersions)
+		{
+			// Layers above an evicted one keep it as their parent.
+			m_layers.erase(m_versions.front());
+			m_versions.pop_front();
+		}
+	}
+	return *ret;
+}
+
+void StateSnapshot::fold(Layer& _top)
+{
+	vector<Layer*> chain{&_top};
+	while (chain.back()->parent && chain.size() <= c_maxDepth)
+		chain.push_back(chain.back()->parent.get());
+	if (chain.size() <= c_maxDepth)
+		return;
+
+	// Move the entries of the layer above the bottom one into it and give the result to the former, leaving the
+	// bottom one empty; so the cost is that of the smaller layer. Other layers on the bottom one can only fall back
+	// on the trie from now on.
+	Layer& above = *chain[chain.size() - 2];
+	shared_ptr<Layer> keep = above.parent;
+	Layer& bottom = *keep;
+	for (auto const& a: above.resetStorage)
+		bottom.storage.erase(bottom.storage.lower_bound(make_pair(a, u256(0))), bottom.storage.upper_bound(make_pair(a, ~u256(0))));
+	for (auto& i: above.accounts)
+		bottom.accounts[i.first] = move(i.second);
+	for (auto const& i: above.storage)
+		bottom.storage[i.first] = i.second;
+	bottom.resetStorage.insert(above.resetStorage.begin(), above.resetStorage.end());
+
+	swap(static_cast<Changes&>(above), static_cast<Changes&>(bottom));
+	above.parent = move(bottom.parent);
+	bottom = Layer();
+
+	if (above.accounts.size() + above.storage.size() > c_maxEntries)
+		static_cast<Changes&>(above) = Changes();
+}
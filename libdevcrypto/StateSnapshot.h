@@ -0,0 +1,102 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateSnapshot.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+#include "Common.h"
+
+namespace dev
+{
+
+/**
+ * @brief Flat index of accounts and storage slots, kept next to the state trie and versioned by state root.
+ * Each known root has a layer of the values known at that root, over the layer of the state it was committed from.
+ * Since a root determines its state, entries never go stale; a lookup that finds nothing must read the trie.
+ * @threadsafe
+ */
+class StateSnapshot
+{
+public:
+	/// What a commit changed.
+	struct Changes
+	{
+		std::unordered_map<Address, std::string, Address::hash> accounts;	///< The new RLP of each account; empty if it was deleted.
+		std::map<std::pair<Address, u256>, u256> storage;					///< The new value of each slot.
+		std::unordered_set<Address, Address::hash> resetStorage;			///< Accounts whose other slots are all zero.
+	};
+
+	/// Layers looked through by a single lookup.
+	static const unsigned c_maxDepth = 16;
+	/// Roots remembered.
+	static const unsigned c_maxVersions = 256;
+	/// Entries of the bottom layer, beyond which it is dropped.
+	static const size_t c_maxEntries = 1 << 22;
+
+	StateSnapshot(): m_hits(0), m_misses(0) {}
+
+	/// @returns true if the account @a _a in the state with root @a _root is known, setting o_rlp to it.
+	/// o_rlp is empty if the account does not exist.
+	bool account(h256 const& _root, Address const& _a, std::string& o_rlp) const;
+	/// @returns true if the slot @a _slot of @a _a in the state with root @a _root is known, setting o_value to it.
+	/// The caller must know that the account's storage has not been reset since the state was committed.
+	bool storage(h256 const& _root, Address const& _a, u256 const& _slot, u256& o_value) const;
+
+	/// Records @a _rlp read from the trie for the account @a _a in the state with root @a _root.
+	void noteAccount(h256 const& _root, Address const& _a, std::string const& _rlp);
+	/// Records @a _value read from the trie for a slot.
+	void noteStorage(h256 const& _root, Address const& _a, u256 const& _slot, u256 const& _value);
+
+	/// Records that the state with root @a _root is the one with root @a _parent after @a _changes.
+	void update(h256 const& _parent, h256 const& _root, Changes&& _changes);
+
+	void clear();
+
+	uint64_t hits() const { return m_hits; }
+	uint64_t misses() const { return m_misses; }
+
+private:
+	struct Layer: Changes
+	{
+		std::shared_ptr<Layer> parent;
+	};
+
+	/// @returns the layer of @a _root, creating an empty one if there is none. Requires a write lock on x_layers.
+	Layer& layer(h256 const& _root);
+	/// Merges the bottom layer of the chain ending at _top into the one above it, if the chain is too long.
+	void fold(Layer& _top);
+
+	mutable SharedMutex x_layers;
+	std::unordered_map<h256, std::shared_ptr<Layer>> m_layers;
+	std::deque<h256> m_versions;								///< Roots of m_layers, oldest first.
+	mutable std::atomic<uint64_t> m_hits;
+	mutable std::atomic<uint64_t> m_misses;
+};
+
+}
@@ -20,6 +20,8 @@
  */
 
 #include "TrieCommon.h"
+#include <unordered_map>
+#include "SHA3.h"
 
 namespace dev
 {
@@ -124,4 +126,74 @@ byte uniqueInUse(RLP const& _orig, byte except)
 	return used;
 }
 
+bool verifyTrieProof(h256 const& _root, bytesConstRef _key, std::vector<bytes> const& _proof, std::string& o_value)
+{
+	o_value.clear();
+	std::unordered_map<h256, bytes const*> nodes;
+	for (auto const& n: _proof)
+		nodes[sha3(n)] = &n;
+
+	try
+	{
+		auto r = nodes.find(_root);
+		if (r == nodes.end())
+			return false;
+		RLP here(*r->second);
+		NibbleSlice key(_key);
+		while (!here.isEmpty() && !here.isNull())
+		{
+			if (!here.isList() || (here.itemCount() != 2 && here.itemCount() != 17))
+				return false;
+			RLP next;
+			if (here.itemCount() == 2)
+			{
+				if (here[0].payload().empty())
+					return false;
+				auto k = keyOf(here);
+				if (isLeaf(here))
+				{
+					if (key == k)
+						o_value = here[1].toString();
+					return true;
+				}
+				if (!key.contains(k))
+					return true;
+				next = here[1];
+				key = key.mid(k.size());
+			}
+			else
+			{
+				if (key.empty())
+				{
+					o_value = here[16].toString();
+					return true;
+				}
+				next = here[key[0]];
+				if (next.isEmpty())
+					return true;
+				key = key.mid(1);
+			}
+
+			if (next.isList())
+				here = next;
+			else if (next.isData() && next.size() == 32)
+			{
+				// A node referenced by hash must be in the proof, or nothing is proven.
+				auto n = nodes.find(next.toHash<h256>());
+				if (n == nodes.end())
+					return false;
+				here = RLP(*n->second);
+			}
+			else
+				return false;
+		}
+		// Reached an empty node: the key is absent.
+		return true;
+	}
+	catch (RLPException const&)
+	{
+		return false;
+	}
+}
+
 }
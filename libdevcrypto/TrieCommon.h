@@ -118,4 +118,8 @@ inline std::string hexPrefixEncode(NibbleSlice _s1, NibbleSlice _s2, bool _leaf)
 	return hexPrefixEncode(_s1.data, _s1.offset, _s2.data, _s2.offset, _leaf);
 }
 
+/// Checks @a _proof, as made by GenericTrieDB::prove(), against the trie with root @a _root, without any DB.
+/// @returns true if it proves the value of @a _key, setting o_value to it; o_value is empty if @a _key is proven absent.
+bool verifyTrieProof(h256 const& _root, bytesConstRef _key, std::vector<bytes> const& _proof, std::string& o_value);
+
 }
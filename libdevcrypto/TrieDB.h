@@ -31,6 +31,7 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/Log.h>
 #include <libdevcore/Exceptions.h>
+#include <libdevcore/ThreadPool.h>
 #include <libdevcrypto/SHA3.h>
 #include "MemoryDB.h"
 #include "OverlayDB.h"
@@ -40,6 +41,11 @@ namespace ldb = leveldb;
 namespace dev
 {
 
+/// Called with each entry of a range of a trie.
+using TrieEntryVisitor = std::function<void(bytesConstRef _key, bytesConstRef _value)>;
+/// Called with each key at which two tries differ.
+using TrieKeyVisitor = std::function<void(bytes const& _key)>;
+
 struct TrieDBChannel: public LogChannel  { static const char* name() { return "-T-"; } static const int verbosity = 17; };
 #define tdebug clog(TrieDBChannel)
 
@@ -47,6 +53,13 @@ struct InvalidTrie: virtual dev::Exception {};
 extern const h256 c_shaNull;
 extern const h256 EmptyTrie;
 
+/// @returns the trie node cache of @a _db, if it has one.
+template <class DB> TrieNodeCache* nodeCacheOf(DB const*) { return nullptr; }
+inline TrieNodeCache* nodeCacheOf(OverlayDB const* _db) { return _db->nodeCache(); }
+
+/// The number of changes from which GenericTrieDB::apply() hashes independent subtries in parallel.
+static const unsigned c_parallelTrieHashing = 256;
+
 /**
  * @brief Merkle Patricia Tree "Trie": a modifed base-16 Radix tree.
  * This version uses a database backend.
@@ -93,6 +106,9 @@ public:
 	/// True if the trie is initialised but empty (i.e. that the DB contains the root node which is empty).
 	bool isEmpty() const { return m_root == c_shaNull && node(m_root).size(); }
 
+	/// @returns the root hash without reading the root node.
+	h256 const& rootHash() const { return m_root; }
+
 	h256 root() const { if (!node(m_root).size()) BOOST_THROW_EXCEPTION(BadRoot()); /*std::cout << "Returning root as " << ret << " (really " << m_root << ")" << std::endl;*/ return m_root; }	// patch the root in the case of the empty trie. TODO: handle this properly.
 
 	void debugPrint() {}
@@ -169,9 +185,22 @@ public:
 	void insert(bytesConstRef _key, bytesConstRef _value);
 	void remove(bytes const& _key) { remove(&_key); }
 	void remove(bytesConstRef _key);
+	/// Applies @a _changes at once, removing the keys with an empty value. Each node on the changed paths is
+	/// rebuilt in memory and hashed only once, rather than once per key as with insert() and remove().
+	/// @a _changes may be any container of key-value pairs, each bytes or bytesConstRef, without repeated keys.
+	template <class _Changes> void apply(_Changes const& _changes);
 	bool contains(bytes const& _key) { return contains(&_key); }
 	bool contains(bytesConstRef _key) { return !at(_key).empty(); }
 
+	/// @returns the nodes on the path to @a _key, root first, which prove its value or its absence to
+	/// verifyTrieProof(). Nodes inlined in their parents are not listed.
+	std::vector<bytes> prove(bytesConstRef _key) const;
+
+	/// Calls @a _f with the key of each entry whose value differs in @a _other, including those only one of them has.
+	/// The two are walked together, down only those subtrees whose nodes differ, so the cost goes with the
+	/// difference rather than with the size of either.
+	void diff(GenericTrieDB const& _other, TrieKeyVisitor const& _f) const { bytes path; diffAux(_other, node(m_root), _other.node(_other.m_root), path, _f); }
+
 	class iterator
 	{
 	public:
@@ -220,13 +249,26 @@ public:
 
 	iterator lower_bound(bytesConstRef _key) const { return iterator(this, _key); }
 
+	/// Calls @a _f with the entries whose keys are not before @a _from, in key order, stopping after @a _limit.
+	/// Only the nodes on the path to the current entry are held, so a range of any size can be streamed in chunks.
+	/// @returns the key of the entry after the last visited, to resume from, or empty bytes if there is none.
+	bytes forEach(bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f) const
+	{
+		auto it = _from.empty() ? begin() : lower_bound(_from);
+		for (unsigned n = 0; it != end() && n < _limit; ++it, ++n)
+			_f((*it).first, (*it).second);
+		return it == end() ? bytes() : (*it).first.toBytes();
+	}
+
 protected:
 	DB* db() const { return m_db; }
 
 private:
-	RLPStream& streamNode(RLPStream& _s, bytes const& _b);
+	RLPStream& streamNode(RLPStream& _s, bytesConstRef _b);
 
 	std::string atAux(RLP const& _here, NibbleSlice _key) const;
+	/// Like atAux from the root, but taking nodes from @a _cache.
+	std::string cachedAt(TrieNodeCache& _cache, NibbleSlice _key) const;
 
 	void mergeAtAux(RLPStream& _out, RLP const& _replace, NibbleSlice _key, bytesConstRef _value);
 	bytes mergeAt(RLP const& _replace, NibbleSlice _k, bytesConstRef _v, bool _inLine = false);
@@ -273,14 +315,65 @@ private:
 
 	bool isTwoItemNode(RLP const& _n) const;
 	std::string deref(RLP const& _n) const;
+	/// @returns the node that the item @a _n of a branch or extension refers to; empty if it refers to none.
+	std::string child(RLP const& _n) const { return _n.isEmpty() ? std::string() : deref(_n); }
+
+	/// Reports to @a _f the keys whose values differ between node @a _a of ours and node @a _b of @a _other, both at
+	/// @a io_path, a nibble a byte.
+	void diffAux(GenericTrieDB const& _other, std::string const& _a, std::string const& _b, bytes& io_path, TrieKeyVisitor const& _f) const;
+	/// Adds the entries under node @a _n, at @a io_path, to @a o_entries.
+	void entriesAux(std::string const& _n, bytes& io_path, std::map<bytes, std::string>& o_entries) const;
+
+	/// A node of the trie being changed by apply(). Nodes are loaded only when a change reaches them.
+	struct BatchNode
+	{
+		enum Kind { Unloaded, Leaf, Extension, Branch };
+
+		explicit BatchNode(Kind _kind): kind(_kind) {}
+
+		Kind kind;
+		bool dirty = false;							///< Changed since loaded; it must be rehashed.
+		bytes ref;									///< Our item in the original parent: a hash or an inline node. Empty if new.
+		bytes key;									///< The partial key of a leaf or extension, one nibble per byte.
+		bytes value;								///< The value of a leaf or branch.
+		std::unique_ptr<BatchNode> children[16];	///< The children of a branch; the first is the child of an extension.
+		bytes rlp;									///< Once hashed, the new RLP of a dirty node.
+		h256 hash;									///< Once hashed, the hash of rlp if it is not inlined.
+	};
+	using BatchNodePtr = std::unique_ptr<BatchNode>;
+
+	static BatchNodePtr batchNode(typename BatchNode::Kind _kind, bytesConstRef _key);
+	static BatchNodePtr batchRef(RLP const& _item);
+	void batchLoad(BatchNode& _n) const;
+	void batchKill(BatchNode const& _n);
+	// Replaces the leaf or extension _n with a branch _s nibbles into its key, under an extension if _s > 0.
+	void batchSplit(BatchNodePtr& _n, unsigned _s);
+	void batchInsert(BatchNodePtr& _n, bytesConstRef _k, bytesConstRef _v);
+	void batchRemove(BatchNodePtr& _n, bytesConstRef _k);
+	// Restores the canonical shape of the changed extension or branch _n after a removal.
+	void batchNormalise(BatchNodePtr& _n);
+	// Encodes and hashes the dirty nodes under and including _n, bottom-up, a level at a time so that the nodes of a
+	// level are hashed together. Touches no DB, so disjoint subtries can be hashed concurrently.
+	static void batchHash(BatchNode& _n);
+	// Files the dirty, unencoded nodes under and including _n by height. @returns one more than the height of _n, or
+	// zero if it needs no encoding.
+	static unsigned batchLevels(BatchNode& _n, std::vector<std::vector<BatchNode*>>& o_levels);
+	// Encodes the dirty node _n, whose children are encoded already.
+	static void batchEncode(BatchNode& _n);
+	// Writes the hashed dirty nodes under and including _n to the DB, killing those they replace.
+	void batchWrite(BatchNode const& _n);
 
 	std::string node(h256 _h) const { return m_db->lookup(_h); }
+	TrieNodeCache::NodePtr cachedNode(TrieNodeCache& _cache, h256 const& _h) const { auto n = _cache.find(_h); return n ? n : _cache.insert(_h, node(_h)); }
 	void insertNode(h256 _h, bytesConstRef _v) { m_db->insert(_h, _v); }
 	void killNode(h256 _h) { m_db->kill(_h); }
 
 	h256 insertNode(bytesConstRef _v) { auto h = sha3(_v); insertNode(h, _v); return h; }
 	void killNode(RLP const& _d) { if (_d.data().size() >= 32) killNode(sha3(_d.data())); }
 
+	static bytesConstRef changeRef(bytes const& _b) { return &_b; }
+	static bytesConstRef changeRef(bytesConstRef _b) { return _b; }
+
 	h256 m_root;
 	DB* m_db = nullptr;
 };
@@ -307,9 +400,17 @@ public:
 
 	bool contains(KeyType _k) const { return Generic::contains(bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
 	std::string at(KeyType _k) const { return Generic::at(bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
+	std::vector<bytes> prove(KeyType _k) const { return Generic::prove(bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
 	void insert(KeyType _k, bytesConstRef _value) { Generic::insert(bytesConstRef((byte const*)&_k, sizeof(KeyType)), _value); }
 	void insert(KeyType _k, bytes const& _value) { insert(_k, bytesConstRef(&_value)); }
 	void remove(KeyType _k) { Generic::remove(bytesConstRef((byte const*)&_k, sizeof(KeyType))); }
+	void apply(std::map<KeyType, bytes> const& _changes)
+	{
+		std::map<bytes, bytes> c;
+		for (auto const& i: _changes)
+			c.insert(make_pair(bytesConstRef((byte const*)&i.first, sizeof(KeyType)).toBytes(), i.second));
+		Generic::apply(c);
+	}
 
 	class iterator: public Generic::iterator
 	{
@@ -361,14 +462,31 @@ public:
 	using Super::isEmpty;
 
 	using Super::root;
+	using Super::rootHash;
 
 	using Super::leftOvers;
 	using Super::check;
 
 	std::string at(bytesConstRef _key) const { return Super::at(sha3(_key)); }
+	/// @returns the proof of the value at @a _key, under the trie key sha3(_key).
+	std::vector<bytes> prove(bytesConstRef _key) const { return Super::prove(sha3(_key)); }
 	bool contains(bytesConstRef _key) { return Super::contains(sha3(_key)); }
 	void insert(bytesConstRef _key, bytesConstRef _value) { Super::insert(sha3(_key), _value); }
 	void remove(bytesConstRef _key) { Super::remove(sha3(_key)); }
+	void apply(std::map<bytes, bytes> const& _changes)
+	{
+		std::vector<bytesConstRef> keys;
+		keys.reserve(_changes.size());
+		for (auto const& i: _changes)
+			keys.push_back(&i.first);
+		std::vector<h256> hashes(keys.size());
+		sha3(keys.data(), hashes.data(), keys.size());
+		std::map<h256, bytes> c;
+		auto h = hashes.begin();
+		for (auto const& i: _changes)
+			c.insert(make_pair(*h++, i.second));
+		Super::apply(c);
+	}
 
 	// empty from the PoV of the iterator interface; still need a basic iterator impl though.
 	class iterator
@@ -419,9 +537,14 @@ public:
 	}
 
 	h256 root() const { return m_secure.root(); }
+	h256 const& rootHash() const { return m_secure.rootHash(); }
+
+	/// @returns the proof of the value at @a _key against root(), which is that of the hashed trie.
+	std::vector<bytes> prove(bytesConstRef _key) const { return m_secure.prove(_key); }
 
 	void insert(bytesConstRef _key, bytesConstRef _value) { Super::insert(_key, _value); m_secure.insert(_key, _value); syncRoot(); }
 	void remove(bytesConstRef _key) { Super::remove(_key); m_secure.remove(_key); syncRoot(); }
+	void apply(std::map<bytes, bytes> const& _changes) { Super::apply(_changes); m_secure.apply(_changes); syncRoot(); }
 
 	std::set<h256> leftOvers(std::ostream* = nullptr) const { return std::set<h256>{}; }
 	bool check(bool) const { return m_secure.check(false) && Super::check(false); }
@@ -742,9 +865,188 @@ template <class DB> void GenericTrieDB<DB>::insert(bytesConstRef _key, bytesCons
 
 template <class DB> std::string GenericTrieDB<DB>::at(bytesConstRef _key) const
 {
+	if (TrieNodeCache* c = nodeCacheOf(m_db))
+		return cachedAt(*c, _key);
 	return atAux(RLP(node(m_root)), _key);
 }
 
+template <class DB> std::string GenericTrieDB<DB>::cachedAt(TrieNodeCache& _cache, NibbleSlice _key) const
+{
+	// Same walk as atAux, but iterative so that the node being read stays owned. Inline nodes have no
+	// cache entry and are read through RLP.
+	TrieNodeCache::NodePtr owner = cachedNode(_cache, m_root);
+	TrieNodeCache::Node const* parsed = owner.get();
+	RLP here(owner->data);
+	while (!here.isEmpty() && !here.isNull())
+	{
+		assert(here.isList() && (here.itemCount() == 2 || here.itemCount() == 17));
+		RLP next;
+		if (parsed ? parsed->count == 2 : here.itemCount() == 2)
+		{
+			auto k = keyOf(here);
+			if (_key == k && isLeaf(here))
+				// reached leaf and it's us
+				return here[1].toString();
+			else if (!_key.contains(k) || isLeaf(here))
+				// not us.
+				return std::string();
+			// not yet at leaf and it might yet be us. onwards...
+			next = here[1];
+			_key = _key.mid(k.size());
+		}
+		else
+		{
+			if (_key.size() == 0)
+				return (parsed ? RLP(parsed->items[16]) : here[16]).toString();
+			next = parsed ? RLP(parsed->items[_key[0]]) : here[_key[0]];
+			if (next.isEmpty())
+				return std::string();
+			_key = _key.mid(1);
+		}
+
+		if (next.isList())
+		{
+			here = next;
+			parsed = nullptr;
+		}
+		else
+		{
+			owner = cachedNode(_cache, next.toHash<h256>());
+			parsed = owner.get();
+			here = RLP(owner->data);
+		}
+	}
+	// not found.
+	return std::string();
+}
+
+template <class DB> std::vector<bytes> GenericTrieDB<DB>::prove(bytesConstRef _key) const
+{
+	// Same walk as atAux, keeping each node read by hash.
+	std::vector<bytes> ret;
+	std::string n = node(m_root);
+	ret.push_back(asBytes(n));
+	RLP here(n);
+	NibbleSlice key(_key);
+	while (!here.isEmpty() && !here.isNull())
+	{
+		RLP next;
+		if (here.itemCount() == 2)
+		{
+			auto k = keyOf(here);
+			if (isLeaf(here) || !key.contains(k))
+				break;
+			next = here[1];
+			key = key.mid(k.size());
+		}
+		else
+		{
+			if (key.empty() || here[key[0]].isEmpty())
+				break;
+			next = here[key[0]];
+			key = key.mid(1);
+		}
+
+		if (next.isList())
+			here = next;
+		else
+		{
+			n = node(next.toHash<h256>());
+			ret.push_back(asBytes(n));
+			here = RLP(n);
+		}
+	}
+	return ret;
+}
+
+template <class DB> void GenericTrieDB<DB>::diffAux(GenericTrieDB const& _other, std::string const& _a, std::string const& _b, bytes& io_path, TrieKeyVisitor const& _f) const
+{
+	// Nodes are hashed by content, so identical nodes head identical subtrees.
+	if (_a == _b)
+		return;
+
+	RLP a(_a);
+	RLP b(_b);
+	auto packed = [](bytes const& _nibbles)
+	{
+		bytes ret(_nibbles.size() / 2);
+		for (unsigned i = 0; i < ret.size(); ++i)
+			ret[i] = (_nibbles[i * 2] << 4) | _nibbles[i * 2 + 1];
+		return ret;
+	};
+	if (a.isList() && a.itemCount() == 17 && b.isList() && b.itemCount() == 17)
+	{
+		if (a[16].payload().toString() != b[16].payload().toString())
+			_f(packed(io_path));
+		for (byte i = 0; i < 16; ++i)
+			if (a[i].data().toString() != b[i].data().toString())
+			{
+				io_path.push_back(i);
+				diffAux(_other, child(a[i]), _other.child(b[i]), io_path, _f);
+				io_path.pop_back();
+			}
+		return;
+	}
+	if (a.isList() && a.itemCount() == 2 && b.isList() && b.itemCount() == 2 && !isLeaf(a) && !isLeaf(b) && keyOf(a) == keyOf(b))
+	{
+		auto k = keyOf(a);
+		for (unsigned i = 0; i < k.size(); ++i)
+			io_path.push_back(k[i]);
+		diffAux(_other, child(a[1]), _other.child(b[1]), io_path, _f);
+		io_path.resize(io_path.size() - k.size());
+		return;
+	}
+
+	// Shaped differently here, which is seldom but near the leaves; compare what is under each.
+	std::map<bytes, std::string> as;
+	std::map<bytes, std::string> bs;
+	entriesAux(_a, io_path, as);
+	_other.entriesAux(_b, io_path, bs);
+	auto ai = as.begin();
+	auto bi = bs.begin();
+	while (ai != as.end() || bi != bs.end())
+		if (bi == bs.end() || (ai != as.end() && ai->first < bi->first))
+			_f(packed(ai++->first));
+		else if (ai == as.end() || bi->first < ai->first)
+			_f(packed(bi++->first));
+		else
+		{
+			if (ai->second != bi->second)
+				_f(packed(ai->first));
+			++ai, ++bi;
+		}
+}
+
+template <class DB> void GenericTrieDB<DB>::entriesAux(std::string const& _n, bytes& io_path, std::map<bytes, std::string>& o_entries) const
+{
+	RLP n(_n);
+	if (!n.isList() || n.isEmpty())
+		return;
+	if (n.itemCount() == 2)
+	{
+		auto k = keyOf(n);
+		for (unsigned i = 0; i < k.size(); ++i)
+			io_path.push_back(k[i]);
+		if (isLeaf(n))
+			o_entries[io_path] = n[1].payload().toString();
+		else
+			entriesAux(child(n[1]), io_path, o_entries);
+		io_path.resize(io_path.size() - k.size());
+	}
+	else
+	{
+		if (!n[16].isEmpty())
+			o_entries[io_path] = n[16].payload().toString();
+		for (byte i = 0; i < 16; ++i)
+			if (!n[i].isEmpty())
+			{
+				io_path.push_back(i);
+				entriesAux(child(n[i]), io_path, o_entries);
+				io_path.pop_back();
+			}
+	}
+}
+
 template <class DB> std::string GenericTrieDB<DB>::atAux(RLP const& _here, NibbleSlice _key) const
 {
 	if (_here.isEmpty() || _here.isNull())
@@ -869,7 +1171,7 @@ template <class DB> void GenericTrieDB<DB>::mergeAtAux(RLPStream& _out, RLP cons
 		isRemovable = true;
 	}
 	bytes b = mergeAt(r, _k, _v, !isRemovable);
-	streamNode(_out, b);
+	streamNode(_out, &b);
 }
 
 template <class DB> void GenericTrieDB<DB>::remove(bytesConstRef _key)
@@ -888,6 +1190,400 @@ template <class DB> void GenericTrieDB<DB>::remove(bytesConstRef _key)
 	}
 }
 
+template <class DB> template <class _Changes> void GenericTrieDB<DB>::apply(_Changes const& _changes)
+{
+#if ETH_PARANOIA
+	tdebug << "Apply" << _changes.size();
+#endif
+
+	bool wasEmpty = RLP(node(m_root)).isEmpty();
+	BatchNodePtr root;
+	if (!wasEmpty)
+	{
+		root.reset(new BatchNode(BatchNode::Unloaded));
+		root->ref = rlp(m_root);
+	}
+
+	bytes k;
+	for (auto const& i: _changes)
+	{
+		NibbleSlice key(changeRef(i.first));
+		k.resize(key.size());
+		for (unsigned j = 0; j < k.size(); ++j)
+			k[j] = key[j];
+		if (i.second.empty())
+			batchRemove(root, &k);
+		else
+			batchInsert(root, &k, changeRef(i.second));
+	}
+
+	// As with insert() and remove(), the root is always hashed.
+	if (!root)
+	{
+		if (!wasEmpty)
+			m_root = insertNode(&RLPNull);
+	}
+	else if (root->dirty)
+	{
+		if (_changes.size() >= c_parallelTrieHashing && ThreadPool::get().size())
+		{
+			// Split the changed nodes into enough independent subtries to keep the pool busy.
+			std::vector<BatchNode*> subtries{root.get()};
+			while (subtries.size() < ThreadPool::get().size() * 4)
+			{
+				std::vector<BatchNode*> next;
+				for (BatchNode* n: subtries)
+					for (auto const& c: n->children)
+						if (c && c->dirty)
+							next.push_back(c.get());
+				if (next.empty())
+					break;
+				subtries.swap(next);
+			}
+			ThreadPool::get().forEach(subtries.size(), [&](unsigned i) { batchHash(*subtries[i]); });
+		}
+		batchHash(*root);
+
+		if (wasEmpty)
+			killNode(m_root);
+		batchWrite(*root);
+		m_root = root->rlp.size() < 32 ? insertNode(&root->rlp) : root->hash;
+	}
+}
+
+template <class DB> typename GenericTrieDB<DB>::BatchNodePtr GenericTrieDB<DB>::batchNode(typename BatchNode::Kind _kind, bytesConstRef _key)
+{
+	BatchNodePtr ret(new BatchNode(_kind));
+	ret->dirty = true;
+	ret->key = _key.toBytes();
+	return ret;
+}
+
+template <class DB> typename GenericTrieDB<DB>::BatchNodePtr GenericTrieDB<DB>::batchRef(RLP const& _item)
+{
+	if (_item.isEmpty())
+		return BatchNodePtr();
+	BatchNodePtr ret(new BatchNode(BatchNode::Unloaded));
+	ret->ref = _item.data().toBytes();
+	return ret;
+}
+
+template <class DB> void GenericTrieDB<DB>::batchLoad(BatchNode& _n) const
+{
+	if (_n.kind != BatchNode::Unloaded)
+		return;
+
+	RLP r(_n.ref);
+	std::string s;
+	if (r.isData())
+	{
+		s = node(r.toHash<h256>());
+		r = RLP(s);
+	}
+	assert(r.isList() && (r.itemCount() == 2 || r.itemCount() == 17));
+	if (r.itemCount() == 2)
+	{
+		NibbleSlice k = keyOf(r);
+		for (unsigned i = 0; i < k.size(); ++i)
+			_n.key.push_back(k[i]);
+		if (isLeaf(r))
+		{
+			_n.kind = BatchNode::Leaf;
+			_n.value = r[1].toBytes();
+		}
+		else
+		{
+			_n.kind = BatchNode::Extension;
+			_n.children[0] = batchRef(r[1]);
+		}
+	}
+	else
+	{
+		_n.kind = BatchNode::Branch;
+		for (unsigned i = 0; i < 16; ++i)
+			_n.children[i] = batchRef(r[i]);
+		_n.value = r[16].toBytes();
+	}
+}
+
+template <class DB> void GenericTrieDB<DB>::batchKill(BatchNode const& _n)
+{
+	// Inline nodes are not in the DB.
+	if (_n.ref.size() && RLP(_n.ref).isData())
+		killNode(RLP(_n.ref).toHash<h256>());
+}
+
+template <class DB> void GenericTrieDB<DB>::batchSplit(BatchNodePtr& _n, unsigned _s)
+{
+	BatchNode& old = *_n;
+	assert((old.kind == BatchNode::Leaf && _s <= old.key.size()) || (old.kind == BatchNode::Extension && _s < old.key.size()));
+	BatchNodePtr b = batchNode(BatchNode::Branch, bytesConstRef());
+	if (_s == old.key.size())
+		b->value = old.value;
+	else if (old.kind == BatchNode::Extension && _s + 1 == old.key.size())
+		b->children[old.key[_s]] = std::move(old.children[0]);
+	else
+	{
+		BatchNodePtr rest = batchNode(old.kind, bytesConstRef(&old.key).cropped(_s + 1));
+		rest->value = old.value;
+		rest->children[0] = std::move(old.children[0]);
+		b->children[old.key[_s]] = std::move(rest);
+	}
+	batchKill(old);
+
+	if (_s)
+	{
+		BatchNodePtr e = batchNode(BatchNode::Extension, bytesConstRef(&old.key).cropped(0, _s));
+		e->children[0] = std::move(b);
+		_n = std::move(e);
+	}
+	else
+		_n = std::move(b);
+}
+
+template <class DB> void GenericTrieDB<DB>::batchInsert(BatchNodePtr& _n, bytesConstRef _k, bytesConstRef _v)
+{
+	if (!_n)
+	{
+		_n = batchNode(BatchNode::Leaf, _k);
+		_n->value = _v.toBytes();
+		return;
+	}
+
+	batchLoad(*_n);
+	BatchNode& n = *_n;
+	if (n.kind == BatchNode::Branch)
+	{
+		if (_k.empty())
+		{
+			if (!_v.contentsEqual(n.value))
+			{
+				n.value = _v.toBytes();
+				n.dirty = true;
+			}
+		}
+		else
+		{
+			auto& c = n.children[_k[0]];
+			batchInsert(c, _k.cropped(1), _v);
+			n.dirty |= c->dirty;
+		}
+		return;
+	}
+
+	unsigned s = 0;
+	for (; s < n.key.size() && s < _k.size() && n.key[s] == _k[s]; ++s) {}
+	if (n.kind == BatchNode::Leaf && s == n.key.size() && s == _k.size())
+	{
+		if (!_v.contentsEqual(n.value))
+		{
+			n.value = _v.toBytes();
+			n.dirty = true;
+		}
+	}
+	else if (n.kind == BatchNode::Extension && s == n.key.size())
+	{
+		auto& c = n.children[0];
+		batchInsert(c, _k.cropped(s), _v);
+		n.dirty |= c->dirty;
+	}
+	else
+	{
+		batchSplit(_n, s);
+		batchInsert(_n, _k, _v);
+	}
+}
+
+template <class DB> void GenericTrieDB<DB>::batchRemove(BatchNodePtr& _n, bytesConstRef _k)
+{
+	if (!_n)
+		return;
+
+	batchLoad(*_n);
+	BatchNode& n = *_n;
+	if (n.kind == BatchNode::Leaf)
+	{
+		if (_k.contentsEqual(n.key))
+		{
+			batchKill(n);
+			_n.reset();
+		}
+		return;
+	}
+
+	if (n.kind == BatchNode::Extension)
+	{
+		if (!_k.cropped(0, n.key.size()).contentsEqual(n.key))
+			// not found - no change.
+			return;
+		auto& c = n.children[0];
+		batchRemove(c, _k.cropped(n.key.size()));
+		if (c && !c->dirty)
+			return;
+	}
+	else if (_k.empty())
+	{
+		if (n.value.empty())
+			return;
+		n.value.clear();
+	}
+	else
+	{
+		auto& c = n.children[_k[0]];
+		if (!c)
+			return;
+		batchRemove(c, _k.cropped(1));
+		if (c && !c->dirty)
+			return;
+	}
+	n.dirty = true;
+	batchNormalise(_n);
+}
+
+template <class DB> void GenericTrieDB<DB>::batchNormalise(BatchNodePtr& _n)
+{
+	BatchNode& n = *_n;
+	if (n.kind == BatchNode::Extension)
+	{
+		auto& c = n.children[0];
+		if (!c)
+		{
+			batchKill(n);
+			_n.reset();
+			return;
+		}
+		batchLoad(*c);
+		if (c->kind == BatchNode::Branch)
+			return;
+
+		// graft: the child takes our key as a prefix of its own.
+		c->key.insert(c->key.begin(), n.key.begin(), n.key.end());
+		c->dirty = true;
+		BatchNodePtr grafted = std::move(c);
+		batchKill(n);
+		_n = std::move(grafted);
+		return;
+	}
+
+	assert(n.kind == BatchNode::Branch);
+	unsigned count = 0;
+	byte used = 0;
+	for (byte i = 0; i < 16; ++i)
+		if (n.children[i])
+		{
+			++count;
+			used = i;
+		}
+	if (count + (n.value.empty() ? 0 : 1) > 1)
+		return;
+
+	// A single item left - merge it into its parent.
+	batchKill(n);
+	if (count)
+	{
+		BatchNodePtr e = batchNode(BatchNode::Extension, bytesConstRef(&used, 1));
+		e->children[0] = std::move(n.children[used]);
+		_n = std::move(e);
+		batchNormalise(_n);
+	}
+	else if (n.value.size())
+	{
+		BatchNodePtr l = batchNode(BatchNode::Leaf, bytesConstRef());
+		l->value = std::move(n.value);
+		_n = std::move(l);
+	}
+	else
+		_n.reset();
+}
+
+template <class DB> void GenericTrieDB<DB>::batchHash(BatchNode& _n)
+{
+	std::vector<std::vector<BatchNode*>> levels;
+	batchLevels(_n, levels);
+	std::vector<bytesConstRef> rlps;
+	std::vector<h256> hashes;
+	for (auto const& level: levels)
+	{
+		rlps.clear();
+		for (BatchNode* n: level)
+		{
+			batchEncode(*n);
+			if (n->rlp.size() >= 32)
+				rlps.push_back(&n->rlp);
+		}
+		hashes.resize(rlps.size());
+		sha3(rlps.data(), hashes.data(), rlps.size());
+		auto h = hashes.begin();
+		for (BatchNode* n: level)
+			if (n->rlp.size() >= 32)
+				n->hash = *h++;
+	}
+}
+
+template <class DB> unsigned GenericTrieDB<DB>::batchLevels(BatchNode& _n, std::vector<std::vector<BatchNode*>>& o_levels)
+{
+	if (!_n.dirty || _n.rlp.size())
+		return 0;
+
+	unsigned level = 0;
+	unsigned items = _n.kind == BatchNode::Branch ? 16 : _n.kind == BatchNode::Extension ? 1 : 0;
+	for (unsigned i = 0; i < items; ++i)
+		if (_n.children[i])
+			level = std::max(level, batchLevels(*_n.children[i], o_levels));
+	if (o_levels.size() <= level)
+		o_levels.resize(level + 1);
+	o_levels[level].push_back(&_n);
+	return level + 1;
+}
+
+template <class DB> void GenericTrieDB<DB>::batchEncode(BatchNode& _n)
+{
+	auto streamChild = [](RLPStream& _s, BatchNodePtr const& _c)
+	{
+		if (!_c)
+			_s << "";
+		else if (!_c->dirty)
+			_s.appendRaw(_c->ref);
+		else if (_c->rlp.size() < 32)
+			_s.appendRaw(_c->rlp);
+		else
+			_s << _c->hash;
+	};
+
+	std::string key = _n.kind == BatchNode::Branch ? std::string() : hexPrefixEncode(_n.key, _n.kind == BatchNode::Leaf);
+	_n.rlp = rlpExact([&](RLPStream& _s)
+	{
+		if (_n.kind == BatchNode::Leaf)
+			_s.appendList(2) << key << _n.value;
+		else if (_n.kind == BatchNode::Extension)
+		{
+			_s.appendList(2) << key;
+			streamChild(_s, _n.children[0]);
+		}
+		else
+		{
+			_s.appendList(17);
+			for (unsigned i = 0; i < 16; ++i)
+				streamChild(_s, _n.children[i]);
+			_s << _n.value;
+		}
+	});
+}
+
+template <class DB> void GenericTrieDB<DB>::batchWrite(BatchNode const& _n)
+{
+	if (!_n.dirty)
+		return;
+	assert(_n.rlp.size());
+
+	batchKill(_n);
+	for (auto const& c: _n.children)
+		if (c)
+			batchWrite(*c);
+	if (_n.rlp.size() >= 32)
+		insertNode(_n.hash, &_n.rlp);
+}
+
 template <class DB> bool GenericTrieDB<DB>::isTwoItemNode(RLP const& _n) const
 {
 	return (_n.isData() && RLP(node(_n.toHash<h256>())).itemCount() == 2)
@@ -934,7 +1630,7 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 			if (!deleteAtAux(s, _orig[1], _k.mid(k.size())))
 				return bytes();
 			killNode(_orig);
-			RLP r(s.out());
+			RLP r(s.outRef());
 			if (isTwoItemNode(r[1]))
 				return graft(r);
 			return s.out();
@@ -988,7 +1684,7 @@ template <class DB> bytes GenericTrieDB<DB>::deleteAt(RLP const& _orig, NibbleSl
 			killNode(_orig);
 
 			// check if we ended up leaving the node invalid.
-			RLP rlp(r.out());
+			RLP rlp(r.outRef());
 			byte used = uniqueInUse(rlp, 255);
 			if (used == 255)	// no - all ok.
 				return r.out();
@@ -1022,7 +1718,7 @@ template <class DB> bool GenericTrieDB<DB>::deleteAtAux(RLPStream& _out, RLP con
 	else
 		killNode(_orig.toHash<h256>());*/
 
-	streamNode(_out, b);
+	streamNode(_out, &b);
 	return true;
 }
 
@@ -1069,12 +1765,12 @@ template <class DB> bytes GenericTrieDB<DB>::remove(RLP const& _orig)
 	return r.out();
 }
 
-template <class DB> RLPStream& GenericTrieDB<DB>::streamNode(RLPStream& _s, bytes const& _b)
+template <class DB> RLPStream& GenericTrieDB<DB>::streamNode(RLPStream& _s, bytesConstRef _b)
 {
 	if (_b.size() < 32)
 		_s.appendRaw(_b);
 	else
-		_s.append(insertNode(&_b));
+		_s.append(insertNode(_b));
 	return _s;
 }
 
@@ -1094,7 +1790,7 @@ template <class DB> bytes GenericTrieDB<DB>::cleve(RLP const& _orig, unsigned _s
 
 	RLPStream top(2);
 	top << hexPrefixEncode(k, false, 0, /*ugh*/(int)_s);
-	streamNode(top, bottom.out());
+	streamNode(top, bottom.outRef());
 
 	return top.out();
 }
@@ -1172,7 +1868,7 @@ template <class DB> bytes GenericTrieDB<DB>::branch(RLP const& _orig)
 				{
 					RLPStream bottom(2);
 					bottom << hexPrefixEncode(k.mid(1), isLeaf(_orig)) << _orig[1];
-					streamNode(r, bottom.out());
+					streamNode(r, bottom.outRef());
 				}
 				else
 					r << _orig[1];
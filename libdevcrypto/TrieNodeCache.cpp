@@ -0,0 +1,111 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file TrieNodeCache.cpp
+ * @date 2015
+ */
+
+#include "TrieNodeCache.h"
+#include <libdevcore/RLP.h>
+using namespace std;
+using namespace dev;
+
+namespace
+{
+	/// Rough per-entry cost of the list node, index entry and Node object.
+	size_t const c_entryOverhead = 200;
+
+	size_t cost(TrieNodeCache::Node const& _n) { return _n.data.size() + c_entryOverhead; }
+}
+
+TrieNodeCache::Node::Node(std::string _data):
+	data(move(_data))
+{
+	RLP r(data);
+	if (r.isList())
+	{
+		count = r.itemCount();
+		unsigned i = 0;
+		for (auto const& item: r)
+			if (i < items.size())
+				items[i++] = item.data();
+	}
+}
+
+TrieNodeCache::TrieNodeCache(size_t _capacity):
+	m_shardCapacity(_capacity / c_shards),
+	m_hits(0),
+	m_misses(0)
+{}
+
+TrieNodeCache::NodePtr TrieNodeCache::find(h256 const& _h)
+{
+	Shard& s = shard(_h);
+	Guard l(s.x_shard);
+	auto it = s.index.find(_h);
+	if (it == s.index.end())
+	{
+		++m_misses;
+		return NodePtr();
+	}
+	++m_hits;
+	s.entries.splice(s.entries.begin(), s.entries, it->second);
+	return it->second->second;
+}
+
+TrieNodeCache::NodePtr TrieNodeCache::insert(h256 const& _h, std::string _data)
+{
+	auto n = make_shared<Node const>(move(_data));
+	if (n->data.empty())
+		return n;
+
+	Shard& s = shard(_h);
+	Guard l(s.x_shard);
+	if (s.index.count(_h))
+		return n;
+	s.entries.emplace_front(_h, n);
+	s.index[_h] = s.entries.begin();
+	s.size += cost(*n);
+	while (s.size > m_shardCapacity && s.entries.size() > 1)
+	{
+		s.size -= cost(*s.entries.back().second);
+		s.index.erase(s.entries.back().first);
+		s.entries.pop_back();
+	}
+	return n;
+}
+
+void TrieNodeCache::clear()
+{
+	for (auto& s: m_shards)
+	{
+		Guard l(s.x_shard);
+		s.entries.clear();
+		s.index.clear();
+		s.size = 0;
+	}
+}
+
+size_t TrieNodeCache::size() const
+{
+	size_t ret = 0;
+	for (auto const& s: m_shards)
+	{
+		Guard l(s.x_shard);
+		ret += s.size;
+	}
+	return ret;
+}
@@ -0,0 +1,96 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file TrieNodeCache.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+
+/**
+ * @brief Size-bounded LRU cache of parsed trie nodes, keyed by hash.
+ * Nodes are content-addressed, so entries never go stale and one cache can serve every trie over a database.
+ * @threadsafe
+ */
+class TrieNodeCache
+{
+public:
+	/// A trie node with the positions of its items found once.
+	struct Node
+	{
+		explicit Node(std::string _data);
+		Node(Node const&) = delete;
+		Node& operator=(Node const&) = delete;
+
+		std::string data;						///< The node's RLP.
+		unsigned count = 0;						///< Number of items; 0 if not a list.
+		std::array<bytesConstRef, 17> items;	///< The RLP of each item, pointing into data.
+	};
+	using NodePtr = std::shared_ptr<Node const>;
+
+	static const size_t c_defaultCapacity = 32 * 1024 * 1024;
+
+	/// @param _capacity Approximate bound on the memory used, in bytes.
+	explicit TrieNodeCache(size_t _capacity = c_defaultCapacity);
+
+	/// @returns the node with hash @a _h, or null if it is not cached.
+	NodePtr find(h256 const& _h);
+
+	/// Caches @a _data as the node with hash @a _h. Empty data (a node not found) is not cached.
+	/// @returns the parsed node.
+	NodePtr insert(h256 const& _h, std::string _data);
+
+	void clear();
+
+	uint64_t hits() const { return m_hits; }
+	uint64_t misses() const { return m_misses; }
+	/// @returns the approximate memory used, in bytes.
+	size_t size() const;
+
+private:
+	static const unsigned c_shards = 16;
+
+	struct Shard
+	{
+		using Entries = std::list<std::pair<h256, NodePtr>>;
+		mutable Mutex x_shard;
+		Entries entries;											///< Most recently used first.
+		std::unordered_map<h256, Entries::iterator> index;
+		size_t size = 0;
+	};
+
+	Shard& shard(h256 const& _h) { return m_shards[_h[0] % c_shards]; }
+
+	std::array<Shard, c_shards> m_shards;
+	size_t m_shardCapacity;
+	std::atomic<uint64_t> m_hits;
+	std::atomic<uint64_t> m_misses;
+};
+
+}
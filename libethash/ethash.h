@@ -72,7 +72,18 @@ void ethash_get_seedhash(uint8_t seedhash[32], const uint32_t block_number);
 void ethash_mkcache(void *cache, ethash_params const *params, const uint8_t seed[32]);
 void ethash_light(ethash_return_value *ret, void const *cache, ethash_params const *params, const uint8_t header_hash[32], const uint64_t nonce);
 void ethash_compute_full_data(void *mem, ethash_params const *params, void const *cache);
+/// Computes only the nodes [begin, end) of the full data into their places in @a mem; ranges that do not overlap may be computed at once.
+void ethash_compute_full_data_range(void *mem, ethash_params const *params, void const *cache, uint64_t begin, uint64_t end);
 void ethash_full(ethash_return_value *ret, void const *full_mem, ethash_params const *params, const uint8_t header_hash[32], const uint64_t nonce);
+/// Evaluates the @a count nonces from @a start_nonce into @a ret[0] to @a ret[count - 1], several at a time so that
+/// their reads of the full data overlap. Built with AVX-512 enabled, the mixing uses it; AVX2 is used where the CPU
+/// has it, whatever the build.
+void ethash_full_batch(ethash_return_value *ret, void const *full_mem, ethash_params const *params, const uint8_t header_hash[32], const uint64_t start_nonce, const unsigned count);
+
+/// @returns the instruction set the computation of DAG items uses on this CPU.
+char const* ethash_dag_item_kernel(void);
+/// @returns the instruction set the mixing of pages into the mix uses on this CPU.
+char const* ethash_mix_kernel(void);
 
 /***********************************
  * NEW API *************************
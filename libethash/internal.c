@@ -47,6 +47,18 @@ uint64_t ethash_get_cachesize(const uint32_t block_number) {
     return cache_sizes[block_number / ETHASH_EPOCH_LENGTH];
 }
 
+#if ETHASH_CPU_DISPATCH
+static inline int ethash_cpu_has_sse41(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+
+static inline int ethash_cpu_has_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
 // Follows Sergio's "STRICT MEMORY HARD HASHING FUNCTIONS" (2014)
 // https://bitslog.files.wordpress.com/2013/12/memohash-v0-3.pdf
 // SeqMemoHash(s, R, N)
@@ -92,6 +104,53 @@ void ethash_mkcache(
     ethash_compute_cache_nodes(nodes, params, seed);
 }
 
+// mixes the ETHASH_DATASET_PARENTS parents of the DAG item into ret
+static void ethash_mix_parents(
+        node *const ret,
+        const unsigned node_index,
+        node const *cache_nodes,
+        uint32_t num_parent_nodes) {
+
+    for (unsigned i = 0; i != ETHASH_DATASET_PARENTS; ++i) {
+        uint32_t parent_index = ((node_index ^ i) * FNV_PRIME ^ ret->words[i % NODE_WORDS]) % num_parent_nodes;
+        node const *parent = &cache_nodes[parent_index];
+        for (unsigned w = 0; w != NODE_WORDS; ++w) {
+            ret->words[w] = fnv_hash(ret->words[w], parent->words[w]);
+        }
+    }
+}
+
+#if ETHASH_CPU_DISPATCH
+__attribute__((target("sse4.1")))
+static void ethash_mix_parents_sse41(
+        node *const ret,
+        const unsigned node_index,
+        node const *cache_nodes,
+        uint32_t num_parent_nodes) {
+
+    __m128i const fnv_prime = _mm_set1_epi32(FNV_PRIME);
+    for (unsigned i = 0; i != ETHASH_DATASET_PARENTS; ++i) {
+        uint32_t parent_index = ((node_index ^ i) * FNV_PRIME ^ ret->words[i % NODE_WORDS]) % num_parent_nodes;
+        node const *parent = &cache_nodes[parent_index];
+        // have to write to ret as values are used to compute index
+        for (unsigned w = 0; w != NODE_WORDS; w += 4) {
+            __m128i m = _mm_loadu_si128((__m128i const *) &ret->words[w]);
+            __m128i p = _mm_loadu_si128((__m128i const *) &parent->words[w]);
+            _mm_storeu_si128((__m128i *) &ret->words[w], _mm_xor_si128(_mm_mullo_epi32(m, fnv_prime), p));
+        }
+    }
+}
+#endif
+
+char const* ethash_dag_item_kernel(void) {
+#if ETHASH_CPU_DISPATCH
+    if (ethash_cpu_has_sse41()) {
+        return "sse4.1";
+    }
+#endif
+    return "portable";
+}
+
 void ethash_calculate_dag_item(
         node *const ret,
         const unsigned node_index,
@@ -106,43 +165,12 @@ void ethash_calculate_dag_item(
     ret->words[0] ^= node_index;
     SHA3_512(ret->bytes, ret->bytes, sizeof(node));
 
-#if defined(_M_X64) && ENABLE_SSE
-    __m128i const fnv_prime = _mm_set1_epi32(FNV_PRIME);
-    __m128i xmm0 = ret->xmm[0];
-    __m128i xmm1 = ret->xmm[1];
-    __m128i xmm2 = ret->xmm[2];
-    __m128i xmm3 = ret->xmm[3];
+#if ETHASH_CPU_DISPATCH
+    if (ethash_cpu_has_sse41()) {
+        ethash_mix_parents_sse41(ret, node_index, cache_nodes, num_parent_nodes);
+    } else
 #endif
-
-    for (unsigned i = 0; i != ETHASH_DATASET_PARENTS; ++i) {
-        uint32_t parent_index = ((node_index ^ i) * FNV_PRIME ^ ret->words[i % NODE_WORDS]) % num_parent_nodes;
-        node const *parent = &cache_nodes[parent_index];
-
-#if defined(_M_X64) && ENABLE_SSE
-        {
-            xmm0 = _mm_mullo_epi32(xmm0, fnv_prime);
-            xmm1 = _mm_mullo_epi32(xmm1, fnv_prime);
-            xmm2 = _mm_mullo_epi32(xmm2, fnv_prime);
-            xmm3 = _mm_mullo_epi32(xmm3, fnv_prime);
-            xmm0 = _mm_xor_si128(xmm0, parent->xmm[0]);
-            xmm1 = _mm_xor_si128(xmm1, parent->xmm[1]);
-            xmm2 = _mm_xor_si128(xmm2, parent->xmm[2]);
-            xmm3 = _mm_xor_si128(xmm3, parent->xmm[3]);
-
-            // have to write to ret as values are used to compute index
-            ret->xmm[0] = xmm0;
-            ret->xmm[1] = xmm1;
-            ret->xmm[2] = xmm2;
-            ret->xmm[3] = xmm3;
-        }
-        #else
-        {
-            for (unsigned w = 0; w != NODE_WORDS; ++w) {
-                ret->words[w] = fnv_hash(ret->words[w], parent->words[w]);
-            }
-        }
-#endif
-    }
+    ethash_mix_parents(ret, node_index, cache_nodes, num_parent_nodes);
 
     SHA3_512(ret->bytes, ret->bytes, sizeof(node));
 }
@@ -153,27 +181,32 @@ void ethash_compute_full_data(
 		void const *cache) {
     assert((params->full_size % (sizeof(uint32_t) * MIX_WORDS)) == 0);
     assert((params->full_size % sizeof(node)) == 0);
+    ethash_compute_full_data_range(mem, params, cache, 0, params->full_size / sizeof(node));
+}
+
+void ethash_compute_full_data_range(
+        void *mem,
+        ethash_params const *params,
+		void const *cache,
+        uint64_t begin,
+        uint64_t end) {
+    assert(end <= params->full_size / sizeof(node));
     node *full_nodes = mem;
 
     // now compute full nodes
-    for (unsigned n = 0; n != (params->full_size / sizeof(node)); ++n) {
-        ethash_calculate_dag_item(&(full_nodes[n]), n, params, cache);
+    for (uint64_t n = begin; n < end; ++n) {
+        ethash_calculate_dag_item(&(full_nodes[n]), (unsigned) n, params, cache);
     }
 }
 
-static void ethash_hash(
-        ethash_return_value *ret,
-        node const *full_nodes,
-		void const *cache,
-        ethash_params const *params,
+// pack hash and nonce together into the first 40 bytes of s_mix, hash them, and replicate the result across the mix
+static void ethash_hash_init(
+        node s_mix[MIX_NODES + 1],
         const uint8_t header_hash[32],
         const uint64_t nonce) {
 
-    assert((params->full_size % MIX_WORDS) == 0);
-
     // pack hash and nonce together into first 40 bytes of s_mix
     assert(sizeof(node) * 8 == 512);
-    node s_mix[MIX_NODES + 1];
     memcpy(s_mix[0].bytes, header_hash, 32);
 
 #if BYTE_ORDER != LITTLE_ENDIAN
@@ -195,46 +228,72 @@ static void ethash_hash(
     for (unsigned w = 0; w != MIX_WORDS; ++w) {
         mix->words[w] = s_mix[0].words[w % NODE_WORDS];
     }
+}
 
-    unsigned const
-            page_size = sizeof(uint32_t) * MIX_WORDS,
-            num_full_pages = (unsigned) (params->full_size / page_size);
-
-
-    for (unsigned i = 0; i != ETHASH_ACCESSES; ++i) {
-        uint32_t const index = ((s_mix->words[0] ^ i) * FNV_PRIME ^ mix->words[i % MIX_WORDS]) % num_full_pages;
-
-        for (unsigned n = 0; n != MIX_NODES; ++n) {
-            const node *dag_node = &full_nodes[MIX_NODES * index + n];
+#if ETHASH_CPU_DISPATCH
+__attribute__((target("avx2")))
+static inline void ethash_mix_page_avx2(
+        node *restrict mix,
+        node const *restrict page) {
+
+    __m256i const fnv_prime = _mm256_set1_epi32(FNV_PRIME);
+    for (unsigned n = 0; n != MIX_NODES; ++n) {
+        for (unsigned w = 0; w != NODE_WORDS; w += 8) {
+            __m256i m = _mm256_loadu_si256((__m256i const *) &mix[n].words[w]);
+            __m256i d = _mm256_loadu_si256((__m256i const *) &page[n].words[w]);
+            _mm256_storeu_si256((__m256i *) &mix[n].words[w], _mm256_xor_si256(_mm256_mullo_epi32(m, fnv_prime), d));
+        }
+    }
+}
+#endif
 
-            if (!full_nodes) {
-                node tmp_node;
-                ethash_calculate_dag_item(&tmp_node, index * MIX_NODES + n, params, cache);
-                dag_node = &tmp_node;
-            }
+char const* ethash_mix_kernel(void) {
+#if defined(__AVX512F__)
+    return "avx512f";
+#elif ETHASH_CPU_DISPATCH
+    if (ethash_cpu_has_avx2()) {
+        return "avx2";
+    }
+#endif
+    return "portable";
+}
 
-#if defined(_M_X64) && ENABLE_SSE
-            {
-                __m128i fnv_prime = _mm_set1_epi32(FNV_PRIME);
-                __m128i xmm0 = _mm_mullo_epi32(fnv_prime, mix[n].xmm[0]);
-                __m128i xmm1 = _mm_mullo_epi32(fnv_prime, mix[n].xmm[1]);
-                __m128i xmm2 = _mm_mullo_epi32(fnv_prime, mix[n].xmm[2]);
-                __m128i xmm3 = _mm_mullo_epi32(fnv_prime, mix[n].xmm[3]);
-                mix[n].xmm[0] = _mm_xor_si128(xmm0, dag_node->xmm[0]);
-                mix[n].xmm[1] = _mm_xor_si128(xmm1, dag_node->xmm[1]);
-                mix[n].xmm[2] = _mm_xor_si128(xmm2, dag_node->xmm[2]);
-                mix[n].xmm[3] = _mm_xor_si128(xmm3, dag_node->xmm[3]);
-            }
-            #else
-            {
-                for (unsigned w = 0; w != NODE_WORDS; ++w) {
-                    mix[n].words[w] = fnv_hash(mix[n].words[w], dag_node->words[w]);
-                }
-            }
+// mixes the MIX_NODES nodes of page into mix, word by word
+static inline void ethash_mix_page(
+        node *restrict mix,
+        node const *restrict page) {
+
+#if defined(__AVX512F__)
+    __m512i const fnv_prime = _mm512_set1_epi32(FNV_PRIME);
+    for (unsigned n = 0; n != MIX_NODES; ++n) {
+        __m512i m = _mm512_loadu_si512((void const *) mix[n].words);
+        __m512i d = _mm512_loadu_si512((void const *) page[n].words);
+        _mm512_storeu_si512((void *) mix[n].words, _mm512_xor_si512(_mm512_mullo_epi32(m, fnv_prime), d));
+    }
+#else
+#if defined(__AVX2__)
+    ethash_mix_page_avx2(mix, page);
+    return;
+#elif ETHASH_CPU_DISPATCH
+    if (ethash_cpu_has_avx2()) {
+        ethash_mix_page_avx2(mix, page);
+        return;
+    }
 #endif
+    for (unsigned n = 0; n != MIX_NODES; ++n) {
+        for (unsigned w = 0; w != NODE_WORDS; ++w) {
+            mix[n].words[w] = fnv_hash(mix[n].words[w], page[n].words[w]);
         }
-
     }
+#endif
+}
+
+// compresses the mix and makes the final hash of it
+static void ethash_hash_final(
+        ethash_return_value *ret,
+        node s_mix[MIX_NODES + 1]) {
+
+    node *const mix = s_mix + 1;
 
     // compress mix
     for (unsigned w = 0; w != MIX_WORDS; w += 4) {
@@ -256,6 +315,86 @@ static void ethash_hash(
     SHA3_256(ret->result, s_mix->bytes, 64 + 32); // Keccak-256(s + compressed_mix)
 }
 
+static void ethash_hash(
+        ethash_return_value *ret,
+        node const *full_nodes,
+		void const *cache,
+        ethash_params const *params,
+        const uint8_t header_hash[32],
+        const uint64_t nonce) {
+
+    assert((params->full_size % MIX_WORDS) == 0);
+
+    node s_mix[MIX_NODES + 1];
+    ethash_hash_init(s_mix, header_hash, nonce);
+    node *const mix = s_mix + 1;
+
+    unsigned const
+            page_size = sizeof(uint32_t) * MIX_WORDS,
+            num_full_pages = (unsigned) (params->full_size / page_size);
+
+    for (unsigned i = 0; i != ETHASH_ACCESSES; ++i) {
+        uint32_t const index = ((s_mix->words[0] ^ i) * FNV_PRIME ^ mix->words[i % MIX_WORDS]) % num_full_pages;
+
+        if (full_nodes) {
+            ethash_mix_page(mix, &full_nodes[MIX_NODES * index]);
+        } else {
+            node page[MIX_NODES];
+            for (unsigned n = 0; n != MIX_NODES; ++n) {
+                ethash_calculate_dag_item(&page[n], index * MIX_NODES + n, params, cache);
+            }
+            ethash_mix_page(mix, page);
+        }
+    }
+
+    ethash_hash_final(ret, s_mix);
+}
+
+void ethash_full_batch(
+        ethash_return_value *ret,
+        void const *full_mem,
+        ethash_params const *params,
+        const uint8_t header_hash[32],
+        const uint64_t start_nonce,
+        const unsigned count) {
+
+    assert((params->full_size % MIX_WORDS) == 0);
+    node const *full_nodes = (node const *) full_mem;
+    unsigned const
+            page_size = sizeof(uint32_t) * MIX_WORDS,
+            num_full_pages = (unsigned) (params->full_size / page_size);
+
+    for (unsigned b = 0; b < count; b += ETHASH_BATCH_LANES) {
+        unsigned const lanes = count - b < ETHASH_BATCH_LANES ? count - b : ETHASH_BATCH_LANES;
+        node s_mix[ETHASH_BATCH_LANES][MIX_NODES + 1];
+        node const *page[ETHASH_BATCH_LANES];
+
+        for (unsigned l = 0; l != lanes; ++l) {
+            ethash_hash_init(s_mix[l], header_hash, start_nonce + b + l);
+        }
+
+        for (unsigned i = 0; i != ETHASH_ACCESSES; ++i) {
+            // each lane's next page depends on its own mix only, so all lanes' pages are found and fetched
+            // before any is mixed, overlapping their reads from the full data
+            for (unsigned l = 0; l != lanes; ++l) {
+                node const *mix = s_mix[l] + 1;
+                uint32_t const index = ((s_mix[l][0].words[0] ^ i) * FNV_PRIME ^ mix->words[i % MIX_WORDS]) % num_full_pages;
+                page[l] = &full_nodes[MIX_NODES * index];
+                for (unsigned n = 0; n != MIX_NODES; ++n) {
+                    ethash_prefetch(&page[l][n]);
+                }
+            }
+            for (unsigned l = 0; l != lanes; ++l) {
+                ethash_mix_page(s_mix[l] + 1, page[l]);
+            }
+        }
+
+        for (unsigned l = 0; l != lanes; ++l) {
+            ethash_hash_final(&ret[b + l], s_mix[l]);
+        }
+    }
+}
+
 void ethash_quick_hash(
         uint8_t return_hash[32],
         const uint8_t header_hash[32],
@@ -3,10 +3,28 @@
 #include "endian.h"
 #include "ethash.h"
 
-#define ENABLE_SSE 0
+// kernels for instruction sets the build does not assume are picked at runtime, by what the CPU has
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ETHASH_CPU_DISPATCH 1
+#include <immintrin.h>
+#else
+#define ETHASH_CPU_DISPATCH 0
+#endif
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// nonces evaluated together by ethash_full_batch
+#define ETHASH_BATCH_LANES 4
 
-#if defined(_M_X64) && ENABLE_SSE
-#include <smmintrin.h>
+#if defined(__GNUC__)
+#define ethash_prefetch(p) __builtin_prefetch((p))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define ethash_prefetch(p) _mm_prefetch((char const *) (p), _MM_HINT_T0)
+#else
+#define ethash_prefetch(p)
 #endif
 
 #ifdef __cplusplus
@@ -23,11 +41,6 @@ typedef union node {
     uint8_t bytes[NODE_WORDS * 4];
     uint32_t words[NODE_WORDS];
     uint64_t double_words[NODE_WORDS / 2];
-
-#if defined(_M_X64) && ENABLE_SSE
-	__m128i xmm[NODE_WORDS/4];
-#endif
-
 } node;
 
 void ethash_calculate_dag_item(
@@ -20,7 +20,9 @@
  */
 
 #include <libdevcore/Common.h>
+#include <libdevcore/Guards.h>
 #include <libdevcore/RLP.h>
+#include <libdevcore/RLPSchema.h>
 #include <libdevcrypto/TrieDB.h>
 #include <libethcore/Common.h>
 #include "ProofOfWork.h"
@@ -57,14 +59,32 @@ void BlockInfo::clear()
 	extraData.clear();
 	mixHash = h256();
 	nonce = Nonce();
-	m_hash = m_seedHash = h256();
+	noteDirty();
+}
+
+/// Epochs whose seed hashes are kept once worked out; enough for centuries of blocks.
+static const unsigned c_seedHashesKept = 4096;
+
+/// @returns the seed hash of epoch @a _epoch, that of the one before hashed again; the first is zero.
+static h256 epochSeedHash(u256 _epoch)
+{
+	static Mutex s_x;
+	static h256s s_seeds(1);
+	Guard l(s_x);
+	while (s_seeds.size() <= _epoch && s_seeds.size() < c_seedHashesKept)
+		s_seeds.push_back(sha3(s_seeds.back()));
+	if (_epoch < s_seeds.size())
+		return s_seeds[(unsigned)_epoch];
+	h256 ret = s_seeds.back();
+	for (u256 e = s_seeds.size() - 1; e < _epoch; ++e)
+		ret = sha3(ret);
+	return ret;
 }
 
 h256 const& BlockInfo::seedHash() const
 {
 	if (!m_seedHash)
-		for (u256 n = number; n >= c_epochDuration; n -= c_epochDuration)
-			m_seedHash = sha3(m_seedHash);
+		m_seedHash = epochSeedHash(number / c_epochDuration);
 	return m_seedHash;
 }
 
@@ -91,9 +111,12 @@ BlockInfo BlockInfo::fromHeader(bytesConstRef _header, Strictness _s, h256 const
 
 h256 BlockInfo::headerHash(IncludeNonce _n) const
 {
-	RLPStream s;
-	streamRLP(s, _n);
-	return sha3(s.out());
+	if (_n == WithoutNonce && m_sealHash)
+		return m_sealHash;
+	h256 ret = sha3(rlpExact([&](RLPStream& _s){ streamRLP(_s, _n); }));
+	if (_n == WithoutNonce)
+		m_sealHash = ret;
+	return ret;
 }
 
 void BlockInfo::streamRLP(RLPStream& _s, IncludeNonce _n) const
@@ -112,31 +135,16 @@ h256 BlockInfo::headerHash(bytesConstRef _block)
 
 void BlockInfo::populateFromHeader(RLP const& _header, Strictness _s, h256 const& _h)
 {
+	noteDirty();
 	m_hash = _h;
 	if (_h)
 		assert(_h == dev::sha3(_header.data()));
-	m_seedHash = h256();
 
-	int field = 0;
+	unsigned field = 0;
 	try
 	{
-		if (_header.itemCount() != 15)
+		if (!decodeRLPList(_header.data(), field, parentHash, sha3Uncles, coinbaseAddress, stateRoot, transactionsRoot, receiptsRoot, logBloom, difficulty, number, gasLimit, gasUsed, timestamp, extraData, mixHash, nonce))
 			throw InvalidBlockHeaderItemCount();
-		parentHash = _header[field = 0].toHash<h256>(RLP::VeryStrict);
-		sha3Uncles = _header[field = 1].toHash<h256>(RLP::VeryStrict);
-		coinbaseAddress = _header[field = 2].toHash<Address>(RLP::VeryStrict);
-		stateRoot = _header[field = 3].toHash<h256>(RLP::VeryStrict);
-		transactionsRoot = _header[field = 4].toHash<h256>(RLP::VeryStrict);
-		receiptsRoot = _header[field = 5].toHash<h256>(RLP::VeryStrict);
-		logBloom = _header[field = 6].toHash<LogBloom>(RLP::VeryStrict);
-		difficulty = _header[field = 7].toInt<u256>();
-		number = _header[field = 8].toInt<u256>();
-		gasLimit = _header[field = 9].toInt<u256>();
-		gasUsed = _header[field = 10].toInt<u256>();
-		timestamp = _header[field = 11].toInt<u256>();
-		extraData = _header[field = 12].toBytes();
-		mixHash = _header[field = 13].toHash<h256>(RLP::VeryStrict);
-		nonce = _header[field = 14].toHash<Nonce>(RLP::VeryStrict);
 	}
 
 	catch (Exception const& _e)
@@ -185,8 +193,10 @@ template <class T, class U> h256 trieRootOver(unsigned _itemCount, T const& _get
 	MemoryDB db;
 	GenericTrieDB<MemoryDB> t(&db);
 	t.init();
+	std::map<bytes, bytes> items;
 	for (unsigned i = 0; i < _itemCount; ++i)
-		t.insert(_getKey(i), _getValue(i));
+		items[_getKey(i)] = _getValue(i).toBytes();
+	t.apply(items);
 	return t.root();
 }
 
@@ -118,7 +118,9 @@ public:
 
 	void clear();
 
-	void noteDirty() const { m_hash = m_seedHash = m_boundary = h256(); }
+	/// Forgets the hashes and boundary worked out from the fields, which must be done whenever one is changed.
+	/// Copies keep them, so a header decoded or hashed once need not be again.
+	void noteDirty() const { m_hash = m_sealHash = m_seedHash = m_boundary = h256(); }
 
 	void populateFromHeader(RLP const& _header, Strictness _s = IgnoreNonce, h256 const& _h = h256());
 	void populate(bytesConstRef _block, Strictness _s = IgnoreNonce, h256 const& _h = h256());
@@ -133,13 +135,14 @@ public:
 	h256 const& hash() const;
 	h256 const& boundary() const;
 
-	/// sha3 of the header only.
+	/// sha3 of the header only. Without the nonce, as mining and verifying ask for again and again, it is cached.
 	h256 headerHash(IncludeNonce _n) const;
 	void streamRLP(RLPStream& _s, IncludeNonce _n) const;
 
 private:
 	mutable h256 m_seedHash;
 	mutable h256 m_hash;						///< SHA3 hash of the block header! Not serialised.
+	mutable h256 m_sealHash;					///< headerHash(WithoutNonce).
 	mutable h256 m_boundary;					///< 2^256 / difficulty
 };
 
@@ -0,0 +1,54 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file CodeStore.cpp
+ * @date 2015
+ */
+
+#include "CodeStore.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+const size_t CodeStore::c_defaultCapacity;
+
+CodeStore& CodeStore::get()
+{
+	static CodeStore s_this;
+	return s_this;
+}
+
+SharedCode CodeStore::code(h256 const& _hash, function<bytes()> const& _load)
+{
+	SharedCode ret;
+	if (!m_cache.get(_hash, ret))
+		// Should two threads miss at once, both load; the later insert replaces the earlier, which is equal.
+		ret = insert(_hash, _load());
+	return ret;
+}
+
+SharedCode CodeStore::insert(h256 const& _hash, bytes&& _code)
+{
+	SharedCode ret = make_shared<bytes const>(move(_code));
+	m_cache.insert(_hash, ret);
+	return ret;
+}
+
+SharedCode const& CodeStore::empty()
+{
+	static const SharedCode s_empty = make_shared<bytes const>();
+	return s_empty;
+}
@@ -0,0 +1,70 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file CodeStore.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/ShardedCache.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/// Contract code, immutable, shared by each account, call frame and analysis of it rather than copied.
+using SharedCode = std::shared_ptr<bytes const>;
+
+/**
+ * @brief The process's contract code by hash, so that code used again is loaded from the state DB once and held
+ * in memory once. Past its capacity, the least recently used code is dropped from the store; it lives on for
+ * as long as anything still holds it.
+ * @threadsafe
+ */
+class CodeStore
+{
+public:
+	static CodeStore& get();
+
+	/// @returns the code of hash @a _hash, calling @a _load for it should it not be in the store.
+	SharedCode code(h256 const& _hash, std::function<bytes()> const& _load);
+	/// @returns @a _code, shared, putting it in the store under its hash @a _hash.
+	SharedCode insert(h256 const& _hash, bytes&& _code);
+
+	size_t memoryUsage() const { return m_cache.memoryUsage(); }
+	void setCapacity(size_t _bytes) { m_cache.setCapacity(_bytes); }
+
+	/// @returns the empty code.
+	static SharedCode const& empty();
+
+	static const size_t c_defaultCapacity = 64 * 1024 * 1024;
+
+private:
+	CodeStore(): m_cache(c_defaultCapacity) {}
+
+	struct Size { size_t operator()(SharedCode const& _c) const { return _c->size(); } };
+
+	ShardedCache<h256, SharedCode, Size> m_cache;
+};
+
+}
+}
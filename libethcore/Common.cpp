@@ -34,7 +34,7 @@ namespace eth
 {
 
 const unsigned c_ethashVersion = c_ethashRevision;
-const unsigned c_protocolVersion = 60;
+const unsigned c_protocolVersion = 61;
 const unsigned c_minorProtocolVersion = 0;
 const unsigned c_databaseBaseVersion = 9;
 #if ETH_FATDB
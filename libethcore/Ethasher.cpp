@@ -23,15 +23,23 @@
 #include <boost/filesystem.hpp>
 #include <chrono>
 #include <array>
+#include <atomic>
 #include <random>
 #include <thread>
 #include <libdevcore/Common.h>
+#include <libdevcore/CpuFeatures.h>
 #include <libdevcore/Guards.h>
 #include <libdevcore/Log.h>
+#include <libdevcore/MappedFile.h>
 #include <libdevcrypto/CryptoPP.h>
 #include <libdevcrypto/SHA3.h>
 #include <libdevcrypto/FileSystem.h>
 #include <libethcore/Params.h>
+#ifdef __linux__
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 #include "BlockInfo.h"
 #include "Ethasher.h"
 using namespace std;
@@ -39,27 +47,69 @@ using namespace chrono;
 using namespace dev;
 using namespace eth;
 
-Ethasher* dev::eth::Ethasher::s_this = nullptr;
+/// Epochs whose full data is kept mapped.
+// Reports the kernels libethash picks for this CPU along with those picked through CpuDispatch.
+static bool const c_ethashKernelsNoted = (noteCpuKernel("ethash_dag_item", ethash_dag_item_kernel()), noteCpuKernel("ethash_mix", ethash_mix_kernel()), true);
+
+static const unsigned c_fullsKept = 2;
+
+/// Nodes of the full data a thread takes at a time when computing it.
+static const uint64_t c_fullChunk = 4096;
+
+/// Lowers the priority of this thread, and of those it starts, so that ethash data made in the background takes only
+/// what time is spare.
+static void lowerPriority()
+{
+#ifdef __linux__
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 19);
+#endif
+}
+
+/// @returns the path of the file of the full data for @a _seed.
+static string fullPath(h256 const& _seed)
+{
+	return getDataDir("ethash") + "/full-R" + toString(c_ethashRevision) + "-" + toHex(_seed.ref().cropped(0, 8));
+}
+
+/// Notes the progress of computing the full data for @a _header.
+static function<void(unsigned)> noteProgress(BlockInfo const& _header)
+{
+	unsigned epoch = (unsigned)(_header.number / c_ethashEpochLength);
+	return [=](unsigned _percent)
+	{
+		if (_percent % 10 == 0)
+			cnote << "Generating DAG for epoch" << epoch << ":" << _percent << "%";
+	};
+}
+
+Ethasher* Ethasher::get()
+{
+	// Made on first use, thread-safely, and never deleted, so that it outlives any thread still using it at exit.
+	static Ethasher* s_this = new Ethasher;
+	return s_this;
+}
 
 Ethasher::~Ethasher()
 {
-	while (!m_lights.empty())
-		killCache(m_lights.begin()->first);
+	if (m_pregenerator.joinable())
+		m_pregenerator.join();
+	if (m_verificationMaker.joinable())
+		m_verificationMaker.join();
 }
 
-void Ethasher::killCache(h256 const& _s)
+void Ethasher::setLightsKept(unsigned _n)
 {
 	RecursiveGuard l(x_this);
-	if (m_lights.count(_s))
+	m_lightsKept = max(_n, 1u);
+	while (m_lightsOrder.size() > m_lightsKept)
 	{
-		ethash_delete_light(m_lights.at(_s));
-		m_lights.erase(_s);
+		m_lights.erase(m_lightsOrder.front());
+		m_lightsOrder.pop_front();
 	}
 }
 
-void const* Ethasher::light(BlockInfo const& _header)
+Ethasher::Light Ethasher::light(BlockInfo const& _header)
 {
-	RecursiveGuard l(x_this);
 	if (_header.number > c_ethashEpochLength * 2048)
 	{
 		std::ostringstream error;
@@ -67,55 +117,237 @@ void const* Ethasher::light(BlockInfo const& _header)
 		throw std::invalid_argument( error.str() );
  	}
 
-	if (!m_lights.count(_header.seedHash()))
+	h256 seed = _header.seedHash();
 	{
-		ethash_params p = params((unsigned)_header.number);
-		m_lights[_header.seedHash()] = ethash_new_light(&p, _header.seedHash().data());
+		// Should it be being made already, we wait for that rather than make it again.
+		unique_lock<RecursiveMutex> l(x_this);
+		m_lightMade.wait(l, [&](){ return !m_makingLights.count(seed); });
+		auto it = m_lights.find(seed);
+		if (it != m_lights.end())
+		{
+			m_lightsOrder.remove(seed);
+			m_lightsOrder.push_back(seed);
+			return it->second;
+		}
+		m_makingLights.insert(seed);
 	}
-	return m_lights[_header.seedHash()];
+
+	// Made without the lock, so that those using other epochs need not wait.
+	ethash_params p = params((unsigned)_header.number);
+	Light ret(ethash_new_light(&p, seed.data()), [](void const* _l){ ethash_delete_light(_l); });
+
+	{
+		RecursiveGuard l(x_this);
+		m_makingLights.erase(seed);
+		if (!ret)
+		{
+			m_lightMade.notify_all();
+			BOOST_THROW_EXCEPTION(std::bad_alloc());
+		}
+		m_lights[seed] = ret;
+		m_lightsOrder.push_back(seed);
+		while (m_lightsOrder.size() > m_lightsKept)
+		{
+			m_lights.erase(m_lightsOrder.front());
+			m_lightsOrder.pop_front();
+		}
+	}
+	m_lightMade.notify_all();
+	return ret;
 }
 
 #define IGNORE_EXCEPTIONS(X) try { X; } catch (...) {}
 
 bytesConstRef Ethasher::full(BlockInfo const& _header)
 {
-	RecursiveGuard l(x_this);
-	if (!m_fulls.count(_header.seedHash()))
+	return fullFile(_header)->data();
+}
+
+unsigned Ethasher::fullNode() const
+{
+	switch (m_dagPlacement)
+	{
+	case DagPlacement::Interleaved:
+		return c_allNumaNodes;
+	case DagPlacement::Replicated:
+		return numaNodes().size() > 1 ? currentNumaNode() : c_anyNumaNode;
+	default:
+		return c_anyNumaNode;
+	}
+}
+
+Ethasher::FullFile Ethasher::fullFile(BlockInfo const& _header)
+{
+	h256 seed = _header.seedHash();
+	unsigned node = fullNode();
+	FullKey key(seed, node);
+	{
+		// Should it be being made already, perhaps ahead of time, we wait for that rather than make it again; so too
+		// for a copy on another node, which leaves the file made for this one.
+		unique_lock<RecursiveMutex> l(x_this);
+		m_fullMade.wait(l, [&](){ return !m_makingFulls.count(seed); });
+		auto it = m_fulls.find(key);
+		if (it != m_fulls.end())
+			return it->second;
+		m_makingFulls.insert(seed);
+	}
+
+	FullFile ret;
+	try
+	{
+		ret = makeFull(_header, node);
+	}
+	catch (...)
 	{
-		// @memoryleak @bug place it on a pile for deletion - perhaps use shared_ptr.
-/*		if (!m_fulls.empty())
 		{
-			delete [] m_fulls.begin()->second.data();
-			m_fulls.erase(m_fulls.begin());
-		}*/
-
-		try {
-			boost::filesystem::create_directories(getDataDir("ethash"));
-		} catch (...) {}
-
-		auto info = rlpList(c_ethashRevision, _header.seedHash());
-		std::string oldMemoFile = getDataDir("ethash") + "/full";
-		std::string memoFile = getDataDir("ethash") + "/full-R" + toString(c_ethashRevision) + "-" + toHex(_header.seedHash().ref().cropped(0, 8));
-		if (boost::filesystem::exists(oldMemoFile) && contents(oldMemoFile + ".info") == info)
+			RecursiveGuard l(x_this);
+			m_makingFulls.erase(seed);
+		}
+		m_fullMade.notify_all();
+		throw;
+	}
+
+	{
+		// Only the latest epochs are kept mapped, on each node; those still in use stay so until they are done with.
+		RecursiveGuard l(x_this);
+		m_makingFulls.erase(seed);
+		m_fulls[key] = ret;
+		m_fullsOrder.push_back(key);
+		while (m_fullsOrder.size() > c_fullsKept * (m_dagPlacement == DagPlacement::Replicated ? numaNodes().size() : 1))
 		{
-			// memofile valid - rename.
-			boost::filesystem::rename(oldMemoFile, memoFile);
+			m_fulls.erase(m_fullsOrder.front());
+			m_fullsOrder.pop_front();
 		}
+	}
+	m_fullMade.notify_all();
+	return ret;
+}
 
-		IGNORE_EXCEPTIONS(boost::filesystem::remove(oldMemoFile));
-		IGNORE_EXCEPTIONS(boost::filesystem::remove(oldMemoFile + ".info"));
+Ethasher::FullFile Ethasher::makeFull(BlockInfo const& _header, unsigned _node)
+{
+	try {
+		boost::filesystem::create_directories(getDataDir("ethash"));
+	} catch (...) {}
 
-		m_fulls[_header.seedHash()] = contentsNew(memoFile);
-		if (!m_fulls[_header.seedHash()])
+	auto info = rlpList(c_ethashRevision, _header.seedHash());
+	std::string oldMemoFile = getDataDir("ethash") + "/full";
+	std::string memoFile = fullPath(_header.seedHash());
+	if (boost::filesystem::exists(oldMemoFile) && contents(oldMemoFile + ".info") == info)
+	{
+		// memofile valid - rename.
+		boost::filesystem::rename(oldMemoFile, memoFile);
+	}
+
+	IGNORE_EXCEPTIONS(boost::filesystem::remove(oldMemoFile));
+	IGNORE_EXCEPTIONS(boost::filesystem::remove(oldMemoFile + ".info"));
+
+	ethash_params p = params((unsigned)_header.number);
+	auto ret = make_shared<MappedFile>(memoFile, m_hugePages, _node);
+	if (ret->data().size() != p.full_size)
+	{
+		// Computed into a file of its own and only then moved into place, so that no other process maps half of it.
+		std::string tempFile = memoFile + ".tmp-" + toHex(h64::random().ref());
+		auto c = light(_header);
+		if (!MappedFile::create(tempFile, p.full_size, [&](bytesRef _d){ computeFull(_d.data(), p, c.get(), 0, noteProgress(_header)); }))
 		{
-			ethash_params p = params((unsigned)_header.number);
-			m_fulls[_header.seedHash()] = bytesRef(new byte[p.full_size], p.full_size);
-			auto c = light(_header);
-			ethash_prep_full(m_fulls[_header.seedHash()].data(), &p, c);
-			writeFile(memoFile, m_fulls[_header.seedHash()]);
+			IGNORE_EXCEPTIONS(boost::filesystem::remove(tempFile));
+			BOOST_THROW_EXCEPTION(FileError() << errinfo_comment(tempFile));
 		}
+		boost::filesystem::rename(tempFile, memoFile);
+		ret = make_shared<MappedFile>(memoFile, m_hugePages, _node);
+		if (ret->data().size() != p.full_size)
+			BOOST_THROW_EXCEPTION(FileError() << errinfo_comment(memoFile));
+	}
+	return ret;
+}
+
+void Ethasher::noteHead(unsigned _number)
+{
+	unsigned next = (_number / c_ethashEpochLength + 1) * c_ethashEpochLength;
+	std::thread done;
+	{
+		RecursiveGuard l(x_this);
+		m_head = _number;
+		if (next - _number > m_pregenerateDistance || next <= m_pregenerated)
+			return;
+		m_pregenerated = next;
+		swap(done, m_pregenerator);
+
+		// The full data is only made ahead for those already using it; others verify with the light cache alone.
+		bool full = !m_fulls.empty();
+		m_pregenerator = std::thread([=]()
+		{
+			setThreadName("ethash");
+			lowerPriority();
+			BlockInfo bi;
+			bi.number = next;
+			cnote << "Preparing ethash for epoch" << next / c_ethashEpochLength << "ahead of block" << next;
+			try
+			{
+				light(bi);
+				if (full)
+					fullFile(bi);
+			}
+			catch (...)
+			{
+				cwarn << "Couldn't prepare ethash for the next epoch:" << boost::current_exception_diagnostic_information();
+			}
+		});
 	}
-	return m_fulls[_header.seedHash()];
+	// The last one finished long ago, an epoch having passed since.
+	if (done.joinable())
+		done.join();
+}
+
+Ethasher::FullFile Ethasher::verificationFull(BlockInfo const& _header)
+{
+	h256 seed = _header.seedHash();
+	{
+		RecursiveGuard l(x_this);
+		auto it = m_fulls.find(FullKey(seed, fullNode()));
+		if (it != m_fulls.end())
+			return it->second;
+		// Older epochs are only met while syncing, and soon passed, so their full data would not pay for itself; nor is
+		// it made for any later than the next, lest a peer have us make it for any epoch it likes.
+		unsigned epoch = (unsigned)(_header.number / c_ethashEpochLength);
+		unsigned headEpoch = m_head / c_ethashEpochLength;
+		if (!m_fullVerification || m_makingFulls.count(seed) || epoch < headEpoch || epoch > headEpoch + 1)
+			return FullFile();
+	}
+
+	boost::system::error_code ec;
+	if (boost::filesystem::file_size(fullPath(seed), ec) == params(_header).full_size && !ec)
+		// Only needs mapping.
+		return fullFile(_header);
+
+	std::thread done;
+	{
+		RecursiveGuard l(x_this);
+		if (m_verificationMaking)
+			return FullFile();
+		m_verificationMaking = true;
+		swap(done, m_verificationMaker);
+		BlockInfo bi = _header;
+		m_verificationMaker = std::thread([=]()
+		{
+			setThreadName("ethash");
+			lowerPriority();
+			try
+			{
+				fullFile(bi);
+			}
+			catch (...)
+			{
+				cwarn << "Couldn't make the DAG to verify with:" << boost::current_exception_diagnostic_information();
+			}
+			RecursiveGuard l(x_this);
+			m_verificationMaking = false;
+		});
+	}
+	// It has finished, m_verificationMaking having been cleared.
+	if (done.joinable())
+		done.join();
+	return FullFile();
 }
 
 ethash_params Ethasher::params(BlockInfo const& _header)
@@ -125,40 +357,40 @@ ethash_params Ethasher::params(BlockInfo const& _header)
 
 void Ethasher::readFull(BlockInfo const& _header, void* _dest)
 {
-	if (!m_fulls.count(_header.seedHash()))
+	auto f = fullFile(_header);
+	memcpy(_dest, f->data().data(), f->data().size());
+}
+
+void Ethasher::computeFull(void* _dest, ethash_params const& _params, LightType _light, unsigned _threads, function<void(unsigned)> const& _progress)
+{
+	// The nodes are independent; threads take chunks of them in turn until none are left.
+	uint64_t nodes = _params.full_size / ETHASH_HASH_BYTES;
+	atomic<uint64_t> next(0);
+	atomic<uint64_t> done(0);
+	auto work = [&]()
 	{
-		// @memoryleak @bug place it on a pile for deletion - perhaps use shared_ptr.
-/*		if (!m_fulls.empty())
-		{
-			delete [] m_fulls.begin()->second.data();
-			m_fulls.erase(m_fulls.begin());
-		}*/
-
-		try {
-			boost::filesystem::create_directories(getDataDir("ethash"));
-		} catch (...) {}
-
-		auto info = rlpList(c_ethashRevision, _header.seedHash());
-		std::string oldMemoFile = getDataDir("ethash") + "/full";
-		std::string memoFile = getDataDir("ethash") + "/full-R" + toString(c_ethashRevision) + "-" + toHex(_header.seedHash().ref().cropped(0, 8));
-		if (boost::filesystem::exists(oldMemoFile) && contents(oldMemoFile + ".info") == info)
+		for (uint64_t b = next.fetch_add(c_fullChunk); b < nodes; b = next.fetch_add(c_fullChunk))
 		{
-			// memofile valid - rename.
-			boost::filesystem::rename(oldMemoFile, memoFile);
+			uint64_t e = min(b + c_fullChunk, nodes);
+			ethash_compute_full_data_range(_dest, &_params, _light, b, e);
+			done += e - b;
 		}
+	};
+	vector<thread> threads;
+	for (unsigned i = 0; i < (_threads ? _threads : max(thread::hardware_concurrency(), 1u)); ++i)
+		threads.push_back(thread(work));
 
-		IGNORE_EXCEPTIONS(boost::filesystem::remove(oldMemoFile));
-		IGNORE_EXCEPTIONS(boost::filesystem::remove(oldMemoFile + ".info"));
-
-		ethash_params p = params((unsigned)_header.number);
-		bytesRef r = contentsNew(memoFile, bytesRef((byte*)_dest, p.full_size));
-		if (!r)
+	if (_progress)
+		for (unsigned last = (unsigned)-1; done < nodes; this_thread::sleep_for(milliseconds(100)))
 		{
-			auto c = light(_header);
-			ethash_prep_full(_dest, &p, c);
-			writeFile(memoFile, bytesConstRef((byte*)_dest, p.full_size));
+			unsigned percent = (unsigned)(done * 100 / nodes);
+			if (percent != last)
+				_progress(last = percent);
 		}
-	}
+	for (auto& t: threads)
+		t.join();
+	if (_progress)
+		_progress(100);
 }
 
 ethash_params Ethasher::params(unsigned _n)
@@ -211,10 +443,11 @@ Ethasher::Result Ethasher::eval(BlockInfo const& _header, Nonce const& _nonce)
 {
 	auto p = Ethasher::params(_header);
 	ethash_return_value r;
-	if (Ethasher::get()->m_fulls.count(_header.seedHash()))
-		ethash_compute_full(&r, Ethasher::get()->full(_header).data(), &p, _header.headerHash(WithoutNonce).data(), (uint64_t)(u64)_nonce);
+	FullFile full = Ethasher::get()->verificationFull(_header);
+	if (full)
+		ethash_compute_full(&r, full->data().data(), &p, _header.headerHash(WithoutNonce).data(), (uint64_t)(u64)_nonce);
 	else
-		ethash_compute_light(&r, Ethasher::get()->light(_header), &p, _header.headerHash(WithoutNonce).data(), (uint64_t)(u64)_nonce);
+		ethash_compute_light(&r, Ethasher::get()->light(_header).get(), &p, _header.headerHash(WithoutNonce).data(), (uint64_t)(u64)_nonce);
 //	cdebug << "Ethasher::eval sha3(cache):" << sha3(Ethasher::get()->cache(_header)) << "hh:" << _header.headerHash(WithoutNonce) << "nonce:" << _nonce << " => " << h256(r.result, h256::ConstructFromPointer);
 	return Result{h256(r.result, h256::ConstructFromPointer), h256(r.mix_hash, h256::ConstructFromPointer)};
 }
@@ -24,10 +24,17 @@
 #pragma once
 
 #include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <set>
 #include <thread>
 #include <cstdint>
 #include <libdevcore/Guards.h>
 #include <libdevcore/Log.h>
+#include <libdevcore/MappedFile.h>
 #include <libdevcrypto/SHA3.h>
 #include <libethash/ethash.h>		// TODO: REMOVE once everything merged into this class and an opaque API can be provided.
 static const unsigned c_ethashRevision = ETHASH_REVISION;
@@ -40,24 +47,68 @@ namespace dev
 namespace eth
 {
 
+/// Where the full data is placed among the NUMA nodes of the machine.
+enum class DagPlacement
+{
+	Shared,				///< Mapped from its file, shared with other processes, wherever the page cache has it.
+	Interleaved,		///< Read into memory of our own, spread page by page over the nodes.
+	Replicated			///< Read into memory of our own on each node, each thread using that of the node it runs on.
+};
+
+/**
+ * @brief Keeps the light caches and full data of the ethash epochs in use.
+ * All of its state is guarded by x_this, which is never held while a cache or full data is made: another thread
+ * wanting the same epoch waits for it to be made rather than make it again, while those wanting others carry on.
+ * Caches and full data are handed out by reference count, so that they outlive being dropped from here for as long as
+ * they are in use.
+ */
 class Ethasher
 {
 public:
 	Ethasher() {}
 	~Ethasher();
 
-	static Ethasher* get() { if (!s_this) s_this = new Ethasher(); return s_this; }
+	static Ethasher* get();
 
 	using LightType = void const*;
 	using FullType = void const*;
-
-	LightType light(BlockInfo const& _header);
+	using Light = std::shared_ptr<void const>;
+	using FullFile = std::shared_ptr<MappedFile const>;
+
+	/// @returns the light cache for @a _header, which is made if it is not kept already.
+	/// Only the most recently used caches are kept; older ones are deleted once nothing else holds them.
+	Light light(BlockInfo const& _header);
+	/// Sets how many light caches are kept.
+	void setLightsKept(unsigned _n);
+	/// @returns the full data for @a _header, valid only while its epoch stays mapped; prefer fullFile() to keep it.
 	bytesConstRef full(BlockInfo const& _header);
+	/// @returns the full data for @a _header, mapped from its file, which is made if it is not there yet.
+	/// Only the latest epochs stay mapped here; older ones are unmapped once nothing else holds them.
+	FullFile fullFile(BlockInfo const& _header);
+	/// Sets whether full data mapped from now on is read into huge pages rather than shared with other processes.
+	void setHugePages(bool _hugePages) { m_hugePages = _hugePages; }
+	/// Sets where full data mapped from now on is placed. Replicated, a thread should be pinned to a node, so that the
+	/// copy it has stays local to it.
+	void setDagPlacement(DagPlacement _p) { m_dagPlacement = _p; }
+	/// Sets whether blocks are verified against the full data rather than the light cache, for nodes with the memory to
+	/// spare. The full data of the head's epoch, or a later one, is mapped as it is first needed, or made in the
+	/// background should there be no file of it yet; until then, and for older epochs, the light cache is used.
+	void setFullVerification(bool _full) { m_fullVerification = _full; }
+
+	/// Notes that the chain's head is now block @a _number. Once within the pregenerate distance of the next epoch, its
+	/// light cache, and its full data if that of an epoch is in use, are made in the background at low priority.
+	void noteHead(unsigned _number);
+	/// Sets how many blocks before an epoch begins it is prepared for.
+	void setPregenerateDistance(unsigned _blocks) { m_pregenerateDistance = _blocks; }
 	static ethash_params params(BlockInfo const& _header);
 	static ethash_params params(unsigned _n);
 
 	void readFull(BlockInfo const& _header, void* _dest);
 
+	/// Computes the full data for @a _params from @a _light into @a _dest, split among @a _threads threads (one per
+	/// hardware thread if 0). @a _progress, if given, is called on this thread every so often with the percentage done.
+	static void computeFull(void* _dest, ethash_params const& _params, LightType _light, unsigned _threads = 0, std::function<void(unsigned)> const& _progress = std::function<void(unsigned)>());
+
 	struct Result
 	{
 		h256 value;
@@ -74,7 +125,8 @@ public:
 		Miner(BlockInfo const& _header):
 			m_headerHash(_header.headerHash(WithoutNonce)),
 			m_params(Ethasher::params(_header)),
-			m_datasetPointer(Ethasher::get()->full(_header).data())
+			m_full(Ethasher::get()->fullFile(_header)),
+			m_datasetPointer(m_full->data().data())
 		{}
 
 		inline h256 mine(uint64_t _nonce)
@@ -89,20 +141,52 @@ public:
 			return h256(m_ethashReturn.mix_hash, h256::ConstructFromPointer);
 		}
 
+		/// Evaluates the @a _count nonces from @a _nonce together, into @a o_results[0] to @a o_results[_count - 1].
+		inline void mine(uint64_t _nonce, unsigned _count, ethash_return_value* o_results)
+		{
+			ethash_full_batch(o_results, m_datasetPointer, &m_params, m_headerHash.data(), _nonce, _count);
+		}
+
 	private:
 		ethash_return_value m_ethashReturn;
 		h256 m_headerHash;
 		ethash_params m_params;
+		FullFile m_full;
 		void const* m_datasetPointer;
 	};
 
 private:
-	void killCache(h256 const& _s);
+	/// The seed of an epoch's full data and the NUMA node it is placed on, as placeMemory() has it.
+	using FullKey = std::pair<h256, unsigned>;
+
+	/// Maps the full data for @a _header from its file, computing that first if need be, placed on NUMA node @a _node.
+	FullFile makeFull(BlockInfo const& _header, unsigned _node);
+	/// @returns the NUMA node the full data the calling thread asks for is placed on.
+	unsigned fullNode() const;
+	/// @returns the full data to verify @a _header with, or null if the light cache is to be used for now.
+	FullFile verificationFull(BlockInfo const& _header);
 
-	static Ethasher* s_this;
 	RecursiveMutex x_this;
-	std::map<h256, LightType> m_lights;
-	std::map<h256, bytesRef> m_fulls;
+	std::map<h256, Light> m_lights;
+	std::list<h256> m_lightsOrder;		///< The seeds of m_lights, least recently used first.
+	unsigned m_lightsKept = 3;
+	std::set<h256> m_makingLights;		///< The seeds whose light cache is being made.
+	std::condition_variable_any m_lightMade;
+	std::map<FullKey, FullFile> m_fulls;
+	std::deque<FullKey> m_fullsOrder;	///< The keys of m_fulls, oldest first.
+	std::set<h256> m_makingFulls;		///< The seeds whose full data is being made, on whichever node.
+	std::condition_variable_any m_fullMade;
+	bool m_hugePages = false;
+	DagPlacement m_dagPlacement = DagPlacement::Shared;
+
+	std::thread m_pregenerator;
+	unsigned m_pregenerated = 0;		///< The first block of the latest epoch prepared ahead.
+	unsigned m_pregenerateDistance = 1000;
+	unsigned m_head = 0;				///< The head's number, as last noted.
+
+	bool m_fullVerification = false;
+	std::thread m_verificationMaker;	///< Makes the full data for verification, should there be no file of it.
+	bool m_verificationMaking = false;	///< Whether m_verificationMaker is still at it.
 };
 
 }
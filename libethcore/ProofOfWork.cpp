@@ -50,6 +50,25 @@ bool EthashPoW::verify(BlockInfo const& _header)
 	return Ethasher::verify(_header);
 }
 
+void EthashPoW::abort()
+{
+	{
+		lock_guard<mutex> l(x_aborted);
+		m_aborted = true;
+	}
+	m_abortedSignal.notify_all();
+}
+
+bool EthashPoW::waitUnlessAborted(unsigned _ms)
+{
+	unique_lock<mutex> l(x_aborted);
+	m_abortedSignal.wait_for(l, milliseconds(_ms), [&](){ return m_aborted.load(); });
+	return aborted();
+}
+
+/// Nonces EthashCPU::mine() tries at once.
+static const unsigned c_mineBatch = 32;
+
 std::pair<MineInfo, EthashCPU::Proof> EthashCPU::mine(BlockInfo const& _header, unsigned _msTimeout, bool _continue)
 {
 	Ethasher::Miner m(_header);
@@ -70,20 +89,27 @@ std::pair<MineInfo, EthashCPU::Proof> EthashCPU::mine(BlockInfo const& _header,
 	double best = 1e99;	// high enough to be effectively infinity :)
 	Proof result;
 	unsigned hashCount = 0;
-	for (; (std::chrono::steady_clock::now() - startTime) < std::chrono::milliseconds(_msTimeout) && _continue; tryNonce++, hashCount++)
+	ethash_return_value results[c_mineBatch];
+	for (; (std::chrono::steady_clock::now() - startTime) < std::chrono::milliseconds(_msTimeout) && _continue && !ret.first.completed && !aborted(); tryNonce += c_mineBatch)
 	{
-		h256 val(m.mine(tryNonce));
-		best = std::min<double>(best, log2((double)(u256)val));
-		if (val <= boundary)
+		// Nonces are tried a batch at a time, so that several reads of the DAG are under way at once.
+		m.mine(tryNonce, c_mineBatch, results);
+		for (unsigned i = 0; i < c_mineBatch; ++i)
 		{
-			ret.first.completed = true;
-			assert(Ethasher::eval(_header, (Nonce)(u64)tryNonce).value == val);
-			result.mixHash = m.lastMixHash();
-			result.nonce = u64(tryNonce);
-			BlockInfo test = _header;
-			assignResult(result, test);
-			assert(verify(test));
-			break;
+			hashCount++;
+			h256 val(results[i].result, h256::ConstructFromPointer);
+			best = std::min<double>(best, log2((double)(u256)val));
+			if (val <= boundary)
+			{
+				ret.first.completed = true;
+				assert(Ethasher::eval(_header, (Nonce)(u64)(tryNonce + i)).value == val);
+				result.mixHash = h256(results[i].mix_hash, h256::ConstructFromPointer);
+				result.nonce = u64(tryNonce + i);
+				BlockInfo test = _header;
+				assignResult(result, test);
+				assert(verify(test));
+				break;
+			}
 		}
 	}
 	ret.first.hashes = hashCount;
@@ -169,8 +195,8 @@ protected:
 private:
 	Mutex x_all;
 	vector<Nonce> m_found;
-	uint64_t m_total;
-	uint64_t m_last;
+	uint64_t m_total = 0;
+	uint64_t m_last = 0;
 	bool m_abort = false;
 	bool m_aborted = true;
 };
@@ -206,18 +232,25 @@ std::pair<MineInfo, Ethash::Proof> EthashCL::mine(BlockInfo const& _header, unsi
 	}
 	m_lastHeader = _header;
 
-	std::this_thread::sleep_for(chrono::milliseconds(_msTimeout));
+	// A new header is searched for on the next call.
+	waitUnlessAborted(_msTimeout);
+
+	// The device's searching is reported as the CPU's is, so that its hash rate shows.
+	MineInfo info;
+	info.requirement = log2((double)(u256)_header.boundary());
+	info.hashes = (unsigned)m_hook->fetchTotal();
 	auto found = m_hook->fetchFound();
-	if (!found.empty())
+	for (auto const& n: found)
 	{
-		for (auto const& n: found)
+		auto result = Ethasher::eval(_header, n);
+		if (result.value < _header.boundary())
 		{
-			auto result = Ethasher::eval(_header, n);
-			if (result.value < _header.boundary())
-				return std::make_pair(MineInfo(true), EthashCL::Proof{n, result.mixHash});
+			info.completed = true;
+			info.best = log2((double)(u256)result.value);
+			return std::make_pair(info, EthashCL::Proof{n, result.mixHash});
 		}
 	}
-	return std::make_pair(MineInfo(false), EthashCL::Proof());
+	return std::make_pair(info, EthashCL::Proof());
 }
 
 #endif
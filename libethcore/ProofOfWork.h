@@ -23,7 +23,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <thread>
 #include <cstdint>
 #include <libdevcrypto/SHA3.h>
@@ -65,6 +68,21 @@ public:
 
 	virtual unsigned defaultTimeout() const { return 100; }
 	virtual std::pair<MineInfo, Proof> mine(BlockInfo const& _header, unsigned _msTimeout = 100, bool _continue = true) = 0;
+
+	/// Makes the mine() under way, or else the next one, return as soon as it can, its header being no longer worth
+	/// mining. May be called from any thread.
+	void abort();
+
+protected:
+	/// @returns true if abort() has been called since this last returned true.
+	bool aborted() { return m_aborted.exchange(false); }
+	/// Waits for @a _ms milliseconds, or until abort() is called. @returns true if it was.
+	bool waitUnlessAborted(unsigned _ms);
+
+private:
+	std::atomic<bool> m_aborted{false};
+	std::mutex x_aborted;
+	std::condition_variable m_abortedSignal;
 };
 
 class EthashCPU: public EthashPoW
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <tuple>
 #include <libdevcore/Common.h>
 #include <libdevcore/FixedHash.h>
 #include <libdevcore/CommonData.h>
@@ -31,33 +32,112 @@ namespace dev
 namespace eth
 {
 
+/// The size of a static parameter in the ABI, as of a word of the EVM.
+static const unsigned c_abiWordSize = 32;
+/// The size of the selector of a function, the first bytes of the hash of its signature.
+static const unsigned c_abiSelectorSize = 4;
+
+/// @returns the selector of the function of signature @a _signature, e.g. "nameOf(address)".
+inline FixedHash<4> abiSelector(std::string const& _signature) { return FixedHash<4>(sha3(_signature)); }
+
+/// Writes the parameters of static type T, each into the size bytes of the ABI at o_out.
 template <class T> struct ABISerialiser {};
-template <unsigned N> struct ABISerialiser<FixedHash<N>> { static bytes serialise(FixedHash<N> const& _t) { static_assert(N <= 32, "Cannot serialise hash > 32 bytes."); static_assert(N > 0, "Cannot serialise zero-length hash."); return bytes(32 - N, 0) + _t.asBytes(); } };
-template <> struct ABISerialiser<u256> { static bytes serialise(u256 const& _t) { return h256(_t).asBytes(); } };
-template <> struct ABISerialiser<u160> { static bytes serialise(u160 const& _t) { return bytes(12, 0) + h160(_t).asBytes(); } };
-template <> struct ABISerialiser<string32> { static bytes serialise(string32 const& _t) { return bytesConstRef((byte const*)_t.data(), 32).toBytes(); } };
+template <unsigned N> struct ABISerialiser<FixedHash<N>> { static const unsigned size = c_abiWordSize; static void serialise(FixedHash<N> const& _t, byte* o_out) { static_assert(N <= 32, "Cannot serialise hash > 32 bytes."); static_assert(N > 0, "Cannot serialise zero-length hash."); memset(o_out, 0, 32 - N); memcpy(o_out + 32 - N, _t.data(), N); } };
+template <> struct ABISerialiser<u256> { static const unsigned size = c_abiWordSize; static void serialise(u256 const& _t, byte* o_out) { bytesRef o(o_out, 32); toBigEndian(_t, o); } };
+template <> struct ABISerialiser<u160> { static const unsigned size = c_abiWordSize; static void serialise(u160 const& _t, byte* o_out) { memset(o_out, 0, 12); bytesRef o(o_out + 12, 20); toBigEndian(_t, o); } };
+template <> struct ABISerialiser<string32> { static const unsigned size = c_abiWordSize; static void serialise(string32 const& _t, byte* o_out) { memcpy(o_out, _t.data(), 32); } };
+template <> struct ABISerialiser<bool> { static const unsigned size = c_abiWordSize; static void serialise(bool _t, byte* o_out) { memset(o_out, 0, 31); o_out[31] = _t; } };
+
+/// The size of the parameters T ... together, known at compile time.
+template <class ... T> struct ABISize;
+template <> struct ABISize<> { static const unsigned value = 0; };
+template <class T, class ... U> struct ABISize<T, U ...> { static const unsigned value = ABISerialiser<T>::size + ABISize<U ...>::value; };
+
+inline void abiInAux(byte*) {}
+template <class T, class ... U> void abiInAux(byte* o_out, T const& _t, U const& ... _u)
+{
+	ABISerialiser<T>::serialise(_t, o_out);
+	abiInAux(o_out + ABISerialiser<T>::size, _u ...);
+}
 
-inline bytes abiInAux() { return {}; }
-template <class T, class ... U> bytes abiInAux(T const& _t, U const& ... _u)
+/// Writes the call of the function of selector @a _selector with the parameters @a _t ... into @a o_out, which must
+/// be of its size, c_abiSelectorSize + ABISize<T ...>::value.
+template <class ... T> void abiIn(bytesRef o_out, FixedHash<4> const& _selector, T const& ... _t)
 {
-	return ABISerialiser<T>::serialise(_t) + abiInAux(_u ...);
+	assert(o_out.size() == c_abiSelectorSize + ABISize<T ...>::value);
+	memcpy(o_out.data(), _selector.data(), c_abiSelectorSize);
+	abiInAux(o_out.data() + c_abiSelectorSize, _t ...);
 }
 
-template <class ... T> bytes abiIn(std::string _id, T const& ... _t)
+template <class ... T> bytes abiIn(FixedHash<4> const& _selector, T const& ... _t)
 {
-	return sha3(_id).ref().cropped(0, 4).toBytes() + abiInAux(_t ...);
+	bytes ret(c_abiSelectorSize + ABISize<T ...>::value);
+	abiIn(bytesRef(&ret), _selector, _t ...);
+	return ret;
 }
 
+template <class ... T> bytes abiIn(std::string const& _id, T const& ... _t)
+{
+	return abiIn(abiSelector(_id), _t ...);
+}
+
+/**
+ * @brief A function of a contract taking the parameters T ..., to be called many times.
+ * Its selector is hashed once, and each call is written in one go into a buffer of the size known at compile time;
+ * encode() writes into one the caller keeps, for those that make calls by the million.
+ */
+template <class ... T> class ABIFunction
+{
+public:
+	static const unsigned size = c_abiSelectorSize + ABISize<T ...>::value;
+
+	explicit ABIFunction(std::string const& _signature): m_selector(abiSelector(_signature)) {}
+
+	bytes operator()(T const& ... _t) const { return abiIn(m_selector, _t ...); }
+	/// Writes the call with the parameters @a _t ... into @a o_out, which must be size bytes.
+	void encode(bytesRef o_out, T const& ... _t) const { abiIn(o_out, m_selector, _t ...); }
+
+	FixedHash<4> const& selector() const { return m_selector; }
+
+private:
+	FixedHash<4> m_selector;
+};
+
+/// Reads the parameters of static type T, each from the front of io_t, which is moved past it. What is missing of
+/// io_t reads as zero.
 template <class T> struct ABIDeserialiser {};
 template <unsigned N> struct ABIDeserialiser<FixedHash<N>> { static FixedHash<N> deserialise(bytesConstRef& io_t) { static_assert(N <= 32, "Parameter sizes must be at most 32 bytes."); FixedHash<N> ret; io_t.cropped(32 - N, N).populate(ret.ref()); io_t = io_t.cropped(32); return ret; } };
 template <> struct ABIDeserialiser<u256> { static u256 deserialise(bytesConstRef& io_t) { u256 ret = fromBigEndian<u256>(io_t.cropped(0, 32)); io_t = io_t.cropped(32); return ret; } };
 template <> struct ABIDeserialiser<u160> { static u160 deserialise(bytesConstRef& io_t) { u160 ret = fromBigEndian<u160>(io_t.cropped(12, 20)); io_t = io_t.cropped(32); return ret; } };
 template <> struct ABIDeserialiser<string32> { static string32 deserialise(bytesConstRef& io_t) { string32 ret; io_t.cropped(0, 32).populate(bytesRef((byte*)ret.data(), 32)); io_t = io_t.cropped(32); return ret; } };
+template <> struct ABIDeserialiser<bool> { static bool deserialise(bytesConstRef& io_t) { bool ret = io_t.size() >= 32 && io_t[31]; io_t = io_t.cropped(32); return ret; } };
+
+template <unsigned I, class Tuple> struct ABITupleDeserialiser
+{
+	static void deserialise(bytesConstRef& io_t, Tuple& o_t)
+	{
+		ABITupleDeserialiser<I - 1, Tuple>::deserialise(io_t, o_t);
+		std::get<I - 1>(o_t) = ABIDeserialiser<typename std::tuple_element<I - 1, Tuple>::type>::deserialise(io_t);
+	}
+};
+template <class Tuple> struct ABITupleDeserialiser<0, Tuple> { static void deserialise(bytesConstRef&, Tuple&) {} };
+
+template <class T> T abiOut(bytesConstRef _data)
+{
+	return ABIDeserialiser<T>::deserialise(_data);
+}
 
 template <class T> T abiOut(bytes const& _data)
 {
-	bytesConstRef o(&_data);
-	return ABIDeserialiser<T>::deserialise(o);
+	return abiOut<T>(bytesConstRef(&_data));
+}
+
+/// @returns the values T ... that @a _data, the output of a call or the data of a log, holds in turn; read in place.
+template <class ... T> std::tuple<T ...> abiOutTuple(bytesConstRef _data)
+{
+	std::tuple<T ...> ret;
+	ABITupleDeserialiser<sizeof ... (T), std::tuple<T ...>>::deserialise(_data, ret);
+	return ret;
 }
 
 }
@@ -0,0 +1,57 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file AccessSet.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <map>
+#include <set>
+#include <libdevcore/Common.h>
+#include <libdevcrypto/Common.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief The state a transaction touched: each account (its balance, nonce or existence) and storage slot, as read,
+ * written or both, and each account whose code was read. Reads and writes in call frames which were reverted count.
+ */
+struct AccessSet
+{
+	enum Kind: byte
+	{
+		Read = 1,
+		Written = 2
+	};
+
+	void noteAccount(Address const& _a, Kind _k) { accounts[_a] |= _k; }
+	void noteStorage(Address const& _a, u256 const& _key, Kind _k) { storage[std::make_pair(_a, _key)] |= _k; }
+	void noteCode(Address const& _a) { code.insert(_a); }
+
+	bool empty() const { return accounts.empty() && storage.empty() && code.empty(); }
+
+	std::map<Address, byte> accounts;					///< Kinds of access, or'd together.
+	std::map<std::pair<Address, u256>, byte> storage;	///< Kinds of access, or'd together.
+	std::set<Address> code;
+};
+
+}
+}
@@ -28,3 +28,23 @@ using namespace dev::eth;
 #pragma GCC diagnostic ignored "-Wunused-variable"
 
 const h256 Account::c_contractConceptionCodeHash;
+
+Account Account::changes() const
+{
+	Account ret = *this;
+	ret.m_storageOverlay.clear();
+	m_storageOverlay.forEach([&](StorageOverlay::Slot const& _s)
+	{
+		if (_s.dirty())
+			ret.m_storageOverlay.set(_s.key, _s.value);
+	});
+	return ret;
+}
+
+void Account::settle()
+{
+	if (isFreshCode())
+		m_codeHash = sha3(code());
+	m_storageOverlay.settle();
+	m_isUnchanged = true;
+}
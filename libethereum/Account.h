@@ -25,6 +25,8 @@
 #include <libdevcore/RLP.h>
 #include <libdevcrypto/TrieDB.h>
 #include <libdevcrypto/SHA3.h>
+#include <libethcore/CodeStore.h>
+#include "StorageOverlay.h"
 
 namespace dev
 {
@@ -42,7 +44,7 @@ namespace eth
  * For the account's storage, the class operates a cache. baseRoot() specifies the base state of the storage
  * given as the Trie root to be looked up in the state database. Alterations beyond this base are specified
  * in the overlay, stored in this class and retrieved with storageOverlay(). setStorage allows the overlay
- * to be altered.
+ * to be altered, and noteStorage() caches a value read from the trie, which only a later change makes dirty.
  *
  * The code handling explicitly supports a two-stage commit model needed for contract-creation. When creating
  * a contract (running the initialisation code), the code of the account is considered empty. The attribute
@@ -54,7 +56,7 @@ namespace eth
  * The code can be retrieved through code(), and its hash through codeHash(). codeHash() is only valid when
  * the account is not in the contract-creation phase (i.e. when isFreshCode() returns false). This class
  * supports populating code on-demand from the state database. To determine if the code has been prepopulated
- * call codeCacheValid(). To populate the code, look it up with codeHash() and populate with noteCode().
+ * call codeCacheValid(). To populate the code, get it from CodeStore by codeHash() and populate with noteCode().
  *
  * @todo: need to make a noteCodeCommitted().
  *
@@ -134,12 +136,14 @@ public:
 	/// which encodes the base-state of the account's storage (upon which the storage is overlaid).
 	h256 baseRoot() const { assert(m_storageRoot); return m_storageRoot; }
 
-	/// @returns the storage overlay as a simple map.
-	std::map<u256, u256> const& storageOverlay() const { return m_storageOverlay; }
+	/// @returns the storage overlay, with the original value of each slot read from the trie.
+	StorageOverlay const& storageOverlay() const { return m_storageOverlay; }
 
 	/// Set a key/value pair in the account's storage. This actually goes into the overlay, for committing
 	/// to the trie later.
-	void setStorage(u256 _p, u256 _v) { m_storageOverlay[_p] = _v; changed(); }
+	void setStorage(u256 _p, u256 _v) { m_storageOverlay.set(_p, _v); changed(); }
+	/// Cache @a _v as read from the storage trie at @a _p. Leaves the account as dirty as it was.
+	void noteStorage(u256 _p, u256 _v) { m_storageOverlay.load(_p, _v); }
 
 	/// @returns true if we are in the contract-conception state and setCode is valid to call.
 	bool isFreshCode() const { return m_codeHash == c_contractConceptionCodeHash; }
@@ -152,18 +156,34 @@ public:
 	h256 codeHash() const { assert(!isFreshCode()); return m_codeHash; }
 
 	/// Sets the code of the account. Must only be called when isFreshCode() returns true.
-	void setCode(bytes&& _code) { assert(isFreshCode()); m_codeCache = _code; changed(); }
-	void setCode(bytes const& _code) { assert(isFreshCode()); m_codeCache = _code; changed(); }
+	void setCode(bytes&& _code) { assert(isFreshCode()); m_code = std::make_shared<bytes const>(std::move(_code)); changed(); }
+	void setCode(bytes const& _code) { assert(isFreshCode()); m_code = std::make_shared<bytes const>(_code); changed(); }
 
 	/// @returns true if the account's code is available through code().
-	bool codeCacheValid() const { return m_codeHash == EmptySHA3 || m_codeHash == c_contractConceptionCodeHash || m_codeCache.size(); }
+	bool codeCacheValid() const { return m_codeHash == EmptySHA3 || m_codeHash == c_contractConceptionCodeHash || m_code; }
 
 	/// Specify to the object what the actual code is for the account. @a _code must have a SHA3 equal to
 	/// codeHash() and must only be called when isFreshCode() returns false.
-	void noteCode(bytesConstRef _code) { assert(sha3(_code) == m_codeHash); m_codeCache = _code.toBytes(); }
+	void noteCode(SharedCode _code) { assert(sha3(*_code) == m_codeHash); m_code = std::move(_code); }
 
 	/// @returns the account's code. Must only be called when codeCacheValid returns true.
-	bytes const& code() const { assert(codeCacheValid()); return m_codeCache; }
+	bytes const& code() const { assert(codeCacheValid()); return m_code ? *m_code : *CodeStore::empty(); }
+	/// @returns the account's code, to be shared rather than copied. Must only be called when codeCacheValid returns true.
+	SharedCode sharedCode() const { assert(codeCacheValid()); return m_code ? m_code : CodeStore::empty(); }
+
+	/// Undo a change to the balance, nonce or a storage slot, as recorded by State's journal, restoring whether the
+	/// account was dirty too. A null @a _v removes @a _p from the overlay.
+	void restoreBalance(u256 _b, bool _dirty) { m_balance = _b; m_isUnchanged = !_dirty; }
+	void restoreNonce(u256 _n, bool _dirty) { m_nonce = _n; m_isUnchanged = !_dirty; }
+	void restoreStorage(u256 _p, u256 const* _v, bool _dirty) { if (_v) m_storageOverlay.set(_p, *_v); else m_storageOverlay.erase(_p); m_isUnchanged = !_dirty; }
+
+	/// @returns a copy of the account with only the dirty slots of its overlay, enough to commit it.
+	Account changes() const;
+	/// Marks the account and its slots unchanged, as though committed, while keeping them cached. Fresh code
+	/// takes its hash.
+	void settle();
+	/// Sets the root of the storage under the overlay, once what was settle()d has been committed into it.
+	void rebase(h256 const& _storageRoot) { m_storageRoot = _storageRoot; }
 
 private:
 	/// Note that we've altered the account.
@@ -193,17 +213,25 @@ private:
 	 */
 	h256 m_codeHash = EmptySHA3;
 
-	/// The map with is overlaid onto whatever storage is implied by the m_storageRoot in the trie.
-	std::map<u256, u256> m_storageOverlay;
+	/// The slots which are overlaid onto whatever storage is implied by the m_storageRoot in the trie.
+	StorageOverlay m_storageOverlay;
 
-	/// The associated code for this account. The SHA3 of this should be equal to m_codeHash unless m_codeHash
-	/// equals c_contractConceptionCodeHash.
-	bytes m_codeCache;
+	/// The associated code for this account, if known; shared with CodeStore and any VM running it. The SHA3 of
+	/// this should be equal to m_codeHash unless m_codeHash equals c_contractConceptionCodeHash.
+	SharedCode m_code;
 
 	/// Value for m_codeHash when this account is having its code determined.
 	static const h256 c_contractConceptionCodeHash;
 };
 
+/// Merkle proof of an account, and of some of its storage slots, against a state root; see verifyTrieProof().
+struct StateProof
+{
+	h256 root;
+	std::vector<bytes> account;								///< Proves the account's RLP, or its absence, under sha3(address).
+	std::vector<std::pair<u256, std::vector<bytes>>> storage;	///< Each slot asked for, and the proof of its value under sha3(slot) against the account's storage root.
+};
+
 }
 }
 
@@ -0,0 +1,148 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file BlockArchive.cpp
+ * @date 2015
+ */
+
+#include "BlockArchive.h"
+#include <fstream>
+#include <future>
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/Snappy.h>
+#include <libdevcore/ThreadPool.h>
+#include "BlockChain.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+static char const* const c_snappyMagic = "ethereum-blocks-snappy";
+/// The most a frame may uncompress to.
+static const size_t c_maxFrameSize = 256 * 1024 * 1024;
+/// About how much of a compressed archive is uncompressed for each call of the reader's callback.
+static const size_t c_readBatch = 16 * 1024 * 1024;
+
+bool dev::eth::writeBlockArchive(BlockChain const& _bc, unsigned _from, unsigned _to, string const& _path, ArchiveFormat _format)
+{
+	ofstream out(_path, ofstream::binary);
+	if (!out)
+		return false;
+	if (_format == ArchiveFormat::Snappy)
+	{
+		bytes magic = rlp(string(c_snappyMagic));
+		out.write((char const*)magic.data(), magic.size());
+	}
+
+	auto readFrame = [&](unsigned _first)
+	{
+		vector<bytes> ret;
+		for (unsigned n = _first; n <= _to && n - _first < c_archiveFrame; ++n)
+			ret.push_back(_bc.block(_bc.numberHash(n)));
+		return ret;
+	};
+
+	RLPStream index;
+	unsigned frames = 0;
+	future<vector<bytes>> next = async(launch::async, readFrame, _from);
+	for (unsigned first = _from; first <= _to && first >= _from; first += c_archiveFrame, ++frames)
+	{
+		vector<bytes> frame = next.get();
+		if (_to - first >= c_archiveFrame)
+			next = async(launch::async, readFrame, first + c_archiveFrame);
+
+		index.appendList(2) << first << (uint64_t)out.tellp();
+		if (_format == ArchiveFormat::Binary)
+			for (bytes const& b: frame)
+				out.write((char const*)b.data(), b.size());
+		else
+		{
+			bytes raw;
+			for (bytes const& b: frame)
+				raw += b;
+			RLPStream s(3);
+			s << first << frame.size() << snappyCompress(&raw);
+			out.write((char const*)s.out().data(), s.out().size());
+		}
+	}
+	out.close();
+
+	RLPStream list;
+	list.appendList(frames);
+	list.appendRaw(index.out(), frames);
+	writeFile(_path + ".index", list.out());
+	return !out.fail();
+}
+
+bool dev::eth::writeBlockArchives(BlockChain const& _bc, unsigned _from, unsigned _to, string const& _path, ArchiveFormat _format, unsigned _shards)
+{
+	unsigned total = _to - _from + 1;
+	// Whole frames to each, so that the shards' frames are those one archive of the range would have.
+	unsigned each = (total + _shards - 1) / max(_shards, 1u);
+	each = (each + c_archiveFrame - 1) / c_archiveFrame * c_archiveFrame;
+	vector<char> ok(_shards, true);
+	ThreadPool::get().forEach(_shards, [&](unsigned i)
+	{
+		if (i * each < total)
+			ok[i] = writeBlockArchive(_bc, _from + i * each, _from + min(total, (i + 1) * each) - 1, _path + "." + toString(i), _format);
+	});
+	return find(ok.begin(), ok.end(), false) == ok.end();
+}
+
+bool dev::eth::readBlockArchive(bytesConstRef _archive, function<bool(bytesConstRef)> const& _f, bytesConstRef _index, unsigned _from)
+{
+	size_t offset = 0;
+	if (!_index.empty())
+		for (auto const& entry: RLP(_index, RLP::LaisezFaire))
+		{
+			if (entry[0].toInt<unsigned>() > _from)
+				break;
+			offset = entry[1].toInt<uint64_t>();
+		}
+
+	// Blocks are RLP lists; a compressed archive starts with a string.
+	if (_archive.empty() || _archive[0] >= 0xc0)
+	{
+		if (offset > _archive.size())
+			return false;
+		_f(_archive.cropped(offset));
+		return true;
+	}
+
+	RLP magic(_archive, RLP::LaisezFaire);
+	if (!magic.isData() || magic.toString() != c_snappyMagic)
+		return false;
+	bytes batch;
+	for (size_t pos = max<size_t>(offset, magic.actualSize()); pos < _archive.size();)
+	{
+		RLP frame(_archive.cropped(pos), RLP::LaisezFaire);
+		size_t size = frame.actualSize();
+		if (!frame.isList() || frame.itemCount() != 3 || !size || size > _archive.size() - pos)
+			return false;
+		if (!snappyUncompress(frame[2].toBytesConstRef(), batch, c_maxFrameSize))
+			return false;
+		pos += size;
+		if (batch.size() >= c_readBatch)
+		{
+			if (!_f(&batch))
+				return true;
+			batch.clear();
+		}
+	}
+	if (!batch.empty())
+		_f(&batch);
+	return true;
+}
@@ -0,0 +1,59 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file BlockArchive.h
+ * @date 2015
+ * Files of consecutive blocks of the chain, as exported for bulk import elsewhere.
+ */
+
+#pragma once
+
+#include <functional>
+#include <string>
+#include <libdevcore/Common.h>
+
+namespace dev
+{
+namespace eth
+{
+
+class BlockChain;
+
+enum class ArchiveFormat
+{
+	Binary,		///< The blocks' RLP, concatenated.
+	Snappy		///< A magic RLP string, then frames: RLP lists of [first number, count, the blocks' RLP concatenated and compressed].
+};
+
+/// Blocks in each frame of an archive, and so between the entries of its index.
+static const unsigned c_archiveFrame = 256;
+
+/// Writes blocks @a _from to @a _to, inclusive, of @a _bc to @a _path in @a _format, reading each frame of them
+/// while the one before is compressed and written. An index goes to @a _path + ".index": an RLP list of
+/// [first number, offset in the file] for each frame. @returns false if the files could not be written.
+bool writeBlockArchive(BlockChain const& _bc, unsigned _from, unsigned _to, std::string const& _path, ArchiveFormat _format);
+
+/// Writes blocks @a _from to @a _to in @a _shards archives of consecutive ranges, "<_path>.0" onwards, in parallel.
+/// @returns false if any could not be written.
+bool writeBlockArchives(BlockChain const& _bc, unsigned _from, unsigned _to, std::string const& _path, ArchiveFormat _format, unsigned _shards);
+
+/// Calls @a _f with the blocks of @a _archive, of either format, concatenated, some frames at a time, until it
+/// returns false. Given the archive's @a _index, starts at the frame holding block @a _from rather than the first.
+/// @returns false if the archive is malformed.
+bool readBlockArchive(bytesConstRef _archive, std::function<bool(bytesConstRef)> const& _f, bytesConstRef _index = bytesConstRef(), unsigned _from = 0);
+
+}
+}
@@ -24,14 +24,17 @@
 #if ETH_PROFILING_GPERF
 #include <gperftools/profiler.h>
 #endif
-#include <leveldb/db.h>
+#include <condition_variable>
+#include <thread>
 #include <boost/timer.hpp>
 #include <boost/filesystem.hpp>
 #include <test/JsonSpiritHeaders.h>
 #include <libdevcore/Common.h>
 #include <libdevcore/Assertions.h>
+#include <libdevcore/Metrics.h>
 #include <libdevcore/RLP.h>
 #include <libdevcore/StructuredLogger.h>
+#include <libdevcore/ThreadPool.h>
 #include <libdevcrypto/FileSystem.h>
 #include <libethcore/Exceptions.h>
 #include <libethcore/ProofOfWork.h>
@@ -49,73 +52,307 @@ namespace js = json_spirit;
 #define ETH_CATCH 1
 #define ETH_TIMED_IMPORTS 0
 
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Writes the blocks and extras of imports to their DBs, either straight away or on its own thread.
+ * Queued batches are kept in memory, and searched by lookups, until they are durable.
+ * @threadsafe
+ */
+class BlockChain::Writer
+{
+public:
+	struct Batch
+	{
+		std::map<bytes, bytes> blocks;
+		std::map<bytes, bytes> extras;
+
+		void insertBlock(bytesConstRef _key, bytesConstRef _value) { blocks[_key.toBytes()] = _value.toBytes(); }
+		void insertExtra(bytesConstRef _key, bytesConstRef _value) { extras[_key.toBytes()] = _value.toBytes(); }
+	};
+
+	/// The most batches queued at once; imports wait for the writer beyond this.
+	static const unsigned c_maxQueued = 64;
+	/// The entries a merged batch gathers before it is written.
+	static const unsigned c_bulkEntries = 1 << 16;
+
+	Writer(shared_ptr<KeyValueDB> const& _blocksDB, shared_ptr<KeyValueDB> const& _extrasDB): m_blocksDB(_blocksDB), m_extrasDB(_extrasDB) {}
+	~Writer() { setAsync(false); }
+
+	/// Starts or stops the writer thread; stopping it writes what is queued first. Not to be called concurrently with itself.
+	void setAsync(bool _async);
+	/// Starts or stops merging the batches written into one, which is written once it holds c_bulkEntries entries
+	/// or on flush(). Stopping writes what is merged first.
+	void setBulk(bool _bulk);
+	void write(shared_ptr<Batch const> const& _b);
+	void flush();
+
+	bool lookupBlock(bytesConstRef _key, string& o_v) const { return lookup(&Batch::blocks, _key, o_v); }
+	bool lookupExtra(bytesConstRef _key, string& o_v) const { return lookup(&Batch::extras, _key, o_v); }
+
+private:
+	bool lookup(std::map<bytes, bytes> Batch::* _m, bytesConstRef _key, string& o_v) const;
+	/// Queues or, if not async, writes @a _b; @a _l is held on entry but may not be on return.
+	void enqueue(unique_lock<Mutex>& _l, shared_ptr<Batch const> const& _b);
+	void writeNow(Batch const& _b);
+	void run();
+
+	shared_ptr<KeyValueDB> m_blocksDB;
+	shared_ptr<KeyValueDB> m_extrasDB;
+
+	mutable Mutex x_queue;
+	deque<shared_ptr<Batch const>> m_queue;		///< Oldest first; the front one is being written.
+	Condition m_queued;								///< Signalled when a batch is queued or the thread is to stop.
+	Condition m_written;							///< Signalled when a batch has been written.
+	shared_ptr<Batch> m_bulk;						///< The batches merged so far, if merging; newer than any queued.
+	bool m_async = false;
+	bool m_stop = false;
+	std::thread m_thread;
+};
+
+}
+}
+
+void BlockChain::Writer::setAsync(bool _async)
+{
+	if (_async)
+	{
+		Guard l(x_queue);
+		if (!m_async)
+		{
+			m_async = true;
+			m_stop = false;
+			m_thread = std::thread([=](){ run(); });
+		}
+	}
+	else
+	{
+		{
+			Guard l(x_queue);
+			if (!m_async)
+				return;
+			m_async = false;
+			m_stop = true;
+		}
+		m_queued.notify_all();
+		m_thread.join();
+	}
+}
+
+void BlockChain::Writer::setBulk(bool _bulk)
+{
+	if (_bulk)
+	{
+		Guard l(x_queue);
+		if (!m_bulk)
+			m_bulk = make_shared<Batch>();
+	}
+	else
+	{
+		flush();
+		Guard l(x_queue);
+		m_bulk.reset();
+	}
+}
+
+void BlockChain::Writer::write(shared_ptr<Batch const> const& _b)
+{
+	unique_lock<Mutex> l(x_queue);
+	if (m_bulk)
+	{
+		for (auto const& i: _b->blocks)
+			m_bulk->blocks[i.first] = i.second;
+		for (auto const& i: _b->extras)
+			m_bulk->extras[i.first] = i.second;
+		if (m_bulk->blocks.size() + m_bulk->extras.size() < c_bulkEntries)
+			return;
+		shared_ptr<Batch const> b = m_bulk;
+		m_bulk = make_shared<Batch>();
+		enqueue(l, b);
+	}
+	else
+		enqueue(l, _b);
+}
+
+void BlockChain::Writer::enqueue(unique_lock<Mutex>& _l, shared_ptr<Batch const> const& _b)
+{
+	if (m_async)
+	{
+		m_written.wait(_l, [&](){ return m_queue.size() < c_maxQueued; });
+		m_queue.push_back(_b);
+		m_queued.notify_all();
+	}
+	else
+	{
+		// Anything still queued from before must land first.
+		m_written.wait(_l, [&](){ return m_queue.empty(); });
+		_l.unlock();
+		writeNow(*_b);
+	}
+}
+
+void BlockChain::Writer::flush()
+{
+	unique_lock<Mutex> l(x_queue);
+	if (m_bulk && (!m_bulk->blocks.empty() || !m_bulk->extras.empty()))
+	{
+		shared_ptr<Batch const> b = m_bulk;
+		m_bulk = make_shared<Batch>();
+		enqueue(l, b);
+		if (!l.owns_lock())
+			l.lock();
+	}
+	m_written.wait(l, [&](){ return m_queue.empty(); });
+}
+
+bool BlockChain::Writer::lookup(std::map<bytes, bytes> Batch::* _m, bytesConstRef _key, string& o_v) const
+{
+	Guard l(x_queue);
+	bytes k = _key.toBytes();
+	if (m_bulk)
+	{
+		auto it = ((*m_bulk).*_m).find(k);
+		if (it != ((*m_bulk).*_m).end())
+		{
+			o_v = asString(it->second);
+			return true;
+		}
+	}
+	for (auto b = m_queue.rbegin(); b != m_queue.rend(); ++b)
+	{
+		auto it = ((**b).*_m).find(k);
+		if (it != ((**b).*_m).end())
+		{
+			o_v = asString(it->second);
+			return true;
+		}
+	}
+	return false;
+}
+
+void BlockChain::Writer::writeNow(Batch const& _b)
+{
+	// Blocks first, so that no extra refers to a block that is not on disk.
+	if (!_b.blocks.empty())
+	{
+		auto batch = m_blocksDB->batch();
+		for (auto const& i: _b.blocks)
+			batch->insert(&i.first, &i.second);
+		m_blocksDB->write(*batch);
+	}
+	if (!_b.extras.empty())
+	{
+		auto batch = m_extrasDB->batch();
+		for (auto const& i: _b.extras)
+			batch->insert(&i.first, &i.second);
+		m_extrasDB->write(*batch);
+	}
+}
+
+void BlockChain::Writer::run()
+{
+	while (true)
+	{
+		shared_ptr<Batch const> b;
+		{
+			unique_lock<Mutex> l(x_queue);
+			m_queued.wait(l, [&](){ return m_stop || !m_queue.empty(); });
+			if (m_queue.empty())
+				return;
+			b = m_queue.front();
+		}
+		writeNow(*b);
+		{
+			Guard l(x_queue);
+			m_queue.pop_front();
+		}
+		m_written.notify_all();
+	}
+}
+
 std::ostream& dev::eth::operator<<(std::ostream& _out, BlockChain const& _bc)
 {
 	string cmp = toBigEndianString(_bc.currentHash());
-	auto it = _bc.m_blocksDB->NewIterator(_bc.m_readOptions);
-	for (it->SeekToFirst(); it->Valid(); it->Next())
-		if (it->key().ToString() != "best")
+	_bc.m_writer->flush();
+	_bc.m_blocksDB->forEach([&](bytesConstRef _key, bytesConstRef _value)
+	{
+		if (_key.toString() != "best")
 		{
 			try {
-				BlockInfo d(bytesConstRef(it->value()));
-				_out << toHex(it->key().ToString()) << ":   " << d.number << " @ " << d.parentHash << (cmp == it->key().ToString() ? "  BEST" : "") << std::endl;
+				BlockInfo d(_value);
+				_out << toHex(_key.toString()) << ":   " << d.number << " @ " << d.parentHash << (cmp == _key.toString() ? "  BEST" : "") << std::endl;
 			}
 			catch (...) {
-				cwarn << "Invalid DB entry:" << toHex(it->key().ToString()) << " -> " << toHex(bytesConstRef(it->value()));
+				cwarn << "Invalid DB entry:" << toHex(_key.toString()) << " -> " << toHex(_value);
 			}
 		}
-	delete it;
+		return true;
+	});
 	return _out;
 }
 
-ldb::Slice dev::eth::toSlice(h256 const& _h, unsigned _sub)
+bytesConstRef dev::eth::toSlice(h256 const& _h, unsigned _sub)
 {
 #if ALL_COMPILERS_ARE_CPP11_COMPLIANT
 	static thread_local h256 h = _h ^ sha3(h256(u256(_sub)));
-	return ldb::Slice((char const*)&h, 32);
+	return h.ref();
 #else
 	static boost::thread_specific_ptr<FixedHash<33>> t_h;
 	if (!t_h.get())
 		t_h.reset(new FixedHash<33>);
 	*t_h = FixedHash<33>(_h);
 	(*t_h)[32] = (uint8_t)_sub;
-	return (ldb::Slice)t_h->ref();//(char const*)t_h.get(), 32);
+	return t_h->ref();
 #endif
 }
 
 #if ETH_DEBUG
-static const chrono::system_clock::duration c_collectionDuration = chrono::seconds(15);
-static const unsigned c_collectionQueueSize = 2;
 static const unsigned c_maxCacheSize = 1024 * 1024 * 1;
-static const unsigned c_minCacheSize = 1;
 #else
 
-/// Duration between flushes.
-static const chrono::system_clock::duration c_collectionDuration = chrono::seconds(60);
-
-/// Length of death row (total time in cache is multiple of this and collection duration).
-static const unsigned c_collectionQueueSize = 20;
-
-/// Max size, above which we start forcing cache reduction.
+/// Total size of the caches, unless set by Defaults::setCacheSize().
 static const unsigned c_maxCacheSize = 1024 * 1024 * 64;
 
-/// Min size, below which we don't bother flushing it.
-static const unsigned c_minCacheSize = 1024 * 1024 * 32;
-
 #endif
 
-BlockChain::BlockChain(bytes const& _genesisBlock, std::string _path, WithExisting _we, ProgressCallback const& _p)
+/// Sixteenths of the cache budget given to each cache.
+static const unsigned c_blocksShare = 6;
+static const unsigned c_receiptsShare = 3;
+static const unsigned c_extraShare = 1;
+
+/// The uncle hashes cache, outside the budget: it needs hold only those of the last few blocks, and there are few.
+static const size_t c_uncleHashesCacheSize = 1024 * 256;
+/// The headers cache, likewise outside the budget; about two thousand headers.
+static const size_t c_headersCacheSize = 1024 * 1024;
+
+/// Blocks verified together in parallel ahead of their execution when importing in bulk or rebuilding.
+static const unsigned c_importChunk = 256;
+
+BlockChain::BlockChain(bytes const& _genesisBlock, std::string _path, WithExisting _we, ProgressCallback const& _p):
+	m_blocks(0),
+	m_details(0),
+	m_logBlooms(0),
+	m_receipts(0),
+	m_transactionAddresses(0),
+	m_blockHashes(0),
+	m_blocksBlooms(0),
+	m_bloomBits(0),
+	m_logIndex(0),
+	m_uncleHashes(c_uncleHashesCacheSize),
+	m_headers(c_headersCacheSize)
 {
-	// initialise deathrow.
-	m_cacheUsage.resize(c_collectionQueueSize);
-	m_lastCollection = chrono::system_clock::now();
+	setLockName(x_lastBlockHash, "BlockChain::x_lastBlockHash");
+	setCacheSize(Defaults::get()->m_cacheSize ? Defaults::get()->m_cacheSize : c_maxCacheSize);
 
 	// Initialise with the genesis as the last block on the longest chain.
-	m_genesisBlock = _genesisBlock;
-	m_genesisHash = sha3(RLP(m_genesisBlock)[0].data());
+	m_genesisBlock = make_shared<bytes const>(_genesisBlock);
+	m_genesisHash = sha3(RLP(_genesisBlock)[0].data());
 
 	open(_path, _we);
-	if (_we == WithExisting::Verify)
+	if (_we == WithExisting::Verify || !m_extrasDB->lookup(bytesConstRef("rebuild")).empty())
 		rebuild(_path, _p);
 }
 
@@ -127,18 +364,21 @@ BlockChain::~BlockChain()
 void BlockChain::open(std::string const& _path, WithExisting _we)
 {
 	std::string path = _path.empty() ? Defaults::get()->m_dbPath : _path;
-	boost::filesystem::create_directories(path);
-	if (_we == WithExisting::Kill)
+	DBOptions const& o = Defaults::dbOptions(DBRole::Blocks);
+	bool inMemory = o.backend == DBBackend::Memory || isMemoryDBPath(path);
+	if (!inMemory)
 	{
-		boost::filesystem::remove_all(path + "/blocks");
-		boost::filesystem::remove_all(path + "/details");
+		boost::filesystem::create_directories(path);
+		if (_we == WithExisting::Kill)
+		{
+			boost::filesystem::remove_all(path + "/blocks");
+			boost::filesystem::remove_all(path + "/details");
+			boost::filesystem::remove(path + "/canon");
+		}
 	}
 
-	ldb::Options o;
-	o.create_if_missing = true;
-	ldb::DB::Open(o, path + "/blocks", &m_blocksDB);
-	ldb::DB::Open(o, path + "/details", &m_extrasDB);
-	if (!m_blocksDB || !m_extrasDB)
+	auto dbs = KeyValueDB::open(path, {"blocks", "details"}, {o, Defaults::dbOptions(DBRole::Extras)});
+	if (dbs.empty())
 	{
 		if (boost::filesystem::space(path + "/blocks").available < 1024)
 		{
@@ -151,33 +391,63 @@ void BlockChain::open(std::string const& _path, WithExisting _we)
 			BOOST_THROW_EXCEPTION(DatabaseAlreadyOpen());
 		}
 	}
+	m_blocksDB = dbs[0];
+	m_extrasDB = dbs[1];
+	m_writer.reset(new Writer(m_blocksDB, m_extrasDB));
+	m_writer->setAsync(m_asyncCommit);
 
 	if (_we != WithExisting::Verify && !details(m_genesisHash))
 	{
 		// Insert details of genesis block.
-		m_details[m_genesisHash] = BlockDetails(0, c_genesisDifficulty, h256(), {});
-		auto r = m_details[m_genesisHash].rlp();
-		m_extrasDB->Put(m_writeOptions, toSlice(m_genesisHash, ExtraDetails), (ldb::Slice)dev::ref(r));
+		BlockDetails d(0, c_genesisDifficulty, h256(), {});
+		auto r = d.compact();
+		m_details.insert(m_genesisHash, d);
+		m_extrasDB->insert(toSlice(m_genesisHash, ExtraDetails), dev::ref(r));
 	}
 
-#if ETH_PARANOIA
-	checkConsistency();
-#endif
+	// Only a clean shutdown leaves the marker; otherwise the blocks last imported may be half written. An interrupted
+	// rebuild leaves blocks without details until it resumes, so is left to do its own checking.
+	bool clean = !m_extrasDB->lookup(bytesConstRef("clean")).empty();
+	if (!clean && m_extrasDB->lookup(bytesConstRef("rebuild")).empty())
+		checkJournal();
+	else
+		m_extrasDB->kill(bytesConstRef("clean"));
 
 	// TODO: Implement ability to rebuild details map from DB.
-	std::string l;
-	m_extrasDB->Get(m_readOptions, ldb::Slice("best"), &l);
+	std::string l = m_extrasDB->lookup(bytesConstRef("best"));
 	m_lastBlockHash = l.empty() ? m_genesisHash : *(h256*)l.data();
 
+	string pivot = m_extrasDB->lookup(bytesConstRef("pivot"));
+	if (!pivot.empty())
+	{
+		RLP r(pivot);
+		m_pivotHash = r[1].toHash<h256>();
+		m_pivotState = r[2].toInt<bool>();
+		m_pivot = r[0].toInt<unsigned>();
+	}
+
+	openCanonHashes(inMemory ? string() : path + "/canon", clean);
+
+	openLogIndex();
+
 	cnote << "Opened blockchain DB. Latest: " << currentHash();
 }
 
 void BlockChain::close()
 {
 	cnote << "Closing blockchain DB";
-	delete m_extrasDB;
-	delete m_blocksDB;
+	m_writer.reset();
+	m_canonCount = 0;
+	if (m_canonHashes)
+		m_canonHashes->flush();
+	m_canonHashes.reset();
+	if (m_extrasDB)
+		m_extrasDB->insert(bytesConstRef("clean"), bytesConstRef("1"));
+	m_extrasDB.reset();
+	m_blocksDB.reset();
 	m_lastBlockHash = m_genesisHash;
+	m_pivot = 0;
+	m_pivotState = false;
 	m_details.clear();
 	m_blocks.clear();
 }
@@ -190,22 +460,35 @@ void BlockChain::rebuild(std::string const& _path, std::function<void(unsigned,
 	ProfilerStart("BlockChain_rebuild.log");
 #endif
 
-//	unsigned originalNumber = (unsigned)BlockInfo(oldBlock(m_lastBlockHash)).number;
-	unsigned originalNumber = number();
-
-	// Keep extras DB around, but under a temp name
-	delete m_extrasDB;
-	m_extrasDB = nullptr;
-	IGNORE_EXCEPTIONS(boost::filesystem::remove_all(_path + "/details.old"));
-	boost::filesystem::rename(_path + "/details", _path + "/details.old");
-	ldb::DB* oldExtrasDB;
-	ldb::Options o;
-	o.create_if_missing = true;
-	ldb::DB::Open(o, _path + "/details.old", &oldExtrasDB);
-	ldb::DB::Open(o, _path + "/details", &m_extrasDB);
+	// Until the rebuild is done the extras hold [old best hash, old best number] at "rebuild". Meanwhile they hold the
+	// chain rebuilt so far, up to "best", whose state is in the state DB, since imports commit state before extras.
+	h256 oldBest;
+	unsigned originalNumber;
+	string record = m_extrasDB->lookup(bytesConstRef("rebuild"));
+	bool resume = !record.empty();
+	if (resume)
+	{
+		RLP r(record);
+		oldBest = r[0].toHash<h256>();
+		originalNumber = r[1].toInt<unsigned>();
+		cnote << "Resuming rebuild at #" << number() << "of" << originalNumber;
+	}
+	else
+	{
+		oldBest = currentHash();
+		originalNumber = number();
+		// Empty the extras for replay, all but the genesis and the record, in the one write.
+		auto batch = m_extrasDB->batch();
+		m_extrasDB->forEach([&](bytesConstRef _key, bytesConstRef){ batch->kill(_key); return true; });
+		bytes genesis = BlockDetails(0, c_genesisDifficulty, h256(), {}).compact();
+		batch->insert(toSlice(m_genesisHash, ExtraDetails), &genesis);
+		bytes r = rlpList(oldBest, originalNumber);
+		batch->insert(bytesConstRef("rebuild"), &r);
+		m_extrasDB->write(*batch);
+	}
 
-	// Open a fresh state DB
-	State s(State::openDB(_path, WithExisting::Kill), BaseState::CanonGenesis);
+	// Open a fresh state DB, or the one being rebuilt.
+	State s(State::openDB(_path, resume ? WithExisting::Trust : WithExisting::Kill), BaseState::CanonGenesis);
 
 	// Clear all memos ready for replay.
 	m_details.clear();
@@ -214,50 +497,184 @@ void BlockChain::rebuild(std::string const& _path, std::function<void(unsigned,
 	m_transactionAddresses.clear();
 	m_blockHashes.clear();
 	m_blocksBlooms.clear();
-	m_lastLastHashes.clear();
-	m_lastBlockHash = genesisHash();
+	m_bloomBits.clear();
+	m_logIndex.clear();
+	if (!resume)
+	{
+		m_lastBlockHash = genesisHash();
+		setCanonHash(0, genesisHash());
+	}
+	m_bloomBitsBackfill = (unsigned)-1;
+	openLogIndex();
+
+	// The old chain's hashes from where the rebuild is to its best block, walked back through the headers.
+	unsigned from = number();
+	h256s hashes(originalNumber > from ? originalNumber - from : 0);
+	h256 h = oldBest;
+	for (unsigned i = hashes.size(); i > 0; --i)
+	{
+		hashes[i - 1] = h;
+		h = info(h).parentHash;
+	}
+	if (h != currentHash())
+	{
+		cwarn << "DISJOINT CHAIN DETECTED; the old chain has" << h.abridged() << "at #" << from << "; expected" << currentHash().abridged();
+		m_extrasDB->kill(bytesConstRef("rebuild"));
+		return;
+	}
 
-	h256 lastHash = genesisHash();
+	// Blocks are verified in parallel a chunk ahead of their serial execution, and the extras merged into large
+	// writes that land at each checkpoint.
+	static const unsigned c_checkpoint = 4096;
+	m_writer->setBulk(true);
 	boost::timer t;
-	for (unsigned d = 1; d < originalNumber; ++d)
+	u256 gas;
+	for (unsigned chunk = 0; chunk < hashes.size(); chunk += c_importChunk)
 	{
-		if (!(d % 1000))
+		unsigned n = min<size_t>(c_importChunk, hashes.size() - chunk);
+		vector<bytes> blocks(n);
+		for (unsigned i = 0; i < n; ++i)
 		{
-			cerr << "\n1000 blocks in " << t.elapsed() << "s = " << (1000.0 / t.elapsed()) << "b/s" << endl;
-			t.restart();
+			blocks[i] = block(hashes[chunk + i]);
+			if ((from + chunk + i + 1) % c_ethashEpochLength == 1)
+				Ethasher::get()->full(BlockInfo(blocks[i], CheckNothing));
 		}
-		try
+		size_t done = importChunk(blocks, s.db(), gas);
+		unsigned d = from + chunk + done;
+		if ((from + chunk) / c_checkpoint != d / c_checkpoint)
 		{
-			bytes b = block(queryExtras<BlockHash, ExtraBlockHash>(h256(u256(d)), m_blockHashes, x_blockHashes, NullBlockHash, oldExtrasDB).value);
+			flush();
+			cnote << "Rebuilt to #" << d << "at" << (d - from) / t.elapsed() << "b/s";
+		}
+		if (_progress)
+			_progress(d, originalNumber);
+		if (done < n)
+			break;
+	}
 
-			BlockInfo bi(b);
-			if (bi.number % c_ethashEpochLength == 1)
-				Ethasher::get()->full(bi);
+	m_writer->setBulk(false);
+	m_extrasDB->kill(bytesConstRef("rebuild"));
 
-			if (bi.parentHash != lastHash)
-			{
-				cwarn << "DISJOINT CHAIN DETECTED; " << bi.hash().abridged() << "#" << d << " -> parent is" << bi.parentHash.abridged() << "; expected" << lastHash.abridged() << "#" << (d - 1);
-				return;
-			}
-			lastHash = bi.hash();
-			import(b, s.db(), Aversion::ImportOldBlocks);
+#if ETH_PROFILING_GPERF
+	ProfilerStop();
+#endif
+}
+
+size_t BlockChain::importChunk(vector<bytes> const& _blocks, OverlayDB const& _stateDB, u256& io_gas, Strictness _s)
+{
+	vector<exception_ptr> errors(_blocks.size());
+	vector<u256> gas(_blocks.size());
+	ThreadPool::get().forEach(_blocks.size(), [&](unsigned i)
+	{
+		try
+		{
+			BlockInfo bi(&_blocks[i], _s);
+			bi.verifyInternals(&_blocks[i]);
+			gas[i] = bi.gasUsed;
 		}
 		catch (...)
 		{
-			// Failed to import - stop here.
-			break;
+			errors[i] = current_exception();
 		}
+	});
 
-		if (_progress)
-			_progress(d, originalNumber);
+	for (size_t i = 0; i < _blocks.size(); ++i)
+		try
+		{
+			if (errors[i])
+				rethrow_exception(errors[i]);
+			import(_blocks[i], _stateDB, Aversion::ImportOldBlocks, true);
+			io_gas += gas[i];
+		}
+		catch (...)
+		{
+			cwarn << "Import of" << BlockInfo::headerHash(_blocks[i]) << "failed:" << boost::current_exception_diagnostic_information();
+			return i;
+		}
+	return _blocks.size();
+}
+
+BlockChain::BulkImport BlockChain::importBulk(bytesConstRef _blocks, OverlayDB const& _stateDB, Strictness _s)
+{
+	BulkImport ret;
+	m_writer->setBulk(true);
+	vector<bytes> chunk;
+	while (!ret.stopped && !_blocks.empty())
+	{
+		// Slice off a chunk of blocks not yet known.
+		chunk.clear();
+		while (chunk.size() < c_importChunk && !_blocks.empty())
+		{
+			bytesConstRef b = _blocks.cropped(0, RLP(_blocks, RLP::LaisezFaire).actualSize());
+			if (b.empty())
+			{
+				cwarn << "Malformed block data at the end:" << _blocks.size() << "bytes left.";
+				ret.stopped = true;
+				break;
+			}
+			_blocks = _blocks.cropped(b.size());
+			if (isKnown(BlockInfo::headerHash(b)))
+				ret.alreadyHave++;
+			else
+				chunk.push_back(b.toBytes());
+		}
+		size_t done = importChunk(chunk, _stateDB, ret.gasUsed, _s);
+		ret.imported += done;
+		ret.stopped = ret.stopped || done < chunk.size();
 	}
+	m_writer->setBulk(false);
+	return ret;
+}
 
-#if ETH_PROFILING_GPERF
-	ProfilerStop();
-#endif
+void BlockChain::setAsyncCommit(bool _async)
+{
+	m_asyncCommit = _async;
+	if (m_writer)
+		m_writer->setAsync(_async);
+}
+
+void BlockChain::flush()
+{
+	if (m_writer)
+		m_writer->flush();
+}
+
+void BlockChain::setPivot(unsigned _pivot, h256 const& _hash)
+{
+	{
+		Guard l(x_pivot);
+		m_pivotHash = _hash;
+	}
+	m_pivotState = false;
+	m_pivot = _pivot;
+	bytes r = rlpList(_pivot, _hash, false);
+	m_extrasDB->insert(bytesConstRef("pivot"), &r);
+	clog(BlockChainNote) << "Fast syncing to #" << _pivot << _hash.abridged();
+}
+
+void BlockChain::notePivotState()
+{
+	m_pivotState = true;
+	bytes r = rlpList(pivot(), pivotHash(), true);
+	m_extrasDB->insert(bytesConstRef("pivot"), &r);
+	clog(BlockChainNote) << "Fast sync has the state of #" << pivot() << "; importing on from there.";
+}
 
-	delete oldExtrasDB;
-	boost::filesystem::remove_all(_path + "/details.old");
+string BlockChain::lookupExtra(bytesConstRef _key) const
+{
+	string ret;
+	if (!m_writer->lookupExtra(_key, ret))
+		ret = m_extrasDB->lookup(_key);
+	return ret;
+}
+
+TransactionReceipt BlockChain::receipt(h256 const& _hash, unsigned _i) const
+{
+	BlockReceipts br;
+	if (m_receipts.get(_hash, br))
+		return _i < br.receipts.size() ? br.receipts[_i] : NullTransactionReceipt;
+	string s = lookupExtra(toSlice(_hash, ExtraReceipts));
+	return s.empty() ? NullTransactionReceipt : BlockReceipts::receiptAt(bytesConstRef(&s), _i);
 }
 
 template <class T, class V>
@@ -281,22 +698,77 @@ inline string toString(h256s const& _bs)
 
 LastHashes BlockChain::lastHashes(unsigned _n) const
 {
-	Guard l(x_lastLastHashes);
-	if (m_lastLastHashesNumber != _n || m_lastLastHashes.empty())
+	LastHashes ret(256);
+	for (unsigned i = 0; i < 256; ++i)
+		ret[i] = _n >= i ? numberHash(_n - i) : h256();
+	return ret;
+}
+
+/// The canonical hash array grows a megabyte at a time.
+static const size_t c_canonGrowth = 1 << 20;
+
+void BlockChain::openCanonHashes(string const& _path, bool _clean)
+{
+	m_canonCount = 0;
+	m_canonHashes.reset(new GrowableMappedFile(_path, (size_t)c_maxCanonHashes * h256::size));
+	unsigned n = number();
+	size_t have = min<size_t>(m_canonHashes->size() / h256::size, n + 1);
+	size_t end = ((size_t)n + 1) * h256::size;
+	if (!m_canonHashes->data() || (end > m_canonHashes->size() && !m_canonHashes->resize(min((end + c_canonGrowth - 1) / c_canonGrowth * c_canonGrowth, m_canonHashes->capacity()))))
 	{
-		m_lastLastHashes.resize(256);
-		for (unsigned i = 0; i < 256; ++i)
-			m_lastLastHashes[i] = _n >= i ? numberHash(_n - i) : h256();
-		m_lastLastHashesNumber = _n;
+		cwarn << "Could not map the canonical hashes; looking them up in the extras instead.";
+		m_canonHashes.reset();
+		return;
 	}
-	return m_lastLastHashes;
+
+	auto put = [&](unsigned _i, h256 const& _h) { memcpy(m_canonHashes->data() + (size_t)_i * h256::size, _h.data(), h256::size); };
+	auto extrasHash = [&](unsigned _i) { return queryExtras<BlockHash, ExtraBlockHash>(h256(u256(_i)), m_blockHashes, NullBlockHash).value; };
+	if (have < n)
+		cnote << "Indexing the hashes of blocks" << have << "to" << n;
+	put(0, m_genesisHash);
+	for (unsigned i = max<unsigned>(have, 1); i <= n; ++i)
+		put(i, extrasHash(i));
+	// A crash may have left the head of a branch whose extras were never written; the array agrees with the extras
+	// below where it forked.
+	if (!_clean)
+		for (unsigned i = (unsigned)have; i-- > 1;)
+		{
+			h256 h = extrasHash(i);
+			if (canonHash(i) == h)
+				break;
+			put(i, h);
+		}
+	m_canonCount = n + 1;
+}
+
+void BlockChain::setCanonHash(unsigned _n, h256 const& _h)
+{
+	if (!m_canonHashes || _n > m_canonCount)
+		return;
+	size_t end = ((size_t)_n + 1) * h256::size;
+	// The file is never shrunk while open, so that no reader touches a page past its end.
+	if (end > m_canonHashes->size() && !m_canonHashes->resize(min((end + c_canonGrowth - 1) / c_canonGrowth * c_canonGrowth, m_canonHashes->capacity())))
+	{
+		cwarn << "Could not grow the canonical hashes; looking them up in the extras from block" << _n;
+		return;
+	}
+	// Meanwhile the blocks being replaced are looked up in the extras, as they were before the array.
+	if (_n < m_canonCount)
+		m_canonCount = _n;
+	memcpy(m_canonHashes->data() + (size_t)_n * h256::size, _h.data(), h256::size);
+	m_canonCount = _n + 1;
 }
 
 tuple<h256s, h256s, bool> BlockChain::sync(BlockQueue& _bq, OverlayDB const& _stateDB, unsigned _max)
 {
 	_bq.tick(*this);
 
-	vector<bytes> blocks;
+	// Those after the pivot of a fast sync wait for its state. The queue gives blocks after their parents, so that
+	// none of those drained is after the pivot if there are no more of them than there are blocks up to it.
+	if (isAwaitingState())
+		_max = min(_max, pivot() > number() ? pivot() - number() : 0);
+
+	vector<SharedBlock> blocks;
 	_bq.drain(blocks, _max);
 
 	h256s fresh;
@@ -306,7 +778,8 @@ tuple<h256s, h256s, bool> BlockChain::sync(BlockQueue& _bq, OverlayDB const& _st
 	{
 		try
 		{
-			auto r = import(block, _stateDB);
+			// The queue has already checked each block's header, proof of work and roots.
+			auto r = import(*block, _stateDB, Aversion::AvoidOldBlocks, true);
 			bool isOld = true;
 			for (auto const& h: r.first)
 				if (h == r.second)
@@ -321,14 +794,14 @@ tuple<h256s, h256s, bool> BlockChain::sync(BlockQueue& _bq, OverlayDB const& _st
 			cwarn << "ODD: Import queue contains block with unknown parent." << boost::current_exception_diagnostic_information();
 			// NOTE: don't reimport since the queue should guarantee everything in the right order.
 			// Can't continue - chain bad.
-			badBlocks.push_back(BlockInfo::headerHash(block));
+			badBlocks.push_back(BlockInfo::headerHash(*block));
 		}
 		catch (Exception const& _e)
 		{
 			cnote << "Exception while importing block. Someone (Jeff? That you?) seems to be giving us dodgy blocks!" << diagnostic_information(_e);
 			// NOTE: don't reimport since the queue should guarantee everything in the right order.
 			// Can't continue - chain  bad.
-			badBlocks.push_back(BlockInfo::headerHash(block));
+			badBlocks.push_back(BlockInfo::headerHash(*block));
 		}
 	}
 	return make_tuple(fresh, dead, _bq.doneDrain(badBlocks));
@@ -347,8 +820,11 @@ pair<h256s, h256> BlockChain::attemptImport(bytes const& _block, OverlayDB const
 	}
 }
 
-pair<h256s, h256> BlockChain::import(bytes const& _block, OverlayDB const& _db, Aversion _force)
+pair<h256s, h256> BlockChain::import(bytes const& _block, OverlayDB const& _db, Aversion _force, bool _verified)
 {
+	static MetricHistogram& s_importTime = Metrics::get().histogram("eth_block_import_seconds", "Time to import a block, whether or not it goes in.");
+	MetricTimer importTimer(s_importTime);
+
 	//@tidy This is a behemoth of a method - could do to be split into a few smaller ones.
 
 #if ETH_TIMED_IMPORTS
@@ -374,7 +850,8 @@ pair<h256s, h256> BlockChain::import(bytes const& _block, OverlayDB const& _db,
 			BOOST_THROW_EXCEPTION(InvalidBlockFormat() << errinfo_comment("block header needs to be a list") << BadFieldError(0, blockRLP.data().toString()));
 
 		bi.populate(&_block);
-		bi.verifyInternals(&_block);
+		if (!_verified)
+			bi.verifyInternals(&_block);
 	}
 #if ETH_CATCH
 	catch (Exception const& _e)
@@ -429,19 +906,31 @@ pair<h256s, h256> BlockChain::import(bytes const& _block, OverlayDB const& _db,
 	try
 #endif
 	{
-		// Check transactions are valid and that they result in a state equivalent to our state_root.
-		// Get total difficulty increase and update state, checking it.
-		State s(_db);	//, bi.coinbaseAddress
-		auto tdIncrease = s.enactOn(&_block, bi, *this);
-
+		u256 tdIncrease;
 		BlockLogBlooms blb;
 		BlockReceipts br;
-		for (unsigned i = 0; i < s.pending().size(); ++i)
+		if (bi.number <= pivot())
+		{
+			// Up to the pivot of a fast sync, its state is downloaded rather than reached by executing the blocks.
+			bi.verifyParent(info(bi.parentHash));
+			tdIncrease = bi.difficulty;
+			for (auto const& u: RLP(_block)[2])
+				tdIncrease += BlockInfo::fromHeader(u.data()).difficulty;
+		}
+		else
 		{
-			blb.blooms.push_back(s.receipt(i).bloom());
-			br.receipts.push_back(s.receipt(i));
+			// Check transactions are valid and that they result in a state equivalent to our state_root.
+			// Get total difficulty increase and update state, checking it.
+			State s(_db);	//, bi.coinbaseAddress
+			tdIncrease = s.enactOn(&_block, bi, *this, _verified);
+
+			for (unsigned i = 0; i < s.pending().size(); ++i)
+			{
+				blb.blooms.push_back(s.receipt(i).bloom());
+				br.receipts.push_back(s.receipt(i));
+			}
+			s.cleanup(true);
 		}
-		s.cleanup(true);
 		td = pd.totalDifficulty + tdIncrease;
 
 #if ETH_TIMED_IMPORTS
@@ -453,26 +942,22 @@ pair<h256s, h256> BlockChain::import(bytes const& _block, OverlayDB const& _db,
 		checkConsistency();
 #endif
 		// All ok - insert into DB
-		{
-			// ensure parent is cached for later addition.
-			// TODO: this is a bit horrible would be better refactored into an enveloping UpgradableGuard
-			// together with an "ensureCachedWithUpdatableLock(l)" method.
-			// This is safe in practice since the caches don't get flushed nearly often enough to be
-			// done here.
-			details(bi.parentHash);
-
-			WriteGuard l(x_details);
-			m_details[bi.hash()] = BlockDetails((unsigned)pd.number + 1, td, bi.parentHash, {});
-			m_details[bi.parentHash].children.push_back(bi.hash());
-		}
-		{
-			WriteGuard l(x_logBlooms);
-			m_logBlooms[bi.hash()] = blb;
-		}
-		{
-			WriteGuard l(x_receipts);
-			m_receipts[bi.hash()] = br;
-		}
+		// Serialise each extra before caching it, so that it is cached with its size.
+		BlockDetails bd((unsigned)pd.number + 1, td, bi.parentHash, {});
+		bytes detailsData = bd.compact();
+		m_details.insert(bi.hash(), bd);
+		// The parent may have been evicted since pd was read, in which case pd is put back.
+		bytes parentData;
+		m_details.update(bi.parentHash, pd, [&](BlockDetails& _d){ _d.children.push_back(bi.hash()); parentData = _d.compact(); });
+		bytes blbData = blb.compact();
+		m_logBlooms.insert(bi.hash(), blb);
+		bytes brData = br.compact();
+		m_receipts.insert(bi.hash(), br);
+		// Its children check and choose their uncles against those it cites.
+		h256s uncles;
+		for (auto const& u: RLP(_block)[2])
+			uncles.push_back(sha3(u.data()));
+		m_uncleHashes.insert(bi.hash(), uncles);
 
 #if ETH_TIMED_IMPORTS
 		collation = t.elapsed();
@@ -480,14 +965,14 @@ pair<h256s, h256> BlockChain::import(bytes const& _block, OverlayDB const& _db,
 #endif
 
 		{
-			ReadGuard l2(x_details);
-			ReadGuard l4(x_receipts);
-			ReadGuard l5(x_logBlooms);
-			m_blocksDB->Put(m_writeOptions, toSlice(bi.hash()), (ldb::Slice)ref(_block));
-			m_extrasDB->Put(m_writeOptions, toSlice(bi.hash(), ExtraDetails), (ldb::Slice)dev::ref(m_details[bi.hash()].rlp()));
-			m_extrasDB->Put(m_writeOptions, toSlice(bi.parentHash, ExtraDetails), (ldb::Slice)dev::ref(m_details[bi.parentHash].rlp()));
-			m_extrasDB->Put(m_writeOptions, toSlice(bi.hash(), ExtraLogBlooms), (ldb::Slice)dev::ref(m_logBlooms[bi.hash()].rlp()));
-			m_extrasDB->Put(m_writeOptions, toSlice(bi.hash(), ExtraReceipts), (ldb::Slice)dev::ref(m_receipts[bi.hash()].rlp()));
+			auto batch = make_shared<Writer::Batch>();
+			batch->insertBlock(toSlice(bi.hash()), ref(_block));
+			batch->insertExtra(toSlice(bi.hash(), ExtraDetails), dev::ref(detailsData));
+			batch->insertExtra(toSlice(bi.parentHash, ExtraDetails), dev::ref(parentData));
+			batch->insertExtra(toSlice(bi.hash(), ExtraLogBlooms), dev::ref(blbData));
+			batch->insertExtra(toSlice(bi.hash(), ExtraReceipts), dev::ref(brData));
+			journal(bi.hash());
+			m_writer->write(batch);
 		}
 
 #if ETH_TIMED_IMPORTS
@@ -535,74 +1020,18 @@ pair<h256s, h256> BlockChain::import(bytes const& _block, OverlayDB const& _db,
 	{
 		unsigned commonIndex;
 		tie(route, common, commonIndex) = treeRoute(last, bi.hash());
-		{
-			WriteGuard l(x_lastBlockHash);
-			m_lastBlockHash = bi.hash();
-		}
-
-		m_extrasDB->Put(m_writeOptions, ldb::Slice("best"), ldb::Slice((char const*)&(bi.hash()), 32));
+		switchCanon(route, common, last, bi.hash());
 
-		// Most of the time these two will be equal - only when we're doing a chain revert will they not be
-		if (common != last)
-			// If we are reverting previous blocks, we need to clear their blooms (in particular, to
-			// rebuild any higher level blooms that they contributed to).
-			clearBlockBlooms(number(common) + 1, number(last) + 1);
-
-		// Go through ret backwards until hash != last.parent and update m_transactionAddresses, m_blockHashes
-		for (auto i = route.rbegin(); i != route.rend() && *i != common; ++i)
+		if (common != last && number(common) + c_bloomBitsConfirmations < (unsigned)bi.number)
 		{
-			auto b = block(*i);
-			BlockInfo bi(b);
-			// Collate logs into blooms.
-			h256s alteredBlooms;
-			{
-				LogBloom blockBloom = bi.logBloom;
-				blockBloom.shiftBloom<3>(sha3(bi.coinbaseAddress.ref()));
-
-				// Pre-memoize everything we need before locking x_blocksBlooms
-				for (unsigned level = 0, index = (unsigned)bi.number; level < c_bloomIndexLevels; level++, index /= c_bloomIndexSize)
-					blocksBlooms(chunkId(level, index / c_bloomIndexSize));
-
-				WriteGuard l(x_blocksBlooms);
-				for (unsigned level = 0, index = (unsigned)bi.number; level < c_bloomIndexLevels; level++, index /= c_bloomIndexSize)
-				{
-					unsigned i = index / c_bloomIndexSize;
-					unsigned o = index % c_bloomIndexSize;
-					alteredBlooms.push_back(chunkId(level, i));
-					m_blocksBlooms[alteredBlooms.back()].blooms[o] |= blockBloom;
-				}
-			}
-			// Collate transaction hashes and remember who they were.
-			h256s newTransactionAddresses;
-			{
-				RLP blockRLP(b);
-				TransactionAddress ta;
-				ta.blockHash = bi.hash();
-				WriteGuard l(x_transactionAddresses);
-				for (ta.index = 0; ta.index < blockRLP[1].itemCount(); ++ta.index)
-				{
-					newTransactionAddresses.push_back(sha3(blockRLP[1][ta.index].data()));
-					m_transactionAddresses[newTransactionAddresses.back()] = ta;
-				}
-			}
-			{
-				WriteGuard l(x_blockHashes);
-				m_blockHashes[h256(bi.number)].value = bi.hash();
-			}
-
-			// Update database with them.
-			ReadGuard l1(x_blocksBlooms);
-			ReadGuard l3(x_blockHashes);
-			ReadGuard l6(x_transactionAddresses);
-			for (auto const& h: alteredBlooms)
-				m_extrasDB->Put(m_writeOptions, toSlice(h, ExtraBlocksBlooms), (ldb::Slice)dev::ref(m_blocksBlooms[h].rlp()));
-			m_extrasDB->Put(m_writeOptions, toSlice(h256(bi.number), ExtraBlockHash), (ldb::Slice)dev::ref(m_blockHashes[h256(bi.number)].rlp()));
-			for (auto const& h: newTransactionAddresses)
-				m_extrasDB->Put(m_writeOptions, toSlice(h, ExtraTransactionAddress), (ldb::Slice)dev::ref(m_transactionAddresses[h].rlp()));
+			// The reorganisation may have reached indexed sections; look them all over again.
+			Guard l(x_bloomBits);
+			m_bloomBitsBackfill = (unsigned)-1;
 		}
+		if (bi.number >= c_bloomBitsConfirmations)
+			indexBloomBits((unsigned)bi.number - c_bloomBitsConfirmations);
 
 		clog(BlockChainNote) << "   Imported and best" << td << " (#" << bi.number << "). Has" << (details(bi.parentHash).children.size() - 1) << "siblings. Route:" << toString(route);
-		noteCanonChanged();
 
 		StructuredLogger::chainNewHead(
 			bi.headerHash(WithoutNonce).abridged(),
@@ -630,6 +1059,13 @@ pair<h256s, h256> BlockChain::import(bytes const& _block, OverlayDB const& _db,
 }
 
 void BlockChain::clearBlockBlooms(unsigned _begin, unsigned _end)
+{
+	CanonDelta d;
+	clearBlockBlooms(_begin, _end, d);
+	writeDelta(d);
+}
+
+void BlockChain::clearBlockBlooms(unsigned _begin, unsigned _end, CanonDelta& io_delta) const
 {
 	//   ... c c c c c c c c c c C o o o o o o
 	//   ...                               /=15        /=21
@@ -662,11 +1098,10 @@ void BlockChain::clearBlockBlooms(unsigned _begin, unsigned _end)
 			{
 				// rebuild the bloom from the previous (lower) level (if there is one).
 				auto lowerChunkId = chunkId(level - 1, item);
-				for (auto const& bloom: blocksBlooms(lowerChunkId).blooms)
+				for (auto const& bloom: io_delta.blooms(*this, lowerChunkId).blooms)
 					acc |= bloom;
 			}
-			blocksBlooms(id);	// make sure it has been memoized.
-			m_blocksBlooms[id].blooms[offset] = acc;
+			io_delta.blooms(*this, id).blooms[offset] = acc;
 		}
 	}
 }
@@ -722,119 +1157,64 @@ tuple<h256s, h256, unsigned> BlockChain::treeRoute(h256 const& _from, h256 const
 	return make_tuple(ret, from, i);
 }
 
-void BlockChain::noteUsed(h256 const& _h, unsigned _extra) const
-{
-	auto id = CacheID(_h, _extra);
-	Guard l(x_cacheUsage);
-	m_cacheUsage[0].insert(id);
-	if (m_cacheUsage[1].count(id))
-		m_cacheUsage[1].erase(id);
-	else
-		m_inUse.insert(id);
-}
-
-template <class T> static unsigned getHashSize(map<h256, T> const& _map)
+void BlockChain::setCacheSize(size_t _bytes)
 {
-	unsigned ret = 0;
-	for (auto const& i: _map)
-		ret += i.second.size + 64;
-	return ret;
+	m_blocks.setCapacity(_bytes / 16 * c_blocksShare);
+	m_receipts.setCapacity(_bytes / 16 * c_receiptsShare);
+	m_details.setCapacity(_bytes / 16 * c_extraShare);
+	m_logBlooms.setCapacity(_bytes / 16 * c_extraShare);
+	m_transactionAddresses.setCapacity(_bytes / 16 * c_extraShare);
+	m_blockHashes.setCapacity(_bytes / 16 * c_extraShare);
+	m_blocksBlooms.setCapacity(_bytes / 16 * c_extraShare);
+	m_bloomBits.setCapacity(_bytes / 16 * c_extraShare);
+	m_logIndex.setCapacity(_bytes / 16 * c_extraShare);
+	updateStats();
 }
 
 void BlockChain::updateStats() const
 {
-	{
-		ReadGuard l(x_blocks);
-		m_lastStats.memBlocks = 0;
-		for (auto const& i: m_blocks)
-			m_lastStats.memBlocks += i.second.size() + 64;
-	}
-	{
-		ReadGuard l(x_details);
-		m_lastStats.memDetails = getHashSize(m_details);
-	}
-	{
-		ReadGuard l1(x_logBlooms);
-		ReadGuard l2(x_blocksBlooms);
-		m_lastStats.memLogBlooms = getHashSize(m_logBlooms) + getHashSize(m_blocksBlooms);
-	}
-	{
-		ReadGuard l(x_receipts);
-		m_lastStats.memReceipts = getHashSize(m_receipts);
-	}
-	{
-		ReadGuard l(x_blockHashes);
-		m_lastStats.memBlockHashes = getHashSize(m_blockHashes);
-	}
-	{
-		ReadGuard l(x_transactionAddresses);
-		m_lastStats.memTransactionAddresses = getHashSize(m_transactionAddresses);
-	}
+	m_lastStats.memBlocks = m_blocks.memoryUsage();
+	m_lastStats.memDetails = m_details.memoryUsage();
+	m_lastStats.memLogBlooms = m_logBlooms.memoryUsage();
+	m_lastStats.memReceipts = m_receipts.memoryUsage();
+	m_lastStats.memBlockHashes = m_blockHashes.memoryUsage();
+	m_lastStats.memTransactionAddresses = m_transactionAddresses.memoryUsage();
+	m_lastStats.memBlocksBlooms = m_blocksBlooms.memoryUsage();
+	m_lastStats.memBloomBits = m_bloomBits.memoryUsage();
+	m_lastStats.memLogIndex = m_logIndex.memoryUsage();
+	m_lastStats.memUncleHashes = m_uncleHashes.memoryUsage();
+	m_lastStats.memHeaders = m_headers.memoryUsage();
+	m_lastStats.budget = m_blocks.capacity() + m_receipts.capacity() + m_details.capacity() + m_logBlooms.capacity() + m_transactionAddresses.capacity() + m_blockHashes.capacity() + m_blocksBlooms.capacity() + m_bloomBits.capacity() + m_logIndex.capacity() + m_uncleHashes.capacity() + m_headers.capacity();
 }
 
 void BlockChain::garbageCollect(bool _force)
 {
-	updateStats();
-
-	if (!_force && chrono::system_clock::now() < m_lastCollection + c_collectionDuration && m_lastStats.memTotal() < c_maxCacheSize)
-		return;
-	if (m_lastStats.memTotal() < c_minCacheSize)
-		return;
-
-	m_lastCollection = chrono::system_clock::now();
-
-	Guard l(x_cacheUsage);
-	WriteGuard l1(x_blocks);
-	WriteGuard l2(x_details);
-	WriteGuard l3(x_blockHashes);
-	WriteGuard l4(x_receipts);
-	WriteGuard l5(x_logBlooms);
-	WriteGuard l6(x_transactionAddresses);
-	WriteGuard l7(x_blocksBlooms);
-	for (CacheID const& id: m_cacheUsage.back())
+	if (_force)
 	{
-		m_inUse.erase(id);
-		// kill i from cache.
-		switch (id.second)
-		{
-		case (unsigned)-1:
-			m_blocks.erase(id.first);
-			break;
-		case ExtraDetails:
-			m_details.erase(id.first);
-			break;
-		case ExtraBlockHash:
-			m_blockHashes.erase(id.first);
-			break;
-		case ExtraReceipts:
-			m_receipts.erase(id.first);
-			break;
-		case ExtraLogBlooms:
-			m_logBlooms.erase(id.first);
-			break;
-		case ExtraTransactionAddress:
-			m_transactionAddresses.erase(id.first);
-			break;
-		case ExtraBlocksBlooms:
-			m_blocksBlooms.erase(id.first);
-			break;
-		}
+		m_blocks.clear();
+		m_details.clear();
+		m_logBlooms.clear();
+		m_receipts.clear();
+		m_transactionAddresses.clear();
+		m_blockHashes.clear();
+		m_blocksBlooms.clear();
+		m_bloomBits.clear();
+		m_logIndex.clear();
+		m_uncleHashes.clear();
+		m_headers.clear();
 	}
-	m_cacheUsage.pop_back();
-	m_cacheUsage.push_front(std::set<CacheID>{});
+	updateStats();
 }
 
 void BlockChain::checkConsistency()
 {
+	flush();
+	m_details.clear();
+	m_blocksDB->forEach([&](bytesConstRef _key, bytesConstRef)
 	{
-		WriteGuard l(x_details);
-		m_details.clear();
-	}
-	ldb::Iterator* it = m_blocksDB->NewIterator(m_readOptions);
-	for (it->SeekToFirst(); it->Valid(); it->Next())
-		if (it->key().size() == 32)
+		if (_key.size() == 32)
 		{
-			h256 h((byte const*)it->key().data(), h256::ConstructFromPointer);
+			h256 h(_key.data(), h256::ConstructFromPointer);
 			auto dh = details(h);
 			auto p = dh.parent;
 			if (p != h256() && p != m_genesisHash)	// TODO: for some reason the genesis details with the children get squished. not sure why.
@@ -850,7 +1230,53 @@ void BlockChain::checkConsistency()
 				}
 			}
 		}
-	delete it;
+		return true;
+	});
+}
+
+void BlockChain::journal(h256 const& _h)
+{
+	// At most c_maxQueued batches are unwritten, so the journal need keep no more blocks than that.
+	Guard l(x_journal);
+	m_journal.push_back(_h);
+	if (m_journal.size() > Writer::c_maxQueued)
+		m_journal.erase(m_journal.begin());
+	m_extrasDB->insert(bytesConstRef("journal"), dev::ref(rlp(m_journal)));
+}
+
+void BlockChain::checkJournal()
+{
+	{
+		Guard l(x_journal);
+		m_journal.clear();
+	}
+	string j = m_extrasDB->lookup(bytesConstRef("journal"));
+	if (j.empty())
+		return;
+	cnote << "Blockchain DB was not closed cleanly; checking the blocks last imported.";
+	m_details.clear();
+	for (h256 const& h: RLP(j).toVector<h256>())
+	{
+		if (m_blocksDB->lookup(h.ref()).empty())
+			continue;
+		auto dh = details(h);
+		if (!dh)
+		{
+			// The block landed but its extras did not; forget it, so that it is imported again.
+			cwarn << "Block" << h << "was written without its details; dropping it.";
+			m_blocksDB->kill(h.ref());
+			m_blocks.clear();
+			continue;
+		}
+		auto p = dh.parent;
+		if (p != h256() && p != m_genesisHash)
+		{
+			auto dp = details(p);
+			if (!contains(dp.children, h) || dp.number != dh.number - 1)
+				cwarn << "Apparently the database is corrupt at" << h << ". Rebuild it with --rebuild.";
+		}
+	}
+	m_extrasDB->kill(bytesConstRef("journal"));
 }
 
 static inline unsigned upow(unsigned a, unsigned b) { while (b-- > 0) a *= a; return a; }
@@ -873,16 +1299,125 @@ vector<unsigned> BlockChain::withBlockBloom(LogBloom const& _b, unsigned _earlie
 {
 	vector<unsigned> ret;
 
-	// start from the top-level
-	unsigned u = upow(c_bloomIndexSize, c_bloomIndexLevels);
+	// Sections in the transposed index are answered from it, the rest from the hierarchy of blooms.
+	for (unsigned begin = _earliest; begin <= _latest;)
+	{
+		unsigned section = begin / c_bloomBitsSection;
+		unsigned end = min(_latest, section * c_bloomBitsSection + c_bloomBitsSection - 1);
+		if (hasBloomBits(section))
+			ret += withBloomBits(_b, begin, end);
+		else
+		{
+			// start from the top-level
+			unsigned u = upow(c_bloomIndexSize, c_bloomIndexLevels);
+
+			// run through each of the top-level blockbloom blocks
+			for (unsigned index = begin / u; index <= end / u; ++index)
+				ret += withBlockBloom(_b, begin, end, c_bloomIndexLevels - 1, index);
+		}
+		if (end == _latest)
+			break;
+		begin = end + 1;
+	}
+
+	return ret;
+}
 
-	// run through each of the top-level blockbloom blocks
-	for (unsigned index = _earliest / u; index <= ceilDiv(_latest, u); ++index)				// 0
-		ret += withBlockBloom(_b, _earliest, _latest, c_bloomIndexLevels - 1, index);
+vector<unsigned> BlockChain::withBloomBits(LogBloom const& _b, unsigned _earliest, unsigned _latest) const
+{
+	unsigned section = _earliest / c_bloomBitsSection;
+	unsigned first = section * c_bloomBitsSection;
+	unsigned wordBegin = (_earliest - first) / 64;
+	unsigned wordEnd = (_latest - first) / 64 + 1;
+
+	// AND the bitmaps of each bit set in _b over just the words of the range, in plain loops the compiler vectorises.
+	BloomBits acc;
+	fill(acc.words.begin() + wordBegin, acc.words.begin() + wordEnd, ~uint64_t(0));
+	for (unsigned i = 0; i < LogBloom::size; ++i)
+		for (unsigned j = 0; j < 8; ++j)
+			if (_b[i] & (1 << j))
+			{
+				BloomBits bits = bloomBits(section, i * 8 + j);
+				uint64_t any = 0;
+				for (unsigned w = wordBegin; w < wordEnd; ++w)
+					any |= (acc.words[w] &= bits.words[w]);
+				if (!any)
+					return vector<unsigned>();
+			}
 
+	vector<unsigned> ret;
+	for (unsigned w = wordBegin; w < wordEnd; ++w)
+		if (acc.words[w])
+			for (unsigned k = 0; k < 64; ++k)
+			{
+				unsigned n = first + w * 64 + k;
+				if ((acc.words[w] >> k & 1) && n >= _earliest && n <= _latest)
+					ret.push_back(n);
+			}
 	return ret;
 }
 
+bool BlockChain::hasBloomBits(unsigned _section) const
+{
+	unsigned last = _section * c_bloomBitsSection + c_bloomBitsSection - 1;
+	if (last > number())
+		return false;
+	string s = lookupExtra(toSlice(h256(u256(_section)), ExtraBloomBitsSection));
+	return !s.empty() && BlockHash(RLP(s)).value == numberHash(last);
+}
+
+void BlockChain::indexBloomBits(unsigned _confirmed)
+{
+	// Another import is at it already; this one need not wait.
+	unique_lock<Mutex> l(x_bloomBits, try_to_lock);
+	if (!l.owns_lock())
+		return;
+
+	unsigned sections = (_confirmed + 1) / c_bloomBitsSection;
+	if (!sections)
+		return;
+	if (!hasBloomBits(sections - 1))
+		buildBloomBits(sections - 1);
+	else
+	{
+		// Catch up on older sections one at a time, e.g. those of a database from before the index.
+		m_bloomBitsBackfill = min(m_bloomBitsBackfill, sections - 1);
+		while (m_bloomBitsBackfill && hasBloomBits(m_bloomBitsBackfill - 1))
+			--m_bloomBitsBackfill;
+		if (m_bloomBitsBackfill)
+			buildBloomBits(--m_bloomBitsBackfill);
+	}
+}
+
+void BlockChain::buildBloomBits(unsigned _section)
+{
+	unsigned first = _section * c_bloomBitsSection;
+	vector<BloomBits> bits(LogBloom::size * 8);
+	for (unsigned o = 0; o < c_bloomBitsSection; ++o)
+	{
+		LogBloom b = blockBloom(first + o);
+		for (unsigned i = 0; i < LogBloom::size; ++i)
+			if (b[i])
+				for (unsigned j = 0; j < 8; ++j)
+					if (b[i] & (1 << j))
+						bits[i * 8 + j].words[o / 64] |= uint64_t(1) << (o % 64);
+	}
+
+	auto batch = make_shared<Writer::Batch>();
+	for (unsigned i = 0; i < bits.size(); ++i)
+		batch->insertExtra(toSlice(bloomBitsId(_section, i), ExtraBloomBits), dev::ref(bits[i].rlp()));
+	// Keyed by the section's last block, so that a reorganisation reaching back into it leaves the index unused.
+	BlockHash last;
+	last.value = numberHash(first + c_bloomBitsSection - 1);
+	batch->insertExtra(toSlice(h256(u256(_section)), ExtraBloomBitsSection), dev::ref(last.rlp()));
+	m_writer->write(batch);
+	// Only now the batch is there to be looked up, so that what is cached from here on is of it.
+	for (unsigned i = 0; i < bits.size(); ++i)
+		m_bloomBits.erase(bloomBitsId(_section, i));
+
+	clog(BlockChainNote) << "Indexed the blooms of blocks" << first << "to" << (first + c_bloomBitsSection - 1);
+}
+
 vector<unsigned> BlockChain::withBlockBloom(LogBloom const& _b, unsigned _earliest, unsigned _latest, unsigned _level, unsigned _index) const
 {
 	// 14, 32, 1, 0
@@ -923,6 +1458,182 @@ vector<unsigned> BlockChain::withBlockBloom(LogBloom const& _b, unsigned _earlie
 	return ret;
 }
 
+vector<LogPosition> BlockChain::logPositions(Address const& _address, h256 const& _topic0, unsigned _earliest, unsigned _latest) const
+{
+	vector<LogPosition> ret;
+	for (unsigned chunk = _earliest / c_logIndexChunk; chunk <= _latest / c_logIndexChunk; ++chunk)
+		for (LogPosition const& p: logPostings(logIndexId(_address, _topic0, chunk)).positions)
+			if (p.block >= _earliest && p.block <= _latest)
+				ret.push_back(p);
+	return ret;
+}
+
+void BlockChain::postLogs(h256 const& _hash, unsigned _number, CanonDelta& io_delta) const
+{
+	map<h256, vector<LogPosition>> posted;
+	BlockReceipts br = receipts(_hash);
+	for (unsigned t = 0; t < br.receipts.size(); ++t)
+		for (unsigned l = 0; l < br.receipts[t].log().size(); ++l)
+		{
+			LogEntry const& e = br.receipts[t].log()[l];
+			posted[logIndexId(e.address, e.topics.empty() ? h256() : e.topics[0], _number / c_logIndexChunk)].push_back(LogPosition{_number, t, l});
+		}
+
+	for (auto const& p: posted)
+	{
+		LogPostings& postings = io_delta.postings(*this, p.first);
+		// Any left of a block once here before are superseded.
+		postings.truncate(_number);
+		postings.positions += p.second;
+	}
+}
+
+void BlockChain::revertLogs(unsigned _begin, unsigned _end, CanonDelta& io_delta) const
+{
+	for (unsigned n = max<unsigned>(_begin, m_logIndexFrom); n < _end; ++n)
+		for (TransactionReceipt const& r: receipts(numberHash(n)).receipts)
+			for (LogEntry const& e: r.log())
+				io_delta.postings(*this, logIndexId(e.address, e.topics.empty() ? h256() : e.topics[0], n / c_logIndexChunk)).truncate(_begin);
+}
+
+BlocksBlooms& BlockChain::CanonDelta::blooms(BlockChain const& _bc, h256 const& _id)
+{
+	auto it = bloomChunks.find(_id);
+	if (it == bloomChunks.end())
+		it = bloomChunks.insert(make_pair(_id, _bc.blocksBlooms(_id))).first;
+	return it->second;
+}
+
+LogPostings& BlockChain::CanonDelta::postings(BlockChain const& _bc, h256 const& _id)
+{
+	auto it = logPostings.find(_id);
+	if (it == logPostings.end())
+		it = logPostings.insert(make_pair(_id, _bc.logPostings(_id))).first;
+	return it->second;
+}
+
+void BlockChain::switchCanon(h256s const& _route, h256 const& _common, h256 const& _last, h256 const& _best)
+{
+	CanonDelta d;
+	if (_common != _last)
+	{
+		// If we are reverting previous blocks, we need to clear their blooms (in particular, to
+		// rebuild any higher level blooms that they contributed to).
+		clearBlockBlooms(number(_common) + 1, number(_last) + 1, d);
+		revertLogs(number(_common) + 1, number(_last) + 1, d);
+	}
+
+	// Go through the route backwards, from just after the common ancestor, gathering what each block adds.
+	for (auto i = _route.rbegin(); i != _route.rend() && *i != _common; ++i)
+	{
+		auto b = block(*i);
+		BlockInfo bi(b);
+		// Collate logs into blooms.
+		LogBloom blockBloom = bi.logBloom;
+		blockBloom.shiftBloom<3>(sha3(bi.coinbaseAddress.ref()));
+		for (unsigned level = 0, index = (unsigned)bi.number; level < c_bloomIndexLevels; level++, index /= c_bloomIndexSize)
+			d.blooms(*this, chunkId(level, index / c_bloomIndexSize)).blooms[index % c_bloomIndexSize] |= blockBloom;
+		if ((unsigned)bi.number >= m_logIndexFrom)
+			postLogs(bi.hash(), (unsigned)bi.number, d);
+		// Collate transaction hashes and remember who they were.
+		RLP blockRLP(b);
+		TransactionAddress ta;
+		ta.blockHash = bi.hash();
+		for (ta.index = 0; ta.index < blockRLP[1].itemCount(); ++ta.index)
+			d.transactionAddresses.push_back(make_pair(sha3(blockRLP[1][ta.index].data()), ta));
+		d.blockHashes.push_back(make_pair((unsigned)bi.number, bi.hash()));
+	}
+
+	writeDelta(d, _best);
+	WriteGuard l(x_lastBlockHash);
+	m_lastBlockHash = _best;
+}
+
+void BlockChain::writeDelta(CanonDelta const& _delta, h256 const& _best)
+{
+	auto batch = make_shared<Writer::Batch>();
+	for (auto const& c: _delta.bloomChunks)
+		batch->insertExtra(toSlice(c.first, ExtraBlocksBlooms), dev::ref(c.second.compact()));
+	for (auto const& p: _delta.logPostings)
+		batch->insertExtra(toSlice(p.first, ExtraLogIndex), dev::ref(p.second.rlp()));
+	for (auto const& t: _delta.transactionAddresses)
+		batch->insertExtra(toSlice(t.first, ExtraTransactionAddress), dev::ref(t.second.rlp()));
+	for (auto const& h: _delta.blockHashes)
+	{
+		BlockHash bh;
+		bh.value = h.second;
+		batch->insertExtra(toSlice(h256(h.first), ExtraBlockHash), dev::ref(bh.rlp()));
+	}
+	// In the same batch, so that the best block's extras are all there whenever "best" is.
+	if (_best)
+		batch->insertExtra(bytesConstRef("best"), _best.ref());
+	m_writer->write(batch);
+
+	// Only now that lookups find the batch are the caches changed, each entry once, so that no lock is held while
+	// the route is gathered and written.
+	for (auto const& c: _delta.bloomChunks)
+		m_blocksBlooms.insert(c.first, c.second);
+	for (auto const& p: _delta.logPostings)
+		m_logIndex.insert(p.first, p.second);
+	for (auto const& t: _delta.transactionAddresses)
+		m_transactionAddresses.insert(t.first, t.second);
+	for (auto const& h: _delta.blockHashes)
+	{
+		BlockHash bh;
+		bh.value = h.second;
+		m_blockHashes.insert(h256(h.first), bh);
+		setCanonHash(h.first, h.second);
+	}
+}
+
+void BlockChain::openLogIndex()
+{
+	string s = lookupExtra(bytesConstRef("logIndexFrom"));
+	if (!Defaults::get()->m_logIndex)
+	{
+		// Imports from here on would leave it incomplete, so it is started afresh if ever wanted again.
+		if (!s.empty())
+			m_extrasDB->kill(bytesConstRef("logIndexFrom"));
+		m_logIndexFrom = (unsigned)-1;
+	}
+	else if (s.empty())
+	{
+		m_logIndexFrom = number() + 1;
+		m_extrasDB->insert(bytesConstRef("logIndexFrom"), dev::ref(rlp(m_logIndexFrom.load())));
+		cnote << "Indexing logs from block" << m_logIndexFrom;
+	}
+	else
+		m_logIndexFrom = RLP(s).toInt<unsigned>();
+}
+
+BlockInfo BlockChain::info(h256 const& _hash) const
+{
+	BlockInfo ret;
+	if (m_headers.get(_hash, ret))
+		return ret;
+	ret = BlockInfo(blockHandle(_hash).data(), IgnoreNonce, _hash);
+	ret.headerHash(WithoutNonce);
+	ret.seedHash();
+	if (ret.difficulty)
+		ret.boundary();
+	m_headers.insert(_hash, ret);
+	return ret;
+}
+
+UncleHashes BlockChain::uncleHashes(h256 const& _hash) const
+{
+	UncleHashes ret;
+	if (m_uncleHashes.get(_hash, ret))
+		return ret;
+	auto b = blockHandle(_hash);
+	if (!b)
+		return ret;
+	for (auto const& u: b.rlp()[2])
+		ret.push_back(sha3(u.data()));
+	m_uncleHashes.insert(_hash, ret);
+	return ret;
+}
+
 h256Set BlockChain::allUnclesFrom(h256 const& _parent) const
 {
 	// Get all uncles cited given a parent (i.e. featured as uncles/main in parent, parent + 1, ... parent + 5).
@@ -931,9 +1642,26 @@ h256Set BlockChain::allUnclesFrom(h256 const& _parent) const
 	for (unsigned i = 0; i < 6 && p != m_genesisHash; ++i, p = details(p).parent)
 	{
 		ret.insert(p);		// TODO: check: should this be details(p).parent?
-		auto b = block(p);
-		for (auto i: RLP(b)[2])
-			ret.insert(sha3(i.data()));
+		for (auto const& u: uncleHashes(p))
+			ret.insert(u);
+	}
+	return ret;
+}
+
+h256s BlockChain::uncleCandidates(h256 const& _parent, unsigned _max) const
+{
+	h256s ret;
+	if (_parent == m_genesisHash || !_max)
+		return ret;
+	h256Set known = allUnclesFrom(_parent);
+	h256 p = details(_parent).parent;
+	for (unsigned gen = 0; gen < 6 && p != m_genesisHash && ret.size() < _max; ++gen)
+	{
+		BlockDetails d = details(p);
+		for (auto const& u: d.children)
+			if (!known.count(u) && ret.size() < _max)	// ignore any uncles/mainline blocks that we know about.
+				ret.push_back(u);
+		p = d.parent;
 	}
 	return ret;
 }
@@ -942,42 +1670,31 @@ bool BlockChain::isKnown(h256 const& _hash) const
 {
 	if (_hash == m_genesisHash)
 		return true;
-	{
-		ReadGuard l(x_blocks);
-		if (m_blocks.count(_hash))
-			return true;
-	}
 	string d;
-	m_blocksDB->Get(m_readOptions, toSlice(_hash), &d);
-	return !!d.size();
+	return m_blocks.contains(_hash) || m_writer->lookupBlock(toSlice(_hash), d) || m_blocksDB->exists(toSlice(_hash));
 }
 
-bytes BlockChain::block(h256 const& _hash) const
+BlockHandle BlockChain::blockHandle(h256 const& _hash) const
 {
 	if (_hash == m_genesisHash)
-		return m_genesisBlock;
+		return BlockHandle(m_genesisBlock);
 
-	{
-		ReadGuard l(x_blocks);
-		auto it = m_blocks.find(_hash);
-		if (it != m_blocks.end())
-			return it->second;
-	}
+	shared_ptr<bytes const> data;
+	if (m_blocks.get(_hash, data))
+		return BlockHandle(data);
 
 	string d;
-	m_blocksDB->Get(m_readOptions, toSlice(_hash), &d);
+	if (!m_writer->lookupBlock(toSlice(_hash), d))
+		d = m_blocksDB->lookup(toSlice(_hash));
 
 	if (!d.size())
 	{
 		cwarn << "Couldn't find requested block:" << _hash.abridged();
-		return bytes();
+		return BlockHandle();
 	}
 
-	noteUsed(_hash);
-
-	WriteGuard l(x_blocks);
-	m_blocks[_hash].resize(d.size());
-	memcpy(m_blocks[_hash].data(), d.data(), d.size());
-
-	return m_blocks[_hash];
+	// The one copy out of the DB; everyone after shares it, and it outlives its eviction from the cache while held.
+	data = make_shared<bytes const>(d.begin(), d.end());
+	m_blocks.insert(_hash, data);
+	return BlockHandle(data);
 }
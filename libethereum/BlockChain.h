@@ -21,16 +21,11 @@
 
 #pragma once
 
-#pragma warning(push)
-#pragma warning(disable: 4100 4267)
-#include <leveldb/db.h>
-#pragma warning(pop)
-
-#include <deque>
-#include <chrono>
 #include <libdevcore/Log.h>
 #include <libdevcore/Exceptions.h>
 #include <libdevcore/Guards.h>
+#include <libdevcore/MappedFile.h>
+#include <libdevcrypto/KeyValueDB.h>
 #include <libethcore/Common.h>
 #include <libethcore/BlockInfo.h>
 #include <libevm/ExtVMFace.h>
@@ -38,7 +33,6 @@
 #include "Account.h"
 #include "Transaction.h"
 #include "BlockQueue.h"
-namespace ldb = leveldb;
 
 namespace dev
 {
@@ -50,6 +44,9 @@ namespace eth
 
 static const h256s NullH256s;
 
+/// Blocks the canonical hash array has room for; 4 GB of address space, taken only as it is written.
+static const unsigned c_maxCanonHashes = 1 << 27;
+
 class State;
 
 struct AlreadyHaveBlock: virtual Exception {};
@@ -63,9 +60,39 @@ struct BlockChainWarn: public LogChannel { static const char* name() { return "=
 // TODO: Move all this Genesis stuff into Genesis.h/.cpp
 std::map<Address, Account> const& genesisState();
 
-ldb::Slice toSlice(h256 const& _h, unsigned _sub = 0);
+/// @returns the key of extra @a _sub of @a _h, valid until the next call on this thread.
+bytesConstRef toSlice(h256 const& _h, unsigned _sub = 0);
+
+/**
+ * @brief A block's RLP, shared with BlockChain's cache rather than copied out of it.
+ * The refs handed out point into the one buffer and stay valid for as long as some handle to it is held.
+ */
+class BlockHandle
+{
+public:
+	BlockHandle() {}
+	explicit BlockHandle(std::shared_ptr<bytes const> const& _data): m_data(_data) {}
+
+	explicit operator bool() const { return m_data && !m_data->empty(); }
+
+	bytesConstRef data() const { return m_data ? bytesConstRef(m_data.get()) : bytesConstRef(); }
+	RLP rlp() const { return RLP(data()); }
+
+	bytesConstRef header() const { return rlp()[0].data(); }
+	unsigned transactionCount() const { return rlp()[1].itemCount(); }
+	bytesConstRef transaction(unsigned _i) const { return rlp()[1][_i].data(); }
+	std::vector<bytesConstRef> transactions() const { std::vector<bytesConstRef> ret; for (auto const& i: rlp()[1]) ret.push_back(i.data()); return ret; }
+	unsigned uncleCount() const { return rlp()[2].itemCount(); }
+	bytesConstRef uncle(unsigned _i) const { return rlp()[2][_i].data(); }
 
-using BlocksHash = std::map<h256, bytes>;
+private:
+	std::shared_ptr<bytes const> m_data;
+};
+
+struct BlockSize { size_t operator()(std::shared_ptr<bytes const> const& _b) const { return sizeof(bytes) + _b->capacity(); } };
+using BlocksCache = ShardedCache<h256, std::shared_ptr<bytes const>, BlockSize>;
+struct HeaderSize { size_t operator()(BlockInfo const& _h) const { return sizeof(BlockInfo) + _h.extraData.capacity(); } };
+using HeadersCache = ShardedCache<h256, BlockInfo, HeaderSize>;
 using TransactionHashes = h256s;
 using UncleHashes = h256s;
 
@@ -75,7 +102,10 @@ enum {
 	ExtraTransactionAddress,
 	ExtraLogBlooms,
 	ExtraReceipts,
-	ExtraBlocksBlooms
+	ExtraBlocksBlooms,
+	ExtraBloomBits,
+	ExtraBloomBitsSection,
+	ExtraLogIndex
 };
 
 using ProgressCallback = std::function<void(unsigned, unsigned)>;
@@ -93,6 +123,7 @@ enum class Aversion
 class BlockChain
 {
 public:
+	/// Opens the chain's DBs at @a _path, or in memory, touching no disk, if it is c_memoryDBPath.
 	BlockChain(bytes const& _genesisBlock, std::string _path, WithExisting _we, ProgressCallback const& _p = ProgressCallback());
 	~BlockChain();
 
@@ -104,6 +135,8 @@ public:
 	void process();
 
 	/// Sync the chain with any incoming blocks. All blocks should, if processed in order
+	/// The queue has already verified the headers, proofs of work and internal roots of the blocks drained, so they are
+	/// only executed, in turn; with asynchronous commits, their writes then go to the writer thread.
 	std::tuple<h256s, h256s, bool> sync(BlockQueue& _bq, OverlayDB const& _stateDB, unsigned _max);
 
 	/// Attempt to import the given block directly into the CanonBlockChain and sync with the state DB.
@@ -111,43 +144,85 @@ public:
 	std::pair<h256s, h256> attemptImport(bytes const& _block, OverlayDB const& _stateDB, Aversion _force = Aversion::AvoidOldBlocks) noexcept;
 
 	/// Import block into disk-backed DB
+	/// If @a _verified, the block's proof of work and internal roots are taken to have been checked already.
 	/// @returns the block hashes of any blocks that came into/went out of the canonical block chain.
-	std::pair<h256s, h256> import(bytes const& _block, OverlayDB const& _stateDB, Aversion _force = Aversion::AvoidOldBlocks);
+	std::pair<h256s, h256> import(bytes const& _block, OverlayDB const& _stateDB, Aversion _force = Aversion::AvoidOldBlocks, bool _verified = false);
+
+	/// What importBulk() did.
+	struct BulkImport
+	{
+		unsigned imported = 0;
+		unsigned alreadyHave = 0;
+		bool stopped = false;		///< Whether a block failed to import, ending it early.
+		u256 gasUsed;				///< By the blocks imported.
+	};
+
+	/// Imports the concatenated blocks of @a _blocks, in order, for offline use such as bootstrapping from an archive.
+	/// Blocks are decoded and verified in parallel chunks ahead of being executed in turn, and their extras go to the DB
+	/// in large batches. Known blocks are skipped; the first that fails to import ends it. With @a _s of IgnoreNonce,
+	/// proofs of work go unchecked, as for the synthetic chains of chaingen.
+	BulkImport importBulk(bytesConstRef _blocks, OverlayDB const& _stateDB, Strictness _s = CheckEverything);
+
+	/// Makes imports hand their DB writes to a writer thread, so that the next block can be executed meanwhile.
+	/// Until written, blocks and extras are still found by queries.
+	void setAsyncCommit(bool _async);
+	/// Blocks until everything imported so far has been written to the DBs.
+	void flush();
+
+	/// Begins a fast sync to the block @a _pivot, of hash @a _hash: blocks up to it are imported without being
+	/// executed, their state being downloaded instead, and none after it until notePivotState() says that it is.
+	/// Blocks so imported have no receipts or log blooms. Kept in the extras, so that it survives a restart.
+	void setPivot(unsigned _pivot, h256 const& _hash);
+	/// Notes that the pivot's state is now in the state DB, so that the blocks after it may be imported.
+	void notePivotState();
+	/// @returns the number of the pivot of the fast sync, if there has been one; 0 if not.
+	unsigned pivot() const { return m_pivot; }
+	/// @returns the hash of the pivot of the fast sync, if there has been one.
+	h256 pivotHash() const { Guard l(x_pivot); return m_pivotHash; }
+	/// @returns true if a fast sync awaits its pivot's state.
+	bool isAwaitingState() const { return m_pivot && !m_pivotState; }
 
 	/// Returns true if the given block is known (though not necessarily a part of the canon chain).
 	bool isKnown(h256 const& _hash) const;
 
 	/// Get the familial details concerning a block (or the most recent mined if none given). Thread-safe.
-	BlockInfo info(h256 const& _hash) const { return BlockInfo(block(_hash), IgnoreNonce, _hash); }
+	/// Get the header of a block, decoded and with its hashes, seed hash and boundary worked out, all cached. Thread-safe.
+	BlockInfo info(h256 const& _hash) const;
 	BlockInfo info() const { return info(currentHash()); }
 
 	/// Get a block (RLP format) for the given hash (or the most recent mined if none given). Thread-safe.
-	bytes block(h256 const& _hash) const;
+	/// The handle shares the cached copy; it is empty if the block is unknown.
+	BlockHandle blockHandle(h256 const& _hash) const;
+	/// As blockHandle(), but copied out.
+	bytes block(h256 const& _hash) const { return blockHandle(_hash).data().toBytes(); }
 	bytes block() const { return block(currentHash()); }
 	bytes oldBlock(h256 const& _hash) const;
 
 	/// Get the familial details concerning a block (or the most recent mined if none given). Thread-safe.
-	BlockDetails details(h256 const& _hash) const { return queryExtras<BlockDetails, ExtraDetails>(_hash, m_details, x_details, NullBlockDetails); }
+	BlockDetails details(h256 const& _hash) const { return queryExtras<BlockDetails, ExtraDetails>(_hash, m_details, NullBlockDetails); }
 	BlockDetails details() const { return details(currentHash()); }
 
 	/// Get the transactions' log blooms of a block (or the most recent mined if none given). Thread-safe.
-	BlockLogBlooms logBlooms(h256 const& _hash) const { return queryExtras<BlockLogBlooms, ExtraLogBlooms>(_hash, m_logBlooms, x_logBlooms, NullBlockLogBlooms); }
+	BlockLogBlooms logBlooms(h256 const& _hash) const { return queryExtras<BlockLogBlooms, ExtraLogBlooms>(_hash, m_logBlooms, NullBlockLogBlooms); }
 	BlockLogBlooms logBlooms() const { return logBlooms(currentHash()); }
 
 	/// Get the transactions' receipts of a block (or the most recent mined if none given). Thread-safe.
-	BlockReceipts receipts(h256 const& _hash) const { return queryExtras<BlockReceipts, ExtraReceipts>(_hash, m_receipts, x_receipts, NullBlockReceipts); }
+	BlockReceipts receipts(h256 const& _hash) const { return queryExtras<BlockReceipts, ExtraReceipts>(_hash, m_receipts, NullBlockReceipts); }
 	BlockReceipts receipts() const { return receipts(currentHash()); }
+	/// Get the receipt of transaction @a _i of a block, or NullTransactionReceipt if there is none. Unless the block's
+	/// receipts are cached, decodes only that one. Thread-safe.
+	TransactionReceipt receipt(h256 const& _hash, unsigned _i) const;
 
 	/// Get a list of transaction hashes for a given block. Thread-safe.
-	TransactionHashes transactionHashes(h256 const& _hash) const { auto b = block(_hash); RLP rlp(b); h256s ret; for (auto t: rlp[1]) ret.push_back(sha3(t.data())); return ret; }
+	TransactionHashes transactionHashes(h256 const& _hash) const { auto b = blockHandle(_hash); h256s ret; for (auto t: b.rlp()[1]) ret.push_back(sha3(t.data())); return ret; }
 	TransactionHashes transactionHashes() const { return transactionHashes(currentHash()); }
 
-	/// Get a list of uncle hashes for a given block. Thread-safe.
-	UncleHashes uncleHashes(h256 const& _hash) const { auto b = block(_hash); RLP rlp(b); h256s ret; for (auto t: rlp[2]) ret.push_back(sha3(t.data())); return ret; }
+	/// Get a list of uncle hashes for a given block; cached, as those of recent blocks are asked for again and again. Thread-safe.
+	UncleHashes uncleHashes(h256 const& _hash) const;
 	UncleHashes uncleHashes() const { return uncleHashes(currentHash()); }
 	
-	/// Get the hash for a given block's number.
-	h256 numberHash(unsigned _i) const { if (!_i) return genesisHash(); return queryExtras<BlockHash, ExtraBlockHash>(h256(u256(_i)), m_blockHashes, x_blockHashes, NullBlockHash).value; }
+	/// Get the hash for a given block's number: a read of the canonical hash array, unless it is past its end. Thread-safe.
+	h256 numberHash(unsigned _i) const { if (_i < m_canonCount) return canonHash(_i); if (!_i) return genesisHash(); return queryExtras<BlockHash, ExtraBlockHash>(h256(u256(_i)), m_blockHashes, NullBlockHash).value; }
 
 	/// Get the last N hashes for a given block. (N is determined by the LastHashes type.)
 	LastHashes lastHashes() const { return lastHashes(number()); }
@@ -168,22 +243,36 @@ public:
 	 * i * (x ^ n) + o * x ^ (n - 1)
 	 */
 	BlocksBlooms blocksBlooms(unsigned _level, unsigned _index) const { return blocksBlooms(chunkId(_level, _index)); }
-	BlocksBlooms blocksBlooms(h256 const& _chunkId) const { return queryExtras<BlocksBlooms, ExtraBlocksBlooms>(_chunkId, m_blocksBlooms, x_blocksBlooms, NullBlocksBlooms); }
+	BlocksBlooms blocksBlooms(h256 const& _chunkId) const { return queryExtras<BlocksBlooms, ExtraBlocksBlooms>(_chunkId, m_blocksBlooms, NullBlocksBlooms); }
 	void clearBlockBlooms(unsigned _begin, unsigned _end);
 	LogBloom blockBloom(unsigned _number) const { return blocksBlooms(chunkId(0, _number / c_bloomIndexSize)).blooms[_number % c_bloomIndexSize]; }
 	std::vector<unsigned> withBlockBloom(LogBloom const& _b, unsigned _earliest, unsigned _latest) const;
 	std::vector<unsigned> withBlockBloom(LogBloom const& _b, unsigned _earliest, unsigned _latest, unsigned _topLevel, unsigned _index) const;
 
+	/** Get the transposed bloom index of a section of the chain: which of the blocks
+	 * _section * c_bloomBitsSection .. (_section + 1) * c_bloomBitsSection - 1
+	 * have bit _bit of their block bloom set. Only meaningful if hasBloomBits(_section). Thread-safe.
+	 */
+	BloomBits bloomBits(unsigned _section, unsigned _bit) const { return queryExtras<BloomBits, ExtraBloomBits>(bloomBitsId(_section, _bit), m_bloomBits, NullBloomBits); }
+	/// @returns true if the transposed bloom index of @a _section is of the blocks now on the canonical chain.
+	bool hasBloomBits(unsigned _section) const;
+
+	/// @returns the first block whose logs are in the log index; none are if it is not kept (see Defaults::setLogIndex).
+	unsigned logIndexFrom() const { return m_logIndexFrom; }
+	/// @returns the positions, in order, of the logs in blocks @a _earliest .. @a _latest by @a _address with first topic
+	/// @a _topic0 (or h256() for those with no topics). Only those from logIndexFrom() on are indexed. Thread-safe.
+	std::vector<LogPosition> logPositions(Address const& _address, h256 const& _topic0, unsigned _earliest, unsigned _latest) const;
+
 	/// Get a transaction from its hash. Thread-safe.
-	bytes transaction(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); if (!ta) return bytes(); return transaction(ta.blockHash, ta.index); }
-	std::pair<h256, unsigned> transactionLocation(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, x_transactionAddresses, NullTransactionAddress); if (!ta) return std::pair<h256, unsigned>(h256(), 0); return std::make_pair(ta.blockHash, ta.index); }
+	bytes transaction(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, NullTransactionAddress); if (!ta) return bytes(); return transaction(ta.blockHash, ta.index); }
+	std::pair<h256, unsigned> transactionLocation(h256 const& _transactionHash) const { TransactionAddress ta = queryExtras<TransactionAddress, ExtraTransactionAddress>(_transactionHash, m_transactionAddresses, NullTransactionAddress); if (!ta) return std::pair<h256, unsigned>(h256(), 0); return std::make_pair(ta.blockHash, ta.index); }
 
 	/// Get a block's transaction (RLP format) for the given block hash (or the most recent mined if none given) & index. Thread-safe.
-	bytes transaction(h256 const& _blockHash, unsigned _i) const { bytes b = block(_blockHash); return RLP(b)[1][_i].data().toBytes(); }
+	bytes transaction(h256 const& _blockHash, unsigned _i) const { return blockHandle(_blockHash).transaction(_i).toBytes(); }
 	bytes transaction(unsigned _i) const { return transaction(currentHash(), _i); }
 
 	/// Get all transactions from a block.
-	std::vector<bytes> transactions(h256 const& _blockHash) const { bytes b = block(_blockHash); std::vector<bytes> ret; for (auto const& i: RLP(b)[1]) ret.push_back(i.data().toBytes()); return ret; }
+	std::vector<bytes> transactions(h256 const& _blockHash) const { auto b = blockHandle(_blockHash); std::vector<bytes> ret; for (auto const& i: b.transactions()) ret.push_back(i.toBytes()); return ret; }
 	std::vector<bytes> transactions() const { return transactions(currentHash()); }
 
 	/// Get a number for the given hash (or the most recent mined if none given). Thread-safe.
@@ -201,8 +290,13 @@ public:
 	/// togther with all their quoted uncles.
 	h256Set allUnclesFrom(h256 const& _parent) const;
 
+	/// @returns the hashes of at most @a _max blocks that a child of @a _parent may cite as uncles: children of the
+	/// six generations of ancestors before it neither on its chain nor cited by it, nearest first.
+	h256s uncleCandidates(h256 const& _parent, unsigned _max = 2) const;
+
 	/// Run through database and verify all blocks by reevaluating.
 	/// Will call _progress with the progress in this operation first param done, second total.
+	/// Resumes from the last checkpoint if a rebuild was interrupted; opening the chain does so too.
 	void rebuild(std::string const& _path, ProgressCallback const& _progress = std::function<void(unsigned, unsigned)>());
 
 	/** @returns a tuple of:
@@ -239,92 +333,165 @@ public:
 		unsigned memReceipts;
 		unsigned memTransactionAddresses;
 		unsigned memBlockHashes;
-		unsigned memTotal() const { return memBlocks + memDetails + memLogBlooms + memReceipts + memTransactionAddresses + memBlockHashes; }
+		unsigned memBlocksBlooms;
+		unsigned memBloomBits;
+		unsigned memLogIndex;
+		unsigned memUncleHashes;
+		unsigned memHeaders;
+		unsigned budget;		///< The bytes the caches together are kept within.
+		unsigned memTotal() const { return memBlocks + memDetails + memLogBlooms + memReceipts + memTransactionAddresses + memBlockHashes + memBlocksBlooms + memBloomBits + memLogIndex + memUncleHashes + memHeaders; }
 	};
 
 	/// @returns statistics about memory usage.
 	Statistics usage(bool _freshen = false) const { if (_freshen) updateStats(); return m_lastStats; }
 
-	/// Deallocate unused data.
+	/// @returns the DB of blocks, and that of their details and other extras; for their KeyValueDB::property()s.
+	KeyValueDB const& blocksDB() const { return *m_blocksDB; }
+	KeyValueDB const& extrasDB() const { return *m_extrasDB; }
+
+	/// Refreshes the statistics; the caches evict by themselves as they fill. If @a _force, empties them too.
 	void garbageCollect(bool _force = false);
 
+	/// Keeps the caches within @a _bytes of memory in total, evicting at once if they are over it.
+	void setCacheSize(size_t _bytes);
+
 private:
 	static h256 chunkId(unsigned _level, unsigned _index) { return h256(_index * 0xff + _level); }
+	static h256 bloomBitsId(unsigned _section, unsigned _bit) { return h256(u256(_section) * LogBloom::size * 8 + _bit); }
+
+	/// @returns those of blocks @a _earliest .. @a _latest, all in one indexed section, whose blooms contain @a _b.
+	std::vector<unsigned> withBloomBits(LogBloom const& _b, unsigned _earliest, unsigned _latest) const;
+	/// Indexes at most one section of blocks up to @a _confirmed not yet indexed: the newest if it needs it, else an older one.
+	void indexBloomBits(unsigned _confirmed);
+	/// Writes the transposed bloom index of @a _section from its blocks' blooms.
+	void buildBloomBits(unsigned _section);
+
+	static h256 logIndexId(Address const& _address, h256 const& _topic0, unsigned _chunk) { return sha3(rlpList(_address, _topic0, _chunk)); }
+	LogPostings logPostings(h256 const& _id) const { return queryExtras<LogPostings, ExtraLogIndex>(_id, m_logIndex, NullLogPostings); }
+
+	/// The extras a change of the canonical chain rewrites, each read once, changed in memory and then written once,
+	/// however many of the route's blocks touch it.
+	struct CanonDelta
+	{
+		BlocksBlooms& blooms(BlockChain const& _bc, h256 const& _id);
+		LogPostings& postings(BlockChain const& _bc, h256 const& _id);
+
+		std::map<h256, BlocksBlooms> bloomChunks;
+		std::map<h256, LogPostings> logPostings;
+		std::vector<std::pair<h256, TransactionAddress>> transactionAddresses;
+		std::vector<std::pair<unsigned, h256>> blockHashes;
+	};
+	/// Clears the blooms of blocks @a _begin .. @a _end - 1 in @a io_delta, rebuilding the higher levels they were in.
+	void clearBlockBlooms(unsigned _begin, unsigned _end, CanonDelta& io_delta) const;
+	/// Adds the logs of block @a _number, of hash @a _hash, to the log index in @a io_delta, as it joins the canonical chain.
+	void postLogs(h256 const& _hash, unsigned _number, CanonDelta& io_delta) const;
+	/// Removes the logs of blocks @a _begin .. @a _end - 1, those of the canonical chain being reverted, from the log
+	/// index in @a io_delta.
+	void revertLogs(unsigned _begin, unsigned _end, CanonDelta& io_delta) const;
+	/// Writes @a _delta, with @a _best as the best block if it is non-zero, in one batch, then caches it: the chunks,
+	/// postings and transaction addresses, and the block hashes, into the canonical hash array too.
+	void writeDelta(CanonDelta const& _delta, h256 const& _best = h256());
+	/// Makes the blocks of @a _route after @a _common canonical in place of those from @a _common to @a _last, and
+	/// @a _best, the route's end, the best block; written in one batch.
+	void switchCanon(h256s const& _route, h256 const& _common, h256 const& _last, h256 const& _best);
+	/// Starts, resumes or forgets the log index according to Defaults::setLogIndex().
+	void openLogIndex();
 
 	void open(std::string const& _path, WithExisting _we = WithExisting::Trust);
 	void close();
 
-	template<class T, unsigned N> T queryExtras(h256 const& _h, std::map<h256, T>& _m, boost::shared_mutex& _x, T const& _n, ldb::DB* _extrasDB = nullptr) const
+	template<class T, unsigned N> T queryExtras(h256 const& _h, ShardedCache<h256, T, ExtraSize>& _m, T const& _n, KeyValueReader const* _extrasDB = nullptr) const
 	{
-		{
-			ReadGuard l(_x);
-			auto it = _m.find(_h);
-			if (it != _m.end())
-				return it->second;
-		}
+		T ret;
+		if (_m.get(_h, ret))
+			return ret;
 
-		std::string s;
-		(_extrasDB ? _extrasDB : m_extrasDB)->Get(m_readOptions, toSlice(_h, N), &s);
+		std::string s = _extrasDB ? _extrasDB->lookup(toSlice(_h, N)) : lookupExtra(toSlice(_h, N));
 		if (s.empty())
 		{
 //			cout << "Not found in DB: " << _h << endl;
 			return _n;
 		}
 
-		noteUsed(_h, N);
-
-		WriteGuard l(_x);
-		auto ret = _m.insert(std::make_pair(_h, T(RLP(s))));
-		return ret.first->second;
+		ret = decodeExtra<T>(bytesConstRef(&s));
+		_m.insert(_h, ret);
+		return ret;
 	}
 
-	void checkConsistency();
+	/// Verifies @a _blocks in parallel, to @a _s, then imports them in turn as verified, old blocks. @returns how many
+	/// were imported before one failed, all of them if none did, adding the gas they used to @a io_gas.
+	size_t importChunk(std::vector<bytes> const& _blocks, OverlayDB const& _stateDB, u256& io_gas, Strictness _s = CheckEverything);
 
-	/// The caches of the disk DB and their locks.
-	mutable SharedMutex x_blocks;
-	mutable BlocksHash m_blocks;
-	mutable SharedMutex x_details;
-	mutable BlockDetailsHash m_details;
-	mutable SharedMutex x_logBlooms;
-	mutable BlockLogBloomsHash m_logBlooms;
-	mutable SharedMutex x_receipts;
-	mutable BlockReceiptsHash m_receipts;
-	mutable SharedMutex x_transactionAddresses;
-	mutable TransactionAddressHash m_transactionAddresses;
-	mutable SharedMutex x_blockHashes;
-	mutable BlockHashHash m_blockHashes;
-	mutable SharedMutex x_blocksBlooms;
-	mutable BlocksBloomsHash m_blocksBlooms;
-
-	using CacheID = std::pair<h256, unsigned>;
-	mutable Mutex x_cacheUsage;
-	mutable std::deque<std::set<CacheID>> m_cacheUsage;
-	mutable std::set<CacheID> m_inUse;
-	void noteUsed(h256 const& _h, unsigned _extra = (unsigned)-1) const;
-	std::chrono::system_clock::time_point m_lastCollection;
-
-	void noteCanonChanged() const { Guard l(x_lastLastHashes); m_lastLastHashes.clear(); }
-	mutable Mutex x_lastLastHashes;
-	mutable LastHashes m_lastLastHashes;
-	mutable unsigned m_lastLastHashesNumber = (unsigned)-1;
+	/// @returns the extra at @a _key, whether yet written or not.
+	std::string lookupExtra(bytesConstRef _key) const;
+
+	void checkConsistency();
+	/// Checks the blocks journaled before an unclean shutdown as checkConsistency() checks them all, dropping any
+	/// whose block was written without its details so that it is imported again.
+	void checkJournal();
+	/// Notes on disk that block @a _h is about to be written, before its batch is queued.
+	void journal(h256 const& _h);
+
+	/// The caches of the disk DB. Each locks and evicts by shard, so needs no lock of ours.
+	mutable BlocksCache m_blocks;
+	mutable BlockDetailsCache m_details;
+	mutable BlockLogBloomsCache m_logBlooms;
+	mutable BlockReceiptsCache m_receipts;
+	mutable TransactionAddressCache m_transactionAddresses;
+	mutable BlockHashCache m_blockHashes;
+	mutable BlocksBloomsCache m_blocksBlooms;
+	mutable BloomBitsCache m_bloomBits;
+	mutable LogPostingsCache m_logIndex;
+	/// The hashes of the uncles each recent block cites, those of the blocks uncles are checked and chosen against,
+	/// filled as blocks are imported. Keyed by block, so a change of the canonical chain leaves it valid.
+	mutable UncleHashesCache m_uncleHashes;
+	/// The headers of recent blocks, those asked for most, decoded; copies carry their hashes with them.
+	mutable HeadersCache m_headers;
+
+	Mutex x_bloomBits;								///< Held while indexing, so that only one import at a time does it.
+	unsigned m_bloomBitsBackfill = (unsigned)-1;	///< Sections below this, if any, may be unindexed; those above are known indexed.
+
+	std::atomic<unsigned> m_logIndexFrom{(unsigned)-1};
+
+	/// Maps the canonical hash array at @a _path, or anonymously if it is empty, bringing it into line with the extras,
+	/// all of it unless we were @a _clean ly closed.
+	void openCanonHashes(std::string const& _path, bool _clean);
+	/// Makes @a _h the hash of block @a _n in the canonical hash array, and forgets those after it. Only appends
+	/// to the array or overwrites it, so that readers need no lock.
+	void setCanonHash(unsigned _n, h256 const& _h);
+	h256 canonHash(unsigned _n) const { return h256(m_canonHashes->data() + (size_t)_n * h256::size, h256::ConstructFromPointer); }
+
+	/// The hashes of the canonical chain by number, as a file mapped into memory; null if it could not be mapped.
+	std::unique_ptr<GrowableMappedFile> m_canonHashes;
+	std::atomic<unsigned> m_canonCount{0};	///< The blocks of m_canonHashes on the canonical chain; those after are in the extras.
 
 	void updateStats() const;
 	mutable Statistics m_lastStats;
 
 	/// The disk DBs. Thread-safe, so no need for locks.
-	ldb::DB* m_blocksDB;
-	ldb::DB* m_extrasDB;
+	std::shared_ptr<KeyValueDB> m_blocksDB;
+	std::shared_ptr<KeyValueDB> m_extrasDB;
+
+	class Writer;
+	std::unique_ptr<Writer> m_writer;		///< Writes to the disk DBs, holding what is not yet written.
+	bool m_asyncCommit = false;
+
+	Mutex x_journal;
+	h256s m_journal;						///< The blocks last imported, oldest first; any not yet durable are among them.
+
+	/// The pivot of a fast sync; see setPivot().
+	std::atomic<unsigned> m_pivot{0};
+	std::atomic<bool> m_pivotState{false};	///< Whether the pivot's state is in the state DB.
+	mutable Mutex x_pivot;
+	h256 m_pivotHash;
 
 	/// Hash of the last (valid) block on the longest chain.
-	mutable boost::shared_mutex x_lastBlockHash;
+	mutable SharedMutex x_lastBlockHash;
 	h256 m_lastBlockHash;
 
 	/// Genesis block info.
 	h256 m_genesisHash;
-	bytes m_genesisBlock;
-
-	ldb::ReadOptions m_readOptions;
-	ldb::WriteOptions m_writeOptions;
+	std::shared_ptr<bytes const> m_genesisBlock;
 
 	friend std::ostream& operator<<(std::ostream& _out, BlockChain const& _bc);
 };
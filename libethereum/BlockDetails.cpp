@@ -26,6 +26,35 @@ using namespace std;
 using namespace dev;
 using namespace dev::eth;
 
+namespace
+{
+
+void appendLE32(bytes& io_out, unsigned _v)
+{
+	for (unsigned i = 0; i < 4; ++i)
+		io_out.push_back((byte)(_v >> (i * 8)));
+}
+
+unsigned readLE32(bytesConstRef _data, size_t _offset)
+{
+	if (_data.size() < _offset + 4)
+		BOOST_THROW_EXCEPTION(BadRLP());
+	return _data[_offset] | (_data[_offset + 1] << 8) | (_data[_offset + 2] << 16) | ((unsigned)_data[_offset + 3] << 24);
+}
+
+bool isCompact(bytesConstRef _data)
+{
+	return _data.size() && _data[0] == c_compactExtra;
+}
+
+/// The offset of the receipts after the count and the offsets of their ends.
+size_t receiptsBegin(unsigned _count)
+{
+	return 5 + _count * 4;
+}
+
+}
+
 BlockDetails::BlockDetails(RLP const& _r)
 {
 	number = _r[0].toInt<unsigned>();
@@ -41,3 +70,184 @@ bytes BlockDetails::rlp() const
 	size = ret.size();
 	return ret;
 }
+
+bytes BlockDetails::compact() const
+{
+	bytes ret(1, c_compactExtra);
+	ret.reserve(1 + 4 + 32 + h256::size * (1 + children.size()));
+	appendLE32(ret, number);
+	ret += h256(totalDifficulty).asBytes();
+	ret += parent.asBytes();
+	for (h256 const& c: children)
+		ret += c.asBytes();
+	size = ret.size();
+	return ret;
+}
+
+template <> BlockDetails dev::eth::decodeExtra<BlockDetails>(bytesConstRef _data)
+{
+	if (!isCompact(_data))
+		return BlockDetails(RLP(_data));
+	if (_data.size() < 69 || (_data.size() - 69) % h256::size)
+		BOOST_THROW_EXCEPTION(BadRLP());
+	BlockDetails ret;
+	ret.number = readLE32(_data, 1);
+	ret.totalDifficulty = fromBigEndian<u256>(_data.cropped(5, 32));
+	ret.parent = h256(_data.cropped(37, h256::size));
+	for (size_t i = 69; i < _data.size(); i += h256::size)
+		ret.children.push_back(h256(_data.cropped(i, h256::size)));
+	ret.size = _data.size();
+	return ret;
+}
+
+bytes BlockLogBlooms::compact() const
+{
+	bytes ret(1, c_compactExtra);
+	for (LogBloom const& b: blooms)
+		appendSparseBloom(ret, b);
+	size = ret.size();
+	return ret;
+}
+
+template <> BlockLogBlooms dev::eth::decodeExtra<BlockLogBlooms>(bytesConstRef _data)
+{
+	if (!isCompact(_data))
+		return BlockLogBlooms(RLP(_data));
+	BlockLogBlooms ret;
+	for (bytesConstRef d = _data.cropped(1); !d.empty();)
+		ret.blooms.push_back(readSparseBloom(d));
+	ret.size = _data.size();
+	return ret;
+}
+
+bytes BlocksBlooms::compact() const
+{
+	bytes ret(1, c_compactExtra);
+	for (LogBloom const& b: blooms)
+		appendSparseBloom(ret, b);
+	size = ret.size();
+	return ret;
+}
+
+template <> BlocksBlooms dev::eth::decodeExtra<BlocksBlooms>(bytesConstRef _data)
+{
+	if (!isCompact(_data))
+		return BlocksBlooms(RLP(_data));
+	BlocksBlooms ret;
+	bytesConstRef d = _data.cropped(1);
+	for (LogBloom& b: ret.blooms)
+		b = readSparseBloom(d);
+	ret.size = _data.size();
+	return ret;
+}
+
+bytes BlockReceipts::compact() const
+{
+	bytes ret(1, c_compactExtra);
+	appendLE32(ret, receipts.size());
+	ret.resize(receiptsBegin(receipts.size()));
+	for (unsigned i = 0; i < receipts.size(); ++i)
+	{
+		receipts[i].appendCompact(ret);
+		unsigned end = ret.size();
+		for (unsigned j = 0; j < 4; ++j)
+			ret[5 + i * 4 + j] = (byte)(end >> (j * 8));
+	}
+	size = ret.size();
+	return ret;
+}
+
+template <> BlockReceipts dev::eth::decodeExtra<BlockReceipts>(bytesConstRef _data)
+{
+	if (!isCompact(_data))
+		return BlockReceipts(RLP(_data));
+	BlockReceipts ret;
+	unsigned count = readLE32(_data, 1);
+	size_t begin = receiptsBegin(count);
+	for (unsigned i = 0; i < count; ++i)
+	{
+		size_t end = readLE32(_data, 5 + i * 4);
+		if (end < begin || end > _data.size())
+			BOOST_THROW_EXCEPTION(BadRLP());
+		ret.receipts.push_back(TransactionReceipt::fromCompact(_data.cropped(begin, end - begin)));
+		begin = end;
+	}
+	ret.size = _data.size();
+	return ret;
+}
+
+TransactionReceipt BlockReceipts::receiptAt(bytesConstRef _data, unsigned _i)
+{
+	if (!isCompact(_data))
+	{
+		RLP r(_data);
+		return _i < r.itemCount() ? TransactionReceipt(r[_i].data()) : NullTransactionReceipt;
+	}
+	unsigned count = readLE32(_data, 1);
+	if (_i >= count)
+		return NullTransactionReceipt;
+	size_t begin = _i ? readLE32(_data, 5 + (_i - 1) * 4) : receiptsBegin(count);
+	size_t end = readLE32(_data, 5 + _i * 4);
+	if (end < begin || end > _data.size())
+		BOOST_THROW_EXCEPTION(BadRLP());
+	return TransactionReceipt::fromCompact(_data.cropped(begin, end - begin));
+}
+
+BloomBits::BloomBits(RLP const& _r)
+{
+	// Little-endian words, so that the database is the same whatever the host.
+	words.fill(0);
+	bytesConstRef d = _r.toBytesConstRef();
+	for (unsigned i = 0; i < d.size() && i < words.size() * 8; ++i)
+		words[i / 8] |= uint64_t(d[i]) << (i % 8 * 8);
+}
+
+bytes BloomBits::rlp() const
+{
+	bytes d(words.size() * 8);
+	for (unsigned i = 0; i < d.size(); ++i)
+		d[i] = (byte)(words[i / 8] >> (i % 8 * 8));
+	return dev::rlp(d);
+}
+
+LogPostings::LogPostings(RLP const& _r)
+{
+	// Flat triples of block delta, transaction and log, so that each position takes about three bytes.
+	unsigned block = 0;
+	for (auto it = _r.begin(); it != _r.end();)
+	{
+		LogPosition p;
+		p.block = block += (*it).toInt<unsigned>();
+		if (++it == _r.end())
+			break;
+		p.transaction = (*it).toInt<unsigned>();
+		if (++it == _r.end())
+			break;
+		p.log = (*it).toInt<unsigned>();
+		++it;
+		positions.push_back(p);
+	}
+	size = _r.data().size();
+}
+
+bytes LogPostings::rlp() const
+{
+	RLPStream s(positions.size() * 3);
+	unsigned block = 0;
+	for (LogPosition const& p: positions)
+	{
+		s << (p.block - block) << p.transaction << p.log;
+		block = p.block;
+	}
+	size = s.out().size();
+	return s.out();
+}
+
+size_t ExtraSize::operator()(BlockReceipts const& _r) const
+{
+	size_t ret = sizeof(_r) + _r.receipts.size() * sizeof(TransactionReceipt);
+	for (TransactionReceipt const& i: _r.receipts)
+		for (LogEntry const& l: i.log())
+			ret += sizeof(l) + l.topics.size() * sizeof(h256) + l.data.size();
+	return ret;
+}
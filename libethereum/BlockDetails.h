@@ -21,6 +21,8 @@
 
 #pragma once
 
+#include <algorithm>
+#include <tuple>
 #pragma warning(push)
 #pragma warning(disable: 4100 4267)
 #include <leveldb/db.h>
@@ -28,6 +30,7 @@
 
 #include <libdevcore/Log.h>
 #include <libdevcore/RLP.h>
+#include <libdevcore/ShardedCache.h>
 #include "TransactionReceipt.h"
 namespace ldb = leveldb;
 
@@ -41,12 +44,27 @@ namespace eth
 static const unsigned c_bloomIndexSize = 16;
 static const unsigned c_bloomIndexLevels = 2;
 
+/// Blocks in each section of the transposed bloom index; the bitmap of one bloom bit over a section is 512 bytes.
+static const unsigned c_bloomBitsSection = 4096;
+/// Blocks a section must be buried under before it is indexed, so that reorganisations seldom reach it.
+static const unsigned c_bloomBitsConfirmations = 256;
+
+/// Blocks in each chunk of the log index; the logs of an address and first topic are listed chunk by chunk.
+static const unsigned c_logIndexChunk = 4096;
+
+/// The first byte of an extra in its compact form, the version of that form. Extras written as RLP, as they were
+/// before, are lists, so start with 0xc0 or more.
+static const byte c_compactExtra = 1;
+
 struct BlockDetails
 {
 	BlockDetails(): number(0), totalDifficulty(0) {}
 	BlockDetails(unsigned _n, u256 _tD, h256 _p, h256s _c): number(_n), totalDifficulty(_tD), parent(_p), children(_c) {}
 	BlockDetails(RLP const& _r);
 	bytes rlp() const;
+	/// @returns the details as the extras DB keeps them: the version, then the number (4 bytes, little-endian), total
+	/// difficulty (32 bytes, big-endian) and parent at fixed offsets, then the children.
+	bytes compact() const;
 
 	bool isNull() const { return !totalDifficulty; }
 	explicit operator bool() const { return !isNull(); }
@@ -56,7 +74,7 @@ struct BlockDetails
 	h256 parent;
 	h256s children;
 
-	mutable unsigned size;
+	mutable unsigned size = 0;
 };
 
 struct BlockLogBlooms
@@ -64,9 +82,11 @@ struct BlockLogBlooms
 	BlockLogBlooms() {}
 	BlockLogBlooms(RLP const& _r) { blooms = _r.toVector<LogBloom>(); size = _r.data().size(); }
 	bytes rlp() const { RLPStream s; s << blooms; size = s.out().size(); return s.out(); }
+	/// @returns the blooms as the extras DB keeps them: the version, then each as appendSparseBloom() has it.
+	bytes compact() const;
 
 	LogBlooms blooms;
-	mutable unsigned size;
+	mutable unsigned size = 0;
 };
 
 struct BlocksBlooms
@@ -74,19 +94,63 @@ struct BlocksBlooms
 	BlocksBlooms() {}
 	BlocksBlooms(RLP const& _r) { blooms = _r.toArray<LogBloom, c_bloomIndexSize>(); size = _r.data().size(); }
 	bytes rlp() const { RLPStream s; s << blooms; size = s.out().size(); return s.out(); }
+	/// @returns the blooms as the extras DB keeps them: the version, then each as appendSparseBloom() has it.
+	bytes compact() const;
 
 	std::array<LogBloom, c_bloomIndexSize> blooms;
-	mutable unsigned size;
+	mutable unsigned size = 0;
+};
+
+/// Which blocks of a section of the chain have one given bit of their block bloom set, a bit per block.
+struct BloomBits
+{
+	BloomBits() { words.fill(0); }
+	BloomBits(RLP const& _r);
+	bytes rlp() const;
+
+	std::array<uint64_t, c_bloomBitsSection / 64> words;
+	static const unsigned size = c_bloomBitsSection / 8 + 3;
+};
+
+/// Where a log is on the chain: the block's number, the transaction's index in it and the log's in that.
+struct LogPosition
+{
+	unsigned block;
+	unsigned transaction;
+	unsigned log;
+
+	bool operator<(LogPosition const& _c) const { return std::tie(block, transaction, log) < std::tie(_c.block, _c.transaction, _c.log); }
+};
+
+/// The positions, in order, of the logs of one address and first topic within one chunk of the chain.
+struct LogPostings
+{
+	LogPostings() {}
+	LogPostings(RLP const& _r);
+	bytes rlp() const;
+
+	/// Forgets the positions in block @a _number and after.
+	void truncate(unsigned _number) { positions.erase(std::lower_bound(positions.begin(), positions.end(), LogPosition{_number, 0, 0}), positions.end()); }
+
+	std::vector<LogPosition> positions;
+	mutable unsigned size = 0;
 };
 
 struct BlockReceipts
 {
 	BlockReceipts() {}
 	BlockReceipts(RLP const& _r) { for (auto const& i: _r) receipts.emplace_back(i.data()); size = _r.data().size(); }
-	bytes rlp() const { RLPStream s(receipts.size()); for (TransactionReceipt const& i: receipts) i.streamRLP(s); size = s.out().size(); return s.out(); }
+	bytes rlp() const { bytes ret = rlpExact([&](RLPStream& _s){ _s.appendList(receipts.size()); for (TransactionReceipt const& i: receipts) i.streamRLP(_s); }); size = ret.size(); return ret; }
+	/// @returns the receipts as the extras DB keeps them: the version, their count (4 bytes, little-endian), the
+	/// offset of the end of each likewise, then each as TransactionReceipt::appendCompact() has it.
+	bytes compact() const;
+
+	/// @returns receipt @a _i of the receipts kept as @a _data, decoding none of the others, or NullTransactionReceipt
+	/// if there is no such receipt.
+	static TransactionReceipt receiptAt(bytesConstRef _data, unsigned _i);
 
 	TransactionReceipts receipts;
-	mutable unsigned size;
+	mutable unsigned size = 0;
 };
 
 struct BlockHash
@@ -113,19 +177,46 @@ struct TransactionAddress
 	static const unsigned size = 67;
 };
 
-using BlockDetailsHash = std::map<h256, BlockDetails>;
-using BlockLogBloomsHash = std::map<h256, BlockLogBlooms>;
-using BlockReceiptsHash = std::map<h256, BlockReceipts>;
-using TransactionAddressHash = std::map<h256, TransactionAddress>;
-using BlockHashHash = std::map<h256, BlockHash>;
-using BlocksBloomsHash = std::map<h256, BlocksBlooms>;
+/// The bytes an extra takes in memory, as accounted for by BlockChain's caches.
+struct ExtraSize
+{
+	size_t operator()(BlockDetails const& _d) const { return sizeof(_d) + _d.children.size() * sizeof(h256); }
+	size_t operator()(BlockLogBlooms const& _b) const { return sizeof(_b) + _b.blooms.size() * sizeof(LogBloom); }
+	size_t operator()(BlocksBlooms const& _b) const { return sizeof(_b); }
+	size_t operator()(BloomBits const& _b) const { return sizeof(_b); }
+	size_t operator()(LogPostings const& _p) const { return sizeof(_p) + _p.positions.size() * sizeof(LogPosition); }
+	size_t operator()(BlockReceipts const& _r) const;
+	size_t operator()(BlockHash const& _h) const { return sizeof(_h); }
+	size_t operator()(TransactionAddress const& _a) const { return sizeof(_a); }
+	size_t operator()(h256s const& _h) const { return sizeof(_h) + _h.size() * sizeof(h256); }
+};
+
+using BlockDetailsCache = ShardedCache<h256, BlockDetails, ExtraSize>;
+using BlockLogBloomsCache = ShardedCache<h256, BlockLogBlooms, ExtraSize>;
+using BlockReceiptsCache = ShardedCache<h256, BlockReceipts, ExtraSize>;
+using TransactionAddressCache = ShardedCache<h256, TransactionAddress, ExtraSize>;
+using BlockHashCache = ShardedCache<h256, BlockHash, ExtraSize>;
+using BlocksBloomsCache = ShardedCache<h256, BlocksBlooms, ExtraSize>;
+using BloomBitsCache = ShardedCache<h256, BloomBits, ExtraSize>;
+using LogPostingsCache = ShardedCache<h256, LogPostings, ExtraSize>;
+using UncleHashesCache = ShardedCache<h256, h256s, ExtraSize>;
+
+/// @returns the extra kept as @a _data in the extras DB, whether in its compact form or as RLP.
+template <class T> T decodeExtra(bytesConstRef _data) { return T(RLP(_data)); }
+template <> BlockDetails decodeExtra<BlockDetails>(bytesConstRef _data);
+template <> BlockLogBlooms decodeExtra<BlockLogBlooms>(bytesConstRef _data);
+template <> BlocksBlooms decodeExtra<BlocksBlooms>(bytesConstRef _data);
+template <> BlockReceipts decodeExtra<BlockReceipts>(bytesConstRef _data);
 
 static const BlockDetails NullBlockDetails;
 static const BlockLogBlooms NullBlockLogBlooms;
 static const BlockReceipts NullBlockReceipts;
+static const TransactionReceipt NullTransactionReceipt(h256(), 0, LogEntries());
 static const TransactionAddress NullTransactionAddress;
 static const BlockHash NullBlockHash;
 static const BlocksBlooms NullBlocksBlooms;
+static const BloomBits NullBloomBits;
+static const LogPostings NullLogPostings;
 
 }
 }
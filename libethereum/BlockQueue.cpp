@@ -29,7 +29,91 @@ using namespace std;
 using namespace dev;
 using namespace dev::eth;
 
-ImportResult BlockQueue::import(bytesConstRef _block, BlockChain const& _bc)
+namespace
+{
+/// The checks of a block that depend on nothing else: its header, proof of work and transaction/uncle roots.
+void verifyBlock(bytesConstRef _block)
+{
+	BlockInfo bi(_block, CheckEverything);
+	bi.verifyInternals(_block);
+}
+}
+
+void BlockQueue::setVerifierThreads(unsigned _n)
+{
+	{
+		lock_guard<Mutex> l(x_verification);
+		m_deleting = true;
+	}
+	m_moreToVerify.notify_all();
+	for (auto& t: m_verifiers)
+		t.join();
+	m_verifiers.clear();
+	m_deleting = false;
+
+	if (_n)
+		for (unsigned i = 0; i < _n; ++i)
+			m_verifiers.push_back(std::thread([=](){ setThreadName("verifier"); verifierBody(); }));
+	else
+		// Nothing left to pick up what is still queued; verify it here.
+		while (true)
+		{
+			pair<h256, SharedBlock> work;
+			{
+				lock_guard<Mutex> l(x_verification);
+				if (m_unverified.empty())
+					break;
+				work = move(m_unverified.front());
+				m_unverified.pop_front();
+			}
+			noteVerified(work);
+		}
+}
+
+void BlockQueue::verifierBody()
+{
+	while (true)
+	{
+		pair<h256, SharedBlock> work;
+		{
+			unique_lock<Mutex> l(x_verification);
+			m_moreToVerify.wait(l, [&](){ return m_deleting || !m_unverified.empty(); });
+			if (m_deleting)
+				return;
+			work = move(m_unverified.front());
+			m_unverified.pop_front();
+		}
+		noteVerified(work);
+	}
+}
+
+void BlockQueue::noteVerified(pair<h256, SharedBlock> const& _work)
+{
+	bool bad = false;
+	try
+	{
+		verifyBlock(bytesConstRef(_work.second.get()));
+	}
+	catch (Exception const& _e)
+	{
+		cwarn << "Ignoring invalid block: " << diagnostic_information(_e);
+		bad = true;
+	}
+
+	WriteGuard l(m_lock);
+	// Cleared meanwhile; forget it.
+	if (!m_verifyingSet.erase(_work.first))
+		return;
+	if (bad)
+	{
+		m_knownBad.insert(_work.first);
+		m_newBad = true;
+	}
+	else if (m_onReady)
+		m_onReady();
+}
+
+ImportResult BlockQueue::import(bytesConstRef _block, SharedBlock _shared, BlockChain const& _bc)
 {
 	// Check if we already know this block.
 	h256 h = BlockInfo::headerHash(_block);
@@ -38,21 +122,21 @@ ImportResult BlockQueue::import(bytesConstRef _block, BlockChain const& _bc)
 
 	UpgradableGuard l(m_lock);
 
-	if (m_readySet.count(h) || m_drainingSet.count(h) || m_unknownSet.count(h) || m_knownBad.count(h))
+	if (m_readySet.count(h) || m_drainingSet.count(h) || m_held.count(h) || m_knownBad.count(h))
 	{
 		// Already know about this one.
 		cblockq << "Already known.";
 		return ImportResult::AlreadyKnown;
 	}
 
-	// VERIFY: populates from the block and checks the block is internally coherent.
+	// VERIFY: populates from the block; checks it in full now unless the verifier threads are to.
 	BlockInfo bi;
 
 	try
 	{
-		// TODO: quick verify
-		bi.populate(_block);
-		bi.verifyInternals(_block);
+		bi.populate(_block, m_verifiers.empty() ? CheckEverything : IgnoreNonce, h);
+		if (m_verifiers.empty())
+			bi.verifyInternals(_block);
 	}
 	catch (Exception const& _e)
 	{
@@ -69,10 +153,15 @@ ImportResult BlockQueue::import(bytesConstRef _block, BlockChain const& _bc)
 
 	UpgradeGuard ul(l);
 
+	// From here it is queued, in whichever queues it goes to, as the one copy.
+	if (!_shared)
+		_shared = make_shared<bytes const>(_block.toBytes());
+
 	// Check it's not in the future
 	if (bi.timestamp > (u256)time(0))
 	{
-		m_future.insert(make_pair((unsigned)bi.timestamp, _block.toBytes()));
+		m_future.insert(make_pair((unsigned)bi.timestamp, make_pair(h, _shared)));
+		holdWithoutWriteGuard(h, bi, _block.size(), true);
 		cblockq << "OK - queued for future.";
 		return ImportResult::FutureTime;
 	}
@@ -85,12 +174,24 @@ ImportResult BlockQueue::import(bytesConstRef _block, BlockChain const& _bc)
 			// bad parent; this is bad too, note it as such
 			return ImportResult::BadChain;
 		}
-		else if (!m_readySet.count(bi.parentHash) && !m_drainingSet.count(bi.parentHash) && !_bc.isKnown(bi.parentHash))
+
+		if (!m_verifiers.empty())
+		{
+			m_verifyingSet.insert(h);
+			{
+				lock_guard<Mutex> vl(x_verification);
+				m_unverified.push_back(make_pair(h, _shared));
+			}
+			m_moreToVerify.notify_one();
+		}
+
+		if (!m_readySet.count(bi.parentHash) && !m_drainingSet.count(bi.parentHash) && !_bc.isKnown(bi.parentHash))
 		{
 			// We don't know the parent (yet) - queue it up for later. It'll get resent to us if we find out about its ancestry later on.
 			cblockq << "OK - queued as unknown parent:" << bi.parentHash.abridged();
-			m_unknown.insert(make_pair(bi.parentHash, make_pair(h, _block.toBytes())));
+			m_unknown.insert(make_pair(bi.parentHash, make_pair(h, _shared)));
 			m_unknownSet.insert(h);
+			holdWithoutWriteGuard(h, bi, _block.size(), false);
 
 			return ImportResult::UnknownParent;
 		}
@@ -98,10 +199,13 @@ ImportResult BlockQueue::import(bytesConstRef _block, BlockChain const& _bc)
 		{
 			// If valid, append to blocks.
 			cblockq << "OK - ready for chain insertion.";
-			m_ready.push_back(_block.toBytes());
+			m_ready.push_back(make_pair(h, _shared));
 			m_readySet.insert(h);
+			m_bytes += _block.size();
 
 			noteReadyWithoutWriteGuard(h);
+			if (m_onReady)
+				m_onReady();
 			return ImportResult::Success;
 		}
 	}
@@ -111,31 +215,121 @@ bool BlockQueue::doneDrain(h256s const& _bad)
 {
 	WriteGuard l(m_lock);
 	m_drainingSet.clear();
-	if (_bad.size())
-	{
-		vector<bytes> old;
-		swap(m_ready, old);
-		for (auto& b: old)
+	m_knownBad += _bad;
+	if (_bad.size() || m_newBad)
+		dropBadWithoutWriteGuard();
+	return !m_ready.empty() && !m_verifyingSet.count(m_ready.front().first);
+}
+
+void BlockQueue::dropBadWithoutWriteGuard()
+{
+	m_newBad = false;
+	// The queue is in chain order, so a parent is always dropped before its children are looked at.
+	vector<pair<h256, SharedBlock>> old;
+	swap(m_ready, old);
+	for (auto& b: old)
+		if (m_knownBad.count(b.first) || m_knownBad.count(BlockInfo(*b.second).parentHash))
 		{
-			BlockInfo bi(b);
-			if (m_knownBad.count(bi.parentHash))
-				m_knownBad.insert(bi.hash());
-			else
-				m_ready.push_back(std::move(b));
+			m_knownBad.insert(b.first);
+			m_readySet.erase(b.first);
+			m_verifyingSet.erase(b.first);
+			m_bytes -= b.second->size();
 		}
+		else
+			m_ready.push_back(std::move(b));
+}
+
+void BlockQueue::clear()
+{
+	WriteGuard l(m_lock);
+	{
+		lock_guard<Mutex> vl(x_verification);
+		m_unverified.clear();
 	}
-	m_knownBad += _bad;
-	return !m_readySet.empty();
+	m_readySet.clear();
+	m_drainingSet.clear();
+	m_ready.clear();
+	m_unknownSet.clear();
+	m_unknown.clear();
+	m_future.clear();
+	m_verifyingSet.clear();
+	m_held.clear();
+	m_heldByWork.clear();
+	m_bytes = 0;
 }
 
 void BlockQueue::tick(BlockChain const& _bc)
 {
 	unsigned t = time(0);
-	for (auto i = m_future.begin(); i != m_future.end() && i->first < t; ++i)
-		import(&(i->second), _bc);
+	vector<SharedBlock> due;
+	{
+		UpgradableGuard l(m_lock);
+		if (m_future.empty() || m_future.begin()->first > t)
+			return;
+		UpgradeGuard ul(l);
+		auto end = m_future.upper_bound(t);
+		for (auto i = m_future.begin(); i != end; ++i)
+		{
+			unholdWithoutWriteGuard(i->second.first, true);
+			due.push_back(move(i->second.second));
+		}
+		m_future.erase(m_future.begin(), end);
+	}
+	// Imported as if new; any of their children waiting on them follow them into the ready queue.
+	for (auto const& b: due)
+		import(b, _bc);
+}
 
-	WriteGuard l(m_lock);
-	m_future.erase(m_future.begin(), m_future.upper_bound(t));
+void BlockQueue::holdWithoutWriteGuard(h256 const& _h, BlockInfo const& _bi, size_t _size, bool _future)
+{
+	m_held[_h] = Held{_future, (unsigned)_bi.timestamp, _bi.parentHash, _size, m_heldByWork.insert(make_pair(_bi.difficulty, _h))};
+	m_bytes += _size;
+	evictWithoutWriteGuard();
+}
+
+void BlockQueue::unholdWithoutWriteGuard(h256 const& _h, bool _gone)
+{
+	auto it = m_held.find(_h);
+	if (it == m_held.end())
+		return;
+	if (_gone)
+		m_bytes -= it->second.size;
+	m_heldByWork.erase(it->second.byWork);
+	m_held.erase(it);
+}
+
+void BlockQueue::evictWithoutWriteGuard()
+{
+	while (m_bytes > m_limit && !m_heldByWork.empty())
+	{
+		h256 h = m_heldByWork.begin()->second;
+		Held const& held = m_held.at(h);
+		if (held.future)
+		{
+			auto r = m_future.equal_range(held.timestamp);
+			for (auto it = r.first; it != r.second; ++it)
+				if (it->second.first == h)
+				{
+					m_future.erase(it);
+					break;
+				}
+		}
+		else
+		{
+			// Its children, if any, stay to be evicted in turn or to be sent again.
+			auto r = m_unknown.equal_range(held.parent);
+			for (auto it = r.first; it != r.second; ++it)
+				if (it->second.first == h)
+				{
+					m_unknown.erase(it);
+					break;
+				}
+			m_unknownSet.erase(h);
+			m_verifyingSet.erase(h);
+		}
+		cblockq << "Evicted" << h.abridged() << "over the memory limit.";
+		unholdWithoutWriteGuard(h, true);
+	}
 }
 
 template <class T> T advanced(T _t, unsigned _n)
@@ -144,23 +338,28 @@ template <class T> T advanced(T _t, unsigned _n)
 	return _t;
 }
 
-void BlockQueue::drain(std::vector<bytes>& o_out, unsigned _max)
+void BlockQueue::drain(std::vector<SharedBlock>& o_out, unsigned _max)
 {
 	WriteGuard l(m_lock);
 	if (m_drainingSet.empty())
 	{
-		o_out.resize(min<unsigned>(_max, m_ready.size()));
-		for (unsigned i = 0; i < o_out.size(); ++i)
-			swap(o_out[i], m_ready[i]);
-		m_ready.erase(m_ready.begin(), advanced(m_ready.begin(), o_out.size()));
-		for (auto const& bs: o_out)
+		// Blocks that failed verification since the last drain go, with their descendants.
+		if (m_newBad)
+			dropBadWithoutWriteGuard();
+
+		// Only the verified prefix may go; the rest waits for its parents to pass.
+		unsigned n = 0;
+		while (n < min<unsigned>(_max, m_ready.size()) && !m_verifyingSet.count(m_ready[n].first))
+			++n;
+		o_out.resize(n);
+		for (unsigned i = 0; i < n; ++i)
 		{
-			auto h = sha3(bs);
-			m_drainingSet.insert(h);
-			m_readySet.erase(h);
+			m_bytes -= m_ready[i].second->size();
+			swap(o_out[i], m_ready[i].second);
+			m_drainingSet.insert(m_ready[i].first);
+			m_readySet.erase(m_ready[i].first);
 		}
-//		swap(o_out, m_ready);
-//		swap(m_drainingSet, m_readySet);
+		m_ready.erase(m_ready.begin(), advanced(m_ready.begin(), n));
 	}
 }
 
@@ -173,9 +372,13 @@ void BlockQueue::noteReadyWithoutWriteGuard(h256 _good)
 		goodQueue.pop_front();
 		for (auto it = r.first; it != r.second; ++it)
 		{
-			m_ready.push_back(it->second.second);
 			auto newReady = it->second.first;
 			m_unknownSet.erase(newReady);
+			unholdWithoutWriteGuard(newReady, m_knownBad.count(newReady));
+			// Failed verification while waiting for its parent; its own children stay unknown.
+			if (m_knownBad.count(newReady))
+				continue;
+			m_ready.push_back(it->second);
 			m_readySet.insert(newReady);
 			goodQueue.push_back(newReady);
 		}
@@ -21,6 +21,11 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <thread>
 #include <boost/thread.hpp>
 #include <libdevcore/Common.h>
 #include <libdevcore/Log.h>
@@ -34,6 +39,10 @@ namespace eth
 {
 
 class BlockChain;
+struct BlockInfo;
+
+/// A block's RLP, shared rather than copied as it goes from the network through the queue into the chain.
+using SharedBlock = std::shared_ptr<bytes const>;
 
 struct BlockQueueChannel: public LogChannel { static const char* name() { return "[]Q"; } static const int verbosity = 4; };
 #define cblockq dev::LogOutputStream<dev::eth::BlockQueueChannel, true>()
@@ -44,28 +53,55 @@ struct BlockQueueStatus
 	size_t future;
 	size_t unknown;
 	size_t bad;
+	size_t verifying;
+	size_t memory;		///< Bytes of the blocks held, ready or not.
 };
 
 /**
  * @brief A queue of blocks. Sits between network or other I/O and the BlockChain.
  * Sorts them ready for blockchain insertion (with the BlockChain::sync() method).
+ * Every block is checked in full (header, proof of work, transaction and uncle roots) before it is drained;
+ * with verifier threads, these checks run concurrently, off the thread that imports.
+ * The blocks it holds are kept within a memory limit. Over it, those held back, from the future or of unknown
+ * parents, are evicted, those whose proof of work took least first, so that blocks cheap to make cannot crowd out
+ * those of the chain.
  * @threadsafe
  */
 class BlockQueue
 {
 public:
-	/// Import a block into the queue.
-	ImportResult import(bytesConstRef _tx, BlockChain const& _bc);
+	BlockQueue() { setLockName(m_lock, "BlockQueue::m_lock"); setLockName(x_verification, "BlockQueue::x_verification"); }
+	~BlockQueue() { setVerifierThreads(0); }
+
+	/// Import a block into the queue. Without verifier threads, the block is verified in full before this returns;
+	/// with them, only its header is parsed here and it is drained once a verifier has passed it.
+	/// The block is copied only should it be queued.
+	ImportResult import(bytesConstRef _block, BlockChain const& _bc) { return import(_block, SharedBlock(), _bc); }
+	/// As above, keeping @a _block itself, not a copy; it is what drain() gives.
+	ImportResult import(SharedBlock const& _block, BlockChain const& _bc) { return import(bytesConstRef(_block.get()), _block, _bc); }
+
+	/// Sets @a _f to be called whenever a block may have become ready for import. It is called with the queue locked, so
+	/// must not call back into it. Call before any block is imported.
+	void onReady(std::function<void()> const& _f) { m_onReady = _f; }
+
+	/// Runs @a _n threads to verify newly arrived blocks. 0 (the default) verifies them within import().
+	/// Not to be called while another thread may be importing.
+	void setVerifierThreads(unsigned _n);
 
-	/// Notes that time has moved on and some blocks that used to be "in the future" may no be valid.
+	/// Imports the blocks that were "in the future" and no longer are. Cheap when none are due.
 	void tick(BlockChain const& _bc);
+	/// @returns the time at which the next block "in the future" falls due, or 0 if none is queued.
+	unsigned nextFuture() const { ReadGuard l(m_lock); return m_future.empty() ? 0 : m_future.begin()->first; }
 
-	/// Grabs at most @a _max of the blocks that are ready, giving them in the correct order for insertion into the chain.
+	/// Keeps the blocks queued within @a _bytes, evicting at once down to it.
+	void setMemoryLimit(size_t _bytes) { WriteGuard l(m_lock); m_limit = _bytes; evictWithoutWriteGuard(); }
+
+	/// Grabs at most @a _max of the blocks that are ready and verified, giving them in the correct order for insertion into the chain.
 	/// Don't forget to call doneDrain() once you're done importing.
-	void drain(std::vector<bytes>& o_out, unsigned _max);
+	void drain(std::vector<SharedBlock>& o_out, unsigned _max);
 
 	/// Must be called after a drain() call. Notes that the drained blocks have been imported into the blockchain, so we can forget about them.
-	/// @returns true iff there are additional blocks ready to be processed.
+	/// @returns true iff there are additional blocks ready and verified to be processed.
 	bool doneDrain(h256s const& _knownBad = h256s());
 
 	/// Notify the queue that the chain has changed and a new block has attained 'ready' status (i.e. is in the chain).
@@ -75,26 +111,66 @@ public:
 	std::pair<unsigned, unsigned> items() const { ReadGuard l(m_lock); return std::make_pair(m_ready.size(), m_unknown.size()); }
 
 	/// Clear everything.
-	void clear() { WriteGuard l(m_lock); m_readySet.clear(); m_drainingSet.clear(); m_ready.clear(); m_unknownSet.clear(); m_unknown.clear(); m_future.clear(); }
+	void clear();
 
 	/// Return first block with an unknown parent.
 	h256 firstUnknown() const { ReadGuard l(m_lock); return m_unknownSet.size() ? *m_unknownSet.begin() : h256(); }
 
 	/// Get some infomration on the current status.
-	BlockQueueStatus status() const { ReadGuard l(m_lock); return BlockQueueStatus{m_ready.size(), m_future.size(), m_unknown.size(), m_knownBad.size()}; }
+	BlockQueueStatus status() const { ReadGuard l(m_lock); return BlockQueueStatus{m_ready.size(), m_future.size(), m_unknown.size(), m_knownBad.size(), m_verifyingSet.size(), m_bytes}; }
+
+	/// The memory limit unless set otherwise.
+	static const size_t c_defaultMemoryLimit = 128 * 1024 * 1024;
 
 private:
+	/// A block held back, in m_future or m_unknown, as the eviction index knows it.
+	struct Held
+	{
+		bool future;
+		unsigned timestamp;
+		h256 parent;
+		size_t size;
+		std::multimap<u256, h256>::iterator byWork;
+	};
+
+	/// Imports @a _block, which is @a _shared unless that is null, in which case it is copied should it be queued.
+	ImportResult import(bytesConstRef _block, SharedBlock _shared, BlockChain const& _bc);
+
+	/// Notes block @a _h, of @a _size bytes and header @a _bi, as held back in m_future if @a _future, else in
+	/// m_unknown, then evicts as needed.
+	void holdWithoutWriteGuard(h256 const& _h, BlockInfo const& _bi, size_t _size, bool _future);
+	/// Forgets that block @a _h is held back; its bytes stay counted unless @a _gone.
+	void unholdWithoutWriteGuard(h256 const& _h, bool _gone);
+	/// Evicts held-back blocks, least work first, until within the memory limit or none is left.
+	void evictWithoutWriteGuard();
+
 	void noteReadyWithoutWriteGuard(h256 _b);
 	void notePresentWithoutWriteGuard(bytesConstRef _block);
+	void dropBadWithoutWriteGuard();
+	void verifierBody();
+	void noteVerified(std::pair<h256, SharedBlock> const& _work);
 
-	mutable boost::shared_mutex m_lock;						///< General lock.
+	mutable SharedMutex m_lock;								///< General lock.
 	std::set<h256> m_readySet;								///< All blocks ready for chain-import.
 	std::set<h256> m_drainingSet;							///< All blocks being imported.
-	std::vector<bytes> m_ready;								///< List of blocks, in correct order, ready for chain-import.
+	std::vector<std::pair<h256, SharedBlock>> m_ready;		///< List of blocks, in correct order, ready for chain-import.
 	std::set<h256> m_unknownSet;							///< Set of all blocks whose parents are not ready/in-chain.
-	std::multimap<h256, std::pair<h256, bytes>> m_unknown;	///< For transactions that have an unknown parent; we map their parent hash to the block stuff, and insert once the block appears.
-	std::multimap<unsigned, bytes> m_future;				///< Set of blocks that are not yet valid.
+	std::multimap<h256, std::pair<h256, SharedBlock>> m_unknown;	///< For transactions that have an unknown parent; we map their parent hash to the block stuff, and insert once the block appears.
+	std::multimap<unsigned, std::pair<h256, SharedBlock>> m_future;	///< Blocks that are not yet valid, by timestamp.
+	std::map<h256, Held> m_held;							///< The blocks of m_unknown and m_future.
+	std::multimap<u256, h256> m_heldByWork;					///< The blocks of m_held by difficulty.
+	size_t m_bytes = 0;										///< The size of the blocks ready or held back.
+	size_t m_limit = c_defaultMemoryLimit;
 	std::set<h256> m_knownBad;								///< Set of blocks that we know will never be valid.
+	std::set<h256> m_verifyingSet;							///< All blocks queued or ready whose verification has not yet finished.
+	bool m_newBad = false;									///< Whether a block has failed verification since the ready queue was last pruned.
+
+	Mutex x_verification;									///< Guards m_unverified and m_deleting.
+	Condition m_moreToVerify;								///< Signalled when a block is queued for verification, or on shutdown.
+	std::deque<std::pair<h256, SharedBlock>> m_unverified;	///< Blocks awaiting a verifier thread; the same as those in the queues.
+	bool m_deleting = false;								///< Tells the verifier threads to finish.
+	std::vector<std::thread> m_verifiers;					///< The verifier threads; empty if blocks are verified within import().
+	std::function<void()> m_onReady;						///< Called whenever a block may have become ready.
 };
 
 }
@@ -61,9 +61,11 @@ std::map<u256, u256> CachedAddressState::storage() const
 //			ret[j.first] = RLP(j.second).toInt<u256>();
 	}
 	if (m_s)
-		for (auto const& j: m_s->storageOverlay())
-			if ((!ret.count(j.first) && j.second) || (ret.count(j.first) && ret.at(j.first) != j.second))
-				ret[j.first] = j.second;
+		m_s->storageOverlay().forEach([&](StorageOverlay::Slot const& j)
+		{
+			if ((!ret.count(j.key) && j.value) || (ret.count(j.key) && ret.at(j.key) != j.value))
+				ret[j.key] = j.value;
+		});
 	return ret;
 }
 
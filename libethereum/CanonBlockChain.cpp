@@ -24,8 +24,10 @@
 #include <test/JsonSpiritHeaders.h>
 #include <boost/filesystem.hpp>
 #include <libdevcore/Common.h>
+#include <libdevcore/CommonIO.h>
 #include <libdevcore/RLP.h>
 #include <libdevcrypto/FileSystem.h>
+#include <libdevcrypto/KeyValueDB.h>
 #include <libethcore/Exceptions.h>
 #include <libethcore/ProofOfWork.h>
 #include <libethcore/BlockInfo.h>
@@ -67,15 +69,42 @@ std::map<Address, Account> const& dev::eth::genesisState()
 	return s_ret;
 }
 
+h256 const& dev::eth::genesisSpecHash()
+{
+	static h256 const s_ret = sha3(rlpList(c_genesisInfo, c_genesisDifficulty, c_genesisGasLimit));
+	return s_ret;
+}
+
 // TODO: place Registry in here.
 
 std::unique_ptr<BlockInfo> CanonBlockChain::s_genesis;
-boost::shared_mutex CanonBlockChain::x_genesis;
+SharedMutex CanonBlockChain::x_genesis;
+h256 CanonBlockChain::s_genesisStateRoot;
 
-bytes CanonBlockChain::createGenesisBlock()
+BlockInfo const& CanonBlockChain::genesis()
 {
-	RLPStream block(3);
+	{
+		ReadGuard l(x_genesis);
+		if (s_genesis)
+			return *s_genesis;
+	}
+	auto gb = createGenesisBlock();
+	WriteGuard l(x_genesis);
+	if (!s_genesis)
+	{
+		s_genesis.reset(new BlockInfo);
+		s_genesis->populate(&gb);
+	}
+	return *s_genesis;
+}
 
+h256 CanonBlockChain::genesisStateRoot()
+{
+	{
+		ReadGuard l(x_genesis);
+		if (s_genesisStateRoot)
+			return s_genesisStateRoot;
+	}
 	h256 stateRoot;
 	{
 		MemoryDB db;
@@ -84,14 +113,55 @@ bytes CanonBlockChain::createGenesisBlock()
 		dev::eth::commit(genesisState(), db, state);
 		stateRoot = state.root();
 	}
+	WriteGuard l(x_genesis);
+	return s_genesisStateRoot = stateRoot;
+}
+
+bytes CanonBlockChain::createGenesisBlock()
+{
+	return createGenesisBlock(genesisStateRoot());
+}
 
+bytes CanonBlockChain::createGenesisBlock(h256 const& _stateRoot)
+{
+	RLPStream block(3);
 	block.appendList(15)
-			<< h256() << EmptyListSHA3 << h160() << stateRoot << EmptyTrie << EmptyTrie << LogBloom() << c_genesisDifficulty << 0 << c_genesisGasLimit << 0 << (unsigned)0 << string() << h256() << Nonce(u64(42));
+			<< h256() << EmptyListSHA3 << h160() << _stateRoot << EmptyTrie << EmptyTrie << LogBloom() << c_genesisDifficulty << 0 << c_genesisGasLimit << 0 << (unsigned)0 << string() << h256() << Nonce(u64(42));
 	block.appendRaw(RLPEmptyList);
 	block.appendRaw(RLPEmptyList);
 	return block.out();
 }
 
-CanonBlockChain::CanonBlockChain(std::string const& _path, WithExisting _we, ProgressCallback const& _pc): BlockChain(CanonBlockChain::createGenesisBlock(), _path, _we, _pc)
+bytes CanonBlockChain::openGenesisBlock(std::string const& _path)
+{
+	string path = _path.empty() ? Defaults::dbPath() : _path;
+	if (isMemoryDBPath(path))
+		return createGenesisBlock();
+
+	// Parsing a large allocation and hashing it into a trie takes far longer than reading back its root, kept by
+	// the hash of what it was made of so that a change of genesis is never mistaken for the old one.
+	string file = path + "/genesis";
+	bytes kept = contents(file);
+	if (kept.size())
+	{
+		RLP r(kept);
+		if (r.isList() && r.itemCount() == 2 && r[0].toHash<h256>() == genesisSpecHash())
+		{
+			h256 stateRoot = r[1].toHash<h256>();
+			{
+				WriteGuard l(x_genesis);
+				s_genesisStateRoot = stateRoot;
+			}
+			return createGenesisBlock(stateRoot);
+		}
+	}
+
+	h256 stateRoot = genesisStateRoot();
+	boost::filesystem::create_directories(path);
+	writeFile(file, rlpList(genesisSpecHash(), stateRoot));
+	return createGenesisBlock(stateRoot);
+}
+
+CanonBlockChain::CanonBlockChain(std::string const& _path, WithExisting _we, ProgressCallback const& _pc): BlockChain(CanonBlockChain::openGenesisBlock(_path), _path, _we, _pc)
 {
 }
@@ -46,6 +46,8 @@ namespace eth
 
 // TODO: Move all this Genesis stuff into Genesis.h/.cpp
 std::map<Address, Account> const& genesisState();
+/// @returns the hash of what the genesis block is made of: its allocation and the constants of its header.
+h256 const& genesisSpecHash();
 
 /**
  * @brief Implements the blockchain database. All data this gives is disk-backed.
@@ -60,16 +62,25 @@ public:
 		~CanonBlockChain() {}
 
 		/// @returns the genesis block header.
-		static BlockInfo const& genesis() { UpgradableGuard l(x_genesis); if (!s_genesis) { auto gb = createGenesisBlock(); UpgradeGuard ul(l); s_genesis.reset(new BlockInfo); s_genesis->populate(&gb); } return *s_genesis; }
+		static BlockInfo const& genesis();
+
+		/// @returns the state root of the genesis block, worked out from genesisState() unless it is already known.
+		static h256 genesisStateRoot();
 
 		/// @returns the genesis block as its RLP-encoded byte array.
-		/// @note This is slow as it's constructed anew each call. Consider genesis() instead.
+		/// @note This is constructed anew each call, if from a known state root. Consider genesis() instead.
 		static bytes createGenesisBlock();
 
 private:
+		static bytes createGenesisBlock(h256 const& _stateRoot);
+		/// @returns the genesis block, its state root read from the file kept of it in the chain at @a _path, or else
+		/// worked out and written there for the next time.
+		static bytes openGenesisBlock(std::string const& _path);
+
 		/// Static genesis info and its lock.
-		static boost::shared_mutex x_genesis;
+		static SharedMutex x_genesis;
 		static std::unique_ptr<BlockInfo> s_genesis;
+		static h256 s_genesisStateRoot;
 };
 
 }
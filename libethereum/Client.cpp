@@ -25,11 +25,15 @@
 #include <thread>
 #include <boost/filesystem.hpp>
 #include <libdevcore/Log.h>
+#include <libdevcore/Metrics.h>
 #include <libdevcore/StructuredLogger.h>
+#include <libethcore/Ethasher.h>
+#include <libevm/AnalysedCode.h>
 #include <libp2p/Host.h>
 #include "Defaults.h"
 #include "Executive.h"
 #include "EthereumHost.h"
+#include "LightHost.h"
 using namespace std;
 using namespace dev;
 using namespace dev::eth;
@@ -75,50 +79,134 @@ void VersionChecker::setOk()
 	}
 }
 
-void BasicGasPricer::update(BlockChain const& _bc)
+/// How many work packages a RemoteMiner keeps, so work on all of them may still be submitted.
+static const unsigned c_remoteWorkKept = 8;
+
+/// How long, in milliseconds, one round of work spends filling the pending block from the queue; what is left waits
+/// for the next round, so that new blocks and the miners are not kept waiting on a long queue.
+static const unsigned c_syncTimeLimit = 250;
+
+void RemoteMiner::update(State const& _provisional, BlockChain const& _bc)
 {
-	unsigned c = 0;
-	h256 p = _bc.currentHash();
-	m_gasPerBlock = _bc.info(p).gasLimit;
+	m_packages.push_back(_provisional);
+	m_packages.back().commitToMine(_bc);
+	if (m_packages.size() > 1 && m_packages[m_packages.size() - 2].info().headerHash(IncludeNonce::WithoutNonce) == workHash())
+		// Nothing new since last time; no need to keep both.
+		m_packages.erase(m_packages.end() - 2);
+	while (m_packages.size() > c_remoteWorkKept)
+		m_packages.pop_front();
+}
 
-	map<u256, unsigned> dist;
-	unsigned total = 0;
-	while (c < 1000 && p)
+bool RemoteMiner::submitWork(h256 const& _workHash, ProofOfWork::Proof const& _result)
+{
+	for (auto it = m_packages.rbegin(); it != m_packages.rend(); ++it)
+		if (it->info().headerHash(IncludeNonce::WithoutNonce) == _workHash)
+		{
+			BlockInfo bi = it->info();
+			ProofOfWork::assignResult(_result, bi);
+			if (!ProofOfWork::verify(bi) || !it->completeMine(_result))
+				return false;
+			m_completed = *it;
+			m_packages.erase(next(it).base());
+			return (m_isComplete = true);
+		}
+	return false;
+}
+
+BasicGasPricer::WindowBlock BasicGasPricer::windowBlock(BlockChain const& _bc, h256 const& _h, unsigned _number)
+{
+	WindowBlock ret{_h, _number, {}};
+	if (_bc.info(_h).transactionsRoot != EmptyTrie)
 	{
-		BlockInfo bi = _bc.info(p);
-		if (bi.transactionsRoot != EmptyTrie)
+		auto bb = _bc.block(_h);
+		RLP txs = RLP(bb)[1];
+		BlockReceipts brs(_bc.receipts(_h));
+		// Receipts give the gas used by the block so far.
+		u256 before = 0;
+		for (unsigned i = 0; i < txs.itemCount() && i < brs.receipts.size(); ++i)
 		{
-			auto bb = _bc.block(p);
-			RLP r(bb);
-			BlockReceipts brs(_bc.receipts(bi.hash()));
-			for (unsigned i = 0; i < r[1].size(); ++i)
-			{
-				auto gu = brs.receipts[i].gasUsed();
-				dist[Transaction(r[1][i].data(), CheckTransaction::None).gasPrice()] += (unsigned)brs.receipts[i].gasUsed();
-				total += (unsigned)gu;
-			}
+			auto gu = brs.receipts[i].gasUsed();
+			ret.gasAt[Transaction(txs[i].data(), CheckTransaction::None).gasPrice()] += gu - before;
+			before = gu;
 		}
-		p = bi.parentHash;
-		++c;
 	}
-	if (total > 0)
+	return ret;
+}
+
+void BasicGasPricer::note(WindowBlock const& _b, bool _add)
+{
+	for (auto const& i: _b.gasAt)
+		if (_add)
+		{
+			m_gasAt[i.first] += i.second;
+			m_gas += i.second;
+		}
+		else
+		{
+			if (!(m_gasAt[i.first] -= i.second))
+				m_gasAt.erase(i.first);
+			m_gas -= i.second;
+		}
+}
+
+void BasicGasPricer::update(BlockChain const& _bc)
+{
+	// Back from the head to the latest block the window still shares with the chain, taking out those after it.
+	h256s fresh;
+	bool joined = false;
+	for (h256 h = _bc.currentHash(); fresh.size() < m_window;)
 	{
-		unsigned t = 0;
-		unsigned q = 1;
-		m_octiles[0] = dist.begin()->first;
-		for (auto const& i: dist)
+		auto d = _bc.details(h);
+		if (!m_blocks.empty() && d.number >= m_blocks.front().number && d.number <= m_blocks.back().number && m_blocks[d.number - m_blocks.front().number].hash == h)
 		{
-			for (; t <= total * q / 8 && t + i.second > total * q / 8; ++q)
-				m_octiles[q] = i.first;
-			if (q > 7)
-				break;
+			for (; m_blocks.back().hash != h; m_blocks.pop_back())
+				note(m_blocks.back(), false);
+			joined = true;
+			break;
 		}
-		m_octiles[8] = dist.rbegin()->first;
+		fresh.push_back(h);
+		if (!d.number)
+			break;
+		h = d.parent;
+	}
+	if (!joined)
+	{
+		m_blocks.clear();
+		m_gasAt.clear();
+		m_gas = 0;
 	}
+
+	unsigned number = _bc.details().number;
+	for (unsigned i = fresh.size(); i > 0; --i)
+	{
+		m_blocks.push_back(windowBlock(_bc, fresh[i - 1], number + 1 - i));
+		note(m_blocks.back(), true);
+	}
+	for (; m_blocks.size() > m_window; m_blocks.pop_front())
+		note(m_blocks.front(), false);
+
+	// The octiles of the prices, weighted by gas: the least, the price at which each eighth of the gas is reached, and
+	// the greatest.
+	array<u256, 9> octiles;
+	octiles.fill(0);
+	if (m_gas > 0)
+	{
+		u256 t = 0;
+		unsigned q = 1;
+		octiles[0] = m_gasAt.begin()->first;
+		for (auto const& i: m_gasAt)
+			for (t += i.second; q < 8 && t * 8 >= m_gas * q; ++q)
+				octiles[q] = i.first;
+		octiles[8] = m_gasAt.rbegin()->first;
+	}
+
+	Guard l(x_octiles);
+	m_gasPerBlock = _bc.info().gasLimit;
+	m_octiles = octiles;
 }
 
 Client::Client(p2p::Host* _extNet, std::string const& _dbPath, WithExisting _forceAction, u256 _networkId, int _miners):
-	Worker("eth"),
+	Worker("eth", 0),
 	m_vc(_dbPath),
 	m_bc(_dbPath, max(m_vc.action(), _forceAction), [](unsigned d, unsigned t){ cerr << "REVISING BLOCKCHAIN: Processed " << d << " of " << t << "...\r"; }),
 	m_gp(new TrivialGasPricer),
@@ -126,9 +214,20 @@ Client::Client(p2p::Host* _extNet, std::string const& _dbPath, WithExisting _for
 	m_preMine(m_stateDB, BaseState::CanonGenesis),
 	m_postMine(m_stateDB)
 {
+	setLockName(x_stateDB, "Client::x_stateDB");
+	setLockName(x_views, "Client::x_views");
+	m_stateDB.setAsyncCommit(true);
+	m_stateDB.setCanonical([=](unsigned _n){ return m_bc.numberHash(_n); });
+	m_bc.setAsyncCommit(true);
+	m_bq.setVerifierThreads(max(thread::hardware_concurrency(), 2u) - 1);
+	m_bq.onReady([=](){ noteWork(); });
+	m_tq.onReady([=](){ noteWork(); });
 	m_gp->update(m_bc);
+	publishViews();
+	watchMetrics();
 
-	m_host = _extNet->registerCapability(new EthereumHost(m_bc, m_tq, m_bq, _networkId));
+	m_host = _extNet->registerCapability(new EthereumHost(m_bc, m_stateDB, m_tq, m_bq, _networkId));
+	_extNet->registerCapability(new LightHost(m_bc, m_stateDB, m_tq, _networkId));
 
 	if (_miners > -1)
 		setMiningThreads(_miners);
@@ -143,7 +242,7 @@ Client::Client(p2p::Host* _extNet, std::string const& _dbPath, WithExisting _for
 }
 
 Client::Client(p2p::Host* _extNet, std::shared_ptr<GasPricer> _gp, std::string const& _dbPath, WithExisting _forceAction, u256 _networkId, int _miners):
-	Worker("eth"),
+	Worker("eth", 0),
 	m_vc(_dbPath),
 	m_bc(_dbPath, max(m_vc.action(), _forceAction), [](unsigned d, unsigned t){ cerr << "REVISING BLOCKCHAIN: Processed " << d << " of " << t << "...\r"; }),
 	m_gp(_gp),
@@ -151,9 +250,20 @@ Client::Client(p2p::Host* _extNet, std::shared_ptr<GasPricer> _gp, std::string c
 	m_preMine(m_stateDB),
 	m_postMine(m_stateDB)
 {
+	setLockName(x_stateDB, "Client::x_stateDB");
+	setLockName(x_views, "Client::x_views");
+	m_stateDB.setAsyncCommit(true);
+	m_stateDB.setCanonical([=](unsigned _n){ return m_bc.numberHash(_n); });
+	m_bc.setAsyncCommit(true);
+	m_bq.setVerifierThreads(max(thread::hardware_concurrency(), 2u) - 1);
+	m_bq.onReady([=](){ noteWork(); });
+	m_tq.onReady([=](){ noteWork(); });
 	m_gp->update(m_bc);
+	publishViews();
+	watchMetrics();
 
-	m_host = _extNet->registerCapability(new EthereumHost(m_bc, m_tq, m_bq, _networkId));
+	m_host = _extNet->registerCapability(new EthereumHost(m_bc, m_stateDB, m_tq, m_bq, _networkId));
+	_extNet->registerCapability(new LightHost(m_bc, m_stateDB, m_tq, _networkId));
 
 	if (_miners > -1)
 		setMiningThreads(_miners);
@@ -169,7 +279,85 @@ Client::Client(p2p::Host* _extNet, std::shared_ptr<GasPricer> _gp, std::string c
 
 Client::~Client()
 {
+	for (auto id: m_metrics)
+		Metrics::get().unwatch(id);
 	stopWorking();
+	m_stateDB.flush();
+	m_stateDB.setCanonical(CanonicalHash());
+}
+
+void Client::watchMetrics()
+{
+	auto& m = Metrics::get();
+	auto watch = [&](string const& _name, string const& _help, string const& _labels, function<double()> const& _f)
+	{
+		m_metrics.push_back(m.watch(_name, _help, _labels, _f));
+	};
+	char const* bqHelp = "Blocks in the block queue, by state.";
+	watch("eth_block_queue", bqHelp, "state=\"ready\"", [=]() { return m_bq.status().ready; });
+	watch("eth_block_queue", bqHelp, "state=\"verifying\"", [=]() { return m_bq.status().verifying; });
+	watch("eth_block_queue", bqHelp, "state=\"future\"", [=]() { return m_bq.status().future; });
+	watch("eth_block_queue", bqHelp, "state=\"unknown\"", [=]() { return m_bq.status().unknown; });
+	watch("eth_block_queue", bqHelp, "state=\"bad\"", [=]() { return m_bq.status().bad; });
+	char const* tqHelp = "Transactions in the transaction queue, by whether they are priced to be mined now.";
+	watch("eth_transaction_queue", tqHelp, "state=\"current\"", [=]() { return m_tq.items().first; });
+	watch("eth_transaction_queue", tqHelp, "state=\"future\"", [=]() { return m_tq.items().second; });
+
+	using Stats = BlockChain::Statistics;
+	static const pair<char const*, unsigned Stats::*> c_caches[] = {
+		{ "blocks", &Stats::memBlocks },
+		{ "details", &Stats::memDetails },
+		{ "logBlooms", &Stats::memLogBlooms },
+		{ "receipts", &Stats::memReceipts },
+		{ "transactionAddresses", &Stats::memTransactionAddresses },
+		{ "blockHashes", &Stats::memBlockHashes },
+		{ "blocksBlooms", &Stats::memBlocksBlooms },
+		{ "bloomBits", &Stats::memBloomBits },
+		{ "logIndex", &Stats::memLogIndex },
+		{ "uncleHashes", &Stats::memUncleHashes },
+		{ "headers", &Stats::memHeaders }
+	};
+	for (auto const& c: c_caches)
+	{
+		auto member = c.second;
+		watch("eth_blockchain_cache_bytes", "Bytes in each of the block chain's caches, as of their last garbage collection.", string("cache=\"") + c.first + "\"", [=]() { return m_bc.usage().*member; });
+	}
+	watch("eth_blockchain_cache_budget_bytes", "The bytes the block chain's caches are kept within.", "", [=]() { return m_bc.usage().budget; });
+	// A point read may touch a table at each level, and any of those at level 0, so these tell the read amplification.
+	static const pair<char const*, DBRole> c_dbs[] = {
+		{ "blocks", DBRole::Blocks },
+		{ "extras", DBRole::Extras },
+		{ "state", DBRole::State }
+	};
+	for (auto const& d: c_dbs)
+		for (unsigned level = 0; level < 7; ++level)
+		{
+			auto role = d.second;
+			string name = "num-files-at-level" + toString(level);
+			watch("eth_db_files", "Tables of each DB, by level.", string("db=\"") + d.first + "\",level=\"" + toString(level) + "\"", [=]() { return atof(dbProperty(role, name).c_str()); });
+		}
+	watch("eth_block_number", "The number of the best block.", "", [=]() { return m_bc.number(); });
+	watch("eth_hashrate", "Hashes a second of the in-process miners.", "", [=]()
+	{
+		MineProgress p = miningProgress();
+		return p.ms ? p.hashes * 1000.0 / p.ms : 0.0;
+	});
+}
+
+string Client::dbProperty(DBRole _role, string const& _name) const
+{
+	switch (_role)
+	{
+	case DBRole::Blocks: return m_bc.blocksDB().property(_name);
+	case DBRole::Extras: return m_bc.extrasDB().property(_name);
+	case DBRole::State:
+	{
+		ReadGuard l(x_stateDB);
+		return m_stateDB.db()->property(_name);
+	}
+	case DBRole::Size: break;
+	}
+	return string();
 }
 
 void Client::setNetworkId(u256 _n)
@@ -192,13 +380,22 @@ bool Client::isSyncing() const
 	return false;
 }
 
+void Client::setFastSync(bool _fast)
+{
+	if (auto h = m_host.lock())
+		h->setFastSync(_fast);
+}
+
 void Client::doneWorking()
 {
 	// Synchronise the state according to the head of the block chain.
 	// TODO: currently it contains keys for *all* blocks. Make it remove old ones.
 	WriteGuard l(x_stateDB);
-	m_preMine.sync(m_bc);
+	// Amid a fast sync the head has no state; it would be reached by executing every block.
+	if (!m_bc.isAwaitingState())
+		m_preMine.sync(m_bc);
 	m_postMine = m_preMine;
+	publishViews();
 }
 
 void Client::killChain()
@@ -216,13 +413,17 @@ void Client::killChain()
 
 	{
 		WriteGuard l(x_stateDB);
+		m_stateDB.flush();
 		m_stateDB = OverlayDB();
 		m_stateDB = State::openDB(Defaults::dbPath(), WithExisting::Kill);
+		m_stateDB.setAsyncCommit(true);
+		m_stateDB.setCanonical([=](unsigned _n){ return m_bc.numberHash(_n); });
 	}
 	m_bc.reopen(Defaults::dbPath(), WithExisting::Kill);
 
 	m_preMine = State(m_stateDB);
 	m_postMine = State(m_stateDB);
+	publishViews();
 
 	if (auto h = m_host.lock())
 		h->reset();
@@ -248,6 +449,7 @@ void Client::clearPending()
 		changeds.insert(PendingChangedFilter);
 		m_tq.clear();
 		m_postMine = m_preMine;
+		publishViews();
 	}
 
 	{
@@ -259,54 +461,21 @@ void Client::clearPending()
 	noteChanged(changeds);
 }
 
-template <class T>
-static string filtersToString(T const& _fs)
-{
-	stringstream ret;
-	ret << "{";
-	unsigned i = 0;
-	for (h256 const& f: _fs)
-		ret << (i++ ? ", " : "") << (f == PendingChangedFilter ? "pending" : f == ChainChangedFilter ? "chain" : f.abridged());
-	ret << "}";
-	return ret.str();
-}
-
-void Client::noteChanged(h256Set const& _filters)
-{
-	Guard l(x_filtersWatches);
-	if (_filters.size())
-		cnote << "noteChanged(" << filtersToString(_filters) << ")";
-	// accrue all changes left in each filter into the watches.
-	for (auto& w: m_watches)
-		if (_filters.count(w.second.id))
-		{
-			cwatch << "!!!" << w.first << (m_filters.count(w.second.id) ? w.second.id.abridged() : w.second.id == PendingChangedFilter ? "pending" : w.second.id == ChainChangedFilter ? "chain" : "???");
-			if (m_filters.count(w.second.id))	// Normal filtering watch
-				w.second.changes += m_filters.at(w.second.id).changes;
-			else								// Special ('pending'/'latest') watch
-				w.second.changes.push_back(LocalisedLogEntry(SpecialLogEntry, 0));
-		}
-	// clear the filters now.
-	for (auto& i: m_filters)
-		i.second.changes.clear();
-}
-
 void Client::appendFromNewPending(TransactionReceipt const& _receipt, h256Set& io_changed, h256 _transactionHash)
 {
+	unsigned number = m_bc.number() + 1;
 	Guard l(x_filtersWatches);
-	for (pair<h256 const, InstalledFilter>& i: m_filters)
-		if (i.second.filter.envelops(RelativeBlock::Pending, m_bc.number() + 1))
+	// Each log is tried only against the filters it may match.
+	for (LogEntry const& e: _receipt.log())
+		m_filterIndex.forCandidates(e, [&](h256 const& _id)
 		{
-			// acceptable number.
-			auto m = i.second.filter.matches(_receipt);
-			if (m.size())
+			InstalledFilter& f = m_filters.at(_id);
+			if (f.filter.envelops(RelativeBlock::Pending, number) && f.filter.matches(e))
 			{
-				// filter catches them
-				for (LogEntry const& l: m)
-					i.second.changes.push_back(LocalisedLogEntry(l, m_bc.number() + 1, _transactionHash));
-				io_changed.insert(i.first);
+				f.changes.push_back(LocalisedLogEntry(e, number, _transactionHash));
+				io_changed.insert(_id);
 			}
-		}
+		});
 }
 
 void Client::appendFromNewBlock(h256 const& _block, h256Set& io_changed)
@@ -316,22 +485,23 @@ void Client::appendFromNewBlock(h256 const& _block, h256Set& io_changed)
 	auto br = m_bc.receipts(_block);
 
 	Guard l(x_filtersWatches);
-	for (pair<h256 const, InstalledFilter>& i: m_filters)
-		if (i.second.filter.envelops(RelativeBlock::Latest, d.number) && i.second.filter.matches(d.logBloom))
-			// acceptable number & looks like block may contain a matching log entry.
-			for (size_t j = 0; j < br.receipts.size(); j++)
+	// Each log is tried only against the filters it may match.
+	for (size_t j = 0; j < br.receipts.size(); j++)
+	{
+		h256 transactionHash;
+		for (LogEntry const& e: br.receipts[j].log())
+			m_filterIndex.forCandidates(e, [&](h256 const& _id)
 			{
-				auto tr = br.receipts[j];
-				auto m = i.second.filter.matches(tr);
-				if (m.size())
+				InstalledFilter& f = m_filters.at(_id);
+				if (f.filter.envelops(RelativeBlock::Latest, d.number) && f.filter.matches(e))
 				{
-					auto transactionHash = transaction(d.hash(), j).sha3();
-					// filter catches them
-					for (LogEntry const& l: m)
-						i.second.changes.push_back(LocalisedLogEntry(l, (unsigned)d.number, transactionHash));
-					io_changed.insert(i.first);
+					if (!transactionHash)
+						transactionHash = transaction(d.hash(), j).sha3();
+					f.changes.push_back(LocalisedLogEntry(e, (unsigned)d.number, transactionHash));
+					io_changed.insert(_id);
 				}
-			}
+			});
+	}
 }
 
 void Client::setForceMining(bool _enable)
@@ -342,6 +512,60 @@ void Client::setForceMining(bool _enable)
 		 m.noteStateChange();
 }
 
+pair<unsigned, unsigned> Client::warmUp(bool _dag, unsigned _stateLevels, unsigned _codeBlocks)
+{
+	BlockInfo head = m_bc.info();
+	if (_dag)
+		Ethasher::get()->full(head);
+
+	// Breadth first, so that the nodes nearest the root, which every lookup passes through, come first.
+	unsigned nodes = 0;
+	{
+		ReadGuard l(x_stateDB);
+		h256s level{head.stateRoot};
+		for (unsigned d = 0; d < _stateLevels && !level.empty(); ++d)
+		{
+			h256s next;
+			for (auto const& h: level)
+			{
+				string n = m_stateDB.lookup(h);
+				if (n.empty())
+					continue;
+				++nodes;
+				RLP r(n);
+				// Items of 32 bytes are the hashes of children; smaller children are inline, and accounts are longer.
+				if (r.isList())
+					for (auto const& i: r)
+						if (i.isData() && i.size() == 32)
+							next.push_back(i.toHash<h256>());
+			}
+			swap(level, next);
+		}
+	}
+
+	set<Address> called;
+	h256 b = head.hash();
+	for (unsigned i = 0; i < _codeBlocks && b && b != m_bc.genesisHash(); ++i, b = m_bc.details(b).parent)
+		for (auto const& t: m_bc.transactions(b))
+		{
+			Transaction tx(&t, CheckTransaction::None);
+			if (!tx.isCreation())
+				called.insert(tx.receiveAddress());
+		}
+	State s = postState();
+	unsigned contracts = 0;
+	for (auto const& a: called)
+	{
+		h256 ch = s.codeHash(a);
+		if (ch != EmptySHA3)
+		{
+			AnalysedCode::cached(ch, s.sharedCode(a));
+			++contracts;
+		}
+	}
+	return make_pair(nodes, contracts);
+}
+
 void Client::setMiningThreads(unsigned _threads)
 {
 	stopMining();
@@ -430,7 +654,8 @@ ExecutionResult Client::call(Address _dest, bytes const& _data, u256 _gas, u256
 			temp = m_postMine;
 			temp.addBalance(_from, _value + _gasPrice * _gas);
 		}
-		Executive e(temp, LastHashes(), 0);
+		LastHashes lastHashes;
+		Executive e(temp, lastHashes, 0);
 		if (!e.call(_dest, _dest, _from, _value, _gasPrice, &_data, _gas, _from))
 			e.go();
 		ret = e.executionResult();
@@ -443,25 +668,50 @@ ExecutionResult Client::call(Address _dest, bytes const& _data, u256 _gas, u256
 }
 
 pair<h256, u256> Client::getWork()
+{
+	BlockInfo bi = getWorkPackage();
+	return make_pair(bi.headerHash(IncludeNonce::WithoutNonce), bi.difficulty);
+}
+
+BlockInfo Client::getWorkPackage()
 {
 	Guard l(x_remoteMiner);
 	{
 		ReadGuard l(x_stateDB);
 		m_remoteMiner.update(m_postMine, m_bc);
 	}
-	return make_pair(m_remoteMiner.workHash(), m_remoteMiner.difficulty());
+	return m_remoteMiner.work();
 }
 
 bool Client::submitWork(ProofOfWork::Proof const& _proof)
 {
 	Guard l(x_remoteMiner);
-	return m_remoteMiner.submitWork(_proof);
+	if (!m_remoteMiner.submitWork(_proof))
+		return false;
+	noteWork();
+	return true;
 }
 
-void Client::doWork()
+bool Client::submitWork(h256 const& _workHash, ProofOfWork::Proof const& _proof)
+{
+	Guard l(x_remoteMiner);
+	if (!m_remoteMiner.submitWork(_workHash, _proof))
+		return false;
+	noteWork();
+	return true;
+}
+
+void Client::noteWork()
 {
-	// TODO: Use condition variable rather than polling.
+	{
+		Guard l(x_signalled);
+		m_signalled = true;
+	}
+	m_signal.notify_all();
+}
 
+void Client::doWork()
+{
 	bool stillGotWork = false;
 
 	cworkin << "WORK";
@@ -506,6 +756,7 @@ void Client::doWork()
 	{
 		Guard l(x_remoteMiner);
 		maintainMiner(m_remoteMiner);
+		m_remoteMiner.noteStateChange();
 	}
 
 	// Synchronise state to block chain.
@@ -554,30 +805,68 @@ void Client::doWork()
 			for (auto i: fresh)
 				appendFromNewBlock(i, changeds);
 			changeds.insert(ChainChangedFilter);
+			m_gp->update(m_bc);
 		}
 		x_stateDB.lock();
 		if (fresh.size())
 			m_stateDB = db;
 
+		// Amid a fast sync, the blocks up to the pivot have no state; once the pivot's has been downloaded, those after
+		// it are imported by executing them on it.
+		bool awaitingState = m_bc.isAwaitingState();
+		if (awaitingState && m_bc.isKnown(m_bc.pivotHash()) && m_stateDB.exists(m_bc.info(m_bc.pivotHash()).stateRoot))
+		{
+			m_bc.notePivotState();
+			awaitingState = false;
+			stillGotWork = true;
+		}
+
+		// Pending transactions from here on are new, as far as the watches know.
+		unsigned firstNewPending = m_postMine.pending().size();
+
 		cwork << "preSTATE <== CHAIN";
-		if (m_preMine.sync(m_bc) || m_postMine.address() != m_preMine.address())
+		if (!awaitingState && (m_preMine.sync(m_bc) || m_postMine.address() != m_preMine.address()))
 		{
+			Ethasher::get()->noteHead(m_bc.number());
 			if (isMining())
 				cnote << "New block on chain: Restarting mining operation.";
+			// Rebase: carry over, in their old order, those pending on the old head that are still queued.
+			Transactions formerlyPending;
+			for (auto const& t: m_postMine.pending())
+				if (m_tq.contains(t.sha3()))
+					formerlyPending.push_back(t);
 			m_postMine = m_preMine;
+			m_postMine.replay(m_bc, formerlyPending);
+			firstNewPending = 0;
 			resyncStateNeeded = true;
 			changeds.insert(PendingChangedFilter);
-			// TODO: Move transactions pending from m_postMine back to transaction queue.
+		}
+		else
+		{
+			// Roll back only the suffix from the first pending transaction to have left the queue (replaced, evicted
+			// or dropped); the queue gives back those after it that are still valid.
+			auto const& pending = m_postMine.pending();
+			for (unsigned i = 0; i < pending.size(); ++i)
+				if (!m_tq.contains(pending[i].sha3()))
+				{
+					m_postMine.rollback(i);
+					firstNewPending = min(firstNewPending, i);
+					resyncStateNeeded = true;
+					changeds.insert(PendingChangedFilter);
+					break;
+				}
 		}
 
 		// returns TransactionReceipts, once for each transaction.
 		cwork << "postSTATE <== TQ";
-		TransactionReceipts newPendingReceipts = m_postMine.sync(m_bc, m_tq, *m_gp);
-		if (newPendingReceipts.size())
+		bool timedOut = false;
+		TransactionReceipts newPendingReceipts = awaitingState ? TransactionReceipts() : m_postMine.sync(m_bc, m_tq, *m_gp, nullptr, c_syncTimeLimit, &timedOut);
+		stillGotWork = stillGotWork || timedOut;
+		if (newPendingReceipts.size() || firstNewPending < m_postMine.pending().size())
 		{
-			for (size_t i = 0; i < newPendingReceipts.size(); i++)
-				appendFromNewPending(newPendingReceipts[i], changeds, m_postMine.pending()[i].sha3());
-			
+			for (size_t i = firstNewPending; i < m_postMine.pending().size(); i++)
+				appendFromNewPending(m_postMine.receipt(i), changeds, m_postMine.pending()[i].sha3());
+
 			changeds.insert(PendingChangedFilter);
 
 			if (isMining())
@@ -586,6 +875,9 @@ void Client::doWork()
 			if (auto h = m_host.lock())
 				h->noteNewTransactions();
 		}
+
+		if (resyncStateNeeded)
+			publishViews();
 	}
 
 	if (!changeds.empty())
@@ -601,10 +893,26 @@ void Client::doWork()
 
 	cwork << "noteChanged" << changeds.size() << "items";
 	noteChanged(changeds);
+	if (changeds.count(ChainChangedFilter) || changeds.count(PendingChangedFilter))
+	{
+		Guard l(x_onNewWork);
+		if (m_onNewWork)
+			m_onNewWork();
+		if (m_onChainChanged && changeds.count(ChainChangedFilter))
+			m_onChainChanged();
+	}
 	cworkout << "WORK";
 
 	if (!stillGotWork)
-		this_thread::sleep_for(chrono::milliseconds(100));
+	{
+		// Sleep until there is something to sync, or the next future block falls due; the timeout is for housekeeping.
+		auto until = chrono::system_clock::now() + chrono::milliseconds(100);
+		if (unsigned due = m_bq.nextFuture())
+			until = min(until, chrono::system_clock::from_time_t(due));
+		unique_lock<Mutex> l(x_signalled);
+		m_signal.wait_until(l, until, [&](){ return m_signalled; });
+		m_signalled = false;
+	}
 
 	if (chrono::system_clock::now() - m_lastGarbageCollection > chrono::seconds(5))
 	{
@@ -631,8 +939,8 @@ void Client::doWork()
 
 State Client::asOf(h256 const& _block) const
 {
-	ReadGuard l(x_stateDB);
-	return State(m_stateDB, bc(), _block);
+	// The latest view's DB reaches all that has been committed, without waiting on an import for x_stateDB.
+	return State(latestView()->db(), bc(), _block);
 }
 
 void Client::prepareForTransaction()
@@ -640,6 +948,28 @@ void Client::prepareForTransaction()
 	startWorking();
 }
 
+void Client::pin(StatePin& o_pin) const
+{
+	{
+		// Both under the one lock, so that the pending state is that built on the latest.
+		Guard l(x_views);
+		o_pin.latest = m_latestView;
+		o_pin.pending = m_pendingView;
+	}
+	o_pin.latestHash = o_pin.latest->info().parentHash;
+	o_pin.latestNumber = (unsigned)o_pin.latest->info().number - 1;
+}
+
+void Client::publishViews()
+{
+	// Copied here, once per change, rather than by every reader.
+	auto latest = make_shared<StateView>(m_preMine);
+	auto pending = make_shared<StateView>(m_postMine);
+	Guard l(x_views);
+	m_latestView = latest;
+	m_pendingView = pending;
+}
+
 State Client::state(unsigned _txi, h256 _block) const
 {
 	ReadGuard l(x_stateDB);
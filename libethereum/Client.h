@@ -24,9 +24,11 @@
 #include <thread>
 #include <mutex>
 #include <list>
+#include <deque>
 #include <atomic>
 #include <string>
 #include <array>
+#include <condition_variable>
 
 #include <boost/utility.hpp>
 
@@ -37,6 +39,7 @@
 #include <libethcore/Params.h>
 #include <libp2p/Common.h>
 #include "CanonBlockChain.h"
+#include "Defaults.h"
 #include "TransactionQueue.h"
 #include "State.h"
 #include "CommonNet.h"
@@ -72,44 +75,85 @@ private:
 	std::string m_path;
 };
 
+/**
+ * @brief The work given out to miners outside the client.
+ * The last few work packages are kept, so that work on one may still be submitted once a newer one has been given out;
+ * each is known by its work hash.
+ */
 class RemoteMiner: public Miner
 {
 public:
 	RemoteMiner() {}
 
-	void update(State const& _provisional, BlockChain const& _bc) { m_state = _provisional; m_state.commitToMine(_bc); }
+	/// Makes a new work package from @a _provisional.
+	void update(State const& _provisional, BlockChain const& _bc);
 
-	h256 workHash() const { return m_state.info().headerHash(IncludeNonce::WithoutNonce); }
-	u256 const& difficulty() const { return m_state.info().difficulty; }
+	/// @returns the header of the newest work package.
+	BlockInfo const& work() const { return m_packages.back().info(); }
+	h256 workHash() const { return work().headerHash(IncludeNonce::WithoutNonce); }
+	u256 const& difficulty() const { return work().difficulty; }
 
-	bool submitWork(ProofOfWork::Proof const& _result) { return (m_isComplete = m_state.completeMine(_result)); }
+	/// Submits @a _result for the newest work package. @returns false if it is not a valid proof of work.
+	bool submitWork(ProofOfWork::Proof const& _result) { return !m_packages.empty() && submitWork(workHash(), _result); }
+	/// Submits @a _result for the work package with work hash @a _workHash. @returns false if there is no such
+	/// package (it may be too old) or @a _result is not a valid proof of work for it.
+	bool submitWork(h256 const& _workHash, ProofOfWork::Proof const& _result);
 
 	virtual bool isComplete() const override { return m_isComplete; }
-	virtual bytes const& blockData() const { return m_state.blockData(); }
+	virtual bytes const& blockData() const { return m_completed.blockData(); }
 
-	virtual void noteStateChange() override {}
+	/// Notes that the completed block has been taken.
+	virtual void noteStateChange() override { m_isComplete = false; }
 
 private:
 	bool m_isComplete = false;
-	State m_state;
+	State m_completed;					///< The last package to be completed.
+	std::deque<State> m_packages;		///< The newest at the back.
 };
 
+/**
+ * @brief Bids the gas prices paid, weighted by the gas they bought, over the latest blocks of the chain.
+ * The prices are kept as a histogram of a sliding window of blocks, so that an update costs the blocks imported since
+ * the last, not the window.
+ */
 class BasicGasPricer: public GasPricer
 {
 public:
-	explicit BasicGasPricer(u256 _weiPerRef, u256 _refsPerBlock): m_weiPerRef(_weiPerRef), m_refsPerBlock(_refsPerBlock) {}
+	/// Bids from the latest @a _window blocks.
+	explicit BasicGasPricer(u256 _weiPerRef, u256 _refsPerBlock, unsigned _window = 1000): m_weiPerRef(_weiPerRef), m_refsPerBlock(_refsPerBlock), m_window(_window) {}
 
 	void setRefPrice(u256 _weiPerRef) { m_weiPerRef = _weiPerRef; }
 	void setRefBlockFees(u256 _refsPerBlock) { m_refsPerBlock = _refsPerBlock; }
 
-	u256 ask(State const&) const override { return m_weiPerRef * m_refsPerBlock / m_gasPerBlock; }
-	u256 bid(TransactionPriority _p = TransactionPriority::Medium) const override { return m_octiles[(int)_p] > 0 ? m_octiles[(int)_p] : (m_weiPerRef * m_refsPerBlock / m_gasPerBlock); }
+	u256 ask(State const&) const override { Guard l(x_octiles); return m_weiPerRef * m_refsPerBlock / m_gasPerBlock; }
+	u256 bid(TransactionPriority _p = TransactionPriority::Medium) const override { Guard l(x_octiles); return m_octiles[(int)_p] > 0 ? m_octiles[(int)_p] : (m_weiPerRef * m_refsPerBlock / m_gasPerBlock); }
 
+	/// Brings the window up to the head of @a _bc, adding the blocks new to it and taking out those that have left
+	/// the window or, in a reorganisation, the chain. Only a window not found within reach of the head is rebuilt.
 	void update(BlockChain const& _bc) override;
 
 private:
+	/// A block of the window, with the gas its transactions bought at each price.
+	struct WindowBlock
+	{
+		h256 hash;
+		unsigned number;
+		std::map<u256, u256> gasAt;
+	};
+
+	static WindowBlock windowBlock(BlockChain const& _bc, h256 const& _h, unsigned _number);
+	/// Adds the gas of @a _b to m_gasAt, or takes it out unless @a _add.
+	void note(WindowBlock const& _b, bool _add);
+
 	u256 m_weiPerRef;
 	u256 m_refsPerBlock;
+
+	unsigned m_window;
+	std::deque<WindowBlock> m_blocks;		///< The window, consecutive blocks of the chain, the latest at the back.
+	std::map<u256, u256> m_gasAt;			///< The gas bought at each price over m_blocks.
+	u256 m_gas;								///< The sum of m_gasAt.
+
+	mutable Mutex x_octiles;
 	u256 m_gasPerBlock = 3141592;
 	std::array<u256, 9> m_octiles;
 };
@@ -175,10 +219,18 @@ public:
 	CanonBlockChain const& blockChain() const { return m_bc; }
 	/// Get some information on the block queue.
 	BlockQueueStatus blockQueueStatus() const { return m_bq.status(); }
+	/// @returns the property @a _name of the DB @a _role; see KeyValueDB::property().
+	std::string dbProperty(DBRole _role, std::string const& _name) const;
+	/// Sets the number of threads verifying queued blocks, at least one.
+	void setVerifierThreads(unsigned _n) { m_bq.setVerifierThreads(std::max(_n, 1u)); }
+	/// Loads what the first requests would otherwise wait on: the full DAG of the head's epoch if @a _dag, the nodes of
+	/// the top @a _stateLevels levels of the head's state trie, and the analyses of the code called by the transactions
+	/// of the last @a _codeBlocks blocks. @returns the number of trie nodes and of contracts loaded.
+	std::pair<unsigned, unsigned> warmUp(bool _dag, unsigned _stateLevels, unsigned _codeBlocks);
 
 	// Mining stuff:
 
-	void setAddress(Address _us) { WriteGuard l(x_stateDB); m_preMine.setAddress(_us); }
+	void setAddress(Address _us) { WriteGuard l(x_stateDB); m_preMine.setAddress(_us); publishViews(); }
 
 	/// Check block validity prior to mining.
 	bool miningParanoia() const { return m_paranoia; }
@@ -217,11 +269,22 @@ public:
 	virtual std::pair<h256, u256> getWork() override;
 	/// Submit the proof for the proof-of-work.
 	virtual bool submitWork(ProofOfWork::Proof const& _proof) override;
+	/// Makes a new work package for remote miners from the latest transactions. @returns its header.
+	BlockInfo getWorkPackage();
+	/// Submits @a _proof for the work package whose work hash is @a _workHash, which need not be the newest.
+	bool submitWork(h256 const& _workHash, ProofOfWork::Proof const& _proof);
+	/// Sets @a _f to be called, on the client's thread, whenever there is new work for miners: a new head, or new
+	/// pending transactions. Pass an empty function to stop.
+	void onNewWork(std::function<void()> const& _f) { Guard l(x_onNewWork); m_onNewWork = _f; }
+	/// Sets @a _f to be called, on the client's thread, whenever the chain has changed. Pass an empty function to stop.
+	void onChainChanged(std::function<void()> const& _f) { Guard l(x_onNewWork); m_onChainChanged = _f; }
 
 	// Debug stuff:
 
 	DownloadMan const* downloadMan() const;
 	bool isSyncing() const;
+	/// Has a new chain synced by downloading the state of a recent block, rather than by executing every block.
+	void setFastSync(bool _fast);
 	/// Sets the network id.
 	void setNetworkId(u256 _n);
 	/// Clears pending transactions. Just for debug use.
@@ -238,9 +301,18 @@ protected:
 	/// Works properly with LatestBlock and PendingBlock.
 	using ClientBase::asOf;
 	virtual State asOf(h256 const& _block) const override;
-	virtual State preMine() const override { ReadGuard l(x_stateDB); return m_preMine; }
-	virtual State postMine() const override { ReadGuard l(x_stateDB); return m_postMine; }
+	virtual State preMine() const override { return latestView()->copy(); }
+	virtual State postMine() const override { return pendingView()->copy(); }
 	virtual void prepareForTransaction() override;
+	virtual std::shared_ptr<StateView const> latestView() const override { Guard l(x_views); return m_latestView; }
+	virtual std::shared_ptr<StateView const> pendingView() const override { Guard l(x_views); return m_pendingView; }
+	virtual void pin(StatePin& o_pin) const override;
+
+	/// Makes views of m_preMine and m_postMine, as they are now, the ones readers get. Call with x_stateDB held.
+	void publishViews();
+
+	/// Reports the queues, caches, DB tables, chain head and hashrate as gauges of the process's Metrics.
+	void watchMetrics();
 
 	/// Collate the changed filters for the bloom filter of the given pending transaction.
 	/// Insert any filters that are activated into @a o_changed.
@@ -250,10 +322,6 @@ protected:
 	/// Insert any filters that are activated into @a o_changed.
 	void appendFromNewBlock(h256 const& _blockHash, h256Set& io_changed);
 
-	/// Record that the set of filters @a _filters have changed.
-	/// This doesn't actually make any callbacks, but incrememnts some counters in m_watches.
-	void noteChanged(h256Set const& _filters);
-
 private:
 	/// Do some work. Handles blockchain maintenance and mining.
 	virtual void doWork();
@@ -261,8 +329,12 @@ private:
 	/// Called when Worker is exiting.
 	virtual void doneWorking();
 
+	/// Wakes our thread to sync at once: there are new blocks, transactions or mined work.
+	void noteWork();
+
 	/// Overrides for being a mining host.
 	virtual void setupState(State& _s);
+	virtual void onComplete() { noteWork(); }
 	virtual bool turbo() const { return m_turboMining; }
 	virtual bool force() const { return m_forceMining; }
 
@@ -276,10 +348,17 @@ private:
 	State m_preMine;						///< The present state of the client.
 	State m_postMine;						///< The state of the client which we're mining (i.e. it'll have all the rewards added).
 
+	mutable Mutex x_views;					///< Lock on the view pointers only; never held for longer than it takes to swap one.
+	std::shared_ptr<StateView const> m_latestView;	///< What readers see of m_preMine, as of when it was last published.
+	std::shared_ptr<StateView const> m_pendingView;	///< What readers see of m_postMine, as of when it was last published.
+
 	std::weak_ptr<EthereumHost> m_host;		///< Our Ethereum Host. Don't do anything if we can't lock.
 
 	mutable Mutex x_remoteMiner;			///< The remote miner lock.
 	RemoteMiner m_remoteMiner;				///< The remote miner.
+	mutable Mutex x_onNewWork;				///< Lock on m_onNewWork and m_onChainChanged.
+	std::function<void()> m_onNewWork;		///< Called when there is new work for miners.
+	std::function<void()> m_onChainChanged;	///< Called when the chain has changed.
 
 	std::vector<LocalMiner> m_localMiners;	///< The in-process miners.
 	mutable SharedMutex x_localMiners;		///< The in-process miners lock.
@@ -288,7 +367,13 @@ private:
 	bool m_forceMining = false;				///< Mine even when there are no transactions pending?
 	bool m_verifyOwnBlocks = true;			///< Should be verify blocks that we mined?
 
+	Mutex x_signalled;						///< Lock for m_signalled.
+	Condition m_signal;						///< Signalled by noteWork().
+	bool m_signalled = false;				///< Whether there may be something to sync since our thread last looked.
+
 	mutable std::chrono::system_clock::time_point m_lastGarbageCollection;
+
+	std::vector<unsigned> m_metrics;		///< Our watched gauges, to unwatch on destruction.
 };
 
 }
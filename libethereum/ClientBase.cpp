@@ -22,6 +22,10 @@
 
 #include <libdevcore/StructuredLogger.h>
 #include "ClientBase.h"
+
+#include <thread>
+#include <boost/thread/tss.hpp>
+#include <libdevcore/ThreadPool.h>
 #include "BlockChain.h"
 #include "Executive.h"
 
@@ -29,22 +33,79 @@ using namespace std;
 using namespace dev;
 using namespace dev::eth;
 
+/// Bytes of call results kept.
+static const size_t c_callResultsSize = 16 * 1024 * 1024;
+/// Most probes of an estimateGas() round, each on its own thread.
+static const unsigned c_maxEstimateProbes = 4;
+
+ClientBase::ClientBase():
+	m_callResults(c_callResultsSize)
+{
+}
+
+/// The pin that reads on this thread see, if any.
+static boost::thread_specific_ptr<shared_ptr<StatePin const>> t_pin;
+
 State ClientBase::asOf(BlockNumber _h) const
 {
+	if (_h == PendingBlock || _h == LatestBlock)
+		return viewOf(_h)->copy();
+	return asOf(bc().numberHash(_h));
+}
+
+shared_ptr<StateView const> ClientBase::viewOf(BlockNumber _h) const
+{
+	auto p = pinned();
 	if (_h == PendingBlock)
-		return postMine();
+		return p ? p->pending : pendingView();
 	else if (_h == LatestBlock)
-		return preMine();
-	return asOf(bc().numberHash(_h));
+		return p ? p->latest : latestView();
+	return make_shared<StateView>(asOf(bc().numberHash(_h)));
+}
+
+void ClientBase::pin(StatePin& o_pin) const
+{
+	o_pin.latest = latestView();
+	o_pin.pending = pendingView();
+	// The head as the states know it; the chain itself may be ahead by now.
+	o_pin.latestHash = o_pin.latest->info().parentHash;
+	o_pin.latestNumber = (unsigned)o_pin.latest->info().number - 1;
+}
+
+StatePin const* ClientBase::pinned() const
+{
+	auto p = t_pin.get();
+	return p && *p && (*p)->client == this ? p->get() : nullptr;
+}
+
+SnapshotRunner ClientBase::snapshot() const
+{
+	auto p = make_shared<StatePin>();
+	p->client = this;
+	pin(*p);
+	shared_ptr<StatePin const> cp = p;
+	return [cp](function<void()> const& _f)
+	{
+		if (!t_pin.get())
+			t_pin.reset(new shared_ptr<StatePin const>);
+		// Restores whatever pin the thread had before, however _f leaves.
+		struct Scope
+		{
+			Scope(shared_ptr<StatePin const> const& _p): old(*t_pin) { *t_pin = _p; }
+			~Scope() { *t_pin = old; }
+			shared_ptr<StatePin const> old;
+		} s(cp);
+		_f();
+	};
 }
 
 void ClientBase::submitTransaction(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice)
 {
 	prepareForTransaction();
 	
-	u256 n = postMine().transactionsFrom(toAddress(_secret));
+	u256 n = viewOf(PendingBlock)->transactionsFrom(toAddress(_secret));
 	Transaction t(_value, _gasPrice, _gas, _dest, _data, n, _secret);
-	m_tq.import(t.rlp());
+	m_tq.import(t);
 	
 	StructuredLogger::transactionReceived(t.sha3().abridged(), t.sender().abridged());
 	cnote << "New transaction " << t;
@@ -54,9 +115,9 @@ Address ClientBase::submitTransaction(Secret _secret, u256 _endowment, bytes con
 {
 	prepareForTransaction();
 	
-	u256 n = postMine().transactionsFrom(toAddress(_secret));
+	u256 n = viewOf(PendingBlock)->transactionsFrom(toAddress(_secret));
 	Transaction t(_endowment, _gasPrice, _gas, _init, n, _secret);
-	m_tq.import(t.rlp());
+	m_tq.import(t);
 
 	StructuredLogger::transactionReceived(t.sha3().abridged(), t.sender().abridged());
 	cnote << "New transaction " << t;
@@ -64,19 +125,67 @@ Address ClientBase::submitTransaction(Secret _secret, u256 _endowment, bytes con
 	return right160(sha3(rlpList(t.sender(), t.nonce())));
 }
 
+h256s ClientBase::submitTransactions(vector<Secret> const& _secrets, vector<TransactionSkeleton> const& _ts)
+{
+	prepareForTransaction();
+
+	Addresses senders(_ts.size());
+	ThreadPool::get().forEach(_ts.size(), [&](unsigned i) { senders[i] = toAddress(_secrets[i]); });
+
+	// The nonces are given out in order; only then can the transactions be signed, each on its own.
+	vector<u256> nonces(_ts.size());
+	{
+		auto view = viewOf(PendingBlock);
+		map<Address, u256> next;
+		for (unsigned i = 0; i < _ts.size(); ++i)
+		{
+			auto it = next.find(senders[i]);
+			if (it == next.end())
+				it = next.insert(make_pair(senders[i], view->transactionsFrom(senders[i]))).first;
+			nonces[i] = it->second++;
+		}
+	}
+
+	Transactions ts(_ts.size());
+	ThreadPool::get().forEach(_ts.size(), [&](unsigned i)
+	{
+		TransactionSkeleton const& t = _ts[i];
+		ts[i] = t.creation ?
+			Transaction(t.value, t.gasPrice, t.gas, t.data, nonces[i], _secrets[i]) :
+			Transaction(t.value, t.gasPrice, t.gas, t.to, t.data, nonces[i], _secrets[i]);
+	});
+	m_tq.import(ts);
+
+	h256s ret;
+	for (Transaction const& t: ts)
+		ret.push_back(t.sha3());
+	cnote << "New transactions:" << ts.size();
+	return ret;
+}
+
 // TODO: remove try/catch, allow exceptions
 ExecutionResult ClientBase::call(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice, BlockNumber _blockNumber, FudgeFactor _ff)
 {
 	ExecutionResult ret;
 	try
 	{
-		State temp = asOf(_blockNumber);
+		auto view = viewOf(_blockNumber);
 		Address a = toAddress(_secret);
+
+		// A call changes nothing, so made again against the same state, in the same block, it gives the same result.
+		// A new head means a new root or parent, and so a new key: nothing need be thrown away.
+		BlockInfo const& bi = view->info();
+		h256 key = sha3(rlpList(view->rootHash(), bi.parentHash, bi.number, bi.timestamp, bi.coinbaseAddress, bi.gasLimit, a, _dest, _value, _gas, _gasPrice, (unsigned)_ff, sha3(_data)));
+		if (m_callResults.get(key, ret))
+			return ret;
+
+		State temp = view->copy();
 		u256 n = temp.transactionsFrom(a);
 		Transaction t(_value, _gasPrice, _gas, _dest, _data, n, _secret);
 		if (_ff == FudgeFactor::Lenient)
 			temp.addBalance(a, (u256)(t.gas() * t.gasPrice() + t.value()));
 		ret = temp.execute(bc().lastHashes(), t, Permanence::Reverted);
+		m_callResults.insert(key, ret);
 	}
 	catch (...)
 	{
@@ -107,29 +216,118 @@ ExecutionResult ClientBase::create(Secret _secret, u256 _value, bytes const& _da
 	return ret;
 }
 
+u256 ClientBase::estimateGas(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _maxGas, u256 _gasPrice, BlockNumber _blockNumber)
+{
+	try
+	{
+		// Every probe runs on its own copy of one fork of the state, in which the sender can afford the most gas.
+		State base = viewOf(_blockNumber)->copy();
+		Address a = toAddress(_secret);
+		u256 n = base.transactionsFrom(a);
+		base.addBalance(a, (u256)(bigint(_maxGas) * _gasPrice + _value));
+		LastHashes lh = bc().lastHashes();
+
+		auto succeeds = [&](u256 _gas)
+		{
+			try
+			{
+				State temp = base;
+				Transaction t = _dest ? Transaction(_value, _gasPrice, _gas, _dest, _data, n, _secret) : Transaction(_value, _gasPrice, _gas, _data, n, _secret);
+				return temp.execute(lh, t, Permanence::Reverted).excepted == TransactionException::None;
+			}
+			catch (...)
+			{
+				return false;
+			}
+		};
+
+		// lo always fails and hi always succeeds; each round probes several points between them at once.
+		bigint intrinsic = Transaction::gasRequired(_data);
+		if (intrinsic > _maxGas || !succeeds(_maxGas))
+			return 0;
+		u256 lo = (u256)intrinsic - 1;
+		u256 hi = _maxGas;
+		unsigned k = max(1u, min(thread::hardware_concurrency(), c_maxEstimateProbes));
+		while (hi - lo > 1)
+		{
+			vector<u256> gas;
+			for (unsigned i = 1; i <= k; ++i)
+			{
+				u256 g = lo + (u256)(bigint(hi - lo) * i / (k + 1));
+				if (g > lo && g < hi && (gas.empty() || g > gas.back()))
+					gas.push_back(g);
+			}
+			if (gas.empty())
+				gas.push_back(lo + (hi - lo) / 2);
+
+			vector<char> ok(gas.size());
+			vector<thread> probes;
+			for (unsigned i = 1; i < gas.size(); ++i)
+				probes.push_back(thread([&, i](){ ok[i] = succeeds(gas[i]); }));
+			ok[0] = succeeds(gas[0]);
+			for (auto& p: probes)
+				p.join();
+
+			for (unsigned i = 0; i < gas.size(); ++i)
+				if (ok[i])
+				{
+					hi = gas[i];
+					break;
+				}
+				else
+					lo = gas[i];
+		}
+		return hi;
+	}
+	catch (...)
+	{
+		return 0;
+	}
+}
+
+ExecutionResult ClientBase::traceAccesses(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice, BlockNumber _blockNumber)
+{
+	// Not kept in m_callResults: the accesses are far bigger than a call's result, and asked for far more rarely.
+	ExecutionResult ret;
+	try
+	{
+		State temp = viewOf(_blockNumber)->copy();
+		Address a = toAddress(_secret);
+		u256 n = temp.transactionsFrom(a);
+		Transaction t = _dest ? Transaction(_value, _gasPrice, _gas, _dest, _data, n, _secret) : Transaction(_value, _gasPrice, _gas, _data, n, _secret);
+		temp.addBalance(a, (u256)(t.gas() * t.gasPrice() + t.value()));
+		ret = temp.execute(bc().lastHashes(), t, Permanence::Reverted, Tracing::Accesses);
+	}
+	catch (...)
+	{
+		// TODO: Some sort of notification of failure.
+	}
+	return ret;
+}
+
 void ClientBase::injectBlock(bytes const& _block)
 {
-	bc().import(_block, preMine().db());
+	bc().import(_block, viewOf(LatestBlock)->db());
 }
 
 u256 ClientBase::balanceAt(Address _a, BlockNumber _block) const
 {
-	return asOf(_block).balance(_a);
+	return viewOf(_block)->balance(_a);
 }
 
 u256 ClientBase::countAt(Address _a, BlockNumber _block) const
 {
-	return asOf(_block).transactionsFrom(_a);
+	return viewOf(_block)->transactionsFrom(_a);
 }
 
 u256 ClientBase::stateAt(Address _a, u256 _l, BlockNumber _block) const
 {
-	return asOf(_block).storage(_a, _l);
+	return viewOf(_block)->storage(_a, _l);
 }
 
 bytes ClientBase::codeAt(Address _a, BlockNumber _block) const
 {
-	return asOf(_block).code(_a);
+	return viewOf(_block)->code(_a);
 }
 
 map<u256, u256> ClientBase::storageAt(Address _a, BlockNumber _block) const
@@ -137,6 +335,21 @@ map<u256, u256> ClientBase::storageAt(Address _a, BlockNumber _block) const
 	return asOf(_block).storage(_a);
 }
 
+StateProof ClientBase::proofAt(Address _a, u256s const& _slots, BlockNumber _block) const
+{
+	return asOf(_block).prove(_a, _slots);
+}
+
+bytes ClientBase::accountRangeAt(bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f, BlockNumber _block) const
+{
+	return asOf(_block).accountRange(_from, _limit, _f);
+}
+
+bytes ClientBase::storageRangeAt(Address _a, bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f, BlockNumber _block) const
+{
+	return asOf(_block).storageRange(_a, _from, _limit, _f);
+}
+
 // TODO: remove try/catch, allow exceptions
 LocalisedLogEntries ClientBase::logs(unsigned _watchId) const
 {
@@ -155,14 +368,16 @@ LocalisedLogEntries ClientBase::logs(unsigned _watchId) const
 
 LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 {
+	// Entries are gathered in the reverse of the order returned, then turned round, rather than each being inserted at the front.
 	LocalisedLogEntries ret;
-	unsigned begin = min<unsigned>(bc().number() + 1, (unsigned)_f.latest());
-	unsigned end = min(bc().number(), min(begin, (unsigned)_f.earliest()));
+	unsigned number = this->number();
+	unsigned begin = min<unsigned>(number + 1, (unsigned)_f.latest());
+	unsigned end = min(number, min(begin, (unsigned)_f.earliest()));
 	
 	// Handle pending transactions differently as they're not on the block chain.
-	if (begin > bc().number())
+	if (begin > number)
 	{
-		State temp = postMine();
+		State temp = asOf(PendingBlock);
 		for (unsigned i = 0; i < temp.pending().size(); ++i)
 		{
 			// Might have a transaction that contains a matching log.
@@ -171,15 +386,20 @@ LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 			LogEntries le = _f.matches(tr);
 			if (le.size())
 				for (unsigned j = 0; j < le.size(); ++j)
-					ret.insert(ret.begin(), LocalisedLogEntry(le[j], begin, th));
+					ret.push_back(LocalisedLogEntry(le[j], begin, th));
 		}
-		begin = bc().number();
+		begin = number;
 	}
 	
+	// Logs in the log index are looked up directly; any older are searched for by their blooms.
+	auto keys = _f.indexKeys();
+	unsigned indexFrom = keys.empty() ? (unsigned)-1 : bc().logIndexFrom();
+
 	set<unsigned> matchingBlocks;
-	for (auto const& i: _f.bloomPossibilities())
-		for (auto u: bc().withBlockBloom(i, end, begin))
-			matchingBlocks.insert(u);
+	if (end < indexFrom)
+		for (auto const& i: _f.bloomPossibilities())
+			for (auto u: bc().withBlockBloom(i, end, min(begin, indexFrom - 1)))
+				matchingBlocks.insert(u);
 
 	unsigned falsePos = 0;
 	for (auto n: matchingBlocks)
@@ -199,7 +419,7 @@ LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 				{
 					total += le.size();
 					for (unsigned j = 0; j < le.size(); ++j)
-						ret.insert(ret.begin(), LocalisedLogEntry(le[j], n, th));
+						ret.push_back(LocalisedLogEntry(le[j], n, th));
 				}
 			}
 			
@@ -208,7 +428,36 @@ LocalisedLogEntries ClientBase::logs(LogFilter const& _f) const
 		}
 	}
 
+	if (begin >= indexFrom)
+	{
+		vector<LogPosition> positions;
+		for (auto const& k: keys)
+			positions += bc().logPositions(k.first, k.second, max(end, indexFrom), begin);
+		sort(positions.begin(), positions.end());
+
+		unsigned block = (unsigned)-1;
+		h256 h;
+		BlockReceipts receipts;
+		for (LogPosition const& p: positions)
+		{
+			if (p.block != block)
+			{
+				block = p.block;
+				h = bc().numberHash(block);
+				receipts = bc().receipts(h);
+			}
+			if (p.transaction < receipts.receipts.size() && p.log < receipts.receipts[p.transaction].log().size())
+			{
+				LogEntry const& e = receipts.receipts[p.transaction].log()[p.log];
+				if (_f.matches(e))
+					ret.push_back(LocalisedLogEntry(e, p.block, transaction(h, p.transaction).sha3()));
+			}
+		}
+		cdebug << positions.size() << "logs looked up from the log index";
+	}
+
 	cdebug << matchingBlocks.size() << "searched from" << (end - begin) << "skipped; " << falsePos << "false +ves";
+	reverse(ret.begin(), ret.end());
 	return ret;
 }
 
@@ -221,6 +470,7 @@ unsigned ClientBase::installWatch(LogFilter const& _f, Reaping _r)
 		{
 			cwatch << "FFF" << _f << h.abridged();
 			m_filters.insert(make_pair(h, _f));
+			m_filterIndex.insert(h, _f);
 		}
 	}
 	return installWatch(h, _r);
@@ -247,6 +497,75 @@ unsigned ClientBase::installWatch(h256 _h, Reaping _r)
 	return ret;
 }
 
+unsigned ClientBase::installWatch(LogFilter const& _f, ChangesHandler const& _h)
+{
+	unsigned ret = installWatch(_f, Reaping::Manual);
+	Guard l(x_filtersWatches);
+	m_watches[ret].handler = _h;
+	return ret;
+}
+
+unsigned ClientBase::installWatch(h256 _h, ChangesHandler const& _handler)
+{
+	unsigned ret = installWatch(_h, Reaping::Manual);
+	Guard l(x_filtersWatches);
+	m_watches[ret].handler = _handler;
+	return ret;
+}
+
+template <class T>
+static string filtersToString(T const& _fs)
+{
+	stringstream ret;
+	ret << "{";
+	unsigned i = 0;
+	for (h256 const& f: _fs)
+		ret << (i++ ? ", " : "") << (f == PendingChangedFilter ? "pending" : f == ChainChangedFilter ? "chain" : f.abridged());
+	ret << "}";
+	return ret.str();
+}
+
+void ClientBase::noteChanged(h256Set const& _filters)
+{
+	vector<pair<unsigned, ChangesHandler>> pushed;
+	vector<LocalisedLogEntries> pushedChanges;
+	{
+		Guard l(x_filtersWatches);
+		if (_filters.size())
+			cnote << "noteChanged(" << filtersToString(_filters) << ")";
+		// accrue all changes left in each filter into the watches.
+		for (auto& w: m_watches)
+			if (_filters.count(w.second.id))
+			{
+				cwatch << "!!!" << w.first << (m_filters.count(w.second.id) ? w.second.id.abridged() : w.second.id == PendingChangedFilter ? "pending" : w.second.id == ChainChangedFilter ? "chain" : "???");
+				if (m_filters.count(w.second.id))	// Normal filtering watch
+					w.second.changes += m_filters.at(w.second.id).changes;
+				else								// Special ('pending'/'latest') watch
+					w.second.changes.push_back(LocalisedLogEntry(SpecialLogEntry, 0));
+				if (w.second.handler && !w.second.changes.empty())
+				{
+					pushed.push_back(make_pair(w.first, w.second.handler));
+					pushedChanges.push_back(LocalisedLogEntries());
+					swap(pushedChanges.back(), w.second.changes);
+				}
+			}
+		// clear the filters now.
+		for (auto& i: m_filters)
+			i.second.changes.clear();
+	}
+
+	// Unlocked, so that handlers may install and uninstall watches.
+	for (unsigned i = 0; i < pushed.size(); ++i)
+		try
+		{
+			pushed[i].second(pushed[i].first, pushedChanges[i]);
+		}
+		catch (...)
+		{
+			cwarn << "Watch" << pushed[i].first << "handler threw:" << boost::current_exception_diagnostic_information();
+		}
+}
+
 bool ClientBase::uninstallWatch(unsigned _i)
 {
 	cwatch << "XXX" << _i;
@@ -264,6 +583,7 @@ bool ClientBase::uninstallWatch(unsigned _i)
 		if (!--fit->second.refCount)
 		{
 			cwatch << "*X*" << fit->first << ":" << fit->second.filter;
+			m_filterIndex.erase(fit->first, fit->second.filter);
 			m_filters.erase(fit);
 		}
 	return true;
@@ -298,7 +618,7 @@ LocalisedLogEntries ClientBase::checkWatch(unsigned _watchId)
 
 BlockInfo ClientBase::blockInfo(h256 _hash) const
 {
-	return BlockInfo(bc().block(_hash));
+	return BlockInfo(bc().blockHandle(_hash).data());
 }
 
 BlockDetails ClientBase::blockDetails(h256 _hash) const
@@ -313,21 +633,19 @@ Transaction ClientBase::transaction(h256 _transactionHash) const
 
 Transaction ClientBase::transaction(h256 _blockHash, unsigned _i) const
 {
-	auto bl = bc().block(_blockHash);
-	RLP b(bl);
-	if (_i < b[1].itemCount())
-		return Transaction(b[1][_i].data(), CheckTransaction::Cheap);
+	auto b = bc().blockHandle(_blockHash);
+	if (_i < b.transactionCount())
+		return Transaction(b.transaction(_i), CheckTransaction::Cheap);
 	else
 		return Transaction();
 }
 
 Transactions ClientBase::transactions(h256 _blockHash) const
 {
-	auto bl = bc().block(_blockHash);
-	RLP b(bl);
+	auto b = bc().blockHandle(_blockHash);
 	Transactions res;
-	for (unsigned i = 0; i < b[1].itemCount(); i++)
-		res.emplace_back(b[1][i].data(), CheckTransaction::Cheap);
+	for (auto const& t: b.transactions())
+		res.emplace_back(t, CheckTransaction::Cheap);
 	return res;
 }
 
@@ -336,12 +654,21 @@ TransactionHashes ClientBase::transactionHashes(h256 _blockHash) const
 	return bc().transactionHashes(_blockHash);
 }
 
+bytes ClientBase::blockRLP(h256 _hash) const
+{
+	return bc().block(_hash);
+}
+
+bytes ClientBase::receiptsRLP(h256 _hash) const
+{
+	return bc().receipts(_hash).rlp();
+}
+
 BlockInfo ClientBase::uncle(h256 _blockHash, unsigned _i) const
 {
-	auto bl = bc().block(_blockHash);
-	RLP b(bl);
-	if (_i < b[2].itemCount())
-		return BlockInfo::fromHeader(b[2][_i].data());
+	auto b = bc().blockHandle(_blockHash);
+	if (_i < b.uncleCount())
+		return BlockInfo::fromHeader(b.uncle(_i));
 	else
 		return BlockInfo();
 }
@@ -353,31 +680,28 @@ UncleHashes ClientBase::uncleHashes(h256 _blockHash) const
 
 unsigned ClientBase::transactionCount(h256 _blockHash) const
 {
-	auto bl = bc().block(_blockHash);
-	RLP b(bl);
-	return b[1].itemCount();
+	return bc().blockHandle(_blockHash).transactionCount();
 }
 
 unsigned ClientBase::uncleCount(h256 _blockHash) const
 {
-	auto bl = bc().block(_blockHash);
-	RLP b(bl);
-	return b[2].itemCount();
+	return bc().blockHandle(_blockHash).uncleCount();
 }
 
 unsigned ClientBase::number() const
 {
-	return bc().number();
+	auto p = pinned();
+	return p ? p->latestNumber : bc().number();
 }
 
 Transactions ClientBase::pending() const
 {
-	return postMine().pending();
+	return viewOf(PendingBlock)->pending();
 }
 
 h256s ClientBase::pendingHashes() const
 {
-	return h256s() + postMine().pendingHashes();
+	return h256s() + viewOf(PendingBlock)->pendingHashes();
 }
 
 
@@ -403,12 +727,12 @@ Addresses ClientBase::addresses(BlockNumber _block) const
 
 u256 ClientBase::gasLimitRemaining() const
 {
-	return postMine().gasLimitRemaining();
+	return viewOf(PendingBlock)->gasLimitRemaining();
 }
 
 Address ClientBase::address() const
 {
-	return preMine().address();
+	return viewOf(LatestBlock)->address();
 }
 
 h256 ClientBase::hashFromNumber(BlockNumber _number) const
@@ -416,6 +740,9 @@ h256 ClientBase::hashFromNumber(BlockNumber _number) const
 	if (_number == PendingBlock)
 		return h256();
 	if (_number == LatestBlock)
-		return bc().currentHash();
+	{
+		auto p = pinned();
+		return p ? p->latestHash : bc().currentHash();
+	}
 	return bc().numberHash(_number);
 }
@@ -23,8 +23,10 @@
 #pragma once
 
 #include <chrono>
+#include <libdevcore/ShardedCache.h>
 #include "Interface.h"
 #include "LogFilter.h"
+#include "StateView.h"
 
 namespace dev {
 
@@ -57,8 +59,22 @@ struct ClientWatch
 	LocalisedLogEntries changes;
 #endif
 	mutable std::chrono::system_clock::time_point lastPoll = std::chrono::system_clock::now();
+	ChangesHandler handler;		///< If set, takes the changes as they come, instead of their waiting for checkWatch.
 };
 
+/// The latest and pending blocks of a client as they were at one moment; see ClientBase::snapshot().
+struct StatePin
+{
+	void const* client = nullptr;
+	h256 latestHash;
+	unsigned latestNumber = 0;
+	std::shared_ptr<StateView const> latest;
+	std::shared_ptr<StateView const> pending;
+};
+
+struct CallResultSize { size_t operator()(ExecutionResult const& _r) const { return sizeof(_r) + _r.output.capacity(); } };
+using CallResultCache = ShardedCache<h256, ExecutionResult, CallResultSize>;
+
 struct WatchChannel: public LogChannel { static const char* name() { return "(o)"; } static const int verbosity = 7; };
 #define cwatch dev::LogOutputStream<dev::eth::WatchChannel, true>()
 struct WorkInChannel: public LogChannel { static const char* name() { return ">W>"; } static const int verbosity = 16; };
@@ -71,7 +87,7 @@ struct WorkChannel: public LogChannel { static const char* name() { return "-W-"
 class ClientBase: public dev::eth::Interface
 {
 public:
-	ClientBase() {}
+	ClientBase();
 	virtual ~ClientBase() {}
 
 	/// Submits the given message-call transaction.
@@ -81,11 +97,16 @@ public:
 	/// @returns the new contract's address (assuming it all goes through).
 	virtual Address submitTransaction(Secret _secret, u256 _endowment, bytes const& _init, u256 _gas = 10000, u256 _gasPrice = 10 * szabo) override;
 
+	/// Submits the transactions together: signed in parallel and queued under one lock, to be announced in one go.
+	virtual h256s submitTransactions(std::vector<Secret> const& _secrets, std::vector<TransactionSkeleton> const& _ts) override;
+
 	/// Makes the given call. Nothing is recorded into the state.
 	virtual ExecutionResult call(Secret _secret, u256 _value, Address _dest, bytes const& _data = bytes(), u256 _gas = 10000, u256 _gasPrice = 10 * szabo, BlockNumber _blockNumber = PendingBlock, FudgeFactor _ff = FudgeFactor::Strict) override;
 
 	/// Makes the given create. Nothing is recorded into the state.
 	virtual ExecutionResult create(Secret _secret, u256 _value, bytes const& _data = bytes(), u256 _gas = 10000, u256 _gasPrice = 10 * szabo, BlockNumber _blockNumber = PendingBlock, FudgeFactor _ff = FudgeFactor::Strict) override;
+	virtual u256 estimateGas(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _maxGas, u256 _gasPrice, BlockNumber _blockNumber = PendingBlock) override;
+	virtual ExecutionResult traceAccesses(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice, BlockNumber _blockNumber = PendingBlock) override;
 	
 	using Interface::balanceAt;
 	using Interface::countAt;
@@ -98,6 +119,9 @@ public:
 	virtual u256 stateAt(Address _a, u256 _l, BlockNumber _block) const override;
 	virtual bytes codeAt(Address _a, BlockNumber _block) const override;
 	virtual std::map<u256, u256> storageAt(Address _a, BlockNumber _block) const override;
+	virtual StateProof proofAt(Address _a, u256s const& _slots, BlockNumber _block) const override;
+	virtual bytes accountRangeAt(bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f, BlockNumber _block) const override;
+	virtual bytes storageRangeAt(Address _a, bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f, BlockNumber _block) const override;
 
 	virtual LocalisedLogEntries logs(unsigned _watchId) const override;
 	virtual LocalisedLogEntries logs(LogFilter const& _filter) const override;
@@ -105,6 +129,8 @@ public:
 	/// Install, uninstall and query watches.
 	virtual unsigned installWatch(LogFilter const& _filter, Reaping _r = Reaping::Automatic) override;
 	virtual unsigned installWatch(h256 _filterId, Reaping _r = Reaping::Automatic) override;
+	virtual unsigned installWatch(LogFilter const& _filter, ChangesHandler const& _h) override;
+	virtual unsigned installWatch(h256 _filterId, ChangesHandler const& _h) override;
 	virtual bool uninstallWatch(unsigned _watchId) override;
 	virtual LocalisedLogEntries peekWatch(unsigned _watchId) const override;
 	virtual LocalisedLogEntries checkWatch(unsigned _watchId) override;
@@ -116,6 +142,8 @@ public:
 	virtual eth::Transaction transaction(h256 _blockHash, unsigned _i) const override;
 	virtual eth::Transactions transactions(h256 _blockHash) const override;
 	virtual eth::TransactionHashes transactionHashes(h256 _blockHash) const override;
+	virtual bytes blockRLP(h256 _hash) const override;
+	virtual bytes receiptsRLP(h256 _hash) const override;
 	virtual eth::BlockInfo uncle(h256 _blockHash, unsigned _i) const override;
 	virtual eth::UncleHashes uncleHashes(h256 _blockHash) const override;
 	virtual unsigned transactionCount(h256 _blockHash) const override;
@@ -123,6 +151,7 @@ public:
 	virtual unsigned number() const override;
 	virtual eth::Transactions pending() const override;
 	virtual h256s pendingHashes() const override;
+	virtual SnapshotRunner snapshot() const override;
 
 	void injectBlock(bytes const& _block);
 
@@ -153,6 +182,8 @@ public:
 	virtual bool submitWork(eth::ProofOfWork::Proof const&) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::ClientBase::submitWork")); }
 
 	State asOf(BlockNumber _h) const;
+	/// @returns a read-only view of the state of @a _h; that of the latest or pending block is had without copying it.
+	std::shared_ptr<StateView const> viewOf(BlockNumber _h) const;
 
 protected:
 	/// The interface that must be implemented in any class deriving this.
@@ -165,12 +196,28 @@ protected:
 	virtual void prepareForTransaction() = 0;
 	/// }
 
+	/// @returns views of the states of the latest and pending blocks; by default of copies of preMine() and postMine().
+	virtual std::shared_ptr<StateView const> latestView() const { return std::make_shared<StateView>(preMine()); }
+	virtual std::shared_ptr<StateView const> pendingView() const { return std::make_shared<StateView>(postMine()); }
+
+	/// Fills in @a o_pin with the states of the latest and pending blocks, and the head they are on, all as of one moment.
+	virtual void pin(StatePin& o_pin) const;
+	/// @returns the pin that reads of ours on this thread are to see, if there is one.
+	StatePin const* pinned() const;
+
+	/// Record that the set of filters @a _filters have changed: their changes go to the watches on them,
+	/// and are pushed at once, outside our lock, to those with handlers.
+	void noteChanged(h256Set const& _filters);
+
 	TransactionQueue m_tq;							///< Maintains a list of incoming transactions not yet in a block on the blockchain.
 
 	// filters
 	mutable Mutex x_filtersWatches;					///< Our lock.
 	std::map<h256, InstalledFilter> m_filters;		///< The dictionary of filters that are active.
+	LogFilterIndex m_filterIndex;					///< Which of m_filters may match any given log.
 	std::map<unsigned, ClientWatch> m_watches;		///< Each and every watch - these reference a filter.
+
+	CallResultCache m_callResults;					///< The results of recent calls, by all that went into them.
 };
 
 }}
@@ -47,11 +47,26 @@ static const unsigned c_maxHashesAsk = 256;		///< Maximum number of hashes GetBl
 static const unsigned c_maxBlocks = 128;		///< Maximum number of blocks Blocks will ever send.
 static const unsigned c_maxBlocksAsk = 128;		///< Maximum number of blocks we ask to receive in Blocks (when using GetChain).
 #endif
+static const unsigned c_relayVersion = 2;		///< Sent after the genesis hash in Status; peers that both send 1 or more relay transactions by announcing hashes, and 2 or more new blocks too.
+static const std::chrono::seconds c_transactionRequestTimeout(5);	///< How long before we ask another peer for an announced transaction or block.
+static const unsigned c_minBlocksAsk = 8;		///< Fewest blocks we ask a peer for at once, however slow it has been.
+static const std::chrono::milliseconds c_blocksFetchTime(2000);	///< How long we aim for a peer to take answering each GetBlocks.
+static const unsigned c_maxNodes = 384;		///< Maximum number of state nodes NodeData will ever send.
+static const unsigned c_maxNodesAsk = 384;		///< Maximum number of state nodes we ask to receive in NodeData.
+static const unsigned c_pivotDistance = 64;	///< How far behind the head a fast sync downloads the state of, so that it is unlikely to be reorganised away.
+static const unsigned c_lightProtocolVersion = 1;	///< The version of the light client protocol, "les".
+static const unsigned c_maxLightHeaders = 192;	///< Maximum number of headers Headers will ever send.
+static const unsigned c_maxLightItems = 64;		///< Maximum number of receipts, proofs, codes or transactions a light request may carry.
+static const unsigned c_lightRecentHeaders = 1024;	///< How many of the latest headers a light client keeps whole; it follows no reorganisation deeper.
+static const std::chrono::seconds c_lightRequestTimeout(10);	///< How long a light client waits on a server before asking another.
 
 class BlockChain;
 class TransactionQueue;
 class EthereumHost;
 class EthereumPeer;
+class LightHost;
+class LightPeer;
+class LightClient;
 
 enum
 {
@@ -63,9 +78,29 @@ enum
 	GetBlocksPacket,
 	BlocksPacket,
 	NewBlockPacket,
+	GetNodeDataPacket,
+	NodeDataPacket,
 	PacketCount
 };
 
+/// The packets of the light client protocol. Each request carries an id, which its answer gives back followed by the
+/// credit the server reckons the client has left.
+enum LightPacket
+{
+	LightStatusPacket = 0,
+	AnnouncePacket,
+	GetHeadersPacket,
+	HeadersPacket,
+	GetReceiptsPacket,
+	ReceiptsPacket,
+	GetProofsPacket,
+	ProofsPacket,
+	GetCodePacket,
+	CodePacket,
+	SendTransactionsPacket,
+	LightPacketCount
+};
+
 enum class Asking
 {
 	State,
@@ -28,7 +28,55 @@ using namespace dev::eth;
 
 Defaults* Defaults::s_this = nullptr;
 
+DBProfile dev::eth::toDBProfile(string const& _name)
+{
+	if (_name == "default")
+		return DBProfile::Default;
+	if (_name == "full")
+		return DBProfile::Full;
+	if (_name == "archive")
+		return DBProfile::Archive;
+	BOOST_THROW_EXCEPTION(UnknownDBProfile() << errinfo_comment(_name));
+}
+
 Defaults::Defaults()
 {
 	m_dbPath = getDataDir();
 }
+
+void Defaults::setDBProfile(DBProfile _profile)
+{
+	static const size_t c_mb = 1024 * 1024;
+	// Cache and write buffer MB, bloom bits, open files and compression of the blocks, extras and state DBs. The
+	// state's reads are of random hashes, which only a bloom filter keeps from touching a table at each level, and
+	// its nodes don't compress. An archive's state grows without bound, so gets more of the memory and many more
+	// tables kept open; its blocks are rarely reread.
+	struct Tuning { size_t cache; size_t buffer; unsigned bloom; int files; bool compression; };
+	static const Tuning c_full[] = {
+		{ 16, 8, 10, 0, true },
+		{ 64, 16, 10, 0, true },
+		{ 256, 32, 10, 1024, false }
+	};
+	static const Tuning c_archive[] = {
+		{ 8, 8, 10, 0, true },
+		{ 64, 16, 10, 0, true },
+		{ 512, 64, 10, 4096, false }
+	};
+	for (unsigned i = 0; i < (unsigned)DBRole::Size; ++i)
+	{
+		DBOptions& o = get()->m_dbOptions[i];
+		DBOptions p;
+		p.backend = o.backend;
+		p.createIfMissing = o.createIfMissing;
+		if (_profile != DBProfile::Default)
+		{
+			Tuning const& t = (_profile == DBProfile::Full ? c_full : c_archive)[i];
+			p.blockCacheSize = t.cache * c_mb;
+			p.writeBufferSize = t.buffer * c_mb;
+			p.bloomBitsPerKey = t.bloom;
+			p.maxOpenFiles = t.files;
+			p.compression = t.compression;
+		}
+		o = p;
+	}
+}
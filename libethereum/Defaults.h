@@ -22,12 +22,35 @@
 #pragma once
 
 #include <libdevcore/Common.h>
+#include <libdevcrypto/KeyValueDB.h>
 
 namespace dev
 {
 namespace eth
 {
 
+/// The node's DBs, each tuned for how it is used.
+enum class DBRole
+{
+	Blocks,		///< Block RLP, written once and read mostly when serving peers.
+	Extras,		///< Details, receipts, blooms and indexes of blocks; small values, read often.
+	State,		///< Trie nodes under their hashes: random reads, incompressible, by far the largest.
+	Size
+};
+
+/// Tunings of the DBs for kinds of node; see Defaults::setDBProfile().
+enum class DBProfile
+{
+	Default,	///< The backend's own options, as before profiles.
+	Full,		///< A pruned state: bloom filters and a state cache large enough for the recent tries.
+	Archive		///< Every state kept: larger state caches and write buffers, and many more tables open.
+};
+
+struct UnknownDBProfile: virtual Exception {};
+
+/// @returns the profile named @a _name ("default", "full" or "archive"); throws UnknownDBProfile otherwise.
+DBProfile toDBProfile(std::string const& _name);
+
 struct Defaults
 {
 	friend class BlockChain;
@@ -39,9 +62,27 @@ public:
 	static Defaults* get() { if (!s_this) s_this = new Defaults; return s_this; }
 	static void setDBPath(std::string const& _dbPath) { get()->m_dbPath = _dbPath; }
 	static std::string const& dbPath() { return get()->m_dbPath; }
+	/// Sets the storage backend, and its tuning, of the state and blockchain DBs.
+	static void setDBOptions(DBOptions const& _options) { for (auto& o: get()->m_dbOptions) o = _options; }
+	/// Sets the tuning of the DB @a _role alone; all of them should have the same backend.
+	static void setDBOptions(DBRole _role, DBOptions const& _options) { get()->m_dbOptions[(unsigned)_role] = _options; }
+	static DBOptions const& dbOptions(DBRole _role = DBRole::State) { return get()->m_dbOptions[(unsigned)_role]; }
+	/// Retunes each DB as in @a _profile, keeping the backend.
+	static void setDBProfile(DBProfile _profile);
+	/// Keeps only the states of the last @a _history blocks, and of every @a _checkpoints-th block if non-zero; 0 keeps all.
+	static void setPruning(unsigned _history, unsigned _checkpoints = 0) { get()->m_pruneHistory = _history; get()->m_pruneCheckpoints = _checkpoints; }
+	/// Keeps the blockchain's in-memory caches within @a _bytes in total; 0 for the default.
+	static void setCacheSize(size_t _bytes) { get()->m_cacheSize = _bytes; }
+	/// Indexes the logs of blocks imported from now on by address and first topic, for exact log queries.
+	static void setLogIndex(bool _on) { get()->m_logIndex = _on; }
 
 private:
 	std::string m_dbPath;
+	DBOptions m_dbOptions[(unsigned)DBRole::Size];
+	unsigned m_pruneHistory = 0;
+	unsigned m_pruneCheckpoints = 0;
+	size_t m_cacheSize = 0;
+	bool m_logIndex = false;
 
 	static Defaults* s_this;
 };
@@ -53,10 +53,12 @@ h256Set DownloadSub::nextFetch(unsigned _n)
 	if (!m_man || m_man->chain().empty())
 		return h256Set();
 
-	m_asked = (~(m_man->taken() + m_attempted)).lowest(_n);
+	m_asked = m_man->untaken(_n, m_attempted);
 	if (m_asked.empty())
-		m_asked = (~(m_man->taken(true) + m_attempted)).lowest(_n);
+		m_asked = m_man->untaken(_n, m_attempted, true);
 	m_attempted += m_asked;
+	if (!m_asked.empty())
+		m_askedAt = chrono::steady_clock::now().time_since_epoch().count();
 	for (auto i: m_asked)
 	{
 		auto x = m_man->m_chain[i];
@@ -73,5 +75,47 @@ bool DownloadSub::noteBlock(h256 _hash)
 		m_man->m_blocksGot += m_indices[_hash];
 	bool ret = !!m_remaining.count(_hash);
 	m_remaining.erase(_hash);
+	if (ret && m_remaining.empty())
+	{
+		m_lastAsk = chrono::steady_clock::now().time_since_epoch() - chrono::steady_clock::duration(m_askedAt);
+		m_askedAt = 0;
+	}
 	return ret;
 }
+
+void DownloadSub::noteFetched(unsigned _got, size_t _bytes)
+{
+	Guard l(m_fetch);
+	auto askedAt = m_askedAt.load();
+	double s;
+	if (askedAt)
+	{
+		// Answered in part; the rest is asked for again, so time that afresh.
+		auto now = chrono::steady_clock::now().time_since_epoch();
+		s = chrono::duration<double>(now - chrono::steady_clock::duration(askedAt)).count();
+		m_askedAt = now.count();
+	}
+	else
+		// Answered in full, which noteBlock() timed.
+		s = chrono::duration<double>(m_lastAsk).count();
+	s = max(s, 0.001);
+	// Weighted towards recent fetches, so a peer that slows down is soon given less.
+	auto average = [&](double& _avg, double _sample) { _avg = _avg ? _avg * 0.75 + _sample * 0.25 : _sample; };
+	average(m_stats.blocksPerSecond, _got / s);
+	average(m_stats.bytesPerSecond, _bytes / s);
+	average(m_stats.latency, s);
+}
+
+unsigned DownloadSub::fetchSize() const
+{
+	Guard l(m_fetch);
+	if (!m_stats.blocksPerSecond)
+		return c_maxBlocksAsk / 4;
+	return (unsigned)max<double>(c_minBlocksAsk, min<double>(c_maxBlocksAsk, m_stats.blocksPerSecond * c_blocksFetchTime.count() / 1000));
+}
+
+bool DownloadSub::isOverdue() const
+{
+	auto askedAt = m_askedAt.load();
+	return askedAt && chrono::steady_clock::now().time_since_epoch() - chrono::steady_clock::duration(askedAt) > c_blocksFetchTime * 2;
+}
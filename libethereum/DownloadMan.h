@@ -21,13 +21,16 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <vector>
 #include <set>
 #include <libdevcore/Guards.h>
 #include <libdevcore/Worker.h>
-#include <libdevcore/RangeMask.h>
+#include <libdevcore/RangeBitmap.h>
 #include <libdevcore/FixedHash.h>
+#include "CommonNet.h"
 
 namespace dev
 {
@@ -37,6 +40,14 @@ namespace eth
 
 class DownloadMan;
 
+/// How fast a peer has been delivering the blocks asked of it, averaged over its recent fetches.
+struct DownloadStats
+{
+	double blocksPerSecond = 0;
+	double bytesPerSecond = 0;
+	double latency = 0;			///< Seconds from asking for a fetch to its being answered.
+};
+
 class DownloadSub
 {
 	friend class DownloadMan;
@@ -51,12 +62,25 @@ public:
 	/// Note that we've received a particular block. @returns true if we had asked for it but haven't received it yet.
 	bool noteBlock(h256 _hash);
 
+	/// Note that the last fetch was answered with @a _got of the blocks asked for, in @a _bytes, updating the peer's statistics.
+	void noteFetched(unsigned _got, size_t _bytes);
+
+	/// @returns the peer's measured throughput and latency; all 0 if it has yet to answer a fetch.
+	DownloadStats stats() const { Guard l(m_fetch); return m_stats; }
+
+	/// @returns how many blocks to ask the peer for next, so that it answers in about c_blocksFetchTime.
+	unsigned fetchSize() const;
+
+	/// @returns true if a fetch is outstanding and has taken twice c_blocksFetchTime, which fetches are sized to take.
+	/// Its blocks are then open to other peers, well before the peer would time out.
+	bool isOverdue() const;
+
 	/// Nothing doing here.
 	void doneFetch() { resetFetch(); }
 
 	bool askedContains(unsigned _i) const { Guard l(m_fetch); return m_asked.contains(_i); }
-	RangeMask<unsigned> const& asked() const { return m_asked; }
-	RangeMask<unsigned> const& attemped() const { return m_attempted; }
+	RangeBitmap<unsigned> asked() const { Guard l(m_fetch); return m_asked; }
+	RangeBitmap<unsigned> const& attemped() const { return m_attempted; }
 
 private:
 	void resetFetch()		// Called by DownloadMan when we need to reset the download.
@@ -66,6 +90,7 @@ private:
 		m_indices.clear();
 		m_asked.reset();
 		m_attempted.reset();
+		m_askedAt = 0;
 	}
 
 	DownloadMan* m_man = nullptr;
@@ -73,8 +98,13 @@ private:
 	mutable Mutex m_fetch;
 	h256Set m_remaining;
 	std::map<h256, unsigned> m_indices;
-	RangeMask<unsigned> m_asked;
-	RangeMask<unsigned> m_attempted;
+	RangeBitmap<unsigned> m_asked;
+	RangeBitmap<unsigned> m_attempted;
+
+	/// When the outstanding fetch was asked for, in steady_clock ticks; 0 if none is. Read by other subs without m_fetch.
+	std::atomic<std::chrono::steady_clock::rep> m_askedAt{0};
+	std::chrono::steady_clock::duration m_lastAsk{};	///< How long the last fetch answered in full took.
+	DownloadStats m_stats;
 };
 
 class DownloadMan
@@ -100,9 +130,13 @@ public:
 		m_chain.reserve(_chain.size());
 		for (auto i = _chain.rbegin(); i != _chain.rend(); ++i)
 			m_chain.push_back(*i);
-		m_blocksGot = RangeMask<unsigned>(0, m_chain.size());
+		m_blocksGot = RangeBitmap<unsigned>(0, m_chain.size());
+		m_first = (unsigned)-1;
 	}
 
+	/// Has the block @a _index of the chain fetched ahead of the rest, as the pivot of a fast sync is.
+	void fetchFirst(unsigned _index) { WriteGuard l(m_lock); m_first = _index; }
+
 	void reset()
 	{
 		{
@@ -115,17 +149,27 @@ public:
 		m_blocksGot.reset();
 	}
 
-	RangeMask<unsigned> taken(bool _desperate = false) const
+	/// @returns the lowest @a _n blocks neither got, nor in @a _also, nor asked of a sub that is not overdue (of any
+	/// if @a _desperate). Costs no more for a download that has become fragmented, and copies none of the masks.
+	RangeBitmap<unsigned> untaken(unsigned _n, RangeBitmap<unsigned> const& _also, bool _desperate = false) const
 	{
 		ReadGuard l(m_lock);
-		auto ret = m_blocksGot;
+		ReadGuard ls(x_subs);
+		std::vector<RangeBitmap<unsigned> const*> also{&_also};
 		if (!_desperate)
-		{
-			ReadGuard l(x_subs);
 			for (auto i: m_subs)
-				ret += i->m_asked;
-		}
-		return ret;
+				if (!i->isOverdue())
+					also.push_back(&i->m_asked);
+		auto taken = [&](unsigned _i)
+		{
+			for (auto m: also)
+				if (m->contains(_i))
+					return true;
+			return m_blocksGot.contains(_i);
+		};
+		if (m_first < m_chain.size() && _n && !taken(m_first))
+			return m_blocksGot.lowestClear(_n - 1, also) += m_first;
+		return m_blocksGot.lowestClear(_n, also);
 	}
 
 	bool isComplete() const
@@ -137,12 +181,13 @@ public:
 	h256s chain() const { ReadGuard l(m_lock); return m_chain; }
 	void foreachSub(std::function<void(DownloadSub const&)> const& _f) const { ReadGuard l(x_subs); for(auto i: m_subs) _f(*i); }
 	unsigned subCount() const { ReadGuard l(x_subs); return m_subs.size(); }
-	RangeMask<unsigned> blocksGot() const { ReadGuard l(m_lock); return m_blocksGot; }
+	RangeBitmap<unsigned> blocksGot() const { ReadGuard l(m_lock); return m_blocksGot; }
 
 private:
 	mutable SharedMutex m_lock;
 	h256s m_chain;
-	RangeMask<unsigned> m_blocksGot;
+	RangeBitmap<unsigned> m_blocksGot;
+	unsigned m_first = (unsigned)-1;	///< The index of the block to fetch ahead of the rest, if any.
 
 	mutable SharedMutex x_subs;
 	std::set<DownloadSub*> m_subs;
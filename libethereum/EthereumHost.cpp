@@ -38,23 +38,57 @@ using namespace dev;
 using namespace dev::eth;
 using namespace p2p;
 
-EthereumHost::EthereumHost(BlockChain const& _ch, TransactionQueue& _tq, BlockQueue& _bq, u256 _networkId):
+EthereumHost::EthereumHost(BlockChain& _ch, OverlayDB const& _stateDB, TransactionQueue& _tq, BlockQueue& _bq, u256 _networkId):
 	HostCapability<EthereumPeer>(),
 	Worker		("ethsync"),
 	m_chain		(_ch),
+	m_stateDB	(_stateDB),
 	m_tq		(_tq),
 	m_bq		(_bq),
-	m_networkId	(_networkId)
+	m_networkId	(_networkId),
+	m_state		(_stateDB)
 {
 	m_latestBlockSent = _ch.currentHash();
+
+	// A fast sync interrupted carries on where it was.
+	if (_ch.isAwaitingState())
+	{
+		m_state.setPivot(_ch.pivotHash());
+		if (_ch.isKnown(_ch.pivotHash()))
+			m_state.begin(_ch.info(_ch.pivotHash()).stateRoot);
+	}
 }
 
 EthereumHost::~EthereumHost()
 {
+	m_decoderWork.reset();
+	if (m_decoderThread.joinable())
+		m_decoderThread.join();
 	for (auto i: peerSessions())
 		i.first->cap<EthereumPeer>().get()->abortSync();
 }
 
+void EthereumHost::onStarting()
+{
+	m_decoder.reset();
+	m_decoderWork.reset(new boost::asio::io_service::work(m_decoder));
+	m_decoderThread = std::thread([=]()
+	{
+		setThreadName("ethdecode");
+		m_decoder.run();
+	});
+	startWorking();
+}
+
+void EthereumHost::onStopping()
+{
+	stopWorking();
+	// What the peers have already sent is still queued, and sessions are kept until it is.
+	m_decoderWork.reset();
+	if (m_decoderThread.joinable())
+		m_decoderThread.join();
+}
+
 bool EthereumHost::ensureInitialised()
 {
 	if (!m_latestBlockSent)
@@ -94,20 +128,18 @@ void EthereumHost::changeSyncer(EthereumPeer* _syncer)
 	m_syncer = _syncer;
 	if (isSyncing())
 	{
+		// The fastest go first, so they take the lowest blocks, which import waits on.
 		if (_syncer->m_asking == Asking::Blocks)
-			for (auto j: peerSessions())
-			{
-				auto e = j.first->cap<EthereumPeer>().get();
-				if (e != _syncer && e->m_asking == Asking::Nothing)
+			for (auto const& e: peersByThroughput())
+				if (e.get() != _syncer && e->m_asking == Asking::Nothing)
 					e->transition(Asking::Blocks);
-			}
 	}
 	else
 	{
-		// start grabbing next hash chain if there is one.
-		for (auto j: peerSessions())
+		// start grabbing next hash chain if there is one, from the fastest peer that can give it.
+		for (auto const& e: peersByThroughput())
 		{
-			j.first->cap<EthereumPeer>()->attemptSync();
+			e->attemptSync();
 			if (isSyncing())
 				return;
 		}
@@ -115,6 +147,24 @@ void EthereumHost::changeSyncer(EthereumPeer* _syncer)
 	}
 }
 
+void EthereumHost::notePivotChain(h256s const& _chain)
+{
+	// Only a chain of nothing but the genesis block is fast synced, and only once. Our chain is at its genesis, so
+	// _chain[i] is of number _chain.size() - i.
+	if (m_fastSync && !m_chain.pivot() && !m_chain.number() && _chain.size() > c_pivotDistance * 2)
+	{
+		m_chain.setPivot(_chain.size() - c_pivotDistance, _chain[c_pivotDistance]);
+		m_state.setPivot(_chain[c_pivotDistance]);
+	}
+	if (m_chain.isAwaitingState())
+	{
+		// Its header gives the root of the state to download, so it is fetched before the blocks up to it are.
+		auto it = find(_chain.begin(), _chain.end(), m_chain.pivotHash());
+		if (it != _chain.end())
+			m_man.fetchFirst(_chain.end() - it - 1);
+	}
+}
+
 void EthereumHost::noteDoneBlocks(EthereumPeer* _who, bool _clemency)
 {
 	if (m_man.isComplete())
@@ -171,9 +221,18 @@ void EthereumHost::doWork()
 		}
 	}
 
+	bool stateWanted = m_state.isActive();
 	for (auto p: peerSessions())
 		if (shared_ptr<EthereumPeer> const& ep = p.first->cap<EthereumPeer>())
+		{
 			ep->tick();
+			if (stateWanted)
+			{
+				Guard l(ep->interpretLock());
+				if (ep->isEnabled())
+					ep->askNodes();
+			}
+		}
 
 //	return netChange;
 	// TODO: Figure out what to do with netChange.
@@ -182,14 +241,25 @@ void EthereumHost::doWork()
 
 void EthereumHost::maintainTransactions()
 {
-	// Send any new transactions.
+	// Send any new transactions: in full to a random few of the peers without them, and, batched into one packet
+	// each, just their hashes to the other peers without them that take announcements.
 	map<std::shared_ptr<EthereumPeer>, h256s> peerTransactions;
+	map<std::shared_ptr<EthereumPeer>, h256s> peerAnnouncements;
 	auto ts = m_tq.transactions();
 	for (auto const& i: ts)
 	{
 		bool unsent = !m_transactionsSent.count(i.first);
-		for (auto const& p: randomSelection(25, [&](EthereumPeer* p) { return p->m_requireTransactions || (unsent && !p->m_knownTransactions.count(i.first)); }))
+		set<EthereumPeer*> full;
+		for (auto const& p: randomSelection(25, [&](EthereumPeer* p) { return p->m_requireTransactions || (unsent && !p->isTransactionKnown(i.first)); }))
+		{
 			peerTransactions[p].push_back(i.first);
+			full.insert(p.get());
+		}
+		if (unsent)
+			for (auto const& j: peerSessions())
+				if (auto p = j.first->cap<EthereumPeer>())
+					if (p->m_announceTransactions && !full.count(p.get()) && !p->isTransactionKnown(i.first))
+						peerAnnouncements[p].push_back(i.first);
 	}
 	for (auto const& t: ts)
 		m_transactionsSent.insert(t.first);
@@ -200,13 +270,11 @@ void EthereumHost::maintainTransactions()
 			unsigned n = 0;
 			for (auto const& h: peerTransactions[ep])
 			{
-				ep->m_knownTransactions.insert(h);
+				ep->noteTransactionKnown(h);
 				b += ts[h].rlp();
 				++n;
 			}
 
-			ep->clearKnownTransactions();
-
 			if (n || ep->m_requireTransactions)
 			{
 				RLPStream ts;
@@ -214,9 +282,54 @@ void EthereumHost::maintainTransactions()
 				ep->sealAndSend(ts);
 			}
 			ep->m_requireTransactions = false;
+
+			auto const& hs = peerAnnouncements[ep];
+			if (hs.size())
+			{
+				RLPStream s;
+				ep->prep(s, TransactionsPacket, hs.size());
+				for (auto const& h: hs)
+				{
+					ep->noteTransactionKnown(h);
+					s << h;
+				}
+				ep->sealAndSend(s);
+			}
 		}
 }
 
+bool EthereumHost::noteRequested(h256 const& _h)
+{
+	Guard l(x_requested);
+	auto now = chrono::steady_clock::now();
+	auto it = m_requested.find(_h);
+	if (it != m_requested.end() && now - it->second < c_transactionRequestTimeout)
+		return false;
+	m_requested[_h] = now;
+	if (m_requested.size() > c_maxHashes * 16)
+	{
+		for (auto i = m_requested.begin(); i != m_requested.end();)
+			if (now - i->second >= c_transactionRequestTimeout)
+				i = m_requested.erase(i);
+			else
+				++i;
+	}
+	return true;
+}
+
+std::vector<std::shared_ptr<EthereumPeer>> EthereumHost::peersByThroughput() const
+{
+	std::vector<std::pair<double, std::shared_ptr<EthereumPeer>>> rated;
+	for (auto const& j: peerSessions())
+		if (auto pp = j.first->cap<EthereumPeer>())
+			rated.push_back(make_pair(pp->m_sub.stats().bytesPerSecond, pp));
+	stable_sort(rated.begin(), rated.end(), [](std::pair<double, std::shared_ptr<EthereumPeer>> const& _a, std::pair<double, std::shared_ptr<EthereumPeer>> const& _b) { return _a.first > _b.first; });
+	std::vector<std::shared_ptr<EthereumPeer>> ret;
+	for (auto const& r: rated)
+		ret.push_back(r.second);
+	return ret;
+}
+
 std::vector<std::shared_ptr<EthereumPeer>> EthereumHost::randomSelection(unsigned _percent, std::function<bool(EthereumPeer*)> const& _allow)
 {
 	std::vector<std::shared_ptr<EthereumPeer>> candidates;
@@ -245,13 +358,41 @@ void EthereumHost::maintainBlocks(h256 _currentHash)
 	{
 		clog(NetMessageSummary) << "Sending a new block (current is" << _currentHash << ", was" << m_latestBlockSent << ")";
 
-		for (auto const& p: randomSelection(25, [&](EthereumPeer* p){return !p->m_knownBlocks.count(_currentHash); }))
+		// In full to about the square root of the peers without it, the quickest to answer and furthest along first, as
+		// likeliest to pass it on soonest; as just its hash to the rest that take announcements, which ask for it should
+		// they not have it by then. The block is serialised once for all of them.
+		vector<shared_ptr<EthereumPeer>> peers;
+		for (auto const& j: peerSessions())
+			if (auto p = j.first->cap<EthereumPeer>())
+			{
+				Guard l(p->x_knownBlocks);
+				if (!p->m_knownBlocks.count(_currentHash))
+					peers.push_back(p);
+			}
+		sort(peers.begin(), peers.end(), [](shared_ptr<EthereumPeer> const& _a, shared_ptr<EthereumPeer> const& _b)
+		{
+			auto a = _a->session()->info().lastPing;
+			auto b = _b->session()->info().lastPing;
+			return a < b || (a == b && _a->m_totalDifficulty > _b->m_totalDifficulty);
+		});
+
+		u256 td = m_chain.details().totalDifficulty;
+		RLPStream block;
+		block.appendRaw(m_chain.block(), 1).append(td);
+		unsigned fullCount = (unsigned)ceil(sqrt((double)peers.size()));
+		for (unsigned i = 0; i < peers.size(); ++i)
 		{
+			auto const& p = peers[i];
 			RLPStream ts;
-			p->prep(ts, NewBlockPacket, 2).appendRaw(m_chain.block(), 1).append(m_chain.details().totalDifficulty);
+			if (i < fullCount)
+				p->prep(ts, NewBlockPacket, 2).appendRaw(block.out(), 2);
+			else if (p->m_announceBlocks)
+				p->prep(ts, NewBlockPacket, 2) << _currentHash << td;
+			else
+				continue;
 
 			Guard l(p->x_knownBlocks);
-			p->sealAndSend(ts);
+			p->sealAndSend(ts, Lane::Urgent);
 			p->m_knownBlocks.clear();
 		}
 		m_latestBlockSent = _currentHash;
@@ -37,6 +37,7 @@
 #include "CommonNet.h"
 #include "EthereumPeer.h"
 #include "DownloadMan.h"
+#include "StateDownload.h"
 
 namespace dev
 {
@@ -59,8 +60,8 @@ class EthereumHost: public p2p::HostCapability<EthereumPeer>, Worker
 	friend class EthereumPeer;
 
 public:
-	/// Start server, but don't listen.
-	EthereumHost(BlockChain const& _ch, TransactionQueue& _tq, BlockQueue& _bq, u256 _networkId);
+	/// Start server, but don't listen. State nodes are served from, and fast syncs written to, @a _stateDB.
+	EthereumHost(BlockChain& _ch, OverlayDB const& _stateDB, TransactionQueue& _tq, BlockQueue& _bq, u256 _networkId);
 
 	/// Will block on network process events.
 	virtual ~EthereumHost();
@@ -74,6 +75,11 @@ public:
 	DownloadMan const& downloadMan() const { return m_man; }
 	bool isSyncing() const { return !!m_syncer; }
 
+	/// Has a chain of only the genesis block synced by downloading the state of a recent block, rather than executing
+	/// every block up to it.
+	void setFastSync(bool _fast) { m_fastSync = _fast; }
+	StateDownload const& stateDownload() const { return m_state; }
+
 	bool isBanned(p2p::NodeId _id) const { return !!m_banned.count(_id); }
 
 	void noteNewTransactions() { m_newTransactions = true; }
@@ -82,9 +88,24 @@ public:
 private:
 	std::vector<std::shared_ptr<EthereumPeer>> randomSelection(unsigned _percent = 25, std::function<bool(EthereumPeer*)> const& _allow = [](EthereumPeer const*){ return true; });
 
+	/// Runs @a _f on our decoding thread, after those posted before it. Hashing, checking and queueing the blocks and
+	/// transactions that peers send is done there, so that the network's threads are not held up by it.
+	void decode(std::function<void()> const& _f) { m_decoder.post(_f); }
+
+	/// Notes that we are about to ask a peer for the announced transaction or block @a _h.
+	/// @returns false if we already asked one within c_transactionRequestTimeout, so should not ask again yet.
+	bool noteRequested(h256 const& _h);
+
+	/// @returns our peers, those that have delivered blocks fastest first; those yet to deliver any go last.
+	std::vector<std::shared_ptr<EthereumPeer>> peersByThroughput() const;
+
 	/// Session is tell us that we may need (re-)syncing with the peer.
 	void noteNeedsSyncing(EthereumPeer* _who);
 
+	/// Picks the pivot of a fast sync among the blocks @a _chain about to be downloaded, newest first, should it be
+	/// time for one, and has it downloaded first.
+	void notePivotChain(h256s const& _chain);
+
 	/// Called when the peer can no longer provide us with any needed blocks.
 	void noteDoneBlocks(EthereumPeer* _who, bool _clemency);
 
@@ -105,12 +126,13 @@ private:
 	/// Initialises the network peer-state, doing the stuff that needs to be once-only. @returns true if it really was first.
 	bool ensureInitialised();
 
-	virtual void onStarting() { startWorking(); }
-	virtual void onStopping() { stopWorking(); }
+	virtual void onStarting();
+	virtual void onStopping();
 
 	void changeSyncer(EthereumPeer* _ignore);
 
-	BlockChain const& m_chain;
+	BlockChain& m_chain;
+	OverlayDB m_stateDB;					///< Where the state nodes that peers ask for are found.
 	TransactionQueue& m_tq;					///< Maintains a list of incoming transactions not yet in a block on the blockchain.
 	BlockQueue& m_bq;						///< Maintains a list of incoming blocks not yet on the blockchain (to be imported).
 
@@ -120,13 +142,23 @@ private:
 
 	DownloadMan m_man;
 
+	bool m_fastSync = false;
+	StateDownload m_state;
+
 	h256 m_latestBlockSent;
 	h256Set m_transactionsSent;
 
+	Mutex x_requested;
+	std::map<h256, std::chrono::steady_clock::time_point> m_requested;	///< Announced transactions and blocks we asked for, and when.
+
 	std::set<p2p::NodeId> m_banned;
 
 	bool m_newTransactions = false;
 	bool m_newBlocks = false;
+
+	boost::asio::io_service m_decoder;							///< Runs the work decode() is given.
+	std::unique_ptr<boost::asio::io_service::work> m_decoderWork;
+	std::thread m_decoderThread;
 };
 
 }
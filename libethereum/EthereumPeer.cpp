@@ -50,6 +50,7 @@ EthereumPeer::~EthereumPeer()
 {
 	clogS(NetMessageSummary) << "Aborting Sync :-(";
 	abortSync();
+	giveBackNodes();
 }
 
 void EthereumPeer::abortSync()
@@ -93,12 +94,13 @@ void EthereumPeer::transition(Asking _a, bool _force)
 		if (m_asking == Asking::Nothing)
 		{
 			setAsking(Asking::State, false);
-			prep(s, StatusPacket, 5)
+			prep(s, StatusPacket, 6)
 							<< host()->protocolVersion()
 							<< host()->networkId()
 							<< host()->m_chain.details().totalDifficulty
 							<< host()->m_chain.currentHash()
-							<< host()->m_chain.genesisHash();
+							<< host()->m_chain.genesisHash()
+							<< c_relayVersion;
 			sealAndSend(s);
 			return;
 		}
@@ -142,6 +144,7 @@ void EthereumPeer::transition(Asking _a, bool _force)
 				clog(NetNote) << "Difficulty of hashchain HIGHER. Grabbing" << m_syncingNeededBlocks.size() << "blocks [latest now" << m_syncingLatestHash.abridged() << ", was" << host()->m_latestBlockSent.abridged() << "]";
 
 				host()->m_man.resetToChain(m_syncingNeededBlocks);
+				host()->notePivotChain(m_syncingNeededBlocks);
 				host()->m_latestBlockSent = m_syncingLatestHash;
 			}
 			else
@@ -157,7 +160,8 @@ void EthereumPeer::transition(Asking _a, bool _force)
 		{
 			// Looks like it's the best yet for total difficulty. Set to download.
 			setAsking(Asking::Blocks, isSyncing());		// will kick off other peers to help if available.
-			auto blocks = m_sub.nextFetch(c_maxBlocksAsk);
+			// Faster peers are asked for more at once, so each takes about as long to answer.
+			auto blocks = m_sub.nextFetch(m_sub.fetchSize());
 			if (blocks.size())
 			{
 				prep(s, GetBlocksPacket, blocks.size());
@@ -244,6 +248,35 @@ void EthereumPeer::tick()
 		session()->disconnect(PingTimeout);
 }
 
+void EthereumPeer::askNodes()
+{
+	auto now = chrono::steady_clock::now();
+	if (!m_askedNodes.empty() && now - m_nodesAskedAt > chrono::seconds(10))
+	{
+		// Another peer may have them; this one is given a rest.
+		giveBackNodes();
+		m_noNodesUntil = now + chrono::seconds(30);
+	}
+	if (!m_askedNodes.empty() || now < m_noNodesUntil)
+		return;
+	m_askedNodes = host()->m_state.nextFetch(c_maxNodesAsk);
+	if (m_askedNodes.empty())
+		return;
+	m_nodesAskedAt = now;
+	RLPStream s;
+	prep(s, GetNodeDataPacket, m_askedNodes.size());
+	for (auto const& h: m_askedNodes)
+		s << h;
+	sealAndSend(s);
+}
+
+void EthereumPeer::giveBackNodes()
+{
+	if (!m_askedNodes.empty())
+		host()->m_state.giveBack(m_askedNodes);
+	m_askedNodes.clear();
+}
+
 bool EthereumPeer::isSyncing() const
 {
 	return host()->m_syncer == this;
@@ -314,6 +347,9 @@ bool EthereumPeer::interpret(unsigned _id, RLP const& _r)
 		m_totalDifficulty = _r[2].toInt<u256>();
 		m_latestHash = _r[3].toHash<h256>();
 		auto genesisHash = _r[4].toHash<h256>();
+		// Older peers send no relay version, and ignore ours.
+		m_announceTransactions = _r.itemCount() > 5 && _r[5].toInt<unsigned>() >= 1;
+		m_announceBlocks = _r.itemCount() > 5 && _r[5].toInt<unsigned>() >= 2;
 
 		clogS(NetMessageSummary) << "Status:" << m_protocolVersion << "/" << m_networkId << "/" << genesisHash.abridged() << ", TD:" << m_totalDifficulty << "=" << m_latestHash.abridged();
 
@@ -331,32 +367,55 @@ bool EthereumPeer::interpret(unsigned _id, RLP const& _r)
 			transition(Asking::Nothing);
 		break;
 	}
-	case GetTransactionsPacket: break;	// DEPRECATED.
+	case GetTransactionsPacket:
+	{
+		// Without a relay version, this is the deprecated ask for all pending transactions.
+		if (!m_announceTransactions)
+			break;
+		clogS(NetAllDetail) << "GetTransactions (" << dec << _r.itemCount() << "entries)";
+		bytes rlp;
+		unsigned n = 0;
+		for (unsigned i = 0; i < _r.itemCount() && i < c_maxHashes; ++i)
+			if (auto t = host()->m_tq.transaction(_r[i].toHash<h256>()))
+			{
+				rlp += t.rlp();
+				++n;
+			}
+		RLPStream s;
+		prep(s, TransactionsPacket, n).appendRaw(rlp, n);
+		sealAndSend(s);
+		break;
+	}
 	case TransactionsPacket:
 	{
-		clogS(NetAllDetail) << "Transactions (" << dec << _r.itemCount() << "entries)";
-		Guard l(x_knownTransactions);
-		for (unsigned i = 0; i < _r.itemCount(); ++i)
+		if (m_announceTransactions && _r.itemCount() && _r[0].isData())
 		{
-			auto h = sha3(_r[i].data());
-			m_knownTransactions.insert(h);
-			ImportResult ir = host()->m_tq.import(_r[i].data());
-			switch (ir)
+			// An announcement: ask for those we have neither got nor asked another peer for lately.
+			clogS(NetAllDetail) << "Transaction hashes (" << dec << _r.itemCount() << "entries)";
+			h256s wanted;
+			for (auto const& i: _r)
+			{
+				auto h = i.toHash<h256>();
+				noteTransactionKnown(h);
+				if (!host()->m_tq.contains(h) && host()->noteRequested(h))
+					wanted.push_back(h);
+			}
+			if (wanted.size())
 			{
-			case ImportResult::Malformed:
-				addRating(-100);
-				break;
-			case ImportResult::AlreadyKnown:
-				// if we already had the transaction, then don't bother sending it on.
-				host()->m_transactionsSent.insert(h);
-				addRating(0);
-				break;
-			case ImportResult::Success:
-				addRating(100);
-				break;
-			default:;
+				RLPStream s;
+				prep(s, GetTransactionsPacket, wanted.size());
+				for (auto const& h: wanted)
+					s << h;
+				sealAndSend(s);
 			}
+			addRating(0);
+			break;
 		}
+
+		clogS(NetAllDetail) << "Transactions (" << dec << _r.itemCount() << "entries)";
+		// Copied out of the session's buffer, which goes back to the pool once we return.
+		auto packet = make_shared<bytes>(_r.data().toBytes());
+		decodeLater([=]() { importTransactions(*packet); });
 		break;
 	}
 	case GetBlockHashesPacket:
@@ -424,59 +483,167 @@ bool EthereumPeer::interpret(unsigned _id, RLP const& _r)
 		addRating(0);
 		RLPStream s;
 		prep(s, BlocksPacket, n).appendRaw(rlp, n);
+		// A lone block asked for is likely one we announced, so goes ahead of any sync the peer is doing from us.
+		sealAndSend(s, _r.itemCount() == 1 ? Lane::Urgent : Lane::Normal);
+		break;
+	}
+	case GetNodeDataPacket:
+	{
+		clogS(NetMessageSummary) << "GetNodeData (" << dec << _r.itemCount() << "entries)";
+		// Those we have not, as when pruned, are left out; the peer tells which it got by their hashes.
+		unsigned n = 0;
+		RLPStream nodes;
+		for (unsigned i = 0; i < _r.itemCount() && i < c_maxNodes; ++i)
+		{
+			string node = host()->m_stateDB.lookup(_r[i].toHash<h256>());
+			if (!node.empty())
+			{
+				nodes << node;
+				++n;
+			}
+		}
+		addRating(0);
+		RLPStream s;
+		prep(s, NodeDataPacket, n).appendRaw(nodes.out(), n);
 		sealAndSend(s);
 		break;
 	}
+	case NodeDataPacket:
+	{
+		clogS(NetMessageSummary) << "NodeData (" << dec << _r.itemCount() << "entries)";
+		if (m_askedNodes.empty())
+		{
+			clogS(NetWarn) << "Peer giving us state nodes when we didn't ask for them.";
+			break;
+		}
+		// Copied out of the session's buffer, which goes back to the pool once we return.
+		auto packet = make_shared<bytes>(_r.data().toBytes());
+		decodeLater([=]() { importNodes(*packet); });
+		break;
+	}
 	case BlocksPacket:
 	{
 		clogS(NetMessageSummary) << "Blocks (" << dec << _r.itemCount() << "entries)" << (_r.itemCount() ? "" : ": NoMoreBlocks");
+		// Each block is copied once out of the session's buffer, which goes back to the pool once we return, into a
+		// buffer of its own that the queue and the chain then share. The rest is done on the decoding thread.
+		vector<SharedBlock> blocks;
+		blocks.reserve(_r.itemCount());
+		for (auto const& b: _r)
+			blocks.push_back(make_shared<bytes const>(b.data().toBytes()));
+		decodeLater([=]() { importBlocks(blocks); });
+		break;
+	}
+	case NewBlockPacket:
+	{
+		if (_r.itemCount() != 2)
+			disable("NewBlock without 2 data fields.");
+		else if (_r[0].isData())
+		{
+			// An announcement: ask for it unless we have it, or have asked another peer for it lately. While syncing from
+			// the peer, we leave it be, as its Blocks would answer both.
+			auto h = _r[0].toHash<h256>();
+			clogS(NetMessageSummary) << "NewBlock hash: " << h.abridged();
+			{
+				Guard l(x_knownBlocks);
+				m_knownBlocks.insert(h);
+			}
+			if (m_asking == Asking::Nothing && !host()->m_chain.isKnown(h) && host()->noteRequested(h))
+			{
+				m_announcedAsked[h] = _r[1].toInt<u256>();
+				RLPStream s;
+				prep(s, GetBlocksPacket, 1) << h;
+				sealAndSend(s, Lane::Urgent);
+			}
+			addRating(0);
+		}
+		else
+		{
+			auto block = make_shared<bytes const>(_r[0].data().toBytes());
+			u256 td = _r[1].toInt<u256>();
+			decodeLater([=]() { importNewBlock(block, td); });
+		}
+		break;
+	}
+	default:
+		return false;
+	}
+	}
+	catch (Exception const& _e)
+	{
+		clogS(NetWarn) << "Peer causing an Exception:" << _e.what() << _r;
+	}
+	catch (std::exception const& _e)
+	{
+		clogS(NetWarn) << "Peer causing an exception:" << _e.what() << _r;
+	}
 
-		if (m_asking != Asking::Blocks)
+	return true;
+}
+
+void EthereumPeer::decodeLater(function<void()> const& _f)
+{
+	auto s = session()->shared_from_this();
+	host()->decode([=]()
+	{
+		if (!s->isConnected())
+			return;
+		try
+		{
+			_f();
+		}
+		catch (std::exception const& _e)
+		{
+			clogS(NetWarn) << "Peer causing an exception:" << _e.what();
+		}
+	});
+}
+
+void EthereumPeer::importBlocks(vector<SharedBlock> const& _blocks)
+{
+	// Hashed and queued without the lock; the peer's state is only touched under it, before and after.
+	h256s hashes;
+	for (auto const& b: _blocks)
+	{
+		hashes.push_back(BlockInfo::headerHash(*b));
+		// The pivot of a fast sync gives the root of the state to download.
+		host()->m_state.noteBlock(hashes.back(), bytesConstRef(b.get()));
+	}
+
+	unsigned repeated = 0;
+	vector<pair<unsigned, u256>> wanted;	// The index of each block to queue, with its total difficulty if announced.
+	{
+		Guard l(interpretLock());
+		if (!isEnabled())
+			return;
+
+		// Either the blocks of a sync, or those announced that we asked for.
+		bool announced = m_asking != Asking::Blocks && !m_announcedAsked.empty();
+		if (m_asking != Asking::Blocks && !announced)
 			clogS(NetWarn) << "Unexpected Blocks received!";
 
-		if (_r.itemCount() == 0)
+		if (_blocks.empty())
 		{
 			// Got to this peer's latest block - just give up.
-			transition(Asking::Nothing);
-			break;
+			if (announced)
+				m_announcedAsked.clear();
+			else
+				transition(Asking::Nothing);
+			return;
 		}
 
-		unsigned success = 0;
-		unsigned future = 0;
-		unsigned unknown = 0;
-		unsigned got = 0;
-		unsigned repeated = 0;
-
-		for (unsigned i = 0; i < _r.itemCount(); ++i)
+		for (unsigned i = 0; i < _blocks.size(); ++i)
 		{
-			auto h = BlockInfo::headerHash(_r[i].data());
-			if (m_sub.noteBlock(h))
+			u256 announcedDifficulty;
+			auto a = m_announcedAsked.find(hashes[i]);
+			if (a != m_announcedAsked.end())
+			{
+				announcedDifficulty = a->second;
+				m_announcedAsked.erase(a);
+			}
+			if (announcedDifficulty || m_sub.noteBlock(hashes[i]))
 			{
 				addRating(10);
-				switch (host()->m_bq.import(_r[i].data(), host()->m_chain))
-				{
-				case ImportResult::Success:
-					success++;
-					break;
-
-				case ImportResult::Malformed:
-				case ImportResult::BadChain:
-					disable("Malformed block received.");
-					return true;
-
-				case ImportResult::FutureTime:
-					future++;
-					break;
-
-				case ImportResult::AlreadyInChain:
-				case ImportResult::AlreadyKnown:
-					got++;
-					break;
-
-				case ImportResult::UnknownParent:
-					unknown++;
-					break;
-				}
+				wanted.push_back(make_pair(i, announcedDifficulty));
 			}
 			else
 			{
@@ -484,68 +651,154 @@ bool EthereumPeer::interpret(unsigned _id, RLP const& _r)
 				repeated++;
 			}
 		}
+	}
 
-		clogS(NetMessageSummary) << dec << success << "imported OK," << unknown << "with unknown parents," << future << "with future timestamps," << got << " already known," << repeated << " repeats received.";
+	vector<ImportResult> results;
+	for (auto const& w: wanted)
+	{
+		results.push_back(host()->m_bq.import(_blocks[w.first], host()->m_chain));
+		if (results.back() == ImportResult::Malformed || results.back() == ImportResult::BadChain)
+			break;
+	}
 
-		if (m_asking == Asking::Blocks)
+	Guard l(interpretLock());
+	if (!isEnabled())
+		return;
+
+	unsigned success = 0;
+	unsigned future = 0;
+	unsigned unknown = 0;
+	unsigned got = 0;
+	for (unsigned i = 0; i < results.size(); ++i)
+		switch (results[i])
 		{
-			if (!got)
-				transition(Asking::Blocks);
-			else
-				transition(Asking::Nothing);
+		case ImportResult::Success:
+			success++;
+			break;
+
+		case ImportResult::Malformed:
+		case ImportResult::BadChain:
+			disable("Malformed block received.");
+			return;
+
+		case ImportResult::FutureTime:
+			future++;
+			break;
+
+		case ImportResult::AlreadyInChain:
+		case ImportResult::AlreadyKnown:
+			got++;
+			break;
+
+		case ImportResult::UnknownParent:
+			unknown++;
+			if (wanted[i].second)
+				setNeedsSyncing(hashes[wanted[i].first], wanted[i].second);
+			break;
 		}
-		break;
-	}
-	case NewBlockPacket:
-	{
-		auto h = BlockInfo::headerHash(_r[0].data());
-		clogS(NetMessageSummary) << "NewBlock: " << h.abridged();
 
-		if (_r.itemCount() != 2)
-			disable("NewBlock without 2 data fields.");
+	clogS(NetMessageSummary) << dec << success << "imported OK," << unknown << "with unknown parents," << future << "with future timestamps," << got << " already known," << repeated << " repeats received.";
+
+	if (m_asking == Asking::Blocks)
+	{
+		size_t size = 0;
+		for (auto const& b: _blocks)
+			size += b->size();
+		m_sub.noteFetched(_blocks.size() - repeated, size);
+		auto st = m_sub.stats();
+		session()->addNote("rate", toString((unsigned)st.blocksPerSecond) + " blocks/s " + toString((unsigned)(st.bytesPerSecond / 1024)) + " KB/s " + toString((unsigned)(st.latency * 1000)) + " ms");
+
+		if (!got)
+			transition(Asking::Blocks);
 		else
-		{
-			switch (host()->m_bq.import(_r[0].data(), host()->m_chain))
-			{
-			case ImportResult::Success:
-				addRating(100);
-				break;
-			case ImportResult::FutureTime:
-				//TODO: Rating dependent on how far in future it is.
-				break;
-
-			case ImportResult::Malformed:
-			case ImportResult::BadChain:
-				disable("Malformed block received.");
-				return true;
+			transition(Asking::Nothing);
+	}
+}
 
-			case ImportResult::AlreadyInChain:
-			case ImportResult::AlreadyKnown:
-				break;
+void EthereumPeer::importNewBlock(SharedBlock const& _block, u256 const& _td)
+{
+	auto h = BlockInfo::headerHash(*_block);
+	clogS(NetMessageSummary) << "NewBlock: " << h.abridged();
+	auto result = host()->m_bq.import(_block, host()->m_chain);
 
-			case ImportResult::UnknownParent:
-				clogS(NetMessageSummary) << "Received block with no known parent. Resyncing...";
-				setNeedsSyncing(h, _r[1].toInt<u256>());
-				break;
-			}
+	Guard l(interpretLock());
+	if (!isEnabled())
+		return;
+	switch (result)
+	{
+	case ImportResult::Success:
+		addRating(100);
+		break;
+	case ImportResult::FutureTime:
+		//TODO: Rating dependent on how far in future it is.
+		break;
 
-			Guard l(x_knownBlocks);
-			m_knownBlocks.insert(h);
-		}
+	case ImportResult::Malformed:
+	case ImportResult::BadChain:
+		disable("Malformed block received.");
+		return;
+
+	case ImportResult::AlreadyInChain:
+	case ImportResult::AlreadyKnown:
+		break;
+
+	case ImportResult::UnknownParent:
+		clogS(NetMessageSummary) << "Received block with no known parent. Resyncing...";
+		setNeedsSyncing(h, _td);
 		break;
 	}
-	default:
-		return false;
-	}
-	}
-	catch (Exception const& _e)
+
+	Guard kl(x_knownBlocks);
+	m_knownBlocks.insert(h);
+}
+
+void EthereumPeer::importTransactions(bytes const& _packet)
+{
+	RLP r(_packet);
+	vector<ImportResult> results = host()->m_tq.importBatch(r);
+
+	Guard l(interpretLock());
+	Guard kl(x_knownTransactions);
+	for (unsigned i = 0; i < r.itemCount(); ++i)
 	{
-		clogS(NetWarn) << "Peer causing an Exception:" << _e.what() << _r;
+		auto h = sha3(r[i].data());
+		m_knownTransactions.insert(h);
+		switch (results[i])
+		{
+		case ImportResult::Malformed:
+			addRating(-100);
+			break;
+		case ImportResult::AlreadyKnown:
+			// if we already had the transaction, then don't bother sending it on.
+			host()->m_transactionsSent.insert(h);
+			addRating(0);
+			break;
+		case ImportResult::Success:
+			addRating(100);
+			break;
+		default:;
+		}
 	}
-	catch (std::exception const& _e)
+}
+
+void EthereumPeer::importNodes(bytes const& _packet)
+{
+	h256s asked;
 	{
-		clogS(NetWarn) << "Peer causing an exception:" << _e.what() << _r;
+		Guard l(interpretLock());
+		swap(asked, m_askedNodes);
 	}
+	unsigned got = host()->m_state.noteNodes(asked, RLP(_packet));
+	auto progress = host()->m_state.progress();
+	clogS(NetMessageSummary) << got << "of" << asked.size() << "state nodes asked for given;" << progress.first << "written," << progress.second << "to come.";
 
-	return true;
+	Guard l(interpretLock());
+	if (!isEnabled())
+		return;
+	addRating(got);
+	session()->addNote("state", toString(progress.first) + " nodes");
+	if (!got)
+		m_noNodesUntil = chrono::steady_clock::now() + chrono::seconds(30);
+	else if (host()->m_state.isActive())
+		askNodes();
 }
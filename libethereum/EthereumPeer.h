@@ -24,6 +24,7 @@
 #include <mutex>
 #include <array>
 #include <set>
+#include <map>
 #include <memory>
 #include <utility>
 
@@ -32,9 +33,11 @@
 
 #include <libdevcore/RLP.h>
 #include <libdevcore/Guards.h>
+#include <libdevcore/HashFilter.h>
 #include <libdevcore/RangeMask.h>
 #include <libethcore/Common.h>
 #include <libp2p/Capability.h>
+#include "BlockQueue.h"
 #include "CommonNet.h"
 #include "DownloadMan.h"
 
@@ -77,6 +80,24 @@ private:
 	/// Interpret an incoming message.
 	virtual bool interpret(unsigned _id, RLP const& _r);
 
+	/// Runs @a _f on the host's decoding thread, keeping the session, and so us, until it has; it is skipped should
+	/// the session have closed meanwhile.
+	void decodeLater(std::function<void()> const& _f);
+	/// On the decoding thread, queues the blocks @a _blocks of a Blocks packet, then carries on syncing.
+	void importBlocks(std::vector<SharedBlock> const& _blocks);
+	/// On the decoding thread, queues the block @a _block of a NewBlock packet, of total difficulty @a _td.
+	void importNewBlock(SharedBlock const& _block, u256 const& _td);
+	/// On the decoding thread, queues the transactions of the Transactions packet @a _packet.
+	void importTransactions(bytes const& _packet);
+	/// On the decoding thread, writes the state nodes of the NodeData packet @a _packet, then asks for more.
+	void importNodes(bytes const& _packet);
+
+	/// Asks the peer for state nodes of a fast sync, unless it has yet to give those last asked for or has lately had
+	/// none of them; those it has taken too long to give are given back. Called with interpretLock() held.
+	void askNodes();
+	/// Gives back to be asked of another peer the state nodes the peer has yet to give.
+	void giveBackNodes();
+
 	/// Transition state in a particular direction.
 	void transition(Asking _wantState, bool _force = false);
 
@@ -86,8 +107,9 @@ private:
 	/// Abort the sync operation.
 	void abortSync();
 
-	/// Clear all known transactions.
-	void clearKnownTransactions() { std::lock_guard<std::mutex> l(x_knownTransactions); m_knownTransactions.clear(); }
+	/// Whether the peer has, as far as we know, seen the transaction @a _h. May be wrong, rarely, in saying it has.
+	bool isTransactionKnown(h256 const& _h) const { Guard l(x_knownTransactions); return m_knownTransactions.contains(_h); }
+	void noteTransactionKnown(h256 const& _h) { Guard l(x_knownTransactions); m_knownTransactions.insert(_h); }
 
 	/// Update our asking state.
 	void setAsking(Asking _g, bool _isSyncing);
@@ -138,10 +160,23 @@ private:
 	/// Have we received a GetTransactions packet that we haven't yet answered?
 	bool m_requireTransactions = false;
 
+	/// Whether the peer's Status gave a relay version of 1 or more, so takes transactions announced by hash:
+	/// a Transactions packet of hashes alone, answered by a GetTransactions packet of the hashes it wants.
+	bool m_announceTransactions = false;
+
+	/// Whether the peer's Status gave a relay version of 2 or more, so takes new blocks announced by hash: a NewBlock
+	/// packet of the hash and total difficulty alone, answered by a GetBlocks packet should it want the block.
+	bool m_announceBlocks = false;
+	std::map<h256, u256> m_announcedAsked;	///< Announced blocks we have asked the peer for, with their total difficulty.
+
+	h256s m_askedNodes;						///< The state nodes we have asked the peer for, in the order we asked.
+	std::chrono::steady_clock::time_point m_nodesAskedAt;
+	std::chrono::steady_clock::time_point m_noNodesUntil;	///< Until when the peer is not asked for nodes, having had none.
+
 	Mutex x_knownBlocks;
 	h256Set m_knownBlocks;					///< Blocks that the peer already knows about (that don't need to be sent to them).
-	Mutex x_knownTransactions;
-	h256Set m_knownTransactions;			///< Transactions that the peer already knows of.
+	mutable Mutex x_knownTransactions;
+	HashFilter m_knownTransactions;			///< Transactions that the peer already knows of, as far as we recall.
 
 };
 
@@ -33,10 +33,23 @@ using namespace dev::eth;
 
 Executive::Executive(State& _s, BlockChain const& _bc, unsigned _level):
 	m_s(_s),
-	m_lastHashes(_bc.lastHashes((unsigned)_s.info().number - 1)),
+	m_ownLastHashes(_bc.lastHashes((unsigned)_s.info().number - 1)),
+	m_lastHashes(m_ownLastHashes),
 	m_depth(_level)
 {}
 
+Executive::~Executive()
+{
+	if (m_tracing)
+		m_s.m_trace = nullptr;
+}
+
+void Executive::traceAccesses()
+{
+	m_tracing = true;
+	m_s.m_trace = &m_accesses;
+}
+
 u256 Executive::gasUsed() const
 {
 	return m_t.gas() - m_endGas;
@@ -44,7 +57,9 @@ u256 Executive::gasUsed() const
 
 ExecutionResult Executive::executionResult() const
 {
-	return ExecutionResult(gasUsed(), m_excepted, m_newAddress, m_out, m_codeDeposit, m_ext ? m_ext->sub.refunds : 0, m_depositSize, m_gasForDeposit);
+	ExecutionResult ret(gasUsed(), m_excepted, m_newAddress, m_out, m_codeDeposit, m_ext ? m_ext->sub.refunds : 0, m_depositSize, m_gasForDeposit);
+	ret.accesses = m_accesses;
+	return ret;
 }
 
 void Executive::accrueSubState(SubState& _parentContext)
@@ -104,10 +119,30 @@ void Executive::initialize(Transaction const& _transaction)
 	}
 }
 
+bool Executive::isTransfer() const
+{
+	return !m_t.isCreation() && !PrecompiledRegistry::get().find(m_t.receiveAddress()) && !m_s.addressHasCode(m_t.receiveAddress());
+}
+
+bool Executive::transfer()
+{
+	// The gas used is known up front, so the sender pays for it and the value at once and is refunded nothing.
+	m_isTransfer = true;
+	m_endGas = m_t.gas() - (u256)m_t.gasRequired();
+	m_s.noteSending(m_t.sender());
+	m_s.subBalance(m_t.sender(), (bigint)m_t.value() + (bigint)(m_t.gas() - m_endGas) * m_t.gasPrice());
+	m_s.addBalance(m_t.receiveAddress(), m_t.value());
+	return true;
+}
+
 bool Executive::execute()
 {
 	// Entry point for a user-executed transaction.
 
+	// Most transactions just send value, which needs none of what follows.
+	if (isTransfer())
+		return transfer();
+
 	// Increment associated nonce for sender.
 	m_s.noteSending(m_t.sender());
 
@@ -125,10 +160,9 @@ bool Executive::call(Address _receiveAddress, Address _codeAddress, Address _sen
 {
 	m_isCreation = false;
 //	cnote << "Transferring" << formatBalance(_value) << "to receiver.";
-	auto it = !(_codeAddress & ~h160(0xffffffff)) ? precompiled().find((unsigned)(u160)_codeAddress) : precompiled().end();
-	if (it != precompiled().end())
+	if (auto p = PrecompiledRegistry::get().find(_codeAddress))
 	{
-		bigint g = it->second.gas(_data);
+		bigint g = p->gas(_data);
 		if (_gas < g)
 		{
 			m_endGas = 0;
@@ -139,15 +173,14 @@ bool Executive::call(Address _receiveAddress, Address _codeAddress, Address _sen
 		else
 		{
 			m_endGas = (u256)(_gas - g);
-			m_precompiledOut = it->second.exec(_data);
-			m_out = &m_precompiledOut;
+			p->exec(_data, m_precompiledOut);
+			m_out = m_precompiledOut.ref();
 		}
 	}
 	else if (m_s.addressHasCode(_codeAddress))
 	{
 		m_vm = VMFactory::create(_gas);
-		bytes const& c = m_s.code(_codeAddress);
-		m_ext = make_shared<ExtVM>(m_s, m_lastHashes, _receiveAddress, _senderAddress, _originAddress, _value, _gasPrice, _data, &c, m_depth);
+		m_ext = make_shared<ExtVM>(m_s, m_lastHashes, _receiveAddress, _senderAddress, _originAddress, _value, _gasPrice, _data, m_s.sharedCode(_codeAddress), m_s.codeHash(_codeAddress), m_depth);
 	}
 	else
 		m_endGas = _gas;
@@ -169,15 +202,15 @@ bool Executive::create(Address _sender, u256 _endowment, u256 _gasPrice, u256 _g
 	if (!_init.empty())
 	{
 		m_vm = VMFactory::create(_gas);
-		m_ext = make_shared<ExtVM>(m_s, m_lastHashes, m_newAddress, _sender, _origin, _endowment, _gasPrice, bytesConstRef(), _init, m_depth);
+		m_ext = make_shared<ExtVM>(m_s, m_lastHashes, m_newAddress, _sender, _origin, _endowment, _gasPrice, bytesConstRef(), make_shared<bytes const>(_init.toBytes()), h256(), m_depth);
 	}
 
-	m_s.m_cache[m_newAddress] = Account(m_s.balance(m_newAddress), Account::ContractConception);
+	m_s.setAccount(m_newAddress, Account(m_s.balance(m_newAddress), Account::ContractConception));
 	m_s.transferBalance(_sender, m_newAddress, _endowment);
 
 	if (_init.empty())
 	{
-		m_s.m_cache[m_newAddress].setCode({});
+		m_s.setCode(m_newAddress, {});
 		m_endGas = _gas;
 	}
 
@@ -231,7 +264,7 @@ bool Executive::go(OnOpFunc const& _onOp)
 					m_codeDeposit = CodeDeposit::Failed;
 					m_out.reset();
 				}
-				m_s.m_cache[m_newAddress].setCode(m_out.toBytes());
+				m_s.setCode(m_newAddress, m_out.toBytes());
 			}
 		}
 		catch (StepsDone const&)
@@ -274,15 +307,16 @@ void Executive::finalize()
 		m_endGas += min((m_t.gas() - m_endGas) / 2, m_ext->sub.refunds);
 
 	//	cnote << "Refunding" << formatBalance(m_endGas * m_ext->gasPrice) << "to origin (=" << m_endGas << "*" << formatBalance(m_ext->gasPrice) << ")";
-	m_s.addBalance(m_t.sender(), m_endGas * m_t.gasPrice());
+	if (!m_isTransfer)
+		m_s.addBalance(m_t.sender(), m_endGas * m_t.gasPrice());
 
 	u256 feesEarned = (m_t.gas() - m_endGas) * m_t.gasPrice();
-	m_s.addBalance(m_s.m_currentBlock.coinbaseAddress, feesEarned);
+	m_s.payFees(feesEarned);
 
 	// Suicides...
 	if (m_ext)
 		for (auto a: m_ext->sub.suicides)
-			m_s.m_cache[a].kill();
+			m_s.kill(a);
 
 	// Logs..
 	if (m_ext)
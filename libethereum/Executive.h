@@ -20,6 +20,7 @@
 
 #include <functional>
 #include <libdevcore/Log.h>
+#include <libdevcore/SmallVector.h>
 #include <libevmcore/Instruction.h>
 #include <libethcore/Common.h>
 #include <libevm/VMFace.h>
@@ -60,16 +61,23 @@ struct VMTraceChannel: public LogChannel { static const char* name() { return "E
 class Executive
 {
 public:
-	/// Basic constructor.
+	/// Basic constructor. @a _lh is kept by reference, so must outlive the executive.
 	Executive(State& _s, LastHashes const& _lh, unsigned _level = 0): m_s(_s), m_lastHashes(_lh), m_depth(_level) {}
+	Executive(State& _s, LastHashes&& _lh, unsigned _level = 0) = delete;
 	/// Basic constructor.
 	Executive(State& _s, BlockChain const& _bc, unsigned _level = 0);
 	/// Basic destructor.
-	~Executive() = default;
+	~Executive();
 
 	Executive(Executive const&) = delete;
 	void operator=(Executive) = delete;
 
+	/// Records every account, storage slot and code that this and its inner call frames read or write, into accesses().
+	/// Far cheaper than a trace of each operation. Call before initialize().
+	void traceAccesses();
+	/// @returns what was read and written since traceAccesses().
+	AccessSet const& accesses() const { return m_accesses; }
+
 	/// Initializes the executive for evaluating a transaction. You must call finalize() at some point following this.
 	void initialize(bytesConstRef _transaction) { initialize(Transaction(_transaction, CheckTransaction::None)); }
 	void initialize(Transaction const& _transaction);
@@ -118,16 +126,25 @@ public:
 	ExecutionResult executionResult() const;
 
 private:
+	/// @returns true if the transaction only moves value to an account with no code to run.
+	bool isTransfer() const;
+	/// Executes a transaction for which isTransfer() holds, straight onto the state.
+	bool transfer();
+
 	State& m_s;							///< The state to which this operation/transaction is applied.
-	LastHashes m_lastHashes;
+	LastHashes m_ownLastHashes;			///< The last hashes, if this executive got them from the block chain.
+	LastHashes const& m_lastHashes;		///< Shared by every call frame of a transaction, rather than copied into each.
 	std::shared_ptr<ExtVM> m_ext;		///< The VM externality object for the VM execution or null if no VM is required.
 	std::unique_ptr<VMFace> m_vm;		///< The VM object or null if no VM is required.
-	bytes m_precompiledOut;				///< Used for the output when there is no VM for a contract (i.e. precompiled).
+	SmallBytes m_precompiledOut;			///< Used for the output when there is no VM for a contract (i.e. precompiled).
 	bytesConstRef m_out;				///< The copyable output.
 	Address m_newAddress;				///< The address of the created contract in the case of create() being called.
 
 	unsigned m_depth = 0;				///< The context's call-depth.
 	bool m_isCreation = false;			///< True if the transaction creates a contract, or if create() is called.
+	bool m_isTransfer = false;			///< True if the transaction was executed by transfer().
+	bool m_tracing = false;				///< True if traceAccesses() was called; the state then notes into m_accesses.
+	AccessSet m_accesses;				///< What was read and written, if m_tracing.
 	unsigned m_depositSize = 0;			///< Amount of code of the creation's attempted deposit.
 	u256 m_gasForDeposit;				///< Amount of gas remaining for the code deposit phase.
 	CodeDeposit m_codeDeposit = CodeDeposit::None;	///< True if an attempted deposit failed due to lack of gas.
@@ -26,6 +26,13 @@ using namespace std;
 using namespace dev;
 using namespace dev::eth;
 
+ExtVM::~ExtVM()
+{
+	if (!m_loaded.empty())
+		StoragePrefetcher::get().noteLoads(codeHash, m_loaded);
+	m_s.releaseCheckpoint();
+}
+
 bool ExtVM::call(Address _receiveAddress, u256 _txValue, bytesConstRef _txData, u256& io_gas, bytesRef _out, OnOpFunc const& _onOp, Address _myAddressOverride, Address _codeAddressOverride)
 {
 	Executive e(m_s, lastHashes, depth + 1);
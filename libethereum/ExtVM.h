@@ -26,6 +26,7 @@
 #include <libethcore/Common.h>
 #include <libevm/ExtVMFace.h>
 #include "State.h"
+#include "StoragePrefetcher.h"
 
 namespace dev
 {
@@ -39,14 +40,24 @@ class ExtVM: public ExtVMFace
 {
 public:
 	/// Full constructor.
-	ExtVM(State& _s, LastHashes const& _lh, Address _myAddress, Address _caller, Address _origin, u256 _value, u256 _gasPrice, bytesConstRef _data, bytesConstRef _code, unsigned _depth = 0):
-		ExtVMFace(_myAddress, _caller, _origin, _value, _gasPrice, _data, _code.toBytes(), _s.m_previousBlock, _s.m_currentBlock, _lh, _depth), m_s(_s), m_origCache(_s.m_cache)
+	ExtVM(State& _s, LastHashes const& _lh, Address _myAddress, Address _caller, Address _origin, u256 _value, u256 _gasPrice, bytesConstRef _data, SharedCode const& _code, h256 const& _codeHash, unsigned _depth = 0):
+		ExtVMFace(_myAddress, _caller, _origin, _value, _gasPrice, _data, _code, _codeHash, _s.m_previousBlock, _s.m_currentBlock, _lh, _depth), m_s(_s), m_checkpoint(_s.checkpoint())
 	{
+		// Should this create the account, reverting must remove it.
+		m_s.journal(State::AccountChange::Created, _myAddress);
 		m_s.ensureCached(_myAddress, true, true);
 	}
+	ExtVM(ExtVM const&) = delete;
+	ExtVM& operator=(ExtVM const&) = delete;
+	~ExtVM();
 
 	/// Read storage location.
-	virtual u256 store(u256 _n) override final { return m_s.storage(myAddress, _n); }
+	virtual u256 store(u256 _n) override final
+	{
+		if (codeHash && m_loaded.size() < StoragePrefetcher::c_maxHistory)
+			m_loaded.push_back(_n);
+		return m_s.storage(myAddress, _n);
+	}
 
 	/// Write a value in storage.
 	virtual void setStore(u256 _n, u256 _v) override final { m_s.setStorage(myAddress, _n, _v); }
@@ -84,7 +95,7 @@ public:
 	/// @TODO check call site for the parent manifest being discarded.
 	virtual void revert() override final
 	{
-		m_s.m_cache = m_origCache;
+		m_s.revertToCheckpoint(m_checkpoint);
 		sub.clear();
 	}
 
@@ -92,7 +103,8 @@ public:
 
 private:
 	State& m_s;										///< A reference to the base state.
-	std::map<Address, Account> m_origCache;			///< The cache of the address states (i.e. the externalities) as-was prior to the execution.
+	size_t m_checkpoint;							///< The state's checkpoint as-was prior to the execution, to revert to.
+	u256s m_loaded;									///< The first slots loaded, for StoragePrefetcher to read ahead next time.
 };
 
 }
@@ -26,8 +26,10 @@
 #include <libdevcore/Guards.h>
 #include <libdevcrypto/Common.h>
 #include <libethcore/Params.h>
+#include <libethcore/CommonJS.h>
 #include "LogFilter.h"
 #include "Transaction.h"
+#include "Account.h"
 #include "AccountDiff.h"
 #include "BlockDetails.h"
 #include "Miner.h"
@@ -46,6 +48,12 @@ enum class Reaping
 	Manual
 };
 
+/// Takes the id of a watch and its changes, as soon as they are found, on the client's own thread; it should be quick.
+using ChangesHandler = std::function<void(unsigned, LocalisedLogEntries const&)>;
+
+/// Runs the function it is given such that its reads of the latest and pending blocks all see them as they were at one moment.
+using SnapshotRunner = std::function<void(std::function<void()> const&)>;
+
 enum class FudgeFactor
 {
 	Strict,
@@ -73,6 +81,11 @@ public:
 	/// @returns the new contract's address (assuming it all goes through).
 	virtual Address submitTransaction(Secret _secret, u256 _endowment, bytes const& _init, u256 _gas = 10000, u256 _gasPrice = 10 * szabo) = 0;
 
+	/// Submits the transactions @a _ts together, each signed with the secret in @a _secrets at the same index; their
+	/// @a from is not used. The nonces of each sender's follow on from its pending ones, in the order given.
+	/// @returns the hashes of the transactions.
+	virtual h256s submitTransactions(std::vector<Secret> const& _secrets, std::vector<TransactionSkeleton> const& _ts) = 0;
+
 	/// Blocks until all pending transactions have been processed.
 	virtual void flushTransactions() = 0;
 
@@ -83,6 +96,13 @@ public:
 	/// Does the given creation. Nothing is recorded into the state.
 	/// @returns the pair of the Address of the created contract together with its code.
 	virtual ExecutionResult create(Secret _secret, u256 _value, bytes const& _data, u256 _gas, u256 _gasPrice, BlockNumber _blockNumber, FudgeFactor _ff = FudgeFactor::Strict) = 0;
+
+	/// Finds the least gas with which the given call, or creation if @a _dest is null, succeeds, as a lenient call would.
+	/// Nothing is recorded into the state. @returns that gas, or 0 if it fails even with @a _maxGas.
+	virtual u256 estimateGas(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _maxGas, u256 _gasPrice, BlockNumber _blockNumber) = 0;
+	/// Makes the given call, or creation if @a _dest is null, as a lenient call would, noting what it reads and writes.
+	/// Nothing is recorded into the state. @returns the result, with ExecutionResult::accesses filled in.
+	virtual ExecutionResult traceAccesses(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice, BlockNumber _blockNumber) = 0;
 	ExecutionResult create(Secret _secret, u256 _value, bytes const& _data = bytes(), u256 _gas = 10000, u256 _gasPrice = 10 * szabo, FudgeFactor _ff = FudgeFactor::Strict) { return create(_secret, _value, _data, _gas, _gasPrice, m_default, _ff); }
 
 	// [STATE-QUERY API]
@@ -101,6 +121,12 @@ public:
 	virtual u256 stateAt(Address _a, u256 _l, BlockNumber _block) const = 0;
 	virtual bytes codeAt(Address _a, BlockNumber _block) const = 0;
 	virtual std::map<u256, u256> storageAt(Address _a, BlockNumber _block) const = 0;
+	/// @returns the proof of the account @a _a and of its storage slots @a _slots in the state after @a _block.
+	virtual StateProof proofAt(Address _a, u256s const& _slots, BlockNumber _block) const = 0;
+	/// Streams a range of the accounts in the state after @a _block; see State::accountRange().
+	virtual bytes accountRangeAt(bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f, BlockNumber _block) const = 0;
+	/// Streams a range of the storage of @a _a in the state after @a _block; see State::storageRange().
+	virtual bytes storageRangeAt(Address _a, bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f, BlockNumber _block) const = 0;
 
 	// [LOGS API]
 	
@@ -110,6 +136,9 @@ public:
 	/// Install, uninstall and query watches.
 	virtual unsigned installWatch(LogFilter const& _filter, Reaping _r = Reaping::Automatic) = 0;
 	virtual unsigned installWatch(h256 _filterId, Reaping _r = Reaping::Automatic) = 0;
+	/// Install a watch whose changes are pushed to @a _h rather than kept to be checked. It lasts until uninstalled.
+	virtual unsigned installWatch(LogFilter const& _filter, ChangesHandler const& _h) = 0;
+	virtual unsigned installWatch(h256 _filterId, ChangesHandler const& _h) = 0;
 	virtual bool uninstallWatch(unsigned _watchId) = 0;
 	LocalisedLogEntries peekWatchSafe(unsigned _watchId) const { try { return peekWatch(_watchId); } catch (...) { return LocalisedLogEntries(); } }
 	LocalisedLogEntries checkWatchSafe(unsigned _watchId) { try { return checkWatch(_watchId); } catch (...) { return LocalisedLogEntries(); } }
@@ -130,6 +159,10 @@ public:
 	virtual unsigned uncleCount(h256 _blockHash) const = 0;
 	virtual Transactions transactions(h256 _blockHash) const = 0;
 	virtual TransactionHashes transactionHashes(h256 _blockHash) const = 0;
+	/// @returns the block @a _hash in RLP, as the chain keeps it, or empty if there is no such block.
+	virtual bytes blockRLP(h256 _hash) const = 0;
+	/// @returns the receipts of the block @a _hash in RLP, as a list of one for each of its transactions.
+	virtual bytes receiptsRLP(h256 _hash) const = 0;
 
 	BlockInfo blockInfo(BlockNumber _block) const { return blockInfo(hashFromNumber(_block)); }
 	BlockDetails blockDetails(BlockNumber _block) const { return blockDetails(hashFromNumber(_block)); }
@@ -146,6 +179,10 @@ public:
 	/// @returns The height of the chain.
 	virtual unsigned number() const = 0;
 
+	/// @returns a runner for reads that should agree with each other: through it, on whichever thread, LatestBlock and
+	/// PendingBlock (their states, numbers, hashes and transactions) are as they are now.
+	virtual SnapshotRunner snapshot() const = 0;
+
 	/// Get a map containing each of the pending transactions.
 	/// @TODO: Remove in favour of transactions().
 	virtual Transactions pending() const = 0;
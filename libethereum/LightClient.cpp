@@ -0,0 +1,473 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file LightClient.cpp
+ * @date 2015
+ */
+
+#include "LightClient.h"
+
+#include <libdevcrypto/MemoryDB.h>
+#include <libdevcrypto/TrieDB.h>
+#include <libp2p/Host.h>
+#include "CanonBlockChain.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+using namespace p2p;
+
+LightClient::LightClient(Host* _net, u256 _networkId):
+	Worker("light", 100)
+{
+	m_genesis.info = CanonBlockChain::genesis();
+	m_genesis.totalDifficulty = m_genesis.info.difficulty;
+	m_hashes.push_back(m_genesis.info.hash());
+	m_recent[0] = m_genesis;
+	m_host = _net->registerCapability(new LightHost(*this, _networkId));
+	startWorking();
+}
+
+LightClient::~LightClient()
+{
+	stopWorking();
+	if (auto h = m_host.lock())
+		h->detach();
+}
+
+LightHead LightClient::head() const
+{
+	ReadGuard l(x_chain);
+	auto const& h = m_recent.rbegin()->second;
+	LightHead ret;
+	ret.hash = h.info.hash();
+	ret.number = (unsigned)h.info.number;
+	ret.totalDifficulty = h.totalDifficulty;
+	return ret;
+}
+
+StateProof LightClient::decodeProof(h256 const& _root, u256s const& _slots, RLP const& _r)
+{
+	StateProof ret;
+	ret.root = _root;
+	bool whole = _r.isList() && _r.itemCount() == 2;
+	if (whole)
+		for (auto const& n: _r[0])
+			ret.account.push_back(n.toBytes());
+	// Slots it gave no proof of are left with none, and so are not proven.
+	for (unsigned i = 0; i < _slots.size(); ++i)
+	{
+		ret.storage.push_back(make_pair(_slots[i], vector<bytes>()));
+		if (whole && i < _r[1].itemCount())
+			for (auto const& n: _r[1][i])
+				ret.storage.back().second.push_back(n.toBytes());
+	}
+	return ret;
+}
+
+bool LightClient::verify(StateProof const& _p, Address const& _a, ProvenAccount& o_account)
+{
+	o_account = ProvenAccount();
+	string account;
+	if (!verifyTrieProof(_p.root, sha3(_a).ref(), _p.account, account))
+		return false;
+	if (!account.empty())
+	{
+		RLP r(account);
+		if (!r.isList() || r.itemCount() != 4)
+			return false;
+		o_account.exists = true;
+		o_account.nonce = r[0].toInt<u256>();
+		o_account.balance = r[1].toInt<u256>();
+		o_account.storageRoot = r[2].toHash<h256>(RLP::VeryStrict);
+		o_account.codeHash = r[3].toHash<h256>(RLP::VeryStrict);
+	}
+	for (auto const& i: _p.storage)
+	{
+		string v;
+		if (!verifyTrieProof(o_account.storageRoot, sha3(h256(i.first)).ref(), i.second, v))
+			return false;
+		o_account.storage[i.first] = v.empty() ? 0 : RLP(v).toInt<u256>();
+	}
+	return true;
+}
+
+bool LightClient::verifyReceipts(h256 const& _root, RLP const& _receipts)
+{
+	if (!_receipts.isList())
+		return false;
+	MemoryDB db;
+	GenericTrieDB<MemoryDB> t(&db);
+	t.init();
+	unsigned i = 0;
+	for (auto const& r: _receipts)
+		t.insert(rlp(i++), r.data());
+	return t.root() == _root;
+}
+
+void LightClient::doWork()
+{
+	auto host = m_host.lock();
+	if (!host)
+		return;
+	LightHead ours = head();
+	shared_ptr<LightPeer> best;
+	u256 bestDifficulty = ours.totalDifficulty;
+	for (auto const& p: host->servers())
+		if (p->head().totalDifficulty > bestDifficulty)
+		{
+			best = p;
+			bestDifficulty = p->head().totalDifficulty;
+		}
+	if (!best)
+		return;
+
+	unsigned from = ours.number + 1 - min(m_back, ours.number);
+	RLPStream args;
+	args << from << c_maxLightHeaders << 0;
+	vector<BlockInfo> headers;
+	try
+	{
+		ask(GetHeadersPacket, args.out(), 3, c_maxLightHeaders, 0, [&](RLP const& _r)
+		{
+			// The proof of work of each, and that they follow on, before any is believed.
+			headers.clear();
+			for (auto const& h: _r)
+			{
+				headers.push_back(BlockInfo::fromHeader(h.data(), CheckEverything));
+				if (headers.size() > 1 && (headers.back().parentHash != headers[headers.size() - 2].hash() || headers.back().number != headers[headers.size() - 2].number + 1))
+					return false;
+			}
+			return !headers.empty() && headers[0].number == from;
+		}, best);
+		if (importHeaders(headers))
+			m_back = 0;
+		else
+			// A fork: look further back for where it leaves our chain.
+			m_back = min(max(m_back * 2, c_maxLightHeaders), c_lightRecentHeaders);
+	}
+	catch (LightRequestFailed const&)
+	{
+		// None to be had just now; perhaps once the server's credit has built up again.
+	}
+	catch (Exception const& _e)
+	{
+		clog(NetWarn) << "Light server gave bad headers:" << _e.what();
+	}
+}
+
+bool LightClient::importHeaders(vector<BlockInfo> const& _headers)
+{
+	WriteGuard l(x_chain);
+	unsigned first = (unsigned)_headers[0].number;
+	if (!first || first > m_hashes.size() || m_hashes[first - 1] != _headers[0].parentHash)
+		return false;
+	auto parent = m_recent.find(first - 1);
+	if (first > 1 && parent == m_recent.end())
+		// Deeper than we follow.
+		return false;
+
+	vector<Header> chain;
+	Header const* prev = first > 1 ? &parent->second : &m_genesis;
+	for (auto const& h: _headers)
+	{
+		h.verifyParent(prev->info);
+		chain.push_back(Header{h, prev->totalDifficulty + h.difficulty});
+		prev = &chain.back();
+	}
+	if (chain.back().totalDifficulty <= m_recent.rbegin()->second.totalDifficulty)
+		return true;
+
+	m_hashes.resize(first);
+	m_recent.erase(m_recent.lower_bound(first), m_recent.end());
+	for (auto const& h: chain)
+	{
+		m_hashes.push_back(h.info.hash());
+		m_recent[(unsigned)h.info.number] = h;
+	}
+	while (m_recent.size() > c_lightRecentHeaders)
+		m_recent.erase(m_recent.begin());
+	clog(NetNote) << "Light chain now at" << (m_hashes.size() - 1) << m_hashes.back().abridged();
+	return true;
+}
+
+LightClient::Header LightClient::header(unsigned _number) const
+{
+	h256 hash;
+	{
+		ReadGuard l(x_chain);
+		if (!_number)
+			return m_genesis;
+		auto it = m_recent.find(_number);
+		if (it != m_recent.end())
+			return it->second;
+		if (_number >= m_hashes.size())
+			return Header();
+		hash = m_hashes[_number];
+	}
+
+	// Older ones we have only the hash of, which is check enough of the header; their total difficulty is not known.
+	RLPStream args;
+	args << _number << 1 << 0;
+	Header ret;
+	ask(GetHeadersPacket, args.out(), 3, 1, _number, [&](RLP const& _r)
+	{
+		if (_r.itemCount() != 1)
+			return false;
+		ret.info = BlockInfo::fromHeader(_r[0].data(), CheckNothing);
+		return ret.info.hash() == hash;
+	});
+	return ret;
+}
+
+unsigned LightClient::numberOf(h256 const& _hash) const
+{
+	ReadGuard l(x_chain);
+	for (unsigned i = m_hashes.size(); i--;)
+		if (m_hashes[i] == _hash)
+			return i;
+	return (unsigned)-1;
+}
+
+unsigned LightClient::resolve(BlockNumber _block) const
+{
+	unsigned n = number();
+	return _block == PendingBlock || _block == LatestBlock ? n : min(_block, n);
+}
+
+bytes LightClient::ask(unsigned _packet, bytes const& _argsRLP, unsigned _args, unsigned _items, unsigned _number, function<bool(RLP const&)> const& _check, shared_ptr<LightPeer> const& _peer) const
+{
+	auto host = m_host.lock();
+	if (!host)
+		BOOST_THROW_EXCEPTION(LightRequestFailed());
+	auto servers = _peer ? vector<shared_ptr<LightPeer>>(1, _peer) : host->servers(_number);
+	for (auto const& p: servers)
+	{
+		unsigned id;
+		{
+			Guard l(x_requests);
+			id = ++m_lastId;
+			m_requests[id].peer = p.get();
+		}
+		Request r;
+		if (p->ask(_packet, id, _argsRLP, _args, _items))
+		{
+			std::unique_lock<Mutex> l(x_requests);
+			m_answered.wait_for(l, c_lightRequestTimeout, [&](){ return m_requests[id].done; });
+			r = move(m_requests[id]);
+			m_requests.erase(id);
+		}
+		else
+		{
+			Guard l(x_requests);
+			m_requests.erase(id);
+			continue;
+		}
+
+		try
+		{
+			if (!r.answer.empty() && _check(RLP(r.answer)))
+				return r.answer;
+		}
+		catch (Exception const&)
+		{
+		}
+		if (!r.answer.empty())
+			clog(NetWarn) << "Light server gave an answer that does not check out.";
+	}
+	BOOST_THROW_EXCEPTION(LightRequestFailed());
+}
+
+void LightClient::noteAnswer(LightPeer const* _peer, unsigned _id, RLP const& _r)
+{
+	Guard l(x_requests);
+	auto it = m_requests.find(_id);
+	if (it == m_requests.end() || it->second.peer != _peer)
+		return;
+	it->second.answer = _r.data().toBytes();
+	it->second.done = true;
+	m_answered.notify_all();
+}
+
+void LightClient::notePeerGone(LightPeer const* _peer)
+{
+	Guard l(x_requests);
+	for (auto& i: m_requests)
+		if (i.second.peer == _peer)
+			i.second.done = true;
+	m_answered.notify_all();
+}
+
+ProvenAccount LightClient::account(Address const& _a, u256s const& _slots, BlockNumber _block, StateProof* o_proof) const
+{
+	unsigned n = resolve(_block);
+	Header h = header(n);
+	RLPStream args(1);
+	args.appendList(1).appendList(3) << h.info.hash() << _a << _slots;
+	ProvenAccount ret;
+	StateProof p;
+	ask(GetProofsPacket, args.out(), 1, 1 + _slots.size(), n, [&](RLP const& _r)
+	{
+		if (_r.itemCount() != 1)
+			return false;
+		p = decodeProof(h.info.stateRoot, _slots, _r[0]);
+		return verify(p, _a, ret);
+	});
+	if (o_proof)
+		*o_proof = p;
+	return ret;
+}
+
+StateProof LightClient::proofAt(Address _a, u256s const& _slots, BlockNumber _block) const
+{
+	StateProof ret;
+	account(_a, _slots, _block, &ret);
+	return ret;
+}
+
+bytes LightClient::codeAt(Address _a, BlockNumber _block) const
+{
+	unsigned n = resolve(_block);
+	h256 codeHash = account(_a, u256s(), n).codeHash;
+	if (codeHash == EmptySHA3)
+		return bytes();
+	RLPStream args(1);
+	args.appendList(1) << codeHash;
+	bytes ret;
+	ask(GetCodePacket, args.out(), 1, 1, n, [&](RLP const& _r)
+	{
+		if (_r.itemCount() != 1)
+			return false;
+		ret = _r[0].toBytes();
+		return sha3(ret) == codeHash;
+	});
+	return ret;
+}
+
+h256 LightClient::hashFromNumber(BlockNumber _number) const
+{
+	unsigned n = resolve(_number);
+	ReadGuard l(x_chain);
+	return m_hashes[n];
+}
+
+BlockInfo LightClient::blockInfo(h256 _hash) const
+{
+	unsigned n = numberOf(_hash);
+	return n == (unsigned)-1 ? BlockInfo() : header(n).info;
+}
+
+BlockDetails LightClient::blockDetails(h256 _hash) const
+{
+	unsigned n = numberOf(_hash);
+	if (n == (unsigned)-1)
+		return BlockDetails();
+	Header h = header(n);
+	return BlockDetails(n, h.totalDifficulty, h.info.parentHash, h256s());
+}
+
+bytes LightClient::receiptsRLP(h256 _hash) const
+{
+	unsigned n = numberOf(_hash);
+	if (n == (unsigned)-1)
+		return bytes();
+	h256 root = header(n).info.receiptsRoot;
+	RLPStream args(1);
+	args.appendList(1) << _hash;
+	bytes ret;
+	ask(GetReceiptsPacket, args.out(), 1, 1, n, [&](RLP const& _r)
+	{
+		if (_r.itemCount() != 1 || !verifyReceipts(root, _r[0]))
+			return false;
+		ret = _r[0].data().toBytes();
+		return true;
+	});
+	return ret;
+}
+
+SnapshotRunner LightClient::snapshot() const
+{
+	// Each read is checked against the header of the block it is of; pinning the latest block is up to the caller,
+	// by asking of it by number.
+	return [](function<void()> const& _f) { _f(); };
+}
+
+u256 LightClient::nextNonce(Address const& _from)
+{
+	u256 count = countAt(_from, LatestBlock);
+	Guard l(x_nonces);
+	u256& n = m_nonces[_from];
+	n = max(n, count);
+	return n++;
+}
+
+void LightClient::send(Transactions const& _ts)
+{
+	auto host = m_host.lock();
+	if (!host)
+		BOOST_THROW_EXCEPTION(LightRequestFailed());
+	for (unsigned i = 0; i < _ts.size(); i += c_maxLightItems)
+	{
+		unsigned n = min<unsigned>(_ts.size() - i, c_maxLightItems);
+		RLPStream args(1);
+		args.appendList(n);
+		for (unsigned j = i; j < i + n; ++j)
+			args.appendRaw(_ts[j].rlp());
+		unsigned sent = 0;
+		for (auto const& p: host->servers())
+		{
+			unsigned id;
+			{
+				Guard l(x_requests);
+				id = ++m_lastId;
+			}
+			sent += p->ask(SendTransactionsPacket, id, args.out(), 1, n);
+		}
+		if (!sent)
+			BOOST_THROW_EXCEPTION(LightRequestFailed());
+	}
+}
+
+void LightClient::submitTransaction(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice)
+{
+	Transaction t(_value, _gasPrice, _gas, _dest, _data, nextNonce(toAddress(_secret)), _secret);
+	send(Transactions(1, t));
+	cnote << "New transaction " << t;
+}
+
+Address LightClient::submitTransaction(Secret _secret, u256 _endowment, bytes const& _init, u256 _gas, u256 _gasPrice)
+{
+	Transaction t(_endowment, _gasPrice, _gas, _init, nextNonce(toAddress(_secret)), _secret);
+	send(Transactions(1, t));
+	cnote << "New transaction " << t;
+	return right160(sha3(rlpList(t.sender(), t.nonce())));
+}
+
+h256s LightClient::submitTransactions(vector<Secret> const& _secrets, vector<TransactionSkeleton> const& _ts)
+{
+	Transactions ts;
+	h256s ret;
+	for (unsigned i = 0; i < _ts.size(); ++i)
+	{
+		TransactionSkeleton const& t = _ts[i];
+		u256 nonce = nextNonce(toAddress(_secrets[i]));
+		ts.push_back(t.creation ?
+			Transaction(t.value, t.gasPrice, t.gas, t.data, nonce, _secrets[i]) :
+			Transaction(t.value, t.gasPrice, t.gas, t.to, t.data, nonce, _secrets[i]));
+		ret.push_back(ts.back().sha3());
+	}
+	send(ts);
+	return ret;
+}
@@ -0,0 +1,236 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file LightClient.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <libdevcore/Worker.h>
+#include <libethcore/BlockInfo.h>
+#include "Interface.h"
+#include "LightHost.h"
+
+namespace dev
+{
+
+namespace p2p { class Host; }
+
+namespace eth
+{
+
+/// No server could be found to answer a request, or none answered it with what checked out.
+struct LightRequestFailed: virtual Exception {};
+
+/// An account, and some of its storage, as a proof proves them.
+struct ProvenAccount
+{
+	bool exists = false;
+	u256 nonce;
+	u256 balance;
+	h256 storageRoot = EmptyTrie;
+	h256 codeHash = EmptySHA3;
+	std::map<u256, u256> storage;	///< The slots proven, zero ones included.
+};
+
+/**
+ * @brief An Interface that holds no state, asking servers of the light client protocol instead.
+ * Only the chain's headers are kept: each is checked for its proof of work and against its parent as it comes, so
+ * that the chain followed is the most difficult any server offers; those of the last c_lightRecentHeaders blocks are
+ * kept whole, and of earlier ones only the hashes. Accounts, storage, code and receipts are asked for on demand, of
+ * whichever server has the credit for it, and checked against the header of their block before being believed:
+ * a server can withhold them, but not lie about them. Transactions are sent to every server, signed here.
+ * What needs state executed or whole blocks (calls, logs, transactions by hash) is not supported.
+ * @threadsafe
+ * @doWork Syncs the headers with the servers.
+ */
+class LightClient: public Interface, Worker
+{
+	friend class LightHost;
+	friend class LightPeer;
+
+public:
+	/// Follows the chain of network @a _networkId from its genesis, through the servers among the peers of @a _net.
+	explicit LightClient(p2p::Host* _net, u256 _networkId = 0);
+	virtual ~LightClient();
+
+	/// @returns the head of the chain we follow.
+	LightHead head() const;
+	h256 genesisHash() const { return m_genesis.info.hash(); }
+
+	/// @returns false unless @a _p proves, against its root, the account @a _a and each of the slots of it that it
+	/// was made for, setting @a o_account to them.
+	static bool verify(StateProof const& _p, Address const& _a, ProvenAccount& o_account);
+	/// @returns false unless @a _receipts, a list of receipts, are those of a block whose receipts root is @a _root.
+	static bool verifyReceipts(h256 const& _root, RLP const& _receipts);
+	/// @returns the proof of the root @a _root for @a _slots, as LightHost::streamProof() streamed it into @a _r.
+	static StateProof decodeProof(h256 const& _root, u256s const& _slots, RLP const& _r);
+
+	// [TRANSACTION API]
+
+	virtual void submitTransaction(Secret _secret, u256 _value, Address _dest, bytes const& _data = bytes(), u256 _gas = 10000, u256 _gasPrice = 10 * szabo) override;
+	virtual Address submitTransaction(Secret _secret, u256 _endowment, bytes const& _init, u256 _gas = 10000, u256 _gasPrice = 10 * szabo) override;
+	virtual h256s submitTransactions(std::vector<Secret> const& _secrets, std::vector<TransactionSkeleton> const& _ts) override;
+	virtual void flushTransactions() override {}
+
+	virtual ExecutionResult call(Secret, u256, Address, bytes const&, u256, u256, BlockNumber, FudgeFactor) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::call")); }
+	virtual ExecutionResult create(Secret, u256, bytes const&, u256, u256, BlockNumber, FudgeFactor) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::create")); }
+	virtual u256 estimateGas(Secret, u256, Address, bytes const&, u256, u256, BlockNumber) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::estimateGas")); }
+	virtual ExecutionResult traceAccesses(Secret, u256, Address, bytes const&, u256, u256, BlockNumber) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::traceAccesses")); }
+
+	// [STATE-QUERY API]
+
+	using Interface::balanceAt;
+	using Interface::countAt;
+	using Interface::stateAt;
+	using Interface::codeAt;
+	using Interface::storageAt;
+
+	virtual u256 balanceAt(Address _a, BlockNumber _block) const override { return account(_a, u256s(), _block).balance; }
+	virtual u256 countAt(Address _a, BlockNumber _block) const override { return account(_a, u256s(), _block).nonce; }
+	virtual u256 stateAt(Address _a, u256 _l, BlockNumber _block) const override { return account(_a, u256s(1, _l), _block).storage[_l]; }
+	virtual bytes codeAt(Address _a, BlockNumber _block) const override;
+	virtual std::map<u256, u256> storageAt(Address, BlockNumber) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::storageAt")); }
+	virtual StateProof proofAt(Address _a, u256s const& _slots, BlockNumber _block) const override;
+	virtual bytes accountRangeAt(bytesConstRef, unsigned, TrieEntryVisitor const&, BlockNumber) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::accountRangeAt")); }
+	virtual bytes storageRangeAt(Address, bytesConstRef, unsigned, TrieEntryVisitor const&, BlockNumber) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::storageRangeAt")); }
+
+	// [LOGS API]
+
+	virtual LocalisedLogEntries logs(unsigned) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::logs")); }
+	virtual LocalisedLogEntries logs(LogFilter const&) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::logs")); }
+	virtual unsigned installWatch(LogFilter const&, Reaping) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::installWatch")); }
+	virtual unsigned installWatch(h256, Reaping) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::installWatch")); }
+	virtual unsigned installWatch(LogFilter const&, ChangesHandler const&) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::installWatch")); }
+	virtual unsigned installWatch(h256, ChangesHandler const&) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::installWatch")); }
+	virtual bool uninstallWatch(unsigned) override { return false; }
+	virtual LocalisedLogEntries peekWatch(unsigned) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::peekWatch")); }
+	virtual LocalisedLogEntries checkWatch(unsigned) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::checkWatch")); }
+
+	// [BLOCK QUERY API]
+
+	virtual Transaction transaction(h256) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::transaction")); }
+	virtual h256 hashFromNumber(BlockNumber _number) const override;
+	virtual BlockInfo blockInfo(h256 _hash) const override;
+	virtual BlockDetails blockDetails(h256 _hash) const override;
+	virtual Transaction transaction(h256, unsigned) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::transaction")); }
+	virtual BlockInfo uncle(h256, unsigned) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::uncle")); }
+	virtual UncleHashes uncleHashes(h256) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::uncleHashes")); }
+	virtual unsigned transactionCount(h256) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::transactionCount")); }
+	virtual unsigned uncleCount(h256) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::uncleCount")); }
+	virtual Transactions transactions(h256) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::transactions")); }
+	virtual TransactionHashes transactionHashes(h256) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::transactionHashes")); }
+	virtual bytes blockRLP(h256) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::blockRLP")); }
+	virtual bytes receiptsRLP(h256 _hash) const override;
+
+	// [EXTRA API]
+
+	virtual unsigned number() const override { ReadGuard l(x_chain); return m_hashes.size() - 1; }
+	virtual SnapshotRunner snapshot() const override;
+	/// There is no pending block; transactions sent are the servers' to keep.
+	virtual Transactions pending() const override { return Transactions(); }
+	virtual h256s pendingHashes() const override { return h256s(); }
+
+	using Interface::diff;
+	virtual StateDiff diff(unsigned, h256) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::diff")); }
+	virtual StateDiff diff(unsigned, BlockNumber) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::diff")); }
+	using Interface::addresses;
+	virtual Addresses addresses(BlockNumber) const override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::addresses")); }
+	virtual u256 gasLimitRemaining() const override { ReadGuard l(x_chain); return m_recent.rbegin()->second.info.gasLimit; }
+
+	// [MINING API]
+
+	virtual void setAddress(Address _us) override { m_address = _us; }
+	virtual Address address() const override { return m_address; }
+	virtual void setMiningThreads(unsigned) override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::setMiningThreads")); }
+	virtual unsigned miningThreads() const override { return 0; }
+	virtual void startMining() override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::startMining")); }
+	virtual void stopMining() override {}
+	virtual bool isMining() const override { return false; }
+	virtual uint64_t hashrate() const override { return 0; }
+	virtual std::pair<h256, u256> getWork() override { BOOST_THROW_EXCEPTION(InterfaceNotSupported("dev::eth::LightClient::getWork")); }
+	virtual bool submitWork(ProofOfWork::Proof const&) override { return false; }
+	virtual MineProgress miningProgress() const override { return MineProgress(); }
+
+private:
+	struct Header
+	{
+		BlockInfo info;
+		u256 totalDifficulty;
+	};
+
+	struct Request
+	{
+		LightPeer const* peer = nullptr;
+		bool done = false;
+		bytes answer;				///< The list the answer gave; empty if the peer went without answering.
+	};
+
+	/// Catches up with the most difficult chain the servers offer, a batch of headers at a time.
+	void doWork();
+
+	/// Checks the consecutive headers @a _headers against their parents and, should they link to our chain and make it
+	/// more difficult, puts them in place of what follows where they link. @returns false if they do not link.
+	bool importHeaders(std::vector<BlockInfo> const& _headers);
+
+	/// @returns the header of the block @a _number, asking for it if it is not one of the recent ones.
+	Header header(unsigned _number) const;
+	/// @returns the number of the block @a _hash on our chain, or -1 if it is not on it.
+	unsigned numberOf(h256 const& _hash) const;
+	/// @returns the number of the block @a _block is, the latest for the pending one.
+	unsigned resolve(BlockNumber _block) const;
+
+	/// @returns the account @a _a and its slots @a _slots after the block @a _block, as proven by a server.
+	ProvenAccount account(Address const& _a, u256s const& _slots, BlockNumber _block, StateProof* o_proof = nullptr) const;
+
+	/// Asks the request @a _packet with the @a _args arguments @a _argsRLP for @a _items items of a server at or past
+	/// block @a _number, or of @a _peer only if given, and waits for it to answer. Each answer is handed to @a _check,
+	/// which @returns true if it checks out; otherwise another server is asked.
+	/// @returns the list the answer gave. @throws LightRequestFailed if no server gave one that checks out.
+	bytes ask(unsigned _packet, bytes const& _argsRLP, unsigned _args, unsigned _items, unsigned _number, std::function<bool(RLP const&)> const& _check, std::shared_ptr<LightPeer> const& _peer = nullptr) const;
+	/// @returns the nonce of the next transaction of @a _from: its count of transactions, or one more than we last sent.
+	u256 nextNonce(Address const& _from);
+	/// Sends the transactions @a _ts to every server.
+	void send(Transactions const& _ts);
+
+	/// Notes the answer @a _r to our request @a _id of @a _peer. Called with the host's x_client held.
+	void noteAnswer(LightPeer const* _peer, unsigned _id, RLP const& _r);
+	/// Notes that @a _peer is gone, and will answer none of our requests. Called with the host's x_client held.
+	void notePeerGone(LightPeer const* _peer);
+
+	std::weak_ptr<LightHost> m_host;
+	Address m_address;
+
+	mutable SharedMutex x_chain;
+	Header m_genesis;
+	h256s m_hashes;							///< The hashes of our chain's blocks, by number.
+	std::map<unsigned, Header> m_recent;	///< Our chain's last c_lightRecentHeaders headers, by number.
+	unsigned m_back = 0;					///< How far back of our head the next batch of headers starts.
+
+	mutable Mutex x_requests;
+	mutable Condition m_answered;
+	mutable unsigned m_lastId = 0;
+	mutable std::map<unsigned, Request> m_requests;
+
+	Mutex x_nonces;
+	std::map<Address, u256> m_nonces;		///< The next nonce of each sender we have sent transactions of.
+};
+
+}
+}
@@ -0,0 +1,209 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file LightHost.cpp
+ * @date 2015
+ */
+
+#include "LightHost.h"
+
+#include <algorithm>
+#include <libdevcrypto/TrieDB.h>
+#include <libp2p/Session.h>
+#include "BlockChain.h"
+#include "LightClient.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+using namespace p2p;
+
+LightHost::LightHost(BlockChain const& _chain, OverlayDB const& _stateDB, TransactionQueue& _tq, u256 _networkId):
+	Worker("lightsync", 100),
+	m_chain(&_chain),
+	m_stateDB(_stateDB),
+	m_tq(&_tq),
+	m_networkId(_networkId),
+	m_announced(_chain.currentHash())
+{
+}
+
+LightHost::LightHost(LightClient& _client, u256 _networkId):
+	Worker("lightsync", 100),
+	m_client(&_client),
+	m_networkId(_networkId)
+{
+}
+
+void LightHost::onStarting()
+{
+	if (isServer())
+		startWorking();
+}
+
+void LightHost::onStopping()
+{
+	stopWorking();
+}
+
+void LightHost::detach()
+{
+	Guard l(x_client);
+	m_client = nullptr;
+}
+
+h256 LightHost::genesisHash() const
+{
+	return m_chain ? m_chain->genesisHash() : m_client ? m_client->genesisHash() : h256();
+}
+
+LightHead LightHost::head() const
+{
+	LightHead ret;
+	if (m_chain)
+	{
+		ret.hash = m_chain->currentHash();
+		auto d = m_chain->details(ret.hash);
+		ret.number = d.number;
+		ret.totalDifficulty = d.totalDifficulty;
+	}
+	else
+	{
+		Guard l(x_client);
+		if (m_client)
+			ret = m_client->head();
+	}
+	return ret;
+}
+
+uint64_t LightHost::cost(unsigned _packet, unsigned _items)
+{
+	// Roughly the microseconds each takes to serve: a state proof walks two tries, a receipt is a DB read.
+	static const uint64_t c_base = 5000;
+	switch (_packet)
+	{
+	case GetHeadersPacket: return c_base + 500 * _items;
+	case GetReceiptsPacket: return c_base + 2000 * _items;
+	case GetProofsPacket: return c_base + 10000 * _items;
+	case GetCodePacket: return c_base + 2000 * _items;
+	case SendTransactionsPacket: return c_base + 5000 * _items;
+	default: return c_base;
+	}
+}
+
+vector<shared_ptr<LightPeer>> LightHost::servers(unsigned _number) const
+{
+	vector<pair<uint64_t, shared_ptr<LightPeer>>> s;
+	for (auto const& i: peerSessions())
+		if (auto p = i.first->cap<LightPeer>())
+			if (p->isServer() && p->head().number >= _number)
+				s.push_back(make_pair(p->credit(), p));
+	sort(s.begin(), s.end(), [](pair<uint64_t, shared_ptr<LightPeer>> const& _a, pair<uint64_t, shared_ptr<LightPeer>> const& _b) { return _a.first > _b.first; });
+	vector<shared_ptr<LightPeer>> ret;
+	for (auto& i: s)
+		ret.push_back(move(i.second));
+	return ret;
+}
+
+void LightHost::doWork()
+{
+	h256 h = m_chain->currentHash();
+	if (h == m_announced)
+		return;
+	m_announced = h;
+	for (auto const& i: peerSessions())
+		if (auto p = i.first->cap<LightPeer>())
+			p->sendHead(true);
+}
+
+unsigned LightHost::streamHeaders(RLPStream& o_s, unsigned _from, unsigned _max, unsigned _skip) const
+{
+	RLPStream headers;
+	unsigned n = 0;
+	unsigned last = m_chain->number();
+	for (uint64_t i = _from; i <= last && n < min(_max, c_maxLightHeaders); i += uint64_t(_skip) + 1, ++n)
+		headers.appendRaw(m_chain->blockHandle(m_chain->numberHash(i)).header());
+	o_s.appendList(n).appendRaw(headers.out(), n);
+	return n;
+}
+
+void LightHost::streamReceipts(RLPStream& o_s, RLP const& _blocks) const
+{
+	unsigned n = min<unsigned>(_blocks.itemCount(), c_maxLightItems);
+	o_s.appendList(n);
+	for (unsigned i = 0; i < n; ++i)
+	{
+		h256 h = _blocks[i].toHash<h256>();
+		if (m_chain->isKnown(h))
+			o_s.appendRaw(m_chain->receipts(h).rlp());
+		else
+			o_s.appendList(0);
+	}
+}
+
+void LightHost::streamProof(RLPStream& o_s, StateProof const& _p)
+{
+	o_s.appendList(2);
+	o_s.appendVector(_p.account);
+	o_s.appendList(_p.storage.size());
+	for (auto const& i: _p.storage)
+		o_s.appendVector(i.second);
+}
+
+void LightHost::streamProofs(RLPStream& o_s, RLP const& _requests) const
+{
+	unsigned n = min<unsigned>(_requests.itemCount(), c_maxLightItems);
+	o_s.appendList(n);
+	for (unsigned i = 0; i < n; ++i)
+	{
+		RLP r = _requests[i];
+		h256 h = r[0].toHash<h256>();
+		if (!m_chain->isKnown(h) || !m_stateDB.exists(m_chain->info(h).stateRoot))
+		{
+			// Not kept, as when pruned: the client asks another server.
+			o_s.appendList(0);
+			continue;
+		}
+
+		// Straight from the tries, keyed by the hashes as the secure tries of State are.
+		auto db = const_cast<OverlayDB*>(&m_stateDB);		// promise we won't change the overlay! :)
+		StateProof p;
+		p.root = m_chain->info(h).stateRoot;
+		GenericTrieDB<OverlayDB> state(db, p.root);
+		Address a = r[1].toHash<Address>();
+		p.account = state.prove(sha3(a).ref());
+		string account = state.at(sha3(a).ref());
+		h256 storageRoot = account.empty() ? EmptyTrie : RLP(account)[2].toHash<h256>();
+		bool haveStorage = storageRoot != EmptyTrie && m_stateDB.exists(storageRoot);
+		GenericTrieDB<OverlayDB> storage(db);
+		if (haveStorage)
+			storage.setRoot(storageRoot);
+		for (auto const& s: r[2])
+		{
+			u256 slot = s.toInt<u256>();
+			// The empty trie's root node is all it takes to prove a slot of it absent.
+			p.storage.push_back(make_pair(slot, haveStorage ? storage.prove(sha3(h256(slot)).ref()) : storageRoot == EmptyTrie ? vector<bytes>(1, RLPNull) : vector<bytes>()));
+		}
+		streamProof(o_s, p);
+	}
+}
+
+void LightHost::streamCode(RLPStream& o_s, RLP const& _hashes) const
+{
+	unsigned n = min<unsigned>(_hashes.itemCount(), c_maxLightItems);
+	o_s.appendList(n);
+	for (unsigned i = 0; i < n; ++i)
+		o_s << m_stateDB.lookup(_hashes[i].toHash<h256>());
+}
@@ -0,0 +1,119 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file LightHost.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <libdevcore/Worker.h>
+#include <libdevcrypto/OverlayDB.h>
+#include <libp2p/HostCapability.h>
+#include "Account.h"
+#include "CommonNet.h"
+#include "LightPeer.h"
+
+namespace dev
+{
+namespace eth
+{
+
+class BlockChain;
+class TransactionQueue;
+
+/// The most credit a server gives a peer: a burst of requests costing this much is served at once.
+static const uint64_t c_lightCreditLimit = 1000000;
+/// The credit a server gives each peer a second, once it has spent its limit.
+static const uint64_t c_lightCreditRate = 50000;
+
+/// The head of a chain, as a light peer tells others of it.
+struct LightHead
+{
+	h256 hash;
+	unsigned number = 0;
+	u256 totalDifficulty;
+};
+
+/**
+ * @brief The light client protocol, "les", alongside EthereumHost.
+ * A full node serves its light peers headers, receipts, Merkle proofs of accounts and their storage, and code, all of
+ * which they check against the headers, and passes on the transactions they send. Each request costs the peer credit
+ * for the work it takes (see cost()); a peer that asks for more than its RequestCredit allows is dropped. A light
+ * client serves nothing, and hands what servers send to its LightClient.
+ * @doWork Announces new heads of the chain served to the peers.
+ */
+class LightHost: public p2p::HostCapability<LightPeer>, Worker
+{
+	friend class LightPeer;
+
+public:
+	/// Serves @a _chain, with its states in @a _stateDB, to the light peers of network @a _networkId, queueing the
+	/// transactions they send in @a _tq.
+	LightHost(BlockChain const& _chain, OverlayDB const& _stateDB, TransactionQueue& _tq, u256 _networkId);
+	/// Serves nothing, handing what servers send to @a _client.
+	LightHost(LightClient& _client, u256 _networkId);
+
+	/// Hands nothing more to the light client, which is going.
+	void detach();
+
+	bool isServer() const { return !!m_chain; }
+	u256 networkId() const { return m_networkId; }
+	h256 genesisHash() const;
+	/// @returns the head of our chain, or of the light client's.
+	LightHead head() const;
+
+	/// @returns the credit a request @a _packet for @a _items items costs.
+	static uint64_t cost(unsigned _packet, unsigned _items);
+
+	/// @returns the servers among our peers whose head is at least @a _number, those with most credit first.
+	std::vector<std::shared_ptr<LightPeer>> servers(unsigned _number = 0) const;
+
+	/// Streams the headers of the blocks numbered @a _from, and every @a _skip + 1 th after it, up to @a _max of them.
+	/// @returns how many it streamed.
+	unsigned streamHeaders(RLPStream& o_s, unsigned _from, unsigned _max, unsigned _skip) const;
+	/// Streams the receipts of each of the blocks @a _blocks as a list, empty if it is not known.
+	void streamReceipts(RLPStream& o_s, RLP const& _blocks) const;
+	/// Streams a proof for each of @a _requests, [block hash, address, [slot, ...]], as streamProof() does, or an empty
+	/// list if the state of the block is not kept.
+	void streamProofs(RLPStream& o_s, RLP const& _requests) const;
+	/// Streams the code of each of the hashes @a _hashes, empty if it is not known.
+	void streamCode(RLPStream& o_s, RLP const& _hashes) const;
+
+	/// Streams @a _p as [[account proof node, ...], [[slot proof node, ...], ...]], the slots as they were asked for.
+	static void streamProof(RLPStream& o_s, StateProof const& _p);
+
+private:
+	void doWork();
+
+	virtual void onStarting();
+	virtual void onStopping();
+
+	BlockChain const* m_chain = nullptr;
+	OverlayDB m_stateDB;				///< Where the states proofs are made of are found.
+	TransactionQueue* m_tq = nullptr;
+
+	mutable Mutex x_client;				///< Held while the light client is handed anything, so that it can go.
+	LightClient* m_client = nullptr;
+
+	u256 m_networkId;
+	h256 m_announced;					///< The head we last told our peers of.
+};
+
+}
+}
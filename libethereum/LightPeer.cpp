@@ -0,0 +1,256 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file LightPeer.cpp
+ * @date 2015
+ */
+
+#include "LightPeer.h"
+
+#include <libp2p/Session.h>
+#include "LightClient.h"
+#include "LightHost.h"
+#include "TransactionQueue.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+using namespace p2p;
+
+#if defined(clogS)
+#undef clogS
+#endif
+#define clogS(X) dev::LogOutputStream<X, true>(false) << "| " << std::setw(2) << session()->socketId() << "] "
+
+LightPeer::LightPeer(Session* _s, HostCapabilityFace* _h, unsigned _i):
+	Capability(_s, _h, _i)
+{
+	if (host()->isServer())
+		m_given.reset(c_lightCreditLimit, c_lightCreditRate);
+	sendHead(false);
+}
+
+LightPeer::~LightPeer()
+{
+	Guard l(host()->x_client);
+	if (host()->m_client)
+		host()->m_client->notePeerGone(this);
+}
+
+LightHost* LightPeer::host() const
+{
+	return static_cast<LightHost*>(Capability::hostCapability());
+}
+
+LightHead LightPeer::head() const
+{
+	Guard l(x_peer);
+	LightHead ret;
+	ret.hash = m_headHash;
+	ret.number = m_headNumber;
+	ret.totalDifficulty = m_headDifficulty;
+	return ret;
+}
+
+void LightPeer::sendHead(bool _announce)
+{
+	LightHead h = host()->head();
+	RLPStream s;
+	if (_announce)
+		prep(s, AnnouncePacket, 3) << h.hash << h.number << h.totalDifficulty;
+	else
+		prep(s, LightStatusPacket, 9)
+			<< version()
+			<< host()->networkId()
+			<< h.totalDifficulty
+			<< h.hash
+			<< h.number
+			<< host()->genesisHash()
+			<< (unsigned)host()->isServer()
+			<< m_given.limit()
+			<< m_given.rate();
+	sealAndSend(s);
+}
+
+bool LightPeer::ask(unsigned _packet, unsigned _id, bytes const& _argsRLP, unsigned _args, unsigned _items)
+{
+	uint64_t cost = LightHost::cost(_packet, _items);
+	{
+		Guard l(x_peer);
+		if (!m_server || !m_have.spend(cost))
+			return false;
+		// Transactions are not answered; the credit they took is left for the server to say.
+		if (_packet != SendTransactionsPacket)
+			m_asked[_id] = cost;
+	}
+	RLPStream s;
+	prep(s, _packet, _args + 1) << _id;
+	s.appendRaw(_argsRLP, _args);
+	sealAndSend(s);
+	return true;
+}
+
+void LightPeer::answer(unsigned _packet, RLP const& _r, unsigned _items, unsigned _answer, RLPStream const& _list, unsigned _count)
+{
+	if (!host()->isServer())
+	{
+		disable("Asked a light client to serve.");
+		return;
+	}
+	if (!m_given.spend(LightHost::cost(_packet, _items)))
+	{
+		clogS(NetWarn) << "Light peer asked for more than its credit.";
+		disable("Exceeded request credit.");
+		return;
+	}
+	RLPStream s;
+	prep(s, _answer, 3) << _r[0].toInt<unsigned>() << m_given.value();
+	s.appendRaw(_list.out(), _count);
+	sealAndSend(s);
+	addRating(0);
+}
+
+bool LightPeer::interpret(unsigned _id, RLP const& _r)
+{
+	try
+	{
+	switch (_id)
+	{
+	case LightStatusPacket:
+	{
+		auto protocolVersion = _r[0].toInt<unsigned>();
+		auto networkId = _r[1].toInt<u256>();
+		auto genesisHash = _r[5].toHash<h256>();
+		clogS(NetMessageSummary) << "Status:" << protocolVersion << "/" << networkId << "/" << genesisHash.abridged() << ", TD:" << _r[2].toInt<u256>() << "=" << _r[3].toHash<h256>().abridged() << (_r[6].toInt<unsigned>() ? "serving" : "");
+
+		if (genesisHash != host()->genesisHash())
+			disable("Invalid genesis hash");
+		else if (protocolVersion != version())
+			disable("Invalid protocol version.");
+		else if (networkId != host()->networkId())
+			disable("Invalid network identifier.");
+		else
+		{
+			Guard l(x_peer);
+			m_headDifficulty = _r[2].toInt<u256>();
+			m_headHash = _r[3].toHash<h256>();
+			m_headNumber = _r[4].toInt<unsigned>();
+			m_server = !!_r[6].toInt<unsigned>();
+			m_have.reset(_r[7].toInt<uint64_t>(), _r[8].toInt<uint64_t>());
+		}
+		break;
+	}
+	case AnnouncePacket:
+	{
+		Guard l(x_peer);
+		m_headHash = _r[0].toHash<h256>();
+		m_headNumber = _r[1].toInt<unsigned>();
+		m_headDifficulty = _r[2].toInt<u256>();
+		break;
+	}
+	case GetHeadersPacket:
+	{
+		unsigned max = min(_r[2].toInt<unsigned>(), c_maxLightHeaders);
+		clogS(NetMessageSummary) << "GetHeaders (" << max << "from" << _r[1].toInt<unsigned>() << ")";
+		RLPStream list;
+		if (host()->isServer())
+			host()->streamHeaders(list, _r[1].toInt<unsigned>(), max, _r[3].toInt<unsigned>());
+		answer(_id, _r, max, HeadersPacket, list, 1);
+		break;
+	}
+	case GetReceiptsPacket:
+	{
+		clogS(NetMessageSummary) << "GetReceipts (" << dec << _r[1].itemCount() << "entries)";
+		RLPStream list;
+		if (host()->isServer())
+			host()->streamReceipts(list, _r[1]);
+		answer(_id, _r, min<unsigned>(_r[1].itemCount(), c_maxLightItems), ReceiptsPacket, list, 1);
+		break;
+	}
+	case GetProofsPacket:
+	{
+		clogS(NetMessageSummary) << "GetProofs (" << dec << _r[1].itemCount() << "entries)";
+		// Each slot costs as much as an account: both are a walk down a trie.
+		unsigned items = 0;
+		for (unsigned i = 0; i < _r[1].itemCount() && i < c_maxLightItems; ++i)
+			items += 1 + _r[1][i][2].itemCount();
+		RLPStream list;
+		if (host()->isServer())
+			host()->streamProofs(list, _r[1]);
+		answer(_id, _r, items, ProofsPacket, list, 1);
+		break;
+	}
+	case GetCodePacket:
+	{
+		clogS(NetMessageSummary) << "GetCode (" << dec << _r[1].itemCount() << "entries)";
+		RLPStream list;
+		if (host()->isServer())
+			host()->streamCode(list, _r[1]);
+		answer(_id, _r, min<unsigned>(_r[1].itemCount(), c_maxLightItems), CodePacket, list, 1);
+		break;
+	}
+	case SendTransactionsPacket:
+	{
+		clogS(NetMessageSummary) << "SendTransactions (" << dec << _r[1].itemCount() << "entries)";
+		unsigned n = _r[1].itemCount();
+		if (!host()->isServer())
+			disable("Sent transactions to a light client.");
+		else if (n > c_maxLightItems)
+			disable("Sent too many transactions at once.");
+		else if (!m_given.spend(LightHost::cost(_id, n)))
+			disable("Exceeded request credit.");
+		else
+			host()->m_tq->importBatch(_r[1]);
+		break;
+	}
+	case HeadersPacket:
+	case ReceiptsPacket:
+	case ProofsPacket:
+	case CodePacket:
+	{
+		unsigned id = _r[0].toInt<unsigned>();
+		{
+			Guard l(x_peer);
+			if (!m_asked.erase(id))
+			{
+				clogS(NetWarn) << "Light server answering what we did not ask.";
+				break;
+			}
+			// What it says we have left, less what we have since spent on requests it has not yet answered.
+			uint64_t since = 0;
+			for (auto const& i: m_asked)
+				since += i.second;
+			m_have.set(_r[1].toInt<uint64_t>(), since);
+		}
+		Guard l(host()->x_client);
+		if (host()->m_client)
+			host()->m_client->noteAnswer(this, id, _r[2]);
+		break;
+	}
+	default:
+		return false;
+	}
+	}
+	catch (Exception const& _e)
+	{
+		clogS(NetWarn) << "Peer causing an Exception:" << _e.what() << _r;
+	}
+	catch (std::exception const& _e)
+	{
+		clogS(NetWarn) << "Peer causing an exception:" << _e.what() << _r;
+	}
+
+	return true;
+}
@@ -0,0 +1,89 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file LightPeer.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <map>
+#include <libdevcore/Guards.h>
+#include <libdevcore/RLP.h>
+#include <libp2p/Capability.h>
+#include "CommonNet.h"
+#include "RequestCredit.h"
+
+namespace dev
+{
+namespace eth
+{
+
+struct LightHead;
+
+/**
+ * @brief A peer of the light client protocol; see LightHost.
+ * Of a peer that serves us, we keep a copy of the credit it gives us, so that we only ask for what it will answer.
+ * Of one we serve, we keep the credit we give it.
+ */
+class LightPeer: public p2p::Capability
+{
+	friend class LightHost;
+
+public:
+	LightPeer(p2p::Session* _s, p2p::HostCapabilityFace* _h, unsigned _i);
+	virtual ~LightPeer();
+
+	static std::string name() { return "les"; }
+	static u256 version() { return c_lightProtocolVersion; }
+	static unsigned messageCount() { return LightPacketCount; }
+
+	LightHost* host() const;
+
+	/// @returns true once the peer has said, in its Status, that it serves.
+	bool isServer() const { Guard l(x_peer); return m_server; }
+	/// @returns the head of the peer's chain, as it last told us.
+	LightHead head() const;
+	/// @returns the credit the peer gives us, as far as we know.
+	uint64_t credit() const { return m_have.value(); }
+
+	/// Asks the peer a request @a _packet, of id @a _id, whose arguments after the id are the @a _args items of
+	/// @a _argsRLP, for @a _items items. The answer goes to the light client.
+	/// @returns false, asking nothing, if the peer does not serve or would not give us the credit for it.
+	bool ask(unsigned _packet, unsigned _id, bytes const& _argsRLP, unsigned _args, unsigned _items);
+
+private:
+	virtual bool interpret(unsigned _id, RLP const& _r) override;
+
+	/// Answers the request @a _r of packet @a _packet for @a _items items, if the peer has the credit for it, with the
+	/// packet @a _answer of the list @a _list of @a _count items.
+	void answer(unsigned _packet, RLP const& _r, unsigned _items, unsigned _answer, RLPStream const& _list, unsigned _count);
+	/// Sends the peer a Status, or an Announce if @a _announce, of our head.
+	void sendHead(bool _announce);
+
+	mutable Mutex x_peer;
+	bool m_server = false;
+	h256 m_headHash;
+	unsigned m_headNumber = 0;
+	u256 m_headDifficulty;
+	std::map<unsigned, uint64_t> m_asked;	///< The requests we have yet to be answered, and what each cost.
+
+	RequestCredit m_given;					///< The credit we give the peer, if we serve.
+	RequestCredit m_have;					///< The credit the peer gives us, if it serves.
+};
+
+}
+}
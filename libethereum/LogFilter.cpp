@@ -43,7 +43,7 @@ h256 LogFilter::sha3() const
 {
 	RLPStream s;
 	streamRLP(s);
-	return dev::sha3(s.out());
+	return dev::sha3(s.outRef());
 }
 
 static bool isNoLater(RelativeBlock _logBlockRelation, u256 _logBlockNumber, unsigned _latest)
@@ -115,14 +115,58 @@ LogEntries LogFilter::matches(TransactionReceipt const& _m) const
 	LogEntries ret;
 	if (matches(_m.bloom()))
 		for (LogEntry const& e: _m.log())
+			if (matches(e))
+				ret.push_back(e);
+	return ret;
+}
+
+bool LogFilter::matches(LogEntry const& _e) const
+{
+	if (!m_addresses.empty() && !m_addresses.count(_e.address))
+		return false;
+	for (unsigned i = 0; i < 4; ++i)
+		if (!m_topics[i].empty() && (_e.topics.size() <= i || !m_topics[i].count(_e.topics[i])))
+			return false;
+	return true;
+}
+
+void LogFilterIndex::insert(h256 const& _id, LogFilter const& _f)
+{
+	if (!_f.addresses().empty())
+		for (Address const& a: _f.addresses())
+			m_byAddress[a].insert(_id);
+	else if (!_f.topics()[0].empty())
+		for (h256 const& t: _f.topics()[0])
+			m_byTopic[t].insert(_id);
+	else
+		m_any.insert(_id);
+}
+
+void LogFilterIndex::erase(h256 const& _id, LogFilter const& _f)
+{
+	if (!_f.addresses().empty())
+		for (Address const& a: _f.addresses())
+		{
+			auto it = m_byAddress.find(a);
+			if (it != m_byAddress.end() && it->second.erase(_id) && it->second.empty())
+				m_byAddress.erase(it);
+		}
+	else if (!_f.topics()[0].empty())
+		for (h256 const& t: _f.topics()[0])
 		{
-			if (!m_addresses.empty() && !m_addresses.count(e.address))
-				goto continue2;
-			for (unsigned i = 0; i < 4; ++i)
-				if (!m_topics[i].empty() && (e.topics.size() < i || !m_topics[i].count(e.topics[i])))
-					goto continue2;
-			ret.push_back(e);
-			continue2:;
+			auto it = m_byTopic.find(t);
+			if (it != m_byTopic.end() && it->second.erase(_id) && it->second.empty())
+				m_byTopic.erase(it);
 		}
+	else
+		m_any.erase(_id);
+}
+
+vector<pair<Address, h256>> LogFilter::indexKeys() const
+{
+	vector<pair<Address, h256>> ret;
+	for (auto const& a: m_addresses)
+		for (auto const& t: m_topics[0])
+			ret.push_back(make_pair(a, t));
 	return ret;
 }
@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include <unordered_map>
 #include <libdevcore/Common.h>
 #include <libdevcore/RLP.h>
 #include <libethcore/Common.h>
@@ -58,6 +59,12 @@ public:
 	bool matches(LogBloom _bloom) const;
 	bool matches(State const& _s, unsigned _i) const;
 	LogEntries matches(TransactionReceipt const& _r) const;
+	bool matches(LogEntry const& _e) const;
+	/// @returns the (address, first topic) pairs of which any matching log has one, or none if the filter does not restrict both.
+	std::vector<std::pair<Address, h256>> indexKeys() const;
+
+	AddressSet const& addresses() const { return m_addresses; }
+	std::array<h256Set, 4> const& topics() const { return m_topics; }
 
 	LogFilter address(Address _a) { m_addresses.insert(_a); return *this; }
 	LogFilter topic(unsigned _index, h256 const& _t) { if (_index < 4) m_topics[_index].insert(_t); return *this; }
@@ -73,6 +80,42 @@ private:
 	unsigned m_latest = LatestBlock;
 };
 
+/**
+ * @brief Finds which of many filters may match a log without trying each in turn.
+ * A filter is kept under each of its addresses, or, if it has none, under each of its first topics, or else as
+ * one that may match any log. So each log is tried only against those filters it could match.
+ */
+class LogFilterIndex
+{
+public:
+	void insert(h256 const& _id, LogFilter const& _f);
+	void erase(h256 const& _id, LogFilter const& _f);
+	void clear() { m_byAddress.clear(); m_byTopic.clear(); m_any.clear(); }
+
+	/// Calls @a _f once with the id of each filter that may match @a _e; those it does not call certainly do not.
+	template <class _F> void forCandidates(LogEntry const& _e, _F const& _f) const
+	{
+		auto a = m_byAddress.find(_e.address);
+		if (a != m_byAddress.end())
+			for (h256 const& i: a->second)
+				_f(i);
+		if (!_e.topics.empty())
+		{
+			auto t = m_byTopic.find(_e.topics[0]);
+			if (t != m_byTopic.end())
+				for (h256 const& i: t->second)
+					_f(i);
+		}
+		for (h256 const& i: m_any)
+			_f(i);
+	}
+
+private:
+	std::unordered_map<Address, h256Set, Address::hash> m_byAddress;
+	std::unordered_map<h256, h256Set> m_byTopic;
+	h256Set m_any;
+};
+
 }
 
 }
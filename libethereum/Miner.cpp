@@ -32,7 +32,7 @@ Miner::~Miner() {}
 
 LocalMiner::LocalMiner(MinerHost* _host, unsigned _id):
 	AsyncMiner(_host, _id),
-	Worker("miner-" + toString(_id))
+	Worker("miner-" + toString(_id), 0)
 {
 	m_pow.reset(_host->turbo() ? new Ethash : (Ethash*)new EthashCPU);
 }
@@ -44,6 +44,18 @@ void LocalMiner::setup(MinerHost* _host, unsigned _id)
 	m_pow.reset(_host->turbo() ? new Ethash : (Ethash*)new EthashCPU);
 }
 
+void LocalMiner::noteStateChange()
+{
+	{
+		Guard l(x_status);
+		++m_stateChanges;
+		m_miningStatus = Preparing;
+	}
+	if (m_pow)
+		m_pow->abort();
+	m_statusChanged.notify_all();
+}
+
 void LocalMiner::doWork()
 {
 	// Do some mining.
@@ -51,11 +63,18 @@ void LocalMiner::doWork()
 	{
 		if (m_miningStatus == Preparing)
 		{
+			unsigned stateChanges;
+			{
+				Guard l(x_status);
+				stateChanges = m_stateChanges;
+			}
 			m_host->setupState(m_mineState);
-			if (m_host->force() || m_mineState.pending().size())
-				m_miningStatus = Mining;
-			else
-				m_miningStatus = Waiting;
+			{
+				Guard l(x_status);
+				// Otherwise the state changed again meanwhile and we prepare afresh.
+				if (stateChanges == m_stateChanges)
+					m_miningStatus = m_host->force() || m_mineState.pending().size() ? Mining : Waiting;
+			}
 
 			{
 				Guard l(x_mineInfo);
@@ -82,8 +101,8 @@ void LocalMiner::doWork()
 			if (mineInfo.completed)
 			{
 				m_mineState.completeMine();
-				m_host->onComplete();
 				m_miningStatus = Mined;
+				m_host->onComplete();
 			}
 			else
 				m_host->onProgressed();
@@ -91,6 +110,8 @@ void LocalMiner::doWork()
 	}
 	else
 	{
-		this_thread::sleep_for(chrono::milliseconds(100));
+		// Nothing to do until the state changes; the timeout only lets the worker notice being stopped.
+		unique_lock<Mutex> l(x_status);
+		m_statusChanged.wait_for(l, chrono::milliseconds(100), [&](){ return m_miningStatus != Waiting && m_miningStatus != Mined; });
 	}
 }
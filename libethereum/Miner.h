@@ -25,6 +25,7 @@
 #include <thread>
 #include <list>
 #include <atomic>
+#include <condition_variable>
 #include <libdevcore/Common.h>
 #include <libdevcore/Worker.h>
 #include <libethcore/Common.h>
@@ -109,14 +110,15 @@ protected:
  * blockData() can be used to retrieve the complete block, ready for insertion into the BlockChain.
  *
  * Information on the mining can be queried through miningProgress() and miningHistory().
+ * A state change abandons the nonces being tried at once, and wakes an idle miner, so no time is spent mining a stale
+ * header.
  * @threadsafe
- * @todo Signal Miner to restart once with condition variables.
  */
 class LocalMiner: public AsyncMiner, Worker
 {
 public:
 	/// Null constructor.
-	LocalMiner() {}
+	LocalMiner(): Worker("miner", 0) {}
 
 	/// Constructor.
 	LocalMiner(MinerHost* _host, unsigned _id = 0);
@@ -140,7 +142,7 @@ public:
 	void stop() { stopWorking(); }
 
 	/// Call to notify Miner of a state change.
-	virtual void noteStateChange() override { m_miningStatus = Preparing; }
+	virtual void noteStateChange() override;
 
 	/// @returns true iff the mining has been start()ed. It may still not be actually mining, depending on the host's turbo() & force().
 	bool isRunning() const override { return isWorking(); }
@@ -165,7 +167,10 @@ private:
 	virtual void doWork();
 
 	enum MiningStatus { Waiting, Preparing, Mining, Mined, Stopping, Stopped };
-	MiningStatus m_miningStatus = Waiting;	///< TODO: consider mutex/atomic variable.
+	std::atomic<MiningStatus> m_miningStatus{Waiting};
+	unsigned m_stateChanges = 0;			///< Bumped by each noteStateChange(), so that a stale setupState() is noticed.
+	Mutex x_status;							///< Lock for changes to m_miningStatus and m_stateChanges.
+	Condition m_statusChanged;					///< Signalled by noteStateChange().
 	State m_mineState;						///< The state on which we are mining, generally equivalent to m_postMine.
 	std::unique_ptr<EthashPoW> m_pow;		///< Our miner.
 
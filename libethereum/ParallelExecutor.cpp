@@ -0,0 +1,217 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file ParallelExecutor.cpp
+ * @date 2015
+ */
+
+#include "ParallelExecutor.h"
+#include <atomic>
+#include <thread>
+#include "Executive.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+	unsigned g_threads = 1;
+
+	/// @returns true if going from @a _base to @a _final creates, kills or re-codes the account.
+	bool replaces(Account const& _base, Account const& _final)
+	{
+		return !_base.isAlive() || !_final.isAlive() || _final.isFreshCode() || _final.codeHash() != _base.codeHash();
+	}
+}
+
+void ParallelExecutor::setThreads(unsigned _threads)
+{
+	g_threads = _threads;
+}
+
+unsigned ParallelExecutor::threads()
+{
+	return g_threads;
+}
+
+void ParallelExecutor::execute(DecodedTransactions const& _txs)
+{
+	// Speculation starts from the trie, so anything still cached must be in it.
+	m_s.commitSettled();
+	if (!m_s.m_cache.empty())
+		m_s.commit();
+
+	unsigned count = _txs.size();
+	vector<Speculation> speculations(count);
+	atomic<unsigned> next(0);
+	auto speculate = [&]()
+	{
+		State s(m_s);
+		for (unsigned i = next++; i < count; i = next++)
+		{
+			s.m_cache.clear();
+			try
+			{
+				run(s, _txs[i], speculations[i]);
+				speculations[i].cache = move(s.m_cache);
+				speculations[i].valid = true;
+			}
+			catch (...)
+			{
+				// Will be executed again, which reports the problem.
+			}
+		}
+	};
+
+	vector<thread> workers;
+	for (unsigned i = 1; i < min(g_threads, count); ++i)
+		workers.emplace_back(speculate);
+	speculate();
+	for (auto& w: workers)
+		w.join();
+
+	m_s.uncommitToMine();
+	unsigned reexecuted = 0;
+	for (unsigned i = 0; i < count; ++i)
+	{
+		Speculation& s = speculations[i];
+		if (s.valid && m_s.gasUsed() + (bigint)s.t.gas() <= m_s.m_currentBlock.gasLimit && !conflicts(s))
+			noteWrites(s.cache, s.access, true);
+		else
+		{
+			++reexecuted;
+			s = Speculation();
+			run(m_s, _txs[i], s);
+			noteWrites(m_s.m_cache, s.access, false);
+		}
+		commit(s);
+	}
+	clog(ParallelExecutorChannel) << count << "transactions executed," << reexecuted << "of them again after a conflict.";
+}
+
+void ParallelExecutor::run(State& _s, DecodedTransaction const& _tx, Speculation& io_s) const
+{
+	_s.m_access = &io_s.access;
+	try
+	{
+		io_s.t = _tx.get();
+		Executive e(_s, m_lastHashes, 0);
+		e.initialize(io_s.t);
+		if (!e.execute())
+#if ETH_VMTRACE
+			e.go(e.simpleTrace());
+#else
+			e.go();
+#endif
+		e.finalize();
+		io_s.gasUsed = e.gasUsed();
+		io_s.logs = e.logs();
+	}
+	catch (...)
+	{
+		_s.m_access = nullptr;
+		throw;
+	}
+	_s.m_access = nullptr;
+}
+
+bool ParallelExecutor::conflicts(Speculation const& _s) const
+{
+	for (auto const& i: _s.access.accounts)
+		if (m_written.count(i.first))
+			return true;
+	for (auto const& i: _s.access.storage)
+		if (m_writtenStorage.count(i.first))
+			return true;
+	// Replaced accounts are copied whole, so nothing else may have changed them.
+	for (auto const& i: _s.cache)
+		if (i.second.isDirty() && m_touched.count(i.first))
+		{
+			auto b = _s.access.accounts.find(i.first);
+			if (b == _s.access.accounts.end() || replaces(b->second, i.second))
+				return true;
+		}
+	return false;
+}
+
+void ParallelExecutor::noteWrites(std::map<Address, Account> const& _cache, StateAccess const& _access, bool _apply)
+{
+	for (auto const& i: _cache)
+	{
+		Account const& a = i.second;
+		if (!a.isDirty())
+			continue;
+
+		auto b = _access.accounts.find(i.first);
+		if (b == _access.accounts.end() || replaces(b->second, a))
+		{
+			m_written.insert(i.first);
+			m_touched.insert(i.first);
+			if (_apply)
+				m_s.m_cache[i.first] = a;
+			continue;
+		}
+
+		// Slots read are in the overlay too, so compare against what was read.
+		bool basic = a.nonce() != b->second.nonce() || a.balance() != b->second.balance();
+		vector<pair<u256, u256>> slots;
+		a.storageOverlay().forEach([&](StorageOverlay::Slot const& j)
+		{
+			auto r = _access.storage.find(make_pair(i.first, j.key));
+			if (r == _access.storage.end() || r->second != j.value)
+				slots.push_back(make_pair(j.key, j.value));
+		});
+		if (!basic && slots.empty())
+			continue;
+
+		m_touched.insert(i.first);
+		if (basic)
+			m_written.insert(i.first);
+		for (auto const& j: slots)
+			m_writtenStorage.insert(make_pair(i.first, j.first));
+
+		if (_apply)
+		{
+			// Earlier transactions may have changed the account's storage, so merge into the current one.
+			m_s.ensureCached(i.first, false, false);
+			Account& t = m_s.m_cache[i.first];
+			if (basic)
+			{
+				t.restoreNonce(a.nonce(), true);
+				t.restoreBalance(a.balance(), true);
+			}
+			for (auto const& j: slots)
+				t.setStorage(j.first, j.second);
+		}
+	}
+}
+
+void ParallelExecutor::commit(Speculation const& _s)
+{
+	Address coinbase = m_s.m_currentBlock.coinbaseAddress;
+	m_s.addBalance(coinbase, _s.access.fees);
+	m_written.insert(coinbase);
+	m_touched.insert(coinbase);
+
+	u256 startGasUsed = m_s.gasUsed();
+	if (!m_s.m_lazyRoots)
+		m_s.commit();
+	m_s.m_transactions.write().push_back(_s.t);
+	m_s.m_receipts.write().push_back(TransactionReceipt(m_s.m_lazyRoots ? h256() : m_s.rootHash(), startGasUsed + _s.gasUsed, _s.logs));
+	m_s.m_transactionSet.write().insert(_s.t.sha3());
+	if (m_s.m_lazyRoots)
+		m_s.settle();
+}
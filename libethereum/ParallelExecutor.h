@@ -0,0 +1,86 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file ParallelExecutor.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <set>
+#include <vector>
+#include "State.h"
+
+namespace dev
+{
+namespace eth
+{
+
+struct ParallelExecutorChannel: public LogChannel { static const char* name() { return "-P-"; } static const int verbosity = 4; };
+
+/**
+ * @brief Optimistically executes the transactions of a block on several threads.
+ * Each transaction is first run on its own copy of the state as it was at the start of the block, recording
+ * which accounts and storage slots it read. The results are then committed in block order; a transaction that
+ * read something written by an earlier transaction of the block (or that failed) is executed again on the real
+ * state. The outcome, including receipts and intermediate state roots, is the same as for State::execute.
+ */
+class ParallelExecutor
+{
+public:
+	ParallelExecutor(State& _s, LastHashes const& _lh): m_s(_s), m_lastHashes(_lh) {}
+
+	/// Execute the transactions @a _txs, appending them and their receipts to the state.
+	/// Throws as State::execute would for the first invalid transaction.
+	void execute(DecodedTransactions const& _txs);
+
+	/// Set the number of threads used to import blocks; 1 or less executes serially.
+	static void setThreads(unsigned _threads);
+	static unsigned threads();
+
+private:
+	struct Speculation
+	{
+		bool valid = false;							///< False if the transaction threw.
+		Transaction t;
+		StateAccess access;
+		std::map<Address, Account> cache;			///< The accounts as left by the transaction.
+		u256 gasUsed;
+		LogEntries logs;
+	};
+
+	/// Run the transaction @a _tx on @a _s, leaving its effects in the cache of @a _s and its accesses in @a io_s.
+	void run(State& _s, DecodedTransaction const& _tx, Speculation& io_s) const;
+
+	/// @returns true if @a _s read or replaced something written by a transaction committed before it.
+	bool conflicts(Speculation const& _s) const;
+
+	/// Record the changes in @a _cache relative to @a _access and, if @a _apply, merge them into the state.
+	void noteWrites(std::map<Address, Account> const& _cache, StateAccess const& _access, bool _apply);
+
+	/// Pay held back fees, commit (or settle) the state cache and append the transaction and its receipt.
+	void commit(Speculation const& _s);
+
+	State& m_s;
+	LastHashes const& m_lastHashes;
+
+	std::set<Address> m_written;							///< Accounts whose existence, nonce, balance or code changed.
+	std::set<Address> m_touched;							///< Accounts changed in any way.
+	std::set<std::pair<Address, u256>> m_writtenStorage;	///< Storage slots changed.
+};
+
+}
+}
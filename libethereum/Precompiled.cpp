@@ -21,6 +21,7 @@
 
 #include "Precompiled.h"
 
+#include <secp256k1/secp256k1.h>
 #include <libdevcrypto/SHA3.h>
 #include <libdevcrypto/Common.h>
 #include <libethcore/Common.h>
@@ -29,7 +30,7 @@ using namespace std;
 using namespace dev;
 using namespace dev::eth;
 
-static bytes ecrecoverCode(bytesConstRef _in)
+static void ecrecoverCode(bytesConstRef _in, SmallBytes& o_out)
 {
 	struct inType
 	{
@@ -42,54 +43,60 @@ static bytes ecrecoverCode(bytesConstRef _in)
 	memcpy(&in, _in.data(), min(_in.size(), sizeof(in)));
 
 	h256 ret;
+	o_out.assign(ret.ref());
 
 	if ((u256)in.v > 28)
-		return ret.asBytes();
+		return;
 	SignatureStruct sig(in.r, in.s, (byte)((int)(u256)in.v - 27));
 	if (!sig.isValid())
-		return ret.asBytes();
-
-	try
-	{
-		ret = dev::sha3(recover(sig, in.hash));
-	}
-	catch (...) {}
+		return;
+
+	// libsecp256k1 keeps its precomputed tables from the first start on; CryptoPP rebuilds its work per call.
+	static bool const s_started = [](){ secp256k1_start(); return true; }();
+	(void)s_started;
+	byte pubkey[65];
+	int pubkeyLength = 65;
+	Public p;
+	Signature rs = sig;
+	if (secp256k1_ecdsa_recover_compact(in.hash.data(), 32, rs.data(), pubkey, &pubkeyLength, 0, sig.v) && pubkeyLength == 65)
+		memcpy(p.data(), pubkey + 1, 64);
+	// As before, a signature with no key recovers the zero key.
+	ret = dev::sha3(p);
 
 	memset(ret.data(), 0, 12);
-	return ret.asBytes();
+	o_out.assign(ret.ref());
 }
 
-static bytes sha256Code(bytesConstRef _in)
+static void sha256Code(bytesConstRef _in, SmallBytes& o_out)
 {
-	bytes ret(32);
-	sha256(_in, &ret);
-	return ret;
+	o_out.resize(32);
+	sha256(_in, o_out.ref());
 }
 
-static bytes ripemd160Code(bytesConstRef _in)
+static void ripemd160Code(bytesConstRef _in, SmallBytes& o_out)
 {
-	bytes ret(32);
-	ripemd160(_in, &ret);
+	o_out.resize(32);
+	ripemd160(_in, o_out.ref());
 	// leaves the 20-byte hash left-aligned. we want it right-aligned:
-	memmove(ret.data() + 12, ret.data(), 20);
-	memset(ret.data(), 0, 12);
-	return ret;
+	memmove(o_out.data() + 12, o_out.data(), 20);
+	memset(o_out.data(), 0, 12);
 }
 
-static bytes identityCode(bytesConstRef _in)
+static void identityCode(bytesConstRef _in, SmallBytes& o_out)
 {
-	return _in.toBytes();
+	o_out.assign(_in);
 }
 
-static const std::map<unsigned, PrecompiledAddress> c_precompiled =
+PrecompiledRegistry& PrecompiledRegistry::get()
 {
-	{ 1, { [](bytesConstRef) -> bigint { return c_ecrecoverGas; }, ecrecoverCode }},
-	{ 2, { [](bytesConstRef i) -> bigint { return c_sha256Gas + (i.size() + 31) / 32 * c_sha256WordGas; }, sha256Code }},
-	{ 3, { [](bytesConstRef i) -> bigint { return c_ripemd160Gas + (i.size() + 31) / 32 * c_ripemd160WordGas; }, ripemd160Code }},
-	{ 4, { [](bytesConstRef i) -> bigint { return c_identityGas + (i.size() + 31) / 32 * c_identityWordGas; }, identityCode }}
-};
+	static PrecompiledRegistry s_this;
+	return s_this;
+}
 
-std::map<unsigned, PrecompiledAddress> const& dev::eth::precompiled()
+PrecompiledRegistry::PrecompiledRegistry()
 {
-	return c_precompiled;
+	add(1, { [](bytesConstRef) -> bigint { return c_ecrecoverGas; }, ecrecoverCode });
+	add(2, { [](bytesConstRef i) -> bigint { return c_sha256Gas + (i.size() + 31) / 32 * c_sha256WordGas; }, sha256Code });
+	add(3, { [](bytesConstRef i) -> bigint { return c_ripemd160Gas + (i.size() + 31) / 32 * c_ripemd160WordGas; }, ripemd160Code });
+	add(4, { [](bytesConstRef i) -> bigint { return c_identityGas + (i.size() + 31) / 32 * c_identityWordGas; }, identityCode });
 }
@@ -21,9 +21,11 @@
 
 #pragma once
 
-#include <map>
+#include <array>
 #include <functional>
 #include <libdevcore/CommonData.h>
+#include <libdevcrypto/Common.h>
+#include <libdevcore/SmallVector.h>
 
 namespace dev
 {
@@ -34,11 +36,40 @@ namespace eth
 struct PrecompiledAddress
 {
 	std::function<bigint(bytesConstRef)> gas;
-	std::function<bytes(bytesConstRef)> exec;
+	std::function<void(bytesConstRef, SmallBytes&)> exec;	///< Writes the output for the given input; inline for all but identity of a long input.
 };
 
-/// Info on precompiled contract accounts baked into the protocol.
-std::map<unsigned, PrecompiledAddress> const& precompiled();
+/**
+ * @brief The contracts run natively at addresses 1 to 255: those baked into the protocol, and any a private
+ * chain adds. Found by indexing an array with the address, rather than by a lookup.
+ * @not threadsafe: add contracts before any transaction is executed.
+ */
+class PrecompiledRegistry
+{
+public:
+	static PrecompiledRegistry& get();
+
+	/// @returns the contract at @a _a, or null if there is none.
+	PrecompiledAddress const* find(Address const& _a) const
+	{
+		// Only the last byte of a precompiled contract's address is not zero.
+		static const Address c_last(0xff);
+		if (_a != (_a & c_last))
+			return nullptr;
+		PrecompiledAddress const& ret = m_contracts[_a[Address::size - 1]];
+		return ret.exec ? &ret : nullptr;
+	}
+
+	/// Runs @a _contract at the address @a _n, in place of any contract already there.
+	void add(byte _n, PrecompiledAddress const& _contract) { m_contracts[_n] = _contract; }
+	/// Removes any contract at the address @a _n.
+	void remove(byte _n) { m_contracts[_n] = PrecompiledAddress(); }
+
+private:
+	PrecompiledRegistry();
+
+	std::array<PrecompiledAddress, 256> m_contracts;
+};
 
 }
 }
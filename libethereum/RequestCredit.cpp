@@ -0,0 +1,75 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file RequestCredit.cpp
+ * @date 2015
+ */
+
+#include "RequestCredit.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+void RequestCredit::reset(uint64_t _limit, uint64_t _rate)
+{
+	Guard l(x_credit);
+	m_limit = _limit;
+	m_rate = _rate;
+	m_value = _limit;
+	m_filled = Clock::now();
+}
+
+void RequestCredit::refill() const
+{
+	auto now = Clock::now();
+	m_value = min<double>(m_value + chrono::duration<double>(now - m_filled).count() * m_rate, m_limit);
+	m_filled = now;
+}
+
+uint64_t RequestCredit::value() const
+{
+	Guard l(x_credit);
+	refill();
+	return (uint64_t)m_value;
+}
+
+bool RequestCredit::spend(uint64_t _cost)
+{
+	Guard l(x_credit);
+	refill();
+	if (m_value < _cost)
+		return false;
+	m_value -= _cost;
+	return true;
+}
+
+void RequestCredit::set(uint64_t _value, uint64_t _since)
+{
+	Guard l(x_credit);
+	m_value = _value > _since ? min(_value - _since, m_limit) : 0;
+	m_filled = Clock::now();
+}
+
+RequestCredit::Clock::duration RequestCredit::waitFor(uint64_t _cost) const
+{
+	Guard l(x_credit);
+	refill();
+	if (m_value >= _cost)
+		return Clock::duration::zero();
+	if (!m_rate || _cost > m_limit)
+		return Clock::duration::max();
+	return chrono::duration_cast<Clock::duration>(chrono::duration<double>((_cost - m_value) / m_rate));
+}
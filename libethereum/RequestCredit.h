@@ -0,0 +1,74 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file RequestCredit.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief The credit a light server gives a peer for its requests.
+ * Each request spends its cost, and the credit refills at a steady rate up to a limit, so a peer may ask for a burst of
+ * up to the limit and then keep on at the rate. Unlike TokenBucket it never goes into debt: a request it cannot pay
+ * for is refused. A client keeps a copy of the credit a server gives it, set from what the server says is left in
+ * each answer, so that it only asks for what it will be given.
+ * @threadsafe
+ */
+class RequestCredit
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/// Starts full, at @a _limit, refilling at @a _rate a second.
+	RequestCredit(uint64_t _limit = 0, uint64_t _rate = 0) { reset(_limit, _rate); }
+
+	void reset(uint64_t _limit, uint64_t _rate);
+	uint64_t limit() const { Guard l(x_credit); return m_limit; }
+	uint64_t rate() const { Guard l(x_credit); return m_rate; }
+
+	/// @returns the credit there is now.
+	uint64_t value() const;
+	/// Takes @a _cost from the credit. @returns false, taking nothing, if there is not that much.
+	bool spend(uint64_t _cost);
+	/// Sets the credit to @a _value, as a server says it is, less @a _since spent on what it has not yet answered.
+	void set(uint64_t _value, uint64_t _since = 0);
+	/// @returns how long until there is @a _cost of credit; zero if there is already, the greatest duration if there
+	/// never will be.
+	Clock::duration waitFor(uint64_t _cost) const;
+
+private:
+	/// Brings m_value up to now. Must hold x_credit.
+	void refill() const;
+
+	mutable Mutex x_credit;
+	uint64_t m_limit = 0;
+	uint64_t m_rate = 0;
+	mutable double m_value = 0;
+	mutable Clock::time_point m_filled;		///< When m_value was last brought up to date.
+};
+
+}
+}
@@ -21,13 +21,16 @@
 
 #include "State.h"
 
+#include <chrono>
 #include <ctime>
 #include <random>
 #include <boost/filesystem.hpp>
 #include <boost/timer.hpp>
 #include <secp256k1/secp256k1.h>
 #include <libdevcore/CommonIO.h>
+#include <libdevcore/Arena.h>
 #include <libdevcore/Assertions.h>
+#include <libdevcore/Metrics.h>
 #include <libdevcore/StructuredLogger.h>
 #include <libevmcore/Instruction.h>
 #include <libethcore/Exceptions.h>
@@ -38,6 +41,8 @@
 #include "Executive.h"
 #include "CachedAddressState.h"
 #include "CanonBlockChain.h"
+#include "ParallelExecutor.h"
+#include "StoragePrefetcher.h"
 using namespace std;
 using namespace dev;
 using namespace dev::eth;
@@ -51,15 +56,16 @@ OverlayDB State::openDB(std::string _path, WithExisting _we)
 {
 	if (_path.empty())
 		_path = Defaults::get()->m_dbPath;
-	boost::filesystem::create_directory(_path);
-
-	if (_we == WithExisting::Kill)
-		boost::filesystem::remove_all(_path + "/state");
+	DBOptions const& o = Defaults::dbOptions(DBRole::State);
+	bool inMemory = o.backend == DBBackend::Memory || isMemoryDBPath(_path);
+	if (!inMemory)
+	{
+		boost::filesystem::create_directory(_path);
+		if (_we == WithExisting::Kill)
+			boost::filesystem::remove_all(_path + "/state");
+	}
 
-	ldb::Options o;
-	o.create_if_missing = true;
-	ldb::DB* db = nullptr;
-	ldb::DB::Open(o, _path + "/state", &db);
+	auto db = KeyValueDB::open(_path + "/state", o);
 	if (!db)
 	{
 		if (boost::filesystem::space(_path + "/state").available < 1024)
@@ -74,8 +80,11 @@ OverlayDB State::openDB(std::string _path, WithExisting _we)
 		}
 	}
 
-	cnote << "Opened state DB.";
-	return OverlayDB(db);
+	cnote << "Opened state DB:" << (inMemory ? toString(DBBackend::Memory) : toString(o.backend));
+	OverlayDB ret(db);
+	if (!ret.setPruning(Defaults::get()->m_pruneHistory, Defaults::get()->m_pruneCheckpoints))
+		cwarn << "State DB holds state written without pruning, so it will not be pruned. Kill the blockchain to start afresh with pruning.";
+	return ret;
 }
 
 State::State(OverlayDB const& _db, BaseState _bs, Address _coinbaseAddress):
@@ -92,11 +101,17 @@ State::State(OverlayDB const& _db, BaseState _bs, Address _coinbaseAddress):
 
 	if (_bs == BaseState::CanonGenesis)
 	{
-		dev::eth::commit(genesisState(), m_db, m_state);
-		m_db.commit();
+		m_previousBlock = CanonBlockChain::genesis();
+		// A DB that has been opened before already holds it, as every node is kept while the root above it is.
+		if (m_db.exists(m_previousBlock.stateRoot))
+			m_state.setRoot(m_previousBlock.stateRoot);
+		else
+		{
+			dev::eth::commit(genesisState(), m_db, m_state);
+			m_db.commit();
+		}
 
 		paranoia("after DB commit of Genesis construction.", true);
-		m_previousBlock = CanonBlockChain::genesis();
 	}
 	else
 		m_previousBlock.clear();
@@ -152,6 +167,7 @@ State::State(State const& _s):
 	m_receipts(_s.m_receipts),
 	m_transactionSet(_s.m_transactionSet),
 	m_cache(_s.m_cache),
+	m_settled(_s.m_settled),
 	m_previousBlock(_s.m_previousBlock),
 	m_currentBlock(_s.m_currentBlock),
 	m_ourAddress(_s.m_ourAddress),
@@ -184,6 +200,7 @@ State& State::operator=(State const& _s)
 	m_receipts = _s.m_receipts;
 	m_transactionSet = _s.m_transactionSet;
 	m_cache = _s.m_cache;
+	m_settled = _s.m_settled;
 	m_previousBlock = _s.m_previousBlock;
 	m_currentBlock = _s.m_currentBlock;
 	m_ourAddress = _s.m_ourAddress;
@@ -203,31 +220,28 @@ StateDiff State::diff(State const& _c) const
 {
 	StateDiff ret;
 
+	// Accounts can differ only where the tries do or where either state has them cached; to diff pending
+	// transactions both tries are those of one block, a transaction apart, so little of them differs.
 	std::set<Address> ads;
-	std::set<Address> trieAds;
-	std::set<Address> trieAdsD;
-
-	auto trie = SecureTrieDB<Address, OverlayDB>(const_cast<OverlayDB*>(&m_db), rootHash());
-	auto trieD = SecureTrieDB<Address, OverlayDB>(const_cast<OverlayDB*>(&_c.m_db), _c.rootHash());
-
-	for (auto i: trie)
-		ads.insert(i.first), trieAds.insert(i.first);
-	for (auto i: trieD)
-		ads.insert(i.first), trieAdsD.insert(i.first);
-	for (auto i: m_cache)
+	for (auto const& i: m_cache)
 		ads.insert(i.first);
-	for (auto i: _c.m_cache)
+	for (auto const& i: _c.m_cache)
 		ads.insert(i.first);
 
-//	cnote << *this;
-//	cnote << _c;
+	auto trie = SecureTrieDB<Address, OverlayDB>(const_cast<OverlayDB*>(&m_db), rootHash());
+	auto trieD = SecureTrieDB<Address, OverlayDB>(const_cast<OverlayDB*>(&_c.m_db), _c.rootHash());
+#if ETH_FATDB
+	// Only the fat trie, keyed by address, can say which accounts its keys are of.
+	if (rootHash() != _c.rootHash())
+		trie.diff(trieD, [&](bytes const& _k){ ads.insert(Address(_k)); });
+#endif
 
 	for (auto i: ads)
 	{
 		auto it = m_cache.find(i);
 		auto itD = _c.m_cache.find(i);
-		CachedAddressState source(trieAds.count(i) ? trie.at(i) : "", it != m_cache.end() ? &it->second : nullptr, &m_db);
-		CachedAddressState dest(trieAdsD.count(i) ? trieD.at(i) : "", itD != _c.m_cache.end() ? &itD->second : nullptr, &_c.m_db);
+		CachedAddressState source(trie.at(i), it != m_cache.end() ? &it->second : nullptr, &m_db);
+		CachedAddressState dest(trieD.at(i), itD != _c.m_cache.end() ? &itD->second : nullptr, &_c.m_db);
 		AccountDiff acd = source.diff(dest);
 		if (acd.changed())
 			ret.accounts[i] = acd;
@@ -238,6 +252,12 @@ StateDiff State::diff(State const& _c) const
 
 void State::ensureCached(Address _a, bool _requireCode, bool _forceCreate) const
 {
+	if (m_trace)
+	{
+		m_trace->noteAccount(_a, AccessSet::Read);
+		if (_requireCode)
+			m_trace->noteCode(_a);
+	}
 	ensureCached(m_cache, _a, _requireCode, _forceCreate);
 }
 
@@ -246,8 +266,19 @@ void State::ensureCached(std::map<Address, Account>& _cache, Address _a, bool _r
 	auto it = _cache.find(_a);
 	if (it == _cache.end())
 	{
-		// populate basic info.
-		string stateBack = m_state.at(_a);
+		// populate basic info, from the flat index if it knows the account.
+		string stateBack;
+		StateSnapshot* snapshot = m_db.snapshot();
+		if (!snapshot->account(m_state.rootHash(), _a, stateBack))
+		{
+			stateBack = m_state.at(_a);
+			snapshot->noteAccount(m_state.rootHash(), _a, stateBack);
+		}
+		if (m_access && &_cache == &m_cache && !m_access->accounts.count(_a))
+		{
+			RLP state(stateBack);
+			m_access->accounts[_a] = state.isNull() ? Account() : Account(state[0].toInt<u256>(), state[1].toInt<u256>(), state[2].toHash<h256>(), state[3].toHash<h256>(), Account::Unchanged);
+		}
 		if (stateBack.empty() && !_forceCreate)
 			return;
 		RLP state(stateBack);
@@ -260,15 +291,78 @@ void State::ensureCached(std::map<Address, Account>& _cache, Address _a, bool _r
 		tie(it, ok) = _cache.insert(make_pair(_a, s));
 	}
 	if (_requireCode && it != _cache.end() && !it->second.isFreshCode() && !it->second.codeCacheValid())
-		it->second.noteCode(it->second.codeHash() == EmptySHA3 ? bytesConstRef() : bytesConstRef(m_db.lookup(it->second.codeHash())));
+	{
+		h256 ch = it->second.codeHash();
+		it->second.noteCode(ch == EmptySHA3 ? CodeStore::empty() : CodeStore::get().code(ch, [&]() { return asBytes(m_db.lookup(ch)); }));
+	}
 }
 
 void State::commit()
 {
+	static MetricHistogram& s_commitTime = Metrics::get().histogram("eth_state_commit_seconds", "Time to commit changed accounts to the state trie.");
+	MetricTimer commitTimer(s_commitTime);
 	dev::eth::commit(m_cache, m_db, m_state);
 	m_cache.clear();
 }
 
+void State::settle()
+{
+	map<Address, Account> changes;
+	bool died = false;
+	for (auto i = m_cache.begin(); i != m_cache.end();)
+		if (!i->second.isDirty())
+			++i;
+		else
+		{
+			changes.insert(make_pair(i->first, i->second.changes()));
+			if (i->second.isAlive())
+			{
+				i->second.settle();
+				++i;
+			}
+			else
+			{
+				died = true;
+				i = m_cache.erase(i);
+			}
+		}
+	m_settled.push_back(move(changes));
+	if (died)
+		commitSettled();
+}
+
+void State::commitSettled()
+{
+	if (m_settled.empty())
+		return;
+	static MetricHistogram& s_commitTime = Metrics::get().histogram("eth_state_commit_seconds", "Time to commit changed accounts to the state trie.");
+	MetricTimer commitTimer(s_commitTime);
+
+	// Each transaction's accounts lie over the storage roots left by those before it.
+	map<Address, h256> roots;
+	auto& receipts = m_receipts.write();
+	size_t r = receipts.size() - m_settled.size();
+	for (auto& changes: m_settled)
+	{
+		for (auto& i: changes)
+		{
+			auto it = roots.find(i.first);
+			if (it != roots.end() && i.second.isAlive())
+				i.second.rebase(it->second);
+		}
+		dev::eth::commit(changes, m_db, m_state, &roots);
+		receipts[r++].setStateRoot(m_state.root());
+	}
+	m_settled.clear();
+
+	for (auto const& i: roots)
+	{
+		auto it = m_cache.find(i.first);
+		if (it != m_cache.end())
+			it->second.rebase(i.second);
+	}
+}
+
 bool State::sync(BlockChain const& _bc)
 {
 	return sync(_bc, _bc.currentHash());
@@ -355,7 +449,7 @@ bool State::sync(BlockChain const& _bc, h256 _block, BlockInfo const& _bi)
 	return ret;
 }
 
-u256 State::enactOn(bytesConstRef _block, BlockInfo const& _bi, BlockChain const& _bc)
+u256 State::enactOn(bytesConstRef _block, BlockInfo const& _bi, BlockChain const& _bc, bool _verified)
 {
 #if ETH_TIMED_ENACTMENTS
 	boost::timer t;
@@ -392,7 +486,7 @@ u256 State::enactOn(bytesConstRef _block, BlockInfo const& _bi, BlockChain const
 #endif
 
 	m_previousBlock = biParent;
-	auto ret = enact(_block, _bc);
+	auto ret = enact(_block, _bc, !_verified, !_verified);
 
 #if ETH_TIMED_ENACTMENTS
 	enactment = t.elapsed();
@@ -419,10 +513,11 @@ map<Address, u256> State::addresses() const
 
 void State::resetCurrent()
 {
-	m_transactions.clear();
-	m_receipts.clear();
-	m_transactionSet.clear();
+	m_transactions.reset();
+	m_receipts.reset();
+	m_transactionSet.reset();
 	m_cache.clear();
+	m_settled.clear();
 	m_currentBlock = BlockInfo();
 	m_currentBlock.coinbaseAddress = m_ourAddress;
 	m_currentBlock.timestamp = max(m_previousBlock.timestamp + 1, (u256)time(0));
@@ -447,7 +542,7 @@ bool State::cull(TransactionQueue& _tq) const
 	auto ts = _tq.transactions();
 	for (auto const& i: ts)
 	{
-		if (!m_transactionSet.count(i.first))
+		if (!m_transactionSet->count(i.first))
 		{
 			try
 			{
@@ -467,78 +562,124 @@ bool State::cull(TransactionQueue& _tq) const
 	return ret;
 }
 
-TransactionReceipts State::sync(BlockChain const& _bc, TransactionQueue& _tq, GasPricer const& _gp, bool* o_transactionQueueChanged)
+TransactionReceipts State::sync(BlockChain const& _bc, TransactionQueue& _tq, GasPricer const& _gp, bool* o_transactionQueueChanged, unsigned _msTimeLimit, bool* o_timedOut)
 {
 	// TRANSACTIONS
 	TransactionReceipts ret;
-	auto ts = _tq.transactions();
 
 	LastHashes lh;
-
-	for (int goodTxs = 1; goodTxs;)
+	auto deadline = chrono::steady_clock::now() + chrono::milliseconds(_msTimeLimit);
+	auto dropped = [&](h256 const& _h)
 	{
-		goodTxs = 0;
-		for (auto const& i: ts)
-			if (!m_transactionSet.count(i.first))
+		_tq.drop(_h);
+		if (o_transactionQueueChanged)
+			*o_transactionQueueChanged = true;
+	};
+
+	// The queue gives each sender's transactions in nonce order, highest gas price first, so one pass takes all that
+	// can go in, best paying first, unless executing some promotes others of their senders from the future.
+	for (bool promoted = true; promoted;)
+	{
+		promoted = false;
+		// Senders one of whose transactions could not go in; their later ones cannot either.
+		set<Address> stalled;
+		for (auto const& i: _tq.topTransactions())
+		{
+			// Not even the cheapest transaction fits in what is left of the block.
+			if (gasLimitRemaining() < c_txGas)
+				return ret;
+			if (_msTimeLimit && chrono::steady_clock::now() > deadline)
 			{
-				try
+				if (o_timedOut)
+					*o_timedOut = true;
+				return ret;
+			}
+
+			Transaction const& t = i.second;
+			if (m_transactionSet->count(i.first) || stalled.count(t.sender()))
+				continue;
+			try
+			{
+				// Screen out, before executing it, what would fail at once; executing throws on it, which is dearer.
+				if (t.gasPrice() < _gp.ask(*this) || t.gas() > gasLimitRemaining())
 				{
-					if (i.second.gasPrice() >= _gp.ask(*this))
-					{
-	//					boost::timer t;
-						if (lh.empty())
-							lh = _bc.lastHashes();
-						execute(lh, i.second);
-						ret.push_back(m_receipts.back());
-						_tq.noteGood(i);
-						++goodTxs;
-	//					cnote << "TX took:" << t.elapsed() * 1000;
-					}
+					// Stays current, for the next block.
+					stalled.insert(t.sender());
+					continue;
 				}
-#if ETH_DEBUG
-				catch (InvalidNonce const& in)
+				u256 nonceReq = transactionsFrom(t.sender());
+				if (t.nonce() < nonceReq || !t.checkPayment())
 				{
-					bigint const* req = boost::get_error_info<errinfo_required>(in);
-					bigint const* got = boost::get_error_info<errinfo_got>(in);
-
-					if (*req > *got)
-					{
-						// too old
-						_tq.drop(i.first);
-						if (o_transactionQueueChanged)
-							*o_transactionQueueChanged = true;
-					}
-					else
-						_tq.setFuture(i);
+					dropped(i.first);
+					continue;
 				}
-				catch (BlockGasLimitReached const& e)
+				if (t.nonce() > nonceReq)
 				{
 					_tq.setFuture(i);
+					stalled.insert(t.sender());
+					continue;
 				}
-#endif
-				catch (Exception const& _e)
+				if (balance(t.sender()) < (bigint)t.gas() * t.gasPrice() + t.value())
 				{
-					// Something else went wrong - drop it.
-					_tq.drop(i.first);
-					if (o_transactionQueueChanged)
-						*o_transactionQueueChanged = true;
-					cnote << "Dropping invalid transaction:";
-					cnote << diagnostic_information(_e);
-				}
-				catch (std::exception const&)
-				{
-					// Something else went wrong - drop it.
-					_tq.drop(i.first);
-					if (o_transactionQueueChanged)
-						*o_transactionQueueChanged = true;
-					cnote << "Transaction caused low-level exception :(";
+					dropped(i.first);
+					stalled.insert(t.sender());
+					continue;
 				}
+
+//				boost::timer t;
+				if (lh.empty())
+					lh = _bc.lastHashes();
+				execute(lh, t);
+				ret.push_back(m_receipts->back());
+				promoted = _tq.noteGood(i) || promoted;
+//				cnote << "TX took:" << t.elapsed() * 1000;
 			}
+			catch (BlockGasLimitReached const&)
+			{
+				// Stays current, for the next block.
+				stalled.insert(t.sender());
+			}
+			catch (Exception const& _e)
+			{
+				// Something else went wrong - drop it.
+				dropped(i.first);
+				stalled.insert(t.sender());
+				cnote << "Dropping invalid transaction:";
+				cnote << diagnostic_information(_e);
+			}
+			catch (std::exception const&)
+			{
+				// Something else went wrong - drop it.
+				dropped(i.first);
+				stalled.insert(t.sender());
+				cnote << "Transaction caused low-level exception :(";
+			}
+		}
 	}
 	return ret;
 }
 
-u256 State::enact(bytesConstRef _block, BlockChain const& _bc, bool _checkNonce)
+TransactionReceipts State::replay(BlockChain const& _bc, Transactions const& _ts)
+{
+	TransactionReceipts ret;
+	LastHashes lh;
+	for (auto const& t: _ts)
+		if (!m_transactionSet->count(t.sha3()))
+			try
+			{
+				if (lh.empty())
+					lh = _bc.lastHashes();
+				execute(lh, t);
+				ret.push_back(m_receipts->back());
+			}
+			catch (Exception const&)
+			{
+				// In the new head already, or no longer valid; the queue will have it dropped or culled.
+			}
+	return ret;
+}
+
+u256 State::enact(bytesConstRef _block, BlockChain const& _bc, bool _checkNonce, bool _checkInternals)
 {
 	// m_currentBlock is assumed to be prepopulated and reset.
 
@@ -555,7 +696,8 @@ u256 State::enact(bytesConstRef _block, BlockChain const& _bc, bool _checkNonce)
 
 	// Populate m_currentBlock with the correct values.
 	m_currentBlock = bi;
-	m_currentBlock.verifyInternals(_block);
+	if (_checkInternals)
+		m_currentBlock.verifyInternals(_block);
 	m_currentBlock.noteDirty();
 
 //	cnote << "playback begins:" << m_state.root();
@@ -573,20 +715,54 @@ u256 State::enact(bytesConstRef _block, BlockChain const& _bc, bool _checkNonce)
 	RLP rlp(_block);
 
 	// All ok with the block generally. Play back the transactions now...
+	DecodedTransactions txs = decodeTransactions(rlp[1]);
+
+	// Read what the contracts called are likely to load while the first transactions run.
+	vector<Address> called;
+	for (auto const& t: txs)
+		if (!t.error && !t.transaction.isCreation())
+			called.push_back(t.transaction.receiveAddress());
+	StoragePrefetcher::get().prefetch(m_db, rootHash(), called);
+
+	// The transactions keep the cache between them; the root each leaves, which its receipt records, is computed
+	// after them all.
+	{
+		m_lazyRoots = true;
+		ScopeGuard lazy([&]() { m_lazyRoots = false; });
+		if (ParallelExecutor::threads() > 1 && txs.size() > 1)
+			ParallelExecutor(*this, lh).execute(txs);
+		else
+			for (auto const& t: txs)
+				execute(lh, t.get());
+	}
+	commitSettled();
+
+	// The keys and receipts live only until the tries are built, so they go in an arena which each block on this
+	// thread reuses, rather than in as many small allocations. The transactions are already in _block.
+	static thread_local Arena s_arena;
+	s_arena.reset();
+	using Changes = ArenaVector<pair<bytesConstRef, bytesConstRef>>;
+	Changes transactions{ArenaAllocator<Changes::value_type>(s_arena)};
+	Changes receipts{ArenaAllocator<Changes::value_type>(s_arena)};
+	transactions.reserve(txs.size());
+	receipts.reserve(txs.size());
+	RLPStream s;
 	unsigned i = 0;
 	for (auto const& tr: rlp[1])
 	{
-		RLPStream k;
-		k << i;
+		s.clear();
+		s << i;
+		bytesConstRef k = s_arena.copy(s.outRef());
 
-		transactionsTrie.insert(&k.out(), tr.data());
-		execute(lh, Transaction(tr.data(), CheckTransaction::Everything));
+		transactions.push_back(make_pair(k, tr.data()));
 
-		RLPStream receiptrlp;
-		m_receipts.back().streamRLP(receiptrlp);
-		receiptsTrie.insert(&k.out(), &receiptrlp.out());
+		s.clear();
+		(*m_receipts)[i].streamRLP(s);
+		receipts.push_back(make_pair(k, s_arena.copy(s.outRef())));
 		++i;
 	}
+	transactionsTrie.apply(transactions);
+	receiptsTrie.apply(receipts);
 
 	if (receiptsTrie.root() != m_currentBlock.receiptsRoot)
 	{
@@ -598,7 +774,7 @@ u256 State::enact(bytesConstRef _block, BlockChain const& _bc, bool _checkNonce)
 		{
 			RLPStream k;
 			k << j;
-			auto b = asBytes(receiptsTrie.at(&k.out()));
+			auto b = asBytes(receiptsTrie.at(k.outRef()));
 			cwarn << j << ": ";
 			cwarn << "RLP: " << RLP(b);
 			cwarn << "Hex: " << toHex(b);
@@ -690,7 +866,7 @@ void State::cleanup(bool _fullCommit)
 		paranoia("immediately before database commit", true);
 
 		// Commit the new trie to disk.
-		m_db.commit();
+		m_db.commit((unsigned)m_currentBlock.number, m_currentBlock.hash());
 
 		paranoia("immediately after database commit", true);
 		m_previousBlock = m_currentBlock;
@@ -709,10 +885,10 @@ void State::uncommitToMine()
 	if (m_committedToMine)
 	{
 		m_cache.clear();
-		if (!m_transactions.size())
+		if (!m_transactions->size())
 			m_state.setRoot(m_previousBlock.stateRoot);
 		else
-			m_state.setRoot(m_receipts.back().stateRoot());
+			m_state.setRoot(m_receipts->back().stateRoot());
 		m_db = m_lastTx;
 		paranoia("Uncommited to mine", true);
 		m_committedToMine = false;
@@ -759,7 +935,7 @@ bool State::amIJustParanoid(BlockChain const& _bc)
 LogBloom State::logBloom() const
 {
 	LogBloom ret;
-	for (TransactionReceipt const& i: m_receipts)
+	for (TransactionReceipt const& i: *m_receipts)
 		ret |= i.bloom();
 	return ret;
 }
@@ -784,22 +960,12 @@ void State::commitToMine(BlockChain const& _bc)
 	{
 		// Find great-uncles (or second-cousins or whatever they are) - children of great-grandparents, great-great-grandparents... that were not already uncles in previous generations.
 //		cout << "Checking " << m_previousBlock.hash << ", parent=" << m_previousBlock.parentHash << endl;
-		set<h256> knownUncles = _bc.allUnclesFrom(m_currentBlock.parentHash);
-		auto p = m_previousBlock.parentHash;
-		for (unsigned gen = 0; gen < 6 && p != _bc.genesisHash() && unclesCount < 2; ++gen, p = _bc.details(p).parent)
+		for (auto const& u: _bc.uncleCandidates(m_currentBlock.parentHash))
 		{
-			auto us = _bc.details(p).children;
-			assert(us.size() >= 1);	// must be at least 1 child of our grandparent - it's our own parent!
-			for (auto const& u: us)
-				if (!knownUncles.count(u))	// ignore any uncles/mainline blocks that we know about.
-				{
-					BlockInfo ubi(_bc.block(u));
-					ubi.streamRLP(unclesData, WithNonce);
-					++unclesCount;
-					uncleBlockHeaders.push_back(ubi);
-					if (unclesCount == 2)
-						break;
-				}
+			BlockInfo ubi = _bc.info(u);
+			ubi.streamRLP(unclesData, WithNonce);
+			++unclesCount;
+			uncleBlockHeaders.push_back(ubi);
 		}
 	}
 
@@ -811,26 +977,26 @@ void State::commitToMine(BlockChain const& _bc)
 	GenericTrieDB<MemoryDB> receiptsTrie(&rm);
 	receiptsTrie.init();
 
-	RLPStream txs;
-	txs.appendList(m_transactions.size());
-
-	for (unsigned i = 0; i < m_transactions.size(); ++i)
+	std::map<bytes, bytes> transactions;
+	std::map<bytes, bytes> receipts;
+	vector<bytes const*> txrlps;
+	for (unsigned i = 0; i < m_transactions->size(); ++i)
 	{
-		RLPStream k;
-		k << i;
-
-		RLPStream receiptrlp;
-		m_receipts[i].streamRLP(receiptrlp);
-		receiptsTrie.insert(&k.out(), &receiptrlp.out());
-
-		RLPStream txrlp;
-		m_transactions[i].streamRLP(txrlp);
-		transactionsTrie.insert(&k.out(), &txrlp.out());
-
-		txs.appendRaw(txrlp.out());
+		bytes k = rlp(i);
+		receipts[k] = (*m_receipts)[i].rlp();
+		bytes& txrlp = transactions[k];
+		txrlp = (*m_transactions)[i].rlp();
+		txrlps.push_back(&txrlp);
 	}
+	receiptsTrie.apply(receipts);
+	transactionsTrie.apply(transactions);
 
-	txs.swapOut(m_currentTxs);
+	m_currentTxs = rlpExact([&](RLPStream& _s)
+	{
+		_s.appendList(txrlps.size());
+		for (auto t: txrlps)
+			_s.appendRaw(*t);
+	});
 
 	RLPStream(unclesCount).appendRaw(unclesData.out(), unclesCount).swapOut(m_currentUncles);
 
@@ -852,6 +1018,7 @@ void State::commitToMine(BlockChain const& _bc)
 	m_currentBlock.gasUsed = gasUsed();
 	m_currentBlock.stateRoot = m_state.root();
 	m_currentBlock.parentHash = m_previousBlock.hash();
+	m_currentBlock.noteDirty();
 
 	m_committedToMine = true;
 }
@@ -876,12 +1043,13 @@ void State::completeMine()
 	// Got it!
 
 	// Compile block:
-	RLPStream ret;
-	ret.appendList(3);
-	m_currentBlock.streamRLP(ret, WithNonce);
-	ret.appendRaw(m_currentTxs);
-	ret.appendRaw(m_currentUncles);
-	ret.swapOut(m_currentBytes);
+	m_currentBytes = rlpExact([&](RLPStream& _s)
+	{
+		_s.appendList(3);
+		m_currentBlock.streamRLP(_s, WithNonce);
+		_s.appendRaw(m_currentTxs);
+		_s.appendRaw(m_currentUncles);
+	});
 	m_currentBlock.noteDirty();
 	cnote << "Mined " << m_currentBlock.hash().abridged() << "(parent: " << m_currentBlock.parentHash.abridged() << ")";
 	StructuredLogger::minedNewBlock(
@@ -893,9 +1061,9 @@ void State::completeMine()
 
 	// Quickly reset the transactions.
 	// TODO: Leave this in a better state than this limbo, or at least record that it's in limbo.
-	m_transactions.clear();
-	m_receipts.clear();
-	m_transactionSet.clear();
+	m_transactions.reset();
+	m_receipts.reset();
+	m_transactionSet.reset();
 	m_lastTx = m_db;
 }
 
@@ -934,10 +1102,14 @@ void State::noteSending(Address _id)
 	{
 		cwarn << "Sending from non-existant account. How did it pay!?!";
 		// this is impossible. but we'll continue regardless...
-		m_cache[_id] = Account(1, 0);
+		setAccount(_id, Account(1, 0));
 	}
 	else
+	{
+		traceWrite(_id);
+		journal(AccountChange::Nonce, _id);
 		it->second.incNonce();
+	}
 }
 
 void State::addBalance(Address _id, u256 _amount)
@@ -945,9 +1117,13 @@ void State::addBalance(Address _id, u256 _amount)
 	ensureCached(_id, false, false);
 	auto it = m_cache.find(_id);
 	if (it == m_cache.end())
-		m_cache[_id] = Account(_amount, Account::NormalCreation);
+		setAccount(_id, Account(_amount, Account::NormalCreation));
 	else
+	{
+		traceWrite(_id);
+		journal(AccountChange::Balance, _id);
 		it->second.addBalance(_amount);
+	}
 }
 
 void State::subBalance(Address _id, bigint _amount)
@@ -957,7 +1133,88 @@ void State::subBalance(Address _id, bigint _amount)
 	if (it == m_cache.end() || (bigint)it->second.balance() < _amount)
 		BOOST_THROW_EXCEPTION(NotEnoughCash());
 	else
+	{
+		traceWrite(_id);
+		journal(AccountChange::Balance, _id);
 		it->second.addBalance(-_amount);
+	}
+}
+
+void State::setStorage(Address _contract, u256 _location, u256 _value)
+{
+	if (m_trace)
+		m_trace->noteStorage(_contract, _location, AccessSet::Written);
+	journal(AccountChange::Storage, _contract, _location);
+	m_cache[_contract].setStorage(_location, _value);
+}
+
+void State::journal(AccountChange::Kind _kind, Address const& _a, u256 const& _key)
+{
+	if (!m_checkpoints)
+		return;
+	auto it = m_cache.find(_a);
+	if (it == m_cache.end())
+	{
+		m_journal.push_back(AccountChange{AccountChange::Created, _a, false, false, 0, 0, nullptr});
+		return;
+	}
+	if (_kind == AccountChange::Created)
+		return;
+	Account const& a = it->second;
+	AccountChange c{_kind, _a, a.isDirty(), false, _key, 0, nullptr};
+	switch (_kind)
+	{
+	case AccountChange::Replaced:
+		c.account.reset(new Account(a));
+		break;
+	case AccountChange::Balance:
+		c.value = a.balance();
+		break;
+	case AccountChange::Nonce:
+		c.value = a.nonce();
+		break;
+	case AccountChange::Storage:
+	{
+		auto s = a.storageOverlay().find(_key);
+		if ((c.hadKey = s))
+			c.value = s->value;
+		break;
+	}
+	default:
+		break;
+	}
+	m_journal.push_back(move(c));
+}
+
+void State::revertToCheckpoint(size_t _checkpoint)
+{
+	for (; m_journal.size() > _checkpoint; m_journal.pop_back())
+	{
+		AccountChange& c = m_journal.back();
+		if (c.kind == AccountChange::Created)
+		{
+			m_cache.erase(c.address);
+			continue;
+		}
+		Account& a = m_cache[c.address];
+		switch (c.kind)
+		{
+		case AccountChange::Replaced:
+			a = move(*c.account);
+			break;
+		case AccountChange::Balance:
+			a.restoreBalance(c.value, c.wasDirty);
+			break;
+		case AccountChange::Nonce:
+			a.restoreNonce(c.value, c.wasDirty);
+			break;
+		case AccountChange::Storage:
+			a.restoreStorage(c.key, c.hadKey ? &c.value : nullptr, c.wasDirty);
+			break;
+		default:
+			break;
+		}
+	}
 }
 
 Address State::newContract(u256 _balance, bytes const& _code)
@@ -971,12 +1228,21 @@ Address State::newContract(u256 _balance, bytes const& _code)
 		auto it = m_cache.find(ret);
 		if (it == m_cache.end())
 		{
-			m_cache[ret] = Account(0, _balance, EmptyTrie, h, Account::Changed);
+			setAccount(ret, Account(0, _balance, EmptyTrie, h, Account::Changed));
 			return ret;
 		}
 	}
 }
 
+void State::payFees(u256 _fees)
+{
+	// Every transaction pays the coinbase, so keep that from making them all depend on each other.
+	if (m_access && !m_cache.count(m_currentBlock.coinbaseAddress))
+		m_access->fees += _fees;
+	else
+		addBalance(m_currentBlock.coinbaseAddress, _fees);
+}
+
 u256 State::transactionsFrom(Address _id) const
 {
 	ensureCached(_id, false, false);
@@ -989,6 +1255,8 @@ u256 State::transactionsFrom(Address _id) const
 
 u256 State::storage(Address _id, u256 _memory) const
 {
+	if (m_trace)
+		m_trace->noteStorage(_id, _memory, AccessSet::Read);
 	ensureCached(_id, false, false);
 	auto it = m_cache.find(_id);
 
@@ -997,15 +1265,24 @@ u256 State::storage(Address _id, u256 _memory) const
 		return 0;
 
 	// See if it's in the account's storage cache.
-	auto mit = it->second.storageOverlay().find(_memory);
-	if (mit != it->second.storageOverlay().end())
-		return mit->second;
-
-	// Not in the storage cache - go to the DB.
-	SecureTrieDB<h256, OverlayDB> memdb(const_cast<OverlayDB*>(&m_db), it->second.baseRoot());			// promise we won't change the overlay! :)
-	string payload = memdb.at(_memory);
-	u256 ret = payload.size() ? RLP(payload).toInt<u256>() : 0;
-	it->second.setStorage(_memory, ret);
+	if (auto s = it->second.storageOverlay().find(_memory))
+		return s->value;
+
+	// Not in the storage cache - go to the flat index, then the DB. A fresh storage root means the account was reset
+	// here, so the committed slots no longer apply.
+	u256 ret;
+	bool fresh = it->second.baseRoot() == EmptyTrie;
+	if (fresh || !m_db.snapshot()->storage(m_state.rootHash(), _id, _memory, ret))
+	{
+		SecureTrieDB<h256, OverlayDB> memdb(const_cast<OverlayDB*>(&m_db), it->second.baseRoot());			// promise we won't change the overlay! :)
+		string payload = memdb.at(_memory);
+		ret = payload.size() ? RLP(payload).toInt<u256>() : 0;
+		if (!fresh)
+			m_db.snapshot()->noteStorage(m_state.rootHash(), _id, _memory, ret);
+	}
+	it->second.noteStorage(_memory, ret);
+	if (m_access)
+		m_access->storage.insert(make_pair(make_pair(_id, _memory), ret));
 	return ret;
 }
 
@@ -1026,15 +1303,66 @@ map<u256, u256> State::storage(Address _id) const
 		}
 
 		// Then merge cached storage over the top.
-		for (auto const& i: it->second.storageOverlay())
-			if (i.second)
-				ret[i.first] = i.second;
+		it->second.storageOverlay().forEach([&](StorageOverlay::Slot const& i)
+		{
+			if (i.value)
+				ret[i.key] = i.value;
 			else
-				ret.erase(i.first);
+				ret.erase(i.key);
+		});
 	}
 	return ret;
 }
 
+StateProof State::prove(Address _id, u256s const& _slots) const
+{
+	StateProof ret;
+	ret.root = m_state.root();
+	ret.account = m_state.prove(_id);
+	SecureTrieDB<h256, OverlayDB> storageDB(const_cast<OverlayDB*>(&m_db), storageRoot(_id));	// promise we won't change the overlay! :)
+	for (auto const& i: _slots)
+		ret.storage.push_back(make_pair(i, storageDB.prove(i)));
+	return ret;
+}
+
+bytes State::accountRange(bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f) const
+{
+	// The secure trie is a plain trie over the hashed keys, so a plain one over the same root streams it in key order.
+	GenericTrieDB<OverlayDB> t(const_cast<OverlayDB*>(&m_db), rootHash());		// promise we won't change the overlay! :)
+	return t.forEach(_from, _limit, _f);
+}
+
+bytes State::storageRange(Address _id, bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f) const
+{
+	GenericTrieDB<OverlayDB> t(const_cast<OverlayDB*>(&m_db), storageRoot(_id));
+	return t.forEach(_from, _limit, _f);
+}
+
+void State::exportState(ostream& _out, unsigned _chunk) const
+{
+	auto write = [&](bytesConstRef _account, bytesConstRef _slot, bytesConstRef _value)
+	{
+		RLPStream s(3);
+		s << _account << _slot << _value;
+		_out.write((char const*)s.out().data(), s.out().size());
+	};
+	bytes from;
+	do
+		from = accountRange(&from, _chunk, [&](bytesConstRef _key, bytesConstRef _account)
+		{
+			write(_key, bytesConstRef(), _account);
+			h256 root = RLP(_account)[2].toHash<h256>();
+			if (root == EmptyTrie)
+				return;
+			GenericTrieDB<OverlayDB> storage(const_cast<OverlayDB*>(&m_db), root);
+			bytes slot;
+			do
+				slot = storage.forEach(&slot, _chunk, [&](bytesConstRef _slot, bytesConstRef _value){ write(_key, _slot, _value); });
+			while (!slot.empty());
+		});
+	while (!from.empty());
+}
+
 h256 State::storageRoot(Address _id) const
 {
 	string s = m_state.at(_id);
@@ -1054,10 +1382,21 @@ bytes const& State::code(Address _contract) const
 	return m_cache[_contract].code();
 }
 
+SharedCode State::sharedCode(Address _contract) const
+{
+	if (!addressHasCode(_contract))
+		return CodeStore::empty();
+	ensureCached(_contract, true, false);
+	return m_cache[_contract].sharedCode();
+}
+
 h256 State::codeHash(Address _contract) const
 {
 	if (!addressHasCode(_contract))
 		return EmptySHA3;
+	// Code still being deposited has no committed hash yet.
+	if (m_cache[_contract].isFreshCode())
+		return sha3(code(_contract));
 	return m_cache[_contract].codeHash();
 }
 
@@ -1096,8 +1435,11 @@ bool State::isTrieGood(bool _enforceRefs, bool _requireNoLeftOvers) const
 	return true;
 }
 
-ExecutionResult State::execute(LastHashes const& _lh, Transaction const& _t, Permanence _p)
+ExecutionResult State::execute(LastHashes const& _lh, Transaction const& _t, Permanence _p, Tracing _tr)
 {
+	static MetricHistogram& s_executeTime = Metrics::get().histogram("eth_transaction_execute_seconds", "Time to execute a transaction on a state.");
+	MetricTimer executeTimer(s_executeTime);
+
 #if ETH_PARANOIA
 	paranoia("start of execution.", true);
 	State old(*this);
@@ -1107,6 +1449,8 @@ ExecutionResult State::execute(LastHashes const& _lh, Transaction const& _t, Per
 	// Create and initialize the executive. This will throw fairly cheaply and quickly if the
 	// transaction is bad in any way.
 	Executive e(*this, _lh, 0);
+	if (_tr == Tracing::Accesses)
+		e.traceAccesses();
 	e.initialize(_t);
 
 	// Uncommitting is a non-trivial operation - only do it once we've verified as much of the
@@ -1133,7 +1477,19 @@ ExecutionResult State::execute(LastHashes const& _lh, Transaction const& _t, Per
 #endif
 
 	if (_p == Permanence::Reverted)
+	{
+		// What is cached may be all there is of earlier transactions, until they are committed.
+		commitSettled();
 		m_cache.clear();
+	}
+	else if (m_lazyRoots)
+	{
+		// The root is filled in once the block's transactions are all done.
+		m_transactions.write().push_back(e.t());
+		m_receipts.write().push_back(TransactionReceipt(h256(), startGasUsed + e.gasUsed(), e.logs()));
+		m_transactionSet.write().insert(e.t().sha3());
+		settle();
+	}
 	else
 	{
 		commit();
@@ -1158,9 +1514,9 @@ ExecutionResult State::execute(LastHashes const& _lh, Transaction const& _t, Per
 		// TODO: CHECK TRIE after level DB flush to make sure exactly the same.
 	
 		// Add to the user-originated transactions that we've executed.
-		m_transactions.push_back(e.t());
-		m_receipts.push_back(TransactionReceipt(rootHash(), startGasUsed + e.gasUsed(), e.logs()));
-		m_transactionSet.insert(e.t().sha3());
+		m_transactions.write().push_back(e.t());
+		m_receipts.write().push_back(TransactionReceipt(rootHash(), startGasUsed + e.gasUsed(), e.logs()));
+		m_transactionSet.write().insert(e.t().sha3());
 	}
 
 	return e.executionResult();
@@ -1169,19 +1525,32 @@ ExecutionResult State::execute(LastHashes const& _lh, Transaction const& _t, Per
 State State::fromPending(unsigned _i) const
 {
 	State ret = *this;
-	ret.m_cache.clear();
-	_i = min<unsigned>(_i, m_transactions.size());
+	ret.rollback(_i);
+	return ret;
+}
+
+void State::rollback(unsigned _i)
+{
+	uncommitToMine();
+	commitSettled();
+	m_cache.clear();
+	_i = min<unsigned>(_i, m_transactions->size());
 	if (!_i)
-		ret.m_state.setRoot(m_previousBlock.stateRoot);
+		m_state.setRoot(m_previousBlock.stateRoot);
 	else
-		ret.m_state.setRoot(m_receipts[_i - 1].stateRoot());
-	while (ret.m_transactions.size() > _i)
+		m_state.setRoot((*m_receipts)[_i - 1].stateRoot());
+	if (m_transactions->size() > _i)
 	{
-		ret.m_transactionSet.erase(ret.m_transactions.back().sha3());
-		ret.m_transactions.pop_back();
-		ret.m_receipts.pop_back();
+		auto& transactions = m_transactions.write();
+		auto& receipts = m_receipts.write();
+		auto& transactionSet = m_transactionSet.write();
+		while (transactions.size() > _i)
+		{
+			transactionSet.erase(transactions.back().sha3());
+			transactions.pop_back();
+			receipts.pop_back();
+		}
 	}
-	return ret;
 }
 
 void State::applyRewards(vector<BlockInfo> const& _uncleBlockHeaders)
@@ -1237,13 +1606,13 @@ std::ostream& dev::eth::operator<<(std::ostream& _out, State const& _s)
 						mem[j.first] = RLP(j.second).toInt<u256>(), back.insert(j.first);
 				}
 				if (cache)
-					for (auto const& j: cache->storageOverlay())
+					cache->storageOverlay().forEach([&](StorageOverlay::Slot const& j)
 					{
-						if ((!mem.count(j.first) && j.second) || (mem.count(j.first) && mem.at(j.first) != j.second))
-							mem[j.first] = j.second, delta.insert(j.first);
-						else if (j.second)
-							cached.insert(j.first);
-					}
+						if ((!mem.count(j.key) && j.value) || (mem.count(j.key) && mem.at(j.key) != j.value))
+							mem[j.key] = j.value, delta.insert(j.key);
+						else if (j.value)
+							cached.insert(j.key);
+					});
 				if (!delta.empty())
 					lead = (lead == " .   ") ? "*.*  " : "***  ";
 
@@ -25,6 +25,7 @@
 #include <map>
 #include <unordered_map>
 #include <libdevcore/Common.h>
+#include <libdevcore/CopyOnWrite.h>
 #include <libdevcore/RLP.h>
 #include <libdevcrypto/TrieDB.h>
 #include <libethcore/Exceptions.h>
@@ -95,6 +96,21 @@ enum class Permanence
 	Committed
 };
 
+/// What State::execute() records of a transaction, beyond its result.
+enum class Tracing
+{
+	None,
+	Accesses	///< The accounts, storage slots and code read and written, into ExecutionResult::accesses.
+};
+
+/// What a transaction read from the state it started from; used to validate speculative execution.
+struct StateAccess
+{
+	std::map<Address, Account> accounts;				///< Accounts as first read; dead if they did not exist.
+	std::map<std::pair<Address, u256>, u256> storage;	///< Storage slots as first read.
+	u256 fees;											///< Fees held back from the coinbase while it was otherwise untouched.
+};
+
 /**
  * @brief Model of the current state of the ledger.
  * Maintains current ledger (m_current) as a fast hash-map. This is hashed only when required (i.e. to create or verify a block).
@@ -106,6 +122,8 @@ class State
 	friend class dev::test::ImportTest;
 	friend class dev::test::StateLoader;
 	friend class Executive;
+	friend class ParallelExecutor;
+	friend class StateView;
 
 public:
 	/// Default constructor; creates with a blank database prepopulated with the genesis block.
@@ -135,6 +153,7 @@ public:
 	Address address() const { return m_ourAddress; }
 
 	/// Open a DB - useful for passing into the constructor & keeping for other states that are necessary.
+	/// With @a _path c_memoryDBPath the DB is a fresh one in memory, touching no disk.
 	static OverlayDB openDB(std::string _path, WithExisting _we = WithExisting::Trust);
 	static OverlayDB openDB(WithExisting _we = WithExisting::Trust) { return openDB(std::string(), _we); }
 	OverlayDB const& db() const { return m_db; }
@@ -212,16 +231,22 @@ public:
 
 	// TODO: Cleaner interface.
 	/// Sync our transactions, killing those from the queue that we have and assimilating those that we don't.
+	/// The best paying go in first, each sender's in nonce order, until the block is full or, if @a _msTimeLimit is
+	/// non-zero, that many milliseconds have passed.
 	/// @returns a list of receipts one for each transaction placed from the queue into the state.
 	/// @a o_transactionQueueChanged boolean pointer, the value of which will be set to true if the transaction queue
-	/// changed and the pointer is non-null
-	TransactionReceipts sync(BlockChain const& _bc, TransactionQueue& _tq, GasPricer const& _gp, bool* o_transactionQueueChanged = nullptr);
+	/// changed and the pointer is non-null; likewise @a o_timedOut, if time ran out with transactions left to try.
+	TransactionReceipts sync(BlockChain const& _bc, TransactionQueue& _tq, GasPricer const& _gp, bool* o_transactionQueueChanged = nullptr, unsigned _msTimeLimit = 0, bool* o_timedOut = nullptr);
 	/// Like sync but only operate on _tq, killing the invalid/old ones.
 	bool cull(TransactionQueue& _tq) const;
+	/// Executes, in order, each of @a _ts that is still valid on this state, skipping the rest. Used to carry the
+	/// transactions pending on an old head over to a new one, without going back through the queue.
+	/// @returns a list of receipts one for each transaction executed.
+	TransactionReceipts replay(BlockChain const& _bc, Transactions const& _ts);
 
 	/// Execute a given transaction.
 	/// This will append @a _t to the transaction list and change the state accordingly.
-	ExecutionResult execute(LastHashes const& _lh, Transaction const& _t, Permanence _p = Permanence::Committed);
+	ExecutionResult execute(LastHashes const& _lh, Transaction const& _t, Permanence _p = Permanence::Committed, Tracing _tr = Tracing::None);
 
 	/// Get the remaining gas limit in this block.
 	u256 gasLimitRemaining() const { return m_currentBlock.gasLimit - gasUsed(); }
@@ -262,11 +287,26 @@ public:
 	u256 storage(Address _contract, u256 _memory) const;
 
 	/// Set the value of a storage position of an account.
-	void setStorage(Address _contract, u256 _location, u256 _value) { m_cache[_contract].setStorage(_location, _value); }
+	void setStorage(Address _contract, u256 _location, u256 _value);
 
 	/// Create a new contract.
 	Address newContract(u256 _balance, bytes const& _code);
 
+	/// @returns the proof of the account @a _contract and of its slots @a _slots against rootHash(),
+	/// so excluding changes not yet committed.
+	StateProof prove(Address _contract, u256s const& _slots) const;
+
+	/// Streams the accounts of the committed state, keyed by the hashes of their addresses, in key order from @a _from
+	/// on, stopping after @a _limit. Only the trie path to the current account is held in memory.
+	/// @returns the key to resume from, or empty bytes once all accounts have been visited.
+	bytes accountRange(bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f) const;
+	/// As accountRange(), for the committed storage of @a _contract, keyed by the hashes of the slots; values are RLP.
+	bytes storageRange(Address _contract, bytesConstRef _from, unsigned _limit, TrieEntryVisitor const& _f) const;
+	/// Writes the committed state to @a _out as a sequence of RLP lists [account key, slot key, value], reading the
+	/// trie @a _chunk entries at a time. An account's own record has an empty slot key and its RLP as value,
+	/// and is followed by the records of its storage.
+	void exportState(std::ostream& _out, unsigned _chunk = 1024) const;
+
 	/// Get the storage of an account.
 	/// @note This is expensive. Don't use it unless you need to.
 	/// @returns std::map<u256, u256> if no account exists at that address.
@@ -275,6 +315,8 @@ public:
 	/// Get the code of an account.
 	/// @returns bytes() if no account exists at that address.
 	bytes const& code(Address _contract) const;
+	/// As code(), but shared rather than to be copied.
+	SharedCode sharedCode(Address _contract) const;
 
 	/// Get the code hash of an account.
 	/// @returns EmptySHA3 if no account exists at that address or if there is no code associated with the address.
@@ -291,28 +333,40 @@ public:
 	h256 rootHash() const { return m_state.root(); }
 
 	/// Get the list of pending transactions.
-	Transactions const& pending() const { return m_transactions; }
+	Transactions const& pending() const { return *m_transactions; }
 
 	/// Get the list of hashes of pending transactions.
-	h256Set const& pendingHashes() const { return m_transactionSet; }
+	h256Set const& pendingHashes() const { return *m_transactionSet; }
 
 	/// Get the transaction receipt for the transaction of the given index.
-	TransactionReceipt const& receipt(unsigned _i) const { return m_receipts[_i]; }
+	TransactionReceipt const& receipt(unsigned _i) const { return (*m_receipts)[_i]; }
 
 	/// Get the list of pending transactions.
-	LogEntries const& log(unsigned _i) const { return m_receipts[_i].log(); }
+	LogEntries const& log(unsigned _i) const { return (*m_receipts)[_i].log(); }
 
 	/// Get the bloom filter of all logs that happened in the block.
 	LogBloom logBloom() const;
 
 	/// Get the bloom filter of a particular transaction that happened in the block.
-	LogBloom const& logBloom(unsigned _i) const { return m_receipts[_i].bloom(); }
+	LogBloom const& logBloom(unsigned _i) const { return (*m_receipts)[_i].bloom(); }
 
 	/// Get the State immediately after the given number of pending transactions have been applied.
 	/// If (_i == 0) returns the initial state of the block.
 	/// If (_i == pending().size()) returns the final state of the block, prior to rewards.
 	State fromPending(unsigned _i) const;
 
+	/// Drops the pending transactions from the @a _i th on, returning the state to how it was after the first @a _i.
+	void rollback(unsigned _i);
+
+	/// Begins recording how to undo each change to the accounts, as a call frame does so that it can be reverted
+	/// without copying the cache. Checkpoints nest; each must be released by releaseCheckpoint().
+	/// @returns the checkpoint, to give to revertToCheckpoint().
+	size_t checkpoint() { ++m_checkpoints; return m_journal.size(); }
+	/// Undoes every change to the accounts since @a _checkpoint, which stays open.
+	void revertToCheckpoint(size_t _checkpoint);
+	/// Closes the innermost checkpoint, keeping its changes; they stay undoable by any enclosing checkpoint.
+	void releaseCheckpoint() { if (!--m_checkpoints) m_journal.clear(); }
+
 	/// @returns the StateDiff caused by the pending transaction of index @a _i.
 	StateDiff pendingDiff(unsigned _i) const { return fromPending(_i).diff(fromPending(_i + 1)); }
 
@@ -328,7 +382,8 @@ public:
 
 	/// Execute all transactions within a given block.
 	/// @returns the additional total difficulty.
-	u256 enactOn(bytesConstRef _block, BlockInfo const& _bi, BlockChain const& _bc);
+	/// If @a _verified, the block's proof of work and internal roots are not checked again.
+	u256 enactOn(bytesConstRef _block, BlockInfo const& _bi, BlockChain const& _bc, bool _verified = false);
 
 	/// Returns back to a pristine state after having done a playback.
 	/// @arg _fullCommit if true flush everything out to disk. If false, this effectively only validates
@@ -345,6 +400,16 @@ private:
 	/// Undo the changes to the state for committing to mine.
 	void uncommitToMine();
 
+	/// Notes in m_trace, if tracing, that the account @a _a is written.
+	void traceWrite(Address const& _a) { if (m_trace) m_trace->noteAccount(_a, AccessSet::Written); }
+
+	/// Sets aside the changes in the cache of the transaction last appended, for commitSettled() to commit, and
+	/// leaves the accounts cached as though committed, so the next transaction finds them there. Commits at once
+	/// if an account died, since the trie would then still have it.
+	void settle();
+	/// Commits what settle() set aside, a transaction at a time, filling in the roots of their receipts.
+	void commitSettled();
+
 	/// Retrieve all information about a given address into the cache.
 	/// If _requireMemory is true, grab the full memory should it be a contract item.
 	/// If _forceCreate is true, then insert a default item into the cache, in the case it doesn't
@@ -354,15 +419,44 @@ private:
 	/// Retrieve all information about a given address into a cache.
 	void ensureCached(std::map<Address, Account>& _cache, Address _a, bool _requireCode, bool _forceCreate) const;
 
+	/// A change to an account in m_cache, with what it takes to undo it.
+	struct AccountChange
+	{
+		enum Kind { Created, Replaced, Balance, Nonce, Storage };
+
+		Kind kind;
+		Address address;
+		bool wasDirty;
+		bool hadKey;							///< For Storage, whether the key was in the overlay.
+		u256 key;								///< For Storage, the key.
+		u256 value;								///< The balance, nonce or storage value before.
+		std::unique_ptr<Account> account;		///< For Replaced, the account before.
+	};
+
+	/// Records, if a checkpoint is open, how to undo a change of @a _kind about to be made to the account @a _a
+	/// (at @a _key, for Storage). If the account is not in m_cache, it is recorded as Created whatever @a _kind;
+	/// if it is, Created records nothing.
+	void journal(AccountChange::Kind _kind, Address const& _a, u256 const& _key = 0);
+
+	/// Sets the account @a _a wholesale, such as to one being created.
+	void setAccount(Address const& _a, Account const& _account) { traceWrite(_a); journal(AccountChange::Replaced, _a); m_cache[_a] = _account; }
+	/// Sets the code of the account @a _a, which must be in its conception.
+	void setCode(Address const& _a, bytes&& _code) { traceWrite(_a); journal(AccountChange::Replaced, _a); m_cache[_a].setCode(std::move(_code)); }
+	/// Kills the account @a _a, as when it suicides.
+	void kill(Address const& _a) { traceWrite(_a); journal(AccountChange::Replaced, _a); m_cache[_a].kill(); }
+
 	/// Execute the given block, assuming it corresponds to m_currentBlock.
 	/// Throws on failure.
-	u256 enact(bytesConstRef _block, BlockChain const& _bc, bool _checkNonce = true);
+	u256 enact(bytesConstRef _block, BlockChain const& _bc, bool _checkNonce = true, bool _checkInternals = true);
+
+	/// Pay the fees of a transaction to the coinbase; held back in m_access if the coinbase was not otherwise touched.
+	void payFees(u256 _fees);
 
 	/// Finalise the block, applying the earned rewards.
 	void applyRewards(std::vector<BlockInfo> const& _uncleBlockHeaders);
 
 	/// @returns gas used by transactions thus far executed.
-	u256 gasUsed() const { return m_receipts.size() ? m_receipts.back().gasUsed() : 0; }
+	u256 gasUsed() const { return m_receipts->size() ? m_receipts->back().gasUsed() : 0; }
 
 	/// Debugging only. Good for checking the Trie is in shape.
 	bool isTrieGood(bool _enforceRefs, bool _requireNoLeftOvers) const;
@@ -372,12 +466,18 @@ private:
 
 	OverlayDB m_db;								///< Our overlay for the state tree.
 	SecureTrieDB<Address, OverlayDB> m_state;	///< Our state tree, as an OverlayDB DB.
-	Transactions m_transactions;				///< The current list of transactions that we've included in the state.
-	TransactionReceipts m_receipts;				///< The corresponding list of transaction receipts.
-	std::set<h256> m_transactionSet;			///< The set of transaction hashes that we've included in the state.
+	// Shared with copies of this state until either adds to them.
+	CopyOnWrite<Transactions> m_transactions;	///< The current list of transactions that we've included in the state.
+	CopyOnWrite<TransactionReceipts> m_receipts;	///< The corresponding list of transaction receipts.
+	CopyOnWrite<std::set<h256>> m_transactionSet;	///< The set of transaction hashes that we've included in the state.
 	OverlayDB m_lastTx;
 
 	mutable std::map<Address, Account> m_cache;	///< Our address cache. This stores the states of each address that has (or at least might have) been changed.
+	std::vector<AccountChange> m_journal;		///< How to undo the changes to m_cache since the outermost checkpoint.
+	unsigned m_checkpoints = 0;					///< How many checkpoints are open; changes are journaled only while any are.
+
+	bool m_lazyRoots = false;					///< If true, execute() settle()s rather than commit()s, leaving receipts' roots for later.
+	std::vector<std::map<Address, Account>> m_settled;	///< The accounts changed by each of the last transactions, in order, yet to be committed.
 
 	BlockInfo m_previousBlock;					///< The previous block's information.
 	BlockInfo m_currentBlock;					///< The current block's information.
@@ -391,6 +491,9 @@ private:
 
 	u256 m_blockReward;
 
+	StateAccess* m_access = nullptr;			///< If non-null, records what is read from the state trie.
+	AccessSet* m_trace = nullptr;				///< If non-null, records every account, slot and code read or written.
+
 	static std::string c_defaultPath;
 
 	friend std::ostream& operator<<(std::ostream& _out, State const& _s);
@@ -398,35 +501,64 @@ private:
 
 std::ostream& operator<<(std::ostream& _out, State const& _s);
 
+/// @returns the flat state index kept with @a _db, if it has one.
+template <class DB> StateSnapshot* snapshotOf(DB*) { return nullptr; }
+inline StateSnapshot* snapshotOf(OverlayDB* _db) { return _db->snapshot(); }
+
+/// Commits the dirty accounts of @a _cache into @a _state, noting in @a o_storageRoots, if given, the storage root
+/// each one committed is left with.
 template <class DB>
-void commit(std::map<Address, Account> const& _cache, DB& _db, SecureTrieDB<Address, DB>& _state)
+void commit(std::map<Address, Account> const& _cache, DB& _db, SecureTrieDB<Address, DB>& _state, std::map<Address, h256>* o_storageRoots = nullptr)
 {
+	StateSnapshot* snapshot = snapshotOf(&_db);
+	StateSnapshot::Changes flat;
+	h256 parent = _state.rootHash();
+
+	// Changes are applied in one batch per trie, so that each node is hashed once.
+	std::map<Address, bytes> accounts;
 	for (auto const& i: _cache)
 		if (i.second.isDirty())
 		{
 			if (!i.second.isAlive())
-				_state.remove(i.first);
+			{
+				accounts[i.first] = bytes();
+				if (o_storageRoots)
+					(*o_storageRoots)[i.first] = EmptyTrie;
+				if (snapshot)
+				{
+					flat.accounts[i.first].clear();
+					flat.resetStorage.insert(i.first);
+				}
+			}
 			else
 			{
+				// Slots only read, or written back as they were, are left out.
+				std::map<h256, bytes> storage;
+				i.second.storageOverlay().forEach([&](StorageOverlay::Slot const& j)
+				{
+					if (!j.dirty())
+						return;
+					storage[j.key] = j.value ? rlp(j.value) : bytes();
+					if (snapshot)
+						flat.storage[std::make_pair(i.first, j.key)] = j.value;
+				});
+				if (snapshot && i.second.baseRoot() == EmptyTrie)
+					flat.resetStorage.insert(i.first);
+
 				RLPStream s(4);
 				s << i.second.nonce() << i.second.balance();
 
-				if (i.second.storageOverlay().empty())
-				{
-					assert(i.second.baseRoot());
-					s.append(i.second.baseRoot());
-				}
-				else
+				h256 storageRoot = i.second.baseRoot();
+				if (!storage.empty())
 				{
-					SecureTrieDB<h256, DB> storageDB(&_db, i.second.baseRoot());
-					for (auto const& j: i.second.storageOverlay())
-						if (j.second)
-							storageDB.insert(j.first, rlp(j.second));
-						else
-							storageDB.remove(j.first);
-					assert(storageDB.root());
-					s.append(storageDB.root());
+					SecureTrieDB<h256, DB> storageDB(&_db, storageRoot);
+					storageDB.apply(storage);
+					storageRoot = storageDB.root();
 				}
+				assert(storageRoot);
+				s.append(storageRoot);
+				if (o_storageRoots)
+					(*o_storageRoots)[i.first] = storageRoot;
 
 				if (i.second.isFreshCode())
 				{
@@ -437,9 +569,14 @@ void commit(std::map<Address, Account> const& _cache, DB& _db, SecureTrieDB<Addr
 				else
 					s << i.second.codeHash();
 
-				_state.insert(i.first, &s.out());
+				accounts[i.first] = s.out();
+				if (snapshot)
+					flat.accounts[i.first] = asString(s.out());
 			}
 		}
+	_state.apply(accounts);
+	if (snapshot)
+		snapshot->update(parent, _state.rootHash(), std::move(flat));
 }
 
 }
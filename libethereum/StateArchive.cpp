@@ -0,0 +1,201 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateArchive.cpp
+ * @date 2015
+ */
+
+#include "StateArchive.h"
+#include <deque>
+#include <future>
+#include <boost/filesystem.hpp>
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/Snappy.h>
+#include <libdevcore/ThreadPool.h>
+#include <libdevcrypto/OverlayDB.h>
+#include <libdevcrypto/TrieDB.h>
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+/// The most a chunk may uncompress to.
+static const size_t c_maxChunkSize = 256 * 1024 * 1024;
+
+bool dev::eth::writeStateArchive(OverlayDB const& _db, h256 const& _root, bytes const& _header, string const& _dir, size_t _chunkSize)
+{
+	boost::filesystem::create_directories(_dir);
+	OverlayDB db = _db;
+	deque<h256> hashes;		///< Filled in by the writes, so a deque, whose elements stay put as it grows.
+	deque<future<void>> writes;
+	auto writeChunk = [&](RLPStream& _accounts, unsigned _accountCount, RLPStream& _codes, unsigned _codeCount)
+	{
+		RLPStream chunk(2);
+		chunk.appendList(_accountCount).appendRaw(_accounts.out(), _accountCount);
+		chunk.appendList(_codeCount).appendRaw(_codes.out(), _codeCount);
+		auto raw = make_shared<bytes>();
+		chunk.swapOut(*raw);
+		hashes.push_back(h256());
+		h256* hash = &hashes.back();
+		// Bounded, so that compression keeps up with the walk without the chunks piling up in memory.
+		if (writes.size() > ThreadPool::get().size() * 2)
+		{
+			writes.front().get();
+			writes.pop_front();
+		}
+		writes.push_back(ThreadPool::get().submit([=]()
+		{
+			bytes compressed = snappyCompress(raw.get());
+			h256 h = sha3(compressed);
+			writeFile(_dir + "/" + toHex(h.ref()), compressed);
+			*hash = h;
+		}));
+		_accounts.clear();
+		_codes.clear();
+	};
+
+	try
+	{
+		GenericTrieDB<OverlayDB> accounts(&db, _root);
+		set<h256> codesSeen;
+		RLPStream chunkAccounts;
+		RLPStream chunkCodes;
+		unsigned accountCount = 0;
+		unsigned codeCount = 0;
+		for (auto const& a: accounts)
+		{
+			RLP account(a.second);
+			GenericTrieDB<OverlayDB> storage(&db, account[2].toHash<h256>());
+			// The iterator's refs last only until it moves on.
+			vector<pair<bytes, bytes>> slots;
+			for (auto const& s: storage)
+				slots.push_back(make_pair(s.first.toBytes(), s.second.toBytes()));
+			chunkAccounts.appendList(3) << a.first << a.second;
+			chunkAccounts.appendList(slots.size());
+			for (auto const& s: slots)
+				chunkAccounts.appendList(2) << s.first << s.second;
+			++accountCount;
+
+			h256 codeHash = account[3].toHash<h256>();
+			if (codeHash != EmptySHA3 && codesSeen.insert(codeHash).second)
+			{
+				chunkCodes << db.lookup(codeHash);
+				++codeCount;
+			}
+			if (chunkAccounts.out().size() + chunkCodes.out().size() >= _chunkSize)
+			{
+				writeChunk(chunkAccounts, accountCount, chunkCodes, codeCount);
+				accountCount = codeCount = 0;
+			}
+		}
+		if (accountCount || hashes.empty())
+			writeChunk(chunkAccounts, accountCount, chunkCodes, codeCount);
+	}
+	catch (Exception const& _e)
+	{
+		cwarn << "State not all present:" << diagnostic_information(_e);
+		for (auto& w: writes)
+			w.wait();
+		return false;
+	}
+	for (auto& w: writes)
+		w.get();
+
+	RLPStream manifest(2);
+	manifest.appendRaw(_header);
+	manifest << h256s(hashes.begin(), hashes.end());
+	writeFile(_dir + "/manifest", manifest.out());
+	return true;
+}
+
+bytes dev::eth::stateArchiveHeader(string const& _dir)
+{
+	bytes manifest = contents(_dir + "/manifest");
+	return manifest.empty() ? bytes() : RLP(manifest)[0].data().toBytes();
+}
+
+bool dev::eth::importStateArchive(string const& _dir, OverlayDB& _db, h256 const& _root)
+{
+	bytes manifest = contents(_dir + "/manifest");
+	if (manifest.empty())
+		return false;
+	h256s hashes = RLP(manifest)[1].toVector<h256>();
+
+	struct Chunk
+	{
+		bool ok = false;
+		vector<pair<bytes, bytes>> accounts;
+		map<h256, string> nodes;		///< The codes and the storage tries' nodes.
+	};
+
+	GenericTrieDB<OverlayDB> accounts(&_db);
+	accounts.init();
+	unsigned window = max(1u, ThreadPool::get().size()) * 4;
+	for (size_t first = 0; first < hashes.size(); first += window)
+	{
+		vector<Chunk> chunks(min<size_t>(window, hashes.size() - first));
+		ThreadPool::get().forEach(chunks.size(), [&](unsigned i)
+		{
+			Chunk& c = chunks[i];
+			bytes compressed = contents(_dir + "/" + toHex(hashes[first + i].ref()));
+			bytes raw;
+			if (sha3(compressed) != hashes[first + i] || !snappyUncompress(&compressed, raw, c_maxChunkSize))
+				return;
+			try
+			{
+				RLP chunk(raw);
+				MemoryDB mem;
+				for (auto const& code: chunk[1])
+					mem.insert(sha3(code.toBytesConstRef()), code.toBytesConstRef());
+				for (auto const& account: chunk[0])
+				{
+					GenericTrieDB<MemoryDB> storage(&mem);
+					storage.init();
+					for (auto const& slot: account[2])
+						storage.insert(slot[0].toBytesConstRef(), slot[1].toBytesConstRef());
+					if (storage.root() != RLP(account[1].toBytesConstRef())[2].toHash<h256>())
+						return;
+					c.accounts.push_back(make_pair(account[0].toBytes(), account[1].toBytes()));
+				}
+				c.nodes = mem.get();
+				c.ok = true;
+			}
+			catch (Exception const&)
+			{
+			}
+		});
+
+		for (size_t i = 0; i < chunks.size(); ++i)
+		{
+			if (!chunks[i].ok)
+			{
+				cwarn << "State chunk" << hashes[first + i] << "is missing or corrupt.";
+				return false;
+			}
+			for (auto const& n: chunks[i].nodes)
+				_db.insert(n.first, &n.second);
+			for (auto const& a: chunks[i].accounts)
+				accounts.insert(&a.first, &a.second);
+		}
+		_db.commit();
+	}
+	if (accounts.root() != _root)
+	{
+		cwarn << "State archive has root" << accounts.root() << "rather than" << _root;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,60 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateArchive.h
+ * @date 2015
+ * The state after a block, as files from which a node may take it up without replaying the blocks before.
+ *
+ * The leaves of the account trie are split, in key order, into chunks of about c_stateChunkSize bytes. Each chunk is
+ * the RLP list [accounts, codes], compressed with snappy and named by the hex of its hash. An account is
+ * [key, value, [[key, value]...]]: its leaf in the account trie followed by the leaves of its storage trie, keyed by
+ * the hashes the secure tries use. Each code comes in the first chunk with an account having it.
+ * The file "manifest" is the RLP list [header of the block, [hashes of the chunks]].
+ */
+
+#pragma once
+
+#include <string>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+
+namespace dev
+{
+
+class OverlayDB;
+
+namespace eth
+{
+
+/// Bytes of leaves, uncompressed, after which a chunk is ended by default; an account is never split between chunks.
+static const size_t c_stateChunkSize = 4 * 1024 * 1024;
+
+/// Writes the state of root @a _root in @a _db, that after the block of header @a _header, to the directory @a _dir,
+/// in chunks of about @a _chunkSize bytes, compressed and written on the shared thread pool as the trie is walked.
+/// @returns false if the state is not all in @a _db.
+bool writeStateArchive(OverlayDB const& _db, h256 const& _root, bytes const& _header, std::string const& _dir, size_t _chunkSize = c_stateChunkSize);
+
+/// @returns the header of the block whose state is archived in @a _dir, or empty bytes if there is no manifest.
+bytes stateArchiveHeader(std::string const& _dir);
+
+/// Imports the state archived in @a _dir into @a _db. Chunks are read, checked against their hashes and have their
+/// storage tries built in parallel; the account trie is then built from them in key order, committing as it goes.
+/// @returns false if a chunk is missing or corrupt, or if the root built is not @a _root, which should come from a
+/// trusted header.
+bool importStateArchive(std::string const& _dir, OverlayDB& _db, h256 const& _root);
+
+}
+}
@@ -0,0 +1,211 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateDownload.cpp
+ * @date 2015
+ */
+
+#include "StateDownload.h"
+
+#include <libdevcore/Log.h>
+#include <libdevcrypto/SHA3.h>
+#include <libdevcrypto/TrieDB.h>
+#include <libethcore/BlockInfo.h>
+#include <libp2p/Common.h>
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+/// How many nodes are written between commits of the DB.
+static const unsigned c_commitInterval = 4096;
+
+StateDownload::StateDownload(OverlayDB const& _db):
+	m_db(_db)
+{
+}
+
+void StateDownload::setPivot(h256 const& _block)
+{
+	Guard l(x_state);
+	m_pivot = _block;
+}
+
+void StateDownload::noteBlock(h256 const& _hash, bytesConstRef _block)
+{
+	{
+		Guard l(x_state);
+		if (_hash != m_pivot || m_root)
+			return;
+	}
+	begin(BlockInfo::fromHeader(RLP(_block)[0].data()).stateRoot);
+}
+
+void StateDownload::begin(h256 const& _root)
+{
+	Guard l(x_state);
+	m_root = _root;
+	m_requests.clear();
+	m_queue.clear();
+	m_inFlight.clear();
+	m_written = 0;
+	m_complete = m_db.exists(_root);
+	if (m_complete)
+		return;
+	m_requests[_root].kind = NodeKind::State;
+	m_queue.push_back(_root);
+	clog(p2p::NetNote) << "Downloading state" << _root.abridged();
+}
+
+h256s StateDownload::nextFetch(unsigned _n)
+{
+	h256s ret;
+	Guard l(x_state);
+	for (; ret.size() < _n && !m_queue.empty(); m_queue.pop_front())
+	{
+		ret.push_back(m_queue.front());
+		m_inFlight.insert(m_queue.front());
+	}
+	return ret;
+}
+
+void StateDownload::giveBack(h256s const& _asked)
+{
+	Guard l(x_state);
+	// To the front, in the order they were asked for, as they would have been had they not been asked for.
+	for (auto i = _asked.rbegin(); i != _asked.rend(); ++i)
+		if (m_inFlight.erase(*i))
+			m_queue.push_front(*i);
+}
+
+void StateDownload::forEachChild(RLP const& _node, NodeKind _k, function<void(h256 const&, NodeKind)> const& _f)
+{
+	auto child = [&](RLP const& _r)
+	{
+		if (_r.isList())
+			forEachChild(_r, _k, _f);
+		else if (_r.isData() && _r.payload().size() == h256::size)
+			_f(_r.toHash<h256>(), _k);
+	};
+	auto value = [&](RLP const& _v)
+	{
+		if (_k != NodeKind::State || !_v.isData())
+			return;
+		RLP account(_v.payload());
+		if (!account.isList() || account.itemCount() != 4)
+			return;
+		auto storageRoot = account[2].toHash<h256>(RLP::VeryStrict);
+		if (storageRoot != EmptyTrie)
+			_f(storageRoot, NodeKind::Storage);
+		auto codeHash = account[3].toHash<h256>(RLP::VeryStrict);
+		if (codeHash != EmptySHA3)
+			_f(codeHash, NodeKind::Code);
+	};
+	if (_node.isList() && _node.itemCount() == 2 && _node[0].isData() && _node[0].payload().size())
+	{
+		// The flag of a hex-prefixed key, that it ends at a value rather than going on to another node.
+		if (_node[0].payload()[0] & 0x20)
+			value(_node[1]);
+		else
+			child(_node[1]);
+	}
+	else if (_node.isList() && _node.itemCount() == 17)
+	{
+		for (unsigned i = 0; i < 16; ++i)
+			child(_node[i]);
+		if (!_node[16].isEmpty())
+			value(_node[16]);
+	}
+}
+
+unsigned StateDownload::noteNodes(h256s const& _asked, RLP const& _nodes)
+{
+	// Hashed without the lock.
+	vector<pair<h256, bytesConstRef>> nodes;
+	for (auto const& n: _nodes)
+		if (n.isData())
+			nodes.push_back(make_pair(sha3(n.payload()), n.payload()));
+
+	unsigned ret = 0;
+	Guard l(x_state);
+	for (auto const& n: nodes)
+	{
+		if (!m_inFlight.erase(n.first))
+			continue;
+		++ret;
+		auto& r = m_requests[n.first];
+		r.data = n.second.toBytes();
+		if (r.kind != NodeKind::Code)
+			try
+			{
+				forEachChild(RLP(r.data), r.kind, [&](h256 const& _h, NodeKind _k) { want(_h, _k, n.first); });
+			}
+			catch (Exception const&)
+			{
+				// It is what the hash it was asked for by says; the state is as bad as the node is.
+				clog(p2p::NetWarn) << "Malformed node" << n.first.abridged() << "in state" << m_root.abridged();
+			}
+		if (!m_requests[n.first].deps)
+			write(n.first);
+	}
+	for (auto i = _asked.rbegin(); i != _asked.rend(); ++i)
+		if (m_inFlight.erase(*i))
+			m_queue.push_front(*i);
+	return ret;
+}
+
+void StateDownload::want(h256 const& _h, NodeKind _k, h256 const& _parent)
+{
+	auto it = m_requests.find(_h);
+	if (it == m_requests.end())
+	{
+		if (m_db.exists(_h))
+			return;
+		it = m_requests.insert(make_pair(_h, Request())).first;
+		it->second.kind = _k;
+		m_queue.push_back(_h);
+	}
+	it->second.parents.push_back(_parent);
+	m_requests[_parent].deps++;
+}
+
+void StateDownload::write(h256 const& _h)
+{
+	h256s ready(1, _h);
+	while (!ready.empty())
+	{
+		h256 h = ready.back();
+		ready.pop_back();
+		auto it = m_requests.find(h);
+		m_db.insert(h, &it->second.data);
+		++m_written;
+		++m_uncommitted;
+		for (auto const& p: it->second.parents)
+			if (!--m_requests[p].deps)
+				ready.push_back(p);
+		m_requests.erase(it);
+		if (h == m_root)
+		{
+			m_complete = true;
+			clog(p2p::NetNote) << "Downloaded state" << m_root.abridged() << "," << m_written << "nodes.";
+		}
+	}
+	// Those written before they are committed go in the same batch as or an earlier one than those above them.
+	if (m_complete || m_uncommitted >= c_commitInterval)
+	{
+		m_db.commit();
+		m_uncommitted = 0;
+	}
+}
@@ -0,0 +1,115 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateDownload.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <libdevcore/Guards.h>
+#include <libdevcore/RLP.h>
+#include <libdevcrypto/OverlayDB.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief The download of a state, node by node, from the peers of a fast sync, as DownloadMan is of its blocks.
+ * The pivot's state trie is walked breadth-first from its root, and the storage tries and code of its accounts with
+ * it; any number of peers are asked for nodes at once, each for different ones. Each node is checked against the hash
+ * it was asked for by, and written to the state DB only once all those it refers to are: so a node that is in the DB
+ * has all below it there too, those of an earlier state or of an interrupted download are not asked for again, and
+ * the root, written last, is there only once the whole state is.
+ * @threadsafe
+ */
+class StateDownload
+{
+public:
+	/// Writes to a copy of @a _db.
+	explicit StateDownload(OverlayDB const& _db);
+
+	/// Awaits the block @a _block, whose state is to be downloaded once noteBlock() gives its root.
+	void setPivot(h256 const& _block);
+	/// @returns the block whose state is being or is to be downloaded; null if none is.
+	h256 pivot() const { Guard l(x_state); return m_pivot; }
+	/// Starts downloading the pivot's state, should @a _block, of hash @a _hash, be the pivot.
+	void noteBlock(h256 const& _hash, bytesConstRef _block);
+
+	/// Starts downloading the state of root @a _root, of which the DB may already have some or all.
+	void begin(h256 const& _root);
+
+	/// @returns true if there are nodes yet to download.
+	bool isActive() const { Guard l(x_state); return m_root && !m_complete; }
+	/// @returns true if the whole state is in the DB.
+	bool isComplete() const { Guard l(x_state); return m_complete; }
+	/// @returns the nodes written so far, and those known of yet to be.
+	std::pair<size_t, size_t> progress() const { Guard l(x_state); return std::make_pair(m_written, m_requests.size()); }
+
+	/// @returns up to @a _n nodes for a peer to be asked for, the shallowest first, none of which another peer has
+	/// been asked for.
+	h256s nextFetch(unsigned _n);
+	/// Notes the nodes @a _nodes that a peer gave when asked for @a _asked; those it did not give go back to be asked
+	/// of another. @returns how many of them were asked for.
+	unsigned noteNodes(h256s const& _asked, RLP const& _nodes);
+	/// Gives back the nodes @a _asked of a peer that will not give them, to be asked of another.
+	void giveBack(h256s const& _asked);
+
+private:
+	enum class NodeKind
+	{
+		State,
+		Storage,
+		Code
+	};
+
+	struct Request
+	{
+		NodeKind kind;
+		bytes data;					///< The node, once given.
+		unsigned deps = 0;			///< The nodes it refers to that are not yet written.
+		h256s parents;				///< Those that refer to it, once for each reference.
+	};
+
+	/// Calls @a _f with each node, and its kind, that the node @a _node of a trie of kind @a _k refers to by hash,
+	/// through those embedded in it; of the state trie, the storage trie and code of each account in its leaves too.
+	static void forEachChild(RLP const& _node, NodeKind _k, std::function<void(h256 const&, NodeKind)> const& _f);
+	/// Notes that @a _parent refers to @a _h, to be downloaded unless it is in the DB.
+	void want(h256 const& _h, NodeKind _k, h256 const& _parent);
+	/// Writes @a _h, and then each of those above it that are no longer waiting on any others.
+	void write(h256 const& _h);
+
+	mutable Mutex x_state;
+	OverlayDB m_db;
+	h256 m_pivot;
+	h256 m_root;
+	bool m_complete = false;
+	std::unordered_map<h256, Request> m_requests;	///< The nodes asked or to be asked for, and those waiting on them.
+	std::deque<h256> m_queue;						///< Those yet to be asked for, in the order they were found.
+	std::unordered_set<h256> m_inFlight;			///< Those a peer has been asked for.
+	size_t m_written = 0;
+	unsigned m_uncommitted = 0;						///< Nodes written since the DB was last committed.
+};
+
+}
+}
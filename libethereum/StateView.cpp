@@ -0,0 +1,83 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateView.cpp
+ * @date 2015
+ */
+
+#include "StateView.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+Account const* StateView::account(Address const& _a, map<Address, Account>& io_cache, bool _requireCode) const
+{
+	auto it = m_state.m_cache.find(_a);
+	if (it != m_state.m_cache.end())
+	{
+		if (!_requireCode || it->second.isFreshCode() || it->second.codeCacheValid())
+			return &it->second;
+		// Noting the code would change the state's cache; do it on a copy of the account.
+		io_cache.insert(*it);
+	}
+	m_state.ensureCached(io_cache, _a, _requireCode, false);
+	auto jt = io_cache.find(_a);
+	return jt == io_cache.end() ? nullptr : &jt->second;
+}
+
+u256 StateView::balance(Address const& _a) const
+{
+	map<Address, Account> c;
+	auto a = account(_a, c, false);
+	return a ? a->balance() : 0;
+}
+
+u256 StateView::transactionsFrom(Address const& _a) const
+{
+	map<Address, Account> c;
+	auto a = account(_a, c, false);
+	return a ? a->nonce() : 0;
+}
+
+u256 StateView::storage(Address const& _a, u256 const& _slot) const
+{
+	map<Address, Account> c;
+	auto a = account(_a, c, false);
+	if (!a)
+		return 0;
+	if (auto s = a->storageOverlay().find(_slot))
+		return s->value;
+
+	// As State::storage, but without keeping the value in the account.
+	u256 ret;
+	bool fresh = a->baseRoot() == EmptyTrie;
+	if (fresh || !m_state.m_db.snapshot()->storage(m_state.rootHash(), _a, _slot, ret))
+	{
+		SecureTrieDB<h256, OverlayDB> memdb(const_cast<OverlayDB*>(&m_state.m_db), a->baseRoot());		// promise we won't change the overlay! :)
+		string payload = memdb.at(_slot);
+		ret = payload.size() ? RLP(payload).toInt<u256>() : 0;
+		if (!fresh)
+			m_state.m_db.snapshot()->noteStorage(m_state.rootHash(), _a, _slot, ret);
+	}
+	return ret;
+}
+
+bytes StateView::code(Address const& _a) const
+{
+	map<Address, Account> c;
+	auto a = account(_a, c, true);
+	return a ? a->code() : bytes();
+}
@@ -0,0 +1,67 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StateView.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include "State.h"
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief A read-only view of a State as it was when the view was made, which any number of threads may share.
+ * Reads through it never touch the state's own cache: what they pull from the trie is kept only for the call,
+ * while the flat index and trie node cache, shared by all states of the DB, keep repeated reads cheap.
+ * @threadsafe
+ */
+class StateView
+{
+public:
+	explicit StateView(State const& _s): m_state(_s) {}
+
+	u256 balance(Address const& _a) const;
+	u256 transactionsFrom(Address const& _a) const;
+	u256 storage(Address const& _a, u256 const& _slot) const;
+	bytes code(Address const& _a) const;
+
+	BlockInfo const& info() const { return m_state.info(); }
+	Transactions const& pending() const { return m_state.pending(); }
+	h256Set const& pendingHashes() const { return m_state.pendingHashes(); }
+	OverlayDB const& db() const { return m_state.db(); }
+	h256 rootHash() const { return m_state.rootHash(); }
+	Address address() const { return m_state.address(); }
+	u256 gasLimitRemaining() const { return m_state.gasLimitRemaining(); }
+
+	/// @returns a copy of the state, to be changed or read as any other.
+	State copy() const { return m_state; }
+
+private:
+	/// @returns the account @a _a, or null if there is none, reading it into @a io_cache if the state has not got it.
+	Account const* account(Address const& _a, std::map<Address, Account>& io_cache, bool _requireCode) const;
+
+	State const m_state;
+};
+
+}
+}
@@ -0,0 +1,169 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StepTrace.cpp
+ * @date 2015
+ */
+
+#include "StepTrace.h"
+
+#include <algorithm>
+#include <libdevcrypto/SHA3.h>
+#include <libevm/VM.h>
+#include "ExtVM.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+OnOpFunc StepTrace::onOp()
+{
+	return [this](uint64_t _steps, Instruction _inst, bigint _newMemSize, bigint _gasCost, VM* _vm, ExtVMFace const* _ext)
+	{
+		record(_steps, _inst, _newMemSize, _gasCost, *_vm, *_ext);
+	};
+}
+
+void StepTrace::record(uint64_t _steps, Instruction _inst, bigint const& _newMemSize, bigint const& _gasCost, VM& _vm, ExtVMFace const& _ext)
+{
+	ExtVM const& ext = static_cast<ExtVM const&>(_ext);
+
+	// Follow the call frames, noting the code and data of each new one.
+	bool frameChanged = false;
+	while (!m_frames.empty() && (m_frames.back().depth > ext.depth || (m_frames.back().depth == ext.depth && m_frames.back().ext != &_ext)))
+	{
+		m_frames.pop_back();
+		frameChanged = true;
+	}
+	if (m_frames.empty() || m_frames.back().depth < ext.depth)
+	{
+		Frame f;
+		f.ext = &_ext;
+		f.depth = ext.depth;
+		f.caller = m_info.empty() ? (unsigned)-1 : (unsigned)m_info.size() - 1;
+		auto code = m_codeIndex.insert(make_pair(make_pair(ext.myAddress, sha3(*ext.code)), (unsigned)m_codes.size()));
+		if (code.second)
+			m_codes.push_back(TracedCode{ext.myAddress, *ext.code});
+		f.code = code.first->second;
+		auto data = m_dataIndex.insert(make_pair(sha3(ext.data), (unsigned)m_data.size()));
+		if (data.second)
+			m_data.push_back(ext.data.toBytes());
+		f.data = data.first->second;
+		m_frames.push_back(f);
+		frameChanged = true;
+	}
+
+	Frame const& f = m_frames.back();
+	bool afterStore = !frameChanged && !m_info.empty() && m_info.back().inst == Instruction::SSTORE;
+	StepInfo info;
+	info.steps = _steps;
+	info.pc = _vm.curPC();
+	info.inst = _inst;
+	info.newMemSize = _newMemSize;
+	info.gas = _vm.gas();
+	info.gasCost = _gasCost;
+	info.depth = ext.depth;
+	info.code = f.code;
+	info.data = f.data;
+	info.caller = f.caller;
+	m_info.push_back(info);
+
+	Diff d;
+
+	// Storage only changes by an SSTORE of this frame, whose slot was on top of the stack before it, or in another
+	// frame, which is read afresh on the way back.
+	if (frameChanged)
+	{
+		d.storageReplaced = true;
+		d.storage = ext.state().storage(ext.myAddress);
+		m_last.storage = d.storage;
+	}
+	else if (afterStore && !m_last.stack.empty())
+	{
+		u256 slot = m_last.stack.back();
+		u256 value = ext.state().storage(ext.myAddress, slot);
+		d.storage[slot] = value;
+		if (value)
+			m_last.storage[slot] = value;
+		else
+			m_last.storage.erase(slot);
+	}
+
+	u256s const& stack = _vm.stack();
+	size_t common = min(stack.size(), m_last.stack.size());
+	d.stackKept = mismatch(stack.begin(), stack.begin() + common, m_last.stack.begin()).first - stack.begin();
+	d.stackPushed.assign(stack.begin() + d.stackKept, stack.end());
+	m_last.stack.resize(d.stackKept);
+	m_last.stack.insert(m_last.stack.end(), d.stackPushed.begin(), d.stackPushed.end());
+
+	bytes const& memory = _vm.memory();
+	d.memorySize = memory.size();
+	m_last.memory.resize(memory.size());
+	auto first = mismatch(memory.begin(), memory.end(), m_last.memory.begin()).first;
+	if (first != memory.end())
+	{
+		size_t at = first - memory.begin();
+		size_t end = memory.size() - (mismatch(memory.rbegin(), memory.rend() - at, m_last.memory.rbegin()).first - memory.rbegin());
+		d.memoryAt = at;
+		d.memoryWritten.assign(memory.begin() + at, memory.begin() + end);
+		copy(d.memoryWritten.begin(), d.memoryWritten.end(), m_last.memory.begin() + at);
+	}
+
+	if ((m_info.size() - 1) % m_interval == 0)
+	{
+		m_checkpoints.push_back(m_last);
+		d = Diff();
+	}
+	m_diffs.push_back(move(d));
+}
+
+void StepTrace::apply(Diff const& _d, Machine& io_m)
+{
+	io_m.stack.resize(_d.stackKept);
+	io_m.stack.insert(io_m.stack.end(), _d.stackPushed.begin(), _d.stackPushed.end());
+	io_m.memory.resize(_d.memorySize);
+	copy(_d.memoryWritten.begin(), _d.memoryWritten.end(), io_m.memory.begin() + _d.memoryAt);
+	if (_d.storageReplaced)
+		io_m.storage = _d.storage;
+	else
+		for (auto const& i: _d.storage)
+			if (i.second)
+				io_m.storage[i.first] = i.second;
+			else
+				io_m.storage.erase(i.first);
+}
+
+TraceStep StepTrace::at(size_t _i, bool _memory) const
+{
+	size_t checkpoint = _i / m_interval * m_interval;
+	if (m_cursor == (size_t)-1 || m_cursor > _i || m_cursor < checkpoint)
+	{
+		m_cursorMachine = m_checkpoints[_i / m_interval];
+		m_cursor = checkpoint;
+	}
+	for (; m_cursor < _i; ++m_cursor)
+		apply(m_diffs[m_cursor + 1], m_cursorMachine);
+
+	TraceStep ret;
+	static_cast<StepInfo&>(ret) = m_info[_i];
+	for (unsigned c = m_info[_i].caller; c != (unsigned)-1; c = m_info[c].caller)
+		ret.levels.push_back(c);
+	reverse(ret.levels.begin(), ret.levels.end());
+	ret.stack = m_cursorMachine.stack;
+	if (_memory)
+		ret.memory = m_cursorMachine.memory;
+	ret.storage = m_cursorMachine.storage;
+	return ret;
+}
@@ -0,0 +1,150 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StepTrace.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libevmcore/Instruction.h>
+#include <libevm/ExtVMFace.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/// What is kept of every step of a traced execution.
+struct StepInfo
+{
+	uint64_t steps = 0;				///< Of the VM it is in, as OnOpFunc counts them.
+	u256 pc;
+	Instruction inst = Instruction::STOP;
+	bigint newMemSize;
+	u256 gas;
+	bigint gasCost;
+	unsigned depth = 0;
+	unsigned code = 0;				///< Index into StepTrace::codes().
+	unsigned data = 0;				///< Index into StepTrace::data().
+	unsigned caller = (unsigned)-1;	///< The step which made the call this one is in; -1 at the outermost.
+};
+
+/// The whole machine state at a step, as StepTrace::at() rebuilds it.
+struct TraceStep: StepInfo
+{
+	std::vector<unsigned> levels;	///< The steps which made each call leading to this one, outermost first.
+	u256s stack;
+	bytes memory;
+	std::map<u256, u256> storage;	///< Of the account whose code is running.
+};
+
+/// Code run during a traced execution.
+struct TracedCode
+{
+	Address address;
+	bytes code;
+};
+
+/**
+ * @brief A trace of each step of an execution, for debuggers, which keeps the whole machine state only every so
+ * many steps and what changed in between.
+ *
+ * Recording every step's stack, memory and storage in full takes memory in proportion to steps times state, which
+ * a long transaction exhausts. This keeps a full checkpoint every interval steps and, for each step, the stack
+ * items pushed since the one before, the bytes of memory written and the storage slots set; at() rebuilds a step
+ * from the checkpoint at or before it. Walking forwards from the step last rebuilt only applies the steps between.
+ */
+class StepTrace
+{
+public:
+	explicit StepTrace(unsigned _checkpointInterval = 1024): m_interval(std::max(_checkpointInterval, 1u)) {}
+
+	/// @returns the callback to run an execution with, recording each of its steps into this trace, which must
+	/// outlive the execution. It runs only under ExtVM.
+	OnOpFunc onOp();
+
+	size_t size() const { return m_info.size(); }
+	bool empty() const { return m_info.empty(); }
+
+	/// @returns what is kept of step @a _i; cheap.
+	StepInfo const& info(size_t _i) const { return m_info[_i]; }
+	/// @returns the machine state at step @a _i, rebuilt from the checkpoint before it, without its memory unless
+	/// @a _memory. Not safe to call from more than one thread at once.
+	TraceStep at(size_t _i, bool _memory = true) const;
+
+	std::vector<TracedCode> const& codes() const { return m_codes; }
+	std::vector<bytes> const& data() const { return m_data; }
+
+private:
+	/// What changed since the step before.
+	struct Diff
+	{
+		unsigned stackKept = 0;			///< Items kept from the bottom of the stack before.
+		u256s stackPushed;
+		size_t memorySize = 0;
+		size_t memoryAt = 0;
+		bytes memoryWritten;
+		bool storageReplaced = false;	///< Whether storage holds the whole storage, rather than the slots changed.
+		std::map<u256, u256> storage;
+	};
+
+	/// The stack, memory and storage at a step.
+	struct Machine
+	{
+		u256s stack;
+		bytes memory;
+		std::map<u256, u256> storage;
+	};
+
+	/// A call frame while recording.
+	struct Frame
+	{
+		ExtVMFace const* ext;
+		unsigned depth;
+		unsigned code;
+		unsigned data;
+		unsigned caller;
+	};
+
+	void record(uint64_t _steps, Instruction _inst, bigint const& _newMemSize, bigint const& _gasCost, VM& _vm, ExtVMFace const& _ext);
+	static void apply(Diff const& _d, Machine& io_m);
+
+	unsigned m_interval;
+	std::vector<StepInfo> m_info;
+	std::vector<Diff> m_diffs;
+	std::vector<Machine> m_checkpoints;		///< Of steps 0, m_interval, 2 * m_interval...
+	std::vector<TracedCode> m_codes;
+	std::vector<bytes> m_data;
+
+	// While recording.
+	Machine m_last;
+	std::vector<Frame> m_frames;
+	std::map<std::pair<Address, h256>, unsigned> m_codeIndex;
+	std::map<h256, unsigned> m_dataIndex;
+
+	// The step at() last rebuilt.
+	mutable size_t m_cursor = (size_t)-1;
+	mutable Machine m_cursorMachine;
+};
+
+}
+}
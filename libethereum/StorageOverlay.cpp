@@ -0,0 +1,145 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StorageOverlay.cpp
+ * @date 2015
+ */
+
+#include "StorageOverlay.h"
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+size_t StorageOverlay::home(u256 const& _k) const
+{
+	// Keys are as often small numbers as hashes, so mix all of them.
+	auto const& b = _k.backend();
+	uint64_t x = 0;
+	for (unsigned i = 0; i < b.size(); ++i)
+		x ^= b.limbs()[i];
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33;
+	return x & (m_slots.size() - 1);
+}
+
+StorageOverlay::Slot const* StorageOverlay::find(u256 const& _k) const
+{
+	if (!m_count)
+		return nullptr;
+	size_t mask = m_slots.size() - 1;
+	for (size_t i = home(_k);; i = (i + 1) & mask)
+	{
+		Slot const& s = m_slots[i];
+		if (!s.used)
+			return nullptr;
+		if (s.key == _k)
+			return &s;
+	}
+}
+
+StorageOverlay::Slot& StorageOverlay::insert(u256 const& _k)
+{
+	if ((m_count + 1) * 4 > m_slots.size() * 3)
+		grow();
+	size_t mask = m_slots.size() - 1;
+	for (size_t i = home(_k);; i = (i + 1) & mask)
+	{
+		Slot& s = m_slots[i];
+		if (!s.used)
+		{
+			s.key = _k;
+			s.used = true;
+			s.known = false;
+			++m_count;
+			return s;
+		}
+		if (s.key == _k)
+			return s;
+	}
+}
+
+void StorageOverlay::load(u256 const& _k, u256 const& _v)
+{
+	Slot& s = insert(_k);
+	s.value = s.original = _v;
+	s.known = true;
+}
+
+void StorageOverlay::set(u256 const& _k, u256 const& _v)
+{
+	insert(_k).value = _v;
+}
+
+void StorageOverlay::erase(u256 const& _k)
+{
+	Slot* s = const_cast<Slot*>(find(_k));
+	if (!s)
+		return;
+	s->used = false;
+	--m_count;
+
+	// Shift back the slots after it that would no longer be found.
+	size_t mask = m_slots.size() - 1;
+	size_t i = s - m_slots.data();
+	for (size_t j = (i + 1) & mask; m_slots[j].used; j = (j + 1) & mask)
+	{
+		size_t h = home(m_slots[j].key);
+		if (j > i ? (h <= i || h > j) : (h <= i && h > j))
+		{
+			m_slots[i] = m_slots[j];
+			m_slots[j].used = false;
+			i = j;
+		}
+	}
+}
+
+void StorageOverlay::settle()
+{
+	for (Slot& s: m_slots)
+		if (s.used)
+		{
+			s.original = s.value;
+			s.known = true;
+		}
+}
+
+bool StorageOverlay::dirty() const
+{
+	for (Slot const& s: m_slots)
+		if (s.used && s.dirty())
+			return true;
+	return false;
+}
+
+void StorageOverlay::grow()
+{
+	vector<Slot> old;
+	old.swap(m_slots);
+	m_slots.resize(max<size_t>(old.size() * 2, 8));
+	for (Slot& s: m_slots)
+		s.used = false;
+
+	size_t mask = m_slots.size() - 1;
+	for (Slot const& s: old)
+		if (s.used)
+		{
+			size_t i = home(s.key);
+			while (m_slots[i].used)
+				i = (i + 1) & mask;
+			m_slots[i] = s;
+		}
+}
@@ -0,0 +1,85 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StorageOverlay.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <vector>
+#include <libdevcore/Common.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Open-addressing hash table of the storage slots an Account has read or written, as kept over its
+ * storage trie. Each slot holds its current value and, once read from the trie, its original value, so that
+ * writes which leave a slot as it was need not go back into the trie.
+ */
+class StorageOverlay
+{
+public:
+	struct Slot
+	{
+		u256 key;
+		u256 value;					///< The current value.
+		u256 original;				///< The value in the storage trie, if known.
+		bool used;
+		bool known;					///< Whether original is known.
+
+		/// @returns false only if the value is known to be the one in the storage trie.
+		bool dirty() const { return !known || value != original; }
+	};
+
+	StorageOverlay() {}
+
+	/// @returns the slot of @a _k, or null if there is none.
+	Slot const* find(u256 const& _k) const;
+
+	/// Notes @a _v as the value of @a _k in the storage trie, as well as its current value.
+	void load(u256 const& _k, u256 const& _v);
+	/// Sets the current value of @a _k, keeping what is known of its original value.
+	void set(u256 const& _k, u256 const& _v);
+	/// Removes the slot of @a _k, if any.
+	void erase(u256 const& _k);
+	/// Takes the current value of every slot as its original, as once it is committed to the trie.
+	void settle();
+
+	void clear() { *this = StorageOverlay(); }
+
+	size_t size() const { return m_count; }
+	bool empty() const { return !m_count; }
+	/// @returns true if any slot is dirty.
+	bool dirty() const;
+
+	/// Calls @a _f with every slot in use, in no particular order.
+	template <class F> void forEach(F const& _f) const { for (Slot const& s: m_slots) if (s.used) _f(s); }
+
+private:
+	size_t home(u256 const& _k) const;
+	Slot& insert(u256 const& _k);
+	void grow();
+
+	std::vector<Slot> m_slots;		///< Power-of-two sized; linear probing.
+	size_t m_count = 0;
+};
+
+}
+}
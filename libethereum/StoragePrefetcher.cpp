@@ -0,0 +1,107 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StoragePrefetcher.cpp
+ * @date 2015
+ */
+
+#include "StoragePrefetcher.h"
+#include <algorithm>
+#include <set>
+#include <libdevcore/Metrics.h>
+#include <libdevcore/ThreadPool.h>
+#include <libdevcrypto/TrieDB.h>
+#include <libethcore/CodeStore.h>
+#include <libevm/AnalysedCode.h>
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+const unsigned StoragePrefetcher::c_maxHistory;
+const size_t StoragePrefetcher::c_historyCapacity;
+
+StoragePrefetcher& StoragePrefetcher::get()
+{
+	static StoragePrefetcher s_this;
+	return s_this;
+}
+
+void StoragePrefetcher::prefetch(OverlayDB const& _db, h256 const& _root, vector<Address> const& _addresses)
+{
+	ThreadPool& pool = ThreadPool::get();
+	if (!pool.size())
+		return;
+	for (Address const& a: set<Address>(_addresses.begin(), _addresses.end()))
+	{
+		// Each its own copy, which shares the overlay, as the caller goes on to change its own.
+		OverlayDB db = _db;
+		pool.post([=]() mutable { prefetch(db, _root, a); });
+	}
+}
+
+void StoragePrefetcher::prefetch(OverlayDB& _db, h256 const& _root, Address const& _a)
+{
+	static MetricCounter& s_read = Metrics::get().counter("eth_storage_prefetched_slots_total", "Storage slots read ahead of the transactions loading them.");
+
+	StateSnapshot* snapshot = _db.snapshot();
+	string account;
+	if (!snapshot->account(_root, _a, account))
+	{
+		account = SecureTrieDB<Address, OverlayDB>(&_db, _root).at(_a);
+		snapshot->noteAccount(_root, _a, account);
+	}
+	if (account.empty())
+		return;
+	RLP state(account);
+	h256 storageRoot = state[2].toHash<h256>();
+	h256 codeHash = state[3].toHash<h256>();
+	if (codeHash == EmptySHA3 || storageRoot == EmptyTrie)
+		return;
+
+	// Loading and analysing the code now spares the VM that too.
+	SharedCode code = CodeStore::get().code(codeHash, [&]() { return asBytes(_db.lookup(codeHash)); });
+	u256s slots = AnalysedCode::cached(codeHash, code)->constantSlots();
+	u256s seen = history(codeHash);
+	slots.insert(slots.end(), seen.begin(), seen.end());
+
+	SecureTrieDB<h256, OverlayDB> storage(&_db, storageRoot);
+	for (u256 const& s: slots)
+	{
+		u256 v;
+		if (snapshot->storage(_root, _a, s, v))
+			continue;
+		string payload = storage.at(s);
+		snapshot->noteStorage(_root, _a, s, payload.size() ? RLP(payload).toInt<u256>() : 0);
+		s_read.inc();
+	}
+}
+
+void StoragePrefetcher::noteLoads(h256 const& _codeHash, u256s const& _slots)
+{
+	m_history.update(_codeHash, u256s(), [&](u256s& io_slots)
+	{
+		for (u256 const& s: _slots)
+			if (io_slots.size() < c_maxHistory && find(io_slots.begin(), io_slots.end(), s) == io_slots.end())
+				io_slots.push_back(s);
+	});
+}
+
+u256s StoragePrefetcher::history(h256 const& _codeHash)
+{
+	u256s ret;
+	m_history.get(_codeHash, ret);
+	return ret;
+}
@@ -0,0 +1,72 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StoragePrefetcher.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/ShardedCache.h>
+#include <libdevcrypto/OverlayDB.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Reads ahead the storage slots that contracts are about to load, so that the VM finds them in the state
+ * DB's flat index rather than walking the storage trie for each SLOAD in turn.
+ * The slots of a contract are those its code loads from a key it has just pushed, and those its code was seen
+ * to load before. Each contract's are read by a task of the shared thread pool, on its own copy of the DB, while
+ * the block executes; nothing waits for them.
+ * @threadsafe
+ */
+class StoragePrefetcher
+{
+public:
+	static StoragePrefetcher& get();
+
+	/// Starts reading the likely slots of each of the accounts @a _addresses in the state of root @a _root in
+	/// @a _db, noting them in @a _db's flat index. Does nothing when the thread pool has no threads.
+	void prefetch(OverlayDB const& _db, h256 const& _root, std::vector<Address> const& _addresses);
+
+	/// Notes that the code of hash @a _codeHash loaded the slots @a _slots.
+	void noteLoads(h256 const& _codeHash, u256s const& _slots);
+	/// @returns the slots noted as loaded by the code of hash @a _codeHash.
+	u256s history(h256 const& _codeHash);
+
+	/// The most slots remembered for one code.
+	static const unsigned c_maxHistory = 64;
+	static const size_t c_historyCapacity = 8 * 1024 * 1024;
+
+private:
+	StoragePrefetcher(): m_history(c_historyCapacity) {}
+
+	/// Reads the likely slots of @a _a; run on the thread pool.
+	void prefetch(OverlayDB& _db, h256 const& _root, Address const& _a);
+
+	struct Size { size_t operator()(u256s const& _s) const { return _s.size() * sizeof(u256); } };
+
+	ShardedCache<h256, u256s, Size> m_history;
+};
+
+}
+}
@@ -22,6 +22,8 @@
 #include <libdevcore/vector_ref.h>
 #include <libdevcore/Log.h>
 #include <libdevcore/CommonIO.h>
+#include <libdevcore/RLPSchema.h>
+#include <libdevcore/ThreadPool.h>
 #include <libdevcrypto/Common.h>
 #include <libethcore/Exceptions.h>
 #include <libevm/VMFace.h>
@@ -56,32 +58,27 @@ TransactionException dev::eth::toTransactionException(VMException const& _e)
 
 Transaction::Transaction(bytesConstRef _rlpData, CheckTransaction _checkSig)
 {
-	int field = 0;
+	unsigned field = 0;
 	RLP rlp(_rlpData);
 	try
 	{
 		if (!rlp.isList())
 			BOOST_THROW_EXCEPTION(BadRLP() << errinfo_comment("transaction RLP must be a list"));
 
-		m_nonce = rlp[field = 0].toInt<u256>();
-		m_gasPrice = rlp[field = 1].toInt<u256>();
-		m_gas = rlp[field = 2].toInt<u256>();
-		m_type = rlp[field = 3].isEmpty() ? ContractCreation : MessageCall;
-		m_receiveAddress = rlp[field = 3].isEmpty() ? Address() : rlp[field = 3].toHash<Address>(RLP::VeryStrict);
-		m_value = rlp[field = 4].toInt<u256>();
+		bytesConstRef to;
+		byte v;
+		u256 r;
+		u256 s;
+		if (!decodeRLPList(_rlpData, field, m_nonce, m_gasPrice, m_gas, to, m_value, m_data, v, r, s))
+			BOOST_THROW_EXCEPTION(BadRLP() << errinfo_comment("transaction RLP must have nine fields"));
 
-		if (!rlp[field = 5].isData())
-			BOOST_THROW_EXCEPTION(BadRLP() << errinfo_comment("transaction data RLP must be an array"));
+		field = 3;
+		m_type = to.empty() ? ContractCreation : MessageCall;
+		if (!to.empty() && to.size() != Address::size)
+			BOOST_THROW_EXCEPTION(BadCast());
+		m_receiveAddress = to.empty() ? Address() : Address(to);
 
-		m_data = rlp[field = 5].toBytes();
-		byte v = rlp[field = 6].toInt<byte>() - 27;
-		h256 r = rlp[field = 7].toInt<u256>();
-		h256 s = rlp[field = 8].toInt<u256>();
-
-		if (rlp.itemCount() > 9)
-			BOOST_THROW_EXCEPTION(BadRLP() << errinfo_comment("to many fields in the transaction RLP"));
-
-		m_vrs = SignatureStruct{ r, s, v };
+		m_vrs = SignatureStruct{ h256(r), h256(s), byte(v - 27) };
 		if (_checkSig >= CheckTransaction::Cheap && !m_vrs.isValid())
 			BOOST_THROW_EXCEPTION(InvalidSignature());
 		if (_checkSig == CheckTransaction::Everything)
@@ -96,6 +93,30 @@ Transaction::Transaction(bytesConstRef _rlpData, CheckTransaction _checkSig)
 		BOOST_THROW_EXCEPTION(OutOfGasBase() << RequirementError(gasRequired(), (bigint)gas()));
 }
 
+DecodedTransaction::DecodedTransaction(bytesConstRef _rlp, CheckTransaction _checkSig)
+{
+	try
+	{
+		transaction = Transaction(_rlp, _checkSig);
+	}
+	catch (...)
+	{
+		error = current_exception();
+	}
+}
+
+DecodedTransactions dev::eth::decodeTransactions(RLP const& _txs, CheckTransaction _checkSig)
+{
+	// RLP caches its last lookup, so it must not be indexed from several threads.
+	vector<bytesConstRef> rlps;
+	for (auto const& tr: _txs)
+		rlps.push_back(tr.data());
+
+	DecodedTransactions ret(rlps.size());
+	ThreadPool::get().forEach(rlps.size(), [&](unsigned i) { ret[i] = DecodedTransaction(rlps[i], _checkSig); });
+	return ret;
+}
+
 Address const& Transaction::safeSender() const noexcept
 {
 	try
@@ -133,7 +154,11 @@ void Transaction::sign(Secret _priv)
 	auto sig = dev::sign(_priv, sha3(WithoutSignature));
 	SignatureStruct sigStruct = *(SignatureStruct const*)&sig;
 	if (sigStruct.isValid())
+	{
 		m_vrs = sigStruct;
+		// Cheaper from the secret than recovering it from the signature later.
+		m_sender = toAddress(_priv);
+	}
 }
 
 void Transaction::streamRLP(RLPStream& _s, IncludeSignature _sig) const
@@ -21,10 +21,12 @@
 
 #pragma once
 
+#include <exception>
 #include <libdevcore/RLP.h>
 #include <libdevcrypto/SHA3.h>
 #include <libethcore/Common.h>
 #include <libethcore/Params.h>
+#include "AccessSet.h"
 namespace dev
 {
 namespace eth
@@ -93,6 +95,7 @@ struct ExecutionResult
 	u256 gasRefunded = 0;
 	unsigned depositSize = 0;
 	u256 gasForDeposit;
+	AccessSet accesses;			///< What the transaction read and wrote, if it was traced.
 };
 
 std::ostream& operator<<(std::ostream& _out, ExecutionResult const& _er);
@@ -148,10 +151,10 @@ public:
 	void streamRLP(RLPStream& _s, IncludeSignature _sig = WithSignature) const;
 
 	/// @returns the RLP serialisation of this transaction.
-	bytes rlp(IncludeSignature _sig = WithSignature) const { RLPStream s; streamRLP(s, _sig); return s.out(); }
+	bytes rlp(IncludeSignature _sig = WithSignature) const { return rlpExact([&](RLPStream& _s){ streamRLP(_s, _sig); }); }
 
 	/// @returns the SHA3 hash of the RLP serialisation of this transaction.
-	h256 sha3(IncludeSignature _sig = WithSignature) const { RLPStream s; streamRLP(s, _sig); return dev::sha3(s.out()); }
+	h256 sha3(IncludeSignature _sig = WithSignature) const { return dev::sha3(rlp(_sig)); }
 
 	/// @returns the amount of ETH to be transferred by this (message-call) transaction, in Wei. Synonym for endowment().
 	u256 value() const { return m_value; }
@@ -214,6 +217,26 @@ private:
 /// Nice name for vector of Transaction.
 using Transactions = std::vector<Transaction>;
 
+/// A transaction decoded ahead of its use, or the exception decoding it threw.
+struct DecodedTransaction
+{
+	DecodedTransaction() = default;
+	/// Decodes @a _rlp as Transaction(_rlp, _checkSig) does, keeping rather than throwing any exception.
+	DecodedTransaction(bytesConstRef _rlp, CheckTransaction _checkSig);
+
+	/// @returns the transaction, rethrowing the exception from decoding it if there was one.
+	Transaction const& get() const { if (error) std::rethrow_exception(error); return transaction; }
+
+	Transaction transaction;
+	std::exception_ptr error;
+};
+
+using DecodedTransactions = std::vector<DecodedTransaction>;
+
+/// Decodes the RLP list of transactions @a _txs, recovering the senders on ThreadPool::get().
+/// The senders are cached on the transactions, so later calls to sender() are free.
+DecodedTransactions decodeTransactions(RLP const& _txs, CheckTransaction _checkSig = CheckTransaction::Everything);
+
 /// Simple human-readable stream-shift operator.
 inline std::ostream& operator<<(std::ostream& _out, Transaction const& _t)
 {
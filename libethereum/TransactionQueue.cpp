@@ -21,7 +21,9 @@
 
 #include "TransactionQueue.h"
 
+#include <queue>
 #include <libdevcore/Log.h>
+#include <libdevcore/ThreadPool.h>
 #include <libethcore/Exceptions.h>
 #include "Transaction.h"
 using namespace std;
@@ -32,79 +34,307 @@ ImportResult TransactionQueue::import(bytesConstRef _transactionRLP)
 {
 	// Check if we already know this transaction.
 	h256 h = sha3(_transactionRLP);
+	{
+		ReadGuard l(m_lock);
+		if (m_queue.count(h))
+			return ImportResult::AlreadyKnown;
+		if (m_bad.count(h))
+			return ImportResult::Malformed;
+	}
 
-	UpgradableGuard l(m_lock);
-	// TODO: keep old transactions around and check in State for nonce validity
+	// Check validity of _transactionRLP as a transaction. To do this we just deserialise and attempt to determine the sender.
+	// If it doesn't work, the signature is bad.
+	// The transaction's nonce may yet be invalid (or, it could be "valid" but we may be missing a marginally older transaction).
+	// Sender recovery is the costly part, so it happens without the lock.
+	return insert(h, DecodedTransaction(_transactionRLP, CheckTransaction::Everything));
+}
+
+ImportResult TransactionQueue::import(Transaction const& _t)
+{
+	DecodedTransaction t;
+	t.transaction = _t;
+	return insert(_t.sha3(), t);
+}
+
+vector<ImportResult> TransactionQueue::import(Transactions const& _ts)
+{
+	h256s hashes;
+	DecodedTransactions decoded(_ts.size());
+	for (unsigned i = 0; i < _ts.size(); ++i)
+	{
+		hashes.push_back(_ts[i].sha3());
+		decoded[i].transaction = _ts[i];
+	}
+	return insert(hashes, decoded);
+}
+
+vector<ImportResult> TransactionQueue::importBatch(RLP const& _txs)
+{
+	vector<bytesConstRef> rlps;
+	h256s hashes;
+	for (auto const& tr: _txs)
+	{
+		rlps.push_back(tr.data());
+		hashes.push_back(sha3(tr.data()));
+	}
 
-	if (m_known.count(h))
-		return ImportResult::AlreadyKnown;
+	vector<ImportResult> ret(rlps.size(), ImportResult::AlreadyKnown);
+	vector<unsigned> unknown;
+	{
+		ReadGuard l(m_lock);
+		for (unsigned i = 0; i < hashes.size(); ++i)
+			if (m_bad.count(hashes[i]))
+				ret[i] = ImportResult::Malformed;
+			else if (!m_queue.count(hashes[i]))
+				unknown.push_back(i);
+	}
+
+	DecodedTransactions decoded(unknown.size());
+	h256s unknownHashes;
+	for (unsigned i: unknown)
+		unknownHashes.push_back(hashes[i]);
+	ThreadPool::get().forEach(unknown.size(), [&](unsigned i) { decoded[i] = DecodedTransaction(rlps[unknown[i]], CheckTransaction::Everything); });
+	vector<ImportResult> inserted = insert(unknownHashes, decoded);
+	for (unsigned i = 0; i < unknown.size(); ++i)
+		ret[unknown[i]] = inserted[i];
+	return ret;
+}
 
+ImportResult TransactionQueue::insert(h256 const& _h, DecodedTransaction const& _t)
+{
+	ImportResult ret;
+	{
+		WriteGuard l(m_lock);
+		ret = insertWithoutWriteGuard(_h, _t);
+	}
+	if (ret == ImportResult::Success && m_onReady)
+		m_onReady();
+	return ret;
+}
+
+vector<ImportResult> TransactionQueue::insert(h256s const& _hs, DecodedTransactions const& _ts)
+{
+	vector<ImportResult> ret;
+	{
+		WriteGuard l(m_lock);
+		for (unsigned i = 0; i < _ts.size(); ++i)
+			ret.push_back(insertWithoutWriteGuard(_hs[i], _ts[i]));
+	}
+	if (count(ret.begin(), ret.end(), ImportResult::Success) && m_onReady)
+		m_onReady();
+	return ret;
+}
+
+ImportResult TransactionQueue::insertWithoutWriteGuard(h256 const& _h, DecodedTransaction const& _t)
+{
 	try
 	{
-		// Check validity of _transactionRLP as a transaction. To do this we just deserialise and attempt to determine the sender.
-		// If it doesn't work, the signature is bad.
-		// The transaction's nonce may yet be invalid (or, it could be "valid" but we may be missing a marginally older transaction).
-		Transaction t(_transactionRLP, CheckTransaction::Everything);
+		Transaction const& t = _t.get();
+
+		// TODO: keep old transactions around and check in State for nonce validity
+		if (m_queue.count(_h))
+			return ImportResult::AlreadyKnown;
+
+		auto& nonces = m_senders[t.sender()];
+		auto it = nonces.find(t.nonce());
+		if (it != nonces.end())
+		{
+			// Same sender and nonce: only one paying more takes its place.
+			QueuedTransaction const& old = m_queue.at(it->second);
+			if (old.transaction.gasPrice() >= t.gasPrice())
+				return ImportResult::AlreadyKnown;
+			m_priced.erase(make_pair(old.transaction.gasPrice(), it->second));
+			m_futurePriced.erase(make_pair(old.transaction.gasPrice(), it->second));
+			m_queue.erase(it->second);
+			it->second = _h;
+		}
+		else
+			it = nonces.insert(make_pair(t.nonce(), _h)).first;
+
+		m_queue.insert(make_pair(_h, QueuedTransaction{t, false}));
+		m_priced.insert(make_pair(t.gasPrice(), _h));
+
+		// It is current if it is the sender's first, or follows on from a current one.
+		auto prev = it;
+		bool current = it == nonces.begin() || (--prev, prev->first + 1 == t.nonce() && !m_queue.at(prev->second).future);
+		settleWithoutWriteGuard(nonces, it, current);
 
-		UpgradeGuard ul(l);
-		// If valid, append to blocks.
-		m_current[h] = t;
-		m_known.insert(h);
+		evictWithoutWriteGuard();
+		if (!m_queue.count(_h))
+			return ImportResult::AlreadyKnown;
 
-		ctxq << "Queued vaguely legit-looking transaction" << h.abridged();
+		ctxq << "Queued vaguely legit-looking transaction" << _h.abridged();
 	}
 	catch (Exception const& _e)
 	{
 		ctxq << "Ignoring invalid transaction: " <<  diagnostic_information(_e);
+		if (_t.error)
+			noteBadWithoutWriteGuard(_h);
 		return ImportResult::Malformed;
 	}
 	catch (std::exception const& _e)
 	{
 		ctxq << "Ignoring invalid transaction: " << _e.what();
+		if (_t.error)
+			noteBadWithoutWriteGuard(_h);
 		return ImportResult::Malformed;
 	}
 
 	return ImportResult::Success;
 }
 
-void TransactionQueue::setFuture(std::pair<h256, Transaction> const& _t)
+void TransactionQueue::noteBadWithoutWriteGuard(h256 const& _h)
+{
+	// Whether it decodes and is signed depends on nothing but its RLP, so it is as bad every time it comes.
+	if (!m_bad.insert(_h).second)
+		return;
+	m_badOrder.push_back(_h);
+	if (m_badOrder.size() > c_maxBad)
+	{
+		m_bad.erase(m_badOrder.front());
+		m_badOrder.pop_front();
+	}
+}
+
+unsigned TransactionQueue::settleWithoutWriteGuard(map<u256, h256>& _nonces, map<u256, h256>::iterator _it, bool _current)
+{
+	unsigned ret = 0;
+	for (auto last = _it; _it != _nonces.end(); last = _it++)
+	{
+		if (_it != last && last->first + 1 != _it->first)
+			_current = false;
+		QueuedTransaction& q = m_queue.at(_it->second);
+		if (!_current && q.future)
+			// Those after a future one are future already.
+			break;
+		if (_current && q.future)
+			++ret;
+		if (q.future == _current)
+			setFutureWithoutWriteGuard(q, _it->second, !_current);
+	}
+	return ret;
+}
+
+void TransactionQueue::setFutureWithoutWriteGuard(QueuedTransaction& _q, h256 const& _h, bool _future)
+{
+	_q.future = _future;
+	if (_future)
+		m_futurePriced.insert(make_pair(_q.transaction.gasPrice(), _h));
+	else
+		m_futurePriced.erase(make_pair(_q.transaction.gasPrice(), _h));
+}
+
+void TransactionQueue::removeWithoutWriteGuard(h256 const& _h, bool _gap)
+{
+	auto q = m_queue.find(_h);
+	if (q == m_queue.end())
+		return;
+	Transaction const& t = q->second.transaction;
+	auto s = m_senders.find(t.sender());
+	auto it = s->second.find(t.nonce());
+	auto next = s->second.erase(it);
+	if (_gap && !q->second.future && next != s->second.end())
+		settleWithoutWriteGuard(s->second, next, false);
+	if (s->second.empty())
+		m_senders.erase(s);
+	m_priced.erase(make_pair(t.gasPrice(), _h));
+	m_futurePriced.erase(make_pair(t.gasPrice(), _h));
+	m_queue.erase(q);
+}
+
+void TransactionQueue::evictWithoutWriteGuard()
+{
+	// Evicting a current transaction leaves a gap, making its sender's later ones future, so check both limits again.
+	while (m_queue.size() > m_limit || m_futurePriced.size() > m_futureLimit)
+		if (m_futurePriced.size() > m_futureLimit)
+			removeWithoutWriteGuard(m_futurePriced.begin()->second, true);
+		else
+			removeWithoutWriteGuard(m_priced.begin()->second, true);
+}
+
+void TransactionQueue::setLimits(unsigned _limit, unsigned _futureLimit)
 {
 	WriteGuard l(m_lock);
-	if (m_current.count(_t.first))
+	m_limit = _limit;
+	m_futureLimit = _futureLimit;
+	evictWithoutWriteGuard();
+}
+
+map<h256, Transaction> TransactionQueue::transactions() const
+{
+	ReadGuard l(m_lock);
+	map<h256, Transaction> ret;
+	for (auto const& q: m_queue)
+		if (!q.second.future)
+			ret.insert(make_pair(q.first, q.second.transaction));
+	return ret;
+}
+
+vector<pair<h256, Transaction>> TransactionQueue::topTransactions(unsigned _limit) const
+{
+	ReadGuard l(m_lock);
+
+	// A heap of each sender's next current transaction; taking one puts the sender's following one in its place.
+	struct Head
+	{
+		u256 gasPrice;
+		map<u256, h256>::const_iterator it;
+		map<u256, h256>::const_iterator end;
+		bool operator<(Head const& _h) const { return gasPrice < _h.gasPrice; }
+	};
+	priority_queue<Head> heads;
+	auto push = [&](map<u256, h256>::const_iterator _it, map<u256, h256>::const_iterator _end)
 	{
-		m_current.erase(_t.first);
-		m_unknown.insert(make_pair(_t.second.sender(), _t));
+		if (_it != _end)
+		{
+			QueuedTransaction const& q = m_queue.at(_it->second);
+			if (!q.future)
+				heads.push(Head{q.transaction.gasPrice(), _it, _end});
+		}
+	};
+	for (auto const& s: m_senders)
+		push(s.second.begin(), s.second.end());
+
+	vector<pair<h256, Transaction>> ret;
+	while (!heads.empty() && ret.size() < _limit)
+	{
+		Head h = heads.top();
+		heads.pop();
+		ret.push_back(make_pair(h.it->second, m_queue.at(h.it->second).transaction));
+		push(++h.it, h.end);
 	}
+	return ret;
 }
 
-void TransactionQueue::noteGood(std::pair<h256, Transaction> const& _t)
+void TransactionQueue::setFuture(std::pair<h256, Transaction> const& _t)
 {
 	WriteGuard l(m_lock);
-	auto r = m_unknown.equal_range(_t.second.sender());
-	for (auto it = r.first; it != r.second; ++it)
-		m_current.insert(it->second);
-	m_unknown.erase(r.first, r.second);
+	auto q = m_queue.find(_t.first);
+	if (q == m_queue.end() || q->second.future)
+		return;
+	auto& nonces = m_senders.at(_t.second.sender());
+	settleWithoutWriteGuard(nonces, nonces.find(_t.second.nonce()), false);
+}
+
+bool TransactionQueue::noteGood(std::pair<h256, Transaction> const& _t)
+{
+	WriteGuard l(m_lock);
+	auto s = m_senders.find(_t.second.sender());
+	if (s == m_senders.end())
+		return false;
+	auto it = s->second.upper_bound(_t.second.nonce());
+	if (it == s->second.end() || it->first != _t.second.nonce() + 1)
+		return false;
+	return settleWithoutWriteGuard(s->second, it, true) > 0;
 }
 
 void TransactionQueue::drop(h256 _txHash)
 {
 	UpgradableGuard l(m_lock);
 
-	if (!m_known.count(_txHash))
+	if (!m_queue.count(_txHash))
 		return;
 
 	UpgradeGuard ul(l);
-	m_known.erase(_txHash);
-
-	if (m_current.count(_txHash))
-		m_current.erase(_txHash);
-	else
-	{
-		for (auto i = m_unknown.begin(); i != m_unknown.end(); ++i)
-			if (i->second.first == _txHash)
-			{
-				m_unknown.erase(i);
-				break;
-			}
-	}
+	removeWithoutWriteGuard(_txHash, false);
 }
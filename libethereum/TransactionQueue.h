@@ -21,6 +21,10 @@
 
 #pragma once
 
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
 #include <boost/thread.hpp>
 #include <libdevcore/Common.h>
 #include <libdevcore/Guards.h>
@@ -39,30 +43,101 @@ struct TransactionQueueChannel: public LogChannel { static const char* name() {
 #define ctxq dev::LogOutputStream<dev::eth::TransactionQueueChannel, true>()
 
 /**
- * @brief A queue of Transactions, each stored as RLP.
+ * @brief A pool of Transactions, each stored as RLP.
+ * Each sender's transactions are kept sorted by nonce. Those that can run in turn, with no nonce missing before
+ * them, are current; those after a gap are future, and are promoted as soon as the gap fills. Block assembly
+ * takes current transactions through topTransactions(), highest gas price first but each sender's in nonce order.
+ * When the pool, or its future part, is over its limit, the transaction paying least is evicted.
+ * Senders are recovered without the lock. Those that cannot be, or do not decode, are remembered, the latest
+ * c_maxBad of them, and turned away at once should they come again.
  * @threadsafe
  */
 class TransactionQueue
 {
 public:
+	/// Holds at most @a _limit transactions, of which at most @a _futureLimit may be future.
+	explicit TransactionQueue(unsigned _limit = 1024, unsigned _futureLimit = 256): m_limit(_limit), m_futureLimit(_futureLimit) { setLockName(m_lock, "TransactionQueue::m_lock"); }
+
+	/// Queues a transaction. It replaces a queued one of the same sender and nonce only if it pays a higher gas price.
+	/// @returns AlreadyKnown also if it would be replacing one paying as much, or be evicted at once as the cheapest of a full pool.
 	ImportResult import(bytes const& _tx) { return import(&_tx); }
 	ImportResult import(bytesConstRef _tx);
+	/// Queues @a _t, made and signed here, without decoding it or recovering its sender again.
+	ImportResult import(Transaction const& _t);
+	/// Queues each of @a _ts as import(Transaction const&) does, all under the one lock, with one call of the onReady
+	/// function at most. @returns the result for each transaction.
+	std::vector<ImportResult> import(Transactions const& _ts);
+	/// Import each transaction of the RLP list @a _txs, recovering their senders in parallel and queueing them all under
+	/// the one lock. @returns the result for each transaction.
+	std::vector<ImportResult> importBatch(RLP const& _txs);
 
 	void drop(h256 _txHash);
+	/// @returns true if the transaction @a _txHash is queued, current or future.
+	bool contains(h256 const& _txHash) const { ReadGuard l(m_lock); return m_queue.count(_txHash); }
+	/// @returns true if the transaction @a _txHash was lately found not to decode or not to be signed properly.
+	bool isBad(h256 const& _txHash) const { ReadGuard l(m_lock); return m_bad.count(_txHash); }
+	/// @returns the queued transaction @a _txHash, or a null transaction if there is none.
+	Transaction transaction(h256 const& _txHash) const { ReadGuard l(m_lock); auto it = m_queue.find(_txHash); return it == m_queue.end() ? Transaction() : it->second.transaction; }
+
+	/// @returns the current transactions, by hash.
+	std::map<h256, Transaction> transactions() const;
+	/// @returns up to @a _limit current transactions, highest gas price first, except that each sender's go in nonce order.
+	std::vector<std::pair<h256, Transaction>> topTransactions(unsigned _limit = (unsigned)-1) const;
+	/// @returns the numbers of current and of future transactions.
+	std::pair<unsigned, unsigned> items() const { ReadGuard l(m_lock); return std::make_pair(unsigned(m_queue.size() - m_futurePriced.size()), unsigned(m_futurePriced.size())); }
+
+	/// Notes that @a _t has a nonce beyond its sender's next; it and the sender's later transactions become future.
+	void setFuture(std::pair<h256, Transaction> const& _t);
+	/// Notes that @a _t has been executed, promoting any of its sender's future transactions that now follow on.
+	/// @returns true if any were promoted.
+	bool noteGood(std::pair<h256, Transaction> const& _t);
 
-	std::map<h256, Transaction> transactions() const { ReadGuard l(m_lock); return m_current; }
-	std::pair<unsigned, unsigned> items() const { ReadGuard l(m_lock); return std::make_pair(m_current.size(), m_unknown.size()); }
+	/// Sets the limits on all transactions and on future ones, evicting the cheapest at once down to them.
+	void setLimits(unsigned _limit, unsigned _futureLimit);
 
-	void setFuture(std::pair<h256, Transaction> const& _t);
-	void noteGood(std::pair<h256, Transaction> const& _t);
+	/// Empties the queue. The bad are still bad, so are still remembered.
+	void clear() { WriteGuard l(m_lock); m_queue.clear(); m_senders.clear(); m_priced.clear(); m_futurePriced.clear(); }
+
+	/// The most bad transactions remembered.
+	static const unsigned c_maxBad = 4096;
 
-	void clear() { WriteGuard l(m_lock); m_known.clear(); m_current.clear(); m_unknown.clear(); }
+	/// Sets @a _f to be called whenever transactions are queued, once for each import. Call before any is imported.
+	void onReady(std::function<void()> const& _f) { m_onReady = _f; }
 
 private:
-	mutable boost::shared_mutex m_lock;							///< General lock.
-	std::set<h256> m_known;										///< Hashes of transactions in both sets.
-	std::map<h256, Transaction> m_current;						///< Map of SHA3(tx) to tx.
-	std::multimap<Address, std::pair<h256, Transaction>> m_unknown;	///< For transactions that have a future nonce; we map their sender address to the tx stuff, and insert once the sender has a valid TX.
+	struct QueuedTransaction
+	{
+		Transaction transaction;
+		bool future;
+	};
+	using PriceIndex = std::set<std::pair<u256, h256>>;
+
+	/// Queue the transaction @a _t with hash @a _h unless it is known or failed to decode.
+	ImportResult insert(h256 const& _h, DecodedTransaction const& _t);
+	/// Queue each of the transactions @a _ts, with hashes @a _hs, as insert() does, under the one lock.
+	std::vector<ImportResult> insert(h256s const& _hs, DecodedTransactions const& _ts);
+	ImportResult insertWithoutWriteGuard(h256 const& _h, DecodedTransaction const& _t);
+	/// Removes the transaction @a _h, demoting its sender's later ones if @a _gap is true.
+	void removeWithoutWriteGuard(h256 const& _h, bool _gap);
+	/// Marks the sender's transaction at @a _it current if @a _current, and those after it current while their nonces
+	/// follow on without a gap from a current one; the rest become future. @returns the number promoted.
+	unsigned settleWithoutWriteGuard(std::map<u256, h256>& _nonces, std::map<u256, h256>::iterator _it, bool _current);
+	void setFutureWithoutWriteGuard(QueuedTransaction& _q, h256 const& _h, bool _future);
+	/// Evicts the cheapest transactions until within the limits.
+	void evictWithoutWriteGuard();
+	/// Remembers @a _h as bad, forgetting the longest remembered beyond c_maxBad.
+	void noteBadWithoutWriteGuard(h256 const& _h);
+
+	mutable SharedMutex m_lock;									///< General lock.
+	std::unordered_map<h256, QueuedTransaction> m_queue;		///< Every queued transaction, by SHA3(tx).
+	std::map<Address, std::map<u256, h256>> m_senders;			///< Each sender's queued transactions, by nonce.
+	PriceIndex m_priced;										///< Every queued transaction, cheapest first.
+	PriceIndex m_futurePriced;									///< The future transactions, cheapest first.
+	std::unordered_set<h256> m_bad;								///< Transactions that do not decode or whose senders cannot be recovered.
+	std::deque<h256> m_badOrder;								///< m_bad, longest remembered first.
+	unsigned m_limit;
+	unsigned m_futureLimit;
+	std::function<void()> m_onReady;								///< Called whenever transactions are queued.
 };
 
 }
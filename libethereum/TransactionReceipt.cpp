@@ -50,6 +50,82 @@ void TransactionReceipt::streamRLP(RLPStream& _s) const
 		l.streamRLP(_s);
 }
 
+void TransactionReceipt::appendCompact(bytes& io_out) const
+{
+	io_out += m_stateRoot.asBytes();
+	bytes gas = toCompactBigEndian(m_gasUsed);
+	io_out.push_back((byte)gas.size());
+	io_out += gas;
+	appendSparseBloom(io_out, m_bloom);
+	RLPStream s(m_log.size());
+	for (LogEntry const& l: m_log)
+		l.streamRLP(s);
+	io_out += s.out();
+}
+
+TransactionReceipt TransactionReceipt::fromCompact(bytesConstRef _data)
+{
+	TransactionReceipt ret;
+	if (_data.size() < h256::size + 1 || _data.size() < h256::size + 1 + (size_t)_data[h256::size])
+		BOOST_THROW_EXCEPTION(BadRLP());
+	ret.m_stateRoot = h256(_data.cropped(0, h256::size));
+	unsigned gas = _data[h256::size];
+	ret.m_gasUsed = fromBigEndian<u256>(_data.cropped(h256::size + 1, gas));
+	_data = _data.cropped(h256::size + 1 + gas);
+	ret.m_bloom = readSparseBloom(_data);
+	for (auto const& i: RLP(_data))
+		ret.m_log.emplace_back(i);
+	return ret;
+}
+
+void dev::eth::appendSparseBloom(bytes& io_out, LogBloom const& _b)
+{
+	bytes bits;
+	for (unsigned i = 0; i < LogBloom::size && bits.size() < 254; ++i)
+		for (unsigned j = 0; j < 8; ++j)
+			if (_b[i] & (1 << j))
+			{
+				bits.push_back((byte)(i * 8 + j));
+				bits.push_back((byte)((i * 8 + j) >> 8));
+			}
+	if (bits.size() < 254)
+	{
+		io_out.push_back((byte)(bits.size() / 2));
+		io_out += bits;
+	}
+	else
+	{
+		io_out.push_back(0xff);
+		io_out += _b.asBytes();
+	}
+}
+
+LogBloom dev::eth::readSparseBloom(bytesConstRef& io_data)
+{
+	LogBloom ret;
+	if (io_data.empty())
+		BOOST_THROW_EXCEPTION(BadRLP());
+	unsigned count = io_data[0];
+	if (count == 0xff)
+	{
+		if (io_data.size() < 1 + LogBloom::size)
+			BOOST_THROW_EXCEPTION(BadRLP());
+		ret = LogBloom(io_data.cropped(1, LogBloom::size));
+		io_data = io_data.cropped(1 + LogBloom::size);
+		return ret;
+	}
+	if (io_data.size() < 1 + count * 2)
+		BOOST_THROW_EXCEPTION(BadRLP());
+	for (unsigned i = 0; i < count; ++i)
+	{
+		unsigned bit = io_data[1 + i * 2] | (io_data[2 + i * 2] << 8);
+		if (bit < LogBloom::size * 8)
+			ret[bit / 8] |= (byte)(1 << (bit % 8));
+	}
+	io_data = io_data.cropped(1 + count * 2);
+	return ret;
+}
+
 std::ostream& dev::eth::operator<<(std::ostream& _out, TransactionReceipt const& _r)
 {
 	_out << "Root: " << _r.stateRoot() << std::endl;
@@ -40,15 +40,25 @@ public:
 	TransactionReceipt(h256 _root, u256 _gasUsed, LogEntries const& _log);
 
 	h256 const& stateRoot() const { return m_stateRoot; }
+	/// Sets the state root, for a receipt made before it was computed.
+	void setStateRoot(h256 const& _root) { m_stateRoot = _root; }
 	u256 const& gasUsed() const { return m_gasUsed; }
 	LogBloom const& bloom() const { return m_bloom; }
 	LogEntries const& log() const { return m_log; }
 
 	void streamRLP(RLPStream& _s) const;
 
-	bytes rlp() const { RLPStream s; streamRLP(s); return s.out(); }
+	bytes rlp() const { return rlpExact([&](RLPStream& _s){ streamRLP(_s); }); }
+
+	/// Appends the receipt to @a io_out as the extras DB keeps it: the state root, the gas used, the bloom as
+	/// appendSparseBloom() has it and the RLP of the log.
+	void appendCompact(bytes& io_out) const;
+	/// @returns the receipt appended as by appendCompact() in @a _data.
+	static TransactionReceipt fromCompact(bytesConstRef _data);
 
 private:
+	TransactionReceipt() {}
+
 	h256 m_stateRoot;
 	u256 m_gasUsed;
 	LogBloom m_bloom;
@@ -57,6 +67,12 @@ private:
 
 using TransactionReceipts = std::vector<TransactionReceipt>;
 
+/// Appends @a _b to @a io_out as the count of its set bits and their indices, or, with too many set for that to be
+/// smaller, as a 0xff and the bloom itself; a receipt without logs thus takes one byte for its bloom rather than 256.
+void appendSparseBloom(bytes& io_out, LogBloom const& _b);
+/// @returns the bloom appended as by appendSparseBloom() at the front of @a io_data, which is advanced past it.
+LogBloom readSparseBloom(bytesConstRef& io_data);
+
 std::ostream& operator<<(std::ostream& _out, eth::TransactionReceipt const& _r);
 
 }
@@ -0,0 +1,130 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file AdaptiveVM.cpp
+ * @date 2015
+ */
+
+#include "AdaptiveVM.h"
+#include <chrono>
+#include "VMFactory.h"
+
+#if ETH_EVMJIT
+#include <evmjit/libevmjit-cpp/JitVM.h>
+#endif
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+/// Number of native runs timed before it is decided whether the JIT is worth it.
+static const unsigned c_trialRuns = 16;
+/// Maximum number of distinct code hashes tracked before all records are flushed.
+static const size_t c_maxRecords = 65536;
+
+unsigned AdaptiveVM::s_promotionThreshold = 100;
+Mutex AdaptiveVM::x_records;
+unordered_map<h256, AdaptiveVM::Record> AdaptiveVM::s_records;
+
+bytesConstRef AdaptiveVM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
+{
+	if (!m_vm)
+	{
+		// Init code has no hash; it runs only once, so it is never worth compiling.
+		m_codeHash = _ext.codeHash;
+		m_tier = m_codeHash ? enter(m_codeHash) : Tier::Interpreter;
+#if ETH_EVMJIT
+		bool native = m_tier == Tier::Trial || m_tier == Tier::JIT;
+		m_vm = VMFactory::create(native ? VMKind::JIT : VMKind::Interpreter, m_gas);
+#else
+		m_vm = VMFactory::create(VMKind::Interpreter, m_gas);
+#endif
+	}
+
+	// Only complete, untraced runs are representative.
+	bool measure = m_codeHash && !_onOp && _steps == (uint64_t)-1 && (m_tier == Tier::Interpreter || m_tier == Tier::Trial);
+	auto gas = m_gas;
+	auto start = chrono::steady_clock::now();
+	bytesConstRef ret;
+	try
+	{
+		ret = m_vm->go(_ext, _onOp, _steps);
+		m_gas = m_vm->gas();
+	}
+	catch (...)
+	{
+		m_gas = m_vm->gas();
+		throw;
+	}
+
+	if (measure)
+	{
+		bool native = m_tier == Tier::Trial;
+#if ETH_EVMJIT
+		native = native && !static_cast<JitVM&>(*m_vm).interpreted();
+#endif
+		leave(m_codeHash, m_tier, native, (double)(gas - m_gas), (double)chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+	}
+	return ret;
+}
+
+AdaptiveVM::Tier AdaptiveVM::enter(h256 const& _codeHash)
+{
+	Guard l(x_records);
+	if (s_records.size() >= c_maxRecords && !s_records.count(_codeHash))
+		s_records.clear();
+	Record& r = s_records[_codeHash];
+	if (r.tier == Tier::Interpreter && ++r.runs > s_promotionThreshold)
+	{
+		r.tier = Tier::Trial;
+		r.runs = 0;
+	}
+	return r.tier;
+}
+
+void AdaptiveVM::leave(h256 const& _codeHash, Tier _tier, bool _native, double _gas, double _ns)
+{
+	Guard l(x_records);
+	auto it = s_records.find(_codeHash);
+	if (it == s_records.end() || it->second.tier != _tier)
+		return;
+	Record& r = it->second;
+	if (_tier == Tier::Interpreter)
+	{
+		r.gas[0] += _gas;
+		r.ns[0] += _ns;
+	}
+	else if (_native && r.runs++)	// The first native run may include the compilation.
+	{
+		r.gas[1] += _gas;
+		r.ns[1] += _ns;
+		if (r.runs > c_trialRuns)
+			// Keep the JIT unless it is no faster per unit of gas than the interpreter was.
+			r.tier = r.gas[0] && r.gas[1] && r.ns[1] / r.gas[1] >= r.ns[0] / r.gas[0] ? Tier::Demoted : Tier::JIT;
+	}
+}
+
+void AdaptiveVM::demote(h256 const& _codeHash)
+{
+	Guard l(x_records);
+	s_records[_codeHash].tier = Tier::Demoted;
+}
+
+void AdaptiveVM::clear()
+{
+	Guard l(x_records);
+	s_records.clear();
+}
@@ -0,0 +1,96 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file AdaptiveVM.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+#include "VMFace.h"
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * @brief Tiered execution: interprets code until it has proven hot, then hands it to the JIT.
+ *
+ * Executions are counted per code hash. Once the code has run promotionThreshold() times it is executed by
+ * the JIT. Code is demoted back to the interpreter for good if it fails to compile, or if the JIT turns out
+ * not to be faster than the interpreter on it. Without JIT support in the build this is just the interpreter.
+ */
+class AdaptiveVM: public VMFace
+{
+public:
+	virtual void reset(u256 _gas = 0) noexcept override final { VMFace::reset(_gas); m_vm.reset(); }
+
+	virtual bytesConstRef go(ExtVMFace& _ext, OnOpFunc const& _onOp = {}, uint64_t _steps = (uint64_t)-1) override final;
+
+	/// @returns the number of executions after which code is compiled.
+	static unsigned promotionThreshold() { return s_promotionThreshold; }
+	/// Sets the number of executions after which code is compiled.
+	static void setPromotionThreshold(unsigned _n) { s_promotionThreshold = _n; }
+
+	/// Stop using the JIT for the code of hash @a _codeHash, e.g. because it failed to compile.
+	static void demote(h256 const& _codeHash);
+	/// Forget all execution counts and decisions.
+	static void clear();
+
+private:
+	friend class VMFactory;
+
+	enum class Tier
+	{
+		Interpreter,	///< Still cold, counting executions.
+		Trial,			///< Promoted, measuring whether the JIT pays off.
+		JIT,			///< Compiled for good.
+		Demoted			///< Interpreted for good.
+	};
+
+	/// What we know about the execution of one piece of code.
+	struct Record
+	{
+		Tier tier = Tier::Interpreter;
+		unsigned runs = 0;			///< Executions in the current tier.
+		double gas[2] = {0, 0};		///< Gas used by the measured runs, interpreted and native.
+		double ns[2] = {0, 0};		///< Time taken by the measured runs, interpreted and native.
+	};
+
+	explicit AdaptiveVM(u256 _gas): VMFace(_gas) {}
+
+	/// @returns the tier in which to run the code of hash @a _codeHash, counting the execution.
+	static Tier enter(h256 const& _codeHash);
+	/// Accounts a successful run in tier @a _tier that used @a _gas in @a _ns nanoseconds; @a _native is false
+	/// if the JIT handed the run to the interpreter after all.
+	static void leave(h256 const& _codeHash, Tier _tier, bool _native, double _gas, double _ns);
+
+	std::unique_ptr<VMFace> m_vm;	///< The VM of the tier chosen on the first go(), kept for resumption.
+	h256 m_codeHash;
+	Tier m_tier = Tier::Interpreter;
+
+	static unsigned s_promotionThreshold;
+	static Mutex x_records;
+	static std::unordered_map<h256, Record> s_records;
+};
+
+}
+}
@@ -0,0 +1,198 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file AnalysedCode.cpp
+ * @date 2015
+ */
+
+#include "AnalysedCode.h"
+#include <array>
+#include <set>
+#include <libethcore/Params.h>
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+/// What the analysis needs of an instruction; instructionInfo() is too slow to ask for each one.
+struct InstructionFacts
+{
+	uint64_t gas;
+	int args;
+	int ret;
+	bool dynamicGas;
+	bool endsBlock;
+};
+
+array<InstructionFacts, 256> const& instructionFacts()
+{
+	static array<InstructionFacts, 256> const s_facts = []()
+	{
+		array<InstructionFacts, 256> ret;
+		for (unsigned i = 0; i < 256; ++i)
+		{
+			Instruction inst = (Instruction)i;
+			InstructionInfo info = instructionInfo(inst);
+			InstructionFacts& f = ret[i];
+			f.args = info.args;
+			f.ret = info.ret;
+			f.gas = info.gasPriceTier == InvalidTier ? 0 : (uint64_t)c_tierStepGas[info.gasPriceTier];
+			f.dynamicGas = false;
+			f.endsBlock = info.gasPriceTier == InvalidTier;
+			switch (inst)
+			{
+			case Instruction::SLOAD:
+				f.gas = (uint64_t)c_sloadGas;
+				break;
+			case Instruction::JUMPDEST:
+				f.gas = 1;
+				break;
+			case Instruction::CALL:
+			case Instruction::CALLCODE:
+			case Instruction::CREATE:
+				f.endsBlock = true;
+				// fall through
+			case Instruction::SSTORE:
+			case Instruction::MSTORE:
+			case Instruction::MSTORE8:
+			case Instruction::MLOAD:
+			case Instruction::RETURN:
+			case Instruction::SHA3:
+			case Instruction::CALLDATACOPY:
+			case Instruction::CODECOPY:
+			case Instruction::EXTCODECOPY:
+			case Instruction::LOG0:
+			case Instruction::LOG1:
+			case Instruction::LOG2:
+			case Instruction::LOG3:
+			case Instruction::LOG4:
+			case Instruction::EXP:
+				f.dynamicGas = true;
+				break;
+			default:;
+			}
+			switch (inst)
+			{
+			case Instruction::STOP:
+			case Instruction::JUMP:
+			case Instruction::JUMPI:
+			case Instruction::RETURN:
+			case Instruction::SUICIDE:
+			case Instruction::GAS:
+				f.endsBlock = true;
+				break;
+			default:;
+			}
+		}
+		return ret;
+	}();
+	return s_facts;
+}
+
+}
+
+bool dev::eth::hasDynamicGas(Instruction _inst)
+{
+	return instructionFacts()[(byte)_inst].dynamicGas;
+}
+
+uint64_t dev::eth::staticGas(Instruction _inst)
+{
+	return instructionFacts()[(byte)_inst].gas;
+}
+
+/// Maximum number of distinct code hashes kept in the cache before it is flushed.
+static const size_t c_maxCachedCode = 1024;
+
+SharedMutex AnalysedCode::x_cache;
+unordered_map<h256, shared_ptr<AnalysedCode const>> AnalysedCode::s_cache;
+
+AnalysedCode::AnalysedCode(SharedCode const& _code):
+	m_code(_code),
+	m_jumpDests(_code->size(), false),
+	m_pushIndex(_code->size(), 0),
+	m_blockIndex(_code->size(), c_noBlock)
+{
+	bytes const& code = *m_code;
+	array<InstructionFacts, 256> const& facts = instructionFacts();
+	int64_t const stackLimit = (int64_t)c_stackLimit;
+	set<u256> slots;
+	bool pushed = false;
+	Block* block = nullptr;
+	int64_t height = 0;		// Stack height within the current block, relative to its entry.
+	for (size_t i = 0; i < code.size(); ++i)
+	{
+		Instruction inst = (Instruction)code[i];
+		InstructionFacts const& f = facts[(byte)inst];
+		if (!block || inst == Instruction::JUMPDEST)
+		{
+			m_blockIndex[i] = m_blocks.size();
+			m_blocks.push_back(Block{0, 0, stackLimit});
+			block = &m_blocks.back();
+			height = 0;
+		}
+		if (!f.dynamicGas)
+			block->gas += f.gas;
+		block->minStack = max<int64_t>(block->minStack, f.args - height);
+		block->maxStack = min<int64_t>(block->maxStack, stackLimit + f.args - f.ret - height);
+		height += f.ret - f.args;
+		if (f.endsBlock)
+			block = nullptr;
+
+		if (inst == Instruction::SLOAD && pushed)
+			slots.insert(m_pushValues.back());
+		pushed = inst >= Instruction::PUSH1 && inst <= Instruction::PUSH32;
+		if (inst == Instruction::JUMPDEST)
+			m_jumpDests[i] = true;
+		else if (pushed)
+		{
+			// Push data running off the end of the code reads as zeroes.
+			u256 v = 0;
+			size_t pc = i;
+			for (unsigned n = getPushNumber(inst); n--;)
+				v = (v << 8) | (++pc < code.size() ? code[pc] : 0);
+			m_pushIndex[i] = m_pushValues.size();
+			m_pushValues.push_back(v);
+			i = pc;
+		}
+	}
+	m_constantSlots.assign(slots.begin(), slots.end());
+}
+
+shared_ptr<AnalysedCode const> AnalysedCode::cached(h256 const& _codeHash, SharedCode const& _code)
+{
+	{
+		ReadGuard l(x_cache);
+		auto it = s_cache.find(_codeHash);
+		if (it != s_cache.end())
+			return it->second;
+	}
+
+	// Analyse outside the lock; should two threads race on the same code the first one in wins.
+	auto ret = make_shared<AnalysedCode const>(_code);
+	WriteGuard l(x_cache);
+	if (s_cache.size() >= c_maxCachedCode)
+		s_cache.clear();
+	return s_cache.insert(make_pair(_codeHash, ret)).first->second;
+}
+
+void AnalysedCode::clearCache()
+{
+	WriteGuard l(x_cache);
+	s_cache.clear();
+}
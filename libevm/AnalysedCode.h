@@ -0,0 +1,108 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file AnalysedCode.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+#include <libevmcore/Instruction.h>
+#include <libethcore/CodeStore.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/// @returns true iff the fee of @a _inst depends on its operands or the state, so is only known as it runs.
+bool hasDynamicGas(Instruction _inst);
+/// @returns the fee of @a _inst or, if hasDynamicGas(_inst), the base fee of its tier; 0 for invalid instructions.
+uint64_t staticGas(Instruction _inst);
+
+/**
+ * @brief EVM code together with the results of a single linear pass over it.
+ *
+ * Holds the jump-destination bitmap and the PUSH immediates already widened to u256, so that the
+ * interpreter never has to rescan the code or reassemble push data byte-by-byte. Instances are
+ * immutable once built and are shared between VMs through the cache in cached().
+ *
+ * The code is also split into basic blocks, for the interpreter to pay the static fees of and check the
+ * stack for a whole block on entering it. A block starts at the beginning of the code, at each JUMPDEST and
+ * after each instruction that ends one: those that leave the block (JUMP, JUMPI, STOP, RETURN, SUICIDE or
+ * an invalid one) and those that look at the gas left (GAS, CALL, CALLCODE, CREATE).
+ */
+class AnalysedCode
+{
+public:
+	/// What running a basic block through to its end requires, of each of its instructions together.
+	struct Block
+	{
+		uint64_t gas;		///< The static fees, not counting those of instructions with dynamic gas.
+		int64_t minStack;	///< Stack height on entry below which an instruction in the block underflows.
+		int64_t maxStack;	///< Stack height on entry above which an instruction in the block overflows.
+	};
+
+	/// Analyse the given code, sharing rather than copying it.
+	explicit AnalysedCode(SharedCode const& _code);
+	/// Analyse a copy of the given code.
+	explicit AnalysedCode(bytesConstRef _code): AnalysedCode(std::make_shared<bytes const>(_code.toBytes())) {}
+
+	/// @returns the analysis for the code of hash @a _codeHash, building and caching it from @a _code if needed.
+	static std::shared_ptr<AnalysedCode const> cached(h256 const& _codeHash, SharedCode const& _code);
+	/// Drop all cached analyses.
+	static void clearCache();
+
+	/// @returns the code as it was analysed.
+	bytes const& code() const { return *m_code; }
+	/// @returns the length of the code in bytes.
+	size_t size() const { return m_code->size(); }
+
+	/// @returns the instruction at @a _pc; positions beyond the end of the code are STOP.
+	Instruction instruction(uint64_t _pc) const { return _pc < m_code->size() ? (Instruction)(*m_code)[(size_t)_pc] : Instruction::STOP; }
+	/// @returns the (zero-padded) immediate of the PUSH instruction at @a _pc.
+	/// @warning Only valid if instruction(_pc) is a PUSH.
+	u256 const& pushValue(uint64_t _pc) const { return m_pushValues[m_pushIndex[(size_t)_pc]]; }
+	/// @returns true iff @a _pc addresses a JUMPDEST that is not part of PUSH data.
+	bool isJumpDest(u256 const& _pc) const { return _pc < m_jumpDests.size() && m_jumpDests[(size_t)_pc]; }
+	/// @returns the storage slots loaded by an SLOAD straight after a PUSH of their key, in ascending order.
+	u256s const& constantSlots() const { return m_constantSlots; }
+	/// @returns the basic block starting at @a _pc, or nullptr if none does.
+	Block const* blockAt(uint64_t _pc) const { return _pc < m_blockIndex.size() && m_blockIndex[(size_t)_pc] != c_noBlock ? &m_blocks[m_blockIndex[(size_t)_pc]] : nullptr; }
+
+private:
+	SharedCode m_code;						///< The code itself.
+	std::vector<bool> m_jumpDests;			///< Bit per code byte: set iff the byte is a valid jump destination.
+	std::vector<unsigned> m_pushIndex;		///< For each PUSH position, the index of its value in m_pushValues.
+	u256s m_pushValues;						///< The widened PUSH immediates, in code order.
+	u256s m_constantSlots;					///< The slots of constantSlots().
+	std::vector<unsigned> m_blockIndex;		///< For each position, the index in m_blocks of the block starting there, or c_noBlock.
+	std::vector<Block> m_blocks;			///< The basic blocks, in code order.
+
+	static const unsigned c_noBlock = (unsigned)-1;
+
+	static SharedMutex x_cache;
+	static std::unordered_map<h256, std::shared_ptr<AnalysedCode const>> s_cache;
+};
+
+}
+}
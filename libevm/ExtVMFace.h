@@ -30,6 +30,7 @@
 #include <libevmcore/Instruction.h>
 #include <libethcore/Common.h>
 #include <libethcore/BlockInfo.h>
+#include <libethcore/CodeStore.h>
 
 namespace dev
 {
@@ -118,7 +119,7 @@ public:
 	ExtVMFace() = default;
 
 	/// Full constructor.
-	ExtVMFace(Address _myAddress, Address _caller, Address _origin, u256 _value, u256 _gasPrice, bytesConstRef _data, bytes const& _code, BlockInfo const& _previousBlock, BlockInfo const& _currentBlock, LastHashes const& _lh, unsigned _depth);
+	ExtVMFace(Address _myAddress, Address _caller, Address _origin, u256 _value, u256 _gasPrice, bytesConstRef _data, SharedCode const& _code, h256 const& _codeHash, BlockInfo const& _previousBlock, BlockInfo const& _currentBlock, LastHashes const& _lh, unsigned _depth);
 
 	virtual ~ExtVMFace() = default;
 
@@ -165,7 +166,7 @@ public:
 	h256 blockhash(u256 _number) { return _number < currentBlock.number && _number >= (std::max<u256>(256, currentBlock.number) - 256) ? lastHashes[(unsigned)(currentBlock.number - 1 - _number)] : h256(); }
 
 	/// Get the code at the given location in code ROM.
-	byte getCode(u256 _n) const { return _n < code.size() ? code[(size_t)_n] : 0; }
+	byte getCode(u256 _n) const { return _n < code->size() ? (*code)[(size_t)_n] : 0; }
 
 	Address myAddress;			///< Address associated with executing code (a contract, or contract-to-be).
 	Address caller;				///< Address which sent the message (either equal to origin or a contract).
@@ -173,7 +174,8 @@ public:
 	u256 value;					///< Value (in Wei) that was passed to this address.
 	u256 gasPrice;				///< Price of gas (that we already paid).
 	bytesConstRef data;			///< Current input data.
-	bytes code;					///< Current code that is executing.
+	SharedCode code = CodeStore::empty();	///< Current code that is executing, shared with whatever else holds it.
+	h256 codeHash;				///< SHA3 of the code, or null if not known (e.g. init code) in which case its analysis isn't cached.
 	LastHashes lastHashes;		///< Most recent 256 blocks' hashes.
 	BlockInfo previousBlock;	///< The previous block's information.	TODO: PoC-8: REMOVE
 	BlockInfo currentBlock;		///< The current block's information.
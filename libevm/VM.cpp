@@ -20,16 +20,99 @@
  */
 
 #include "VM.h"
+#include <boost/thread/tss.hpp>
+#include <evmjit/libevmjit/Arith256Kernels.h>
 #include <libethereum/ExtVM.h>
 using namespace std;
 using namespace dev;
 using namespace dev::eth;
 
+// Direct-threaded dispatch needs label addresses, which GCC and Clang provide.
+#if !defined(ETH_COMPUTED_GOTO) && defined(__GNUC__)
+#define ETH_COMPUTED_GOTO 1
+#endif
+
+namespace
+{
+
+/// The buffers of a finished VM, kept for reuse by the next one created on the same thread.
+struct VMFrame
+{
+	u256s stack;
+	bytes memory;
+};
+
+/// Maximum number of frames kept per thread.
+static const unsigned c_maxPooledFrames = 64;
+/// Memory buffers grown beyond this are freed rather than kept.
+static const size_t c_maxPooledMemory = 1024 * 1024;
+
+boost::thread_specific_ptr<vector<VMFrame>> t_framePool;
+
+#if EVMJIT_NATIVE_ARITH
+namespace arith = dev::eth::jit::arith;
+static_assert(sizeof(boost::multiprecision::limb_type) == sizeof(uint64_t), "Native arithmetic needs 64-bit limbs.");
+
+// Conversions between u256 and the word arrays of the native kernels; both are least significant limb first.
+inline void toWords(u256 const& _x, uint64_t* o_w)
+{
+	auto const& b = _x.backend();
+	memset(o_w, 0, 4 * sizeof(uint64_t));
+	memcpy(o_w, b.limbs(), b.size() * sizeof(uint64_t));
+}
+
+inline u256 fromWords(uint64_t const* _w)
+{
+	u256 ret;
+	auto& b = ret.backend();
+	unsigned n = max(arith::words(_w, 4), 1u);
+	b.resize(n, n);
+	memcpy(b.limbs(), _w, n * sizeof(uint64_t));
+	b.normalize();
+	return ret;
+}
+#endif
+
+}
+
+VM::VM(u256 _gas, bool _threaded): VMFace(_gas), m_threaded(_threaded)
+{
+	if (auto pool = t_framePool.get())
+		if (!pool->empty())
+		{
+			m_stack = move(pool->back().stack);
+			m_temp = move(pool->back().memory);
+			pool->pop_back();
+		}
+	m_stack.reserve((unsigned)c_stackLimit);
+}
+
+VM::~VM()
+{
+	try
+	{
+		if (!t_framePool.get())
+		{
+			t_framePool.reset(new vector<VMFrame>);
+			t_framePool->reserve(c_maxPooledFrames);
+		}
+		if (t_framePool->size() < c_maxPooledFrames)
+		{
+			m_stack.clear();
+			m_temp.clear();
+			if (m_temp.capacity() > c_maxPooledMemory)
+				bytes().swap(m_temp);
+			t_framePool->push_back(VMFrame{move(m_stack), move(m_temp)});
+		}
+	}
+	catch (...) {}
+}
+
 void VM::reset(u256 _gas) noexcept
 {
 	VMFace::reset(_gas);
 	m_curPC = 0;
-	m_jumpDests.clear();
+	m_code.reset();
 }
 
 struct InstructionMetric
@@ -37,6 +120,10 @@ struct InstructionMetric
 	int gasPriceTier;
 	int args;
 	int ret;
+	unsigned minStack;		///< Stack height below which the instruction underflows.
+	unsigned maxStack;		///< Stack height above which the instruction overflows.
+	bool dynamicGas;		///< True iff the fee depends on the operands or the state and must be worked out by gasCost().
+	uint64_t gas;			///< The fee, if not dynamicGas; otherwise its tier's base fee.
 };
 
 static array<InstructionMetric, 256> metrics()
@@ -48,263 +135,475 @@ static array<InstructionMetric, 256> metrics()
 		s_ret[i].gasPriceTier = inst.gasPriceTier;
 		s_ret[i].args = inst.args;
 		s_ret[i].ret = inst.ret;
+		s_ret[i].minStack = inst.args;
+		s_ret[i].maxStack = (unsigned)c_stackLimit + inst.args - inst.ret;
+		s_ret[i].dynamicGas = hasDynamicGas((Instruction)i);
+		s_ret[i].gas = staticGas((Instruction)i);
 	}
 	return s_ret;
 }
 
-bytesConstRef VM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
+/// Saturation value for 64-bit gas arithmetic: anything at or above this doesn't fit in 64 bits.
+static const uint64_t c_gasOverflow = numeric_limits<uint64_t>::max();
+
+// Arithmetic for the fee schedule. The 64-bit flavour saturates at c_gasOverflow rather than wrapping;
+// the bigint flavour is exact and only used when something has overflowed.
+template <class Gas> static Gas toGas(u256 const& _v);
+template <> inline uint64_t toGas<uint64_t>(u256 const& _v) { return _v < c_gasOverflow ? (uint64_t)_v : c_gasOverflow; }
+template <> inline bigint toGas<bigint>(u256 const& _v) { return _v; }
+static inline uint64_t gasAdd(uint64_t _a, uint64_t _b) { return _a + _b < _a ? c_gasOverflow : _a + _b; }
+static inline uint64_t gasMul(uint64_t _a, uint64_t _b) { return _a && _b > c_gasOverflow / _a ? c_gasOverflow : _a * _b; }
+static inline uint64_t gasDiv(uint64_t _a, uint64_t _b) { return _a == c_gasOverflow ? c_gasOverflow : _a / _b; }
+static inline uint64_t gasSub(uint64_t _a, uint64_t _b) { return _a == c_gasOverflow ? c_gasOverflow : _a - _b; }
+static inline uint64_t gasWords(uint64_t _a) { return _a == c_gasOverflow ? c_gasOverflow : _a / 32 + (_a % 32 ? 1 : 0); }
+static inline bigint gasAdd(bigint const& _a, bigint const& _b) { return _a + _b; }
+static inline bigint gasMul(bigint const& _a, bigint const& _b) { return _a * _b; }
+static inline bigint gasDiv(bigint const& _a, bigint const& _b) { return _a / _b; }
+static inline bigint gasSub(bigint const& _a, bigint const& _b) { return _a - _b; }
+static inline bigint gasWords(bigint const& _a) { return (_a + 31) / 32; }
+
+/// @returns the gas needed to execute the dynamically-priced @a _inst with the given stack and memory size and
+/// sets @a o_newMemSize to the (word-aligned) memory size it requires.
+/// @note For Gas == uint64_t a return value of c_gasOverflow means the true cost doesn't fit in 64 bits.
+template <class Gas>
+static Gas gasCost(Instruction _inst, InstructionMetric const& _metric, ExtVMFace& _ext, u256s const& _stack, size_t _memSize, Gas& o_newMemSize)
 {
-	m_stack.reserve((unsigned)c_stackLimit);
+	auto stackItem = [&](unsigned _i) -> u256 const& { return _stack[_stack.size() - 1 - _i]; };
+	auto memNeed = [](u256 const& _offset, u256 const& _size) -> Gas { return _size ? gasAdd(toGas<Gas>(_offset), toGas<Gas>(_size)) : Gas(0); };
+	auto gasForMem = [](Gas const& _size) -> Gas
+	{
+		Gas s = gasDiv(_size, Gas(32));
+		return gasAdd(gasMul(toGas<Gas>(c_memoryGas), s), gasDiv(gasMul(s, s), toGas<Gas>(c_quadCoeffDiv)));
+	};
 
-	static const array<InstructionMetric, 256> c_metrics = metrics();
+	Gas runGas = toGas<Gas>(c_tierStepGas[_metric.gasPriceTier]);
+	Gas newMemSize = _memSize;
+	Gas copySize = 0;
 
-	auto memNeed = [](u256 _offset, dev::u256 _size) { return _size ? (bigint)_offset + _size : (bigint)0; };
-	auto gasForMem = [](bigint _size) -> bigint
+	switch (_inst)
 	{
-		bigint s = _size / 32;
-		return (bigint)c_memoryGas * s + s * s / c_quadCoeffDiv;
-	};
+	case Instruction::SSTORE:
+		if (!_ext.store(stackItem(0)) && stackItem(1))
+			runGas = toGas<Gas>(c_sstoreSetGas);
+		else
+			runGas = toGas<Gas>(c_sstoreResetGas);
+		break;
+
+	// These all operate on memory and therefore potentially expand it:
+	case Instruction::MSTORE:
+	case Instruction::MLOAD:
+		newMemSize = gasAdd(toGas<Gas>(stackItem(0)), Gas(32));
+		break;
+	case Instruction::MSTORE8:
+		newMemSize = gasAdd(toGas<Gas>(stackItem(0)), Gas(1));
+		break;
+	case Instruction::RETURN:
+		newMemSize = memNeed(stackItem(0), stackItem(1));
+		break;
+	case Instruction::SHA3:
+		runGas = gasAdd(toGas<Gas>(c_sha3Gas), gasMul(gasWords(toGas<Gas>(stackItem(1))), toGas<Gas>(c_sha3WordGas)));
+		newMemSize = memNeed(stackItem(0), stackItem(1));
+		break;
+	case Instruction::CALLDATACOPY:
+	case Instruction::CODECOPY:
+		copySize = toGas<Gas>(stackItem(2));
+		newMemSize = memNeed(stackItem(0), stackItem(2));
+		break;
+	case Instruction::EXTCODECOPY:
+		copySize = toGas<Gas>(stackItem(3));
+		newMemSize = memNeed(stackItem(1), stackItem(3));
+		break;
+
+	case Instruction::LOG0:
+	case Instruction::LOG1:
+	case Instruction::LOG2:
+	case Instruction::LOG3:
+	case Instruction::LOG4:
+	{
+		unsigned n = (unsigned)_inst - (unsigned)Instruction::LOG0;
+		runGas = gasAdd(toGas<Gas>(c_logGas + c_logTopicGas * n), gasMul(toGas<Gas>(c_logDataGas), toGas<Gas>(stackItem(1))));
+		newMemSize = memNeed(stackItem(0), stackItem(1));
+		break;
+	}
 
-	if (m_jumpDests.empty())
-		for (unsigned i = 0; i < _ext.code.size(); ++i)
+	case Instruction::CALL:
+	case Instruction::CALLCODE:
+		runGas = gasAdd(toGas<Gas>(c_callGas), toGas<Gas>(stackItem(0)));
+		if (_inst != Instruction::CALLCODE && !_ext.exists(asAddress(stackItem(1))))
+			runGas = gasAdd(runGas, toGas<Gas>(c_callNewAccountGas));
+		if (stackItem(2) > 0)
+			runGas = gasAdd(runGas, toGas<Gas>(c_callValueTransferGas));
+		newMemSize = std::max(memNeed(stackItem(5), stackItem(6)), memNeed(stackItem(3), stackItem(4)));
+		break;
+
+	case Instruction::CREATE:
+		newMemSize = memNeed(stackItem(1), stackItem(2));
+		runGas = toGas<Gas>(c_createGas);
+		break;
+
+	case Instruction::EXP:
+		runGas = toGas<Gas>(c_expGas + c_expByteGas * (32 - (h256(stackItem(1)).firstBitSet() / 8)));
+		break;
+
+	default:;
+	}
+
+	newMemSize = gasMul(gasWords(newMemSize), Gas(32));
+	if (newMemSize > _memSize)
+		runGas = gasAdd(runGas, gasSub(gasForMem(newMemSize), gasForMem(_memSize)));
+	runGas = gasAdd(runGas, gasMul(toGas<Gas>(c_copyGas), gasWords(copySize)));
+
+	o_newMemSize = newMemSize;
+	return runGas;
+}
+
+bytesConstRef VM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
+{
+	if (!VMProfiler::get().isEnabled())
+		return dispatch(_ext, _onOp, _steps);
+
+	// Count into a local profile and hand it to the profiler however we leave.
+	CodeProfile profile;
+	profile.runs = 1;
+	auto start = chrono::steady_clock::now();
+	auto record = [&]()
+	{
+		m_profile = nullptr;
+		profile.time = chrono::steady_clock::now() - start;
+		for (auto const& o: profile.opcodes)
 		{
-			if (_ext.code[i] == (byte)Instruction::JUMPDEST)
-				m_jumpDests.insert(i);
-			else if (_ext.code[i] >= (byte)Instruction::PUSH1 && _ext.code[i] <= (byte)Instruction::PUSH32)
-				i += _ext.code[i] - (unsigned)Instruction::PUSH1 + 1;
+			profile.steps += o.count;
+			profile.gas = gasAdd(profile.gas, o.gas);
 		}
-	u256 nextPC = m_curPC + 1;
-	auto osteps = _steps;
-	for (bool stopped = false; !stopped && _steps--; m_curPC = nextPC, nextPC = m_curPC + 1)
+		VMProfiler::get().record(_ext.codeHash ? _ext.codeHash : sha3(*_ext.code), profile);
+	};
+
+	m_profile = &profile;
+	try
 	{
-		// INSTRUCTION...
-		Instruction inst = (Instruction)_ext.getCode(m_curPC);
-		auto metric = c_metrics[(int)inst];
-		int gasPriceTier = metric.gasPriceTier;
+		auto ret = dispatch(_ext, _onOp, _steps);
+		record();
+		return ret;
+	}
+	catch (...)
+	{
+		record();
+		throw;
+	}
+}
 
-		if (gasPriceTier == InvalidTier)
-			BOOST_THROW_EXCEPTION(BadInstruction());
+bytesConstRef VM::dispatch(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
+{
+#if ETH_COMPUTED_GOTO
+	if (m_threaded)
+		return interpret<true>(_ext, _onOp, _steps);
+#endif
+	return interpret<false>(_ext, _onOp, _steps);
+}
 
-		// FEES...
-		bigint runGas = c_tierStepGas[metric.gasPriceTier];
-		bigint newTempSize = m_temp.size();
-		bigint copySize = 0;
+#if ETH_COMPUTED_GOTO
+// Label addresses and computed gotos are GNU extensions.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+// Each handler is both a case of the dispatch switch and a jump target of the direct-threaded table.
+#define CASE(name) case Instruction::name: L_##name:
+// At the end of a handler the direct-threaded interpreter begins the next instruction and jumps straight to it.
+#define NEXT \
+	if (c_threaded) \
+	{ \
+		m_curPC = nextPC; \
+		if (!_steps--) \
+			goto L_stepsDone; \
+		inst = code.instruction(m_curPC); \
+		nextPC = m_curPC + 1; \
+		onStep(); \
+		goto *c_jumpTable[(byte)inst]; \
+	} \
+	break;
+#else
+#define CASE(name) case Instruction::name:
+#define NEXT break;
+#endif
+
+template <bool c_threaded>
+bytesConstRef VM::interpret(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
+{
+	static const array<InstructionMetric, 256> c_metrics = metrics();
+#if ETH_COMPUTED_GOTO
+	static void* const c_jumpTable[256] =
+	{
+		&&L_STOP, &&L_ADD, &&L_MUL, &&L_SUB, &&L_DIV, &&L_SDIV, &&L_MOD, &&L_SMOD, &&L_ADDMOD, &&L_MULMOD, &&L_EXP, &&L_SIGNEXTEND, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0x00
+		&&L_LT, &&L_GT, &&L_SLT, &&L_SGT, &&L_EQ, &&L_ISZERO, &&L_AND, &&L_OR, &&L_XOR, &&L_NOT, &&L_BYTE, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0x10
+		&&L_SHA3, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0x20
+		&&L_ADDRESS, &&L_BALANCE, &&L_ORIGIN, &&L_CALLER, &&L_CALLVALUE, &&L_CALLDATALOAD, &&L_CALLDATASIZE, &&L_CALLDATACOPY, &&L_CODESIZE, &&L_CODECOPY, &&L_GASPRICE, &&L_EXTCODESIZE, &&L_EXTCODECOPY, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0x30
+		&&L_BLOCKHASH, &&L_COINBASE, &&L_TIMESTAMP, &&L_NUMBER, &&L_DIFFICULTY, &&L_GASLIMIT, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0x40
+		&&L_POP, &&L_MLOAD, &&L_MSTORE, &&L_MSTORE8, &&L_SLOAD, &&L_SSTORE, &&L_JUMP, &&L_JUMPI, &&L_PC, &&L_MSIZE, &&L_GAS, &&L_JUMPDEST, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0x50
+		&&L_PUSH1, &&L_PUSH2, &&L_PUSH3, &&L_PUSH4, &&L_PUSH5, &&L_PUSH6, &&L_PUSH7, &&L_PUSH8, &&L_PUSH9, &&L_PUSH10, &&L_PUSH11, &&L_PUSH12, &&L_PUSH13, &&L_PUSH14, &&L_PUSH15, &&L_PUSH16,	// 0x60
+		&&L_PUSH17, &&L_PUSH18, &&L_PUSH19, &&L_PUSH20, &&L_PUSH21, &&L_PUSH22, &&L_PUSH23, &&L_PUSH24, &&L_PUSH25, &&L_PUSH26, &&L_PUSH27, &&L_PUSH28, &&L_PUSH29, &&L_PUSH30, &&L_PUSH31, &&L_PUSH32,	// 0x70
+		&&L_DUP1, &&L_DUP2, &&L_DUP3, &&L_DUP4, &&L_DUP5, &&L_DUP6, &&L_DUP7, &&L_DUP8, &&L_DUP9, &&L_DUP10, &&L_DUP11, &&L_DUP12, &&L_DUP13, &&L_DUP14, &&L_DUP15, &&L_DUP16,	// 0x80
+		&&L_SWAP1, &&L_SWAP2, &&L_SWAP3, &&L_SWAP4, &&L_SWAP5, &&L_SWAP6, &&L_SWAP7, &&L_SWAP8, &&L_SWAP9, &&L_SWAP10, &&L_SWAP11, &&L_SWAP12, &&L_SWAP13, &&L_SWAP14, &&L_SWAP15, &&L_SWAP16,	// 0x90
+		&&L_LOG0, &&L_LOG1, &&L_LOG2, &&L_LOG3, &&L_LOG4, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0xa0
+		&&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0xb0
+		&&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0xc0
+		&&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0xd0
+		&&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID,	// 0xe0
+		&&L_CREATE, &&L_CALL, &&L_CALLCODE, &&L_RETURN, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_INVALID, &&L_SUICIDE,	// 0xf0
+	};
+#endif
 
-		// should work, but just seems to result in immediate errorless exit on initial execution. yeah. weird.
-		//m_onFail = std::function<void()>(onOperation);
+	if (!m_code)
+		m_code = _ext.codeHash ? AnalysedCode::cached(_ext.codeHash, _ext.code) : make_shared<AnalysedCode const>(_ext.code);
+	AnalysedCode const& code = *m_code;
 
-		require(metric.args, metric.ret);
+	Instruction inst;
+	uint64_t nextPC;
+	auto osteps = _steps;
 
-		auto onOperation = [&]()
-		{
-			if (_onOp)
-				_onOp(osteps - _steps - 1, inst, newTempSize > m_temp.size() ? (newTempSize - m_temp.size()) / 32 : bigint(0), runGas, this, &_ext);
-		};
+	auto onOperation = [&](bigint const& _newTempSize, bigint const& _runGas)
+	{
+		if (_onOp)
+			_onOp(osteps - _steps - 1, inst, _newTempSize > m_temp.size() ? (_newTempSize - m_temp.size()) / 32 : bigint(0), _runGas, this, &_ext);
+	};
 
-		switch (inst)
+	// Counts inst towards the profile, if any, once its fee of _runGas has been paid.
+	auto profileStep = [&](uint64_t _runGas)
+	{
+		OpcodeProfile& p = m_profile->opcodes[(byte)inst];
+		++p.count;
+		p.gas = gasAdd(p.gas, _runGas);
+	};
+
+	// Charges the fee of the dynamically-priced inst and expands memory for it.
+	auto payDynamicGas = [&](InstructionMetric const& metric)
+	{
+		uint64_t newTempSize;
+		uint64_t runGas = gasCost(inst, metric, _ext, m_stack, m_temp.size(), newTempSize);
+		if (runGas == c_gasOverflow)
 		{
-		case Instruction::SSTORE:
-			if (!_ext.store(m_stack.back()) && m_stack[m_stack.size() - 2])
-				runGas = c_sstoreSetGas;
-			else if (_ext.store(m_stack.back()) && !m_stack[m_stack.size() - 2])
+			// Doesn't fit in 64 bits, so it's only payable if we have more gas than that. Redo it exactly.
+			bigint bigTempSize;
+			bigint bigGas = gasCost(inst, metric, _ext, m_stack, m_temp.size(), bigTempSize);
+			onOperation(bigTempSize, bigGas);
+			if (m_gas < bigGas || bigTempSize >= c_gasOverflow)
 			{
-				runGas = c_sstoreResetGas;
-				_ext.sub.refunds += c_sstoreRefundGas;
+				// Out of gas!
+				m_gas = 0;
+				BOOST_THROW_EXCEPTION(OutOfGas());
 			}
-			else
-				runGas = c_sstoreResetGas;
-			break;
-
-		case Instruction::SLOAD:
-			runGas = c_sloadGas;
-			break;
-
-		// These all operate on memory and therefore potentially expand it:
-		case Instruction::MSTORE:
-			newTempSize = (bigint)m_stack.back() + 32;
-			break;
-		case Instruction::MSTORE8:
-			newTempSize = (bigint)m_stack.back() + 1;
-			break;
-		case Instruction::MLOAD:
-			newTempSize = (bigint)m_stack.back() + 32;
-			break;
-		case Instruction::RETURN:
-			newTempSize = memNeed(m_stack.back(), m_stack[m_stack.size() - 2]);
-			break;
-		case Instruction::SHA3:
-			runGas = c_sha3Gas + (m_stack[m_stack.size() - 2] + 31) / 32 * c_sha3WordGas;
-			newTempSize = memNeed(m_stack.back(), m_stack[m_stack.size() - 2]);
-			break;
-		case Instruction::CALLDATACOPY:
-			copySize = m_stack[m_stack.size() - 3];
-			newTempSize = memNeed(m_stack.back(), m_stack[m_stack.size() - 3]);
-			break;
-		case Instruction::CODECOPY:
-			copySize = m_stack[m_stack.size() - 3];
-			newTempSize = memNeed(m_stack.back(), m_stack[m_stack.size() - 3]);
-			break;
-		case Instruction::EXTCODECOPY:
-			copySize = m_stack[m_stack.size() - 4];
-			newTempSize = memNeed(m_stack[m_stack.size() - 2], m_stack[m_stack.size() - 4]);
-			break;
-
-		case Instruction::JUMPDEST:
-			runGas = 1;
-			break;
-
-		case Instruction::LOG0:
-		case Instruction::LOG1:
-		case Instruction::LOG2:
-		case Instruction::LOG3:
-		case Instruction::LOG4:
-		{
-			unsigned n = (unsigned)inst - (unsigned)Instruction::LOG0;
-			runGas = c_logGas + c_logTopicGas * n + (bigint)c_logDataGas * m_stack[m_stack.size() - 2];
-			newTempSize = memNeed(m_stack[m_stack.size() - 1], m_stack[m_stack.size() - 2]);
-			break;
-		}
-
-		case Instruction::CALL:
-		case Instruction::CALLCODE:
-			runGas = (bigint)c_callGas + m_stack[m_stack.size() - 1];
-			if (inst != Instruction::CALLCODE && !_ext.exists(asAddress(m_stack[m_stack.size() - 2])))
-				runGas += c_callNewAccountGas;
-			if (m_stack[m_stack.size() - 3] > 0)
-				runGas += c_callValueTransferGas;
-			newTempSize = std::max(memNeed(m_stack[m_stack.size() - 6], m_stack[m_stack.size() - 7]), memNeed(m_stack[m_stack.size() - 4], m_stack[m_stack.size() - 5]));
-			break;
-
-		case Instruction::CREATE:
-		{
-			newTempSize = memNeed(m_stack[m_stack.size() - 2], m_stack[m_stack.size() - 3]);
-			runGas = c_createGas;
-			break;
+			m_gas -= (u256)bigGas;
+			newTempSize = (uint64_t)bigTempSize;
+			if (m_profile)
+				profileStep(c_gasOverflow);
 		}
-		case Instruction::EXP:
+		else
 		{
-			auto expon = m_stack[m_stack.size() - 2];
-			runGas = c_expGas + c_expByteGas * (32 - (h256(expon).firstBitSet() / 8));
-			break;
-		}
-		default:;
+			if (_onOp)
+				onOperation(newTempSize, runGas);
+			if (m_gas < runGas)
+			{
+				// Out of gas!
+				m_gas = 0;
+				BOOST_THROW_EXCEPTION(OutOfGas());
+			}
+			m_gas -= runGas;
+			if (m_profile)
+				profileStep(runGas);
 		}
 
-		newTempSize = (newTempSize + 31) / 32 * 32;
 		if (newTempSize > m_temp.size())
-			runGas += gasForMem(newTempSize) - gasForMem(m_temp.size());
-		runGas += c_copyGas * ((copySize + 31) / 32);
+			m_temp.resize((size_t)newTempSize);
+	};
 
-		onOperation();
-//		if (_onOp)
-//			_onOp(osteps - _steps - 1, inst, newTempSize > m_temp.size() ? (newTempSize - m_temp.size()) / 32 : bigint(0), runGas, this, &_ext);
+	// Checks the stack, charges the fee and expands memory for inst.
+	auto checkStep = [&]()
+	{
+		InstructionMetric const& metric = c_metrics[(byte)inst];
+		if (metric.gasPriceTier == InvalidTier)
+			BOOST_THROW_EXCEPTION(BadInstruction());
 
-		if (m_gas < runGas)
+		if (m_stack.size() < metric.minStack)
+			BOOST_THROW_EXCEPTION(StackUnderflow() << RequirementError((bigint)metric.args, (bigint)m_stack.size()));
+		if (m_stack.size() > metric.maxStack)
+			BOOST_THROW_EXCEPTION(OutOfStack() << RequirementError((bigint)metric.ret - metric.args, (bigint)m_stack.size()));
+
+		if (metric.dynamicGas)
+		{
+			payDynamicGas(metric);
+			return;
+		}
+		if (_onOp)
+			onOperation(m_temp.size(), metric.gas);
+		if (m_gas < metric.gas)
 		{
 			// Out of gas!
 			m_gas = 0;
 			BOOST_THROW_EXCEPTION(OutOfGas());
 		}
+		m_gas -= metric.gas;
+		if (m_profile)
+			profileStep(metric.gas);
+	};
 
-		m_gas = (u256)((bigint)m_gas - runGas);
+	// Unless every step is to be seen, as by _onOp, the profiler or a limit on the steps, the static fees and the
+	// stack of each basic block are dealt with on entering it. A block that would fail these part way through is
+	// run a step at a time instead, so that it fails at the same step in the same way.
+	bool const byBlock = !_onOp && !m_profile && _steps == (uint64_t)-1;
+	bool prepaid = false;	// Whether the block of inst was paid for on entry; not so for one entered part way.
+	auto onStep = [&]()
+	{
+		if (byBlock)
+			if (AnalysedCode::Block const* block = code.blockAt(m_curPC))
+			{
+				int64_t height = m_stack.size();
+				prepaid = height >= block->minStack && height <= block->maxStack && m_gas >= block->gas;
+				if (prepaid)
+					m_gas -= block->gas;
+			}
+		if (!prepaid)
+			checkStep();
+		else if (c_metrics[(byte)inst].gasPriceTier == InvalidTier)
+			BOOST_THROW_EXCEPTION(BadInstruction());
+		else if (c_metrics[(byte)inst].dynamicGas)
+			payDynamicGas(c_metrics[(byte)inst]);
+	};
 
-		if (newTempSize > m_temp.size())
-			m_temp.resize((size_t)newTempSize);
+	for (; _steps--; m_curPC = nextPC)
+	{
+		// INSTRUCTION...
+		inst = code.instruction(m_curPC);
+		nextPC = m_curPC + 1;
+
+		// FEES...
+		onStep();
 
 		// EXECUTE...
+#if ETH_COMPUTED_GOTO
+		if (c_threaded)
+			goto *c_jumpTable[(byte)inst];
+#endif
 		switch (inst)
 		{
-		case Instruction::ADD:
+		CASE(ADD)
 			//pops two items and pushes S[-1] + S[-2] mod 2^256.
 			m_stack[m_stack.size() - 2] += m_stack.back();
 			m_stack.pop_back();
-			break;
-		case Instruction::MUL:
+			NEXT
+		CASE(MUL)
 			//pops two items and pushes S[-1] * S[-2] mod 2^256.
 			m_stack[m_stack.size() - 2] *= m_stack.back();
 			m_stack.pop_back();
-			break;
-		case Instruction::SUB:
+			NEXT
+		CASE(SUB)
 			m_stack[m_stack.size() - 2] = m_stack.back() - m_stack[m_stack.size() - 2];
 			m_stack.pop_back();
-			break;
-		case Instruction::DIV:
+			NEXT
+		CASE(DIV)
 			m_stack[m_stack.size() - 2] = m_stack[m_stack.size() - 2] ? m_stack.back() / m_stack[m_stack.size() - 2] : 0;
 			m_stack.pop_back();
-			break;
-		case Instruction::SDIV:
+			NEXT
+		CASE(SDIV)
 			m_stack[m_stack.size() - 2] = m_stack[m_stack.size() - 2] ? s2u(u2s(m_stack.back()) / u2s(m_stack[m_stack.size() - 2])) : 0;
 			m_stack.pop_back();
-			break;
-		case Instruction::MOD:
+			NEXT
+		CASE(MOD)
 			m_stack[m_stack.size() - 2] = m_stack[m_stack.size() - 2] ? m_stack.back() % m_stack[m_stack.size() - 2] : 0;
 			m_stack.pop_back();
-			break;
-		case Instruction::SMOD:
+			NEXT
+		CASE(SMOD)
 			m_stack[m_stack.size() - 2] = m_stack[m_stack.size() - 2] ? s2u(u2s(m_stack.back()) % u2s(m_stack[m_stack.size() - 2])) : 0;
 			m_stack.pop_back();
-			break;
-		case Instruction::EXP:
+			NEXT
+		CASE(EXP)
 		{
 			auto base = m_stack.back();
 			auto expon = m_stack[m_stack.size() - 2];
 			m_stack.pop_back();
+#if EVMJIT_NATIVE_ARITH
+			uint64_t b[4], e[4], r[4];
+			toWords(base, b);
+			toWords(expon, e);
+			arith::exp(b, e, r);
+			m_stack.back() = fromWords(r);
+#else
 			m_stack.back() = (u256)boost::multiprecision::powm((bigint)base, (bigint)expon, bigint(1) << 256);
-			break;
+#endif
+			NEXT
 		}
-		case Instruction::NOT:
+		CASE(NOT)
 			m_stack.back() = ~m_stack.back();
-			break;
-		case Instruction::LT:
+			NEXT
+		CASE(LT)
 			m_stack[m_stack.size() - 2] = m_stack.back() < m_stack[m_stack.size() - 2] ? 1 : 0;
 			m_stack.pop_back();
-			break;
-		case Instruction::GT:
+			NEXT
+		CASE(GT)
 			m_stack[m_stack.size() - 2] = m_stack.back() > m_stack[m_stack.size() - 2] ? 1 : 0;
 			m_stack.pop_back();
-			break;
-		case Instruction::SLT:
+			NEXT
+		CASE(SLT)
 			m_stack[m_stack.size() - 2] = u2s(m_stack.back()) < u2s(m_stack[m_stack.size() - 2]) ? 1 : 0;
 			m_stack.pop_back();
-			break;
-		case Instruction::SGT:
+			NEXT
+		CASE(SGT)
 			m_stack[m_stack.size() - 2] = u2s(m_stack.back()) > u2s(m_stack[m_stack.size() - 2]) ? 1 : 0;
 			m_stack.pop_back();
-			break;
-		case Instruction::EQ:
+			NEXT
+		CASE(EQ)
 			m_stack[m_stack.size() - 2] = m_stack.back() == m_stack[m_stack.size() - 2] ? 1 : 0;
 			m_stack.pop_back();
-			break;
-		case Instruction::ISZERO:
+			NEXT
+		CASE(ISZERO)
 			m_stack.back() = m_stack.back() ? 0 : 1;
-			break;
-		case Instruction::AND:
+			NEXT
+		CASE(AND)
 			m_stack[m_stack.size() - 2] = m_stack.back() & m_stack[m_stack.size() - 2];
 			m_stack.pop_back();
-			break;
-		case Instruction::OR:
+			NEXT
+		CASE(OR)
 			m_stack[m_stack.size() - 2] = m_stack.back() | m_stack[m_stack.size() - 2];
 			m_stack.pop_back();
-			break;
-		case Instruction::XOR:
+			NEXT
+		CASE(XOR)
 			m_stack[m_stack.size() - 2] = m_stack.back() ^ m_stack[m_stack.size() - 2];
 			m_stack.pop_back();
-			break;
-		case Instruction::BYTE:
+			NEXT
+		CASE(BYTE)
 			m_stack[m_stack.size() - 2] = m_stack.back() < 32 ? (m_stack[m_stack.size() - 2] >> (unsigned)(8 * (31 - m_stack.back()))) & 0xff : 0;
 			m_stack.pop_back();
-			break;
-		case Instruction::ADDMOD:
+			NEXT
+		CASE(ADDMOD)
+		{
+#if EVMJIT_NATIVE_ARITH
+			uint64_t x[4], y[4], m[4], r[4];
+			toWords(m_stack.back(), x);
+			toWords(m_stack[m_stack.size() - 2], y);
+			toWords(m_stack[m_stack.size() - 3], m);
+			arith::addmod(x, y, m, r);
+			m_stack[m_stack.size() - 3] = fromWords(r);
+#else
 			m_stack[m_stack.size() - 3] = m_stack[m_stack.size() - 3] ? u256((bigint(m_stack.back()) + bigint(m_stack[m_stack.size() - 2])) % m_stack[m_stack.size() - 3]) : 0;
+#endif
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
-		case Instruction::MULMOD:
+			NEXT
+		}
+		CASE(MULMOD)
+		{
+#if EVMJIT_NATIVE_ARITH
+			uint64_t x[4], y[4], m[4], r[4];
+			toWords(m_stack.back(), x);
+			toWords(m_stack[m_stack.size() - 2], y);
+			toWords(m_stack[m_stack.size() - 3], m);
+			arith::mulmod(x, y, m, r);
+			m_stack[m_stack.size() - 3] = fromWords(r);
+#else
 			m_stack[m_stack.size() - 3] = m_stack[m_stack.size() - 3] ? u256((bigint(m_stack.back()) * bigint(m_stack[m_stack.size() - 2])) % m_stack[m_stack.size() - 3]) : 0;
+#endif
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
-		case Instruction::SIGNEXTEND:
+			NEXT
+		}
+		CASE(SIGNEXTEND)
 			if (m_stack.back() < 31)
 			{
 				unsigned const testBit(m_stack.back() * 8 + 7);
@@ -316,34 +615,34 @@ bytesConstRef VM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
 					number &= mask;
 			}
 			m_stack.pop_back();
-			break;
-		case Instruction::SHA3:
+			NEXT
+		CASE(SHA3)
 		{
 			unsigned inOff = (unsigned)m_stack.back();
 			m_stack.pop_back();
 			unsigned inSize = (unsigned)m_stack.back();
 			m_stack.pop_back();
 			m_stack.push_back(sha3(bytesConstRef(m_temp.data() + inOff, inSize)));
-			break;
+			NEXT
 		}
-		case Instruction::ADDRESS:
+		CASE(ADDRESS)
 			m_stack.push_back(fromAddress(_ext.myAddress));
-			break;
-		case Instruction::ORIGIN:
+			NEXT
+		CASE(ORIGIN)
 			m_stack.push_back(fromAddress(_ext.origin));
-			break;
-		case Instruction::BALANCE:
+			NEXT
+		CASE(BALANCE)
 		{
 			m_stack.back() = _ext.balance(asAddress(m_stack.back()));
-			break;
+			NEXT
 		}
-		case Instruction::CALLER:
+		CASE(CALLER)
 			m_stack.push_back(fromAddress(_ext.caller));
-			break;
-		case Instruction::CALLVALUE:
+			NEXT
+		CASE(CALLVALUE)
 			m_stack.push_back(_ext.value);
-			break;
-		case Instruction::CALLDATALOAD:
+			NEXT
+		CASE(CALLDATALOAD)
 		{
 			if ((bigint)m_stack.back() + 31 < _ext.data.size())
 				m_stack.back() = (u256)*(h256 const*)(_ext.data.data() + (size_t)m_stack.back());
@@ -356,20 +655,20 @@ bytesConstRef VM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
 					r[j] = i < _ext.data.size() ? _ext.data[i] : 0;
 				m_stack.back() = (u256)r;
 			}
-			break;
+			NEXT
 		}
-		case Instruction::CALLDATASIZE:
+		CASE(CALLDATASIZE)
 			m_stack.push_back(_ext.data.size());
-			break;
-		case Instruction::CODESIZE:
-			m_stack.push_back(_ext.code.size());
-			break;
-		case Instruction::EXTCODESIZE:
+			NEXT
+		CASE(CODESIZE)
+			m_stack.push_back(_ext.code->size());
+			NEXT
+		CASE(EXTCODESIZE)
 			m_stack.back() = _ext.codeAt(asAddress(m_stack.back())).size();
-			break;
-		case Instruction::CALLDATACOPY:
-		case Instruction::CODECOPY:
-		case Instruction::EXTCODECOPY:
+			NEXT
+		CASE(CALLDATACOPY)
+		CASE(CODECOPY)
+		CASE(EXTCODECOPY)
 		{
 			Address a;
 			if (inst == Instruction::EXTCODECOPY)
@@ -391,8 +690,8 @@ bytesConstRef VM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
 				memcpy(m_temp.data() + offset, _ext.data.data() + (unsigned)index, sizeToBeCopied);
 				break;
 			case Instruction::CODECOPY:
-				sizeToBeCopied = index + (bigint)size > (u256)_ext.code.size() ? (u256)_ext.code.size() < index ? 0 : _ext.code.size() - (unsigned)index : size;
-				memcpy(m_temp.data() + offset, _ext.code.data() + (unsigned)index, sizeToBeCopied);
+				sizeToBeCopied = index + (bigint)size > (u256)_ext.code->size() ? (u256)_ext.code->size() < index ? 0 : _ext.code->size() - (unsigned)index : size;
+				memcpy(m_temp.data() + offset, _ext.code->data() + (unsigned)index, sizeToBeCopied);
 				break;
 			case Instruction::EXTCODECOPY:
 				sizeToBeCopied = index + (bigint)size > (u256)_ext.codeAt(a).size() ? (u256)_ext.codeAt(a).size() < index ? 0 : _ext.codeAt(a).size() - (unsigned)index : size;
@@ -405,197 +704,194 @@ bytesConstRef VM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
 				break;
 			}
 			memset(m_temp.data() + offset + sizeToBeCopied, 0, size - sizeToBeCopied);
-			break;
+			NEXT
 		}
-		case Instruction::GASPRICE:
+		CASE(GASPRICE)
 			m_stack.push_back(_ext.gasPrice);
-			break;
-		case Instruction::BLOCKHASH:
+			NEXT
+		CASE(BLOCKHASH)
 			m_stack.back() = (u256)_ext.blockhash(m_stack.back());
-			break;
-		case Instruction::COINBASE:
+			NEXT
+		CASE(COINBASE)
 			m_stack.push_back((u160)_ext.currentBlock.coinbaseAddress);
-			break;
-		case Instruction::TIMESTAMP:
+			NEXT
+		CASE(TIMESTAMP)
 			m_stack.push_back(_ext.currentBlock.timestamp);
-			break;
-		case Instruction::NUMBER:
+			NEXT
+		CASE(NUMBER)
 			m_stack.push_back(_ext.currentBlock.number);
-			break;
-		case Instruction::DIFFICULTY:
+			NEXT
+		CASE(DIFFICULTY)
 			m_stack.push_back(_ext.currentBlock.difficulty);
-			break;
-		case Instruction::GASLIMIT:
+			NEXT
+		CASE(GASLIMIT)
 			m_stack.push_back(_ext.currentBlock.gasLimit);
-			break;
-		case Instruction::PUSH1:
-		case Instruction::PUSH2:
-		case Instruction::PUSH3:
-		case Instruction::PUSH4:
-		case Instruction::PUSH5:
-		case Instruction::PUSH6:
-		case Instruction::PUSH7:
-		case Instruction::PUSH8:
-		case Instruction::PUSH9:
-		case Instruction::PUSH10:
-		case Instruction::PUSH11:
-		case Instruction::PUSH12:
-		case Instruction::PUSH13:
-		case Instruction::PUSH14:
-		case Instruction::PUSH15:
-		case Instruction::PUSH16:
-		case Instruction::PUSH17:
-		case Instruction::PUSH18:
-		case Instruction::PUSH19:
-		case Instruction::PUSH20:
-		case Instruction::PUSH21:
-		case Instruction::PUSH22:
-		case Instruction::PUSH23:
-		case Instruction::PUSH24:
-		case Instruction::PUSH25:
-		case Instruction::PUSH26:
-		case Instruction::PUSH27:
-		case Instruction::PUSH28:
-		case Instruction::PUSH29:
-		case Instruction::PUSH30:
-		case Instruction::PUSH31:
-		case Instruction::PUSH32:
-		{
-			int i = (int)inst - (int)Instruction::PUSH1 + 1;
-			nextPC = m_curPC + 1;
-			m_stack.push_back(0);
-			for (; i--; nextPC++)
-				m_stack.back() = (m_stack.back() << 8) | _ext.getCode(nextPC);
-			break;
-		}
-		case Instruction::POP:
-			m_stack.pop_back();
-			break;
-		case Instruction::DUP1:
-		case Instruction::DUP2:
-		case Instruction::DUP3:
-		case Instruction::DUP4:
-		case Instruction::DUP5:
-		case Instruction::DUP6:
-		case Instruction::DUP7:
-		case Instruction::DUP8:
-		case Instruction::DUP9:
-		case Instruction::DUP10:
-		case Instruction::DUP11:
-		case Instruction::DUP12:
-		case Instruction::DUP13:
-		case Instruction::DUP14:
-		case Instruction::DUP15:
-		case Instruction::DUP16:
+			NEXT
+		CASE(PUSH1)
+		CASE(PUSH2)
+		CASE(PUSH3)
+		CASE(PUSH4)
+		CASE(PUSH5)
+		CASE(PUSH6)
+		CASE(PUSH7)
+		CASE(PUSH8)
+		CASE(PUSH9)
+		CASE(PUSH10)
+		CASE(PUSH11)
+		CASE(PUSH12)
+		CASE(PUSH13)
+		CASE(PUSH14)
+		CASE(PUSH15)
+		CASE(PUSH16)
+		CASE(PUSH17)
+		CASE(PUSH18)
+		CASE(PUSH19)
+		CASE(PUSH20)
+		CASE(PUSH21)
+		CASE(PUSH22)
+		CASE(PUSH23)
+		CASE(PUSH24)
+		CASE(PUSH25)
+		CASE(PUSH26)
+		CASE(PUSH27)
+		CASE(PUSH28)
+		CASE(PUSH29)
+		CASE(PUSH30)
+		CASE(PUSH31)
+		CASE(PUSH32)
+			m_stack.push_back(code.pushValue(m_curPC));
+			nextPC = m_curPC + 1 + getPushNumber(inst);
+			NEXT
+		CASE(POP)
+			m_stack.pop_back();
+			NEXT
+		CASE(DUP1)
+		CASE(DUP2)
+		CASE(DUP3)
+		CASE(DUP4)
+		CASE(DUP5)
+		CASE(DUP6)
+		CASE(DUP7)
+		CASE(DUP8)
+		CASE(DUP9)
+		CASE(DUP10)
+		CASE(DUP11)
+		CASE(DUP12)
+		CASE(DUP13)
+		CASE(DUP14)
+		CASE(DUP15)
+		CASE(DUP16)
 		{
 			auto n = 1 + (int)inst - (int)Instruction::DUP1;
 			m_stack.push_back(m_stack[m_stack.size() - n]);
-			break;
+			NEXT
 		}
-		case Instruction::SWAP1:
-		case Instruction::SWAP2:
-		case Instruction::SWAP3:
-		case Instruction::SWAP4:
-		case Instruction::SWAP5:
-		case Instruction::SWAP6:
-		case Instruction::SWAP7:
-		case Instruction::SWAP8:
-		case Instruction::SWAP9:
-		case Instruction::SWAP10:
-		case Instruction::SWAP11:
-		case Instruction::SWAP12:
-		case Instruction::SWAP13:
-		case Instruction::SWAP14:
-		case Instruction::SWAP15:
-		case Instruction::SWAP16:
+		CASE(SWAP1)
+		CASE(SWAP2)
+		CASE(SWAP3)
+		CASE(SWAP4)
+		CASE(SWAP5)
+		CASE(SWAP6)
+		CASE(SWAP7)
+		CASE(SWAP8)
+		CASE(SWAP9)
+		CASE(SWAP10)
+		CASE(SWAP11)
+		CASE(SWAP12)
+		CASE(SWAP13)
+		CASE(SWAP14)
+		CASE(SWAP15)
+		CASE(SWAP16)
 		{
 			unsigned n = (int)inst - (int)Instruction::SWAP1 + 2;
 			auto d = m_stack.back();
 			m_stack.back() = m_stack[m_stack.size() - n];
 			m_stack[m_stack.size() - n] = d;
-			break;
+			NEXT
 		}
-		case Instruction::MLOAD:
+		CASE(MLOAD)
 		{
 			m_stack.back() = (u256)*(h256 const*)(m_temp.data() + (unsigned)m_stack.back());
-			break;
+			NEXT
 		}
-		case Instruction::MSTORE:
+		CASE(MSTORE)
 		{
 			*(h256*)&m_temp[(unsigned)m_stack.back()] = (h256)m_stack[m_stack.size() - 2];
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
+			NEXT
 		}
-		case Instruction::MSTORE8:
+		CASE(MSTORE8)
 		{
 			m_temp[(unsigned)m_stack.back()] = (byte)(m_stack[m_stack.size() - 2] & 0xff);
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
+			NEXT
 		}
-		case Instruction::SLOAD:
+		CASE(SLOAD)
 			m_stack.back() = _ext.store(m_stack.back());
-			break;
-		case Instruction::SSTORE:
+			NEXT
+		CASE(SSTORE)
+			if (_ext.store(m_stack.back()) && !m_stack[m_stack.size() - 2])
+				_ext.sub.refunds += c_sstoreRefundGas;
 			_ext.setStore(m_stack.back(), m_stack[m_stack.size() - 2]);
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
-		case Instruction::JUMP:
-			nextPC = m_stack.back();
-			if (!m_jumpDests.count(nextPC))
+			NEXT
+		CASE(JUMP)
+			if (!code.isJumpDest(m_stack.back()))
 				BOOST_THROW_EXCEPTION(BadJumpDestination());
+			nextPC = (uint64_t)m_stack.back();
 			m_stack.pop_back();
-			break;
-		case Instruction::JUMPI:
+			NEXT
+		CASE(JUMPI)
 			if (m_stack[m_stack.size() - 2])
 			{
-				nextPC = m_stack.back();
-				if (!m_jumpDests.count(nextPC))
+				if (!code.isJumpDest(m_stack.back()))
 					BOOST_THROW_EXCEPTION(BadJumpDestination());
+				nextPC = (uint64_t)m_stack.back();
 			}
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
-		case Instruction::PC:
+			NEXT
+		CASE(PC)
 			m_stack.push_back(m_curPC);
-			break;
-		case Instruction::MSIZE:
+			NEXT
+		CASE(MSIZE)
 			m_stack.push_back(m_temp.size());
-			break;
-		case Instruction::GAS:
+			NEXT
+		CASE(GAS)
 			m_stack.push_back(m_gas);
-			break;
-		case Instruction::JUMPDEST:
-			break;
-		case Instruction::LOG0:
+			NEXT
+		CASE(JUMPDEST)
+			NEXT
+		CASE(LOG0)
 			_ext.log({}, bytesConstRef(m_temp.data() + (unsigned)m_stack[m_stack.size() - 1], (unsigned)m_stack[m_stack.size() - 2]));
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
-		case Instruction::LOG1:
+			NEXT
+		CASE(LOG1)
 			_ext.log({m_stack[m_stack.size() - 3]}, bytesConstRef(m_temp.data() + (unsigned)m_stack[m_stack.size() - 1], (unsigned)m_stack[m_stack.size() - 2]));
 			m_stack.pop_back();
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
-		case Instruction::LOG2:
+			NEXT
+		CASE(LOG2)
 			_ext.log({m_stack[m_stack.size() - 3], m_stack[m_stack.size() - 4]}, bytesConstRef(m_temp.data() + (unsigned)m_stack[m_stack.size() - 1], (unsigned)m_stack[m_stack.size() - 2]));
 			m_stack.pop_back();
 			m_stack.pop_back();
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
-		case Instruction::LOG3:
+			NEXT
+		CASE(LOG3)
 			_ext.log({m_stack[m_stack.size() - 3], m_stack[m_stack.size() - 4], m_stack[m_stack.size() - 5]}, bytesConstRef(m_temp.data() + (unsigned)m_stack[m_stack.size() - 1], (unsigned)m_stack[m_stack.size() - 2]));
 			m_stack.pop_back();
 			m_stack.pop_back();
 			m_stack.pop_back();
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
-		case Instruction::LOG4:
+			NEXT
+		CASE(LOG4)
 			_ext.log({m_stack[m_stack.size() - 3], m_stack[m_stack.size() - 4], m_stack[m_stack.size() - 5], m_stack[m_stack.size() - 6]}, bytesConstRef(m_temp.data() + (unsigned)m_stack[m_stack.size() - 1], (unsigned)m_stack[m_stack.size() - 2]));
 			m_stack.pop_back();
 			m_stack.pop_back();
@@ -603,8 +899,8 @@ bytesConstRef VM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
 			m_stack.pop_back();
 			m_stack.pop_back();
 			m_stack.pop_back();
-			break;
-		case Instruction::CREATE:
+			NEXT
+		CASE(CREATE)
 		{
 			u256 endowment = m_stack.back();
 			m_stack.pop_back();
@@ -617,10 +913,10 @@ bytesConstRef VM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
 				m_stack.push_back((u160)_ext.create(endowment, m_gas, bytesConstRef(m_temp.data() + initOff, initSize), _onOp));
 			else
 				m_stack.push_back(0);
-			break;
+			NEXT
 		}
-		case Instruction::CALL:
-		case Instruction::CALLCODE:
+		CASE(CALL)
+		CASE(CALLCODE)
 		{
 			u256 gas = m_stack.back();
 			if (m_stack[m_stack.size() - 3] > 0)
@@ -646,9 +942,9 @@ bytesConstRef VM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
 				m_stack.push_back(0);
 
 			m_gas += gas;
-			break;
+			NEXT
 		}
-		case Instruction::RETURN:
+		CASE(RETURN)
 		{
 			unsigned b = (unsigned)m_stack.back();
 			m_stack.pop_back();
@@ -657,17 +953,29 @@ bytesConstRef VM::go(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps)
 
 			return bytesConstRef(m_temp.data() + b, s);
 		}
-		case Instruction::SUICIDE:
+		CASE(SUICIDE)
 		{
 			Address dest = asAddress(m_stack.back());
 			_ext.suicide(dest);
 			// ...follow through to...
 		}
-		case Instruction::STOP:
+		CASE(STOP)
 			return bytesConstRef();
+#if ETH_COMPUTED_GOTO
+		L_INVALID:
+#endif
+		default:
+			BOOST_THROW_EXCEPTION(BadInstruction());
 		}
 	}
-	if (_steps == (uint64_t)-1)
-		BOOST_THROW_EXCEPTION(StepsDone());
-	return bytesConstRef();
+#if ETH_COMPUTED_GOTO
+L_stepsDone:
+#endif
+	BOOST_THROW_EXCEPTION(StepsDone());
 }
+
+#undef CASE
+#undef NEXT
+#if ETH_COMPUTED_GOTO
+#pragma GCC diagnostic pop
+#endif
@@ -29,6 +29,8 @@
 #include <libethcore/BlockInfo.h>
 #include <libethcore/Params.h>
 #include "VMFace.h"
+#include "AnalysedCode.h"
+#include "VMProfiler.h"
 
 namespace dev
 {
@@ -52,6 +54,9 @@ inline u256 fromAddress(Address _a)
 class VM: public VMFace
 {
 public:
+	/// Hands the stack and memory buffers back to this thread's pool for the next VM.
+	virtual ~VM();
+
 	virtual void reset(u256 _gas = 0) noexcept override final;
 
 	virtual bytesConstRef go(ExtVMFace& _ext, OnOpFunc const& _onOp = {}, uint64_t _steps = (uint64_t)-1) override final;
@@ -67,14 +72,22 @@ public:
 private:
 	friend class VMFactory;
 
-	/// Construct VM object.
-	explicit VM(u256 _gas): VMFace(_gas) {}
+	/// Construct VM object, reusing stack and memory buffers of a previous VM on this thread if available.
+	/// If @a _threaded is true the direct-threaded dispatch loop will be used where the compiler supports it.
+	explicit VM(u256 _gas, bool _threaded = false);
+
+	/// Run the interpreter loop of the dispatch kind chosen at construction.
+	bytesConstRef dispatch(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps);
+	/// The interpreter loop; @a c_threaded selects direct-threaded rather than switch dispatch.
+	template <bool c_threaded> bytesConstRef interpret(ExtVMFace& _ext, OnOpFunc const& _onOp, uint64_t _steps);
 
-	u256 m_curPC = 0;
+	uint64_t m_curPC = 0;
 	bytes m_temp;
 	u256s m_stack;
-	std::set<u256> m_jumpDests;
+	bool m_threaded = false;
+	std::shared_ptr<AnalysedCode const> m_code;	///< The code being executed together with its jump destinations and push data.
 	std::function<void()> m_onFail;
+	CodeProfile* m_profile = nullptr;	///< Where executed opcodes are counted while the VMProfiler is enabled.
 };
 
 }
@@ -18,6 +18,7 @@
 #include "VMFactory.h"
 #include <libdevcore/Assertions.h>
 #include "VM.h"
+#include "AdaptiveVM.h"
 
 #if ETH_EVMJIT
 #include <evmjit/libevmjit-cpp/JitVM.h>
@@ -37,13 +38,25 @@ void VMFactory::setKind(VMKind _kind)
 	g_kind = _kind;
 }
 
+VMKind VMFactory::kind()
+{
+	return g_kind;
+}
+
 std::unique_ptr<VMFace> VMFactory::create(u256 _gas)
+{
+	return create(g_kind, _gas);
+}
+
+std::unique_ptr<VMFace> VMFactory::create(VMKind _kind, u256 _gas)
 {
 #if ETH_EVMJIT
-	return std::unique_ptr<VMFace>(g_kind == VMKind::JIT ? static_cast<VMFace*>(new JitVM(_gas)) : static_cast<VMFace*>(new VM(_gas)));
+	if (_kind == VMKind::Adaptive)
+		return std::unique_ptr<VMFace>(new AdaptiveVM(_gas));
+	return std::unique_ptr<VMFace>(_kind == VMKind::JIT ? static_cast<VMFace*>(new JitVM(_gas)) : static_cast<VMFace*>(new VM(_gas, _kind == VMKind::Threaded)));
 #else
-	asserts(g_kind == VMKind::Interpreter && "JIT disabled in build configuration");
-	return std::unique_ptr<VMFace>(new VM(_gas));
+	asserts(_kind != VMKind::JIT && "JIT disabled in build configuration");
+	return std::unique_ptr<VMFace>(new VM(_gas, _kind == VMKind::Threaded));
 #endif
 }
 
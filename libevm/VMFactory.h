@@ -23,10 +23,12 @@ namespace dev
 namespace eth
 {
 
-enum class VMKind: bool
+enum class VMKind
 {
 	Interpreter,
-	JIT
+	JIT,
+	Threaded,	///< The interpreter with direct-threaded (computed goto) dispatch; as Interpreter on other compilers.
+	Adaptive	///< The interpreter for cold code and the JIT for hot code, see AdaptiveVM; as Interpreter without JIT.
 };
 
 class VMFactory
@@ -35,7 +37,10 @@ public:
 	VMFactory() = delete;
 
 	static std::unique_ptr<VMFace> create(u256 _gas);
+	/// Creates a VM of the given kind, regardless of the one set with setKind().
+	static std::unique_ptr<VMFace> create(VMKind _kind, u256 _gas);
 	static void setKind(VMKind _kind);
+	static VMKind kind();
 };
 
 }
@@ -0,0 +1,97 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file VMProfiler.cpp
+ * @date 2015
+ */
+
+#include "VMProfiler.h"
+#include <algorithm>
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/StructuredLogger.h>
+#include <libevmcore/Instruction.h>
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+/// Number of opcodes itemised for each piece of code in the structured log.
+static const unsigned c_loggedOpcodes = 5;
+
+static uint64_t saturatingAdd(uint64_t _a, uint64_t _b)
+{
+	return _a + _b < _a ? numeric_limits<uint64_t>::max() : _a + _b;
+}
+
+void CodeProfile::merge(CodeProfile const& _p)
+{
+	runs += _p.runs;
+	steps += _p.steps;
+	gas = saturatingAdd(gas, _p.gas);
+	time += _p.time;
+	for (unsigned i = 0; i < opcodes.size(); ++i)
+	{
+		opcodes[i].count += _p.opcodes[i].count;
+		opcodes[i].gas = saturatingAdd(opcodes[i].gas, _p.opcodes[i].gas);
+	}
+}
+
+vector<pair<byte, OpcodeProfile>> CodeProfile::hottest(unsigned _max) const
+{
+	vector<pair<byte, OpcodeProfile>> ret;
+	for (unsigned i = 0; i < opcodes.size(); ++i)
+		if (opcodes[i].count)
+			ret.push_back(make_pair((byte)i, opcodes[i]));
+	sort(ret.begin(), ret.end(), [](pair<byte, OpcodeProfile> const& a, pair<byte, OpcodeProfile> const& b) { return a.second.gas > b.second.gas || (a.second.gas == b.second.gas && a.second.count > b.second.count); });
+	if (ret.size() > _max)
+		ret.resize(_max);
+	return ret;
+}
+
+void VMProfiler::record(h256 const& _codeHash, CodeProfile const& _run)
+{
+	Guard l(x_profiles);
+	m_profiles[_codeHash].merge(_run);
+}
+
+void VMProfiler::reset()
+{
+	Guard l(x_profiles);
+	m_profiles.clear();
+}
+
+vector<pair<h256, CodeProfile>> VMProfiler::hotSpots(unsigned _max) const
+{
+	vector<pair<h256, CodeProfile>> ret;
+	{
+		Guard l(x_profiles);
+		ret.assign(m_profiles.begin(), m_profiles.end());
+	}
+	sort(ret.begin(), ret.end(), [](pair<h256, CodeProfile> const& a, pair<h256, CodeProfile> const& b) { return a.second.gas > b.second.gas; });
+	if (ret.size() > _max)
+		ret.resize(_max);
+	return ret;
+}
+
+void VMProfiler::log(unsigned _max) const
+{
+	for (auto const& p: hotSpots(_max))
+	{
+		string opcodes;
+		for (auto const& o: p.second.hottest(c_loggedOpcodes))
+			opcodes += (opcodes.empty() ? "" : " ") + string(instructionInfo((Instruction)o.first).name) + ":" + toString(o.second.gas);
+		StructuredLogger::vmProfile(toHex(p.first.ref()), p.second.runs, p.second.steps, p.second.gas, (uint64_t)chrono::duration_cast<chrono::microseconds>(p.second.time).count(), opcodes);
+	}
+}
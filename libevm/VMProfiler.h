@@ -0,0 +1,97 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file VMProfiler.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+#include <libdevcore/Common.h>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/// What one opcode cost within a piece of code.
+struct OpcodeProfile
+{
+	uint64_t count = 0;		///< Number of times it was executed.
+	uint64_t gas = 0;		///< Gas charged for it, saturating at 2^64 - 1.
+};
+
+/// Execution statistics of one piece of code, accumulated over all of its runs.
+struct CodeProfile
+{
+	/// Add the statistics of @a _p to ours.
+	void merge(CodeProfile const& _p);
+
+	/// @returns the @a _max opcodes with the most gas charged, most expensive first. Opcodes never executed are omitted.
+	std::vector<std::pair<byte, OpcodeProfile>> hottest(unsigned _max = 256) const;
+
+	uint64_t runs = 0;									///< Number of VM invocations of this code.
+	uint64_t steps = 0;									///< Total instructions executed.
+	uint64_t gas = 0;									///< Total gas charged by its instructions (excluding gas passed on to calls).
+	std::chrono::nanoseconds time = std::chrono::nanoseconds(0);	///< Wall time spent in the VM, including nested calls.
+	std::array<OpcodeProfile, 256> opcodes;				///< Indexed by instruction.
+};
+
+/**
+ * @brief Process-wide counting profiler for the interpreter.
+ *
+ * When enabled, every VM counts the opcodes it executes and the gas charged for each, and on leaving go()
+ * merges these together with the time spent into the profile for its code hash. When disabled the only
+ * cost is a single flag test per go().
+ */
+class VMProfiler
+{
+public:
+	static VMProfiler& get() { static VMProfiler s_this; return s_this; }
+
+	bool isEnabled() const { return m_enabled; }
+	/// Switch profiling on or off. Already collected profiles are kept.
+	void setEnabled(bool _enabled) { m_enabled = _enabled; }
+
+	/// Merge the statistics of a single run of the code with hash @a _codeHash.
+	void record(h256 const& _codeHash, CodeProfile const& _run);
+	/// Drop all collected profiles.
+	void reset();
+
+	/// @returns the @a _max profiled pieces of code which have consumed the most gas, most expensive first.
+	std::vector<std::pair<h256, CodeProfile>> hotSpots(unsigned _max = (unsigned)-1) const;
+
+	/// Emit the @a _max hottest pieces of code through the StructuredLogger.
+	void log(unsigned _max = 10) const;
+
+private:
+	VMProfiler() = default;
+
+	std::atomic<bool> m_enabled{false};
+
+	mutable Mutex x_profiles;
+	std::unordered_map<h256, CodeProfile> m_profiles;
+};
+
+}
+}
@@ -23,6 +23,7 @@
 #include <fstream>
 #include <libdevcore/Log.h>
 #include <libevmcore/CommonSubexpressionEliminator.h>
+#include <libevmcore/ControlFlowGraph.h>
 
 using namespace std;
 using namespace dev;
@@ -183,7 +184,7 @@ inline bool matches(AssemblyItemsConstRef _a, AssemblyItemsConstRef _b)
 struct OptimiserChannel: public LogChannel { static const char* name() { return "OPT"; } static const int verbosity = 12; };
 #define copt dev::LogOutputStream<OptimiserChannel, true>()
 
-Assembly& Assembly::optimise(bool _enable)
+Assembly& Assembly::optimise(bool _enable, bool _isCreation, unsigned _runs)
 {
 	if (!_enable)
 		return *this;
@@ -196,6 +197,25 @@ Assembly& Assembly::optimise(bool _enable)
 	{
 		copt << *this;
 		count = 0;
+		unsigned addressLength = dev::bytesRequired(bytesRequired());
+		auto cheaper = [&](AssemblyItemsConstRef _new, AssemblyItemsConstRef _old)
+		{
+			return GasMeter::cost(_new, addressLength, _isCreation, _runs) < GasMeter::cost(_old, addressLength, _isCreation, _runs);
+		};
+
+		copt << "Optimising across basic blocks...";
+		{
+			ControlFlowGraph cfg(m_items);
+			unsigned changes = cfg.foldConstantJumps();
+			changes += cfg.threadJumps();
+			changes += cfg.removeDeadBlocks();
+			changes += cfg.mergeBlocks();
+			if (changes)
+			{
+				m_items = cfg.items();
+				count += changes;
+			}
+		}
 
 		copt << "Performing common subexpression elimination...";
 		for (auto iter = m_items.begin(); iter != m_items.end();)
@@ -208,7 +228,7 @@ Assembly& Assembly::optimise(bool _enable)
 			try
 			{
 				optItems = eliminator.getOptimizedItems();
-				shouldReplace = (optItems.size() < size_t(iter - orig));
+				shouldReplace = cheaper(&optItems, AssemblyItemsConstRef(&*orig, iter - orig));
 			}
 			catch (StackTooDeepException const&)
 			{
@@ -234,7 +254,7 @@ Assembly& Assembly::optimise(bool _enable)
 				if (matches(vr, &r.first))
 				{
 					auto rw = r.second(vr);
-					if (rw.size() < vr.size())
+					if (cheaper(&rw, vr))
 					{
 						copt << "Rule " << vr << " matches " << AssemblyItemsConstRef(&r.first) << " becomes...";
 						copt << AssemblyItemsConstRef(&rw) << "\n";
@@ -304,7 +324,7 @@ Assembly& Assembly::optimise(bool _enable)
 	copt << total << " optimisations done.";
 
 	for (auto& sub: m_subs)
-	  sub.optimise(true);
+	  sub.optimise(true, false, _runs);
 
 	return *this;
 }
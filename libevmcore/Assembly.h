@@ -28,6 +28,7 @@
 #include <libevmcore/SourceLocation.h>
 #include <libevmcore/Instruction.h>
 #include <libevmcore/AssemblyItem.h>
+#include <libevmcore/GasMeter.h>
 #include "Exceptions.h"
 
 namespace dev
@@ -85,7 +86,10 @@ public:
 	void setSourceLocation(SourceLocation const& _location) { m_currentSourceLocation = _location; }
 
 	bytes assemble() const;
-	Assembly& optimise(bool _enable);
+	/// Optimises the items, and those of each subassembly as runtime code, choosing between equivalent sequences by
+	/// GasMeter::cost(). @a _isCreation if these items are run once to create a contract; @a _runs is how many times
+	/// runtime code is taken to run for each deployment: the higher, the more running gas outweighs code size.
+	Assembly& optimise(bool _enable, bool _isCreation = true, unsigned _runs = c_optimiseRuns);
 	std::ostream& stream(std::ostream& _out, std::string const& _prefix = "", const StringMap &_sourceCodes = StringMap()) const;
 
 protected:
@@ -0,0 +1,272 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file ControlFlowGraph.cpp
+ * @date 2015
+ * Optimizer steps which look across basic blocks.
+ */
+
+#include <libevmcore/ControlFlowGraph.h>
+#include <algorithm>
+#include <set>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+/// @returns true if control never goes on past @a _item.
+static bool isTerminator(AssemblyItem const& _item)
+{
+	if (_item.type() != Operation)
+		return false;
+	switch (_item.instruction())
+	{
+	case Instruction::JUMP:
+	case Instruction::STOP:
+	case Instruction::RETURN:
+	case Instruction::SUICIDE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/// @returns the index in @a _items of the PushTag whose tag the JUMP ending them jumps to, found by following
+/// it over the stack, or -1 if they do not end in a JUMP, its target comes from elsewhere, or the tag is also
+/// copied or used by anything else.
+static int jumpTargetPush(AssemblyItems const& _items)
+{
+	if (_items.empty() || _items.back() != AssemblyItem(Instruction::JUMP))
+		return -1;
+	// Each stack slot holds the index of the PushTag that put it there, or -1; slots below the block's own are -1.
+	vector<int> stack;
+	set<int> escaped;
+	auto pop = [&]() { int r = stack.empty() ? -1 : stack.back(); if (!stack.empty()) stack.pop_back(); return r; };
+	for (size_t i = 0; i + 1 < _items.size(); ++i)
+	{
+		AssemblyItem const& item = _items[i];
+		if (item.type() == Tag)
+			continue;
+		if (item.type() != Operation)
+		{
+			stack.push_back(item.type() == PushTag ? int(i) : -1);
+			continue;
+		}
+		Instruction inst = item.instruction();
+		if (inst >= Instruction::DUP1 && inst <= Instruction::DUP16)
+		{
+			unsigned n = getDupNumber(inst);
+			stack.push_back(n <= stack.size() ? stack[stack.size() - n] : -1);
+			escaped.insert(stack.back());
+		}
+		else if (inst >= Instruction::SWAP1 && inst <= Instruction::SWAP16)
+		{
+			unsigned n = getSwapNumber(inst);
+			if (n >= stack.size())
+				stack.insert(stack.begin(), n + 1 - stack.size(), -1);
+			swap(stack.back(), stack[stack.size() - 1 - n]);
+		}
+		else
+		{
+			InstructionInfo info = instructionInfo(inst);
+			for (int j = 0; j < info.args; ++j)
+				escaped.insert(pop());
+			stack.insert(stack.end(), info.ret, -1);
+		}
+	}
+	int ret = pop();
+	return ret < 0 || escaped.count(ret) || count(stack.begin(), stack.end(), ret) ? -1 : ret;
+}
+
+ControlFlowGraph::ControlFlowGraph(AssemblyItems const& _items)
+{
+	for (AssemblyItem const& i: _items)
+	{
+		if (i.type() == Operation && (i.instruction() == Instruction::JUMPDEST || i.instruction() == Instruction::PC))
+			m_fixedJumps = true;
+		if (m_blocks.empty() || (i.type() == Tag && !m_blocks.back().items.empty()))
+			m_blocks.push_back(BasicBlock());
+		m_blocks.back().items.push_back(i);
+		if (isTerminator(i) || i == AssemblyItem(Instruction::JUMPI))
+		{
+			m_blocks.back().fallsThrough = !isTerminator(i);
+			m_blocks.push_back(BasicBlock());
+		}
+	}
+	if (!m_blocks.empty() && m_blocks.back().items.empty())
+		m_blocks.pop_back();
+	noteTags();
+}
+
+void ControlFlowGraph::noteTags()
+{
+	m_tagBlocks.clear();
+	for (unsigned i = 0; i < m_blocks.size(); ++i)
+		if (hasTag(m_blocks[i]))
+			m_tagBlocks[m_blocks[i].items[0].data()] = i;
+}
+
+AssemblyItems ControlFlowGraph::items() const
+{
+	AssemblyItems ret;
+	for (BasicBlock const& b: m_blocks)
+		ret.insert(ret.end(), b.items.begin(), b.items.end());
+	return ret;
+}
+
+unsigned ControlFlowGraph::foldConstantJumps()
+{
+	unsigned ret = 0;
+	for (BasicBlock& b: m_blocks)
+	{
+		AssemblyItems& items = b.items;
+		size_t n = items.size();
+		if (n < 3 || items[n - 1] != AssemblyItem(Instruction::JUMPI) || items[n - 2].type() != PushTag || items[n - 3].type() != Push)
+			continue;
+		if (items[n - 3].data())
+		{
+			// Always taken.
+			items.erase(items.begin() + n - 3);
+			items.back() = AssemblyItem(Instruction::JUMP);
+			b.fallsThrough = false;
+		}
+		else
+			// Never taken.
+			items.erase(items.end() - 3, items.end());
+		++ret;
+	}
+	return ret;
+}
+
+unsigned ControlFlowGraph::threadJumps()
+{
+	unsigned ret = 0;
+	for (BasicBlock& b: m_blocks)
+		for (size_t i = 0; i + 1 < b.items.size(); ++i)
+		{
+			if (b.items[i].type() != PushTag || (b.items[i + 1] != AssemblyItem(Instruction::JUMP) && b.items[i + 1] != AssemblyItem(Instruction::JUMPI)))
+				continue;
+			// Follows the chain of blocks which only jump on, leaving the jump as it is if the chain loops.
+			u256 target = b.items[i].data();
+			set<u256> seen{target};
+			for (auto it = m_tagBlocks.find(target); it != m_tagBlocks.end(); it = m_tagBlocks.find(target))
+			{
+				AssemblyItems const& t = m_blocks[it->second].items;
+				if (t.size() != 3 || t[1].type() != PushTag || t[2] != AssemblyItem(Instruction::JUMP))
+					break;
+				target = t[1].data();
+				if (!seen.insert(target).second)
+				{
+					target = b.items[i].data();
+					break;
+				}
+			}
+			if (target != b.items[i].data())
+			{
+				b.items[i].setData(target);
+				++ret;
+			}
+		}
+	return ret;
+}
+
+unsigned ControlFlowGraph::removeDeadBlocks()
+{
+	if (m_fixedJumps || m_blocks.empty())
+		return 0;
+
+	// A block is reached from the start, from a reached block falling through into it, or from anywhere its tag is
+	// pushed in a reached block; whether as a jump's target or as a return address, it is all the same.
+	vector<bool> reached(m_blocks.size(), false);
+	vector<unsigned> todo{0};
+	while (!todo.empty())
+	{
+		unsigned b = todo.back();
+		todo.pop_back();
+		if (reached[b])
+			continue;
+		reached[b] = true;
+		if (m_blocks[b].fallsThrough && b + 1 < m_blocks.size())
+			todo.push_back(b + 1);
+		for (AssemblyItem const& i: m_blocks[b].items)
+			if (i.type() == PushTag && m_tagBlocks.count(i.data()))
+				todo.push_back(m_tagBlocks[i.data()]);
+	}
+
+	vector<BasicBlock> blocks;
+	for (unsigned i = 0; i < m_blocks.size(); ++i)
+		if (reached[i])
+			blocks.push_back(move(m_blocks[i]));
+	unsigned ret = m_blocks.size() - blocks.size();
+	m_blocks = move(blocks);
+	noteTags();
+	return ret;
+}
+
+unsigned ControlFlowGraph::mergeBlocks()
+{
+	if (m_fixedJumps)
+		return 0;
+
+	map<u256, unsigned> references;
+	for (BasicBlock const& b: m_blocks)
+		for (AssemblyItem const& i: b.items)
+			if (i.type() == PushTag)
+				references[i.data()]++;
+
+	unsigned ret = 0;
+	for (unsigned p = 0; p < m_blocks.size();)
+	{
+		// The jump ending p must be the only way into b: b's tag pushed nowhere else, and nothing falling into it.
+		// As b then ends in a way out of its own, it can go where the jump is. The tag need not be pushed just
+		// before the jump: an internal function's return jumps to the tag its caller pushed before the call.
+		AssemblyItems& items = m_blocks[p].items;
+		size_t n = items.size();
+		int push = jumpTargetPush(items);
+		auto it = push >= 0 ? m_tagBlocks.find(items[push].data()) : m_tagBlocks.end();
+		if (it == m_tagBlocks.end())
+		{
+			++p;
+			continue;
+		}
+		unsigned b = it->second;
+		if (b == p || references[it->first] != 1 || m_blocks[b].fallsThrough || (b && m_blocks[b - 1].fallsThrough))
+		{
+			++p;
+			continue;
+		}
+
+		// A tag pushed further up stays in its stack slot as a zero, popped instead of jumped to, for the
+		// eliminator to remove both.
+		if (unsigned(push) + 2 == n)
+			items.erase(items.end() - 2, items.end());
+		else
+		{
+			items[push] = AssemblyItem(u256(0));
+			items.back() = AssemblyItem(Instruction::POP);
+		}
+		items.insert(items.end(), m_blocks[b].items.begin() + 1, m_blocks[b].items.end());
+		m_blocks[p].fallsThrough = false;
+		m_blocks.erase(m_blocks.begin() + b);
+		noteTags();
+		++ret;
+		// p may now end in another jump to merge; if b came before it, it has moved back one.
+		if (b < p)
+			--p;
+	}
+	return ret;
+}
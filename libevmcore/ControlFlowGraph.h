@@ -0,0 +1,76 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file ControlFlowGraph.h
+ * @date 2015
+ * Optimizer steps which look across basic blocks.
+ */
+
+#pragma once
+
+#include <map>
+#include <vector>
+#include <libevmcore/AssemblyItem.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * The basic blocks of a list of assembly items and the jumps between them, for the optimizer steps which the
+ * common subexpression eliminator, working within one block, cannot do:
+ * - folding a JUMPI on a constant into a JUMP or into nothing;
+ * - jump threading, i.e. retargeting a jump to a block that only jumps on;
+ * - removing the blocks which no path from the start reaches;
+ * - merging a block entered only by one jump into the place of that jump, whether the tag is pushed just before
+ *   it or, as for the return from an internal function, further up, so that constants and
+ *   loaded storage values carry across, as the eliminator then sees one block where there were two.
+ * Each step @returns the number of changes it made; items() gives the result.
+ * Code which jumps to addresses of its own, rather than to tags, is left as it is.
+ */
+class ControlFlowGraph
+{
+public:
+	explicit ControlFlowGraph(AssemblyItems const& _items);
+
+	unsigned foldConstantJumps();
+	unsigned threadJumps();
+	unsigned removeDeadBlocks();
+	unsigned mergeBlocks();
+
+	AssemblyItems items() const;
+
+private:
+	struct BasicBlock
+	{
+		AssemblyItems items;		///< Starting with its Tag, if it has one.
+		bool fallsThrough = true;	///< False if it ends in a JUMP, STOP, RETURN or SUICIDE.
+	};
+
+	/// @returns true if @a _block starts with a tag.
+	static bool hasTag(BasicBlock const& _block) { return !_block.items.empty() && _block.items[0].type() == Tag; }
+	/// Indexes the blocks by their tags.
+	void noteTags();
+
+	std::vector<BasicBlock> m_blocks;
+	std::map<u256, unsigned> m_tagBlocks;	///< The block each tag starts.
+	bool m_fixedJumps = false;				///< True if the items jump without tags, so must stay where they are.
+};
+
+}
+}
@@ -274,7 +274,8 @@ Rules::Rules()
 
 ExpressionClasses::Id ExpressionClasses::tryToSimplify(Expression const& _expr, bool _secondRun)
 {
-	static Rules rules;
+	// The rules keep what their patterns matched, so each thread optimising code needs its own.
+	static thread_local Rules rules;
 
 	if (_expr.item->type() != Operation)
 		return -1;
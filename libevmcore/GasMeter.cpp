@@ -0,0 +1,89 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file GasMeter.cpp
+ * @date 2015
+ * Cost model of assembly items, by which the optimiser picks between equivalent sequences.
+ */
+
+#include <libevmcore/GasMeter.h>
+#include <libethcore/Params.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+bigint GasMeter::runGas(AssemblyItem const& _item)
+{
+	switch (_item.type())
+	{
+	case Operation:
+		break;
+	case Tag:
+		return c_jumpdestGas;
+	case Push:
+	case PushString:
+	case PushTag:
+	case PushData:
+	case PushSub:
+	case PushSubSize:
+	case PushProgramSize:
+		return c_tierStepGas[VeryLowTier];
+	default:
+		return 0;
+	}
+
+	Instruction i = _item.instruction();
+	switch (i)
+	{
+	case Instruction::EXP: return c_expGas;
+	case Instruction::SHA3: return c_sha3Gas;
+	case Instruction::SLOAD: return c_sloadGas;
+	case Instruction::SSTORE: return c_sstoreResetGas;
+	case Instruction::JUMPDEST: return c_jumpdestGas;
+	case Instruction::CREATE: return c_createGas;
+	case Instruction::CALL:
+	case Instruction::CALLCODE: return c_callGas;
+	default:
+		break;
+	}
+	if (i >= Instruction::LOG0 && i <= Instruction::LOG4)
+		return c_logGas + c_logTopicGas * (unsigned(i) - unsigned(Instruction::LOG0));
+	int tier = instructionInfo(i).gasPriceTier;
+	return tier < InvalidTier ? bigint(c_tierStepGas[tier]) : 0;
+}
+
+bigint GasMeter::runGas(AssemblyItemsConstRef _items)
+{
+	bigint ret = 0;
+	for (AssemblyItem const& i: _items)
+		ret += runGas(i);
+	return ret;
+}
+
+bigint GasMeter::deployGas(AssemblyItemsConstRef _items, unsigned _addressLength, bool _isCreation)
+{
+	unsigned bytes = 0;
+	for (AssemblyItem const& i: _items)
+		bytes += i.bytesRequired(_addressLength);
+	return bigint(bytes) * (_isCreation ? c_txDataNonZeroGas : c_createDataGas);
+}
+
+bigint GasMeter::cost(AssemblyItemsConstRef _items, unsigned _addressLength, bool _isCreation, unsigned _runs)
+{
+	return deployGas(_items, _addressLength, _isCreation) + runGas(_items) * (_isCreation ? 1 : _runs);
+}
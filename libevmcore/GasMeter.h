@@ -0,0 +1,56 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file GasMeter.h
+ * @date 2015
+ * Cost model of assembly items, by which the optimiser picks between equivalent sequences.
+ */
+
+#pragma once
+
+#include <libdevcore/Common.h>
+#include <libevmcore/AssemblyItem.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/// How many times the runtime code is taken to run for each time it is deployed, unless the caller says.
+static const unsigned c_optimiseRuns = 200;
+
+/**
+ * The gas of assembly items, in two parts: running them, by the tiers of instructionInfo() and c_tierStepGas, and
+ * deploying their bytes. Costs which depend on the arguments (memory, SSTORE of a new slot, EXP's exponent, ...)
+ * are taken at their base, which is the same for any two equivalent sequences.
+ */
+struct GasMeter
+{
+	/// @returns the gas to run @a _item once.
+	static bigint runGas(AssemblyItem const& _item);
+	/// @returns the gas to run each of @a _items once.
+	static bigint runGas(AssemblyItemsConstRef _items);
+	/// @returns the gas to deploy @a _items, a jump tag's value taking @a _addressLength bytes: as contract code at
+	/// c_createDataGas a byte, or, if @a _isCreation, as the data of a creating transaction.
+	static bigint deployGas(AssemblyItemsConstRef _items, unsigned _addressLength, bool _isCreation);
+	/// @returns what @a _items cost, all told: deploying them once, and running them once if @a _isCreation,
+	/// otherwise @a _runs times.
+	static bigint cost(AssemblyItemsConstRef _items, unsigned _addressLength, bool _isCreation, unsigned _runs);
+};
+
+}
+}
@@ -0,0 +1,145 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file GasProfiler.cpp
+ * @date 2015
+ * Attribution of the gas spent running compiled code to the source it was compiled from.
+ */
+
+#include <libevmcore/GasProfiler.h>
+#include <algorithm>
+#include <libdevcore/CommonIO.h>
+#include <libdevcrypto/SHA3.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+/// @returns the head of the function definition at @a _location in @a _source, with its whitespace collapsed, or
+/// an empty string if there is none there.
+static string functionHead(string const& _source, SourceLocation const& _location)
+{
+	if (_location.start < 0 || _location.end > int(_source.size()) || _source.compare(_location.start, 8, "function"))
+		return string();
+	string ret;
+	for (int i = _location.start; i < _location.end && _source[i] != '{' && _source[i] != ';'; ++i)
+		if (!isspace(_source[i]))
+			ret += _source[i];
+		else if (!ret.empty() && ret.back() != ' ')
+			ret += ' ';
+	while (!ret.empty() && ret.back() == ' ')
+		ret.pop_back();
+	return ret;
+}
+
+void GasProfiler::addCode(string const& _name, bytes const& _code, AssemblyItems const& _items, StringMap const& _sources)
+{
+	Code& code = m_codes[sha3(_code)];
+	code = Code();
+	code.name = _name;
+	code.items.assign(_code.size(), -1);
+	for (size_t pc = 0, item = 0; pc < _code.size() && item < _items.size(); ++pc, ++item)
+	{
+		code.items[pc] = item;
+		Instruction i = Instruction(_code[pc]);
+		if (i >= Instruction::PUSH1 && i <= Instruction::PUSH32)
+			pc += unsigned(i) - unsigned(Instruction::PUSH1) + 1;
+	}
+
+	map<string, vector<int>> lineStarts;
+	for (AssemblyItem const& item: _items)
+	{
+		SourceLocation const& location = item.getLocation();
+		auto source = location.sourceName ? _sources.find(*location.sourceName) : _sources.end();
+		code.jumps.push_back(item.getJumpType());
+		if (location.isEmpty() || source == _sources.end())
+		{
+			code.lines.push_back(_name);
+			code.functions.push_back(string());
+			continue;
+		}
+		vector<int>& starts = lineStarts[source->first];
+		if (starts.empty())
+		{
+			starts.push_back(0);
+			for (size_t i = 0; i < source->second.size(); ++i)
+				if (source->second[i] == '\n')
+					starts.push_back(i + 1);
+		}
+		size_t line = upper_bound(starts.begin(), starts.end(), location.start) - starts.begin();
+		code.lines.push_back((source->first.empty() ? _name : source->first) + ":" + toString(line));
+		code.functions.push_back(item.type() == Tag ? functionHead(source->second, location) : string());
+	}
+}
+
+void GasProfiler::step(uint64_t _steps, unsigned _depth, bytes const& _code, unsigned _pc, bigint const& _gas)
+{
+	if (_depth >= m_runs.size())
+		m_runs.resize(_depth + 1);
+	Run& run = m_runs[_depth];
+	if (_steps == 0)
+	{
+		auto it = m_codes.find(sha3(_code));
+		run.code = it == m_codes.end() ? nullptr : &it->second;
+		run.frames = {run.code ? run.code->name : "?"};
+		run.lastJump = AssemblyItem::JumpType::Ordinary;
+		m_prefixDepth = unsigned(-1);
+	}
+
+	int item = run.code && _pc < run.code->items.size() ? run.code->items[_pc] : -1;
+	if (item >= 0)
+	{
+		// The jump into an external function's body, from the dispatcher, is not marked, so the first
+		// function is taken to be entered however it is reached.
+		string const& function = run.code->functions[item];
+		if (!function.empty() && (run.lastJump == AssemblyItem::JumpType::IntoFunction || run.frames.size() == 1))
+		{
+			run.frames.push_back(function);
+			m_prefixDepth = unsigned(-1);
+		}
+		else if (run.lastJump == AssemblyItem::JumpType::OutOfFunction && run.frames.size() > 1)
+		{
+			run.frames.pop_back();
+			m_prefixDepth = unsigned(-1);
+		}
+		run.lastJump = run.code->jumps[item];
+	}
+
+	string const& line = item >= 0 ? run.code->lines[item] : run.frames.front();
+	m_stacks[prefix(_depth) + ";" + line] += _gas;
+	m_lines[line] += _gas;
+	m_frames[run.frames.back()] += _gas;
+}
+
+string const& GasProfiler::prefix(unsigned _depth)
+{
+	if (m_prefixDepth != _depth)
+	{
+		m_prefix.clear();
+		for (unsigned d = 0; d <= _depth; ++d)
+			for (string const& frame: m_runs[d].frames.empty() ? vector<string>{"?"} : m_runs[d].frames)
+				m_prefix += (m_prefix.empty() ? "" : ";") + frame;
+		m_prefixDepth = _depth;
+	}
+	return m_prefix;
+}
+
+void GasProfiler::streamFolded(ostream& _out) const
+{
+	for (auto const& stack: m_stacks)
+		_out << stack.first << " " << stack.second << endl;
+}
@@ -0,0 +1,97 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file GasProfiler.h
+ * @date 2015
+ * Attribution of the gas spent running compiled code to the source it was compiled from.
+ */
+
+#pragma once
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <libdevcore/FixedHash.h>
+#include <libevmcore/AssemblyItem.h>
+
+namespace dev
+{
+namespace eth
+{
+
+/**
+ * Sums up the gas of the steps a VM takes by where in the source they come from, through the source locations of
+ * the assembly items the code was assembled from, one instruction for each item.
+ * The steps are sorted into a stack of frames: the code run at each call depth and, within it, the functions
+ * entered by jumps the compiler marked as going into a function. A step's gas goes to that stack topped by the
+ * source line of its item, which gives the folded format of flamegraph.pl, and to the line and the innermost frame
+ * on their own. Steps of code that was not added go to the frame "?".
+ */
+class GasProfiler
+{
+public:
+	/// Profiles the steps of @a _code, assembled from @a _items, under the frame @a _name. @a _sources holds the
+	/// source code by name, to give lines and function names.
+	void addCode(std::string const& _name, bytes const& _code, AssemblyItems const& _items, StringMap const& _sources);
+
+	/// Notes a step at @a _pc of @a _code at call depth @a _depth, which cost @a _gas. @a _steps is the number of
+	/// steps taken before it in this run of the code, as given to an OnOpFunc; 0 starts a new run.
+	void step(uint64_t _steps, unsigned _depth, bytes const& _code, unsigned _pc, bigint const& _gas);
+
+	/// @returns the gas by stack of frames, separated by ';' and topped by the source line, as "<source>:<line>".
+	std::map<std::string, bigint> const& stacks() const { return m_stacks; }
+	/// @returns the gas by source line.
+	std::map<std::string, bigint> const& lines() const { return m_lines; }
+	/// @returns the gas by function or code frame, not counting that of the functions and code it calls.
+	std::map<std::string, bigint> const& frames() const { return m_frames; }
+
+	/// Writes out the stacks in the folded format of flamegraph.pl: a stack and its gas on each line.
+	void streamFolded(std::ostream& _out) const;
+
+private:
+	/// What is known of a piece of code, by the index of each instruction's item.
+	struct Code
+	{
+		std::string name;
+		std::vector<int> items;				///< The item of each pc, or -1 within push data.
+		std::vector<std::string> lines;		///< "<source>:<line>" or, for items without a location, the name.
+		std::vector<std::string> functions;	///< For each tag, the function it enters, if any.
+		std::vector<AssemblyItem::JumpType> jumps;
+	};
+	/// A run of code at one call depth.
+	struct Run
+	{
+		Code const* code = nullptr;
+		std::vector<std::string> frames;
+		AssemblyItem::JumpType lastJump = AssemblyItem::JumpType::Ordinary;
+	};
+
+	/// @returns the stack of frames of the runs up to @a _depth, each but the first preceded by ';'.
+	std::string const& prefix(unsigned _depth);
+
+	std::map<h256, Code> m_codes;
+	std::vector<Run> m_runs;				///< By depth.
+	std::string m_prefix;
+	unsigned m_prefixDepth = unsigned(-1);	///< The depth m_prefix was made for, or -1 if the frames changed since.
+	std::map<std::string, bigint> m_stacks;
+	std::map<std::string, bigint> m_lines;
+	std::map<std::string, bigint> m_frames;
+};
+
+}
+}
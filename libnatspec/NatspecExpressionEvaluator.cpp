@@ -19,6 +19,7 @@
  * @date 2015
  */
 
+#include <memory>
 #include <libdevcore/Log.h>
 #include <libdevcore/Exceptions.h>
 #include "NatspecExpressionEvaluator.h"
@@ -35,23 +36,43 @@ static QString contentsOfQResource(string const& _res)
 	return in.readAll();
 }
 
+QJSEngine& NatspecExpressionEvaluator::engine()
+{
+	// Loading natspec.js takes far longer than any expression; it is done once a thread, not once an evaluation.
+	static thread_local unique_ptr<QJSEngine> s_engine;
+	if (!s_engine)
+	{
+		Q_INIT_RESOURCE(natspec);
+		unique_ptr<QJSEngine> e(new QJSEngine);
+		QJSValue result = e->evaluate(contentsOfQResource(":/natspec/natspec.js"));
+		if (result.isError())
+			BOOST_THROW_EXCEPTION(FileError());
+		e->evaluate("var natspec = require('natspec')");
+		s_engine = move(e);
+	}
+	return *s_engine;
+}
+
 NatspecExpressionEvaluator::NatspecExpressionEvaluator(QString const& _abi, QString const& _transaction, QString const& _method)
-: m_abi(_abi), m_transaction(_transaction), m_method(_method)
 {
-	Q_INIT_RESOURCE(natspec);
-	QJSValue result = m_engine.evaluate(contentsOfQResource(":/natspec/natspec.js"));
-	if (result.isError())
-		BOOST_THROW_EXCEPTION(FileError());
-	
-	m_engine.evaluate("var natspec = require('natspec')");
+	QJSEngine& e = engine();
+	m_evaluate = e.globalObject().property("natspec").property("evaluateExpressionSafe");
+	if (!_abi.isEmpty() && !_transaction.isEmpty() && !_method.isEmpty())
+	{
+		// Parsed as data here, and handed over as an object, rather than pasted into the source of each evaluation.
+		QJSValue parse = e.globalObject().property("JSON").property("parse");
+		m_call = e.newObject();
+		m_call.setProperty("abi", parse.call(QJSValueList() << _abi));
+		m_call.setProperty("transaction", parse.call(QJSValueList() << _transaction));
+		m_call.setProperty("method", _method);
+	}
 }
 
 QString NatspecExpressionEvaluator::evalExpression(QString const& _expression)
 {
-	QString call = "";
-	if (!m_abi.isEmpty() && !m_transaction.isEmpty() && !m_method.isEmpty())
-		call = ", {abi:" + m_abi + ", transaction:" + m_transaction + ", method: '" + m_method + "' }";
-	
-	QJSValue result = m_engine.evaluate("natspec.evaluateExpressionSafe(\"" + _expression + "\"" + call + ")");
-	return result.toString();
+	QJSValueList args;
+	args << _expression;
+	if (!m_call.isUndefined())
+		args << m_call;
+	return m_evaluate.call(args).toString();
 }
@@ -26,6 +26,8 @@
 
 /**
  * Should be used to evaluate natspec expression.
+ * Each thread keeps one engine, with natspec.js loaded into it when first needed, for all the evaluators it makes:
+ * globals an expression sets are seen by later ones on the same thread.
  * @see test/natspec.cpp for natspec expression examples
  */
 class NatspecExpressionEvaluator
@@ -44,8 +46,9 @@ public:
 	QString evalExpression(QString const& _expression);
 	
 private:
-	QJSEngine m_engine;
-	QString m_abi;
-	QString m_transaction;
-	QString m_method;
+	/// @returns this thread's engine, with natspec.js loaded.
+	static QJSEngine& engine();
+
+	QJSValue m_evaluate;	///< natspec.evaluateExpressionSafe, looked up once.
+	QJSValue m_call;		///< The abi, transaction and method, parsed once; undefined if there are none.
 };
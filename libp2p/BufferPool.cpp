@@ -0,0 +1,92 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file BufferPool.cpp
+ * @date 2015
+ */
+
+#include "BufferPool.h"
+using namespace std;
+using namespace dev;
+using namespace dev::p2p;
+
+/// The smallest size class is 2 ^ c_minClassBits bytes.
+static const unsigned c_minClassBits = 10;
+
+/// @returns the size class of a buffer of @a _size bytes.
+static unsigned sizeClass(size_t _size)
+{
+	unsigned ret = 0;
+	while (((size_t)1 << (ret + c_minClassBits)) < _size)
+		++ret;
+	return ret;
+}
+
+BufferPool::Buffer& BufferPool::Buffer::operator=(Buffer&& _b)
+{
+	release();
+	swap(m_pool, _b.m_pool);
+	swap(m_data, _b.m_data);
+	swap(m_size, _b.m_size);
+	return *this;
+}
+
+void BufferPool::Buffer::release()
+{
+	if (!m_pool)
+		return;
+	m_pool->giveBack(move(m_data));
+	m_pool = nullptr;
+	bytes().swap(m_data);
+	m_size = 0;
+}
+
+BufferPool::Buffer BufferPool::borrow(size_t _size, size_t _limit)
+{
+	unsigned c = sizeClass(_size);
+	size_t classSize = (size_t)1 << (c + c_minClassBits);
+	Buffer ret;
+	{
+		Guard l(x_pool);
+		if (m_lent && m_lent + classSize > _limit)
+			return ret;
+		m_lent += classSize;
+		if (c < m_free.size() && !m_free[c].empty())
+		{
+			ret.m_data = move(m_free[c].back());
+			m_free[c].pop_back();
+			m_freeBytes -= classSize;
+		}
+	}
+	if (ret.m_data.empty())
+		ret.m_data.resize(classSize);
+	ret.m_pool = this;
+	ret.m_size = _size;
+	return ret;
+}
+
+void BufferPool::giveBack(bytes&& _data)
+{
+	Guard l(x_pool);
+	m_lent -= _data.size();
+	if (m_freeBytes + _data.size() > m_keptFree)
+		return;
+	unsigned c = sizeClass(_data.size());
+	if (m_free.size() <= c)
+		m_free.resize(c + 1);
+	m_freeBytes += _data.size();
+	m_free[c].push_back(move(_data));
+}
@@ -0,0 +1,87 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file BufferPool.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace p2p
+{
+
+/**
+ * @brief Buffers for reading from the network, lent to sessions a frame at a time.
+ * Buffers come in power-of-two size classes and go back to the pool once done with, which keeps a bounded amount of
+ * free memory for reuse. A borrower may be refused should too much be lent out already, and is then to wait before
+ * reading more, so that many peers sending large frames at once are held back rather than run us out of memory.
+ * @threadsafe
+ */
+class BufferPool
+{
+public:
+	/// A buffer borrowed from the pool, given back when destroyed or released.
+	class Buffer
+	{
+		friend class BufferPool;
+
+	public:
+		Buffer() {}
+		Buffer(Buffer&& _b) { *this = std::move(_b); }
+		Buffer& operator=(Buffer&& _b);
+		~Buffer() { release(); }
+
+		/// @returns false if the pool refused to lend one.
+		explicit operator bool() const { return !!m_pool; }
+		bytesRef ref() { return bytesRef(m_data.data(), m_size); }
+
+		/// Gives the buffer back to the pool.
+		void release();
+
+	private:
+		BufferPool* m_pool = nullptr;
+		bytes m_data;						///< The whole of its size class.
+		size_t m_size = 0;					///< The size asked for.
+	};
+
+	/// Keeps up to @a _keptFree bytes of free buffers for reuse.
+	explicit BufferPool(size_t _keptFree = 32 * 1024 * 1024): m_keptFree(_keptFree) {}
+
+	/// @returns a buffer of @a _size bytes, or, should lending it bring what is lent beyond @a _limit, an empty one.
+	/// A buffer is always lent when none are out, however large.
+	Buffer borrow(size_t _size, size_t _limit = (size_t)-1);
+
+	/// @returns the bytes lent out.
+	size_t lent() const { Guard l(x_pool); return m_lent; }
+
+private:
+	void giveBack(bytes&& _data);
+
+	mutable Mutex x_pool;
+	std::vector<std::vector<bytes>> m_free;	///< Free buffers, by size class.
+	size_t m_freeBytes = 0;
+	size_t m_keptFree;
+	size_t m_lent = 0;
+};
+
+}
+}
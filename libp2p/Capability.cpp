@@ -43,14 +43,19 @@ void Capability::disable(std::string const& _problem)
 	m_enabled = false;
 }
 
+Mutex& Capability::interpretLock() const
+{
+	return m_host->x_interpret;
+}
+
 RLPStream& Capability::prep(RLPStream& _s, unsigned _id, unsigned _args)
 {
 	return _s.appendRaw(bytes(1, _id + m_idOffset)).appendList(_args);
 }
 
-void Capability::sealAndSend(RLPStream& _s)
+void Capability::sealAndSend(RLPStream& _s, Lane _lane)
 {
-	m_session->sealAndSend(_s);
+	m_session->sealAndSend(_s, m_host, _lane);
 }
 
 void Capability::addRating(int _r)
@@ -49,9 +49,14 @@ protected:
 	virtual bool interpret(unsigned _id, RLP const&) = 0;
 
 	void disable(std::string const& _problem);
+	/// @returns false once disable()d, after which the peer's packets are no longer interpreted.
+	bool isEnabled() const { return m_enabled; }
+	/// @returns the lock held while a packet of any of the host capability's peers is interpreted. Work on a packet
+	/// that is finished off elsewhere, after interpret() has returned, takes it to touch what interpret() touches.
+	Mutex& interpretLock() const;
 
 	RLPStream& prep(RLPStream& _s, unsigned _id, unsigned _args = 0);
-	void sealAndSend(RLPStream& _s);
+	void sealAndSend(RLPStream& _s, Lane _lane = Lane::Normal);
 	void addRating(int _r);
 
 private:
@@ -128,6 +128,28 @@ inline bool isPermanentProblem(DisconnectReason _r)
 /// @returns the string form of the given disconnection reason.
 std::string reasonOf(DisconnectReason _r);
 
+/// The compression of packets a peer takes, given as the sixth item of its Hello.
+enum Compression
+{
+	NoCompression = 0,
+	SnappyCompression							///< Packets' payloads may be compressed in Snappy's raw format.
+};
+
+/// The lane a packet is queued to a peer in. Urgent packets go out before any normal ones queued, and are never held
+/// to their capability's egress rate.
+enum class Lane
+{
+	Urgent,
+	Normal
+};
+
+/// Bytes sent to and received from a peer, frame headers and MACs included.
+struct TrafficCount
+{
+	uint64_t ingress = 0;
+	uint64_t egress = 0;
+};
+
 using CapDesc = std::pair<std::string, u256>;
 using CapDescSet = std::set<CapDesc>;
 using CapDescs = std::vector<CapDesc>;
@@ -147,6 +169,8 @@ struct PeerSessionInfo
 	std::set<CapDesc> caps;
 	unsigned socket;
 	std::map<std::string, std::string> notes;
+	TrafficCount traffic;							///< All the session's traffic.
+	std::map<std::string, TrafficCount> capTraffic;	///< The traffic of each capability's packets, by its name.
 };
 
 using PeerSessionInfos = std::vector<PeerSessionInfo>;
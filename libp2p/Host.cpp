@@ -29,6 +29,7 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/Assertions.h>
 #include <libdevcore/CommonIO.h>
+#include <libdevcore/Metrics.h>
 #include <libdevcore/StructuredLogger.h>
 #include <libethcore/Exceptions.h>
 #include <libdevcrypto/FileSystem.h>
@@ -45,9 +46,15 @@ using namespace dev::p2p;
 /// Interval at which Host::run will call keepAlivePeers to ping peers.
 std::chrono::seconds const c_keepAliveInterval = std::chrono::seconds(30);
 
+/// The window over which inbound handshakes from each address are counted against handshakesPerAddress.
+std::chrono::seconds const c_handshakeRateWindow = std::chrono::seconds(10);
+
 /// Disconnect timeout after failure to respond to keepAlivePeers ping.
 std::chrono::milliseconds const c_keepAliveTimeOut = std::chrono::milliseconds(1000);
 
+/// Interval at which peers that have changed are written to the PeerStore.
+std::chrono::seconds const c_peerStoreFlushInterval = std::chrono::seconds(10);
+
 HostNodeTableHandler::HostNodeTableHandler(Host& _host): m_host(_host) {}
 
 void HostNodeTableHandler::processEvent(NodeId const& _n, NodeTableEventType const& _e)
@@ -66,11 +73,14 @@ Host::Host(std::string const& _clientVersion, NetworkPreferences const& _n, byte
 	m_alias(networkAlias(_restoreNetwork)),
 	m_lastPing(chrono::steady_clock::time_point::min())
 {
+	setLockName(x_sessions, "Host::x_sessions");
+	m_peersMetric = Metrics::get().watch("p2p_peers", "Peers connected.", "", [=]() { return peerCount(); });
 	clog(NetNote) << "Id:" << id();
 }
 
 Host::~Host()
 {
+	Metrics::get().unwatch(m_peersMetric);
 	stop();
 }
 
@@ -105,6 +115,10 @@ void Host::stop()
 
 void Host::doneWorking()
 {
+	// UPnP is not interrupted; it gives up on its own within seconds.
+	if (m_determinePublic.joinable())
+		m_determinePublic.join();
+
 	// reset ioservice (allows manually polling network, below)
 	m_ioService.reset();
 
@@ -167,6 +181,17 @@ void Host::doneWorking()
 	// reset network (allows reusing ioservice in future)
 	m_ioService.reset();
 
+	// handshakes are all over, so their crypto is too
+	m_handshakeCryptoWork.reset();
+	for (auto& t: m_handshakeCryptoThreads)
+		t.join();
+	m_handshakeCryptoThreads.clear();
+
+	// what little has changed since the store was last written is written now; the rest is there already
+	flushPeerStore(true);
+	m_peerStore.reset();
+	m_peersToRestore.clear();
+
 	// finally, clear out peers (in case they're lingering)
 	RecursiveGuard l(x_sessions);
 	m_sessions.clear();
@@ -199,12 +224,13 @@ void Host::startPeerSession(Public const& _id, RLP const& _rlp, RLPXFrameIO* _io
 	clog(NetMessageSummary) << "Hello: " << clientVersion << "V[" << protocolVersion << "]" << _id.abridged() << showbase << capslog.str() << dec << listenPort;
 	
 	// create session so disconnects are managed
-	auto ps = make_shared<Session>(this, _io, p, PeerSessionInfo({_id, clientVersion, _endpoint.address().to_string(), listenPort, chrono::steady_clock::duration(), _rlp[2].toSet<CapDesc>(), 0, map<string, string>()}));
+	auto ps = make_shared<Session>(this, _io, p, PeerSessionInfo({_id, clientVersion, _endpoint.address().to_string(), listenPort, chrono::steady_clock::duration(), _rlp[2].toSet<CapDesc>(), 0, map<string, string>(), TrafficCount(), map<string, TrafficCount>()}));
 	if (protocolVersion != dev::p2p::c_protocolVersion)
 	{
 		ps->disconnect(IncompatibleProtocol);
 		return;
 	}
+	ps->m_compress = m_netPrefs.compressThreshold && _rlp.itemCount() > 5 && _rlp[5].toInt<unsigned>() == SnappyCompression;
 	
 	{
 		RecursiveGuard l(x_sessions);
@@ -281,6 +307,8 @@ void Host::onNodeTableEvent(NodeId const& _n, NodeTableEventType const& _e)
 
 		RecursiveGuard l(x_sessions);
 		m_peers.erase(_n);
+		if (m_peerStore)
+			m_peerStore->forget(_n);
 	}
 }
 
@@ -310,24 +338,47 @@ void Host::determinePublic()
 	}
 	else if (m_netPrefs.traverseNAT)
 	{
-		bi::address natIFAddr;
-		ep = Network::traverseNAT(lset && ifAddresses.count(laddr) ? std::set<bi::address>({laddr}) : ifAddresses, m_netPrefs.listenPort, natIFAddr);
-		
-		if (lset && natIFAddr != laddr)
-			// if listen address is set, Host will use it, even if upnp returns different
-			clog(NetWarn) << "Listen address" << laddr << "differs from local address" << natIFAddr << "returned by UPnP!";
-		
-		if (pset && ep.address() != paddr)
+		// Peers are listened for and dialled meanwhile; what UPnP finds is advertised once it is found.
+		auto ifs = lset && ifAddresses.count(laddr) ? std::set<bi::address>({laddr}) : ifAddresses;
+		unsigned short listenPort = m_netPrefs.listenPort;
+		m_determinePublic = thread([=]()
 		{
-			// if public address is set, Host will advertise it, even if upnp returns different
-			clog(NetWarn) << "Specified public address" << paddr << "differs from external address" << ep.address() << "returned by UPnP!";
+			setThreadName("p2p.upnp");
+			bi::address natIFAddr;
+			bi::tcp::endpoint upnpEP = Network::traverseNAT(ifs, listenPort, natIFAddr);
+			
+			if (lset && natIFAddr != laddr)
+				// if listen address is set, Host will use it, even if upnp returns different
+				clog(NetWarn) << "Listen address" << laddr << "differs from local address" << natIFAddr << "returned by UPnP!";
+			
+			if (pset && upnpEP.address() != paddr)
+			{
+				// if public address is set, Host will advertise it, even if upnp returns different
+				clog(NetWarn) << "Specified public address" << paddr << "differs from external address" << upnpEP.address() << "returned by UPnP!";
+				upnpEP.address(paddr);
+			}
+			m_ioService.post([=]() { if (m_run) notePublic(upnpEP); });
+		});
+		if (pset)
 			ep.address(paddr);
-		}
 	}
 	else if (pset)
 		ep.address(paddr);
 
-	m_tcpPublic = ep;
+	notePublic(ep);
+}
+
+void Host::notePublic(bi::tcp::endpoint const& _ep)
+{
+	{
+		Guard l(x_tcpPublic);
+		m_tcpPublic = _ep;
+	}
+	if (_ep.address().is_unspecified())
+		return;
+	clog(NetNote) << "Public endpoint:" << _ep;
+	if (auto nt = m_nodeTable)
+		nt->setAdvertisedEndpoint(_ep);
 }
 
 void Host::runAcceptor()
@@ -336,7 +387,7 @@ void Host::runAcceptor()
 
 	if (m_run && !m_accepting)
 	{
-		clog(NetConnect) << "Listening on local port " << m_listenPort << " (public: " << m_tcpPublic << ")";
+		clog(NetConnect) << "Listening on local port " << m_listenPort << " (public: " << publicEndpoint() << ")";
 		m_accepting = true;
 
 		auto socket = make_shared<RLPXSocket>(new bi::tcp::socket(m_ioService));
@@ -344,13 +395,18 @@ void Host::runAcceptor()
 		{
 			// if no error code
 			bool success = false;
-			if (!ec)
+			if (!ec && !admitHandshake(socket->remoteEndpoint().address()))
+				clog(NetConnect) << "p2p.connect.ingress refused for" << socket->remoteEndpoint() << "(too many handshakes)";
+			else if (!ec)
 			{
 				try
 				{
 					// incoming connection; we don't yet know nodeid
 					auto handshake = make_shared<RLPXHandshake>(this, socket);
-					m_connecting.push_back(handshake);
+					{
+						Guard l(x_connecting);
+						m_connecting.push_back(handshake);
+					}
 					handshake->start();
 					success = true;
 				}
@@ -374,6 +430,27 @@ void Host::runAcceptor()
 	}
 }
 
+bool Host::admitHandshake(bi::address const& _address)
+{
+	{
+		Guard l(x_connecting);
+		unsigned n = 0;
+		for (auto const& i: m_connecting)
+			if (!i.expired() && ++n >= m_netPrefs.maxHandshakes)
+				return false;
+	}
+
+	auto now = chrono::steady_clock::now();
+	Guard l(x_recentHandshakes);
+	auto& recent = m_recentHandshakes[_address];
+	while (!recent.empty() && now - recent.front() > c_handshakeRateWindow)
+		recent.pop_front();
+	if (recent.size() >= m_netPrefs.handshakesPerAddress)
+		return false;
+	recent.push_back(now);
+	return true;
+}
+
 string Host::pocHost()
 {
 	vector<string> strs;
@@ -567,12 +644,26 @@ void Host::run(boost::system::error_code const&)
 			return t->expires_from_now().total_milliseconds() > 0;
 		});
 	}
+	{
+		auto now = chrono::steady_clock::now();
+		Guard l(x_recentHandshakes);
+		for (auto i = m_recentHandshakes.begin(); i != m_recentHandshakes.end();)
+			if (i->second.empty() || now - i->second.back() > c_handshakeRateWindow)
+				i = m_recentHandshakes.erase(i);
+			else
+				++i;
+	}
 	
-	for (auto p: m_sessions)
-		if (auto pp = p.second.lock())
-			pp->serviceNodesRequest();
+	{
+		RecursiveGuard l(x_sessions);
+		for (auto p: m_sessions)
+			if (auto pp = p.second.lock())
+				pp->serviceNodesRequest();
+	}
 
 	keepAlivePeers();
+	restoreSomePeers();
+	flushPeerStore();
 	
 	// At this time peers will be disconnected based on natural TCP timeout.
 	// disconnectLatePeers needs to be updated for the assumption that Session
@@ -618,9 +709,24 @@ void Host::startedWorking()
 		m_run = true;
 	}
 
+	m_handshakeCrypto.reset();
+	m_handshakeCryptoWork.reset(new ba::io_service::work(m_handshakeCrypto));
+	for (unsigned i = 0; i < max(m_netPrefs.handshakeThreads, 1u); ++i)
+		m_handshakeCryptoThreads.push_back(thread([=]()
+		{
+			setThreadName(("p2p.hs" + toString(i)).c_str());
+			m_handshakeCrypto.run();
+		}));
+
+	m_packetLog = m_netPrefs.packetLogPath.empty() ? nullptr : make_shared<PacketLog>(m_netPrefs.packetLogPath);
+
 	// start capability threads (ready for incoming connections)
 	for (auto const& h: m_capabilities)
+	{
+		auto limit = m_netPrefs.egressLimits.find(h.first.first);
+		h.second->m_egress.setRate(limit == m_netPrefs.egressLimits.end() ? 0 : limit->second);
 		h.second->onStarting();
+	}
 	
 	// try to open acceptor (todo: ipv6)
 	m_listenPort = Network::tcp4Listen(m_tcp4Acceptor, m_netPrefs);
@@ -639,8 +745,14 @@ void Host::startedWorking()
 
 	shared_ptr<NodeTable> nodeTable(new NodeTable(m_ioService, m_alias, bi::address::from_string(listenAddress()), listenPort()));
 	nodeTable->setEventHandler(new HostNodeTableHandler(*this));
+	{
+		Guard l(x_tcpPublic);
+		if (!m_tcpPublic.address().is_unspecified())
+			nodeTable->setAdvertisedEndpoint(m_tcpPublic);
+	}
 	m_nodeTable = nodeTable;
 	restoreNetwork(&m_restoreNetwork);
+	openPeerStore();
 
 	clog(NetNote) << "p2p.started id:" << id().abridged();
 
@@ -649,8 +761,19 @@ void Host::startedWorking()
 
 void Host::doWork()
 {
-	if (m_run)
-		m_ioService.run();
+	if (!m_run)
+		return;
+	// Sessions' handlers are run by whichever thread is free, so one slow to interpret a packet holds up no others.
+	vector<thread> threads;
+	for (unsigned i = 1; i < m_netPrefs.ioThreads; ++i)
+		threads.push_back(thread([=]()
+		{
+			setThreadName(("p2p." + toString(i)).c_str());
+			m_ioService.run();
+		}));
+	m_ioService.run();
+	for (auto& t: threads)
+		t.join();
 }
 
 void Host::keepAlivePeers()
@@ -679,8 +802,92 @@ void Host::disconnectLatePeers()
 				pp->disconnect(PingTimeout);
 }
 
+void Host::openPeerStore()
+{
+	m_peersToRestore.clear();
+	m_restoreAllowance = 0;
+	m_peerStore.reset();
+	if (m_netPrefs.peerStorePath.empty())
+		return;
+	m_peerStore.reset(new PeerStore(m_netPrefs.peerStorePath));
+	if (!m_peerStore->isOpen())
+	{
+		m_peerStore.reset();
+		return;
+	}
+	m_lastPeerStoreFlush = chrono::steady_clock::now();
+	if (m_dropPeers)
+		return;
+
+	// Rather than pinging every peer we knew of at once, the best are tried first, and only as fast as
+	// restoreSomePeers() allows, for as long as we want for peers; those required are still tried at once.
+	for (auto const& p: m_peerStore->load())
+		if (p->id == id())
+			continue;
+		else if (p->required)
+		{
+			{
+				RecursiveGuard l(x_sessions);
+				if (!m_peers.count(p->id))
+					m_peers[p->id] = p;
+			}
+			requirePeer(p->id, p->endpoint.udp.address(), p->endpoint.udp.port(), p->endpoint.tcp.address(), p->endpoint.tcp.port());
+		}
+		else
+			m_peersToRestore.push_back(p);
+	clog(NetNote) << "p2p.peerStore.restoring" << m_peersToRestore.size() << "peers";
+}
+
+void Host::restoreSomePeers()
+{
+	if (m_peersToRestore.empty() || peerCount() >= m_idealPeerCount)
+	{
+		m_restoreAllowance = 0;
+		return;
+	}
+	double rate = max(m_netPrefs.restoreRate, 1u);
+	m_restoreAllowance = min(m_restoreAllowance + rate * c_timerInterval / 1000, rate);
+	for (; m_restoreAllowance >= 1 && !m_peersToRestore.empty(); m_peersToRestore.pop_front())
+	{
+		auto p = m_peersToRestore.front();
+		{
+			RecursiveGuard l(x_sessions);
+			if (m_peers.count(p->id))
+				continue;
+			m_peers[p->id] = p;
+		}
+		m_nodeTable->addNode(*p);
+		m_restoreAllowance -= 1;
+	}
+}
+
+void Host::flushPeerStore(bool _force)
+{
+	auto now = chrono::steady_clock::now();
+	if (!m_peerStore || (!_force && now - m_lastPeerStoreFlush < c_peerStoreFlushInterval))
+		return;
+	{
+		RecursiveGuard l(x_sessions);
+		for (auto const& p: m_peers)
+			if (p.second && p.first != id())
+				m_peerStore->note(*p.second);
+	}
+	if (unsigned n = m_peerStore->flush())
+		clog(NetNote) << "p2p.peerStore.flushed" << n << "peers";
+	m_lastPeerStoreFlush = now;
+}
+
 bytes Host::saveNetwork() const
 {
+	if (!m_netPrefs.peerStorePath.empty())
+	{
+		// The PeerStore keeps the peers as they change; there is only our key to save.
+		RLPStream ret(3);
+		ret << dev::p2p::c_protocolVersion << m_alias.secret();
+		ret.appendList(0);
+		return ret.out();
+	}
+
 	std::list<Peer> peers;
 	{
 		RecursiveGuard l(x_sessions);
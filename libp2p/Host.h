@@ -24,6 +24,7 @@
 
 #include <mutex>
 #include <map>
+#include <deque>
 #include <vector>
 #include <set>
 #include <memory>
@@ -36,10 +37,13 @@
 #include <libdevcore/RangeMask.h>
 #include <libdevcrypto/Common.h>
 #include <libdevcrypto/ECDHE.h>
+#include "BufferPool.h"
 #include "NodeTable.h"
 #include "HostCapability.h"
 #include "Network.h"
+#include "PacketLog.h"
 #include "Peer.h"
+#include "PeerStore.h"
 #include "RLPxFrameIO.h"
 #include "Common.h"
 namespace ba = boost::asio;
@@ -126,7 +130,10 @@ public:
 	/// Get the port we're listening on currently.
 	unsigned short listenPort() const { return m_netPrefs.listenPort; }
 
-	/// Serialise the set of known peers.
+	/// Get our public endpoint, as advertised to others; its address is unspecified until it is known.
+	bi::tcp::endpoint publicEndpoint() const { Guard l(x_tcpPublic); return m_tcpPublic; }
+
+	/// Serialise the set of known peers; with a PeerStore, which keeps them itself, only our key.
 	bytes saveNetwork() const;
 
 	// TODO: P2P this should be combined with peers into a HostStat object of some kind; coalesce data, as it's only used for status information.
@@ -161,8 +168,11 @@ protected:
 private:
 	bool havePeerSession(NodeId _id) { RecursiveGuard l(x_sessions); return m_sessions.count(_id) ? !!m_sessions[_id].lock() : false; }
 	
-	/// Determines and sets m_tcpPublic to publicly advertised address.
+	/// Determines and sets m_tcpPublic to publicly advertised address. Should that take UPnP, the address it finds
+	/// is noted later, from m_determinePublic, and until then none is advertised.
 	void determinePublic();
+	/// Notes @a _ep as our public endpoint, advertising it in discovery if its address is known.
+	void notePublic(bi::tcp::endpoint const& _ep);
 
 	void connect(std::shared_ptr<Peer> const& _p);
 
@@ -172,9 +182,20 @@ private:
 	/// Disconnect peers which didn't respond to keepAlivePeers ping prior to c_keepAliveTimeOut.
 	void disconnectLatePeers();
 
+	/// Opens the PeerStore, if there is to be one, and queues its peers to be restored.
+	void openPeerStore();
+	/// Adds as many of the peers queued by openPeerStore() to the node table as the rate allows, if we want for peers.
+	void restoreSomePeers();
+	/// Notes each peer with the PeerStore and writes those that have changed; only so often unless @a _force.
+	void flushPeerStore(bool _force = false);
+
 	/// Called only from startedWorking().
 	void runAcceptor();
 
+	/// @returns true if an inbound handshake with @a _address may begin: there aren't too many under way, nor has it
+	/// dialled us too often lately.
+	bool admitHandshake(bi::address const& _address);
+
 	/// Called by Worker. Not thread-safe; to be called only by worker.
 	virtual void startedWorking();
 	/// Called by startedWorking. Not thread-safe; to be called only be Worker.
@@ -192,7 +213,7 @@ private:
 	bytes m_restoreNetwork;										///< Set by constructor and used to set Host key and restore network peers & nodes.
 
 	bool m_run = false;													///< Whether network is running.
-	std::mutex x_runTimer;												///< Start/stop mutex.
+	Mutex x_runTimer;													///< Start/stop mutex.
 
 	std::string m_clientVersion;											///< Our version string.
 
@@ -203,6 +224,9 @@ private:
 
 	int m_listenPort = -1;												///< What port are we listening on. -1 means binding failed or acceptor hasn't been initialized.
 
+	std::shared_ptr<PacketLog> m_packetLog;								///< Where sessions record their packets, if m_netPrefs.packetLogPath is set.
+
+	BufferPool m_ingressPool;												///< Buffers for frames being read; outlives m_ioService, whose handlers hold sessions.
 	ba::io_service m_ioService;											///< IOService for network stuff.
 	bi::tcp::acceptor m_tcp4Acceptor;										///< Listening acceptor.
 
@@ -212,7 +236,9 @@ private:
 	std::set<Peer*> m_pendingPeerConns;									/// Used only by connect(Peer&) to limit concurrently connecting to same node. See connect(shared_ptr<Peer>const&).
 	Mutex x_pendingNodeConns;
 
+	mutable Mutex x_tcpPublic;
 	bi::tcp::endpoint m_tcpPublic;											///< Our public listening endpoint.
+	std::thread m_determinePublic;											///< Traverses the NAT with UPnP, which can take seconds, while the network starts.
 	KeyPair m_alias;															///< Alias for network communication. Network address is k*G. k is key material. TODO: Replace KeyPair.
 	std::shared_ptr<NodeTable> m_nodeTable;									///< Node table (uses kademlia-like discovery).
 
@@ -227,10 +253,18 @@ private:
 	/// Mutable because we flush zombie entries (null-weakptrs) as regular maintenance from a const method.
 	mutable std::map<NodeId, std::weak_ptr<Session>> m_sessions;
 	mutable RecursiveMutex x_sessions;
+	unsigned m_peersMetric;		///< Our watched gauge of the peer count.
 	
 	std::list<std::weak_ptr<RLPXHandshake>> m_connecting;					///< Pending connections.
 	Mutex x_connecting;													///< Mutex for m_connecting.
 
+	ba::io_service m_handshakeCrypto;										///< Runs handshakes' asymmetric crypto; see RLPXHandshake::offload().
+	std::unique_ptr<ba::io_service::work> m_handshakeCryptoWork;			///< Keeps m_handshakeCrypto running while the network is.
+	std::vector<std::thread> m_handshakeCryptoThreads;
+
+	std::map<bi::address, std::deque<std::chrono::steady_clock::time_point>> m_recentHandshakes;	///< When each address lately began inbound handshakes.
+	Mutex x_recentHandshakes;
+
 	unsigned m_idealPeerCount = 5;										///< Ideal number of peers to be connected to.
 
 	std::map<CapDesc, std::shared_ptr<HostCapabilityFace>> m_capabilities;	///< Each of the capabilities we support.
@@ -239,6 +273,11 @@ private:
 	std::list<std::shared_ptr<boost::asio::deadline_timer>> m_timers;
 	Mutex x_timers;
 
+	std::unique_ptr<PeerStore> m_peerStore;								///< Where peers are kept between runs, if anywhere.
+	std::deque<std::shared_ptr<Peer>> m_peersToRestore;					///< Peers of the store yet to be tried, best first. Only touched by run().
+	double m_restoreAllowance = 0;										///< Peers that may be restored now, built up at m_netPrefs.restoreRate.
+	std::chrono::steady_clock::time_point m_lastPeerStoreFlush;				///< When the PeerStore was last written.
+
 	std::chrono::steady_clock::time_point m_lastPing;						///< Time we sent the last ping to all peers.
 	bool m_accepting = false;
 	bool m_dropPeers = false;
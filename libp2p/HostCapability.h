@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include <libdevcore/Guards.h>
+#include "TokenBucket.h"
 #include "Peer.h"
 #include "Common.h"
 
@@ -59,6 +61,11 @@ protected:
 
 private:
 	Host* m_host = nullptr;
+	/// Held while any peer's packet is interpreted, so that the capability's state shared between peers sees one at a
+	/// time, even with the network running on several threads.
+	Mutex x_interpret;
+	/// Holds the capability's normal packets to all peers together to the rate in the host's egressLimits.
+	TokenBucket m_egress;
 };
 
 template<class PeerCap>
@@ -52,6 +52,17 @@ struct NetworkPreferences
 	std::string listenIPAddress;
 	unsigned short listenPort = 30303;
 	bool traverseNAT = true;
+	size_t sessionIngressLimit = (1 << 24) + 32;		///< The largest frame, padded and with its MAC, a peer may send us before being dropped.
+	size_t ingressLimit = 256 * 1024 * 1024;			///< The most memory lent to all sessions for frames being read; once reached, they wait to read more.
+	unsigned ioThreads = 1;								///< Threads running the network; each session's handlers still run one at a time.
+	unsigned handshakeThreads = 2;						///< Threads doing handshakes' asymmetric crypto, off the network's threads.
+	unsigned maxHandshakes = 128;						///< The most handshakes under way at once; connections beyond are closed once accepted.
+	unsigned handshakesPerAddress = 8;					///< The most inbound handshakes taken from any one address in ten seconds.
+	size_t compressThreshold = 1024;					///< Packets of at least this size are compressed for peers that take it; zero never compresses.
+	std::map<std::string, size_t> egressLimits;		///< Bytes a second each named capability may send to all peers together, but for its urgent packets.
+	std::string packetLogPath;							///< If set, every packet of every session, and when it went, is appended to this file; see PacketLog.
+	std::string peerStorePath;							///< If set, known peers are kept in a PeerStore here as they change, rather than by Host::saveNetwork().
+	unsigned restoreRate = 20;							///< Peers of the PeerStore tried a second, best first, while we want for peers.
 };
 
 /**
@@ -27,9 +27,34 @@ using namespace dev::p2p;
 NodeEntry::NodeEntry(Node _src, Public _pubk, NodeIPEndpoint _gw): Node(_pubk, _gw), distance(NodeTable::distance(_src.id,_pubk)) {}
 NodeEntry::NodeEntry(Node _src, Public _pubk, bi::udp::endpoint _udp): Node(_pubk, NodeIPEndpoint(_udp)), distance(NodeTable::distance(_src.id,_pubk)) {}
 
+unsigned NodeTable::distance(NodeId const& _a, NodeId const& _b)
+{
+	// Byte by byte rather than through u512, which is costly to shift.
+	for (unsigned i = 0; i < NodeId::size; ++i)
+		if (byte d = _a[i] ^ _b[i])
+		{
+			unsigned ret = (NodeId::size - 1 - i) * 8;
+			for (; d >>= 1; ++ret) {}
+			return ret;
+		}
+	return 0;
+}
+
+bool NodeTable::BucketNodes::remove(shared_ptr<NodeEntry> const& _n)
+{
+	for (unsigned i = 0; i < m_size; ++i)
+		if (m_nodes[i].lock() == _n)
+		{
+			erase(i);
+			return true;
+		}
+	return false;
+}
+
 NodeTable::NodeTable(ba::io_service& _io, KeyPair _alias, bi::address const& _udpAddress, uint16_t _udp):
 	m_node(Node(_alias.pub(), bi::udp::endpoint(_udpAddress, _udp))),
 	m_secret(_alias.sec()),
+	m_advertised(_udpAddress, _udp),
 	m_io(_io),
 	m_socket(new NodeSocket(m_io, *this, m_node.endpoint.udp)),
 	m_socketPointer(m_socket.get()),
@@ -81,12 +106,13 @@ shared_ptr<NodeEntry> NodeTable::addNode(Node const& _node)
 	// ping address to recover nodeid if nodeid is empty
 	if (!_node.id)
 	{
-		clog(NodeTableConnect) << "Sending public key discovery Ping to" << _node.endpoint.udp << "(Advertising:" << m_node.endpoint.udp << ")";
+		clog(NodeTableConnect) << "Sending public key discovery Ping to" << _node.endpoint.udp << "(Advertising:" << advertised() << ")";
 		{
 			Guard l(x_pubkDiscoverPings);
 			m_pubkDiscoverPings[_node.endpoint.udp.address()] = std::chrono::steady_clock::now();
 		}
-		PingNode p(_node.endpoint.udp, m_node.endpoint.udp.address().to_string(), m_node.endpoint.udp.port());
+		auto a = advertised();
+		PingNode p(_node.endpoint.udp, a.address().to_string(), a.port());
 		p.sign(m_secret);
 		m_socketPointer->send(p);
 		return move(shared_ptr<NodeEntry>());
@@ -102,7 +128,8 @@ shared_ptr<NodeEntry> NodeTable::addNode(Node const& _node)
 	m_nodes[_node.id] = ret;
 	ret->cullEndpoint();
 	clog(NodeTableConnect) << "addNode pending for" << _node.endpoint.udp << _node.endpoint.tcp;
-	PingNode p(_node.endpoint.udp, m_node.endpoint.udp.address().to_string(), m_node.endpoint.udp.port());
+	auto a = advertised();
+	PingNode p(_node.endpoint.udp, a.address().to_string(), a.port());
 	p.sign(m_secret);
 	m_socketPointer->send(p);
 	return ret;
@@ -131,9 +158,10 @@ list<NodeEntry> NodeTable::snapshot() const
 {
 	list<NodeEntry> ret;
 	Guard l(x_state);
-	for (auto s: m_state)
-		for (auto n: s.nodes)
-			ret.push_back(*n.lock());
+	for (auto const& s: m_state)
+		for (auto const& n: s.nodes)
+			if (auto p = n.lock())
+				ret.push_back(*p);
 	return move(ret);
 }
 
@@ -155,132 +183,96 @@ shared_ptr<NodeEntry> NodeTable::nodeEntry(NodeId _id)
 	return m_nodes.count(_id) ? m_nodes[_id] : shared_ptr<NodeEntry>();
 }
 
-void NodeTable::discover(NodeId _node, unsigned _round, shared_ptr<set<shared_ptr<NodeEntry>>> _tried)
+void NodeTable::discover(NodeId _target)
 {
-	if (!m_socketPointer->isOpen() || _round == s_maxSteps)
-		return;
-	
-	if (_round == s_maxSteps)
+	if (m_lookups >= s_alpha)
 	{
-		clog(NodeTableEvent) << "Terminating discover after " << _round << " rounds.";
+		clog(NodeTableEvent) << "Not discovering; enough lookups under way.";
 		return;
 	}
-	else if(!_round && !_tried)
-		// initialized _tried on first round
-		_tried.reset(new set<shared_ptr<NodeEntry>>());
-	
-	auto nearest = nearestNodeEntries(_node);
-	list<shared_ptr<NodeEntry>> tried;
-	for (unsigned i = 0; i < nearest.size() && tried.size() < s_alpha; i++)
-		if (!_tried->count(nearest[i]))
-		{
-			auto r = nearest[i];
-			tried.push_back(r);
-			FindNode p(r->endpoint.udp, _node);
-			p.sign(m_secret);
-			m_findNodeTimeout.push_back(make_pair(_node, chrono::steady_clock::now()));
-			m_socketPointer->send(p);
-		}
-	
-	if (tried.empty())
+	++m_lookups;
+	discover(make_shared<Lookup>(m_io, _target), 0);
+}
+
+void NodeTable::discover(shared_ptr<Lookup> const& _lookup, unsigned _round)
+{
+	if (!m_socketPointer->isOpen() || _round == s_maxSteps)
 	{
 		clog(NodeTableEvent) << "Terminating discover after " << _round << " rounds.";
+		--m_lookups;
 		return;
 	}
-		
-	while (!tried.empty())
+
+	auto nearest = nearestNodeEntries(_lookup->target);
+	unsigned tried = 0;
 	{
-		_tried->insert(tried.front());
-		tried.pop_front();
+		auto now = chrono::steady_clock::now();
+		Guard l(x_findNodeTimeout);
+		m_findNodeTimeout.remove_if([&](NodeIdTimePoint const& t) { return now - t.second >= c_reqTimeout; });
+		for (unsigned i = 0; i < nearest.size() && tried < s_alpha; i++)
+			if (_lookup->tried.insert(nearest[i]->id).second)
+			{
+				auto r = nearest[i];
+				FindNode p(r->endpoint.udp, _lookup->target);
+				p.sign(m_secret);
+				m_findNodeTimeout.push_back(make_pair(r->id, now));
+				m_socketPointer->send(p);
+				++tried;
+			}
 	}
-	
+
+	if (!tried)
+	{
+		clog(NodeTableEvent) << "Terminating discover after " << _round << " rounds.";
+		--m_lookups;
+		return;
+	}
+
 	auto self(shared_from_this());
-	m_evictionCheckTimer.expires_from_now(boost::posix_time::milliseconds(c_reqTimeout.count() * 2));
-	m_evictionCheckTimer.async_wait([this, self, _node, _round, _tried](boost::system::error_code const& _ec)
+	_lookup->timer.expires_from_now(boost::posix_time::milliseconds(c_reqTimeout.count() * 2));
+	_lookup->timer.async_wait([this, self, _lookup, _round](boost::system::error_code const& _ec)
 	{
 		if (_ec)
-			return;
-		discover(_node, _round + 1, _tried);
+			--m_lookups;
+		else
+			discover(_lookup, _round + 1);
 	});
 }
 
 vector<shared_ptr<NodeEntry>> NodeTable::nearestNodeEntries(NodeId _target)
 {
-	// send s_alpha FindNode packets to nodes we know, closest to target
-	static unsigned lastBin = s_bins - 1;
+	// Nodes in our bucket for the target's distance from us, and in those nearer us, are all nearer the target than that
+	// distance; those in further buckets are as far from it as from us. So nearer buckets are taken whole, then further
+	// ones in order until there are enough, and only those taken are ordered, by their exact distance from the target.
 	unsigned head = distance(m_node.id, _target);
-	unsigned tail = head == 0 ? lastBin : (head - 1) % s_bins;
-	
-	map<unsigned, list<shared_ptr<NodeEntry>>> found;
-	unsigned count = 0;
-	
-	// if d is 0, then we roll look forward, if last, we reverse, else, spread from d
-	if (head > 1 && tail != lastBin)
-		while (head != tail && head < s_bins && count < s_bucketSize)
+	vector<pair<NodeId, shared_ptr<NodeEntry>>> found;
+	{
+		Guard l(x_state);
+		auto take = [&](NodeBucket const& _b)
 		{
-			Guard l(x_state);
-			for (auto n: m_state[head].nodes)
+			for (auto const& n: _b.nodes)
 				if (auto p = n.lock())
-				{
-					if (count < s_bucketSize)
-						found[distance(_target, p->id)].push_back(p);
-					else
-						break;
-				}
-			
-			if (count < s_bucketSize && tail)
-				for (auto n: m_state[tail].nodes)
-					if (auto p = n.lock())
-					{
-						if (count < s_bucketSize)
-							found[distance(_target, p->id)].push_back(p);
-						else
-							break;
-					}
+					found.push_back(make_pair(p->id ^ _target, p));
+		};
+		for (unsigned i = 0; i < head && i < s_bins; ++i)
+			take(m_state[i]);
+		for (unsigned i = head; i < s_bins && found.size() < s_bucketSize; ++i)
+			take(m_state[i]);
+	}
 
-			head++;
-			if (tail)
-				tail--;
-		}
-	else if (head < 2)
-		while (head < s_bins && count < s_bucketSize)
-		{
-			Guard l(x_state);
-			for (auto n: m_state[head].nodes)
-				if (auto p = n.lock())
-				{
-					if (count < s_bucketSize)
-						found[distance(_target, p->id)].push_back(p);
-					else
-						break;
-				}
-			head++;
-		}
-	else
-		while (tail > 0 && count < s_bucketSize)
-		{
-			Guard l(x_state);
-			for (auto n: m_state[tail].nodes)
-				if (auto p = n.lock())
-				{
-					if (count < s_bucketSize)
-						found[distance(_target, p->id)].push_back(p);
-					else
-						break;
-				}
-			tail--;
-		}
-	
+	auto n = min<size_t>(found.size(), s_bucketSize);
+	partial_sort(found.begin(), found.begin() + n, found.end(), [](pair<NodeId, shared_ptr<NodeEntry>> const& _a, pair<NodeId, shared_ptr<NodeEntry>> const& _b) { return _a.first < _b.first; });
 	vector<shared_ptr<NodeEntry>> ret;
-	for (auto& nodes: found)
-		for (auto n: nodes.second)
-			ret.push_back(n);
+	ret.reserve(n);
+	for (unsigned i = 0; i < n; ++i)
+		ret.push_back(found[i].second);
 	return move(ret);
 }
 
 void NodeTable::ping(bi::udp::endpoint _to) const
 {
-	PingNode p(_to, m_node.endpoint.udp.address().to_string(), m_node.endpoint.udp.port());
+	auto a = advertised();
+	PingNode p(_to, a.address().to_string(), a.port());
 	p.sign(m_secret);
 	m_socketPointer->send(p);
 }
@@ -322,18 +314,12 @@ void NodeTable::noteActiveNode(Public const& _pubk, bi::udp::endpoint const& _en
 		{
 			Guard l(x_state);
 			NodeBucket& s = bucket_UNSAFE(node.get());
-			bool removed = false;
-			s.nodes.remove_if([&node, &removed](weak_ptr<NodeEntry> const& n)
-			{
-				if (n.lock() == node)
-					removed = true;
-				return removed;
-			});
+			bool removed = s.nodes.remove(node);
 			
 			if (s.nodes.size() >= s_bucketSize)
 			{
 				// It's only contested iff nodeentry exists
-				contested = s.nodes.front().lock();
+				contested = s.nodes.front();
 				if (!contested)
 				{
 					s.nodes.pop_front();
@@ -365,7 +351,12 @@ void NodeTable::dropNode(shared_ptr<NodeEntry> _n)
 	{
 		Guard l(x_state);
 		NodeBucket& s = bucket_UNSAFE(_n.get());
-		s.nodes.remove_if([&_n](weak_ptr<NodeEntry> n) { return n.lock() == _n; });
+		s.nodes.remove(_n);
+	}
+	{
+		// otherwise every node ever heard of would be kept
+		Guard l(x_nodes);
+		m_nodes.erase(_n->id);
 	}
 	
 	// notify host
@@ -419,35 +410,41 @@ void NodeTable::onReceived(UDPSocketFace*, bi::udp::endpoint const& _from, bytes
 				Pong in = Pong::fromBytesConstRef(_from, rlpBytes);
 				
 				// whenever a pong is received, check if it's in m_evictions
-				Guard le(x_evictions);
-				bool evictionEntry = false;
-				for (auto it = m_evictions.begin(); it != m_evictions.end(); it++)
-					if (it->first.first == nodeid && it->first.second > std::chrono::steady_clock::now())
-					{
-						evictionEntry = true;
-						if (auto n = nodeEntry(it->second))
-							dropNode(n);
-						
-						if (auto n = nodeEntry(it->first.first))
-							n->pending = false;
-						
-						it = m_evictions.erase(it);
-					}
+				// (nodes are looked up and dropped once x_evictions is released, as x_nodes is to be locked first)
+				list<NodeId> evicted;
+				{
+					Guard le(x_evictions);
+					for (auto it = m_evictions.begin(); it != m_evictions.end();)
+						if (it->first.first == nodeid && it->first.second > std::chrono::steady_clock::now())
+						{
+							evicted.push_back(it->second);
+							it = m_evictions.erase(it);
+						}
+						else
+							++it;
+				}
+				bool evictionEntry = !evicted.empty();
+				for (auto const& id: evicted)
+					if (auto n = nodeEntry(id))
+						dropNode(n);
+				if (evictionEntry)
+					if (auto n = nodeEntry(nodeid))
+						n->pending = false;
 				
 				// if not, check if it's known/pending or a pubk discovery ping
 				if (!evictionEntry)
 				{
-					if (auto n = nodeEntry(nodeid))
-						n->pending = false;
-					else if (m_pubkDiscoverPings.count(_from.address()))
+					bool discoverPing = false;
+					auto n = nodeEntry(nodeid);
+					if (!n)
 					{
-						{
-							Guard l(x_pubkDiscoverPings);
-							m_pubkDiscoverPings.erase(_from.address());
-						}
-						if (!haveNode(nodeid))
-							addNode(nodeid, _from, bi::tcp::endpoint(_from.address(), _from.port()));
+						Guard l(x_pubkDiscoverPings);
+						discoverPing = m_pubkDiscoverPings.erase(_from.address());
 					}
+					if (n)
+						n->pending = false;
+					else if (discoverPing)
+						addNode(nodeid, _from, bi::tcp::endpoint(_from.address(), _from.port()));
 					else
 						return; // unsolicited pong; don't note node as active
 				}
@@ -459,12 +456,15 @@ void NodeTable::onReceived(UDPSocketFace*, bi::udp::endpoint const& _from, bytes
 			case Neighbours::type:
 			{
 				bool expected = false;
-				m_findNodeTimeout.remove_if([&](NodeIdTimePoint const& t)
 				{
-					if (t.first == nodeid && chrono::steady_clock::now() - t.second < c_reqTimeout)
-						expected = true;
-					return t.first == nodeid;
-				});
+					Guard l(x_findNodeTimeout);
+					m_findNodeTimeout.remove_if([&](NodeIdTimePoint const& t)
+					{
+						if (t.first == nodeid && chrono::steady_clock::now() - t.second < c_reqTimeout)
+							expected = true;
+						return t.first == nodeid;
+					});
+				}
 				
 				if (!expected)
 				{
@@ -566,6 +566,16 @@ void NodeTable::doRefreshBuckets(boost::system::error_code const& _ec)
 		return;
 
 	clog(NodeTableEvent) << "refreshing buckets";
+	{
+		// discovery pings which were never answered
+		auto now = chrono::steady_clock::now();
+		Guard l(x_pubkDiscoverPings);
+		for (auto i = m_pubkDiscoverPings.begin(); i != m_pubkDiscoverPings.end();)
+			if (now - i->second > c_reqTimeout)
+				i = m_pubkDiscoverPings.erase(i);
+			else
+				++i;
+	}
 	bool connected = m_socketPointer->isOpen();
 	if (connected)
 	{
@@ -22,7 +22,10 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <deque>
+#include <set>
 
 #include <boost/integer/static_log2.hpp>
 
@@ -140,8 +143,8 @@ public:
 	NodeTable(ba::io_service& _io, KeyPair _alias, bi::address const& _udpAddress, uint16_t _udpPort = 30303);
 	~NodeTable();
 
-	/// Returns distance based on xor metric two node ids. Used by NodeEntry and NodeTable.
-	static unsigned distance(NodeId const& _a, NodeId const& _b) { u512 d = _a ^ _b; unsigned ret; for (ret = 0; d >>= 1; ++ret) {}; return ret; }
+	/// Returns distance based on xor metric two node ids: the index of the highest bit in which they differ. Used by NodeEntry and NodeTable.
+	static unsigned distance(NodeId const& _a, NodeId const& _b);
 
 	/// Set event handler for NodeEntryAdded and NodeEntryDropped events.
 	void setEventHandler(NodeTableEventHandler* _handler) { m_nodeEventHandler.reset(_handler); }
@@ -173,6 +176,11 @@ public:
 	/// Returns the Node to the corresponding node id or the empty Node if that id is not found.
 	Node node(NodeId const& _id);
 
+	/// Advertises @a _ep, in the pings we send, as where to connect to us; until then, our UDP address and port are.
+	void setAdvertisedEndpoint(bi::tcp::endpoint const& _ep) { Guard l(x_advertised); m_advertised = _ep; }
+	/// @returns where we advertise to connect to us.
+	bi::tcp::endpoint advertised() const { Guard l(x_advertised); return m_advertised; }
+
 #if defined(BOOST_AUTO_TEST_SUITE) || defined(_MSC_VER) // MSVC includes access specifier in symbol name
 protected:
 #else
@@ -189,7 +197,7 @@ private:
 	/// Chosen constants
 
 	static unsigned const s_bucketSize = 16;			///< Denoted by k in [Kademlia]. Number of nodes stored in each bucket.
-	static unsigned const s_alpha = 3;				///< Denoted by \alpha in [Kademlia]. Number of concurrent FindNode requests.
+	static unsigned const s_alpha = 3;				///< Denoted by \alpha in [Kademlia]. Number of concurrent FindNode requests, and of concurrent lookups.
 
 	/// Intervals
 
@@ -198,11 +206,34 @@ private:
 	std::chrono::milliseconds const c_reqTimeout = std::chrono::milliseconds(300);						///< How long to wait for requests (evict, find iterations).
 	std::chrono::milliseconds const c_bucketRefresh = std::chrono::milliseconds(57600);							///< Refresh interval prevents bucket from becoming stale. [Kademlia]
 
+	/// Up to s_bucketSize nodes, least recently seen first, held in place rather than in a list.
+	class BucketNodes
+	{
+	public:
+		using const_iterator = std::weak_ptr<NodeEntry> const*;
+		const_iterator begin() const { return m_nodes.data(); }
+		const_iterator end() const { return m_nodes.data() + m_size; }
+		unsigned size() const { return m_size; }
+		std::shared_ptr<NodeEntry> front() const { return m_size ? m_nodes[0].lock() : nullptr; }
+
+		void push_back(std::shared_ptr<NodeEntry> const& _n) { assert(m_size < s_bucketSize); m_nodes[m_size++] = _n; }
+		void pop_front() { if (m_size) erase(0); }
+		/// @returns true if @a _n was there to remove.
+		bool remove(std::shared_ptr<NodeEntry> const& _n);
+		void clear() { while (m_size) m_nodes[--m_size].reset(); }
+
+	private:
+		void erase(unsigned _i) { std::move(m_nodes.begin() + _i + 1, m_nodes.begin() + m_size, m_nodes.begin() + _i); m_nodes[--m_size].reset(); }
+
+		std::array<std::weak_ptr<NodeEntry>, s_bucketSize> m_nodes;
+		unsigned m_size = 0;
+	};
+
 	struct NodeBucket
 	{
 		unsigned distance;
 		TimePoint modified;
-		std::list<std::weak_ptr<NodeEntry>> nodes;
+		BucketNodes nodes;
 		void touch() { modified = std::chrono::steady_clock::now(); }
 	};
 
@@ -218,11 +249,22 @@ private:
 	/// Used by asynchronous operations to return NodeEntry which is active and managed by node table.
 	std::shared_ptr<NodeEntry> nodeEntry(NodeId _id);
 
+	/// The state of a lookup under way; see discover().
+	struct Lookup
+	{
+		Lookup(ba::io_service& _io, NodeId const& _target): target(_target), timer(_io) {}
+		NodeId target;
+		std::set<NodeId> tried;								///< Nodes already asked.
+		boost::asio::deadline_timer timer;					///< Schedules the next round.
+	};
+
 	/// Used to discovery nodes on network which are close to the given target.
 	/// Sends s_alpha concurrent requests to nodes nearest to target, for nodes nearest to target, up to s_maxSteps rounds.
-	void discover(NodeId _target, unsigned _round = 0, std::shared_ptr<std::set<std::shared_ptr<NodeEntry>>> _tried = std::shared_ptr<std::set<std::shared_ptr<NodeEntry>>>());
+	/// Up to s_alpha lookups run at once, each with its own timer; beyond that, a new one is not begun.
+	void discover(NodeId _target);
+	void discover(std::shared_ptr<Lookup> const& _lookup, unsigned _round);
 
-	/// Returns nodes from node table which are closest to target.
+	/// Returns the s_bucketSize nodes from node table which are closest to target, closest first.
 	std::vector<std::shared_ptr<NodeEntry>> nearestNodeEntries(NodeId _target);
 
 	/// Asynchronously drops _leastSeen node if it doesn't reply and adds _new node, otherwise _new node is thrown away.
@@ -260,6 +302,9 @@ private:
 	Node m_node;												///< This node.
 	Secret m_secret;											///< This nodes secret key.
 
+	mutable Mutex x_advertised;
+	bi::tcp::endpoint m_advertised;							///< Where we tell others to connect to us; set once our public endpoint is known.
+
 	mutable Mutex x_nodes;									///< LOCK x_state first if both locks are required. Mutable for thread-safe copy in nodes() const.
 	std::map<NodeId, std::shared_ptr<NodeEntry>> m_nodes;		///< Nodes
 
@@ -274,6 +319,8 @@ private:
 
 	Mutex x_findNodeTimeout;
 	std::list<NodeIdTimePoint> m_findNodeTimeout;				///< Timeouts for pending Ping and FindNode requests.
+
+	std::atomic<unsigned> m_lookups{0};						///< Lookups under way.
 	
 	ba::io_service& m_io;										///< Used by bucket refresh timer.
 	std::shared_ptr<NodeSocket> m_socket;						///< Shared pointer for our UDPSocket; ASIO requires shared_ptr.
@@ -0,0 +1,74 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file PacketLog.cpp
+ * @date 2015
+ */
+
+#include "PacketLog.h"
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/RLP.h>
+using namespace std;
+using namespace dev;
+using namespace dev::p2p;
+
+PacketLog::PacketLog(string const& _path):
+	m_file(_path, ios::binary | ios::app)
+{
+	if (!m_file)
+		cwarn << "Couldn't open packet log" << _path;
+}
+
+void PacketLog::record(NodeId const& _node, bool _outgoing, string const& _capability, unsigned _type, bytesConstRef _payload)
+{
+	auto at = chrono::duration_cast<chrono::microseconds>(chrono::system_clock::now().time_since_epoch()).count();
+	RLPStream s(6);
+	s << (u256)at << _node << (unsigned)_outgoing << _capability << _type;
+	s.appendRaw(_payload);
+	bytes const& out = s.out();
+
+	Guard l(x_file);
+	m_file.write((char const*)out.data(), out.size());
+	m_file.flush();
+}
+
+vector<LoggedPacket> PacketLog::read(string const& _path)
+{
+	vector<LoggedPacket> ret;
+	bytes file = contents(_path);
+	for (bytesConstRef d(&file); !d.empty();)
+		try
+		{
+			RLP r(d, RLP::ThrowOnFail | RLP::FailIfTooSmall);
+			if (r.actualSize() > d.size())
+				BOOST_THROW_EXCEPTION(BadRLP());
+			d = d.cropped(r.actualSize());
+			LoggedPacket p;
+			p.at = chrono::microseconds(r[0].toInt<uint64_t>());
+			p.node = r[1].toHash<NodeId>();
+			p.outgoing = !!r[2].toInt<unsigned>();
+			p.capability = r[3].toString();
+			p.type = r[4].toInt<unsigned>();
+			p.payload = r[5].data().toBytes();
+			ret.push_back(move(p));
+		}
+		catch (RLPException const&)
+		{
+			cwarn << "Packet log" << _path << "ends in a partial record; ignoring it.";
+			break;
+		}
+	return ret;
+}
@@ -0,0 +1,72 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file PacketLog.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <libdevcore/Common.h>
+#include <libdevcore/Guards.h>
+#include "Common.h"
+
+namespace dev
+{
+namespace p2p
+{
+
+/// A packet, as a PacketLog records it.
+struct LoggedPacket
+{
+	std::chrono::microseconds at;	///< Since the epoch of the system clock.
+	NodeId node;					///< The peer it came from or went to.
+	bool outgoing = false;
+	std::string capability;			///< The name of the capability whose packet it is; empty for the session's own.
+	unsigned type = 0;				///< Its type within its capability.
+	bytes payload;					///< Its RLP, without the type.
+};
+
+/**
+ * @brief Records the packets of a host's sessions, both ways and with when they went, to a file, so that the traffic
+ * of a real sync may be studied or replayed later (see bench_sync).
+ *
+ * Each record is an RLP list of [microseconds, node, outgoing, capability, type, payload], appended one after another.
+ * @threadsafe
+ */
+class PacketLog
+{
+public:
+	/// Appends to the file at @a _path, creating it if need be.
+	explicit PacketLog(std::string const& _path);
+
+	void record(NodeId const& _node, bool _outgoing, std::string const& _capability, unsigned _type, bytesConstRef _payload);
+
+	/// @returns the packets in the log at @a _path, in the order they were recorded. A log cut short, as by a crash,
+	/// reads up to its last whole record.
+	static std::vector<LoggedPacket> read(std::string const& _path);
+
+private:
+	Mutex x_file;
+	std::ofstream m_file;
+};
+
+}
+}
@@ -53,6 +53,7 @@ class Peer: public Node
 {
 	friend class Session;		/// Allows Session to update score and rating.
 	friend class Host;		/// For Host: saveNetwork(), restoreNetwork()
+	friend class PeerStore;	/// For PeerStore: reading and writing the record of a peer.
 
 	friend class RLPXHandshake;
 
@@ -0,0 +1,182 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file PeerStore.cpp
+ * @date 2015
+ */
+
+#include "PeerStore.h"
+
+#include <algorithm>
+#include <libdevcore/Log.h>
+#include <libdevcore/RLP.h>
+#include <libdevcrypto/SHA3.h>
+using namespace std;
+using namespace dev;
+using namespace dev::p2p;
+
+/// The most peers loaded; the worst of any more are dropped.
+static const size_t c_maxStoredPeers = 1024;
+/// How long since last connected a peer that has failed since is kept.
+static const chrono::hours c_peerExpiry = chrono::hours(24 * 7);
+
+PeerStore::PeerStore(string const& _path):
+	m_db(KeyValueDB::open(_path))
+{
+	if (!m_db)
+		cwarn << "Couldn't open the peer store at" << _path << "; peers will not be kept.";
+}
+
+bool PeerStore::betterToRestore(Peer const& _a, Peer const& _b)
+{
+	if (_a.required != _b.required)
+		return _a.required;
+	if (_a.m_lastConnected != _b.m_lastConnected)
+		return _a.m_lastConnected > _b.m_lastConnected;
+	if (_a.m_failedAttempts != _b.m_failedAttempts)
+		return _a.m_failedAttempts < _b.m_failedAttempts;
+	if (_a.m_score != _b.m_score)
+		return _a.m_score > _b.m_score;
+	return _a.id < _b.id;
+}
+
+bytes PeerStore::encode(Peer const& _p)
+{
+	auto const& a = _p.endpoint.tcp.address();
+	RLPStream s(10);
+	if (a.is_v4())
+		s << a.to_v4().to_bytes();
+	else
+		s << a.to_v6().to_bytes();
+	s << _p.endpoint.udp.port() << _p.endpoint.tcp.port() << _p.required
+		<< chrono::duration_cast<chrono::seconds>(_p.m_lastConnected.time_since_epoch()).count()
+		<< chrono::duration_cast<chrono::seconds>(_p.m_lastAttempted.time_since_epoch()).count()
+		<< _p.m_failedAttempts << (unsigned)_p.m_lastDisconnect << (unsigned)_p.m_score << (unsigned)_p.m_rating;
+	return s.out();
+}
+
+shared_ptr<Peer> PeerStore::decode(NodeId const& _id, bytesConstRef _r)
+{
+	RLP r(_r);
+	if (!r.isList() || r.itemCount() != 10)
+		return nullptr;
+	bi::address a;
+	if (r[0].size() == 4)
+		a = bi::address_v4(r[0].toArray<byte, 4>());
+	else if (r[0].size() == 16)
+		a = bi::address_v6(r[0].toArray<byte, 16>());
+	else
+		return nullptr;
+	auto p = make_shared<Peer>();
+	p->id = _id;
+	p->endpoint = NodeIPEndpoint(bi::udp::endpoint(a, r[1].toInt<unsigned short>()), bi::tcp::endpoint(a, r[2].toInt<unsigned short>()));
+	p->required = r[3].toInt<bool>();
+	p->m_lastConnected = chrono::system_clock::time_point(chrono::seconds(r[4].toInt<uint64_t>()));
+	p->m_lastAttempted = chrono::system_clock::time_point(chrono::seconds(r[5].toInt<uint64_t>()));
+	p->m_failedAttempts = r[6].toInt<unsigned>();
+	p->m_lastDisconnect = (DisconnectReason)r[7].toInt<unsigned>();
+	p->m_score = (int)r[8].toInt<unsigned>();
+	p->m_rating = (int)r[9].toInt<unsigned>();
+	return p;
+}
+
+vector<shared_ptr<Peer>> PeerStore::load()
+{
+	vector<shared_ptr<Peer>> ret;
+	if (!m_db)
+		return ret;
+	auto now = chrono::system_clock::now();
+	Guard l(x_store);
+	m_db->forEach([&](bytesConstRef _key, bytesConstRef _value)
+	{
+		if (_key.size() != NodeId::size)
+			return true;
+		NodeId id(_key);
+		shared_ptr<Peer> p;
+		try
+		{
+			p = decode(id, _value);
+		}
+		catch (...) {}
+		if (p && (p->required || !p->m_failedAttempts || now - p->m_lastConnected < c_peerExpiry))
+		{
+			m_written[id] = sha3(_value);
+			ret.push_back(p);
+		}
+		else
+			m_dirty[id] = bytes();
+		return true;
+	});
+	sort(ret.begin(), ret.end(), [](shared_ptr<Peer> const& _a, shared_ptr<Peer> const& _b) { return betterToRestore(*_a, *_b); });
+	for (size_t i = c_maxStoredPeers; i < ret.size(); ++i)
+		m_dirty[ret[i]->id] = bytes();
+	if (ret.size() > c_maxStoredPeers)
+		ret.resize(c_maxStoredPeers);
+	return ret;
+}
+
+bool PeerStore::note(Peer const& _p)
+{
+	// As Host::saveNetwork(), only those we could reach again from anywhere.
+	auto const& tcp = _p.endpoint.tcp;
+	if (!tcp.address().is_v4() || !tcp.port() || tcp.port() >= /*49152*/32768 || isPrivateAddress(tcp.address()) || isPrivateAddress(_p.endpoint.udp.address()))
+	{
+		forget(_p.id);
+		return false;
+	}
+	bytes r = encode(_p);
+	h256 h = sha3(r);
+	Guard l(x_store);
+	auto w = m_written.find(_p.id);
+	if (w != m_written.end() && w->second == h)
+		m_dirty.erase(_p.id);
+	else
+		m_dirty[_p.id] = move(r);
+	return true;
+}
+
+void PeerStore::forget(NodeId const& _id)
+{
+	Guard l(x_store);
+	if (m_written.count(_id))
+		m_dirty[_id] = bytes();
+	else
+		m_dirty.erase(_id);
+}
+
+unsigned PeerStore::flush()
+{
+	map<NodeId, bytes> dirty;
+	{
+		Guard l(x_store);
+		if (!m_db || m_dirty.empty())
+			return 0;
+		swap(dirty, m_dirty);
+		for (auto const& i: dirty)
+			if (i.second.empty())
+				m_written.erase(i.first);
+			else
+				m_written[i.first] = sha3(i.second);
+	}
+	auto batch = m_db->batch();
+	for (auto const& i: dirty)
+		if (i.second.empty())
+			batch->kill(i.first.ref());
+		else
+			batch->insert(i.first.ref(), &i.second);
+	m_db->write(*batch);
+	return dirty.size();
+}
@@ -0,0 +1,79 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file PeerStore.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <libdevcore/Guards.h>
+#include <libdevcrypto/KeyValueDB.h>
+#include "Peer.h"
+
+namespace dev
+{
+namespace p2p
+{
+
+/**
+ * @brief The peers known to a Host, kept in a DB between runs in place of Host::saveNetwork()'s single blob.
+ * Each peer is a record of its own, keyed by its id, written only when it has changed since it last was; so
+ * keeping it up to date costs in proportion to the peers that change, and there is nothing left to write at
+ * shutdown but those lately changed.
+ * @threadsafe
+ */
+class PeerStore
+{
+public:
+	/// Opens the store at @a _path, creating it if need be.
+	explicit PeerStore(std::string const& _path);
+
+	bool isOpen() const { return !!m_db; }
+
+	/// @returns the peers stored, best first: those connected to most lately, then those failed least. Those not
+	/// connected to for long that have failed since are dropped, from the store too.
+	std::vector<std::shared_ptr<Peer>> load();
+
+	/// Notes @a _p as it now is, to be written by flush() if it differs from what was. @returns false if it is not
+	/// worth keeping, as for a private address, and forgets any record of it.
+	bool note(Peer const& _p);
+	/// Forgets the peer @a _id by the next flush().
+	void forget(NodeId const& _id);
+
+	/// Writes what has changed since the last flush, together. @returns the records written or removed.
+	unsigned flush();
+
+	/// @returns whether @a _a is better worth restoring than @a _b.
+	static bool betterToRestore(Peer const& _a, Peer const& _b);
+
+private:
+	static bytes encode(Peer const& _p);
+	static std::shared_ptr<Peer> decode(NodeId const& _id, bytesConstRef _r);
+
+	std::shared_ptr<KeyValueDB> m_db;
+
+	std::map<NodeId, h256> m_written;				///< The hash of each record as it was last written.
+	std::map<NodeId, bytes> m_dirty;				///< Records to be written by flush(); empty for those to remove.
+	mutable Mutex x_store;
+};
+
+}
+}
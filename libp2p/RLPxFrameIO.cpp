@@ -20,6 +20,7 @@
  */
 
 #include "RLPxFrameIO.h"
+#include <cryptopp/cpu.h>
 #include <libdevcore/Assertions.h>
 #include "Host.h"
 #include "Session.h"
@@ -31,6 +32,9 @@ using namespace dev;
 using namespace dev::p2p;
 using namespace CryptoPP;
 
+/// Bytes coded and hashed at a time by encryptAndMAC and macAndDecrypt; small enough to stay in L1.
+static const size_t c_codingChunk = 16 * 1024;
+
 RLPXFrameIO::RLPXFrameIO(RLPXHandshake const& _init): m_socket(_init.m_socket)
 {
 	// we need:
@@ -96,34 +100,35 @@ RLPXFrameIO::RLPXFrameIO(RLPXHandshake const& _init): m_socket(_init.m_socket)
 
 void RLPXFrameIO::writeSingleFramePacket(bytesConstRef _packet, bytes& o_bytes)
 {
-	// _packet = type || rlpList()
+	bytes body = _packet.toBytes();
+	h256 header;
+	h128 mac;
+	writeFrame(body, header, mac);
+	o_bytes = header.asBytes() + body + mac.asBytes();
+}
+
+void RLPXFrameIO::writeFrame(bytes& io_packet, h256& o_header, h128& o_mac)
+{
+	// io_packet = type || rlpList()
 
 	RLPStream header;
-	uint32_t len = (uint32_t)_packet.size();
+	uint32_t len = (uint32_t)io_packet.size();
 	header.appendRaw(bytes({byte((len >> 16) & 0xff), byte((len >> 8) & 0xff), byte(len & 0xff)}));
 	// zeroHeader: []byte{0xC2, 0x80, 0x80}. Should be rlpList(protocolType,seqId,totalPacketSize).
 	header.appendRaw(bytes({0xc2,0x80,0x80}));
 	
 	// TODO: SECURITY check that header is <= 16 bytes
 
-	bytes headerWithMac(h256::size);
-	bytesConstRef(&header.out()).copyTo(bytesRef(&headerWithMac));
-	m_frameEnc.ProcessData(headerWithMac.data(), headerWithMac.data(), 16);
-	updateEgressMACWithHeader(bytesConstRef(&headerWithMac).cropped(0, 16));
-	egressDigest().ref().copyTo(bytesRef(&headerWithMac).cropped(h128::size,h128::size));
-
-	auto padding = (16 - (_packet.size() % 16)) % 16;
-	o_bytes.swap(headerWithMac);
-	o_bytes.resize(32 + _packet.size() + padding + h128::size);
-	bytesRef packetRef(o_bytes.data() + 32, _packet.size());
-	m_frameEnc.ProcessData(packetRef.data(), _packet.data(), _packet.size());
-	bytesRef paddingRef(o_bytes.data() + 32 + _packet.size(), padding);
-	if (padding)
-		m_frameEnc.ProcessData(paddingRef.data(), paddingRef.data(), padding);
-	bytesRef packetWithPaddingRef(o_bytes.data() + 32, _packet.size() + padding);
-	updateEgressMACWithFrame(packetWithPaddingRef);
-	bytesRef macRef(o_bytes.data() + 32 + _packet.size() + padding, h128::size);
-	egressDigest().ref().copyTo(macRef);
+	o_header = h256();
+	header.outRef().copyTo(o_header.ref());
+	m_frameEnc.ProcessData(o_header.data(), o_header.data(), 16);
+	updateEgressMACWithHeader(o_header.ref().cropped(0, 16));
+	egressDigest().ref().copyTo(o_header.ref().cropped(h128::size, h128::size));
+
+	io_packet.resize(len + (16 - (len % 16)) % 16);
+	encryptAndMAC(m_frameEnc, m_egressMac, &io_packet);
+	updateMAC(m_egressMac);
+	o_mac = egressDigest();
 }
 
 bool RLPXFrameIO::authAndDecryptHeader(bytesRef io)
@@ -140,13 +145,40 @@ bool RLPXFrameIO::authAndDecryptHeader(bytesRef io)
 
 bool RLPXFrameIO::authAndDecryptFrame(bytesRef io)
 {
-	bytesRef cipherText(io.cropped(0, io.size() - h128::size));
-	updateIngressMACWithFrame(cipherText);
+	// Decrypted along with being authenticated; should it not be, the frame is thrown away, plaintext and all.
+	macAndDecrypt(m_frameDec, m_ingressMac, io.cropped(0, io.size() - h128::size));
+	updateMAC(m_ingressMac);
 	bytesConstRef frameMac(io.data() + io.size() - h128::size, h128::size);
-	if (*(h128*)frameMac.data() != ingressDigest())
-		return false;
-	m_frameDec.ProcessData(io.data(), io.data(), io.size() - h128::size);
-	return true;
+	return *(h128*)frameMac.data() == ingressDigest();
+}
+
+void RLPXFrameIO::encryptAndMAC(CTR_Mode<AES>::Encryption& _enc, SHA3_256& _mac, bytesRef io_data)
+{
+	for (size_t i = 0; i < io_data.size(); i += c_codingChunk)
+	{
+		bytesRef chunk = io_data.cropped(i, min(c_codingChunk, io_data.size() - i));
+		_enc.ProcessData(chunk.data(), chunk.data(), chunk.size());
+		_mac.Update(chunk.data(), chunk.size());
+	}
+}
+
+void RLPXFrameIO::macAndDecrypt(CTR_Mode<AES>::Encryption& _dec, SHA3_256& _mac, bytesRef io_data)
+{
+	for (size_t i = 0; i < io_data.size(); i += c_codingChunk)
+	{
+		bytesRef chunk = io_data.cropped(i, min(c_codingChunk, io_data.size() - i));
+		_mac.Update(chunk.data(), chunk.size());
+		_dec.ProcessData(chunk.data(), chunk.data(), chunk.size());
+	}
+}
+
+bool RLPXFrameIO::hardwareAES()
+{
+#if CRYPTOPP_BOOL_X86 || CRYPTOPP_BOOL_X64
+	return HasAESNI();
+#else
+	return false;
+#endif
 }
 
 h128 RLPXFrameIO::egressDigest()
@@ -82,12 +82,26 @@ public:
 	/// Encrypt _packet as RLPx frame.
 	void writeSingleFramePacket(bytesConstRef _packet, bytes& o_bytes);
 
+	/// Encrypt @a io_packet in-place, padded, as the body of an RLPx frame. @a o_header gets the frame's header and its
+	/// MAC, and @a o_mac the body's MAC; sent one after the other, the three make the frame.
+	void writeFrame(bytes& io_packet, h256& o_header, h128& o_mac);
+
 	/// Authenticate and decrypt header in-place.
 	bool authAndDecryptHeader(bytesRef io_cipherWithMac);
 	
 	/// Authenticate and decrypt frame in-place.
 	bool authAndDecryptFrame(bytesRef io_cipherWithMac);
 	
+	/// Encrypt @a io_data in-place with @a _enc, updating @a _mac with the ciphertext as it goes. Done a chunk at a
+	/// time, so that each is hashed while still in cache rather than the whole being read twice.
+	static void encryptAndMAC(CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption& _enc, CryptoPP::SHA3_256& _mac, bytesRef io_data);
+
+	/// Update @a _mac with the ciphertext @a io_data, decrypting it in-place with @a _dec as it goes, a chunk at a time.
+	static void macAndDecrypt(CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption& _dec, CryptoPP::SHA3_256& _mac, bytesRef io_data);
+
+	/// @returns true if CryptoPP's AES runs on the CPU's own AES instructions here.
+	static bool hardwareAES();
+
 	/// Return first 16 bytes of current digest from egress mac.
 	h128 egressDigest();
 
@@ -31,44 +31,52 @@ using namespace CryptoPP;
 void RLPXHandshake::writeAuth()
 {
 	clog(NetConnect) << "p2p.connect.egress sending auth to " << m_socket->remoteEndpoint();
-	m_auth.resize(Signature::size + h256::size + Public::size + h256::size + 1);
-	bytesRef sig(&m_auth[0], Signature::size);
-	bytesRef hepubk(&m_auth[Signature::size], h256::size);
-	bytesRef pubk(&m_auth[Signature::size + h256::size], Public::size);
-	bytesRef nonce(&m_auth[Signature::size + h256::size + Public::size], h256::size);
-	
-	// E(remote-pubk, S(ecdhe-random, ecdh-shared-secret^nonce) || H(ecdhe-random-pubk) || pubk || nonce || 0x0)
-	Secret staticShared;
-	crypto::ecdh::agree(m_host->m_alias.sec(), m_remote, staticShared);
-	sign(m_ecdhe.seckey(), staticShared ^ m_nonce).ref().copyTo(sig);
-	sha3(m_ecdhe.pubkey().ref(), hepubk);
-	m_host->m_alias.pub().ref().copyTo(pubk);
-	m_nonce.ref().copyTo(nonce);
-	m_auth[m_auth.size() - 1] = 0x0;
-	encryptECIES(m_remote, &m_auth, m_authCipher);
+	offload([this]()
+	{
+		m_auth.resize(Signature::size + h256::size + Public::size + h256::size + 1);
+		bytesRef sig(&m_auth[0], Signature::size);
+		bytesRef hepubk(&m_auth[Signature::size], h256::size);
+		bytesRef pubk(&m_auth[Signature::size + h256::size], Public::size);
+		bytesRef nonce(&m_auth[Signature::size + h256::size + Public::size], h256::size);
 
-	auto self(shared_from_this());
-	ba::async_write(m_socket->ref(), ba::buffer(m_authCipher), [this, self](boost::system::error_code ec, std::size_t)
+		// E(remote-pubk, S(ecdhe-random, ecdh-shared-secret^nonce) || H(ecdhe-random-pubk) || pubk || nonce || 0x0)
+		Secret staticShared;
+		crypto::ecdh::agree(m_host->m_alias.sec(), m_remote, staticShared);
+		sign(m_ecdhe.seckey(), staticShared ^ m_nonce).ref().copyTo(sig);
+		sha3(m_ecdhe.pubkey().ref(), hepubk);
+		m_host->m_alias.pub().ref().copyTo(pubk);
+		m_nonce.ref().copyTo(nonce);
+		m_auth[m_auth.size() - 1] = 0x0;
+		encryptECIES(m_remote, &m_auth, m_authCipher);
+	}, [this]()
 	{
-		transition(ec);
+		auto self(shared_from_this());
+		ba::async_write(m_socket->ref(), ba::buffer(m_authCipher), [this, self](boost::system::error_code ec, std::size_t)
+		{
+			transition(ec);
+		});
 	});
 }
 
 void RLPXHandshake::writeAck()
 {
 	clog(NetConnect) << "p2p.connect.ingress sending ack to " << m_socket->remoteEndpoint();
-	m_ack.resize(Public::size + h256::size + 1);
-	bytesRef epubk(&m_ack[0], Public::size);
-	bytesRef nonce(&m_ack[Public::size], h256::size);
-	m_ecdhe.pubkey().ref().copyTo(epubk);
-	m_nonce.ref().copyTo(nonce);
-	m_ack[m_ack.size() - 1] = 0x0;
-	encryptECIES(m_remote, &m_ack, m_ackCipher);
-	
-	auto self(shared_from_this());
-	ba::async_write(m_socket->ref(), ba::buffer(m_ackCipher), [this, self](boost::system::error_code ec, std::size_t)
+	offload([this]()
+	{
+		m_ack.resize(Public::size + h256::size + 1);
+		bytesRef epubk(&m_ack[0], Public::size);
+		bytesRef nonce(&m_ack[Public::size], h256::size);
+		m_ecdhe.pubkey().ref().copyTo(epubk);
+		m_nonce.ref().copyTo(nonce);
+		m_ack[m_ack.size() - 1] = 0x0;
+		encryptECIES(m_remote, &m_ack, m_ackCipher);
+	}, [this]()
 	{
-		transition(ec);
+		auto self(shared_from_this());
+		ba::async_write(m_socket->ref(), ba::buffer(m_ackCipher), [this, self](boost::system::error_code ec, std::size_t)
+		{
+			transition(ec);
+		});
 	});
 }
 
@@ -81,30 +89,31 @@ void RLPXHandshake::readAuth()
 	{
 		if (ec)
 			transition(ec);
-		else if (decryptECIES(m_host->m_alias.sec(), bytesConstRef(&m_authCipher), m_auth))
-		{
-			bytesConstRef sig(&m_auth[0], Signature::size);
-			bytesConstRef hepubk(&m_auth[Signature::size], h256::size);
-			bytesConstRef pubk(&m_auth[Signature::size + h256::size], Public::size);
-			bytesConstRef nonce(&m_auth[Signature::size + h256::size + Public::size], h256::size);
-			pubk.copyTo(m_remote.ref());
-			nonce.copyTo(m_remoteNonce.ref());
-			
-			Secret sharedSecret;
-			crypto::ecdh::agree(m_host->m_alias.sec(), m_remote, sharedSecret);
-			m_remoteEphemeral = recover(*(Signature*)sig.data(), sharedSecret ^ m_remoteNonce);
-
-			if (sha3(m_remoteEphemeral) != *(h256*)hepubk.data())
-				clog(NetConnect) << "p2p.connect.ingress auth failed (invalid: hash mismatch) for" << m_socket->remoteEndpoint();
-			
-			transition();
-		}
 		else
-		{
-			clog(NetConnect) << "p2p.connect.ingress recving auth decrypt failed for" << m_socket->remoteEndpoint();
-			m_nextState = Error;
-			transition();
-		}
+			offload([this]()
+			{
+				if (decryptECIES(m_host->m_alias.sec(), bytesConstRef(&m_authCipher), m_auth))
+				{
+					bytesConstRef sig(&m_auth[0], Signature::size);
+					bytesConstRef hepubk(&m_auth[Signature::size], h256::size);
+					bytesConstRef pubk(&m_auth[Signature::size + h256::size], Public::size);
+					bytesConstRef nonce(&m_auth[Signature::size + h256::size + Public::size], h256::size);
+					pubk.copyTo(m_remote.ref());
+					nonce.copyTo(m_remoteNonce.ref());
+
+					Secret sharedSecret;
+					crypto::ecdh::agree(m_host->m_alias.sec(), m_remote, sharedSecret);
+					m_remoteEphemeral = recover(*(Signature*)sig.data(), sharedSecret ^ m_remoteNonce);
+
+					if (sha3(m_remoteEphemeral) != *(h256*)hepubk.data())
+						clog(NetConnect) << "p2p.connect.ingress auth failed (invalid: hash mismatch) for" << m_socket->remoteEndpoint();
+				}
+				else
+				{
+					clog(NetConnect) << "p2p.connect.ingress recving auth decrypt failed for" << m_socket->remoteEndpoint();
+					m_nextState = Error;
+				}
+			}, [this]() { transition(); });
 	});
 }
 
@@ -117,18 +126,31 @@ void RLPXHandshake::readAck()
 	{
 		if (ec)
 			transition(ec);
-		else if (decryptECIES(m_host->m_alias.sec(), bytesConstRef(&m_ackCipher), m_ack))
-		{
-			bytesConstRef(&m_ack).cropped(0, Public::size).copyTo(m_remoteEphemeral.ref());
-			bytesConstRef(&m_ack).cropped(Public::size, h256::size).copyTo(m_remoteNonce.ref());
-			transition();
-		}
 		else
-		{
-			clog(NetConnect) << "p2p.connect.egress recving ack decrypt failed for " << m_socket->remoteEndpoint();
-			m_nextState = Error;
-			transition();
-		}
+			offload([this]()
+			{
+				if (decryptECIES(m_host->m_alias.sec(), bytesConstRef(&m_ackCipher), m_ack))
+				{
+					bytesConstRef(&m_ack).cropped(0, Public::size).copyTo(m_remoteEphemeral.ref());
+					bytesConstRef(&m_ack).cropped(Public::size, h256::size).copyTo(m_remoteNonce.ref());
+				}
+				else
+				{
+					clog(NetConnect) << "p2p.connect.egress recving ack decrypt failed for " << m_socket->remoteEndpoint();
+					m_nextState = Error;
+				}
+			}, [this]() { transition(); });
+	});
+}
+
+void RLPXHandshake::offload(function<void()> const& _crypto, function<void()> const& _then)
+{
+	auto self(shared_from_this());
+	ba::io_service& io = m_socket->ref().get_io_service();
+	m_host->m_handshakeCrypto.post([self, _crypto, _then, &io]()
+	{
+		_crypto();
+		io.post([self, _then]() { _then(); });
 	});
 }
 
@@ -177,25 +199,29 @@ void RLPXHandshake::transition(boost::system::error_code _ech)
 		m_nextState = ReadHello;
 		clog(NetConnect) << (m_originated ? "p2p.connect.egress" : "p2p.connect.ingress") << "sending capabilities handshake";
 
-		/// This pointer will be freed if there is an error otherwise
-		/// it will be passed to Host which will take ownership.
-		m_io = new RLPXFrameIO(*this);
-
-		// old packet format
-		// 5 arguments, HelloPacket
-		RLPStream s;
-		s.append((unsigned)0).appendList(5)
-		<< dev::p2p::c_protocolVersion
-		<< m_host->m_clientVersion
-		<< m_host->caps()
-		<< m_host->listenPort()
-		<< m_host->id();
-		bytes packet;
-		s.swapOut(packet);
-		m_io->writeSingleFramePacket(&packet, m_handshakeOutBuffer);
-		ba::async_write(m_socket->ref(), ba::buffer(m_handshakeOutBuffer), [this, self](boost::system::error_code ec, std::size_t)
+		offload([this]()
 		{
-			transition(ec);
+			/// This pointer will be freed if there is an error otherwise
+			/// it will be passed to Host which will take ownership.
+			m_io = new RLPXFrameIO(*this);
+		}, [this, self]()
+		{
+			// HelloPacket: the old packet format's 5 arguments, then the compression we take, which older peers ignore.
+			RLPStream s;
+			s.append((unsigned)0).appendList(6)
+			<< dev::p2p::c_protocolVersion
+			<< m_host->m_clientVersion
+			<< m_host->caps()
+			<< m_host->listenPort()
+			<< m_host->id()
+			<< (unsigned)(m_host->m_netPrefs.compressThreshold ? SnappyCompression : NoCompression);
+			bytes packet;
+			s.swapOut(packet);
+			m_io->writeSingleFramePacket(&packet, m_handshakeOutBuffer);
+			ba::async_write(m_socket->ref(), ba::buffer(m_handshakeOutBuffer), [this, self](boost::system::error_code ec, std::size_t)
+			{
+				transition(ec);
+			});
 		});
 	}
 	else if (m_nextState == ReadHello)
@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <libdevcrypto/Common.h>
 #include <libdevcrypto/ECDHE.h>
@@ -88,6 +89,10 @@ protected:
 	/// Reads Auth message from socket and transitions to WriteHello.
 	void readAck();
 	
+	/// Runs @a _crypto on the host's handshake crypto threads, then @a _then back on the network's, so that connection
+	/// storms keep the asymmetric crypto from holding up established sessions.
+	void offload(std::function<void()> const& _crypto, std::function<void()> const& _then);
+
 	/// Closes connection and ends transitions.
 	void error();
 	
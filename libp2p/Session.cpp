@@ -25,6 +25,8 @@
 #include <chrono>
 #include <libdevcore/Common.h>
 #include <libdevcore/CommonIO.h>
+#include <libdevcore/Metrics.h>
+#include <libdevcore/Snappy.h>
 #include <libdevcore/StructuredLogger.h>
 #include <libethcore/Exceptions.h>
 #include "Host.h"
@@ -36,16 +38,42 @@ using namespace dev::p2p;
 #if defined(clogS)
 #undef clogS
 #endif
+/// The most bytes of packets gathered into one write.
+static const size_t c_maxWriteBytes = 256 * 1024;
+
+/// Set in the type byte of a packet whose payload is compressed; packet types themselves are under 0x80.
+static const byte c_compressedPacket = 0x80;
+
+/// How long a session waits, when the host has no buffer to lend it, before asking again.
+static const unsigned c_ingressWaitMs = 20;
+
+static MetricCounter& sentBytes()
+{
+	static MetricCounter& s_this = Metrics::get().counter("p2p_sent_bytes_total", "Bytes of frames sent to peers.");
+	return s_this;
+}
+
+static MetricCounter& receivedBytes()
+{
+	static MetricCounter& s_this = Metrics::get().counter("p2p_received_bytes_total", "Bytes of frames received from peers.");
+	return s_this;
+}
+
 #define clogS(X) dev::LogOutputStream<X, true>(false) << "| " << std::setw(2) << m_socket.native_handle() << "] "
 
 Session::Session(Host* _s, RLPXFrameIO* _io, std::shared_ptr<Peer> const& _n, PeerSessionInfo _info):
 	m_server(_s),
+	m_packetLog(_s->m_packetLog),
 	m_io(_io),
 	m_socket(m_io->socket()),
+	m_writeTimer(m_socket.get_io_service()),
+	m_readTimer(m_socket.get_io_service()),
+	m_strand(m_socket.get_io_service()),
 	m_peer(_n),
 	m_info(_info),
 	m_ping(chrono::steady_clock::time_point::max())
 {
+	setLockName(x_writeQueue, "Session::x_writeQueue");
 	m_peer->m_lastDisconnect = NoDisconnect;
 	m_lastReceived = m_connect = chrono::steady_clock::now();
 }
@@ -244,14 +272,16 @@ bool Session::interpret(PacketType _t, RLP const& _r)
 			}
 			break;
 		default:
-			for (auto const& i: m_capabilities)
-				if (_t >= (int)i.second->m_idOffset && _t - i.second->m_idOffset < i.second->hostCapability()->messageCount())
+			if (auto c = capabilityFor(_t))
+			{
+				if (c->m_enabled)
 				{
-					if (i.second->m_enabled)
-						return i.second->interpret(_t - i.second->m_idOffset, _r);
-					else
-						return true;
+					Guard l(c->hostCapability()->x_interpret);
+					return c->interpret(_t - c->m_idOffset, _r);
 				}
+				else
+					return true;
+			}
 			return false;
 		}
 	}
@@ -264,6 +294,14 @@ bool Session::interpret(PacketType _t, RLP const& _r)
 	return true;
 }
 
+shared_ptr<Capability> Session::capabilityFor(unsigned _t) const
+{
+	for (auto const& i: m_capabilities)
+		if (_t >= i.second->m_idOffset && _t - i.second->m_idOffset < i.second->hostCapability()->messageCount())
+			return i.second;
+	return nullptr;
+}
+
 void Session::ping()
 {
 	RLPStream s;
@@ -276,11 +314,19 @@ RLPStream& Session::prep(RLPStream& _s, PacketType _id, unsigned _args)
 	return _s.append((unsigned)_id).appendList(_args);
 }
 
-void Session::sealAndSend(RLPStream& _s)
+void Session::sealAndSend(RLPStream& _s, HostCapabilityFace* _cap, Lane _lane)
 {
 	bytes b;
 	_s.swapOut(b);
-	send(move(b));
+	send(move(b), _cap, _lane);
+}
+
+void Session::logPacket(bool _outgoing, unsigned _t, bytesConstRef _payload) const
+{
+	if (auto c = capabilityFor(_t))
+		m_packetLog->record(id(), _outgoing, c->hostCapability()->name(), _t - c->m_idOffset, _payload);
+	else
+		m_packetLog->record(id(), _outgoing, string(), _t, _payload);
 }
 
 bool Session::checkPacket(bytesConstRef _msg)
@@ -295,7 +341,7 @@ bool Session::checkPacket(bytesConstRef _msg)
 	return true;
 }
 
-void Session::send(bytes&& _msg)
+void Session::send(bytes&& _msg, HostCapabilityFace* _cap, Lane _lane)
 {
 	clogS(NetLeft) << RLP(bytesConstRef(&_msg).cropped(1));
 
@@ -306,24 +352,126 @@ void Session::send(bytes&& _msg)
 	if (!m_socket.is_open())
 		return;
 
+	if (m_packetLog && !msg.empty())
+		logPacket(true, msg[0], msg.cropped(1));
+
 	bool doWrite = false;
 	{
 		Guard l(x_writeQueue);
-		m_writeQueue.push_back(_msg);
-		doWrite = (m_writeQueue.size() == 1);
+		auto& q = _lane == Lane::Urgent ? m_urgentQueue : m_normalQueue;
+		q.push_back(OutFrame());
+		q.back().packet = move(_msg);
+		q.back().cap = _cap;
+		// An urgent frame doesn't wait for normal ones to be allowed out; should the timer fire later, it finds us
+		// writing and leaves it be.
+		if (m_writeState == WriteState::Idle || (m_writeState == WriteState::Waiting && _lane == Lane::Urgent))
+		{
+			m_writeState = WriteState::Writing;
+			doWrite = true;
+		}
 	}
 
+	// Written from our strand, as it may be a reply, or a packet from elsewhere, while we are reading on another thread.
 	if (doWrite)
-		write();
+	{
+		auto self(shared_from_this());
+		m_strand.post([this, self]() { write(); });
+	}
+}
+
+bool Session::gatherFrames(chrono::steady_clock::duration& o_wait)
+{
+	// Urgent frames first, then normal ones. A normal frame whose capability is over its rate stays queued, as do those
+	// of the same capability behind it, so that each capability's packets keep their order; others may pass them.
+	Guard l(x_writeQueue);
+	size_t size = 0;
+	auto full = [&](OutFrame const& _f){ return !m_writing.empty() && size + _f.packet.size() > c_maxWriteBytes; };
+	while (!m_urgentQueue.empty() && !full(m_urgentQueue.front()))
+	{
+		size += m_urgentQueue.front().packet.size();
+		m_writing.push_back(move(m_urgentQueue.front()));
+		m_urgentQueue.pop_front();
+	}
+	set<HostCapabilityFace*> held;
+	bool waiting = false;
+	for (auto i = m_normalQueue.begin(); i != m_normalQueue.end() && !full(*i);)
+	{
+		chrono::steady_clock::duration wait;
+		if (held.count(i->cap))
+			++i;
+		else if (i->cap && !i->cap->m_egress.take(i->packet.size(), wait))
+		{
+			o_wait = waiting ? min(o_wait, wait) : wait;
+			waiting = true;
+			held.insert(i->cap);
+			++i;
+		}
+		else
+		{
+			size += i->packet.size();
+			m_writing.push_back(move(*i));
+			i = m_normalQueue.erase(i);
+		}
+	}
+	if (!m_writing.empty())
+		return true;
+	m_writeState = m_normalQueue.empty() ? WriteState::Idle : WriteState::Waiting;
+	return !waiting;
 }
 
 void Session::write()
 {
-	const bytes& bytes = m_writeQueue[0];
-	m_io->writeSingleFramePacket(&bytes, m_writeQueue[0]);
+	// Queued frames go out together, up to c_maxWriteBytes of them, in one write gathering each one's header, body and
+	// MAC from where they were sealed.
+	chrono::steady_clock::duration wait;
+	if (!gatherFrames(wait))
+	{
+		auto self(shared_from_this());
+		m_writeTimer.expires_from_now(boost::posix_time::microseconds(chrono::duration_cast<chrono::microseconds>(wait).count() + 1));
+		m_writeTimer.async_wait(m_strand.wrap([this, self](boost::system::error_code const& _ec)
+		{
+			if (_ec)
+				return;
+			{
+				Guard l(x_writeQueue);
+				if (m_writeState != WriteState::Waiting)
+					return;
+				m_writeState = WriteState::Writing;
+			}
+			write();
+		}));
+		return;
+	}
+	if (m_writing.empty())
+		return;
+
+	vector<ba::const_buffer> buffers;
+	buffers.reserve(m_writing.size() * 3);
+	for (auto& f: m_writing)
+	{
+		if (m_compress && f.packet.size() >= m_server->m_netPrefs.compressThreshold)
+		{
+			// Sent compressed only if that makes it smaller.
+			bytes compressed(1, f.packet[0] | c_compressedPacket);
+			snappyCompress(bytesConstRef(&f.packet).cropped(1), compressed);
+			if (compressed.size() < f.packet.size())
+				f.packet.swap(compressed);
+		}
+		m_io->writeFrame(f.packet, f.header, f.mac);
+		buffers.push_back(ba::buffer(f.header.data(), h256::size));
+		buffers.push_back(ba::buffer(f.packet));
+		buffers.push_back(ba::buffer(f.mac.data(), h128::size));
+		size_t bytes = h256::size + f.packet.size() + h128::size;
+		m_info.traffic.egress += bytes;
+		sentBytes().inc(bytes);
+		if (f.cap)
+			m_info.capTraffic[f.cap->name()].egress += bytes;
+	}
+
 	auto self(shared_from_this());
-	ba::async_write(m_socket, ba::buffer(bytes), [this, self](boost::system::error_code ec, std::size_t /*length*/)
+	ba::async_write(m_socket, buffers, m_strand.wrap([this, self](boost::system::error_code ec, std::size_t /*length*/)
 	{
+		m_writing.clear();
 		// must check queue, as write callback can occur following dropped()
 		if (ec)
 		{
@@ -331,15 +479,8 @@ void Session::write()
 			drop(TCPError);
 			return;
 		}
-		else
-		{
-			Guard l(x_writeQueue);
-			m_writeQueue.pop_front();
-			if (m_writeQueue.empty())
-				return;
-		}
 		write();
-	});
+	}));
 }
 
 void Session::drop(DisconnectReason _reason)
@@ -356,6 +497,9 @@ void Session::drop(DisconnectReason _reason)
 		}
 		catch (...) {}
 
+	boost::system::error_code ec;
+	m_writeTimer.cancel(ec);
+
 	m_peer->m_lastDisconnect = _reason;
 	if (_reason == BadProtocol)
 	{
@@ -395,7 +539,7 @@ void Session::doRead()
 		return;
 
 	auto self(shared_from_this());
-	ba::async_read(m_socket, boost::asio::buffer(m_data, h256::size), [this,self](boost::system::error_code ec, std::size_t length)
+	ba::async_read(m_socket, boost::asio::buffer(m_header, h256::size), m_strand.wrap([this,self](boost::system::error_code ec, std::size_t length)
 	{
 		if (ec && ec.category() != boost::asio::error::get_misc_category() && ec.value() != boost::asio::error::eof)
 		{
@@ -407,7 +551,7 @@ void Session::doRead()
 		else
 		{
 			/// authenticate and decrypt header
-			bytesRef header(m_data.data(), h256::size);
+			bytesRef header(m_header.data(), h256::size);
 			if (!m_io->authAndDecryptHeader(header))
 			{
 				clog(NetWarn) << "header decrypt failed";
@@ -416,56 +560,101 @@ void Session::doRead()
 			}
 
 			/// check frame size
-			uint32_t frameSize = (m_data[0] * 256 + m_data[1]) * 256 + m_data[2];
+			uint32_t frameSize = (m_header[0] * 256 + m_header[1]) * 256 + m_header[2];
 			if (frameSize >= (uint32_t)1 << 24)
 			{
 				clog(NetWarn) << "frame size too large";
 				drop(BadProtocol);
 				return;
 			}
-			
-			/// rlp of header has protocol-type, sequence-id[, total-packet-size]
-			bytes headerRLP(13);
-			bytesConstRef(m_data.data(), h128::size).cropped(3).copyTo(&headerRLP);
-			
+
 			/// read padded frame and mac
 			auto tlen = frameSize + ((16 - (frameSize % 16)) % 16) + h128::size;
-			ba::async_read(m_socket, boost::asio::buffer(m_data, tlen), [this, self, headerRLP, frameSize, tlen](boost::system::error_code ec, std::size_t length)
+			if (tlen > m_server->m_netPrefs.sessionIngressLimit)
 			{
-				if (ec && ec.category() != boost::asio::error::get_misc_category() && ec.value() != boost::asio::error::eof)
+				clog(NetWarn) << "frame larger than we take from a peer";
+				drop(BadProtocol);
+				return;
+			}
+			readFrame(frameSize, tlen);
+		}
+	}));
+}
+
+void Session::readFrame(uint32_t _frameSize, size_t _tlen)
+{
+	if (m_dropped)
+		return;
+
+	auto self(shared_from_this());
+	m_frame = m_server->m_ingressPool.borrow(_tlen, m_server->m_netPrefs.ingressLimit);
+	if (!m_frame)
+	{
+		// So much is being read from all peers together that this one's frame is left unread for now, holding it back.
+		m_readTimer.expires_from_now(boost::posix_time::milliseconds(c_ingressWaitMs));
+		m_readTimer.async_wait(m_strand.wrap([this, self, _frameSize, _tlen](boost::system::error_code const& _ec)
+		{
+			if (!_ec)
+				readFrame(_frameSize, _tlen);
+		}));
+		return;
+	}
+
+	// Parsed where it is read, in the borrowed buffer, which goes back to the pool once the packet is interpreted.
+	ba::async_read(m_socket, boost::asio::buffer(m_frame.ref().data(), _tlen), m_strand.wrap([this, self, _frameSize, _tlen](boost::system::error_code ec, std::size_t length)
+	{
+		if (ec && ec.category() != boost::asio::error::get_misc_category() && ec.value() != boost::asio::error::eof)
+		{
+			clogS(NetWarn) << "Error reading: " << ec.message();
+			drop(TCPError);
+		}
+		else if (ec && length == 0)
+			return;
+		else
+		{
+			if (!m_io->authAndDecryptFrame(m_frame.ref()))
+			{
+				clog(NetWarn) << "frame decrypt failed";
+				drop(BadProtocol); // todo: better error
+				return;
+			}
+
+			bytesConstRef frame = m_frame.ref().cropped(0, _frameSize);
+			bytes uncompressed;
+			if (m_compress && frame.size() && (frame[0] & c_compressedPacket))
+			{
+				uncompressed.push_back(frame[0] & ~c_compressedPacket);
+				if (!snappyUncompress(frame.cropped(1), uncompressed, m_server->m_netPrefs.sessionIngressLimit))
 				{
-					clogS(NetWarn) << "Error reading: " << ec.message();
-					drop(TCPError);
-				}
-				else if (ec && length == 0)
+					clogS(NetWarn) << "Couldn't uncompress packet.";
+					disconnect(BadProtocol);
 					return;
-				else
-				{
-					if (!m_io->authAndDecryptFrame(bytesRef(m_data.data(), tlen)))
-					{
-						clog(NetWarn) << "frame decrypt failed";
-						drop(BadProtocol); // todo: better error
-						return;
-					}
-					
-					bytesConstRef frame(m_data.data(), frameSize);
-					if (!checkPacket(frame))
-					{
-						cerr << "Received " << frame.size() << ": " << toHex(frame) << endl;
-						clogS(NetWarn) << "INVALID MESSAGE RECEIVED";
-						disconnect(BadProtocol);
-						return;
-					}
-					else
-					{
-						auto packetType = (PacketType)RLP(frame.cropped(0, 1)).toInt<unsigned>();
-						RLP r(frame.cropped(1));
-						if (!interpret(packetType, r))
-							clogS(NetWarn) << "Couldn't interpret packet." << RLP(r);
-					}
-					doRead();
 				}
-			});
+				frame = &uncompressed;
+			}
+			if (!checkPacket(frame))
+			{
+				cerr << "Received " << frame.size() << ": " << toHex(frame) << endl;
+				clogS(NetWarn) << "INVALID MESSAGE RECEIVED";
+				disconnect(BadProtocol);
+				return;
+			}
+			else
+			{
+				auto packetType = (PacketType)RLP(frame.cropped(0, 1)).toInt<unsigned>();
+				size_t bytes = h256::size + _tlen;
+				m_info.traffic.ingress += bytes;
+				receivedBytes().inc(bytes);
+				if (auto c = capabilityFor(packetType))
+					m_info.capTraffic[c->hostCapability()->name()].ingress += bytes;
+				RLP r(frame.cropped(1));
+				if (m_packetLog)
+					logPacket(false, packetType, r.data());
+				if (!interpret(packetType, r))
+					clogS(NetWarn) << "Couldn't interpret packet." << RLP(r);
+			}
+			m_frame.release();
+			doRead();
 		}
-	});
+	}));
 }
@@ -33,6 +33,7 @@
 #include <libdevcore/RLP.h>
 #include <libdevcore/RangeMask.h>
 #include <libdevcore/Guards.h>
+#include "BufferPool.h"
 #include "RLPxHandshake.h"
 #include "Common.h"
 
@@ -43,6 +44,8 @@ namespace p2p
 {
 
 class Peer;
+class HostCapabilityFace;
+class PacketLog;
 
 /**
  * @brief The Session class
@@ -52,6 +55,7 @@ class Session: public std::enable_shared_from_this<Session>
 {
 	friend class Host;
 	friend class HostCapabilityFace;
+	friend class Capability;
 
 public:
 	Session(Host* _server, RLPXFrameIO* _io, std::shared_ptr<Peer> const& _n, PeerSessionInfo _info);
@@ -71,7 +75,8 @@ public:
 	std::shared_ptr<PeerCap> cap() const { try { return std::static_pointer_cast<PeerCap>(m_capabilities.at(std::make_pair(PeerCap::name(), PeerCap::version()))); } catch (...) { return nullptr; } }
 
 	static RLPStream& prep(RLPStream& _s, PacketType _t, unsigned _args = 0);
-	void sealAndSend(RLPStream& _s);
+	/// Sends the session's own packet, in the urgent lane.
+	void sealAndSend(RLPStream& _s) { sealAndSend(_s, nullptr, Lane::Urgent); }
 
 	int rating() const;
 	void addRating(int _r);
@@ -84,33 +89,69 @@ public:
 	void serviceNodesRequest();
 
 private:
-	void send(bytes&& _msg);
+	/// Sends a packet of the capability @a _cap, or of the session's own if null, in the lane @a _lane.
+	void sealAndSend(RLPStream& _s, HostCapabilityFace* _cap, Lane _lane);
+	void send(bytes&& _msg, HostCapabilityFace* _cap, Lane _lane);
+
+	/// @returns the capability whose packets include those of type @a _t, or null if none do.
+	std::shared_ptr<Capability> capabilityFor(unsigned _t) const;
 
 	/// Drop the connection for the reason @a _r.
 	void drop(DisconnectReason _r);
 
 	/// Perform a read on the socket.
 	void doRead();
+	/// Read the frame, of @a _frameSize bytes and @a _tlen with padding and MAC, whose header has been read.
+	void readFrame(uint32_t _frameSize, size_t _tlen);
 
 	/// Perform a single round of the write operation. This could end up calling itself asynchronously.
 	void write();
+	/// Moves queued frames to m_writing: urgent ones first, then normal ones as their capabilities' egress rates allow.
+	/// @returns false, with @a o_wait set to how long until one may go, if normal ones are queued but none may go yet.
+	bool gatherFrames(std::chrono::steady_clock::duration& o_wait);
 
 	/// Interpret an incoming message.
 	bool interpret(PacketType _t, RLP const& _r);
 
+	/// Records the packet of type @a _t, of RLP @a _payload, to the host's packet log.
+	void logPacket(bool _outgoing, unsigned _t, bytesConstRef _payload) const;
+
 	/// @returns true iff the _msg forms a valid message for sending or receiving on the network.
 	static bool checkPacket(bytesConstRef _msg);
 
 	Host* m_server;							///< The host that owns us. Never null.
+	std::shared_ptr<PacketLog> m_packetLog;	///< The host's packet log, or null if it keeps none.
 
 	RLPXFrameIO* m_io;						///< Transport over which packets are sent.
 	bi::tcp::socket& m_socket;				///< Socket for the peer's connection.
-	Mutex x_writeQueue;						///< Mutex for the write queue.
-	std::deque<bytes> m_writeQueue;			///< The write queue.
-	std::array<byte, 16777216> m_data;			///< Buffer for ingress packet data.
-	bytes m_incoming;						///< Read buffer for ingress bytes.
+	/// A packet queued to be sent, sealed into a frame just before it goes.
+	struct OutFrame
+	{
+		bytes packet;						///< The packet; once sealed, the frame's body, encrypted and padded.
+		h256 header;						///< Once sealed, the frame's header and its MAC.
+		h128 mac;							///< Once sealed, the body's MAC.
+		HostCapabilityFace* cap;			///< The capability whose packet it is, or null for our own.
+	};
+	enum class WriteState
+	{
+		Idle,								///< Nothing queued.
+		Writing,							///< A write is under way or posted.
+		Waiting								///< Only normal frames are queued, and m_writeTimer waits until one may go.
+	};
+
+	Mutex x_writeQueue;						///< Mutex for the write queues and m_writeState.
+	std::deque<OutFrame> m_urgentQueue;		///< Frames of the urgent lane, waiting to be written.
+	std::deque<OutFrame> m_normalQueue;		///< Frames of the normal lane, waiting to be written.
+	WriteState m_writeState = WriteState::Idle;
+	std::vector<OutFrame> m_writing;		///< The frames being written; touched only on our strand.
+	boost::asio::deadline_timer m_writeTimer;	///< Delays writing normal frames while their capabilities are over their rates.
+	std::array<byte, h256::size> m_header;	///< Buffer for the ingress frame header.
+	BufferPool::Buffer m_frame;				///< Buffer for the ingress frame, borrowed from the host's pool while it is read.
+	boost::asio::deadline_timer m_readTimer;	///< Delays reading while the host's pool has nothing to lend.
+	boost::asio::io_service::strand m_strand;	///< Runs our handlers one at a time, whichever of the host's threads they run on.
 
 	unsigned m_protocolVersion = 0;			///< The protocol version of the peer.
+	bool m_compress = false;				///< Whether we both take compressed packets, so large ones are compressed both ways.
 	std::shared_ptr<Peer> m_peer;			///< The Peer object.
 	bool m_dropped = false;					///< If true, we've already divested ourselves of this peer. We're just waiting for the reads & writes to fail before the shared_ptr goes OOS and the destructor kicks in.
 
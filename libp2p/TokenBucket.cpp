@@ -0,0 +1,49 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file TokenBucket.cpp
+ * @date 2015
+ */
+
+#include "TokenBucket.h"
+using namespace std;
+using namespace dev;
+using namespace dev::p2p;
+
+void TokenBucket::setRate(size_t _rate)
+{
+	Guard l(x_bucket);
+	m_rate = _rate;
+	m_tokens = _rate;
+	m_filled = Clock::now();
+}
+
+bool TokenBucket::take(size_t _bytes, Clock::duration& o_wait)
+{
+	Guard l(x_bucket);
+	if (!m_rate)
+		return true;
+	auto now = Clock::now();
+	m_tokens = min<double>(m_tokens + chrono::duration<double>(now - m_filled).count() * m_rate, m_rate);
+	m_filled = now;
+	if (m_tokens < 0)
+	{
+		o_wait = chrono::duration_cast<Clock::duration>(chrono::duration<double>(-m_tokens / m_rate));
+		return false;
+	}
+	m_tokens -= _bytes;
+	return true;
+}
@@ -0,0 +1,61 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file TokenBucket.h
+ * @date 2015
+ */
+
+#pragma once
+
+#include <chrono>
+#include <libdevcore/Common.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+namespace p2p
+{
+
+/**
+ * @brief Limits the bytes sent a second, however many sessions send them.
+ * Refills at the rate set, up to a second's worth. Sending is allowed so long as the bucket is not in debt, and may put
+ * it in debt, so that a frame larger than the bucket still goes, followed by a wait long enough to keep to the rate.
+ * @threadsafe
+ */
+class TokenBucket
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/// Refills at @a _rate bytes a second; zero is unlimited.
+	explicit TokenBucket(size_t _rate = 0) { setRate(_rate); }
+
+	void setRate(size_t _rate);
+	size_t rate() const { Guard l(x_bucket); return m_rate; }
+
+	/// Takes @a _bytes from the bucket if it is not in debt.
+	/// @returns true if they were taken, else false with @a o_wait set to how long until it is out of debt.
+	bool take(size_t _bytes, Clock::duration& o_wait);
+
+private:
+	mutable Mutex x_bucket;
+	size_t m_rate = 0;
+	double m_tokens = 0;					///< Bytes that may be sent now; negative while in debt.
+	Clock::time_point m_filled;				///< When m_tokens was last brought up to date.
+};
+
+}
+}
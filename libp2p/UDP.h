@@ -26,6 +26,15 @@
 #include <vector>
 #include <deque>
 #include <array>
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+/// Whether UDPSocket moves datagrams in batches, with recvmmsg and sendmmsg.
+#define ETH_UDP_BATCHED 1
+#else
+#define ETH_UDP_BATCHED 0
+#endif
 
 #include <libdevcore/Guards.h>
 #include <libdevcrypto/Common.h>
@@ -103,6 +112,9 @@ struct UDPSocketEvents
  * @brief UDP Interface
  * Handler must implement UDPSocketEvents.
  *
+ * Where ETH_UDP_BATCHED, up to ioBatch datagrams are read, or written, with one call once the socket is ready,
+ * into a preallocated ring of buffers; elsewhere, one at a time with plain asio.
+ *
  * @todo multiple endpoints (we cannot advertise 0.0.0.0)
  * @todo decouple deque from UDPDatagram and add ref() to datagram for fire&forget
  */
@@ -111,6 +123,7 @@ class UDPSocket: UDPSocketFace, public std::enable_shared_from_this<UDPSocket<Ha
 {
 public:
 	enum { maxDatagramSize = MaxDatagramSize };
+	enum { ioBatch = 32 };
 	static_assert(maxDatagramSize < 65507, "UDP datagrams cannot be larger than 65507 bytes");
 
 	/// Create socket for specific endpoint.
@@ -147,8 +160,17 @@ protected:
 
 	Mutex x_sendQ;
 	std::deque<UDPDatagram> m_sendQ;				///< Queue for egress data.
+#if ETH_UDP_BATCHED
+	std::array<std::array<byte, maxDatagramSize>, ioBatch> m_recvData;	///< Buffers for ingress data.
+	std::array<bi::udp::endpoint, ioBatch> m_recvEndpoints;				///< Endpoints data was received from.
+	std::array<iovec, ioBatch> m_recvIov;
+	std::array<mmsghdr, ioBatch> m_recvMsgs;							///< Point into m_recvData and m_recvEndpoints.
+	std::array<iovec, ioBatch> m_sendIov;
+	std::array<mmsghdr, ioBatch> m_sendMsgs;							///< Point into the front of m_sendQ while it is written.
+#else
 	std::array<byte, maxDatagramSize> m_recvData;	///< Buffer for ingress data.
 	bi::udp::endpoint m_recvEndpoint;				///< Endpoint data was received from.
+#endif
 	bi::udp::socket m_socket;						///< Boost asio udp socket.
 
 	Mutex x_socketError;							///< Mutex for error which can be set from host or IO thread.
@@ -176,6 +198,21 @@ void UDPSocket<Handler, MaxDatagramSize>::connect()
 	Guard l(x_sendQ);
 	m_sendQ.clear();
 
+#if ETH_UDP_BATCHED
+	for (unsigned i = 0; i < ioBatch; ++i)
+	{
+		m_recvIov[i].iov_base = m_recvData[i].data();
+		m_recvIov[i].iov_len = maxDatagramSize;
+		m_recvMsgs[i] = mmsghdr();
+		m_recvMsgs[i].msg_hdr.msg_name = m_recvEndpoints[i].data();
+		m_recvMsgs[i].msg_hdr.msg_iov = &m_recvIov[i];
+		m_recvMsgs[i].msg_hdr.msg_iovlen = 1;
+		m_sendMsgs[i] = mmsghdr();
+		m_sendMsgs[i].msg_hdr.msg_iov = &m_sendIov[i];
+		m_sendMsgs[i].msg_hdr.msg_iovlen = 1;
+	}
+#endif
+
 	m_closed = false;
 	doRead();
 }
@@ -201,6 +238,27 @@ void UDPSocket<Handler, MaxDatagramSize>::doRead()
 		return;
 
 	auto self(UDPSocket<Handler, MaxDatagramSize>::shared_from_this());
+#if ETH_UDP_BATCHED
+	// Once there is something to read, everything waiting, up to ioBatch datagrams, is read at once.
+	m_socket.async_receive(ba::null_buffers(), [this, self](boost::system::error_code _ec, size_t)
+	{
+		if (_ec || m_closed)
+			return disconnectWithError(_ec);
+
+		for (unsigned i = 0; i < ioBatch; ++i)
+			m_recvMsgs[i].msg_hdr.msg_namelen = m_recvEndpoints[i].capacity();
+		int n = recvmmsg(m_socket.native_handle(), m_recvMsgs.data(), ioBatch, MSG_DONTWAIT, nullptr);
+		if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+			return disconnectWithError(boost::system::error_code(errno, boost::system::system_category()));
+		for (int i = 0; i < n && !m_closed; ++i)
+			if (m_recvMsgs[i].msg_len)
+			{
+				m_recvEndpoints[i].resize(m_recvMsgs[i].msg_hdr.msg_namelen);
+				m_host.onReceived(this, m_recvEndpoints[i], bytesConstRef(m_recvData[i].data(), m_recvMsgs[i].msg_len));
+			}
+		doRead();
+	});
+#else
 	m_socket.async_receive_from(boost::asio::buffer(m_recvData), m_recvEndpoint, [this, self](boost::system::error_code _ec, size_t _len)
 	{
 		// ASIO Safety: It is possible that ASIO will call lambda w/o an error
@@ -213,6 +271,7 @@ void UDPSocket<Handler, MaxDatagramSize>::doRead()
 		m_host.onReceived(this, m_recvEndpoint, bytesConstRef(m_recvData.data(), _len));
 		doRead();
 	});
+#endif
 }
 
 template <typename Handler, unsigned MaxDatagramSize>
@@ -221,8 +280,43 @@ void UDPSocket<Handler, MaxDatagramSize>::doWrite()
 	if (m_closed)
 		return;
 
-	const UDPDatagram& datagram = m_sendQ[0];
 	auto self(UDPSocket<Handler, MaxDatagramSize>::shared_from_this());
+#if ETH_UDP_BATCHED
+	// Once the socket may be written, up to ioBatch datagrams from the front of the queue are sent at once; they stay
+	// put, and only we take them off, while more are queued behind them.
+	m_socket.async_send(ba::null_buffers(), [this, self](boost::system::error_code _ec, std::size_t)
+	{
+		if (_ec || m_closed)
+			return disconnectWithError(_ec);
+
+		unsigned count = 0;
+		{
+			Guard l(x_sendQ);
+			for (auto i = m_sendQ.begin(); i != m_sendQ.end() && count < ioBatch; ++i, ++count)
+			{
+				m_sendIov[count].iov_base = i->data.data();
+				m_sendIov[count].iov_len = i->data.size();
+				m_sendMsgs[count].msg_hdr.msg_name = const_cast<sockaddr*>(i->endpoint().data());
+				m_sendMsgs[count].msg_hdr.msg_namelen = i->endpoint().size();
+			}
+		}
+		int n = sendmmsg(m_socket.native_handle(), m_sendMsgs.data(), count, MSG_DONTWAIT);
+		if (n < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				return disconnectWithError(boost::system::error_code(errno, boost::system::system_category()));
+			n = 0;
+		}
+		{
+			Guard l(x_sendQ);
+			m_sendQ.erase(m_sendQ.begin(), m_sendQ.begin() + n);
+			if (m_sendQ.empty())
+				return;
+		}
+		doWrite();
+	});
+#else
+	const UDPDatagram& datagram = m_sendQ[0];
 	m_socket.async_send_to(boost::asio::buffer(datagram.data), datagram.endpoint(), [this, self](boost::system::error_code _ec, std::size_t)
 	{
 		if (_ec || m_closed)
@@ -236,6 +330,7 @@ void UDPSocket<Handler, MaxDatagramSize>::doWrite()
 		}
 		doWrite();
 	});
+#endif
 }
 
 template <typename Handler, unsigned MaxDatagramSize>
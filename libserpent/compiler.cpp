@@ -5,6 +5,7 @@
 #include "util.h"
 #include "bignum.h"
 #include "opcodes.h"
+#include <libevmcore/Assembly.h>
 
 // Auxiliary data that is gathered while compiling
 struct programAux {
@@ -472,9 +473,97 @@ std::vector<Node> prettyAssemble(Node fragTree) {
     return dereference(fragTree);
 }
 
+// Auxiliary data for building an assembly: the tag for each label,
+// and the subassembly for each label starting a code block
+struct assemblyAux {
+    std::map<std::string, dev::eth::AssemblyItem> tags;
+    std::map<std::string, dev::eth::AssemblyItem> subs;
+};
+
+dev::eth::AssemblyItem tagFor(std::string label, dev::eth::Assembly &a,
+                              assemblyAux &aux) {
+    if (!aux.tags.count(label))
+        aux.tags.insert(std::make_pair(label, a.newTag()));
+    return aux.tags.find(label)->second;
+}
+
+void buildAssembly(Node program, dev::eth::Assembly &a, assemblyAux &aux);
+
+// Turns each code block into a subassembly, laid out after the code
+// as Solidity does it, rather than inline with a jump over it
+void buildSubs(Node program, dev::eth::Assembly &a, assemblyAux &aux) {
+    for (unsigned i = 0; i < program.args.size(); i++) {
+        Node arg = program.args[i];
+        if (arg.type == TOKEN && arg.val[0] == '~' && i + 1 < program.args.size()
+                && program.args[i + 1].val == "____CODE") {
+            Node code = program.args[++i];
+            dev::eth::Assembly sub;
+            assemblyAux subAux;
+            buildSubs(code, sub, subAux);
+            buildAssembly(code, sub, subAux);
+            aux.subs.insert(std::make_pair(arg.val.substr(1), a.newSub(sub)));
+        }
+        else if (arg.type != TOKEN) buildSubs(arg, a, aux);
+    }
+}
+
+void buildAssembly(Node program, dev::eth::Assembly &a, assemblyAux &aux) {
+    Metadata m = program.metadata;
+    if (program.type == TOKEN) {
+        std::string v = program.val;
+        if (isNumberLike(program))
+            a.append(dev::u256(v));
+        // $label pushes its tag, $begin.end the size of a code block
+        // and $begin its offset
+        else if (v[0] == '$') {
+            int dotLoc = v.find('.');
+            std::string label = v.substr(1, dotLoc == -1 ? std::string::npos : dotLoc - 1);
+            if (aux.subs.count(label) && dotLoc == -1)
+                a.append(aux.subs.find(label)->second);
+            else if (aux.subs.count(label))
+                a.append(a.newPushSubSize(aux.subs.find(label)->second.data()));
+            else if (dotLoc == -1)
+                a.append(tagFor(label, a, aux).pushTag());
+            else err("Label distance is not a code block size: "+v, m);
+        }
+        else if (opcode(v) >= 0)
+            a.append(dev::eth::Instruction(opcode(v)));
+        else err("Invalid opcode: "+v, m);
+        return;
+    }
+    for (unsigned i = 0; i < program.args.size(); i++) {
+        Node arg = program.args[i];
+        if (arg.type == TOKEN && arg.val[0] == '~') {
+            // A label is a tag, which brings its own JUMPDEST; the
+            // start of a code block is now that of the subassembly
+            bool nextIsCode = i + 1 < program.args.size()
+                && program.args[i + 1].val == "____CODE";
+            if (nextIsCode) i++;
+            else {
+                a.append(tagFor(arg.val.substr(1), a, aux));
+                if (i + 1 < program.args.size()
+                        && program.args[i + 1].val == "JUMPDEST") i++;
+            }
+        }
+        else buildAssembly(arg, a, aux);
+    }
+}
+
+// Fragtree -> assembly
+dev::eth::Assembly buildAssembly(Node fragTree) {
+    dev::eth::Assembly a;
+    assemblyAux aux;
+    buildSubs(fragTree, a, aux);
+    buildAssembly(fragTree, a, aux);
+    return a;
+}
+
 // LLL -> bin
-std::string compileLLL(Node program) {
-    return assemble(buildFragmentTree(program));
+std::string compileLLL(Node program, bool optimize) {
+    if (!optimize)
+        return assemble(buildFragmentTree(program));
+    dev::bytes code = buildAssembly(buildFragmentTree(program)).optimise(true).assemble();
+    return std::string(code.begin(), code.end());
 }
 
 // LLL -> tokens
@@ -6,6 +6,7 @@
 #include <vector>
 #include <map>
 #include "util.h"
+#include <libevmcore/Assembly.h>
 
 // Compiled fragtree -> compiled fragtree without labels
 std::vector<Node> dereference(Node program);
@@ -22,8 +23,11 @@ std::string assemble(Node fragTree);
 // Fragtree -> opcodes
 std::vector<Node> prettyAssemble(Node fragTree);
 
-// LLL -> bin
-std::string compileLLL(Node program);
+// Fragtree -> assembly, for the optimiser shared with LLL and Solidity
+dev::eth::Assembly buildAssembly(Node fragTree);
+
+// LLL -> bin, optionally through that optimiser
+std::string compileLLL(Node program, bool optimize=false);
 
 // LLL -> opcodes
 std::vector<Node> prettyCompileLLL(Node program);
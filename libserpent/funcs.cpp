@@ -18,16 +18,16 @@ Node compileChunkToLLL(std::string input) {
     return rewriteChunk(parseSerpent(input));
 }
 
-std::string compile(std::string input) {
-    return compileLLL(compileToLLL(input));
+std::string compile(std::string input, bool optimize) {
+    return compileLLL(compileToLLL(input), optimize);
 }
 
 std::vector<Node> prettyCompile(std::string input) {
     return prettyCompileLLL(compileToLLL(input));
 }
 
-std::string compileChunk(std::string input) {
-    return compileLLL(compileChunkToLLL(input));
+std::string compileChunk(std::string input, bool optimize) {
+    return compileLLL(compileChunkToLLL(input), optimize);
 }
 
 std::vector<Node> prettyCompileChunk(std::string input) {
@@ -26,10 +26,10 @@ Node compileToLLL(std::string input);
 
 Node compileChunkToLLL(std::string input);
 
-std::string compile(std::string input);
+std::string compile(std::string input, bool optimize=false);
 
 std::vector<Node> prettyCompile(std::string input);
 
-std::string compileChunk(std::string input);
+std::string compileChunk(std::string input, bool optimize=false);
 
 std::vector<Node> prettyCompileChunk(std::string input);
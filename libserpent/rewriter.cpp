@@ -605,14 +605,15 @@ Node storageTransform(Node node, preprocessAux aux,
 }
 
 // Basic rewrite rule execution
-std::pair<Node, bool> rulesTransform(Node node, rewriteRuleSet macros) {
+std::pair<Node, bool> rulesTransform(Node node, rewriteRuleSet const& macros) {
     std::string prefix = "_temp_"+mkUniqueToken();
     bool changed = false;
-    if (!macros.ruleLists.count(node.val))
+    std::vector<rewriteRule> const* rules =
+        macros.rulesFor(node.val, node.args.size());
+    if (!rules)
         return std::pair<Node, bool>(node, false);
-    std::vector<rewriteRule> rules = macros.ruleLists[node.val];
-    for (unsigned pos = 0; pos < rules.size(); pos++) {
-        rewriteRule macro = rules[pos];
+    for (unsigned pos = 0; pos < rules->size(); pos++) {
+        rewriteRule const& macro = (*rules)[pos];
         matchResult mr = match(macro.pattern, node);
         if (mr.success) {
             node = subst(macro.substitution, mr.map, prefix, node.metadata);
@@ -636,15 +637,21 @@ std::pair<Node, bool> synonymTransform(Node node) {
 rewriteRuleSet nodeMacros;
 rewriteRuleSet setterMacros;
 
+// Numbers each rewriting pass to its fixpoint, so that the subtrees
+// one pass of it finds nothing to rewrite in are skipped by the next
+// (see Node::normalIn); whether there is anything to rewrite in a
+// subtree depends on nothing outside it
+unsigned lastPass = 0;
+
 bool dontDescend(std::string s) {
     return s == "macro" || s == "comment" || s == "outer";
 }
 
 // Recursively applies any set of rewrite rules
-std::pair<Node, bool> apply_rules_iter(preprocessResult pr, rewriteRuleSet rules) {
+std::pair<Node, bool> apply_rules_iter(Node node, rewriteRuleSet const& rules,
+                                       unsigned pass) {
     bool changed = false;
-    Node node = pr.first;
-    if (dontDescend(node.val))
+    if (node.normalIn == pass || dontDescend(node.val))
         return std::pair<Node, bool>(node, false);
     std::pair<Node, bool> o = rulesTransform(node, rules);
     node = o.first;
@@ -652,18 +659,22 @@ std::pair<Node, bool> apply_rules_iter(preprocessResult pr, rewriteRuleSet rules
     if (node.type == ASTNODE) {
         for (unsigned i = 0; i < node.args.size(); i++) {
             std::pair<Node, bool> r =
-                apply_rules_iter(preprocessResult(node.args[i], pr.second), rules);
+                apply_rules_iter(node.args[i], rules, pass);
             node.args[i] = r.first;
             changed = changed || r.second;
         }
     }
+    if (!changed)
+        node.normalIn = pass;
     return std::pair<Node, bool>(node, changed);
 }
 
 // Recursively applies rewrite rules and other primary transformations
-std::pair<Node, bool> mainTransform(preprocessResult pr) {
+std::pair<Node, bool> mainTransform(Node node, preprocessAux const& aux,
+                                    unsigned pass) {
     bool changed = false;
-    Node node = pr.first;
+    if (node.normalIn == pass)
+        return std::pair<Node, bool>(node, false);
 
     // Anything inside "outer" should be treated as a separate program
     // and thus recursively compiled in its entirety
@@ -678,15 +689,15 @@ std::pair<Node, bool> mainTransform(preprocessResult pr) {
 
     // Special storage transformation
     if (isNodeStorageVariable(node)) {
-        node = storageTransform(node, pr.second);
+        node = storageTransform(node, aux);
         changed = true;
     }
     if (node.val == "ref" && isNodeStorageVariable(node.args[0])) {
-        node = storageTransform(node.args[0], pr.second, false, true);
+        node = storageTransform(node.args[0], aux, false, true);
         changed = true;
     }
     if (node.val == "=" && isNodeStorageVariable(node.args[0])) {
-        Node t = storageTransform(node.args[0], pr.second);
+        Node t = storageTransform(node.args[0], aux);
         if (t.val == "sload") {
             std::vector<Node> o;
             o.push_back(t.args[0]);
@@ -711,7 +722,7 @@ std::pair<Node, bool> mainTransform(preprocessResult pr) {
         changed = true;
     }
     if (node.val == "fun" && node.args[0].val == ".") {
-        node = dotTransform(node, pr.second);
+        node = dotTransform(node, aux);
         changed = true;
     }
     if (node.val == "text") {
@@ -726,6 +737,7 @@ std::pair<Node, bool> mainTransform(preprocessResult pr) {
             if (node.args[0].type == TOKEN && 
                     node.args[0].val.size() > 0 && node.args[0].val[0] != '\'') {
                 node.args[0].val = "'" + node.args[0].val;
+                node.args[0].normalIn = 0;
                 changed = true;
             }
             i = 1;
@@ -734,13 +746,14 @@ std::pair<Node, bool> mainTransform(preprocessResult pr) {
         else if (node.val == "arglen") {
             node.val = "get";
             node.args[0].val = "'_len_" + node.args[0].val;
+            node.args[0].normalIn = 0;
             i = 1;
             changed = true;
         }
         // Recursively process children
         for (; i < node.args.size(); i++) {
             std::pair<Node, bool> r =
-                mainTransform(preprocessResult(node.args[i], pr.second));
+                mainTransform(node.args[i], aux, pass);
             node.args[i] = r.first;
             changed = changed || r.second;
         }
@@ -758,6 +771,8 @@ std::pair<Node, bool> mainTransform(preprocessResult pr) {
         node.val = strToNumeric(node.val);
         changed = true;
     }
+    if (!changed)
+        node.normalIn = pass;
     return std::pair<Node, bool>(node, changed);
 }
 
@@ -794,23 +809,26 @@ Node apply_rules(preprocessResult pr) {
     std::pair<Node, bool> r;
     for(it=pr.second.customMacros.begin();
         it != pr.second.customMacros.end(); it++) {
+        unsigned pass = ++lastPass;
         while (1) {
             // std::cerr << "STARTING ARI CYCLE: " << (*it).first <<"\n";
             // std::cerr << printAST(pr.first) << "\n";
-            r = apply_rules_iter(pr, (*it).second);
+            r = apply_rules_iter(pr.first, (*it).second, pass);
             pr.first = r.first;
             if (!r.second) break;
         }
     }
     // Apply setter macros
+    unsigned pass = ++lastPass;
     while (1) {
-        r = apply_rules_iter(pr, setterMacros);
+        r = apply_rules_iter(pr.first, setterMacros, pass);
         pr.first = r.first;
         if (!r.second) break;
     }
     // Apply all other mactos
+    pass = ++lastPass;
     while (1) {
-        r = mainTransform(pr);
+        r = mainTransform(pr.first, pr.second, pass);
         pr.first = r.first;
         if (!r.second) break;
     }
@@ -111,40 +111,39 @@ bool isNodeStorageVariable(Node node) {
     }
 }
 
+// Matches n against p, adding the variables of the pattern to map; a
+// helper to match, so that the bindings of one argument are not copied
+// into those of its parent
+static bool matchInto(Node const& p, Node const& n,
+                      std::map<std::string, Node>& map) {
+    if (p.type == TOKEN) {
+        if (p.val == n.val && n.type == TOKEN) return true;
+        if (p.val[0] == '$' || p.val[0] == '@') {
+            map[p.val.substr(1)] = n;
+            return true;
+        }
+        return false;
+    }
+    if (n.type==TOKEN || p.val!=n.val || p.args.size()!=n.args.size())
+        return false;
+    for (unsigned i = 0; i < p.args.size(); i++) {
+        if (!matchInto(p.args[i], n.args[i], map))
+            return false;
+    }
+    return true;
+}
+
 // Main pattern matching routine, for those patterns that can be expressed
 // using our standard mini-language above
 //
 // Returns two values. First, a boolean to determine whether the node matches
 // the pattern, second, if the node does match then a map mapping variables
 // in the pattern to nodes
-matchResult match(Node p, Node n) {
+matchResult match(Node const& p, Node const& n) {
     matchResult o;
-    o.success = false;
-    if (p.type == TOKEN) {
-        if (p.val == n.val && n.type == TOKEN) o.success = true;
-        else if (p.val[0] == '$' || p.val[0] == '@') {
-            o.success = true;
-            o.map[p.val.substr(1)] = n;
-        }
-    }
-    else if (n.type==TOKEN || p.val!=n.val || p.args.size()!=n.args.size()) {
-        // do nothing
-    }
-    else {
-		for (unsigned i = 0; i < p.args.size(); i++) {
-            matchResult oPrime = match(p.args[i], n.args[i]);
-            if (!oPrime.success) {
-                o.success = false;
-                return o;
-            }
-            for (std::map<std::string, Node>::iterator it = oPrime.map.begin();
-                 it != oPrime.map.end();
-                 it++) {
-                o.map[(*it).first] = (*it).second;
-            }
-        }
-        o.success = true;
-    }
+    o.success = matchInto(p, n, o.map);
+    if (!o.success)
+        o.map.clear();
     return o;
 }
 
@@ -153,7 +152,7 @@ matchResult match(Node p, Node n) {
 // nodes (these dicts are generated by match). Match and subst together
 // create a full pattern-matching engine. 
 Node subst(Node pattern,
-           std::map<std::string, Node> dict,
+           std::map<std::string, Node> const& dict,
            std::string varflag,
            Metadata m) {
     // Swap out patterns at the token level
@@ -161,8 +160,10 @@ Node subst(Node pattern,
         pattern.metadata = m;
     if (pattern.type == TOKEN && 
             pattern.val[0] == '$') {
-        if (dict.count(pattern.val.substr(1))) {
-            return dict[pattern.val.substr(1)];
+        std::map<std::string, Node>::const_iterator it =
+            dict.find(pattern.val.substr(1));
+        if (it != dict.end()) {
+            return it->second;
         }
         else {
             return token(varflag + pattern.val.substr(1), m);
@@ -38,11 +38,11 @@ struct matchResult {
 };
 
 // Match node to pattern
-matchResult match(Node p, Node n);
+matchResult match(Node const& p, Node const& n);
 
 // Substitute node using pattern
 Node subst(Node pattern,
-           std::map<std::string, Node> dict,
+           std::map<std::string, Node> const& dict,
            std::string varflag,
            Metadata m);
 
@@ -58,17 +58,28 @@ class rewriteRule {
         Node substitution;
 };
 
+// Rules are kept by the head and the number of arguments of their
+// patterns, the only nodes they can match, so that each node is tried
+// against only the few rules that might apply to it
 class rewriteRuleSet {
     public:
         rewriteRuleSet() {
-            ruleLists = std::map<std::string, std::vector<rewriteRule> >();
+            ruleLists = std::map<std::string, std::map<unsigned, std::vector<rewriteRule> > >();
         }
         void addRule(rewriteRule r) {
-            if (!ruleLists.count(r.pattern.val))
-                ruleLists[r.pattern.val] = std::vector<rewriteRule>();
-            ruleLists[r.pattern.val].push_back(r);
+            ruleLists[r.pattern.val][r.pattern.args.size()].push_back(r);
         }
-        std::map<std::string, std::vector<rewriteRule> > ruleLists;
+        // The rules that might match a node of head val with n
+        // arguments, in the order they were added, or NULL if none
+        std::vector<rewriteRule> const* rulesFor(std::string const& val,
+                                                 unsigned n) const {
+            std::map<std::string, std::map<unsigned, std::vector<rewriteRule> > >::const_iterator it = ruleLists.find(val);
+            if (it == ruleLists.end())
+                return NULL;
+            std::map<unsigned, std::vector<rewriteRule> >::const_iterator jt = it->second.find(n);
+            return jt == it->second.end() ? NULL : &jt->second;
+        }
+        std::map<std::string, std::map<unsigned, std::vector<rewriteRule> > > ruleLists;
 };
 
 
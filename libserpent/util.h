@@ -45,10 +45,16 @@ std::string mkUniqueToken();
 // type can be TOKEN or ASTNODE
 class Node {
     public:
+        Node(): type(TOKEN), normalIn(0) {}
         int type;
         std::string val;
         std::vector<Node> args;
         Metadata metadata;
+        // Nonzero if a rewriting pass numbered so found nothing to
+        // rewrite in this subtree (see rewriter.cpp); copies made
+        // while it is rewritten keep it, as they need no rewriting
+        // either
+        unsigned normalIn;
 };
 Node token(std::string val, Metadata met=Metadata());
 Node astnode(std::string val, std::vector<Node> args, Metadata met=Metadata());
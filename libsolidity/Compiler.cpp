@@ -173,12 +173,24 @@ void Compiler::appendFunctionSelector(ContractDefinition const& _contract)
 		CompilerUtils(m_context).loadFromMemory(0, IntegerType(CompilerUtils::dataStartOffset * 8), true);
 
 	// stack now is: 1 0 <funhash>
+	vector<pair<FixedHash<4>, eth::AssemblyItem>> entryPoints;
 	for (auto const& it: interfaceFunctions)
 	{
 		callDataUnpackerEntryPoints.insert(std::make_pair(it.first, m_context.newTag()));
-		m_context << eth::dupInstruction(1) << u256(FixedHash<4>::Arith(it.first)) << eth::Instruction::EQ;
-		m_context.appendConditionalJumpTo(callDataUnpackerEntryPoints.at(it.first));
+		entryPoints.push_back(make_pair(it.first, callDataUnpackerEntryPoints.at(it.first)));
 	}
+	if (entryPoints.size() > c_linearSelectorFunctions)
+	{
+		eth::AssemblyItem notFound = m_context.newTag();
+		appendFunctionSelectorSearch(entryPoints, 0, entryPoints.size(), notFound);
+		m_context << notFound;
+	}
+	else
+		for (auto const& entryPoint: entryPoints)
+		{
+			m_context << eth::dupInstruction(1) << u256(FixedHash<4>::Arith(entryPoint.first)) << eth::Instruction::EQ;
+			m_context.appendConditionalJumpTo(entryPoint.second);
+		}
 	if (FunctionDefinition const* fallback = _contract.getFallbackFunction())
 	{
 		eth::AssemblyItem returnTag = m_context.pushNewTag();
@@ -203,6 +215,33 @@ void Compiler::appendFunctionSelector(ContractDefinition const& _contract)
 	}
 }
 
+void Compiler::appendFunctionSelectorSearch(
+	vector<pair<FixedHash<4>, eth::AssemblyItem>> const& _entryPoints,
+	size_t _begin,
+	size_t _end,
+	eth::AssemblyItem const& _notFound
+)
+{
+	if (_end - _begin <= c_linearSelectorFunctions)
+	{
+		for (size_t i = _begin; i < _end; ++i)
+		{
+			m_context << eth::dupInstruction(1) << u256(FixedHash<4>::Arith(_entryPoints[i].first)) << eth::Instruction::EQ;
+			m_context.appendConditionalJumpTo(_entryPoints[i].second);
+		}
+		m_context.appendJumpTo(_notFound);
+		return;
+	}
+	// The upper half starts at the middle selector; the lower half is jumped to if the one called is below it.
+	size_t middle = _begin + (_end - _begin) / 2;
+	eth::AssemblyItem lowerHalf = m_context.newTag();
+	m_context << eth::dupInstruction(1) << u256(FixedHash<4>::Arith(_entryPoints[middle].first)) << eth::Instruction::GT;
+	m_context.appendConditionalJumpTo(lowerHalf);
+	appendFunctionSelectorSearch(_entryPoints, middle, _end, _notFound);
+	m_context << lowerHalf;
+	appendFunctionSelectorSearch(_entryPoints, _begin, middle, _notFound);
+}
+
 void Compiler::appendCalldataUnpacker(TypePointers const& _typeParameters, bool _fromMemory)
 {
 	// We do not check the calldata size, everything is zero-padded.
@@ -34,13 +34,14 @@ namespace solidity {
 class Compiler: private ASTConstVisitor
 {
 public:
-	explicit Compiler(bool _optimize = false): m_optimize(_optimize), m_context(),
+	/// @a _runs is how many times the optimiser takes the runtime code to run for each deployment.
+	explicit Compiler(bool _optimize = false, unsigned _runs = eth::c_optimiseRuns): m_optimize(_optimize), m_runs(_runs), m_context(),
 		m_returnTag(m_context.newTag()) {}
 
 	void compileContract(ContractDefinition const& _contract,
 						 std::map<ContractDefinition const*, bytes const*> const& _contracts);
-	bytes getAssembledBytecode() { return m_context.getAssembledBytecode(m_optimize); }
-	bytes getRuntimeBytecode() { return m_runtimeContext.getAssembledBytecode(m_optimize);}
+	bytes getAssembledBytecode() { return m_context.getAssembledBytecode(m_optimize, true, m_runs); }
+	bytes getRuntimeBytecode() { return m_runtimeContext.getAssembledBytecode(m_optimize, false, m_runs); }
 	/// @arg _sourceCodes is the map of input files to source code strings
 	void streamAssembly(std::ostream& _stream, StringMap const& _sourceCodes = StringMap()) const
 	{
@@ -61,6 +62,15 @@ private:
 	void appendBaseConstructor(FunctionDefinition const& _constructor);
 	void appendConstructor(FunctionDefinition const& _constructor);
 	void appendFunctionSelector(ContractDefinition const& _contract);
+	/// Appends a binary search for the function selector on the stack among @a _entryPoints[_begin, _end), sorted by
+	/// selector, jumping to its entry point, or to @a _notFound if it is none of them. Ranges of no more than
+	/// c_linearSelectorFunctions are compared one by one.
+	void appendFunctionSelectorSearch(
+		std::vector<std::pair<FixedHash<4>, eth::AssemblyItem>> const& _entryPoints,
+		size_t _begin,
+		size_t _end,
+		eth::AssemblyItem const& _notFound
+	);
 	/// Creates code that unpacks the arguments for the given function represented by a vector of TypePointers.
 	/// From memory if @a _fromMemory is true, otherwise from call data.
 	void appendCalldataUnpacker(TypePointers const& _typeParameters, bool _fromMemory = false);
@@ -87,7 +97,11 @@ private:
 
 	void compileExpression(Expression const& _expression, TypePointer const& _targetType = TypePointer());
 
+	/// Up to this many functions, a selector is compared with each of them in turn rather than searched for.
+	static unsigned const c_linearSelectorFunctions = 4;
+
 	bool const m_optimize;
+	unsigned const m_runs;
 	CompilerContext m_context;
 	CompilerContext m_runtimeContext;
 	std::vector<eth::AssemblyItem> m_breakTags; ///< tag to jump to for a "break" statement
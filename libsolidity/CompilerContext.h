@@ -124,7 +124,8 @@ public:
 	/// @arg _sourceCodes is the map of input files to source code strings
 	void streamAssembly(std::ostream& _stream, StringMap const& _sourceCodes = StringMap()) const { m_asm.stream(_stream, "", _sourceCodes); }
 
-	bytes getAssembledBytecode(bool _optimize = false) { return m_asm.optimise(_optimize).assemble(); }
+	/// @a _isCreation if the code is run once to create the contract, with the runtime code as a subassembly.
+	bytes getAssembledBytecode(bool _optimize = false, bool _isCreation = true, unsigned _runs = eth::c_optimiseRuns) { return m_asm.optimise(_optimize, _isCreation, _runs).assemble(); }
 
 	/**
 	 * Helper class to pop the visited nodes stack when a scope closes
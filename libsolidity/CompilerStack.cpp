@@ -31,6 +31,7 @@
 #include <libsolidity/CompilerStack.h>
 #include <libsolidity/InterfaceHandler.h>
 
+#include <libdevcore/ThreadPool.h>
 #include <libdevcrypto/SHA3.h>
 
 using namespace std;
@@ -54,6 +55,23 @@ const map<string, string> StandardSources = map<string, string>{
 	{"std", R"(import "owned";import "mortal";import "Config";import "configUser";import "NameReg";import "named";)"}
 };
 
+/// The contracts that code of a contract, or of its bases, creates.
+class CreatedContracts: private ASTConstVisitor
+{
+public:
+	explicit CreatedContracts(ContractDefinition const& _contract)
+	{
+		for (ContractDefinition const* base: _contract.getLinearizedBaseContracts())
+			base->accept(*this);
+	}
+	set<ContractDefinition const*> const& get() const { return m_created; }
+
+private:
+	virtual bool visit(NewExpression const& _new) override { m_created.insert(_new.getContract()); return true; }
+
+	set<ContractDefinition const*> m_created;
+};
+
 CompilerStack::CompilerStack(bool _addStandardSources):
 	m_addStandardSources(_addStandardSources), m_parseSuccessful(false)
 {
@@ -63,26 +81,37 @@ CompilerStack::CompilerStack(bool _addStandardSources):
 
 bool CompilerStack::addSource(string const& _name, string const& _content, bool _isLibrary)
 {
-	bool existed = m_sources.count(_name) != 0;
+	h256 hash = dev::sha3(_content);
+	auto it = m_sources.find(_name);
+	if (it != m_sources.end() && it->second.hash == hash && it->second.isLibrary == _isLibrary)
+		// Unchanged, so whatever was parsed and compiled still stands.
+		return true;
+	bool existed = it != m_sources.end();
 	reset(true);
 	m_sources[_name].scanner = make_shared<Scanner>(CharStream(_content), _name);
 	m_sources[_name].isLibrary = _isLibrary;
+	m_sources[_name].hash = hash;
 	return existed;
 }
 
 void CompilerStack::setSource(string const& _sourceCode)
 {
-	reset();
+	for (auto const& sourcePair: m_sources)
+		if (!sourcePair.first.empty() && !(m_addStandardSources && StandardSources.count(sourcePair.first)))
+		{
+			reset();
+			break;
+		}
 	addSource("", _sourceCode);
 }
 
 void CompilerStack::parse()
 {
+	if (m_parseSuccessful)
+		return;
+	// Nothing of an earlier, failed parse can be trusted; sources are parsed again as the imports reach them.
 	for (auto& sourcePair: m_sources)
-	{
-		sourcePair.second.scanner->reset();
-		sourcePair.second.ast = Parser().parse(sourcePair.second.scanner);
-	}
+		sourcePair.second.reset();
 	resolveImports();
 
 	m_globalContext = make_shared<GlobalContext>();
@@ -128,32 +157,72 @@ vector<string> CompilerStack::getContractNames() const
 }
 
 
-void CompilerStack::compile(bool _optimize)
+void CompilerStack::compile(bool _optimize, unsigned _runs)
 {
 	if (!m_parseSuccessful)
 		parse();
+	else if (m_compiled && m_optimize == _optimize && m_runs == _runs)
+		return;
+	m_compiled = false;
 
-	map<ContractDefinition const*, bytes const*> contractBytecode;
+	vector<ContractDefinition const*> todo;
 	for (Source const* source: m_sourceOrder)
 		for (ASTPointer<ASTNode> const& node: source->ast->getNodes())
-			if (ContractDefinition* contract = dynamic_cast<ContractDefinition*>(node.get()))
-			{
-				if (!contract->isFullyImplemented())
-					continue;
-				shared_ptr<Compiler> compiler = make_shared<Compiler>(_optimize);
-				compiler->compileContract(*contract, contractBytecode);
-				Contract& compiledContract = m_contracts[contract->getName()];
-				compiledContract.bytecode = compiler->getAssembledBytecode();
-				compiledContract.runtimeBytecode = compiler->getRuntimeBytecode();
-				compiledContract.compiler = move(compiler);
-				contractBytecode[compiledContract.contract] = &compiledContract.bytecode;
-			}
+			if (ContractDefinition const* contract = dynamic_cast<ContractDefinition const*>(node.get()))
+				if (contract->isFullyImplemented())
+					todo.push_back(contract);
+
+	// Generating code walks the AST, which is not safe to share between threads, so it goes one contract at a time,
+	// each once the contracts it creates are done. Optimising and assembling then only touch the contract's own
+	// assembly, and run on the thread pool for all the contracts generated in a round.
+	map<ContractDefinition const*, bytes const*> contractBytecode;
+	set<ContractDefinition const*> pending(todo.begin(), todo.end());
+	while (!todo.empty())
+	{
+		vector<ContractDefinition const*> round;
+		vector<ContractDefinition const*> later;
+		for (ContractDefinition const* contract: todo)
+		{
+			set<ContractDefinition const*> created = CreatedContracts(*contract).get();
+			bool ready = none_of(created.begin(), created.end(), [&](ContractDefinition const* c) { return pending.count(c); });
+			(ready ? round : later).push_back(contract);
+		}
+		if (round.empty())
+			// Contracts creating each other; compiling them reports it.
+			swap(round, later);
+
+		vector<shared_ptr<Compiler>> compilers;
+		for (ContractDefinition const* contract: round)
+		{
+			compilers.push_back(make_shared<Compiler>(_optimize, _runs));
+			compilers.back()->compileContract(*contract, contractBytecode);
+		}
+		vector<bytes> bytecode(round.size() * 2);
+		ThreadPool::get().forEach(bytecode.size(), [&](unsigned i)
+		{
+			bytecode[i] = i % 2 ? compilers[i / 2]->getRuntimeBytecode() : compilers[i / 2]->getAssembledBytecode();
+		});
+
+		for (unsigned i = 0; i < round.size(); ++i)
+		{
+			Contract& compiledContract = m_contracts[round[i]->getName()];
+			compiledContract.bytecode = move(bytecode[i * 2]);
+			compiledContract.runtimeBytecode = move(bytecode[i * 2 + 1]);
+			compiledContract.compiler = move(compilers[i]);
+			contractBytecode[compiledContract.contract] = &compiledContract.bytecode;
+			pending.erase(round[i]);
+		}
+		todo = move(later);
+	}
+	m_compiled = true;
+	m_optimize = _optimize;
+	m_runs = _runs;
 }
 
-bytes const& CompilerStack::compile(string const& _sourceCode, bool _optimize)
+bytes const& CompilerStack::compile(string const& _sourceCode, bool _optimize, unsigned _runs)
 {
 	parse(_sourceCode);
-	compile(_optimize);
+	compile(_optimize, _runs);
 	return getBytecode();
 }
 
@@ -234,7 +303,10 @@ Scanner const& CompilerStack::getScanner(string const& _sourceName) const
 
 SourceUnit const& CompilerStack::getAST(string const& _sourceName) const
 {
-	return *getSource(_sourceName).ast;
+	Source const& source = getSource(_sourceName);
+	if (!source.ast)
+		BOOST_THROW_EXCEPTION(CompilerError() << errinfo_comment("Source was not parsed."));
+	return *source.ast;
 }
 
 ContractDefinition const& CompilerStack::getContractDefinition(string const& _contractName) const
@@ -251,14 +323,15 @@ bytes CompilerStack::staticCompile(std::string const& _sourceCode, bool _optimiz
 void CompilerStack::reset(bool _keepSources)
 {
 	m_parseSuccessful = false;
+	m_compiled = false;
 	if (_keepSources)
-		for (auto sourcePair: m_sources)
+		for (auto& sourcePair: m_sources)
 			sourcePair.second.reset();
 	else
 	{
 		m_sources.clear();
 		if (m_addStandardSources)
-			addSources(StandardSources);
+			addSources(StandardSources, true);
 	}
 	m_globalContext.reset();
 	m_sourceOrder.clear();
@@ -267,15 +340,18 @@ void CompilerStack::reset(bool _keepSources)
 
 void CompilerStack::resolveImports()
 {
-	// topological sorting (depth first search) of the import graph, cutting potential cycles
+	// topological sorting (depth first search) of the import graph, cutting potential cycles; a source is only
+	// parsed once reached, so libraries which nothing imports are never parsed
 	vector<Source const*> sourceOrder;
 	set<Source const*> sourcesSeen;
 
-	function<void(Source const*)> toposort = [&](Source const* _source)
+	function<void(Source*)> toposort = [&](Source* _source)
 	{
 		if (sourcesSeen.count(_source))
 			return;
 		sourcesSeen.insert(_source);
+		_source->scanner->reset();
+		_source->ast = Parser().parse(_source->scanner);
 		for (ASTPointer<ASTNode> const& node: _source->ast->getNodes())
 			if (ImportDirective const* import = dynamic_cast<ImportDirective*>(node.get()))
 			{
@@ -289,7 +365,7 @@ void CompilerStack::resolveImports()
 		sourceOrder.push_back(_source);
 	};
 
-	for (auto const& sourcePair: m_sources)
+	for (auto& sourcePair: m_sources)
 		if (!sourcePair.second.isLibrary)
 			toposort(&sourcePair.second);
 
@@ -309,7 +385,7 @@ CompilerStack::Contract const& CompilerStack::getContract(string const& _contrac
 	if (_contractName.empty())
 		// try to find some user-supplied contract
 		for (auto const& it: m_sources)
-			if (!StandardSources.count(it.first))
+			if (!StandardSources.count(it.first) && it.second.ast)
 				for (ASTPointer<ASTNode> const& node: it.second.ast->getNodes())
 					if (auto contract = dynamic_cast<ContractDefinition const*>(node.get()))
 						contractName = contract->getName();
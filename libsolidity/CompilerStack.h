@@ -30,6 +30,7 @@
 #include <boost/noncopyable.hpp>
 #include <libdevcore/Common.h>
 #include <libdevcore/FixedHash.h>
+#include <libevmcore/GasMeter.h>
 
 namespace dev
 {
@@ -70,12 +71,14 @@ public:
 	/// Creates a new compiler stack. Adds standard sources if @a _addStandardSources.
 	explicit CompilerStack(bool _addStandardSources = true);
 
-	/// Adds a source object (e.g. file) to the parser. After this, parse has to be called again.
+	/// Adds a source object (e.g. file) to the parser. After this, parse has to be called again, unless a source
+	/// by the name and with the same content was there already, in which case nothing changes.
 	/// @returns true if a source object by the name already existed and was replaced.
 	void addSources(StringMap const& _nameContents, bool _isLibrary = false) { for (auto const& i: _nameContents) addSource(i.first, i.second, _isLibrary); }
 	bool addSource(std::string const& _name, std::string const& _content, bool _isLibrary = false);
 	void setSource(std::string const& _sourceCode);
-	/// Parses all source units that were added
+	/// Parses the source units that were added, apart from libraries that nothing imports.
+	/// Does nothing if no source changed since the last successful parse.
 	void parse();
 	/// Sets the given source code as the only source unit apart from standard sources and parses it.
 	void parse(std::string const& _sourceCode);
@@ -84,10 +87,13 @@ public:
 	std::string defaultContractName() const;
 
 	/// Compiles the source units that were previously added and parsed.
-	void compile(bool _optimize = false);
+	/// Does nothing if no source and neither setting changed since the last successful compilation.
+	/// @a _runs is how many times the optimiser takes each contract's code to be run for each time it is deployed:
+	/// the higher, the more it favours cheaper execution over smaller code.
+	void compile(bool _optimize = false, unsigned _runs = eth::c_optimiseRuns);
 	/// Parses and compiles the given source code.
 	/// @returns the compiled bytecode
-	bytes const& compile(std::string const& _sourceCode, bool _optimize = false);
+	bytes const& compile(std::string const& _sourceCode, bool _optimize = false, unsigned _runs = eth::c_optimiseRuns);
 
 	/// @returns the assembled bytecode for a contract.
 	bytes const& getBytecode(std::string const& _contractName = "") const;
@@ -139,7 +145,8 @@ private:
 		std::shared_ptr<SourceUnit> ast;
 		std::string interface;
 		bool isLibrary = false;
-		void reset() { scanner.reset(); ast.reset(); interface.clear(); isLibrary = false;}
+		h256 hash;	///< Of the content, to tell whether adding it again changes it.
+		void reset() { ast.reset(); interface.clear(); }
 	};
 
 	struct Contract
@@ -165,6 +172,9 @@ private:
 
 	bool m_addStandardSources; ///< If true, standard sources are added.
 	bool m_parseSuccessful;
+	bool m_compiled = false;	///< True if the contracts were compiled since the last parse, with the settings below.
+	bool m_optimize = false;
+	unsigned m_runs = 0;
 	std::map<std::string const, Source> m_sources;
 	std::shared_ptr<GlobalContext> m_globalContext;
 	std::vector<Source const*> m_sourceOrder;
@@ -0,0 +1,225 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file ConstantEvaluator.cpp
+ * @date 2015
+ * Evaluation of expressions whose value is known at compile time.
+ */
+
+#include <libsolidity/ConstantEvaluator.h>
+#include <libdevcore/CommonData.h>
+#include <libdevcrypto/SHA3.h>
+#include <libsolidity/AST.h>
+#include <libsolidity/Types.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::solidity;
+
+bool ConstantEvaluator::evaluate(Expression const& _expression, u256& o_value)
+{
+	Type const& type = *_expression.getType();
+	if (type.getCategory() == Type::Category::IntegerConstant)
+	{
+		o_value = type.literalValue(nullptr);
+		return true;
+	}
+	if (auto literal = dynamic_cast<Literal const*>(&_expression))
+	{
+		if (type.getCategory() != Type::Category::Bool && type.getCategory() != Type::Category::FixedBytes)
+			return false;
+		o_value = type.literalValue(literal);
+		return true;
+	}
+	if (auto identifier = dynamic_cast<Identifier const*>(&_expression))
+	{
+		auto variable = dynamic_cast<VariableDeclaration const*>(identifier->getReferencedDeclaration());
+		if (!variable || !variable->isConstant() || !variable->getValue())
+			return false;
+		Expression const& value = *variable->getValue();
+		return evaluate(value, o_value) && convert(o_value, *value.getType(), *variable->getType());
+	}
+	if (auto operation = dynamic_cast<UnaryOperation const*>(&_expression))
+		return evaluateUnary(*operation, o_value);
+	if (auto operation = dynamic_cast<BinaryOperation const*>(&_expression))
+		return evaluateBinary(*operation, o_value);
+	if (auto call = dynamic_cast<FunctionCall const*>(&_expression))
+		return evaluateCall(*call, o_value);
+	return false;
+}
+
+bool ConstantEvaluator::evaluateUnary(UnaryOperation const& _operation, u256& o_value)
+{
+	Type const& type = *_operation.getType();
+	Token::Value const op = _operation.getOperator();
+	if (op != Token::Not && op != Token::BitNot && op != Token::Add && op != Token::Sub)
+		return false;
+	if (!evaluate(_operation.getSubExpression(), o_value))
+		return false;
+	if (op == Token::Not)
+		o_value = o_value ? 0 : 1;
+	else if (type.getCategory() != Type::Category::Integer)
+		return false;
+	else if (op == Token::BitNot)
+		o_value = cleanup(~o_value, dynamic_cast<IntegerType const&>(type));
+	else if (op == Token::Sub)
+		o_value = cleanup(0 - o_value, dynamic_cast<IntegerType const&>(type));
+	return true;
+}
+
+bool ConstantEvaluator::evaluateBinary(BinaryOperation const& _operation, u256& o_value)
+{
+	Type const& commonType = _operation.getCommonType();
+	Token::Value const op = _operation.getOperator();
+	Expression const& left = _operation.getLeftExpression();
+	Expression const& right = _operation.getRightExpression();
+	u256 a;
+	u256 b;
+	if (
+		!evaluate(left, a) || !convert(a, *left.getType(), commonType) ||
+		!evaluate(right, b) || !convert(b, *right.getType(), commonType)
+	)
+		return false;
+
+	if (op == Token::And || op == Token::Or)
+		o_value = op == Token::And ? (a && b) : (a || b);
+	else if (op == Token::Equal || op == Token::NotEqual)
+		o_value = (a == b) == (op == Token::Equal);
+	else if (Token::isBitOp(op))
+		o_value = op == Token::BitAnd ? (a & b) : op == Token::BitOr ? (a | b) : (a ^ b);
+	else if (commonType.getCategory() != Type::Category::Integer)
+		return false;
+	else
+	{
+		IntegerType const& type = dynamic_cast<IntegerType const&>(commonType);
+		bool const c_isSigned = type.isSigned();
+		switch (op)
+		{
+		case Token::LessThan:
+			o_value = c_isSigned ? u2s(a) < u2s(b) : a < b;
+			break;
+		case Token::GreaterThan:
+			o_value = c_isSigned ? u2s(a) > u2s(b) : a > b;
+			break;
+		case Token::LessThanOrEqual:
+			o_value = c_isSigned ? u2s(a) <= u2s(b) : a <= b;
+			break;
+		case Token::GreaterThanOrEqual:
+			o_value = c_isSigned ? u2s(a) >= u2s(b) : a >= b;
+			break;
+		case Token::Add:
+			o_value = cleanup(a + b, type);
+			break;
+		case Token::Sub:
+			o_value = cleanup(a - b, type);
+			break;
+		case Token::Mul:
+			o_value = cleanup(a * b, type);
+			break;
+		// As DIV, SDIV, MOD and SMOD, division by zero gives zero.
+		case Token::Div:
+			o_value = b == 0 ? 0 : cleanup(c_isSigned ? s2u(u2s(a) / u2s(b)) : a / b, type);
+			break;
+		case Token::Mod:
+			o_value = b == 0 ? 0 : cleanup(c_isSigned ? s2u(u2s(a) % u2s(b)) : a % b, type);
+			break;
+		case Token::Exp:
+			o_value = cleanup(u256(boost::multiprecision::powm(bigint(a), bigint(b), bigint(1) << 256)), type);
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ConstantEvaluator::evaluateCall(FunctionCall const& _call, u256& o_value)
+{
+	vector<ASTPointer<Expression const>> const& arguments = _call.getArguments();
+	if (_call.isTypeConversion())
+		return arguments.size() == 1 && evaluate(*arguments.front(), o_value) &&
+			convert(o_value, *arguments.front()->getType(), *_call.getType());
+
+	auto function = dynamic_cast<FunctionType const*>(_call.getExpression().getType().get());
+	if (!function || function->getLocation() != FunctionType::Location::SHA3 || !_call.getNames().empty())
+		return false;
+	// The arguments are laid out in memory as by appendArgumentsCopyToMemory, each as its real type.
+	bytes data;
+	for (ASTPointer<Expression const> const& argument: arguments)
+	{
+		TypePointer type = argument->getType()->getRealType();
+		u256 value;
+		if (!evaluate(*argument, value) || !convert(value, *argument->getType(), *type))
+			return false;
+		unsigned size = type->getCalldataEncodedSize(function->padArguments());
+		if (size == 0 || size > 32)
+			return false;
+		bytes word = toBigEndian(value);
+		if (type->getCategory() == Type::Category::FixedBytes)
+			data.insert(data.end(), word.begin(), word.begin() + size);
+		else
+			data.insert(data.end(), word.end() - size, word.end());
+	}
+	o_value = u256(sha3(data));
+	return true;
+}
+
+bool ConstantEvaluator::convert(u256& io_value, Type const& _from, Type const& _to)
+{
+	if (_from == _to)
+		return true;
+	Type::Category from = _from.getCategory();
+	Type::Category to = _to.getCategory();
+	if (from == Type::Category::IntegerConstant || from == Type::Category::Integer)
+	{
+		if (to == Type::Category::Integer)
+			io_value = cleanup(io_value, dynamic_cast<IntegerType const&>(_to));
+		else if (to == Type::Category::FixedBytes)
+			io_value <<= 256 - dynamic_cast<FixedBytesType const&>(_to).getNumBytes() * 8;
+		else
+			return false;
+	}
+	else if (from == Type::Category::FixedBytes)
+	{
+		unsigned bits = dynamic_cast<FixedBytesType const&>(_from).getNumBytes() * 8;
+		if (to == Type::Category::Integer)
+			io_value = cleanup(io_value >> (256 - bits), dynamic_cast<IntegerType const&>(_to));
+		else if (to == Type::Category::FixedBytes)
+		{
+			unsigned targetBits = dynamic_cast<FixedBytesType const&>(_to).getNumBytes() * 8;
+			if (targetBits < bits)
+				io_value = targetBits == 0 ? 0 : (io_value >> (256 - targetBits)) << (256 - targetBits);
+		}
+		else
+			return false;
+	}
+	else
+		return false;
+	return true;
+}
+
+u256 ConstantEvaluator::cleanup(u256 const& _value, IntegerType const& _type)
+{
+	unsigned bits = _type.getNumBits();
+	if (bits >= 256)
+		return _value;
+	u256 mask = (u256(1) << bits) - 1;
+	u256 value = _value & mask;
+	if (_type.isSigned() && (value >> (bits - 1)) != 0)
+		value |= ~mask;
+	return value;
+}
@@ -0,0 +1,59 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @file ConstantEvaluator.h
+ * @date 2015
+ * Evaluation of expressions whose value is known at compile time.
+ */
+
+#pragma once
+
+#include <libdevcore/Common.h>
+#include <libsolidity/ASTForward.h>
+
+namespace dev
+{
+namespace solidity
+{
+
+class Type;
+class IntegerType;
+
+/**
+ * Works out the value of a typed expression built only from literals and constant state variables:
+ * arithmetic, bit operations and comparisons on integers and booleans, conversions between integer and
+ * fixed bytes types, and sha3 of such values. The value is the one the code for the expression would
+ * leave on the stack, wrapped around and cleaned up for the expression's type.
+ */
+class ConstantEvaluator
+{
+public:
+	/// @returns true and sets @a o_value to the value of @a _expression if it is known at compile time.
+	static bool evaluate(Expression const& _expression, u256& o_value);
+
+private:
+	static bool evaluateUnary(UnaryOperation const& _operation, u256& o_value);
+	static bool evaluateBinary(BinaryOperation const& _operation, u256& o_value);
+	static bool evaluateCall(FunctionCall const& _call, u256& o_value);
+	/// Converts @a io_value from @a _from to @a _to. @returns false if that conversion is not done here.
+	static bool convert(u256& io_value, Type const& _from, Type const& _to);
+	/// @returns @a _value with the bits above those of @a _type cleared or, for signed types, sign extended.
+	static u256 cleanup(u256 const& _value, IntegerType const& _type);
+};
+
+}
+}
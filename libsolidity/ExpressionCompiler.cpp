@@ -26,6 +26,7 @@
 #include <libdevcore/Common.h>
 #include <libdevcrypto/SHA3.h>
 #include <libsolidity/AST.h>
+#include <libsolidity/ConstantEvaluator.h>
 #include <libsolidity/ExpressionCompiler.h>
 #include <libsolidity/CompilerContext.h>
 #include <libsolidity/CompilerUtils.h>
@@ -285,6 +286,8 @@ bool ExpressionCompiler::visit(UnaryOperation const& _unaryOperation)
 		m_context << _unaryOperation.getType()->literalValue(nullptr);
 		return false;
 	}
+	if (appendConstantValue(_unaryOperation))
+		return false;
 
 	_unaryOperation.getSubExpression().accept(*this);
 
@@ -352,6 +355,8 @@ bool ExpressionCompiler::visit(BinaryOperation const& _binaryOperation)
 	Type const& commonType = _binaryOperation.getCommonType();
 	Token::Value const c_op = _binaryOperation.getOperator();
 
+	if (appendConstantValue(_binaryOperation))
+		return false;
 	if (c_op == Token::And || c_op == Token::Or) // special case: short-circuiting
 		appendAndOrOperatorCode(_binaryOperation);
 	else if (commonType.getCategory() == Type::Category::IntegerConstant)
@@ -395,6 +400,8 @@ bool ExpressionCompiler::visit(FunctionCall const& _functionCall)
 {
 	CompilerContext::LocationSetter locationSetter(m_context, _functionCall);
 	using Location = FunctionType::Location;
+	if (appendConstantValue(_functionCall))
+		return false;
 	if (_functionCall.isTypeConversion())
 	{
 		//@todo struct construction
@@ -829,7 +836,7 @@ void ExpressionCompiler::endVisit(Identifier const& _identifier)
 	{
 		if (!variable->isConstant())
 			setLValueFromDeclaration(*declaration, _identifier);
-		else
+		else if (!appendConstantValue(_identifier))
 			variable->getValue()->accept(*this);
 	}
 	else if (dynamic_cast<ContractDefinition const*>(declaration))
@@ -989,6 +996,15 @@ void ExpressionCompiler::appendShiftOperatorCode(Token::Value _operator)
 	}
 }
 
+bool ExpressionCompiler::appendConstantValue(Expression const& _expression)
+{
+	u256 value;
+	if (!m_optimize || !ConstantEvaluator::evaluate(_expression, value))
+		return false;
+	m_context << value;
+	return true;
+}
+
 void ExpressionCompiler::appendHighBitsCleanup(IntegerType const& _typeOnStack)
 {
 	if (_typeOnStack.getNumBits() == 256)
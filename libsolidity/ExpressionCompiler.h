@@ -94,6 +94,10 @@ private:
 	void appendShiftOperatorCode(Token::Value _operator);
 	/// @}
 
+	/// Pushes the value of @a _expression if optimising and it is known at compile time.
+	/// @returns true if it did so.
+	bool appendConstantValue(Expression const& _expression);
+
 	//// Appends code that cleans higher-order bits for integer types.
 	void appendHighBitsCleanup(IntegerType const& _typeOnStack);
 
@@ -184,8 +184,9 @@ BOOST_STATIC_ASSERT(Token::NUM_TOKENS <= 0x100);
 
 Token::Value Scanner::next()
 {
-	m_currentToken = m_nextToken;
-	m_skippedComment = m_nextSkippedComment;
+	// scanToken() clears the next token's literals, so they need not be copied.
+	takeToken(m_currentToken, m_nextToken);
+	takeToken(m_skippedComment, m_nextSkippedComment);
 	scanToken();
 
 	return m_currentToken.token;
@@ -391,7 +392,8 @@ void Scanner::scanToken()
 		case '\n': // fall-through
 		case ' ':
 		case '\t':
-			token = selectToken(Token::Whitespace);
+			skipWhitespace();
+			token = Token::Whitespace;
 			break;
 		case '"':
 		case '\'':
@@ -707,10 +709,12 @@ Token::Value Scanner::scanIdentifierOrKeyword()
 {
 	solAssert(isIdentifierStart(m_char), "");
 	LiteralScope literal(this, LITERAL_TYPE_STRING);
-	addLiteralCharAndAdvance();
-	// Scan the rest of the identifier characters.
+	int const start = getSourcePos();
+	advance();
+	// Scan the rest of the identifier characters, then take them from the source in one go.
 	while (isIdentifierPart(m_char))
-		addLiteralCharAndAdvance();
+		advance();
+	m_nextToken.literal.assign(m_source.getSource(), start, getSourcePos() - start);
 	literal.complete();
 	return Token::fromIdentifierOrKeyword(m_nextToken.literal);
 }
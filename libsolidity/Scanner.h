@@ -80,6 +80,7 @@ public:
 	char rollback(size_t _amount);
 
 	void reset() { m_pos = 0; }
+	std::string const& getSource() const { return m_source; }
 
 	///@{
 	///@name Error printing helper functions
@@ -161,6 +162,8 @@ private:
 		SourceLocation location;
 		std::string literal;
 	};
+	/// Moves @a _from into @a _to, handing _from the buffer of _to's literal rather than a copy.
+	static void takeToken(TokenDesc& _to, TokenDesc& _from) { _to.token = _from.token; _to.location = _from.location; _to.literal.swap(_from.literal); }
 
 	///@{
 	///@name Literal buffer support
@@ -40,7 +40,7 @@
 // You should have received a copy of the GNU General Public License
 // along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
 
-#include <map>
+#include <unordered_map>
 #include <libsolidity/Token.h>
 
 using namespace std;
@@ -86,7 +86,7 @@ Token::Value Token::fromIdentifierOrKeyword(const std::string& _name)
 	// and keywords to be put inside the keywords variable.
 #define KEYWORD(name, string, precedence) {string, Token::name},
 #define TOKEN(name, string, precedence)
-	static const map<string, Token::Value> keywords({TOKEN_LIST(TOKEN, KEYWORD)});
+	static const unordered_map<string, Token::Value> keywords({TOKEN_LIST(TOKEN, KEYWORD)});
 #undef KEYWORD
 #undef TOKEN
 	auto it = keywords.find(_name);
@@ -31,11 +31,11 @@ using namespace dev::eth;
 BlockChainLoader::BlockChainLoader(Json::Value const& _json)
 {
 	// load pre state
-	StateLoader sl(_json["pre"], m_dir.path());
+	StateLoader sl(_json["pre"], c_memoryDBPath);
 	m_state = sl.state();
 
 	// load genesisBlock
-	m_bc.reset(new BlockChain(fromHex(_json["genesisRLP"].asString()), m_dir.path(), WithExisting::Kill));
+	m_bc.reset(new BlockChain(fromHex(_json["genesisRLP"].asString()), c_memoryDBPath, WithExisting::Kill));
 	assert(m_state.rootHash() == m_bc->info().stateRoot);
 
 	// load blocks
@@ -22,7 +22,6 @@
 #pragma once
 #include <string>
 #include <json/json.h>
-#include <libdevcore/TransientDirectory.h>
 #include <libethereum/BlockChain.h>
 #include <libethereum/State.h>
 
@@ -43,7 +42,6 @@ public:
 	eth::State const& state() const { return m_state; }
 
 private:
-	TransientDirectory m_dir;
 	std::auto_ptr<eth::BlockChain> m_bc;
 	eth::State m_state;
 };
@@ -0,0 +1,374 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file IpcServer.cpp
+ * @date 2015
+ */
+
+#include "IpcServer.h"
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+#include <libdevcore/Log.h>
+#include <libethereum/Client.h>
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+namespace ba = boost::asio;
+using ba::local::stream_protocol;
+
+/// The longest request taken; a client sending longer is disconnected.
+static const size_t c_maxRequestSize = 64 * 1024;
+/// The most blocks a request for logs may cover.
+static const unsigned c_maxLogBlocks = 1024;
+/// The most blocks given at once, and the size past which no more are added.
+static const unsigned c_maxBlocks = 1024;
+static const size_t c_maxBlocksSize = 16 * 1024 * 1024;
+
+IpcConnection::IpcConnection(IpcServer& _server):
+	m_server(_server),
+	m_socket(_server.m_io)
+{
+}
+
+void IpcConnection::read()
+{
+	auto self = shared_from_this();
+	ba::async_read(m_socket, ba::buffer(m_length), [self](boost::system::error_code const& _ec, size_t)
+	{
+		size_t length = ((size_t)self->m_length[0] << 24) | ((size_t)self->m_length[1] << 16) | ((size_t)self->m_length[2] << 8) | self->m_length[3];
+		if (_ec || !length || length > c_maxRequestSize)
+		{
+			self->close();
+			return;
+		}
+		self->m_in.resize(length);
+		ba::async_read(self->m_socket, ba::buffer(self->m_in), [self](boost::system::error_code const& _ec, size_t)
+		{
+			if (_ec)
+			{
+				self->close();
+				return;
+			}
+			bytes request = self->m_in;
+			self->m_server.m_worker.post([=](){ self->m_server.handle(self, request); });
+			self->read();
+		});
+	});
+}
+
+void IpcConnection::send(bytes const& _message)
+{
+	if (!m_open)
+		return;
+	bytes frame(4 + _message.size());
+	for (unsigned i = 0; i < 4; ++i)
+		frame[i] = (byte)(_message.size() >> (24 - 8 * i));
+	memcpy(frame.data() + 4, _message.data(), _message.size());
+	m_out.push_back(move(frame));
+	if (m_out.size() == 1)
+		write();
+}
+
+void IpcConnection::write()
+{
+	auto self = shared_from_this();
+	ba::async_write(m_socket, ba::buffer(m_out.front()), [self](boost::system::error_code const& _ec, size_t)
+	{
+		if (_ec)
+		{
+			self->close();
+			return;
+		}
+		self->m_out.pop_front();
+		if (!self->m_out.empty())
+			self->write();
+	});
+}
+
+void IpcConnection::close()
+{
+	if (!m_open)
+		return;
+	m_open = false;
+	boost::system::error_code ec;
+	m_socket.close(ec);
+	m_server.m_connections.erase(shared_from_this());
+}
+
+IpcServer::IpcServer(Client& _client, string const& _path, size_t _ringSize):
+	m_client(_client),
+	m_path(_path),
+	m_ringSize(_ringSize)
+{
+}
+
+IpcServer::~IpcServer()
+{
+	stop();
+}
+
+bool IpcServer::start()
+{
+	if (m_thread.joinable())
+		return false;
+	try
+	{
+		// A socket left by a node that did not stop cleanly would keep us from listening.
+		boost::filesystem::remove(m_path);
+		m_acceptor.reset(new stream_protocol::acceptor(m_io, stream_protocol::endpoint(m_path)));
+	}
+	catch (...)
+	{
+		cwarn << "Couldn't listen for local clients on" << m_path << ":" << boost::current_exception_diagnostic_information();
+		return false;
+	}
+	if (m_ringSize)
+	{
+		m_ring.reset(new SharedRing(ringPath(), m_ringSize));
+		if (!m_ring->isOpen())
+		{
+			cwarn << "Couldn't map" << ringPath() << "; new blocks are only to be had through" << m_path;
+			m_ring.reset();
+		}
+	}
+	m_exported = m_client.blockChain().currentHash();
+
+	m_worker.reset();
+	m_workerWork.reset(new ba::io_service::work(m_worker));
+	m_workerThread = std::thread([=](){ m_worker.run(); });
+
+	m_io.reset();
+	accept();
+	m_thread = std::thread([=](){ m_io.run(); });
+
+	m_client.onChainChanged([=](){ noteChainChanged(); });
+	return true;
+}
+
+void IpcServer::stop()
+{
+	if (!m_thread.joinable())
+		return;
+	m_client.onChainChanged(function<void()>());
+	m_io.post([=]()
+	{
+		boost::system::error_code ec;
+		m_acceptor->close(ec);
+		auto connections = m_connections;
+		for (auto const& c: connections)
+			c->close();
+		m_io.stop();
+	});
+	m_thread.join();
+	m_acceptor.reset();
+	boost::system::error_code ec;
+	boost::filesystem::remove(m_path, ec);
+
+	m_workerWork.reset();
+	m_worker.stop();
+	m_workerThread.join();
+	m_ring.reset();
+	m_exporting = false;
+}
+
+void IpcServer::accept()
+{
+	auto c = make_shared<IpcConnection>(*this);
+	m_acceptor->async_accept(c->m_socket, [=](boost::system::error_code const& _ec)
+	{
+		if (_ec == ba::error::operation_aborted)
+			return;
+		if (!_ec)
+		{
+			m_connections.insert(c);
+			c->read();
+		}
+		accept();
+	});
+}
+
+void IpcServer::handle(shared_ptr<IpcConnection> const& _c, bytes const& _request)
+{
+	u256 id;
+	RLPStream response(3);
+	try
+	{
+		RLP r(_request);
+		id = r[0].toInt<u256>();
+		string method = r[1].toStringStrict();
+		bytes result;
+		if (!id)
+			throw invalid_argument("Id must not be zero");
+		if (method == "subscribe")
+		{
+			m_io.post([=](){ _c->m_subscribed = true; });
+			result = rlp(true);
+		}
+		else
+			result = answer(method, r);
+		response << id << 0;
+		response.appendRaw(result);
+	}
+	catch (invalid_argument const& _e)
+	{
+		response.clear();
+		response.appendList(3) << id << 1 << string(_e.what());
+	}
+	catch (...)
+	{
+		response.clear();
+		response.appendList(3) << id << 1 << "Invalid request";
+	}
+	bytes out = response.out();
+	m_io.post([=](){ _c->send(out); });
+}
+
+bytes IpcServer::answer(string const& _method, RLP const& _request)
+{
+	BlockChain const& bc = m_client.blockChain();
+	if (_method == "head")
+	{
+		h256 h = bc.currentHash();
+		return rlpList(bc.number(h), h);
+	}
+	if (_method == "block")
+		return bc.block(blockHash(_request[2]));
+	if (_method == "header")
+	{
+		bytes block = bc.block(blockHash(_request[2]));
+		return RLP(block)[0].data().toBytes();
+	}
+	if (_method == "receipts")
+		return bc.receipts(blockHash(_request[2])).rlp();
+	if (_method == "blocks")
+	{
+		// Straight from where the chain keeps them, copied once.
+		unsigned from = _request[2].toInt<unsigned>();
+		unsigned count = min(_request[3].toInt<unsigned>(), c_maxBlocks);
+		bool withReceipts = _request.itemCount() > 4 && _request[4].toInt<unsigned>();
+		unsigned number = bc.number();
+		RLPStream blocks;
+		unsigned n = 0;
+		for (; from + n <= number && n < count && blocks.out().size() < c_maxBlocksSize; ++n)
+		{
+			h256 h = bc.numberHash(from + n);
+			auto b = bc.blockHandle(h);
+			if (withReceipts)
+				blocks.appendList(2);
+			blocks.appendRaw(b.data());
+			if (withReceipts)
+				blocks.appendRaw(bc.receipts(h).rlp());
+		}
+		RLPStream ret;
+		ret.appendList(n).appendRaw(blocks.out(), n);
+		return ret.out();
+	}
+	if (_method == "logs")
+	{
+		unsigned from = _request[2].toInt<unsigned>();
+		unsigned to = min(_request[3].toInt<unsigned>(), bc.number());
+		if (to >= from + c_maxLogBlocks)
+			throw invalid_argument("Too many blocks");
+		RLPStream logs;
+		unsigned count = 0;
+		for (unsigned n = from; n <= to; ++n)
+		{
+			TransactionReceipts receipts = bc.receipts(bc.numberHash(n)).receipts;
+			for (unsigned i = 0; i < receipts.size(); ++i)
+				for (LogEntry const& l: receipts[i].log())
+				{
+					logs.appendList(3) << n << i;
+					l.streamRLP(logs);
+					++count;
+				}
+		}
+		RLPStream ret;
+		ret.appendList(count).appendRaw(logs.out(), count);
+		return ret.out();
+	}
+	if (_method == "ring")
+	{
+		if (!m_ring)
+			throw invalid_argument("No ring");
+		return rlpList(ringPath(), (u256)m_ring->end());
+	}
+	throw invalid_argument("Method not found");
+}
+
+h256 IpcServer::blockHash(RLP const& _r) const
+{
+	BlockChain const& bc = m_client.blockChain();
+	h256 ret;
+	if (_r.isData() && _r.size() == h256::size)
+		ret = _r.toHash<h256>();
+	else
+	{
+		unsigned n = _r.toInt<unsigned>();
+		if (n <= bc.number())
+			ret = bc.numberHash(n);
+	}
+	if (!bc.isKnown(ret))
+		throw invalid_argument("Unknown block");
+	return ret;
+}
+
+void IpcServer::noteChainChanged()
+{
+	// However much changes while an export is on its way, it takes it all.
+	if (m_exporting.exchange(true))
+		return;
+	m_worker.post([=](){ exportNewBlocks(); });
+}
+
+void IpcServer::exportNewBlocks()
+{
+	m_exporting = false;
+	BlockChain const& bc = m_client.blockChain();
+	h256 head = bc.currentHash();
+	if (head == m_exported)
+		return;
+
+	// On a change of branch, those from where the branches meet are told of again, as they now are.
+	h256s route;
+	h256 common;
+	tie(route, common, ignore) = bc.treeRoute(m_exported, head, false, false, true);
+	vector<bytes> heads;
+	for (auto const& h: route)
+		if (h != common)
+		{
+			bytes block = bc.block(h);
+			uint64_t pos = m_ring ? m_ring->append(&block) : (uint64_t)-1;
+			RLPStream s(pos == (uint64_t)-1 ? 4 : 5);
+			s << 0 << "head" << bc.number(h) << h;
+			if (pos != (uint64_t)-1)
+				s << (u256)pos;
+			heads.push_back(s.out());
+		}
+	m_exported = head;
+
+	m_io.post([=]()
+	{
+		for (auto const& c: m_connections)
+			if (c->m_subscribed)
+				for (auto const& m: heads)
+					c->send(m);
+	});
+}
+
+#endif
@@ -0,0 +1,137 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file IpcServer.h
+ * @date 2015
+ */
+
+#pragma once
+
+// Make sure boost/asio.hpp is included before windows.h.
+#include <boost/asio.hpp>
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/SharedRing.h>
+
+namespace dev
+{
+namespace eth
+{
+
+class Client;
+class IpcServer;
+
+/// A local client's connection to an IpcServer. Everything here is only touched on the server's thread.
+class IpcConnection: public std::enable_shared_from_this<IpcConnection>
+{
+	friend class IpcServer;
+
+public:
+	IpcConnection(IpcServer& _server);
+
+private:
+	void read();
+	/// Sends @a _message, framed.
+	void send(bytes const& _message);
+	void write();
+	void close();
+
+	IpcServer& m_server;
+	boost::asio::local::stream_protocol::socket m_socket;
+	std::array<byte, 4> m_length;
+	bytes m_in;
+	std::deque<bytes> m_out;					///< The front is being written.
+	bool m_subscribed = false;					///< Whether new heads are pushed to us.
+	bool m_open = true;
+};
+
+/**
+ * @brief Serves the chain to other processes on the same host over a unix domain socket, in RLP rather than JSON.
+ * Each message either way is framed by its length, as four bytes big-endian, and is an RLP list. A request is
+ * [id, method, args...], with a non-zero id; its response is [id, 0, result], or [id, 1, message] should it fail. The
+ * methods are "head", giving [number, hash]; "block", "header" and "receipts", each of a block by number or hash;
+ * "blocks", of up to the second argument's count of blocks from the number given first, each as the chain keeps it,
+ * or, should the third be non-zero, as [block, receipts], fewer should they be large; "logs", of the blocks
+ * numbered from the first argument to the second, giving [number, transaction index, log] for each log; "ring",
+ * giving [path, end]; and "subscribe".
+ * Once subscribed, a connection is sent [0, "head", number, hash, position] for each block that becomes canonical,
+ * oldest first. Each such block is also written, as it is, to a SharedRing at the socket's path with ".ring" added,
+ * at the position given, so that a reader keeping up has it without copying it through the socket; the position is
+ * left off for a block too big for the ring. A reader that falls behind gets what it missed by "block".
+ * Requests are answered in turn on a worker thread of ours.
+ */
+class IpcServer
+{
+	friend class IpcConnection;
+
+public:
+	/// Serves the chain of @a _client on a socket at @a _path, writing new blocks to a ring of @a _ringSize bytes.
+	/// A @a _ringSize of zero means no ring.
+	IpcServer(Client& _client, std::string const& _path, size_t _ringSize = 64 * 1024 * 1024);
+	~IpcServer();
+
+	/// @returns false if we are already serving or cannot listen.
+	bool start();
+	void stop();
+
+	std::string const& path() const { return m_path; }
+	std::string ringPath() const { return m_path + ".ring"; }
+
+private:
+	void accept();
+	/// Answers @a _request from @a _c, on the worker thread.
+	void handle(std::shared_ptr<IpcConnection> const& _c, bytes const& _request);
+	/// @returns the result of @a _method with the arguments in @a _request.
+	bytes answer(std::string const& _method, RLP const& _request);
+	/// @returns the hash of the block given by @a _r, as a hash or a number.
+	h256 blockHash(RLP const& _r) const;
+	/// Called on the client's thread when the chain has changed.
+	void noteChainChanged();
+	/// On the worker thread, writes the blocks new to the canonical chain to the ring and tells subscribers of them.
+	void exportNewBlocks();
+
+	Client& m_client;
+	std::string m_path;
+	size_t m_ringSize;
+
+	boost::asio::io_service m_io;
+	std::unique_ptr<boost::asio::local::stream_protocol::acceptor> m_acceptor;
+	std::thread m_thread;
+	std::set<std::shared_ptr<IpcConnection>> m_connections;
+
+	boost::asio::io_service m_worker;					///< Answers requests and exports blocks, off our thread.
+	std::unique_ptr<boost::asio::io_service::work> m_workerWork;
+	std::thread m_workerThread;
+	std::atomic<bool> m_exporting{false};				///< Whether an export is on its way.
+
+	std::unique_ptr<SharedRing> m_ring;					///< Only touched on the worker thread.
+	h256 m_exported;									///< The last block exported; only touched on the worker thread.
+};
+
+}
+}
+
+#endif
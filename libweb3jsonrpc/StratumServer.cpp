@@ -0,0 +1,316 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StratumServer.cpp
+ * @date 2015
+ */
+
+#include "StratumServer.h"
+
+#include <libdevcore/CommonJS.h>
+#include <libdevcore/Log.h>
+#include <libethcore/Ethasher.h>
+#include <libethereum/Client.h>
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+namespace ba = boost::asio;
+using ba::ip::tcp;
+
+/// The longest request line taken; a miner sending longer is disconnected.
+static const size_t c_maxLineSize = 16 * 1024;
+/// Jobs kept, so that shares for all of them may still be submitted.
+static const unsigned c_jobsKept = 8;
+
+StratumConnection::StratumConnection(StratumServer& _server):
+	m_server(_server),
+	m_socket(_server.m_io),
+	m_in(c_maxLineSize)
+{
+}
+
+void StratumConnection::read()
+{
+	auto self = shared_from_this();
+	ba::async_read_until(m_socket, m_in, '\n', [self](boost::system::error_code const& _ec, size_t _n)
+	{
+		if (_ec)
+		{
+			// Also when the line is too long.
+			self->close();
+			return;
+		}
+		string line(ba::buffers_begin(self->m_in.data()), ba::buffers_begin(self->m_in.data()) + _n);
+		self->m_in.consume(_n);
+		self->handle(line);
+		if (self->m_open)
+			self->read();
+	});
+}
+
+void StratumConnection::handle(string const& _line)
+{
+	Json::Value request;
+	if (!Json::Reader().parse(_line, request, false) || !request.isObject())
+	{
+		if (_line.find_first_not_of(" \t\r\n") != string::npos)
+			error(Json::Value(), -32700, "Parse error");
+		return;
+	}
+	Json::Value id = request["id"];
+	string method = request["method"].asString();
+	Json::Value params = request["params"];
+	try
+	{
+		if (method == "eth_submitLogin")
+		{
+			m_loggedIn = true;
+			reply(id, true);
+		}
+		else if (method == "eth_getWork")
+		{
+			if (m_server.m_jobs.empty())
+				error(id, 0, "No work yet");
+			else
+				reply(id, m_server.work());
+		}
+		else if (method == "eth_submitWork")
+		{
+			if (!params.isArray() || params.size() < 3)
+			{
+				error(id, -32602, "Invalid params");
+				return;
+			}
+			m_server.submit(shared_from_this(), id, jsToFixed<Nonce::size>(params[0].asString()), jsToFixed<32>(params[1].asString()), jsToFixed<32>(params[2].asString()));
+		}
+		else if (method == "eth_submitHashrate")
+			reply(id, true);
+		else
+			error(id, -32601, "Method not found");
+	}
+	catch (...)
+	{
+		error(id, -32602, "Invalid params");
+	}
+}
+
+void StratumConnection::reply(Json::Value const& _id, Json::Value const& _result)
+{
+	Json::Value m;
+	m["id"] = _id;
+	m["jsonrpc"] = "2.0";
+	m["result"] = _result;
+	send(m);
+}
+
+void StratumConnection::error(Json::Value const& _id, int _code, string const& _message)
+{
+	Json::Value m;
+	m["id"] = _id;
+	m["jsonrpc"] = "2.0";
+	m["error"]["code"] = _code;
+	m["error"]["message"] = _message;
+	send(m);
+}
+
+void StratumConnection::send(Json::Value const& _message)
+{
+	if (!m_open)
+		return;
+	m_out.push_back(Json::FastWriter().write(_message));
+	if (m_out.size() == 1)
+		write();
+}
+
+void StratumConnection::write()
+{
+	auto self = shared_from_this();
+	ba::async_write(m_socket, ba::buffer(m_out.front()), [self](boost::system::error_code const& _ec, size_t)
+	{
+		if (_ec)
+		{
+			self->close();
+			return;
+		}
+		self->m_out.pop_front();
+		if (!self->m_out.empty())
+			self->write();
+	});
+}
+
+void StratumConnection::close()
+{
+	if (!m_open)
+		return;
+	m_open = false;
+	boost::system::error_code ec;
+	m_socket.close(ec);
+	m_server.m_connections.erase(shared_from_this());
+}
+
+StratumServer::StratumServer(Client& _client, unsigned short _port, string const& _address):
+	m_client(_client),
+	m_endpoint(ba::ip::address::from_string(_address), _port)
+{
+}
+
+StratumServer::~StratumServer()
+{
+	stop();
+}
+
+bool StratumServer::start()
+{
+	if (m_thread.joinable())
+		return false;
+	try
+	{
+		m_acceptor.reset(new tcp::acceptor(m_io, m_endpoint));
+	}
+	catch (...)
+	{
+		cwarn << "Couldn't listen for miners on" << m_endpoint << ":" << boost::current_exception_diagnostic_information();
+		return false;
+	}
+	m_worker.reset();
+	m_workerWork.reset(new ba::io_service::work(m_worker));
+	m_workerThread = std::thread([=](){ m_worker.run(); });
+
+	m_io.reset();
+	accept();
+	m_thread = std::thread([=](){ m_io.run(); });
+
+	m_client.onNewWork([=](){ noteNewWork(); });
+	noteNewWork();
+	return true;
+}
+
+void StratumServer::stop()
+{
+	if (!m_thread.joinable())
+		return;
+	m_client.onNewWork(function<void()>());
+	m_io.post([=]()
+	{
+		boost::system::error_code ec;
+		m_acceptor->close(ec);
+		auto connections = m_connections;
+		for (auto const& c: connections)
+			c->close();
+		m_io.stop();
+	});
+	m_thread.join();
+	m_acceptor.reset();
+
+	m_workerWork.reset();
+	m_worker.stop();
+	m_workerThread.join();
+	m_jobs.clear();
+	m_refreshing = false;
+}
+
+void StratumServer::accept()
+{
+	auto c = make_shared<StratumConnection>(*this);
+	m_acceptor->async_accept(c->m_socket, [=](boost::system::error_code const& _ec)
+	{
+		if (_ec == ba::error::operation_aborted)
+			return;
+		if (!_ec)
+		{
+			boost::system::error_code ec;
+			c->m_socket.set_option(tcp::no_delay(true), ec);
+			m_connections.insert(c);
+			c->read();
+		}
+		accept();
+	});
+}
+
+void StratumServer::noteNewWork()
+{
+	// However much changes while a package is being made, one more is made after it.
+	if (m_refreshing.exchange(true))
+		return;
+	m_worker.post([=]()
+	{
+		m_refreshing = false;
+		BlockInfo header = m_client.getWorkPackage();
+		m_io.post([=](){ noteJob(header); });
+	});
+}
+
+void StratumServer::noteJob(BlockInfo const& _header)
+{
+	h256 workHash = _header.headerHash(WithoutNonce);
+	if (!m_jobs.empty() && m_jobs.back().header.headerHash(WithoutNonce) == workHash)
+		return;
+
+	Job job;
+	job.header = _header;
+	job.shareBoundary = _header.boundary();
+	if (m_shareDifficulty && m_shareDifficulty < _header.difficulty)
+		job.shareBoundary = m_shareDifficulty > 1 ? h256(u256((bigint(1) << 256) / m_shareDifficulty)) : ~h256();
+	m_jobs.push_back(job);
+	while (m_jobs.size() > c_jobsKept)
+		m_jobs.pop_front();
+
+	Json::Value w = work();
+	for (auto const& c: m_connections)
+		if (c->m_loggedIn)
+			c->reply(0, w);
+}
+
+Json::Value StratumServer::work() const
+{
+	Job const& job = m_jobs.back();
+	Json::Value ret(Json::arrayValue);
+	ret.append(toJS(job.header.headerHash(WithoutNonce)));
+	ret.append(toJS(job.header.seedHash()));
+	ret.append(toJS(job.shareBoundary));
+	return ret;
+}
+
+void StratumServer::submit(shared_ptr<StratumConnection> const& _c, Json::Value const& _id, Nonce const& _nonce, h256 const& _workHash, h256 const& _mixHash)
+{
+	auto job = find_if(m_jobs.begin(), m_jobs.end(), [&](Job const& _j){ return _j.header.headerHash(WithoutNonce) == _workHash; });
+	if (job == m_jobs.end() || !job->submitted.insert(_nonce).second)
+	{
+		// Stale or already counted.
+		++m_rejected;
+		_c->reply(_id, false);
+		return;
+	}
+	BlockInfo header = job->header;
+	h256 shareBoundary = job->shareBoundary;
+	m_worker.post([=]()
+	{
+		auto r = Ethasher::eval(header, _nonce);
+		bool share = r.mixHash == _mixHash && r.value <= shareBoundary;
+		if (share && r.value <= header.boundary())
+		{
+			if (m_client.submitWork(_workHash, ProofOfWork::Proof{_nonce, _mixHash}))
+			{
+				++m_blocks;
+				cnote << "Remote miner found block" << _workHash.abridged();
+			}
+			else
+				cwarn << "Remote miner's block" << _workHash.abridged() << "could not be completed";
+		}
+		++(share ? m_accepted : m_rejected);
+		m_io.post([=](){ _c->reply(_id, share); });
+	});
+}
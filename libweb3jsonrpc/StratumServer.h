@@ -0,0 +1,136 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StratumServer.h
+ * @date 2015
+ */
+
+#pragma once
+
+// Make sure boost/asio.hpp is included before windows.h.
+#include <boost/asio.hpp>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <json/json.h>
+#include <libdevcore/FixedHash.h>
+#include <libethcore/BlockInfo.h>
+
+namespace dev
+{
+namespace eth
+{
+
+class Client;
+class StratumServer;
+
+/// A miner's connection to a StratumServer. Everything here is only touched on the server's thread.
+class StratumConnection: public std::enable_shared_from_this<StratumConnection>
+{
+	friend class StratumServer;
+
+public:
+	StratumConnection(StratumServer& _server);
+
+private:
+	void read();
+	void handle(std::string const& _line);
+	void reply(Json::Value const& _id, Json::Value const& _result);
+	void error(Json::Value const& _id, int _code, std::string const& _message);
+	void send(Json::Value const& _message);
+	void write();
+	void close();
+
+	StratumServer& m_server;
+	boost::asio::ip::tcp::socket m_socket;
+	boost::asio::streambuf m_in;
+	std::deque<std::string> m_out;				///< The front is being written.
+	bool m_loggedIn = false;					///< Whether new work is pushed to us.
+	bool m_open = true;
+};
+
+/**
+ * @brief Gives work to remote miners over TCP, speaking the "eth-proxy" flavour of Stratum: a JSON-RPC request per
+ * line, with new work pushed to logged-in miners as soon as there is a new head or new pending transactions.
+ * Each work package is a job known by its work hash; shares may be submitted for any of the last few. Shares need only
+ * meet the share difficulty, which may be well below the block's, so that a miner's progress can be counted; those
+ * that also meet the block's difficulty complete the block.
+ */
+class StratumServer
+{
+	friend class StratumConnection;
+
+public:
+	/// Serves work from @a _client on @a _port of @a _address.
+	StratumServer(Client& _client, unsigned short _port, std::string const& _address = "0.0.0.0");
+	~StratumServer();
+
+	/// Sets the difficulty shares must meet; 0, the default, means they must meet the block's. Call before start().
+	void setShareDifficulty(u256 const& _d) { m_shareDifficulty = _d; }
+
+	/// @returns false if we are already serving or cannot listen.
+	bool start();
+	void stop();
+
+	unsigned sharesAccepted() const { return m_accepted; }
+	unsigned sharesRejected() const { return m_rejected; }
+	unsigned blocksFound() const { return m_blocks; }
+
+private:
+	/// A work package given out.
+	struct Job
+	{
+		BlockInfo header;
+		h256 shareBoundary;
+		std::set<Nonce> submitted;			///< So that no share is counted twice.
+	};
+
+	void accept();
+	/// Called on the client's thread when there is new work.
+	void noteNewWork();
+	/// Takes the new work package @a _header, pushing it to every logged-in miner.
+	void noteJob(BlockInfo const& _header);
+	/// @returns the newest job as it is sent to miners.
+	Json::Value work() const;
+	/// Checks a share, on the worker thread, replying to @a _c once done.
+	void submit(std::shared_ptr<StratumConnection> const& _c, Json::Value const& _id, Nonce const& _nonce, h256 const& _workHash, h256 const& _mixHash);
+
+	Client& m_client;
+	u256 m_shareDifficulty;
+
+	boost::asio::io_service m_io;
+	boost::asio::ip::tcp::endpoint m_endpoint;
+	std::unique_ptr<boost::asio::ip::tcp::acceptor> m_acceptor;
+	std::thread m_thread;
+	std::set<std::shared_ptr<StratumConnection>> m_connections;
+	std::deque<Job> m_jobs;								///< The newest at the back.
+
+	boost::asio::io_service m_worker;					///< Makes work packages and checks shares, off our thread.
+	std::unique_ptr<boost::asio::io_service::work> m_workerWork;
+	std::thread m_workerThread;
+	std::atomic<bool> m_refreshing{false};				///< Whether a new work package is on its way.
+
+	std::atomic<unsigned> m_accepted{0};
+	std::atomic<unsigned> m_rejected{0};
+	std::atomic<unsigned> m_blocks{0};
+};
+
+}
+}
@@ -0,0 +1,457 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StreamServer.cpp
+ * @date 2015
+ */
+
+#include "StreamServer.h"
+
+#include <boost/thread/tss.hpp>
+#include <jsonrpccpp/common/exception.h>
+#include <libdevcore/Log.h>
+using namespace std;
+using namespace dev;
+namespace ba = boost::asio;
+using ba::ip::tcp;
+
+/// The longest request line taken; a connection sending longer is closed.
+static const size_t c_maxRequestSize = 1024 * 1024;
+/// How much of a streamed result is gathered before it is sent, and how much may wait to be written before more is made.
+static const size_t c_streamChunk = 64 * 1024;
+static const size_t c_streamQueue = 1024 * 1024;
+/// Threads running streamed calls.
+static const unsigned c_streamThreads = 2;
+
+/// The connection whose request the thread is handling.
+static boost::thread_specific_ptr<shared_ptr<StreamConnection>> t_current;
+
+StreamConnection::StreamConnection(StreamServer& _server):
+	m_server(_server),
+	m_socket(_server.m_io),
+	m_in(c_maxRequestSize)
+{
+}
+
+bool StreamConnection::push(string const& _message)
+{
+	return send(_message.empty() || _message.back() != '\n' ? _message + "\n" : _message);
+}
+
+bool StreamConnection::send(string const& _data)
+{
+	if (!m_open)
+		return false;
+	{
+		Guard l(x_queued);
+		m_queued += _data.size();
+	}
+	auto self = shared_from_this();
+	m_server.m_io.post([=]()
+	{
+		if (!self->m_open)
+			return;
+		self->m_out.push_back(_data);
+		if (self->m_out.size() == 1)
+			self->write();
+	});
+	return true;
+}
+
+void StreamConnection::waitForRoom(size_t _bytes)
+{
+	unique_lock<Mutex> l(x_queued);
+	m_written.wait(l, [&](){ return m_queued <= _bytes || !m_open; });
+}
+
+void StreamConnection::onClose(function<void()> const& _f)
+{
+	{
+		Guard l(x_onClose);
+		if (m_open)
+		{
+			m_onClose.push_back(_f);
+			return;
+		}
+	}
+	_f();
+}
+
+shared_ptr<StreamConnection> StreamConnection::current()
+{
+	return t_current.get() ? *t_current : nullptr;
+}
+
+void StreamConnection::read()
+{
+	auto self = shared_from_this();
+	ba::async_read_until(m_socket, m_in, '\n', [self](boost::system::error_code const& _ec, size_t)
+	{
+		if (_ec)
+		{
+			self->close();
+			return;
+		}
+		istream in(&self->m_in);
+		string request;
+		getline(in, request);
+		if (!request.empty() && request != "\r" && !self->m_server.handle(self, request))
+			return;
+		self->read();
+	});
+}
+
+void StreamConnection::write()
+{
+	auto self = shared_from_this();
+	ba::async_write(m_socket, ba::buffer(m_out.front()), [self](boost::system::error_code const& _ec, size_t)
+	{
+		if (_ec)
+		{
+			self->close();
+			return;
+		}
+		{
+			Guard l(self->x_queued);
+			self->m_queued -= self->m_out.front().size();
+		}
+		self->m_written.notify_all();
+		self->m_out.pop_front();
+		if (!self->m_out.empty())
+			self->write();
+	});
+}
+
+void StreamConnection::close()
+{
+	vector<function<void()>> onClose;
+	{
+		Guard l(x_onClose);
+		if (!m_open)
+			return;
+		m_open = false;
+		swap(onClose, m_onClose);
+	}
+	{
+		// Wakes any stream waiting to write to us.
+		Guard l(x_queued);
+		m_written.notify_all();
+	}
+	boost::system::error_code ec;
+	m_socket.close(ec);
+	for (auto const& f: onClose)
+		f();
+	m_server.noteClosed(shared_from_this());
+}
+
+StreamServer::StreamServer(unsigned short _port, string const& _address):
+	m_endpoint(ba::ip::address::from_string(_address), _port)
+{
+}
+
+StreamServer::~StreamServer()
+{
+	StopListening();
+}
+
+bool StreamServer::StartListening()
+{
+	if (m_thread.joinable())
+		return false;
+	try
+	{
+		m_acceptor.reset(new tcp::acceptor(m_io, m_endpoint));
+	}
+	catch (...)
+	{
+		cwarn << "Couldn't listen for JSON-RPC on" << m_endpoint << ":" << boost::current_exception_diagnostic_information();
+		return false;
+	}
+	m_io.reset();
+	accept();
+	m_thread = std::thread([=](){ m_io.run(); });
+
+	m_pool.reset();
+	m_poolWork.reset(new ba::io_service::work(m_pool));
+	for (unsigned i = 0; i < max(std::thread::hardware_concurrency(), 2u); ++i)
+		m_poolThreads.push_back(std::thread([=](){ m_pool.run(); }));
+
+	m_streams.reset();
+	m_streamsWork.reset(new ba::io_service::work(m_streams));
+	for (unsigned i = 0; i < c_streamThreads; ++i)
+		m_streamsThreads.push_back(std::thread([=](){ m_streams.run(); }));
+	return true;
+}
+
+bool StreamServer::StopListening()
+{
+	if (!m_thread.joinable())
+		return false;
+	m_io.post([=]()
+	{
+		boost::system::error_code ec;
+		m_acceptor->close(ec);
+		set<shared_ptr<StreamConnection>> connections;
+		{
+			Guard l(x_connections);
+			connections = m_connections;
+		}
+		// Closing tells the connections' subscribers, before the thread goes.
+		for (auto const& c: connections)
+			c->close();
+		m_io.stop();
+	});
+	m_thread.join();
+	m_acceptor.reset();
+
+	m_poolWork.reset();
+	for (auto& t: m_poolThreads)
+		t.join();
+	m_poolThreads.clear();
+
+	// The connections are closed, so any stream still running fails its next write and ends.
+	m_streamsWork.reset();
+	for (auto& t: m_streamsThreads)
+		t.join();
+	m_streamsThreads.clear();
+	return true;
+}
+
+bool StreamServer::SendResponse(string const& _response, void* _addInfo)
+{
+	if (!_addInfo)
+		return false;
+	Reply* r = static_cast<Reply*>(_addInfo);
+	if (r->out)
+	{
+		*r->out = _response;
+		return true;
+	}
+	return r->connection->push(_response);
+}
+
+void StreamServer::accept()
+{
+	auto c = make_shared<StreamConnection>(*this);
+	m_acceptor->async_accept(c->m_socket, [=](boost::system::error_code const& _ec)
+	{
+		if (_ec == ba::error::operation_aborted)
+			return;
+		if (!_ec)
+		{
+			{
+				Guard l(x_connections);
+				m_connections.insert(c);
+			}
+			c->read();
+		}
+		accept();
+	});
+}
+
+bool StreamServer::handle(shared_ptr<StreamConnection> const& _c, string const& _request)
+{
+	// Anything we do not handle ourselves, including what does not parse, is left to jsonrpccpp.
+	Json::Value request;
+	if (m_face && Json::Reader().parse(_request, request, false))
+	{
+		if (request.isArray() && !request.empty())
+		{
+			handleBatch(_c, request);
+			return true;
+		}
+		if (request.isObject() && request.isMember("id") && request["method"].isString() && m_face->isStreamed(request["method"].asString()))
+		{
+			handleStreamed(_c, request);
+			return false;
+		}
+	}
+
+	if (!t_current.get())
+		t_current.reset(new shared_ptr<StreamConnection>);
+	*t_current = _c;
+	Reply r;
+	r.connection = _c.get();
+	OnRequest(_request, &r);
+	t_current->reset();
+	return true;
+}
+
+void StreamServer::handleBatch(shared_ptr<StreamConnection> const& _c, Json::Value const& _batch)
+{
+	if (!t_current.get())
+		t_current.reset(new shared_ptr<StreamConnection>);
+	*t_current = _c;
+
+	unsigned n = _batch.size();
+	vector<string> requests(n);
+	vector<string> responses(n);
+	Json::FastWriter writer;
+	for (unsigned i = 0; i < n; ++i)
+		requests[i] = writer.write(_batch[i]);
+	auto isReadOnly = [&](unsigned i)
+	{
+		Json::Value const& r = _batch[i];
+		return r.isObject() && r["method"].isString() && m_face->isReadOnly(r["method"].asString());
+	};
+	auto run = [&](unsigned i)
+	{
+		Reply r;
+		r.out = &responses[i];
+		OnRequest(requests[i], &r);
+	};
+
+	for (unsigned i = 0; i < n;)
+	{
+		unsigned end = i;
+		while (end < n && isReadOnly(end))
+			++end;
+		if (end - i < 2)
+		{
+			// Anything that may write, or a lone read, is run here, in its turn.
+			run(i++);
+			continue;
+		}
+
+		// A run of reads is shared among the pool, all against one snapshot.
+		auto snapshot = m_face->snapshot();
+		atomic<unsigned> next(i);
+		unsigned workers = min<unsigned>(end - i, m_poolThreads.size());
+		unsigned done = 0;
+		Mutex x_done;
+		Condition doneChanged;
+		for (unsigned w = 0; w < workers; ++w)
+			m_pool.post([&]()
+			{
+				if (!t_current.get())
+					t_current.reset(new shared_ptr<StreamConnection>);
+				*t_current = _c;
+				try
+				{
+					snapshot([&]()
+					{
+						for (unsigned j = next++; j < end; j = next++)
+							run(j);
+					});
+				}
+				catch (...)
+				{
+					cwarn << "Unexpected exception in JSON-RPC batch:" << boost::current_exception_diagnostic_information();
+				}
+				t_current->reset();
+				Guard l(x_done);
+				++done;
+				doneChanged.notify_one();
+			});
+		unique_lock<Mutex> l(x_done);
+		doneChanged.wait(l, [&](){ return done == workers; });
+		i = end;
+	}
+
+	// Notifications have no response; if all were, nothing is sent.
+	string ret;
+	for (string const& r: responses)
+	{
+		auto last = r.find_last_not_of(" \t\r\n");
+		if (last != string::npos)
+			ret += (ret.empty() ? "[" : ",") + r.substr(0, last + 1);
+	}
+	if (!ret.empty())
+		_c->push(ret + "]");
+	t_current->reset();
+}
+
+/// @returns @a _v as compact JSON text, without the newline Json::FastWriter ends it with.
+static string toText(Json::Value const& _v)
+{
+	string ret = Json::FastWriter().write(_v);
+	if (!ret.empty() && ret.back() == '\n')
+		ret.pop_back();
+	return ret;
+}
+
+void StreamServer::handleStreamed(shared_ptr<StreamConnection> const& _c, Json::Value const& _request)
+{
+	m_streams.post([=]()
+	{
+		if (!t_current.get())
+			t_current.reset(new shared_ptr<StreamConnection>);
+		*t_current = _c;
+
+		string id = toText(_request["id"]);
+		string out;
+		bool started = false;
+		auto write = [&](string const& _s)
+		{
+			if (!started)
+			{
+				out = "{\"id\":" + id + ",\"jsonrpc\":\"2.0\",\"result\":";
+				started = true;
+			}
+			out += _s;
+			if (out.size() >= c_streamChunk)
+			{
+				_c->waitForRoom(c_streamQueue);
+				if (!_c->send(out))
+					BOOST_THROW_EXCEPTION(jsonrpc::JsonRpcException(jsonrpc::Errors::ERROR_RPC_INTERNAL_ERROR));
+				out.clear();
+			}
+		};
+
+		Json::Value error;
+		try
+		{
+			m_face->stream(_request["method"].asString(), _request["params"], write);
+			if (!started)
+				write("null");
+			_c->send(out + "}\n");
+		}
+		catch (jsonrpc::JsonRpcException const& _e)
+		{
+			error["code"] = _e.GetCode();
+			error["message"] = _e.GetMessage();
+		}
+		catch (...)
+		{
+			cwarn << "Unexpected exception in streamed JSON-RPC call:" << boost::current_exception_diagnostic_information();
+			error["code"] = jsonrpc::Errors::ERROR_RPC_INTERNAL_ERROR;
+			error["message"] = "Internal error";
+		}
+		t_current->reset();
+
+		if (!error.isNull())
+		{
+			if (started)
+			{
+				// Half a result has gone; nothing can be said after it that the client could make sense of.
+				m_io.post([_c](){ _c->close(); });
+				return;
+			}
+			Json::Value response;
+			response["id"] = _request["id"];
+			response["jsonrpc"] = "2.0";
+			response["error"] = error;
+			_c->push(toText(response));
+		}
+		m_io.post([_c](){ _c->read(); });
+	});
+}
+
+void StreamServer::noteClosed(shared_ptr<StreamConnection> const& _c)
+{
+	Guard l(x_connections);
+	m_connections.erase(_c);
+}
@@ -0,0 +1,157 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file StreamServer.h
+ * @date 2015
+ */
+
+#pragma once
+
+// Make sure boost/asio.hpp is included before windows.h.
+#include <boost/asio.hpp>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <jsonrpccpp/server.h>
+#include <libdevcore/Guards.h>
+
+namespace dev
+{
+
+class StreamServer;
+
+/// What a StreamServer needs of the server behind it in order to run the calls of a batch in parallel, and to
+/// write large results out as they are made.
+class StreamServerFace
+{
+public:
+	virtual ~StreamServerFace() {}
+
+	/// @returns true if calls to @a _method only read, so that they may run alongside each other.
+	virtual bool isReadOnly(std::string const& _method) const = 0;
+	/// @returns a runner under which calls, on whichever thread, all see the state as it is now.
+	virtual std::function<void(std::function<void()> const&)> snapshot() = 0;
+
+	/// @returns true if the results of @a _method are to be written out piece by piece through stream().
+	virtual bool isStreamed(std::string const& _method) const = 0;
+	/// Writes the result of calling @a _method with @a _params, as JSON text, to @a _write in as many pieces as it likes.
+	/// @throws jsonrpc::JsonRpcException should the call fail; if anything has been written by then, the connection is closed.
+	virtual void stream(std::string const& _method, Json::Value const& _params, std::function<void(std::string const&)> const& _write) = 0;
+};
+
+/// A client's connection to a StreamServer, down which messages may be pushed unasked.
+class StreamConnection: public std::enable_shared_from_this<StreamConnection>
+{
+	friend class StreamServer;
+
+public:
+	StreamConnection(StreamServer& _server);
+
+	/// Sends @a _message as a line of its own, after any sent before. Thread-safe.
+	/// @returns false if the connection has closed.
+	bool push(std::string const& _message);
+	/// Sends @a _data as it is, after any sent before. Thread-safe.
+	/// @returns false if the connection has closed.
+	bool send(std::string const& _data);
+	/// Calls @a _f, on the server's thread, once the connection closes; at once if it has. Thread-safe.
+	void onClose(std::function<void()> const& _f);
+
+	/// @returns the connection whose request this thread is handling, if any.
+	static std::shared_ptr<StreamConnection> current();
+
+private:
+	void read();
+	void write();
+	void close();
+	/// Waits until no more than @a _bytes are queued to be written, or the connection has closed. Not on the server's thread.
+	void waitForRoom(size_t _bytes);
+
+	StreamServer& m_server;
+	boost::asio::ip::tcp::socket m_socket;
+	boost::asio::streambuf m_in;
+	std::deque<std::string> m_out;					///< Only touched on the server's thread; the front is being written.
+	std::atomic<bool> m_open{true};
+
+	Mutex x_queued;
+	Condition m_written;
+	size_t m_queued = 0;							///< Bytes sent but not yet written.
+
+	Mutex x_onClose;
+	std::vector<std::function<void()>> m_onClose;
+};
+
+/**
+ * @brief A JSON-RPC server connector over plain TCP, taking a request and giving a response per line.
+ * Connections stay open, so that notifications, such as those of subscriptions, can be pushed down them as they happen.
+ * Requests are handled in turn on the server's own thread. Given a StreamServerFace, each run of read-only calls in a
+ * batch is spread over a pool of workers, all against one snapshot; other calls in it stay in order between them.
+ * Calls whose results are streamed are run on threads of their own, written out as they are made, no faster than the
+ * client takes them; the connection reads no further requests until each is done.
+ */
+class StreamServer: public jsonrpc::AbstractServerConnector
+{
+	friend class StreamConnection;
+
+public:
+	explicit StreamServer(unsigned short _port, std::string const& _address = "127.0.0.1");
+	virtual ~StreamServer();
+
+	virtual bool StartListening() override;
+	virtual bool StopListening() override;
+	virtual bool SendResponse(std::string const& _response, void* _addInfo = nullptr) override;
+
+	/// Lets batches be run in parallel, and results be streamed, as @a _f allows. @a _f must outlive our listening.
+	void setFace(StreamServerFace* _f) { m_face = _f; }
+
+private:
+	/// Where the response to a request goes: down the connection, or, for one of a batch, into its place.
+	struct Reply
+	{
+		StreamConnection* connection = nullptr;
+		std::string* out = nullptr;
+	};
+
+	void accept();
+	/// Handles @a _request from @a _c. @returns false if it is being handled elsewhere, which will read on from @a _c.
+	bool handle(std::shared_ptr<StreamConnection> const& _c, std::string const& _request);
+	void handleBatch(std::shared_ptr<StreamConnection> const& _c, Json::Value const& _batch);
+	void handleStreamed(std::shared_ptr<StreamConnection> const& _c, Json::Value const& _request);
+	void noteClosed(std::shared_ptr<StreamConnection> const& _c);
+
+	boost::asio::io_service m_io;
+	boost::asio::ip::tcp::endpoint m_endpoint;
+	std::unique_ptr<boost::asio::ip::tcp::acceptor> m_acceptor;
+	std::thread m_thread;
+
+	StreamServerFace* m_face = nullptr;
+	boost::asio::io_service m_pool;						///< Runs the read-only calls of batches.
+	std::unique_ptr<boost::asio::io_service::work> m_poolWork;
+	std::vector<std::thread> m_poolThreads;
+	boost::asio::io_service m_streams;					///< Runs streamed calls; these wait on our thread, so may not share the pool.
+	std::unique_ptr<boost::asio::io_service::work> m_streamsWork;
+	std::vector<std::thread> m_streamsThreads;
+
+	Mutex x_connections;
+	std::set<std::shared_ptr<StreamConnection>> m_connections;
+};
+
+}
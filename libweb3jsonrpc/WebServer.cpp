@@ -0,0 +1,495 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file WebServer.cpp
+ * @date 2015
+ */
+
+#include "WebServer.h"
+
+#include <map>
+#include <sstream>
+#include <boost/algorithm/string.hpp>
+#include <libdevcore/Base64.h>
+#include <libdevcore/Log.h>
+#include <libdevcrypto/SHA3.h>
+using namespace std;
+using namespace dev;
+namespace ba = boost::asio;
+using ba::ip::tcp;
+
+/// The largest request body, or WebSocket message, taken; a connection sending larger is refused and closed.
+static const size_t c_maxRequestSize = 1024 * 1024;
+/// The longest HTTP request head taken.
+static const size_t c_maxHeaderSize = 16 * 1024;
+/// Requests read ahead on a connection, waiting to be handled, before it is read no further.
+static const size_t c_maxPipelined = 16;
+/// Requests that may wait for each worker before further connections wait for them.
+static const unsigned c_queuedPerThread = 4;
+
+static const char* c_webSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+/// @returns a single, unmasked WebSocket frame of @a _opcode carrying @a _payload.
+static string frame(unsigned _opcode, string const& _payload)
+{
+	string ret(1, char(0x80 | _opcode));
+	uint64_t n = _payload.size();
+	if (n < 126)
+		ret += char(n);
+	else if (n < 65536)
+	{
+		ret += char(126);
+		ret += char(n >> 8);
+		ret += char(n);
+	}
+	else
+	{
+		ret += char(127);
+		for (int i = 7; i >= 0; --i)
+			ret += char(n >> (i * 8));
+	}
+	return ret + _payload;
+}
+
+/// @returns a WebSocket close frame giving @a _code.
+static string closeFrame(unsigned _code)
+{
+	return frame(0x8, string{char(_code >> 8), char(_code)});
+}
+
+WebConnection::WebConnection(WebServer& _server):
+	m_server(_server),
+	m_socket(_server.m_io)
+{
+}
+
+void WebConnection::read()
+{
+	if (m_reading || m_closing || m_ended || !m_open || m_requests.size() >= c_maxPipelined)
+		return;
+	m_reading = true;
+	auto self = shared_from_this();
+	m_socket.async_read_some(ba::buffer(m_buffer), [self](boost::system::error_code const& _ec, size_t _n)
+	{
+		self->m_reading = false;
+		if (_ec == ba::error::eof)
+			// What has been sent is still answered.
+			self->m_ended = true;
+		else if (_ec)
+		{
+			self->close();
+			return;
+		}
+		else
+			self->m_in.append(self->m_buffer.data(), _n);
+		self->next();
+	});
+}
+
+void WebConnection::parse()
+{
+	while (!m_closing && m_requests.size() < c_maxPipelined && (m_webSocket ? parseFrame() : parseHttp())) {}
+}
+
+bool WebConnection::parseHttp()
+{
+	Request r;
+	auto end = m_in.find("\r\n\r\n");
+	if (end == string::npos)
+	{
+		if (m_in.size() > c_maxHeaderSize)
+		{
+			r.status = "431 Request Header Fields Too Large";
+			refuse(r);
+		}
+		return false;
+	}
+
+	istringstream head(m_in.substr(0, end));
+	string line;
+	getline(head, line);
+	string method;
+	string target;
+	string version;
+	istringstream(line) >> method >> target >> version;
+	map<string, string> headers;
+	while (getline(head, line))
+	{
+		auto colon = line.find(':');
+		if (colon != string::npos)
+			headers[boost::to_lower_copy(line.substr(0, colon))] = boost::trim_copy(line.substr(colon + 1));
+	}
+	string connection = boost::to_lower_copy(headers["connection"]);
+	bool close = version == "HTTP/1.0" ? connection.find("keep-alive") == string::npos : connection.find("close") != string::npos;
+
+	size_t length = 0;
+	try
+	{
+		length = headers.count("content-length") ? stoul(headers["content-length"]) : 0;
+	}
+	catch (...)
+	{
+		r.status = "400 Bad Request";
+	}
+	if (method.empty() || version.compare(0, 5, "HTTP/"))
+		r.status = "400 Bad Request";
+	else if (headers.count("transfer-encoding"))
+		r.status = "411 Length Required";
+	else if (length > c_maxRequestSize)
+		r.status = "413 Payload Too Large";
+	if (!r.status.empty())
+	{
+		refuse(r);
+		return false;
+	}
+	if (m_in.size() < end + 4 + length)
+		return false;
+	string body = m_in.substr(end + 4, length);
+	m_in.erase(0, end + 4 + length);
+
+	if (method == "POST" && !body.empty())
+		r.body = body;
+	else if (method == "POST")
+		r.status = "400 Bad Request";
+	else if (method == "OPTIONS")
+		// A CORS preflight; every reply allows any origin.
+		r.status = "200 OK";
+	else if (method == "GET" && boost::iequals(headers["upgrade"], "websocket") && headers.count("sec-websocket-key"))
+	{
+		string key = headers["sec-websocket-key"] + c_webSocketGuid;
+		bytes hash(20);
+		sha1(bytesConstRef((byte const*)key.data(), key.size()), &hash);
+		r.raw = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " + toBase64(&hash) + "\r\n\r\n";
+		m_webSocket = true;
+		close = false;
+	}
+	else
+		r.status = "405 Method Not Allowed";
+	m_requests.push_back(r);
+	if (close)
+		m_closing = true;
+	return true;
+}
+
+bool WebConnection::parseFrame()
+{
+	Request r;
+	r.webSocket = true;
+	if (m_in.size() < 2)
+		return false;
+	byte const* p = (byte const*)m_in.data();
+	bool fin = p[0] & 0x80;
+	unsigned opcode = p[0] & 0x0f;
+	bool masked = p[1] & 0x80;
+	uint64_t length = p[1] & 0x7f;
+	size_t pos = 2;
+	if (length == 126)
+	{
+		if (m_in.size() < 4)
+			return false;
+		length = (p[2] << 8) | p[3];
+		pos = 4;
+	}
+	else if (length == 127)
+	{
+		if (m_in.size() < 10)
+			return false;
+		length = 0;
+		for (unsigned i = 2; i < 10; ++i)
+			length = (length << 8) | p[i];
+		pos = 10;
+	}
+	if (!masked)
+	{
+		// Clients must mask what they send.
+		r.raw = closeFrame(1002);
+		refuse(r);
+		return false;
+	}
+	if (length > c_maxRequestSize - m_message.size())
+	{
+		r.raw = closeFrame(1009);
+		refuse(r);
+		return false;
+	}
+	if (m_in.size() < pos + 4 + length)
+		return false;
+	string payload = m_in.substr(pos + 4, length);
+	for (size_t i = 0; i < payload.size(); ++i)
+		payload[i] ^= p[pos + i % 4];
+	m_in.erase(0, pos + 4 + length);
+
+	switch (opcode)
+	{
+	case 0x0:
+	case 0x1:
+	case 0x2:
+		if (opcode)
+			m_message.clear();
+		m_message += payload;
+		if (fin && !m_message.empty())
+		{
+			r.body.swap(m_message);
+			m_requests.push_back(r);
+		}
+		return true;
+	case 0x8:
+		r.raw = frame(0x8, payload.substr(0, 2));
+		refuse(r);
+		return false;
+	case 0x9:
+		r.raw = frame(0xA, payload);
+		m_requests.push_back(r);
+		return true;
+	case 0xA:
+		return true;
+	default:
+		r.raw = closeFrame(1002);
+		refuse(r);
+		return false;
+	}
+}
+
+void WebConnection::refuse(Request const& _r)
+{
+	m_requests.push_back(_r);
+	m_closing = true;
+	m_in.clear();
+}
+
+void WebConnection::next()
+{
+	if (!m_open)
+		return;
+	parse();
+	while (!m_busy && !m_requests.empty())
+	{
+		if (m_requests.front().body.empty())
+		{
+			Request r = m_requests.front();
+			m_requests.pop_front();
+			reply(r, string());
+			parse();
+			continue;
+		}
+		m_busy = true;
+		m_server.dispatch(shared_from_this());
+	}
+	closeIfDone();
+	read();
+}
+
+void WebConnection::respond(string const& _response)
+{
+	if (!m_open)
+		return;
+	m_busy = false;
+	Request r = m_requests.front();
+	m_requests.pop_front();
+	reply(r, _response);
+	next();
+}
+
+void WebConnection::reply(Request const& _r, string const& _response)
+{
+	if (!_r.raw.empty())
+		send(_r.raw);
+	else if (_r.webSocket)
+	{
+		// Notifications have no response.
+		if (!_response.empty())
+			send(frame(0x1, _response));
+	}
+	else
+	{
+		string status = !_r.status.empty() ? _r.status : _response.empty() ? "204 No Content" : "200 OK";
+		bool last = m_closing && m_requests.empty();
+		send("HTTP/1.1 " + status + "\r\n"
+			"Content-Type: application/json\r\n"
+			"Content-Length: " + to_string(_response.size()) + "\r\n"
+			"Access-Control-Allow-Origin: *\r\n"
+			"Access-Control-Allow-Methods: POST, OPTIONS\r\n"
+			"Access-Control-Allow-Headers: Content-Type\r\n"
+			"Connection: " + (last ? "close" : "keep-alive") + "\r\n"
+			"\r\n" + _response);
+	}
+}
+
+void WebConnection::send(string const& _data)
+{
+	m_out.push_back(_data);
+	if (m_out.size() == 1)
+		write();
+}
+
+void WebConnection::write()
+{
+	auto self = shared_from_this();
+	ba::async_write(m_socket, ba::buffer(m_out.front()), [self](boost::system::error_code const& _ec, size_t)
+	{
+		if (_ec)
+		{
+			self->close();
+			return;
+		}
+		self->m_out.pop_front();
+		if (!self->m_out.empty())
+			self->write();
+		else
+			self->closeIfDone();
+	});
+}
+
+void WebConnection::closeIfDone()
+{
+	if ((m_closing || m_ended) && !m_busy && m_requests.empty() && m_out.empty())
+		close();
+}
+
+void WebConnection::close()
+{
+	if (!m_open)
+		return;
+	m_open = false;
+	boost::system::error_code ec;
+	m_socket.close(ec);
+	m_server.m_connections.erase(shared_from_this());
+}
+
+WebServer::WebServer(unsigned short _port, string const& _address, unsigned _threads):
+	m_endpoint(ba::ip::address::from_string(_address), _port),
+	m_threads(_threads ? _threads : max(std::thread::hardware_concurrency(), 1u))
+{
+}
+
+WebServer::~WebServer()
+{
+	StopListening();
+}
+
+bool WebServer::StartListening()
+{
+	if (m_thread.joinable())
+		return false;
+	try
+	{
+		m_acceptor.reset(new tcp::acceptor(m_io, m_endpoint));
+	}
+	catch (...)
+	{
+		cwarn << "Couldn't listen for JSON-RPC on" << m_endpoint << ":" << boost::current_exception_diagnostic_information();
+		return false;
+	}
+	m_io.reset();
+	accept();
+	m_thread = std::thread([=](){ m_io.run(); });
+
+	m_pool.reset();
+	m_poolWork.reset(new ba::io_service::work(m_pool));
+	for (unsigned i = 0; i < m_threads; ++i)
+		m_poolThreads.push_back(std::thread([=](){ m_pool.run(); }));
+	return true;
+}
+
+bool WebServer::StopListening()
+{
+	if (!m_thread.joinable())
+		return false;
+	m_io.post([=]()
+	{
+		boost::system::error_code ec;
+		m_acceptor->close(ec);
+		auto connections = m_connections;
+		for (auto const& c: connections)
+			c->close();
+		m_waiting.clear();
+		m_io.stop();
+	});
+	m_thread.join();
+	m_acceptor.reset();
+
+	m_poolWork.reset();
+	for (auto& t: m_poolThreads)
+		t.join();
+	m_poolThreads.clear();
+	return true;
+}
+
+bool WebServer::SendResponse(string const& _response, void* _addInfo)
+{
+	if (!_addInfo)
+		return false;
+	*static_cast<string*>(_addInfo) = _response;
+	return true;
+}
+
+void WebServer::accept()
+{
+	auto c = make_shared<WebConnection>(*this);
+	m_acceptor->async_accept(c->m_socket, [=](boost::system::error_code const& _ec)
+	{
+		if (_ec == ba::error::operation_aborted)
+			return;
+		if (!_ec)
+		{
+			boost::system::error_code ec;
+			c->m_socket.set_option(tcp::no_delay(true), ec);
+			m_connections.insert(c);
+			c->read();
+		}
+		accept();
+	});
+}
+
+void WebServer::dispatch(shared_ptr<WebConnection> const& _c)
+{
+	if (m_inFlight >= m_threads * c_queuedPerThread)
+	{
+		m_waiting.push_back(_c);
+		return;
+	}
+	++m_inFlight;
+	string request = _c->m_requests.front().body;
+	m_pool.post([=]()
+	{
+		string response;
+		try
+		{
+			OnRequest(request, &response);
+		}
+		catch (...)
+		{
+			cwarn << "Unexpected exception in JSON-RPC call:" << boost::current_exception_diagnostic_information();
+		}
+		m_io.post([=]()
+		{
+			noteDone();
+			_c->respond(response);
+		});
+	});
+}
+
+void WebServer::noteDone()
+{
+	--m_inFlight;
+	while (!m_waiting.empty() && m_inFlight < m_threads * c_queuedPerThread)
+	{
+		auto c = m_waiting.front();
+		m_waiting.pop_front();
+		if (c->m_open)
+			dispatch(c);
+	}
+}
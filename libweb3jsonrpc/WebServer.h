@@ -0,0 +1,135 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file WebServer.h
+ * @date 2015
+ */
+
+#pragma once
+
+// Make sure boost/asio.hpp is included before windows.h.
+#include <boost/asio.hpp>
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <jsonrpccpp/server.h>
+
+namespace dev
+{
+
+class WebServer;
+
+/// A client's connection to a WebServer: HTTP/1.1, kept alive and perhaps pipelined, or a WebSocket once upgraded.
+/// Everything here is only touched on the server's thread.
+class WebConnection: public std::enable_shared_from_this<WebConnection>
+{
+	friend class WebServer;
+
+public:
+	WebConnection(WebServer& _server);
+
+private:
+	/// A request taken from the connection, waiting for its reply to be sent in turn.
+	struct Request
+	{
+		std::string body;				///< The JSON-RPC request to handle, if any.
+		std::string raw;				///< Otherwise, what is sent back as it is.
+		std::string status;				///< Otherwise, the HTTP status sent back, without a body.
+		bool webSocket = false;			///< Whether the reply goes in a WebSocket frame rather than an HTTP response.
+	};
+
+	void read();
+	/// Takes whole HTTP requests, or WebSocket messages, from m_in while there is room for them.
+	void parse();
+	/// @returns false if m_in does not yet hold a whole HTTP request.
+	bool parseHttp();
+	/// @returns false if m_in does not yet hold a whole WebSocket frame.
+	bool parseFrame();
+	/// Queues @a _r as the last reply, taking no more requests.
+	void refuse(Request const& _r);
+	/// Sends the replies at the front of m_requests, and hands the next request to the server, unless one is with it.
+	void next();
+	/// Sends the reply @a _response to the request at the front of m_requests, which the server has handled.
+	void respond(std::string const& _response);
+	void reply(Request const& _r, std::string const& _response);
+	void send(std::string const& _data);
+	void write();
+	/// Closes the connection if we are to close it and have nothing left to say.
+	void closeIfDone();
+	void close();
+
+	WebServer& m_server;
+	boost::asio::ip::tcp::socket m_socket;
+	std::array<char, 8192> m_buffer;
+	std::string m_in;							///< Read but not yet taken as a request.
+	bool m_reading = false;
+	bool m_webSocket = false;
+	std::string m_message;						///< The WebSocket message whose fragments are being taken.
+
+	std::deque<Request> m_requests;
+	bool m_busy = false;						///< Whether the front of m_requests is with the server.
+	bool m_closing = false;						///< Whether we take no more requests, closing once the rest are replied to.
+	bool m_ended = false;						///< Whether the client has sent all it will.
+	std::deque<std::string> m_out;				///< The front is being written.
+	bool m_open = true;
+};
+
+/**
+ * @brief A JSON-RPC server connector over HTTP/1.1 and WebSocket.
+ * Connections are kept alive and may pipeline requests; each connection's are handled in order, and replied to in
+ * order. Requests are handled on a fixed pool of workers. When enough requests wait for them, further ones are left
+ * unread, so that clients sending faster than they are served are held back by TCP.
+ */
+class WebServer: public jsonrpc::AbstractServerConnector
+{
+	friend class WebConnection;
+
+public:
+	/// Serves on @a _port of @a _address, handling requests on @a _threads workers (one per hardware thread if 0).
+	WebServer(unsigned short _port, std::string const& _address = "0.0.0.0", unsigned _threads = 0);
+	virtual ~WebServer();
+
+	virtual bool StartListening() override;
+	virtual bool StopListening() override;
+	virtual bool SendResponse(std::string const& _response, void* _addInfo = nullptr) override;
+
+private:
+	void accept();
+	/// Hands the request at the front of @a _c 's to a worker, or, if too many wait for them, queues @a _c until one is free.
+	void dispatch(std::shared_ptr<WebConnection> const& _c);
+	/// Called on our thread once a worker is done with a request.
+	void noteDone();
+
+	boost::asio::io_service m_io;
+	boost::asio::ip::tcp::endpoint m_endpoint;
+	std::unique_ptr<boost::asio::ip::tcp::acceptor> m_acceptor;
+	std::thread m_thread;
+	std::set<std::shared_ptr<WebConnection>> m_connections;
+
+	unsigned m_threads;
+	boost::asio::io_service m_pool;							///< Handles requests.
+	std::unique_ptr<boost::asio::io_service::work> m_poolWork;
+	std::vector<std::thread> m_poolThreads;
+	unsigned m_inFlight = 0;								///< Requests handed to the pool and not yet done.
+	std::deque<std::shared_ptr<WebConnection>> m_waiting;	///< Connections with a request for the pool once it has room.
+};
+
+}
@@ -32,6 +32,8 @@
 #include <libsolidity/SourceReferenceFormatter.h>
 #endif
 #include <libevmcore/Instruction.h>
+#include <libevm/VMProfiler.h>
+#include <libdevcore/Metrics.h>
 #include <liblll/Compiler.h>
 #include <libethereum/Client.h>
 #include <libwebthree/WebThree.h>
@@ -170,6 +172,75 @@ static Json::Value toJson(map<u256, u256> const& _storage)
 	return res;
 }
 
+static Json::Value toJson(h256 const& _codeHash, dev::eth::CodeProfile const& _p)
+{
+	Json::Value res;
+	res["codeHash"] = toJS(_codeHash);
+	res["runs"] = toJS(_p.runs);
+	res["steps"] = toJS(_p.steps);
+	res["gas"] = toJS(_p.gas);
+	res["microseconds"] = toJS(chrono::duration_cast<chrono::microseconds>(_p.time).count());
+	Json::Value opcodes(Json::arrayValue);
+	for (auto const& o: _p.hottest())
+	{
+		Json::Value op;
+		op["opcode"] = dev::eth::instructionInfo((dev::eth::Instruction)o.first).name;
+		op["count"] = toJS(o.second.count);
+		op["gas"] = toJS(o.second.gas);
+		opcodes.append(op);
+	}
+	res["opcodes"] = opcodes;
+	return res;
+}
+
+static Json::Value toJson(std::vector<bytes> const& _proof)
+{
+	Json::Value res(Json::arrayValue);
+	for (auto const& n: _proof)
+		res.append(toJS(n));
+	return res;
+}
+
+static Json::Value toJson(Address const& _a, dev::eth::StateProof const& _p)
+{
+	// The values are read back from the proofs themselves, so that they are what a verifier would find.
+	Json::Value res;
+	res["address"] = toJS(_a);
+	res["stateRoot"] = toJS(_p.root);
+	res["accountProof"] = toJson(_p.account);
+	string account;
+	verifyTrieProof(_p.root, sha3(_a).ref(), _p.account, account);
+	h256 storageRoot = EmptyTrie;
+	if (account.size())
+	{
+		RLP r(account);
+		res["nonce"] = toJS(r[0].toInt<u256>());
+		res["balance"] = toJS(r[1].toInt<u256>());
+		storageRoot = r[2].toHash<h256>();
+		res["codeHash"] = toJS(r[3].toHash<h256>());
+	}
+	else
+	{
+		res["nonce"] = toJS(u256(0));
+		res["balance"] = toJS(u256(0));
+		res["codeHash"] = toJS(EmptySHA3);
+	}
+	res["storageHash"] = toJS(storageRoot);
+	Json::Value storage(Json::arrayValue);
+	for (auto const& i: _p.storage)
+	{
+		Json::Value s;
+		string v;
+		verifyTrieProof(storageRoot, sha3(h256(i.first)).ref(), i.second, v);
+		s["key"] = toJS(i.first);
+		s["value"] = toJS(v.size() ? RLP(v).toInt<u256>() : u256(0));
+		s["proof"] = toJson(i.second);
+		storage.append(s);
+	}
+	res["storageProof"] = storage;
+	return res;
+}
+
 static dev::eth::LogFilter toLogFilter(Json::Value const& _json)	// commented to avoid warning. Uncomment once in use @ PoC-7.
 {
 	dev::eth::LogFilter filter;
@@ -258,6 +329,11 @@ static Json::Value toJson(h256 const& _h, shh::Envelope const& _e, shh::Message
 	return res;
 }
 
+static MetricHistogram& rpcTime(string const& _method)
+{
+	return Metrics::get().histogram("rpc_request_seconds", "Time to handle a JSON-RPC call, by method.", "method=\"" + _method + "\"");
+}
+
 WebThreeStubServerBase::WebThreeStubServerBase(AbstractServerConnector& _conn, vector<dev::KeyPair> const& _accounts):
 	AbstractWebThreeStubServer(_conn), m_accounts(make_shared<AccountHolder>(bind(&WebThreeStubServerBase::client, this)))
 {
@@ -286,6 +362,33 @@ bool WebThreeStubServerBase::net_listening()
 	return network()->isNetworkStarted();
 }
 
+Json::Value WebThreeStubServerBase::net_peers()
+{
+	Json::Value res(Json::arrayValue);
+	for (p2p::PeerSessionInfo const& i: network()->peers())
+	{
+		Json::Value p;
+		p["id"] = toJS(i.id);
+		p["clientVersion"] = i.clientVersion;
+		p["host"] = i.host;
+		p["port"] = i.port;
+		p["latency"] = (Json::UInt64)chrono::duration_cast<chrono::milliseconds>(i.lastPing).count();
+		Json::Value caps(Json::arrayValue);
+		for (auto const& c: i.caps)
+			caps.append(c.first + "/" + toString(c.second));
+		p["caps"] = caps;
+		p["ingress"] = (Json::UInt64)i.traffic.ingress;
+		p["egress"] = (Json::UInt64)i.traffic.egress;
+		for (auto const& t: i.capTraffic)
+		{
+			p["capTraffic"][t.first]["ingress"] = (Json::UInt64)t.second.ingress;
+			p["capTraffic"][t.first]["egress"] = (Json::UInt64)t.second.egress;
+		}
+		res.append(p);
+	}
+	return res;
+}
+
 string WebThreeStubServerBase::eth_protocolVersion()
 {
 	return toJS(eth::c_protocolVersion);
@@ -349,6 +452,22 @@ string WebThreeStubServerBase::eth_getStorageAt(string const& _address, string c
 	}
 }
 
+Json::Value WebThreeStubServerBase::eth_getProof(string const& _address, Json::Value const& _storageKeys, string const& _blockNumber)
+{
+	try
+	{
+		Address a = jsToAddress(_address);
+		u256s slots;
+		for (auto const& i: _storageKeys)
+			slots.push_back(jsToU256(i.asString()));
+		return toJson(a, client()->proofAt(a, slots, jsToBlockNumber(_blockNumber)));
+	}
+	catch (...)
+	{
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	}
+}
+
 string WebThreeStubServerBase::eth_getTransactionCount(string const& _address, string const& _blockNumber)
 {
 	try
@@ -452,21 +571,27 @@ static TransactionSkeleton toTransaction(Json::Value const& _json)
 	return ret;
 }
 
+TransactionSkeleton WebThreeStubServerBase::toCompleteTransaction(Json::Value const& _json)
+{
+	TransactionSkeleton t = toTransaction(_json);
+	if (!t.from)
+		t.from = m_accounts->getDefaultTransactAccount();
+	if (!t.gasPrice)
+		t.gasPrice = 10 * dev::eth::szabo;		// TODO: should be determined by user somehow.
+	if (!t.gas)
+		t.gas = min<u256>(client()->gasLimitRemaining(), client()->balanceAt(t.from) / t.gasPrice);
+	return t;
+}
+
 string WebThreeStubServerBase::eth_sendTransaction(Json::Value const& _json)
 {
 	try
 	{
 		string ret;
-		TransactionSkeleton t = toTransaction(_json);
+		TransactionSkeleton t = toCompleteTransaction(_json);
 	
-		if (!t.from)
-			t.from = m_accounts->getDefaultTransactAccount();
 		if (t.creation)
 			ret = toJS(right160(sha3(rlpList(t.from, client()->countAt(t.from)))));;
-		if (!t.gasPrice)
-			t.gasPrice = 10 * dev::eth::szabo;		// TODO: should be determined by user somehow.
-		if (!t.gas)
-			t.gas = min<u256>(client()->gasLimitRemaining(), client()->balanceAt(t.from) / t.gasPrice);
 
 		if (m_accounts->isRealAccount(t.from))
 			authenticate(t, false);
@@ -481,6 +606,39 @@ string WebThreeStubServerBase::eth_sendTransaction(Json::Value const& _json)
 	}
 }
 
+Json::Value WebThreeStubServerBase::eth_sendTransactions(Json::Value const& _json)
+{
+	try
+	{
+		Json::Value ret(Json::arrayValue);
+		vector<TransactionSkeleton> real;
+		map<Address, u256> nonces;
+		for (Json::Value const& json: _json)
+		{
+			TransactionSkeleton t = toCompleteTransaction(json);
+
+			// The creation address counts the transactions from the same sender earlier in the batch.
+			auto nonce = nonces.find(t.from);
+			if (nonce == nonces.end())
+				nonce = nonces.insert(make_pair(t.from, client()->countAt(t.from))).first;
+			ret.append(t.creation ? toJS(right160(sha3(rlpList(t.from, nonce->second)))) : string());
+			++nonce->second;
+
+			if (m_accounts->isRealAccount(t.from))
+				real.push_back(t);
+			else if (m_accounts->isProxyAccount(t.from))
+				authenticate(t, true);
+		}
+		if (!real.empty())
+			authenticate(real);
+		return ret;
+	}
+	catch (...)
+	{
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	}
+}
+
 
 string WebThreeStubServerBase::eth_call(Json::Value const& _json, string const& _blockNumber)
 {
@@ -505,6 +663,30 @@ string WebThreeStubServerBase::eth_call(Json::Value const& _json, string const&
 	
 }
 
+string WebThreeStubServerBase::eth_estimateGas(Json::Value const& _json, string const& _blockNumber)
+{
+	u256 gas;
+	try
+	{
+		TransactionSkeleton t = toTransaction(_json);
+		if (!t.from)
+			t.from = m_accounts->getDefaultTransactAccount();
+		if (!t.gasPrice)
+			t.gasPrice = 10 * dev::eth::szabo;
+		if (!t.gas)
+			t.gas = client()->gasLimitRemaining();
+
+		gas = client()->estimateGas(m_accounts->secretKey(t.from), t.value, t.creation ? Address() : t.to, t.data, t.gas, t.gasPrice, jsToBlockNumber(_blockNumber));
+	}
+	catch (...)
+	{
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	}
+	if (!gas)
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS, "Transaction fails with any gas allowed"));
+	return toJS(gas);
+}
+
 bool WebThreeStubServerBase::eth_flush()
 {
 	client()->flushTransactions();
@@ -635,7 +817,7 @@ string WebThreeStubServerBase::eth_compileSerpent(string const& _code)
 #if ETH_SERPENT || !ETH_TRUE
 	try
 	{
-		res = toJS(dev::asBytes(::compile(_code)));
+		res = toJS(dev::asBytes(::compile(_code, true)));
 	}
 	catch (string err)
 	{
@@ -754,6 +936,312 @@ Json::Value WebThreeStubServerBase::eth_getLogs(Json::Value const& _json)
 	}
 }
 
+/// The most blocks eth_getBlocksRlp gives at once.
+static const unsigned c_maxRlpBlocks = 1024;
+
+/// Calls @a _f with the RLP of each block there is of the @a _count from @a _from, oldest first, as the chain keeps it;
+/// if @a _withReceipts, as [block, receipts].
+static void forBlocksRlp(Interface* _c, string const& _from, string const& _count, bool _withReceipts, function<void(bytes const&)> const& _f)
+{
+	unsigned from;
+	unsigned count;
+	try
+	{
+		BlockNumber b = jsToBlockNumber(_from);
+		from = b == LatestBlock || b == PendingBlock ? _c->number() : b;
+		count = min<unsigned>(jsToInt(_count), c_maxRlpBlocks);
+	}
+	catch (...)
+	{
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	}
+	unsigned number = _c->number();
+	for (unsigned n = from; n <= number && n - from < count; ++n)
+	{
+		h256 h = _c->hashFromNumber(n);
+		if (!_withReceipts)
+			_f(_c->blockRLP(h));
+		else
+		{
+			RLPStream s(2);
+			s.appendRaw(_c->blockRLP(h)).appendRaw(_c->receiptsRLP(h));
+			_f(s.out());
+		}
+	}
+}
+
+Json::Value WebThreeStubServerBase::eth_getBlocksRlp(string const& _from, string const& _count, bool _withReceipts)
+{
+	Json::Value ret(Json::arrayValue);
+	forBlocksRlp(client(), _from, _count, _withReceipts, [&](bytes const& _b){ ret.append(toJS(_b)); });
+	return ret;
+}
+
+bool WebThreeStubServerBase::isReadOnly(string const& _method) const
+{
+	static const set<string> s_readOnly = {
+		"web3_sha3", "web3_clientVersion", "net_version", "net_peerCount", "net_listening", "net_peers",
+		"eth_protocolVersion", "eth_hashrate", "eth_coinbase", "eth_mining", "eth_gasPrice", "eth_accounts", "eth_blockNumber",
+		"eth_getBalance", "eth_getStorageAt", "eth_getProof", "eth_getTransactionCount", "eth_getCode", "eth_call", "eth_estimateGas",
+		"eth_getBlockTransactionCountByHash", "eth_getBlockTransactionCountByNumber",
+		"eth_getUncleCountByBlockHash", "eth_getUncleCountByBlockNumber",
+		"eth_getBlockByHash", "eth_getBlockByNumber", "eth_getTransactionByHash",
+		"eth_getTransactionByBlockHashAndIndex", "eth_getTransactionByBlockNumberAndIndex",
+		"eth_getUncleByBlockHashAndIndex", "eth_getUncleByBlockNumberAndIndex",
+		"eth_getCompilers", "eth_getLogs", "eth_getBlocksRlp", "debug_accountRangeAt", "debug_storageRangeAt", "debug_traceAccesses", "db_get"
+	};
+	return s_readOnly.count(_method);
+}
+
+function<void(function<void()> const&)> WebThreeStubServerBase::snapshot()
+{
+	return client()->snapshot();
+}
+
+/// Blocks whose logs are gathered at a time when a log query is streamed.
+static const unsigned c_streamedLogBlocks = 1024;
+
+/// @returns @a _v as compact JSON text, without the newline Json::FastWriter ends it with.
+static string toText(Json::Value const& _v)
+{
+	string ret = Json::FastWriter().write(_v);
+	if (!ret.empty() && ret.back() == '\n')
+		ret.pop_back();
+	return ret;
+}
+
+bool WebThreeStubServerBase::isStreamed(string const& _method) const
+{
+	return _method == "eth_getLogs" || _method == "eth_getFilterLogs" || _method == "eth_getBlockByHash" || _method == "eth_getBlockByNumber" || _method == "eth_getBlocksRlp";
+}
+
+void WebThreeStubServerBase::HandleMethodCall(Procedure& _proc, Json::Value const& _input, Json::Value& _output)
+{
+	MetricTimer t(rpcTime(_proc.GetProcedureName()));
+	AbstractWebThreeStubServer::HandleMethodCall(_proc, _input, _output);
+}
+
+void WebThreeStubServerBase::stream(string const& _method, Json::Value const& _params, function<void(string const&)> const& _write)
+{
+	MetricTimer t(rpcTime(_method));
+	if (!_params.isArray())
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	bool first = true;
+	auto writeEntry = [&](LocalisedLogEntry const& _e)
+	{
+		_write((first ? "[" : ",") + toText(toJson(_e)));
+		first = false;
+	};
+
+	if (_method == "eth_getBlockByHash" || _method == "eth_getBlockByNumber")
+	{
+		BlockInfo bi;
+		UncleHashes us;
+		Transactions ts;
+		bool full = _params[1u].isBool() && _params[1u].asBool();
+		if (!_params[0u].isString() || !full)
+		{
+			// Without the transactions a block is small enough to be made whole.
+			if (_method == "eth_getBlockByHash")
+				_write(toText(eth_getBlockByHash(_params[0u].asString(), full)));
+			else
+				_write(toText(eth_getBlockByNumber(_params[0u].asString(), full)));
+			return;
+		}
+		try
+		{
+			h256 h = _method == "eth_getBlockByHash" ? jsToFixed<32>(_params[0u].asString()) : client()->hashFromNumber(jsToBlockNumber(_params[0u].asString()));
+			bi = client()->blockInfo(h);
+			us = client()->uncleHashes(h);
+			ts = client()->transactions(h);
+		}
+		catch (...)
+		{
+			BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+		}
+		if (!bi)
+		{
+			_write("null");
+			return;
+		}
+		// The block without its transactions, left open for them.
+		Json::Value b = toJson(bi, us, TransactionHashes());
+		b.removeMember("transactions");
+		string head = toText(b);
+		head.pop_back();
+		_write(head + ",\"transactions\":[");
+		for (unsigned i = 0; i < ts.size(); ++i)
+			_write((i ? "," : "") + toText(toJson(ts[i])));
+		_write("]}");
+	}
+	else if (_method == "eth_getFilterLogs")
+	{
+		LocalisedLogEntries es;
+		try
+		{
+			es = client()->logs(jsToInt(_params[0u].asString()));
+		}
+		catch (...)
+		{
+			BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+		}
+		for (auto const& e: es)
+			writeEntry(e);
+		_write(first ? "[]" : "]");
+	}
+	else if (_method == "eth_getLogs")
+	{
+		LogFilter f;
+		try
+		{
+			f = toLogFilter(_params[0u]);
+		}
+		catch (...)
+		{
+			BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+		}
+
+		// The range is gathered a window of blocks at a time, newest first, as logs() orders them, so that only
+		// one window's entries are held at once. Pending entries come last. All are read from one snapshot.
+		client()->snapshot()([&]()
+		{
+			unsigned number = client()->number();
+			unsigned begin = min<unsigned>(number + 1, f.latest());
+			unsigned end = min(number, min(begin, f.earliest()));
+			for (unsigned top = min(begin, number) + 1; top > end; top -= min(top - end, c_streamedLogBlocks))
+			{
+				unsigned bottom = top - min(top - end, c_streamedLogBlocks);
+				for (auto const& e: client()->logs(LogFilter(f).withEarliest(bottom).withLatest(top - 1)))
+					writeEntry(e);
+			}
+			if (begin > number)
+				for (auto const& e: client()->logs(LogFilter(f).withEarliest(PendingBlock).withLatest(PendingBlock)))
+					if (e.number > number)
+						writeEntry(e);
+		});
+		_write(first ? "[]" : "]");
+	}
+	else if (_method == "eth_getBlocksRlp")
+	{
+		// Each block is written out as it is read, all from one snapshot.
+		client()->snapshot()([&]()
+		{
+			forBlocksRlp(client(), _params[0u].asString(), _params[1u].asString(), _params[2u].asBool(), [&](bytes const& _b)
+			{
+				_write((first ? "[\"" : ",\"") + toJS(_b) + "\"");
+				first = false;
+			});
+		});
+		_write(first ? "[]" : "]");
+	}
+	else
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_REQUEST));
+}
+
+static shared_ptr<StreamConnection> subscriber()
+{
+	auto ret = StreamConnection::current();
+	if (!ret)
+		// There is nowhere to push to; filters are polled instead.
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_REQUEST));
+	return ret;
+}
+
+/// @returns a handler pushing the changes of a watch, as given by @a _toJson, down @a _c while it is open.
+static ChangesHandler pushTo(shared_ptr<StreamConnection> const& _c, function<Json::Value(LocalisedLogEntries const&)> const& _toJson)
+{
+	weak_ptr<StreamConnection> wc = _c;
+	return [=](unsigned _watchId, LocalisedLogEntries const& _es)
+	{
+		if (auto c = wc.lock())
+		{
+			Json::Value n;
+			n["jsonrpc"] = "2.0";
+			n["method"] = "eth_subscription";
+			n["params"]["subscription"] = toJS(_watchId);
+			n["params"]["result"] = _toJson(_es);
+			c->push(Json::FastWriter().write(n));
+		}
+	};
+}
+
+string WebThreeStubServerBase::eth_subscribe(Json::Value const& _json)
+{
+	auto c = subscriber();
+	LogFilter f;
+	try
+	{
+		f = toLogFilter(_json);
+	}
+	catch (...)
+	{
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	}
+	return noteSubscription(c, client()->installWatch(f, pushTo(c, [](LocalisedLogEntries const& _es){ return toJson(_es); })));
+}
+
+string WebThreeStubServerBase::eth_subscribeBlocks(string const& _filter)
+{
+	auto c = subscriber();
+	if (_filter == "chain" || _filter == "latest")
+	{
+		// Each notification gives the new head's hash.
+		Interface* cl = client();
+		return noteSubscription(c, cl->installWatch(dev::eth::ChainChangedFilter, pushTo(c, [=](LocalisedLogEntries const&){ return Json::Value(toJS(cl->hashFromNumber(LatestBlock))); })));
+	}
+	else if (_filter == "pending")
+		return noteSubscription(c, client()->installWatch(dev::eth::PendingChangedFilter, pushTo(c, [](LocalisedLogEntries const&){ return Json::Value(); })));
+	BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+}
+
+bool WebThreeStubServerBase::eth_unsubscribe(string const& _subscriptionId)
+{
+	auto c = subscriber();
+	unsigned id;
+	try
+	{
+		id = jsToInt(_subscriptionId);
+	}
+	catch (...)
+	{
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	}
+	{
+		Guard l(x_subscriptions);
+		auto it = m_subscriptions.find(c.get());
+		if (it == m_subscriptions.end() || !it->second.erase(id))
+			return false;
+	}
+	return client()->uninstallWatch(id);
+}
+
+string WebThreeStubServerBase::noteSubscription(shared_ptr<StreamConnection> const& _c, unsigned _watchId)
+{
+	bool first;
+	{
+		Guard l(x_subscriptions);
+		first = !m_subscriptions.count(_c.get());
+		m_subscriptions[_c.get()].insert(_watchId);
+	}
+	if (first)
+	{
+		StreamConnection const* c = _c.get();
+		Interface* cl = client();
+		_c->onClose([=]()
+		{
+			set<unsigned> watches;
+			{
+				Guard l(x_subscriptions);
+				swap(watches, m_subscriptions[c]);
+				m_subscriptions.erase(c);
+			}
+			for (unsigned w: watches)
+				cl->uninstallWatch(w);
+		});
+	}
+	return toJS(_watchId);
+}
+
 Json::Value WebThreeStubServerBase::eth_getWork()
 {
 	Json::Value ret(Json::arrayValue);
@@ -817,6 +1305,145 @@ Json::Value WebThreeStubServerBase::eth_fetchQueuedTransactions(string const& _a
 	}
 }
 
+bool WebThreeStubServerBase::debug_setVMProfiling(bool _enabled)
+{
+	VMProfiler::get().setEnabled(_enabled);
+	return true;
+}
+
+Json::Value WebThreeStubServerBase::debug_vmProfile(bool _reset)
+{
+	Json::Value res(Json::arrayValue);
+	for (auto const& p: VMProfiler::get().hotSpots())
+		res.append(toJson(p.first, p.second));
+	if (_reset)
+		VMProfiler::get().reset();
+	return res;
+}
+
+Json::Value WebThreeStubServerBase::debug_lockProfile(bool _reset)
+{
+	Json::Value res(Json::arrayValue);
+	for (auto const& p: lockProfile())
+	{
+		Json::Value l;
+		l["name"] = p.name;
+		l["acquisitions"] = toJS(p.acquisitions);
+		l["contentions"] = toJS(p.contentions);
+		l["waitMs"] = p.waitMs;
+		l["maxWaitMs"] = p.maxWaitMs;
+		l["holdMs"] = p.holdMs;
+		l["maxHoldMs"] = p.maxHoldMs;
+		res.append(l);
+	}
+	if (_reset)
+		resetLockProfile();
+	return res;
+}
+
+Json::Value WebThreeStubServerBase::debug_accountRangeAt(string const& _blockNumber, string const& _from, string const& _limit)
+{
+	try
+	{
+		Json::Value accounts(Json::arrayValue);
+		bytes from = jsToBytes(_from);
+		bytes next = client()->accountRangeAt(&from, jsToInt(_limit), [&](bytesConstRef _key, bytesConstRef _value)
+		{
+			RLP r(_value);
+			Json::Value a;
+			a["key"] = toJS(_key.toBytes());
+			a["nonce"] = toJS(r[0].toInt<u256>());
+			a["balance"] = toJS(r[1].toInt<u256>());
+			a["storageHash"] = toJS(r[2].toHash<h256>());
+			a["codeHash"] = toJS(r[3].toHash<h256>());
+			accounts.append(a);
+		}, jsToBlockNumber(_blockNumber));
+		Json::Value res;
+		res["accounts"] = accounts;
+		res["next"] = next.empty() ? Json::Value() : Json::Value(toJS(next));
+		return res;
+	}
+	catch (...)
+	{
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	}
+}
+
+Json::Value WebThreeStubServerBase::debug_storageRangeAt(string const& _blockNumber, string const& _address, string const& _from, string const& _limit)
+{
+	try
+	{
+		Json::Value storage(Json::arrayValue);
+		bytes from = jsToBytes(_from);
+		bytes next = client()->storageRangeAt(jsToAddress(_address), &from, jsToInt(_limit), [&](bytesConstRef _key, bytesConstRef _value)
+		{
+			Json::Value s;
+			s["key"] = toJS(_key.toBytes());
+			s["value"] = toJS(RLP(_value).toInt<u256>());
+			storage.append(s);
+		}, jsToBlockNumber(_blockNumber));
+		Json::Value res;
+		res["storage"] = storage;
+		res["next"] = next.empty() ? Json::Value() : Json::Value(toJS(next));
+		return res;
+	}
+	catch (...)
+	{
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	}
+}
+
+Json::Value WebThreeStubServerBase::debug_traceAccesses(Json::Value const& _json, string const& _blockNumber)
+{
+	ExecutionResult er;
+	try
+	{
+		TransactionSkeleton t = toTransaction(_json);
+		if (!t.from)
+			t.from = m_accounts->getDefaultTransactAccount();
+		if (!t.gasPrice)
+			t.gasPrice = 10 * dev::eth::szabo;
+		if (!t.gas)
+			t.gas = client()->gasLimitRemaining();
+
+		er = client()->traceAccesses(m_accounts->secretKey(t.from), t.value, t.creation ? Address() : t.to, t.data, t.gas, t.gasPrice, jsToBlockNumber(_blockNumber));
+	}
+	catch (...)
+	{
+		BOOST_THROW_EXCEPTION(JsonRpcException(Errors::ERROR_RPC_INVALID_PARAMS));
+	}
+
+	AccessSet const& a = er.accesses;
+	Json::Value accounts(Json::arrayValue);
+	for (auto const& i: a.accounts)
+	{
+		Json::Value r;
+		r["address"] = toJS(i.first);
+		r["read"] = !!(i.second & AccessSet::Read);
+		r["written"] = !!(i.second & AccessSet::Written);
+		accounts.append(r);
+	}
+	Json::Value storage(Json::arrayValue);
+	for (auto const& i: a.storage)
+	{
+		Json::Value r;
+		r["address"] = toJS(i.first.first);
+		r["key"] = toJS(i.first.second);
+		r["read"] = !!(i.second & AccessSet::Read);
+		r["written"] = !!(i.second & AccessSet::Written);
+		storage.append(r);
+	}
+	Json::Value code(Json::arrayValue);
+	for (auto const& i: a.code)
+		code.append(toJS(i));
+
+	Json::Value res;
+	res["accounts"] = accounts;
+	res["storage"] = storage;
+	res["code"] = code;
+	return res;
+}
+
 bool WebThreeStubServerBase::db_put(string const& _name, string const& _key, string const& _value)
 {
 	db()->put(_name, _key,_value);
@@ -988,6 +1615,14 @@ void WebThreeStubServerBase::authenticate(TransactionSkeleton const& _t, bool _t
 		client()->submitTransaction(m_accounts->secretKey(_t.from), _t.value, _t.data, _t.gas, _t.gasPrice);
 }
 
+void WebThreeStubServerBase::authenticate(vector<TransactionSkeleton> const& _ts)
+{
+	vector<Secret> secrets;
+	for (TransactionSkeleton const& t: _ts)
+		secrets.push_back(m_accounts->secretKey(t.from));
+	client()->submitTransactions(secrets, _ts);
+}
+
 void WebThreeStubServerBase::setAccounts(const vector<KeyPair>& _accounts)
 {
 	m_accounts->setAccounts(_accounts);
@@ -23,14 +23,18 @@
 
 #pragma once
 
+#include <map>
 #include <memory>
 #include <iostream>
+#include <set>
 #include <jsonrpccpp/server.h>
+#include <libdevcore/Guards.h>
 #include <libdevcrypto/Common.h>
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 #include "abstractwebthreestubserver.h"
 #pragma GCC diagnostic pop
+#include "StreamServer.h"
 
 
 namespace dev
@@ -65,17 +69,27 @@ public:
  * @todo split these up according to subprotocol (eth, shh, db, p2p, web3) and make it /very/ clear about how to add other subprotocols.
  * @todo modularise everything so additional subprotocols don't need to change this file.
  */
-class WebThreeStubServerBase: public AbstractWebThreeStubServer
+class WebThreeStubServerBase: public AbstractWebThreeStubServer, public StreamServerFace
 {
 public:
 	WebThreeStubServerBase(jsonrpc::AbstractServerConnector& _conn, std::vector<dev::KeyPair> const& _accounts);
 
+	/// StreamServerFace
+	virtual bool isReadOnly(std::string const& _method) const override;
+	virtual std::function<void(std::function<void()> const&)> snapshot() override;
+	virtual bool isStreamed(std::string const& _method) const override;
+	virtual void stream(std::string const& _method, Json::Value const& _params, std::function<void(std::string const&)> const& _write) override;
+
+	/// Handles each call, timing it into the process's Metrics.
+	virtual void HandleMethodCall(jsonrpc::Procedure& _proc, Json::Value const& _input, Json::Value& _output) override;
+
 	virtual std::string web3_sha3(std::string const& _param1);
 	virtual std::string web3_clientVersion() { return "C++ (ethereum-cpp)"; }
 
 	virtual std::string net_version() { return ""; }
 	virtual std::string net_peerCount();
 	virtual bool net_listening();
+	virtual Json::Value net_peers();
 
 	virtual std::string eth_protocolVersion();
 	virtual std::string eth_hashrate();
@@ -86,6 +100,7 @@ public:
 	virtual std::string eth_blockNumber();
 	virtual std::string eth_getBalance(std::string const& _address, std::string const& _blockNumber);
 	virtual std::string eth_getStorageAt(std::string const& _address, std::string const& _position, std::string const& _blockNumber);
+	virtual Json::Value eth_getProof(std::string const& _address, Json::Value const& _storageKeys, std::string const& _blockNumber);
 	virtual std::string eth_getTransactionCount(std::string const& _address, std::string const& _blockNumber);
 	virtual std::string eth_getBlockTransactionCountByHash(std::string const& _blockHash);
 	virtual std::string eth_getBlockTransactionCountByNumber(std::string const& _blockNumber);
@@ -93,7 +108,9 @@ public:
 	virtual std::string eth_getUncleCountByBlockNumber(std::string const& _blockNumber);
 	virtual std::string eth_getCode(std::string const& _address, std::string const& _blockNumber);
 	virtual std::string eth_sendTransaction(Json::Value const& _json);
+	virtual Json::Value eth_sendTransactions(Json::Value const& _json);
 	virtual std::string eth_call(Json::Value const& _json, std::string const& _blockNumber);
+	virtual std::string eth_estimateGas(Json::Value const& _json, std::string const& _blockNumber);
 	virtual bool eth_flush();
 	virtual Json::Value eth_getBlockByHash(std::string const& _blockHash, bool _includeTransactions);
 	virtual Json::Value eth_getBlockByNumber(std::string const& _blockNumber, bool _includeTransactions);
@@ -112,12 +129,27 @@ public:
 	virtual Json::Value eth_getFilterChanges(std::string const& _filterId);
 	virtual Json::Value eth_getFilterLogs(std::string const& _filterId);
 	virtual Json::Value eth_getLogs(Json::Value const& _json);
+	/// @returns the blocks from @a _from, up to @a _count of them, each as the hex of its RLP, as the chain keeps it,
+	/// rather than remade as JSON; with @a _withReceipts, that of [block, receipts].
+	virtual Json::Value eth_getBlocksRlp(std::string const& _from, std::string const& _count, bool _withReceipts);
+	/// Subscriptions: as filters, but their changes are pushed as eth_subscription notifications, as they happen,
+	/// down the connection subscribing, which must be of a StreamServer. They go when it closes.
+	virtual std::string eth_subscribe(Json::Value const& _json);
+	virtual std::string eth_subscribeBlocks(std::string const& _filter);
+	virtual bool eth_unsubscribe(std::string const& _subscriptionId);
 	virtual Json::Value eth_getWork();
 	virtual bool eth_submitWork(std::string const& _nonce, std::string const& _mixHash);
 	virtual std::string eth_register(std::string const& _address);
 	virtual bool eth_unregister(std::string const& _accountId);
 	virtual Json::Value eth_fetchQueuedTransactions(std::string const& _accountId);
 	
+	virtual bool debug_setVMProfiling(bool _enabled);
+	virtual Json::Value debug_vmProfile(bool _reset);
+	virtual Json::Value debug_lockProfile(bool _reset);
+	virtual Json::Value debug_accountRangeAt(std::string const& _blockNumber, std::string const& _from, std::string const& _limit);
+	virtual Json::Value debug_storageRangeAt(std::string const& _blockNumber, std::string const& _address, std::string const& _from, std::string const& _limit);
+	virtual Json::Value debug_traceAccesses(Json::Value const& _json, std::string const& _blockNumber);
+
 	virtual bool db_put(std::string const& _name, std::string const& _key, std::string const& _value);
 	virtual std::string db_get(std::string const& _name, std::string const& _key);
 
@@ -137,6 +169,14 @@ public:
 
 protected:
 	virtual void authenticate(dev::eth::TransactionSkeleton const& _t, bool _toProxy);
+	/// Submits the transactions @a _ts, all from real accounts, as one batch.
+	virtual void authenticate(std::vector<dev::eth::TransactionSkeleton> const& _ts);
+
+	/// @returns the transaction given by @a _json, with the sender, gas and gas price it leaves out filled in.
+	dev::eth::TransactionSkeleton toCompleteTransaction(Json::Value const& _json);
+
+	/// Records the watch @a _watchId as a subscription of @a _c, to go when it closes. @returns the subscription's id.
+	std::string noteSubscription(std::shared_ptr<StreamConnection> const& _c, unsigned _watchId);
 
 protected:
 	virtual dev::eth::Interface* client() = 0;
@@ -146,6 +186,9 @@ protected:
 
 	std::map<dev::Public, dev::Secret> m_ids;
 	std::map<unsigned, dev::Public> m_shhWatches;
+
+	Mutex x_subscriptions;
+	std::map<StreamConnection const*, std::set<unsigned>> m_subscriptions;	///< The watches of each connection's subscriptions.
 	std::shared_ptr<dev::AccountHolder> m_accounts;
 };
 
@@ -17,6 +17,7 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
             this->bindAndAddMethod(jsonrpc::Procedure("net_version", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING,  NULL), &AbstractWebThreeStubServer::net_versionI);
             this->bindAndAddMethod(jsonrpc::Procedure("net_peerCount", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING,  NULL), &AbstractWebThreeStubServer::net_peerCountI);
             this->bindAndAddMethod(jsonrpc::Procedure("net_listening", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_BOOLEAN,  NULL), &AbstractWebThreeStubServer::net_listeningI);
+            this->bindAndAddMethod(jsonrpc::Procedure("net_peers", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_ARRAY,  NULL), &AbstractWebThreeStubServer::net_peersI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_protocolVersion", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING,  NULL), &AbstractWebThreeStubServer::eth_protocolVersionI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_hashrate", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING,  NULL), &AbstractWebThreeStubServer::eth_hashrateI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_coinbase", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING,  NULL), &AbstractWebThreeStubServer::eth_coinbaseI);
@@ -26,6 +27,7 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
             this->bindAndAddMethod(jsonrpc::Procedure("eth_blockNumber", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING,  NULL), &AbstractWebThreeStubServer::eth_blockNumberI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getBalance", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_getBalanceI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getStorageAt", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_STRING,"param3",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_getStorageAtI);
+            this->bindAndAddMethod(jsonrpc::Procedure("eth_getProof", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_OBJECT, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_ARRAY,"param3",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_getProofI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getTransactionCount", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_getTransactionCountI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getBlockTransactionCountByHash", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_getBlockTransactionCountByHashI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getBlockTransactionCountByNumber", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_getBlockTransactionCountByNumberI);
@@ -33,7 +35,9 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getUncleCountByBlockNumber", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_getUncleCountByBlockNumberI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getCode", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_getCodeI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_sendTransaction", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_OBJECT, NULL), &AbstractWebThreeStubServer::eth_sendTransactionI);
+            this->bindAndAddMethod(jsonrpc::Procedure("eth_sendTransactions", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_ARRAY, "param1",jsonrpc::JSON_ARRAY, NULL), &AbstractWebThreeStubServer::eth_sendTransactionsI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_call", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_OBJECT,"param2",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_callI);
+            this->bindAndAddMethod(jsonrpc::Procedure("eth_estimateGas", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_OBJECT,"param2",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_estimateGasI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_flush", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_BOOLEAN,  NULL), &AbstractWebThreeStubServer::eth_flushI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getBlockByHash", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_OBJECT, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_BOOLEAN, NULL), &AbstractWebThreeStubServer::eth_getBlockByHashI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getBlockByNumber", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_OBJECT, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_BOOLEAN, NULL), &AbstractWebThreeStubServer::eth_getBlockByNumberI);
@@ -52,11 +56,21 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getFilterChanges", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_ARRAY, "param1",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_getFilterChangesI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getFilterLogs", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_ARRAY, "param1",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_getFilterLogsI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getLogs", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_ARRAY, "param1",jsonrpc::JSON_OBJECT, NULL), &AbstractWebThreeStubServer::eth_getLogsI);
+            this->bindAndAddMethod(jsonrpc::Procedure("eth_getBlocksRlp", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_ARRAY, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_STRING,"param3",jsonrpc::JSON_BOOLEAN, NULL), &AbstractWebThreeStubServer::eth_getBlocksRlpI);
+            this->bindAndAddMethod(jsonrpc::Procedure("eth_subscribe", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_OBJECT, NULL), &AbstractWebThreeStubServer::eth_subscribeI);
+            this->bindAndAddMethod(jsonrpc::Procedure("eth_subscribeBlocks", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_subscribeBlocksI);
+            this->bindAndAddMethod(jsonrpc::Procedure("eth_unsubscribe", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_BOOLEAN, "param1",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_unsubscribeI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_getWork", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_ARRAY,  NULL), &AbstractWebThreeStubServer::eth_getWorkI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_submitWork", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_BOOLEAN, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_submitWorkI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_register", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_registerI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_unregister", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_BOOLEAN, "param1",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_unregisterI);
             this->bindAndAddMethod(jsonrpc::Procedure("eth_fetchQueuedTransactions", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_ARRAY, "param1",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::eth_fetchQueuedTransactionsI);
+            this->bindAndAddMethod(jsonrpc::Procedure("debug_setVMProfiling", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_BOOLEAN, "param1",jsonrpc::JSON_BOOLEAN, NULL), &AbstractWebThreeStubServer::debug_setVMProfilingI);
+            this->bindAndAddMethod(jsonrpc::Procedure("debug_vmProfile", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_ARRAY, "param1",jsonrpc::JSON_BOOLEAN, NULL), &AbstractWebThreeStubServer::debug_vmProfileI);
+            this->bindAndAddMethod(jsonrpc::Procedure("debug_lockProfile", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_ARRAY, "param1",jsonrpc::JSON_BOOLEAN, NULL), &AbstractWebThreeStubServer::debug_lockProfileI);
+            this->bindAndAddMethod(jsonrpc::Procedure("debug_accountRangeAt", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_OBJECT, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_STRING,"param3",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::debug_accountRangeAtI);
+            this->bindAndAddMethod(jsonrpc::Procedure("debug_storageRangeAt", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_OBJECT, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_STRING,"param3",jsonrpc::JSON_STRING,"param4",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::debug_storageRangeAtI);
+            this->bindAndAddMethod(jsonrpc::Procedure("debug_traceAccesses", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_OBJECT, "param1",jsonrpc::JSON_OBJECT,"param2",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::debug_traceAccessesI);
             this->bindAndAddMethod(jsonrpc::Procedure("db_put", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_BOOLEAN, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_STRING,"param3",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::db_putI);
             this->bindAndAddMethod(jsonrpc::Procedure("db_get", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_STRING, "param1",jsonrpc::JSON_STRING,"param2",jsonrpc::JSON_STRING, NULL), &AbstractWebThreeStubServer::db_getI);
             this->bindAndAddMethod(jsonrpc::Procedure("shh_post", jsonrpc::PARAMS_BY_POSITION, jsonrpc::JSON_BOOLEAN, "param1",jsonrpc::JSON_OBJECT, NULL), &AbstractWebThreeStubServer::shh_postI);
@@ -94,6 +108,11 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
             (void)request;
             response = this->net_listening();
         }
+        inline virtual void net_peersI(const Json::Value &request, Json::Value &response)
+        {
+            (void)request;
+            response = this->net_peers();
+        }
         inline virtual void eth_protocolVersionI(const Json::Value &request, Json::Value &response)
         {
             (void)request;
@@ -137,6 +156,10 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
         {
             response = this->eth_getStorageAt(request[0u].asString(), request[1u].asString(), request[2u].asString());
         }
+        inline virtual void eth_getProofI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->eth_getProof(request[0u].asString(), request[1u], request[2u].asString());
+        }
         inline virtual void eth_getTransactionCountI(const Json::Value &request, Json::Value &response)
         {
             response = this->eth_getTransactionCount(request[0u].asString(), request[1u].asString());
@@ -165,10 +188,18 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
         {
             response = this->eth_sendTransaction(request[0u]);
         }
+        inline virtual void eth_sendTransactionsI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->eth_sendTransactions(request[0u]);
+        }
         inline virtual void eth_callI(const Json::Value &request, Json::Value &response)
         {
             response = this->eth_call(request[0u], request[1u].asString());
         }
+        inline virtual void eth_estimateGasI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->eth_estimateGas(request[0u], request[1u].asString());
+        }
         inline virtual void eth_flushI(const Json::Value &request, Json::Value &response)
         {
             (void)request;
@@ -243,6 +274,22 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
         {
             response = this->eth_getLogs(request[0u]);
         }
+        inline virtual void eth_getBlocksRlpI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->eth_getBlocksRlp(request[0u].asString(), request[1u].asString(), request[2u].asBool());
+        }
+        inline virtual void eth_subscribeI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->eth_subscribe(request[0u]);
+        }
+        inline virtual void eth_subscribeBlocksI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->eth_subscribeBlocks(request[0u].asString());
+        }
+        inline virtual void eth_unsubscribeI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->eth_unsubscribe(request[0u].asString());
+        }
         inline virtual void eth_getWorkI(const Json::Value &request, Json::Value &response)
         {
             (void)request;
@@ -264,6 +311,30 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
         {
             response = this->eth_fetchQueuedTransactions(request[0u].asString());
         }
+        inline virtual void debug_setVMProfilingI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->debug_setVMProfiling(request[0u].asBool());
+        }
+        inline virtual void debug_vmProfileI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->debug_vmProfile(request[0u].asBool());
+        }
+        inline virtual void debug_lockProfileI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->debug_lockProfile(request[0u].asBool());
+        }
+        inline virtual void debug_accountRangeAtI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->debug_accountRangeAt(request[0u].asString(), request[1u].asString(), request[2u].asString());
+        }
+        inline virtual void debug_storageRangeAtI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->debug_storageRangeAt(request[0u].asString(), request[1u].asString(), request[2u].asString(), request[3u].asString());
+        }
+        inline virtual void debug_traceAccessesI(const Json::Value &request, Json::Value &response)
+        {
+            response = this->debug_traceAccesses(request[0u], request[1u].asString());
+        }
         inline virtual void db_putI(const Json::Value &request, Json::Value &response)
         {
             response = this->db_put(request[0u].asString(), request[1u].asString(), request[2u].asString());
@@ -314,6 +385,7 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
         virtual std::string net_version() = 0;
         virtual std::string net_peerCount() = 0;
         virtual bool net_listening() = 0;
+        virtual Json::Value net_peers() = 0;
         virtual std::string eth_protocolVersion() = 0;
         virtual std::string eth_hashrate() = 0;
         virtual std::string eth_coinbase() = 0;
@@ -323,6 +395,7 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
         virtual std::string eth_blockNumber() = 0;
         virtual std::string eth_getBalance(const std::string& param1, const std::string& param2) = 0;
         virtual std::string eth_getStorageAt(const std::string& param1, const std::string& param2, const std::string& param3) = 0;
+        virtual Json::Value eth_getProof(const std::string& param1, const Json::Value& param2, const std::string& param3) = 0;
         virtual std::string eth_getTransactionCount(const std::string& param1, const std::string& param2) = 0;
         virtual std::string eth_getBlockTransactionCountByHash(const std::string& param1) = 0;
         virtual std::string eth_getBlockTransactionCountByNumber(const std::string& param1) = 0;
@@ -330,7 +403,9 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
         virtual std::string eth_getUncleCountByBlockNumber(const std::string& param1) = 0;
         virtual std::string eth_getCode(const std::string& param1, const std::string& param2) = 0;
         virtual std::string eth_sendTransaction(const Json::Value& param1) = 0;
+        virtual Json::Value eth_sendTransactions(const Json::Value& param1) = 0;
         virtual std::string eth_call(const Json::Value& param1, const std::string& param2) = 0;
+        virtual std::string eth_estimateGas(const Json::Value& param1, const std::string& param2) = 0;
         virtual bool eth_flush() = 0;
         virtual Json::Value eth_getBlockByHash(const std::string& param1, bool param2) = 0;
         virtual Json::Value eth_getBlockByNumber(const std::string& param1, bool param2) = 0;
@@ -349,11 +424,21 @@ class AbstractWebThreeStubServer : public jsonrpc::AbstractServer<AbstractWebThr
         virtual Json::Value eth_getFilterChanges(const std::string& param1) = 0;
         virtual Json::Value eth_getFilterLogs(const std::string& param1) = 0;
         virtual Json::Value eth_getLogs(const Json::Value& param1) = 0;
+        virtual Json::Value eth_getBlocksRlp(const std::string& param1, const std::string& param2, bool param3) = 0;
+        virtual std::string eth_subscribe(const Json::Value& param1) = 0;
+        virtual std::string eth_subscribeBlocks(const std::string& param1) = 0;
+        virtual bool eth_unsubscribe(const std::string& param1) = 0;
         virtual Json::Value eth_getWork() = 0;
         virtual bool eth_submitWork(const std::string& param1, const std::string& param2) = 0;
         virtual std::string eth_register(const std::string& param1) = 0;
         virtual bool eth_unregister(const std::string& param1) = 0;
         virtual Json::Value eth_fetchQueuedTransactions(const std::string& param1) = 0;
+        virtual bool debug_setVMProfiling(bool param1) = 0;
+        virtual Json::Value debug_vmProfile(bool param1) = 0;
+        virtual Json::Value debug_lockProfile(bool param1) = 0;
+        virtual Json::Value debug_accountRangeAt(const std::string& param1, const std::string& param2, const std::string& param3) = 0;
+        virtual Json::Value debug_storageRangeAt(const std::string& param1, const std::string& param2, const std::string& param3, const std::string& param4) = 0;
+        virtual Json::Value debug_traceAccesses(const Json::Value& param1, const std::string& param2) = 0;
         virtual bool db_put(const std::string& param1, const std::string& param2, const std::string& param3) = 0;
         virtual std::string db_get(const std::string& param1, const std::string& param2) = 0;
         virtual bool shh_post(const Json::Value& param1) = 0;
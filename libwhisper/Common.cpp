@@ -42,6 +42,25 @@ CollapsedTopic dev::shh::collapse(FullTopic const& _fullTopic)
 	return ret;
 }
 
+TopicBloomFilter dev::shh::topicBloom(CollapsedTopic const& _topic)
+{
+	TopicBloomFilter ret;
+	for (auto const& t: _topic)
+		ret |= topicBloom(t);
+	return ret;
+}
+
+bool dev::shh::bloomMatches(TopicBloomFilter const& _bloom, CollapsedTopic const& _topic)
+{
+	// Only a mask without topic parts matches an envelope without any, and such a mask sets all the bits.
+	if (_topic.empty())
+		return _bloom == ~TopicBloomFilter();
+	for (auto const& t: _topic)
+		if (_bloom.contains(topicBloom(t)))
+			return true;
+	return false;
+}
+
 CollapsedTopic BuildTopic::toTopic() const
 {
 	CollapsedTopic ret;
@@ -61,7 +80,7 @@ h256 TopicFilter::sha3() const
 {
 	RLPStream s;
 	streamRLP(s);
-	return dev::sha3(s.out());
+	return dev::sha3(s.outRef());
 }
 
 bool TopicFilter::matches(Envelope const& _e) const
@@ -84,6 +103,40 @@ bool TopicFilter::matches(Envelope const& _e) const
 	return false;
 }
 
+vector<TopicBloomFilter> TopicFilter::maskBlooms() const
+{
+	vector<TopicBloomFilter> ret;
+	ret.reserve(m_topicMasks.size());
+	for (TopicMask const& t: m_topicMasks)
+	{
+		ret.push_back(TopicBloomFilter());
+		for (auto const& p: t)
+			if (p.second == ~CollapsedTopicPart())
+				ret.back() |= topicBloom(p.first);
+	}
+	return ret;
+}
+
+TopicBloomFilter TopicFilter::exportBloom() const
+{
+	TopicBloomFilter ret;
+	for (TopicMask const& t: m_topicMasks)
+	{
+		// An envelope matching the mask has at least one of the parts it matches exactly; without any, every
+		// envelope may match.
+		bool exact = false;
+		for (auto const& p: t)
+			if (p.second == ~CollapsedTopicPart())
+			{
+				ret |= topicBloom(p.first);
+				exact = true;
+			}
+		if (!exact)
+			return ~TopicBloomFilter();
+	}
+	return ret;
+}
+
 TopicMask BuildTopicMask::toTopicMask() const
 {
 	TopicMask ret;
@@ -55,7 +55,7 @@ enum WhisperPacket
 {
 	StatusPacket = 0,
 	MessagesPacket,
-	AddFilterPacket,
+	TopicFilterPacket,
 	RemoveFilterPacket,
 	PacketCount
 };
@@ -69,6 +69,17 @@ using FullTopic = h256s;
 CollapsedTopicPart collapse(FullTopicPart const& _fullTopicPart);
 CollapsedTopic collapse(FullTopic const& _fullTopic);
 
+/// A bloom filter of collapsed topic parts. Peers send one another the bloom of the topics of the envelopes they
+/// want; an envelope none of whose topics is in it is not sent.
+using TopicBloomFilter = FixedHash<64>;
+
+/// @returns the bits of @a _part in a TopicBloomFilter.
+inline TopicBloomFilter topicBloom(CollapsedTopicPart const& _part) { return _part.bloom<2, 64>(); }
+/// @returns the bits of all the parts of @a _topic.
+TopicBloomFilter topicBloom(CollapsedTopic const& _topic);
+/// @returns true if an envelope with @a _topic may be wanted by whoever sent @a _bloom.
+bool bloomMatches(TopicBloomFilter const& _bloom, CollapsedTopic const& _topic);
+
 class BuildTopic
 {
 public:
@@ -116,6 +127,13 @@ public:
 
 	bool matches(Envelope const& _m) const;
 
+	TopicMasks const& masks() const { return m_topicMasks; }
+	/// @returns for each mask, the bits of the topic parts it matches exactly, all of which an envelope's topic must
+	/// have for the mask to match it.
+	std::vector<TopicBloomFilter> maskBlooms() const;
+	/// @returns the bits of the topic parts of the envelopes that may match, or all of them if any envelope may.
+	TopicBloomFilter exportBloom() const;
+
 private:
 	TopicMasks m_topicMasks;
 };
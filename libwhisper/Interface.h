@@ -48,10 +48,14 @@ class Watch;
 
 struct InstalledFilter
 {
-	InstalledFilter(FullTopic const& _f): full(_f), filter(_f) {}
+	InstalledFilter(FullTopic const& _f): full(_f), filter(_f), blooms(filter.maskBlooms()) {}
+
+	/// @returns false if no envelope with topic bits @a _bloom can match, without going through the masks' parts.
+	bool mayMatch(TopicBloomFilter const& _bloom) const { for (auto const& b: blooms) if (_bloom.contains(b)) return true; return false; }
 
 	FullTopic full;
 	TopicFilter filter;
+	std::vector<TopicBloomFilter> blooms;	///< Those of the filter's masks.
 	unsigned refCount = 1;
 };
 
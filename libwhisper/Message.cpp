@@ -21,6 +21,8 @@
 
 #include "Message.h"
 
+#include <libdevcore/ThreadPool.h>
+
 using namespace std;
 using namespace dev;
 using namespace dev::p2p;
@@ -32,7 +34,7 @@ Message::Message(Envelope const& _e, FullTopic const& _fk, Secret const& _s)
 	{
 		bytes b;
 		if (_s)
-			if (!decrypt(_s, &(_e.data()), b))
+			if (!decrypt(_s, _e.data(), b))
 				return;
 			else{}
 		else
@@ -56,8 +58,8 @@ Message::Message(Envelope const& _e, FullTopic const& _fk, Secret const& _s)
 				return;
 
 			// get key from decrypted topic key: just xor
-			h256 tk = h256(bytesConstRef(&(_e.data())).cropped(32 * topicIndex, 32));
-			bytesConstRef cipherText = bytesConstRef(&(_e.data())).cropped(32 * _e.topic().size());
+			h256 tk = h256(_e.data().cropped(32 * topicIndex, 32));
+			bytesConstRef cipherText = _e.data().cropped(32 * _e.topic().size());
 //			cdebug << "Decrypting(" << topicIndex << "): " << topicSecret << tk << (topicSecret ^ tk) << toHex(cipherText);
 			if (!decryptSym(topicSecret ^ tk, cipherText, b))
 				return;
@@ -112,40 +114,82 @@ Envelope Message::seal(Secret _from, FullTopic const& _fullTopic, unsigned _ttl,
 		assert(recover(*(Signature*)&(input[1 + m_payload.size()]), sha3(m_payload)) == KeyPair(_from).pub());
 	}
 
+	bytes data;
 	if (m_to)
-		encrypt(m_to, &input, ret.m_data);
+		encrypt(m_to, &input, data);
 	else
 	{
 		// create the shared secret and encrypt
 		Secret s = Secret::random();
 		for (h256 const& t: _fullTopic)
-			ret.m_data += (t ^ s).asBytes();
+			data += (t ^ s).asBytes();
 		bytes d;
 		encryptSym(s, &input, d);
-		ret.m_data += d;
+		data += d;
 
 		for (unsigned i = 0; i < _fullTopic.size(); ++i)
 		{
 			bytes b;
-			h256 tk = h256(bytesConstRef(&(ret.m_data)).cropped(32 * i, 32));
-			bytesConstRef cipherText = bytesConstRef(&(ret.m_data)).cropped(32 * ret.topic().size());
+			h256 tk = h256(bytesConstRef(&data).cropped(32 * i, 32));
+			bytesConstRef cipherText = bytesConstRef(&data).cropped(32 * ret.topic().size());
 			cnote << "Test decrypting(" << i << "): " << _fullTopic[i] << tk << (_fullTopic[i] ^ tk) << toHex(cipherText);
 			assert(decryptSym(_fullTopic[i] ^ tk, cipherText, b));
 			cnote << "Got: " << toHex(b);
 		}
 	}
 
+	ret.m_bytes = make_shared<bytes const>(move(data));
+	ret.m_data = bytesConstRef(ret.m_bytes.get());
 	ret.proveWork(_workToProve);
 	return ret;
 }
 
 Envelope::Envelope(RLP const& _m)
 {
-	m_expiry = _m[0].toInt<unsigned>();
-	m_ttl = _m[1].toInt<unsigned>();
-	m_topic = _m[2].toVector<FixedHash<4>>();
-	m_data = _m[3].toBytes();
-	m_nonce = _m[4].toInt<u256>();
+	// The packet the envelope came in goes once it is read, so its RLP is copied, but just the once; the fields
+	// are read from the copy, the data staying where it is in it, and the envelope is passed on as it came.
+	m_bytes = make_shared<bytes const>(_m.data().toBytes());
+	m_hasRLP = true;
+	RLP r(*m_bytes);
+	m_expiry = r[0].toInt<unsigned>();
+	m_ttl = r[1].toInt<unsigned>();
+	m_topic = r[2].toVector<FixedHash<4>>();
+	m_data = r[3].toBytesConstRef();
+	m_nonce = r[4].toInt<u256>();
+}
+
+void Envelope::streamRLP(RLPStream& _s, IncludeNonce _withNonce) const
+{
+	if (_withNonce && m_hasRLP)
+		_s.appendRaw(*m_bytes);
+	else
+	{
+		_s.appendList(_withNonce ? 5 : 4) << m_expiry << m_ttl << m_topic << m_data;
+		if (_withNonce)
+			_s << m_nonce;
+	}
+}
+
+h256 Envelope::sha3(IncludeNonce _withNonce) const
+{
+	if (_withNonce && m_hasRLP)
+		return dev::sha3(*m_bytes);
+	RLPStream s;
+	streamRLP(s, _withNonce);
+	return dev::sha3(s.outRef());
+}
+
+void Envelope::cacheRLP()
+{
+	RLPStream s;
+	m_hasRLP = false;
+	streamRLP(s, WithNonce);
+	bytes out;
+	s.swapOut(out);
+	auto rlp = make_shared<bytes const>(move(out));
+	m_data = RLP(*rlp)[3].toBytesConstRef();
+	m_bytes = rlp;
+	m_hasRLP = true;
 }
 
 Message Envelope::open(FullTopic const& _ft, Secret const& _s) const
@@ -161,25 +205,54 @@ unsigned Envelope::workProved() const
 	return dev::sha3(bytesConstRef(d[0].data(), 64)).firstBitSet();
 }
 
-void Envelope::proveWork(unsigned _ms)
-{
-	// PoW
-	h256 d[2];
-	d[0] = sha3(WithoutNonce);
-	uint32_t& n = *(uint32_t*)&(d[1][28]);
-	unsigned bestBitSet = 0;
-	bytesConstRef chuck(d[0].data(), 64);
+/// The nonces hashed together, one for each lane of the several-at-once sha3.
+static const unsigned c_nonceLanes = 4;
 
-	chrono::high_resolution_clock::time_point then = chrono::high_resolution_clock::now() + chrono::milliseconds(_ms);
-	for (n = 0; chrono::high_resolution_clock::now() < then; )
+/// Tries nonces from zero for the envelope whose sha3 without nonce is @a _hash, until one gives @a _bits of work or
+/// @a _until passes. @returns the nonce giving the most work.
+static u256 searchNonce(h256 const& _hash, unsigned _bits, chrono::steady_clock::time_point _until)
+{
+	// Each lane hashes the envelope's hash followed by its nonce, big-endian, as workProved() does.
+	h256 d[c_nonceLanes][2];
+	bytesConstRef in[c_nonceLanes];
+	h256 out[c_nonceLanes];
+	for (unsigned l = 0; l < c_nonceLanes; ++l)
+	{
+		d[l][0] = _hash;
+		in[l] = bytesConstRef(d[l][0].data(), 64);
+	}
+	uint32_t best = 0;
+	unsigned bestBits = 0;
+	for (uint32_t n = 0; chrono::steady_clock::now() < _until; )
 		// do it rounds of 1024 for efficiency
-		for (unsigned i = 0; i < 1024; ++i, ++n)
+		for (unsigned i = 0; i < 1024; i += c_nonceLanes, n += c_nonceLanes)
 		{
-			auto fbs = dev::sha3(chuck).firstBitSet();
-			if (fbs > bestBitSet)
+			for (unsigned l = 0; l < c_nonceLanes; ++l)
+				for (unsigned b = 0; b < 4; ++b)
+					d[l][1][28 + b] = byte((n + l) >> (24 - 8 * b));
+			sha3(in, out, c_nonceLanes);
+			for (unsigned l = 0; l < c_nonceLanes; ++l)
 			{
-				bestBitSet = fbs;
-				m_nonce = n;
+				unsigned bits = out[l].firstBitSet();
+				if (bits > bestBits)
+				{
+					bestBits = bits;
+					best = n + l;
+					if (bestBits >= _bits)
+						return best;
+				}
 			}
 		}
+	return best;
+}
+
+void Envelope::proveWork(vector<Envelope*> const& _envelopes, unsigned _ms, unsigned _bits)
+{
+	auto until = chrono::steady_clock::now() + chrono::milliseconds(_ms);
+	ThreadPool::get().forEach(_envelopes.size(), [&](unsigned i)
+	{
+		Envelope& e = *_envelopes[i];
+		e.m_nonce = searchNonce(e.sha3(WithoutNonce), _bits, until);
+		e.cacheRLP();
+	});
 }
@@ -66,29 +66,39 @@ public:
 
 	operator bool() const { return !!m_expiry; }
 
-	void streamRLP(RLPStream& _s, IncludeNonce _withNonce = WithNonce) const { _s.appendList(_withNonce ? 5 : 4) << m_expiry << m_ttl << m_topic << m_data; if (_withNonce) _s << m_nonce; }
-	h256 sha3(IncludeNonce _withNonce = WithNonce) const { RLPStream s; streamRLP(s, _withNonce); return dev::sha3(s.out()); }
+	/// Streams the envelope; with the nonce, that of an envelope received or sealed is its RLP as it was, uncopied.
+	void streamRLP(RLPStream& _s, IncludeNonce _withNonce = WithNonce) const;
+	h256 sha3(IncludeNonce _withNonce = WithNonce) const;
 
 	unsigned sent() const { return m_expiry - m_ttl; }
 	unsigned expiry() const { return m_expiry; }
 	unsigned ttl() const { return m_ttl; }
 	CollapsedTopic const& topic() const { return m_topic; }
-	bytes const& data() const { return m_data; }
+	bytesConstRef data() const { return m_data; }
 
 	Message open(FullTopic const& _ft, Secret const& _s = Secret()) const;
 
 	unsigned workProved() const;
-	void proveWork(unsigned _ms);
+	/// Looks for the nonce giving the most work for @a _ms, or until one gives @a _bits of it.
+	void proveWork(unsigned _ms, unsigned _bits = 256) { std::vector<Envelope*> e{this}; proveWork(e, _ms, _bits); }
+	/// Proves work on all of @a _envelopes at once, spread over the shared thread pool, as proveWork() does on each.
+	static void proveWork(std::vector<Envelope*> const& _envelopes, unsigned _ms, unsigned _bits = 256);
 
 private:
 	Envelope(unsigned _exp, unsigned _ttl, CollapsedTopic const& _topic): m_expiry(_exp), m_ttl(_ttl), m_topic(_topic) {}
 
+	/// Encodes the envelope with its nonce, for it to be streamed as it is from then on.
+	void cacheRLP();
+
 	unsigned m_expiry = 0;
 	unsigned m_ttl = 0;
 	u256 m_nonce;
 
 	CollapsedTopic m_topic;
-	bytes m_data;
+	/// The envelope's RLP, with nonce, if m_hasRLP, else the data alone. Shared by the copies of the envelope.
+	std::shared_ptr<bytes const> m_bytes;
+	bytesConstRef m_data;	///< Within m_bytes.
+	bool m_hasRLP = false;
 };
 
 enum /*Message Flags*/
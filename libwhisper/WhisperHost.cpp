@@ -21,6 +21,7 @@
 
 #include "WhisperHost.h"
 
+#include <cmath>
 #include <libdevcore/CommonIO.h>
 #include <libdevcore/Log.h>
 #include <libp2p/All.h>
@@ -34,24 +35,37 @@ using namespace dev::shh;
 #endif
 #define clogS(X) dev::LogOutputStream<X, true>(false) << "| " << std::setw(2) << session()->socketId() << "] "
 
-WhisperHost::WhisperHost()
+/// @returns about how many bytes @a _e takes up.
+static size_t envelopeBytes(Envelope const& _e)
 {
+	return sizeof(Envelope) + _e.data().size() + _e.topic().size() * sizeof(CollapsedTopicPart);
+}
+
+WhisperHost::WhisperHost():
+	Worker("shh", 30, WorkerMode::Pool),
+	m_expiryWheel(c_expiryWheelSlots),
+	m_expiryWheelTime((unsigned)time(0))
+{
+	setLockName(x_messages, "WhisperHost::x_messages");
 }
 
 WhisperHost::~WhisperHost()
 {
+	stopWorking();
 }
 
-void WhisperHost::streamMessage(h256 _m, RLPStream& _s) const
+bool WhisperHost::streamMessage(h256 _m, RLPStream& _s, TopicBloomFilter const& _bloom) const
 {
 	UpgradableGuard l(x_messages);
-	if (m_messages.count(_m))
+	if (m_messages.count(_m) && bloomMatches(_bloom, m_messages.at(_m).topic()))
 	{
 		UpgradeGuard ll(l);
 		auto const& m = m_messages.at(_m);
 		cnote << "streamRLP: " << m.expiry() << m.ttl() << m.topic() << toHex(m.data());
 		m.streamRLP(_s);
+		return true;
 	}
+	return false;
 }
 
 void WhisperHost::inject(Envelope const& _m, WhisperPeer* _p)
@@ -63,19 +77,35 @@ void WhisperHost::inject(Envelope const& _m, WhisperPeer* _p)
 
 	auto h = _m.sha3();
 	{
-		UpgradableGuard l(x_messages);
+		ReadGuard l(x_messages);
 		if (m_messages.count(h))
 			return;
-		UpgradeGuard ll(l);
+	}
+	size_t bytes = envelopeBytes(_m);
+	double work = ldexp(1.0, _m.workProved()) / bytes;
+	{
+		WriteGuard l(x_messages);
+		if (m_messages.count(h))
+			return;
+		// Make room by dropping what was worked on less for its size, or else drop this one.
+		while (m_messageBytes + bytes > c_maxEnvelopeBytes && !m_byWork.empty() && m_byWork.begin()->first < work)
+			eraseMessage(m_messages.find(m_byWork.begin()->second), m_byWork.begin()->first);
+		if (m_messageBytes + bytes > c_maxEnvelopeBytes)
+			return;
 		m_messages[h] = _m;
-		m_expiryQueue.insert(make_pair(_m.expiry(), h));
+		m_messageBytes += bytes;
+		m_byWork.insert(make_pair(work, h));
+		m_expiryWheel[_m.expiry() % c_expiryWheelSlots].push_back(Expiring{h, _m.expiry(), work});
+		for (auto const& t: _m.topic())
+			m_topicIndex[t].insert(h);
 	}
 
 //	if (_p)
 	{
+		TopicBloomFilter bloom = topicBloom(_m.topic());
 		Guard l(m_filterLock);
 		for (auto const& f: m_filters)
-			if (f.second.filter.matches(_m))
+			if (f.second.mayMatch(bloom) && f.second.filter.matches(_m))
 				noteChanged(h, f.first);
 	}
 
@@ -116,7 +146,10 @@ unsigned WhisperHost::installWatch(shh::FullTopic const& _ft)
 	h256 h = f.filter.sha3();
 
 	if (!m_filters.count(h))
+	{
 		m_filters.insert(make_pair(h, f));
+		noteFiltersChanged();
+	}
 
 	return installWatchOnId(h);
 }
@@ -136,9 +169,26 @@ h256s WhisperHost::watchMessages(unsigned _watchId)
 		f = fit->second.filter;
 	}
 	ReadGuard l(x_messages);
-	for (auto const& m: m_messages)
-		if (f.matches(m.second))
-			ret.push_back(m.first);
+	// A message matching a mask is under each topic part the mask matches exactly, so only those under one of them
+	// need looking at, unless there is a mask without any.
+	h256Set candidates;
+	for (TopicMask const& t: f.masks())
+	{
+		auto exact = find_if(t.begin(), t.end(), [](pair<CollapsedTopicPart, CollapsedTopicPart> const& p) { return p.second == ~CollapsedTopicPart(); });
+		if (exact == t.end())
+		{
+			for (auto const& m: m_messages)
+				if (f.matches(m.second))
+					ret.push_back(m.first);
+			return ret;
+		}
+		auto it = m_topicIndex.find(exact->first);
+		if (it != m_topicIndex.end())
+			candidates.insert(it->second.begin(), it->second.end());
+	}
+	for (auto const& c: candidates)
+		if (f.matches(m_messages.at(c)))
+			ret.push_back(c);
 	return ret;
 }
 
@@ -157,13 +207,44 @@ void WhisperHost::uninstallWatch(unsigned _i)
 	auto fit = m_filters.find(id);
 	if (fit != m_filters.end())
 		if (!--fit->second.refCount)
+		{
 			m_filters.erase(fit);
+			noteFiltersChanged();
+		}
+}
+
+void WhisperHost::noteFiltersChanged()
+{
+	m_filtersBloom = TopicBloomFilter();
+	for (auto const& f: m_filters)
+		m_filtersBloom |= f.second.filter.exportBloom();
 }
 
 void WhisperHost::doWork()
 {
-	for (auto i: peerSessions())
-		i.first->cap<WhisperPeer>().get()->sendMessages();
+	auto sessions = peerSessions();
+	vector<shared_ptr<WhisperPeer>> peers;
+	vector<TopicBloomFilter> blooms;
+	for (auto const& i: sessions)
+	{
+		peers.push_back(i.first->cap<WhisperPeer>());
+		blooms.push_back(peers.back()->bloom());
+	}
+	TopicBloomFilter own;
+	{
+		Guard l(m_filterLock);
+		own = m_filtersBloom;
+	}
+	// Each peer is told of what we want and of what the other peers want, for us to forward to them.
+	for (unsigned i = 0; i < peers.size(); ++i)
+	{
+		TopicBloomFilter bloom = own;
+		for (unsigned j = 0; j < peers.size(); ++j)
+			if (j != i)
+				bloom |= blooms[j];
+		peers[i]->advertiseBloom(bloom);
+		peers[i]->sendMessages();
+	}
 	cleanup();
 }
 
@@ -173,6 +254,37 @@ void WhisperHost::cleanup()
 	// should be called every now and again.
 	unsigned now = (unsigned)time(0);
 	WriteGuard l(x_messages);
-	for (auto it = m_expiryQueue.begin(); it != m_expiryQueue.end() && it->first <= now; it = m_expiryQueue.erase(it))
-		m_messages.erase(it->second);
+	if (now <= m_expiryWheelTime)
+		return;
+	// Only the slots of the seconds since last time hold anything newly expired.
+	unsigned from = now - m_expiryWheelTime < c_expiryWheelSlots ? m_expiryWheelTime + 1 : now - c_expiryWheelSlots + 1;
+	for (unsigned t = from; t <= now; ++t)
+	{
+		vector<Expiring>& slot = m_expiryWheel[t % c_expiryWheelSlots];
+		auto kept = slot.begin();
+		for (Expiring const& e: slot)
+			if (e.expiry > now)
+				*kept++ = e;
+			else
+			{
+				auto m = m_messages.find(e.hash);
+				if (m != m_messages.end())
+					eraseMessage(m, e.work);
+			}
+		slot.erase(kept, slot.end());
+	}
+	m_expiryWheelTime = now;
+}
+
+void WhisperHost::eraseMessage(map<h256, Envelope>::iterator _m, double _work)
+{
+	for (auto const& t: _m->second.topic())
+	{
+		auto ti = m_topicIndex.find(t);
+		if (ti != m_topicIndex.end() && ti->second.erase(_m->first) && ti->second.empty())
+			m_topicIndex.erase(ti);
+	}
+	m_byWork.erase(make_pair(_work, _m->first));
+	m_messageBytes -= envelopeBytes(_m->second);
+	m_messages.erase(_m);
 }
@@ -42,6 +42,11 @@ namespace shh
 
 static const FullTopic EmptyFullTopic;
 
+/// The most bytes of envelopes kept; beyond it, those with the least work proved for their size make way.
+static const unsigned c_maxEnvelopeBytes = 32 * 1024 * 1024;
+/// The seconds the expiry wheel goes round in; envelopes expiring further out stay in their slot for more rounds.
+static const unsigned c_expiryWheelSlots = 256;
+
 class WhisperHost: public HostCapability<WhisperPeer>, public Interface, public Worker
 {
 	friend class WhisperPeer;
@@ -50,7 +55,7 @@ public:
 	WhisperHost();
 	virtual ~WhisperHost();
 
-	unsigned protocolVersion() const { return 2; }
+	unsigned protocolVersion() const { return 3; }
 
 	virtual void inject(Envelope const& _e, WhisperPeer* _from = nullptr) override;
 
@@ -75,17 +80,37 @@ private:
 	virtual void onStarting() { startWorking(); }
 	virtual void onStopping() { stopWorking(); }
 
-	void streamMessage(h256 _m, RLPStream& _s) const;
+	/// Streams the envelope @a _m into @a _s if whoever sent @a _bloom may want it. @returns true if it did.
+	bool streamMessage(h256 _m, RLPStream& _s, TopicBloomFilter const& _bloom) const;
 
 	void noteChanged(h256 _messageHash, h256 _filter);
 
+	/// Recomputes m_filtersBloom from m_filters.
+	void noteFiltersChanged();
+
+	/// Forgets the envelope at @a _m, whose work for its size is @a _work. Must hold x_messages.
+	void eraseMessage(std::map<h256, Envelope>::iterator _m, double _work);
+
+	struct Expiring
+	{
+		h256 hash;
+		unsigned expiry;
+		double work;
+	};
+
 	mutable dev::SharedMutex x_messages;
 	std::map<h256, Envelope> m_messages;
-	std::multimap<unsigned, h256> m_expiryQueue;
+	std::map<CollapsedTopicPart, h256Set> m_topicIndex;	///< The messages with each topic part.
+	std::set<std::pair<double, h256>> m_byWork;		///< The messages by work proved for each byte of them.
+	size_t m_messageBytes = 0;
+	/// The messages by expiry time modulo c_expiryWheelSlots. Ones since dropped for room are skipped.
+	std::vector<std::vector<Expiring>> m_expiryWheel;
+	unsigned m_expiryWheelTime;						///< The time up to which expired messages are gone.
 
 	mutable dev::Mutex m_filterLock;
 	std::map<h256, InstalledFilter> m_filters;
 	std::map<unsigned, ClientWatch> m_watches;
+	TopicBloomFilter m_filtersBloom;	///< The topic bits of the envelopes the filters may match.
 };
 
 }
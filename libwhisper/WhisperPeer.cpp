@@ -77,6 +77,12 @@ bool WhisperPeer::interpret(unsigned _id, RLP const& _r)
 				host()->inject(Envelope(i), this);
 		break;
 	}
+	case TopicFilterPacket:
+	{
+		Guard l(x_unseen);
+		m_bloom = _r[0].toHash<TopicBloomFilter>();
+		break;
+	}
 	default:
 		return false;
 	}
@@ -89,12 +95,12 @@ void WhisperPeer::sendMessages()
 	unsigned msgCount = 0;
 	{
 		Guard l(x_unseen);
-		msgCount = m_unseen.size();
 		while (m_unseen.size())
 		{
 			auto p = *m_unseen.begin();
 			m_unseen.erase(m_unseen.begin());
-			host()->streamMessage(p.second, amalg);
+			if (host()->streamMessage(p.second, amalg, m_bloom))
+				++msgCount;
 		}
 	}
 	
@@ -106,6 +112,15 @@ void WhisperPeer::sendMessages()
 	}
 }
 
+void WhisperPeer::advertiseBloom(TopicBloomFilter const& _bloom)
+{
+	if (_bloom == m_advertised)
+		return;
+	m_advertised = _bloom;
+	RLPStream s;
+	sealAndSend(prep(s, TopicFilterPacket, 1) << m_advertised);
+}
+
 void WhisperPeer::noteNewMessage(h256 _h, Envelope const& _m)
 {
 	Guard l(x_unseen);
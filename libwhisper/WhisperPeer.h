@@ -54,7 +54,7 @@ public:
 	virtual ~WhisperPeer();
 
 	static std::string name() { return "shh"; }
-	static u256 version() { return 2; }
+	static u256 version() { return 3; }
 	static unsigned messageCount() { return PacketCount; }
 
 	WhisperHost* host() const;
@@ -63,12 +63,18 @@ private:
 	virtual bool interpret(unsigned _id, RLP const&) override;
 
 	void sendMessages();
+	/// Sends the peer @a _bloom, the topic bits of the envelopes we want, if it differs from what we sent last.
+	void advertiseBloom(TopicBloomFilter const& _bloom);
+	/// @returns the topic bits of the envelopes the peer wants.
+	TopicBloomFilter bloom() const { Guard l(x_unseen); return m_bloom; }
 
 	unsigned rating(Envelope const&) const { return 0; }	// TODO
 	void noteNewMessage(h256 _h, Envelope const& _m);
 
 	mutable dev::Mutex x_unseen;
 	std::multimap<unsigned, h256> m_unseen;	///< Rated according to what they want.
+	TopicBloomFilter m_bloom = ~TopicBloomFilter();	///< What they want; everything until they tell us otherwise.
+	TopicBloomFilter m_advertised = ~TopicBloomFilter();	///< What we last told them we want; they take it to be everything at first.
 
 	std::chrono::system_clock::time_point m_timer = std::chrono::system_clock::now();
 };
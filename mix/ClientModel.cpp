@@ -26,7 +26,6 @@
 #include <QDebug>
 #include <QQmlContext>
 #include <QQmlApplicationEngine>
-#include <QStandardPaths>
 #include <jsonrpccpp/server.h>
 #include <libethcore/CommonJS.h>
 #include <libethereum/Transaction.h>
@@ -83,7 +82,7 @@ ClientModel::ClientModel():
 	qRegisterMetaType<RecordLogEntry*>("RecordLogEntry*");
 
 	connect(this, &ClientModel::runComplete, this, &ClientModel::showDebugger, Qt::QueuedConnection);
-	m_client.reset(new MixClient(QStandardPaths::writableLocation(QStandardPaths::TempLocation).toStdString()));
+	m_client.reset(new MixClient());
 
 	m_web3Server.reset(new Web3Server(*m_rpcConnector.get(), m_client->userAccounts(), m_client.get()));
 	connect(m_web3Server.get(), &Web3Server::newTransaction, this, &ClientModel::onNewTransaction, Qt::DirectConnection);
@@ -225,6 +224,9 @@ void ClientModel::executeSequence(vector<TransactionSettings> const& _sequence,
 	//run sequence
 	m_runFuture = QtConcurrent::run([=]()
 	{
+		// Only the last transaction is shown in the debugger; the others are traced if they are picked.
+		m_client->setTraceFrom(_sequence.empty() ? 0 : _sequence.size() - 1);
+		ScopeGuard traceAll([=](){ m_client->setTraceFrom(0); });
 		try
 		{
 			m_client->resetState(_balances);
@@ -369,8 +371,10 @@ void ClientModel::showDebuggerForTransaction(ExecutionResult const& _t)
 	map<QString, QVariableDeclaration*> storageDeclarations; //<name, decl>
 
 	unsigned prevInstructionIndex = 0;
-	for (MachineState const& s: _t.machineStates)
+	for (unsigned i = 0; i < _t.stepCount(); ++i)
 	{
+		// Walking forwards, each step is rebuilt from the one before.
+		MachineState s = _t.machineState(i, false);
 		int instructionIndex = codeMaps[s.codeIndex][static_cast<unsigned>(s.curPC)];
 		QSolState* solState = nullptr;
 		if (!codeItems[s.codeIndex].empty() && contracts[s.codeIndex])
@@ -451,7 +455,7 @@ void ClientModel::showDebuggerForTransaction(ExecutionResult const& _t)
 			solState = new QSolState(debugData, move(storage), move(solCallStack), move(locals), location.start, location.end, QString::fromUtf8(location.sourceName->c_str()));
 		}
 
-		states.append(QVariant::fromValue(new QMachineState(debugData, instructionIndex, s, codes[s.codeIndex], data[s.dataIndex], solState)));
+		states.append(QVariant::fromValue(new QMachineState(debugData, instructionIndex, _t.trace, i, codes[s.codeIndex], data[s.dataIndex], solState)));
 	}
 
 	debugData->setStates(move(states));
@@ -512,7 +516,7 @@ void ClientModel::emptyRecord()
 
 void ClientModel::debugRecord(unsigned _index)
 {
-	ExecutionResult e = m_client->execution(_index);
+	ExecutionResult e = m_client->retrace(_index);
 	showDebuggerForTransaction(e);
 }
 
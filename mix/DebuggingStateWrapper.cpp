@@ -102,23 +102,24 @@ QCode* QMachineState::getHumanReadableCode(QObject* _owner, const Address& _addr
 
 QBigInt* QMachineState::gasCost()
 {
-	return new QBigInt(m_state.gasCost);
+	return new QBigInt(info().gasCost);
 }
 
 QBigInt* QMachineState::gas()
 {
-	return new QBigInt(m_state.gas);
+	return new QBigInt(info().gas);
 }
 
 QBigInt* QMachineState::newMemSize()
 {
-	return new QBigInt(m_state.newMemSize);
+	return new QBigInt(info().newMemSize);
 }
 
 QStringList QMachineState::debugStack()
 {
 	QStringList stack;
-	for (std::vector<u256>::reverse_iterator i = m_state.stack.rbegin(); i != m_state.stack.rend(); ++i)
+	u256s s = m_trace->at(m_step, false).stack;
+	for (std::vector<u256>::reverse_iterator i = s.rbegin(); i != s.rend(); ++i)
 		stack.append(QString::fromStdString(prettyU256(*i)));
 	return stack;
 }
@@ -126,7 +127,7 @@ QStringList QMachineState::debugStack()
 QStringList QMachineState::debugStorage()
 {
 	QStringList storage;
-	for (auto const& i: m_state.storage)
+	for (auto const& i: m_trace->at(m_step, false).storage)
 	{
 		std::stringstream s;
 		s << "@" << prettyU256(i.first) << "\t" << prettyU256(i.second);
@@ -137,7 +138,7 @@ QStringList QMachineState::debugStorage()
 
 QVariantList QMachineState::debugMemory()
 {
-	return memDumpToList(m_state.memory, 16);
+	return memDumpToList(m_trace->at(m_step).memory, 16);
 }
 
 QCallData* QMachineState::getDebugCallData(QObject* _owner, bytes const& _data)
@@ -148,34 +149,35 @@ QCallData* QMachineState::getDebugCallData(QObject* _owner, bytes const& _data)
 QVariantList QMachineState::levels()
 {
 	QVariantList levelList;
-	for (unsigned l: m_state.levels)
+	for (unsigned l: m_trace->at(m_step, false).levels)
 		levelList.push_back(l);
 	return levelList;
 }
 
 QString QMachineState::instruction()
 {
-	return QString::fromStdString(dev::eth::instructionInfo(m_state.inst).name);
+	return QString::fromStdString(dev::eth::instructionInfo(info().inst).name);
 }
 
 QString QMachineState::endOfDebug()
 {
-	if (m_state.gasCost > m_state.gas)
+	eth::TraceStep state = m_trace->at(m_step);
+	if (state.gasCost > state.gas)
 		return QObject::tr("OUT-OF-GAS");
-	else if (m_state.inst == Instruction::RETURN && m_state.stack.size() >= 2)
+	else if (state.inst == Instruction::RETURN && state.stack.size() >= 2)
 	{
-		unsigned from = (unsigned)m_state.stack.back();
-		unsigned size = (unsigned)m_state.stack[m_state.stack.size() - 2];
+		unsigned from = (unsigned)state.stack.back();
+		unsigned size = (unsigned)state.stack[state.stack.size() - 2];
 		unsigned o = 0;
 		bytes out(size, 0);
-		for (; o < size && from + o < m_state.memory.size(); ++o)
-			out[o] = m_state.memory[from + o];
+		for (; o < size && from + o < state.memory.size(); ++o)
+			out[o] = state.memory[from + o];
 		return QObject::tr("RETURN") + " " + QString::fromStdString(dev::memDump(out, 16, false));
 	}
-	else if (m_state.inst == Instruction::STOP)
+	else if (state.inst == Instruction::STOP)
 		return QObject::tr("STOP");
-	else if (m_state.inst == Instruction::SUICIDE && m_state.stack.size() >= 1)
-		return QObject::tr("SUICIDE") + " 0x" + QString::fromStdString(toString(right160(m_state.stack.back())));
+	else if (state.inst == Instruction::SUICIDE && state.stack.size() >= 1)
+		return QObject::tr("SUICIDE") + " 0x" + QString::fromStdString(toString(right160(state.stack.back())));
 	else
 		return QObject::tr("EXCEPTION");
 }
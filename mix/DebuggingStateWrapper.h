@@ -157,16 +157,17 @@ class QMachineState: public QObject
 	Q_PROPERTY(QObject* solidity MEMBER m_solState CONSTANT)
 
 public:
-	QMachineState(QObject* _owner, int _instructionIndex, MachineState const& _state, QCode* _code, QCallData* _callData, QSolState* _solState):
-		QObject(_owner), m_instructionIndex(_instructionIndex), m_state(_state), m_code(_code), m_callData(_callData), m_solState(_solState) { }
+	/// Wraps step @a _step of @a _trace, whose stack, memory and storage are rebuilt only when asked for.
+	QMachineState(QObject* _owner, int _instructionIndex, std::shared_ptr<dev::eth::StepTrace const> const& _trace, unsigned _step, QCode* _code, QCallData* _callData, QSolState* _solState):
+		QObject(_owner), m_instructionIndex(_instructionIndex), m_trace(_trace), m_step(_step), m_code(_code), m_callData(_callData), m_solState(_solState) { }
 	/// Get the step of this machine states.
-	int step() { return  (int)m_state.steps; }
+	int step() { return  (int)info().steps; }
 	/// Get the proccessed code index.
-	int curPC() { return (int)m_state.curPC; }
+	int curPC() { return (int)info().pc; }
 	/// Get the code id
-	unsigned codeIndex() { return m_state.codeIndex; }
+	unsigned codeIndex() { return info().code; }
 	/// Get the call data id
-	unsigned dataIndex() { return m_state.dataIndex; }
+	unsigned dataIndex() { return info().data; }
 	/// Get gas cost.
 	QBigInt* gasCost();
 	/// Get gas used.
@@ -185,16 +186,17 @@ public:
 	QString instruction();
 	/// Get all previous steps.
 	QVariantList levels();
-	/// Get the current processed machine state.
-	MachineState const& state() const { return m_state; }
 	/// Convert all machine states in human readable code.
 	static QCode* getHumanReadableCode(QObject* _owner, const Address& _address, const bytes& _code, QHash<int, int>& o_codeMap);
 	/// Convert call data into human readable form
 	static QCallData* getDebugCallData(QObject* _owner, bytes const& _data);
 
 private:
+	dev::eth::StepInfo const& info() const { return m_trace->info(m_step); }
+
 	int m_instructionIndex;
-	MachineState m_state;
+	std::shared_ptr<dev::eth::StepTrace const> m_trace;
+	unsigned m_step;
 	QCode* m_code;
 	QCallData* m_callData;
 	QSolState* m_solState;
@@ -25,12 +25,14 @@ along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <vector>
 #include <map>
+#include <memory>
 #include <stdint.h>
 #include <libdevcore/Common.h>
 #include <libdevcrypto/Common.h>
 #include <libevmcore/Instruction.h>
 #include <libethereum/Transaction.h>
 #include <libethereum/TransactionReceipt.h>
+#include <libethereum/StepTrace.h>
 
 namespace dev
 {
@@ -72,7 +74,7 @@ namespace mix
 	{
 		ExecutionResult(): transactionIndex(std::numeric_limits<unsigned>::max()) {}
 
-		std::vector<MachineState> machineStates;
+		std::shared_ptr<dev::eth::StepTrace const> trace;	///< Of each step; null if the execution was not traced.
 		std::vector<bytes> transactionData;
 		std::vector<MachineCode> executionCode;
 		dev::eth::ExecutionResult result;
@@ -86,6 +88,14 @@ namespace mix
 
 		bool isCall() const { return transactionIndex == std::numeric_limits<unsigned>::max(); }
 		bool isConstructor() const { return !isCall() && !address; }
+		/// @returns the number of steps traced.
+		size_t stepCount() const { return trace ? trace->size() : 0; }
+		/// @returns the machine state at step @a _i, rebuilt from the trace; without its memory unless @a _memory.
+		MachineState machineState(size_t _i, bool _memory = true) const
+		{
+			dev::eth::TraceStep s = trace->at(_i, _memory);
+			return MachineState({s.steps, s.pc, s.inst, s.newMemSize, s.gas, std::move(s.stack), std::move(s.memory), s.gasCost, std::move(s.storage), std::move(s.levels), s.code, s.data});
+		}
 	};
 
 	using ExecutionResults = std::vector<ExecutionResult>;
@@ -72,8 +72,15 @@ void MixClient::resetState(std::map<Secret, u256> _accounts)
 	WriteGuard l(x_state);
 	Guard fl(x_filtersWatches);
 	m_filters.clear();
+	m_filterIndex.clear();
 	m_watches.clear();
 
+	if (m_genesis && _accounts == m_genesisAccounts)
+	{
+		restoreCheckpoint(*m_genesis);
+		return;
+	}
+
 	m_stateDB = OverlayDB();
 	SecureTrieDB<Address, MemoryDB> accountState(&m_stateDB);
 	accountState.init();
@@ -91,11 +98,70 @@ void MixClient::resetState(std::map<Secret, u256> _accounts)
 	h256 stateRoot = accountState.root();
 	m_bc.reset();
 	m_bc.reset(new MixBlockChain(m_dbPath, stateRoot));
+	m_genesisRoot = stateRoot;
+	m_blocks.clear();
 	m_state = eth::State(m_stateDB, BaseState::PreExisting, genesisState.begin()->first);
 	m_state.sync(bc());
 	m_startState = m_state;
-	WriteGuard lx(x_executions);
-	m_executions.clear();
+	{
+		WriteGuard lx(x_executions);
+		m_executions.clear();
+		m_replays.clear();
+	}
+	m_genesisAccounts = _accounts;
+	m_genesis.reset(new Checkpoint(takeCheckpoint()));
+}
+
+MixClient::Checkpoint MixClient::checkpoint() const
+{
+	ReadGuard l(x_state);
+	return takeCheckpoint();
+}
+
+void MixClient::restore(Checkpoint const& _checkpoint)
+{
+	{
+		WriteGuard l(x_state);
+		restoreCheckpoint(_checkpoint);
+	}
+	h256Set changed { dev::eth::PendingChangedFilter, dev::eth::ChainChangedFilter };
+	noteChanged(changed);
+}
+
+MixClient::Checkpoint MixClient::takeCheckpoint() const
+{
+	Checkpoint ret;
+	ret.genesisRoot = m_genesisRoot;
+	ret.blocks = m_blocks;
+	ret.stateDB = m_stateDB;
+	ret.state = m_state;
+	ret.startState = m_startState;
+	ret.userAccounts = m_userAccounts;
+	ReadGuard l(x_executions);
+	ret.executions = m_executions;
+	ret.replays = m_replays;
+	return ret;
+}
+
+void MixClient::restoreCheckpoint(Checkpoint const& _checkpoint)
+{
+	// Blocks are only re-imported when the chain has moved on; within a block the state is all there is to restore.
+	if (!m_bc.get() || m_genesisRoot != _checkpoint.genesisRoot || m_blocks != _checkpoint.blocks)
+	{
+		m_bc.reset();
+		m_bc.reset(new MixBlockChain(m_dbPath, _checkpoint.genesisRoot));
+		for (bytes const& b: _checkpoint.blocks)
+			m_bc->import(b, _checkpoint.stateDB);
+	}
+	m_genesisRoot = _checkpoint.genesisRoot;
+	m_blocks = _checkpoint.blocks;
+	m_stateDB = _checkpoint.stateDB;
+	m_state = _checkpoint.state;
+	m_startState = _checkpoint.startState;
+	m_userAccounts = _checkpoint.userAccounts;
+	WriteGuard l(x_executions);
+	m_executions = _checkpoint.executions;
+	m_replays = _checkpoint.replays;
 }
 
 Transaction MixClient::replaceGas(Transaction const& _t, Secret const& _secret, u256 const& _gas)
@@ -106,10 +172,41 @@ Transaction MixClient::replaceGas(Transaction const& _t, Secret const& _secret,
 		return Transaction(_t.value(), _t.gasPrice(), _gas, _t.receiveAddress(), _t.data(), _t.nonce(), _secret);
 }
 
+ExecutionResult MixClient::dryRun(Transaction const& _t, State const& _state, LastHashes const& _lastHashes, bool _trace) const
+{
+	bytes rlp = _t.rlp();
+	State execState = _state;
+	Executive execution(execState, _lastHashes, 0);
+	execution.initialize(&rlp);
+	execution.execute();
+	std::shared_ptr<StepTrace> trace;
+	if (_trace)
+	{
+		trace = std::make_shared<StepTrace>();
+		execution.go(trace->onOp());
+	}
+	else
+		execution.go();
+	execution.finalize();
+
+	ExecutionResult ret;
+	ret.result = execution.executionResult();
+	if (trace)
+	{
+		for (TracedCode const& c: trace->codes())
+			ret.executionCode.push_back(MachineCode({c.address, c.code}));
+		ret.transactionData = trace->data();
+		ret.trace = trace;
+	}
+	else
+		// Enough for the records to name the function called.
+		ret.transactionData.push_back(_t.isCreation() ? bytes() : _t.data());
+	return ret;
+}
+
 void MixClient::executeTransaction(Transaction const& _t, State& _state, bool _call, bool _gasAuto, Secret const& _secret)
 {
 	Transaction t = _gasAuto ? replaceGas(_t, _secret, m_state.gasLimitRemaining()) : _t;
-	bytes rlp = t.rlp();
 
 	// do debugging run first
 	LastHashes lastHashes(256);
@@ -117,64 +214,17 @@ void MixClient::executeTransaction(Transaction const& _t, State& _state, bool _c
 	for (unsigned i = 1; i < 256; ++i)
 		lastHashes[i] = lastHashes[i - 1] ? bc().details(lastHashes[i - 1]).parent : h256();
 
-	State execState = _state;
-	Executive execution(execState, lastHashes, 0);
-	execution.initialize(&rlp);
-	execution.execute();
-	std::vector<MachineState> machineStates;
-	std::vector<unsigned> levels;
-	std::vector<MachineCode> codes;
-	std::map<bytes const*, unsigned> codeIndexes;
-	std::vector<bytes> data;
-	std::map<bytesConstRef const*, unsigned> dataIndexes;
-	bytes const* lastCode = nullptr;
-	bytesConstRef const* lastData = nullptr;
-	unsigned codeIndex = 0;
-	unsigned dataIndex = 0;
-	auto onOp = [&](uint64_t steps, Instruction inst, dev::bigint newMemSize, dev::bigint gasCost, void* voidVM, void const* voidExt)
+	unsigned index;
 	{
-		VM& vm = *static_cast<VM*>(voidVM);
-		ExtVM const& ext = *static_cast<ExtVM const*>(voidExt);
-		if (lastCode == nullptr || lastCode != &ext.code)
-		{
-			auto const& iter = codeIndexes.find(&ext.code);
-			if (iter != codeIndexes.end())
-				codeIndex = iter->second;
-			else
-			{
-				codeIndex = codes.size();
-				codes.push_back(MachineCode({ext.myAddress, ext.code}));
-				codeIndexes[&ext.code] = codeIndex;
-			}
-			lastCode = &ext.code;
-		}
-
-		if (lastData == nullptr || lastData != &ext.data)
-		{
-			auto const& iter = dataIndexes.find(&ext.data);
-			if (iter != dataIndexes.end())
-				dataIndex = iter->second;
-			else
-			{
-				dataIndex = data.size();
-				data.push_back(ext.data.toBytes());
-				dataIndexes[&ext.data] = dataIndex;
-			}
-			lastData = &ext.data;
-		}
-
-		if (levels.size() < ext.depth)
-			levels.push_back(machineStates.size() - 1);
-		else
-			levels.resize(ext.depth);
-
-		machineStates.emplace_back(MachineState({steps, vm.curPC(), inst, newMemSize, vm.gas(),
-									  vm.stack(), vm.memory(), gasCost, ext.state().storage(ext.myAddress), levels, codeIndex, dataIndex}));
-	};
-
-	execution.go(onOp);
-	execution.finalize();
-	dev::eth::ExecutionResult er = execution.executionResult();
+		ReadGuard l(x_executions);
+		index = m_executions.size();
+	}
+	bool trace = index >= m_traceFrom;
+	State before;
+	if (!trace)
+		before = _state;
+	ExecutionResult d = dryRun(t, _state, lastHashes, trace);
+	dev::eth::ExecutionResult er = d.result;
 
 	switch (er.excepted)
 	{
@@ -200,11 +250,6 @@ void MixClient::executeTransaction(Transaction const& _t, State& _state, bool _c
 			BOOST_THROW_EXCEPTION(Exception() << errinfo_comment("Internal execution error"));
 	};
 
-	ExecutionResult d;
-	d.result = execution.executionResult();
-	d.machineStates = machineStates;
-	d.executionCode = std::move(codes);
-	d.transactionData = std::move(data);
 	d.address = _t.receiveAddress();
 	d.sender = _t.sender();
 	d.value = _t.value();
@@ -213,7 +258,7 @@ void MixClient::executeTransaction(Transaction const& _t, State& _state, bool _c
 		d.contractAddress = right160(sha3(rlpList(_t.sender(), _t.nonce())));
 	if (!_call)
 		d.transactionIndex = m_state.pending().size();
-	d.executonIndex = m_executions.size();
+	d.executonIndex = index;
 
 	// execute on a state
 	if (!_call)
@@ -225,24 +270,28 @@ void MixClient::executeTransaction(Transaction const& _t, State& _state, bool _c
 		d.gasUsed = er.gasUsed + er.gasRefunded + er.gasForDeposit;
 		// collect watches
 		h256Set changed;
-		Guard l(x_filtersWatches);
-		for (std::pair<h256 const, eth::InstalledFilter>& i: m_filters)
-			if ((unsigned)i.second.filter.latest() > bc().number())
-			{
-				// acceptable number.
-				auto m = i.second.filter.matches(_state.receipt(_state.pending().size() - 1));
-				if (m.size())
+		{
+			Guard l(x_filtersWatches);
+			for (std::pair<h256 const, eth::InstalledFilter>& i: m_filters)
+				if ((unsigned)i.second.filter.latest() > bc().number())
 				{
-					// filter catches them
-					for (LogEntry const& l: m)
-						i.second.changes.push_back(LocalisedLogEntry(l, bc().number() + 1));
-					changed.insert(i.first);
+					// acceptable number.
+					auto m = i.second.filter.matches(_state.receipt(_state.pending().size() - 1));
+					if (m.size())
+					{
+						// filter catches them
+						for (LogEntry const& l: m)
+							i.second.changes.push_back(LocalisedLogEntry(l, bc().number() + 1));
+						changed.insert(i.first);
+					}
 				}
-			}
+		}
 		changed.insert(dev::eth::PendingChangedFilter);
 		noteChanged(changed);
 	}
 	WriteGuard l(x_executions);
+	if (!trace)
+		m_replays.insert(std::make_pair(index, Replay{before, t, lastHashes}));
 	m_executions.emplace_back(std::move(d));
 }
 
@@ -253,6 +302,7 @@ void MixClient::mine()
 	ProofOfWork pow;
 	while (!m_state.mine(&pow).completed) {}
 	m_state.completeMine();
+	m_blocks.push_back(m_state.blockData());
 	bc().import(m_state.blockData(), m_stateDB);
 	m_state.sync(bc());
 	m_startState = m_state;
@@ -272,6 +322,27 @@ ExecutionResult MixClient::execution(unsigned _index) const
 	return m_executions.at(_index);
 }
 
+ExecutionResult MixClient::retrace(unsigned _index)
+{
+	ExecutionResult ret = execution(_index);
+	Replay replay;
+	{
+		ReadGuard l(x_executions);
+		auto it = m_replays.find(_index);
+		if (it == m_replays.end())
+			return ret;
+		replay = it->second;
+	}
+	ExecutionResult traced = dryRun(replay.transaction, replay.state, replay.lastHashes, true);
+	ret.trace = std::move(traced.trace);
+	ret.executionCode = std::move(traced.executionCode);
+	ret.transactionData = std::move(traced.transactionData);
+	WriteGuard l(x_executions);
+	if (_index < m_executions.size() && m_replays.erase(_index))
+		m_executions[_index] = ret;
+	return ret;
+}
+
 State MixClient::asOf(h256 const& _block) const
 {
 	ReadGuard l(x_state);
@@ -346,20 +417,6 @@ dev::eth::ExecutionResult MixClient::create(Secret _secret, u256 _value, bytes c
 	return lastExecution().result;
 }
 
-void MixClient::noteChanged(h256Set const& _filters)
-{
-	for (auto& i: m_watches)
-		if (_filters.count(i.second.id))
-		{
-			if (m_filters.count(i.second.id))
-				i.second.changes += m_filters.at(i.second.id).changes;
-			else
-				i.second.changes.push_back(LocalisedLogEntry(SpecialLogEntry, 0));
-		}
-	for (auto& i: m_filters)
-		i.second.changes.clear();
-}
-
 eth::BlockInfo MixClient::blockInfo() const
 {
 	ReadGuard l(x_state);
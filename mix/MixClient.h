@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include <map>
+#include <memory>
 #include <vector>
 #include <string>
 #include <libethereum/ClientBase.h>
@@ -45,14 +47,49 @@ public:
 class MixClient: public dev::eth::ClientBase
 {
 public:
-	MixClient(std::string const& _dbPath);
+	/// What an execution run without tracing began with, so that it can be traced later.
+	struct Replay
+	{
+		eth::State state;
+		eth::Transaction transaction;
+		eth::LastHashes lastHashes;
+	};
+
+	/// The whole of the client's chain and state at some point, to return to with restore().
+	struct Checkpoint
+	{
+		h256 genesisRoot;
+		std::vector<bytes> blocks;			///< Those mined on the genesis, oldest first.
+		OverlayDB stateDB;
+		eth::State state;
+		eth::State startState;
+		std::vector<KeyPair> userAccounts;
+		ExecutionResults executions;
+		std::map<unsigned, Replay> replays;	///< Of the untraced executions, by index.
+	};
+
+	/// Keeps its chain at @a _dbPath; by default in memory, so that each reset is a fresh chain costing no disk I/O.
+	MixClient(std::string const& _dbPath = c_memoryDBPath);
 	virtual ~MixClient();
-	/// Reset state to the empty state with given balance.
+	/// Reset state to the empty state with given balance. Resetting to the balances of the last reset restores the
+	/// genesis it made rather than building it again.
 	void resetState(std::map<Secret, u256> _accounts);
 	void mine();
 	ExecutionResult lastExecution() const;
 	ExecutionResult execution(unsigned _index) const;
 
+	/// @returns the client's chain, state and executions as they are now. Cheap: the state DB is copied on write.
+	Checkpoint checkpoint() const;
+	/// Returns the client to @a _checkpoint. The chain is only rebuilt if blocks were mined since it was taken.
+	void restore(Checkpoint const& _checkpoint);
+
+	/// Executions before the @a _index th since the last reset are run without recording their machine states,
+	/// which are the bulk of their cost; retrace() records them if they are wanted after all.
+	void setTraceFrom(unsigned _index) { m_traceFrom = _index; }
+	/// @returns execution @a _index with its machine states, running it again from where it began if they were
+	/// not recorded.
+	ExecutionResult retrace(unsigned _index);
+
 	void submitTransaction(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice) override;
 	Address submitTransaction(Secret _secret, u256 _endowment, bytes const& _init, u256 _gas, u256 _gasPrice) override;
 	dev::eth::ExecutionResult call(Secret _secret, u256 _value, Address _dest, bytes const& _data, u256 _gas, u256 _gasPrice, eth::BlockNumber _blockNumber = eth::PendingBlock, eth::FudgeFactor _ff = eth::FudgeFactor::Strict) override;
@@ -91,7 +128,11 @@ protected:
 
 private:
 	void executeTransaction(dev::eth::Transaction const& _t, eth::State& _state, bool _call, bool _gasAuto, dev::Secret const& _secret);
-	void noteChanged(h256Set const& _filters);
+	/// Runs @a _t on a copy of @a _state, recording its machine states if @a _trace.
+	ExecutionResult dryRun(dev::eth::Transaction const& _t, eth::State const& _state, eth::LastHashes const& _lastHashes, bool _trace) const;
+	/// As checkpoint() and restore(), with x_state already held.
+	Checkpoint takeCheckpoint() const;
+	void restoreCheckpoint(Checkpoint const& _checkpoint);
 	dev::eth::Transaction replaceGas(dev::eth::Transaction const& _t, dev::Secret const& _secret, dev::u256 const& _gas);
 
 	std::vector<KeyPair> m_userAccounts;
@@ -99,11 +140,17 @@ private:
 	eth::State m_startState;
 	OverlayDB m_stateDB;
 	std::auto_ptr<MixBlockChain> m_bc;
-	mutable boost::shared_mutex x_state;
-	mutable boost::shared_mutex x_executions;
+	mutable SharedMutex x_state;
+	mutable SharedMutex x_executions;
 	ExecutionResults m_executions;
+	std::map<unsigned, Replay> m_replays;
 	std::string m_dbPath;
 	unsigned m_miningThreads;
+	unsigned m_traceFrom = 0;
+	h256 m_genesisRoot;
+	std::vector<bytes> m_blocks;					///< Mined on the genesis, oldest first.
+	std::map<Secret, u256> m_genesisAccounts;
+	std::unique_ptr<Checkpoint> m_genesis;			///< Just after the last reset.
 };
 
 }
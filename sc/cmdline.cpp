@@ -6,6 +6,14 @@
 #include <libserpent/funcs.h>
 
 int main(int argv, char** argc) {
+    // -o passes the compiled code through the optimiser used for
+    // LLL and Solidity
+    bool optimize = false;
+    if (argv > 1 && (std::string(argc[1]) == "-o" || std::string(argc[1]) == "--optimize")) {
+        optimize = true;
+        argc++;
+        argv--;
+    }
     if (argv == 1) {
         std::cerr << "Must provide a command and arguments! Try parse, rewrite, compile, assemble\n";
         return 0;
@@ -13,7 +21,8 @@ int main(int argv, char** argc) {
 	if (argv == 2 && (std::string(argc[1]) == "--help" || std::string(argc[1]) == "-h" )) {
         std::cout << argc[1] << "\n";
         
-        std::cout << "serpent command input\n";
+        std::cout << "serpent [-o] command input\n";
+        std::cout << "where -o optimizes the code from compile, compile_chunk and compile_lll.\n";
         std::cout << "where input -s for from stdin, a file, or interpreted as serpent code if does not exist as file.";
         std::cout << "where command: \n";
         std::cout << " parse:          Just parses and returns s-expression code.\n";
@@ -65,7 +74,7 @@ int main(int argv, char** argc) {
         std::cout << printAST(buildFragmentTree(parseLLL(input, true))) << "\n";
     }
     else if (command == "compile_lll") {
-        std::cout << binToHex(compileLLL(parseLLL(input, true))) << "\n";
+        std::cout << binToHex(compileLLL(parseLLL(input, true), optimize)) << "\n";
     }
     else if (command == "dereference") {
         std::cout << printTokens(dereference(parseLLL(input, true))) <<"\n";
@@ -92,10 +101,10 @@ int main(int argv, char** argc) {
         std::cout << printTokens(deserialize(hexToBin(input))) << "\n";
     }
     else if (command == "compile") {
-        std::cout << binToHex(compile(input)) << "\n";
+        std::cout << binToHex(compile(input, optimize)) << "\n";
     }
     else if (command == "compile_chunk") {
-        std::cout << binToHex(compileChunk(input)) << "\n";
+        std::cout << binToHex(compileChunk(input, optimize)) << "\n";
     }
     else if (command == "encode_datalist") {
         std::vector<Node> tokens = tokenize(input);
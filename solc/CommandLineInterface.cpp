@@ -211,7 +211,8 @@ bool CommandLineInterface::parseArguments(int argc, char** argv)
 	desc.add_options()
 		("help", "Show help message and exit")
 		("version", "Show version and exit")
-		("optimize", po::value<bool>()->default_value(false), "Optimize bytecode for size")
+		("optimize", po::value<bool>()->default_value(false), "Optimize bytecode")
+		("optimize-runs", po::value<unsigned>()->default_value(eth::c_optimiseRuns), "Number of times the optimizer takes contracts to be called for each deployment; higher favours cheaper calls over smaller code")
 		("add-std", po::value<bool>()->default_value(false), "Add standard contracts")
 		("input-file", po::value<vector<string>>(), "input file")
 		(g_argAstStr.c_str(), po::value<OutputType>()->value_name("stdout|file|both"),
@@ -300,7 +301,7 @@ bool CommandLineInterface::processInput()
 		for (auto const& sourceCode: m_sourceCodes)
 			m_compiler->addSource(sourceCode.first, sourceCode.second);
 		// TODO: Perhaps we should not compile unless requested
-		m_compiler->compile(m_args["optimize"].as<bool>());
+		m_compiler->compile(m_args["optimize"].as<bool>(), m_args["optimize-runs"].as<unsigned>());
 	}
 	catch (ParserError const& _exception)
 	{
@@ -0,0 +1,236 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file JsonReader.cpp
+ * @date 2015
+ * Reading of the JSON test fixtures in one pass.
+ */
+
+#include "JsonReader.h"
+#include <cstdlib>
+#include <limits>
+
+using namespace std;
+namespace js = json_spirit;
+
+namespace
+{
+
+/// Reads JSON values, straight into json_spirit's, from a pointer moving through the text.
+class JsonReader
+{
+public:
+	JsonReader(string const& _s): m_pos(_s.data()), m_end(_s.data() + _s.size()) {}
+
+	bool value(js::mValue& o_value)
+	{
+		skipSpace();
+		if (m_pos == m_end)
+			return false;
+		switch (*m_pos)
+		{
+		case '{':
+			return object(o_value);
+		case '[':
+			return array(o_value);
+		case '"':
+		{
+			string s;
+			if (!str(s))
+				return false;
+			o_value = js::mValue(s);
+			return true;
+		}
+		case 't':
+			o_value = js::mValue(true);
+			return literal("true");
+		case 'f':
+			o_value = js::mValue(false);
+			return literal("false");
+		case 'n':
+			o_value = js::mValue();
+			return literal("null");
+		default:
+			return number(o_value);
+		}
+	}
+
+private:
+	void skipSpace()
+	{
+		while (m_pos != m_end && (*m_pos == ' ' || *m_pos == '\n' || *m_pos == '\r' || *m_pos == '\t' || *m_pos == '\f' || *m_pos == '\v'))
+			++m_pos;
+	}
+
+	bool expect(char _c)
+	{
+		skipSpace();
+		if (m_pos == m_end || *m_pos != _c)
+			return false;
+		++m_pos;
+		return true;
+	}
+
+	bool literal(char const* _word)
+	{
+		for (; *_word; ++_word, ++m_pos)
+			if (m_pos == m_end || *m_pos != *_word)
+				return false;
+		return true;
+	}
+
+	bool object(js::mValue& o_value)
+	{
+		++m_pos;
+		o_value = js::mObject();
+		js::mObject& obj = o_value.get_obj();
+		if (expect('}'))
+			return true;
+		do
+		{
+			string name;
+			skipSpace();
+			if (m_pos == m_end || *m_pos != '"' || !str(name) || !expect(':') || !value(obj[name]))
+				return false;
+		}
+		while (expect(','));
+		return expect('}');
+	}
+
+	bool array(js::mValue& o_value)
+	{
+		++m_pos;
+		o_value = js::mArray();
+		js::mArray& arr = o_value.get_array();
+		if (expect(']'))
+			return true;
+		do
+		{
+			arr.emplace_back();
+			if (!value(arr.back()))
+				return false;
+		}
+		while (expect(','));
+		return expect(']');
+	}
+
+	/// Reads the string at m_pos into @a o_s, taking escapes as json_spirit does: "\u" gives one char, truncated.
+	bool str(string& o_s)
+	{
+		char const* start = ++m_pos;
+		while (m_pos != m_end && *m_pos != '"' && *m_pos != '\\')
+			++m_pos;
+		o_s.assign(start, m_pos);
+		while (m_pos != m_end && *m_pos != '"')
+		{
+			// An escape.
+			if (++m_pos == m_end)
+				return false;
+			switch (*m_pos++)
+			{
+			case 't': o_s += '\t'; break;
+			case 'b': o_s += '\b'; break;
+			case 'f': o_s += '\f'; break;
+			case 'n': o_s += '\n'; break;
+			case 'r': o_s += '\r'; break;
+			case '\\': o_s += '\\'; break;
+			case '/': o_s += '/'; break;
+			case '"': o_s += '"'; break;
+			case 'x':
+				if (!hexChar(2, o_s))
+					return false;
+				break;
+			case 'u':
+				if (!hexChar(4, o_s))
+					return false;
+				break;
+			default:
+				return false;
+			}
+			start = m_pos;
+			while (m_pos != m_end && *m_pos != '"' && *m_pos != '\\')
+				++m_pos;
+			o_s.append(start, m_pos);
+		}
+		if (m_pos == m_end)
+			return false;
+		++m_pos;
+		return true;
+	}
+
+	bool hexChar(unsigned _digits, string& io_s)
+	{
+		unsigned c = 0;
+		for (unsigned i = 0; i < _digits; ++i, ++m_pos)
+		{
+			if (m_pos == m_end || !isxdigit(*m_pos))
+				return false;
+			c = c * 16 + (*m_pos <= '9' ? *m_pos - '0' : (*m_pos | 0x20) - 'a' + 10);
+		}
+		io_s += char(c);
+		return true;
+	}
+
+	/// Reads the number at m_pos: a real if it has a fraction or an exponent, else an int64, or a uint64 if it is
+	/// too big for that.
+	bool number(js::mValue& o_value)
+	{
+		char const* start = m_pos;
+		bool negative = m_pos != m_end && *m_pos == '-';
+		if (negative || (m_pos != m_end && *m_pos == '+'))
+			++m_pos;
+		uint64_t n = 0;
+		bool overflow = false;
+		char const* digits = m_pos;
+		for (; m_pos != m_end && *m_pos >= '0' && *m_pos <= '9'; ++m_pos)
+		{
+			unsigned d = *m_pos - '0';
+			overflow = overflow || n > (numeric_limits<uint64_t>::max() - d) / 10;
+			n = n * 10 + d;
+		}
+		if (m_pos == digits)
+			return false;
+		if (m_pos != m_end && (*m_pos == '.' || *m_pos == 'e' || *m_pos == 'E'))
+		{
+			// The text is held by a std::string, so strtod stops, at the latest, at its terminating zero.
+			char* end;
+			o_value = js::mValue(strtod(start, &end));
+			m_pos = end;
+			return end != start;
+		}
+		if (overflow)
+			return false;
+		if (!negative && n <= uint64_t(numeric_limits<int64_t>::max()))
+			o_value = js::mValue(int64_t(n));
+		else if (negative && n <= uint64_t(numeric_limits<int64_t>::max()) + 1)
+			o_value = js::mValue(int64_t(0 - n));
+		else if (!negative)
+			o_value = js::mValue(n);
+		else
+			return false;
+		return true;
+	}
+
+	char const* m_pos;
+	char const* m_end;
+};
+
+}
+
+bool dev::test::readJson(string const& _s, js::mValue& o_value)
+{
+	return JsonReader(_s).value(o_value);
+}
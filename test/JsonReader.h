@@ -0,0 +1,38 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file JsonReader.h
+ * @date 2015
+ * Reading of the JSON test fixtures in one pass.
+ */
+
+#pragma once
+
+#include <string>
+#include "JsonSpiritHeaders.h"
+
+namespace dev
+{
+namespace test
+{
+
+/// Reads the JSON text @a _s into @a o_value, giving what json_spirit::read_string does, but in a single pass over
+/// the text rather than through Spirit's backtracking grammar. Whatever follows the value is ignored.
+/// @returns false if the text is not JSON.
+bool readJson(std::string const& _s, json_spirit::mValue& o_value);
+
+}
+}
@@ -0,0 +1,103 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * @date 2015
+ * Unit tests for the compiler stack only redoing its work when its sources or settings change.
+ */
+
+#if ETH_SOLIDITY
+
+#include "TestHelper.h"
+#include <libsolidity/CompilerStack.h>
+#include <libsolidity/AST.h>
+#include <libsolidity/Exceptions.h>
+
+using namespace std;
+
+namespace dev
+{
+namespace solidity
+{
+namespace test
+{
+
+BOOST_AUTO_TEST_SUITE(SolidityCompilerStack)
+
+BOOST_AUTO_TEST_CASE(unimported_libraries_not_parsed)
+{
+	CompilerStack stack;
+	stack.addSource("a", "import \"mortal\"; contract A is mortal {}");
+	ETH_TEST_REQUIRE_NO_THROW(stack.parse(), "Parsing failed");
+	BOOST_CHECK_NO_THROW(stack.getAST("owned"));
+	BOOST_CHECK_THROW(stack.getAST("coin"), CompilerError);
+}
+
+BOOST_AUTO_TEST_CASE(unchanged_sources_kept)
+{
+	CompilerStack stack;
+	stack.addSource("a", "contract A { function f() returns (uint) { return 1; } }");
+	stack.addSource("b", "contract B { function g() returns (uint) { return 2; } }");
+	ETH_TEST_REQUIRE_NO_THROW(stack.compile(), "Compiling failed");
+	SourceUnit const* ast = &stack.getAST("a");
+	bytes code = stack.getBytecode("A");
+
+	// Adding the same content again changes nothing.
+	BOOST_CHECK(stack.addSource("b", "contract B { function g() returns (uint) { return 2; } }"));
+	stack.compile();
+	BOOST_CHECK_EQUAL(ast, &stack.getAST("a"));
+
+	// Other settings only compile again.
+	stack.compile(true);
+	BOOST_CHECK_EQUAL(ast, &stack.getAST("a"));
+	BOOST_CHECK(code != stack.getBytecode("A"));
+
+	// A changed source makes for a new parse.
+	stack.addSource("b", "contract B { function g() returns (uint) { return 3; } }");
+	stack.compile();
+	BOOST_CHECK(ast != &stack.getAST("a"));
+	BOOST_CHECK(code == stack.getBytecode("A"));
+}
+
+BOOST_AUTO_TEST_CASE(set_source_replaces_others)
+{
+	CompilerStack stack(false);
+	stack.addSource("a", "contract A {}");
+	stack.compile(string("contract B {}"));
+	BOOST_CHECK(stack.getContractNames() == vector<string>{"B"});
+	SourceUnit const* ast = &stack.getAST();
+	stack.compile(string("contract B {}"));
+	BOOST_CHECK_EQUAL(ast, &stack.getAST());
+}
+
+BOOST_AUTO_TEST_CASE(created_contract_compiled_first)
+{
+	// A comes first but creates B, so B's code must be ready to go into A's.
+	CompilerStack stack(false);
+	stack.addSource("", "contract A { function f() { new B(); } } contract B { function g() returns (uint) { return 2; } }");
+	ETH_TEST_REQUIRE_NO_THROW(stack.compile(true), "Compiling failed");
+	bytes const& a = stack.getRuntimeBytecode("A");
+	bytes const& b = stack.getBytecode("B");
+	BOOST_CHECK(search(a.begin(), a.end(), b.begin(), b.end()) != a.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+}
+} // end namespaces
+
+#endif
@@ -26,6 +26,8 @@
 #include <string>
 #include <tuple>
 #include <boost/test/unit_test.hpp>
+#include <boost/filesystem.hpp>
+#include <libdevcore/CommonIO.h>
 #include <libdevcrypto/SHA3.h>
 #include <test/solidityExecutionFramework.h>
 
@@ -3676,6 +3678,24 @@ BOOST_AUTO_TEST_CASE(packed_storage_structs_with_bytes0)
 	BOOST_CHECK(callContractFunction("test()") == encodeArgs(true));
 }
 
+BOOST_AUTO_TEST_CASE(many_functions_dispatch_gas)
+{
+	// The selector is searched for among ManyFunctions' 200 or so, so a call costs little more than with the
+	// function alone, rather than a comparison for each function sorting before it.
+	string manyFunctions = asString(contents((boost::filesystem::path(__FILE__).parent_path() / "ManyFunctions.sol").string()));
+	for (string const& function: {"finish", "nextRand"})
+	{
+		string signature = function + "(uint256)";
+		compileAndRun("contract ManyFunctions { function " + function + "(uint seed) returns (uint) { return seed; } }");
+		callContractFunction(signature, 7);
+		u256 alone = m_gasUsed;
+		compileAndRun(manyFunctions);
+		BOOST_REQUIRE(!callContractFunction(signature, 7).empty());
+		BOOST_TEST_MESSAGE(signature << ": " << m_gasUsed << " gas in ManyFunctions, " << alone << " alone");
+		BOOST_CHECK_LT(m_gasUsed - alone, 400);
+	}
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
@@ -0,0 +1,84 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/**
+ * @date 2015
+ * Tests for attributing the gas of Solidity contracts to their source.
+ */
+
+#if ETH_SOLIDITY
+
+#include <string>
+#include <boost/test/unit_test.hpp>
+#include <test/solidityExecutionFramework.h>
+#include <libevmcore/GasProfiler.h>
+
+using namespace std;
+using namespace dev::eth;
+
+namespace dev
+{
+namespace solidity
+{
+namespace test
+{
+
+class GasProfilerFramework: public ExecutionFramework
+{
+public:
+	GasProfilerFramework() { m_gasProfiler = &m_profiler; }
+
+protected:
+	GasProfiler m_profiler;
+};
+
+BOOST_FIXTURE_TEST_SUITE(SolidityGasProfiler, GasProfilerFramework)
+
+BOOST_AUTO_TEST_CASE(gas_by_line_and_function)
+{
+	char const* sourceCode = R"(
+		contract C {
+			uint x;
+			function f(uint a) returns (uint r) {
+				r = g(a) + g(a + 1);
+			}
+			function g(uint b) internal returns (uint r) {
+				r = b * 2;
+				x = r;
+			}
+		}
+	)";
+	compileAndRun(sourceCode);
+	BOOST_REQUIRE(callContractFunction("f(uint256)", u256(5)) == encodeArgs(u256(22)));
+
+	string const f = "function f(uint a) returns (uint r)";
+	string const g = "function g(uint b) internal returns (uint r)";
+	BOOST_CHECK(m_profiler.frames().count("C(creation)"));
+	BOOST_CHECK(m_profiler.frames().count(f));
+	BOOST_REQUIRE(m_profiler.frames().count(g));
+	// The storage writes in g cost far more than anything else.
+	BOOST_CHECK(m_profiler.frames().at(g) > m_profiler.frames().at(f));
+	BOOST_CHECK(m_profiler.lines().at("C:9") > c_sstoreSetGas);
+	BOOST_CHECK(m_profiler.stacks().count("C;" + f + ";" + g + ";C:9"));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+}
+}
+} // end namespaces
+
+#endif
@@ -29,6 +29,8 @@
 #include <test/solidityExecutionFramework.h>
 #include <libevmcore/CommonSubexpressionEliminator.h>
 #include <libevmcore/Assembly.h>
+#include <libevmcore/ControlFlowGraph.h>
+#include <libevmcore/GasMeter.h>
 
 using namespace std;
 using namespace dev::eth;
@@ -206,6 +208,54 @@ BOOST_AUTO_TEST_CASE(function_calls)
 	compareVersions("f(uint256)", 36);
 }
 
+BOOST_AUTO_TEST_CASE(packed_storage_through_internal_calls)
+{
+	// Both setters write into the same slot; once their bodies are merged into f, one SSTORE is left.
+	char const* sourceCode = R"(
+		contract test {
+			uint64 a;
+			uint64 b;
+			function setA(uint64 x) internal { a = x; }
+			function setB(uint64 x) internal { b = x; }
+			function f(uint64 x, uint64 y) returns (uint64 ra, uint64 rb) { setA(x); setB(y); ra = a; rb = b; }
+		}
+	)";
+	compileBothVersions(sourceCode);
+	compareVersions("f(uint64,uint64)", 7, 9);
+	compareVersions("f(uint64,uint64)", u256(1) << 63, 0);
+	m_optimize = true;
+	bytes code = compileAndRun(sourceCode);
+	unsigned sstores = 0;
+	eth::eachInstruction(code, [&](Instruction _i, u256 const&) { sstores += _i == Instruction::SSTORE; });
+	BOOST_CHECK_EQUAL(sstores, 1);
+}
+
+BOOST_AUTO_TEST_CASE(constant_expressions_folded)
+{
+	// Everything here is known at compile time, so neither SHA3 nor EXP is left in the optimised code.
+	char const* sourceCode = R"(
+		contract test {
+			uint constant a = 2**10 * 1 ether;
+			uint8 constant b = 200;
+			int8 constant c = -128;
+			bytes4 constant d = "abcd";
+			function f() returns (uint) { return a / 3 + uint16(b + b); }
+			function g() returns (bool x, int y) { x = c < -1 && !(b == 144); y = -c / int(-3); }
+			function h() returns (bytes32 x, bytes2 y, uint z) { x = sha3(a, b, c, true, "xy", d); y = bytes2(d); z = uint8(d); }
+		}
+	)";
+	compileBothVersions(sourceCode);
+	compareVersions("f()");
+	compareVersions("g()");
+	compareVersions("h()");
+	m_optimize = true;
+	bytes code = compileAndRun(sourceCode);
+	eth::eachInstruction(code, [&](Instruction _i, u256 const&)
+	{
+		BOOST_CHECK(_i != Instruction::SHA3 && _i != Instruction::EXP);
+	});
+}
+
 BOOST_AUTO_TEST_CASE(cse_intermediate_swap)
 {
 	eth::CommonSubexpressionEliminator cse;
@@ -731,6 +781,93 @@ BOOST_AUTO_TEST_CASE(cse_sha3_twice_same_content_noninterfering_store_in_between
 	BOOST_CHECK_EQUAL(1, count(output.begin(), output.end(), AssemblyItem(Instruction::SHA3)));
 }
 
+BOOST_AUTO_TEST_CASE(gas_meter)
+{
+	// As fast as each other, but the DUP is a byte shorter.
+	AssemblyItems push{u256(2)};
+	AssemblyItems dup{Instruction::DUP1};
+	BOOST_CHECK_EQUAL(GasMeter::runGas(&push), GasMeter::runGas(&dup));
+	BOOST_CHECK(GasMeter::cost(&dup, 1, false, 1) < GasMeter::cost(&push, 1, false, 1));
+
+	// A long constant against a short load: the more runs, the more the load costs.
+	AssemblyItems constant{u256(0x1234567890)};
+	AssemblyItems load{u256(0), Instruction::SLOAD};
+	BOOST_CHECK(GasMeter::cost(&load, 1, false, 1) < GasMeter::cost(&constant, 1, false, 1));
+	BOOST_CHECK(GasMeter::cost(&constant, 1, false, c_optimiseRuns) < GasMeter::cost(&load, 1, false, c_optimiseRuns));
+	BOOST_CHECK_EQUAL(GasMeter::cost(&load, 1, true, c_optimiseRuns), GasMeter::runGas(&load) + GasMeter::deployGas(&load, 1, true));
+}
+
+BOOST_AUTO_TEST_CASE(cfg_jump_threading)
+{
+	// tag 1 only jumps on to tag 2: the jump to it goes straight there, leaving tag 1's block dead, and tag 2's
+	// block, then entered only by that jump, goes in its place.
+	AssemblyItems input{
+		AssemblyItem(PushTag, 1),
+		Instruction::JUMP,
+		AssemblyItem(Tag, 1),
+		AssemblyItem(PushTag, 2),
+		Instruction::JUMP,
+		AssemblyItem(Tag, 2),
+		Instruction::STOP
+	};
+	ControlFlowGraph cfg(input);
+	BOOST_CHECK_EQUAL(cfg.threadJumps(), 1);
+	BOOST_CHECK_EQUAL(cfg.removeDeadBlocks(), 1);
+	BOOST_CHECK_EQUAL(cfg.mergeBlocks(), 1);
+	AssemblyItems expectation{Instruction::STOP};
+	AssemblyItems output = cfg.items();
+	BOOST_CHECK_EQUAL_COLLECTIONS(expectation.begin(), expectation.end(), output.begin(), output.end());
+
+	// A loop of jumps is left as it is.
+	AssemblyItems loop{AssemblyItem(Tag, 1), AssemblyItem(PushTag, 2), Instruction::JUMP, AssemblyItem(Tag, 2), AssemblyItem(PushTag, 1), Instruction::JUMP};
+	BOOST_CHECK_EQUAL(ControlFlowGraph(loop).threadJumps(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(cfg_constant_jumps)
+{
+	AssemblyItems input{
+		u256(0),
+		AssemblyItem(PushTag, 1),
+		Instruction::JUMPI,
+		u256(1),
+		AssemblyItem(PushTag, 2),
+		Instruction::JUMPI,
+		AssemblyItem(Tag, 1),
+		Instruction::STOP,
+		AssemblyItem(Tag, 2),
+		Instruction::CALLER,
+		Instruction::STOP
+	};
+	ControlFlowGraph cfg(input);
+	BOOST_CHECK_EQUAL(cfg.foldConstantJumps(), 2);
+	BOOST_CHECK_EQUAL(cfg.removeDeadBlocks(), 1);
+	BOOST_CHECK_EQUAL(cfg.mergeBlocks(), 1);
+	AssemblyItems expectation{Instruction::CALLER, Instruction::STOP};
+	AssemblyItems output = cfg.items();
+	BOOST_CHECK_EQUAL_COLLECTIONS(expectation.begin(), expectation.end(), output.begin(), output.end());
+}
+
+BOOST_AUTO_TEST_CASE(cfg_sload_across_blocks)
+{
+	// The second load, in the block jumped to, is of a slot loaded before the jump and not stored to since.
+	Assembly a;
+	AssemblyItem t = a.newTag();
+	a.append(u256(7));
+	a.append(Instruction::SLOAD);
+	a.appendJump(t);
+	a.append(t);
+	a.append(u256(7));
+	a.append(Instruction::SLOAD);
+	a.append(Instruction::ADD);
+	a.append(u256(0));
+	a.append(Instruction::MSTORE);
+	a.append(Instruction::STOP);
+	a.optimise(true, false);
+	AssemblyItems const& items = a.getItems();
+	BOOST_CHECK_EQUAL(1, count(items.begin(), items.end(), AssemblyItem(Instruction::SLOAD)));
+	BOOST_CHECK_EQUAL(0, count(items.begin(), items.end(), AssemblyItem(Instruction::JUMP)));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 }
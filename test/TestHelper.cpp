@@ -29,6 +29,7 @@
 #include <libethereum/Client.h>
 #include <liblll/Compiler.h>
 #include <libevm/VMFactory.h>
+#include <libdevcore/ThreadPool.h>
 #include "Stats.h"
 
 using namespace std;
@@ -217,9 +218,9 @@ void ImportTest::checkExpectedState(State const& _stateExpect, State const& _sta
 	#define CHECK(a,b)						\
 		{									\
 			if (_throw == WhenError::Throw) \
-				BOOST_CHECK_MESSAGE(a,b);	\
+				ETH_TEST_CHECK_MESSAGE(a,b);	\
 			else							\
-				BOOST_WARN_MESSAGE(a,b);	\
+				ETH_TEST_WARN_MESSAGE(a,b);	\
 		}
 
 	for (auto const& a: _stateExpect.addresses())
@@ -236,7 +237,7 @@ void ImportTest::checkExpectedState(State const& _stateExpect, State const& _sta
 				}
 				catch(std::out_of_range)
 				{
-					BOOST_ERROR("expectedStateOptions map does not match expectedState in checkExpectedState!");
+					ETH_TEST_ERROR("expectedStateOptions map does not match expectedState in checkExpectedState!");
 					break;
 				}
 			}
@@ -424,13 +425,13 @@ void checkOutput(bytes const& _output, json_spirit::mObject& _o)
 	if (_o["out"].type() == json_spirit::array_type)
 		for (auto const& d: _o["out"].get_array())
 		{
-			BOOST_CHECK_MESSAGE(_output[j] == toInt(d), "Output byte [" << j << "] different!");
+			ETH_TEST_CHECK_MESSAGE(_output[j] == toInt(d), "Output byte [" << j << "] different!");
 			++j;
 		}
 	else if (_o["out"].get_str().find("0x") == 0)
-		BOOST_CHECK(_output == fromHex(_o["out"].get_str().substr(2)));
+		ETH_TEST_CHECK(_output == fromHex(_o["out"].get_str().substr(2)));
 	else
-		BOOST_CHECK(_output == fromHex(_o["out"].get_str()));
+		ETH_TEST_CHECK(_output == fromHex(_o["out"].get_str()));
 }
 
 void checkStorage(map<u256, u256> _expectedStore, map<u256, u256> _resultStore, Address _expectedAddr)
@@ -440,44 +441,44 @@ void checkStorage(map<u256, u256> _expectedStore, map<u256, u256> _resultStore,
 		auto& expectedStoreKey = expectedStorePair.first;
 		auto resultStoreIt = _resultStore.find(expectedStoreKey);
 		if (resultStoreIt == _resultStore.end())
-			BOOST_ERROR(_expectedAddr << ": missing store key " << expectedStoreKey);
+			ETH_TEST_ERROR(_expectedAddr << ": missing store key " << expectedStoreKey);
 		else
 		{
 			auto& expectedStoreValue = expectedStorePair.second;
 			auto& resultStoreValue = resultStoreIt->second;
-			BOOST_CHECK_MESSAGE(expectedStoreValue == resultStoreValue, _expectedAddr << ": store[" << expectedStoreKey << "] = " << resultStoreValue << ", expected " << expectedStoreValue);
+			ETH_TEST_CHECK_MESSAGE(expectedStoreValue == resultStoreValue, _expectedAddr << ": store[" << expectedStoreKey << "] = " << resultStoreValue << ", expected " << expectedStoreValue);
 		}
 	}
-	BOOST_CHECK_EQUAL(_resultStore.size(), _expectedStore.size());
+	ETH_TEST_CHECK_EQUAL(_resultStore.size(), _expectedStore.size());
 	for (auto&& resultStorePair: _resultStore)
 	{
 		if (!_expectedStore.count(resultStorePair.first))
-			BOOST_ERROR(_expectedAddr << ": unexpected store key " << resultStorePair.first);
+			ETH_TEST_ERROR(_expectedAddr << ": unexpected store key " << resultStorePair.first);
 	}
 }
 
 void checkLog(LogEntries _resultLogs, LogEntries _expectedLogs)
 {
-	BOOST_REQUIRE_EQUAL(_resultLogs.size(), _expectedLogs.size());
+	ETH_TEST_REQUIRE_EQUAL(_resultLogs.size(), _expectedLogs.size());
 
 	for (size_t i = 0; i < _resultLogs.size(); ++i)
 	{
-		BOOST_CHECK_EQUAL(_resultLogs[i].address, _expectedLogs[i].address);
-		BOOST_CHECK_EQUAL(_resultLogs[i].topics, _expectedLogs[i].topics);
-		BOOST_CHECK(_resultLogs[i].data == _expectedLogs[i].data);
+		ETH_TEST_CHECK_EQUAL(_resultLogs[i].address, _expectedLogs[i].address);
+		ETH_TEST_CHECK_EQUAL(_resultLogs[i].topics, _expectedLogs[i].topics);
+		ETH_TEST_CHECK(_resultLogs[i].data == _expectedLogs[i].data);
 	}
 }
 
 void checkCallCreates(eth::Transactions _resultCallCreates, eth::Transactions _expectedCallCreates)
 {
-	BOOST_REQUIRE_EQUAL(_resultCallCreates.size(), _expectedCallCreates.size());
+	ETH_TEST_REQUIRE_EQUAL(_resultCallCreates.size(), _expectedCallCreates.size());
 
 	for (size_t i = 0; i < _resultCallCreates.size(); ++i)
 	{
-		BOOST_CHECK(_resultCallCreates[i].data() == _expectedCallCreates[i].data());
-		BOOST_CHECK(_resultCallCreates[i].receiveAddress() == _expectedCallCreates[i].receiveAddress());
-		BOOST_CHECK(_resultCallCreates[i].gas() == _expectedCallCreates[i].gas());
-		BOOST_CHECK(_resultCallCreates[i].value() == _expectedCallCreates[i].value());
+		ETH_TEST_CHECK(_resultCallCreates[i].data() == _expectedCallCreates[i].data());
+		ETH_TEST_CHECK(_resultCallCreates[i].receiveAddress() == _expectedCallCreates[i].receiveAddress());
+		ETH_TEST_CHECK(_resultCallCreates[i].gas() == _expectedCallCreates[i].gas());
+		ETH_TEST_CHECK(_resultCallCreates[i].value() == _expectedCallCreates[i].value());
 	}
 }
 
@@ -503,7 +504,7 @@ void userDefinedTest(string testTypeFlag, std::function<void(json_spirit::mValue
 				json_spirit::mValue v;
 				string s = asString(contents(filename));
 				BOOST_REQUIRE_MESSAGE(s.length() > 0, "Contents of " + filename + " is empty. ");
-				json_spirit::read_string(s, v);
+				readJson(s, v);
 				json_spirit::mObject oSingleTest;
 
 				json_spirit::mObject::const_iterator pos = v.get_obj().find(testname);
@@ -533,7 +534,82 @@ void userDefinedTest(string testTypeFlag, std::function<void(json_spirit::mValue
 	}
 }
 
-void executeTests(const string& _name, const string& _testPathAppendix, std::function<void(json_spirit::mValue&, bool)> doTests)
+static thread_local CaseReport* t_caseReport = nullptr;
+
+CaseReport::Scope::Scope(CaseReport& _report):
+	m_outer(t_caseReport)
+{
+	t_caseReport = &_report;
+}
+
+CaseReport::Scope::~Scope()
+{
+	t_caseReport = m_outer;
+}
+
+CaseReport* CaseReport::current()
+{
+	return t_caseReport;
+}
+
+void CaseReport::fail(CheckSeverity _severity, string const& _message, char const* _file, unsigned _line)
+{
+	m_failures.push_back(Failure{_severity, _message, _file, _line});
+	if (_severity == CheckSeverity::Require)
+		BOOST_THROW_EXCEPTION(RequirementFailed());
+}
+
+void CaseReport::report(string const& _case) const
+{
+	for (auto const& f: m_failures)
+		if (f.severity == CheckSeverity::Warn)
+			BOOST_WARN_MESSAGE(false, _case << ": " << f.message << " (" << f.file << ":" << f.line << ")");
+		else
+			BOOST_ERROR(_case << ": " << f.message << " (" << f.file << ":" << f.line << ")");
+}
+
+/// Passes each case of @a _v to @a _doTests on its own, concurrently, and then puts them, as filled, back in @a _v and
+/// reports what each failed, in order.
+static void doTestsInParallel(json_spirit::mValue& _v, bool _fillin, std::function<void(json_spirit::mValue&, bool)> const& _doTests)
+{
+	json_spirit::mObject& all = _v.get_obj();
+	vector<string> names;
+	vector<json_spirit::mValue> cases;
+	for (auto& i: all)
+	{
+		names.push_back(i.first);
+		json_spirit::mObject o;
+		o[i.first] = move(i.second);
+		cases.push_back(move(o));
+	}
+	vector<CaseReport> reports(cases.size());
+	ThreadPool::get().forEach(cases.size(), [&](unsigned i)
+	{
+		CaseReport::Scope scope(reports[i]);
+		try
+		{
+			_doTests(cases[i], _fillin);
+		}
+		catch (RequirementFailed const&)
+		{
+		}
+		catch (Exception const& _e)
+		{
+			ETH_TEST_ERROR("Failed test with Exception: " << diagnostic_information(_e));
+		}
+		catch (std::exception const& _e)
+		{
+			ETH_TEST_ERROR("Failed test with Exception: " << _e.what());
+		}
+	});
+	for (unsigned i = 0; i < cases.size(); ++i)
+	{
+		all[names[i]] = move(cases[i].get_obj()[names[i]]);
+		reports[i].report(names[i]);
+	}
+}
+
+void executeTests(const string& _name, const string& _testPathAppendix, std::function<void(json_spirit::mValue&, bool)> doTests, bool _parallel)
 {
 	string testPath = getTestPath();
 	testPath += _testPathAppendix;
@@ -541,6 +617,17 @@ void executeTests(const string& _name, const string& _testPathAppendix, std::fun
 	if (Options::get().stats)
 		Listener::registerListener(Stats::get());
 
+	// The listeners, such as the stats, and the VM trace see one case at a time.
+	if (Options::get().serial || Options::get().stats || Options::get().vmtrace)
+		_parallel = false;
+	auto run = [&](json_spirit::mValue& _v, bool _fillin)
+	{
+		if (_parallel)
+			doTestsInParallel(_v, _fillin, doTests);
+		else
+			doTests(_v, _fillin);
+	};
+
 	if (Options::get().fillTests)
 	{
 		try
@@ -551,8 +638,8 @@ void executeTests(const string& _name, const string& _testPathAppendix, std::fun
 			boost::filesystem::path dir = p.parent_path();
 			string s = asString(dev::contents(dir.string() + "/" + _name + "Filler.json"));
 			BOOST_REQUIRE_MESSAGE(s.length() > 0, "Contents of " + dir.string() + "/" + _name + "Filler.json is empty.");
-			json_spirit::read_string(s, v);
-			doTests(v, true);
+			readJson(s, v);
+			run(v, true);
 			writeFile(testPath + "/" + _name + ".json", asBytes(json_spirit::write_string(v, true)));
 		}
 		catch (Exception const& _e)
@@ -571,9 +658,9 @@ void executeTests(const string& _name, const string& _testPathAppendix, std::fun
 		json_spirit::mValue v;
 		string s = asString(dev::contents(testPath + "/" + _name + ".json"));
 		BOOST_REQUIRE_MESSAGE(s.length() > 0, "Contents of " + testPath + "/" + _name + ".json is empty. Have you cloned the 'tests' repo branch develop and set ETHEREUM_TEST_PATH to its path?");
-		json_spirit::read_string(s, v);
+		readJson(s, v);
 		Listener::notifySuiteStarted(_name);
-		doTests(v, false);
+		run(v, false);
 	}
 	catch (Exception const& _e)
 	{
@@ -652,6 +739,8 @@ Options::Options()
 			if (arg.size() > 7)
 				statsOutFile = arg.substr(8); // skip '=' char
 		}
+		else if (arg.compare(0, 13, "--gasprofile=") == 0)
+			gasProfileOutFile = arg.substr(13);
 		else if (arg == "--performance")
 			performance = true;
 		else if (arg == "--quadratic")
@@ -664,6 +753,8 @@ Options::Options()
 			bigData = true;
 		else if (arg == "--checkstate")
 			checkState = true;
+		else if (arg == "--serial")
+			serial = true;
 		else if (arg == "--all")
 		{
 			performance = true;
@@ -22,10 +22,12 @@
 #pragma once
 
 #include <functional>
+#include <sstream>
 
 #include <boost/test/unit_test.hpp>
 
 #include "JsonSpiritHeaders.h"
+#include "JsonReader.h"
 #include <libethereum/State.h>
 #include <libevm/ExtVMFace.h>
 #include <libtestutils/Common.h>
@@ -45,6 +47,89 @@ void connectClients(Client& c1, Client& c2);
 namespace test
 {
 
+/// How bad a failed check is.
+enum class CheckSeverity
+{
+	Warn,		///< Not a failure; as BOOST_WARN.
+	Check,		///< As BOOST_CHECK: the case goes on.
+	Require		///< As BOOST_REQUIRE: the case stops.
+};
+
+/// Thrown by a failed ETH_TEST_REQUIRE while checks are deferred, to stop the case.
+struct RequirementFailed: virtual Exception {};
+
+/**
+ * @brief The failed checks of a JSON test case run concurrently with others by executeTests(), which Boost.Test can not
+ * take from several threads; once all the cases are done they are reported through Boost, in the order of the cases.
+ * The checks of the doTests of such cases must be made with the ETH_TEST_ macros, which go straight to Boost when no
+ * case is deferring them on the calling thread.
+ */
+class CaseReport
+{
+public:
+	/// Defers the checks made on this thread to @a _report while in scope.
+	class Scope
+	{
+	public:
+		explicit Scope(CaseReport& _report);
+		~Scope();
+		Scope(Scope const&) = delete;
+		Scope& operator=(Scope const&) = delete;
+
+	private:
+		CaseReport* m_outer;
+	};
+
+	/// @returns the report the checks of this thread are deferred to, or null if they go straight to Boost.
+	static CaseReport* current();
+
+	/// Records a failed check; with CheckSeverity::Require, throws RequirementFailed.
+	void fail(CheckSeverity _severity, std::string const& _message, char const* _file, unsigned _line);
+	/// Reports the failures recorded through Boost, from the calling thread, as those of the case @a _case.
+	void report(std::string const& _case) const;
+
+private:
+	struct Failure
+	{
+		CheckSeverity severity;
+		std::string message;
+		std::string file;
+		unsigned line;
+	};
+
+	std::vector<Failure> m_failures;
+};
+
+/// A check made through Boost, as @a _boost, or deferred to the CaseReport of the thread if there is one.
+#define ETH_TEST_CHECK_IMPL(_cond, _message, _severity, _boost)		\
+	do																	\
+	{																	\
+		if (auto report = dev::test::CaseReport::current())			\
+		{																\
+			if (!(_cond))												\
+			{															\
+				std::ostringstream message;								\
+				message << _message;									\
+				report->fail(dev::test::CheckSeverity::_severity, message.str(), __FILE__, __LINE__); \
+			}															\
+		}																\
+		else															\
+			_boost;														\
+	}																	\
+	while (0)
+
+/// Our versions of the Boost.Test checks, which may be deferred; see CaseReport.
+/// @{
+#define ETH_TEST_CHECK(_cond) ETH_TEST_CHECK_IMPL(_cond, "check " #_cond " has failed", Check, BOOST_CHECK(_cond))
+#define ETH_TEST_CHECK_MESSAGE(_cond, _message) ETH_TEST_CHECK_IMPL(_cond, _message, Check, BOOST_CHECK_MESSAGE(_cond, _message))
+#define ETH_TEST_CHECK_EQUAL(_a, _b) ETH_TEST_CHECK_IMPL((_a) == (_b), "check " #_a " == " #_b " has failed [" << (_a) << " != " << (_b) << "]", Check, BOOST_CHECK_EQUAL(_a, _b))
+#define ETH_TEST_REQUIRE(_cond) ETH_TEST_CHECK_IMPL(_cond, "critical check " #_cond " has failed", Require, BOOST_REQUIRE(_cond))
+#define ETH_TEST_REQUIRE_MESSAGE(_cond, _message) ETH_TEST_CHECK_IMPL(_cond, _message, Require, BOOST_REQUIRE_MESSAGE(_cond, _message))
+#define ETH_TEST_REQUIRE_EQUAL(_a, _b) ETH_TEST_CHECK_IMPL((_a) == (_b), "critical check " #_a " == " #_b " has failed [" << (_a) << " != " << (_b) << "]", Require, BOOST_REQUIRE_EQUAL(_a, _b))
+#define ETH_TEST_ERROR(_message) ETH_TEST_CHECK_IMPL(false, _message, Check, BOOST_ERROR(_message))
+#define ETH_TEST_WARN_MESSAGE(_cond, _message) ETH_TEST_CHECK_IMPL(_cond, _message, Warn, BOOST_WARN_MESSAGE(_cond, _message))
+/// @}
+
 /// Make sure that no Exception is thrown during testing. If one is thrown show its info and fail the test.
 /// Our version of BOOST_REQUIRE_NO_THROW()
 /// @param _statenent    The statement for which to make sure no exceptions are thrown
@@ -151,7 +236,10 @@ void checkStorage(std::map<u256, u256> _expectedStore, std::map<u256, u256> _res
 void checkLog(eth::LogEntries _resultLogs, eth::LogEntries _expectedLogs);
 void checkCallCreates(eth::Transactions _resultCallCreates, eth::Transactions _expectedCallCreates);
 
-void executeTests(const std::string& _name, const std::string& _testPathAppendix, std::function<void(json_spirit::mValue&, bool)> doTests);
+/// Fills, if asked to, and runs the JSON tests @a _name, passing them to @a doTests. If @a _parallel, each case is passed
+/// on its own, the cases running concurrently on the shared thread pool unless --serial, --stats or --vmtrace is given,
+/// with their checks deferred; see CaseReport.
+void executeTests(const std::string& _name, const std::string& _testPathAppendix, std::function<void(json_spirit::mValue&, bool)> doTests, bool _parallel = false);
 void userDefinedTest(std::string testTypeFlag, std::function<void(json_spirit::mValue&, bool)> doTests);
 RLPStream createRLPStreamFromTransactionFields(json_spirit::mObject& _tObj);
 eth::LastHashes lastHashes(u256 _currentBlockNumber);
@@ -165,9 +253,9 @@ void checkAddresses(mapType& _expectedAddrs, mapType& _resultAddrs)
 		auto& resultAddr = resultPair.first;
 		auto expectedAddrIt = _expectedAddrs.find(resultAddr);
 		if (expectedAddrIt == _expectedAddrs.end())
-			BOOST_ERROR("Missing result address " << resultAddr);
+			ETH_TEST_ERROR("Missing result address " << resultAddr);
 	}
-	BOOST_CHECK(_expectedAddrs == _resultAddrs);
+	ETH_TEST_CHECK(_expectedAddrs == _resultAddrs);
 }
 
 class Options
@@ -179,6 +267,8 @@ public:
 	bool stats = false;		///< Execution time stats
 	std::string statsOutFile; ///< Stats output file. "out" for standard output
 	bool checkState = false;///< Throw error when checking test states
+	bool serial = false;	///< Run the cases of JSON test files one after another, rather than concurrently
+	std::string gasProfileOutFile; ///< Gas profile of the Solidity tests by source line, for flamegraph.pl
 
 	/// Test selection
 	/// @{
@@ -0,0 +1,77 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file abi.cpp
+ * @date 2015
+ * ABI encoding test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libethereum/ABI.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+BOOST_AUTO_TEST_SUITE(ABITests)
+
+BOOST_AUTO_TEST_CASE(abiInLayout)
+{
+	h160 a("0x1234567890123456789012345678901234567890");
+	bytes b = abiIn("f(address,uint256,bool)", a, u256(0x0102), true);
+	static_assert(ABISize<h160, u256, bool>::value == 96, "Static parameters are a word each.");
+	BOOST_REQUIRE_EQUAL(b.size(), 4 + 96u);
+	BOOST_CHECK(bytesConstRef(&b).cropped(0, 4) == sha3("f(address,uint256,bool)").ref().cropped(0, 4));
+	bytes padded = bytes(12, 0) + a.asBytes();
+	BOOST_CHECK(bytesConstRef(&b).cropped(4, 32) == bytesConstRef(&padded));
+	BOOST_CHECK_EQUAL(b[4 + 62], 0x01);
+	BOOST_CHECK_EQUAL(b[4 + 63], 0x02);
+	BOOST_CHECK_EQUAL(b[4 + 95], 1);
+	BOOST_CHECK_EQUAL(b[4 + 64], 0);
+}
+
+BOOST_AUTO_TEST_CASE(abiFunctionReusesBuffer)
+{
+	ABIFunction<u256, h256> f("set(uint256,hash256)");
+	static_assert(ABIFunction<u256, h256>::size == 68, "Selector and two words.");
+	BOOST_CHECK(f.selector() == abiSelector("set(uint256,hash256)"));
+	bytes buffer(ABIFunction<u256, h256>::size);
+	for (unsigned i = 0; i < 3; ++i)
+	{
+		f.encode(bytesRef(&buffer), i, sha3(h256(i)));
+		BOOST_CHECK(buffer == abiIn("set(uint256,hash256)", u256(i), sha3(h256(i))));
+		BOOST_CHECK(buffer == f(i, sha3(h256(i))));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(abiOutRoundTrip)
+{
+	h160 a = h160(u160(0xabcdef));
+	string32 s = {{'e', 't', 'h'}};
+	bytes b = abiIn(FixedHash<4>(), u256(7), a, s, false);
+	auto t = abiOutTuple<u256, h160, string32, bool>(bytesConstRef(&b).cropped(4));
+	BOOST_CHECK_EQUAL(get<0>(t), 7);
+	BOOST_CHECK(get<1>(t) == a);
+	BOOST_CHECK(get<2>(t) == s);
+	BOOST_CHECK(!get<3>(t));
+	BOOST_CHECK(abiOut<h160>(bytesConstRef(&b).cropped(36)) == a);
+
+	// Short output reads as zero.
+	bytes shortOutput(16, 0xff);
+	BOOST_CHECK_EQUAL(abiOut<u256>(shortOutput), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,94 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file affinity.cpp
+ * @date 2015
+ * Thread affinity test functions.
+ */
+
+#include <thread>
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/Affinity.h>
+#include <libdevcore/Log.h>
+#include <libdevcore/Numa.h>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+using namespace dev;
+
+BOOST_AUTO_TEST_SUITE(AffinityTests)
+
+BOOST_AUTO_TEST_CASE(cpuSets)
+{
+	BOOST_CHECK(parseCpuSet("3") == vector<unsigned>({3}));
+	BOOST_CHECK(parseCpuSet("0-2,5") == vector<unsigned>({0, 1, 2, 5}));
+	BOOST_CHECK_THROW(parseCpuSet(""), BadCpuSet);
+	BOOST_CHECK_THROW(parseCpuSet("2-1"), BadCpuSet);
+	BOOST_CHECK_THROW(parseCpuSet("1,x"), BadCpuSet);
+	BOOST_CHECK_THROW(parseCpuSet("1-"), BadCpuSet);
+
+	// There is always a node 0, of every CPU should the machine not be split into nodes.
+	BOOST_REQUIRE(!numaNodes().empty());
+	BOOST_CHECK(parseCpuSet("node0") == numaNodes()[0]);
+	BOOST_CHECK_THROW(parseCpuSet("node" + to_string(numaNodes().size())), BadCpuSet);
+	BOOST_CHECK_THROW(parseCpuSet("node"), BadCpuSet);
+	BOOST_CHECK(currentNumaNode() < numaNodes().size());
+}
+
+#if defined(__linux__)
+static vector<unsigned> cpusOf(pthread_t _t)
+{
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	pthread_getaffinity_np(_t, sizeof(set), &set);
+	vector<unsigned> ret;
+	for (unsigned i = 0; i < CPU_SETSIZE; ++i)
+		if (CPU_ISSET(i, &set))
+			ret.push_back(i);
+	return ret;
+}
+
+BOOST_AUTO_TEST_CASE(pinsByLongestPrefix)
+{
+	auto pinned = [](char const* _name)
+	{
+		vector<unsigned> ret;
+		thread([&]() { setThreadName(_name); ret = cpusOf(pthread_self()); }).join();
+		return ret;
+	};
+
+	// Threads otherwise get the CPUs of the thread starting them.
+	vector<unsigned> all = cpusOf(pthread_self());
+	BOOST_REQUIRE(!all.empty());
+	vector<unsigned> first{all.front()};
+	vector<unsigned> last{all.back()};
+
+	setThreadAffinity("p", first);
+	setThreadAffinity("p2p", last);
+	BOOST_CHECK(pinned("p2p.3") == last);
+	BOOST_CHECK(pinned("pool") == first);
+	BOOST_CHECK(pinned("eth") == all);
+	setThreadAffinity("p2p", {});
+	BOOST_CHECK(pinned("p2p.3") == first);
+	setThreadAffinity("p", {});
+	BOOST_CHECK(pinned("p2p.3") == all);
+}
+#endif
+
+BOOST_AUTO_TEST_SUITE_END()
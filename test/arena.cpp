@@ -0,0 +1,68 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file arena.cpp
+ * @date 2015
+ * Arena test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/Arena.h>
+
+using namespace std;
+using namespace dev;
+
+BOOST_AUTO_TEST_SUITE(ArenaTests)
+
+BOOST_AUTO_TEST_CASE(arenaAllocate)
+{
+	Arena a(256);
+	byte* b = static_cast<byte*>(a.allocate(3, 1));
+	void* p = a.allocate(8, 8);
+	BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(p) % 8, 0u);
+	BOOST_CHECK(static_cast<byte*>(p) > b);
+
+	bytes data{1, 2, 3};
+	bytesRef c = a.copy(&data);
+	BOOST_CHECK(c.toBytes() == data);
+
+	// More than a chunk; after a reset, all of it fits in one.
+	a.allocate(1000, 1);
+	BOOST_CHECK_GE(a.allocated(), 1011u);
+	a.reset();
+	BOOST_CHECK_EQUAL(a.allocated(), 0u);
+	size_t capacity = a.capacity();
+	BOOST_CHECK_GE(capacity, 1011u);
+	a.allocate(1000, 1);
+	BOOST_CHECK_EQUAL(a.capacity(), capacity);
+}
+
+BOOST_AUTO_TEST_CASE(arenaContainers)
+{
+	Arena a;
+	ArenaVector<unsigned> v{ArenaAllocator<unsigned>(a)};
+	for (unsigned i = 0; i < 1000; ++i)
+		v.push_back(i);
+	BOOST_CHECK_EQUAL(v[999], 999u);
+
+	ArenaMap<unsigned, unsigned> m{ArenaAllocator<pair<unsigned const, unsigned>>(a)};
+	for (unsigned i = 0; i < 100; ++i)
+		m[i] = i * i;
+	BOOST_CHECK_EQUAL(m.at(9), 81u);
+	BOOST_CHECK_GE(a.allocated(), 1000 * sizeof(unsigned));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
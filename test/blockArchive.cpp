@@ -0,0 +1,94 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file blockArchive.cpp
+ * @date 2015
+ * Reading of block archives.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/RLP.h>
+#include <libdevcore/Snappy.h>
+#include <libethereum/BlockArchive.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+/// @returns stand-ins for @a _n blocks, RLP lists of differing sizes.
+vector<bytes> blocks(unsigned _n)
+{
+	vector<bytes> ret;
+	for (unsigned i = 0; i < _n; ++i)
+		ret.push_back(rlpList(i, bytes(i % 7 * 10, byte(i))));
+	return ret;
+}
+
+bytes readAll(bytesConstRef _archive, bytesConstRef _index = bytesConstRef(), unsigned _from = 0)
+{
+	bytes ret;
+	BOOST_REQUIRE(readBlockArchive(_archive, [&](bytesConstRef _b){ ret += _b.toBytes(); return true; }, _index, _from));
+	return ret;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(BlockArchiveTests)
+
+BOOST_AUTO_TEST_CASE(binary)
+{
+	vector<bytes> bs = blocks(3);
+	bytes archive = bs[0] + bs[1] + bs[2];
+	BOOST_CHECK(readAll(&archive) == archive);
+
+	// Index frames starting at 0 and at 2.
+	RLPStream index(2);
+	index.appendList(2) << 0 << 0;
+	index.appendList(2) << 2 << bs[0].size() + bs[1].size();
+	BOOST_CHECK(readAll(&archive, &index.out(), 1) == archive);
+	BOOST_CHECK(readAll(&archive, &index.out(), 2) == bs[2]);
+}
+
+BOOST_AUTO_TEST_CASE(snappy)
+{
+	vector<bytes> bs = blocks(5);
+	bytes archive = rlp(string("ethereum-blocks-snappy"));
+	RLPStream index(2);
+	bytes all;
+	for (unsigned first: {0u, 3u})
+	{
+		bytes raw;
+		for (unsigned i = first; i < min<unsigned>(first + 3, bs.size()); ++i)
+			raw += bs[i];
+		all += raw;
+		index.appendList(2) << first << archive.size();
+		RLPStream frame(3);
+		frame << first << 3 << snappyCompress(&raw);
+		archive += frame.out();
+	}
+	BOOST_CHECK(readAll(&archive) == all);
+	BOOST_CHECK(readAll(&archive, &index.out(), 4) == bs[3] + bs[4]);
+
+	bytes truncated(archive.begin(), archive.end() - 1);
+	BOOST_CHECK(!readBlockArchive(&truncated, [](bytesConstRef){ return true; }));
+	bytes badMagic = rlp(string("something else")) + bytes(archive.begin() + rlp(string("ethereum-blocks-snappy")).size(), archive.end());
+	BOOST_CHECK(!readBlockArchive(&badMagic, [](bytesConstRef){ return true; }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
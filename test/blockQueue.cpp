@@ -0,0 +1,86 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file blockQueue.cpp
+ * @date 2015
+ * BlockQueue test functions.
+ */
+
+#include <ctime>
+#include <boost/test/unit_test.hpp>
+#include <libethcore/Params.h>
+#include <libethereum/BlockQueue.h>
+#include <libethereum/CanonBlockChain.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+/// @returns an empty block, of no valid proof of work, on @a _parent with @a _difficulty and @a _timestamp.
+bytes block(h256 const& _parent, u256 _difficulty, u256 _timestamp)
+{
+	BlockInfo bi;
+	bi.clear();
+	bi.parentHash = _parent;
+	bi.number = 1000;
+	bi.difficulty = _difficulty;
+	bi.gasLimit = c_minGasLimit;
+	bi.timestamp = _timestamp;
+	RLPStream s(3);
+	bi.streamRLP(s, WithNonce);
+	s.appendRaw(rlpList()).appendRaw(rlpList());
+	return s.out();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(BlockQueueTests)
+
+BOOST_AUTO_TEST_CASE(bqEvictsLeastWorkFirst)
+{
+	CanonBlockChain bc(c_memoryDBPath);
+	BlockQueue q;
+	// With verifiers, the proof of work is left to them, so these are queued for now.
+	q.setVerifierThreads(1);
+	u256 past = (u256)time(0) - 100;
+	bytes cheap = block(sha3("a"), c_minimumDifficulty, past);
+	bytes dear = block(sha3("b"), c_minimumDifficulty * 4, past);
+	bytes later = block(sha3("c"), c_minimumDifficulty * 2, past + 1000000);
+	BOOST_CHECK(q.import(&cheap, bc) == ImportResult::UnknownParent);
+	BOOST_CHECK(q.import(&dear, bc) == ImportResult::UnknownParent);
+	BOOST_CHECK(q.import(&later, bc) == ImportResult::FutureTime);
+	BOOST_CHECK(q.import(&later, bc) == ImportResult::AlreadyKnown);
+	BOOST_CHECK_EQUAL(q.status().memory, cheap.size() + dear.size() + later.size());
+	BOOST_CHECK_EQUAL(q.nextFuture(), (unsigned)(past + 1000000));
+
+	// Over the limit, the cheapest goes, whether waiting on its parent or on time.
+	q.setMemoryLimit(dear.size() + later.size());
+	BOOST_CHECK_EQUAL(q.status().unknown, 1u);
+	BOOST_CHECK_EQUAL(q.status().future, 1u);
+	q.setMemoryLimit(dear.size());
+	BOOST_CHECK_EQUAL(q.status().future, 0u);
+	BOOST_CHECK_EQUAL(q.nextFuture(), 0u);
+	BOOST_CHECK_EQUAL(q.status().memory, dear.size());
+	BOOST_CHECK(q.firstUnknown() == BlockInfo::headerHash(dear));
+
+	q.clear();
+	BOOST_CHECK_EQUAL(q.status().memory, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
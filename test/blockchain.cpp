@@ -22,8 +22,8 @@
 
 #include <boost/filesystem.hpp>
 #include <libdevcrypto/FileSystem.h>
-#include <libdevcore/TransientDirectory.h>
 #include <libethereum/CanonBlockChain.h>
+#include <libethereum/ParallelExecutor.h>
 #include "TestHelper.h"
 
 using namespace std;
@@ -47,10 +47,10 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 		cerr << i.first << endl;
 		mObject& o = i.second.get_obj();
 
-		BOOST_REQUIRE(o.count("genesisBlockHeader"));
+		ETH_TEST_REQUIRE(o.count("genesisBlockHeader"));
 		BlockInfo biGenesisBlock = constructBlock(o["genesisBlockHeader"].get_obj());
 
-		BOOST_REQUIRE(o.count("pre"));
+		ETH_TEST_REQUIRE(o.count("pre"));
 		ImportTest importer(o["pre"].get_obj());
 		State state(OverlayDB(), BaseState::Empty, biGenesisBlock.coinbaseAddress);
 		State stateTemp(OverlayDB(), BaseState::Empty, biGenesisBlock.coinbaseAddress);
@@ -61,7 +61,7 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 		if (_fillin)
 			biGenesisBlock.stateRoot = state.rootHash();
 		else
-			BOOST_CHECK_MESSAGE(biGenesisBlock.stateRoot == state.rootHash(), "root hash does not match");
+			ETH_TEST_CHECK_MESSAGE(biGenesisBlock.stateRoot == state.rootHash(), "root hash does not match");
 
 		if (_fillin)
 		{
@@ -78,12 +78,11 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 		o["genesisRLP"] = "0x" + toHex(rlpGenesisBlock.out());
 
 		// construct blockchain
-		TransientDirectory td;
-		BlockChain bc(rlpGenesisBlock.out(), td.path(), WithExisting::Kill);
+		BlockChain bc(rlpGenesisBlock.out(), c_memoryDBPath, WithExisting::Kill);
 
 		if (_fillin)
 		{
-			BOOST_REQUIRE(o.count("blocks"));
+			ETH_TEST_REQUIRE(o.count("blocks"));
 			mArray blArray;
 			vector<BlockInfo> vBiBlocks;
 			vBiBlocks.push_back(biGenesisBlock);
@@ -94,7 +93,7 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 				// get txs
 				TransactionQueue txs;
 				ZeroGasPricer gp;
-				BOOST_REQUIRE(blObj.count("transactions"));
+				ETH_TEST_REQUIRE(blObj.count("transactions"));
 				for (auto const& txObj: blObj["transactions"].get_array())
 				{
 					mObject tx = txObj.get_obj();
@@ -324,29 +323,29 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 				catch (Exception const& _e)
 				{
 					cnote << "state sync or block import did throw an exception: " << diagnostic_information(_e);
-					BOOST_CHECK(blObj.count("blockHeader") == 0);
-					BOOST_CHECK(blObj.count("transactions") == 0);
-					BOOST_CHECK(blObj.count("uncleHeaders") == 0);
+					ETH_TEST_CHECK(blObj.count("blockHeader") == 0);
+					ETH_TEST_CHECK(blObj.count("transactions") == 0);
+					ETH_TEST_CHECK(blObj.count("uncleHeaders") == 0);
 					continue;
 				}
 				catch (std::exception const& _e)
 				{
 					cnote << "state sync or block import did throw an exception: " << _e.what();
-					BOOST_CHECK(blObj.count("blockHeader") == 0);
-					BOOST_CHECK(blObj.count("transactions") == 0);
-					BOOST_CHECK(blObj.count("uncleHeaders") == 0);
+					ETH_TEST_CHECK(blObj.count("blockHeader") == 0);
+					ETH_TEST_CHECK(blObj.count("transactions") == 0);
+					ETH_TEST_CHECK(blObj.count("uncleHeaders") == 0);
 					continue;
 				}
 				catch (...)
 				{
 					cnote << "state sync or block import did throw an exception\n";
-					BOOST_CHECK(blObj.count("blockHeader") == 0);
-					BOOST_CHECK(blObj.count("transactions") == 0);
-					BOOST_CHECK(blObj.count("uncleHeaders") == 0);
+					ETH_TEST_CHECK(blObj.count("blockHeader") == 0);
+					ETH_TEST_CHECK(blObj.count("transactions") == 0);
+					ETH_TEST_CHECK(blObj.count("uncleHeaders") == 0);
 					continue;
 				}
 
-				BOOST_REQUIRE(blObj.count("blockHeader"));
+				ETH_TEST_REQUIRE(blObj.count("blockHeader"));
 
 				mObject tObj = blObj["blockHeader"].get_obj();
 				BlockInfo blockHeaderFromFields;
@@ -357,24 +356,24 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 				BlockInfo blockFromRlp = bc.info();
 
 				//Check the fields restored from RLP to original fields
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.headerHash(WithNonce) == blockFromRlp.headerHash(WithNonce), "hash in given RLP not matching the block hash!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.parentHash == blockFromRlp.parentHash, "parentHash in given RLP not matching the block parentHash!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.sha3Uncles == blockFromRlp.sha3Uncles, "sha3Uncles in given RLP not matching the block sha3Uncles!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.coinbaseAddress == blockFromRlp.coinbaseAddress,"coinbaseAddress in given RLP not matching the block coinbaseAddress!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.stateRoot == blockFromRlp.stateRoot, "stateRoot in given RLP not matching the block stateRoot!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.transactionsRoot == blockFromRlp.transactionsRoot, "transactionsRoot in given RLP not matching the block transactionsRoot!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.receiptsRoot == blockFromRlp.receiptsRoot, "receiptsRoot in given RLP not matching the block receiptsRoot!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.logBloom == blockFromRlp.logBloom, "logBloom in given RLP not matching the block logBloom!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.difficulty == blockFromRlp.difficulty, "difficulty in given RLP not matching the block difficulty!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.number == blockFromRlp.number, "number in given RLP not matching the block number!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.gasLimit == blockFromRlp.gasLimit,"gasLimit in given RLP not matching the block gasLimit!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.gasUsed == blockFromRlp.gasUsed, "gasUsed in given RLP not matching the block gasUsed!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.timestamp == blockFromRlp.timestamp, "timestamp in given RLP not matching the block timestamp!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.extraData == blockFromRlp.extraData, "extraData in given RLP not matching the block extraData!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.mixHash == blockFromRlp.mixHash, "mixHash in given RLP not matching the block mixHash!");
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields.nonce == blockFromRlp.nonce, "nonce in given RLP not matching the block nonce!");
-
-				BOOST_CHECK_MESSAGE(blockHeaderFromFields == blockFromRlp, "However, blockHeaderFromFields != blockFromRlp!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.headerHash(WithNonce) == blockFromRlp.headerHash(WithNonce), "hash in given RLP not matching the block hash!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.parentHash == blockFromRlp.parentHash, "parentHash in given RLP not matching the block parentHash!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.sha3Uncles == blockFromRlp.sha3Uncles, "sha3Uncles in given RLP not matching the block sha3Uncles!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.coinbaseAddress == blockFromRlp.coinbaseAddress,"coinbaseAddress in given RLP not matching the block coinbaseAddress!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.stateRoot == blockFromRlp.stateRoot, "stateRoot in given RLP not matching the block stateRoot!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.transactionsRoot == blockFromRlp.transactionsRoot, "transactionsRoot in given RLP not matching the block transactionsRoot!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.receiptsRoot == blockFromRlp.receiptsRoot, "receiptsRoot in given RLP not matching the block receiptsRoot!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.logBloom == blockFromRlp.logBloom, "logBloom in given RLP not matching the block logBloom!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.difficulty == blockFromRlp.difficulty, "difficulty in given RLP not matching the block difficulty!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.number == blockFromRlp.number, "number in given RLP not matching the block number!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.gasLimit == blockFromRlp.gasLimit,"gasLimit in given RLP not matching the block gasLimit!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.gasUsed == blockFromRlp.gasUsed, "gasUsed in given RLP not matching the block gasUsed!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.timestamp == blockFromRlp.timestamp, "timestamp in given RLP not matching the block timestamp!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.extraData == blockFromRlp.extraData, "extraData in given RLP not matching the block extraData!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.mixHash == blockFromRlp.mixHash, "mixHash in given RLP not matching the block mixHash!");
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields.nonce == blockFromRlp.nonce, "nonce in given RLP not matching the block nonce!");
+
+				ETH_TEST_CHECK_MESSAGE(blockHeaderFromFields == blockFromRlp, "However, blockHeaderFromFields != blockFromRlp!");
 
 				//Check transaction list
 
@@ -384,15 +383,15 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 				{
 					mObject tx = txObj.get_obj();
 
-					BOOST_REQUIRE(tx.count("nonce"));
-					BOOST_REQUIRE(tx.count("gasPrice"));
-					BOOST_REQUIRE(tx.count("gasLimit"));
-					BOOST_REQUIRE(tx.count("to"));
-					BOOST_REQUIRE(tx.count("value"));
-					BOOST_REQUIRE(tx.count("v"));
-					BOOST_REQUIRE(tx.count("r"));
-					BOOST_REQUIRE(tx.count("s"));
-					BOOST_REQUIRE(tx.count("data"));
+					ETH_TEST_REQUIRE(tx.count("nonce"));
+					ETH_TEST_REQUIRE(tx.count("gasPrice"));
+					ETH_TEST_REQUIRE(tx.count("gasLimit"));
+					ETH_TEST_REQUIRE(tx.count("to"));
+					ETH_TEST_REQUIRE(tx.count("value"));
+					ETH_TEST_REQUIRE(tx.count("v"));
+					ETH_TEST_REQUIRE(tx.count("r"));
+					ETH_TEST_REQUIRE(tx.count("s"));
+					ETH_TEST_REQUIRE(tx.count("data"));
 
 					try
 					{
@@ -401,7 +400,7 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 					}
 					catch (Exception const& _e)
 					{
-						BOOST_ERROR("Failed transaction constructor with Exception: " << diagnostic_information(_e));
+						ETH_TEST_ERROR("Failed transaction constructor with Exception: " << diagnostic_information(_e));
 					}
 					catch (exception const& _e)
 					{
@@ -417,22 +416,22 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 					txsFromRlp.push_back(tx);
 				}
 
-				BOOST_CHECK_MESSAGE(txsFromRlp.size() == txsFromField.size(), "transaction list size does not match");
+				ETH_TEST_CHECK_MESSAGE(txsFromRlp.size() == txsFromField.size(), "transaction list size does not match");
 
 				for (size_t i = 0; i < txsFromField.size(); ++i)
 				{
-					BOOST_CHECK_MESSAGE(txsFromField[i].data() == txsFromRlp[i].data(), "transaction data in rlp and in field do not match");
-					BOOST_CHECK_MESSAGE(txsFromField[i].gas() == txsFromRlp[i].gas(), "transaction gasLimit in rlp and in field do not match");
-					BOOST_CHECK_MESSAGE(txsFromField[i].gasPrice() == txsFromRlp[i].gasPrice(), "transaction gasPrice in rlp and in field do not match");
-					BOOST_CHECK_MESSAGE(txsFromField[i].nonce() == txsFromRlp[i].nonce(), "transaction nonce in rlp and in field do not match");
-					BOOST_CHECK_MESSAGE(txsFromField[i].signature().r == txsFromRlp[i].signature().r, "transaction r in rlp and in field do not match");
-					BOOST_CHECK_MESSAGE(txsFromField[i].signature().s == txsFromRlp[i].signature().s, "transaction s in rlp and in field do not match");
-					BOOST_CHECK_MESSAGE(txsFromField[i].signature().v == txsFromRlp[i].signature().v, "transaction v in rlp and in field do not match");
-					BOOST_CHECK_MESSAGE(txsFromField[i].receiveAddress() == txsFromRlp[i].receiveAddress(), "transaction receiveAddress in rlp and in field do not match");
-					BOOST_CHECK_MESSAGE(txsFromField[i].value() == txsFromRlp[i].value(), "transaction receiveAddress in rlp and in field do not match");
-
-					BOOST_CHECK_MESSAGE(txsFromField[i] == txsFromRlp[i], "transactions from  rlp and transaction from field do not match");
-					BOOST_CHECK_MESSAGE(txsFromField[i].rlp() == txsFromRlp[i].rlp(), "transactions rlp do not match");
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i].data() == txsFromRlp[i].data(), "transaction data in rlp and in field do not match");
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i].gas() == txsFromRlp[i].gas(), "transaction gasLimit in rlp and in field do not match");
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i].gasPrice() == txsFromRlp[i].gasPrice(), "transaction gasPrice in rlp and in field do not match");
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i].nonce() == txsFromRlp[i].nonce(), "transaction nonce in rlp and in field do not match");
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i].signature().r == txsFromRlp[i].signature().r, "transaction r in rlp and in field do not match");
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i].signature().s == txsFromRlp[i].signature().s, "transaction s in rlp and in field do not match");
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i].signature().v == txsFromRlp[i].signature().v, "transaction v in rlp and in field do not match");
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i].receiveAddress() == txsFromRlp[i].receiveAddress(), "transaction receiveAddress in rlp and in field do not match");
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i].value() == txsFromRlp[i].value(), "transaction receiveAddress in rlp and in field do not match");
+
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i] == txsFromRlp[i], "transactions from  rlp and transaction from field do not match");
+					ETH_TEST_CHECK_MESSAGE(txsFromField[i].rlp() == txsFromRlp[i].rlp(), "transactions rlp do not match");
 				}
 
 				// check uncle list
@@ -443,7 +442,7 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 					for (auto const& uBlHeaderObj: blObj["uncleHeaders"].get_array())
 					{
 						mObject uBlH = uBlHeaderObj.get_obj();
-						BOOST_REQUIRE(uBlH.size() == 16);
+						ETH_TEST_REQUIRE(uBlH.size() == 16);
 						bytes uncleRLP = createBlockRLPFromFields(uBlH);
 						const RLP c_uRLP(uncleRLP);
 						BlockInfo uncleBlockHeader;
@@ -453,7 +452,7 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 						}
 						catch(...)
 						{
-							BOOST_ERROR("invalid uncle header");
+							ETH_TEST_ERROR("invalid uncle header");
 						}
 						uBlHsFromField.push_back(uncleBlockHeader);
 					}
@@ -467,10 +466,10 @@ void doBlockchainTests(json_spirit::mValue& _v, bool _fillin)
 					uBlHsFromRlp.push_back(uBl);
 				}
 
-				BOOST_REQUIRE_EQUAL(uBlHsFromField.size(), uBlHsFromRlp.size());
+				ETH_TEST_REQUIRE_EQUAL(uBlHsFromField.size(), uBlHsFromRlp.size());
 
 				for (size_t i = 0; i < uBlHsFromField.size(); ++i)
-					BOOST_CHECK_MESSAGE(uBlHsFromField[i] == uBlHsFromRlp[i], "block header in rlp and in field do not match");
+					ETH_TEST_CHECK_MESSAGE(uBlHsFromField[i] == uBlHsFromRlp[i], "block header in rlp and in field do not match");
 			}
 		}
 	}
@@ -585,6 +584,7 @@ void overwriteBlockHeader(BlockInfo& _currentBlockHeader, mObject& _blObj)
 		if (tmp != _currentBlockHeader)
 		{
 			_currentBlockHeader = tmp;
+			_currentBlockHeader.noteDirty();
 
 			ProofOfWork pow;
 			std::pair<MineInfo, Ethash::Proof> ret;
@@ -620,17 +620,18 @@ BlockInfo constructBlock(mObject& _o)
 	}
 	catch (std::exception const& _e)
 	{
-		BOOST_ERROR("Failed block population with Exception: " << _e.what());
+		ETH_TEST_ERROR("Failed block population with Exception: " << _e.what());
 	}
 	catch(...)
 	{
-		BOOST_ERROR("block population did throw an unknown exception\n");
+		ETH_TEST_ERROR("block population did throw an unknown exception\n");
 	}
 	return ret;
 }
 
 void updatePoW(BlockInfo& _bi)
 {
+	_bi.noteDirty();
 	ProofOfWork pow;
 	std::pair<MineInfo, Ethash::Proof> ret;
 	while (!ProofOfWork::verify(_bi))
@@ -680,37 +681,45 @@ BOOST_AUTO_TEST_SUITE(BlockChainTests)
 
 BOOST_AUTO_TEST_CASE(bcForkBlockTest)
 {
-	dev::test::executeTests("bcForkBlockTest", "/BlockTests", dev::test::doBlockchainTests);
+	dev::test::executeTests("bcForkBlockTest", "/BlockTests", dev::test::doBlockchainTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(bcInvalidRLPTest)
 {
-	dev::test::executeTests("bcInvalidRLPTest", "/BlockTests", dev::test::doBlockchainTests);
+	dev::test::executeTests("bcInvalidRLPTest", "/BlockTests", dev::test::doBlockchainTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(bcJS_API_Test)
 {
-	dev::test::executeTests("bcJS_API_Test", "/BlockTests", dev::test::doBlockchainTests);
+	dev::test::executeTests("bcJS_API_Test", "/BlockTests", dev::test::doBlockchainTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(bcValidBlockTest)
 {
-	dev::test::executeTests("bcValidBlockTest", "/BlockTests", dev::test::doBlockchainTests);
+	dev::test::executeTests("bcValidBlockTest", "/BlockTests", dev::test::doBlockchainTests, true);
+}
+
+BOOST_AUTO_TEST_CASE(bcParallelImportTest)
+{
+	ParallelExecutor::setThreads(4);
+	dev::test::executeTests("bcJS_API_Test", "/BlockTests", dev::test::doBlockchainTests, true);
+	dev::test::executeTests("bcValidBlockTest", "/BlockTests", dev::test::doBlockchainTests, true);
+	ParallelExecutor::setThreads(1);
 }
 
 BOOST_AUTO_TEST_CASE(bcInvalidHeaderTest)
 {
-	dev::test::executeTests("bcInvalidHeaderTest", "/BlockTests", dev::test::doBlockchainTests);
+	dev::test::executeTests("bcInvalidHeaderTest", "/BlockTests", dev::test::doBlockchainTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(bcUncleTest)
 {
-	dev::test::executeTests("bcUncleTest", "/BlockTests", dev::test::doBlockchainTests);
+	dev::test::executeTests("bcUncleTest", "/BlockTests", dev::test::doBlockchainTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(bcUncleHeaderValiditiy)
 {
-	dev::test::executeTests("bcUncleHeaderValiditiy", "/BlockTests", dev::test::doBlockchainTests);
+	dev::test::executeTests("bcUncleHeaderValiditiy", "/BlockTests", dev::test::doBlockchainTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(userDefinedFile)
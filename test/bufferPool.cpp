@@ -0,0 +1,63 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file bufferPool.cpp
+ * @date 2015
+ * BufferPool test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libp2p/BufferPool.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::p2p;
+
+BOOST_AUTO_TEST_SUITE(BufferPoolTests)
+
+BOOST_AUTO_TEST_CASE(bufferPoolReuse)
+{
+	BufferPool pool;
+	byte const* first;
+	{
+		auto b = pool.borrow(3000);
+		BOOST_REQUIRE(b);
+		BOOST_CHECK_EQUAL(b.ref().size(), 3000u);
+		BOOST_CHECK_EQUAL(pool.lent(), 4096u);
+		first = b.ref().data();
+	}
+	BOOST_CHECK_EQUAL(pool.lent(), 0u);
+	// The same size class comes back from the free list.
+	auto b = pool.borrow(4000);
+	BOOST_CHECK(b.ref().data() == first);
+	b.release();
+	BOOST_CHECK_EQUAL(pool.lent(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(bufferPoolLimit)
+{
+	BufferPool pool;
+	// With nothing lent, even a buffer over the limit is lent.
+	auto a = pool.borrow(8192, 4096);
+	BOOST_REQUIRE(a);
+	BOOST_CHECK(!pool.borrow(1024, 8192));
+	auto b = pool.borrow(1024, 8192 + 1024);
+	BOOST_CHECK(b);
+	a.release();
+	BOOST_CHECK(pool.borrow(1024, 4096));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
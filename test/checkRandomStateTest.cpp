@@ -52,7 +52,7 @@ int main(int argc, char *argv[])
 			cout << "Content of argument is empty\n";
 			return 1;
 		}
-		read_string(s, v);
+		dev::test::readJson(s, v);
 		ret = doStateTest(v);
 	}
 	catch (Exception const& _e)
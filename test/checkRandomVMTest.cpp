@@ -51,7 +51,7 @@ int main(int argc, char *argv[])
 			cout << "Content of argument is empty\n";
 			return 1;
 		}
-		read_string(s, v);
+		dev::test::readJson(s, v);
 		ret = doVMTest(v);
 	}
 	catch (Exception const& _e)
@@ -85,10 +85,10 @@ bool doVMTest(mValue& _v)
 		fev.importState(o["pre"].get_obj());
 
 		fev.importExec(o["exec"].get_obj());
-		if (fev.code.empty())
+		if (fev.code->empty())
 		{
 			fev.thisTxCode = get<3>(fev.addresses.at(fev.myAddress));
-			fev.code = fev.thisTxCode;
+			fev.code = make_shared<bytes const>(fev.thisTxCode);
 		}
 
 		bytes output;
@@ -0,0 +1,59 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file cpuFeatures.cpp
+ * @date 2015
+ * CPU feature detection and kernel dispatch test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/CpuFeatures.h>
+
+using namespace std;
+using namespace dev;
+
+static int one() { return 1; }
+static int two() { return 2; }
+
+BOOST_AUTO_TEST_SUITE(CpuFeaturesTests)
+
+BOOST_AUTO_TEST_CASE(cpuDispatchPicksFirstSupported)
+{
+	unsigned have = cpuFeatures();
+	unsigned missing = ~have & (CpuSSSE3 | CpuSSE41 | CpuAVX2 | CpuAVX512F | CpuSHA | CpuNEON | CpuSHA2);
+	BOOST_REQUIRE(missing);
+	unsigned oneMissing = missing & -missing;
+
+	CpuDispatch<int(*)()> unsupported("test_unsupported", {{ "missing", oneMissing, one }, { "portable", 0, two }});
+	BOOST_CHECK_EQUAL(unsupported()(), 2);
+	BOOST_CHECK_EQUAL(string(unsupported.name()), "portable");
+
+	CpuDispatch<int(*)()> supported("test_supported", {{ "present", have, one }, { "portable", 0, two }});
+	BOOST_CHECK_EQUAL(supported()(), 1);
+
+	auto kernels = cpuKernels();
+	BOOST_CHECK_EQUAL(kernels["test_unsupported"], "portable");
+	BOOST_CHECK_EQUAL(kernels["test_supported"], "present");
+	BOOST_CHECK(kernels.count("sha256"));
+}
+
+BOOST_AUTO_TEST_CASE(cpuFeatureNamesOfMask)
+{
+	BOOST_CHECK_EQUAL(cpuFeatureNames(0), "");
+	BOOST_CHECK_EQUAL(cpuFeatureNames(CpuSSE41 | CpuAVX2), "sse4.1 avx2");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -144,7 +144,7 @@ int main(int argc, char *argv[])
 	}
 )";
 	mValue v;
-	read_string(s, v);
+	dev::test::readJson(s, v);
 
 	// insert new random code
 	v.get_obj().find("randomStatetest")->second.get_obj().find("pre")->second.get_obj().begin()->second.get_obj()["code"] = "0x" + randomCode + (randGen() > 128 ? "55" : "") + (randGen() > 128 ? "60005155" : "");
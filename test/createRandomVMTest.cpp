@@ -113,7 +113,7 @@ int main(int argc, char *argv[])
 }";
 
 	mValue v;
-	read_string(s, v);
+	dev::test::readJson(s, v);
 
 	// insert new random code
 	v.get_obj().find("randomVMtest")->second.get_obj().find("pre")->second.get_obj().begin()->second.get_obj()["code"] = "0x" + randomCode + (randGen() > 128 ? "55" : "");
@@ -147,10 +147,10 @@ void doMyTests(json_spirit::mValue& _v)
 		o["pre"] = mValue(fev.exportState());
 
 		fev.importExec(o["exec"].get_obj());
-		if (fev.code.empty())
+		if (fev.code->empty())
 		{
 			fev.thisTxCode = get<3>(fev.addresses.at(fev.myAddress));
-			fev.code = fev.thisTxCode;
+			fev.code = make_shared<bytes const>(fev.thisTxCode);
 		}
 
 		bytes output;
@@ -22,15 +22,19 @@
  */
 
 #include <random>
+#include <chrono>
 #include <secp256k1/secp256k1.h>
 #include <libdevcore/Common.h>
 #include <libdevcore/RLP.h>
 #include <libdevcore/Log.h>
 #include <libethereum/Transaction.h>
+#include <libethereum/Precompiled.h>
 #include <boost/test/unit_test.hpp>
 #include <libdevcrypto/SHA3.h>
+#include <libdevcrypto/SHA256.h>
 #include <libdevcrypto/ECDHE.h>
 #include <libdevcrypto/CryptoPP.h>
+#include "TestHelper.h"
 
 using namespace std;
 using namespace dev;
@@ -229,6 +233,39 @@ BOOST_AUTO_TEST_CASE(cryptopp_ecdsa_sipaseckp256k1)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(sign_recover_verify)
+{
+	// dev::sign, recover and verify, and KeyPair's public keys, agree with Crypto++ whichever backend they were built with; with
+	// --performance, the recoveries, which cap how fast transactions come in, are timed.
+	unsigned n = test::Options::get().performance ? 1000 : 16;
+	chrono::high_resolution_clock::duration devTime{};
+	chrono::high_resolution_clock::duration cryptoppTime{};
+	for (unsigned i = 0; i < n; ++i)
+	{
+		KeyPair key(sha3(toBigEndian(u256(i))));
+		Public cryptoppPublic;
+		s_secp256k1.toPublic(key.sec(), cryptoppPublic);
+		BOOST_REQUIRE(key.pub() == cryptoppPublic);
+		h256 hash = sha3(key.sec());
+		Signature sig = dev::sign(key.sec(), hash);
+		Signature cryptoppSig = s_secp256k1.sign(key.sec(), hash);
+		BOOST_REQUIRE(dev::verify(key.pub(), sig, hash));
+		BOOST_REQUIRE(dev::verify(key.pub(), cryptoppSig, hash));
+
+		auto start = chrono::high_resolution_clock::now();
+		Public recovered = dev::recover(cryptoppSig, hash);
+		auto mid = chrono::high_resolution_clock::now();
+		Public cryptoppRecovered = s_secp256k1.recover(sig, hash.ref());
+		cryptoppTime += chrono::high_resolution_clock::now() - mid;
+		devTime += mid - start;
+		BOOST_REQUIRE(recovered == key.pub());
+		BOOST_REQUIRE(cryptoppRecovered == key.pub());
+	}
+
+	if (test::Options::get().performance)
+		cnote << "Recovering a key:" << chrono::duration_cast<chrono::microseconds>(devTime).count() / n << "us, with Crypto++" << chrono::duration_cast<chrono::microseconds>(cryptoppTime).count() / n << "us";
+}
+
 BOOST_AUTO_TEST_CASE(sha3_norestart)
 {
 	CryptoPP::SHA3_256 ctx;
@@ -260,6 +297,79 @@ BOOST_AUTO_TEST_CASE(sha3_norestart)
 	BOOST_REQUIRE(finalDigest2 != finalDigest3);
 }
 
+BOOST_AUTO_TEST_CASE(sha3_keccak)
+{
+	// Either side of the 136-byte block, and several blocks, one at a time and several at once.
+	bytes data(700);
+	for (unsigned i = 0; i < data.size(); ++i)
+		data[i] = (byte)(i * 7 + 3);
+	vector<bytesConstRef> inputs;
+	for (unsigned n = 0; n < data.size(); n += n < 300 ? 1 : 37)
+		inputs.push_back(bytesConstRef(data.data(), n));
+	vector<h256> hashes(inputs.size());
+	sha3(inputs.data(), hashes.data(), inputs.size());
+	for (unsigned i = 0; i < inputs.size(); ++i)
+	{
+		CryptoPP::SHA3_256 ctx;
+		ctx.Update(inputs[i].data(), inputs[i].size());
+		h256 expected;
+		ctx.Final(expected.data());
+		BOOST_REQUIRE_EQUAL(sha3(inputs[i]), expected);
+		BOOST_REQUIRE_EQUAL(hashes[i], expected);
+	}
+	BOOST_CHECK_EQUAL(sha3(bytesConstRef()), h256("c5d2460186f7233c927e7db2dcc703c0e500b653ca82273b7bfad8045d85a470"));
+}
+
+BOOST_AUTO_TEST_CASE(sha256_native)
+{
+	// Either side of the padding's spill into a second block, whichever path this CPU takes.
+	bytes data(300);
+	for (unsigned i = 0; i < data.size(); ++i)
+		data[i] = (byte)(i * 5 + 1);
+	for (unsigned n = 0; n < data.size(); ++n)
+	{
+		bytesConstRef in(data.data(), n);
+		CryptoPP::SHA256 ctx;
+		ctx.Update(in.data(), in.size());
+		h256 expected;
+		ctx.Final(expected.data());
+		h256 native;
+		h256 portable;
+		sha256(in, native.data());
+		sha256Portable(in, portable.data());
+		BOOST_REQUIRE_EQUAL(native, expected);
+		BOOST_REQUIRE_EQUAL(portable, expected);
+	}
+	h256 abc;
+	sha256(bytesConstRef("abc"), abc.data());
+	BOOST_CHECK_EQUAL(abc, h256("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+}
+
+BOOST_AUTO_TEST_CASE(precompiled_registry)
+{
+	eth::PrecompiledRegistry& r = eth::PrecompiledRegistry::get();
+	BOOST_REQUIRE(r.find(Address(1)));
+	BOOST_CHECK(!r.find(Address()));
+	BOOST_CHECK(!r.find(Address(0x101)));
+	BOOST_CHECK(!r.find(Address(0xfe)));
+
+	// ecrecover gives back the signer's address, right-aligned.
+	bytes in = fromHex(
+		"18c547e4f7b0f325ad1e56f57e26c745b09a3e503d86e00e5255ff7f715d3d1c"
+		"000000000000000000000000000000000000000000000000000000000000001c"
+		"73b1693892219d736caba55bdb67216e485557ea6b6af75f37096c9aa6a5a75f"
+		"eeb940b1d03b21e36b0e47e79769f095fe2ab855bd91e3a38756b7d75a9c4549");
+	SmallBytes out;
+	r.find(Address(1))->exec(&in, out);
+	BOOST_CHECK_EQUAL(toHex(out.ref()), "000000000000000000000000a94f5374fce5edbc8e2a8697c15331677e6ebf0b");
+
+	r.add(0xfe, { [](bytesConstRef) -> bigint { return 1; }, [](bytesConstRef _in, SmallBytes& o_out) { o_out.assign(_in); } });
+	BOOST_REQUIRE(r.find(Address(0xfe)));
+	BOOST_CHECK_EQUAL(r.find(Address(0xfe))->gas(bytesConstRef()), 1);
+	r.remove(0xfe);
+	BOOST_CHECK(!r.find(Address(0xfe)));
+}
+
 BOOST_AUTO_TEST_CASE(ecies_kdf)
 {
 	KeyPair local = KeyPair::create();
@@ -305,6 +415,26 @@ BOOST_AUTO_TEST_CASE(ecies_standard)
 	BOOST_REQUIRE(bytesConstRef(&b).cropped(0, original.size()).toBytes() == asBytes(original));
 }
 
+BOOST_AUTO_TEST_CASE(ecies_many_recipients)
+{
+	vector<KeyPair> keys{KeyPair::create(), KeyPair::create(), KeyPair::create()};
+	vector<Public> pubs;
+	for (auto const& k: keys)
+		pubs.push_back(k.pub());
+	bytes original = asBytes("Now is the time for all good persons to come to the aid of humanity.");
+
+	vector<bytes> ciphers;
+	encryptECIES(pubs, &original, ciphers);
+	BOOST_REQUIRE_EQUAL(ciphers.size(), keys.size());
+	for (unsigned i = 0; i < keys.size(); ++i)
+	{
+		bytes plain;
+		BOOST_REQUIRE(decryptECIES(keys[i].sec(), &ciphers[i], plain));
+		BOOST_CHECK(plain == original);
+		BOOST_CHECK(!decryptECIES(keys[(i + 1) % keys.size()].sec(), &ciphers[i], plain));
+	}
+}
+
 BOOST_AUTO_TEST_CASE(ecies_eckeypair)
 {
 	KeyPair k = KeyPair::create();
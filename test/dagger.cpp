@@ -64,7 +64,7 @@ BOOST_AUTO_TEST_CASE(basic_test)
 		unsigned cacheSize(o["cache_size"].get_int());
 		h256 cacheHash(o["cache_hash"].get_str());
 		BOOST_REQUIRE_EQUAL(Ethasher::get()->params(header).cache_size, cacheSize);
-		BOOST_REQUIRE_EQUAL(sha3(bytesConstRef((byte const*)Ethasher::get()->light(header), cacheSize)), cacheHash);
+		BOOST_REQUIRE_EQUAL(sha3(bytesConstRef((byte const*)Ethasher::get()->light(header).get(), cacheSize)), cacheHash);
 
 #if TEST_FULL
 		unsigned fullSize(o["full_size"].get_int());
@@ -80,6 +80,77 @@ BOOST_AUTO_TEST_CASE(basic_test)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(parallel_full_data)
+{
+	// A small dataset, of a few chunks, computed across threads comes out as when computed serially.
+	ethash_params p;
+	p.cache_size = 64 * 1024;
+	p.full_size = 4 * 1024 * 1024 + 128;
+	h256 seed = sha3("seed");
+	ethash_light_t light = ethash_new_light(&p, seed.data());
+	bytes serial(p.full_size);
+	ethash_compute_full_data(serial.data(), &p, light);
+	bytes parallel(p.full_size);
+	unsigned last = 0;
+	Ethasher::computeFull(parallel.data(), p, light, 3, [&](unsigned _p){ BOOST_CHECK(_p >= last); last = _p; });
+	ethash_delete_light(light);
+	BOOST_CHECK_EQUAL(last, 100u);
+	BOOST_CHECK(serial == parallel);
+}
+
+BOOST_AUTO_TEST_CASE(light_and_full_verification)
+{
+	// Evaluating against the full data gives what the light cache does; with --performance, the two are timed.
+	ethash_params p;
+	p.cache_size = 1024 * 1024;
+	p.full_size = 32 * 1024 * 1024;
+	h256 seed = sha3("seed");
+	h256 headerHash = sha3("header");
+	ethash_light_t light = ethash_new_light(&p, seed.data());
+	bytes full(p.full_size);
+	Ethasher::computeFull(full.data(), p, light);
+
+	unsigned n = test::Options::get().performance ? 1000 : 16;
+	ethash_return_value l;
+	ethash_return_value f;
+	chrono::high_resolution_clock::duration lightTime{};
+	chrono::high_resolution_clock::duration fullTime{};
+	for (unsigned i = 0; i < n; ++i)
+	{
+		auto start = chrono::high_resolution_clock::now();
+		ethash_compute_light(&l, light, &p, headerHash.data(), i);
+		auto mid = chrono::high_resolution_clock::now();
+		ethash_compute_full(&f, full.data(), &p, headerHash.data(), i);
+		fullTime += chrono::high_resolution_clock::now() - mid;
+		lightTime += mid - start;
+		BOOST_REQUIRE(h256(l.result, h256::ConstructFromPointer) == h256(f.result, h256::ConstructFromPointer));
+		BOOST_REQUIRE(h256(l.mix_hash, h256::ConstructFromPointer) == h256(f.mix_hash, h256::ConstructFromPointer));
+	}
+	ethash_delete_light(light);
+
+	if (test::Options::get().performance)
+		cnote << "Verifying a block: light" << chrono::duration_cast<chrono::microseconds>(lightTime).count() / n << "us, full" << chrono::duration_cast<chrono::microseconds>(fullTime).count() / n << "us";
+}
+
+BOOST_AUTO_TEST_CASE(header_hashes_cached)
+{
+	BlockInfo header;
+	header.clear();
+	header.number = 2 * 30000 + 1;
+	header.difficulty = 131072;
+	BOOST_CHECK_EQUAL(header.seedHash(), sha3(sha3(h256())));
+
+	// Copies keep what was worked out; a change noted dirty is hashed again.
+	h256 sealHash = header.headerHash(WithoutNonce);
+	BlockInfo copy = header;
+	copy.nonce = Nonce(u64(42));
+	BOOST_CHECK_EQUAL(copy.headerHash(WithoutNonce), sealHash);
+	copy.timestamp += 1;
+	copy.noteDirty();
+	BOOST_CHECK(copy.headerHash(WithoutNonce) != sealHash);
+	BOOST_CHECK_EQUAL(copy.headerHash(WithoutNonce), sha3(rlpExact([&](RLPStream& _s){ copy.streamRLP(_s, WithoutNonce); })));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 
@@ -0,0 +1,277 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file diffRandomVMTest.cpp
+ * @date 2015
+ * Runs random programs, or the VM tests given, on every kind of VM built in, checks that they all agree with the
+ * interpreter on the outcome and reports how much faster than it each of them is.
+ * Returns 1 if any of them disagreed.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <boost/random.hpp>
+
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+#include <json_spirit/json_spirit.h>
+#include <json_spirit/json_spirit_writer_template.h>
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/CommonData.h>
+#include <libevmcore/Instruction.h>
+#include <libevm/VMFactory.h>
+#include "vm.h"
+
+using namespace std;
+using namespace json_spirit;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+/// The VMs compared; the first is the reference.
+vector<pair<VMKind, char const*>> const c_kinds =
+{
+	{ VMKind::Interpreter, "interpreter" },
+	{ VMKind::Threaded, "threaded" },
+#if ETH_EVMJIT
+	{ VMKind::JIT, "jit" },
+	{ VMKind::Adaptive, "adaptive" },
+#endif
+};
+
+/// What a run of a program comes to, all of which must be the same whatever the VM.
+struct Outcome
+{
+	bool exception = false;
+	bytes output;
+	u256 gas;
+	string post;
+	string logs;
+	string callCreates;
+
+	bool operator==(Outcome const& _o) const
+	{
+		return exception == _o.exception && output == _o.output && gas == _o.gas && post == _o.post && logs == _o.logs && callCreates == _o.callCreates;
+	}
+	bool operator!=(Outcome const& _o) const { return !operator==(_o); }
+};
+
+ostream& operator<<(ostream& _out, Outcome const& _o)
+{
+	if (_o.exception)
+		return _out << "exception";
+	return _out << "out 0x" << toHex(_o.output) << ", gas " << _o.gas << ", post " << _o.post << ", logs " << _o.logs << ", callcreates " << _o.callCreates;
+}
+
+/// Runs the test @a _test on a fresh VM of kind @a _kind, adding the time spent in the VM to @a io_time.
+Outcome run(mObject _test, VMKind _kind, chrono::nanoseconds& io_time)
+{
+	test::FakeExtVM fev;
+	fev.importEnv(_test["env"].get_obj());
+	fev.importState(_test["pre"].get_obj());
+	fev.importExec(_test["exec"].get_obj());
+	if (fev.code->empty())
+	{
+		fev.thisTxCode = get<3>(fev.addresses.at(fev.myAddress));
+		fev.code = make_shared<bytes const>(fev.thisTxCode);
+	}
+
+	Outcome ret;
+	auto vm = VMFactory::create(_kind, fev.gas);
+	auto start = chrono::steady_clock::now();
+	try
+	{
+		// No tracing, which would keep the VMs off their fast paths.
+		ret.output = vm->go(fev, OnOpFunc()).toBytes();
+		ret.gas = vm->gas();
+	}
+	catch (VMException const&)
+	{
+		ret.exception = true;
+	}
+	io_time += chrono::steady_clock::now() - start;
+	if (ret.exception)
+		return ret;
+
+	// Storage set to zero is as good as none.
+	for (auto& a: fev.addresses)
+		for (auto it = get<2>(a.second).begin(); it != get<2>(a.second).end();)
+			it = it->second ? next(it) : get<2>(a.second).erase(it);
+	ret.post = write_string(mValue(fev.exportState()), false);
+	ret.logs = write_string(mValue(test::exportLog(fev.sub.logs)), false);
+	ret.callCreates = write_string(mValue(fev.exportCallCreates()), false);
+	return ret;
+}
+
+/// @returns a test running random code of up to @a _maxLength instructions, mostly valid ones, with small pushes
+/// so that some jumps land.
+mObject randomTest(boost::random::mt19937& _gen, unsigned _maxLength)
+{
+	boost::random::uniform_int_distribution<> lengthDist(2, _maxLength);
+	boost::random::uniform_int_distribution<> byteDist(0, 255);
+	bytes code;
+	for (int i = lengthDist(_gen); i > 0; --i)
+	{
+		auto inst = Instruction(byteDist(_gen));
+		if (!isValidInstruction(inst) && byteDist(_gen) < 250)
+			inst = byteDist(_gen) < 128 ? Instruction::PUSH1 : Instruction::DUP1;
+		code.push_back(byte(inst));
+		if (inst >= Instruction::PUSH1 && inst <= Instruction::PUSH32)
+			for (unsigned j = 0; j <= unsigned(inst) - unsigned(Instruction::PUSH1); ++j)
+				code.push_back(byte(j == 0 ? byteDist(_gen) % max<size_t>(code.size(), 1) : byteDist(_gen)));
+	}
+
+	mObject env;
+	env["previousHash"] = "5e20a0453cecd065ea59c37ac63e079ee08998b6045136a8ce6635c7912ec0b6";
+	env["currentNumber"] = "300";
+	env["currentGasLimit"] = "1000000";
+	env["currentDifficulty"] = "256";
+	env["currentTimestamp"] = "2";
+	env["currentCoinbase"] = "2adc25665018aa1fe0e6bc666dac8fc2697ff9ba";
+	mObject account;
+	account["balance"] = "1000000000000000000";
+	account["nonce"] = "0";
+	account["code"] = "0x" + toHex(code);
+	account["storage"] = mObject();
+	mObject pre;
+	pre["0f572e5295c57f15886f9b263e2f6d2d6c7b5ec6"] = account;
+	mObject exec;
+	exec["address"] = "0f572e5295c57f15886f9b263e2f6d2d6c7b5ec6";
+	exec["origin"] = "cd1722f3947def4cf144679da39c4c32bdc35681";
+	exec["caller"] = "cd1722f3947def4cf144679da39c4c32bdc35681";
+	exec["value"] = "1000000000000000000";
+	exec["data"] = "";
+	exec["gasPrice"] = "100000000000000";
+	exec["gas"] = "100000";
+	mObject ret;
+	ret["env"] = env;
+	ret["pre"] = pre;
+	ret["exec"] = exec;
+	return ret;
+}
+
+double percentile(vector<double> _values, double _p)
+{
+	if (_values.empty())
+		return 0;
+	sort(_values.begin(), _values.end());
+	return _values[size_t(_p * (_values.size() - 1))];
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+	g_logVerbosity = 0;
+	unsigned programs = 1000;
+	unsigned maxLength = 64;
+	unsigned repeats = 5;
+	unsigned seed = unsigned(chrono::steady_clock::now().time_since_epoch().count());
+	vector<string> files;
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			programs = atoi(argv[++i]);
+		else if (arg == "-l" && i + 1 < argc)
+			maxLength = max(2, atoi(argv[++i]));
+		else if (arg == "-r" && i + 1 < argc)
+			repeats = max(1, atoi(argv[++i]));
+		else if (arg == "-s" && i + 1 < argc)
+			seed = atoi(argv[++i]);
+		else if (arg == "-h" || arg == "--help")
+		{
+			cout << "Usage: " << argv[0] << " [-n <programs>] [-l <max instructions>] [-r <timed runs>] [-s <seed>] [<VM test file>...]" << endl
+				<< "Runs random programs, or the tests of the files given, on each VM and compares them with the interpreter." << endl
+				<< "The JIT's optimization tier is set as usual through EVMJIT, e.g. EVMJIT=\"-O\" or EVMJIT=\"-promote=2\"." << endl;
+			return 0;
+		}
+		else
+			files.push_back(arg);
+	}
+
+	vector<pair<string, mObject>> tests;
+	if (files.empty())
+	{
+		cout << "Seed " << seed << endl;
+		boost::random::mt19937 gen(seed);
+		for (unsigned i = 0; i < programs; ++i)
+			tests.emplace_back("random" + toString(i), randomTest(gen, maxLength));
+	}
+	for (auto const& f: files)
+	{
+		mValue v;
+		test::readJson(contentsString(f), v);
+		for (auto& t: v.get_obj())
+			tests.emplace_back(f + ":" + t.first, t.second.get_obj());
+	}
+
+	map<VMKind, vector<double>> speedups;
+	map<VMKind, unsigned> mismatches;
+	for (auto& t: tests)
+	{
+		vector<chrono::nanoseconds> best;
+		Outcome reference;
+		for (auto const& kind: c_kinds)
+		{
+			// The first run checks the outcome and, for the JIT, compiles; the rest are timed.
+			chrono::nanoseconds ignored(0);
+			Outcome outcome = run(t.second, kind.first, ignored);
+			if (kind.first == c_kinds.front().first)
+				reference = outcome;
+			else if (outcome != reference)
+			{
+				++mismatches[kind.first];
+				cout << t.first << ": " << kind.second << " differs from " << c_kinds.front().second << endl
+					<< "  code: " << t.second["pre"].get_obj().begin()->second.get_obj()["code"].get_str() << endl
+					<< "  " << c_kinds.front().second << ": " << reference << endl
+					<< "  " << kind.second << ": " << outcome << endl;
+			}
+			chrono::nanoseconds fastest = chrono::nanoseconds::max();
+			for (unsigned r = 0; r < repeats; ++r)
+			{
+				chrono::nanoseconds time(0);
+				run(t.second, kind.first, time);
+				fastest = min(fastest, time);
+			}
+			best.push_back(fastest);
+		}
+		for (size_t k = 1; k < c_kinds.size(); ++k)
+			speedups[c_kinds[k].first].push_back(double(best[0].count()) / max<int64_t>(best[k].count(), 1));
+	}
+
+	cout << tests.size() << " programs; speedup over the " << c_kinds.front().second << ", fastest of " << repeats << " runs:" << endl;
+	cout << setw(12) << left << "vm" << setw(12) << right << "mismatches" << setw(8) << "min" << setw(8) << "p10" << setw(8) << "median" << setw(8) << "p90" << setw(8) << "max" << endl;
+	bool ok = true;
+	for (size_t k = 1; k < c_kinds.size(); ++k)
+	{
+		auto const& s = speedups[c_kinds[k].first];
+		cout << setw(12) << left << c_kinds[k].second << setw(12) << right << mismatches[c_kinds[k].first] << fixed << setprecision(2);
+		for (double p: { 0.0, 0.1, 0.5, 0.9, 1.0 })
+			cout << setw(8) << percentile(s, p);
+		cout << endl;
+		ok = ok && !mismatches[c_kinds[k].first];
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file extras.cpp
+ * @date 2015
+ * Tests of the compact form of the block chain's extras.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libethereum/BlockDetails.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+BlockReceipts someReceipts()
+{
+	BlockReceipts ret;
+	ret.receipts.push_back(TransactionReceipt(h256(u256(1)), 21000, LogEntries()));
+	ret.receipts.push_back(TransactionReceipt(h256(u256(2)), u256(1) << 70, LogEntries{LogEntry(Address(7), {h256(u256(8)), h256(u256(9))}, bytes(40, 3))}));
+	LogEntries many;
+	for (unsigned i = 0; i < 100; ++i)
+		many.push_back(LogEntry(Address(i), {h256(u256(i))}, bytes()));
+	ret.receipts.push_back(TransactionReceipt(h256(u256(3)), 4000000, many));
+	return ret;
+}
+
+void checkSame(TransactionReceipt const& _a, TransactionReceipt const& _b)
+{
+	BOOST_CHECK(_a.rlp() == _b.rlp());
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ExtrasTests)
+
+BOOST_AUTO_TEST_CASE(compactDetails)
+{
+	BlockDetails d(123456, u256(1) << 200, h256(u256(5)), {h256(u256(6)), h256(u256(7))});
+	bytes c = d.compact();
+	BOOST_CHECK_EQUAL(c.size(), 69u + 64);
+	for (bytes const& b: {c, d.rlp()})
+	{
+		BlockDetails e = decodeExtra<BlockDetails>(&b);
+		BOOST_CHECK_EQUAL(e.number, d.number);
+		BOOST_CHECK(e.totalDifficulty == d.totalDifficulty);
+		BOOST_CHECK(e.parent == d.parent);
+		BOOST_CHECK(e.children == d.children);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(compactReceipts)
+{
+	BlockReceipts r = someReceipts();
+	bytes c = r.compact();
+	bytes l = r.rlp();
+	BOOST_CHECK_LT(c.size(), l.size());
+	for (bytes const& b: {c, l})
+	{
+		BlockReceipts s = decodeExtra<BlockReceipts>(&b);
+		BOOST_REQUIRE_EQUAL(s.receipts.size(), r.receipts.size());
+		for (unsigned i = 0; i < r.receipts.size(); ++i)
+		{
+			checkSame(s.receipts[i], r.receipts[i]);
+			checkSame(BlockReceipts::receiptAt(&b, i), r.receipts[i]);
+			BOOST_CHECK(s.receipts[i].bloom() == r.receipts[i].bloom());
+		}
+		BOOST_CHECK(BlockReceipts::receiptAt(&b, 3).stateRoot() == h256());
+	}
+	bytes none = BlockReceipts().compact();
+	BOOST_CHECK(decodeExtra<BlockReceipts>(&none).receipts.empty());
+}
+
+BOOST_AUTO_TEST_CASE(sparseBlooms)
+{
+	BlockLogBlooms b;
+	for (auto const& r: someReceipts().receipts)
+		b.blooms.push_back(r.bloom());
+	bytes c = b.compact();
+	// The version; the empty bloom takes a byte, the one of a log two bytes a bit, the full one its 256 bytes.
+	BOOST_CHECK_LE(c.size(), 1 + 1 + 1 + 2 * 9 + 1 + LogBloom::size);
+	for (bytes const& d: {c, b.rlp()})
+		BOOST_CHECK(decodeExtra<BlockLogBlooms>(&d).blooms == b.blooms);
+
+	BlocksBlooms bb;
+	bb.blooms[3] = b.blooms[1];
+	bb.blooms[15] = b.blooms[2];
+	for (bytes const& d: {bb.compact(), bb.rlp()})
+		BOOST_CHECK(decodeExtra<BlocksBlooms>(&d).blooms == bb.blooms);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
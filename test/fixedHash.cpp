@@ -0,0 +1,130 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file fixedHash.cpp
+ * @date 2015
+ * FixedHash and hex conversion test functions, timed with --performance.
+ */
+
+#include <chrono>
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/Exceptions.h>
+#include <libdevcore/Log.h>
+#include "TestHelper.h"
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+/// Runs @a _f @a _n times and @returns the nanoseconds each took.
+template <class F> double timed(unsigned _n, F const& _f)
+{
+	auto start = chrono::high_resolution_clock::now();
+	for (unsigned i = 0; i < _n; ++i)
+		_f(i);
+	return chrono::duration<double, nano>(chrono::high_resolution_clock::now() - start).count() / _n;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(FixedHashTests)
+
+BOOST_AUTO_TEST_CASE(fixedHashCompare)
+{
+	// The orders agree with those of the numbers, whichever byte the hashes first differ in.
+	for (unsigned i = 0; i < 256; ++i)
+	{
+		h256 a = h256::random();
+		h256 b = a;
+		b[i % 32] ^= byte(1 << (i / 32));
+		BOOST_CHECK_EQUAL(a < b, u256(a) < u256(b));
+		BOOST_CHECK_EQUAL(a <= b, u256(a) <= u256(b));
+		BOOST_CHECK_EQUAL(a > b, u256(a) > u256(b));
+		BOOST_CHECK(a != b && !(a == b) && a <= a && a >= a && !(a < a));
+		h160 c(a, h160::AlignRight);
+		h160 d(b, h160::AlignRight);
+		BOOST_CHECK_EQUAL(c < d, u160(c) < u160(d));
+	}
+	BOOST_CHECK(!h2048());
+	h2048 one;
+	one[255] = 1;
+	BOOST_CHECK(!!one);
+}
+
+BOOST_AUTO_TEST_CASE(fixedHashBloom)
+{
+	h2048 bloom;
+	h256s in;
+	for (unsigned i = 0; i < 20; ++i)
+	{
+		in.push_back(h256::random());
+		bloom.shiftBloom<3>(in.back());
+	}
+	for (h256 const& h: in)
+		BOOST_CHECK(bloom.containsBloom<3>(h));
+	BOOST_CHECK(bloom.contains(h2048()));
+	BOOST_CHECK(!h2048().contains(bloom));
+	h2048 other = bloom;
+	other[0] ^= 0x80;
+	BOOST_CHECK_EQUAL(bloom.contains(other), (bloom[0] & 0x80) != 0);
+}
+
+BOOST_AUTO_TEST_CASE(hexConversion)
+{
+	BOOST_CHECK_EQUAL(toHex(bytes{0x00, 0x0f, 0xa5, 0xff}), "000fa5ff");
+	BOOST_CHECK_EQUAL(toHex(bytes{0x1, 0x2}, 1), "102");
+	BOOST_CHECK(fromHex("0x000FA5ff") == (bytes{0x00, 0x0f, 0xa5, 0xff}));
+	BOOST_CHECK(fromHex("fff") == (bytes{0x0f, 0xff}));
+	BOOST_CHECK(fromHex("") == bytes());
+	BOOST_CHECK(fromHex("12zz34") == (bytes{0x12, 0x00, 0x34}));
+	BOOST_CHECK_THROW(fromHex("12zz34", WhenError::Throw), BadHexCharacter);
+	for (unsigned i = 0; i < 100; ++i)
+	{
+		h256 h = h256::random();
+		BOOST_CHECK(h256(toHex(h.ref())) == h);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(fixedHashPerformance)
+{
+	// With --performance, times the operations on hashes that maps, blooms and RPC lean on.
+	if (!test::Options::get().performance)
+		return;
+	unsigned const n = 1000000;
+	h256s hashes(1024);
+	for (auto& h: hashes)
+		h = h256::random();
+	h2048 bloom;
+	for (auto const& h: hashes)
+		bloom.shiftBloom<3>(h);
+	string hex = toHex(hashes[0].ref());
+
+	size_t sink = 0;
+	cnote << "h256 <:" << timed(n, [&](unsigned i) { sink += hashes[i % 1024] < hashes[(i + 1) % 1024]; }) << "ns";
+	cnote << "h256 ==:" << timed(n, [&](unsigned i) { sink += hashes[i % 1024] == hashes[(i + 1) % 1024]; }) << "ns";
+	cnote << "h256 bool:" << timed(n, [&](unsigned i) { sink += !!hashes[i % 1024]; }) << "ns";
+	cnote << "h2048 |=:" << timed(n, [&](unsigned i) { bloom |= h2048(hashes[i % 1024]); }) << "ns";
+	cnote << "h2048 contains:" << timed(n, [&](unsigned i) { sink += bloom.contains(h2048(hashes[i % 1024])); }) << "ns";
+	cnote << "h2048 containsBloom:" << timed(n, [&](unsigned i) { sink += bloom.containsBloom<3>(hashes[i % 1024]); }) << "ns";
+	cnote << "toHex(h256):" << timed(n, [&](unsigned i) { sink += toHex(hashes[i % 1024].ref()).size(); }) << "ns";
+	cnote << "fromHex(h256):" << timed(n, [&](unsigned) { sink += fromHex(hex).size(); }) << "ns";
+	BOOST_CHECK(sink);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file gasPricer.cpp
+ * @date 2015
+ * BasicGasPricer test functions.
+ */
+
+#include <ctime>
+#include <boost/test/unit_test.hpp>
+#include <libdevcrypto/KeyValueDB.h>
+#include <libethereum/CanonBlockChain.h>
+#include <libethereum/Client.h>
+#include <libethereum/State.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+/// Mines blocks of transfers at given gas prices onto an in-memory chain, a second apart from an hour ago.
+struct PricedChain
+{
+	PricedChain(): stateDB(State::openDB(c_memoryDBPath)), s(stateDB, BaseState::CanonGenesis, miner.address()) { s.sync(bc); }
+
+	void mine(vector<u256> const& _prices)
+	{
+		for (auto p: _prices)
+			s.execute(bc.lastHashes(), Transaction(1, p, c_txGas, Address(0x42), bytes(), s.transactionsFrom(miner.address()), miner.secret()));
+		s.commitToMine(bc);
+		s.completeMine();
+
+		// The proof of work is not valid, so it goes in as verified, with a timestamp that is not in the future.
+		bytes block = s.blockData();
+		RLP r(block);
+		BlockInfo bi(block, CheckNothing);
+		bi.timestamp = (u256)time(0) - 3600 + bc.number();
+		bi.difficulty = bi.calculateDifficulty(bc.info());
+		bi.noteDirty();
+		RLPStream out(3);
+		bi.streamRLP(out, WithNonce);
+		out.appendRaw(r[1].data()).appendRaw(r[2].data());
+		bc.import(out.out(), stateDB, Aversion::AvoidOldBlocks, true);
+		s.sync(bc);
+	}
+
+	KeyPair miner = KeyPair(sha3("gas pricer miner"));
+	CanonBlockChain bc{c_memoryDBPath};
+	OverlayDB stateDB;
+	State s;
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(GasPricerTests)
+
+BOOST_AUTO_TEST_CASE(basicGasPricerSlidesItsWindow)
+{
+	PricedChain c;
+	c.mine({});
+	c.mine({10, 20, 20});
+	c.mine({30});
+
+	BasicGasPricer gp(1, 1, 2);
+	gp.update(c.bc);
+	// Weighted by gas: 10, 20, 20, 30.
+	BOOST_CHECK_EQUAL(gp.bid(TransactionPriority::Lowest), 10);
+	BOOST_CHECK_EQUAL(gp.bid(TransactionPriority::Low), 10);
+	BOOST_CHECK_EQUAL(gp.bid(TransactionPriority::Medium), 20);
+	BOOST_CHECK_EQUAL(gp.bid(TransactionPriority::High), 20);
+	BOOST_CHECK_EQUAL(gp.bid(TransactionPriority::Highest), 30);
+
+	// The block of 10 and 20s leaves the window.
+	c.mine({40});
+	gp.update(c.bc);
+	BOOST_CHECK_EQUAL(gp.bid(TransactionPriority::Lowest), 30);
+	BOOST_CHECK_EQUAL(gp.bid(TransactionPriority::Highest), 40);
+
+	// Updating with nothing new changes nothing.
+	gp.update(c.bc);
+	BOOST_CHECK_EQUAL(gp.bid(TransactionPriority::Medium), 30);
+	BOOST_CHECK_EQUAL(gp.bid(TransactionPriority::Highest), 40);
+}
+
+BOOST_AUTO_TEST_CASE(basicGasPricerFallsBackWithoutTransactions)
+{
+	PricedChain c;
+	c.mine({});
+	BasicGasPricer gp(3141592, 5, 10);
+	gp.update(c.bc);
+	BOOST_CHECK_EQUAL(gp.bid(), 3141592 * 5 / c.bc.info().gasLimit);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
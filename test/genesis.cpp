@@ -28,6 +28,7 @@
 #include "JsonSpiritHeaders.h"
 #include <libdevcore/CommonIO.h>
 #include <libethereum/CanonBlockChain.h>
+#include <libethereum/State.h>
 #include "TestHelper.h"
 
 using namespace std;
@@ -65,5 +66,16 @@ BOOST_AUTO_TEST_CASE(genesis_tests)
 	BOOST_CHECK_EQUAL(BlockInfo::headerHash(CanonBlockChain::createGenesisBlock()), h256(o["genesis_hash"].get_str()));
 }
 
+BOOST_AUTO_TEST_CASE(genesisStateReused)
+{
+	OverlayDB db = State::openDB(c_memoryDBPath);
+	State first(db, BaseState::CanonGenesis);
+	// Found already in the DB, rather than built again.
+	State second(db, BaseState::CanonGenesis);
+	BOOST_CHECK_EQUAL(second.rootHash(), CanonBlockChain::genesis().stateRoot);
+	for (auto const& i: genesisState())
+		BOOST_CHECK_EQUAL(second.balance(i.first), i.second.balance());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -0,0 +1,75 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file guards.cpp
+ * @date 2015
+ * Lock profiling test functions.
+ */
+
+#include <thread>
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/Guards.h>
+
+using namespace std;
+using namespace dev;
+
+BOOST_AUTO_TEST_SUITE(GuardsTests)
+
+BOOST_AUTO_TEST_CASE(profiledMutex)
+{
+	ProfiledMutex<std::mutex> m;
+	m.setName("test::profiledMutex");
+	LockStats& s = lockStats("test::profiledMutex");
+	BOOST_CHECK_EQUAL(&s, &lockStats("test::profiledMutex"));
+
+	{
+		lock_guard<ProfiledMutex<std::mutex>> l(m);
+	}
+	BOOST_CHECK_EQUAL(s.acquisitions, 1u);
+	BOOST_CHECK_EQUAL(s.contentions, 0u);
+
+	unique_lock<ProfiledMutex<std::mutex>> l(m);
+	thread t([&]() { lock_guard<ProfiledMutex<std::mutex>> l(m); });
+	this_thread::sleep_for(chrono::milliseconds(20));
+	l.unlock();
+	t.join();
+	BOOST_CHECK_EQUAL(s.acquisitions, 3u);
+	BOOST_CHECK_EQUAL(s.contentions, 1u);
+	BOOST_CHECK(s.maxWaitNs >= 10000000u);
+	BOOST_CHECK(s.maxHoldNs >= 10000000u);
+}
+
+BOOST_AUTO_TEST_CASE(profiledSharedMutex)
+{
+	ProfiledMutex<boost::shared_mutex> m;
+	m.setName("test::profiledSharedMutex");
+	LockStats& s = lockStats("test::profiledSharedMutex");
+	{
+		boost::shared_lock<ProfiledMutex<boost::shared_mutex>> r1(m);
+		boost::shared_lock<ProfiledMutex<boost::shared_mutex>> r2(m);
+	}
+	{
+		boost::upgrade_lock<ProfiledMutex<boost::shared_mutex>> u(m);
+		boost::upgrade_to_unique_lock<ProfiledMutex<boost::shared_mutex>> w(u);
+	}
+	BOOST_CHECK_EQUAL(s.acquisitions, 3u);
+	BOOST_CHECK_EQUAL(s.contentions, 0u);
+
+	resetLockProfile();
+	BOOST_CHECK_EQUAL(s.acquisitions, 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,54 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file hashFilter.cpp
+ * @date 2015
+ * HashFilter test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/HashFilter.h>
+#include <libdevcrypto/SHA3.h>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+h256 key(unsigned _i) { return sha3(h256(u256(_i))); }
+}
+
+BOOST_AUTO_TEST_SUITE(HashFilterTests)
+
+BOOST_AUTO_TEST_CASE(hashFilterRecent)
+{
+	HashFilter f(1000);
+	for (unsigned i = 0; i < 2000; ++i)
+		f.insert(key(i));
+
+	// The last half-capacity are always remembered; those long gone mostly are not.
+	for (unsigned i = 1500; i < 2000; ++i)
+		BOOST_CHECK(f.contains(key(i)));
+	unsigned remembered = 0;
+	for (unsigned i = 0; i < 500; ++i)
+		remembered += f.contains(key(i));
+	BOOST_CHECK(remembered < 10);
+
+	f.clear();
+	BOOST_CHECK(!f.contains(key(1999)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,129 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file lightClient.cpp
+ * @date 2015
+ * LightClient, LightHost and RequestCredit test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libethereum/LightClient.h>
+#include <libethereum/RequestCredit.h>
+#include <libethereum/State.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+/// @returns @a _p as a server would send it, decoded as a light client would.
+static StateProof roundTrip(StateProof const& _p, u256s const& _slots)
+{
+	RLPStream s;
+	LightHost::streamProof(s, _p);
+	bytes b = s.out();
+	return LightClient::decodeProof(_p.root, _slots, RLP(b));
+}
+
+BOOST_AUTO_TEST_SUITE(LightClientTests)
+
+BOOST_AUTO_TEST_CASE(requestCreditSpend)
+{
+	RequestCredit c(1000, 0);
+	BOOST_CHECK_EQUAL(c.value(), 1000u);
+	BOOST_CHECK(c.spend(600));
+	BOOST_CHECK_EQUAL(c.value(), 400u);
+	// Never into debt: a request it cannot afford takes nothing.
+	BOOST_CHECK(!c.spend(500));
+	BOOST_CHECK_EQUAL(c.value(), 400u);
+	BOOST_CHECK(c.waitFor(500) == RequestCredit::Clock::duration::max());
+	BOOST_CHECK(c.waitFor(400) == RequestCredit::Clock::duration::zero());
+}
+
+BOOST_AUTO_TEST_CASE(requestCreditSet)
+{
+	RequestCredit c(1000, 0);
+	c.set(700, 200);
+	BOOST_CHECK_EQUAL(c.value(), 500u);
+	c.set(100, 200);
+	BOOST_CHECK_EQUAL(c.value(), 0u);
+	c.set(5000);
+	BOOST_CHECK_EQUAL(c.value(), 1000u);
+}
+
+BOOST_AUTO_TEST_CASE(requestCost)
+{
+	BOOST_CHECK(LightHost::cost(GetProofsPacket, 2) > LightHost::cost(GetProofsPacket, 1));
+	BOOST_CHECK(LightHost::cost(GetProofsPacket, 1) > LightHost::cost(GetHeadersPacket, 1));
+	BOOST_CHECK(LightHost::cost(GetProofsPacket, c_maxLightItems) < c_lightCreditLimit);
+}
+
+BOOST_AUTO_TEST_CASE(lightProofRoundTrip)
+{
+	State s(OverlayDB(), BaseState::Empty);
+	for (unsigned i = 1; i < 50; ++i)
+		s.addBalance(Address(i), i);
+	Address c = s.newContract(7, bytes{0x60, 0x01});
+	for (unsigned j = 0; j < 20; ++j)
+		s.setStorage(c, j, j + 1);
+	s.commit();
+
+	u256s slots{3, 100};
+	ProvenAccount a;
+	BOOST_REQUIRE(LightClient::verify(roundTrip(s.prove(c, slots), slots), c, a));
+	BOOST_CHECK(a.exists);
+	BOOST_CHECK_EQUAL(a.balance, 7);
+	BOOST_CHECK_EQUAL(a.storage[3], 4);
+	BOOST_CHECK_EQUAL(a.storage[100], 0);
+
+	ProvenAccount none;
+	BOOST_REQUIRE(LightClient::verify(roundTrip(s.prove(Address(1000), u256s()), u256s()), Address(1000), none));
+	BOOST_CHECK(!none.exists);
+	BOOST_CHECK_EQUAL(none.balance, 0);
+}
+
+BOOST_AUTO_TEST_CASE(lightProofTampered)
+{
+	State s(OverlayDB(), BaseState::Empty);
+	for (unsigned i = 1; i < 50; ++i)
+		s.addBalance(Address(i), i);
+	s.commit();
+
+	ProvenAccount a;
+	StateProof p = s.prove(Address(5), u256s());
+	BOOST_REQUIRE(LightClient::verify(p, Address(5), a));
+	// The proof of another account does not prove this one.
+	BOOST_CHECK(!LightClient::verify(p, Address(6), a));
+	p.account.back().back() ^= 1;
+	BOOST_CHECK(!LightClient::verify(p, Address(5), a));
+
+	// A slot the server gave no proof of is not proven.
+	RLPStream r;
+	r.appendList(2);
+	r.appendVector(s.prove(Address(5), u256s()).account);
+	r.appendList(0);
+	bytes b = r.out();
+	BOOST_CHECK(!LightClient::verify(LightClient::decodeProof(s.rootHash(), u256s(1, 1), RLP(b)), Address(5), a));
+}
+
+BOOST_AUTO_TEST_CASE(lightReceipts)
+{
+	bytes empty = rlpList();
+	BOOST_CHECK(LightClient::verifyReceipts(EmptyTrie, RLP(empty)));
+	bytes one = rlpList(rlpList(1, 2));
+	BOOST_CHECK(!LightClient::verifyReceipts(EmptyTrie, RLP(one)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,118 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file log.cpp
+ * @date 2015
+ * Logging test functions.
+ */
+
+#include <thread>
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/Guards.h>
+#include <libdevcore/Log.h>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+struct LogTestChannel: public LogChannel { static const char* name() { return "%%%"; } static const int verbosity = 0; };
+struct LogTestQuietChannel: public LogChannel { static const char* name() { return "%%%"; } static const int verbosity = 100; };
+
+/// Collects what is posted to the test channel for as long as it lives.
+struct LogCapture
+{
+	LogCapture(): m_post(g_logPost)
+	{
+		g_logPost = [this](string const& _s, char const* _c)
+		{
+			if (string(_c) == LogTestChannel::name())
+			{
+				Guard l(x_lines);
+				lines.push_back(_s);
+			}
+		};
+	}
+	~LogCapture() { g_logPost = m_post; }
+
+	Mutex x_lines;
+	vector<string> lines;
+
+private:
+	function<void(string const&, char const*)> m_post;
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(LogTests)
+
+BOOST_AUTO_TEST_CASE(logFormat)
+{
+	LogCapture c;
+	clog(LogTestChannel) << "a" << 1 << "b " << 2;
+	LogOutputStream<LogTestChannel, true>(false) << "| c";
+	BOOST_REQUIRE_EQUAL(c.lines.size(), 2u);
+	BOOST_CHECK_EQUAL(c.lines[0].substr(0, 6), "%%% [ ");
+	BOOST_CHECK_EQUAL(c.lines[0].substr(c.lines[0].size() - 10), " ] a 1 b 2");
+	BOOST_CHECK_EQUAL(c.lines[1].substr(c.lines[1].size() - 4), " | c");
+}
+
+BOOST_AUTO_TEST_CASE(logInvisible)
+{
+	LogCapture c;
+	unsigned evaluated = 0;
+	clog(LogTestQuietChannel) << ++evaluated;
+	BOOST_CHECK_EQUAL(evaluated, 0u);
+	BOOST_CHECK(c.lines.empty());
+}
+
+BOOST_AUTO_TEST_CASE(logAsync)
+{
+	LogCapture c;
+	uint64_t dropped = droppedLogEntries();
+	setAsyncLogging(true, 1024);
+	vector<thread> threads;
+	for (unsigned t = 0; t < 4; ++t)
+		threads.push_back(thread([]()
+		{
+			for (unsigned i = 0; i < 200; ++i)
+				clog(LogTestChannel) << i;
+		}));
+	for (auto& t: threads)
+		t.join();
+	setAsyncLogging(false);
+	BOOST_CHECK_EQUAL(c.lines.size() + droppedLogEntries() - dropped, 800u);
+
+	// Synchronous again.
+	size_t posted = c.lines.size();
+	clog(LogTestChannel) << "now";
+	BOOST_CHECK_EQUAL(c.lines.size(), posted + 1);
+}
+
+BOOST_AUTO_TEST_CASE(logAsyncDrops)
+{
+	LogCapture c;
+	uint64_t dropped = droppedLogEntries();
+	setAsyncLogging(true, 4);
+	for (unsigned i = 0; i < 1000; ++i)
+		clog(LogTestChannel) << i;
+	setAsyncLogging(false);
+	BOOST_CHECK(droppedLogEntries() > dropped);
+	BOOST_CHECK_EQUAL(c.lines.size() + droppedLogEntries() - dropped, 1000u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
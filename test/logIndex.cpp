@@ -0,0 +1,89 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file logIndex.cpp
+ * @date 2015
+ * Log index test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libethereum/BlockDetails.h>
+#include <libethereum/LogFilter.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+BOOST_AUTO_TEST_SUITE(LogIndexTests)
+
+BOOST_AUTO_TEST_CASE(logPostingsRoundTrip)
+{
+	LogPostings p;
+	p.positions = {{4096, 0, 0}, {4096, 0, 3}, {4100, 12, 1}, {8191, 200, 0}};
+	bytes r = p.rlp();
+	LogPostings q{RLP(r)};
+	BOOST_REQUIRE_EQUAL(q.positions.size(), 4u);
+	for (unsigned i = 0; i < 4; ++i)
+		BOOST_CHECK(!(p.positions[i] < q.positions[i]) && !(q.positions[i] < p.positions[i]));
+
+	// Reverting to block 4100 leaves those before it.
+	q.truncate(4100);
+	BOOST_CHECK_EQUAL(q.positions.size(), 2u);
+	q.truncate(0);
+	BOOST_CHECK(q.positions.empty());
+}
+
+BOOST_AUTO_TEST_CASE(logFilterIndexKeys)
+{
+	Address a(1);
+	h256 t(u256(2));
+	h256 u(u256(3));
+	BOOST_CHECK(LogFilter().address(a).indexKeys().empty());
+	BOOST_CHECK(LogFilter().topic(0, t).indexKeys().empty());
+	BOOST_CHECK_EQUAL(LogFilter().address(a).topic(0, t).topic(0, u).indexKeys().size(), 2u);
+
+	// The index narrows to the first topic; the rest are matched on the entries.
+	LogFilter f = LogFilter().address(a).topic(0, t).topic(1, u);
+	BOOST_CHECK(f.matches(LogEntry(a, {t, u}, bytes())));
+	BOOST_CHECK(!f.matches(LogEntry(a, {t, t}, bytes())));
+	BOOST_CHECK(!f.matches(LogEntry(a, {t}, bytes())));
+}
+
+BOOST_AUTO_TEST_CASE(logFilterIndexCandidates)
+{
+	Address a(1);
+	Address b(2);
+	h256 t(u256(3));
+	LogFilterIndex index;
+	index.insert(h256(u256(1)), LogFilter().address(a).topic(0, t));
+	index.insert(h256(u256(2)), LogFilter().topic(0, t));
+	index.insert(h256(u256(3)), LogFilter());
+
+	auto candidates = [&](LogEntry const& _e)
+	{
+		h256Set ret;
+		index.forCandidates(_e, [&](h256 const& _id){ ret.insert(_id); });
+		return ret;
+	};
+	BOOST_CHECK_EQUAL(candidates(LogEntry(a, {t}, bytes())).size(), 3u);
+	BOOST_CHECK_EQUAL(candidates(LogEntry(b, {t}, bytes())).size(), 2u);
+	BOOST_CHECK_EQUAL(candidates(LogEntry(b, {}, bytes())).size(), 1u);
+
+	index.erase(h256(u256(2)), LogFilter().topic(0, t));
+	BOOST_CHECK_EQUAL(candidates(LogEntry(b, {t}, bytes())).size(), 1u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,84 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file mappedFile.cpp
+ * @date 2015
+ * MappedFile test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/MappedFile.h>
+#include <libdevcore/TransientDirectory.h>
+
+using namespace std;
+using namespace dev;
+
+BOOST_AUTO_TEST_SUITE(MappedFileTests)
+
+BOOST_AUTO_TEST_CASE(createAndMap)
+{
+	TransientDirectory dir;
+	string path = dir.path() + "/data";
+	size_t size = 3 * 1024 * 1024 + 5;
+	BOOST_REQUIRE(MappedFile::create(path, size, [](bytesRef _d){ for (size_t i = 0; i < _d.size(); ++i) _d[i] = (byte)(i * 7); }));
+
+	for (bool huge: {false, true})
+		for (unsigned node: {c_anyNumaNode, c_allNumaNodes, 0u})
+		{
+			MappedFile f(path, huge, node);
+			BOOST_REQUIRE_EQUAL(f.data().size(), size);
+			BOOST_CHECK_EQUAL(f.data()[0], 0);
+			BOOST_CHECK_EQUAL(f.data()[size - 1], (byte)((size - 1) * 7));
+		}
+	BOOST_CHECK(MappedFile(dir.path() + "/missing").data().empty());
+}
+
+BOOST_AUTO_TEST_CASE(growable)
+{
+#ifndef _WIN32
+	TransientDirectory dir;
+	string path = dir.path() + "/grown";
+	size_t capacity = 64 * 1024 * 1024;
+	byte* base;
+	{
+		GrowableMappedFile f(path, capacity);
+		BOOST_REQUIRE(f.data());
+		BOOST_CHECK_EQUAL(f.size(), 0u);
+		base = f.data();
+		BOOST_REQUIRE(f.resize(4096));
+		f.data()[4095] = 1;
+		BOOST_REQUIRE(f.resize(1024 * 1024));
+		// It grows where it is.
+		BOOST_CHECK(f.data() == base);
+		BOOST_CHECK_EQUAL(f.data()[4095], 1);
+		f.data()[1024 * 1024 - 1] = 2;
+		BOOST_CHECK(!f.resize(capacity + 1));
+		f.flush();
+	}
+	{
+		GrowableMappedFile f(path, capacity);
+		BOOST_REQUIRE_EQUAL(f.size(), 1024u * 1024);
+		BOOST_CHECK_EQUAL(f.data()[4095], 1);
+		BOOST_CHECK_EQUAL(f.data()[1024 * 1024 - 1], 2);
+	}
+	GrowableMappedFile m("", capacity);
+	BOOST_REQUIRE(m.resize(8192));
+	m.data()[8191] = 3;
+	BOOST_CHECK_EQUAL(m.data()[8191], 3);
+#endif
+}
+
+BOOST_AUTO_TEST_SUITE_END()
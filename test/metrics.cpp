@@ -0,0 +1,79 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file metrics.cpp
+ * @date 2015
+ * Metrics test functions.
+ */
+
+#include <thread>
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/Exceptions.h>
+#include <libdevcore/Metrics.h>
+
+using namespace std;
+using namespace dev;
+
+BOOST_AUTO_TEST_SUITE(MetricsTests)
+
+BOOST_AUTO_TEST_CASE(metricCounter)
+{
+	MetricCounter& c = Metrics::get().counter("test_counter_total", "A test counter.");
+	BOOST_CHECK_EQUAL(&c, &Metrics::get().counter("test_counter_total", "A test counter."));
+	vector<thread> threads;
+	for (unsigned t = 0; t < 8; ++t)
+		threads.push_back(thread([&]()
+		{
+			for (unsigned i = 0; i < 10000; ++i)
+				c.inc();
+		}));
+	for (auto& t: threads)
+		t.join();
+	BOOST_CHECK_EQUAL(c.value(), 80000u);
+	BOOST_CHECK_THROW(Metrics::get().gauge("test_counter_total", ""), InvalidMetric);
+}
+
+BOOST_AUTO_TEST_CASE(metricHistogram)
+{
+	MetricHistogram& h = Metrics::get().histogram("test_histogram", "A test histogram.", "kind=\"a\"", {1, 2});
+	h.observe(0.5);
+	h.observe(1);
+	h.observe(1.5);
+	h.observe(3);
+	BOOST_CHECK(h.counts() == vector<uint64_t>({2, 1, 1}));
+	BOOST_CHECK_EQUAL(h.sum(), 6);
+
+	string out = Metrics::get().prometheus();
+	BOOST_CHECK(out.find("# TYPE test_histogram histogram\n") != string::npos);
+	BOOST_CHECK(out.find("test_histogram_bucket{kind=\"a\",le=\"1\"} 2\n") != string::npos);
+	BOOST_CHECK(out.find("test_histogram_bucket{kind=\"a\",le=\"2\"} 3\n") != string::npos);
+	BOOST_CHECK(out.find("test_histogram_bucket{kind=\"a\",le=\"+Inf\"} 4\n") != string::npos);
+	BOOST_CHECK(out.find("test_histogram_sum{kind=\"a\"} 6\n") != string::npos);
+	BOOST_CHECK(out.find("test_histogram_count{kind=\"a\"} 4\n") != string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(metricWatch)
+{
+	double v = 7;
+	unsigned id = Metrics::get().watch("test_watched", "A watched value.", "", [&]() { return v; });
+	BOOST_CHECK(Metrics::get().prometheus().find("test_watched 7\n") != string::npos);
+	v = 8;
+	BOOST_CHECK(Metrics::get().prometheus().find("test_watched 8\n") != string::npos);
+	Metrics::get().unwatch(id);
+	BOOST_CHECK(Metrics::get().prometheus().find("test_watched 8\n") == string::npos);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -112,6 +112,16 @@ BOOST_AUTO_TEST_CASE(natspec_js_eval_input_params)
 	BOOST_CHECK_EQUAL(result, "Will multiply 4 by 7 and return 28.");
 }
 
+BOOST_AUTO_TEST_CASE(natspec_js_eval_quotes)
+{
+	// given
+	NatspecExpressionEvaluator e;
+	// when
+	string result = e.evalExpression("Sends `\"to \" + 'you'`.").toStdString();
+	// then
+	BOOST_CHECK_EQUAL(result, "Sends to you.");
+}
+
 BOOST_AUTO_TEST_CASE(natspec_js_eval_error)
 {
 	// given
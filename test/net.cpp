@@ -299,6 +299,17 @@ BOOST_AUTO_TEST_CASE(kademlia)
 
 }
 
+BOOST_AUTO_TEST_CASE(advertisedEndpoint)
+{
+	ba::io_service io;
+	TestNodeTable t(io, KeyPair::create(), bi::address::from_string("127.0.0.1"), 30299);
+	// Until our public endpoint is known, where we listen for discovery.
+	BOOST_CHECK(t.advertised() == bi::tcp::endpoint(bi::address::from_string("127.0.0.1"), 30299));
+	bi::tcp::endpoint pub(bi::address::from_string("8.8.4.4"), 30310);
+	t.setAdvertisedEndpoint(pub);
+	BOOST_CHECK(t.advertised() == pub);
+}
+
 BOOST_AUTO_TEST_CASE(test_udp_once)
 {
 	UDPDatagram d(bi::udp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), 30300), bytes({65,65,65,65}));
@@ -0,0 +1,77 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file packetLog.cpp
+ * @date 2015
+ * PacketLog test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/TransientDirectory.h>
+#include <libp2p/PacketLog.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::p2p;
+
+BOOST_AUTO_TEST_SUITE(PacketLogTests)
+
+BOOST_AUTO_TEST_CASE(packetLogReadsWhatWasRecorded)
+{
+	TransientDirectory dir;
+	string path = dir.path() + "/packets";
+	NodeId a = NodeId::random();
+	NodeId b = NodeId::random();
+	RLPStream hashes(2);
+	hashes << h256::random() << 256;
+	{
+		PacketLog log(path);
+		log.record(a, true, "eth", 3, &hashes.out());
+		log.record(b, false, string(), 2, &RLPStream(0).out());
+	}
+
+	auto packets = PacketLog::read(path);
+	BOOST_REQUIRE_EQUAL(packets.size(), 2);
+	BOOST_CHECK(packets[0].node == a);
+	BOOST_CHECK(packets[0].outgoing);
+	BOOST_CHECK_EQUAL(packets[0].capability, "eth");
+	BOOST_CHECK_EQUAL(packets[0].type, 3);
+	BOOST_CHECK(packets[0].payload == hashes.out());
+	BOOST_CHECK(packets[1].node == b);
+	BOOST_CHECK(!packets[1].outgoing);
+	BOOST_CHECK(packets[1].capability.empty());
+	BOOST_CHECK(packets[0].at <= packets[1].at);
+}
+
+BOOST_AUTO_TEST_CASE(packetLogIgnoresPartialRecord)
+{
+	TransientDirectory dir;
+	string path = dir.path() + "/packets";
+	{
+		PacketLog log(path);
+		log.record(NodeId(), false, "eth", 0, &RLPStream(0).out());
+		log.record(NodeId(), false, "eth", 1, &RLPStream(0).out());
+	}
+	bytes file = contents(path);
+	file.resize(file.size() - 3);
+	writeFile(path, file);
+
+	BOOST_CHECK_EQUAL(PacketLog::read(path).size(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,95 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file peerStore.cpp
+ * @date 2015
+ * PeerStore test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/TransientDirectory.h>
+#include <libp2p/PeerStore.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::p2p;
+
+static Peer makePeer(string const& _address, unsigned short _port, bool _required = false)
+{
+	Peer ret;
+	ret.id = NodeId::random();
+	auto a = bi::address::from_string(_address);
+	ret.endpoint = NodeIPEndpoint(bi::udp::endpoint(a, _port), bi::tcp::endpoint(a, _port));
+	ret.required = _required;
+	return ret;
+}
+
+BOOST_AUTO_TEST_SUITE(PeerStoreTests)
+
+BOOST_AUTO_TEST_CASE(writesOnlyWhatChanged)
+{
+	TransientDirectory dir;
+	Peer a = makePeer("8.8.8.8", 30303);
+	Peer b = makePeer("8.8.4.4", 30303, true);
+	{
+		PeerStore store(dir.path() + "/peers");
+		BOOST_REQUIRE(store.isOpen());
+		BOOST_CHECK(store.load().empty());
+
+		// Those we couldn't reach again are not kept.
+		BOOST_CHECK(!store.note(makePeer("192.168.0.1", 30303)));
+		BOOST_CHECK(!store.note(makePeer("8.8.8.8", 50000)));
+		BOOST_CHECK_EQUAL(store.flush(), 0u);
+
+		BOOST_CHECK(store.note(a));
+		BOOST_CHECK(store.note(b));
+		BOOST_CHECK_EQUAL(store.flush(), 2u);
+		BOOST_CHECK(store.note(a));
+		BOOST_CHECK_EQUAL(store.flush(), 0u);
+
+		a.endpoint.tcp.port(30304);
+		BOOST_CHECK(store.note(a));
+		BOOST_CHECK(store.note(b));
+		BOOST_CHECK_EQUAL(store.flush(), 1u);
+	}
+
+	{
+		// Required first.
+		PeerStore store(dir.path() + "/peers");
+		auto peers = store.load();
+		BOOST_REQUIRE_EQUAL(peers.size(), 2u);
+		BOOST_CHECK(peers[0]->id == b.id);
+		BOOST_CHECK(peers[0]->required);
+		BOOST_CHECK(peers[1]->id == a.id);
+		BOOST_CHECK_EQUAL(peers[1]->endpoint.tcp.port(), 30304);
+		BOOST_CHECK(peers[1]->endpoint.tcp.address() == a.endpoint.tcp.address());
+
+		// Loaded is as good as written.
+		BOOST_CHECK(store.note(*peers[1]));
+		BOOST_CHECK_EQUAL(store.flush(), 0u);
+
+		store.forget(b.id);
+		store.forget(NodeId::random());
+		BOOST_CHECK_EQUAL(store.flush(), 1u);
+	}
+
+	PeerStore store(dir.path() + "/peers");
+	auto peers = store.load();
+	BOOST_REQUIRE_EQUAL(peers.size(), 1u);
+	BOOST_CHECK(peers[0]->id == a.id);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
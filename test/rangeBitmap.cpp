@@ -0,0 +1,111 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file rangeBitmap.cpp
+ * @date 2015
+ * RangeBitmap test functions.
+ */
+
+#include <random>
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/RangeBitmap.h>
+#include <libdevcore/RangeMask.h>
+
+using namespace std;
+using namespace dev;
+
+template <class M> static vector<unsigned> items(M const& _m)
+{
+	vector<unsigned> ret;
+	for (auto i: _m)
+		ret.push_back(i);
+	return ret;
+}
+
+BOOST_AUTO_TEST_SUITE(RangeBitmapTests)
+
+BOOST_AUTO_TEST_CASE(rangeBitmapAsRangeMask)
+{
+	// Over several chunks, from an offset that is not a multiple of one.
+	unsigned const from = 1000;
+	unsigned const to = 20000;
+	RangeMask<unsigned> a(from, to);
+	RangeBitmap<unsigned> b(from, to);
+	mt19937 rng(42);
+	uniform_int_distribution<unsigned> at(from, to - 1);
+	for (unsigned round = 0; round < 200; ++round)
+	{
+		unsigned x = at(rng);
+		unsigned y = min(to, x + at(rng) % 300);
+		if (round % 3)
+		{
+			a += make_pair(x, y);
+			b += make_pair(x, y);
+		}
+		else
+		{
+			a -= RangeMask<unsigned>::Range(x, y);
+			b -= RangeBitmap<unsigned>::Range(x, y);
+		}
+		BOOST_REQUIRE(items(a) == items(b));
+		BOOST_REQUIRE_EQUAL(a.contains(x), b.contains(x));
+		BOOST_REQUIRE_EQUAL(a.contains(y - 1), b.contains(y - 1));
+	}
+	BOOST_CHECK(items(~a) == items(~b));
+	BOOST_CHECK(items(a.lowest(777)) == items(b.lowest(777)));
+	BOOST_CHECK(items((~a).lowest(777)) == items(b.lowestClear(777)));
+	BOOST_CHECK_EQUAL(b.size() + (~b).size(), to - from);
+	BOOST_CHECK(!b.full());
+	BOOST_CHECK((b + ~b).full());
+
+	ostringstream sa;
+	ostringstream sb;
+	sa << a;
+	sb << b;
+	BOOST_CHECK_EQUAL(sa.str(), sb.str());
+}
+
+BOOST_AUTO_TEST_CASE(rangeBitmapLowestClear)
+{
+	RangeBitmap<unsigned> got(0, 100000);
+	got += make_pair(0u, 50000u);
+	// Every other item after: as fragmented as can be.
+	for (unsigned i = 50000; i < 100000; i += 2)
+		got += i;
+	RangeBitmap<unsigned> asked(0, 100000);
+	asked += make_pair(50001u, 50011u);
+	RangeBitmap<unsigned> attempted(0, 100000);
+	attempted += 50011u;
+
+	auto m = got.lowestClear(4, {&asked, &attempted});
+	BOOST_CHECK(items(m) == vector<unsigned>({50013, 50015, 50017, 50019}));
+	BOOST_CHECK(m.all() == got.all());
+	BOOST_CHECK(items(m) == items((~(got + asked + attempted)).lowest(4)));
+
+	// Nothing clear; nothing given.
+	got += make_pair(50000u, 100000u);
+	BOOST_CHECK(got.full());
+	BOOST_CHECK(got.lowestClear(4).empty());
+
+	got -= make_pair(99999u, 100000u);
+	BOOST_CHECK(items(got.lowestClear(4)) == vector<unsigned>({99999}));
+	got.reset();
+	BOOST_CHECK(got.empty());
+	BOOST_CHECK_EQUAL(got.size(), 0u);
+	BOOST_CHECK(got.begin() == got.end());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -27,6 +27,7 @@
 
 #include <libdevcore/Log.h>
 #include <libdevcore/RLP.h>
+#include <libdevcore/RLPSchema.h>
 #include <libdevcore/Common.h>
 #include <libdevcore/CommonIO.h>
 #include <algorithm>
@@ -198,5 +199,110 @@ BOOST_AUTO_TEST_CASE(rlp_decoding_test)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(rlp_indexed)
+{
+	// Short lists are indexed in place, longer ones on the heap; either way, items read in any order match a scan's.
+	for (unsigned count: {0, 1, 31, 32, 1000})
+	{
+		RLPStream s(count);
+		for (unsigned i = 0; i < count; ++i)
+			if (i % 3)
+				s << i * 1000003;
+			else
+				s << bytes(i % 70, (byte)i);
+		bytes out = s.out();
+		RLP list(out);
+		IndexedRLP indexed(list);
+		BOOST_REQUIRE_EQUAL(indexed.itemCount(), count);
+		BOOST_REQUIRE_EQUAL(list.itemCount(), count);
+		for (unsigned i = count; i-- > 0;)
+			BOOST_REQUIRE(indexed[i].data() == list[i].data());
+		BOOST_CHECK(!indexed[count]);
+	}
+	bytes data = fromHex("0x83646f67");
+	BOOST_CHECK_EQUAL(IndexedRLP(RLP(data)).itemCount(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(rlp_exact)
+{
+	// Lists nested, short and long, of small, 256-bit and big integers and strings either side of 55 bytes.
+	auto stream = [](RLPStream& _s)
+	{
+		_s.appendList(5);
+		_s << 0 << 127 << 128 << u256(-1) << (bigint(1) << 300);
+		_s.appendList(3);
+		_s << bytes(55, 1) << bytes(56, 2);
+		_s.appendList(2) << string(200, 'x') << RLPEmptyList;
+		_s.appendList(0);
+		for (unsigned i = 0; i < 3; ++i)
+		{
+			_s.appendList(2) << u160(i) << h256(i);
+			_s.appendRaw(rlp(i * 1000));
+		}
+	};
+	RLPStream s;
+	s.appendList(2) << "head";
+	stream(s);
+	bytes expected = s.out();
+
+	RLPStream e;
+	e.appendExact([&](RLPStream& _s){ _s.appendList(2) << "head"; stream(_s); });
+	BOOST_CHECK(e.out() == expected);
+	BOOST_CHECK(rlpExact([&](RLPStream& _s){ _s.appendList(2) << "head"; stream(_s); }) == expected);
+	BOOST_CHECK(RLP(expected, RLP::LaisezFaire)[1][3].toInt<u256>() == u256(-1));
+
+	// Further appends to the stream are streamed as ever.
+	e << 1;
+	s << 1;
+	BOOST_CHECK(e.out() == s.out());
+}
+
+BOOST_AUTO_TEST_CASE(rlp_schema)
+{
+	RLPStream s(6);
+	s << h256(7) << u256(-1) << 0 << 300 << bytes(60, 3) << "x";
+	bytes out = s.out();
+
+	unsigned field;
+	h256 hash;
+	u256 big;
+	unsigned zero = 1;
+	uint16_t small;
+	bytes copied;
+	bytesConstRef viewed;
+	BOOST_REQUIRE(decodeRLPList(&out, field, hash, big, zero, small, copied, viewed));
+	BOOST_CHECK_EQUAL(field, 6u);
+	RLP r(out);
+	BOOST_CHECK(hash == r[0].toHash<h256>(RLP::VeryStrict));
+	BOOST_CHECK(big == r[1].toInt<u256>());
+	BOOST_CHECK_EQUAL(zero, 0u);
+	BOOST_CHECK_EQUAL(small, 300);
+	BOOST_CHECK(copied == r[4].toBytes());
+	BOOST_CHECK(viewed == r[5].toBytesConstRef());
+
+	// Too few fields or too many.
+	BOOST_CHECK(!decodeRLPList(&out, field, hash, big, zero, small, copied));
+	BOOST_CHECK(!decodeRLPList(&out, field, hash, big, zero, small, copied, viewed, viewed));
+	BOOST_CHECK_EQUAL(field, 6u);
+
+	// Fields that aren't as their types have them be.
+	h160 address;
+	BOOST_CHECK_THROW(decodeRLPList(&out, field, address, big, zero, small, copied, viewed), BadCast);
+	BOOST_CHECK_EQUAL(field, 0u);
+	byte tiny;
+	BOOST_CHECK_THROW(decodeRLPList(&out, field, hash, big, zero, tiny, copied, viewed), BadCast);
+	BOOST_CHECK_EQUAL(field, 3u);
+	bytes nonCanon = fromHex("0xc3820001");
+	BOOST_CHECK_THROW(decodeRLPList(&nonCanon, field, small), BadCast);
+
+	// Truncated, not a list, or followed by more.
+	bytes truncated(out.begin(), out.end() - 1);
+	BOOST_CHECK_THROW(decodeRLPList(&truncated, field, hash, big, zero, small, copied, viewed), BadRLP);
+	bytes data = rlp("dog");
+	BOOST_CHECK_THROW(decodeRLPList(&data, field, viewed), BadRLP);
+	bytes trailing = out + bytes(1, 0);
+	BOOST_CHECK_THROW(decodeRLPList(&trailing, field, hash, big, zero, small, copied, viewed), BadRLP);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
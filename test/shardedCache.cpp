@@ -0,0 +1,113 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file shardedCache.cpp
+ * @date 2015
+ * ShardedCache test functions.
+ */
+
+#include <thread>
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/FixedHash.h>
+#include <libdevcore/ShardedCache.h>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+struct UnitSize { size_t operator()(unsigned) const { return 0; } };
+struct ValueSize { size_t operator()(unsigned _v) const { return _v; } };
+using Cache = ShardedCache<h256, unsigned, UnitSize>;
+h256 key(unsigned _i) { return h256(u256(_i)); }
+}
+
+BOOST_AUTO_TEST_SUITE(ShardedCacheTests)
+
+BOOST_AUTO_TEST_CASE(shardedCacheLRU)
+{
+	// One shard with room for three entries.
+	Cache c(3 * Cache::c_entryOverhead, 1);
+	for (unsigned i = 0; i < 3; ++i)
+		c.insert(key(i), i);
+	unsigned v;
+	BOOST_REQUIRE(c.get(key(0), v));
+	BOOST_CHECK_EQUAL(v, 0u);
+
+	// 1 is now the least recently used, so goes first.
+	c.insert(key(3), 3);
+	BOOST_CHECK(!c.contains(key(1)));
+	BOOST_CHECK(c.contains(key(0)));
+	BOOST_CHECK(c.contains(key(2)));
+	BOOST_CHECK_EQUAL(c.memoryUsage(), 3 * Cache::c_entryOverhead);
+
+	BOOST_CHECK_EQUAL(c.update(key(1), 10, [](unsigned& _v){ ++_v; }), 11u);
+	BOOST_CHECK(!c.contains(key(2)));
+	BOOST_CHECK_EQUAL(c.update(key(1), 10, [](unsigned& _v){ ++_v; }), 12u);
+
+	c.erase(key(1));
+	BOOST_CHECK(!c.get(key(1), v));
+	c.clear();
+	BOOST_CHECK_EQUAL(c.memoryUsage(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(shardedCacheCost)
+{
+	using SizedCache = ShardedCache<h256, unsigned, ValueSize>;
+	size_t const o = SizedCache::c_entryOverhead;
+	SizedCache c(4 * o + 1000, 1);
+	c.insert(key(0), 10);
+	c.insert(key(1), 900);
+	c.insert(key(2), 10);
+	c.insert(key(3), 10);
+	BOOST_CHECK_EQUAL(c.memoryUsage(), 4 * o + 930);
+
+	// Over budget: the big entry goes, though it is not the oldest.
+	c.insert(key(4), 100);
+	BOOST_CHECK(!c.contains(key(1)));
+	BOOST_CHECK(c.contains(key(0)));
+	BOOST_CHECK_EQUAL(c.memoryUsage(), 4 * o + 130);
+
+	// Shrinking evicts at once.
+	c.setCapacity(2 * o + 110);
+	BOOST_CHECK_EQUAL(c.capacity(), 2 * o + 110);
+	BOOST_CHECK(c.memoryUsage() <= c.capacity());
+	BOOST_CHECK(c.contains(key(4)));
+}
+
+BOOST_AUTO_TEST_CASE(shardedCacheConcurrent)
+{
+	Cache c(1 << 20);
+	vector<thread> threads;
+	for (unsigned t = 0; t < 4; ++t)
+		threads.push_back(thread([&]()
+		{
+			for (unsigned i = 0; i < 1000; ++i)
+				c.update(key(i % 100), 0, [](unsigned& _v){ ++_v; });
+		}));
+	for (auto& t: threads)
+		t.join();
+	unsigned total = 0;
+	for (unsigned i = 0; i < 100; ++i)
+	{
+		unsigned v = 0;
+		BOOST_REQUIRE(c.get(key(i), v));
+		total += v;
+	}
+	BOOST_CHECK_EQUAL(total, 4000u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,89 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file sharedRing.cpp
+ * @date 2015
+ * SharedRing test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/SharedRing.h>
+#include <libdevcore/TransientDirectory.h>
+
+using namespace std;
+using namespace dev;
+
+BOOST_AUTO_TEST_SUITE(SharedRingTests)
+
+BOOST_AUTO_TEST_CASE(readsWhatIsWrittenUntilOverwritten)
+{
+#ifndef _WIN32
+	TransientDirectory dir;
+	string path = dir.path() + "/ring";
+	BOOST_CHECK(!SharedRing(path).isOpen());
+
+	SharedRing w(path, 1024);
+	SharedRing r(path);
+	BOOST_REQUIRE(w.isOpen() && r.isOpen());
+	BOOST_CHECK_EQUAL(r.capacity(), 1024u);
+
+	// Nothing to read yet, and nothing over half the ring is taken.
+	uint64_t pos = 0;
+	bytes record;
+	BOOST_CHECK(!r.read(pos, record));
+	BOOST_CHECK_EQUAL(w.append(bytesConstRef(bytes(600).data(), 600)), (uint64_t)-1);
+
+	bytes a(400, 0xaa);
+	bytes b(101, 0xbb);
+	BOOST_CHECK_EQUAL(w.append(&a), 0u);
+	uint64_t bPos = w.append(&b);
+	BOOST_CHECK_EQUAL(bPos, 8u + 400);
+	BOOST_REQUIRE(r.read(pos, record));
+	BOOST_CHECK(record == a);
+	BOOST_REQUIRE(r.read(pos, record));
+	BOOST_CHECK(record == b);
+	BOOST_CHECK_EQUAL(pos, r.end());
+	BOOST_CHECK(!r.read(pos, record));
+
+	// Too little is left at the end for the last, so it goes at the start, over a; b is still there.
+	uint64_t cPos = w.append(&b);
+	BOOST_REQUIRE(r.read(pos, record));
+	BOOST_CHECK(record == b);
+	BOOST_CHECK_EQUAL(pos, r.end());
+	bytes c(400, 0xcc);
+	uint64_t dPos = w.append(&c);
+	BOOST_CHECK_EQUAL(dPos % 1024, 0u);
+	uint64_t at = 0;
+	BOOST_CHECK(!r.read(at, record));
+	at = bPos;
+	BOOST_REQUIRE(r.read(at, record));
+	BOOST_CHECK(record == b);
+	BOOST_CHECK_EQUAL(at, cPos);
+	BOOST_REQUIRE(r.read(at, record));
+	BOOST_CHECK_EQUAL(at, cPos + 8 + 104);
+	BOOST_REQUIRE(r.read(at, record));
+	BOOST_CHECK(record == c);
+	BOOST_CHECK_EQUAL(at, dPos + 8 + 400);
+
+	// Once the writer comes round again, b is gone, and is left unread.
+	w.append(&b);
+	at = bPos;
+	BOOST_CHECK(!r.read(at, record));
+	BOOST_CHECK_EQUAL(at, bPos);
+#endif
+}
+
+BOOST_AUTO_TEST_SUITE_END()
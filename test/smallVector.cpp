@@ -0,0 +1,85 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file smallVector.cpp
+ * @date 2015
+ * SmallVector test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/SmallVector.h>
+#include <libdevcore/RLP.h>
+
+using namespace std;
+using namespace dev;
+
+BOOST_AUTO_TEST_SUITE(SmallVectorTests)
+
+BOOST_AUTO_TEST_CASE(smallVectorSpill)
+{
+	SmallVector<byte, 4> v;
+	for (byte i = 0; i < 4; ++i)
+		v.push_back(i);
+	BOOST_CHECK(!v.spilled());
+	v.push_back(4);
+	BOOST_CHECK(v.spilled());
+	BOOST_CHECK(v.toVector() == bytes({0, 1, 2, 3, 4}));
+
+	v.resize(7);
+	BOOST_CHECK_EQUAL(v[6], 0);
+	v.pop_back();
+	BOOST_CHECK_EQUAL(v.size(), 6u);
+
+	bytes out;
+	v.swap(out);
+	BOOST_CHECK(out == bytes({0, 1, 2, 3, 4, 0}));
+	BOOST_CHECK(v.empty());
+}
+
+BOOST_AUTO_TEST_CASE(smallVectorCopyMove)
+{
+	bytes b{1, 2, 3};
+	SmallVector<byte, 4> a(&b);
+	SmallVector<byte, 4> c(a);
+	BOOST_CHECK(a == c);
+	BOOST_CHECK(c.ref().data() != a.ref().data());
+
+	b.resize(10, 9);
+	SmallVector<byte, 4> big(&b);
+	byte const* data = big.data();
+	SmallVector<byte, 4> moved(move(big));
+	BOOST_CHECK_EQUAL(moved.data(), data);
+	BOOST_CHECK(moved.toVector() == b);
+}
+
+BOOST_AUTO_TEST_CASE(smallVectorRLPStream)
+{
+	RLPStream s(2);
+	s << "cat" << "dog";
+	BOOST_CHECK(s.outRef().toBytes() == fromHex("c88363617483646f67"));
+	BOOST_CHECK(s.out() == fromHex("c88363617483646f67"));
+	BOOST_CHECK(rlpList("cat", "dog") == fromHex("c88363617483646f67"));
+
+	RLPStream l;
+	l.appendList(100);
+	for (unsigned i = 0; i < 100; ++i)
+		l << i;
+	RLP r(l.outRef());
+	BOOST_CHECK_EQUAL(r.itemCount(), 100u);
+	BOOST_CHECK_EQUAL(r[99].toInt<unsigned>(), 99u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
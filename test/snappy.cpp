@@ -0,0 +1,131 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file snappy.cpp
+ * @date 2015
+ * Snappy compression test functions.
+ */
+
+#include <chrono>
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/Snappy.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/CommonIO.h>
+#include <libtestutils/Common.h>
+#include "TestHelper.h"
+
+using namespace std;
+using namespace dev;
+
+BOOST_AUTO_TEST_SUITE(SnappyTests)
+
+BOOST_AUTO_TEST_CASE(snappyFormat)
+{
+	// "abc" as a literal, then a copy of nine bytes from three back.
+	bytes in = {0x0c, 0x08, 'a', 'b', 'c', 0x15, 0x03};
+	bytes out = {'x'};
+	BOOST_REQUIRE(snappyUncompress(&in, out));
+	BOOST_CHECK(out == asBytes("xabcabcabcabc"));
+
+	bytes bad = {0x0c, 0x08, 'a', 'b', 'c', 0x15, 0x04};
+	BOOST_CHECK(!snappyUncompress(&bad, out));
+	BOOST_CHECK(!snappyUncompress(&in, out, 11));
+}
+
+BOOST_AUTO_TEST_CASE(snappyRoundTrip)
+{
+	for (size_t size: {0, 1, 15, 16, 1000, 70000, 300000})
+	{
+		bytes random(size);
+		bytes padded(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			random[i] = (byte)rand();
+			padded[i] = i % 32 < 24 ? 0 : (byte)i;
+		}
+		for (bytes const* in: {&random, &padded})
+		{
+			bytes compressed = snappyCompress(bytesConstRef(in));
+			bytes out;
+			BOOST_REQUIRE(snappyUncompress(&compressed, out));
+			BOOST_REQUIRE(out == *in);
+		}
+		if (size >= 1000)
+			BOOST_CHECK(snappyCompress(&padded).size() < size / 4);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(snappyBlocks)
+{
+	// With --performance, compresses the blocks of the blockchain tests, one at a time and as a Blocks packet.
+	if (!test::Options::get().performance)
+		return;
+	bytes packet;
+	vector<bytes> blocks;
+	for (string name: {"bcValidBlockTest", "bcJS_API_Test", "bcUncleTest", "bcForkBlockTest"})
+	{
+		string s = asString(contents(test::getTestPath() + "/BlockTests/" + name + ".json"));
+		if (s.empty())
+			continue;
+		json_spirit::mValue v;
+		json_spirit::read_string(s, v);
+		for (auto& t: v.get_obj())
+			if (t.second.get_obj().count("blocks"))
+				for (auto& b: t.second.get_obj()["blocks"].get_array())
+					if (b.get_obj().count("rlp"))
+					{
+						blocks.push_back(fromHex(b.get_obj()["rlp"].get_str()));
+						packet += blocks.back();
+					}
+	}
+	if (blocks.empty())
+	{
+		cnote << "No blockchain tests found; set ETHEREUM_TEST_PATH.";
+		return;
+	}
+	RLPStream s;
+	s.appendList(blocks.size()).appendRaw(packet, blocks.size());
+	s.swapOut(packet);
+
+	size_t size = 0;
+	size_t compressedSize = 0;
+	for (auto const& b: blocks)
+	{
+		size += b.size();
+		compressedSize += snappyCompress(&b).size();
+	}
+	cnote << blocks.size() << "blocks of" << size << "bytes compress one at a time to" << compressedSize << "bytes";
+
+	unsigned n = max<unsigned>(64 * 1024 * 1024 / packet.size(), 1);
+	bytes compressed;
+	auto start = chrono::high_resolution_clock::now();
+	for (unsigned i = 0; i < n; ++i)
+		compressed = snappyCompress(&packet);
+	auto compressTime = chrono::high_resolution_clock::now() - start;
+	bytes out;
+	start = chrono::high_resolution_clock::now();
+	for (unsigned i = 0; i < n; ++i)
+	{
+		out.clear();
+		snappyUncompress(&compressed, out);
+	}
+	auto uncompressTime = chrono::high_resolution_clock::now() - start;
+	BOOST_REQUIRE(out == packet);
+	auto mbps = [&](chrono::high_resolution_clock::duration _t) { return (double)packet.size() * n / chrono::duration_cast<chrono::microseconds>(_t).count(); };
+	cnote << "As a Blocks packet," << packet.size() << "bytes compress to" << compressed.size() << "bytes, at" << mbps(compressTime) << "MB/s; uncompress at" << mbps(uncompressTime) << "MB/s";
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -24,7 +24,10 @@
 
 #include <string>
 #include <tuple>
+#include <fstream>
 #include "TestHelper.h"
+#include <libevm/VM.h>
+#include <libevmcore/GasProfiler.h>
 #include <libethereum/State.h>
 #include <libethereum/Executive.h>
 #include <libsolidity/CompilerStack.h>
@@ -49,6 +52,13 @@ public:
 		ETH_TEST_REQUIRE_NO_THROW(compiler.compile(m_optimize), "Compiling contract failed");
 
 		bytes code = compiler.getBytecode(_contractName);
+		if (eth::GasProfiler* profiler = m_gasProfiler)
+		{
+			std::string name = _contractName.empty() ? compiler.defaultContractName() : _contractName;
+			StringMap sources{{"", _sourceCode}};
+			profiler->addCode(name + "(creation)", code, compiler.getAssemblyItems(_contractName), sources);
+			profiler->addCode(name, compiler.getRuntimeBytecode(_contractName), compiler.getRuntimeAssemblyItems(_contractName), sources);
+		}
 		sendMessage(code, true, _value);
 		BOOST_REQUIRE(!m_output.empty());
 		return m_output;
@@ -130,11 +140,27 @@ private:
 		return encode(_cppFunction(_arguments...));
 	}
 
+	/// @returns the profiler that the runs of all tests go to if --gasprofile was given, or nullptr. The profile is
+	/// written out at exit.
+	static eth::GasProfiler* gasProfiler()
+	{
+		struct Profile
+		{
+			~Profile() { std::ofstream out(dev::test::Options::get().gasProfileOutFile); profiler.streamFolded(out); }
+			eth::GasProfiler profiler;
+		};
+		if (dev::test::Options::get().gasProfileOutFile.empty())
+			return nullptr;
+		static Profile s_profile;
+		return &s_profile.profiler;
+	}
+
 protected:
 	void sendMessage(bytes const& _data, bool _isCreation, u256 const& _value = 0)
 	{
 		m_state.addBalance(m_sender, _value); // just in case
-		eth::Executive executive(m_state, eth::LastHashes(), 0);
+		eth::LastHashes lastHashes;
+		eth::Executive executive(m_state, lastHashes, 0);
 		eth::Transaction t = _isCreation ? eth::Transaction(_value, m_gasPrice, m_gas, _data, 0, KeyPair::create().sec())
 										 : eth::Transaction(_value, m_gasPrice, m_gas, m_contractAddress, _data, 0, KeyPair::create().sec());
 		bytes transactionRLP = t.rlp();
@@ -157,21 +183,31 @@ protected:
 			BOOST_REQUIRE(m_state.addressHasCode(m_contractAddress));
 			BOOST_REQUIRE(!executive.call(m_contractAddress, m_contractAddress, m_sender, _value, m_gasPrice, &_data, m_gas, m_sender));
 		}
-		BOOST_REQUIRE(executive.go());
+		eth::OnOpFunc onOp;
+		if (eth::GasProfiler* profiler = m_gasProfiler)
+			onOp = [=](uint64_t _steps, eth::Instruction, bigint, bigint _gasCost, eth::VM* _vm, eth::ExtVMFace const* _ext)
+			{
+				profiler->step(_steps, _ext->depth, *_ext->code, unsigned(_vm->curPC()), _gasCost);
+			};
+		BOOST_REQUIRE(executive.go(onOp));
 		m_state.noteSending(m_sender);
 		executive.finalize();
+		m_gasUsed = executive.gasUsed();
 		m_output = executive.out().toVector();
 		m_logs = executive.logs();
 	}
 
 	bool m_optimize = false;
 	bool m_addStandardSources = false;
+	/// Where the gas of the compiled contracts and of the messages sent to them is profiled, if anywhere.
+	eth::GasProfiler* m_gasProfiler = gasProfiler();
 	Address m_sender;
 	Address m_contractAddress;
 	eth::State m_state;
 	u256 const m_gasPrice = 100 * eth::szabo;
 	u256 const m_gas = 100000000;
 	bytes m_output;
+	u256 m_gasUsed;	///< By the last message, apart from the transaction's own gas.
 	eth::LogEntries m_logs;
 };
 
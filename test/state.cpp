@@ -46,9 +46,9 @@ void doStateTests(json_spirit::mValue& v, bool _fillin)
 		std::cout << "  " << i.first << "\n";
 		mObject& o = i.second.get_obj();
 
-		BOOST_REQUIRE(o.count("env") > 0);
-		BOOST_REQUIRE(o.count("pre") > 0);
-		BOOST_REQUIRE(o.count("transaction") > 0);
+		ETH_TEST_REQUIRE(o.count("env") > 0);
+		ETH_TEST_REQUIRE(o.count("pre") > 0);
+		ETH_TEST_REQUIRE(o.count("transaction") > 0);
 
 		ImportTest importer(o, _fillin);
 
@@ -80,8 +80,8 @@ void doStateTests(json_spirit::mValue& v, bool _fillin)
 		}
 		else
 		{
-			BOOST_REQUIRE(o.count("post") > 0);
-			BOOST_REQUIRE(o.count("out") > 0);
+			ETH_TEST_REQUIRE(o.count("post") > 0);
+			ETH_TEST_REQUIRE(o.count("out") > 0);
 
 			// check output
 			checkOutput(output, o);
@@ -96,7 +96,7 @@ void doStateTests(json_spirit::mValue& v, bool _fillin)
 			auto resultAddrs = theState.addresses();
 			checkAddresses<map<Address, u256> >(expectedAddrs, resultAddrs);
 #endif
-			BOOST_CHECK_MESSAGE(theState.rootHash() == h256(o["postStateRoot"].get_str()), "wrong post state root");
+			ETH_TEST_CHECK_MESSAGE(theState.rootHash() == h256(o["postStateRoot"].get_str()), "wrong post state root");
 		}
 	}
 }
@@ -106,79 +106,79 @@ BOOST_AUTO_TEST_SUITE(StateTests)
 
 BOOST_AUTO_TEST_CASE(stExample)
 {
-	dev::test::executeTests("stExample", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stExample", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stSystemOperationsTest)
 {
-	dev::test::executeTests("stSystemOperationsTest", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stSystemOperationsTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stCallCreateCallCodeTest)
 {
-	dev::test::executeTests("stCallCreateCallCodeTest", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stCallCreateCallCodeTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stPreCompiledContracts)
 {
-	dev::test::executeTests("stPreCompiledContracts", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stPreCompiledContracts", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stLogTests)
 {
-	dev::test::executeTests("stLogTests", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stLogTests", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stRecursiveCreate)
 {
-	dev::test::executeTests("stRecursiveCreate", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stRecursiveCreate", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stInitCodeTest)
 {
-	dev::test::executeTests("stInitCodeTest", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stInitCodeTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stTransactionTest)
 {
-	dev::test::executeTests("stTransactionTest", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stTransactionTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stSpecialTest)
 {
-	dev::test::executeTests("stSpecialTest", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stSpecialTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stRefundTest)
 {
-	dev::test::executeTests("stRefundTest", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stRefundTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stBlockHashTest)
 {
-	dev::test::executeTests("stBlockHashTest", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stBlockHashTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stQuadraticComplexityTest)
 {
 	if (test::Options::get().quadratic)
-		dev::test::executeTests("stQuadraticComplexityTest", "/StateTests", dev::test::doStateTests);
+		dev::test::executeTests("stQuadraticComplexityTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stMemoryStressTest)
 {
 	if (test::Options::get().memory)
-		dev::test::executeTests("stMemoryStressTest", "/StateTests", dev::test::doStateTests);
+		dev::test::executeTests("stMemoryStressTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stSolidityTest)
 {
-	dev::test::executeTests("stSolidityTest", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stSolidityTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(stMemoryTest)
 {
-	dev::test::executeTests("stMemoryTest", "/StateTests", dev::test::doStateTests);
+	dev::test::executeTests("stMemoryTest", "/StateTests", dev::test::doStateTests, true);
 }
 
 
@@ -199,18 +199,18 @@ BOOST_AUTO_TEST_CASE(stCreateTest)
 				cnote << "Populating tests...";
 				json_spirit::mValue v;
 				string s = asString(dev::contents(boost::unit_test::framework::master_test_suite().argv[i + 1]));
-				BOOST_REQUIRE_MESSAGE(s.length() > 0, "Content of " + (string)boost::unit_test::framework::master_test_suite().argv[i + 1] + " is empty.");
-				json_spirit::read_string(s, v);
+				ETH_TEST_REQUIRE_MESSAGE(s.length() > 0, "Content of " + (string)boost::unit_test::framework::master_test_suite().argv[i + 1] + " is empty.");
+				dev::test::readJson(s, v);
 				dev::test::doStateTests(v, true);
 				writeFile(boost::unit_test::framework::master_test_suite().argv[i + 2], asBytes(json_spirit::write_string(v, true)));
 			}
 			catch (Exception const& _e)
 			{
-				BOOST_ERROR("Failed state test with Exception: " << diagnostic_information(_e));
+				ETH_TEST_ERROR("Failed state test with Exception: " << diagnostic_information(_e));
 			}
 			catch (std::exception const& _e)
 			{
-				BOOST_ERROR("Failed state test with Exception: " << _e.what());
+				ETH_TEST_ERROR("Failed state test with Exception: " << _e.what());
 			}
 		}
 	}
@@ -236,22 +236,60 @@ BOOST_AUTO_TEST_CASE(stRandom)
 			cnote << "Testing ..." << path.filename();
 			json_spirit::mValue v;
 			string s = asString(dev::contents(path.string()));
-			BOOST_REQUIRE_MESSAGE(s.length() > 0, "Content of " + path.string() + " is empty. Have you cloned the 'tests' repo branch develop and set ETHEREUM_TEST_PATH to its path?");
-			json_spirit::read_string(s, v);
+			ETH_TEST_REQUIRE_MESSAGE(s.length() > 0, "Content of " + path.string() + " is empty. Have you cloned the 'tests' repo branch develop and set ETHEREUM_TEST_PATH to its path?");
+			dev::test::readJson(s, v);
 			test::Listener::notifySuiteStarted(path.filename().string());
 			dev::test::doStateTests(v, false);
 		}
 		catch (Exception const& _e)
 		{
-			BOOST_ERROR("Failed test with Exception: " << diagnostic_information(_e));
+			ETH_TEST_ERROR("Failed test with Exception: " << diagnostic_information(_e));
 		}
 		catch (std::exception const& _e)
 		{
-			BOOST_ERROR("Failed test with Exception: " << _e.what());
+			ETH_TEST_ERROR("Failed test with Exception: " << _e.what());
 		}
 	}
 }
 
+BOOST_AUTO_TEST_CASE(stSnapshot)
+{
+	StateSnapshot s;
+	Address a(1);
+	Address b(2);
+	std::string rlp;
+	u256 value;
+	ETH_TEST_CHECK(!s.account(h256(1), a, rlp));
+
+	s.noteAccount(h256(1), a, "a1");
+	s.noteStorage(h256(1), b, 5, 50);
+	ETH_TEST_REQUIRE(s.account(h256(1), a, rlp));
+	ETH_TEST_CHECK_EQUAL(rlp, "a1");
+
+	// Each commit changes a and resets b's storage every other time; all of it must stay right
+	// as the layers get folded.
+	for (unsigned i = 2; i < StateSnapshot::c_maxDepth * 3; ++i)
+	{
+		StateSnapshot::Changes c;
+		c.accounts[a] = "a" + toString(i);
+		if (i % 2)
+			c.resetStorage.insert(b);
+		else
+			c.storage[make_pair(b, u256(i))] = i;
+		s.update(h256(i - 1), h256(i), std::move(c));
+
+		ETH_TEST_REQUIRE(s.account(h256(i), a, rlp));
+		ETH_TEST_CHECK_EQUAL(rlp, "a" + toString(i));
+		ETH_TEST_REQUIRE(s.storage(h256(i), b, 5, value));
+		ETH_TEST_CHECK_EQUAL(value, i < 3 ? 50 : 0);
+		ETH_TEST_REQUIRE(s.storage(h256(i), b, i - i % 2, value));
+		ETH_TEST_CHECK_EQUAL(value, i % 2 ? 0 : i);
+	}
+	ETH_TEST_CHECK(!s.account(h256(1), b, rlp));
+	ETH_TEST_CHECK(s.hits() > 0);
+	ETH_TEST_CHECK(s.misses() > 0);
+}
+
 BOOST_AUTO_TEST_CASE(userDefinedFileState)
 {
 	dev::test::userDefinedTest("--singletest", dev::test::doStateTests);
@@ -0,0 +1,113 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file stateArchive.cpp
+ * @date 2015
+ * Export and import of state archives.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/CommonIO.h>
+#include <libdevcore/RLP.h>
+#include <libdevcore/TransientDirectory.h>
+#include <libdevcrypto/KeyValueDB.h>
+#include <libdevcrypto/OverlayDB.h>
+#include <libdevcrypto/TrieDB.h>
+#include <libethereum/StateArchive.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+OverlayDB memoryDB()
+{
+	DBOptions o;
+	o.backend = DBBackend::Memory;
+	return OverlayDB(KeyValueDB::open(string(), o));
+}
+
+/// Fills @a _db with accounts, some with code and storage, enough for several small chunks. @returns the root.
+h256 makeState(OverlayDB& _db)
+{
+	bytes code = {0x60, 0x01, 0x60, 0x00, 0x55};
+	_db.insert(sha3(code), &code);
+	GenericTrieDB<OverlayDB> accounts(&_db);
+	accounts.init();
+	for (unsigned i = 0; i < 300; ++i)
+	{
+		GenericTrieDB<OverlayDB> storage(&_db);
+		storage.init();
+		for (unsigned j = 0; j < i % 5 * 10; ++j)
+		{
+			bytes value = rlp(u256(i * j + 1));
+			storage.insert(sha3(toBigEndian(u256(j))).ref(), &value);
+		}
+		bytes account = rlpList(u256(i), u256(i) * 1000, storage.root(), i % 3 ? EmptySHA3 : sha3(code));
+		accounts.insert(sha3(toBigEndian(u256(i))).ref(), &account);
+	}
+	_db.commit();
+	return accounts.root();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(StateArchiveTests)
+
+BOOST_AUTO_TEST_CASE(roundTrip)
+{
+	TransientDirectory dir;
+	OverlayDB from = memoryDB();
+	h256 root = makeState(from);
+	bytes header = rlpList(root, 1);
+	BOOST_REQUIRE(writeStateArchive(from, root, header, dir.path(), 4096));
+	BOOST_CHECK(stateArchiveHeader(dir.path()) == header);
+
+	OverlayDB to = memoryDB();
+	BOOST_REQUIRE(importStateArchive(dir.path(), to, root));
+	GenericTrieDB<OverlayDB> accounts(&to, root);
+	string accountRLP = accounts.at(sha3(toBigEndian(u256(3))).ref());
+	RLP account(accountRLP);
+	BOOST_CHECK_EQUAL(account[1].toInt<u256>(), 3000);
+	GenericTrieDB<OverlayDB> storage(&to, account[2].toHash<h256>());
+	BOOST_CHECK(storage.at(sha3(toBigEndian(u256(7))).ref()) == asString(rlp(u256(22))));
+	BOOST_CHECK(!to.lookup(account[3].toHash<h256>()).empty());
+
+	OverlayDB wrong = memoryDB();
+	BOOST_CHECK(!importStateArchive(dir.path(), wrong, sha3(root)));
+}
+
+BOOST_AUTO_TEST_CASE(corruptChunk)
+{
+	TransientDirectory dir;
+	OverlayDB from = memoryDB();
+	h256 root = makeState(from);
+	BOOST_REQUIRE(writeStateArchive(from, root, rlpList(root), dir.path(), 4096));
+	bytes manifest = contents(dir.path() + "/manifest");
+	h256s chunks = RLP(manifest)[1].toVector<h256>();
+	BOOST_REQUIRE(chunks.size() > 1);
+	string path = dir.path() + "/" + toHex(chunks[1].ref());
+	bytes data = contents(path);
+	data[data.size() / 2] ^= 1;
+	writeFile(path, data);
+
+	OverlayDB to = memoryDB();
+	BOOST_CHECK(!importStateArchive(dir.path(), to, root));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,122 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file stateDownload.cpp
+ * @date 2015
+ * StateDownload test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libethereum/State.h>
+#include <libethereum/StateDownload.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+/// @returns the nodes of @a _db that are asked for in @a _asked, as a NodeData packet would have them, leaving out
+/// every @a _skip th.
+static bytes answer(OverlayDB const& _db, h256s const& _asked, unsigned _skip)
+{
+	vector<string> nodes;
+	for (unsigned i = 0; i < _asked.size(); ++i)
+		if (!_skip || i % _skip)
+			nodes.push_back(_db.lookup(_asked[i]));
+	RLPStream s(nodes.size());
+	for (auto const& n: nodes)
+		s.append(n);
+	return s.out();
+}
+
+BOOST_AUTO_TEST_SUITE(StateDownloadTests)
+
+BOOST_AUTO_TEST_CASE(stateDownloadWhole)
+{
+	State s(OverlayDB(), BaseState::Empty);
+	for (unsigned i = 1; i < 200; ++i)
+		s.addBalance(Address(i), i);
+	for (unsigned i = 0; i < 5; ++i)
+	{
+		Address c = s.newContract(i, bytes{0x60, byte(i)});
+		for (unsigned j = 0; j < 50; ++j)
+			s.setStorage(c, j, j + 1);
+	}
+	s.commit();
+	OverlayDB source = s.db();
+
+	// Written through a copy, so seen here only once committed.
+	OverlayDB target = State::openDB(c_memoryDBPath);
+	StateDownload d(target);
+	BOOST_CHECK(!d.isActive());
+	d.begin(s.rootHash());
+	BOOST_CHECK(d.isActive());
+
+	// Two peers at once, one of which never gives some of what it is asked for, and one that gives up.
+	unsigned rounds = 0;
+	while (d.isActive() && rounds++ < 10000)
+	{
+		auto a = d.nextFetch(16);
+		auto b = d.nextFetch(16);
+		for (auto const& h: a)
+			BOOST_REQUIRE(find(b.begin(), b.end(), h) == b.end());
+		bytes fromA = answer(source, a, 3);
+		bytes fromB = answer(source, b, 0);
+		if (rounds % 7)
+			d.noteNodes(b, RLP(fromB));
+		else
+			d.giveBack(b);
+		d.noteNodes(a, RLP(fromA));
+	}
+	BOOST_REQUIRE(d.isComplete());
+	BOOST_CHECK(d.nextFetch(16).empty());
+	BOOST_CHECK_EQUAL(d.progress().second, 0u);
+	for (auto const& n: source.get())
+		BOOST_CHECK(target.lookup(n.first) == n.second);
+	BOOST_CHECK_EQUAL(d.progress().first, source.get().size());
+
+	// Nothing is asked for that is already there.
+	StateDownload again(target);
+	again.begin(s.rootHash());
+	BOOST_CHECK(again.isComplete());
+	BOOST_CHECK(again.nextFetch(16).empty());
+}
+
+BOOST_AUTO_TEST_CASE(stateDownloadIgnoresUnasked)
+{
+	State s(OverlayDB(), BaseState::Empty);
+	s.addBalance(Address(1), 1);
+	s.commit();
+
+	OverlayDB target = State::openDB(c_memoryDBPath);
+	StateDownload d(target);
+	d.begin(s.rootHash());
+	auto asked = d.nextFetch(16);
+	BOOST_REQUIRE_EQUAL(asked.size(), 1u);
+
+	// What was not asked for, or does not hash to it, is dropped and the root asked for again.
+	RLPStream bogus(2);
+	bogus << string("not a node") << bytes(32, 0);
+	BOOST_CHECK_EQUAL(d.noteNodes(asked, RLP(bogus.out())), 0u);
+	BOOST_CHECK(!target.exists(s.rootHash()));
+	asked = d.nextFetch(16);
+	BOOST_REQUIRE_EQUAL(asked.size(), 1u);
+	bytes root = answer(s.db(), asked, 0);
+	BOOST_CHECK_EQUAL(d.noteNodes(asked, RLP(root)), 1u);
+	BOOST_CHECK(d.isComplete());
+	BOOST_CHECK(target.exists(s.rootHash()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -44,6 +44,152 @@ BOOST_AUTO_TEST_CASE(Basic)
 	State s;
 }
 
+BOOST_AUTO_TEST_CASE(Checkpoints)
+{
+	State s;
+	Address a(1);
+	Address b(2);
+	s.addBalance(a, 100);
+
+	size_t outer = s.checkpoint();
+	s.addBalance(a, 50);
+	s.addBalance(b, 7);
+	s.setStorage(a, 1, 2);
+
+	size_t inner = s.checkpoint();
+	s.setStorage(a, 1, 3);
+	s.subBalance(a, 20);
+	s.revertToCheckpoint(inner);
+	BOOST_CHECK_EQUAL(s.storage(a, 1), 2);
+	BOOST_CHECK_EQUAL(s.balance(a), 150);
+	s.setStorage(a, 2, 4);
+	s.releaseCheckpoint();
+
+	s.revertToCheckpoint(outer);
+	s.releaseCheckpoint();
+	BOOST_CHECK_EQUAL(s.balance(a), 100);
+	BOOST_CHECK_EQUAL(s.storage(a, 1), 0);
+	BOOST_CHECK_EQUAL(s.storage(a, 2), 0);
+	BOOST_CHECK(!s.addressInUse(b));
+}
+
+BOOST_AUTO_TEST_CASE(Transfer)
+{
+	KeyPair sender = sha3("transfer sender");
+	Address miner(0x99);
+	Address to(0x1234);
+	State s(OverlayDB(), BaseState::Empty, miner);
+	s.addBalance(sender.address(), 1000000);
+
+	// To an account with no code: no VM, the same balances and receipt as one.
+	Transaction t(100, 10, 30000, to, bytes(), 0, sender.secret());
+	ExecutionResult r = s.execute(LastHashes(), t);
+	BOOST_CHECK_EQUAL(r.gasUsed, c_txGas);
+	BOOST_CHECK_EQUAL(s.balance(to), 100);
+	BOOST_CHECK_EQUAL(s.balance(miner), c_txGas * 10);
+	BOOST_CHECK_EQUAL(s.balance(sender.address()), 1000000 - 100 - c_txGas * 10);
+	BOOST_CHECK_EQUAL(s.transactionsFrom(sender.address()), 1);
+	BOOST_CHECK_EQUAL(s.receipt(0).gasUsed(), c_txGas);
+	BOOST_CHECK(s.receipt(0).log().empty());
+
+	// Nothing sent still brings the recipient into being.
+	Address none(0x5678);
+	s.execute(LastHashes(), Transaction(0, 10, 30000, none, bytes(), 1, sender.secret()));
+	BOOST_CHECK(s.addressInUse(none));
+}
+
+BOOST_AUTO_TEST_CASE(TraceAccesses)
+{
+	KeyPair sender = sha3("trace sender");
+	State s(OverlayDB(), BaseState::Empty, Address(0x99));
+	s.addBalance(sender.address(), 10000000);
+	// Deploys PUSH1 1 SLOAD PUSH1 2 SSTORE: reads slot 1 and writes slot 2.
+	bytes init = {0x65, 0x60, 0x01, 0x54, 0x60, 0x02, 0x55, 0x60, 0x00, 0x52, 0x60, 0x06, 0x60, 0x1a, 0xf3};
+	Address to = s.execute(LastHashes(), Transaction(0, 10, 100000, init, 0, sender.secret())).newAddress;
+	BOOST_REQUIRE(s.addressHasCode(to));
+
+	Transaction t(0, 10, 50000, to, bytes(), 1, sender.secret());
+	ExecutionResult r = s.execute(LastHashes(), t, Permanence::Reverted, Tracing::Accesses);
+	AccessSet const& a = r.accesses;
+	BOOST_CHECK_EQUAL(a.accounts.at(sender.address()), AccessSet::Read | AccessSet::Written);
+	BOOST_CHECK(a.code.count(to));
+	BOOST_CHECK_EQUAL(a.storage.at(make_pair(to, u256(1))), AccessSet::Read);
+	BOOST_CHECK_EQUAL(a.storage.at(make_pair(to, u256(2))), AccessSet::Written);
+
+	// Untraced, nothing is noted.
+	BOOST_CHECK(s.execute(LastHashes(), t, Permanence::Reverted).accesses.empty());
+}
+
+BOOST_AUTO_TEST_CASE(StorageOverlaySlots)
+{
+	Account a(0, 0, EmptyTrie, EmptySHA3, Account::Unchanged);
+	a.noteStorage(1, 2);
+	BOOST_CHECK(!a.isDirty());
+	a.setStorage(1, 3);
+	BOOST_CHECK(a.storageOverlay().dirty());
+	a.setStorage(1, 2);
+	BOOST_CHECK(!a.storageOverlay().dirty());
+	a.setStorage(7, 0);
+	BOOST_CHECK(a.storageOverlay().find(7)->dirty());
+
+	// Against a map, through enough inserts and erases to grow and shift the table.
+	StorageOverlay o;
+	map<u256, u256> m;
+	for (unsigned i = 0; i < 5000; ++i)
+	{
+		u256 k = i % 2 ? u256(sha3(toString(i % 700))) : u256(i % 300);
+		if (i % 3)
+			o.set(k, i), m[k] = i;
+		else
+			o.erase(k), m.erase(k);
+	}
+	BOOST_REQUIRE_EQUAL(o.size(), m.size());
+	for (auto const& i: m)
+		BOOST_CHECK(o.find(i.first) && o.find(i.first)->value == i.second);
+	o.forEach([&](StorageOverlay::Slot const& s) { BOOST_CHECK(m.count(s.key)); });
+}
+
+BOOST_AUTO_TEST_CASE(SettledCommits)
+{
+	Account a(0, 0, EmptyTrie, EmptySHA3, Account::Unchanged);
+	a.noteStorage(1, 2);
+	a.setStorage(3, 4);
+	BOOST_CHECK_EQUAL(a.changes().storageOverlay().size(), 1);
+	a.settle();
+	BOOST_CHECK(!a.isDirty());
+	BOOST_CHECK(!a.storageOverlay().dirty());
+	BOOST_CHECK_EQUAL(a.storageOverlay().find(3)->value, 4);
+
+	Account f(0, Account::ContractConception);
+	f.setCode(bytes{1, 2, 3});
+	f.settle();
+	BOOST_CHECK(!f.isFreshCode());
+	BOOST_CHECK_EQUAL(f.codeHash(), sha3(bytes{1, 2, 3}));
+
+	// Committed one after the other over the storage root left by the first, as with the whole at once.
+	Address x(0x42);
+	MemoryDB db;
+	SecureTrieDB<Address, MemoryDB> state(&db);
+	state.init();
+	map<Address, Account> first = {{ x, Account(1, 0, EmptyTrie, EmptySHA3, Account::Changed) }};
+	first[x].setStorage(1, 5);
+	map<Address, h256> roots;
+	dev::eth::commit(first, db, state, &roots);
+	map<Address, Account> second = {{ x, Account(1, 0, EmptyTrie, EmptySHA3, Account::Changed) }};
+	second[x].setStorage(2, 6);
+	second[x].rebase(roots[x]);
+	dev::eth::commit(second, db, state, &roots);
+
+	MemoryDB db2;
+	SecureTrieDB<Address, MemoryDB> state2(&db2);
+	state2.init();
+	map<Address, Account> whole = {{ x, Account(1, 0, EmptyTrie, EmptySHA3, Account::Changed) }};
+	whole[x].setStorage(1, 5);
+	whole[x].setStorage(2, 6);
+	dev::eth::commit(whole, db2, state2);
+	BOOST_CHECK_EQUAL(state.root(), state2.root());
+}
+
 BOOST_AUTO_TEST_CASE(Complex)
 {
 	cnote << "Testing State...";
@@ -0,0 +1,57 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file stateView.cpp
+ * @date 2015
+ * StateView test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libethereum/StateView.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+BOOST_AUTO_TEST_SUITE(StateViewTests)
+
+BOOST_AUTO_TEST_CASE(stateViewReads)
+{
+	State s(OverlayDB(), BaseState::Empty);
+	Address a(1);
+	s.addBalance(a, 100);
+	Address c = s.newContract(5, bytes{0x60, 0x00});
+	s.setStorage(c, 1, 42);
+	s.commit();
+
+	// Uncommitted changes are seen too.
+	s.addBalance(a, 1);
+	StateView v(s);
+	BOOST_CHECK_EQUAL(v.balance(a), 101);
+	BOOST_CHECK_EQUAL(v.balance(c), 5);
+	BOOST_CHECK_EQUAL(v.balance(Address(2)), 0);
+	BOOST_CHECK_EQUAL(v.storage(c, 1), 42);
+	BOOST_CHECK_EQUAL(v.storage(c, 2), 0);
+	BOOST_CHECK(v.code(c) == bytes({0x60, 0x00}));
+	BOOST_CHECK(v.code(a).empty());
+
+	// Later changes to the state do not reach the view.
+	s.addBalance(a, 1);
+	BOOST_CHECK_EQUAL(v.balance(a), 101);
+	BOOST_CHECK_EQUAL(v.copy().balance(a), 101);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file stepTrace.cpp
+ * @date 2015
+ * StepTrace tests.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libevm/VM.h>
+#include <libethereum/Executive.h>
+#include <libethereum/ExtVM.h>
+#include <libethereum/StepTrace.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+BOOST_AUTO_TEST_SUITE(StepTraceTests)
+
+BOOST_AUTO_TEST_CASE(rebuildsEveryStep)
+{
+	State s(OverlayDB(), BaseState::Empty);
+	// Ten times: mstore(i, i); sstore(i, i); then stop.
+	Address inner = s.newContract(0, bytes{0x60, 0x0a, 0x5b, 0x80, 0x80, 0x52, 0x80, 0x80, 0x55, 0x60, 0x01, 0x90, 0x03, 0x80, 0x60, 0x02, 0x57, 0x00});
+	// call(0xfffff, inner, 0, 0, 0, 0, 0); sstore(3, 7); stop.
+	bytes outerCode{0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x60, 0x00, 0x73};
+	outerCode += inner.asBytes();
+	outerCode += bytes{0x62, 0x0f, 0xff, 0xff, 0xf1, 0x60, 0x07, 0x60, 0x03, 0x55, 0x00};
+	Address outer = s.newContract(0, outerCode);
+	Address sender(0x99);
+	s.addBalance(sender, 1000000);
+
+	StepTrace trace(4);
+	OnOpFunc record = trace.onOp();
+	vector<TraceStep> full;
+	auto both = [&](uint64_t _steps, Instruction _inst, bigint _newMemSize, bigint _gasCost, VM* _vm, ExtVMFace const* _ext)
+	{
+		ExtVM const& ext = *static_cast<ExtVM const*>(_ext);
+		TraceStep t;
+		t.pc = _vm->curPC();
+		t.depth = ext.depth;
+		t.stack = _vm->stack();
+		t.memory = _vm->memory();
+		t.storage = ext.state().storage(ext.myAddress);
+		full.push_back(t);
+		record(_steps, _inst, _newMemSize, _gasCost, _vm, _ext);
+	};
+
+	LastHashes lastHashes(256);
+	Executive e(s, lastHashes, 0);
+	BOOST_REQUIRE(!e.call(outer, outer, sender, 0, 0, bytesConstRef(), 1000000, sender));
+	e.go(both);
+
+	BOOST_REQUIRE_EQUAL(trace.size(), full.size());
+	BOOST_REQUIRE(full.size() > 100);
+	BOOST_CHECK_EQUAL(trace.codes().size(), 2u);
+	auto check = [&](size_t _i)
+	{
+		TraceStep t = trace.at(_i);
+		BOOST_CHECK_EQUAL(t.pc, full[_i].pc);
+		BOOST_CHECK_EQUAL(t.depth, full[_i].depth);
+		BOOST_CHECK_EQUAL(t.levels.size(), t.depth);
+		BOOST_CHECK(t.stack == full[_i].stack);
+		BOOST_CHECK(t.memory == full[_i].memory);
+		BOOST_CHECK(t.storage == full[_i].storage);
+		BOOST_CHECK(trace.codes()[t.code].address == (t.depth ? inner : outer));
+	};
+	// Forwards, as a debugger steps, then backwards, each step from its checkpoint.
+	for (size_t i = 0; i < full.size(); ++i)
+		check(i);
+	for (size_t i = full.size(); i > 0; --i)
+		check(i - 1);
+	BOOST_CHECK(trace.at(full.size() - 1, false).memory.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
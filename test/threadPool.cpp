@@ -0,0 +1,155 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file threadPool.cpp
+ * @date 2015
+ * ThreadPool and Worker test functions.
+ */
+
+#include <atomic>
+#include <boost/test/unit_test.hpp>
+#include <libdevcore/ThreadPool.h>
+#include <libdevcore/Worker.h>
+
+using namespace std;
+using namespace dev;
+
+namespace
+{
+
+class CountingWorker: public Worker
+{
+public:
+	CountingWorker(unsigned _idleWaitMs, WorkerMode _mode): Worker("count", _idleWaitMs, _mode) {}
+	~CountingWorker() { stopWorking(); }
+
+	using Worker::startWorking;
+	using Worker::stopWorking;
+	using Worker::wake;
+
+	atomic<unsigned> started{0};
+	atomic<unsigned> cycles{0};
+	atomic<unsigned> done{0};
+
+private:
+	void startedWorking() override { ++started; }
+	void doWork() override { ++cycles; }
+	void doneWorking() override { ++done; }
+};
+
+/// Waits up to a few seconds for @a _c to hold.
+template <class C> bool eventually(C _c)
+{
+	for (unsigned i = 0; i < 500 && !_c(); ++i)
+		this_thread::sleep_for(chrono::milliseconds(10));
+	return _c();
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE(ThreadPoolTests)
+
+BOOST_AUTO_TEST_CASE(threadPoolSubmit)
+{
+	ThreadPool pool(3);
+	vector<future<unsigned>> results;
+	for (unsigned i = 0; i < 100; ++i)
+		results.push_back(pool.submit([=]() { return i * i; }));
+	for (unsigned i = 0; i < 100; ++i)
+		BOOST_CHECK_EQUAL(results[i].get(), i * i);
+
+	auto thrown = pool.submit([]() -> int { throw runtime_error("x"); });
+	BOOST_CHECK_THROW(thrown.get(), runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(threadPoolForRange)
+{
+	for (unsigned threads: {0u, 1u, 4u})
+	{
+		ThreadPool pool(threads);
+		vector<atomic<unsigned>> hits(10007);
+		for (auto& h: hits)
+			h = 0;
+		pool.forRange(0, hits.size(), [&](size_t _b, size_t _e)
+		{
+			for (size_t i = _b; i < _e; ++i)
+				++hits[i];
+		}, 100);
+		for (auto const& h: hits)
+			BOOST_REQUIRE_EQUAL(h, 1u);
+
+		// Nested loops, posting from the pool's own threads.
+		atomic<unsigned> sum{0};
+		pool.forEach(8, [&](unsigned)
+		{
+			pool.forEach(8, [&](unsigned _j) { sum += _j; });
+		});
+		BOOST_CHECK_EQUAL(sum, 8u * 28);
+
+		BOOST_CHECK_THROW(pool.forEach(16, [](unsigned _i) { if (_i == 5) throw runtime_error("x"); }), runtime_error);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(threadPoolPriority)
+{
+	ThreadPool pool(1);
+	mutex block;
+	block.lock();
+	pool.post([&]() { lock_guard<mutex> l(block); });
+	vector<int> order;
+	mutex x_order;
+	auto note = [&](int _i) { return [&, _i]() { lock_guard<mutex> l(x_order); order.push_back(_i); }; };
+	pool.post(note(3), TaskPriority::Low);
+	pool.post(note(2), TaskPriority::Normal);
+	pool.post(note(1), TaskPriority::High);
+	block.unlock();
+	pool.submit([]() {}, TaskPriority::Low).get();
+	BOOST_CHECK(order == vector<int>({1, 2, 3}));
+}
+
+BOOST_AUTO_TEST_CASE(threadPoolSchedule)
+{
+	ThreadPool pool(2);
+	auto start = ThreadPool::Clock::now();
+	promise<ThreadPool::Clock::time_point> ran;
+	pool.schedule(chrono::milliseconds(50), [&]() { ran.set_value(ThreadPool::Clock::now()); });
+	BOOST_CHECK(ran.get_future().get() - start >= chrono::milliseconds(50));
+}
+
+BOOST_AUTO_TEST_CASE(workerWake)
+{
+	for (WorkerMode mode: {WorkerMode::Thread, WorkerMode::Pool})
+	{
+		// Long enough an idle wait that only wake() gets doWork() called again within the test.
+		CountingWorker w(60000, mode);
+		w.startWorking();
+		this_thread::sleep_for(chrono::milliseconds(20));
+		BOOST_CHECK_EQUAL(w.cycles, 0u);
+		w.wake();
+		BOOST_CHECK(eventually([&]() { return w.cycles == 1; }));
+		w.wake();
+		BOOST_CHECK(eventually([&]() { return w.cycles == 2; }));
+		w.stopWorking();
+		BOOST_CHECK_EQUAL(w.started, 1u);
+		BOOST_CHECK_EQUAL(w.done, 1u);
+		unsigned cycles = w.cycles;
+		w.wake();
+		this_thread::sleep_for(chrono::milliseconds(20));
+		BOOST_CHECK_EQUAL(w.cycles, cycles);
+	}
+}
+
+BOOST_AUTO_TEST_SUITE_END()
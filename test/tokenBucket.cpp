@@ -0,0 +1,52 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file tokenBucket.cpp
+ * @date 2015
+ * TokenBucket test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libp2p/TokenBucket.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::p2p;
+
+BOOST_AUTO_TEST_SUITE(TokenBucketTests)
+
+BOOST_AUTO_TEST_CASE(tokenBucketUnlimited)
+{
+	TokenBucket b;
+	TokenBucket::Clock::duration wait;
+	for (unsigned i = 0; i < 100; ++i)
+		BOOST_CHECK(b.take(1 << 20, wait));
+}
+
+BOOST_AUTO_TEST_CASE(tokenBucketDebt)
+{
+	TokenBucket b(1000);
+	TokenBucket::Clock::duration wait;
+	// A second's worth, then more than that at once, which puts it in debt.
+	BOOST_CHECK(b.take(600, wait));
+	BOOST_CHECK(b.take(2400, wait));
+	BOOST_CHECK(!b.take(1, wait));
+	// About two seconds to pay off 2000 bytes at 1000 a second.
+	BOOST_CHECK(wait > chrono::milliseconds(1900));
+	BOOST_CHECK(wait <= chrono::seconds(2));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -176,7 +176,7 @@ BOOST_AUTO_TEST_CASE(ttCreateTest)
 				json_spirit::mValue v;
 				string s = asString(dev::contents(boost::unit_test::framework::master_test_suite().argv[i + 1]));
 				BOOST_REQUIRE_MESSAGE(s.length() > 0, "Content of " + (string)boost::unit_test::framework::master_test_suite().argv[i + 1] + " is empty.");
-				json_spirit::read_string(s, v);
+				dev::test::readJson(s, v);
 				dev::test::doTransactionTests(v, true);
 				writeFile(boost::unit_test::framework::master_test_suite().argv[i + 2], asBytes(json_spirit::write_string(v, true)));
 			}
@@ -192,6 +192,28 @@ BOOST_AUTO_TEST_CASE(ttCreateTest)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(ttDecodeBatch)
+{
+	RLPStream s(17);
+	vector<KeyPair> keys;
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		keys.push_back(KeyPair::create());
+		s.appendRaw(Transaction(i, 1, 30000, Address(i), bytes(), 0, keys.back().secret()).rlp());
+	}
+	s.appendRaw(rlpList(0, 1, 30000, Address(), 0, bytes(), 29, 1, 1));
+	bytes txs = s.out();
+
+	DecodedTransactions decoded = decodeTransactions(RLP(txs));
+	BOOST_REQUIRE_EQUAL(decoded.size(), 17u);
+	for (unsigned i = 0; i < 16; ++i)
+	{
+		BOOST_CHECK(!decoded[i].error);
+		BOOST_CHECK(decoded[i].get().sender() == keys[i].address());
+	}
+	BOOST_CHECK_THROW(decoded[16].get(), InvalidSignature);
+}
+
 BOOST_AUTO_TEST_CASE(userDefinedFile)
 {
 	dev::test::userDefinedTest("--singletest", dev::test::doTransactionTests);
@@ -0,0 +1,197 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file transactionQueue.cpp
+ * @date 2015
+ * TransactionQueue test functions.
+ */
+
+#include <boost/test/unit_test.hpp>
+#include <libdevcrypto/KeyValueDB.h>
+#include <libethereum/CanonBlockChain.h>
+#include <libethereum/State.h>
+#include <libethereum/TransactionQueue.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+bytes tx(KeyPair const& _k, unsigned _nonce, unsigned _gasPrice)
+{
+	return Transaction(0, _gasPrice, 21000, Address(), bytes(), _nonce, _k.secret()).rlp();
+}
+
+vector<u256> nonces(vector<pair<h256, Transaction>> const& _ts)
+{
+	vector<u256> ret;
+	for (auto const& t: _ts)
+		ret.push_back(t.second.nonce());
+	return ret;
+}
+
+/// Asks nothing, so that any transaction may go in.
+class FreeGasPricer: public GasPricer
+{
+	u256 ask(State const&) const override { return 0; }
+	u256 bid(TransactionPriority) const override { return 0; }
+};
+}
+
+BOOST_AUTO_TEST_SUITE(TransactionQueueTests)
+
+BOOST_AUTO_TEST_CASE(tqNonceGap)
+{
+	KeyPair k = KeyPair::create();
+	TransactionQueue q;
+	BOOST_CHECK(q.import(tx(k, 0, 1)) == ImportResult::Success);
+	BOOST_CHECK(q.import(tx(k, 2, 1)) == ImportResult::Success);
+	BOOST_CHECK(q.import(tx(k, 3, 1)) == ImportResult::Success);
+	BOOST_CHECK_EQUAL(q.items().first, 1u);
+	BOOST_CHECK_EQUAL(q.items().second, 2u);
+
+	// Filling the gap promotes those after it.
+	BOOST_CHECK(q.import(tx(k, 1, 1)) == ImportResult::Success);
+	BOOST_CHECK_EQUAL(q.items().first, 4u);
+	BOOST_CHECK(nonces(q.topTransactions()) == vector<u256>({0, 1, 2, 3}));
+
+	// The sender's account is past its first; all wait until told otherwise.
+	auto ts = q.topTransactions();
+	q.setFuture(ts[0]);
+	BOOST_CHECK_EQUAL(q.items().first, 0u);
+	BOOST_CHECK(q.noteGood(ts[0]));
+	BOOST_CHECK_EQUAL(q.items().first, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(tqPriceOrder)
+{
+	KeyPair a = KeyPair::create();
+	KeyPair b = KeyPair::create();
+	TransactionQueue q;
+	q.import(tx(a, 0, 1));
+	q.import(tx(a, 1, 5));
+	q.import(tx(b, 0, 3));
+
+	// b's goes first, but a's second cannot go ahead of a's first.
+	auto ts = q.topTransactions();
+	BOOST_REQUIRE_EQUAL(ts.size(), 3u);
+	BOOST_CHECK_EQUAL(ts[0].second.sender(), b.address());
+	BOOST_CHECK(nonces(ts) == vector<u256>({0, 0, 1}));
+
+	// Replacing needs a higher price.
+	BOOST_CHECK(q.import(tx(b, 0, 3)) == ImportResult::AlreadyKnown);
+	BOOST_CHECK(q.import(tx(b, 0, 2)) == ImportResult::AlreadyKnown);
+	BOOST_CHECK(q.import(tx(b, 0, 4)) == ImportResult::Success);
+	BOOST_CHECK_EQUAL(q.items().first, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(tqEviction)
+{
+	KeyPair a = KeyPair::create();
+	KeyPair b = KeyPair::create();
+	TransactionQueue q(2, 1);
+	q.import(tx(a, 0, 1));
+	q.import(tx(a, 1, 10));
+	BOOST_CHECK(q.import(tx(b, 0, 5)) == ImportResult::Success);
+
+	// a's first went as the cheapest, leaving its second future.
+	BOOST_CHECK_EQUAL(q.items().first, 1u);
+	BOOST_CHECK_EQUAL(q.items().second, 1u);
+
+	// The cheapest of a full pool is turned away.
+	BOOST_CHECK(q.import(tx(b, 1, 2)) == ImportResult::AlreadyKnown);
+	q.setLimits(1, 0);
+	BOOST_CHECK_EQUAL(q.items().first, 1u);
+	BOOST_CHECK_EQUAL(q.items().second, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(tqImportSigned)
+{
+	// A transaction signed here comes with its sender, and is queued as its RLP would be.
+	KeyPair k = KeyPair::create();
+	Transaction t(0, 1, 21000, Address(), bytes(), 0, k.secret());
+	BOOST_CHECK(t.sender() == k.address());
+	BOOST_CHECK(Transaction(t.rlp(), CheckTransaction::Everything).sender() == k.address());
+	TransactionQueue q;
+	BOOST_CHECK(q.import(t) == ImportResult::Success);
+	BOOST_CHECK(q.import(t.rlp()) == ImportResult::AlreadyKnown);
+	BOOST_CHECK(q.contains(t.sha3()));
+}
+
+BOOST_AUTO_TEST_CASE(tqRemembersBad)
+{
+	KeyPair k = KeyPair::create();
+	bytes good = tx(k, 0, 1);
+	RLPStream t(9);
+	t << 0 << 1 << 21000 << Address() << 0 << bytes() << 30 << 1 << 1;
+	bytes bad = t.out();
+	TransactionQueue q;
+	BOOST_CHECK(q.import(bad) == ImportResult::Malformed);
+	BOOST_CHECK(q.isBad(sha3(bad)));
+	BOOST_CHECK(q.import(bad) == ImportResult::Malformed);
+	BOOST_CHECK(!q.isBad(sha3(good)));
+
+	// In a batch too, and without holding up the good.
+	RLPStream s(2);
+	s.appendRaw(bad).appendRaw(good);
+	bytes batch = s.out();
+	auto rs = q.importBatch(RLP(batch));
+	BOOST_REQUIRE_EQUAL(rs.size(), 2u);
+	BOOST_CHECK(rs[0] == ImportResult::Malformed);
+	BOOST_CHECK(rs[1] == ImportResult::Success);
+
+	// Only so many are remembered.
+	for (unsigned i = 0; i < TransactionQueue::c_maxBad; ++i)
+		q.import(rlp(i));
+	BOOST_CHECK(!q.isBad(sha3(bad)));
+}
+
+BOOST_AUTO_TEST_CASE(tqSyncPacksBestPayingFirst)
+{
+	KeyPair a = KeyPair::create();
+	KeyPair b = KeyPair::create();
+	KeyPair poor = KeyPair::create();
+	CanonBlockChain bc(c_memoryDBPath);
+	State s(State::openDB(c_memoryDBPath), BaseState::CanonGenesis, Address());
+	s.sync(bc);
+	s.addBalance(a.address(), ether);
+	s.addBalance(b.address(), ether);
+
+	TransactionQueue q;
+	q.import(tx(a, 0, 1));
+	q.import(tx(a, 1, 5));
+	q.import(tx(b, 0, 3));
+	q.import(tx(b, 2, 9));
+	q.import(tx(poor, 0, 7));
+
+	// b's goes in first; a's in nonce order; that which cannot pay is dropped and that after a gap waits.
+	bool changed = false;
+	FreeGasPricer gp;
+	TransactionReceipts rs = s.sync(bc, q, gp, &changed);
+	BOOST_REQUIRE_EQUAL(rs.size(), 3u);
+	BOOST_CHECK_EQUAL(s.pending()[0].sender(), b.address());
+	BOOST_CHECK_EQUAL(s.pending()[1].sender(), a.address());
+	BOOST_CHECK_EQUAL(s.pending()[2].nonce(), 1);
+	BOOST_CHECK(changed);
+	BOOST_CHECK_EQUAL(q.items().first, 3u);
+	BOOST_CHECK_EQUAL(q.items().second, 1u);
+
+	// Nothing is left to go in.
+	BOOST_CHECK(s.sync(bc, q, gp).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -23,10 +23,13 @@
 #include <fstream>
 #include <random>
 
+#include <boost/filesystem.hpp>
 #include <boost/test/unit_test.hpp>
 
 #include "JsonSpiritHeaders.h"
 #include <libdevcore/CommonIO.h>
+#include <libdevcore/TransientDirectory.h>
+#include <libdevcrypto/OverlayDB.h>
 #include <libdevcrypto/TrieDB.h>
 #include "TrieHash.h"
 #include "MemTrie.h"
@@ -474,6 +477,433 @@ BOOST_AUTO_TEST_CASE(trieLowerBound)
 	}
 }
 
+BOOST_AUTO_TEST_CASE(trieNodeCache)
+{
+	cnote << "Testing the trie node cache...";
+	MemoryDB dm;
+	OverlayDB om;
+	GenericTrieDB<MemoryDB> d(&dm);
+	GenericTrieDB<OverlayDB> o(&om);
+	d.init();
+	o.init();
+	BOOST_REQUIRE(om.nodeCache());
+	StringMap m;
+	for (int i = 0; i < 200; ++i)
+	{
+		auto k = randomWord();
+		auto v = toString(i);
+		m[k] = v;
+		d.insert(k, v);
+		o.insert(k, v);
+	}
+	BOOST_REQUIRE_EQUAL(d.root(), o.root());
+
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		for (auto const& i: m)
+			BOOST_REQUIRE_EQUAL(o.at(i.first), i.second);
+		for (unsigned i = 0; i < 100; ++i)
+		{
+			auto k = randomWord();
+			BOOST_REQUIRE_EQUAL(o.at(k), d.at(k));
+		}
+	}
+	auto c = om.nodeCache();
+	BOOST_CHECK(c->hits() > c->misses());
+
+	// Copies of the database share the cache; it is bypassed while references are enforced.
+	OverlayDB copy = om;
+	BOOST_CHECK_EQUAL(copy.nodeCache(), c);
+	EnforceRefs e(om, true);
+	BOOST_CHECK(!om.nodeCache());
+}
+
+BOOST_AUTO_TEST_CASE(trieApply)
+{
+	cnote << "Testing batched trie updates...";
+	MemoryDB dm;
+	MemoryDB bm;
+	EnforceRefs ed(dm, true);
+	EnforceRefs eb(bm, true);
+	GenericTrieDB<MemoryDB> d(&dm);
+	GenericTrieDB<MemoryDB> b(&bm);
+	d.init();
+	b.init();
+	std::vector<bytes> keys;
+	for (int a = 0; a < 10; ++a)
+	{
+		std::map<bytes, bytes> changes;
+		// The last batch is big enough to be hashed in parallel.
+		int count = a == 9 ? c_parallelTrieHashing * 4 : 100;
+		for (int i = 0; i < count; ++i)
+		{
+			bytes k = keys.size() && i % 3 == 0 ? keys[i % keys.size()] : sha3(toString(a * 10000 + i)).asBytes();
+			keys.push_back(k);
+			changes[k] = i % 4 ? asBytes(toString(i)) : bytes();
+		}
+		for (auto const& i: changes)
+			if (i.second.empty())
+				d.remove(i.first);
+			else
+				d.insert(i.first, i.second);
+		b.apply(changes);
+		BOOST_REQUIRE_EQUAL(d.root(), b.root());
+		BOOST_REQUIRE(dm.get() == bm.get());
+		BOOST_REQUIRE(b.check(true));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(nodeTable)
+{
+	cnote << "Testing MemoryDB's node table...";
+	NodeTable t;
+	std::map<h256, std::pair<unsigned, bytes>> m;
+	for (unsigned i = 0; i < 20000; ++i)
+	{
+		// Small numbers as well as hashes, and values both inline and in the arena.
+		h256 k = i % 2 ? sha3(toString(i % 3000)) : h256(i % 1000);
+		bytes v(i % (NodeTable::c_inline * 3), byte(i));
+		if (i % 5 < 3)
+		{
+			auto& s = t.insert(k);
+			t.setValue(s, &v);
+			++s.refs;
+			++m[k].first;
+			m[k].second = v;
+		}
+		else if (i % 5 == 3)
+		{
+			t.erase(k);
+			m.erase(k);
+		}
+		else if (auto s = t.find(k))
+		{
+			s->refs = 0;
+			m[k].first = 0;
+		}
+		if (i % 1000 == 999)
+		{
+			t.purge();
+			for (auto it = m.begin(); it != m.end();)
+				it = it->second.first ? next(it) : m.erase(it);
+		}
+	}
+
+	BOOST_REQUIRE_EQUAL(t.size(), m.size());
+	t.forEach([&](NodeTable::Slot const& s)
+	{
+		BOOST_REQUIRE(m.count(s.key));
+		BOOST_CHECK_EQUAL(s.refs, m[s.key].first);
+		BOOST_CHECK(t.value(s).contentsEqual(m[s.key].second));
+	});
+	for (auto const& i: m)
+		BOOST_CHECK(t.find(i.first));
+}
+
+BOOST_AUTO_TEST_CASE(memoryDBCopyOnWrite)
+{
+	cnote << "Testing copies of a MemoryDB...";
+	MemoryDB m;
+	EnforceRefs e(m, true);
+	GenericTrieDB<MemoryDB> t(&m);
+	t.init();
+	for (unsigned i = 0; i < 100; ++i)
+		t.insert(asBytes(toString(i)), asBytes(toString(i * i)));
+	h256 root = t.root();
+	auto nodes = m.get();
+
+	// Both share the nodes until the copy is changed; after, each sees only its own.
+	MemoryDB c = m;
+	GenericTrieDB<MemoryDB> ct(&c);
+	ct.setRoot(root);
+	BOOST_CHECK(c.get() == nodes);
+	for (unsigned i = 0; i < 50; ++i)
+		ct.remove(asBytes(toString(i)));
+	ct.insert(asBytes("new"), asBytes("value"));
+	BOOST_CHECK(m.get() == nodes);
+	BOOST_CHECK_EQUAL(t.root(), root);
+	BOOST_CHECK(t.check(true));
+	BOOST_CHECK(ct.check(true));
+	BOOST_CHECK_EQUAL(t.at(asBytes("7")), "49");
+	BOOST_CHECK_EQUAL(ct.at(asBytes("7")), "");
+	BOOST_CHECK_EQUAL(ct.at(asBytes("new")), "value");
+}
+
+BOOST_AUTO_TEST_CASE(triePruning)
+{
+	cnote << "Testing state DB pruning...";
+	TransientDirectory dir;
+	auto kv = KeyValueDB::open(dir.path() + "/state");
+	BOOST_REQUIRE(kv);
+	OverlayDB db(kv);
+	unsigned const history = 4;
+	BOOST_REQUIRE(db.setPruning(history));
+	std::map<unsigned, h256> canon;
+	db.setCanonical([&](unsigned _n){ return canon.count(_n) ? canon[_n] : h256(); });
+
+	GenericTrieDB<OverlayDB> t(&db);
+	t.init();
+	db.commit();
+	std::vector<h256> roots;
+	std::vector<std::map<bytes, bytes>> contents(1);
+	roots.push_back(t.root());
+	h256 forkRoot;
+	for (unsigned era = 1; era <= 20; ++era)
+	{
+		if (era == 10)
+		{
+			// A block of the same era that does not make it into the chain.
+			OverlayDB fdb = db;
+			GenericTrieDB<OverlayDB> f(&fdb);
+			f.setRoot(t.root());
+			f.insert(asBytes("fork"), asBytes("never canonical"));
+			forkRoot = f.root();
+			fdb.commit(era, sha3("fork"));
+		}
+		contents.push_back(contents.back());
+		for (unsigned i = 0; i < 10; ++i)
+		{
+			bytes k = sha3(toString(i * 7 % 30 + era % 3)).asBytes();
+			bytes v = asBytes(toString(era * 100 + i));
+			t.insert(k, v);
+			contents.back()[k] = v;
+		}
+		canon[era] = sha3(toString(era));
+		db.commit(era, canon[era]);
+		roots.push_back(t.root());
+	}
+	db.flush();
+
+	for (unsigned era = 0; era < roots.size(); ++era)
+		if (era + history >= 20)
+		{
+			GenericTrieDB<OverlayDB> r(&db);
+			r.setRoot(roots[era]);
+			std::map<bytes, bytes> got;
+			for (auto i: r)
+				got[i.first.toBytes()] = i.second.toBytes();
+			BOOST_CHECK(got == contents[era]);
+		}
+		else
+			BOOST_CHECK(!db.exists(roots[era]) || roots[era] == roots.back());
+	BOOST_CHECK(!db.exists(forkRoot));
+}
+
+BOOST_AUTO_TEST_CASE(keyValueBackends)
+{
+	cnote << "Testing key-value DB backends...";
+	TransientDirectory dir;
+	for (auto backend: { DBBackend::LevelDB, DBBackend::Memory })
+	{
+		DBOptions o;
+		o.backend = backend;
+		auto dbs = KeyValueDB::open(dir.path() + "/" + toString(backend), {"a", "b"}, o);
+		BOOST_REQUIRE_EQUAL(dbs.size(), 2u);
+		auto a = dbs[0];
+		auto b = dbs[1];
+
+		a->insert(bytesConstRef("k2"), bytesConstRef("two"));
+		auto batch = a->batch();
+		batch->insert(bytesConstRef("k1"), bytesConstRef("one"));
+		batch->insert(bytesConstRef("k3"), bytesConstRef("three"));
+		batch->kill(bytesConstRef("k2"));
+		BOOST_REQUIRE(a->write(*batch));
+		BOOST_CHECK_EQUAL(a->lookup(bytesConstRef("k1")), "one");
+		BOOST_CHECK(!a->exists(bytesConstRef("k2")));
+		BOOST_CHECK(!b->exists(bytesConstRef("k1")));
+
+		auto snapshot = a->snapshot();
+		a->insert(bytesConstRef("k0"), bytesConstRef("zero"));
+		a->kill(bytesConstRef("k3"));
+		BOOST_CHECK_EQUAL(snapshot->lookup(bytesConstRef("k3")), "three");
+		BOOST_CHECK(!snapshot->exists(bytesConstRef("k0")));
+
+		strings keys;
+		a->forEach(bytesConstRef("k1"), [&](bytesConstRef _key, bytesConstRef){ keys.push_back(_key.toString()); return true; });
+		BOOST_CHECK(keys == strings{"k1"});
+		keys.clear();
+		snapshot->forEach([&](bytesConstRef _key, bytesConstRef){ keys.push_back(_key.toString()); return keys.size() < 1; });
+		BOOST_CHECK(keys == strings{"k1"});
+	}
+}
+
+BOOST_AUTO_TEST_CASE(keyValueTuning)
+{
+	cnote << "Testing key-value DB tuning...";
+	TransientDirectory dir;
+	DBOptions tuned;
+	tuned.blockCacheSize = 1024 * 1024;
+	tuned.writeBufferSize = 1024 * 1024;
+	tuned.bloomBitsPerKey = 10;
+	tuned.maxOpenFiles = 64;
+	tuned.compression = false;
+	auto dbs = KeyValueDB::open(dir.path(), {"a", "b"}, {DBOptions(), tuned});
+	BOOST_REQUIRE_EQUAL(dbs.size(), 2u);
+	for (auto const& db: dbs)
+	{
+		for (unsigned i = 0; i < 1000; ++i)
+			db->insert(bytesConstRef(toString(i)), bytesConstRef(toString(i * 3)));
+		BOOST_CHECK_EQUAL(db->lookup(bytesConstRef("999")), "2997");
+		BOOST_CHECK(!db->exists(bytesConstRef("1000")));
+		BOOST_CHECK(!db->property("num-files-at-level0").empty());
+		BOOST_CHECK(db->property("no-such-property").empty());
+	}
+	BOOST_CHECK(KeyValueDB::open(dir.path(), {"a", "b"}, {DBOptions()}).empty());
+}
+
+BOOST_AUTO_TEST_CASE(keyValueMemoryPath)
+{
+	cnote << "Testing key-value DBs at the memory path...";
+	BOOST_CHECK(isMemoryDBPath(c_memoryDBPath));
+	BOOST_CHECK(isMemoryDBPath(string(c_memoryDBPath) + "/state"));
+	BOOST_CHECK(!isMemoryDBPath(string(c_memoryDBPath) + "x"));
+	BOOST_CHECK(!isMemoryDBPath("/tmp/state"));
+
+	// LevelDB is asked for, but nothing may reach the disk.
+	auto dbs = KeyValueDB::open(c_memoryDBPath, {"a", "b"}, DBOptions());
+	BOOST_REQUIRE_EQUAL(dbs.size(), 2u);
+	dbs[0]->insert(bytesConstRef("k"), bytesConstRef("v"));
+	BOOST_CHECK_EQUAL(dbs[0]->lookup(bytesConstRef("k")), "v");
+	BOOST_CHECK(!dbs[1]->exists(bytesConstRef("k")));
+	BOOST_CHECK(dbs[0]->property("stats").empty());
+	BOOST_CHECK(!boost::filesystem::exists(c_memoryDBPath));
+
+	// Each is opened afresh.
+	auto again = KeyValueDB::open(string(c_memoryDBPath) + "/a");
+	BOOST_REQUIRE(again);
+	BOOST_CHECK(!again->exists(bytesConstRef("k")));
+}
+
+BOOST_AUTO_TEST_CASE(trieProofs)
+{
+	cnote << "Testing trie proofs...";
+	MemoryDB m;
+	GenericTrieDB<MemoryDB> t(&m);
+	t.init();
+	std::map<bytes, bytes> contents;
+	for (unsigned i = 0; i < 200; ++i)
+	{
+		// Short keys and values, so that some nodes are inlined in their parents.
+		bytes k = i % 2 ? sha3(toString(i)).asBytes() : asBytes(toString(i));
+		bytes v = asBytes(toString(i * 37));
+		t.insert(k, v);
+		contents[k] = v;
+	}
+
+	std::string v;
+	for (auto const& i: contents)
+	{
+		auto proof = t.prove(&i.first);
+		BOOST_REQUIRE(verifyTrieProof(t.root(), &i.first, proof, v));
+		BOOST_CHECK(asBytes(v) == i.second);
+		BOOST_CHECK(!verifyTrieProof(sha3("other root"), &i.first, proof, v));
+	}
+
+	bytes absent = asBytes("absent");
+	auto proof = t.prove(&absent);
+	BOOST_REQUIRE(verifyTrieProof(t.root(), &absent, proof, v));
+	BOOST_CHECK(v.empty());
+
+	// Without the last node, the branch proves nothing.
+	bytes k = contents.rbegin()->first;
+	proof = t.prove(&k);
+	BOOST_REQUIRE(proof.size() > 1);
+	proof.pop_back();
+	BOOST_CHECK(!verifyTrieProof(t.root(), &k, proof, v));
+
+	// Secure tries prove under the hashed key.
+	MemoryDB sm;
+	SecureTrieDB<Address, MemoryDB> s(&sm);
+	s.init();
+	Address a(sha3("account"));
+	s.insert(a, asBytes("value"));
+	s.insert(Address(sha3("other")), asBytes("other value"));
+	BOOST_REQUIRE(verifyTrieProof(s.root(), sha3(a).ref(), s.prove(a), v));
+	BOOST_CHECK_EQUAL(v, "value");
+}
+
+BOOST_AUTO_TEST_CASE(trieRanges)
+{
+	cnote << "Testing trie ranges...";
+	MemoryDB m;
+	GenericTrieDB<MemoryDB> t(&m);
+	t.init();
+	std::map<bytes, bytes> contents;
+	for (unsigned i = 0; i < 200; ++i)
+	{
+		bytes k = sha3(toString(i)).asBytes();
+		t.insert(k, asBytes(toString(i)));
+		contents[k] = asBytes(toString(i));
+	}
+
+	// Chunks resume where the last left off, and together visit every entry once, in order.
+	std::vector<std::pair<bytes const, bytes>> seen;
+	bytes from;
+	unsigned chunks = 0;
+	do
+	{
+		from = t.forEach(&from, 7, [&](bytesConstRef _k, bytesConstRef _v){ seen.push_back(make_pair(_k.toBytes(), _v.toBytes())); });
+		++chunks;
+	}
+	while (!from.empty());
+	BOOST_CHECK_EQUAL(chunks, (200u + 6) / 7);
+	BOOST_REQUIRE_EQUAL(seen.size(), contents.size());
+	BOOST_CHECK(std::equal(seen.begin(), seen.end(), contents.begin()));
+
+	// A start key between entries begins at the next one.
+	auto second = std::next(contents.begin());
+	bytes between = contents.begin()->first;
+	between.push_back(0);
+	bytes next = t.forEach(&between, 1, [&](bytesConstRef _k, bytesConstRef){ BOOST_CHECK(_k.toBytes() == second->first); });
+	BOOST_CHECK(next == std::next(second)->first);
+}
+
+BOOST_AUTO_TEST_CASE(trieDiff)
+{
+	cnote << "Testing trie diffs...";
+	MemoryDB m;
+	GenericTrieDB<MemoryDB> t(&m);
+	t.init();
+	for (unsigned i = 0; i < 200; ++i)
+		t.insert(sha3(toString(i)).asBytes(), asBytes(toString(i)));
+	// Keys that are prefixes of others, so that values sit in branches and under extensions.
+	t.insert(asBytes("do"), asBytes("verb"));
+	t.insert(asBytes("dog"), asBytes("puppy"));
+	t.insert(asBytes("doge"), asBytes("coin"));
+
+	// A copy sharing all but the changed paths, and the same trie built anew in another DB.
+	MemoryDB m2;
+	GenericTrieDB<MemoryDB> c(&m, t.root());
+	GenericTrieDB<MemoryDB> d(&m2);
+	d.init();
+	t.forEach(bytesConstRef(), (unsigned)-1, [&](bytesConstRef _k, bytesConstRef _v){ d.insert(_k, _v); });
+	std::set<bytes> changed;
+	auto change = [&](bytes const& _k, std::string const& _v)
+	{
+		changed.insert(_k);
+		if (_v.empty())
+			c.remove(_k), d.remove(_k);
+		else
+			c.insert(_k, asBytes(_v)), d.insert(_k, asBytes(_v));
+	};
+	change(sha3(toString(3)).asBytes(), "three");
+	change(sha3(toString(4)).asBytes(), "");
+	change(sha3("new").asBytes(), "new");
+	change(asBytes("dog"), "");
+	change(asBytes("do"), "make");
+	change(asBytes("doe"), "deer");
+
+	for (auto const* o: {&c, &d})
+	{
+		std::set<bytes> seen;
+		t.diff(*o, [&](bytes const& _k){ BOOST_CHECK(seen.insert(_k).second); });
+		BOOST_CHECK(seen == changed);
+	}
+	unsigned n = 0;
+	t.diff(t, [&](bytes const&){ ++n; });
+	BOOST_CHECK_EQUAL(n, 0u);
+}
+
 BOOST_AUTO_TEST_CASE(trieStess)
 {
 	cnote << "Stress-testing Trie...";
@@ -0,0 +1,102 @@
+/*
+	This file is part of cpp-ethereum.
+
+	cpp-ethereum is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	cpp-ethereum is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with cpp-ethereum.  If not, see <http://www.gnu.org/licenses/>.
+*/
+/** @file uncles.cpp
+ * @date 2015
+ * Uncle index test functions.
+ */
+
+#include <ctime>
+#include <boost/test/unit_test.hpp>
+#include <libdevcrypto/KeyValueDB.h>
+#include <libethereum/CanonBlockChain.h>
+#include <libethereum/State.h>
+
+using namespace std;
+using namespace dev;
+using namespace dev::eth;
+
+namespace
+{
+
+/// Mines empty blocks onto an in-memory chain, ten seconds apart from an hour ago, with siblings of them if asked.
+struct UncledChain
+{
+	UncledChain(): stateDB(State::openDB(c_memoryDBPath)), s(stateDB, BaseState::CanonGenesis, miner.address()) { s.sync(bc); }
+
+	/// Mines the next block and imports it with @a _siblings others of the same parent. @returns their hashes.
+	h256s mine(unsigned _siblings = 0)
+	{
+		s.commitToMine(bc);
+		s.completeMine();
+
+		// The proof of work is not valid, so they go in as verified, each with a timestamp and nonce of its own.
+		h256s ret;
+		bytes block = s.blockData();
+		RLP r(block);
+		for (unsigned i = 0; i <= _siblings; ++i)
+		{
+			BlockInfo bi(block, CheckNothing);
+			bi.timestamp = (u256)time(0) - 3600 + bi.number * 10 + i;
+			bi.difficulty = bi.calculateDifficulty(bc.info(bi.parentHash));
+			bi.nonce = Nonce(sha3(rlpList(bi.number, i)));
+			bi.noteDirty();
+			RLPStream out(3);
+			bi.streamRLP(out, WithNonce);
+			out.appendRaw(r[1].data()).appendRaw(r[2].data());
+			bc.import(out.out(), stateDB, Aversion::AvoidOldBlocks, true);
+			ret.push_back(bi.hash());
+		}
+		s.sync(bc);
+		return ret;
+	}
+
+	KeyPair miner = KeyPair(sha3("uncle miner"));
+	CanonBlockChain bc{c_memoryDBPath};
+	OverlayDB stateDB;
+	State s;
+};
+
+}
+
+BOOST_AUTO_TEST_SUITE(UncleTests)
+
+BOOST_AUTO_TEST_CASE(uncleCandidatesAreCitedOnce)
+{
+	UncledChain c;
+	c.mine();
+	h256s twins = c.mine(1);
+	h256 head = c.bc.currentHash();
+	h256 side = twins[0] == head ? twins[1] : twins[0];
+
+	// The twin left off the chain is offered to the next block, which cites it.
+	BOOST_CHECK(c.bc.uncleCandidates(head) == h256s{side});
+	h256 nephew = c.mine()[0];
+	BOOST_CHECK(c.bc.uncleHashes(nephew) == h256s{side});
+	BOOST_CHECK(c.bc.allUnclesFrom(nephew).count(side));
+
+	// Once cited it is offered no more, though it is only a generation back.
+	BOOST_CHECK(c.bc.uncleCandidates(nephew).empty());
+	h256 next = c.mine()[0];
+	BOOST_CHECK(c.bc.uncleHashes(next).empty());
+
+	// The index is a cache: emptied, it is filled again from the blocks.
+	c.bc.garbageCollect(true);
+	BOOST_CHECK(c.bc.uncleHashes(nephew) == h256s{side});
+	BOOST_CHECK(c.bc.allUnclesFrom(next).count(side));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
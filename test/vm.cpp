@@ -20,10 +20,13 @@
  * vm test functions.
  */
 
+#include <chrono>
 #include <boost/filesystem.hpp>
 
 #include <libethereum/Executive.h>
+#include <libethereum/StoragePrefetcher.h>
 #include <libevm/VMFactory.h>
+#include <libevm/AdaptiveVM.h>
 #include "vm.h"
 
 using namespace std;
@@ -33,7 +36,7 @@ using namespace dev::eth;
 using namespace dev::test;
 
 FakeExtVM::FakeExtVM(eth::BlockInfo const& _previousBlock, eth::BlockInfo const& _currentBlock, unsigned _depth):			/// TODO: XXX: remove the default argument & fix.
-	ExtVMFace(Address(), Address(), Address(), 0, 1, bytesConstRef(), bytes(), _previousBlock, _currentBlock, test::lastHashes(_currentBlock.number), _depth) {}
+	ExtVMFace(Address(), Address(), Address(), 0, 1, bytesConstRef(), CodeStore::empty(), h256(), _previousBlock, _currentBlock, test::lastHashes(_currentBlock.number), _depth) {}
 
 h160 FakeExtVM::create(u256 _endowment, u256& io_gas, bytesConstRef _init, OnOpFunc const&)
 {
@@ -177,7 +180,7 @@ mObject FakeExtVM::exportExec()
 	push(ret, "gasPrice", gasPrice);
 	push(ret, "gas", gas);
 	ret["data"] = "0x" + toHex(data);
-	ret["code"] = "0x" + toHex(code);
+	ret["code"] = "0x" + toHex(*code);
 	return ret;
 }
 
@@ -200,11 +203,9 @@ void FakeExtVM::importExec(mObject& _o)
 	gas = toInt(_o["gas"]);
 
 	thisTxCode.clear();
-	code = thisTxCode;
+	code = CodeStore::empty();
 
 	thisTxCode = importCode(_o);
-	if (_o["code"].type() != str_type && _o["code"].type() != array_type)
-		code.clear();
 
 	thisTxData.clear();
 	thisTxData = importData(_o);
@@ -315,9 +316,9 @@ void doVMTests(json_spirit::mValue& v, bool _fillin)
 		std::cout << "  " << i.first << "\n";
 		mObject& o = i.second.get_obj();
 
-		BOOST_REQUIRE(o.count("env") > 0);
-		BOOST_REQUIRE(o.count("pre") > 0);
-		BOOST_REQUIRE(o.count("exec") > 0);
+		ETH_TEST_REQUIRE(o.count("env") > 0);
+		ETH_TEST_REQUIRE(o.count("pre") > 0);
+		ETH_TEST_REQUIRE(o.count("exec") > 0);
 
 		FakeExtVM fev;
 		fev.importEnv(o["env"].get_obj());
@@ -327,10 +328,10 @@ void doVMTests(json_spirit::mValue& v, bool _fillin)
 			o["pre"] = mValue(fev.exportState());
 
 		fev.importExec(o["exec"].get_obj());
-		if (fev.code.empty())
+		if (fev.code->empty())
 		{
 			fev.thisTxCode = get<3>(fev.addresses.at(fev.myAddress));
-			fev.code = fev.thisTxCode;
+			fev.code = make_shared<bytes const>(fev.thisTxCode);
 		}
 
 		bytes output;
@@ -356,12 +357,12 @@ void doVMTests(json_spirit::mValue& v, bool _fillin)
 		catch (Exception const& _e)
 		{
 			cnote << "VM did throw an exception: " << diagnostic_information(_e);
-			BOOST_ERROR("Failed VM Test with Exception: " << _e.what());
+			ETH_TEST_ERROR("Failed VM Test with Exception: " << _e.what());
 		}
 		catch (std::exception const& _e)
 		{
 			cnote << "VM did throw an exception: " << _e.what();
-			BOOST_ERROR("Failed VM Test with Exception: " << _e.what());
+			ETH_TEST_ERROR("Failed VM Test with Exception: " << _e.what());
 		}
 
 		// delete null entries in storage for the sake of comparison
@@ -409,13 +410,13 @@ void doVMTests(json_spirit::mValue& v, bool _fillin)
 		{
 			if (o.count("post") > 0)	// No exceptions expected
 			{
-				BOOST_CHECK(!vmExceptionOccured);
+				ETH_TEST_CHECK(!vmExceptionOccured);
 
-				BOOST_REQUIRE(o.count("post") > 0);
-				BOOST_REQUIRE(o.count("callcreates") > 0);
-				BOOST_REQUIRE(o.count("out") > 0);
-				BOOST_REQUIRE(o.count("gas") > 0);
-				BOOST_REQUIRE(o.count("logs") > 0);
+				ETH_TEST_REQUIRE(o.count("post") > 0);
+				ETH_TEST_REQUIRE(o.count("callcreates") > 0);
+				ETH_TEST_REQUIRE(o.count("out") > 0);
+				ETH_TEST_REQUIRE(o.count("gas") > 0);
+				ETH_TEST_REQUIRE(o.count("logs") > 0);
 
 				dev::test::FakeExtVM test;
 				test.importState(o["post"].get_obj());
@@ -424,7 +425,7 @@ void doVMTests(json_spirit::mValue& v, bool _fillin)
 
 				checkOutput(output, o);
 
-				BOOST_CHECK_EQUAL(toInt(o["gas"]), gas);
+				ETH_TEST_CHECK_EQUAL(toInt(o["gas"]), gas);
 
 				State postState, expectState;
 				mObject mPostState = fev.exportState();
@@ -439,7 +440,7 @@ void doVMTests(json_spirit::mValue& v, bool _fillin)
 				checkLog(fev.sub.logs, test.sub.logs);
 			}
 			else	// Exception expected
-				BOOST_CHECK(vmExceptionOccured);
+				ETH_TEST_CHECK(vmExceptionOccured);
 		}
 	}
 }
@@ -450,52 +451,52 @@ BOOST_AUTO_TEST_SUITE(VMTests)
 
 BOOST_AUTO_TEST_CASE(vm_tests)
 {
-	dev::test::executeTests("vmtests", "/VMTests", dev::test::doVMTests);
+	dev::test::executeTests("vmtests", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmArithmeticTest)
 {
-	dev::test::executeTests("vmArithmeticTest", "/VMTests", dev::test::doVMTests);
+	dev::test::executeTests("vmArithmeticTest", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmBitwiseLogicOperationTest)
 {
-	dev::test::executeTests("vmBitwiseLogicOperationTest", "/VMTests", dev::test::doVMTests);
+	dev::test::executeTests("vmBitwiseLogicOperationTest", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmSha3Test)
 {
-	dev::test::executeTests("vmSha3Test", "/VMTests", dev::test::doVMTests);
+	dev::test::executeTests("vmSha3Test", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmEnvironmentalInfoTest)
 {
-	dev::test::executeTests("vmEnvironmentalInfoTest", "/VMTests", dev::test::doVMTests);
+	dev::test::executeTests("vmEnvironmentalInfoTest", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmBlockInfoTest)
 {
-	dev::test::executeTests("vmBlockInfoTest", "/VMTests", dev::test::doVMTests);
+	dev::test::executeTests("vmBlockInfoTest", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmIOandFlowOperationsTest)
 {
-	dev::test::executeTests("vmIOandFlowOperationsTest", "/VMTests", dev::test::doVMTests);
+	dev::test::executeTests("vmIOandFlowOperationsTest", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmPushDupSwapTest)
 {
-	dev::test::executeTests("vmPushDupSwapTest", "/VMTests", dev::test::doVMTests);
+	dev::test::executeTests("vmPushDupSwapTest", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmLogTest)
 {
-	dev::test::executeTests("vmLogTest", "/VMTests", dev::test::doVMTests);
+	dev::test::executeTests("vmLogTest", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmSystemOperationsTest)
 {
-	dev::test::executeTests("vmSystemOperationsTest", "/VMTests", dev::test::doVMTests);
+	dev::test::executeTests("vmSystemOperationsTest", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmPerformanceTest)
@@ -504,22 +505,42 @@ BOOST_AUTO_TEST_CASE(vmPerformanceTest)
 		dev::test::executeTests("vmPerformanceTest", "/VMTests", dev::test::doVMTests);
 }
 
+BOOST_AUTO_TEST_CASE(vmPerformanceThreadedTest)
+{
+	if (!test::Options::get().performance)
+		return;
+
+	// Benchmark the direct-threaded interpreter against the switch-dispatched one.
+	auto run = [](VMKind _kind)
+	{
+		VMFactory::setKind(_kind);
+		auto start = chrono::high_resolution_clock::now();
+		dev::test::executeTests("vmPerformanceTest", "/VMTests", dev::test::doVMTests);
+		return chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - start).count();
+	};
+	auto previous = VMFactory::kind();
+	auto interpreter = run(VMKind::Interpreter);
+	auto threaded = run(VMKind::Threaded);
+	VMFactory::setKind(previous);
+	cnote << "vmPerformanceTest: interpreter" << interpreter << "ms, direct-threaded" << threaded << "ms";
+}
+
 BOOST_AUTO_TEST_CASE(vmInputLimitsTest1)
 {
 	if (test::Options::get().inputLimits)
-		dev::test::executeTests("vmInputLimits1", "/VMTests", dev::test::doVMTests);
+		dev::test::executeTests("vmInputLimits1", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmInputLimitsTest2)
 {
 	if (test::Options::get().inputLimits)
-		dev::test::executeTests("vmInputLimits2", "/VMTests", dev::test::doVMTests);
+		dev::test::executeTests("vmInputLimits2", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmInputLimitsLightTest)
 {
 	if (test::Options::get().inputLimits)
-		dev::test::executeTests("vmInputLimitsLight", "/VMTests", dev::test::doVMTests);
+		dev::test::executeTests("vmInputLimitsLight", "/VMTests", dev::test::doVMTests, true);
 }
 
 BOOST_AUTO_TEST_CASE(vmRandom)
@@ -542,18 +563,18 @@ BOOST_AUTO_TEST_CASE(vmRandom)
 			std::cout << "TEST " << path.filename() << "\n";
 			json_spirit::mValue v;
 			string s = asString(dev::contents(path.string()));
-			BOOST_REQUIRE_MESSAGE(s.length() > 0, "Content of " + path.string() + " is empty. Have you cloned the 'tests' repo branch develop and set ETHEREUM_TEST_PATH to its path?");
-			json_spirit::read_string(s, v);
+			ETH_TEST_REQUIRE_MESSAGE(s.length() > 0, "Content of " + path.string() + " is empty. Have you cloned the 'tests' repo branch develop and set ETHEREUM_TEST_PATH to its path?");
+			dev::test::readJson(s, v);
 			test::Listener::notifySuiteStarted(path.filename().string());
 			doVMTests(v, false);
 		}
 		catch (Exception const& _e)
 		{
-			BOOST_ERROR("Failed test with Exception: " << diagnostic_information(_e));
+			ETH_TEST_ERROR("Failed test with Exception: " << diagnostic_information(_e));
 		}
 		catch (std::exception const& _e)
 		{
-			BOOST_ERROR("Failed test with Exception: " << _e.what());
+			ETH_TEST_ERROR("Failed test with Exception: " << _e.what());
 		}
 	}
 }
@@ -563,4 +584,169 @@ BOOST_AUTO_TEST_CASE(userDefinedFile)
 	dev::test::userDefinedTest("--singletest", dev::test::doVMTests);
 }
 
+BOOST_AUTO_TEST_CASE(vmAnalysedCodeTest)
+{
+	// PUSH1 0x04 JUMP PUSH1 0x5b JUMPDEST PUSH2 0xff(truncated)
+	bytes code = fromHex("600456605b5b61ff");
+	AnalysedCode a(&code);
+	ETH_TEST_CHECK(!a.isJumpDest(4));
+	ETH_TEST_CHECK(a.isJumpDest(5));
+	ETH_TEST_CHECK(!a.isJumpDest(code.size()));
+	ETH_TEST_CHECK(!a.isJumpDest(u256(1) << 200));
+	ETH_TEST_CHECK(a.instruction(0) == Instruction::PUSH1);
+	ETH_TEST_CHECK(a.instruction(code.size()) == Instruction::STOP);
+	ETH_TEST_CHECK_EQUAL(a.pushValue(0), 4);
+	ETH_TEST_CHECK_EQUAL(a.pushValue(3), 0x5b);
+	ETH_TEST_CHECK_EQUAL(a.pushValue(6), 0xff00);
+
+	h256 h = sha3(code);
+	SharedCode shared = make_shared<bytes const>(code);
+	ETH_TEST_CHECK(AnalysedCode::cached(h, shared) == AnalysedCode::cached(h, shared));
+	ETH_TEST_CHECK(&AnalysedCode::cached(h, shared)->code() == shared.get());
+	AnalysedCode::clearCache();
+}
+
+BOOST_AUTO_TEST_CASE(vmBasicBlocksTest)
+{
+	// PUSH1 4 JUMP JUMPDEST JUMPDEST PUSH1 1 POP GAS POP STOP
+	bytes code = fromHex("6004565b5b6001505a5000");
+	AnalysedCode a(&code);
+	ETH_TEST_REQUIRE(a.blockAt(0));
+	ETH_TEST_CHECK_EQUAL(a.blockAt(0)->gas, 3u + 8);
+	ETH_TEST_CHECK(!a.blockAt(2));
+	ETH_TEST_CHECK(a.blockAt(3));
+	ETH_TEST_REQUIRE(a.blockAt(4));
+	ETH_TEST_CHECK_EQUAL(a.blockAt(4)->gas, 1u + 3 + 2 + 2);
+	ETH_TEST_CHECK_EQUAL(a.blockAt(4)->minStack, 0);
+	ETH_TEST_CHECK_EQUAL(a.blockAt(4)->maxStack, (int64_t)c_stackLimit - 1);
+	ETH_TEST_REQUIRE(a.blockAt(9));
+	ETH_TEST_CHECK_EQUAL(a.blockAt(9)->minStack, 1);
+
+	// Paying for blocks on entry must leave the same gas, and fail at the same step in the same way, as
+	// paying for each step, which the VM does when there is an _onOp.
+	auto run = [](bytes const& _code, u256 _gas, bool _stepwise) -> pair<u256, string>
+	{
+		FakeExtVM fev;
+		fev.code = make_shared<bytes const>(_code);
+		auto vm = eth::VMFactory::create(VMKind::Interpreter, _gas);
+		OnOpFunc onOp;
+		if (_stepwise)
+			onOp = [](uint64_t, Instruction, bigint, bigint, VM*, ExtVMFace const*) {};
+		try
+		{
+			vm->go(fev, onOp);
+			return make_pair(vm->gas(), string());
+		}
+		catch (VMException const& _e)
+		{
+			return make_pair(vm->gas(), string(typeid(_e).name()));
+		}
+	};
+	for (char const* hex: {
+		"6004565b5b6001505a5000",
+		// PUSH1 0 PUSH1 0 SSTORE PUSH1 1 PUSH1 1 ADD POP INVALID
+		"600060005560016001015021",
+		// PUSH1 1 POP POP
+		"60015050",
+		// PUSH1 3 PUSH1 2 EXP PUSH1 0 MSTORE PUSH1 0x20 PUSH1 0 RETURN
+		"600360020a60005260206000f3"
+	})
+		for (u256 gas = 0; gas < 25000; gas += gas < 100 ? 1 : 997)
+			ETH_TEST_CHECK(run(fromHex(hex), gas, false) == run(fromHex(hex), gas, true));
+}
+
+BOOST_AUTO_TEST_CASE(vmStorageSlotsTest)
+{
+	// PUSH1 3 SLOAD PUSH1 0 CALLDATALOAD SLOAD PUSH1 0x20 SLOAD PUSH1 3 SLOAD
+	bytes code = fromHex("60035460003554602054600354");
+	ETH_TEST_CHECK(AnalysedCode(&code).constantSlots() == u256s({3, 0x20}));
+
+	h256 h = sha3(code);
+	StoragePrefetcher::get().noteLoads(h, {7, 3});
+	StoragePrefetcher::get().noteLoads(h, {3, 9});
+	ETH_TEST_CHECK(StoragePrefetcher::get().history(h) == u256s({7, 3, 9}));
+}
+
+BOOST_AUTO_TEST_CASE(vmCodeStoreTest)
+{
+	bytes code = fromHex("60016002");
+	h256 h = sha3(code);
+	unsigned loads = 0;
+	auto load = [&]() { ++loads; return code; };
+	SharedCode a = CodeStore::get().code(h, load);
+	SharedCode b = CodeStore::get().code(h, load);
+	ETH_TEST_CHECK_EQUAL(loads, 1u);
+	ETH_TEST_CHECK(a == b);
+	ETH_TEST_CHECK(*a == code);
+}
+
+BOOST_AUTO_TEST_CASE(vmProfilerTest)
+{
+	FakeExtVM fev;
+	// PUSH1 0x02 PUSH1 0x03 ADD POP STOP
+	fev.code = make_shared<bytes const>(fromHex("60026003015000"));
+	VMProfiler::get().reset();
+	VMProfiler::get().setEnabled(true);
+	auto vm = eth::VMFactory::create(100000);
+	vm->go(fev);
+	VMProfiler::get().setEnabled(false);
+
+	auto hotSpots = VMProfiler::get().hotSpots();
+	ETH_TEST_REQUIRE_EQUAL(hotSpots.size(), 1u);
+	ETH_TEST_CHECK(hotSpots[0].first == sha3(*fev.code));
+	CodeProfile const& p = hotSpots[0].second;
+	ETH_TEST_CHECK_EQUAL(p.runs, 1u);
+	ETH_TEST_CHECK_EQUAL(p.steps, 5u);
+	ETH_TEST_CHECK_EQUAL(p.gas, 100000 - vm->gas());
+	ETH_TEST_CHECK_EQUAL(p.opcodes[(byte)Instruction::PUSH1].count, 2u);
+	ETH_TEST_CHECK_EQUAL(p.opcodes[(byte)Instruction::ADD].count, 1u);
+	ETH_TEST_CHECK_EQUAL(p.opcodes[(byte)Instruction::MUL].count, 0u);
+	VMProfiler::get().reset();
+}
+
+BOOST_AUTO_TEST_CASE(vmAdaptiveKindTest)
+{
+	FakeExtVM fev;
+	// PUSH1 0x2a PUSH1 0x00 MSTORE PUSH1 0x20 PUSH1 0x00 RETURN
+	fev.code = make_shared<bytes const>(fromHex("602a60005260206000f3"));
+	fev.codeHash = sha3(*fev.code);
+	auto interpreter = eth::VMFactory::create(VMKind::Interpreter, 100000);
+	bytes out = interpreter->go(fev).toBytes();
+	ETH_TEST_CHECK(out == h256(0x2a).asBytes());
+	for (unsigned i = 0; i < AdaptiveVM::promotionThreshold() + 2; ++i)
+	{
+		auto vm = eth::VMFactory::create(VMKind::Adaptive, 100000);
+		ETH_TEST_CHECK(vm->go(fev).toBytes() == out);
+		ETH_TEST_CHECK_EQUAL(vm->gas(), interpreter->gas());
+	}
+	AdaptiveVM::clear();
+}
+
+BOOST_AUTO_TEST_CASE(vmModularArithmeticTest)
+{
+	auto run = [](Instruction _op, u256 _x, u256 _y, u256 _m)
+	{
+		FakeExtVM fev;
+		bytes c;
+		for (u256 const& v: {_m, _y, _x})
+		{
+			c.push_back((byte)Instruction::PUSH32);
+			c += h256(v).asBytes();
+		}
+		c += bytes{(byte)_op, 0x60, 0x00, 0x52, 0x60, 0x20, 0x60, 0x00, 0xf3};
+		fev.code = make_shared<bytes const>(c);
+		auto vm = eth::VMFactory::create(100000);
+		return u256(h256(vm->go(fev).toBytes()));
+	};
+
+	u256 const big = ~u256(0) - 7;
+	for (u256 const& m: {u256(0), u256(1), u256(97), u256(1) << 130, big})
+	{
+		ETH_TEST_CHECK_EQUAL(run(Instruction::MULMOD, big, big - 1, m), m ? u256((bigint(big) * (big - 1)) % m) : 0);
+		ETH_TEST_CHECK_EQUAL(run(Instruction::ADDMOD, big, big - 1, m), m ? u256((bigint(big) + (big - 1)) % m) : 0);
+	}
+	ETH_TEST_CHECK_EQUAL(run(Instruction::EXP, 3, 200, 0), u256(boost::multiprecision::powm(bigint(3), bigint(200), bigint(1) << 256)));
+	ETH_TEST_CHECK_EQUAL(run(Instruction::EXP, big, big, 0), u256(boost::multiprecision::powm(bigint(big), bigint(big), bigint(1) << 256)));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
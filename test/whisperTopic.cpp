@@ -298,4 +298,23 @@ BOOST_AUTO_TEST_CASE(asyncforwarding)
 }
 #endif
 
+BOOST_AUTO_TEST_CASE(topicBloomFilter)
+{
+	CollapsedTopic odd = BuildTopic("odd");
+	CollapsedTopic even = BuildTopic("even");
+	TopicBloomFilter bloom = TopicFilter(BuildTopicMask("odd").toTopicMask()).exportBloom();
+	BOOST_CHECK(bloomMatches(bloom, odd));
+	BOOST_CHECK(bloomMatches(bloom, BuildTopic("even")("odd")));
+	BOOST_CHECK(!bloomMatches(bloom, even));
+	BOOST_CHECK(!bloomMatches(bloom, CollapsedTopic()));
+
+	// Every part matched exactly must be in an envelope's topic; a filter without any such part may match anything.
+	InstalledFilter both(BuildTopicMask("odd")("even"));
+	BOOST_CHECK(!both.mayMatch(topicBloom(odd)));
+	BOOST_CHECK(both.mayMatch(topicBloom(CollapsedTopic(BuildTopic("even")("odd")))));
+	InstalledFilter any(FullTopic{h256()});
+	BOOST_CHECK(any.filter.exportBloom() == ~TopicBloomFilter());
+	BOOST_CHECK(any.mayMatch(TopicBloomFilter()));
+}
+
 BOOST_AUTO_TEST_SUITE_END()